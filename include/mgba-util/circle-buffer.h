@@ -33,6 +33,53 @@ int CircleBufferRead32(struct CircleBuffer* buffer, int32_t* value);
 size_t CircleBufferRead(struct CircleBuffer* buffer, void* output, size_t length);
 size_t CircleBufferDump(const struct CircleBuffer* buffer, void* output, size_t length);
 
+// A byte ring whose capacity is a power of two. The indices run freely and are only masked
+// when the data is touched, so the size is their difference and nothing needs a wraparound
+// branch. Single bytes go through the inline accessors; bulk copies take at most two memcpys.
+struct CircleBufferMasked {
+	uint8_t* data;
+	uint32_t mask;
+	uint32_t readIndex;
+	uint32_t writeIndex;
+};
+
+// Capacity is rounded up to a power of two
+void CircleBufferMaskedInit(struct CircleBufferMasked* buffer, size_t capacity);
+void CircleBufferMaskedDeinit(struct CircleBufferMasked* buffer);
+void CircleBufferMaskedClear(struct CircleBufferMasked* buffer);
+// Like CircleBufferWrite, this writes all of length or nothing
+size_t CircleBufferMaskedWrite(struct CircleBufferMasked* buffer, const void* input, size_t length);
+// These transfer up to length bytes, and return how many they did
+size_t CircleBufferMaskedRead(struct CircleBufferMasked* buffer, void* output, size_t length);
+size_t CircleBufferMaskedPeek(const struct CircleBufferMasked* buffer, void* output, size_t length);
+size_t CircleBufferMaskedDiscard(struct CircleBufferMasked* buffer, size_t length);
+
+static inline size_t CircleBufferMaskedSize(const struct CircleBufferMasked* buffer) {
+	return (uint32_t) (buffer->writeIndex - buffer->readIndex);
+}
+
+static inline size_t CircleBufferMaskedCapacity(const struct CircleBufferMasked* buffer) {
+	return (size_t) buffer->mask + 1;
+}
+
+static inline int CircleBufferMaskedWrite8(struct CircleBufferMasked* buffer, int8_t value) {
+	if (CircleBufferMaskedSize(buffer) > buffer->mask) {
+		return 0;
+	}
+	buffer->data[buffer->writeIndex & buffer->mask] = value;
+	++buffer->writeIndex;
+	return 1;
+}
+
+static inline int CircleBufferMaskedRead8(struct CircleBufferMasked* buffer, int8_t* value) {
+	if (buffer->writeIndex == buffer->readIndex) {
+		return 0;
+	}
+	*value = buffer->data[buffer->readIndex & buffer->mask];
+	++buffer->readIndex;
+	return 1;
+}
+
 CXX_GUARD_END
 
 #endif
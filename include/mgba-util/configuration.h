@@ -17,6 +17,8 @@ struct VFile;
 struct Configuration {
 	struct Table sections;
 	struct Table root;
+	// Bumped on every change, so anything derived from the values can tell when it is stale
+	unsigned generation;
 };
 
 void ConfigurationInit(struct Configuration*);
@@ -11,6 +11,9 @@
 CXX_GUARD_START
 
 uint32_t hash32(const void* key, int len, uint32_t seed);
+// XXH64. Reads the data as little-endian words, so it hashes the same on every host, but the
+// data must be 8-byte aligned on big-endian ones.
+uint64_t hash64(const void* key, size_t len, uint64_t seed);
 
 CXX_GUARD_END
 
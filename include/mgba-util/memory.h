@@ -13,6 +13,11 @@ CXX_GUARD_START
 void* anonymousMemoryMap(size_t size);
 void mappedMemoryFree(void* memory, size_t size);
 
+// Like anonymousMemoryMap, but backed by huge pages where the platform and build support it,
+// for blocks the emulator accesses constantly. Must be freed with hugeMemoryFree and the same size.
+void* hugeMemoryMap(size_t size);
+void hugeMemoryFree(void* memory, size_t size);
+
 CXX_GUARD_END
 
 #endif
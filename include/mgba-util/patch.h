@@ -17,6 +17,14 @@ struct Patch {
 
 	size_t (*outputSize)(struct Patch* patch, size_t inSize);
 	bool (*applyPatch)(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize);
+	// Optional. Patches a private, copy-on-write mapping of the input where it lies, so only the pages the
+	// records cover get copied. Only applies to patches that keep the size the same; otherwise, or if the
+	// patch doesn't validate, the buffer is left as it was and false is returned.
+	bool (*applyPatchInPlace)(struct Patch* patch, void* buffer, size_t size);
+
+	// Set when applying the patch had to checksum the whole output anyway
+	bool hasOutputCrc32;
+	uint32_t outputCrc32;
 };
 
 bool loadPatch(struct VFile* vf, struct Patch* patch);
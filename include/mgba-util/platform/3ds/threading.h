@@ -90,11 +90,15 @@ static inline int ConditionWake(Condition* cond) {
 	return 0;
 }
 
+// The processor new threads run on: the New 3DS's third core by default. An Old 3DS can only use the
+// system core, and only for the share of time set with APT_SetAppCpuTimeLimit.
+extern int ctrThreadCore;
+
 static inline int ThreadCreate(Thread* thread, ThreadEntry entry, void* context) {
 	if (!entry || !thread) {
 		return 1;
 	}
-	*thread = threadCreate(entry, context, 0x8000, 0x18, 2, true);
+	*thread = threadCreate(entry, context, 0x8000, 0x18, ctrThreadCore, true);
 	return !*thread;
 }
 
@@ -107,4 +111,20 @@ static inline void ThreadSetName(const char* name) {
 	// Unimplemented
 }
 
+static inline int ThreadSetAffinity(uint64_t cpus) {
+	UNUSED(cpus);
+	// Unimplemented
+	return -1;
+}
+
+static inline int ThreadSetHighPriority(void) {
+	// Unimplemented
+	return -1;
+}
+
+static inline int ThreadSleep(uint32_t microseconds) {
+	svcSleepThread((s64) microseconds * 1000);
+	return 0;
+}
+
 #endif
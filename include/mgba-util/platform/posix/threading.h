@@ -11,7 +11,9 @@
 CXX_GUARD_START
 
 #include <pthread.h>
+#include <sched.h>
 #include <sys/time.h>
+#include <time.h>
 #ifdef HAVE_PTHREAD_NP_H
 #include <pthread_np.h>
 #elif defined(__HAIKU__)
@@ -101,6 +103,38 @@ static inline int ThreadSetName(const char* name) {
 #endif
 }
 
+// Pins the calling thread to the CPUs set in the mask
+static inline int ThreadSetAffinity(uint64_t cpus) {
+#if defined(HAVE_PTHREAD_SETAFFINITY_NP) && defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	int cpu;
+	for (cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; ++cpu) {
+		if (cpus & (1ULL << cpu)) {
+			CPU_SET(cpu, &set);
+		}
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	UNUSED(cpus);
+	return -1;
+#endif
+}
+
+static inline int ThreadSetHighPriority(void) {
+	// Real-time scheduling needs privileges on most systems, so this may fail
+	struct sched_param param = { .sched_priority = sched_get_priority_min(SCHED_RR) };
+	return pthread_setschedparam(pthread_self(), SCHED_RR, &param);
+}
+
+static inline int ThreadSleep(uint32_t microseconds) {
+	struct timespec ts = {
+		.tv_sec = microseconds / 1000000,
+		.tv_nsec = (microseconds % 1000000) * 1000
+	};
+	return nanosleep(&ts, NULL);
+}
+
 CXX_GUARD_END
 
 #endif
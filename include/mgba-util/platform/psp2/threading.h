@@ -143,4 +143,17 @@ static inline int ThreadSetName(const char* name) {
 	UNUSED(name);
 	return -1;
 }
+
+static inline int ThreadSetAffinity(uint64_t cpus) {
+	UNUSED(cpus);
+	return -1;
+}
+
+static inline int ThreadSetHighPriority(void) {
+	return -1;
+}
+
+static inline int ThreadSleep(uint32_t microseconds) {
+	return sceKernelDelayThread(microseconds);
+}
 #endif
@@ -84,4 +84,20 @@ static inline void ThreadSetName(const char* name) {
 	// Unimplemented
 }
 
+static inline int ThreadSetAffinity(uint64_t cpus) {
+	UNUSED(cpus);
+	// Unimplemented
+	return -1;
+}
+
+static inline int ThreadSetHighPriority(void) {
+	// Unimplemented
+	return -1;
+}
+
+static inline int ThreadSleep(uint32_t microseconds) {
+	svcSleepThread((s64) microseconds * 1000);
+	return 0;
+}
+
 #endif
@@ -88,4 +88,37 @@ static inline int ThreadSetName(const char* name) {
 	return -1;
 }
 
+static inline int ThreadSetAffinity(uint64_t cpus) {
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) cpus) ? 0 : -1;
+}
+
+static inline int ThreadSetHighPriority(void) {
+	return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST) ? 0 : -1;
+}
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Sleep rounds up to the scheduler tick, which can be as long as 15.6 ms, so this uses a
+// waitable timer, which is high resolution on Windows 10 1803 and newer
+static inline int ThreadSleep(uint32_t microseconds) {
+	HANDLE timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!timer) {
+		timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+	}
+	if (!timer) {
+		return -1;
+	}
+	LARGE_INTEGER due;
+	// Relative times are negative, in 100 ns units
+	due.QuadPart = -(LONGLONG) microseconds * 10;
+	int ret = -1;
+	if (SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE) && WaitForSingleObject(timer, INFINITE) == WAIT_OBJECT_0) {
+		ret = 0;
+	}
+	CloseHandle(timer);
+	return ret;
+}
+
 #endif
@@ -0,0 +1,60 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef RING_SPSC_H
+#define RING_SPSC_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#define RING_SPSC_CACHE_LINE 64
+
+// A byte ring for exactly one producer thread and one consumer thread that needs no locking.
+// Unlike RingFIFO the indices are free-running counters published with acquire/release
+// atomics, the capacity is a power of two, and each side works on a cached copy of the
+// other side's index so touching the shared cache line is only needed when space runs out.
+// Reserve/Commit and Peek/Consume let either side work on the buffer in place, in batches.
+struct RingSPSC {
+	uint8_t* data;
+	uint32_t mask;
+	uint8_t padding0[RING_SPSC_CACHE_LINE];
+
+	// Producer side
+	uint32_t writeIndex;
+	uint32_t readIndexCache;
+	uint8_t padding1[RING_SPSC_CACHE_LINE];
+
+	// Consumer side
+	uint32_t readIndex;
+	uint32_t writeIndexCache;
+	uint8_t padding2[RING_SPSC_CACHE_LINE];
+};
+
+// Capacity is rounded up to a power of two, and may not exceed 2 GiB
+void RingSPSCInit(struct RingSPSC* ring, size_t capacity);
+void RingSPSCDeinit(struct RingSPSC* ring);
+size_t RingSPSCCapacity(const struct RingSPSC* ring);
+size_t RingSPSCSize(const struct RingSPSC* ring);
+// Not thread-safe: neither side may be using the ring
+void RingSPSCClear(struct RingSPSC* ring);
+
+// Producer only. Returns NULL unless at least *length contiguous bytes are free, otherwise
+// sets *length to the full contiguous free span. Nothing is visible until it is committed.
+void* RingSPSCReserve(struct RingSPSC* ring, size_t* length);
+void RingSPSCCommit(struct RingSPSC* ring, size_t length);
+// Consumer only. Returns NULL unless at least *length contiguous bytes are queued, otherwise
+// sets *length to the full contiguous queued span. The span stays valid until it is consumed.
+const void* RingSPSCPeek(struct RingSPSC* ring, size_t* length);
+void RingSPSCConsume(struct RingSPSC* ring, size_t length);
+
+// Copying wrappers that handle wrapping around the end. Like RingFIFO, these either transfer
+// all of length and return it, or transfer nothing and return 0.
+size_t RingSPSCWrite(struct RingSPSC* ring, const void* value, size_t length);
+size_t RingSPSCRead(struct RingSPSC* ring, void* output, size_t length);
+
+CXX_GUARD_END
+
+#endif
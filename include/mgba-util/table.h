@@ -10,10 +10,10 @@
 
 CXX_GUARD_START
 
-struct TableList;
+struct TableTuple;
 
 struct Table {
-	struct TableList* table;
+	struct TableTuple* table;
 	size_t tableSize;
 	size_t size;
 	void (*deinitializer)(void*);
@@ -22,6 +22,9 @@ struct Table {
 void TableInit(struct Table*, size_t initialSize, void (deinitializer(void*)));
 void TableDeinit(struct Table*);
 
+// Grows the table once so that count entries fit without rehashing along the way
+void TableReserve(struct Table*, size_t count);
+
 void* TableLookup(const struct Table*, uint32_t key);
 void TableInsert(struct Table*, uint32_t key, void* value);
 
@@ -33,6 +36,7 @@ size_t TableSize(const struct Table*);
 
 void HashTableInit(struct Table* table, size_t initialSize, void (deinitializer(void*)));
 void HashTableDeinit(struct Table* table);
+void HashTableReserve(struct Table* table, size_t count);
 
 void* HashTableLookup(const struct Table*, const char* key);
 void HashTableInsert(struct Table*, const char* key, void* value);
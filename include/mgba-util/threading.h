@@ -87,6 +87,11 @@ static inline int ConditionWake(Condition* cond) {
 	UNUSED(cond);
 	return 0;
 }
+
+static inline int ThreadSleep(uint32_t microseconds) {
+	UNUSED(microseconds);
+	return -1;
+}
 #endif
 
 CXX_GUARD_END
@@ -47,6 +47,7 @@ struct VFile {
 	void (*unmap)(struct VFile* vf, void* memory, size_t size);
 	void (*truncate)(struct VFile* vf, size_t size);
 	ssize_t (*size)(struct VFile* vf);
+	// buffer may be any part of a mapping, in which case only that part is written back
 	bool (*sync)(struct VFile* vf, const void* buffer, size_t size);
 };
 
@@ -73,6 +74,13 @@ struct VFile* VFileFromMemory(void* mem, size_t size);
 struct VFile* VFileFromConstMemory(const void* mem, size_t size);
 struct VFile* VFileMemChunk(const void* mem, size_t size);
 
+// An arena hands out empty growable memory VFiles that keep their buffers when closed, so
+// repeated captures stop allocating once warmed up. It must outlive the VFiles it returns.
+struct VFileMemArena;
+struct VFileMemArena* VFileMemArenaCreate(void);
+void VFileMemArenaDestroy(struct VFileMemArena*);
+struct VFile* VFileMemArenaChunk(struct VFileMemArena*);
+
 struct CircleBuffer;
 struct VFile* VFileFIFO(struct CircleBuffer* backing);
 
@@ -0,0 +1,51 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_ASYNC_WRITER_H
+#define M_ASYNC_WRITER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#ifndef DISABLE_THREADING
+#include <mgba-util/threading.h>
+#endif
+
+// A unit of deferred file output. The job owns everything it writes, and run is responsible
+// for freeing the job once it's done.
+struct mAsyncWriterJob {
+	void (*run)(struct mAsyncWriterJob*);
+	struct mAsyncWriterJob* next;
+};
+
+struct mAsyncWriter {
+#ifndef DISABLE_THREADING
+	Thread thread;
+	Mutex mutex;
+	Condition queued;
+	Condition drained;
+	struct mAsyncWriterJob* head;
+	struct mAsyncWriterJob* tail;
+	bool busy;
+	bool exiting;
+	bool running;
+#else
+	int dummy;
+#endif
+};
+
+void mAsyncWriterInit(struct mAsyncWriter*);
+// Finishes every queued job before returning
+void mAsyncWriterDeinit(struct mAsyncWriter*);
+
+// Jobs run in the order they're submitted. Without a worker thread, the job runs before this returns.
+void mAsyncWriterSubmit(struct mAsyncWriter*, struct mAsyncWriterJob*);
+// Waits for every job submitted so far, e.g. before reading back a file one of them is writing
+void mAsyncWriterFlush(struct mAsyncWriter*);
+
+CXX_GUARD_END
+
+#endif
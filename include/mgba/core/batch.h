@@ -0,0 +1,44 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_BATCH_H
+#define M_CORE_BATCH_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#define mCORE_BATCH_MAX_THREADS 64
+
+struct mCore;
+struct mCoreBatchThreads;
+struct mCoreBatch {
+	size_t nThreads;
+
+	// The step in progress; only valid while mCoreBatchStep is running
+	struct mCore** cores;
+	size_t nCores;
+	unsigned frames;
+	const uint32_t* keys;
+	bool renderLast;
+	size_t next;
+	size_t finished;
+
+	// Kept out of line so the struct's layout doesn't depend on the threading backend
+	struct mCoreBatchThreads* threads;
+};
+
+// nThreads counts the calling thread, so 1 runs every core on the caller
+void mCoreBatchInit(struct mCoreBatch*, size_t nThreads);
+void mCoreBatchDeinit(struct mCoreBatch*);
+
+// Runs each core for the given number of frames. keys holds frames entries per core, one per frame, in
+// core order, or is NULL to leave the keys alone. With renderLast, only the last frame is drawn and
+// only its audio is kept, so the video buffers end up holding the final frame of each core.
+void mCoreBatchStep(struct mCoreBatch*, struct mCore** cores, size_t nCores, unsigned frames, const uint32_t* keys, bool renderLast);
+
+CXX_GUARD_END
+
+#endif
@@ -58,6 +58,11 @@ interleaving of two buffers into a stereo sample stream. Outputs 16-bit signed
 samples. Returns number of samples actually read.  */
 int blip_read_samples( blip_t*, short out [], int count, int stereo );
 
+/** Reads and removes at most 'count' samples from both buffers in one pass and
+writes them to 'out' interleaved as left/right pairs. Stops at whichever buffer
+has fewer samples available. Returns number of sample pairs actually read.  */
+int blip_read_samples_stereo( blip_t* left, blip_t* right, short out [], int count );
+
 /** Frees buffer. No effect if NULL is passed. */
 void blip_delete( blip_t* );
 
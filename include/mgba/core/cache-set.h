@@ -23,6 +23,13 @@ struct mCacheSet {
 	struct mMapCacheSet maps;
 	struct mBitmapCacheSet bitmaps;
 	struct mTileCacheSet tiles;
+
+	// When deferred, writes only set bits here and are applied by mCacheSetApplyDeferred
+	uint32_t* deferredVRAM;
+	size_t deferredVRAMSize;
+	uint32_t* deferredPalette;
+	color_t* deferredColors;
+	size_t deferredPaletteSize;
 };
 
 void mCacheSetInit(struct mCacheSet*, size_t nMaps, size_t nBitmaps, size_t nTiles);
@@ -33,6 +40,10 @@ void mCacheSetAssignVRAM(struct mCacheSet*, void* vram);
 void mCacheSetWriteVRAM(struct mCacheSet*, uint32_t address);
 void mCacheSetWritePalette(struct mCacheSet*, uint32_t entry, color_t color);
 
+// Only call mCacheSetDefer while no writes are in flight; mCacheSetApplyDeferred may then run on any one thread
+void mCacheSetDefer(struct mCacheSet*, size_t vramSize, size_t paletteSize);
+size_t mCacheSetApplyDeferred(struct mCacheSet*);
+
 CXX_GUARD_END
 
 #endif
@@ -49,6 +49,7 @@ mLOG_DECLARE_CATEGORY(CHEATS);
 DECLARE_VECTOR(mCheatList, struct mCheat);
 
 struct mCheatDevice;
+struct mCheatProgram;
 struct mCheatSet {
 	struct mCheatList list;
 
@@ -67,10 +68,26 @@ struct mCheatSet {
 	char* name;
 	bool enabled;
 	struct StringList lines;
+
+	// Compiled form of list, rebuilt on refresh whenever list changes
+	struct mCheatProgram* program;
 };
 
 DECLARE_VECTOR(mCheatSets, struct mCheatSet*);
 
+#define mCHEAT_MAX_MEMORY_REGIONS 4
+
+struct mCoreMemoryDirty;
+struct mCheatMemoryRegion {
+	uint32_t start;
+	uint32_t end;
+	uint32_t mask;
+	uint32_t size;
+	uint8_t* memory;
+	struct mCoreMemoryDirty* dirty;
+	uint32_t dirtyBase;
+};
+
 struct mCheatDevice {
 	struct mCPUComponent d;
 	struct mCore* p;
@@ -80,6 +97,12 @@ struct mCheatDevice {
 	struct mCheatSets cheats;
 	bool autosave;
 	bool buttonDown;
+
+	// Plain little-endian memory that aligned cheat accesses may touch directly instead of going over the bus.
+	// Called before cheats run and after every bus write, since banking or DMA can move or block these regions.
+	void (*updateRegions)(struct mCheatDevice*);
+	struct mCheatMemoryRegion regions[mCHEAT_MAX_MEMORY_REGIONS];
+	size_t nRegions;
 };
 
 struct VFile;
@@ -12,11 +12,14 @@ CXX_GUARD_START
 
 #include <mgba-util/configuration.h>
 
+struct mCoreConfigCache;
 struct mCoreConfig {
 	struct Configuration configTable;
 	struct Configuration defaultsTable;
 	struct Configuration overridesTable;
 	char* port;
+	// Resolved and parsed lookups, discarded whenever any of the tables changes
+	struct mCoreConfigCache* cache;
 };
 
 enum mCoreConfigLevel {
@@ -31,6 +34,9 @@ struct mCoreOptions {
 	bool useBios;
 	int logLevel;
 	int frameskip;
+	int runAhead;
+	// Have the frontend sample input when the game first reads the keys each frame
+	bool lateInput;
 	bool rewindEnable;
 	int rewindBufferCapacity;
 	float fpsTarget;
@@ -54,9 +60,17 @@ struct mCoreOptions {
 
 	int volume;
 	bool mute;
+	// Skip audio synthesis entirely, keeping only the state software can observe
+	bool skipAudio;
+	// Trade compression ratio for speed when writing savestates and video logs
+	bool fastCompression;
 
 	bool videoSync;
 	bool audioSync;
+	bool framePacing;
+	float audioRateControl;
+	// Let the audio device pull small buffers and pace the audio it is handed, see mCoreSyncSetAudioPull
+	bool lowLatencyAudio;
 };
 
 void mCoreConfigInit(struct mCoreConfig*, const char* port);
@@ -76,6 +90,8 @@ const char* mCoreConfigGetValue(const struct mCoreConfig*, const char* key);
 bool mCoreConfigGetIntValue(const struct mCoreConfig*, const char* key, int* value);
 bool mCoreConfigGetUIntValue(const struct mCoreConfig*, const char* key, unsigned* value);
 bool mCoreConfigGetFloatValue(const struct mCoreConfig*, const char* key, float* value);
+// Parses a list of CPU indices and ranges, such as "0,2-3", into a bitmask
+bool mCoreConfigGetCPUMaskValue(const struct mCoreConfig*, const char* key, uint64_t* value);
 
 void mCoreConfigSetValue(struct mCoreConfig*, const char* key, const char* value);
 void mCoreConfigSetIntValue(struct mCoreConfig*, const char* key, int value);
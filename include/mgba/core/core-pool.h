@@ -0,0 +1,71 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_POOL_H
+#define M_CORE_POOL_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/rom-cache.h>
+#include <mgba-util/table.h>
+#ifndef DISABLE_THREADING
+#include <mgba-util/threading.h>
+#endif
+
+struct mCore;
+struct VFile;
+
+// Keeps initialized cores per ROM, along with a snapshot of each ROM's state right after reset.
+// Cores handed out by the pool always start from that snapshot, and can be put back into it with
+// mCorePoolResetCore, which restores the state in place instead of reinitializing the core.
+struct mCorePool {
+	struct mROMCache romCache;
+	struct Table roms;
+	// Idle cores kept per ROM; any more are destroyed when released. Zero means no limit.
+	size_t maxIdle;
+
+	// Called on each new core after init and before loading the ROM, to configure it and attach buffers
+	void (*setup)(struct mCorePool*, struct mCore*);
+	// Called before the pool deinitializes a core, to free whatever setup attached to it
+	void (*teardown)(struct mCorePool*, struct mCore*);
+	void* context;
+#ifndef DISABLE_THREADING
+	Mutex mutex;
+#endif
+};
+
+void mCorePoolInit(struct mCorePool*);
+// Every acquired core must be released first
+void mCorePoolDeinit(struct mCorePool*);
+
+// Takes ownership of vf
+struct mCore* mCorePoolAcquire(struct mCorePool*, struct VFile* vf);
+struct mCore* mCorePoolAcquireCRC32(struct mCorePool*, uint32_t crc32);
+void mCorePoolRelease(struct mCorePool*, struct mCore*);
+
+bool mCorePoolResetCore(struct mCorePool*, struct mCore*);
+
+// A core's state and save data stored as differences from its ROM's snapshot, which are usually
+// a small fraction of a savestate. Hibernating a core releases it back to the pool, so it can go
+// to another session or be destroyed under maxIdle, and waking takes a core from the pool again.
+// Anything running the core, such as an mCoreThread, has to be ended first.
+struct mCoreHibernation;
+
+struct mCoreHibernation* mCorePoolHibernate(struct mCorePool*, struct mCore*);
+// Frees the hibernation whether or not a core could be woken. Fails if the pool doesn't have the
+// ROM, such as when the hibernation was loaded into a new pool that hasn't acquired a core for it.
+struct mCore* mCorePoolWake(struct mCorePool*, struct mCoreHibernation*);
+void mCoreHibernationFree(struct mCoreHibernation*);
+
+size_t mCoreHibernationSize(const struct mCoreHibernation*);
+uint32_t mCoreHibernationCRC32(const struct mCoreHibernation*);
+bool mCoreHibernationSave(const struct mCoreHibernation*, struct VFile*);
+struct mCoreHibernation* mCoreHibernationLoad(struct VFile*);
+
+CXX_GUARD_END
+
+#endif
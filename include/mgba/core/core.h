@@ -36,9 +36,12 @@ enum mCoreChecksumType {
 	CHECKSUM_CRC32,
 };
 
+struct mAsyncWriter;
 struct mCoreConfig;
 struct mCoreSync;
 struct mDebuggerSymbols;
+struct mPerfCounters;
+struct mMemoryHeatmap;
 struct mStateExtdata;
 struct mVideoLogContext;
 struct mCore {
@@ -48,6 +51,8 @@ struct mCore {
 	struct mDebugger* debugger;
 	struct mDebuggerSymbols* symbolTable;
 	struct mVideoLogger* videoLogger;
+	// When set, screenshots and savestates with screenshots are encoded and written here instead of inline
+	struct mAsyncWriter* asyncWriter;
 
 #if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
 	struct mDirectorySet dirs;
@@ -71,6 +76,13 @@ struct mCore {
 
 	void (*desiredVideoDimensions)(struct mCore*, unsigned* width, unsigned* height);
 	void (*setVideoBuffer)(struct mCore*, color_t* buffer, size_t stride);
+	// Picks what the software renderer writes into the video buffer, which must then be sized to match;
+	// the stride stays in pixels. Every core takes mCOLOR_NATIVE. In 32-bit builds the GBA core also takes
+	// mCOLOR_RGB565, halving the buffer, and mCOLOR_NATIVE | mCOLOR_TILED_4X4, so a frontend can hand it
+	// a texture to fill directly. Frames from getPixels and the AV stream come out in this format, while
+	// putPixels always takes linear color_t. Returns false if the format isn't supported.
+	bool (*setVideoBufferFormat)(struct mCore*, enum mColorFormat);
+	enum mColorFormat (*videoBufferFormat)(const struct mCore*);
 	void (*setVideoGLTex)(struct mCore*, unsigned texid);
 
 	void (*getPixels)(struct mCore*, const void** buffer, size_t* stride);
@@ -83,6 +95,13 @@ struct mCore {
 	void (*addCoreCallbacks)(struct mCore*, struct mCoreCallbacks*);
 	void (*clearCoreCallbacks)(struct mCore*);
 	void (*setAVStream)(struct mCore*, struct mAVStream*);
+	// Suppressed video is neither rendered nor posted; suppressed audio never reaches the blip buffers
+	void (*setOutputSuppressed)(struct mCore*, bool video, bool audio);
+	// Attaches a caller-owned counter block, or detaches it with NULL. Returns false if the
+	// core was built without ENABLE_PERF_COUNTERS, in which case nothing is ever counted.
+	bool (*setPerfCounters)(struct mCore*, struct mPerfCounters*);
+	// Same contract as setPerfCounters, for per-page memory access counts
+	bool (*setMemoryHeatmap)(struct mCore*, struct mMemoryHeatmap*);
 
 	bool (*isROM)(struct VFile* vf);
 	bool (*loadROM)(struct mCore*, struct VFile* vf);
@@ -108,6 +127,7 @@ struct mCore {
 	void (*setKeys)(struct mCore*, uint32_t keys);
 	void (*addKeys)(struct mCore*, uint32_t keys);
 	void (*clearKeys)(struct mCore*, uint32_t keys);
+	uint32_t (*getKeys)(struct mCore*);
 
 	int32_t (*frameCounter)(const struct mCore*);
 	int32_t (*frameCycles)(const struct mCore*);
@@ -136,6 +156,11 @@ struct mCore {
 
 	size_t (*listMemoryBlocks)(const struct mCore*, const struct mCoreMemoryBlock**);
 	void* (*getMemoryBlock)(struct mCore*, size_t id, size_t* sizeOut);
+	bool (*trackMemoryBlockDirty)(struct mCore*, size_t id, bool enable);
+	const uint32_t* (*getMemoryBlockDirty)(struct mCore*, size_t id, size_t* pagesOut);
+	void (*clearMemoryBlockDirty)(struct mCore*, size_t id);
+	// Pass NULL to remove the hook
+	void (*setMemoryHook)(struct mCore*, struct mCoreMemoryHook*);
 
 #ifdef USE_DEBUGGERS
 	bool (*supportsDebuggerType)(struct mCore*, enum mDebuggerType);
@@ -151,6 +176,8 @@ struct mCore {
 	struct mCheatDevice* (*cheatDevice)(struct mCore*);
 
 	size_t (*savedataClone)(struct mCore*, void** sram);
+	// Points at the save data in place instead of copying it; returns 0 if it isn't held in memory
+	size_t (*savedataView)(struct mCore*, const void** sram);
 	bool (*savedataRestore)(struct mCore*, const void* sram, size_t size, bool writeback);
 
 	size_t (*listVideoLayers)(const struct mCore*, const struct mCoreChannelInfo**);
@@ -184,8 +211,23 @@ void mCoreDeleteState(struct mCore* core, int slot);
 void mCoreTakeScreenshot(struct mCore* core);
 #endif
 
+struct mCoreRomInfo {
+	enum mPlatform platform;
+	char title[17];
+	char code[9];
+	size_t size;
+	uint32_t crc32;
+};
+
 struct mCore* mCoreFindVF(struct VFile* vf);
 enum mPlatform mCoreIsCompatible(struct VFile* vf);
+// Fills in info from the ROM header and a streamed CRC32 without creating a core. Returns false if the
+// file isn't a ROM or is one that can only be identified by loading it, such as a multiboot image.
+bool mCoreIdentifyVF(struct VFile* vf, struct mCoreRomInfo* info);
+
+// Gets the current frame as color_t, converting it into *converted when the core outputs another format.
+// *converted must be freed with free() afterwards; it stays NULL when no conversion was needed.
+bool mCoreGetNativePixels(struct mCore* core, const void** pixels, size_t* stride, void** converted);
 
 bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags);
 bool mCoreLoadStateNamed(struct mCore* core, struct VFile* vf, int flags);
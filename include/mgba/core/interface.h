@@ -14,6 +14,7 @@ CXX_GUARD_START
 
 struct mCore;
 struct mStateExtdataItem;
+struct VFile;
 
 #ifdef COLOR_16_BIT
 typedef uint16_t color_t;
@@ -53,6 +54,23 @@ static inline color_t mColorFrom555(uint16_t value) {
 #endif
 	return color;
 }
+
+#ifndef COLOR_16_BIT
+static inline uint16_t mColorToRGB565(color_t color) {
+	return ((color & 0xF8) << 8) | ((color >> 5) & 0x07E0) | ((color >> 19) & 0x001F);
+}
+
+static inline color_t mColorFromRGB565(uint16_t value) {
+	color_t color = ((value >> 8) & 0xF8) | ((value << 5) & 0xFC00) | ((value << 19) & 0xF80000);
+	color |= ((color >> 5) & 0x070007) | ((color >> 6) & 0x000300);
+	return color;
+}
+#endif
+
+// Where pixel (x, y) lives in an mCOLOR_TILED_4X4 buffer, counted in pixels
+static inline size_t mColorTiledOffset(size_t stride, unsigned x, unsigned y) {
+	return (y & ~3) * stride + ((x & ~3) << 2) + ((y & 3) << 2) + (x & 3);
+}
 #endif
 
 struct blip_t;
@@ -77,9 +95,24 @@ enum mColorFormat {
 	mCOLOR_RGB8   = 0x10000,
 	mCOLOR_BGR8   = 0x20000,
 
+	// Not a format by itself: OR it with one to lay the buffer out in 4x4 pixel tiles, each stored
+	// row by row, the way GX textures are. The stride must then be a multiple of 4.
+	mCOLOR_TILED_4X4 = 0x100000,
+
 	mCOLOR_ANY    = -1
 };
 
+// The format color_t holds in this build
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+#define mCOLOR_NATIVE mCOLOR_RGB565
+#else
+#define mCOLOR_NATIVE mCOLOR_BGR5
+#endif
+#else
+#define mCOLOR_NATIVE mCOLOR_XBGR8
+#endif
+
 enum mCoreFeature {
 	mCORE_FEATURE_OPENGL = 1,
 };
@@ -150,6 +183,11 @@ struct mRTCGenericSource {
 	enum mRTCGenericType override;
 	int64_t value;
 	struct mRTCSource* custom;
+
+	// The host clock is only read every so often and extrapolated from emulated time in between
+	bool anchored;
+	int64_t anchorTime;
+	uint32_t anchorFrame;
 };
 
 struct mRTCGenericState {
@@ -192,6 +230,60 @@ struct mCoreMemoryBlock {
 	uint32_t segmentStart;
 };
 
+#define mCORE_MEMORY_DIRTY_PAGE_SHIFT 8
+#define mCORE_MEMORY_DIRTY_PAGE_SIZE (1 << mCORE_MEMORY_DIRTY_PAGE_SHIFT)
+
+struct mCoreMemoryDirty {
+	uint32_t* bitmap;
+	size_t nPages;
+};
+
+void mCoreMemoryDirtyInit(struct mCoreMemoryDirty* dirty, size_t size);
+void mCoreMemoryDirtyDeinit(struct mCoreMemoryDirty* dirty);
+void mCoreMemoryDirtyClear(struct mCoreMemoryDirty* dirty);
+void mCoreMemoryDirtyMarkAll(struct mCoreMemoryDirty* dirty);
+void mCoreMemoryDirtyMarkRange(struct mCoreMemoryDirty* dirty, uint32_t offset, uint32_t size);
+// Copies only the pages of src that differ from dest, marking just those dirty. Returns how many were copied.
+size_t mCoreMemoryDirtyRestore(struct mCoreMemoryDirty* dirty, void* dest, const void* src, size_t size);
+
+static inline void mCoreMemoryDirtyMark(struct mCoreMemoryDirty* dirty, uint32_t offset) {
+	if (dirty->bitmap) {
+		size_t page = offset >> mCORE_MEMORY_DIRTY_PAGE_SHIFT;
+		if (page < dirty->nPages) {
+			dirty->bitmap[page >> 5] |= 1U << (page & 0x1F);
+		}
+	}
+}
+
+// Savedata tracks its writes in 32 sectors so syncing only has to touch what changed.
+// The last sector also covers anything past the first 124 KiB.
+#define mSAVEDATA_SECTOR_SHIFT 12
+#define mSAVEDATA_SECTORS_ALL 0xFFFFFFFFU
+
+static inline uint32_t mSavedataSector(uint32_t offset) {
+	uint32_t sector = offset >> mSAVEDATA_SECTOR_SHIFT;
+	return 1U << (sector < 31 ? sector : 31);
+}
+
+uint32_t mSavedataSectorRange(uint32_t offset, uint32_t size);
+bool mSavedataSyncSectors(struct VFile* vf, const uint8_t* data, size_t size, uint32_t sectors);
+
+// Reports CPU stores to the pages marked in `pages`, one bit per 4 KiB of the address
+// space. Cores only wrap their store paths while a hook is set.
+#define mCORE_MEMORY_HOOK_PAGE_SHIFT 12
+#define mCORE_MEMORY_HOOK_PAGES (1 << (32 - mCORE_MEMORY_HOOK_PAGE_SHIFT))
+
+struct mCoreMemoryHook {
+	void* context;
+	void (*written)(void* context, uint32_t address, int width, uint32_t value);
+	const uint32_t* pages;
+};
+
+static inline bool mCoreMemoryHookWatches(const struct mCoreMemoryHook* hook, uint32_t address) {
+	uint32_t page = address >> mCORE_MEMORY_HOOK_PAGE_SHIFT;
+	return hook->pages[page >> 5] & (1U << (page & 0x1F));
+}
+
 CXX_GUARD_END
 
 #endif
@@ -0,0 +1,89 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_LOCKSTEP_LINK_H
+#define M_LOCKSTEP_LINK_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba-util/socket.h>
+#include <mgba-util/vector.h>
+
+#define mLOCKSTEP_LINK_MAX_BATCH 64
+#define mLOCKSTEP_LINK_PING_INTERVAL 250000
+
+// Cycle stamps are free-running and wrap at 32 bits; compare them with mLockstepLinkCyclesDiff
+struct mLockstepLinkEvent {
+	uint32_t when;
+	uint16_t type;
+	uint16_t player;
+	uint32_t data;
+};
+
+DECLARE_VECTOR(mLockstepLinkEventList, struct mLockstepLinkEvent);
+
+// Round trip times are in microseconds
+struct mLockstepLinkStats {
+	uint64_t framesSent;
+	uint64_t framesReceived;
+	uint64_t eventsSent;
+	uint64_t eventsReceived;
+	uint64_t stallTime;
+	uint64_t totalRtt;
+	uint32_t rttSamples;
+	uint32_t lastRtt;
+	uint32_t minRtt;
+	uint32_t maxRtt;
+};
+
+struct mLockstepLink {
+	Socket socket;
+	bool failed;
+
+	// Events are stamped with the cycle they take effect on, which must be at least this far past
+	// the sender's last reported horizon. This is what lets either side run ahead of the other.
+	int32_t lookahead;
+	uint32_t localHorizon;
+	uint32_t remoteHorizon;
+
+	struct mLockstepLinkEvent outgoing[mLOCKSTEP_LINK_MAX_BATCH];
+	size_t nOutgoing;
+	struct mLockstepLinkEventList incoming;
+	size_t incomingRead;
+
+	uint32_t recvBuffer[0x400];
+	size_t recvFill;
+
+	uint16_t pingId;
+	uint16_t pongId;
+	bool pingOutstanding;
+	bool pongPending;
+	uint64_t pingSent;
+
+	struct mLockstepLinkStats stats;
+};
+
+void mLockstepLinkInit(struct mLockstepLink*, Socket socket);
+void mLockstepLinkDeinit(struct mLockstepLink*);
+
+bool mLockstepLinkQueue(struct mLockstepLink*, const struct mLockstepLinkEvent*);
+bool mLockstepLinkFlush(struct mLockstepLink*, uint32_t horizon);
+bool mLockstepLinkPoll(struct mLockstepLink*, int64_t timeoutMillis);
+
+bool mLockstepLinkNextEvent(struct mLockstepLink*, uint32_t until, struct mLockstepLinkEvent*);
+int32_t mLockstepLinkBudget(const struct mLockstepLink*, uint32_t now);
+bool mLockstepLinkWaitUntil(struct mLockstepLink*, uint32_t cycle, int64_t timeoutMillis);
+
+uint32_t mLockstepLinkAverageRtt(const struct mLockstepLinkStats*);
+
+static inline int32_t mLockstepLinkCyclesDiff(uint32_t a, uint32_t b) {
+	return (int32_t) (a - b);
+}
+
+CXX_GUARD_END
+
+#endif
@@ -24,11 +24,16 @@ enum mLogLevel {
 	mLOG_ALL = 0x7F
 };
 
+#define mLOG_MAX_CATEGORY 64
+
 struct Table;
 struct mLogFilter {
 	int defaultLevels;
 	struct Table categories;
 	struct Table levels;
+	// Levels of the first nResolved categories, precomputed whenever the tables change
+	int nResolved;
+	uint8_t resolved[mLOG_MAX_CATEGORY];
 };
 
 struct mLogger {
@@ -53,6 +58,15 @@ void mLogFilterReset(struct mLogFilter*, const char* category);
 bool mLogFilterTest(const struct mLogFilter*, int category, enum mLogLevel level);
 int mLogFilterLevels(const struct mLogFilter*, int category);
 
+// Queues formatted messages for a background thread to pass on to backend, so logging never
+// blocks the caller. The backend receives each message already formatted, as "%s", and a run
+// of messages sharing one format is cut short with a count of how many were skipped. If the
+// queue fills up, messages are dropped and counted instead. Fatal messages are delivered before
+// mLog returns. Without threading support messages are passed on immediately.
+struct mLogger* mAsyncLoggerCreate(struct mLogger* backend);
+void mAsyncLoggerDestroy(struct mLogger*);
+void mAsyncLoggerFlush(struct mLogger*);
+
 ATTRIBUTE_FORMAT(printf, 3, 4)
 void mLog(int category, enum mLogLevel level, const char* format, ...);
 
@@ -38,6 +38,13 @@ struct mMapCacheEntry {
 	struct mTileCacheEntry tileStatus[16];
 };
 
+struct mMapCacheRegion {
+	unsigned x;
+	unsigned y;
+	unsigned width;
+	unsigned height;
+};
+
 struct mTileCache;
 struct mTileCacheEntry;
 struct mMapCache {
@@ -45,6 +52,11 @@ struct mMapCache {
 	struct mTileCache* tileCache;
 	struct mMapCacheEntry* status;
 
+	// A row is only looked at again if one of its entries was written, or if the tile cache
+	// has changed since the row was last cleaned
+	uint32_t* rowDirty;
+	uint32_t* rowVersion;
+
 	uint8_t* vram;
 
 	uint32_t mapStart;
@@ -72,6 +84,9 @@ bool mMapCacheCheckTile(struct mMapCache* cache, const struct mMapCacheEntry* en
 void mMapCacheCleanTile(struct mMapCache* cache, struct mMapCacheEntry* entry, unsigned x, unsigned y);
 
 void mMapCacheCleanRow(struct mMapCache* cache, unsigned y);
+// Cleans every row that may have changed, and fills regions with the tiles that were redrawn.
+// Rows that don't fit in regions are left for the next call.
+size_t mMapCacheCleanDirtyRegions(struct mMapCache* cache, struct mMapCacheRegion* regions, size_t maxRegions);
 const color_t* mMapCacheGetRow(struct mMapCache* cache, unsigned y);
 
 CXX_GUARD_END
@@ -0,0 +1,63 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef CORE_MEM_HEATMAP_H
+#define CORE_MEM_HEATMAP_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+// Pages cover the low 256 MiB of the address space, which is everything the GBA decodes.
+// Addresses above that wrap around onto the same pages, as they do on the bus.
+#define mMEMORY_HEATMAP_PAGE_SHIFT 12
+#define mMEMORY_HEATMAP_PAGES 0x10000
+
+enum mMemoryHeatmapAccess {
+	mMEMORY_HEATMAP_READ = 0,
+	mMEMORY_HEATMAP_WRITE,
+	mMEMORY_HEATMAP_EXECUTE,
+	mMEMORY_HEATMAP_MAX
+};
+
+struct mMemoryHeatmapPage {
+	uint64_t accesses[mMEMORY_HEATMAP_MAX];
+	// Bus cycles spent on those accesses, including waitstates and stalls
+	uint64_t cycles[mMEMORY_HEATMAP_MAX];
+};
+
+// Per-page access counts of a core, for seeing which memory a game hammers. Like mPerfCounters,
+// these are only counted in builds with ENABLE_PERF_COUNTERS, and only while the heatmap is
+// attached with mCore.setMemoryHeatmap. Executes are instruction fetches; on GB that includes
+// operand bytes, and every GB access is charged one M-cycle. DMA is counted with no cycles,
+// since it is billed to the DMA rather than to the access.
+struct mMemoryHeatmap {
+	struct mMemoryHeatmapPage* pages;
+	// The frame counter when counting last started, and the last frame marked as counted
+	uint32_t firstFrame;
+	uint32_t lastFrame;
+};
+
+void mMemoryHeatmapInit(struct mMemoryHeatmap*);
+void mMemoryHeatmapDeinit(struct mMemoryHeatmap*);
+// Zeroes every page and starts a new frame range at `frame`
+void mMemoryHeatmapReset(struct mMemoryHeatmap*, uint32_t frame);
+void mMemoryHeatmapMarkFrame(struct mMemoryHeatmap*, uint32_t frame);
+
+static inline struct mMemoryHeatmapPage* mMemoryHeatmapGetPage(struct mMemoryHeatmap* heatmap, uint32_t address) {
+	return &heatmap->pages[(address >> mMEMORY_HEATMAP_PAGE_SHIFT) & (mMEMORY_HEATMAP_PAGES - 1)];
+}
+
+// Adds up the counters of `count` pages starting at the one holding `address`
+void mMemoryHeatmapSum(const struct mMemoryHeatmap*, uint32_t address, size_t count, struct mMemoryHeatmapPage* out);
+
+struct VFile;
+// Writes a "first_frame,last_frame" line, then every page that was touched as
+// "address,reads,writes,executes,read_cycles,write_cycles,execute_cycles"
+bool mMemoryHeatmapDump(const struct mMemoryHeatmap*, struct VFile*);
+
+CXX_GUARD_END
+
+#endif
@@ -0,0 +1,50 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef CORE_MEM_PROBE_H
+#define CORE_MEM_PROBE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba-util/vector.h>
+
+#define mCORE_MEMORY_PROBE_MAX_BLOCKS 16
+
+struct mCoreMemoryProbe {
+	uint32_t address;
+	int width;
+	// Index into the list's blocks, or -1 if the probe has to go through the bus
+	int block;
+	uint32_t offset;
+};
+
+DECLARE_VECTOR(mCoreMemoryProbes, struct mCoreMemoryProbe);
+
+struct mCore;
+struct mCoreMemoryProbeList {
+	struct mCore* core;
+	struct mCoreMemoryProbes probes;
+	size_t nBlocks;
+	size_t blockIds[mCORE_MEMORY_PROBE_MAX_BLOCKS];
+};
+
+void mCoreMemoryProbeListInit(struct mCoreMemoryProbeList*, struct mCore* core);
+void mCoreMemoryProbeListDeinit(struct mCoreMemoryProbeList*);
+
+// Adds a probe of 1, 2 or 4 bytes and returns its index in the results. Probes that fall
+// in an unbanked memory block are read straight from it; anything else, such as I/O,
+// banked regions, mirrors or misaligned addresses, is read with the core's bus functions.
+size_t mCoreMemoryProbeListAdd(struct mCoreMemoryProbeList*, uint32_t address, int width);
+void mCoreMemoryProbeListClear(struct mCoreMemoryProbeList*);
+
+// Reads every probe into `values`, in the order they were added. Block pointers are looked
+// up once per call, so this stays valid across resets and loads that reallocate memory.
+void mCoreMemoryProbeListRead(struct mCoreMemoryProbeList*, uint32_t* values);
+
+CXX_GUARD_END
+
+#endif
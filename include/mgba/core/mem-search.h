@@ -45,6 +45,8 @@ struct mCoreMemorySearchResult {
 	enum mCoreMemorySearchType type;
 	int width;
 	int32_t oldValue;
+	// Raw value of an integer result as of the last time it was read
+	int32_t lastValue;
 };
 
 DECLARE_VECTOR(mCoreMemorySearchResults, struct mCoreMemorySearchResult);
@@ -53,6 +55,12 @@ struct mCore;
 void mCoreMemorySearch(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* out, size_t limit);
 void mCoreMemorySearchRepeat(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* inout);
 
+// Like mCoreMemorySearchRepeat, but reads straight from memory blocks that support dirty tracking, turning it on
+// as needed, and reuses the last value of results in pages that have not been written since the previous call.
+// The dirty bitmaps of those blocks are cleared afterwards, so they should not be shared with other consumers.
+// Unlike mCoreMemorySearchRepeat, the remaining results keep their order.
+void mCoreMemorySearchRepeatDirty(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* inout);
+
 CXX_GUARD_END
 
 #endif
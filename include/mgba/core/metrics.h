@@ -0,0 +1,84 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_METRICS_H
+#define M_CORE_METRICS_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#define mCORE_METRICS_FRAME_BUCKETS 10
+
+// Where the emulation thread's wall-clock time goes. Emulation is whatever is left of each
+// frame after the others, so rendering only shows up on its own with a threaded renderer,
+// as the time spent waiting for the render thread to catch up.
+enum mCoreMetricsPhase {
+	mCORE_METRICS_EMULATION = 0,
+	mCORE_METRICS_VIDEO_SYNC,
+	mCORE_METRICS_AUDIO_SYNC,
+	mCORE_METRICS_RENDER,
+	mCORE_METRICS_REWIND,
+	mCORE_METRICS_PHASE_MAX
+};
+
+// Upper bounds of the frame time buckets, in microseconds
+extern const uint32_t mCoreMetricsFrameBuckets[mCORE_METRICS_FRAME_BUCKETS];
+
+// All times are in microseconds
+struct mCoreMetrics {
+	uint64_t frames;
+	// Each bucket counts the frames that took longer than the bucket before it and no longer
+	// than its own bound. The extra bucket at the end counts everything slower.
+	uint64_t frameTimeBuckets[mCORE_METRICS_FRAME_BUCKETS + 1];
+	uint64_t frameTimeTotal;
+	uint64_t frameTimeMax;
+	uint64_t phaseTime[mCORE_METRICS_PHASE_MAX];
+
+	// Audio frames padded with silence or dropped on the way to the audio device
+	uint64_t audioUnderruns;
+	uint64_t audioOverruns;
+	// Device reads that came up short, and with the pull model, how many frames it is keeping
+	// queued and the furthest a read has strayed from its period
+	uint64_t audioUnderrunEvents;
+	uint32_t audioTarget;
+	uint32_t audioJitterMax;
+
+	// Bytes queued for a threaded renderer as of the last frame, and the most seen at a frame end
+	size_t videoQueueDepth;
+	size_t videoQueueMaxDepth;
+};
+
+// Turns the running totals of time spent waiting into per-frame phase times. Every producer of
+// those totals only ever adds to them, so the recorder just keeps what it saw at the last frame.
+struct mCoreMetricsRecorder {
+	struct mCoreMetrics metrics;
+	uint64_t lastFrame;
+	uint64_t lastWaits[mCORE_METRICS_PHASE_MAX];
+};
+
+uint64_t mCoreMetricsTime(void);
+
+void mCoreMetricsReset(struct mCoreMetrics*);
+void mCoreMetricsAddFrame(struct mCoreMetrics*, uint64_t frameTime);
+void mCoreMetricsMerge(struct mCoreMetrics* metrics, const struct mCoreMetrics* other);
+
+void mCoreMetricsRecorderInit(struct mCoreMetricsRecorder*);
+// Call once a frame with the running wait totals; the emulation entry is ignored
+void mCoreMetricsRecorderFrame(struct mCoreMetricsRecorder*, const uint64_t waits[mCORE_METRICS_PHASE_MAX]);
+// Leaves the time until the next frame out, e.g. while paused
+void mCoreMetricsRecorderSkip(struct mCoreMetricsRecorder*);
+
+struct mVideoLogger;
+void mCoreMetricsSampleVideoLogger(struct mCoreMetrics*, struct mVideoLogger*);
+
+// Writes the metrics in the Prometheus text exposition format. labels may be NULL or a
+// comma-separated list of name="value" pairs to put on every sample. Returns the length the
+// text needs, which is only all written if it is less than size.
+size_t mCoreMetricsFormatPrometheus(const struct mCoreMetrics*, const char* labels, char* buffer, size_t size);
+
+CXX_GUARD_END
+
+#endif
@@ -0,0 +1,53 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_PERF_COUNTERS_H
+#define M_CORE_PERF_COUNTERS_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#define mPERF_COUNTER_MODES 2
+#define mPERF_COUNTER_REGIONS 16
+#define mPERF_COUNTER_MAX_EVENTS 32
+#define mPERF_COUNTER_HANDLERS 0x1000
+
+// Counters for the hot paths of a core. They are only incremented in builds with
+// ENABLE_PERF_COUNTERS, and only while a block is attached with mCore.setPerfCounters,
+// so leaving them detached costs a pointer check and compiling them out costs nothing.
+// Instructions are split by CPU mode (ARM and Thumb on GBA; GB only uses the first) and
+// memory accesses by the top address nybble that each core already dispatches on.
+struct mPerfCounters {
+	uint64_t instructions[mPERF_COUNTER_MODES];
+	uint64_t memoryAccesses[mPERF_COUNTER_REGIONS];
+	// Instructions fetched from each region, and executions of each handler, indexed the same
+	// way as the core's decode table (_armTable, _thumbTable or _lr35902InstructionTable)
+	uint64_t instructionRegions[mPERF_COUNTER_REGIONS];
+	uint64_t handlers[mPERF_COUNTER_MODES][mPERF_COUNTER_HANDLERS];
+	uint64_t conditionsFailed;
+	uint64_t waitstateCycles;
+	uint64_t dmaCycles;
+	uint64_t idleLoopSkips;
+	uint64_t eventsFired;
+
+	// Fired events keyed by mTimingEvent.name; names past the end are only in eventsFired
+	size_t nEvents;
+	struct mPerfCounterEvent {
+		const char* name;
+		uint64_t fired;
+	} events[mPERF_COUNTER_MAX_EVENTS];
+};
+
+void mPerfCountersReset(struct mPerfCounters*);
+void mPerfCountersCountEvent(struct mPerfCounters*, const char* name);
+
+struct VFile;
+// Writes every nonzero counter as a "counter,mode,index,value" CSV line
+bool mPerfCountersDump(const struct mPerfCounters*, struct VFile*);
+
+CXX_GUARD_END
+
+#endif
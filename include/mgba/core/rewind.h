@@ -15,15 +15,45 @@ CXX_GUARD_START
 #include <mgba-util/threading.h>
 #endif
 
-DECLARE_VECTOR(mCoreRewindPatches, struct PatchFast);
+#define M_CORE_REWIND_PAGE_SIZE 0x1000
+
+struct mCoreRewindPage;
+struct mCoreRewindSnapshot {
+	size_t size;
+	size_t nPages;
+	struct mCoreRewindPage** pages;
+	uint32_t sequence;
+	bool compressed;
+};
+
+DECLARE_VECTOR(mCoreRewindSnapshots, struct mCoreRewindSnapshot);
+
+// A flat state, as written by mCoreSaveStateBuffer, waiting to be diffed into a snapshot
+struct mCoreRewindArena {
+	uint8_t* data;
+	size_t capacity;
+	size_t size;
+};
 
 struct VFile;
 struct mCoreRewindContext {
-	struct mCoreRewindPatches patchMemory;
+	struct mCoreRewindSnapshots snapshots;
 	size_t current;
 	size_t size;
-	struct VFile* previousState;
 	struct VFile* currentState;
+	struct mCoreRewindPage* freePages;
+
+	// With a nonzero budget, snapshots older than the newest quarter of those held are
+	// compressed and thinned out as needed to keep the stored pages under this many bytes
+	size_t budget;
+	size_t bytes;
+	uint32_t sequence;
+	void* compressor;
+
+	// The emulation thread only copies its state into an arena. With a diff thread, that
+	// thread takes the pending arena while the emulation thread fills the other one.
+	struct mCoreRewindArena arenas[2];
+	unsigned pending;
 
 #ifndef DISABLE_THREADING
 	bool onThread;
@@ -31,6 +61,9 @@ struct mCoreRewindContext {
 	Condition cond;
 	Mutex mutex;
 	bool ready;
+	// CPUs to pin the diff thread to, or 0 to leave it unpinned
+	uint64_t affinity;
+	bool highPriority;
 #endif
 };
 
@@ -40,6 +73,8 @@ void mCoreRewindContextDeinit(struct mCoreRewindContext*);
 struct mCore;
 void mCoreRewindAppend(struct mCoreRewindContext*, struct mCore*);
 bool mCoreRewindRestore(struct mCoreRewindContext*, struct mCore*);
+// Goes back up to `steps` snapshots but only loads the last of them, returning how many were rewound
+size_t mCoreRewindRestoreSteps(struct mCoreRewindContext*, struct mCore*, size_t steps);
 
 CXX_GUARD_END
 
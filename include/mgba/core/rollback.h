@@ -0,0 +1,66 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_ROLLBACK_H
+#define M_ROLLBACK_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#define mROLLBACK_MAX_PLAYERS 4
+#define mROLLBACK_DEFAULT_WINDOW 8
+
+struct mCore;
+
+struct mRollbackInput {
+	uint32_t keys[mROLLBACK_MAX_PLAYERS];
+	// Players whose keys for this frame are still a guess
+	unsigned predicted;
+};
+
+struct mRollbackStats {
+	uint64_t framesRun;
+	uint64_t framesResimulated;
+	uint64_t rollbacks;
+	uint64_t stalls;
+	int32_t maxRollback;
+};
+
+struct mRollback {
+	struct mCore* core;
+	int nPlayers;
+	int localPlayer;
+
+	// States are saved at the start of each frame, so the last window frames can be replayed
+	size_t window;
+	size_t stateSize;
+	void** states;
+	// Inputs cover twice the window, so remote input can arrive up to a window early
+	struct mRollbackInput* inputs;
+
+	int32_t frame;
+	int32_t confirmed[mROLLBACK_MAX_PLAYERS];
+	uint32_t confirmedKeys[mROLLBACK_MAX_PLAYERS];
+	int32_t rollbackFrame;
+
+	// Turns every player's keys into the core's input; by default they're all ORed together
+	void (*applyInputs)(struct mRollback*, const uint32_t* keys);
+	void* context;
+
+	struct mRollbackStats stats;
+};
+
+bool mRollbackInit(struct mRollback*, struct mCore* core, int nPlayers, int localPlayer, size_t window);
+void mRollbackDeinit(struct mRollback*);
+
+bool mRollbackAddInput(struct mRollback*, int player, int32_t frame, uint32_t keys);
+bool mRollbackRunFrame(struct mRollback*, uint32_t localKeys);
+
+int32_t mRollbackConfirmedFrame(const struct mRollback*);
+
+CXX_GUARD_END
+
+#endif
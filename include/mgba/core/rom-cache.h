@@ -0,0 +1,41 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_ROM_CACHE_H
+#define M_CORE_ROM_CACHE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba-util/table.h>
+#ifndef DISABLE_THREADING
+#include <mgba-util/threading.h>
+#endif
+
+// Hands out refcounted read-only VFiles over a single shared copy of each ROM, keyed by
+// the same CRC32 that mCoreChecksum reports. Cores treat the mapping as pristine and copy
+// it before patching it, so any number of cores can run from one copy. The cache must
+// outlive every VFile it returns.
+struct mROMCache {
+	struct Table entries;
+#ifndef DISABLE_THREADING
+	Mutex mutex;
+#endif
+};
+
+struct VFile;
+void mROMCacheInit(struct mROMCache*);
+void mROMCacheDeinit(struct mROMCache*);
+
+// Takes ownership of vf. Returns vf itself if the ROM cannot be shared.
+struct VFile* mROMCacheOpen(struct mROMCache*, struct VFile* vf);
+struct VFile* mROMCacheOpenCRC32(struct mROMCache*, uint32_t crc32);
+bool mROMCacheIsShared(const struct VFile* vf);
+bool mROMCacheGetCRC32(const struct VFile* vf, uint32_t* crc32);
+
+CXX_GUARD_END
+
+#endif
@@ -29,6 +29,11 @@ struct mScriptEngine {
 #ifdef USE_DEBUGGERS
 	void (*debuggerEntered)(struct mScriptEngine*, enum mDebuggerEntryReason, struct mDebuggerEntryInfo*);
 #endif
+
+	// Optional; engines that leave these NULL are skipped
+	void (*frameStarted)(struct mScriptEngine*);
+	void (*frameEnded)(struct mScriptEngine*);
+	void (*memoryWritten)(struct mScriptEngine*, uint32_t address, int width, uint32_t value);
 };
 
 struct mScriptBridge* mScriptBridgeCreate(void);
@@ -47,6 +52,21 @@ bool mScriptBridgeLoadScript(struct mScriptBridge*, const char* name);
 
 bool mScriptBridgeLookupSymbol(struct mScriptBridge*, const char* name, int32_t* out);
 
+struct mCore;
+// Frame hooks are registered as core callbacks, so the bridge has to outlive the
+// core's emulation, which clears them when its thread ends
+void mScriptBridgeSetCore(struct mScriptBridge*, struct mCore*);
+struct mCore* mScriptBridgeGetCore(struct mScriptBridge*);
+
+// Reports CPU writes that touch the range to the engines' memoryWritten. The core's
+// store paths are only hooked while at least one range is watched.
+void mScriptBridgeWatchWrites(struct mScriptBridge*, uint32_t address, uint32_t size);
+void mScriptBridgeClearWriteWatches(struct mScriptBridge*);
+
+// Copies a range of the address space in one call, straight from the memory block when it
+// lies in an unbanked one. For many scattered values, see mCoreMemoryProbeList.
+size_t mScriptBridgeReadRange(struct mScriptBridge*, uint32_t address, void* buffer, size_t size);
+
 CXX_GUARD_END
 
 #endif
@@ -47,9 +47,22 @@ bool mStateExtdataDeserialize(struct mStateExtdata* extdata, struct VFile* vf);
 
 struct mCore;
 bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags);
+// Takes ownership of vf. Screenshot states are handed to the core's async writer when it has one,
+// in which case a true return only means the state was queued.
+bool mCoreSaveStateNamedDeferred(struct mCore* core, struct VFile* vf, int flags);
 bool mCoreLoadStateNamed(struct mCore* core, struct VFile* vf, int flags);
 void* mCoreExtractState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata);
 
+// Flat, uncompressed states in caller-owned memory, laid out exactly like a non-PNG
+// state file. Screenshots are not stored. mCoreSaveStateBuffer returns the size the
+// state needs and only writes it if it fits in size; pass NULL to query the size.
+#define M_STATE_BUFFER_ALIGNMENT 16
+size_t mCoreSaveStateBuffer(struct mCore* core, void* buffer, size_t size, int flags);
+// A size that stays large enough for mCoreSaveStateBuffer as long as the save data doesn't
+// outgrow maxSavedataSize, for callers that need a fixed buffer size up front
+size_t mCoreSaveStateBufferBound(struct mCore* core, int flags, size_t maxSavedataSize);
+bool mCoreLoadStateBuffer(struct mCore* core, const void* buffer, size_t size, int flags);
+
 CXX_GUARD_END
 
 #endif
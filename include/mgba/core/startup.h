@@ -0,0 +1,59 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_STARTUP_H
+#define M_CORE_STARTUP_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
+#include <mgba/core/log.h>
+
+mLOG_DECLARE_CATEGORY(STARTUP);
+
+#define mCORE_STARTUP_MAX_THREADS 8
+
+enum mCoreStartupAsset {
+	mCORE_STARTUP_ROM = 0,
+	mCORE_STARTUP_BIOS,
+	mCORE_STARTUP_SAVE,
+	mCORE_STARTUP_PATCH,
+	mCORE_STARTUP_CHEATS,
+	mCORE_STARTUP_ASSET_MAX
+};
+
+// Everything mCoreLoadFile and the mCoreAutoload functions do before the first frame, but with the
+// files read on a few threads at once. Only reading happens off the calling thread; the core itself
+// is only touched afterwards, in order: ROM, BIOS, save, patch, then cheats.
+struct mCoreStartup {
+	// Set by mCoreStartupInit, and can be changed before loading
+	size_t nThreads;
+	bool autoloadSave;
+	bool autoloadPatch;
+	bool autoloadCheats;
+	// Used instead of looking for a patch next to the ROM, e.g. one given on the command line
+	const char* patch;
+
+	// Filled in by mCoreStartupLoad, all in microseconds
+	bool loaded[mCORE_STARTUP_ASSET_MAX];
+	uint64_t openTime;
+	uint64_t readTime[mCORE_STARTUP_ASSET_MAX];
+	uint64_t applyTime[mCORE_STARTUP_ASSET_MAX];
+	uint64_t totalTime;
+};
+
+void mCoreStartupInit(struct mCoreStartup*);
+
+struct mCore;
+// Returns false if the ROM couldn't be opened or loaded, in which case nothing else is applied.
+// The BIOS is only read ahead of time for GBA, and otherwise left to the core to find on reset.
+bool mCoreStartupLoad(struct mCoreStartup*, struct mCore* core, const char* path);
+#endif
+
+CXX_GUARD_END
+
+#endif
@@ -0,0 +1,61 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_STATE_HASH_H
+#define M_STATE_HASH_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#define mSTATE_HASH_MAX_BLOCKS 16
+
+// Small enough to send every frame, so two cores can check they're in sync without exchanging savestates
+struct mStateHash {
+	uint64_t combined;
+	// The serialized savestate, which covers registers, I/O and timing as well as RAM
+	uint64_t state;
+	// One per writable memory block, in the order they're listed in the hasher
+	size_t nBlocks;
+	uint64_t blocks[mSTATE_HASH_MAX_BLOCKS];
+};
+
+struct mStateHashBlock {
+	size_t id;
+	const char* name;
+	size_t size;
+	bool tracked;
+	// Little-endian hashes of each page, so a block's hash only depends on its contents
+	uint64_t* pageHashes;
+	size_t nPages;
+	bool valid;
+};
+
+struct mCore;
+struct mStateHasher {
+	struct mCore* core;
+	void* state;
+	size_t stateSize;
+	size_t nBlocks;
+	struct mStateHashBlock blocks[mSTATE_HASH_MAX_BLOCKS];
+	struct mStateHash hash;
+};
+
+// With incremental set, memory blocks that support dirty tracking have it turned on, and only the pages
+// written since the last update are hashed again. Those bitmaps are cleared by every update, so they
+// should not be shared with other consumers. Either way the resulting hashes are the same.
+void mStateHasherInit(struct mStateHasher*, struct mCore* core, bool incremental);
+void mStateHasherDeinit(struct mStateHasher*);
+
+// Both sides need to update at the same point in a frame, e.g. right after runFrame returns
+uint64_t mStateHasherUpdate(struct mStateHasher*);
+
+// Returns -1 if the hashes match, the index of the first memory block that differs, or nBlocks if only the
+// rest of the state does
+ssize_t mStateHashCompare(const struct mStateHash* a, const struct mStateHash* b);
+
+CXX_GUARD_END
+
+#endif
@@ -10,6 +10,7 @@
 
 CXX_GUARD_START
 
+#include <mgba-util/ring-spsc.h>
 #include <mgba-util/threading.h>
 
 struct mCoreSync {
@@ -24,7 +25,41 @@ struct mCoreSync {
 	Condition audioRequiredCond;
 	Mutex audioBufferMutex;
 
+	// Optional lock-free handoff to the audio device, enabled by the consumer
+	struct RingSPSC audioRing;
+	uint32_t audioProducerWaiting;
+	uint32_t audioOverruns;
+	uint32_t audioUnderruns;
+
+	// Dynamic rate control: the producer nudges the blip output rate by up to this fraction
+	// to hold the ring half full, so audio can be paced by video without blocking either side
+	float audioRateControl;
+	double audioClockRate;
+	double audioSampleRate;
+
+	// Pull model, see mCoreSyncSetAudioPull. The producer reads the frame counts; the rest
+	// belongs to the consumer, apart from the statistics.
+	uint32_t audioPullFrames;
+	uint32_t audioTarget;
+	uint64_t audioLastRead;
+	float audioJitter;
+	float audioUnderrunMargin;
+	uint32_t audioUnderrunEvents;
+	uint32_t audioJitterMax;
+
 	float fpsTarget;
+
+	// Pace posted frames to fpsTarget by the clock rather than by waking on a condition, which
+	// can take several milliseconds on some systems. The emulation thread sleeps until a margin
+	// before each frame is due and spins the rest of the way, keeping the margin just above
+	// how late its recent sleeps have woken up.
+	bool framePacing;
+	double frameDeadline;
+	uint32_t framePacingMargin;
+
+	// Microseconds the emulation thread has spent blocked on each kind of sync
+	uint64_t videoWaitTime;
+	uint64_t audioWaitTime;
 };
 
 void mCoreSyncPostFrame(struct mCoreSync* sync);
@@ -34,11 +69,30 @@ void mCoreSyncWaitFrameEnd(struct mCoreSync* sync);
 void mCoreSyncSetVideoSync(struct mCoreSync* sync, bool wait);
 
 struct blip_t;
-bool mCoreSyncProduceAudio(struct mCoreSync* sync, const struct blip_t*, size_t samples);
+bool mCoreSyncProduceAudio(struct mCoreSync* sync, struct blip_t* left, struct blip_t* right, size_t samples);
 void mCoreSyncLockAudio(struct mCoreSync* sync);
 void mCoreSyncUnlockAudio(struct mCoreSync* sync);
 void mCoreSyncConsumeAudio(struct mCoreSync* sync);
 
+// Once the ring is enabled the producer moves interleaved stereo frames out of the blip
+// buffers itself, and the consumer must only use mCoreSyncReadAudio until the sync is torn down.
+// If audioWait is off the producer never blocks and drops frames the ring cannot hold.
+// Reading more frames than are queued pads the output with silence and counts an underrun.
+void mCoreSyncInitAudioRing(struct mCoreSync* sync, size_t frames);
+void mCoreSyncDeinitAudioRing(struct mCoreSync* sync);
+bool mCoreSyncHasAudioRing(const struct mCoreSync* sync);
+size_t mCoreSyncAudioAvailable(struct mCoreSync* sync);
+size_t mCoreSyncReadAudio(struct mCoreSync* sync, int16_t* output, size_t frames);
+void mCoreSyncSetAudioRates(struct mCoreSync* sync, struct blip_t* left, struct blip_t* right, double clockRate, double sampleRate);
+
+// Switches the ring to a pull model for a device that reads deviceFrames at a time, or back
+// with 0. The device callback then sets the pace: instead of filling the ring, the producer
+// keeps only a target number of frames queued, and hands them over as soon as a callback's
+// worth is ready instead of in larger batches. Each read measures how far the callback strays
+// from its period and sizes the target to cover two callbacks plus that jitter, growing it
+// further after an underrun. Both margins shrink back slowly while the callback keeps time.
+void mCoreSyncSetAudioPull(struct mCoreSync* sync, size_t deviceFrames);
+
 CXX_GUARD_END
 
 #endif
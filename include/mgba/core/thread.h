@@ -36,13 +36,23 @@ struct mCoreThread {
 	ThreadCallback sleepCallback;
 	ThreadCallback pauseCallback;
 	ThreadCallback unpauseCallback;
+	// Called on the emulation thread the first time the game reads the keys in each frame, or at
+	// the end of a frame where it doesn't, when the lateInput option is on and run-ahead is off
+	ThreadCallback keysReadCallback;
 	void* userData;
 	void (*run)(struct mCoreThread*);
 
+	// Optional second instance of the same game, sharing the video buffer. With runAhead set,
+	// it runs ahead from the primary's state on its own thread and renders every shown frame. Each
+	// frame is posted before the next job is queued, so it never draws over one still being shown.
+	struct mCore* runAheadCore;
+
 	struct mCoreThreadInternal* impl;
 };
 
 #ifndef OPAQUE_THREADING
+#include <mgba/core/async-writer.h>
+#include <mgba/core/metrics.h>
 #include <mgba/core/rewind.h>
 #include <mgba/core/sync.h>
 #include <mgba-util/threading.h>
@@ -82,6 +92,35 @@ struct mCoreThreadInternal {
 
 	struct mCoreSync sync;
 	struct mCoreRewindContext rewind;
+	// Only set when the default logger is in use
+	struct mLogger* asyncLogger;
+	struct mAsyncWriter asyncWriter;
+
+	void* runAheadState;
+	size_t runAheadStateSize;
+	bool runAheadSpeculating;
+	bool runAheadHidden;
+
+	Thread runAheadThread;
+	Mutex runAheadMutex;
+	Condition runAheadCond;
+	Condition runAheadDoneCond;
+	size_t runAheadJobSize;
+	uint32_t runAheadKeys;
+	int runAheadFrames;
+	bool runAheadPending;
+	bool runAheadBusy;
+	bool runAheadPresent;
+	bool runAheadExiting;
+
+	bool keysPolled;
+
+	// The recorder belongs to the emulation thread, which publishes a copy of it every frame
+	struct mCoreMetricsRecorder metricsRecorder;
+	uint64_t rewindTime;
+	uint64_t traceFrameStart;
+	Mutex metricsMutex;
+	struct mCoreMetrics metrics;
 };
 
 #endif
@@ -113,6 +152,10 @@ void mCoreThreadStopWaiting(struct mCoreThread* threadContext);
 void mCoreThreadSetRewinding(struct mCoreThread* threadContext, bool);
 void mCoreThreadRewindParamsChanged(struct mCoreThread* threadContext);
 
+struct mCoreMetrics;
+// Safe to call from any thread while the thread is running
+void mCoreThreadGetMetrics(struct mCoreThread* threadContext, struct mCoreMetrics* metrics);
+
 struct mCoreThread* mCoreThreadGet(void);
 struct mLogger* mCoreThreadLogger(void);
 
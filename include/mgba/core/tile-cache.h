@@ -32,6 +32,8 @@ struct mTileCache {
 	color_t* cache;
 	struct mTileCacheEntry* status;
 	uint32_t* globalPaletteVersion;
+	// Bumped by every write that can change a tile, so that users can skip checking each one
+	uint32_t version;
 
 	uint32_t tileBase;
 	uint32_t paletteBase;
@@ -40,6 +42,8 @@ struct mTileCache {
 
 	uint16_t* vram;
 	color_t* palette;
+	// The same palette with the alpha bits already filled in for every entry but color 0
+	color_t* opaquePalette;
 	color_t temporaryTile[64];
 
 	mTileCacheConfiguration config;
@@ -55,6 +59,8 @@ void mTileCacheWritePalette(struct mTileCache* cache, uint32_t entry, color_t co
 
 const color_t* mTileCacheGetTile(struct mTileCache* cache, unsigned tileId, unsigned paletteId);
 const color_t* mTileCacheGetTileIfDirty(struct mTileCache* cache, struct mTileCacheEntry* entry, unsigned tileId, unsigned paletteId);
+// Brings every tile drawn with paletteId up to date in one pass, and returns how many were stale
+size_t mTileCacheRegenerateDirty(struct mTileCache* cache, unsigned paletteId);
 const color_t* mTileCacheGetPalette(struct mTileCache* cache, unsigned paletteId);
 const uint16_t* mTileCacheGetVRAM(struct mTileCache* cache, unsigned tileId);
 
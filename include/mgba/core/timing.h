@@ -10,6 +10,9 @@
 
 CXX_GUARD_START
 
+#include <mgba-util/vector.h>
+
+struct mPerfCounters;
 struct mTiming;
 struct mTimingEvent {
 	void* context;
@@ -19,15 +22,71 @@ struct mTimingEvent {
 	unsigned priority;
 
 	struct mTimingEvent* next;
+	uint32_t order;
+	size_t index;
+};
+
+DECLARE_VECTOR(mTimingEventHeap, struct mTimingEvent*);
+
+// Pending events are normally kept in a sorted list, which is fastest for the handful that the
+// systems schedule. Once more than this many are pending they move into a binary heap, and they
+// move back to the list when half that many are left.
+#define mTIMING_LIST_MAX 32
+
+#define mTIMING_TRACE_MAX_EVENTS 255
+
+enum mTimingTraceOp {
+	mTIMING_TRACE_SCHEDULE = 0,
+	// Scheduled again while still pending, which the original list didn't handle
+	mTIMING_TRACE_RESCHEDULE,
+	mTIMING_TRACE_DESCHEDULE,
+	mTIMING_TRACE_TICK,
+	mTIMING_TRACE_FIRE,
+	mTIMING_TRACE_TICK_END,
+	mTIMING_TRACE_INTERRUPT,
+	mTIMING_TRACE_CLEAR,
+	// masterCycles was changed from outside, e.g. by loading a savestate
+	mTIMING_TRACE_SET_MASTER,
+};
+
+struct mTimingTraceEntry {
+	uint8_t op;
+	uint8_t event;
+	// The absolute deadline for schedules, cycles for ticks and the new value for SET_MASTER
+	uint32_t value;
+};
+
+DECLARE_VECTOR(mTimingTraceEntryList, struct mTimingTraceEntry);
+
+// Every queue operation in order, so that it can be replayed against other queue implementations
+// without running the core. Only recorded in builds with ENABLE_PERF_COUNTERS, and only while
+// attached to mTiming.trace. Events are numbered in the order they're first seen.
+struct mTimingTrace {
+	struct mTimingTraceEntryList entries;
+	uint32_t masterCycles;
+	bool overflowed;
+	size_t nEvents;
+	struct mTimingTraceEvent {
+		const struct mTimingEvent* event;
+		const char* name;
+		unsigned priority;
+	} events[mTIMING_TRACE_MAX_EVENTS];
 };
 
 struct mTiming {
 	struct mTimingEvent* root;
-	struct mTimingEvent* reroot;
+	size_t listSize;
+	bool useHeap;
+	struct mTimingEventHeap heap;
+	uint32_t order;
+	bool interrupted;
 
 	uint32_t masterCycles;
 	int32_t* relativeCycles;
 	int32_t* nextEvent;
+
+	struct mPerfCounters* perfCounters;
+	struct mTimingTrace* trace;
 };
 
 void mTimingInit(struct mTiming* timing, int32_t* relativeCycles, int32_t* nextEvent);
@@ -36,11 +95,15 @@ void mTimingClear(struct mTiming* timing);
 void mTimingSchedule(struct mTiming* timing, struct mTimingEvent*, int32_t when);
 void mTimingDeschedule(struct mTiming* timing, struct mTimingEvent*);
 bool mTimingIsScheduled(const struct mTiming* timing, const struct mTimingEvent*);
+void mTimingInterrupt(struct mTiming* timing);
 int32_t mTimingTick(struct mTiming* timing, int32_t cycles);
 int32_t mTimingCurrentTime(const struct mTiming* timing);
 int32_t mTimingNextEvent(struct mTiming* timing);
 int32_t mTimingUntil(const struct mTiming* timing, const struct mTimingEvent*);
 
+void mTimingTraceInit(struct mTimingTrace*);
+void mTimingTraceDeinit(struct mTimingTrace*);
+
 CXX_GUARD_END
 
 #endif
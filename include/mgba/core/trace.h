@@ -0,0 +1,57 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_TRACE_H
+#define M_CORE_TRACE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+// Events kept per thread; older ones are overwritten once a thread records more
+#define mTRACE_THREAD_EVENTS 0x4000
+#define mTRACE_MAX_THREADS 32
+
+// A timeline of what each thread was doing, for finding where frames stall. Spans are only
+// recorded in builds with ENABLE_TRACE, and only while tracing is turned on with
+// mTraceSetEnabled, so turning it off costs a flag check and compiling it out costs nothing.
+// Each thread appends to its own ring of events without taking any locks; names must be
+// string literals, since only the pointer is kept.
+#ifdef ENABLE_TRACE
+#define mTRACE_BEGIN(VAR) uint64_t VAR = mTraceBegin()
+#define mTRACE_END(VAR, NAME) mTraceEnd(NAME, VAR)
+#define mTRACE_THREAD(NAME) mTraceSetThreadName(NAME)
+#else
+#define mTRACE_BEGIN(VAR)
+#define mTRACE_END(VAR, NAME)
+#define mTRACE_THREAD(NAME)
+#endif
+
+struct mTraceEvent {
+	const char* name;
+	// Both in microseconds, on the same clock as mCoreMetricsTime
+	uint64_t start;
+	uint64_t duration;
+};
+
+void mTraceSetEnabled(bool enabled);
+bool mTraceIsEnabled(void);
+// Forgets every recorded event, but keeps the threads' buffers and names
+void mTraceClear(void);
+
+// Returns 0 while tracing is off, which makes the matching mTraceEnd do nothing
+uint64_t mTraceBegin(void);
+void mTraceEnd(const char* name, uint64_t start);
+void mTraceRecord(const char* name, uint64_t start, uint64_t end);
+void mTraceSetThreadName(const char* name);
+
+struct VFile;
+// Writes every thread's events as a Chrome trace-event JSON document, which can be opened
+// with chrome://tracing or Perfetto. Safe to call while other threads are still recording.
+bool mTraceWriteChrome(struct VFile*);
+
+CXX_GUARD_END
+
+#endif
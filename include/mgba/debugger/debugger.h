@@ -82,6 +82,8 @@ struct mBreakpoint {
 struct mWatchpoint {
 	ssize_t id;
 	uint32_t address;
+	// Number of bytes watched starting at address; 0 watches a single byte
+	uint32_t size;
 	int segment;
 	enum mWatchpointType type;
 	struct ParseTree* condition;
@@ -91,6 +93,10 @@ DECLARE_VECTOR(mBreakpointList, struct mBreakpoint);
 DECLARE_VECTOR(mWatchpointList, struct mWatchpoint);
 
 struct mDebugger;
+struct mDebuggerTrace;
+struct mDebuggerProfiler;
+struct mDebuggerReverse;
+struct mDebuggerTraceRecord;
 struct ParseTree;
 struct mDebuggerPlatform {
 	struct mDebugger* p;
@@ -110,6 +116,11 @@ struct mDebuggerPlatform {
 	void (*listWatchpoints)(struct mDebuggerPlatform*, struct mWatchpointList*);
 
 	void (*trace)(struct mDebuggerPlatform*, char* out, size_t* length);
+	void (*traceInstruction)(struct mDebuggerPlatform*, struct mDebuggerTraceRecord* out);
+	void (*traceAccesses)(struct mDebuggerPlatform*, bool enable);
+
+	// Returns the address of the next instruction, and the return address if the CPU keeps one in a register
+	bool (*getCallFrame)(struct mDebuggerPlatform*, uint32_t* pc, int* segment, uint32_t* returnAddress);
 
 	bool (*getRegister)(struct mDebuggerPlatform*, const char* name, int32_t* value);
 	bool (*setRegister)(struct mDebuggerPlatform*, const char* name, int32_t value);
@@ -123,6 +134,9 @@ struct mDebugger {
 	enum mDebuggerType type;
 	struct mCore* core;
 	struct mScriptBridge* bridge;
+	struct mDebuggerTrace* trace;
+	struct mDebuggerProfiler* profiler;
+	struct mDebuggerReverse* reverse;
 
 	void (*init)(struct mDebugger*);
 	void (*deinit)(struct mDebugger*);
@@ -136,6 +150,11 @@ struct mDebugger* mDebuggerCreate(enum mDebuggerType type, struct mCore*);
 void mDebuggerAttach(struct mDebugger*, struct mCore*);
 void mDebuggerRun(struct mDebugger*);
 void mDebuggerRunFrame(struct mDebugger*);
+void mDebuggerSetTrace(struct mDebugger*, struct mDebuggerTrace*);
+// While a reverse history is set, the debugger steps every instruction so it can count them
+void mDebuggerSetReverse(struct mDebugger*, struct mDebuggerReverse*);
+// Executes one instruction, keeping the reverse history up to date
+void mDebuggerStep(struct mDebugger*);
 void mDebuggerEnter(struct mDebugger*, enum mDebuggerEntryReason, struct mDebuggerEntryInfo*);
 
 bool mDebuggerLookupIdentifier(struct mDebugger* debugger, const char* name, int32_t* value, int* segment);
@@ -0,0 +1,126 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_SHARED_MEMORY_H
+#define M_SHARED_MEMORY_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/interface.h>
+
+#define mSHARED_MEMORY_MAGIC 0x4D53484D
+#define mSHARED_MEMORY_VERSION 1
+#define mSHARED_MEMORY_MAX_BLOCKS 16
+#define mSHARED_MEMORY_AUDIO_FRAMES 0x4000
+
+// Commands an external process can post through the control channel of the mapping
+enum mSharedMemoryCommand {
+	mSHARED_MEMORY_COMMAND_NONE = 0,
+	mSHARED_MEMORY_COMMAND_RUN,
+	mSHARED_MEMORY_COMMAND_PAUSE,
+	// Runs `argument` frames and then pauses
+	mSHARED_MEMORY_COMMAND_STEP,
+	mSHARED_MEMORY_COMMAND_RESET,
+	// Serializes into and out of the state area of the mapping
+	mSHARED_MEMORY_COMMAND_SAVE_STATE,
+	mSHARED_MEMORY_COMMAND_LOAD_STATE,
+	mSHARED_MEMORY_COMMAND_QUIT,
+};
+
+enum mSharedMemoryRunState {
+	mSHARED_MEMORY_RUNNING = 0,
+	mSHARED_MEMORY_PAUSED,
+	mSHARED_MEMORY_QUITTING,
+};
+
+struct mSharedMemoryBlock {
+	char name[16];
+	// Address of the block in the emulated address space
+	uint32_t start;
+	uint32_t size;
+	// Offset of the block's copy from the start of the mapping
+	uint32_t offset;
+	uint32_t reserved;
+};
+
+// Layout of the start of the mapping. All offsets are from the start of the mapping
+// and all fields are in host byte order. The other process must treat every field
+// it does not own as read-only.
+struct mSharedMemoryHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	uint32_t platform;
+
+	// Odd while a frame is being emulated, so a reader that sees the same even value
+	// before and after copying something got a consistent frame
+	uint32_t frameSequence;
+	uint32_t frameCounter;
+	uint32_t runState;
+	uint32_t stepsRemaining;
+
+	// The core renders straight into this buffer
+	uint32_t videoOffset;
+	uint32_t videoWidth;
+	uint32_t videoHeight;
+	// In pixels of BYTES_PER_PIXEL bytes
+	uint32_t videoStride;
+
+	// Interleaved stereo int16_t frames, at the rate of mAVStream.postAudioFrame
+	uint32_t audioOffset;
+	uint32_t audioCapacity;
+	// Total frames written, wrapping; frame N is at index N % audioCapacity
+	uint32_t audioWrite;
+	uint32_t reserved;
+
+	// Written by the other process: the keys to hold, as passed to mCore.setKeys
+	uint32_t keys;
+
+	uint32_t stateOffset;
+	uint32_t stateCapacity;
+	uint32_t nBlocks;
+	struct mSharedMemoryBlock blocks[mSHARED_MEMORY_MAX_BLOCKS];
+
+	// Control channel. The other process writes command and argument,
+	// then bumps commandSequence; resultSequence is set to match once it is handled.
+	uint32_t commandSequence;
+	uint32_t command;
+	uint32_t argument;
+	uint32_t resultSequence;
+	int32_t result;
+};
+
+struct mCore;
+struct VFile;
+struct mSharedMemory {
+	struct mAVStream d;
+	struct mCore* core;
+	struct VFile* vf;
+	struct mSharedMemoryHeader* header;
+	uint8_t* memory;
+	size_t size;
+	size_t blockIds[mSHARED_MEMORY_MAX_BLOCKS];
+	bool blockTracked[mSHARED_MEMORY_MAX_BLOCKS];
+	bool blocksValid;
+};
+
+// Maps `path` and points the core's video buffer and AV stream at it. Call it once the
+// core has been reset, since that decides which memory blocks exist; writable ones are
+// mirrored, up to mSHARED_MEMORY_MAX_BLOCKS. On Linux, a path under /dev/shm keeps the
+// mapping in memory.
+bool mSharedMemoryInit(struct mSharedMemory*, struct mCore*, const char* path);
+void mSharedMemoryDeinit(struct mSharedMemory*);
+
+// Handles pending commands and returns whether a frame should be run now
+bool mSharedMemoryPoll(struct mSharedMemory*);
+bool mSharedMemoryIsQuitting(const struct mSharedMemory*);
+void mSharedMemoryFrameStarted(struct mSharedMemory*);
+void mSharedMemoryFrameEnded(struct mSharedMemory*);
+
+CXX_GUARD_END
+
+#endif
@@ -32,6 +32,10 @@ struct mVideoThreadProxy {
 	enum mVideoLoggerEvent event;
 
 	struct RingFIFO dirtyQueue;
+
+	// CPUs to pin the render thread to, or 0 to leave it unpinned
+	uint64_t affinity;
+	bool highPriority;
 };
 
 void mVideoThreadProxyCreate(struct mVideoThreadProxy* renderer);
@@ -25,6 +25,7 @@ enum mVideoLoggerDirtyType {
 	DIRTY_FRAME,
 	DIRTY_RANGE,
 	DIRTY_BUFFER,
+	DIRTY_VRAM_DELTA,
 };
 
 enum mVideoLoggerEvent {
@@ -42,6 +43,13 @@ struct mVideoLoggerDirtyInfo {
 	uint32_t value2;
 };
 
+// A DIRTY_VRAM_DELTA packet carries value bytes of runs for the 0x1000 byte block at address.
+// Each run is this header followed by its words of VRAM.
+struct mVideoLoggerVRAMRun {
+	uint16_t offset;
+	uint16_t length;
+};
+
 struct VFile;
 struct mVideoLogger {
 	bool (*writeData)(struct mVideoLogger* logger, const void* data, size_t length);
@@ -74,9 +82,16 @@ struct mVideoLogger {
 	uint16_t* vram;
 	uint16_t* oam;
 	uint16_t* palette;
+	// What has been sent of VRAM so far, for encoding dirty blocks as deltas
+	uint32_t* vramShadow;
 
 	const void* pixelBuffer;
 	size_t pixelStride;
+
+	// Optional, for loggers that hand the stream to another thread: bytes written but not yet read
+	size_t (*queueDepth)(struct mVideoLogger*);
+	// Microseconds the writing thread has spent blocked on the reading one
+	uint64_t blockedTime;
 };
 
 void mVideoLoggerRendererCreate(struct mVideoLogger* logger, bool readonly);
@@ -97,6 +112,8 @@ void mVideoLoggerRendererFlush(struct mVideoLogger* logger);
 void mVideoLoggerRendererFinishFrame(struct mVideoLogger* logger);
 
 bool mVideoLoggerRendererRun(struct mVideoLogger* logger, bool block);
+bool mVideoLoggerRendererReadVRAMDelta(struct mVideoLogger* logger, const struct mVideoLoggerDirtyInfo* packet,
+                                       void (*written)(struct mVideoLogger*, uint32_t address, uint32_t length));
 
 struct mVideoLogContext;
 void mVideoLoggerAttachChannel(struct mVideoLogger* logger, struct mVideoLogContext* context, size_t channelId);
@@ -111,11 +128,16 @@ bool mVideoLogContextLoad(struct mVideoLogContext*, struct VFile*);
 void mVideoLogContextDestroy(struct mCore* core, struct mVideoLogContext*);
 
 void mVideoLogContextRewind(struct mVideoLogContext*, struct mCore*);
+uint32_t mVideoLogContextSeek(struct mVideoLogContext*, struct mCore*, uint32_t frame);
+void mVideoLogContextSetKeyframeInterval(struct mVideoLogContext*, uint32_t frames);
+void mVideoLogContextSetCompressionLevel(struct mVideoLogContext*, int level);
 void* mVideoLogContextInitialState(struct mVideoLogContext*, size_t* size);
 
 int mVideoLoggerAddChannel(struct mVideoLogContext*);
 
+bool mVideoLogIsCompatible(struct VFile*);
 struct mCore* mVideoLogCoreFind(struct VFile*);
+bool mVideoLogPlayerSeek(struct mCore*, uint32_t frame);
 
 CXX_GUARD_END
 
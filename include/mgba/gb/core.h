@@ -14,6 +14,7 @@ struct mCore;
 struct mCore* GBCoreCreate(void);
 #ifndef MINIMAL_CORE
 struct mCore* GBVideoLogPlayerCreate(void);
+bool GBVideoLogPlayerSeek(struct mCore*, uint32_t frame);
 #endif
 
 CXX_GUARD_END
@@ -14,6 +14,7 @@ struct mCore;
 struct mCore* GBACoreCreate(void);
 #ifndef MINIMAL_CORE
 struct mCore* GBAVideoLogPlayerCreate(void);
+bool GBAVideoLogPlayerSeek(struct mCore*, uint32_t frame);
 #endif
 
 CXX_GUARD_END
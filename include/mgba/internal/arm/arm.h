@@ -147,6 +147,31 @@ struct ARMInterruptHandler {
 	void (*hitStub)(struct ARMCore* cpu, uint32_t opcode);
 };
 
+#define ARM_BLOCK_CACHE_SIZE 0x1000
+#define ARM_BLOCK_MAX_LENGTH 32
+
+struct ARMBlockEntry {
+	union {
+		void (*arm)(struct ARMCore*, uint32_t opcode);
+		void (*thumb)(struct ARMCore*, uint16_t opcode);
+	};
+	uint32_t opcode;
+	unsigned condition;
+};
+
+struct ARMBlock {
+	uint32_t address;
+	enum ExecutionMode mode;
+	int length;
+	struct ARMBlockEntry entries[ARM_BLOCK_MAX_LENGTH];
+};
+
+struct ARMBlockCache {
+	struct ARMBlock blocks[ARM_BLOCK_CACHE_SIZE];
+};
+
+struct mPerfCounters;
+struct mMemoryHeatmap;
 struct ARMCore {
 	int32_t gprs[16];
 	union PSR cpsr;
@@ -173,6 +198,10 @@ struct ARMCore {
 
 	size_t numComponents;
 	struct mCPUComponent** components;
+
+	struct ARMBlockCache* blockCache;
+	struct mPerfCounters* perfCounters;
+	struct mMemoryHeatmap* heatmap;
 };
 
 void ARMInit(struct ARMCore* cpu);
@@ -191,6 +220,9 @@ void ARMRun(struct ARMCore* cpu);
 void ARMRunLoop(struct ARMCore* cpu);
 void ARMRunFake(struct ARMCore* cpu, uint32_t opcode);
 
+void ARMSetBlockCache(struct ARMCore* cpu, bool enable);
+void ARMBlockCacheInvalidate(struct ARMCore* cpu);
+
 CXX_GUARD_END
 
 #endif
@@ -13,6 +13,7 @@ CXX_GUARD_START
 #include <mgba/debugger/debugger.h>
 
 #include <mgba/internal/arm/arm.h>
+#include <mgba-util/table.h>
 #include <mgba-util/vector.h>
 
 struct ParseTree;
@@ -32,7 +33,13 @@ struct ARMDebugger {
 
 	struct ARMDebugBreakpointList breakpoints;
 	struct ARMDebugBreakpointList swBreakpoints;
+	// Number of hardware breakpoints at each address, consulted before scanning the list
+	struct Table breakpointAddresses;
 	struct mWatchpointList watchpoints;
+	// One bit per page with a watchpoint in it, only allocated while the memory shim is installed
+	uint32_t* watchpointPages;
+	// Whether the memory shim is also installed to record accesses into a trace
+	bool tracingAccesses;
 	struct ARMMemory originalMemory;
 
 	ssize_t nextId;
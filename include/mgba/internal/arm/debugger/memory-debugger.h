@@ -14,6 +14,7 @@ struct ARMDebugger;
 
 void ARMDebuggerInstallMemoryShim(struct ARMDebugger* debugger);
 void ARMDebuggerRemoveMemoryShim(struct ARMDebugger* debugger);
+void ARMDebuggerUpdateWatchpointPages(struct ARMDebugger* debugger);
 
 CXX_GUARD_END
 
@@ -11,6 +11,9 @@
 CXX_GUARD_START
 
 #include <mgba/debugger/debugger.h>
+#include <mgba/internal/debugger/profiler.h>
+#include <mgba/internal/debugger/reverse.h>
+#include <mgba/internal/debugger/trace.h>
 
 extern const char* ERROR_MISSING_ARGS;
 extern const char* ERROR_OVERFLOW;
@@ -80,6 +83,12 @@ struct CLIDebugger {
 
 	int traceRemaining;
 	struct VFile* traceVf;
+
+	struct mDebuggerTrace binaryTrace;
+	bool traceAccesses;
+
+	struct mDebuggerProfiler profiler;
+	struct mDebuggerReverse reverse;
 };
 
 void CLIDebuggerCreate(struct CLIDebugger*);
@@ -11,10 +11,13 @@
 CXX_GUARD_START
 
 #include <mgba/debugger/debugger.h>
+#include <mgba/internal/debugger/reverse.h>
 
+#include <mgba-util/ring-spsc.h>
 #include <mgba-util/socket.h>
+#include <mgba-util/threading.h>
 
-#define GDB_STUB_MAX_LINE 1200
+#define GDB_STUB_MAX_LINE 0x4000
 #define GDB_STUB_INTERVAL 32
 
 enum GDBStubAckState {
@@ -24,10 +27,25 @@ enum GDBStubAckState {
 	GDB_ACK_OFF
 };
 
+enum GDBStubRecordType {
+	GDB_RECORD_PACKET = 0,
+	GDB_RECORD_ATTACHED,
+	GDB_RECORD_DETACHED,
+	GDB_RECORD_OVERFLOW
+};
+
+struct GDBStubRecord {
+	uint32_t type;
+	uint32_t length;
+	Socket connection;
+	char data[GDB_STUB_MAX_LINE];
+};
+
 struct GDBStub {
 	struct mDebugger d;
 
 	char line[GDB_STUB_MAX_LINE];
+	size_t lineLength;
 	char outgoing[GDB_STUB_MAX_LINE];
 	enum GDBStubAckState lineAck;
 
@@ -39,6 +57,25 @@ struct GDBStub {
 
 	bool supportsSwbreak;
 	bool supportsHwbreak;
+
+	struct mDebuggerReverse reverse;
+
+#ifndef DISABLE_THREADING
+	// When threaded, a network thread owns the sockets, reading and framing packets and queueing
+	// them as records, so the emulation thread never touches the socket except to send replies.
+	// The connection is only ever closed by the network thread, after the emulation thread has
+	// stopped using it.
+	bool threaded;
+	Thread networkThread;
+	uint32_t networkRunning;
+	uint32_t hangupRequested;
+	Socket networkConnection;
+	struct RingSPSC queue;
+	Mutex queueMutex;
+	Condition queueCond;
+	struct GDBStubRecord networkRecord;
+	struct GDBStubRecord record;
+#endif
 };
 
 void GDBStubCreate(struct GDBStub*);
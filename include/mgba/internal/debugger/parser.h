@@ -58,10 +58,14 @@ struct Token {
 	};
 };
 
+struct ParseProgram;
 struct ParseTree {
 	struct Token token;
 	struct ParseTree* lhs;
 	struct ParseTree* rhs;
+
+	// Compiled form of the expression, built the first time it is evaluated
+	struct ParseProgram* program;
 };
 
 size_t lexExpression(struct LexVector* lv, const char* string, size_t length, const char* eol);
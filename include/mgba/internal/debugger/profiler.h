@@ -0,0 +1,52 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef DEBUGGER_PROFILER_H
+#define DEBUGGER_PROFILER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/timing.h>
+#include <mgba-util/table.h>
+
+#define mDEBUGGER_PROFILER_DEFAULT_INTERVAL 1024
+
+struct mDebugger;
+struct VFile;
+
+struct mDebuggerProfiler {
+	struct mDebugger* d;
+	struct mTimingEvent event;
+	int32_t interval;
+	bool callers;
+	bool running;
+
+	// Folded stacks, innermost frame last and separated by semicolons, mapped to sample counts
+	struct Table stacks;
+	uint64_t samples;
+};
+
+void mDebuggerProfilerInit(struct mDebuggerProfiler*);
+void mDebuggerProfilerDeinit(struct mDebuggerProfiler*);
+
+// Samples the program counter every interval cycles, and the caller if callers is set and the
+// platform can tell. Starting again discards any previous samples.
+void mDebuggerProfilerStart(struct mDebuggerProfiler*, struct mDebugger*, int32_t interval, bool callers);
+void mDebuggerProfilerStop(struct mDebuggerProfiler*);
+void mDebuggerProfilerClear(struct mDebuggerProfiler*);
+
+// Reschedules sampling if resetting the core or loading a state dropped it
+void mDebuggerProfilerUpdate(struct mDebuggerProfiler*);
+
+void mDebuggerProfilerSample(struct mDebuggerProfiler*);
+
+// Writes one "stack count" line per stack, the format taken by flamegraph.pl and similar tools
+bool mDebuggerProfilerWriteFolded(const struct mDebuggerProfiler*, struct VFile*);
+
+CXX_GUARD_END
+
+#endif
@@ -0,0 +1,89 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef DEBUGGER_REVERSE_H
+#define DEBUGGER_REVERSE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/debugger/debugger.h>
+#include <mgba-util/vector.h>
+
+#define mDEBUGGER_REVERSE_DEFAULT_INTERVAL 0x40000
+#define mDEBUGGER_REVERSE_DEFAULT_CHECKPOINTS 32
+
+struct mDebuggerCheckpoint {
+	uint64_t instruction;
+	uint32_t keys;
+	void* state;
+};
+
+struct mDebuggerKeyChange {
+	uint64_t instruction;
+	uint32_t keys;
+};
+
+DECLARE_VECTOR(mDebuggerKeyLog, struct mDebuggerKeyChange);
+
+enum mDebuggerReverseResult {
+	REVERSE_STOPPED,
+	// Went back as far as the oldest checkpoint without hitting anything
+	REVERSE_BEGINNING,
+	REVERSE_UNAVAILABLE
+};
+
+// Position history for running the debugger backwards. While attached, every instruction the
+// debugger steps is counted and a savestate is kept in memory every interval instructions, in
+// a ring of the most recent ones. Going back restores the nearest earlier checkpoint and steps
+// forward again to the instruction before, with key changes replayed from a log. Anything else
+// from outside, such as the real-time clock, isn't recorded, so replays that depend on it can
+// diverge.
+struct mDebuggerReverse {
+	struct mDebugger* d;
+	uint64_t interval;
+	size_t stateSize;
+
+	struct mDebuggerCheckpoint* checkpoints;
+	size_t capacity;
+	size_t start;
+	size_t size;
+
+	struct mDebuggerKeyLog keys;
+	uint32_t lastKeys;
+
+	// Instructions stepped since the history was last cleared
+	uint64_t instruction;
+
+	// Entries while replaying are recorded here instead of being reported
+	bool replaying;
+	bool stepping;
+	bool pendingHit;
+	uint64_t lastHit;
+	enum mDebuggerEntryReason hitReason;
+	struct mDebuggerEntryInfo hitInfo;
+	bool hitHasInfo;
+};
+
+void mDebuggerReverseInit(struct mDebuggerReverse*, size_t capacity, uint64_t interval);
+void mDebuggerReverseDeinit(struct mDebuggerReverse*);
+
+// Forgets every checkpoint, such as after the state was edited by hand
+void mDebuggerReverseClear(struct mDebuggerReverse*);
+
+// Called by the debugger around every instruction it steps
+void mDebuggerReverseWillStep(struct mDebuggerReverse*);
+void mDebuggerReverseDidStep(struct mDebuggerReverse*);
+void mDebuggerReverseRecordEntry(struct mDebuggerReverse*, enum mDebuggerEntryReason, const struct mDebuggerEntryInfo*);
+
+// Both leave the debugger paused. On REVERSE_STOPPED, reason and info, if not NULL, are filled
+// with what stopped a reverse continue; a reverse step always stops as if single-stepped.
+enum mDebuggerReverseResult mDebuggerReverseStep(struct mDebuggerReverse*);
+enum mDebuggerReverseResult mDebuggerReverseContinue(struct mDebuggerReverse*, enum mDebuggerEntryReason* reason, struct mDebuggerEntryInfo* info, bool* hasInfo);
+
+CXX_GUARD_END
+
+#endif
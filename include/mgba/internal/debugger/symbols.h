@@ -15,11 +15,20 @@ struct mDebuggerSymbols;
 struct mDebuggerSymbols* mDebuggerSymbolTableCreate(void);
 void mDebuggerSymbolTableDestroy(struct mDebuggerSymbols*);
 
+// Makes room for count more symbols up front, such as before loading a whole symbol table
+void mDebuggerSymbolTableReserve(struct mDebuggerSymbols*, size_t count);
+
 bool mDebuggerSymbolLookup(const struct mDebuggerSymbols*, const char* name, int32_t* value, int* segment);
 
 void mDebuggerSymbolAdd(struct mDebuggerSymbols*, const char* name, int32_t value, int segment);
+void mDebuggerSymbolAddSized(struct mDebuggerSymbols*, const char* name, int32_t value, int segment, uint32_t size);
 void mDebuggerSymbolRemove(struct mDebuggerSymbols*, const char* name);
 
+// Finds the symbol at or most closely preceding value, such as the function containing an address.
+// Symbols with a known size only match addresses inside of them. Symbols without a segment are
+// used if nothing in the given segment precedes value.
+const char* mDebuggerSymbolReverseLookup(struct mDebuggerSymbols*, int32_t value, int segment, uint32_t* offset);
+
 struct VFile;
 void mDebuggerLoadARMIPSSymbols(struct mDebuggerSymbols*, struct VFile* vf);
 
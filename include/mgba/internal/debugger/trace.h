@@ -0,0 +1,77 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef DEBUGGER_TRACE_H
+#define DEBUGGER_TRACE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#define mDEBUGGER_TRACE_MAGIC "mTRC"
+#define mDEBUGGER_TRACE_VERSION 1
+
+enum mDebuggerTraceRecordType {
+	TRACE_INSTRUCTION = 0,
+	TRACE_READ = 1,
+	TRACE_WRITE = 2,
+};
+
+// Trace files are a header followed by records, both stored little-endian in this layout.
+// For instructions, address is the address of the instruction, value holds its opcode
+// and width is the opcode's length in bytes. On ARM, Thumb instructions also hold the
+// following halfword in the top of value, so BL pairs can be decoded offline.
+// state is CPSR on ARM and AF on the LR35902.
+struct mDebuggerTraceRecord {
+	uint8_t type;
+	uint8_t width;
+	int16_t segment;
+	uint32_t address;
+	uint32_t value;
+	uint32_t state;
+};
+
+struct mDebuggerTraceHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t platform;
+	uint32_t recordSize;
+};
+
+struct VFile;
+struct mDebuggerTrace {
+	struct mDebuggerTraceRecord* records;
+	size_t capacity;
+	size_t start;
+	size_t size;
+
+	// Records are streamed to this file when the buffer fills up; without one, the
+	// buffer is a ring holding the most recent records
+	struct VFile* vf;
+	bool accesses;
+
+	// Number of instructions still to be recorded, or negative to record indefinitely
+	int32_t remaining;
+	uint64_t total;
+};
+
+struct mDebugger;
+struct mDebuggerPlatform;
+
+void mDebuggerTraceInit(struct mDebuggerTrace*, size_t capacity, struct VFile* vf, int platform);
+void mDebuggerTraceDeinit(struct mDebuggerTrace*);
+
+void mDebuggerTraceInstruction(struct mDebuggerTrace*, struct mDebuggerPlatform*);
+void mDebuggerTraceAccess(struct mDebuggerTrace*, enum mDebuggerTraceRecordType, uint32_t address, uint32_t value, int width, int segment);
+
+void mDebuggerTraceFlush(struct mDebuggerTrace*);
+bool mDebuggerTraceSave(const struct mDebuggerTrace*, struct VFile* vf, int platform);
+
+bool mDebuggerTraceReadHeader(struct VFile* vf, struct mDebuggerTraceHeader*);
+size_t mDebuggerTraceReadRecords(struct VFile* vf, struct mDebuggerTraceRecord*, size_t count);
+
+CXX_GUARD_END
+
+#endif
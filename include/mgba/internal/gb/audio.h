@@ -151,6 +151,13 @@ enum GBAudioStyle {
 	GB_AUDIO_GBA, // GBA PSG
 };
 
+// Channels aren't driven by timing events. Each one only records when its next edge is due,
+// and is run forward to the present whenever its output or state is about to be observed.
+struct GBAudioEdge {
+	int32_t when;
+	bool pending;
+};
+
 struct GBAudio {
 	struct GB* p;
 	struct mTiming* timing;
@@ -193,17 +200,21 @@ struct GBAudio {
 	enum GBAudioStyle style;
 
 	struct mTimingEvent frameEvent;
-	struct mTimingEvent ch1Event;
-	struct mTimingEvent ch2Event;
-	struct mTimingEvent ch3Event;
-	struct mTimingEvent ch3Fade;
-	struct mTimingEvent ch4Event;
+	struct GBAudioEdge ch1Edge;
+	struct GBAudioEdge ch2Edge;
+	struct GBAudioEdge ch3Edge;
+	struct GBAudioEdge ch3Fade;
+	struct GBAudioEdge ch4Edge;
 	struct mTimingEvent sampleEvent;
 	bool enable;
 
 	size_t samples;
 	bool forceDisableCh[4];
 	int masterVolume;
+	bool suppressOutput;
+	// No samples are made at all. Everything software can observe is still run exactly, but
+	// the noise channel's LFSR is only kept in time, since it can only be heard.
+	bool skipSynthesis;
 };
 
 void GBAudioInit(struct GBAudio* audio, size_t samples, uint8_t* nr52, enum GBAudioStyle style);
@@ -238,7 +249,13 @@ void GBAudioWriteNR50(struct GBAudio* audio, uint8_t);
 void GBAudioWriteNR51(struct GBAudio* audio, uint8_t);
 void GBAudioWriteNR52(struct GBAudio* audio, uint8_t);
 
-void GBAudioUpdateFrame(struct GBAudio* audio, struct mTiming* timing);
+// Channel edges due before timestamp are run first, so they see the sequencer's old state
+void GBAudioUpdateFrame(struct GBAudio* audio, int32_t timestamp);
+
+// Runs every channel edge due before timestamp
+void GBAudioRun(struct GBAudio* audio, int32_t timestamp);
+// Runs the channels up to the current time, for when something outside of a register write is about to observe them
+void GBAudioSync(struct GBAudio* audio);
 
 void GBAudioSamplePSG(struct GBAudio* audio, int16_t* left, int16_t* right);
 
@@ -95,12 +95,14 @@ struct GB {
 	size_t pristineRomSize;
 	size_t yankedRomSize;
 	uint32_t romCrc32;
+	bool romCrc32Pending;
 	struct VFile* romVf;
 	struct VFile* biosVf;
 	struct VFile* sramVf;
 	struct VFile* sramRealVf;
 	uint32_t sramSize;
 	int sramDirty;
+	uint32_t sramDirtySectors;
 	int32_t sramDirtAge;
 	bool sramMaskWriteback;
 
@@ -175,7 +177,9 @@ void GBApplyPatch(struct GB* gb, struct Patch* patch);
 
 bool GBIsROM(struct VFile* vf);
 void GBGetGameTitle(const struct GB* gba, char* out);
+uint32_t GBGetROMCrc32(struct GB* gb);
 void GBGetGameCode(const struct GB* gba, char* out);
+bool GBIdentifyROM(struct VFile* vf, char* title, char* code);
 
 void GBTestKeypadIRQ(struct GB* gb);
 
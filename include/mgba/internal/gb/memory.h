@@ -10,6 +10,7 @@
 
 CXX_GUARD_START
 
+#include <mgba/core/interface.h>
 #include <mgba/core/log.h>
 #include <mgba/core/timing.h>
 #include <mgba/gb/interface.h>
@@ -61,6 +62,7 @@ enum {
 	GB_SIZE_OAM = 0xA0,
 	GB_SIZE_IO = 0x80,
 	GB_SIZE_HRAM = 0x7F,
+	GB_SIZE_READ_PAGE = 0x1000,
 };
 
 enum {
@@ -153,6 +155,7 @@ union GBMBCState {
 	struct GBTAMA5State tama5;
 };
 
+struct LR35902Core;
 struct mRotationSource;
 struct GBMemory {
 	uint8_t* rom;
@@ -173,6 +176,9 @@ struct GBMemory {
 	uint8_t* sramBank;
 	int sramCurrentBank;
 
+	// Host pointers for plain data reads, one per 4 KiB of the address space; NULL when the page needs GBLoad8's full handling
+	const uint8_t* readPages[0x10];
+
 	uint8_t io[GB_SIZE_IO];
 	bool ime;
 	uint8_t ie;
@@ -202,14 +208,25 @@ struct GBMemory {
 	struct mRotationSource* rotation;
 	struct mRumble* rumble;
 	struct mImageSource* cam;
+
+	struct mCoreMemoryDirty vramDirtyPages;
+	struct mCoreMemoryDirty sramDirtyPages;
+	struct mCoreMemoryDirty wramDirtyPages;
+	struct mCoreMemoryDirty oamDirtyPages;
+	struct mCoreMemoryDirty hramDirtyPages;
+
+	struct mCoreMemoryHook* hook;
+	void (*unhookedStore8)(struct LR35902Core*, uint16_t address, int8_t value);
+	bool hookInstalled;
 };
 
-struct LR35902Core;
 void GBMemoryInit(struct GB* gb);
 void GBMemoryDeinit(struct GB* gb);
 
 void GBMemoryReset(struct GB* gb);
 void GBMemorySwitchWramBank(struct GBMemory* memory, int bank);
+void GBMemoryUpdateReadPages(struct GBMemory* memory);
+void GBMemorySetHook(struct GB* gb, struct mCoreMemoryHook* hook);
 
 uint8_t GBLoad8(struct LR35902Core* cpu, uint16_t address);
 void GBStore8(struct LR35902Core* cpu, uint16_t address, int8_t value);
@@ -219,7 +236,9 @@ int GBCurrentSegment(struct LR35902Core* cpu, uint16_t address);
 uint8_t GBView8(struct LR35902Core* cpu, uint16_t address, int segment);
 
 void GBMemoryDMA(struct GB* gb, uint16_t base);
+void GBMemorySyncDMA(struct GB* gb, uint32_t cyclesLate);
 uint8_t GBMemoryWriteHDMA5(struct GB* gb, uint8_t value);
+void GBMemoryScheduleHDMA(struct GB* gb);
 
 void GBPatch8(struct LR35902Core* cpu, uint16_t address, int8_t value, int8_t* old, int segment);
 
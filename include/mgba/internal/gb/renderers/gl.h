@@ -0,0 +1,143 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GB_RENDERER_GL_H
+#define GB_RENDERER_GL_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/core.h>
+#include <mgba/internal/gb/gb.h>
+#include <mgba/internal/gb/video.h>
+
+#if defined(BUILD_GLES2) || defined(BUILD_GLES3)
+
+#ifdef USE_EPOXY
+#include <epoxy/gl.h>
+#elif defined(BUILD_GL)
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+#else
+#include <GLES3/gl3.h>
+#endif
+
+enum {
+	GB_GL_VRAM_ROW_SIZE = 256,
+	GB_GL_VRAM_ROWS = 64,
+	GB_GL_SPANS_MAX = 1024,
+	GB_GL_VERTICES_PER_SPAN = 6
+};
+
+enum {
+	GB_GL_TEX_VRAM = 0,
+	GB_GL_TEX_PALETTE,
+	GB_GL_TEX_LOOKUP,
+	GB_GL_TEX_ATTRIBUTES,
+	GB_GL_TEX_OBJ,
+	GB_GL_TEX_BORDER,
+	GB_GL_TEX_INDEX,
+	GB_GL_TEX_MAX
+};
+
+enum {
+	GB_GL_SPAN_ZERO = 0x001,
+	GB_GL_SPAN_MAP = 0x002,
+	GB_GL_SPAN_TILE_DATA = 0x004,
+	GB_GL_SPAN_BG_ENABLE = 0x008,
+	GB_GL_SPAN_OBJ_ENABLE = 0x010,
+	GB_GL_SPAN_OBJ_SIZE = 0x020,
+	GB_GL_SPAN_MODE_SHIFT = 6,
+	GB_GL_SPAN_NOBJ_SHIFT = 8
+};
+
+struct GBVideoGLVertex {
+	GLint x;
+	GLint y;
+	GLint sx;
+	GLint sy;
+	GLint flags;
+	GLint padding;
+};
+
+struct GBVideoGLRenderer {
+	struct GBVideoRenderer d;
+
+	GLuint outputTex;
+	int scale;
+
+	uint32_t* temporaryBuffer;
+
+	GLuint fbo;
+	GLuint tex[GB_GL_TEX_MAX];
+	GLuint vbo;
+	GLuint vao;
+	GLuint program;
+	GLuint borderProgram;
+
+	// Spans are queued while the rest of the frame's state is current, and drawn before it changes.
+	// The extra span at the end holds the border quad.
+	struct GBVideoGLVertex vertices[(GB_GL_SPANS_MAX + 1) * GB_GL_VERTICES_PER_SPAN];
+	int nSpans;
+	// Whether the queued spans are drawn without writing color, for SGB_MASK_EN freeze
+	bool frozenSpans;
+
+	// One bit per 256 byte row of the VRAM texture
+	uint64_t vramDirty;
+
+	uint16_t rawPalette[128];
+	uint32_t palette[128];
+	bool paletteDirty;
+	uint8_t lookup[64];
+	bool lookupDirty;
+
+	struct GBObj objThisLine[GB_VIDEO_VERTICAL_PIXELS][10];
+	int objDirtyStart;
+	int objDirtyEnd;
+
+	uint32_t* border;
+	bool borderDirty;
+
+	uint32_t* transferRow;
+
+	uint8_t scy;
+	uint8_t scx;
+	uint8_t wy;
+	uint8_t wx;
+	uint8_t currentWy;
+	uint8_t currentWx;
+	int lastY;
+	int lastX;
+	bool hasWindow;
+
+	GBRegisterLCDC lcdc;
+	enum GBModel model;
+
+	int16_t objOffsetX;
+	int16_t objOffsetY;
+	int16_t offsetScx;
+	int16_t offsetScy;
+	int16_t offsetWx;
+	int16_t offsetWy;
+
+	int sgbTransfer;
+	uint8_t sgbPacket[128];
+	uint8_t sgbCommandHeader;
+	bool sgbBorders;
+};
+
+void GBVideoGLRendererCreate(struct GBVideoGLRenderer* renderer);
+
+#endif
+
+CXX_GUARD_END
+
+#endif
@@ -14,6 +14,9 @@ CXX_GUARD_START
 #include <mgba/internal/gb/gb.h>
 #include <mgba/internal/gb/video.h>
 
+#define GB_VIDEO_TILE_ROWS (GB_SIZE_VRAM / GB_SIZE_VRAM_BANK0 * GB_BASE_MAP / 2)
+#define GB_VIDEO_TILES (GB_VIDEO_TILE_ROWS / 8)
+
 struct GBVideoSoftwareRenderer {
 	struct GBVideoRenderer d;
 
@@ -27,6 +30,12 @@ struct GBVideoSoftwareRenderer {
 
 	uint32_t* temporaryBuffer;
 
+	// Tile data rows unpacked to one 2bpp pixel per byte, decoded lazily after a VRAM write
+	uint8_t tileRows[GB_VIDEO_TILE_ROWS][8];
+	uint8_t tileRowsFlipped[GB_VIDEO_TILE_ROWS][8];
+	uint32_t tileDirty[GB_VIDEO_TILES / 32];
+	const uint8_t* tileVram;
+
 	uint8_t scy;
 	uint8_t scx;
 	uint8_t wy;
@@ -14,12 +14,20 @@ CXX_GUARD_START
 #include <mgba/core/timing.h>
 #include <mgba/internal/gb/sio.h>
 
+#define GB_LOCKSTEP_DEFAULT_BUDGET 70224
+
 struct GBSIOLockstep {
 	struct mLockstep d;
 	struct GBSIOLockstepNode* players[MAX_GBS];
 
 	uint8_t pendingSB[MAX_GBS];
 	bool masterClaimed;
+
+	// The most cycles the master runs between synchronizations while the link is quiet.
+	// The step starts small after each transfer, since games tend to send bursts of bytes,
+	// and doubles every time the master syncs without seeing one until it hits this budget.
+	int32_t cycleBudget;
+	int32_t idleStep;
 };
 
 struct GBSIOLockstepNode {
@@ -38,6 +46,7 @@ struct GBSIOLockstepNode {
 };
 
 void GBSIOLockstepInit(struct GBSIOLockstep*);
+void GBSIOLockstepSetCycleBudget(struct GBSIOLockstep*, int32_t cycles);
 
 void GBSIOLockstepNodeCreate(struct GBSIOLockstepNode*);
 
@@ -34,6 +34,8 @@ struct GBTimer {
 
 void GBTimerReset(struct GBTimer*);
 void GBTimerDivReset(struct GBTimer*);
+void GBTimerSync(struct GBTimer*);
+void GBTimerUpdateScheduling(struct GBTimer*);
 uint8_t GBTimerUpdateTAC(struct GBTimer*, GBRegisterTAC tac);
 
 struct GBSerializedState;
@@ -129,6 +129,12 @@ struct GBVideo {
 	struct mTimingEvent modeEvent;
 	struct mTimingEvent frameEvent;
 
+	// Set for lines where nothing observes the ends of modes 2 and 3, which are then replayed by
+	// GBVideoSync instead of being scheduled; modeEvent only fires at the end of the line
+	bool lazyLine;
+	void (*lazyMode)(struct mTiming*, void* context, uint32_t cyclesLate);
+	uint32_t lazyModeWhen;
+
 	int32_t dotClock;
 
 	uint8_t* vram;
@@ -155,6 +161,8 @@ struct GBVideo {
 	int32_t frameCounter;
 	int frameskip;
 	int frameskipCounter;
+	int sgbTransferFrames;
+	bool suppressOutput;
 };
 
 void GBVideoInit(struct GBVideo* video);
@@ -162,6 +170,7 @@ void GBVideoReset(struct GBVideo* video);
 void GBVideoDeinit(struct GBVideo* video);
 void GBVideoAssociateRenderer(struct GBVideo* video, struct GBVideoRenderer* renderer);
 void GBVideoProcessDots(struct GBVideo* video, uint32_t cyclesLate);
+void GBVideoSync(struct GBVideo* video);
 
 void GBVideoWriteLCDC(struct GBVideo* video, GBRegisterLCDC value);
 void GBVideoWriteSTAT(struct GBVideo* video, GBRegisterSTAT value);
@@ -174,6 +183,9 @@ void GBVideoSetPalette(struct GBVideo* video, unsigned index, uint32_t color);
 
 void GBVideoWriteSGBPacket(struct GBVideo* video, uint8_t* data);
 
+// Applies an ATTR_BLK, ATTR_LIN, ATTR_DIV or ATTR_CHR packet to the renderer's SGB attributes
+void GBVideoRendererWriteSGBAttributes(struct GBVideoRenderer* renderer, const uint8_t* packet);
+
 struct GBSerializedState;
 void GBVideoSerialize(const struct GBVideo* video, struct GBSerializedState* state);
 void GBVideoDeserialize(struct GBVideo* video, const struct GBSerializedState* state);
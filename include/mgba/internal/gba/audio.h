@@ -18,6 +18,8 @@ CXX_GUARD_START
 #define MP2K_MAGIC 0x68736D53
 #define MP2K_MAX_SOUND_CHANNELS 12
 
+#define GBA_AUDIO_BATCH_SIZE 64
+
 mLOG_DECLARE_CATEGORY(GBA_AUDIO);
 
 struct GBADMA;
@@ -26,7 +28,7 @@ extern const unsigned GBA_AUDIO_SAMPLES;
 extern const int GBA_AUDIO_VOLUME_MAX;
 
 struct GBAAudioFIFO {
-	struct CircleBuffer fifo;
+	struct CircleBufferMasked fifo;
 	int dmaSource;
 	int8_t sample;
 };
@@ -48,7 +50,13 @@ DECL_BITFIELD(GBARegisterSOUNDBIAS, uint16_t);
 DECL_BITS(GBARegisterSOUNDBIAS, Bias, 0, 10);
 DECL_BITS(GBARegisterSOUNDBIAS, Resolution, 14, 2);
 
+struct GBAStereoSample {
+	int16_t left;
+	int16_t right;
+};
+
 struct GBAAudioMixer;
+struct GBAAudioSynthesizer;
 struct GBAAudio {
 	struct GBA* p;
 
@@ -83,15 +91,22 @@ struct GBAAudio {
 	bool forceDisableChA;
 	bool forceDisableChB;
 	int masterVolume;
+	bool suppressOutput;
+	// Neither the PSG nor the FIFOs are mixed. FIFO timing and DMA requests are unaffected.
+	bool skipSynthesis;
+	// Trades band-limited synthesis for cheaper, aliased output, for when nobody is listening closely
+	bool fastSynthesis;
+
+	// Mixed samples are handed to the blip buffers and the stream in batches, to amortize
+	// taking the audio lock and the per-call overhead of blip_buf
+	struct GBAStereoSample batch[GBA_AUDIO_BATCH_SIZE];
+	int batchLength;
+	// When set, batches are synthesized into the blip buffers on another thread
+	struct GBAAudioSynthesizer* synth;
 
 	struct mTimingEvent sampleEvent;
 };
 
-struct GBAStereoSample {
-	int16_t left;
-	int16_t right;
-};
-
 struct GBAMP2kADSR {
 	uint8_t attack;
 	uint8_t decay;
@@ -248,12 +263,14 @@ struct GBAMP2kTrack {
 	struct GBAMP2kMusicPlayerTrack track;
 	struct GBAMP2kSoundChannel* channel;
 	uint8_t lastCommand;
-	struct CircleBuffer buffer;
+	// Only the mixer's render thread touches these while it is running
 	uint32_t samplePlaying;
-	float currentOffset;
+	double currentOffset;
 	bool waiting;
 };
 
+struct GBAMP2kRenderQueue;
+
 struct GBAAudioMixer {
 	struct mCPUComponent d;
 	struct GBAAudio* p;
@@ -271,6 +288,7 @@ struct GBAAudioMixer {
 	double tempo;
 	double frame;
 
+	struct GBAMP2kRenderQueue* queue;
 	struct GBAStereoSample last;
 };
 
@@ -300,6 +318,11 @@ void GBAAudioWriteSOUNDBIAS(struct GBAAudio* audio, uint16_t value);
 void GBAAudioWriteWaveRAM(struct GBAAudio* audio, int address, uint32_t value);
 void GBAAudioWriteFIFO(struct GBAAudio* audio, int address, uint32_t value);
 void GBAAudioSampleFIFO(struct GBAAudio* audio, int fifoId, int32_t cycles);
+// Hands any batched samples over to the blip buffers and the stream
+void GBAAudioFlush(struct GBAAudio* audio);
+void GBAAudioSetThreadedSynthesis(struct GBAAudio* audio, bool enable);
+// Waits for batches handed to the synthesis thread, after which the blip buffers may be touched again
+void GBAAudioFinishSynthesis(struct GBAAudio* audio);
 
 struct GBASerializedState;
 void GBAAudioSerialize(const struct GBAAudio* audio, struct GBASerializedState* state);
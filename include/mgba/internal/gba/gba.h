@@ -96,6 +96,7 @@ struct GBA {
 	size_t pristineRomSize;
 	size_t yankedRomSize;
 	uint32_t romCrc32;
+	bool romCrc32Pending;
 	struct VFile* romVf;
 	struct VFile* biosVf;
 
@@ -105,8 +106,10 @@ struct GBA {
 
 	enum GBAIdleLoopOptimization idleOptimization;
 	uint32_t idleLoop;
+	bool idleLoopDetected;
 	uint32_t lastJump;
 	bool haltPending;
+	bool haltPendingEvent;
 	bool cpuBlocked;
 	bool earlyExit;
 	int idleDetectionStep;
@@ -174,6 +177,8 @@ bool GBAIsMB(struct VFile* vf);
 bool GBAIsBIOS(struct VFile* vf);
 void GBAGetGameCode(const struct GBA* gba, char* out);
 void GBAGetGameTitle(const struct GBA* gba, char* out);
+uint32_t GBAGetROMCrc32(struct GBA* gba);
+bool GBAIdentifyROM(struct VFile* vf, char* title, char* code);
 
 void GBATestKeypadIRQ(struct GBA* gba);
 
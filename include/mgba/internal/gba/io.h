@@ -171,6 +171,7 @@ void GBAIOWrite32(struct GBA* gba, uint32_t address, uint32_t value);
 uint16_t GBAIORead(struct GBA* gba, uint32_t address);
 
 bool GBAIOIsReadConstant(uint32_t address);
+bool GBAIOIsReadEventDriven(uint32_t address);
 
 struct GBASerializedState;
 void GBAIOSerialize(struct GBA* gba, struct GBASerializedState* state);
@@ -15,11 +15,15 @@ struct GBAMatrix {
 	uint32_t paddr;
 	uint32_t vaddr;
 	uint32_t size;
+
+	// Which ROM chunk each chunk of the mapped window currently holds, plus one
+	uint32_t* resident;
 };
 
 struct GBA;
 struct GBAMemory;
 void GBAMatrixReset(struct GBA*);
+void GBAMatrixDeinit(struct GBA*);
 void GBAMatrixWrite(struct GBA*, uint32_t address, uint32_t value);
 void GBAMatrixWrite16(struct GBA*, uint32_t address, uint16_t value);
 
@@ -10,6 +10,7 @@
 
 CXX_GUARD_START
 
+#include <mgba/core/interface.h>
 #include <mgba/core/timing.h>
 
 #include <mgba/internal/arm/arm.h>
@@ -75,6 +76,9 @@ enum {
 	SIZE_AGB_PRINT = 0x10000
 };
 
+// WRAM, IWRAM and VRAM, allocated as one block
+#define GBA_MEMORY_ARENA_SIZE (SIZE_WORKING_RAM + SIZE_WORKING_IRAM + SIZE_VRAM)
+
 enum {
 	OFFSET_MASK = 0x00FFFFFF,
 	BASE_OFFSET = 24
@@ -97,6 +101,19 @@ struct GBAPrintContext {
 	uint16_t put;
 };
 
+// A direct host mapping for one 16 MiB region: offsets (address & mask) below size are
+// plain memory, anything else falls back to the full handler for the region
+struct GBAMemoryPage {
+	uint8_t* data;
+	uint32_t mask;
+	uint32_t size;
+};
+
+// The prefetcher buffers at most 8 halfwords, and no region has more than 8 sequential waitstates
+#define GBA_PREFETCH_MAX_LOADS 8
+#define GBA_PREFETCH_MAX_SEQ 8
+#define GBA_PREFETCH_MAX_WAIT (GBA_PREFETCH_MAX_LOADS * (GBA_PREFETCH_MAX_SEQ + 1))
+
 struct GBAMemory {
 	uint32_t* bios;
 	uint32_t* wram;
@@ -119,6 +136,8 @@ struct GBAMemory {
 	char waitstatesNonseq16[256];
 	int activeRegion;
 	bool prefetch;
+	// Halfwords prefetched during a stall, indexed by sequential waitstates and then by the stall length
+	uint8_t prefetchLoads[GBA_PREFETCH_MAX_SEQ + 1][GBA_PREFETCH_MAX_WAIT + 1];
 	uint32_t lastPrefetchedPc;
 	uint32_t biosPrefetch;
 
@@ -132,6 +151,15 @@ struct GBAMemory {
 	uint16_t* agbPrintBuffer;
 
 	bool mirroring;
+
+	struct mCoreMemoryDirty dirtyPages[REGION_CART_SRAM + 1];
+
+	struct GBAMemoryPage loadPages[256];
+	struct GBAMemoryPage storePages[256];
+
+	struct mCoreMemoryHook* hook;
+	struct ARMMemory unhooked;
+	bool hookInstalled;
 };
 
 struct GBA;
@@ -139,6 +167,9 @@ void GBAMemoryInit(struct GBA* gba);
 void GBAMemoryDeinit(struct GBA* gba);
 
 void GBAMemoryReset(struct GBA* gba);
+// Must be called whenever the ROM mapping or its size changes
+void GBAMemoryUpdatePages(struct GBA* gba);
+void GBAMemorySetHook(struct GBA* gba, struct mCoreMemoryHook* hook);
 
 uint32_t GBALoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter);
 uint32_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter);
@@ -158,6 +189,8 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 void GBAPatch16(struct ARMCore* cpu, uint32_t address, int16_t value, int16_t* old);
 void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old);
 
+void GBAPristineCow(struct GBA* gba);
+
 uint32_t GBALoadMultiple(struct ARMCore*, uint32_t baseAddress, int mask, enum LSMDirection direction,
                          int* cycleCounter);
 uint32_t GBAStoreMultiple(struct ARMCore*, uint32_t baseAddress, int mask, enum LSMDirection direction,
@@ -24,11 +24,13 @@ struct GBACartridgeOverride {
 
 struct Configuration;
 bool GBAOverrideFind(const struct Configuration*, struct GBACartridgeOverride* override);
+bool GBAOverrideFindWithDatabase(const struct Configuration* database, const struct Configuration*, struct GBACartridgeOverride* override);
 void GBAOverrideSave(struct Configuration*, const struct GBACartridgeOverride* override);
+void GBAOverrideSaveIdleLoop(struct Configuration*, const struct GBACartridgeOverride* override);
 
 struct GBA;
 void GBAOverrideApply(struct GBA*, const struct GBACartridgeOverride*);
-void GBAOverrideApplyDefaults(struct GBA*, const struct Configuration*);
+void GBAOverrideApplyDefaults(struct GBA*, const struct Configuration* database, const struct Configuration* overrides);
 
 CXX_GUARD_END
 
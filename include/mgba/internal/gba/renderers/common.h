@@ -18,6 +18,7 @@ struct GBAVideoRendererSprite {
 	int16_t endY;
 };
 
+bool GBAVideoRendererCleanSprite(const struct GBAObj* oam, struct GBAVideoRendererSprite* sprite, int offsetY);
 int GBAVideoRendererCleanOAM(struct GBAObj* oam, struct GBAVideoRendererSprite* sprites, int offsetY);
 
 CXX_GUARD_END
@@ -84,6 +84,14 @@ enum {
 	GBA_GL_TEX_MAX
 };
 
+enum {
+	GBA_GL_VRAM_ROW_SIZE = 512,
+	GBA_GL_VRAM_ROWS = 192,
+	GBA_GL_PALETTE_ROWS = 32,
+
+	GBA_GL_READBACK_BUFFERS = 3
+};
+
 enum {
 	GBA_GL_VS_LOC = 0,
 	GBA_GL_VS_MAXPOS,
@@ -109,6 +117,7 @@ enum {
 	GBA_GL_OBJ_DIMS,
 	GBA_GL_OBJ_OBJWIN,
 	GBA_GL_OBJ_MOSAIC,
+	GBA_GL_OBJ_BASE,
 
 	GBA_GL_FINALIZE_SCALE = 2,
 	GBA_GL_FINALIZE_LAYERS,
@@ -117,7 +126,7 @@ enum {
 	GBA_GL_FINALIZE_BACKDROP,
 	GBA_GL_FINALIZE_BACKDROPFLAGS,
 
-	GBA_GL_UNIFORM_MAX = 12
+	GBA_GL_UNIFORM_MAX = 13
 };
 
 struct GBAVideoGLShader {
@@ -131,6 +140,13 @@ struct GBAVideoGLRenderer {
 
 	uint32_t* temporaryBuffer;
 
+	// When set, every finished frame is read back asynchronously, and GetPixels returns the
+	// frame before the most recent one instead of stalling for the current one
+	bool readbackLatency;
+	GLuint readbackPbo[GBA_GL_READBACK_BUFFERS];
+	GLsync readbackFence[GBA_GL_READBACK_BUFFERS];
+	unsigned readbackFrames;
+
 	struct GBAVideoGLBackground bg[4];
 	struct GBAVideoGLAffine affine[2][GBA_VIDEO_VERTICAL_PIXELS];
 
@@ -148,17 +164,27 @@ struct GBAVideoGLRenderer {
 	uint16_t shadowPalette[512];
 #endif
 	GLuint paletteTex;
-	bool paletteDirty;
+	// One bit per 16-color row of the palette texture
+	uint32_t paletteDirty;
 
 	GLuint vramTex;
-	unsigned vramDirty;
+	// One bit per 256-texel (512 byte) row of the VRAM texture
+	uint32_t vramDirty[GBA_GL_VRAM_ROWS / 32];
+	GLuint vramPbo;
 
 	uint16_t shadowRegs[0x30];
 	uint64_t regsDirty;
 
 	struct GBAVideoGLShader bgShader[6];
 	struct GBAVideoGLShader objShader[2];
+	// With uniform buffers and instancing (GL 3.1 or GLES 3.0), every sprite in a batch is drawn
+	// by this one program from objUbo, instead of one objShader draw per sprite
+	bool objBatching;
+	struct GBAVideoGLShader objBatchShader;
+	GLuint objUbo;
 	struct GBAVideoGLShader finalizeShader;
+	// Program and VAO last bound by _drawScanlines, only valid during a single batch
+	const struct GBAVideoGLShader* activeShader;
 
 	GBARegisterDISPCNT dispcnt;
 
@@ -0,0 +1,80 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GBA_VIDEO_OBSERVATION_H
+#define GBA_VIDEO_OBSERVATION_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/gba/interface.h>
+#include <mgba/internal/gba/memory.h>
+#include <mgba/internal/gba/video.h>
+#include <mgba/internal/gba/renderers/common.h>
+
+#define GBA_OBSERVATION_MAX_SCALE 8
+#define GBA_OBSERVATION_TILEMAP_WIDTH (GBA_VIDEO_HORIZONTAL_PIXELS / 8)
+#define GBA_OBSERVATION_TILEMAP_HEIGHT (GBA_VIDEO_VERTICAL_PIXELS / 8)
+
+// Set on palette index samples of bitmap modes 3 and 5, whose low 15 bits are the color itself
+#define GBA_OBSERVATION_DIRECT_COLOR 0x8000
+
+enum GBAVideoObservationFormat {
+	GBA_OBSERVATION_NONE = 0,
+	// One byte of luma per sample
+	GBA_OBSERVATION_GRAY8,
+	// One uint16_t per sample: 0-255 for backgrounds and the backdrop, 256-511 for sprites
+	GBA_OBSERVATION_PALETTE_INDEX,
+};
+
+// Renders just enough of each frame for an agent to look at, into buffers owned by the caller.
+// Every scale-th pixel of every scale-th line is taken from the topmost opaque layer, without
+// windows, blending, brightness effects or mosaic, and without converting colors. It can also
+// copy out the part of each background's map that is on screen, one entry per 8x8 cell: the raw
+// map entry for text backgrounds and the tile number for affine ones. Backgrounds that aren't
+// shown are left out of tilemapLayers and their maps are left as they were.
+struct GBAVideoObservationRenderer {
+	struct GBAVideoRenderer d;
+
+	enum GBAVideoObservationFormat format;
+	unsigned scale;
+	// Holds GBAVideoObservationWidth x GBAVideoObservationHeight samples, stride apart
+	void* pixels;
+	size_t stride;
+	// Each holds GBA_OBSERVATION_TILEMAP_WIDTH x GBA_OBSERVATION_TILEMAP_HEIGHT entries
+	uint16_t* tilemaps[4];
+	// Which backgrounds' maps were written for the last frame
+	unsigned tilemapLayers;
+
+	GBARegisterDISPCNT dispcnt;
+	struct GBAVideoObservationBackground {
+		GBARegisterBGCNT control;
+		uint16_t x;
+		uint16_t y;
+		int32_t refx;
+		int32_t refy;
+		int16_t dx;
+		int16_t dmx;
+		int16_t dy;
+		int16_t dmy;
+		int32_t sx;
+		int32_t sy;
+	} bg[4];
+
+	uint8_t luma[SIZE_PALETTE_RAM / 2];
+	struct GBAVideoRendererSprite sprites[128];
+	int oamMax;
+	bool oamDirty;
+};
+
+void GBAVideoObservationRendererCreate(struct GBAVideoObservationRenderer* renderer);
+
+unsigned GBAVideoObservationWidth(const struct GBAVideoObservationRenderer* renderer);
+unsigned GBAVideoObservationHeight(const struct GBAVideoObservationRenderer* renderer);
+
+CXX_GUARD_END
+
+#endif
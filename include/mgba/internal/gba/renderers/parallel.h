@@ -0,0 +1,77 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GBA_VIDEO_PARALLEL_H
+#define GBA_VIDEO_PARALLEL_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/internal/gba/memory.h>
+#include <mgba/internal/gba/video.h>
+#include <mgba/internal/gba/renderers/video-software.h>
+
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
+
+#ifndef DISABLE_THREADING
+
+#define GBA_VIDEO_PARALLEL_MAX_THREADS 8
+
+struct GBAVideoParallelCommand {
+	uint8_t type;
+	uint32_t address;
+	uint16_t value;
+};
+
+struct GBAVideoParallelVRAMBlock {
+	uint16_t data[0x800];
+};
+
+DECLARE_VECTOR(GBAVideoParallelCommandList, struct GBAVideoParallelCommand);
+DECLARE_VECTOR(GBAVideoParallelVRAMBlockList, struct GBAVideoParallelVRAMBlock);
+
+struct GBAVideoParallelRenderer;
+
+struct GBAVideoParallelWorker {
+	struct GBAVideoParallelRenderer* p;
+	struct GBAVideoSoftwareRenderer* renderer;
+	int index;
+	unsigned frame;
+	Thread thread;
+
+	uint16_t* vram;
+	uint16_t palette[SIZE_PALETTE_RAM / 2];
+	union GBAOAM oam;
+};
+
+struct GBAVideoParallelRenderer {
+	struct GBAVideoRenderer d;
+	struct GBAVideoSoftwareRenderer* backend;
+	int threads;
+
+	int nWorkers;
+	struct GBAVideoParallelWorker* workers;
+
+	struct GBAVideoParallelCommandList commands;
+	struct GBAVideoParallelVRAMBlockList vramBlocks;
+	uint32_t vramDirty;
+
+	Mutex mutex;
+	Condition toWorkers;
+	Condition fromWorkers;
+	unsigned frame;
+	int pending;
+	bool stopping;
+};
+
+void GBAVideoParallelRendererCreate(struct GBAVideoParallelRenderer* renderer, struct GBAVideoSoftwareRenderer* backend, int threads);
+
+#endif
+
+CXX_GUARD_END
+
+#endif
@@ -80,6 +80,11 @@ struct WindowControl {
 struct Window {
 	uint8_t endX;
 	struct WindowControl control;
+	// Resolved once per scanline: the blend effect as this span sees it and its backdrop color
+	uint8_t blend;
+	color_t backdrop;
+	// Nothing has been drawn over the backdrop in this span yet
+	bool bare;
 };
 
 struct GBAVideoSoftwareRenderer {
@@ -87,6 +92,10 @@ struct GBAVideoSoftwareRenderer {
 
 	color_t* outputBuffer;
 	int outputBufferStride;
+	// Finished scanlines are converted on the way out, so outputBuffer really holds uint16_t pixels
+	bool outputRGB565;
+	// Finished scanlines are scattered into 4x4 tiles, as mCOLOR_TILED_4X4 lays them out
+	bool outputTiled;
 
 	uint32_t* temporaryBuffer;
 
@@ -122,15 +131,18 @@ struct GBAVideoSoftwareRenderer {
 	struct WindowControl objwin;
 
 	struct WindowControl currentWindow;
+	enum GBAVideoBlendEffect currentBlend;
 
 	int nWindows;
 	struct Window windows[MAX_WINDOW];
+	int currentSpan;
 
 	struct GBAVideoSoftwareBackground bg[4];
 
 	int oamDirty;
-	int oamMax;
 	struct GBAVideoRendererSprite sprites[128];
+	// One bit per OAM entry for every scanline it covers, kept up to date by OAM writes
+	uint32_t scanlineSprites[GBA_VIDEO_VERTICAL_PIXELS][4];
 	int16_t objOffsetX;
 	int16_t objOffsetY;
 
@@ -147,6 +159,7 @@ struct GBAVideoSoftwareRenderer {
 };
 
 void GBAVideoSoftwareRendererCreate(struct GBAVideoSoftwareRenderer* renderer);
+void GBAVideoSoftwareRendererSkipScanline(struct GBAVideoSoftwareRenderer* renderer, int y);
 
 CXX_GUARD_START
 
@@ -0,0 +1,79 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GBA_KFM_H
+#define GBA_KFM_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/internal/gba/rr/rr.h>
+#include <mgba-util/vector.h>
+
+#define GBA_KFM_DEFAULT_INTERVAL 600
+
+struct GBA;
+struct VFile;
+
+struct GBAKFMKeyframe {
+	uint32_t frame;
+	uint32_t offset;
+	uint32_t size;
+};
+
+DECLARE_VECTOR(GBAKFMKeyframeList, struct GBAKFMKeyframe);
+DECLARE_VECTOR(GBAKFMInputList, uint16_t);
+
+enum GBAKFMVerifyResult {
+	GBA_KFM_VERIFY_MATCH,
+	GBA_KFM_VERIFY_MISMATCH,
+	GBA_KFM_VERIFY_ERROR
+};
+
+// A single-file movie: a fixed-size input record for every frame, plus a savestate keyframe every
+// keyframeInterval frames and an index of them, so any frame can be reached by loading the nearest
+// keyframe and replaying at most keyframeInterval - 1 frames.
+struct GBAKFMContext {
+	struct GBARRContext d;
+	struct GBA* gba;
+
+	bool isPlaying;
+	bool autorecord;
+	bool isRecording;
+	bool inputThisFrame;
+	// Set while the context itself is saving or loading keyframes, so they don't count as rerecords
+	bool internalState;
+
+	struct VFile* movieFile;
+	uint32_t keyframeInterval;
+	uint16_t currentInput;
+	uint32_t writeOffset;
+	// While verifying, playback stops here and the state is captured into state
+	uint32_t verifyFrame;
+
+	struct GBAKFMKeyframeList keyframes;
+	struct GBAKFMInputList inputs;
+	struct GBASerializedState* state;
+};
+
+void GBAKFMContextCreate(struct GBAKFMContext*, struct GBA*);
+
+bool GBAKFMSetStream(struct GBAKFMContext*, struct VFile*);
+bool GBAKFMCreateStream(struct GBAKFMContext*, enum GBARRInitFrom initFrom, uint32_t keyframeInterval);
+
+uint32_t GBAKFMFrameCount(const struct GBAKFMContext*);
+// Positions playback at the start of the given frame. The core must be idle, e.g. between runFrame calls.
+bool GBAKFMSeek(struct GBAKFMContext*, uint32_t frame);
+
+size_t GBAKFMKeyframeCount(const struct GBAKFMContext*);
+// Plays the movie from a keyframe up to the next one and hashes the state reached there, to check it
+// against the one recorded. Segments only depend on their own keyframe, so contexts on separate cores
+// can verify different segments of one movie at the same time. Hashes are only filled in if it ran.
+enum GBAKFMVerifyResult GBAKFMVerifySegment(struct GBAKFMContext*, size_t keyframe, uint64_t* expected, uint64_t* actual);
+
+CXX_GUARD_END
+
+#endif
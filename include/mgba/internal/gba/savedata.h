@@ -92,6 +92,8 @@ struct GBASavedata {
 	struct mTimingEvent dust;
 
 	enum SavedataDirty dirty;
+	// One bit per mSAVEDATA_SECTOR_SHIFT-sized sector written since the last sync
+	uint32_t dirtySectors;
 	uint32_t dirtAge;
 
 	enum FlashStateMachine flashState;
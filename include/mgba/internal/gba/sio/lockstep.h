@@ -14,11 +14,17 @@ CXX_GUARD_START
 #include <mgba/core/timing.h>
 #include <mgba/internal/gba/sio.h>
 
+#define GBA_LOCKSTEP_DEFAULT_BUDGET 2000
+
 struct GBASIOLockstep {
 	struct mLockstep d;
 	struct GBASIOLockstepNode* players[MAX_GBAS];
 	int attachedMulti;
 	int attachedNormal;
+	// How many cycles the master runs between synchronizations while no transfer is active.
+	// Transfers always synchronize as soon as they start, so raising this only lets the
+	// players drift further apart between them in exchange for fewer round trips.
+	int32_t cycleBudget;
 
 	uint16_t multiRecv[MAX_GBAS];
 	uint32_t normalRecv[MAX_GBAS];
@@ -42,6 +48,7 @@ struct GBASIOLockstepNode {
 };
 
 void GBASIOLockstepInit(struct GBASIOLockstep*);
+void GBASIOLockstepSetCycleBudget(struct GBASIOLockstep*, int32_t cycles);
 
 void GBASIOLockstepNodeCreate(struct GBASIOLockstepNode*);
 
@@ -30,6 +30,8 @@ void GBATimerInit(struct GBA* gba);
 void GBATimerUpdateRegister(struct GBA* gba, int timer, int32_t cyclesLate);
 void GBATimerWriteTMCNT_LO(struct GBA* gba, int timer, uint16_t value);
 void GBATimerWriteTMCNT_HI(struct GBA* gba, int timer, uint16_t value);
+// Must be called when something that consumes timer overflows, e.g. the audio FIFOs, changes
+void GBATimerUpdateScheduling(struct GBA* gba);
 
 CXX_GUARD_END
 
@@ -25,6 +25,12 @@ struct GBAVFameCart {
 	int romMode;
 	int8_t writeSequence[5];
 	bool acceptingModeChange;
+
+	// SRAM scrambling for the current mode, split into byte-sized lookups
+	int tableMode;
+	uint16_t sramAddressLow[256];
+	uint16_t sramAddressHigh[256];
+	uint8_t sramValue[256];
 };
 
 void GBAVFameInit(struct GBAVFameCart* cart);
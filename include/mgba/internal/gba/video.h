@@ -209,6 +209,7 @@ struct GBAVideo {
 	int32_t frameCounter;
 	int frameskip;
 	int frameskipCounter;
+	bool suppressOutput;
 };
 
 void GBAVideoInit(struct GBAVideo* video);
@@ -217,6 +218,9 @@ void GBAVideoDeinit(struct GBAVideo* video);
 void GBAVideoAssociateRenderer(struct GBAVideo* video, struct GBAVideoRenderer* renderer);
 
 void GBAVideoWriteDISPSTAT(struct GBAVideo* video, uint16_t value);
+// Lines where nothing observes the start of HBlank skip that event; this restores it mid-line
+// before anything that could observe it, such as DISPSTAT reads or HBlank DMA setup
+void GBAVideoSyncHblank(struct GBAVideo* video);
 
 struct GBASerializedState;
 void GBAVideoSerialize(const struct GBAVideo* video, struct GBASerializedState* state);
@@ -13,6 +13,7 @@ CXX_GUARD_START
 #include <mgba/debugger/debugger.h>
 
 #include <mgba/internal/lr35902/lr35902.h>
+#include <mgba-util/table.h>
 
 struct LR35902Segment {
 	uint16_t start;
@@ -26,8 +27,12 @@ struct LR35902Debugger {
 	struct LR35902Core* cpu;
 
 	struct mBreakpointList breakpoints;
+	// Number of breakpoints at each address, consulted before scanning the list
+	struct Table breakpointAddresses;
 	struct mWatchpointList watchpoints;
 	struct LR35902Memory originalMemory;
+	// Whether the memory shim is also installed to record accesses into a trace
+	bool tracingAccesses;
 
 	ssize_t nextId;
 
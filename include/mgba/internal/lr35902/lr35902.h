@@ -14,6 +14,8 @@ CXX_GUARD_START
 #include <mgba/internal/lr35902/isa-lr35902.h>
 
 struct LR35902Core;
+struct mPerfCounters;
+struct mMemoryHeatmap;
 
 #pragma pack(push, 1)
 union FlagRegister {
@@ -127,6 +129,9 @@ struct LR35902Core {
 
 	size_t numComponents;
 	struct mCPUComponent** components;
+
+	struct mPerfCounters* perfCounters;
+	struct mMemoryHeatmap* heatmap;
 };
 
 void LR35902Init(struct LR35902Core* cpu);
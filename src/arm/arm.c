@@ -8,6 +8,10 @@
 #include <mgba/internal/arm/isa-arm.h>
 #include <mgba/internal/arm/isa-inlines.h>
 #include <mgba/internal/arm/isa-thumb.h>
+#include <mgba/core/mem-heatmap.h>
+#include <mgba/core/perf-counters.h>
+
+#include <mgba-util/memory.h>
 
 static inline enum RegisterBank _ARMSelectBank(enum PrivilegeMode);
 
@@ -79,6 +83,7 @@ void ARMInit(struct ARMCore* cpu) {
 }
 
 void ARMDeinit(struct ARMCore* cpu) {
+	ARMSetBlockCache(cpu, false);
 	if (cpu->master->deinit) {
 		cpu->master->deinit(cpu->master);
 	}
@@ -141,6 +146,7 @@ void ARMReset(struct ARMCore* cpu) {
 	cpu->nextEvent = 0;
 	cpu->halted = 0;
 
+	ARMBlockCacheInvalidate(cpu);
 	cpu->irqh.reset(cpu);
 }
 
@@ -202,76 +208,97 @@ void ARMRaiseUndefined(struct ARMCore* cpu) {
 	cpu->cpsr.i = 1;
 }
 
+static inline bool _ARMConditionMet(struct ARMCore* cpu, unsigned condition) {
+	switch (condition) {
+	case 0x0:
+		return ARM_COND_EQ;
+	case 0x1:
+		return ARM_COND_NE;
+	case 0x2:
+		return ARM_COND_CS;
+	case 0x3:
+		return ARM_COND_CC;
+	case 0x4:
+		return ARM_COND_MI;
+	case 0x5:
+		return ARM_COND_PL;
+	case 0x6:
+		return ARM_COND_VS;
+	case 0x7:
+		return ARM_COND_VC;
+	case 0x8:
+		return ARM_COND_HI;
+	case 0x9:
+		return ARM_COND_LS;
+	case 0xA:
+		return ARM_COND_GE;
+	case 0xB:
+		return ARM_COND_LT;
+	case 0xC:
+		return ARM_COND_GT;
+	case 0xD:
+		return ARM_COND_LE;
+	default:
+		return false;
+	}
+}
+
+#ifdef ENABLE_PERF_COUNTERS
+// Regions are the top nybble of the address space, which is what the GBA memory map dispatches on
+// The executing instruction is one fetch behind the PC until it gets stepped, and the next fetch is sequential
+#define COUNT_INSTRUCTION(MODE) \
+	if (cpu->perfCounters) { \
+		++cpu->perfCounters->instructions[MODE]; \
+		++cpu->perfCounters->instructionRegions[((uint32_t) cpu->gprs[ARM_PC] >> 24) & (mPERF_COUNTER_REGIONS - 1)]; \
+	} \
+	if (cpu->heatmap) { \
+		struct mMemoryHeatmapPage* heatPage = mMemoryHeatmapGetPage(cpu->heatmap, cpu->gprs[ARM_PC] - ((MODE) == MODE_ARM ? WORD_SIZE_ARM : WORD_SIZE_THUMB)); \
+		++heatPage->accesses[mMEMORY_HEATMAP_EXECUTE]; \
+		heatPage->cycles[mMEMORY_HEATMAP_EXECUTE] += 1 + ((MODE) == MODE_ARM ? cpu->memory.activeSeqCycles32 : cpu->memory.activeSeqCycles16); \
+	}
+#define COUNT_HANDLER(MODE, INDEX) \
+	if (cpu->perfCounters) { \
+		++cpu->perfCounters->handlers[MODE][INDEX]; \
+	}
+#define COUNT_CONDITION_FAILED \
+	if (cpu->perfCounters) { \
+		++cpu->perfCounters->conditionsFailed; \
+	}
+#else
+#define COUNT_INSTRUCTION(MODE)
+#define COUNT_HANDLER(MODE, INDEX)
+#define COUNT_CONDITION_FAILED
+#endif
+
+#define ARM_HANDLER_INDEX(OPCODE) ((((OPCODE) >> 16) & 0xFF0) | (((OPCODE) >> 4) & 0x00F))
+#define THUMB_HANDLER_INDEX(OPCODE) ((OPCODE) >> 6)
+
 static inline void ARMStep(struct ARMCore* cpu) {
+	COUNT_INSTRUCTION(MODE_ARM);
 	uint32_t opcode = cpu->prefetch[0];
 	cpu->prefetch[0] = cpu->prefetch[1];
 	cpu->gprs[ARM_PC] += WORD_SIZE_ARM;
 	LOAD_32(cpu->prefetch[1], cpu->gprs[ARM_PC] & cpu->memory.activeMask, cpu->memory.activeRegion);
 
 	unsigned condition = opcode >> 28;
-	if (condition != 0xE) {
-		bool conditionMet = false;
-		switch (condition) {
-		case 0x0:
-			conditionMet = ARM_COND_EQ;
-			break;
-		case 0x1:
-			conditionMet = ARM_COND_NE;
-			break;
-		case 0x2:
-			conditionMet = ARM_COND_CS;
-			break;
-		case 0x3:
-			conditionMet = ARM_COND_CC;
-			break;
-		case 0x4:
-			conditionMet = ARM_COND_MI;
-			break;
-		case 0x5:
-			conditionMet = ARM_COND_PL;
-			break;
-		case 0x6:
-			conditionMet = ARM_COND_VS;
-			break;
-		case 0x7:
-			conditionMet = ARM_COND_VC;
-			break;
-		case 0x8:
-			conditionMet = ARM_COND_HI;
-			break;
-		case 0x9:
-			conditionMet = ARM_COND_LS;
-			break;
-		case 0xA:
-			conditionMet = ARM_COND_GE;
-			break;
-		case 0xB:
-			conditionMet = ARM_COND_LT;
-			break;
-		case 0xC:
-			conditionMet = ARM_COND_GT;
-			break;
-		case 0xD:
-			conditionMet = ARM_COND_LE;
-			break;
-		default:
-			break;
-		}
-		if (!conditionMet) {
-			cpu->cycles += ARM_PREFETCH_CYCLES;
-			return;
-		}
+	if (condition != 0xE && !_ARMConditionMet(cpu, condition)) {
+		COUNT_CONDITION_FAILED;
+		cpu->cycles += ARM_PREFETCH_CYCLES;
+		return;
 	}
-	ARMInstruction instruction = _armTable[((opcode >> 16) & 0xFF0) | ((opcode >> 4) & 0x00F)];
+	COUNT_HANDLER(MODE_ARM, ARM_HANDLER_INDEX(opcode));
+	ARMInstruction instruction = _armTable[ARM_HANDLER_INDEX(opcode)];
 	instruction(cpu, opcode);
 }
 
 static inline void ThumbStep(struct ARMCore* cpu) {
+	COUNT_INSTRUCTION(MODE_THUMB);
 	uint32_t opcode = cpu->prefetch[0];
 	cpu->prefetch[0] = cpu->prefetch[1];
 	cpu->gprs[ARM_PC] += WORD_SIZE_THUMB;
 	LOAD_16(cpu->prefetch[1], cpu->gprs[ARM_PC] & cpu->memory.activeMask, cpu->memory.activeRegion);
-	ThumbInstruction instruction = _thumbTable[opcode >> 6];
+	COUNT_HANDLER(MODE_THUMB, THUMB_HANDLER_INDEX(opcode));
+	ThumbInstruction instruction = _thumbTable[THUMB_HANDLER_INDEX(opcode)];
 	instruction(cpu, opcode);
 }
 
@@ -286,8 +313,138 @@ void ARMRun(struct ARMCore* cpu) {
 	}
 }
 
+static inline bool _ARMBlockTerminates(uint32_t opcode) {
+	if (opcode >> 28 != 0xE) {
+		return false;
+	}
+	if ((opcode & 0x0E000000) == 0x0A000000) {
+		// B, BL
+		return true;
+	}
+	if ((opcode & 0x0FFFFFF0) == 0x012FFF10) {
+		// BX
+		return true;
+	}
+	// SWI
+	return (opcode & 0x0F000000) == 0x0F000000;
+}
+
+static inline bool _ThumbBlockTerminates(uint16_t opcode) {
+	if ((opcode & 0xF000) == 0xE000 || (opcode & 0xF800) == 0xF800) {
+		// B, BL (second half)
+		return true;
+	}
+	if ((opcode & 0xFF00) == 0x4700 || (opcode & 0xFF00) == 0xBD00) {
+		// BX, POP {PC}
+		return true;
+	}
+	// SWI
+	return (opcode & 0xFF00) == 0xDF00;
+}
+
+static struct ARMBlock* _ARMBlockLookup(struct ARMCore* cpu, uint32_t address, enum ExecutionMode mode) {
+	struct ARMBlock* block = &cpu->blockCache->blocks[((address >> 1) ^ (address >> 13)) & (ARM_BLOCK_CACHE_SIZE - 1)];
+	if (block->length && block->address == address && block->mode == mode) {
+		return block;
+	}
+	block->address = address;
+	block->mode = mode;
+	int i;
+	for (i = 0; i < ARM_BLOCK_MAX_LENGTH; ++i) {
+		struct ARMBlockEntry* entry = &block->entries[i];
+		if (mode == MODE_ARM) {
+			uint32_t opcode;
+			LOAD_32(opcode, (address + i * WORD_SIZE_ARM) & cpu->memory.activeMask, cpu->memory.activeRegion);
+			entry->opcode = opcode;
+			entry->condition = opcode >> 28;
+			entry->arm = _armTable[ARM_HANDLER_INDEX(opcode)];
+			if (_ARMBlockTerminates(opcode)) {
+				++i;
+				break;
+			}
+		} else {
+			uint16_t opcode;
+			LOAD_16(opcode, (address + i * WORD_SIZE_THUMB) & cpu->memory.activeMask, cpu->memory.activeRegion);
+			entry->opcode = opcode;
+			entry->condition = 0xE;
+			entry->thumb = _thumbTable[THUMB_HANDLER_INDEX(opcode)];
+			if (_ThumbBlockTerminates(opcode)) {
+				++i;
+				break;
+			}
+		}
+	}
+	block->length = i;
+	return block;
+}
+
+static void ARMRunBlock(struct ARMCore* cpu) {
+	uint32_t address = cpu->gprs[ARM_PC] - WORD_SIZE_ARM;
+	struct ARMBlock* block = _ARMBlockLookup(cpu, address, MODE_ARM);
+	const struct ARMBlockEntry* entry = block->entries;
+	const struct ARMBlockEntry* end = &block->entries[block->length];
+	for (; entry != end; ++entry) {
+		uint32_t opcode = cpu->prefetch[0];
+		if (opcode != entry->opcode) {
+			// Memory was written or the pipeline was replaced since this block was decoded
+			block->length = 0;
+			ARMStep(cpu);
+			return;
+		}
+		COUNT_INSTRUCTION(MODE_ARM);
+		cpu->prefetch[0] = cpu->prefetch[1];
+		cpu->gprs[ARM_PC] += WORD_SIZE_ARM;
+		LOAD_32(cpu->prefetch[1], cpu->gprs[ARM_PC] & cpu->memory.activeMask, cpu->memory.activeRegion);
+
+		if (entry->condition == 0xE || _ARMConditionMet(cpu, entry->condition)) {
+			COUNT_HANDLER(MODE_ARM, ARM_HANDLER_INDEX(opcode));
+			entry->arm(cpu, opcode);
+		} else {
+			COUNT_CONDITION_FAILED;
+			cpu->cycles += ARM_PREFETCH_CYCLES;
+		}
+		address += WORD_SIZE_ARM;
+		if (cpu->gprs[ARM_PC] != (int32_t) (address + WORD_SIZE_ARM) || cpu->cycles >= cpu->nextEvent) {
+			return;
+		}
+	}
+}
+
+static void ThumbRunBlock(struct ARMCore* cpu) {
+	uint32_t address = cpu->gprs[ARM_PC] - WORD_SIZE_THUMB;
+	struct ARMBlock* block = _ARMBlockLookup(cpu, address, MODE_THUMB);
+	const struct ARMBlockEntry* entry = block->entries;
+	const struct ARMBlockEntry* end = &block->entries[block->length];
+	for (; entry != end; ++entry) {
+		uint32_t opcode = cpu->prefetch[0];
+		if (opcode != entry->opcode) {
+			block->length = 0;
+			ThumbStep(cpu);
+			return;
+		}
+		COUNT_INSTRUCTION(MODE_THUMB);
+		cpu->prefetch[0] = cpu->prefetch[1];
+		cpu->gprs[ARM_PC] += WORD_SIZE_THUMB;
+		LOAD_16(cpu->prefetch[1], cpu->gprs[ARM_PC] & cpu->memory.activeMask, cpu->memory.activeRegion);
+		COUNT_HANDLER(MODE_THUMB, THUMB_HANDLER_INDEX(opcode));
+		entry->thumb(cpu, opcode);
+		address += WORD_SIZE_THUMB;
+		if (cpu->gprs[ARM_PC] != (int32_t) (address + WORD_SIZE_THUMB) || cpu->cycles >= cpu->nextEvent) {
+			return;
+		}
+	}
+}
+
 void ARMRunLoop(struct ARMCore* cpu) {
-	if (cpu->executionMode == MODE_THUMB) {
+	if (cpu->blockCache) {
+		while (cpu->cycles < cpu->nextEvent) {
+			if (cpu->executionMode == MODE_THUMB) {
+				ThumbRunBlock(cpu);
+			} else {
+				ARMRunBlock(cpu);
+			}
+		}
+	} else if (cpu->executionMode == MODE_THUMB) {
 		while (cpu->cycles < cpu->nextEvent) {
 			ThumbStep(cpu);
 		}
@@ -308,3 +465,25 @@ void ARMRunFake(struct ARMCore* cpu, uint32_t opcode) {
 	cpu->prefetch[1] = cpu->prefetch[0];
 	cpu->prefetch[0] = opcode;
 }
+
+void ARMSetBlockCache(struct ARMCore* cpu, bool enable) {
+	if (enable == !!cpu->blockCache) {
+		return;
+	}
+	if (enable) {
+		cpu->blockCache = anonymousMemoryMap(sizeof(struct ARMBlockCache));
+	} else {
+		mappedMemoryFree(cpu->blockCache, sizeof(struct ARMBlockCache));
+		cpu->blockCache = NULL;
+	}
+}
+
+void ARMBlockCacheInvalidate(struct ARMCore* cpu) {
+	if (!cpu->blockCache) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < ARM_BLOCK_CACHE_SIZE; ++i) {
+		cpu->blockCache->blocks[i].length = 0;
+	}
+}
@@ -11,6 +11,9 @@
 #include <mgba/internal/arm/isa-inlines.h>
 #include <mgba/internal/arm/debugger/memory-debugger.h>
 #include <mgba/internal/debugger/parser.h>
+#include <mgba/internal/debugger/trace.h>
+
+#define BREAKPOINT_TABLE_SIZE 512
 
 DEFINE_VECTOR(ARMDebugBreakpointList, struct ARMDebugBreakpoint);
 
@@ -24,6 +27,25 @@ static struct ARMDebugBreakpoint* _lookupBreakpoint(struct ARMDebugBreakpointLis
 	return 0;
 }
 
+static inline uint32_t _breakpointKey(uint32_t address) {
+	// Rotate the alignment bits out of the bottom so the table's buckets all get used
+	return (address >> 2) | (address << 30);
+}
+
+static void _addBreakpointAddress(struct Table* addresses, uint32_t address) {
+	intptr_t count = (intptr_t) TableLookup(addresses, _breakpointKey(address));
+	TableInsert(addresses, _breakpointKey(address), (void*) (count + 1));
+}
+
+static void _removeBreakpointAddress(struct Table* addresses, uint32_t address) {
+	intptr_t count = (intptr_t) TableLookup(addresses, _breakpointKey(address));
+	if (count > 1) {
+		TableInsert(addresses, _breakpointKey(address), (void*) (count - 1));
+	} else {
+		TableRemove(addresses, _breakpointKey(address));
+	}
+}
+
 static void _destroyBreakpoint(struct ARMDebugBreakpoint* breakpoint) {
 	if (breakpoint->d.condition) {
 		parseFree(breakpoint->d.condition);
@@ -47,22 +69,30 @@ static void ARMDebuggerCheckBreakpoints(struct mDebuggerPlatform* d) {
 	} else {
 		instructionLength = WORD_SIZE_THUMB;
 	}
-	struct ARMDebugBreakpoint* breakpoint = _lookupBreakpoint(&debugger->breakpoints, debugger->cpu->gprs[ARM_PC] - instructionLength);
-	if (!breakpoint) {
+	uint32_t address = debugger->cpu->gprs[ARM_PC] - instructionLength;
+	if (!TableLookup(&debugger->breakpointAddresses, _breakpointKey(address))) {
 		return;
 	}
-	if (breakpoint->d.condition) {
-		int32_t value;
-		int segment;
-		if (!mDebuggerEvaluateParseTree(d->p, breakpoint->d.condition, &value, &segment) || !(value || segment >= 0)) {
-			return;
+	size_t i;
+	for (i = 0; i < ARMDebugBreakpointListSize(&debugger->breakpoints); ++i) {
+		struct ARMDebugBreakpoint* breakpoint = ARMDebugBreakpointListGetPointer(&debugger->breakpoints, i);
+		if (breakpoint->d.address != address) {
+			continue;
+		}
+		if (breakpoint->d.condition) {
+			int32_t value;
+			int segment;
+			if (!mDebuggerEvaluateParseTree(d->p, breakpoint->d.condition, &value, &segment) || !(value || segment >= 0)) {
+				continue;
+			}
 		}
+		struct mDebuggerEntryInfo info = {
+			.address = breakpoint->d.address,
+			.type.bp.breakType = BREAKPOINT_HARDWARE
+		};
+		mDebuggerEnter(d->p, DEBUGGER_ENTER_BREAKPOINT, &info);
+		return;
 	}
-	struct mDebuggerEntryInfo info = {
-		.address = breakpoint->d.address,
-		.type.bp.breakType = BREAKPOINT_HARDWARE
-	};
-	mDebuggerEnter(d->p, DEBUGGER_ENTER_BREAKPOINT, &info);
 }
 
 static void ARMDebuggerInit(void* cpu, struct mDebuggerPlatform* platform);
@@ -78,6 +108,9 @@ static void ARMDebuggerListWatchpoints(struct mDebuggerPlatform*, struct mWatchp
 static void ARMDebuggerCheckBreakpoints(struct mDebuggerPlatform*);
 static bool ARMDebuggerHasBreakpoints(struct mDebuggerPlatform*);
 static void ARMDebuggerTrace(struct mDebuggerPlatform*, char* out, size_t* length);
+static void ARMDebuggerTraceInstruction(struct mDebuggerPlatform*, struct mDebuggerTraceRecord* out);
+static void ARMDebuggerTraceAccesses(struct mDebuggerPlatform*, bool enable);
+static bool ARMDebuggerGetCallFrame(struct mDebuggerPlatform*, uint32_t* pc, int* segment, uint32_t* returnAddress);
 static bool ARMDebuggerGetRegister(struct mDebuggerPlatform*, const char* name, int32_t* value);
 static bool ARMDebuggerSetRegister(struct mDebuggerPlatform*, const char* name, int32_t value);
 
@@ -94,6 +127,9 @@ struct mDebuggerPlatform* ARMDebuggerPlatformCreate(void) {
 	platform->checkBreakpoints = ARMDebuggerCheckBreakpoints;
 	platform->hasBreakpoints = ARMDebuggerHasBreakpoints;
 	platform->trace = ARMDebuggerTrace;
+	platform->traceInstruction = ARMDebuggerTraceInstruction;
+	platform->traceAccesses = ARMDebuggerTraceAccesses;
+	platform->getCallFrame = ARMDebuggerGetCallFrame;
 	platform->getRegister = ARMDebuggerGetRegister;
 	platform->setRegister = ARMDebuggerSetRegister;
 	return platform;
@@ -106,7 +142,10 @@ void ARMDebuggerInit(void* cpu, struct mDebuggerPlatform* platform) {
 	debugger->nextId = 1;
 	ARMDebugBreakpointListInit(&debugger->breakpoints, 0);
 	ARMDebugBreakpointListInit(&debugger->swBreakpoints, 0);
+	TableInit(&debugger->breakpointAddresses, BREAKPOINT_TABLE_SIZE, NULL);
 	mWatchpointListInit(&debugger->watchpoints, 0);
+	debugger->watchpointPages = NULL;
+	debugger->tracingAccesses = false;
 }
 
 void ARMDebuggerDeinit(struct mDebuggerPlatform* platform) {
@@ -126,6 +165,7 @@ void ARMDebuggerDeinit(struct mDebuggerPlatform* platform) {
 		_destroyBreakpoint(ARMDebugBreakpointListGetPointer(&debugger->breakpoints, i));
 	}
 	ARMDebugBreakpointListDeinit(&debugger->breakpoints);
+	TableDeinit(&debugger->breakpointAddresses);
 
 	for (i = 0; i < mWatchpointListSize(&debugger->watchpoints); ++i) {
 		_destroyWatchpoint(mWatchpointListGetPointer(&debugger->watchpoints, i));
@@ -190,6 +230,7 @@ static ssize_t ARMDebuggerSetBreakpoint(struct mDebuggerPlatform* d, const struc
 		// TODO
 		abort();
 	}
+	_addBreakpointAddress(&debugger->breakpointAddresses, info->address);
 	return id;
 }
 
@@ -200,6 +241,7 @@ static bool ARMDebuggerClearBreakpoint(struct mDebuggerPlatform* d, ssize_t id)
 	struct ARMDebugBreakpointList* breakpoints = &debugger->breakpoints;
 	for (i = 0; i < ARMDebugBreakpointListSize(breakpoints); ++i) {
 		if (ARMDebugBreakpointListGetPointer(breakpoints, i)->d.id == id) {
+			_removeBreakpointAddress(&debugger->breakpointAddresses, ARMDebugBreakpointListGetPointer(breakpoints, i)->d.address);
 			_destroyBreakpoint(ARMDebugBreakpointListGetPointer(breakpoints, i));
 			ARMDebugBreakpointListShift(breakpoints, i, 1);
 			return true;
@@ -222,8 +264,10 @@ static bool ARMDebuggerClearBreakpoint(struct mDebuggerPlatform* d, ssize_t id)
 		if (mWatchpointListGetPointer(watchpoints, i)->id == id) {
 			_destroyWatchpoint(mWatchpointListGetPointer(watchpoints, i));
 			mWatchpointListShift(watchpoints, i, 1);
-			if (!mWatchpointListSize(&debugger->watchpoints)) {
+			if (!mWatchpointListSize(&debugger->watchpoints) && !debugger->tracingAccesses) {
 				ARMDebuggerRemoveMemoryShim(debugger);
+			} else {
+				ARMDebuggerUpdateWatchpointPages(debugger);
 			}
 			return true;
 		}
@@ -272,7 +316,7 @@ static bool ARMDebuggerHasBreakpoints(struct mDebuggerPlatform* d) {
 
 static ssize_t ARMDebuggerSetWatchpoint(struct mDebuggerPlatform* d, const struct mWatchpoint* info) {
 	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
-	if (!mWatchpointListSize(&debugger->watchpoints)) {
+	if (!mWatchpointListSize(&debugger->watchpoints) && !debugger->tracingAccesses) {
 		ARMDebuggerInstallMemoryShim(debugger);
 	}
 	struct mWatchpoint* watchpoint = mWatchpointListAppend(&debugger->watchpoints);
@@ -280,6 +324,14 @@ static ssize_t ARMDebuggerSetWatchpoint(struct mDebuggerPlatform* d, const struc
 	++debugger->nextId;
 	*watchpoint = *info;
 	watchpoint->id = id;
+	if (!watchpoint->size) {
+		watchpoint->size = 1;
+	}
+	if (watchpoint->address + watchpoint->size - 1 < watchpoint->address) {
+		// Clamp ranges that would wrap around to the end of the address space
+		watchpoint->size = -watchpoint->address;
+	}
+	ARMDebuggerUpdateWatchpointPages(debugger);
 	return id;
 }
 
@@ -325,6 +377,50 @@ static void ARMDebuggerTrace(struct mDebuggerPlatform* d, char* out, size_t* len
 		               cpu->cpsr.packed, disassembly);
 }
 
+static void ARMDebuggerTraceInstruction(struct mDebuggerPlatform* d, struct mDebuggerTraceRecord* out) {
+	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
+	struct ARMCore* cpu = debugger->cpu;
+
+	out->type = TRACE_INSTRUCTION;
+	out->segment = -1;
+	out->state = cpu->cpsr.packed;
+	if (cpu->executionMode == MODE_ARM) {
+		out->width = WORD_SIZE_ARM;
+		out->address = cpu->gprs[ARM_PC] - WORD_SIZE_ARM;
+		out->value = cpu->prefetch[0];
+	} else {
+		out->width = WORD_SIZE_THUMB;
+		out->address = cpu->gprs[ARM_PC] - WORD_SIZE_THUMB;
+		out->value = (cpu->prefetch[0] & 0xFFFF) | (cpu->prefetch[1] << 16);
+	}
+}
+
+static void ARMDebuggerTraceAccesses(struct mDebuggerPlatform* d, bool enable) {
+	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
+	if (enable == debugger->tracingAccesses) {
+		return;
+	}
+	debugger->tracingAccesses = enable;
+	if (mWatchpointListSize(&debugger->watchpoints)) {
+		return;
+	}
+	if (enable) {
+		ARMDebuggerInstallMemoryShim(debugger);
+	} else {
+		ARMDebuggerRemoveMemoryShim(debugger);
+	}
+}
+
+static bool ARMDebuggerGetCallFrame(struct mDebuggerPlatform* d, uint32_t* pc, int* segment, uint32_t* returnAddress) {
+	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
+	struct ARMCore* cpu = debugger->cpu;
+
+	*pc = cpu->gprs[ARM_PC] - (cpu->executionMode == MODE_ARM ? WORD_SIZE_ARM : WORD_SIZE_THUMB);
+	*segment = -1;
+	*returnAddress = cpu->gprs[ARM_LR];
+	return true;
+}
+
 bool ARMDebuggerGetRegister(struct mDebuggerPlatform* d, const char* name, int32_t* value) {
 	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
 	struct ARMCore* cpu = debugger->cpu;
@@ -7,13 +7,28 @@
 
 #include <mgba/internal/arm/debugger/debugger.h>
 #include <mgba/internal/debugger/parser.h>
+#include <mgba/internal/debugger/trace.h>
 
 #include <mgba-util/math.h>
 
 #include <string.h>
 
+#define WATCHPOINT_PAGE_SHIFT 12
+#define WATCHPOINT_PAGES (1 << (32 - WATCHPOINT_PAGE_SHIFT))
+
 static bool _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, struct mDebuggerEntryInfo* info, enum mWatchpointType type, uint32_t newValue, int width);
 
+static void _traceMultiple(struct ARMDebugger* debugger, enum mDebuggerTraceRecordType type, uint32_t base, int mask) {
+	// Registers are transferred in ascending order, so the register values are the data
+	int reg;
+	for (reg = 0; reg <= ARM_PC; ++reg) {
+		if (mask & (1 << reg)) {
+			mDebuggerTraceAccess(debugger->d.p->trace, type, base, debugger->cpu->gprs[reg], 4, -1);
+			base += 4;
+		}
+	}
+}
+
 #define FIND_DEBUGGER(DEBUGGER, CPU) \
 	do { \
 		DEBUGGER = 0; \
@@ -43,7 +58,11 @@ static bool _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, st
 		if (_checkWatchpoints(debugger, address, &info, WATCHPOINT_READ, 0, WIDTH)) { \
 			mDebuggerEnter(debugger->d.p, DEBUGGER_ENTER_WATCHPOINT, &info); \
 		} \
-		return debugger->originalMemory.NAME(cpu, __VA_ARGS__); \
+		RETURN value = debugger->originalMemory.NAME(cpu, __VA_ARGS__); \
+		if (debugger->d.p->trace) { \
+			mDebuggerTraceAccess(debugger->d.p->trace, TRACE_READ, address, value, WIDTH, -1); \
+		} \
+		return value; \
 	}
 
 #define CREATE_WATCHPOINT_WRITE_SHIM(NAME, WIDTH, RETURN, TYPES, ...) \
@@ -54,6 +73,9 @@ static bool _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, st
 		if (_checkWatchpoints(debugger, address, &info, WATCHPOINT_WRITE, value, WIDTH)) { \
 			mDebuggerEnter(debugger->d.p, DEBUGGER_ENTER_WATCHPOINT, &info); \
 		} \
+		if (debugger->d.p->trace) { \
+			mDebuggerTraceAccess(debugger->d.p->trace, TRACE_WRITE, address, value, WIDTH, -1); \
+		} \
 		return debugger->originalMemory.NAME(cpu, __VA_ARGS__); \
 	}
 
@@ -78,7 +100,14 @@ static bool _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, st
 				mDebuggerEnter(debugger->d.p, DEBUGGER_ENTER_WATCHPOINT, &info); \
 			} \
 		} \
-		return debugger->originalMemory.NAME(cpu, address, mask, direction, cycleCounter); \
+		if (ACCESS_TYPE == WATCHPOINT_WRITE && debugger->d.p->trace) { \
+			_traceMultiple(debugger, TRACE_WRITE, base, mask); \
+		} \
+		uint32_t value = debugger->originalMemory.NAME(cpu, address, mask, direction, cycleCounter); \
+		if (ACCESS_TYPE == WATCHPOINT_READ && debugger->d.p->trace) { \
+			_traceMultiple(debugger, TRACE_READ, base, mask); \
+		} \
+		return value; \
 	}
 
 CREATE_WATCHPOINT_READ_SHIM(load32, 4, uint32_t, (struct ARMCore* cpu, uint32_t address, int* cycleCounter), address, cycleCounter)
@@ -93,16 +122,22 @@ CREATE_SHIM(setActiveRegion, void, (struct ARMCore* cpu, uint32_t address), addr
 
 static bool _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, struct mDebuggerEntryInfo* info, enum mWatchpointType type, uint32_t newValue, int width) {
 	--width;
+	uint32_t start = address & ~width;
+	uint32_t page = start >> WATCHPOINT_PAGE_SHIFT;
+	if (!(debugger->watchpointPages[page >> 5] & (1U << (page & 31)))) {
+		return false;
+	}
+	uint32_t end = start + width;
 	struct mWatchpoint* watchpoint;
 	size_t i;
 	for (i = 0; i < mWatchpointListSize(&debugger->watchpoints); ++i) {
 		watchpoint = mWatchpointListGetPointer(&debugger->watchpoints, i);
-		if (!((watchpoint->address ^ address) & ~width) && watchpoint->type & type) {
+		if (end >= watchpoint->address && start <= watchpoint->address + watchpoint->size - 1 && watchpoint->type & type) {
 			if (watchpoint->condition) {
 				int32_t value;
 				int segment;
 				if (!mDebuggerEvaluateParseTree(debugger->d.p, watchpoint->condition, &value, &segment) || !(value || segment >= 0)) {
-					return false;
+					continue;
 				}
 			}
 
@@ -128,6 +163,9 @@ static bool _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, st
 }
 
 void ARMDebuggerInstallMemoryShim(struct ARMDebugger* debugger) {
+	if (!debugger->watchpointPages) {
+		debugger->watchpointPages = calloc(WATCHPOINT_PAGES / 32, sizeof(*debugger->watchpointPages));
+	}
 	debugger->originalMemory = debugger->cpu->memory;
 	debugger->cpu->memory.store32 = DebuggerShim_store32;
 	debugger->cpu->memory.store16 = DebuggerShim_store16;
@@ -150,4 +188,26 @@ void ARMDebuggerRemoveMemoryShim(struct ARMDebugger* debugger) {
 	debugger->cpu->memory.storeMultiple = debugger->originalMemory.storeMultiple;
 	debugger->cpu->memory.loadMultiple = debugger->originalMemory.loadMultiple;
 	debugger->cpu->memory.setActiveRegion = debugger->originalMemory.setActiveRegion;
+	free(debugger->watchpointPages);
+	debugger->watchpointPages = NULL;
+}
+
+void ARMDebuggerUpdateWatchpointPages(struct ARMDebugger* debugger) {
+	if (!debugger->watchpointPages) {
+		return;
+	}
+	memset(debugger->watchpointPages, 0, WATCHPOINT_PAGES / 8);
+	size_t i;
+	for (i = 0; i < mWatchpointListSize(&debugger->watchpoints); ++i) {
+		struct mWatchpoint* watchpoint = mWatchpointListGetPointer(&debugger->watchpoints, i);
+		uint32_t page = watchpoint->address >> WATCHPOINT_PAGE_SHIFT;
+		uint32_t lastPage = (watchpoint->address + watchpoint->size - 1) >> WATCHPOINT_PAGE_SHIFT;
+		while (true) {
+			debugger->watchpointPages[page >> 5] |= 1U << (page & 31);
+			if (page == lastPage) {
+				break;
+			}
+			++page;
+		}
+	}
 }
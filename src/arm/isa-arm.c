@@ -14,7 +14,14 @@
 #define PSR_STATE_MASK  0x00000020
 
 // Addressing mode 1
-static inline void _shiftLSL(struct ARMCore* cpu, uint32_t opcode) {
+// Only the logical operations with S set consume the carry out, so the others skip computing it
+
+#define ARM_SHIFTER_CARRY_OUT(C) \
+	if (carry) { \
+		cpu->shifterCarryOut = C; \
+	}
+
+static inline void _shiftLSL(struct ARMCore* cpu, uint32_t opcode, bool carry) {
 	int rm = opcode & 0x0000000F;
 	if (opcode & 0x00000010) {
 		int rs = (opcode >> 8) & 0x0000000F;
@@ -30,30 +37,30 @@ static inline void _shiftLSL(struct ARMCore* cpu, uint32_t opcode) {
 		}
 		if (!shift) {
 			cpu->shifterOperand = shiftVal;
-			cpu->shifterCarryOut = cpu->cpsr.c;
+			ARM_SHIFTER_CARRY_OUT(cpu->cpsr.c);
 		} else if (shift < 32) {
 			cpu->shifterOperand = shiftVal << shift;
-			cpu->shifterCarryOut = (shiftVal >> (32 - shift)) & 1;
+			ARM_SHIFTER_CARRY_OUT((shiftVal >> (32 - shift)) & 1);
 		} else if (shift == 32) {
 			cpu->shifterOperand = 0;
-			cpu->shifterCarryOut = shiftVal & 1;
+			ARM_SHIFTER_CARRY_OUT(shiftVal & 1);
 		} else {
 			cpu->shifterOperand = 0;
-			cpu->shifterCarryOut = 0;
+			ARM_SHIFTER_CARRY_OUT(0);
 		}
 	} else {
 		int immediate = (opcode & 0x00000F80) >> 7;
 		if (!immediate) {
 			cpu->shifterOperand = cpu->gprs[rm];
-			cpu->shifterCarryOut = cpu->cpsr.c;
+			ARM_SHIFTER_CARRY_OUT(cpu->cpsr.c);
 		} else {
 			cpu->shifterOperand = cpu->gprs[rm] << immediate;
-			cpu->shifterCarryOut = (cpu->gprs[rm] >> (32 - immediate)) & 1;
+			ARM_SHIFTER_CARRY_OUT((cpu->gprs[rm] >> (32 - immediate)) & 1);
 		}
 	}
 }
 
-static inline void _shiftLSR(struct ARMCore* cpu, uint32_t opcode) {
+static inline void _shiftLSR(struct ARMCore* cpu, uint32_t opcode, bool carry) {
 	int rm = opcode & 0x0000000F;
 	if (opcode & 0x00000010) {
 		int rs = (opcode >> 8) & 0x0000000F;
@@ -69,30 +76,30 @@ static inline void _shiftLSR(struct ARMCore* cpu, uint32_t opcode) {
 		}
 		if (!shift) {
 			cpu->shifterOperand = shiftVal;
-			cpu->shifterCarryOut = cpu->cpsr.c;
+			ARM_SHIFTER_CARRY_OUT(cpu->cpsr.c);
 		} else if (shift < 32) {
 			cpu->shifterOperand = shiftVal >> shift;
-			cpu->shifterCarryOut = (shiftVal >> (shift - 1)) & 1;
+			ARM_SHIFTER_CARRY_OUT((shiftVal >> (shift - 1)) & 1);
 		} else if (shift == 32) {
 			cpu->shifterOperand = 0;
-			cpu->shifterCarryOut = shiftVal >> 31;
+			ARM_SHIFTER_CARRY_OUT(shiftVal >> 31);
 		} else {
 			cpu->shifterOperand = 0;
-			cpu->shifterCarryOut = 0;
+			ARM_SHIFTER_CARRY_OUT(0);
 		}
 	} else {
 		int immediate = (opcode & 0x00000F80) >> 7;
 		if (immediate) {
 			cpu->shifterOperand = ((uint32_t) cpu->gprs[rm]) >> immediate;
-			cpu->shifterCarryOut = (cpu->gprs[rm] >> (immediate - 1)) & 1;
+			ARM_SHIFTER_CARRY_OUT((cpu->gprs[rm] >> (immediate - 1)) & 1);
 		} else {
 			cpu->shifterOperand = 0;
-			cpu->shifterCarryOut = ARM_SIGN(cpu->gprs[rm]);
+			ARM_SHIFTER_CARRY_OUT(ARM_SIGN(cpu->gprs[rm]));
 		}
 	}
 }
 
-static inline void _shiftASR(struct ARMCore* cpu, uint32_t opcode) {
+static inline void _shiftASR(struct ARMCore* cpu, uint32_t opcode, bool carry) {
 	int rm = opcode & 0x0000000F;
 	if (opcode & 0x00000010) {
 		int rs = (opcode >> 8) & 0x0000000F;
@@ -108,30 +115,30 @@ static inline void _shiftASR(struct ARMCore* cpu, uint32_t opcode) {
 		}
 		if (!shift) {
 			cpu->shifterOperand = shiftVal;
-			cpu->shifterCarryOut = cpu->cpsr.c;
+			ARM_SHIFTER_CARRY_OUT(cpu->cpsr.c);
 		} else if (shift < 32) {
 			cpu->shifterOperand = shiftVal >> shift;
-			cpu->shifterCarryOut = (shiftVal >> (shift - 1)) & 1;
+			ARM_SHIFTER_CARRY_OUT((shiftVal >> (shift - 1)) & 1);
 		} else if (cpu->gprs[rm] >> 31) {
 			cpu->shifterOperand = 0xFFFFFFFF;
-			cpu->shifterCarryOut = 1;
+			ARM_SHIFTER_CARRY_OUT(1);
 		} else {
 			cpu->shifterOperand = 0;
-			cpu->shifterCarryOut = 0;
+			ARM_SHIFTER_CARRY_OUT(0);
 		}
 	} else {
 		int immediate = (opcode & 0x00000F80) >> 7;
 		if (immediate) {
 			cpu->shifterOperand = cpu->gprs[rm] >> immediate;
-			cpu->shifterCarryOut = (cpu->gprs[rm] >> (immediate - 1)) & 1;
+			ARM_SHIFTER_CARRY_OUT((cpu->gprs[rm] >> (immediate - 1)) & 1);
 		} else {
-			cpu->shifterCarryOut = ARM_SIGN(cpu->gprs[rm]);
-			cpu->shifterOperand = cpu->shifterCarryOut;
+			cpu->shifterOperand = ARM_SIGN(cpu->gprs[rm]);
+			ARM_SHIFTER_CARRY_OUT(cpu->shifterOperand);
 		}
 	}
 }
 
-static inline void _shiftROR(struct ARMCore* cpu, uint32_t opcode) {
+static inline void _shiftROR(struct ARMCore* cpu, uint32_t opcode, bool carry) {
 	int rm = opcode & 0x0000000F;
 	if (opcode & 0x00000010) {
 		int rs = (opcode >> 8) & 0x0000000F;
@@ -148,36 +155,36 @@ static inline void _shiftROR(struct ARMCore* cpu, uint32_t opcode) {
 		int rotate = shift & 0x1F;
 		if (!shift) {
 			cpu->shifterOperand = shiftVal;
-			cpu->shifterCarryOut = cpu->cpsr.c;
+			ARM_SHIFTER_CARRY_OUT(cpu->cpsr.c);
 		} else if (rotate) {
 			cpu->shifterOperand = ROR(shiftVal, rotate);
-			cpu->shifterCarryOut = (shiftVal >> (rotate - 1)) & 1;
+			ARM_SHIFTER_CARRY_OUT((shiftVal >> (rotate - 1)) & 1);
 		} else {
 			cpu->shifterOperand = shiftVal;
-			cpu->shifterCarryOut = ARM_SIGN(shiftVal);
+			ARM_SHIFTER_CARRY_OUT(ARM_SIGN(shiftVal));
 		}
 	} else {
 		int immediate = (opcode & 0x00000F80) >> 7;
 		if (immediate) {
 			cpu->shifterOperand = ROR(cpu->gprs[rm], immediate);
-			cpu->shifterCarryOut = (cpu->gprs[rm] >> (immediate - 1)) & 1;
+			ARM_SHIFTER_CARRY_OUT((cpu->gprs[rm] >> (immediate - 1)) & 1);
 		} else {
 			// RRX
 			cpu->shifterOperand = (cpu->cpsr.c << 31) | (((uint32_t) cpu->gprs[rm]) >> 1);
-			cpu->shifterCarryOut = cpu->gprs[rm] & 0x00000001;
+			ARM_SHIFTER_CARRY_OUT(cpu->gprs[rm] & 0x00000001);
 		}
 	}
 }
 
-static inline void _immediate(struct ARMCore* cpu, uint32_t opcode) {
+static inline void _immediate(struct ARMCore* cpu, uint32_t opcode, bool carry) {
 	int rotate = (opcode & 0x00000F00) >> 7;
 	int immediate = opcode & 0x000000FF;
 	if (!rotate) {
 		cpu->shifterOperand = immediate;
-		cpu->shifterCarryOut = cpu->cpsr.c;
+		ARM_SHIFTER_CARRY_OUT(cpu->cpsr.c);
 	} else {
 		cpu->shifterOperand = ROR(immediate, rotate);
-		cpu->shifterCarryOut = ARM_SIGN(cpu->shifterOperand);
+		ARM_SHIFTER_CARRY_OUT(ARM_SIGN(cpu->shifterOperand));
 	}
 }
 
@@ -293,12 +300,12 @@ ATTRIBUTE_NOINLINE static void _neutralS(struct ARMCore* cpu, int32_t d) {
 		cpu->cycles += currentCycles; \
 	}
 
-#define DEFINE_ALU_INSTRUCTION_EX_ARM(NAME, S_BODY, SHIFTER, BODY) \
+#define DEFINE_ALU_INSTRUCTION_EX_ARM(NAME, S_BODY, SHIFTER, CARRY, BODY) \
 	DEFINE_INSTRUCTION_ARM(NAME, \
 		int rd = (opcode >> 12) & 0xF; \
 		int rn = (opcode >> 16) & 0xF; \
 		UNUSED(rn); \
-		SHIFTER(cpu, opcode); \
+		SHIFTER(cpu, opcode, CARRY); \
 		BODY; \
 		S_BODY; \
 		if (rd == ARM_PC) { \
@@ -309,24 +316,36 @@ ATTRIBUTE_NOINLINE static void _neutralS(struct ARMCore* cpu, int32_t d) {
 			} \
 		})
 
+#define DEFINE_ALU_INSTRUCTION_CARRY_ARM(NAME, S_CARRY, S_BODY, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSL, , _shiftLSL, false, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSL, S_BODY, _shiftLSL, S_CARRY, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSR, , _shiftLSR, false, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSR, S_BODY, _shiftLSR, S_CARRY, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ASR, , _shiftASR, false, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_ASR, S_BODY, _shiftASR, S_CARRY, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ROR, , _shiftROR, false, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_ROR, S_BODY, _shiftROR, S_CARRY, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## I, , _immediate, false, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## SI, S_BODY, _immediate, S_CARRY, BODY)
+
+#define DEFINE_ALU_INSTRUCTION_S_ONLY_CARRY_ARM(NAME, S_CARRY, S_BODY, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSL, S_BODY, _shiftLSL, S_CARRY, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSR, S_BODY, _shiftLSR, S_CARRY, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ASR, S_BODY, _shiftASR, S_CARRY, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ROR, S_BODY, _shiftROR, S_CARRY, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## I, S_BODY, _immediate, S_CARRY, BODY)
+
 #define DEFINE_ALU_INSTRUCTION_ARM(NAME, S_BODY, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSL, , _shiftLSL, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSL, S_BODY, _shiftLSL, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSR, , _shiftLSR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSR, S_BODY, _shiftLSR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ASR, , _shiftASR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_ASR, S_BODY, _shiftASR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ROR, , _shiftROR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_ROR, S_BODY, _shiftROR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## I, , _immediate, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## SI, S_BODY, _immediate, BODY)
+	DEFINE_ALU_INSTRUCTION_CARRY_ARM(NAME, false, S_BODY, BODY)
 
 #define DEFINE_ALU_INSTRUCTION_S_ONLY_ARM(NAME, S_BODY, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSL, S_BODY, _shiftLSL, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSR, S_BODY, _shiftLSR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ASR, S_BODY, _shiftASR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ROR, S_BODY, _shiftROR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## I, S_BODY, _immediate, BODY)
+	DEFINE_ALU_INSTRUCTION_S_ONLY_CARRY_ARM(NAME, false, S_BODY, BODY)
+
+#define DEFINE_LOGICAL_INSTRUCTION_ARM(NAME, S_BODY, BODY) \
+	DEFINE_ALU_INSTRUCTION_CARRY_ARM(NAME, true, S_BODY, BODY)
+
+#define DEFINE_LOGICAL_INSTRUCTION_S_ONLY_ARM(NAME, S_BODY, BODY) \
+	DEFINE_ALU_INSTRUCTION_S_ONLY_CARRY_ARM(NAME, true, S_BODY, BODY)
 
 #define DEFINE_MULTIPLY_INSTRUCTION_EX_ARM(NAME, BODY, S_BODY) \
 	DEFINE_INSTRUCTION_ARM(NAME, \
@@ -466,10 +485,10 @@ DEFINE_ALU_INSTRUCTION_ARM(ADC, ARM_ADDITION_S(n, cpu->shifterOperand, cpu->gprs
 	int32_t n = cpu->gprs[rn];
 	cpu->gprs[rd] = n + cpu->shifterOperand + cpu->cpsr.c;)
 
-DEFINE_ALU_INSTRUCTION_ARM(AND, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
+DEFINE_LOGICAL_INSTRUCTION_ARM(AND, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
 	cpu->gprs[rd] = cpu->gprs[rn] & cpu->shifterOperand;)
 
-DEFINE_ALU_INSTRUCTION_ARM(BIC, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
+DEFINE_LOGICAL_INSTRUCTION_ARM(BIC, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
 	cpu->gprs[rd] = cpu->gprs[rn] & ~cpu->shifterOperand;)
 
 DEFINE_ALU_INSTRUCTION_S_ONLY_ARM(CMN, ARM_ADDITION_S(cpu->gprs[rn], cpu->shifterOperand, aluOut),
@@ -478,16 +497,16 @@ DEFINE_ALU_INSTRUCTION_S_ONLY_ARM(CMN, ARM_ADDITION_S(cpu->gprs[rn], cpu->shifte
 DEFINE_ALU_INSTRUCTION_S_ONLY_ARM(CMP, ARM_SUBTRACTION_S(cpu->gprs[rn], cpu->shifterOperand, aluOut),
 	int32_t aluOut = cpu->gprs[rn] - cpu->shifterOperand;)
 
-DEFINE_ALU_INSTRUCTION_ARM(EOR, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
+DEFINE_LOGICAL_INSTRUCTION_ARM(EOR, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
 	cpu->gprs[rd] = cpu->gprs[rn] ^ cpu->shifterOperand;)
 
-DEFINE_ALU_INSTRUCTION_ARM(MOV, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
+DEFINE_LOGICAL_INSTRUCTION_ARM(MOV, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
 	cpu->gprs[rd] = cpu->shifterOperand;)
 
-DEFINE_ALU_INSTRUCTION_ARM(MVN, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
+DEFINE_LOGICAL_INSTRUCTION_ARM(MVN, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
 	cpu->gprs[rd] = ~cpu->shifterOperand;)
 
-DEFINE_ALU_INSTRUCTION_ARM(ORR, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
+DEFINE_LOGICAL_INSTRUCTION_ARM(ORR, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, cpu->gprs[rd]),
 	cpu->gprs[rd] = cpu->gprs[rn] | cpu->shifterOperand;)
 
 DEFINE_ALU_INSTRUCTION_ARM(RSB, ARM_SUBTRACTION_S(cpu->shifterOperand, n, cpu->gprs[rd]),
@@ -506,10 +525,10 @@ DEFINE_ALU_INSTRUCTION_ARM(SUB, ARM_SUBTRACTION_S(n, cpu->shifterOperand, cpu->g
 	int32_t n = cpu->gprs[rn];
 	cpu->gprs[rd] = n - cpu->shifterOperand;)
 
-DEFINE_ALU_INSTRUCTION_S_ONLY_ARM(TEQ, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, aluOut),
+DEFINE_LOGICAL_INSTRUCTION_S_ONLY_ARM(TEQ, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, aluOut),
 	int32_t aluOut = cpu->gprs[rn] ^ cpu->shifterOperand;)
 
-DEFINE_ALU_INSTRUCTION_S_ONLY_ARM(TST, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, aluOut),
+DEFINE_LOGICAL_INSTRUCTION_S_ONLY_ARM(TST, ARM_NEUTRAL_S(cpu->gprs[rn], cpu->shifterOperand, aluOut),
 	int32_t aluOut = cpu->gprs[rn] & cpu->shifterOperand;)
 
 // End ALU definitions
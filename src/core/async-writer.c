@@ -0,0 +1,103 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/async-writer.h>
+
+#include <mgba/core/trace.h>
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _writerThread(void* context) {
+	struct mAsyncWriter* writer = context;
+	ThreadSetName("Async Writer");
+	mTRACE_THREAD("Async Writer");
+	MutexLock(&writer->mutex);
+	while (true) {
+		struct mAsyncWriterJob* job = writer->head;
+		if (!job) {
+			if (writer->exiting) {
+				break;
+			}
+			ConditionWait(&writer->queued, &writer->mutex);
+			continue;
+		}
+		writer->head = job->next;
+		if (!writer->head) {
+			writer->tail = NULL;
+		}
+		writer->busy = true;
+		MutexUnlock(&writer->mutex);
+		job->run(job);
+		MutexLock(&writer->mutex);
+		writer->busy = false;
+		ConditionWake(&writer->drained);
+	}
+	MutexUnlock(&writer->mutex);
+	return 0;
+}
+#endif
+
+void mAsyncWriterInit(struct mAsyncWriter* writer) {
+	memset(writer, 0, sizeof(*writer));
+#ifndef DISABLE_THREADING
+	MutexInit(&writer->mutex);
+	ConditionInit(&writer->queued);
+	ConditionInit(&writer->drained);
+	writer->running = !ThreadCreate(&writer->thread, _writerThread, writer);
+#endif
+}
+
+void mAsyncWriterDeinit(struct mAsyncWriter* writer) {
+#ifndef DISABLE_THREADING
+	if (writer->running) {
+		MutexLock(&writer->mutex);
+		writer->exiting = true;
+		ConditionWake(&writer->queued);
+		MutexUnlock(&writer->mutex);
+		ThreadJoin(writer->thread);
+		writer->running = false;
+	}
+	ConditionDeinit(&writer->drained);
+	ConditionDeinit(&writer->queued);
+	MutexDeinit(&writer->mutex);
+#else
+	UNUSED(writer);
+#endif
+}
+
+void mAsyncWriterSubmit(struct mAsyncWriter* writer, struct mAsyncWriterJob* job) {
+	job->next = NULL;
+#ifndef DISABLE_THREADING
+	if (writer->running) {
+		MutexLock(&writer->mutex);
+		if (writer->tail) {
+			writer->tail->next = job;
+		} else {
+			writer->head = job;
+		}
+		writer->tail = job;
+		ConditionWake(&writer->queued);
+		MutexUnlock(&writer->mutex);
+		return;
+	}
+#else
+	UNUSED(writer);
+#endif
+	job->run(job);
+}
+
+void mAsyncWriterFlush(struct mAsyncWriter* writer) {
+#ifndef DISABLE_THREADING
+	if (!writer->running) {
+		return;
+	}
+	MutexLock(&writer->mutex);
+	while (writer->head || writer->busy) {
+		ConditionWait(&writer->drained, &writer->mutex);
+	}
+	MutexUnlock(&writer->mutex);
+#else
+	UNUSED(writer);
+#endif
+}
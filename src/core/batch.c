@@ -0,0 +1,151 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/batch.h>
+
+#include <mgba/core/core.h>
+#ifndef DISABLE_THREADING
+#include <mgba-util/threading.h>
+
+struct mCoreBatchThreads {
+	Thread threads[mCORE_BATCH_MAX_THREADS];
+	Mutex mutex;
+	Condition start;
+	Condition done;
+	unsigned generation;
+	bool running;
+};
+#endif
+
+static void _runCore(struct mCoreBatch* batch, size_t index) {
+	struct mCore* core = batch->cores[index];
+	const uint32_t* keys = batch->keys ? &batch->keys[index * batch->frames] : NULL;
+	unsigned frame;
+	if (batch->renderLast && batch->frames > 1) {
+		core->setOutputSuppressed(core, true, true);
+	}
+	for (frame = 0; frame < batch->frames; ++frame) {
+		if (batch->renderLast && batch->frames > 1 && frame == batch->frames - 1) {
+			core->setOutputSuppressed(core, false, false);
+		}
+		if (keys) {
+			core->setKeys(core, keys[frame]);
+		}
+		core->runFrame(core);
+	}
+}
+
+#ifndef DISABLE_THREADING
+// Hands out cores one at a time until none are left; called with the mutex held
+static void _drain(struct mCoreBatch* batch) {
+	while (batch->next < batch->nCores) {
+		size_t index = batch->next;
+		++batch->next;
+		MutexUnlock(&batch->threads->mutex);
+		_runCore(batch, index);
+		MutexLock(&batch->threads->mutex);
+		++batch->finished;
+	}
+	if (batch->finished == batch->nCores) {
+		ConditionWake(&batch->threads->done);
+	}
+}
+
+static THREAD_ENTRY _batchThread(void* context) {
+	struct mCoreBatch* batch = context;
+	ThreadSetName("Batch Thread");
+	MutexLock(&batch->threads->mutex);
+	unsigned generation = batch->threads->generation;
+	while (batch->threads->running) {
+		if (generation == batch->threads->generation) {
+			ConditionWait(&batch->threads->start, &batch->threads->mutex);
+			continue;
+		}
+		generation = batch->threads->generation;
+		_drain(batch);
+	}
+	MutexUnlock(&batch->threads->mutex);
+	return 0;
+}
+#endif
+
+void mCoreBatchInit(struct mCoreBatch* batch, size_t nThreads) {
+	memset(batch, 0, sizeof(*batch));
+	if (!nThreads) {
+		nThreads = 1;
+	}
+	if (nThreads > mCORE_BATCH_MAX_THREADS) {
+		nThreads = mCORE_BATCH_MAX_THREADS;
+	}
+#ifndef DISABLE_THREADING
+	batch->nThreads = nThreads;
+	batch->threads = calloc(1, sizeof(*batch->threads));
+	MutexInit(&batch->threads->mutex);
+	ConditionInit(&batch->threads->start);
+	ConditionInit(&batch->threads->done);
+	batch->threads->running = true;
+	size_t i;
+	for (i = 1; i < nThreads; ++i) {
+		ThreadCreate(&batch->threads->threads[i], _batchThread, batch);
+	}
+#else
+	batch->nThreads = 1;
+#endif
+}
+
+void mCoreBatchDeinit(struct mCoreBatch* batch) {
+#ifndef DISABLE_THREADING
+	MutexLock(&batch->threads->mutex);
+	batch->threads->running = false;
+	ConditionWake(&batch->threads->start);
+	MutexUnlock(&batch->threads->mutex);
+	size_t i;
+	for (i = 1; i < batch->nThreads; ++i) {
+		ThreadJoin(batch->threads->threads[i]);
+	}
+	ConditionDeinit(&batch->threads->done);
+	ConditionDeinit(&batch->threads->start);
+	MutexDeinit(&batch->threads->mutex);
+	free(batch->threads);
+	batch->threads = NULL;
+#else
+	UNUSED(batch);
+#endif
+}
+
+void mCoreBatchStep(struct mCoreBatch* batch, struct mCore** cores, size_t nCores, unsigned frames, const uint32_t* keys, bool renderLast) {
+	if (!nCores || !frames) {
+		return;
+	}
+#ifndef DISABLE_THREADING
+	MutexLock(&batch->threads->mutex);
+#endif
+	batch->cores = cores;
+	batch->nCores = nCores;
+	batch->frames = frames;
+	batch->keys = keys;
+	batch->renderLast = renderLast;
+	batch->next = 0;
+	batch->finished = 0;
+#ifndef DISABLE_THREADING
+	if (batch->nThreads > 1 && nCores > 1) {
+		++batch->threads->generation;
+		ConditionWake(&batch->threads->start);
+	}
+	// The calling thread takes cores too, instead of just waiting on the workers
+	_drain(batch);
+	while (batch->finished < batch->nCores) {
+		ConditionWait(&batch->threads->done, &batch->threads->mutex);
+	}
+	batch->cores = NULL;
+	MutexUnlock(&batch->threads->mutex);
+#else
+	size_t i;
+	for (i = 0; i < nCores; ++i) {
+		_runCore(batch, i);
+	}
+	batch->cores = NULL;
+#endif
+}
@@ -11,8 +11,15 @@ void mBitmapCacheInit(struct mBitmapCache* cache) {
 	// TODO: Reconfigurable cache for space savings
 	cache->cache = NULL;
 	cache->config = mBitmapCacheConfigurationFillShouldStore(0);
+	// Left unset, this could match the first system configuration and skip allocating for it
+	cache->sysConfig = 0;
 	cache->status = NULL;
 	cache->palette = NULL;
+	cache->globalPaletteVersion = 0;
+	cache->bitsSize = 0;
+	cache->bitsStart[0] = 0;
+	cache->bitsStart[1] = 0;
+	cache->stride = 0;
 	cache->buffer = 0;
 }
 
@@ -90,7 +97,8 @@ void mBitmapCacheWriteVRAM(struct mBitmapCache* cache, uint32_t address) {
 		}
 		offset /= cache->stride;
 		offset *= mBitmapCacheSystemInfoGetBuffers(cache->sysConfig);
-		offset += cache->buffer;
+		// The row belongs to whichever buffer was written, not necessarily the one being displayed
+		offset += i;
 		cache->status[offset].vramClean = 0;
 		++cache->status[offset].vramVersion;
 	}
@@ -108,6 +116,10 @@ void mBitmapCacheWritePalette(struct mBitmapCache* cache, uint32_t entry, color_
 	++cache->globalPaletteVersion;
 }
 
+static bool _entryMatches(const struct mBitmapCacheEntry* a, const struct mBitmapCacheEntry* b) {
+	return a->paletteVersion == b->paletteVersion && a->vramVersion == b->vramVersion && a->vramClean == b->vramClean;
+}
+
 uint32_t _lookupEntry8(void* vram, uint32_t offset) {
 	return ((uint8_t*) vram)[offset];
 }
@@ -120,9 +132,10 @@ void mBitmapCacheCleanRow(struct mBitmapCache* cache, struct mBitmapCacheEntry*
 	color_t* row = &cache->cache[(cache->buffer * mBitmapCacheSystemInfoGetHeight(cache->sysConfig) + y) * mBitmapCacheSystemInfoGetWidth(cache->sysConfig)];
 	size_t location = cache->buffer + mBitmapCacheSystemInfoGetBuffers(cache->sysConfig) * y;
 	struct mBitmapCacheEntry* status = &cache->status[location];
+	// Each row is only converted again once VRAM under it or the palette has changed since
 	struct mBitmapCacheEntry desiredStatus = {
 		.paletteVersion = cache->globalPaletteVersion,
-		.vramVersion = entry->vramVersion,
+		.vramVersion = status->vramVersion,
 		.vramClean = 1
 	};
 
@@ -130,22 +143,20 @@ void mBitmapCacheCleanRow(struct mBitmapCache* cache, struct mBitmapCacheEntry*
 		entry[location] = desiredStatus;
 	}
 
-	if (!mBitmapCacheConfigurationIsShouldStore(cache->config) || !memcmp(status, &desiredStatus, sizeof(*entry))) {
+	if (!mBitmapCacheConfigurationIsShouldStore(cache->config) || _entryMatches(status, &desiredStatus)) {
 		return;
 	}
 
-	size_t offset = cache->bitsStart[cache->buffer] + y * mBitmapCacheSystemInfoGetWidth(cache->sysConfig);
-	void* vram;
+	// bitsStart is in bytes, so only the row is scaled to the size of an entry
+	void* vram = &cache->vram[cache->bitsStart[cache->buffer] + y * cache->stride];
 	int bpe = mBitmapCacheSystemInfoGetEntryBPP(cache->sysConfig);
 	uint32_t (*lookupEntry)(void*, uint32_t);
 	switch (bpe) {
 	case 3:
 		lookupEntry = _lookupEntry8;
-		vram = &cache->vram[offset];
 		break;
 	case 4:
 		lookupEntry = _lookupEntry15;
-		vram = &cache->vram[offset << 1];
 		break;
 	default:
 		abort();
@@ -169,11 +180,11 @@ bool mBitmapCacheCheckRow(struct mBitmapCache* cache, const struct mBitmapCacheE
 	size_t location = cache->buffer + mBitmapCacheSystemInfoGetBuffers(cache->sysConfig) * y;
 	struct mBitmapCacheEntry desiredStatus = {
 		.paletteVersion = cache->globalPaletteVersion,
-		.vramVersion = entry->vramVersion,
+		.vramVersion = cache->status[location].vramVersion,
 		.vramClean = 1
 	};
 
-	return memcmp(&entry[location], &desiredStatus, sizeof(*entry)) == 0;
+	return _entryMatches(&entry[location], &desiredStatus);
 }
 
 const color_t* mBitmapCacheGetRow(struct mBitmapCache* cache, unsigned y) {
@@ -5,6 +5,8 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/core/cache-set.h>
 
+#include <mgba-util/math.h>
+
 DEFINE_VECTOR(mMapCacheSet, struct mMapCache);
 DEFINE_VECTOR(mBitmapCacheSet, struct mBitmapCache);
 DEFINE_VECTOR(mTileCacheSet, struct mTileCache);
@@ -16,6 +18,11 @@ void mCacheSetInit(struct mCacheSet* cache, size_t nMaps, size_t nBitmaps, size_
 	mBitmapCacheSetResize(&cache->bitmaps, nBitmaps);
 	mTileCacheSetInit(&cache->tiles, nTiles);
 	mTileCacheSetResize(&cache->tiles, nTiles);
+	cache->deferredVRAM = NULL;
+	cache->deferredVRAMSize = 0;
+	cache->deferredPalette = NULL;
+	cache->deferredColors = NULL;
+	cache->deferredPaletteSize = 0;
 
 	size_t i;
 	for (i = 0; i < nMaps; ++i) {
@@ -40,6 +47,12 @@ void mCacheSetDeinit(struct mCacheSet* cache) {
 	for (i = 0; i < mTileCacheSetSize(&cache->tiles); ++i) {
 		mTileCacheDeinit(mTileCacheSetGetPointer(&cache->tiles, i));
 	}
+	free(cache->deferredVRAM);
+	free(cache->deferredPalette);
+	free(cache->deferredColors);
+	cache->deferredVRAM = NULL;
+	cache->deferredPalette = NULL;
+	cache->deferredColors = NULL;
 }
 
 void mCacheSetAssignVRAM(struct mCacheSet* cache, void* vram) {
@@ -56,7 +69,7 @@ void mCacheSetAssignVRAM(struct mCacheSet* cache, void* vram) {
 	}
 }
 
-void mCacheSetWriteVRAM(struct mCacheSet* cache, uint32_t address) {
+static void _writeVRAM(struct mCacheSet* cache, uint32_t address) {
 	size_t i;
 	for (i = 0; i < mMapCacheSetSize(&cache->maps); ++i) {
 		mMapCacheWriteVRAM(mMapCacheSetGetPointer(&cache->maps, i), address);
@@ -69,7 +82,7 @@ void mCacheSetWriteVRAM(struct mCacheSet* cache, uint32_t address) {
 	}
 }
 
-void mCacheSetWritePalette(struct mCacheSet* cache, uint32_t entry, color_t color) {
+static void _writePalette(struct mCacheSet* cache, uint32_t entry, color_t color) {
 	size_t i;
 	for (i = 0; i < mBitmapCacheSetSize(&cache->bitmaps); ++i) {
 		mBitmapCacheWritePalette(mBitmapCacheSetGetPointer(&cache->bitmaps, i), entry, color);
@@ -78,3 +91,72 @@ void mCacheSetWritePalette(struct mCacheSet* cache, uint32_t entry, color_t colo
 		mTileCacheWritePalette(mTileCacheSetGetPointer(&cache->tiles, i), entry, color);
 	}
 }
+
+void mCacheSetWriteVRAM(struct mCacheSet* cache, uint32_t address) {
+	if (address < cache->deferredVRAMSize) {
+		ATOMIC_OR(cache->deferredVRAM[address >> 5], 1U << (address & 31));
+		return;
+	}
+	_writeVRAM(cache, address);
+}
+
+void mCacheSetWritePalette(struct mCacheSet* cache, uint32_t entry, color_t color) {
+	if (entry < cache->deferredPaletteSize) {
+		// The release on the bit publishes the color along with it
+		cache->deferredColors[entry] = color;
+		ATOMIC_OR(cache->deferredPalette[entry >> 5], 1U << (entry & 31));
+		return;
+	}
+	_writePalette(cache, entry, color);
+}
+
+void mCacheSetDefer(struct mCacheSet* cache, size_t vramSize, size_t paletteSize) {
+	mCacheSetApplyDeferred(cache);
+	free(cache->deferredVRAM);
+	free(cache->deferredPalette);
+	free(cache->deferredColors);
+	cache->deferredVRAM = NULL;
+	cache->deferredPalette = NULL;
+	cache->deferredColors = NULL;
+	cache->deferredVRAMSize = vramSize;
+	cache->deferredPaletteSize = paletteSize;
+	if (vramSize) {
+		cache->deferredVRAM = calloc((vramSize + 31) >> 5, sizeof(uint32_t));
+	}
+	if (paletteSize) {
+		cache->deferredPalette = calloc((paletteSize + 31) >> 5, sizeof(uint32_t));
+		cache->deferredColors = calloc(paletteSize, sizeof(color_t));
+	}
+}
+
+size_t mCacheSetApplyDeferred(struct mCacheSet* cache) {
+	size_t applied = 0;
+	size_t i;
+	for (i = 0; i < (cache->deferredVRAMSize + 31) >> 5; ++i) {
+		uint32_t bits;
+		ATOMIC_LOAD(bits, cache->deferredVRAM[i]);
+		if (!bits) {
+			continue;
+		}
+		ATOMIC_AND(cache->deferredVRAM[i], ~bits);
+		for (; bits; bits &= bits - 1) {
+			_writeVRAM(cache, (i << 5) + 31 - clz32(bits & -bits));
+			++applied;
+		}
+	}
+	for (i = 0; i < (cache->deferredPaletteSize + 31) >> 5; ++i) {
+		uint32_t bits;
+		ATOMIC_LOAD(bits, cache->deferredPalette[i]);
+		if (!bits) {
+			continue;
+		}
+		// Clear before reading the colors so a racing write is picked up on the next pass
+		ATOMIC_AND(cache->deferredPalette[i], ~bits);
+		for (; bits; bits &= bits - 1) {
+			uint32_t entry = (i << 5) + 31 - clz32(bits & -bits);
+			_writePalette(cache, entry, cache->deferredColors[entry]);
+			++applied;
+		}
+	}
+	return applied;
+}
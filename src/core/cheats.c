@@ -6,11 +6,15 @@
 #include <mgba/core/cheats.h>
 
 #include <mgba/core/core.h>
+#include <mgba/core/interface.h>
 #include <mgba-util/string.h>
 #include <mgba-util/vfs.h>
 
 #define MAX_LINE_LENGTH 128
 
+#define REGION_NONE -1
+#define REGION_SEARCH -2
+
 const uint32_t M_CHEAT_DEVICE_ID = 0xABADC0DE;
 
 mLOG_DEFINE_CATEGORY(CHEATS, "Cheats", "core.cheats");
@@ -18,6 +22,22 @@ mLOG_DEFINE_CATEGORY(CHEATS, "Cheats", "core.cheats");
 DEFINE_VECTOR(mCheatList, struct mCheat);
 DEFINE_VECTOR(mCheatSets, struct mCheatSet*);
 
+struct mCheatOp {
+	struct mCheat cheat;
+	// Index of the direct region holding the cheat's address, REGION_NONE or REGION_SEARCH
+	int region;
+	// Set for plain single assignments, which can be stored straight to offset in the region
+	bool direct;
+	uint32_t offset;
+};
+
+struct mCheatProgram {
+	// Copy of the list the ops were compiled from, so in-place edits by the parsers are noticed
+	struct mCheatList source;
+	struct mCheatOp* ops;
+	size_t nOps;
+};
+
 static int32_t _readMem(struct mCore* core, uint32_t address, int width) {
 	switch (width) {
 	case 1:
@@ -44,6 +64,145 @@ static void _writeMem(struct mCore* core, uint32_t address, int width, int32_t v
 	}
 }
 
+static void _updateRegions(struct mCheatDevice* device) {
+	if (device->updateRegions) {
+		device->updateRegions(device);
+	}
+}
+
+static const struct mCheatMemoryRegion* _findRegion(const struct mCheatDevice* device, int hint, uint32_t address, int width, uint32_t* offset) {
+	if (hint == REGION_NONE || (address & (width - 1))) {
+		return NULL;
+	}
+	size_t i = 0;
+	size_t end = device->nRegions;
+	if (hint != REGION_SEARCH) {
+		i = hint;
+		end = i + 1;
+	}
+	if (end > device->nRegions) {
+		end = device->nRegions;
+	}
+	for (; i < end; ++i) {
+		const struct mCheatMemoryRegion* region = &device->regions[i];
+		if (!region->memory || address < region->start || address >= region->end) {
+			continue;
+		}
+		*offset = (address - region->start) & region->mask;
+		if (*offset + width <= region->size) {
+			return region;
+		}
+	}
+	return NULL;
+}
+
+static int32_t _readCheat(struct mCheatDevice* device, int hint, uint32_t address, int width) {
+	uint32_t offset;
+	const struct mCheatMemoryRegion* region = _findRegion(device, hint, address, width, &offset);
+	if (!region) {
+		return _readMem(device->p, address, width);
+	}
+	uint16_t value16;
+	uint32_t value32;
+	switch (width) {
+	case 1:
+		return region->memory[offset];
+	case 2:
+		LOAD_16LE(value16, offset, region->memory);
+		return value16;
+	case 4:
+		LOAD_32LE(value32, offset, region->memory);
+		return value32;
+	}
+	return 0;
+}
+
+static void _storeDirect(const struct mCheatMemoryRegion* region, uint32_t offset, int width, int32_t value) {
+	switch (width) {
+	case 1:
+		region->memory[offset] = value;
+		break;
+	case 2:
+		STORE_16LE(value, offset, region->memory);
+		break;
+	case 4:
+		STORE_32LE(value, offset, region->memory);
+		break;
+	}
+	if (region->dirty) {
+		mCoreMemoryDirtyMark(region->dirty, region->dirtyBase + offset);
+	}
+}
+
+static void _writeCheat(struct mCheatDevice* device, int hint, uint32_t address, int width, int32_t value) {
+	uint32_t offset;
+	const struct mCheatMemoryRegion* region = _findRegion(device, hint, address, width, &offset);
+	if (!region) {
+		_writeMem(device->p, address, width, value);
+		_updateRegions(device);
+		return;
+	}
+	_storeDirect(region, offset, width, value);
+}
+
+static void _freeProgram(struct mCheatProgram* program) {
+	mCheatListDeinit(&program->source);
+	free(program->ops);
+	free(program);
+}
+
+static struct mCheatProgram* _compileProgram(struct mCheatDevice* device, struct mCheatSet* cheats) {
+	struct mCheatProgram* program = cheats->program;
+	size_t nCodes = mCheatListSize(&cheats->list);
+	if (program && mCheatListSize(&program->source) == nCodes &&
+	    (!nCodes || memcmp(mCheatListGetConstPointer(&program->source, 0), mCheatListGetConstPointer(&cheats->list, 0), nCodes * sizeof(struct mCheat)) == 0)) {
+		return program;
+	}
+	if (!program) {
+		program = calloc(1, sizeof(*program));
+		mCheatListInit(&program->source, nCodes);
+		cheats->program = program;
+	}
+	mCheatListResize(&program->source, (ssize_t) nCodes - (ssize_t) mCheatListSize(&program->source));
+	if (nCodes) {
+		memcpy(mCheatListGetPointer(&program->source, 0), mCheatListGetConstPointer(&cheats->list, 0), nCodes * sizeof(struct mCheat));
+	}
+	free(program->ops);
+	program->ops = malloc(sizeof(*program->ops) * (nCodes ? nCodes : 1));
+	program->nOps = nCodes;
+
+	size_t i;
+	for (i = 0; i < nCodes; ++i) {
+		struct mCheatOp* op = &program->ops[i];
+		op->cheat = *mCheatListGetConstPointer(&cheats->list, i);
+		op->region = REGION_NONE;
+		op->direct = false;
+		if (op->cheat.type == CHEAT_ASSIGN_INDIRECT) {
+			// The target is only known once the pointer has been read
+			op->region = REGION_SEARCH;
+			continue;
+		}
+		if (op->cheat.type == CHEAT_IF_BUTTON) {
+			continue;
+		}
+		size_t r;
+		for (r = 0; r < device->nRegions; ++r) {
+			const struct mCheatMemoryRegion* region = &device->regions[r];
+			if (op->cheat.address >= region->start && op->cheat.address < region->end) {
+				op->region = r;
+				break;
+			}
+		}
+		if (op->region >= 0 && op->cheat.type == CHEAT_ASSIGN && op->cheat.repeat == 1) {
+			const struct mCheatMemoryRegion* region = &device->regions[op->region];
+			op->direct = !(op->cheat.address & (op->cheat.width - 1));
+			op->offset = (op->cheat.address - region->start) & region->mask;
+			op->direct = op->direct && op->offset + op->cheat.width <= region->size;
+		}
+	}
+	return program;
+}
+
 static void mCheatDeviceInit(void*, struct mCPUComponent*);
 static void mCheatDeviceDeinit(struct mCPUComponent*);
 
@@ -53,6 +212,8 @@ void mCheatDeviceCreate(struct mCheatDevice* device) {
 	device->d.deinit = mCheatDeviceDeinit;
 	device->autosave = false;
 	device->buttonDown = false;
+	device->updateRegions = NULL;
+	device->nRegions = 0;
 	mCheatSetsInit(&device->cheats, 4);
 }
 
@@ -79,10 +240,14 @@ void mCheatSetInit(struct mCheatSet* set, const char* name) {
 		set->name = 0;
 	}
 	set->enabled = true;
+	set->program = NULL;
 }
 
 void mCheatSetDeinit(struct mCheatSet* set) {
 	mCheatListDeinit(&set->list);
+	if (set->program) {
+		_freeProgram(set->program);
+	}
 	size_t i;
 	for (i = 0; i < StringListSize(&set->lines); ++i) {
 		free(*StringListGetPointer(&set->lines, i));
@@ -275,12 +440,15 @@ void mCheatRefresh(struct mCheatDevice* device, struct mCheatSet* cheats) {
 		return;
 	}
 
+	_updateRegions(device);
+	const struct mCheatProgram* program = _compileProgram(device, cheats);
 	size_t elseLoc = 0;
 	size_t endLoc = 0;
-	size_t nCodes = mCheatListSize(&cheats->list);
+	size_t nCodes = program->nOps;
 	size_t i;
 	for (i = 0; i < nCodes; ++i) {
-		struct mCheat* cheat = mCheatListGetPointer(&cheats->list, i);
+		const struct mCheatOp* op = &program->ops[i];
+		const struct mCheat* cheat = &op->cheat;
 		int32_t value = 0;
 		int32_t operand = cheat->operand;
 		uint32_t operationsRemaining = cheat->repeat;
@@ -290,6 +458,11 @@ void mCheatRefresh(struct mCheatDevice* device, struct mCheatSet* cheats) {
 		int conditionRemaining = 0;
 		int negativeConditionRemaining = 0;
 
+		if (op->direct && (size_t) op->region < device->nRegions && device->regions[op->region].memory) {
+			_storeDirect(&device->regions[op->region], op->offset, cheat->width, operand);
+			operationsRemaining = 0;
+		}
+
 		for (; operationsRemaining; --operationsRemaining) {
 			switch (cheat->type) {
 			case CHEAT_ASSIGN:
@@ -298,71 +471,71 @@ void mCheatRefresh(struct mCheatDevice* device, struct mCheatSet* cheats) {
 				break;
 			case CHEAT_ASSIGN_INDIRECT:
 				value = operand;
-				address = _readMem(device->p, address + cheat->addressOffset, 4);
+				address = _readCheat(device, REGION_SEARCH, address + cheat->addressOffset, 4);
 				performAssignment = true;
 				break;
 			case CHEAT_AND:
-				value = _readMem(device->p, address, cheat->width) & operand;
+				value = _readCheat(device, op->region, address, cheat->width) & operand;
 				performAssignment = true;
 				break;
 			case CHEAT_ADD:
-				value = _readMem(device->p, address, cheat->width) + operand;
+				value = _readCheat(device, op->region, address, cheat->width) + operand;
 				performAssignment = true;
 				break;
 			case CHEAT_OR:
-				value = _readMem(device->p, address, cheat->width) | operand;
+				value = _readCheat(device, op->region, address, cheat->width) | operand;
 				performAssignment = true;
 				break;
 			case CHEAT_IF_EQ:
-				condition = _readMem(device->p, address, cheat->width) == operand;
+				condition = _readCheat(device, op->region, address, cheat->width) == operand;
 				conditionRemaining = cheat->repeat;
 				negativeConditionRemaining = cheat->negativeRepeat;
 				operationsRemaining = 1;
 				break;
 			case CHEAT_IF_NE:
-				condition = _readMem(device->p, address, cheat->width) != operand;
+				condition = _readCheat(device, op->region, address, cheat->width) != operand;
 				conditionRemaining = cheat->repeat;
 				negativeConditionRemaining = cheat->negativeRepeat;
 				operationsRemaining = 1;
 				break;
 			case CHEAT_IF_LT:
-				condition = _readMem(device->p, address, cheat->width) < operand;
+				condition = _readCheat(device, op->region, address, cheat->width) < operand;
 				conditionRemaining = cheat->repeat;
 				negativeConditionRemaining = cheat->negativeRepeat;
 				operationsRemaining = 1;
 				break;
 			case CHEAT_IF_GT:
-				condition = _readMem(device->p, address, cheat->width) > operand;
+				condition = _readCheat(device, op->region, address, cheat->width) > operand;
 				conditionRemaining = cheat->repeat;
 				negativeConditionRemaining = cheat->negativeRepeat;
 				operationsRemaining = 1;
 				break;
 			case CHEAT_IF_ULT:
-				condition = (uint32_t) _readMem(device->p, address, cheat->width) < (uint32_t) operand;
+				condition = (uint32_t) _readCheat(device, op->region, address, cheat->width) < (uint32_t) operand;
 				conditionRemaining = cheat->repeat;
 				negativeConditionRemaining = cheat->negativeRepeat;
 				operationsRemaining = 1;
 				break;
 			case CHEAT_IF_UGT:
-				condition = (uint32_t) _readMem(device->p, address, cheat->width) > (uint32_t) operand;
+				condition = (uint32_t) _readCheat(device, op->region, address, cheat->width) > (uint32_t) operand;
 				conditionRemaining = cheat->repeat;
 				negativeConditionRemaining = cheat->negativeRepeat;
 				operationsRemaining = 1;
 				break;
 			case CHEAT_IF_AND:
-				condition = _readMem(device->p, address, cheat->width) & operand;
+				condition = _readCheat(device, op->region, address, cheat->width) & operand;
 				conditionRemaining = cheat->repeat;
 				negativeConditionRemaining = cheat->negativeRepeat;
 				operationsRemaining = 1;
 				break;
 			case CHEAT_IF_LAND:
-				condition = _readMem(device->p, address, cheat->width) && operand;
+				condition = _readCheat(device, op->region, address, cheat->width) && operand;
 				conditionRemaining = cheat->repeat;
 				negativeConditionRemaining = cheat->negativeRepeat;
 				operationsRemaining = 1;
 				break;
 			case CHEAT_IF_NAND:
-				condition = !(_readMem(device->p, address, cheat->width) & operand);
+				condition = !(_readCheat(device, op->region, address, cheat->width) & operand);
 				conditionRemaining = cheat->repeat;
 				negativeConditionRemaining = cheat->negativeRepeat;
 				operationsRemaining = 1;
@@ -376,7 +549,7 @@ void mCheatRefresh(struct mCheatDevice* device, struct mCheatSet* cheats) {
 			}
 
 			if (performAssignment) {
-				_writeMem(device->p, address, cheat->width, value);
+				_writeCheat(device, op->region, address, cheat->width, value);
 			}
 
 			address += cheat->addressOffset;
@@ -8,6 +8,7 @@
 #include <mgba/core/version.h>
 #include <mgba-util/formatting.h>
 #include <mgba-util/string.h>
+#include <mgba-util/threading.h>
 #include <mgba-util/vfs.h>
 
 #include <sys/stat.h>
@@ -36,6 +37,31 @@ struct mCoreConfigEnumerateData {
 	enum mCoreConfigLevel level;
 };
 
+enum mCoreConfigParseState {
+	PARSE_PENDING = 0,
+	PARSE_VALID,
+	PARSE_INVALID
+};
+
+// Resolving a key walks up to six tables, so both the resolved string and its
+// parsed forms are memoized per key. Any change to a table bumps its
+// generation, and the cache is dropped once the sum no longer matches.
+struct mCoreConfigCacheEntry {
+	const char* value;
+	enum mCoreConfigParseState intState;
+	enum mCoreConfigParseState uintState;
+	enum mCoreConfigParseState floatState;
+	int intValue;
+	unsigned uintValue;
+	float floatValue;
+};
+
+struct mCoreConfigCache {
+	struct Table entries;
+	unsigned generation;
+	Mutex mutex;
+};
+
 static const char* _lookupValue(const struct mCoreConfig* config, const char* key) {
 	const char* value;
 	if (config->port) {
@@ -67,20 +93,38 @@ static const char* _lookupValue(const struct mCoreConfig* config, const char* ke
 	return ConfigurationGetValue(&config->defaultsTable, 0, key);
 }
 
-static bool _lookupCharValue(const struct mCoreConfig* config, const char* key, char** out) {
-	const char* value = _lookupValue(config, key);
-	if (!value) {
-		return false;
+static unsigned _generation(const struct mCoreConfig* config) {
+	return config->configTable.generation + config->defaultsTable.generation + config->overridesTable.generation;
+}
+
+// Must be called with the cache mutex held
+static struct mCoreConfigCacheEntry* _cacheEntry(const struct mCoreConfig* config, const char* key) {
+	struct mCoreConfigCache* cache = config->cache;
+	unsigned generation = _generation(config);
+	if (generation != cache->generation) {
+		HashTableClear(&cache->entries);
+		cache->generation = generation;
 	}
-	if (*out) {
-		free(*out);
+	struct mCoreConfigCacheEntry* entry = HashTableLookup(&cache->entries, key);
+	if (!entry) {
+		entry = calloc(1, sizeof(*entry));
+		entry->value = _lookupValue(config, key);
+		HashTableInsert(&cache->entries, key, entry);
 	}
-	*out = strdup(value);
-	return true;
+	return entry;
+}
+
+static const char* _lookupCachedValue(const struct mCoreConfig* config, const char* key) {
+	if (!config->cache) {
+		return _lookupValue(config, key);
+	}
+	MutexLock(&config->cache->mutex);
+	const char* value = _cacheEntry(config, key)->value;
+	MutexUnlock(&config->cache->mutex);
+	return value;
 }
 
-static bool _lookupIntValue(const struct mCoreConfig* config, const char* key, int* out) {
-	const char* charValue = _lookupValue(config, key);
+static bool _parseIntValue(const char* charValue, int* out) {
 	if (!charValue) {
 		return false;
 	}
@@ -96,8 +140,7 @@ static bool _lookupIntValue(const struct mCoreConfig* config, const char* key, i
 	return true;
 }
 
-static bool _lookupUIntValue(const struct mCoreConfig* config, const char* key, unsigned* out) {
-	const char* charValue = _lookupValue(config, key);
+static bool _parseUIntValue(const char* charValue, unsigned* out) {
 	if (!charValue) {
 		return false;
 	}
@@ -110,8 +153,7 @@ static bool _lookupUIntValue(const struct mCoreConfig* config, const char* key,
 	return true;
 }
 
-static bool _lookupFloatValue(const struct mCoreConfig* config, const char* key, float* out) {
-	const char* charValue = _lookupValue(config, key);
+static bool _parseFloatValue(const char* charValue, float* out) {
 	if (!charValue) {
 		return false;
 	}
@@ -124,6 +166,40 @@ static bool _lookupFloatValue(const struct mCoreConfig* config, const char* key,
 	return true;
 }
 
+#define DEFINE_CACHED_LOOKUP(NAME, TYPE, FIELD) \
+	static bool _lookup ## NAME ## Value(const struct mCoreConfig* config, const char* key, TYPE* out) { \
+		if (!config->cache) { \
+			return _parse ## NAME ## Value(_lookupValue(config, key), out); \
+		} \
+		MutexLock(&config->cache->mutex); \
+		struct mCoreConfigCacheEntry* entry = _cacheEntry(config, key); \
+		if (entry->FIELD ## State == PARSE_PENDING) { \
+			entry->FIELD ## State = _parse ## NAME ## Value(entry->value, &entry->FIELD ## Value) ? PARSE_VALID : PARSE_INVALID; \
+		} \
+		bool valid = entry->FIELD ## State == PARSE_VALID; \
+		if (valid) { \
+			*out = entry->FIELD ## Value; \
+		} \
+		MutexUnlock(&config->cache->mutex); \
+		return valid; \
+	}
+
+DEFINE_CACHED_LOOKUP(Int, int, int)
+DEFINE_CACHED_LOOKUP(UInt, unsigned, uint)
+DEFINE_CACHED_LOOKUP(Float, float, float)
+
+static bool _lookupCharValue(const struct mCoreConfig* config, const char* key, char** out) {
+	const char* value = _lookupCachedValue(config, key);
+	if (!value) {
+		return false;
+	}
+	if (*out) {
+		free(*out);
+	}
+	*out = strdup(value);
+	return true;
+}
+
 void mCoreConfigInit(struct mCoreConfig* config, const char* port) {
 	ConfigurationInit(&config->configTable);
 	ConfigurationInit(&config->defaultsTable);
@@ -134,6 +210,10 @@ void mCoreConfigInit(struct mCoreConfig* config, const char* port) {
 	} else {
 		config->port = 0;
 	}
+	config->cache = malloc(sizeof(*config->cache));
+	HashTableInit(&config->cache->entries, 0, free);
+	config->cache->generation = _generation(config);
+	MutexInit(&config->cache->mutex);
 }
 
 void mCoreConfigDeinit(struct mCoreConfig* config) {
@@ -141,6 +221,12 @@ void mCoreConfigDeinit(struct mCoreConfig* config) {
 	ConfigurationDeinit(&config->defaultsTable);
 	ConfigurationDeinit(&config->overridesTable);
 	free(config->port);
+	if (config->cache) {
+		HashTableDeinit(&config->cache->entries);
+		MutexDeinit(&config->cache->mutex);
+		free(config->cache);
+		config->cache = NULL;
+	}
 }
 
 #if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
@@ -253,7 +339,7 @@ void mCoreConfigDirectory(char* out, size_t outLength) {
 #endif
 
 const char* mCoreConfigGetValue(const struct mCoreConfig* config, const char* key) {
-	return _lookupValue(config, key);
+	return _lookupCachedValue(config, key);
 }
 
 bool mCoreConfigGetIntValue(const struct mCoreConfig* config, const char* key, int* value) {
@@ -268,6 +354,43 @@ bool mCoreConfigGetFloatValue(const struct mCoreConfig* config, const char* key,
 	return _lookupFloatValue(config, key, value);
 }
 
+bool mCoreConfigGetCPUMaskValue(const struct mCoreConfig* config, const char* key, uint64_t* value) {
+	const char* charValue = _lookupCachedValue(config, key);
+	if (!charValue || !charValue[0]) {
+		return false;
+	}
+	uint64_t mask = 0;
+	while (*charValue) {
+		char* end;
+		unsigned long first = strtoul(charValue, &end, 10);
+		unsigned long last = first;
+		if (end == charValue) {
+			return false;
+		}
+		if (*end == '-') {
+			charValue = end + 1;
+			last = strtoul(charValue, &end, 10);
+			if (end == charValue || last < first) {
+				return false;
+			}
+		}
+		if (last >= 64) {
+			return false;
+		}
+		for (; first <= last; ++first) {
+			mask |= 1ULL << first;
+		}
+		if (*end == ',') {
+			++end;
+		} else if (*end) {
+			return false;
+		}
+		charValue = end;
+	}
+	*value = mask;
+	return true;
+}
+
 void mCoreConfigSetValue(struct mCoreConfig* config, const char* key, const char* value) {
 	ConfigurationSetValue(&config->configTable, config->port, key, value);
 }
@@ -329,9 +452,11 @@ void mCoreConfigMap(const struct mCoreConfig* config, struct mCoreOptions* opts)
 	_lookupCharValue(config, "shader", &opts->shader);
 	_lookupIntValue(config, "logLevel", &opts->logLevel);
 	_lookupIntValue(config, "frameskip", &opts->frameskip);
+	_lookupIntValue(config, "runAhead", &opts->runAhead);
 	_lookupIntValue(config, "volume", &opts->volume);
 	_lookupIntValue(config, "rewindBufferCapacity", &opts->rewindBufferCapacity);
 	_lookupFloatValue(config, "fpsTarget", &opts->fpsTarget);
+	_lookupFloatValue(config, "audioRateControl", &opts->audioRateControl);
 	unsigned audioBuffers;
 	if (_lookupUIntValue(config, "audioBuffers", &audioBuffers)) {
 		opts->audioBuffers = audioBuffers;
@@ -348,6 +473,12 @@ void mCoreConfigMap(const struct mCoreConfig* config, struct mCoreOptions* opts)
 	if (_lookupIntValue(config, "videoSync", &fakeBool)) {
 		opts->videoSync = fakeBool;
 	}
+	if (_lookupIntValue(config, "framePacing", &fakeBool)) {
+		opts->framePacing = fakeBool;
+	}
+	if (_lookupIntValue(config, "lowLatencyAudio", &fakeBool)) {
+		opts->lowLatencyAudio = fakeBool;
+	}
 	if (_lookupIntValue(config, "lockAspectRatio", &fakeBool)) {
 		opts->lockAspectRatio = fakeBool;
 	}
@@ -363,6 +494,15 @@ void mCoreConfigMap(const struct mCoreConfig* config, struct mCoreOptions* opts)
 	if (_lookupIntValue(config, "mute", &fakeBool)) {
 		opts->mute = fakeBool;
 	}
+	if (_lookupIntValue(config, "skipAudio", &fakeBool)) {
+		opts->skipAudio = fakeBool;
+	}
+	if (_lookupIntValue(config, "fastCompression", &fakeBool)) {
+		opts->fastCompression = fakeBool;
+	}
+	if (_lookupIntValue(config, "lateInput", &fakeBool)) {
+		opts->lateInput = fakeBool;
+	}
 	if (_lookupIntValue(config, "skipBios", &fakeBool)) {
 		opts->skipBios = fakeBool;
 	}
@@ -388,6 +528,8 @@ void mCoreConfigLoadDefaults(struct mCoreConfig* config, const struct mCoreOptio
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "useBios", opts->useBios);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "logLevel", opts->logLevel);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "frameskip", opts->frameskip);
+	ConfigurationSetIntValue(&config->defaultsTable, 0, "runAhead", opts->runAhead);
+	ConfigurationSetIntValue(&config->defaultsTable, 0, "lateInput", opts->lateInput);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "rewindEnable", opts->rewindEnable);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "rewindBufferCapacity", opts->rewindBufferCapacity);
 	ConfigurationSetFloatValue(&config->defaultsTable, 0, "fpsTarget", opts->fpsTarget);
@@ -395,11 +537,16 @@ void mCoreConfigLoadDefaults(struct mCoreConfig* config, const struct mCoreOptio
 	ConfigurationSetUIntValue(&config->defaultsTable, 0, "sampleRate", opts->sampleRate);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "audioSync", opts->audioSync);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "videoSync", opts->videoSync);
+	ConfigurationSetIntValue(&config->defaultsTable, 0, "framePacing", opts->framePacing);
+	ConfigurationSetFloatValue(&config->defaultsTable, 0, "audioRateControl", opts->audioRateControl);
+	ConfigurationSetIntValue(&config->defaultsTable, 0, "lowLatencyAudio", opts->lowLatencyAudio);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "fullscreen", opts->fullscreen);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "width", opts->width);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "height", opts->height);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "volume", opts->volume);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "mute", opts->mute);
+	ConfigurationSetIntValue(&config->defaultsTable, 0, "skipAudio", opts->skipAudio);
+	ConfigurationSetIntValue(&config->defaultsTable, 0, "fastCompression", opts->fastCompression);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "lockAspectRatio", opts->lockAspectRatio);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "lockIntegerScaling", opts->lockIntegerScaling);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "resampleVideo", opts->resampleVideo);
@@ -0,0 +1,425 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/core-pool.h>
+
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba-util/vector.h>
+#include <mgba-util/vfs.h>
+
+#define HIBERNATION_MAGIC 0x4249484D
+#define HIBERNATION_MIN_ZERO_RUN 8
+
+DECLARE_VECTOR(mCorePoolCoreList, struct mCore*);
+DEFINE_VECTOR(mCorePoolCoreList, struct mCore*);
+
+struct mCorePoolROM {
+	struct mCorePool* pool;
+	uint32_t crc32;
+	// Holds the ROM in the cache, so new cores for it never read the file again
+	struct VFile* vf;
+	// Saved from the first core after reset; never changes afterwards
+	void* baseline;
+	void* sram;
+	size_t sramSize;
+	struct mCorePoolCoreList idle;
+};
+
+// Each delta is a list of runs, every one a count of unchanged bytes followed by a count of
+// changed bytes, both little-endian, and then the changed bytes XORed with the originals
+struct mCoreHibernationDelta {
+	uint8_t* data;
+	uint32_t size;
+	uint32_t decodedSize;
+};
+
+struct mCoreHibernation {
+	uint32_t crc32;
+	struct mCoreHibernationDelta state;
+	struct mCoreHibernationDelta sram;
+};
+
+static inline void _lock(struct mCorePool* pool) {
+#ifndef DISABLE_THREADING
+	MutexLock(&pool->mutex);
+#else
+	UNUSED(pool);
+#endif
+}
+
+static inline void _unlock(struct mCorePool* pool) {
+#ifndef DISABLE_THREADING
+	MutexUnlock(&pool->mutex);
+#else
+	UNUSED(pool);
+#endif
+}
+
+static void _destroyCore(struct mCorePool* pool, struct mCore* core) {
+	if (pool->teardown) {
+		pool->teardown(pool, core);
+	}
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+static void _romDeinit(void* value) {
+	struct mCorePoolROM* rom = value;
+	size_t i;
+	for (i = 0; i < mCorePoolCoreListSize(&rom->idle); ++i) {
+		_destroyCore(rom->pool, *mCorePoolCoreListGetPointer(&rom->idle, i));
+	}
+	mCorePoolCoreListDeinit(&rom->idle);
+	rom->vf->close(rom->vf);
+	free(rom->baseline);
+	free(rom->sram);
+	free(rom);
+}
+
+static struct mCorePoolROM* _lookupCore(struct mCorePool* pool, struct mCore* core) {
+	uint32_t crc32;
+	core->checksum(core, &crc32, CHECKSUM_CRC32);
+	_lock(pool);
+	struct mCorePoolROM* rom = TableLookup(&pool->roms, crc32);
+	_unlock(pool);
+	return rom;
+}
+
+static void _restore(struct mCorePoolROM* rom, struct mCore* core) {
+	// Savestates don't carry save data, so put that back first; loading the state then restores
+	// the save chip's own registers on top of it
+	if (rom->sramSize) {
+		void* sram;
+		size_t size = core->savedataClone(core, &sram);
+		if (size != rom->sramSize || memcmp(sram, rom->sram, size) != 0) {
+			core->savedataRestore(core, rom->sram, rom->sramSize, false);
+		}
+		free(sram);
+	}
+	core->loadState(core, rom->baseline);
+	core->setKeys(core, 0);
+}
+
+static struct mCore* _createCore(struct mCorePool* pool, struct VFile* vf) {
+	struct mCore* core = mCoreFindVF(vf);
+	if (!core) {
+		vf->close(vf);
+		return NULL;
+	}
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	if (pool->setup) {
+		pool->setup(pool, core);
+	}
+	if (!core->loadROM(core, vf)) {
+		vf->close(vf);
+		_destroyCore(pool, core);
+		return NULL;
+	}
+	mCoreLoadForeignConfig(core, &core->config);
+	core->reset(core);
+	return core;
+}
+
+void mCorePoolInit(struct mCorePool* pool) {
+	memset(pool, 0, sizeof(*pool));
+	mROMCacheInit(&pool->romCache);
+	TableInit(&pool->roms, 0, _romDeinit);
+#ifndef DISABLE_THREADING
+	MutexInit(&pool->mutex);
+#endif
+}
+
+void mCorePoolDeinit(struct mCorePool* pool) {
+	// The ROMs' references into the cache have to go before the cache itself
+	TableDeinit(&pool->roms);
+	mROMCacheDeinit(&pool->romCache);
+#ifndef DISABLE_THREADING
+	MutexDeinit(&pool->mutex);
+#endif
+}
+
+struct mCore* mCorePoolAcquire(struct mCorePool* pool, struct VFile* vf) {
+	vf = mROMCacheOpen(&pool->romCache, vf);
+	if (!vf) {
+		return NULL;
+	}
+	uint32_t crc32;
+	if (!mROMCacheGetCRC32(vf, &crc32)) {
+		// Without a shared copy there is nothing to key this ROM's cores by
+		vf->close(vf);
+		return NULL;
+	}
+
+	_lock(pool);
+	struct mCorePoolROM* rom = TableLookup(&pool->roms, crc32);
+	if (!rom) {
+		rom = calloc(1, sizeof(*rom));
+		rom->pool = pool;
+		rom->crc32 = crc32;
+		rom->vf = vf;
+		vf = NULL;
+		mCorePoolCoreListInit(&rom->idle, 0);
+		TableInsert(&pool->roms, crc32, rom);
+	}
+	_unlock(pool);
+	if (vf) {
+		vf->close(vf);
+	}
+	return mCorePoolAcquireCRC32(pool, crc32);
+}
+
+struct mCore* mCorePoolAcquireCRC32(struct mCorePool* pool, uint32_t crc32) {
+	_lock(pool);
+	struct mCorePoolROM* rom = TableLookup(&pool->roms, crc32);
+	struct mCore* core = NULL;
+	if (rom && mCorePoolCoreListSize(&rom->idle)) {
+		size_t last = mCorePoolCoreListSize(&rom->idle) - 1;
+		core = *mCorePoolCoreListGetPointer(&rom->idle, last);
+		mCorePoolCoreListResize(&rom->idle, -1);
+	}
+	_unlock(pool);
+	if (!rom) {
+		return NULL;
+	}
+	if (core) {
+		_restore(rom, core);
+		return core;
+	}
+
+	core = _createCore(pool, mROMCacheOpenCRC32(&pool->romCache, crc32));
+	if (!core) {
+		return NULL;
+	}
+	bool captured = false;
+	_lock(pool);
+	if (!rom->baseline) {
+		rom->baseline = malloc(core->stateSize(core));
+		core->saveState(core, rom->baseline);
+		rom->sramSize = core->savedataClone(core, &rom->sram);
+		captured = true;
+	}
+	_unlock(pool);
+	if (!captured) {
+		// Another core got here first, and every core has to start from the same state
+		_restore(rom, core);
+	}
+	return core;
+}
+
+void mCorePoolRelease(struct mCorePool* pool, struct mCore* core) {
+	struct mCorePoolROM* rom = _lookupCore(pool, core);
+	bool kept = false;
+	if (rom) {
+		_lock(pool);
+		if (!pool->maxIdle || mCorePoolCoreListSize(&rom->idle) < pool->maxIdle) {
+			*mCorePoolCoreListAppend(&rom->idle) = core;
+			kept = true;
+		}
+		_unlock(pool);
+	}
+	if (!kept) {
+		_destroyCore(pool, core);
+	}
+}
+
+bool mCorePoolResetCore(struct mCorePool* pool, struct mCore* core) {
+	struct mCorePoolROM* rom = _lookupCore(pool, core);
+	if (!rom) {
+		return false;
+	}
+	_restore(rom, core);
+	return true;
+}
+
+static void _put32(uint8_t* out, uint32_t value) {
+	out[0] = value;
+	out[1] = value >> 8;
+	out[2] = value >> 16;
+	out[3] = value >> 24;
+}
+
+static uint32_t _get32(const uint8_t* in) {
+	return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t) in[3] << 24);
+}
+
+static inline uint8_t _diff(const uint8_t* data, const uint8_t* base, size_t i) {
+	return base ? data[i] ^ base[i] : data[i];
+}
+
+static void _encodeDelta(struct mCoreHibernationDelta* delta, const uint8_t* data, const uint8_t* base, size_t size) {
+	// A run is at least HIBERNATION_MIN_ZERO_RUN unchanged bytes plus one changed byte, so its
+	// header can never make the encoding more than twice as large
+	uint8_t* out = malloc(size * 2 + 16);
+	size_t length = 0;
+	size_t i = 0;
+	do {
+		size_t start = i;
+		while (i < size && !_diff(data, base, i)) {
+			++i;
+		}
+		size_t changed = i;
+		while (i < size) {
+			if (_diff(data, base, i)) {
+				++i;
+				continue;
+			}
+			size_t zeroes = i;
+			while (zeroes < size && !_diff(data, base, zeroes)) {
+				++zeroes;
+			}
+			if (zeroes == size || zeroes - i >= HIBERNATION_MIN_ZERO_RUN) {
+				break;
+			}
+			i = zeroes;
+		}
+		_put32(&out[length], changed - start);
+		_put32(&out[length + 4], i - changed);
+		length += 8;
+		for (; changed < i; ++changed) {
+			out[length] = _diff(data, base, changed);
+			++length;
+		}
+	} while (i < size);
+	delta->data = realloc(out, length);
+	delta->size = length;
+	delta->decodedSize = size;
+}
+
+static bool _decodeDelta(const struct mCoreHibernationDelta* delta, uint8_t* out, const uint8_t* base) {
+	if (base) {
+		memcpy(out, base, delta->decodedSize);
+	} else {
+		memset(out, 0, delta->decodedSize);
+	}
+	size_t position = 0;
+	size_t i = 0;
+	while (i < delta->size) {
+		if (delta->size - i < 8) {
+			return false;
+		}
+		uint32_t unchanged = _get32(&delta->data[i]);
+		uint32_t changed = _get32(&delta->data[i + 4]);
+		i += 8;
+		if (unchanged > delta->decodedSize - position || changed > delta->decodedSize - position - unchanged || changed > delta->size - i) {
+			return false;
+		}
+		position += unchanged;
+		for (; changed; --changed, ++position, ++i) {
+			out[position] ^= delta->data[i];
+		}
+	}
+	return true;
+}
+
+struct mCoreHibernation* mCorePoolHibernate(struct mCorePool* pool, struct mCore* core) {
+	struct mCorePoolROM* rom = _lookupCore(pool, core);
+	if (!rom || !rom->baseline) {
+		return NULL;
+	}
+	size_t stateSize = core->stateSize(core);
+	void* state = malloc(stateSize);
+	if (!core->saveState(core, state)) {
+		free(state);
+		return NULL;
+	}
+	struct mCoreHibernation* hibernation = calloc(1, sizeof(*hibernation));
+	hibernation->crc32 = rom->crc32;
+	_encodeDelta(&hibernation->state, state, rom->baseline, stateSize);
+	free(state);
+
+	void* sram;
+	size_t sramSize = core->savedataClone(core, &sram);
+	if (sramSize) {
+		_encodeDelta(&hibernation->sram, sram, sramSize == rom->sramSize ? rom->sram : NULL, sramSize);
+	}
+	free(sram);
+
+	mCorePoolRelease(pool, core);
+	return hibernation;
+}
+
+struct mCore* mCorePoolWake(struct mCorePool* pool, struct mCoreHibernation* hibernation) {
+	struct mCore* core = mCorePoolAcquireCRC32(pool, hibernation->crc32);
+	if (!core) {
+		mCoreHibernationFree(hibernation);
+		return NULL;
+	}
+	// The core starts from the snapshot, so the ROM is known and has a baseline
+	struct mCorePoolROM* rom = _lookupCore(pool, core);
+	bool success = hibernation->state.decodedSize == core->stateSize(core);
+	if (success && hibernation->sram.decodedSize) {
+		uint8_t* sram = malloc(hibernation->sram.decodedSize);
+		success = _decodeDelta(&hibernation->sram, sram, hibernation->sram.decodedSize == rom->sramSize ? rom->sram : NULL);
+		if (success) {
+			core->savedataRestore(core, sram, hibernation->sram.decodedSize, false);
+		}
+		free(sram);
+	}
+	if (success) {
+		uint8_t* state = malloc(hibernation->state.decodedSize);
+		success = _decodeDelta(&hibernation->state, state, rom->baseline) && core->loadState(core, state);
+		free(state);
+	}
+	mCoreHibernationFree(hibernation);
+	if (!success) {
+		mCorePoolRelease(pool, core);
+		return NULL;
+	}
+	return core;
+}
+
+void mCoreHibernationFree(struct mCoreHibernation* hibernation) {
+	free(hibernation->state.data);
+	free(hibernation->sram.data);
+	free(hibernation);
+}
+
+size_t mCoreHibernationSize(const struct mCoreHibernation* hibernation) {
+	return sizeof(*hibernation) + hibernation->state.size + hibernation->sram.size;
+}
+
+uint32_t mCoreHibernationCRC32(const struct mCoreHibernation* hibernation) {
+	return hibernation->crc32;
+}
+
+bool mCoreHibernationSave(const struct mCoreHibernation* hibernation, struct VFile* vf) {
+	uint8_t header[24];
+	_put32(&header[0], HIBERNATION_MAGIC);
+	_put32(&header[4], hibernation->crc32);
+	_put32(&header[8], hibernation->state.decodedSize);
+	_put32(&header[12], hibernation->state.size);
+	_put32(&header[16], hibernation->sram.decodedSize);
+	_put32(&header[20], hibernation->sram.size);
+	return vf->write(vf, header, sizeof(header)) == sizeof(header) &&
+	       vf->write(vf, hibernation->state.data, hibernation->state.size) == (ssize_t) hibernation->state.size &&
+	       vf->write(vf, hibernation->sram.data, hibernation->sram.size) == (ssize_t) hibernation->sram.size;
+}
+
+static bool _loadDelta(struct mCoreHibernationDelta* delta, struct VFile* vf) {
+	delta->data = malloc(delta->size ? delta->size : 1);
+	return vf->read(vf, delta->data, delta->size) == (ssize_t) delta->size;
+}
+
+struct mCoreHibernation* mCoreHibernationLoad(struct VFile* vf) {
+	uint8_t header[24];
+	if (vf->read(vf, header, sizeof(header)) != sizeof(header) || _get32(&header[0]) != HIBERNATION_MAGIC) {
+		return NULL;
+	}
+	struct mCoreHibernation* hibernation = calloc(1, sizeof(*hibernation));
+	hibernation->crc32 = _get32(&header[4]);
+	hibernation->state.decodedSize = _get32(&header[8]);
+	hibernation->state.size = _get32(&header[12]);
+	hibernation->sram.decodedSize = _get32(&header[16]);
+	hibernation->sram.size = _get32(&header[20]);
+	ssize_t size = vf->size(vf);
+	if (size < 0 || (uint64_t) hibernation->state.size + hibernation->sram.size > (uint64_t) size ||
+	    !_loadDelta(&hibernation->state, vf) || !_loadDelta(&hibernation->sram, vf)) {
+		mCoreHibernationFree(hibernation);
+		return NULL;
+	}
+	return hibernation;
+}
@@ -5,9 +5,11 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/core/core.h>
 
+#include <mgba/core/async-writer.h>
 #include <mgba/core/cheats.h>
 #include <mgba/core/log.h>
 #include <mgba/core/serialize.h>
+#include <mgba-util/crc32.h>
 #include <mgba-util/vfs.h>
 #include <mgba/internal/debugger/symbols.h>
 
@@ -31,15 +33,16 @@
 static const struct mCoreFilter {
 	bool (*filter)(struct VFile*);
 	struct mCore* (*open)(void);
+	bool (*identify)(struct VFile*, char* title, char* code);
 	enum mPlatform platform;
 } _filters[] = {
 #ifdef M_CORE_GBA
-	{ GBAIsROM, GBACoreCreate, PLATFORM_GBA },
+	{ GBAIsROM, GBACoreCreate, GBAIdentifyROM, PLATFORM_GBA },
 #endif
 #ifdef M_CORE_GB
-	{ GBIsROM, GBCoreCreate, PLATFORM_GB },
+	{ GBIsROM, GBCoreCreate, GBIdentifyROM, PLATFORM_GB },
 #endif
-	{ 0, 0, PLATFORM_NONE }
+	{ 0, 0, 0, PLATFORM_NONE }
 };
 
 struct mCore* mCoreFindVF(struct VFile* vf) {
@@ -74,9 +77,34 @@ enum mPlatform mCoreIsCompatible(struct VFile* vf) {
 	return PLATFORM_NONE;
 }
 
+bool mCoreIdentifyVF(struct VFile* vf, struct mCoreRomInfo* info) {
+	memset(info, 0, sizeof(*info));
+	info->platform = PLATFORM_NONE;
+	if (!vf) {
+		return false;
+	}
+	const struct mCoreFilter* filter;
+	for (filter = &_filters[0]; filter->filter; ++filter) {
+		if (filter->filter(vf)) {
+			break;
+		}
+	}
+	if (!filter->identify || !filter->identify(vf, info->title, info->code)) {
+		return false;
+	}
+	info->platform = filter->platform;
+	info->size = vf->size(vf);
+	info->crc32 = fileCrc32(vf, info->size);
+	return true;
+}
+
 #if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
 #include <mgba-util/png-io.h>
 
+#ifdef USE_PNG
+#include <zlib.h>
+#endif
+
 #ifdef PSP2
 #include <psp2/photoexport.h>
 #endif
@@ -189,8 +217,7 @@ bool mCoreSaveState(struct mCore* core, int slot, int flags) {
 	if (!vf) {
 		return false;
 	}
-	bool success = mCoreSaveStateNamed(core, vf, flags);
-	vf->close(vf);
+	bool success = mCoreSaveStateNamedDeferred(core, vf, flags);
 	if (success) {
 		mLOG(STATUS, INFO, "State %i saved", slot);
 	} else {
@@ -217,6 +244,9 @@ bool mCoreLoadState(struct mCore* core, int slot, int flags) {
 }
 
 struct VFile* mCoreGetState(struct mCore* core, int slot, bool write) {
+	if (core->asyncWriter) {
+		mAsyncWriterFlush(core->asyncWriter);
+	}
 	char name[PATH_MAX + 14]; // Quash warning
 	snprintf(name, sizeof(name), "%s.ss%i", core->dirs.baseName, slot);
 	return core->dirs.state->openFile(core->dirs.state, name, write ? (O_CREAT | O_TRUNC | O_RDWR) : O_RDONLY);
@@ -228,12 +258,66 @@ void mCoreDeleteState(struct mCore* core, int slot) {
 	core->dirs.state->deleteFile(core->dirs.state, name);
 }
 
+#ifdef USE_PNG
+static bool _writeScreenshot(struct VFile* vf, unsigned width, unsigned height, size_t stride, const void* pixels, int level) {
+	png_structp png = PNGWriteOpen(vf);
+	png_infop info = PNGWriteHeader(png, width, height);
+	if (!png || !info) {
+		PNGWriteClose(png, info);
+		return false;
+	}
+	png_set_compression_level(png, level);
+	bool success = PNGWritePixels(png, width, height, stride, pixels);
+	PNGWriteClose(png, info);
+	return success;
+}
+
+#ifndef PSP2
+struct mScreenshotJob {
+	struct mAsyncWriterJob d;
+	struct VFile* vf;
+	unsigned width;
+	unsigned height;
+	int level;
+	color_t pixels[];
+};
+
+static void _writeScreenshotJob(struct mAsyncWriterJob* writerJob) {
+	struct mScreenshotJob* job = (struct mScreenshotJob*) writerJob;
+	if (!_writeScreenshot(job->vf, job->width, job->height, job->width, job->pixels, job->level)) {
+		mLOG(STATUS, WARN, "Failed to take screenshot");
+	}
+	job->vf->close(job->vf);
+	free(job);
+}
+
+static bool _queueScreenshot(struct mCore* core, struct VFile* vf, unsigned width, unsigned height, size_t stride, const void* pixels, int level) {
+	struct mScreenshotJob* job = malloc(sizeof(*job) + width * height * BYTES_PER_PIXEL);
+	if (!job) {
+		return false;
+	}
+	unsigned y;
+	for (y = 0; y < height; ++y) {
+		memcpy(&job->pixels[y * width], (const uint8_t*) pixels + y * stride * BYTES_PER_PIXEL, width * BYTES_PER_PIXEL);
+	}
+	job->d.run = _writeScreenshotJob;
+	job->vf = vf;
+	job->width = width;
+	job->height = height;
+	job->level = level;
+	mAsyncWriterSubmit(core->asyncWriter, &job->d);
+	return true;
+}
+#endif
+#endif
+
 void mCoreTakeScreenshot(struct mCore* core) {
 #ifdef USE_PNG
 	size_t stride;
 	const void* pixels = 0;
 	unsigned width, height;
 	core->desiredVideoDimensions(core, &width, &height);
+	int level = core->opts.fastCompression ? Z_BEST_SPEED : Z_DEFAULT_COMPRESSION;
 	struct VFile* vf;
 #ifndef PSP2
 	vf = VDirFindNextAvailable(core->dirs.screenshot, core->dirs.baseName, "-", ".png", O_CREAT | O_TRUNC | O_WRONLY);
@@ -242,11 +326,17 @@ void mCoreTakeScreenshot(struct mCore* core) {
 #endif
 	bool success = false;
 	if (vf) {
-		core->getPixels(core, &pixels, &stride);
-		png_structp png = PNGWriteOpen(vf);
-		png_infop info = PNGWriteHeader(png, width, height);
-		success = PNGWritePixels(png, width, height, stride, pixels);
-		PNGWriteClose(png, info);
+		void* converted;
+		mCoreGetNativePixels(core, &pixels, &stride, &converted);
+#ifndef PSP2
+		if (pixels && core->asyncWriter && _queueScreenshot(core, vf, width, height, stride, pixels, level)) {
+			free(converted);
+			mLOG(STATUS, INFO, "Screenshot saved");
+			return;
+		}
+#endif
+		success = pixels && _writeScreenshot(vf, width, height, stride, pixels, level);
+		free(converted);
 #ifdef PSP2
 		void* data = vf->map(vf, 0, 0);
 		PhotoExportParam param = {
@@ -271,6 +361,55 @@ void mCoreTakeScreenshot(struct mCore* core) {
 }
 #endif
 
+bool mCoreGetNativePixels(struct mCore* core, const void** pixels, size_t* stride, void** converted) {
+	*converted = NULL;
+	*pixels = NULL;
+	core->getPixels(core, pixels, stride);
+	if (!*pixels) {
+		return false;
+	}
+	if (core->videoBufferFormat && (core->videoBufferFormat(core) & mCOLOR_TILED_4X4)) {
+		unsigned width, height;
+		core->desiredVideoDimensions(core, &width, &height);
+		color_t* buffer = malloc(width * height * BYTES_PER_PIXEL);
+		if (!buffer) {
+			return false;
+		}
+		const color_t* source = *pixels;
+		unsigned x, y;
+		for (y = 0; y < height; ++y) {
+			for (x = 0; x < width; ++x) {
+				buffer[y * width + x] = source[mColorTiledOffset(*stride, x, y)];
+			}
+		}
+		*pixels = buffer;
+		*stride = width;
+		*converted = buffer;
+		return true;
+	}
+#ifndef COLOR_16_BIT
+	if (core->videoBufferFormat && core->videoBufferFormat(core) == mCOLOR_RGB565) {
+		unsigned width, height;
+		core->desiredVideoDimensions(core, &width, &height);
+		color_t* buffer = malloc(width * height * BYTES_PER_PIXEL);
+		if (!buffer) {
+			return false;
+		}
+		const uint16_t* source = *pixels;
+		unsigned x, y;
+		for (y = 0; y < height; ++y) {
+			for (x = 0; x < width; ++x) {
+				buffer[y * width + x] = mColorFromRGB565(source[y * *stride + x]);
+			}
+		}
+		*pixels = buffer;
+		*stride = width;
+		*converted = buffer;
+	}
+#endif
+	return true;
+}
+
 void mCoreInitConfig(struct mCore* core, const char* port) {
 	mCoreConfigInit(&core->config, port);
 }
@@ -348,20 +487,44 @@ bool mCoreLoadELF(struct mCore* core, struct ELF* elf) {
 void mCoreLoadELFSymbols(struct mDebuggerSymbols* symbols, struct ELF* elf) {
 	size_t symIndex = ELFFindSection(elf, ".symtab");
 	size_t names = ELFFindSection(elf, ".strtab");
+	if (!symIndex || !names) {
+		return;
+	}
 	Elf32_Shdr* symHeader = ELFGetSectionHeader(elf, symIndex);
-	char* bytes = ELFBytes(elf, NULL);
+	Elf32_Shdr* nameHeader = ELFGetSectionHeader(elf, names);
+	size_t esize;
+	char* bytes = ELFBytes(elf, &esize);
+	if (!symHeader || !nameHeader || symHeader->sh_offset > esize || symHeader->sh_size > esize - symHeader->sh_offset ||
+	    nameHeader->sh_offset > esize || nameHeader->sh_size > esize - nameHeader->sh_offset) {
+		return;
+	}
+
+	// The file is already mapped, so names are read straight out of the string table instead
+	// of going through libelf for every symbol. It only has to end in a terminator for any
+	// offset into it to be a valid string.
+	const char* strtab = &bytes[nameHeader->sh_offset];
+	if (!nameHeader->sh_size || strtab[nameHeader->sh_size - 1]) {
+		return;
+	}
 
 	Elf32_Sym* syms = (Elf32_Sym*) &bytes[symHeader->sh_offset];
+	size_t nSyms = symHeader->sh_size / sizeof(*syms);
+	mDebuggerSymbolTableReserve(symbols, nSyms);
 	size_t i;
-	for (i = 0; i * sizeof(*syms) < symHeader->sh_size; ++i) {
-		if (!syms[i].st_name || ELF32_ST_TYPE(syms[i].st_info) == STT_FILE) {
+	for (i = 0; i < nSyms; ++i) {
+		if (!syms[i].st_name || syms[i].st_name >= nameHeader->sh_size || ELF32_ST_TYPE(syms[i].st_info) == STT_FILE) {
 			continue;
 		}
-		const char* name = ELFGetString(elf, names, syms[i].st_name);
+		const char* name = &strtab[syms[i].st_name];
 		if (name[0] == '$') {
 			continue;
 		}
-		mDebuggerSymbolAdd(symbols, name, syms[i].st_value, -1);
+		uint32_t value = syms[i].st_value;
+		if (ELF32_ST_TYPE(syms[i].st_info) == STT_FUNC) {
+			// The low bit of a function address marks it as Thumb code
+			value &= ~1;
+		}
+		mDebuggerSymbolAddSized(symbols, name, value, -1, syms[i].st_size);
 	}
 }
 #endif
@@ -7,9 +7,30 @@
 
 #include <mgba/core/core.h>
 #include <mgba/core/serialize.h>
+#include <mgba-util/vfs.h>
 
 DEFINE_VECTOR(mCoreCallbacksList, struct mCoreCallbacks);
 
+// How much emulated time the host clock is extrapolated across before it's read again
+#define RTC_RESYNC_SECONDS 60
+
+static time_t _rtcHostTime(struct mRTCGenericSource* rtc) {
+	struct mCore* core = rtc->p;
+	uint32_t frame = core->frameCounter(core);
+	int64_t elapsed = 0;
+	if (rtc->anchored) {
+		// Resets and loaded states move the frame counter backwards, which will look like a huge jump here
+		elapsed = (uint32_t) (frame - rtc->anchorFrame) * (int64_t) core->frameCycles(core) / core->frequency(core);
+	}
+	if (!rtc->anchored || elapsed >= RTC_RESYNC_SECONDS) {
+		rtc->anchorTime = time(0);
+		rtc->anchorFrame = frame;
+		rtc->anchored = true;
+		elapsed = 0;
+	}
+	return rtc->anchorTime + elapsed;
+}
+
 static void _rtcGenericSample(struct mRTCSource* source) {
 	struct mRTCGenericSource* rtc = (struct mRTCGenericSource*) source;
 	switch (rtc->override) {
@@ -34,7 +55,7 @@ static time_t _rtcGenericCallback(struct mRTCSource* source) {
 		}
 		// Fall through
 	case RTC_NO_OVERRIDE:
-		return time(0);
+		return _rtcHostTime(rtc);
 	case RTC_FIXED:
 		return rtc->value / 1000LL;
 	case RTC_FAKE_EPOCH:
@@ -94,6 +115,7 @@ static bool _rtcGenericDeserialize(struct mRTCSource* source, const struct mStat
 	}
 	rtc->value = state->value;
 	rtc->override = state->type;
+	rtc->anchored = false;
 	return true;
 }
 
@@ -101,8 +123,108 @@ void mRTCGenericSourceInit(struct mRTCGenericSource* rtc, struct mCore* core) {
 	rtc->p = core;
 	rtc->override = RTC_NO_OVERRIDE;
 	rtc->value = 0;
+	rtc->anchored = false;
+	rtc->anchorTime = 0;
+	rtc->anchorFrame = 0;
 	rtc->d.sample = _rtcGenericSample;
 	rtc->d.unixTime = _rtcGenericCallback;
 	rtc->d.serialize = _rtcGenericSerialize;
 	rtc->d.deserialize = _rtcGenericDeserialize;
 }
+
+void mCoreMemoryDirtyInit(struct mCoreMemoryDirty* dirty, size_t size) {
+	dirty->nPages = (size + mCORE_MEMORY_DIRTY_PAGE_SIZE - 1) >> mCORE_MEMORY_DIRTY_PAGE_SHIFT;
+	dirty->bitmap = calloc((dirty->nPages + 31) >> 5, sizeof(*dirty->bitmap));
+	// Nothing is known about the contents yet, so every page starts dirty
+	mCoreMemoryDirtyMarkAll(dirty);
+}
+
+void mCoreMemoryDirtyDeinit(struct mCoreMemoryDirty* dirty) {
+	free(dirty->bitmap);
+	dirty->bitmap = NULL;
+	dirty->nPages = 0;
+}
+
+void mCoreMemoryDirtyClear(struct mCoreMemoryDirty* dirty) {
+	if (dirty->bitmap) {
+		memset(dirty->bitmap, 0, ((dirty->nPages + 31) >> 5) * sizeof(*dirty->bitmap));
+	}
+}
+
+void mCoreMemoryDirtyMarkAll(struct mCoreMemoryDirty* dirty) {
+	if (!dirty->bitmap) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < dirty->nPages >> 5; ++i) {
+		dirty->bitmap[i] = 0xFFFFFFFF;
+	}
+	if (dirty->nPages & 0x1F) {
+		dirty->bitmap[i] = (1U << (dirty->nPages & 0x1F)) - 1;
+	}
+}
+
+void mCoreMemoryDirtyMarkRange(struct mCoreMemoryDirty* dirty, uint32_t offset, uint32_t size) {
+	if (!size) {
+		return;
+	}
+	uint32_t page;
+	for (page = offset >> mCORE_MEMORY_DIRTY_PAGE_SHIFT; page <= (offset + size - 1) >> mCORE_MEMORY_DIRTY_PAGE_SHIFT; ++page) {
+		mCoreMemoryDirtyMark(dirty, page << mCORE_MEMORY_DIRTY_PAGE_SHIFT);
+	}
+}
+
+size_t mCoreMemoryDirtyRestore(struct mCoreMemoryDirty* dirty, void* dest, const void* src, size_t size) {
+	uint8_t* out = dest;
+	const uint8_t* in = src;
+	size_t copied = 0;
+	size_t offset;
+	for (offset = 0; offset < size; offset += mCORE_MEMORY_DIRTY_PAGE_SIZE) {
+		size_t length = size - offset;
+		if (length > mCORE_MEMORY_DIRTY_PAGE_SIZE) {
+			length = mCORE_MEMORY_DIRTY_PAGE_SIZE;
+		}
+		if (!memcmp(&out[offset], &in[offset], length)) {
+			continue;
+		}
+		memcpy(&out[offset], &in[offset], length);
+		mCoreMemoryDirtyMark(dirty, offset);
+		++copied;
+	}
+	return copied;
+}
+
+uint32_t mSavedataSectorRange(uint32_t offset, uint32_t size) {
+	if (!size) {
+		return 0;
+	}
+	uint32_t first = mSavedataSector(offset);
+	uint32_t last = mSavedataSector(offset + size - 1);
+	return (last - first) | last;
+}
+
+bool mSavedataSyncSectors(struct VFile* vf, const uint8_t* data, size_t size, uint32_t sectors) {
+	bool success = true;
+	int sector = 0;
+	while (sectors && sector < 32) {
+		if (!(sectors & (1U << sector))) {
+			++sector;
+			continue;
+		}
+		int end = sector;
+		while (end < 32 && (sectors & (1U << end))) {
+			sectors &= ~(1U << end);
+			++end;
+		}
+		size_t start = (size_t) sector << mSAVEDATA_SECTOR_SHIFT;
+		size_t stop = end < 32 ? (size_t) end << mSAVEDATA_SECTOR_SHIFT : size;
+		if (stop > size) {
+			stop = size;
+		}
+		if (start < stop && !vf->sync(vf, &data[start], stop - start)) {
+			success = false;
+		}
+		sector = end;
+	}
+	return success;
+}
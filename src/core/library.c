@@ -6,15 +6,52 @@
 #include <mgba/core/library.h>
 
 #include <mgba/core/core.h>
+#ifndef MINIMAL_CORE
+#include <mgba/feature/video-logger.h>
+#endif
+#include <mgba-util/table.h>
+#include <mgba-util/threading.h>
 #include <mgba-util/vfs.h>
 
 #ifdef USE_SQLITE3
 
 #include <sqlite3.h>
+#include <sys/stat.h>
 #include "feature/sqlite3/no-intro.h"
 
+#define SCAN_THREADS 4
+
 DEFINE_VECTOR(mLibraryListing, struct mLibraryEntry);
 
+enum mLibraryScanResult {
+	SCAN_NOT_ROM,
+	SCAN_IDENTIFIED,
+	SCAN_NEEDS_CORE,
+};
+
+struct mLibraryScanJob {
+	char* filename;
+	int64_t mtime;
+	struct mLibraryEntry entry;
+	enum mLibraryScanResult result;
+};
+
+DECLARE_VECTOR(mLibraryScanJobs, struct mLibraryScanJob);
+DEFINE_VECTOR(mLibraryScanJobs, struct mLibraryScanJob);
+
+struct mLibraryScanContext {
+	struct VDir* dir;
+	struct mLibraryScanJobs* jobs;
+	size_t nextJob;
+	Mutex mutex;
+};
+
+struct mLibraryKnownPath {
+	int64_t mtime;
+	size_t size;
+	bool current;
+};
+
 struct mLibrary {
 	sqlite3* db;
 	sqlite3_stmt* insertPath;
@@ -22,6 +59,9 @@ struct mLibrary {
 	sqlite3_stmt* insertRoot;
 	sqlite3_stmt* selectRom;
 	sqlite3_stmt* selectRoot;
+	sqlite3_stmt* selectRootMtime;
+	sqlite3_stmt* selectPaths;
+	sqlite3_stmt* updateRoot;
 	sqlite3_stmt* deletePath;
 	sqlite3_stmt* deleteRoot;
 	sqlite3_stmt* count;
@@ -41,8 +81,8 @@ struct mLibrary {
 	"CASE WHEN :useRoot THEN roots.path = :root ELSE 1 END"
 
 static void _mLibraryDeleteEntry(struct mLibrary* library, struct mLibraryEntry* entry);
-static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry* entry);
-static void _mLibraryAddEntry(struct mLibrary* library, const char* filename, const char* base, struct VFile* vf);
+static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry* entry, int64_t mtime);
+static void _mLibraryAddEntry(struct mLibrary* library, const char* filename, const char* base, struct VFile* vf, int64_t mtime);
 
 static void _bindConstraints(sqlite3_stmt* statement, const struct mLibraryEntry* constraints) {
 	if (!constraints) {
@@ -146,7 +186,7 @@ struct mLibrary* mLibraryLoad(const char* path) {
 		goto error;
 	}
 
-	static const char insertPath[] = "INSERT INTO paths (romid, path, customTitle, rootid) VALUES (?, ?, ?, ?);";
+	static const char insertPath[] = "INSERT INTO paths (romid, path, customTitle, rootid, mtime) VALUES (?, ?, ?, ?, ?);";
 	if (sqlite3_prepare_v2(library->db, insertPath, -1, &library->insertPath, NULL)) {
 		goto error;
 	}
@@ -166,7 +206,12 @@ struct mLibrary* mLibraryLoad(const char* path) {
 		goto error;
 	}
 
-	static const char deletePath[] = "DELETE FROM paths WHERE path = ?;";
+	static const char updateRoot[] = "UPDATE roots SET mtime = ? WHERE path = ?;";
+	if (sqlite3_prepare_v2(library->db, updateRoot, -1, &library->updateRoot, NULL)) {
+		goto error;
+	}
+
+	static const char deletePath[] = "DELETE FROM paths WHERE path = ? AND rootid = (SELECT rootid FROM roots WHERE path = ?);";
 	if (sqlite3_prepare_v2(library->db, deletePath, -1, &library->deletePath, NULL)) {
 		goto error;
 	}
@@ -181,6 +226,16 @@ struct mLibrary* mLibraryLoad(const char* path) {
 		goto error;
 	}
 
+	static const char selectRootMtime[] = "SELECT mtime FROM roots WHERE path = ?;";
+	if (sqlite3_prepare_v2(library->db, selectRootMtime, -1, &library->selectRootMtime, NULL)) {
+		goto error;
+	}
+
+	static const char selectPaths[] = "SELECT paths.path, paths.mtime, roms.size FROM paths JOIN roots USING (rootid) JOIN roms USING (romid) WHERE roots.path = ?;";
+	if (sqlite3_prepare_v2(library->db, selectPaths, -1, &library->selectPaths, NULL)) {
+		goto error;
+	}
+
 	static const char count[] = "SELECT count(pathid) FROM paths JOIN roots USING (rootid) JOIN roms USING (romid) WHERE " CONSTRAINTS ";";
 	if (sqlite3_prepare_v2(library->db, count, -1, &library->count, NULL)) {
 		goto error;
@@ -206,16 +261,163 @@ void mLibraryDestroy(struct mLibrary* library) {
 	sqlite3_finalize(library->deleteRoot);
 	sqlite3_finalize(library->selectRom);
 	sqlite3_finalize(library->selectRoot);
+	sqlite3_finalize(library->selectRootMtime);
+	sqlite3_finalize(library->selectPaths);
+	sqlite3_finalize(library->updateRoot);
 	sqlite3_finalize(library->select);
 	sqlite3_finalize(library->count);
 	sqlite3_close(library->db);
 	free(library);
 }
 
+static bool _statFile(const char* base, const char* filename, size_t* size, int64_t* mtime) {
+	char path[PATH_MAX];
+	if (filename) {
+		snprintf(path, sizeof(path), "%s" PATH_SEP "%s", base, filename);
+	} else {
+		strncpy(path, base, sizeof(path) - 1);
+		path[sizeof(path) - 1] = '\0';
+	}
+	struct stat sb;
+	if (stat(path, &sb) < 0) {
+		return false;
+	}
+	*size = sb.st_size;
+	*mtime = sb.st_mtime;
+	return true;
+}
+
+static enum mLibraryScanResult _identifyFile(struct VFile* vf, struct mLibraryEntry* entry) {
+	memset(entry, 0, sizeof(*entry));
+	struct mCoreRomInfo info;
+	if (!mCoreIdentifyVF(vf, &info)) {
+		if (mCoreIsCompatible(vf) != PLATFORM_NONE) {
+			return SCAN_NEEDS_CORE;
+		}
+#ifndef MINIMAL_CORE
+		if (mVideoLogIsCompatible(vf)) {
+			return SCAN_NEEDS_CORE;
+		}
+#endif
+		return SCAN_NOT_ROM;
+	}
+	memcpy(entry->internalTitle, info.title, sizeof(entry->internalTitle));
+	memcpy(entry->internalCode, info.code, sizeof(entry->internalCode));
+	entry->platform = info.platform;
+	entry->filesize = info.size;
+	entry->crc32 = info.crc32;
+	return SCAN_IDENTIFIED;
+}
+
+static void _scanJob(struct VDir* dir, struct mLibraryScanJob* job) {
+	struct VFile* vf = dir->openFile(dir, job->filename, O_RDONLY);
+	if (!vf) {
+		job->result = SCAN_NOT_ROM;
+		return;
+	}
+	job->result = _identifyFile(vf, &job->entry);
+	vf->close(vf);
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _scanThread(void* user) {
+	ThreadSetName("Library Scan Thread");
+	struct mLibraryScanContext* context = user;
+	MutexLock(&context->mutex);
+	while (context->nextJob < mLibraryScanJobsSize(context->jobs)) {
+		struct mLibraryScanJob* job = mLibraryScanJobsGetPointer(context->jobs, context->nextJob);
+		++context->nextJob;
+		MutexUnlock(&context->mutex);
+		_scanJob(context->dir, job);
+		MutexLock(&context->mutex);
+	}
+	MutexUnlock(&context->mutex);
+
+#ifdef _3DS
+	svcExitThread();
+#endif
+	return 0;
+}
+#endif
+
+static void _scanJobs(struct VDir* dir, struct mLibraryScanJobs* jobs, bool parallel) {
+	size_t i;
+#ifndef DISABLE_THREADING
+	// Archive readers keep a shared cursor, so only plain directories are scanned in parallel
+	if (parallel && mLibraryScanJobsSize(jobs) > 1) {
+		struct mLibraryScanContext context = {
+			.dir = dir,
+			.jobs = jobs,
+			.nextJob = 0
+		};
+		Thread threads[SCAN_THREADS];
+		size_t nThreads = mLibraryScanJobsSize(jobs) < SCAN_THREADS ? mLibraryScanJobsSize(jobs) : SCAN_THREADS;
+		MutexInit(&context.mutex);
+		for (i = 0; i < nThreads; ++i) {
+			ThreadCreate(&threads[i], _scanThread, &context);
+		}
+		for (i = 0; i < nThreads; ++i) {
+			ThreadJoin(threads[i]);
+		}
+		MutexDeinit(&context.mutex);
+		return;
+	}
+#else
+	UNUSED(parallel);
+#endif
+	for (i = 0; i < mLibraryScanJobsSize(jobs); ++i) {
+		_scanJob(dir, mLibraryScanJobsGetPointer(jobs, i));
+	}
+}
+
+static bool _rootUnchanged(struct mLibrary* library, const char* base, int64_t mtime) {
+	sqlite3_clear_bindings(library->selectRootMtime);
+	sqlite3_reset(library->selectRootMtime);
+	sqlite3_bind_text(library->selectRootMtime, 1, base, -1, SQLITE_TRANSIENT);
+	if (sqlite3_step(library->selectRootMtime) != SQLITE_ROW) {
+		return false;
+	}
+	int64_t oldMtime = sqlite3_column_int64(library->selectRootMtime, 0);
+	return oldMtime && oldMtime == mtime;
+}
+
+static void _loadKnownPaths(struct mLibrary* library, const char* base, struct Table* known) {
+	sqlite3_clear_bindings(library->selectPaths);
+	sqlite3_reset(library->selectPaths);
+	sqlite3_bind_text(library->selectPaths, 1, base, -1, SQLITE_TRANSIENT);
+	while (sqlite3_step(library->selectPaths) == SQLITE_ROW) {
+		struct mLibraryKnownPath* path = malloc(sizeof(*path));
+		path->mtime = sqlite3_column_int64(library->selectPaths, 1);
+		path->size = sqlite3_column_int64(library->selectPaths, 2);
+		path->current = false;
+		HashTableInsert(known, (const char*) sqlite3_column_text(library->selectPaths, 0), path);
+	}
+}
+
+struct mLibraryStaleContext {
+	struct mLibrary* library;
+	const char* base;
+};
+
+static void _deleteStalePath(const char* key, void* value, void* user) {
+	struct mLibraryKnownPath* path = value;
+	struct mLibraryStaleContext* context = user;
+	if (path->current) {
+		return;
+	}
+	struct mLibraryEntry entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.base = context->base;
+	entry.filename = key;
+	_mLibraryDeleteEntry(context->library, &entry);
+}
+
 void mLibraryLoadDirectory(struct mLibrary* library, const char* base) {
+	bool isArchive = true;
 	struct VDir* dir = VDirOpenArchive(base);
 	if (!dir) {
 		dir = VDirOpen(base);
+		isArchive = false;
 	}
 	sqlite3_exec(library->db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
 	if (!dir) {
@@ -227,40 +429,80 @@ void mLibraryLoadDirectory(struct mLibrary* library, const char* base) {
 		return;
 	}
 
-	struct mLibraryEntry entry;
-	memset(&entry, 0, sizeof(entry));
-	entry.base = base;
-	struct mLibraryListing entries;
-	mLibraryListingInit(&entries, 0);
-	mLibraryGetEntries(library, &entries, 0, 0, &entry);
-	size_t i;
-	for (i = 0; i < mLibraryListingSize(&entries); ++i) {
-		struct mLibraryEntry* current = mLibraryListingGetPointer(&entries, i);
-		struct VFile* vf = dir->openFile(dir, current->filename, O_RDONLY);
-		_mLibraryDeleteEntry(library, current);
-		if (!vf) {
-			continue;
-		}
-		_mLibraryAddEntry(library, current->filename, base, vf);
+	// Archives don't expose per-file times, so they are only rescanned as a whole when they change
+	size_t rootSize;
+	int64_t rootMtime = 0;
+	_statFile(base, NULL, &rootSize, &rootMtime);
+	if (isArchive && _rootUnchanged(library, base, rootMtime)) {
+		dir->close(dir);
+		sqlite3_exec(library->db, "COMMIT;", NULL, NULL, NULL);
+		return;
 	}
-	mLibraryListingDeinit(&entries);
 
+	struct Table known;
+	HashTableInit(&known, 0, free);
+	_loadKnownPaths(library, base, &known);
+
+	struct mLibraryScanJobs jobs;
+	mLibraryScanJobsInit(&jobs, 0);
 	dir->rewind(dir);
-	struct VDirEntry* dirent = dir->listNext(dir);
-	while (dirent) {
-		struct VFile* vf = dir->openFile(dir, dirent->name(dirent), O_RDONLY);
-		if (!vf) {
-			dirent = dir->listNext(dir);
+	struct VDirEntry* dirent;
+	while ((dirent = dir->listNext(dir))) {
+		if (dirent->type(dirent) == VFS_DIRECTORY) {
+			continue;
+		}
+		const char* name = dirent->name(dirent);
+		size_t size = 0;
+		int64_t mtime = 0;
+		if (!isArchive && !_statFile(base, name, &size, &mtime)) {
+			mtime = 0;
+		}
+		struct mLibraryKnownPath* path = HashTableLookup(&known, name);
+		if (path && mtime && path->mtime == mtime && path->size == size) {
+			path->current = true;
 			continue;
 		}
-		_mLibraryAddEntry(library, dirent->name(dirent), base, vf);
-		dirent = dir->listNext(dir);
+		struct mLibraryScanJob* job = mLibraryScanJobsAppend(&jobs);
+		job->filename = strdup(name);
+		job->mtime = mtime;
+	}
+
+	struct mLibraryStaleContext staleContext = { library, base };
+	HashTableEnumerate(&known, _deleteStalePath, &staleContext);
+	HashTableDeinit(&known);
+
+	_scanJobs(dir, &jobs, !isArchive);
+
+	size_t i;
+	for (i = 0; i < mLibraryScanJobsSize(&jobs); ++i) {
+		struct mLibraryScanJob* job = mLibraryScanJobsGetPointer(&jobs, i);
+		switch (job->result) {
+		case SCAN_IDENTIFIED:
+			job->entry.base = base;
+			job->entry.filename = job->filename;
+			_mLibraryInsertEntry(library, &job->entry, job->mtime);
+			break;
+		case SCAN_NEEDS_CORE:
+			_mLibraryAddEntry(library, job->filename, base, dir->openFile(dir, job->filename, O_RDONLY), job->mtime);
+			break;
+		case SCAN_NOT_ROM:
+			break;
+		}
+		free(job->filename);
 	}
+	mLibraryScanJobsDeinit(&jobs);
+
+	sqlite3_clear_bindings(library->updateRoot);
+	sqlite3_reset(library->updateRoot);
+	sqlite3_bind_int64(library->updateRoot, 1, rootMtime);
+	sqlite3_bind_text(library->updateRoot, 2, base, -1, SQLITE_TRANSIENT);
+	sqlite3_step(library->updateRoot);
+
 	dir->close(dir);
 	sqlite3_exec(library->db, "COMMIT;", NULL, NULL, NULL);
 }
 
-void _mLibraryAddEntry(struct mLibrary* library, const char* filename, const char* base, struct VFile* vf) {
+void _mLibraryAddEntry(struct mLibrary* library, const char* filename, const char* base, struct VFile* vf, int64_t mtime) {
 	struct mCore* core;
 	if (!vf) {
 		return;
@@ -280,7 +522,7 @@ void _mLibraryAddEntry(struct mLibrary* library, const char* filename, const cha
 		entry.base = base;
 		entry.filename = filename;
 		entry.filesize = vf->size(vf);
-		_mLibraryInsertEntry(library, &entry);
+		_mLibraryInsertEntry(library, &entry, mtime);
 		// Note: this destroys the VFile
 		core->deinit(core);
 	} else {
@@ -288,7 +530,7 @@ void _mLibraryAddEntry(struct mLibrary* library, const char* filename, const cha
 	}
 }
 
-static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry* entry) {
+static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry* entry, int64_t mtime) {
 	sqlite3_clear_bindings(library->selectRom);
 	sqlite3_reset(library->selectRom);
 	struct mLibraryEntry constraints = *entry;
@@ -330,6 +572,7 @@ static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry*
 	if (rootId > 0) {
 		sqlite3_bind_int64(library->insertPath, 4, rootId);
 	}
+	sqlite3_bind_int64(library->insertPath, 5, mtime);
 	sqlite3_step(library->insertPath);
 }
 
@@ -337,7 +580,8 @@ static void _mLibraryDeleteEntry(struct mLibrary* library, struct mLibraryEntry*
 	sqlite3_clear_bindings(library->deletePath);
 	sqlite3_reset(library->deletePath);
 	sqlite3_bind_text(library->deletePath, 1, entry->filename, -1, SQLITE_TRANSIENT);
-	sqlite3_step(library->insertPath);
+	sqlite3_bind_text(library->deletePath, 2, entry->base, -1, SQLITE_TRANSIENT);
+	sqlite3_step(library->deletePath);
 }
 
 void mLibraryClear(struct mLibrary* library) {
@@ -360,6 +604,11 @@ size_t mLibraryCount(struct mLibrary* library, const struct mLibraryEntry* const
 	return sqlite3_column_int64(library->count, 0);
 }
 
+static void _setEntryTitle(void* context, size_t index, const struct NoIntroGame* game) {
+	struct mLibraryListing* out = context;
+	mLibraryListingGetPointer(out, index)->title = strdup(game->name);
+}
+
 size_t mLibraryGetEntries(struct mLibrary* library, struct mLibraryListing* out, size_t numEntries, size_t offset, const struct mLibraryEntry* constraints) {
 	mLibraryListingClear(out); // TODO: Free memory
 	sqlite3_clear_bindings(library->select);
@@ -381,10 +630,6 @@ size_t mLibraryGetEntries(struct mLibrary* library, struct mLibraryListing* out,
 			const char* colName = sqlite3_column_name(library->select, i);
 			if (strcmp(colName, "crc32") == 0) {
 				entry->crc32 = sqlite3_column_int(library->select, i);
-				struct NoIntroGame game;
-				if (NoIntroDBLookupGameByCRC(library->gameDB, entry->crc32, &game)) {
-					entry->title = strdup(game.name);
-				}
 			} else if (strcmp(colName, "platform") == 0) {
 				entry->platform = sqlite3_column_int(library->select, i);
 			} else if (strcmp(colName, "size") == 0) {
@@ -400,6 +645,16 @@ size_t mLibraryGetEntries(struct mLibrary* library, struct mLibraryListing* out,
 			}
 		}
 	}
+	if (library->gameDB && entryIndex) {
+		// Titles are matched all at once rather than a query per row
+		uint32_t* crc32s = malloc(entryIndex * sizeof(*crc32s));
+		size_t i;
+		for (i = 0; i < entryIndex; ++i) {
+			crc32s[i] = mLibraryListingGetPointer(out, i)->crc32;
+		}
+		NoIntroDBLookupGamesByCRC(library->gameDB, crc32s, entryIndex, _setEntryTitle, out);
+		free(crc32s);
+	}
 	return mLibraryListingSize(out);
 }
 
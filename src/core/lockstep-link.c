@@ -0,0 +1,317 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/lockstep-link.h>
+
+#include <mgba/core/log.h>
+
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+#define LINK_MAGIC 0x4B4E4C6D
+#define LINK_HEADER_SIZE 16
+#define LINK_EVENT_SIZE 12
+#define LINK_SEND_TIMEOUT 100
+
+mLOG_DECLARE_CATEGORY(LOCKSTEP_LINK);
+mLOG_DEFINE_CATEGORY(LOCKSTEP_LINK, "Lockstep Link", "core.lockstep-link");
+
+DEFINE_VECTOR(mLockstepLinkEventList, struct mLockstepLinkEvent);
+
+static uint64_t _now(void) {
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER count;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&count);
+	return (count.QuadPart / frequency.QuadPart) * 1000000ULL + (count.QuadPart % frequency.QuadPart) * 1000000ULL / frequency.QuadPart;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return 1000000ULL * tv.tv_sec + tv.tv_usec;
+#endif
+}
+
+static bool _fail(struct mLockstepLink* link, const char* reason) {
+	if (!link->failed) {
+		mLOG(LOCKSTEP_LINK, ERROR, "Link failed: %s", reason);
+		link->failed = true;
+	}
+	return false;
+}
+
+static bool _sendAll(struct mLockstepLink* link, const uint8_t* buffer, size_t size) {
+	while (size) {
+		ssize_t sent = SocketSend(link->socket, buffer, size);
+		if (sent > 0) {
+			buffer += sent;
+			size -= sent;
+			continue;
+		}
+		if (sent < 0 && SocketWouldBlock()) {
+			Socket writes[] = { link->socket };
+			if (SocketPoll(1, NULL, writes, NULL, LINK_SEND_TIMEOUT) >= 0) {
+				continue;
+			}
+		}
+		return _fail(link, "send failed");
+	}
+	return true;
+}
+
+static bool _sendFrame(struct mLockstepLink* link, bool ping) {
+	uint32_t frame[(LINK_HEADER_SIZE + LINK_EVENT_SIZE * mLOCKSTEP_LINK_MAX_BATCH) / 4];
+	uint16_t pingId = 0;
+	if (ping) {
+		++link->pingId;
+		if (!link->pingId) {
+			link->pingId = 1;
+		}
+		pingId = link->pingId;
+	}
+	STORE_32LE(LINK_MAGIC, 0, frame);
+	STORE_16LE(link->nOutgoing, 4, frame);
+	STORE_16LE(pingId, 6, frame);
+	STORE_32LE(link->localHorizon, 8, frame);
+	STORE_16LE(link->pongPending ? link->pongId : 0, 12, frame);
+	STORE_16LE(0, 14, frame);
+
+	size_t i;
+	uint32_t offset = LINK_HEADER_SIZE;
+	for (i = 0; i < link->nOutgoing; ++i, offset += LINK_EVENT_SIZE) {
+		const struct mLockstepLinkEvent* event = &link->outgoing[i];
+		STORE_32LE(event->when, offset, frame);
+		STORE_16LE(event->type, offset + 4, frame);
+		STORE_16LE(event->player, offset + 6, frame);
+		STORE_32LE(event->data, offset + 8, frame);
+	}
+
+	if (!_sendAll(link, (uint8_t*) frame, offset)) {
+		return false;
+	}
+	if (ping) {
+		link->pingOutstanding = true;
+		link->pingSent = _now();
+	}
+	++link->stats.framesSent;
+	link->stats.eventsSent += link->nOutgoing;
+	link->nOutgoing = 0;
+	link->pongPending = false;
+	return true;
+}
+
+static void _recordRtt(struct mLockstepLink* link) {
+	uint64_t rtt = _now() - link->pingSent;
+	if (rtt > UINT32_MAX) {
+		rtt = UINT32_MAX;
+	}
+	struct mLockstepLinkStats* stats = &link->stats;
+	stats->lastRtt = rtt;
+	if (!stats->rttSamples || rtt < stats->minRtt) {
+		stats->minRtt = rtt;
+	}
+	if (rtt > stats->maxRtt) {
+		stats->maxRtt = rtt;
+	}
+	stats->totalRtt += rtt;
+	++stats->rttSamples;
+	link->pingOutstanding = false;
+}
+
+static bool _parseFrames(struct mLockstepLink* link) {
+	const uint8_t* buffer = (const uint8_t*) link->recvBuffer;
+	size_t offset = 0;
+	while (link->recvFill - offset >= LINK_HEADER_SIZE) {
+		uint32_t magic;
+		uint16_t nEvents;
+		uint16_t ping;
+		uint32_t horizon;
+		uint16_t pong;
+		LOAD_32LE(magic, offset, buffer);
+		LOAD_16LE(nEvents, offset + 4, buffer);
+		LOAD_16LE(ping, offset + 6, buffer);
+		LOAD_32LE(horizon, offset + 8, buffer);
+		LOAD_16LE(pong, offset + 12, buffer);
+		if (magic != LINK_MAGIC || nEvents > mLOCKSTEP_LINK_MAX_BATCH) {
+			return _fail(link, "malformed frame");
+		}
+		size_t size = LINK_HEADER_SIZE + nEvents * LINK_EVENT_SIZE;
+		if (link->recvFill - offset < size) {
+			break;
+		}
+
+		size_t i;
+		uint32_t eventOffset = offset + LINK_HEADER_SIZE;
+		for (i = 0; i < nEvents; ++i, eventOffset += LINK_EVENT_SIZE) {
+			struct mLockstepLinkEvent* event = mLockstepLinkEventListAppend(&link->incoming);
+			LOAD_32LE(event->when, eventOffset, buffer);
+			LOAD_16LE(event->type, eventOffset + 4, buffer);
+			LOAD_16LE(event->player, eventOffset + 6, buffer);
+			LOAD_32LE(event->data, eventOffset + 8, buffer);
+		}
+		if (mLockstepLinkCyclesDiff(horizon, link->remoteHorizon) > 0) {
+			link->remoteHorizon = horizon;
+		}
+		if (ping) {
+			link->pongId = ping;
+			link->pongPending = true;
+		}
+		if (pong && link->pingOutstanding && pong == link->pingId) {
+			_recordRtt(link);
+		}
+		++link->stats.framesReceived;
+		link->stats.eventsReceived += nEvents;
+		offset += size;
+	}
+	// Frames are always a multiple of four bytes, so this keeps the buffer aligned for the loads above
+	memmove(link->recvBuffer, &buffer[offset], link->recvFill - offset);
+	link->recvFill -= offset;
+	return true;
+}
+
+void mLockstepLinkInit(struct mLockstepLink* link, Socket socket) {
+	memset(link, 0, sizeof(*link));
+	link->socket = socket;
+	mLockstepLinkEventListInit(&link->incoming, mLOCKSTEP_LINK_MAX_BATCH);
+	if (SOCKET_FAILED(socket)) {
+		link->failed = true;
+		return;
+	}
+	SocketSetBlocking(socket, false);
+	SocketSetTCPPush(socket, 1);
+}
+
+void mLockstepLinkDeinit(struct mLockstepLink* link) {
+	if (!SOCKET_FAILED(link->socket)) {
+		SocketClose(link->socket);
+		link->socket = INVALID_SOCKET;
+	}
+	mLockstepLinkEventListDeinit(&link->incoming);
+}
+
+bool mLockstepLinkQueue(struct mLockstepLink* link, const struct mLockstepLinkEvent* event) {
+	if (link->failed) {
+		return false;
+	}
+	if (link->nOutgoing == mLOCKSTEP_LINK_MAX_BATCH && !_sendFrame(link, false)) {
+		return false;
+	}
+	link->outgoing[link->nOutgoing] = *event;
+	++link->nOutgoing;
+	return true;
+}
+
+bool mLockstepLinkFlush(struct mLockstepLink* link, uint32_t horizon) {
+	if (link->failed) {
+		return false;
+	}
+	bool ping = !link->pingOutstanding && _now() - link->pingSent >= mLOCKSTEP_LINK_PING_INTERVAL;
+	bool advanced = mLockstepLinkCyclesDiff(horizon, link->localHorizon) > 0;
+	if (advanced) {
+		link->localHorizon = horizon;
+	}
+	// Nothing the other side is waiting on, so save the round trip
+	if (!advanced && !ping && !link->nOutgoing && !link->pongPending) {
+		return true;
+	}
+	return _sendFrame(link, ping);
+}
+
+bool mLockstepLinkPoll(struct mLockstepLink* link, int64_t timeoutMillis) {
+	if (link->failed) {
+		return false;
+	}
+	Socket reads[] = { link->socket };
+	if (SocketPoll(1, reads, NULL, NULL, timeoutMillis) < 0) {
+		return _fail(link, "poll failed");
+	}
+	if (SOCKET_FAILED(reads[0])) {
+		return true;
+	}
+	while (true) {
+		ssize_t received = SocketRecv(link->socket, (uint8_t*) link->recvBuffer + link->recvFill, sizeof(link->recvBuffer) - link->recvFill);
+		if (received == 0) {
+			return _fail(link, "connection closed");
+		}
+		if (received < 0) {
+			if (!SocketWouldBlock()) {
+				return _fail(link, "receive failed");
+			}
+			break;
+		}
+		link->recvFill += received;
+		if (!_parseFrames(link)) {
+			return false;
+		}
+	}
+	// Answer pings right away so the round trip doesn't include the time spent emulating
+	if (link->pongPending) {
+		return _sendFrame(link, false);
+	}
+	return true;
+}
+
+bool mLockstepLinkNextEvent(struct mLockstepLink* link, uint32_t until, struct mLockstepLinkEvent* event) {
+	if (link->incomingRead == mLockstepLinkEventListSize(&link->incoming)) {
+		return false;
+	}
+	const struct mLockstepLinkEvent* next = mLockstepLinkEventListGetPointer(&link->incoming, link->incomingRead);
+	if (mLockstepLinkCyclesDiff(next->when, until) > 0) {
+		return false;
+	}
+	*event = *next;
+	++link->incomingRead;
+	if (link->incomingRead == mLockstepLinkEventListSize(&link->incoming)) {
+		mLockstepLinkEventListClear(&link->incoming);
+		link->incomingRead = 0;
+	} else if (link->incomingRead >= mLOCKSTEP_LINK_MAX_BATCH) {
+		mLockstepLinkEventListShift(&link->incoming, 0, link->incomingRead);
+		link->incomingRead = 0;
+	}
+	return true;
+}
+
+int32_t mLockstepLinkBudget(const struct mLockstepLink* link, uint32_t now) {
+	int32_t budget = mLockstepLinkCyclesDiff(link->remoteHorizon + link->lookahead, now);
+	if (link->incomingRead < mLockstepLinkEventListSize(&link->incoming)) {
+		// Stop at the next pending event so it can be delivered on time
+		const struct mLockstepLinkEvent* next = mLockstepLinkEventListGetConstPointer(&link->incoming, link->incomingRead);
+		int32_t untilEvent = mLockstepLinkCyclesDiff(next->when, now);
+		if (untilEvent < budget) {
+			budget = untilEvent;
+		}
+	}
+	if (budget < 0) {
+		budget = 0;
+	}
+	return budget;
+}
+
+bool mLockstepLinkWaitUntil(struct mLockstepLink* link, uint32_t cycle, int64_t timeoutMillis) {
+	uint64_t start = _now();
+	uint64_t deadline = start + timeoutMillis * 1000;
+	bool success = true;
+	while (mLockstepLinkCyclesDiff(link->remoteHorizon + link->lookahead, cycle) < 0) {
+		uint64_t now = _now();
+		if (timeoutMillis >= 0 && now >= deadline) {
+			success = false;
+			break;
+		}
+		if (!mLockstepLinkPoll(link, timeoutMillis < 0 ? -1 : (int64_t) (deadline - now + 999) / 1000)) {
+			success = false;
+			break;
+		}
+	}
+	link->stats.stallTime += _now() - start;
+	return success;
+}
+
+uint32_t mLockstepLinkAverageRtt(const struct mLockstepLinkStats* stats) {
+	if (!stats->rttSamples) {
+		return 0;
+	}
+	return stats->totalRtt / stats->rttSamples;
+}
@@ -7,8 +7,40 @@
 
 #include <mgba/core/config.h>
 #include <mgba/core/thread.h>
+#include <mgba-util/ring-spsc.h>
 
-#define MAX_CATEGORY 64
+#define ASYNC_LOG_BUFFER_SIZE 0x10000
+#define ASYNC_LOG_MESSAGE_MAX 512
+#define ASYNC_LOG_POLL_INTERVAL 10
+#define ASYNC_LOG_REPEAT_LIMIT 8
+
+struct mAsyncLogRecord {
+	int32_t category;
+	int32_t level;
+	uint32_t length;
+};
+
+struct mAsyncLogger {
+	struct mLogger d;
+	struct mLogger* backend;
+
+	// Producer side, serialized since any thread may log through the same logger
+	Mutex producerMutex;
+	int lastCategory;
+	enum mLogLevel lastLevel;
+	const char* lastFormat;
+	unsigned repeats;
+	unsigned dropped;
+
+#ifndef DISABLE_THREADING
+	struct RingSPSC ring;
+	Thread thread;
+	Mutex mutex;
+	Condition cond;
+	Condition flushCond;
+	bool exiting;
+#endif
+};
 
 static struct mLogger* _defaultLogger = NULL;
 
@@ -28,11 +60,11 @@ void mLogSetDefaultLogger(struct mLogger* logger) {
 }
 
 static int _category = 0;
-static const char* _categoryNames[MAX_CATEGORY];
-static const char* _categoryIds[MAX_CATEGORY];
+static const char* _categoryNames[mLOG_MAX_CATEGORY];
+static const char* _categoryIds[mLOG_MAX_CATEGORY];
 
 int mLogGenerateCategory(const char* name, const char* id) {
-	if (_category < MAX_CATEGORY) {
+	if (_category < mLOG_MAX_CATEGORY) {
 		_categoryNames[_category] = name;
 		_categoryIds[_category] = id;
 	}
@@ -41,14 +73,14 @@ int mLogGenerateCategory(const char* name, const char* id) {
 }
 
 const char* mLogCategoryName(int category) {
-	if (category < MAX_CATEGORY) {
+	if (category < mLOG_MAX_CATEGORY) {
 		return _categoryNames[category];
 	}
 	return NULL;
 }
 
 const char* mLogCategoryId(int category) {
-	if (category < MAX_CATEGORY) {
+	if (category < mLOG_MAX_CATEGORY) {
 		return _categoryIds[category];
 	}
 	return NULL;
@@ -80,9 +112,34 @@ void mLog(int category, enum mLogLevel level, const char* format, ...) {
 	va_end(args);
 }
 
+static int _lookupFilterLevels(const struct mLogFilter* filter, int category) {
+	int value = (intptr_t) TableLookup(&filter->levels, category);
+	if (value) {
+		return value;
+	}
+	const char* cat = mLogCategoryId(category);
+	if (cat) {
+		value = (intptr_t) HashTableLookup(&filter->categories, cat);
+	}
+	return value;
+}
+
+static void _resolveFilter(struct mLogFilter* filter) {
+	int nCategories = _category;
+	if (nCategories > mLOG_MAX_CATEGORY) {
+		nCategories = mLOG_MAX_CATEGORY;
+	}
+	int i;
+	for (i = 0; i < nCategories; ++i) {
+		filter->resolved[i] = _lookupFilterLevels(filter, i);
+	}
+	filter->nResolved = nCategories;
+}
+
 void mLogFilterInit(struct mLogFilter* filter) {
 	HashTableInit(&filter->categories, 8, NULL);
 	TableInit(&filter->levels, 8, NULL);
+	_resolveFilter(filter);
 }
 
 void mLogFilterDeinit(struct mLogFilter* filter) {
@@ -116,6 +173,8 @@ void mLogFilterLoad(struct mLogFilter* filter, const struct mCoreConfig* config)
 	HashTableClear(&filter->categories);
 	TableClear(&filter->levels);
 
+	_resolveFilter(filter);
+
 	mCoreConfigEnumerate(config, "logLevel.", _setFilterLevel, filter);
 	filter->defaultLevels = mLOG_ALL;
 	mCoreConfigGetIntValue(config, "logLevel", &filter->defaultLevels);
@@ -144,6 +203,7 @@ void mLogFilterSet(struct mLogFilter* filter, const char* category, int levels)
 	if (cat >= 0) {
 		TableInsert(&filter->levels, cat, (void*)(intptr_t) levels);
 	}
+	_resolveFilter(filter);
 }
 
 void mLogFilterReset(struct mLogFilter* filter, const char* category) {
@@ -153,6 +213,7 @@ void mLogFilterReset(struct mLogFilter* filter, const char* category) {
 	if (cat >= 0) {
 		TableRemove(&filter->levels, cat);
 	}
+	_resolveFilter(filter);
 }
 
 bool mLogFilterTest(const struct mLogFilter* filter, int category, enum mLogLevel level) {
@@ -164,15 +225,172 @@ bool mLogFilterTest(const struct mLogFilter* filter, int category, enum mLogLeve
 }
 
 int mLogFilterLevels(const struct mLogFilter* filter , int category) {
-	int value = (intptr_t) TableLookup(&filter->levels, category);
-	if (value) {
-		return value;
+	// Categories generated after the filter last changed aren't resolved yet
+	if (category >= 0 && category < filter->nResolved) {
+		return filter->resolved[category];
 	}
-	const char* cat = mLogCategoryId(category);
-	if (cat) {
-		value = (intptr_t) HashTableLookup(&filter->categories, cat);
+	return _lookupFilterLevels(filter, category);
+}
+
+static void _forwardLog(struct mLogger* backend, int category, enum mLogLevel level, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	backend->log(backend, category, level, format, args);
+	va_end(args);
+}
+
+#ifndef DISABLE_THREADING
+static void _asyncDrain(struct mAsyncLogger* logger) {
+	struct mAsyncLogRecord record;
+	char message[ASYNC_LOG_MESSAGE_MAX];
+	while (RingSPSCRead(&logger->ring, &record, sizeof(record))) {
+		// Records are committed whole, so the text is always there with its header
+		RingSPSCRead(&logger->ring, message, record.length);
+		message[record.length] = '\0';
+		_forwardLog(logger->backend, record.category, record.level, "%s", message);
 	}
-	return value;
+}
+
+static THREAD_ENTRY _asyncLogThread(void* context) {
+	struct mAsyncLogger* logger = context;
+	ThreadSetName("Log Thread");
+	MutexLock(&logger->mutex);
+	while (true) {
+		MutexUnlock(&logger->mutex);
+		_asyncDrain(logger);
+		MutexLock(&logger->mutex);
+		ConditionWake(&logger->flushCond);
+		if (logger->exiting && !RingSPSCSize(&logger->ring)) {
+			break;
+		}
+		ConditionWaitTimed(&logger->cond, &logger->mutex, ASYNC_LOG_POLL_INTERVAL);
+	}
+	MutexUnlock(&logger->mutex);
+	return 0;
+}
+#endif
+
+// Must be called with the producer mutex held
+static void _asyncEmit(struct mAsyncLogger* logger, int category, enum mLogLevel level, const char* format, va_list args) {
+#ifndef DISABLE_THREADING
+	uint8_t buffer[sizeof(struct mAsyncLogRecord) + ASYNC_LOG_MESSAGE_MAX];
+	struct mAsyncLogRecord* record = (struct mAsyncLogRecord*) buffer;
+	char* message = (char*) &buffer[sizeof(*record)];
+	int length = vsnprintf(message, ASYNC_LOG_MESSAGE_MAX, format, args);
+	if (length < 0) {
+		return;
+	}
+	if (length >= ASYNC_LOG_MESSAGE_MAX) {
+		length = ASYNC_LOG_MESSAGE_MAX - 1;
+	}
+	record->category = category;
+	record->level = level;
+	record->length = length;
+	if (!RingSPSCWrite(&logger->ring, buffer, sizeof(*record) + length)) {
+		++logger->dropped;
+		return;
+	}
+	if (RingSPSCSize(&logger->ring) > RingSPSCCapacity(&logger->ring) / 2) {
+		ConditionWake(&logger->cond);
+	}
+#else
+	logger->backend->log(logger->backend, category, level, format, args);
+#endif
+}
+
+static void _asyncEmitf(struct mAsyncLogger* logger, int category, enum mLogLevel level, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	_asyncEmit(logger, category, level, format, args);
+	va_end(args);
+}
+
+// Must be called with the producer mutex held
+static void _asyncEmitSkipped(struct mAsyncLogger* logger) {
+	if (logger->dropped) {
+		unsigned dropped = logger->dropped;
+		logger->dropped = 0;
+		_asyncEmitf(logger, _mLOG_CAT_STATUS, mLOG_WARN, "%u log messages dropped", dropped);
+	}
+	if (logger->repeats > ASYNC_LOG_REPEAT_LIMIT) {
+		_asyncEmitf(logger, logger->lastCategory, logger->lastLevel, "Last message repeated %u more times", logger->repeats - ASYNC_LOG_REPEAT_LIMIT);
+	}
+	logger->repeats = 0;
+}
+
+static void _asyncLog(struct mLogger* log, int category, enum mLogLevel level, const char* format, va_list args) {
+	struct mAsyncLogger* logger = (struct mAsyncLogger*) log;
+	MutexLock(&logger->producerMutex);
+	// Comparing the format pointer is enough to catch a message being spammed without formatting it
+	if (format == logger->lastFormat && category == logger->lastCategory && level == logger->lastLevel) {
+		++logger->repeats;
+		if (logger->repeats > ASYNC_LOG_REPEAT_LIMIT) {
+			MutexUnlock(&logger->producerMutex);
+			return;
+		}
+	} else {
+		_asyncEmitSkipped(logger);
+		logger->lastFormat = format;
+		logger->lastCategory = category;
+		logger->lastLevel = level;
+		logger->repeats = 1;
+	}
+	_asyncEmit(logger, category, level, format, args);
+	MutexUnlock(&logger->producerMutex);
+	if (level == mLOG_FATAL) {
+		mAsyncLoggerFlush(log);
+	}
+}
+
+struct mLogger* mAsyncLoggerCreate(struct mLogger* backend) {
+	struct mAsyncLogger* logger = calloc(1, sizeof(*logger));
+	logger->d.log = _asyncLog;
+	logger->d.filter = backend->filter;
+	logger->backend = backend;
+	MutexInit(&logger->producerMutex);
+#ifndef DISABLE_THREADING
+	RingSPSCInit(&logger->ring, ASYNC_LOG_BUFFER_SIZE);
+	MutexInit(&logger->mutex);
+	ConditionInit(&logger->cond);
+	ConditionInit(&logger->flushCond);
+	logger->exiting = false;
+	ThreadCreate(&logger->thread, _asyncLogThread, logger);
+#endif
+	return &logger->d;
+}
+
+void mAsyncLoggerFlush(struct mLogger* log) {
+	struct mAsyncLogger* logger = (struct mAsyncLogger*) log;
+	MutexLock(&logger->producerMutex);
+	_asyncEmitSkipped(logger);
+	logger->lastFormat = NULL;
+	MutexUnlock(&logger->producerMutex);
+#ifndef DISABLE_THREADING
+	MutexLock(&logger->mutex);
+	while (RingSPSCSize(&logger->ring)) {
+		ConditionWake(&logger->cond);
+		ConditionWaitTimed(&logger->flushCond, &logger->mutex, ASYNC_LOG_POLL_INTERVAL);
+	}
+	MutexUnlock(&logger->mutex);
+#endif
+}
+
+void mAsyncLoggerDestroy(struct mLogger* log) {
+	struct mAsyncLogger* logger = (struct mAsyncLogger*) log;
+	mAsyncLoggerFlush(log);
+#ifndef DISABLE_THREADING
+	MutexLock(&logger->mutex);
+	logger->exiting = true;
+	ConditionWake(&logger->cond);
+	MutexUnlock(&logger->mutex);
+	ThreadJoin(logger->thread);
+	ConditionDeinit(&logger->flushCond);
+	ConditionDeinit(&logger->cond);
+	MutexDeinit(&logger->mutex);
+	RingSPSCDeinit(&logger->ring);
+#endif
+	MutexDeinit(&logger->producerMutex);
+	free(logger);
 }
 
 mLOG_DEFINE_CATEGORY(STATUS, "Status", "core.status")
@@ -12,14 +12,25 @@ void mMapCacheInit(struct mMapCache* cache) {
 	cache->cache = NULL;
 	cache->config = mMapCacheConfigurationFillShouldStore(0);
 	cache->status = NULL;
+	cache->rowDirty = NULL;
+	cache->rowVersion = NULL;
 }
 
 static void _freeCache(struct mMapCache* cache) {
 	size_t tiles = (1 << mMapCacheSystemInfoGetTilesWide(cache->sysConfig)) * (1 << mMapCacheSystemInfoGetTilesHigh(cache->sysConfig));
 	mappedMemoryFree(cache->cache, 8 * 8 * sizeof(color_t) * tiles);
 	mappedMemoryFree(cache->status, tiles * sizeof(*cache->status));
+	free(cache->rowDirty);
+	free(cache->rowVersion);
 	cache->cache = NULL;
 	cache->status = NULL;
+	cache->rowDirty = NULL;
+	cache->rowVersion = NULL;
+}
+
+static void _dirtyAllRows(struct mMapCache* cache) {
+	size_t rows = 1 << mMapCacheSystemInfoGetTilesHigh(cache->sysConfig);
+	memset(cache->rowDirty, 0xFF, ((rows + 31) >> 5) * sizeof(*cache->rowDirty));
 }
 
 static void _redoCacheSize(struct mMapCache* cache) {
@@ -30,6 +41,11 @@ static void _redoCacheSize(struct mMapCache* cache) {
 	size_t tiles = (1 << mMapCacheSystemInfoGetTilesWide(cache->sysConfig)) * (1 << mMapCacheSystemInfoGetTilesHigh(cache->sysConfig));
 	cache->cache = anonymousMemoryMap(8 * 8 * sizeof(color_t) * tiles);
 	cache->status = anonymousMemoryMap(tiles * sizeof(*cache->status));
+
+	size_t rows = 1 << mMapCacheSystemInfoGetTilesHigh(cache->sysConfig);
+	cache->rowDirty = malloc(((rows + 31) >> 5) * sizeof(*cache->rowDirty));
+	cache->rowVersion = calloc(rows, sizeof(*cache->rowVersion));
+	_dirtyAllRows(cache);
 }
 
 void mMapCacheConfigure(struct mMapCache* cache, mMapCacheConfiguration config) {
@@ -56,6 +72,7 @@ void mMapCacheConfigureSystem(struct mMapCache* cache, mMapCacheSystemInfo confi
 void mMapCacheConfigureMap(struct mMapCache* cache, uint32_t mapStart) {
 	size_t tiles = (1 << mMapCacheSystemInfoGetTilesWide(cache->sysConfig)) * (1 << mMapCacheSystemInfoGetTilesHigh(cache->sysConfig));
 	memset(cache->status, 0, tiles * sizeof(*cache->status));
+	_dirtyAllRows(cache);
 	cache->mapStart = mapStart;
 }
 
@@ -63,13 +80,25 @@ void mMapCacheDeinit(struct mMapCache* cache) {
 	_freeCache(cache);
 }
 
+// The inverse of mMapCacheTileId, for the y coordinate only
+static unsigned _locationRow(const struct mMapCache* cache, uint32_t location) {
+	int tilesWide = mMapCacheSystemInfoGetTilesWide(cache->sysConfig);
+	int macroTileSize = mMapCacheSystemInfoGetMacroTileSize(cache->sysConfig);
+	location >>= macroTileSize;
+	unsigned yMinor = location & ((1 << macroTileSize) - 1);
+	return ((location >> tilesWide) << macroTileSize) | yMinor;
+}
+
 void mMapCacheWriteVRAM(struct mMapCache* cache, uint32_t address) {
 	if (address >= cache->mapStart && address < cache->mapStart + cache->mapSize) {
 		address -= cache->mapStart;
-		struct mMapCacheEntry* status = &cache->status[address >> mMapCacheSystemInfoGetMapAlign(cache->sysConfig)];
+		uint32_t location = address >> mMapCacheSystemInfoGetMapAlign(cache->sysConfig);
+		struct mMapCacheEntry* status = &cache->status[location];
 		++status->vramVersion;
 		status->flags = mMapCacheEntryFlagsClearVramClean(status->flags);
 		status->tileStatus[mMapCacheEntryFlagsGetPaletteId(status->flags)].vramClean = 0;
+		unsigned y = _locationRow(cache, location);
+		cache->rowDirty[y >> 5] |= 1U << (y & 31);
 	}
 }
 
@@ -171,12 +200,22 @@ bool mMapCacheCheckTile(struct mMapCache* cache, const struct mMapCacheEntry* en
 	return false;
 }
 
-void mMapCacheCleanRow(struct mMapCache* cache, unsigned y) {
-	// TODO: Cache
+// Redraws the tiles in row y whose entry or tile changed since they were last drawn, and
+// returns whether any were, along with the range of them
+static bool _cleanRow(struct mMapCache* cache, unsigned y, unsigned* startX, unsigned* endX) {
+	uint32_t version = cache->tileCache->version;
+	uint32_t bit = 1U << (y & 31);
+	if (!(cache->rowDirty[y >> 5] & bit) && cache->rowVersion[y] == version) {
+		return false;
+	}
+	cache->rowDirty[y >> 5] &= ~bit;
+	cache->rowVersion[y] = version;
+
 	int tilesWide = 1 << mMapCacheSystemInfoGetTilesWide(cache->sysConfig);
 	int macroTile = (1 << mMapCacheSystemInfoGetMacroTileSize(cache->sysConfig)) - 1;
 	size_t stride = 8 << mMapCacheSystemInfoGetTilesWide(cache->sysConfig);
 	int location = 0;
+	bool redrawn = false;
 	int x;
 	for (x = 0; x < tilesWide; ++x) {
 		if (!(x & macroTile)) {
@@ -185,18 +224,64 @@ void mMapCacheCleanRow(struct mMapCache* cache, unsigned y) {
 			++location;
 		}
 		struct mMapCacheEntry* status = &cache->status[location];
+		bool reparsed = false;
 		if (!mMapCacheEntryFlagsIsVramClean(status->flags)) {
 			status->flags = mMapCacheEntryFlagsFillVramClean(status->flags);
 			cache->mapParser(cache, status, &cache->vram[cache->mapStart + (location << mMapCacheSystemInfoGetMapAlign(cache->sysConfig))]);
+			reparsed = true;
 		}
 		unsigned tileId = status->tileId + cache->tileStart;
 		if (tileId >= mTileCacheSystemInfoGetMaxTiles(cache->tileCache->sysConfig)) {
 			tileId = 0;
 		}
-		const color_t* tile = mTileCacheGetTile(cache->tileCache, tileId, mMapCacheEntryFlagsGetPaletteId(status->flags));
+		const color_t* tile = mTileCacheGetTileIfDirty(cache->tileCache, status->tileStatus, tileId, mMapCacheEntryFlagsGetPaletteId(status->flags));
+		if (!tile) {
+			if (!reparsed) {
+				continue;
+			}
+			tile = mTileCacheGetTile(cache->tileCache, tileId, mMapCacheEntryFlagsGetPaletteId(status->flags));
+		}
 		color_t* mapOut = &cache->cache[(y * stride + x) * 8];
 		_cleanTile(cache, tile, mapOut, status);
+		if (!redrawn) {
+			*startX = x;
+			redrawn = true;
+		}
+		*endX = x + 1;
+	}
+	return redrawn;
+}
+
+void mMapCacheCleanRow(struct mMapCache* cache, unsigned y) {
+	unsigned startX;
+	unsigned endX;
+	_cleanRow(cache, y, &startX, &endX);
+}
+
+size_t mMapCacheCleanDirtyRegions(struct mMapCache* cache, struct mMapCacheRegion* regions, size_t maxRegions) {
+	unsigned tilesHigh = 1 << mMapCacheSystemInfoGetTilesHigh(cache->sysConfig);
+	size_t nRegions = 0;
+	unsigned y;
+	for (y = 0; y < tilesHigh && nRegions < maxRegions; ++y) {
+		unsigned startX;
+		unsigned endX;
+		if (!_cleanRow(cache, y, &startX, &endX)) {
+			continue;
+		}
+		if (nRegions) {
+			struct mMapCacheRegion* last = &regions[nRegions - 1];
+			if (last->x == startX && last->width == endX - startX && last->y + last->height == y) {
+				++last->height;
+				continue;
+			}
+		}
+		regions[nRegions].x = startX;
+		regions[nRegions].y = y;
+		regions[nRegions].width = endX - startX;
+		regions[nRegions].height = 1;
+		++nRegions;
 	}
+	return nRegions;
 }
 
 const color_t* mMapCacheGetRow(struct mMapCache* cache, unsigned y) {
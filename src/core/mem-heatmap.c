@@ -0,0 +1,70 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/mem-heatmap.h>
+
+#include <mgba-util/memory.h>
+#include <mgba-util/vfs.h>
+
+#define HEATMAP_SIZE (sizeof(struct mMemoryHeatmapPage) * mMEMORY_HEATMAP_PAGES)
+
+void mMemoryHeatmapInit(struct mMemoryHeatmap* heatmap) {
+	// Mapped rather than calloced, so pages that are never touched never get backed
+	heatmap->pages = anonymousMemoryMap(HEATMAP_SIZE);
+	heatmap->firstFrame = 0;
+	heatmap->lastFrame = 0;
+}
+
+void mMemoryHeatmapDeinit(struct mMemoryHeatmap* heatmap) {
+	mappedMemoryFree(heatmap->pages, HEATMAP_SIZE);
+	heatmap->pages = NULL;
+}
+
+void mMemoryHeatmapReset(struct mMemoryHeatmap* heatmap, uint32_t frame) {
+	memset(heatmap->pages, 0, HEATMAP_SIZE);
+	heatmap->firstFrame = frame;
+	heatmap->lastFrame = frame;
+}
+
+void mMemoryHeatmapMarkFrame(struct mMemoryHeatmap* heatmap, uint32_t frame) {
+	heatmap->lastFrame = frame;
+}
+
+void mMemoryHeatmapSum(const struct mMemoryHeatmap* heatmap, uint32_t address, size_t count, struct mMemoryHeatmapPage* out) {
+	memset(out, 0, sizeof(*out));
+	size_t page = (address >> mMEMORY_HEATMAP_PAGE_SHIFT) & (mMEMORY_HEATMAP_PAGES - 1);
+	for (; count && page < mMEMORY_HEATMAP_PAGES; --count, ++page) {
+		int i;
+		for (i = 0; i < mMEMORY_HEATMAP_MAX; ++i) {
+			out->accesses[i] += heatmap->pages[page].accesses[i];
+			out->cycles[i] += heatmap->pages[page].cycles[i];
+		}
+	}
+}
+
+bool mMemoryHeatmapDump(const struct mMemoryHeatmap* heatmap, struct VFile* vf) {
+	char line[256];
+	int length = snprintf(line, sizeof(line), "first_frame,last_frame\n%u,%u\n"
+	                      "address,reads,writes,executes,read_cycles,write_cycles,execute_cycles\n",
+	                      heatmap->firstFrame, heatmap->lastFrame);
+	if (length < 0 || (size_t) length >= sizeof(line) || vf->write(vf, line, length) != length) {
+		return false;
+	}
+	size_t i;
+	for (i = 0; i < mMEMORY_HEATMAP_PAGES; ++i) {
+		const struct mMemoryHeatmapPage* page = &heatmap->pages[i];
+		if (!page->accesses[mMEMORY_HEATMAP_READ] && !page->accesses[mMEMORY_HEATMAP_WRITE] && !page->accesses[mMEMORY_HEATMAP_EXECUTE]) {
+			continue;
+		}
+		length = snprintf(line, sizeof(line), "0x%08X,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+		                  (unsigned) (i << mMEMORY_HEATMAP_PAGE_SHIFT),
+		                  page->accesses[mMEMORY_HEATMAP_READ], page->accesses[mMEMORY_HEATMAP_WRITE], page->accesses[mMEMORY_HEATMAP_EXECUTE],
+		                  page->cycles[mMEMORY_HEATMAP_READ], page->cycles[mMEMORY_HEATMAP_WRITE], page->cycles[mMEMORY_HEATMAP_EXECUTE]);
+		if (length < 0 || (size_t) length >= sizeof(line) || vf->write(vf, line, length) != length) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,120 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/mem-probe.h>
+
+#include <mgba/core/core.h>
+#include <mgba/core/interface.h>
+
+DEFINE_VECTOR(mCoreMemoryProbes, struct mCoreMemoryProbe);
+
+void mCoreMemoryProbeListInit(struct mCoreMemoryProbeList* list, struct mCore* core) {
+	list->core = core;
+	list->nBlocks = 0;
+	mCoreMemoryProbesInit(&list->probes, 0);
+}
+
+void mCoreMemoryProbeListDeinit(struct mCoreMemoryProbeList* list) {
+	mCoreMemoryProbesDeinit(&list->probes);
+}
+
+static int _findBlock(struct mCoreMemoryProbeList* list, uint32_t address, int width, uint32_t* offset) {
+	if (address & (width - 1)) {
+		// Buses differ in how they handle these, so leave it to them
+		return -1;
+	}
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = list->core->listMemoryBlocks(list->core, &blocks);
+	size_t i;
+	for (i = 0; i < nBlocks; ++i) {
+		const struct mCoreMemoryBlock* block = &blocks[i];
+		if ((block->flags & mCORE_MEMORY_VIRTUAL) || !(block->flags & mCORE_MEMORY_MAPPED)) {
+			continue;
+		}
+		if (address < block->start || address + width > block->end) {
+			continue;
+		}
+		if (block->maxSegment && address + width > block->segmentStart) {
+			// Which bank is visible can change from one read to the next
+			return -1;
+		}
+		size_t b;
+		for (b = 0; b < list->nBlocks; ++b) {
+			if (list->blockIds[b] == block->id) {
+				break;
+			}
+		}
+		if (b == list->nBlocks) {
+			if (list->nBlocks == mCORE_MEMORY_PROBE_MAX_BLOCKS) {
+				return -1;
+			}
+			list->blockIds[b] = block->id;
+			++list->nBlocks;
+		}
+		*offset = address - block->start;
+		return b;
+	}
+	return -1;
+}
+
+size_t mCoreMemoryProbeListAdd(struct mCoreMemoryProbeList* list, uint32_t address, int width) {
+	struct mCoreMemoryProbe* probe = mCoreMemoryProbesAppend(&list->probes);
+	probe->address = address;
+	probe->width = width;
+	probe->offset = 0;
+	probe->block = _findBlock(list, address, width, &probe->offset);
+	return mCoreMemoryProbesSize(&list->probes) - 1;
+}
+
+void mCoreMemoryProbeListClear(struct mCoreMemoryProbeList* list) {
+	mCoreMemoryProbesClear(&list->probes);
+	list->nBlocks = 0;
+}
+
+void mCoreMemoryProbeListRead(struct mCoreMemoryProbeList* list, uint32_t* values) {
+	struct mCore* core = list->core;
+	const uint8_t* bases[mCORE_MEMORY_PROBE_MAX_BLOCKS];
+	size_t sizes[mCORE_MEMORY_PROBE_MAX_BLOCKS];
+	size_t b;
+	for (b = 0; b < list->nBlocks; ++b) {
+		sizes[b] = 0;
+		bases[b] = core->getMemoryBlock(core, list->blockIds[b], &sizes[b]);
+	}
+
+	size_t i;
+	size_t nProbes = mCoreMemoryProbesSize(&list->probes);
+	const struct mCoreMemoryProbe* probe = list->probes.vector;
+	for (i = 0; i < nProbes; ++i, ++probe) {
+		// A block may be smaller than its address range, such as a ROM that doesn't fill the cartridge space
+		if (probe->block >= 0 && bases[probe->block] && probe->offset + probe->width <= sizes[probe->block]) {
+			const uint8_t* base = bases[probe->block];
+			switch (probe->width) {
+			case 1:
+				values[i] = base[probe->offset];
+				continue;
+			case 2:
+				LOAD_16LE(values[i], probe->offset, base);
+				continue;
+			case 4:
+				LOAD_32LE(values[i], probe->offset, base);
+				continue;
+			}
+		}
+		switch (probe->width) {
+		case 1:
+			values[i] = core->busRead8(core, probe->address);
+			break;
+		case 2:
+			values[i] = core->busRead16(core, probe->address);
+			break;
+		case 4:
+			values[i] = core->busRead32(core, probe->address);
+			break;
+		default:
+			values[i] = 0;
+			break;
+		}
+	}
+}
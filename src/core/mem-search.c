@@ -8,6 +8,21 @@
 #include <mgba/core/core.h>
 #include <mgba/core/interface.h>
 
+#include <mgba-util/threading.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define MEM_SEARCH_SIMD_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MEM_SEARCH_SIMD_NEON
+#endif
+
+#define SEARCH_CHUNK 16
+#define SEARCH_THREADS 4
+#define SEARCH_THREAD_MIN_SIZE 0x100000
+#define SEARCH_THREAD_MAX_LIMIT 0x40000
+
 DEFINE_VECTOR(mCoreMemorySearchResults, struct mCoreMemorySearchResult);
 
 static bool _op(int32_t value, int32_t match, enum mCoreMemorySearchOp op) {
@@ -23,6 +38,208 @@ static bool _op(int32_t value, int32_t match, enum mCoreMemorySearchOp op) {
 	return false;
 }
 
+// Each of the _match functions below compares one 16-byte chunk against the value,
+// returning a mask with bit n set if the nth element of the chunk matches
+#ifndef MEM_SEARCH_SIMD_SSE2
+static unsigned _scalarMatch32(const uint32_t* mem32, uint32_t value32, enum mCoreMemorySearchOp op) {
+	unsigned mask = 0;
+	int n;
+	for (n = 0; n < SEARCH_CHUNK / 4; ++n) {
+		if (_op(mem32[n], value32, op)) {
+			mask |= 1 << n;
+		}
+	}
+	return mask;
+}
+
+static unsigned _scalarMatch16(const uint16_t* mem16, uint16_t value16, enum mCoreMemorySearchOp op) {
+	unsigned mask = 0;
+	int n;
+	for (n = 0; n < SEARCH_CHUNK / 2; ++n) {
+		if (_op(mem16[n], value16, op)) {
+			mask |= 1 << n;
+		}
+	}
+	return mask;
+}
+
+static unsigned _scalarMatch8(const uint8_t* mem8, uint8_t value8, enum mCoreMemorySearchOp op) {
+	unsigned mask = 0;
+	int n;
+	for (n = 0; n < SEARCH_CHUNK; ++n) {
+		if (_op(mem8[n], value8, op)) {
+			mask |= 1 << n;
+		}
+	}
+	return mask;
+}
+#endif
+
+// 32-bit values compare signed, while narrower values are zero-extended by _op and so compare unsigned
+static inline unsigned _match32(const uint32_t* mem32, uint32_t value32, enum mCoreMemorySearchOp op) {
+#if defined(MEM_SEARCH_SIMD_SSE2)
+	__m128i chunk = _mm_loadu_si128((const __m128i*) mem32);
+	__m128i match = _mm_set1_epi32(value32);
+	__m128i cmp;
+	switch (op) {
+	case mCORE_MEMORY_SEARCH_GREATER:
+		cmp = _mm_cmpgt_epi32(chunk, match);
+		break;
+	case mCORE_MEMORY_SEARCH_LESS:
+		cmp = _mm_cmplt_epi32(chunk, match);
+		break;
+	default:
+		cmp = _mm_cmpeq_epi32(chunk, match);
+		break;
+	}
+	return _mm_movemask_ps(_mm_castsi128_ps(cmp));
+#elif defined(MEM_SEARCH_SIMD_NEON)
+	int32x4_t chunk = vld1q_s32((const int32_t*) mem32);
+	int32x4_t match = vdupq_n_s32(value32);
+	uint32x4_t cmp;
+	switch (op) {
+	case mCORE_MEMORY_SEARCH_GREATER:
+		cmp = vcgtq_s32(chunk, match);
+		break;
+	case mCORE_MEMORY_SEARCH_LESS:
+		cmp = vcltq_s32(chunk, match);
+		break;
+	default:
+		cmp = vceqq_s32(chunk, match);
+		break;
+	}
+	uint64x2_t wide = vreinterpretq_u64_u32(cmp);
+	if (!(vgetq_lane_u64(wide, 0) | vgetq_lane_u64(wide, 1))) {
+		return 0;
+	}
+	return _scalarMatch32(mem32, value32, op);
+#else
+	return _scalarMatch32(mem32, value32, op);
+#endif
+}
+
+static inline unsigned _match16(const uint16_t* mem16, uint16_t value16, enum mCoreMemorySearchOp op) {
+#if defined(MEM_SEARCH_SIMD_SSE2)
+	__m128i chunk = _mm_loadu_si128((const __m128i*) mem16);
+	__m128i match = _mm_set1_epi16(value16);
+	__m128i bias = _mm_set1_epi16(0x8000);
+	__m128i cmp;
+	// SSE2 only has signed comparisons, so flip the sign bits to compare unsigned
+	switch (op) {
+	case mCORE_MEMORY_SEARCH_GREATER:
+		cmp = _mm_cmpgt_epi16(_mm_xor_si128(chunk, bias), _mm_xor_si128(match, bias));
+		break;
+	case mCORE_MEMORY_SEARCH_LESS:
+		cmp = _mm_cmplt_epi16(_mm_xor_si128(chunk, bias), _mm_xor_si128(match, bias));
+		break;
+	default:
+		cmp = _mm_cmpeq_epi16(chunk, match);
+		break;
+	}
+	return _mm_movemask_epi8(_mm_packs_epi16(cmp, _mm_setzero_si128()));
+#elif defined(MEM_SEARCH_SIMD_NEON)
+	uint16x8_t chunk = vld1q_u16(mem16);
+	uint16x8_t match = vdupq_n_u16(value16);
+	uint16x8_t cmp;
+	switch (op) {
+	case mCORE_MEMORY_SEARCH_GREATER:
+		cmp = vcgtq_u16(chunk, match);
+		break;
+	case mCORE_MEMORY_SEARCH_LESS:
+		cmp = vcltq_u16(chunk, match);
+		break;
+	default:
+		cmp = vceqq_u16(chunk, match);
+		break;
+	}
+	uint64x2_t wide = vreinterpretq_u64_u16(cmp);
+	if (!(vgetq_lane_u64(wide, 0) | vgetq_lane_u64(wide, 1))) {
+		return 0;
+	}
+	return _scalarMatch16(mem16, value16, op);
+#else
+	return _scalarMatch16(mem16, value16, op);
+#endif
+}
+
+static inline unsigned _match8(const uint8_t* mem8, uint8_t value8, enum mCoreMemorySearchOp op) {
+#if defined(MEM_SEARCH_SIMD_SSE2)
+	__m128i chunk = _mm_loadu_si128((const __m128i*) mem8);
+	__m128i match = _mm_set1_epi8(value8);
+	__m128i bias = _mm_set1_epi8(0x80);
+	__m128i cmp;
+	switch (op) {
+	case mCORE_MEMORY_SEARCH_GREATER:
+		cmp = _mm_cmpgt_epi8(_mm_xor_si128(chunk, bias), _mm_xor_si128(match, bias));
+		break;
+	case mCORE_MEMORY_SEARCH_LESS:
+		cmp = _mm_cmplt_epi8(_mm_xor_si128(chunk, bias), _mm_xor_si128(match, bias));
+		break;
+	default:
+		cmp = _mm_cmpeq_epi8(chunk, match);
+		break;
+	}
+	return _mm_movemask_epi8(cmp);
+#elif defined(MEM_SEARCH_SIMD_NEON)
+	uint8x16_t chunk = vld1q_u8(mem8);
+	uint8x16_t match = vdupq_n_u8(value8);
+	uint8x16_t cmp;
+	switch (op) {
+	case mCORE_MEMORY_SEARCH_GREATER:
+		cmp = vcgtq_u8(chunk, match);
+		break;
+	case mCORE_MEMORY_SEARCH_LESS:
+		cmp = vcltq_u8(chunk, match);
+		break;
+	default:
+		cmp = vceqq_u8(chunk, match);
+		break;
+	}
+	uint64x2_t wide = vreinterpretq_u64_u8(cmp);
+	if (!(vgetq_lane_u64(wide, 0) | vgetq_lane_u64(wide, 1))) {
+		return 0;
+	}
+	return _scalarMatch8(mem8, value8, op);
+#else
+	return _scalarMatch8(mem8, value8, op);
+#endif
+}
+
+static void _appendInt(struct mCoreMemorySearchResults* out, uint32_t address, int width, uint32_t value, uint32_t raw) {
+	struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsAppend(out);
+	res->address = address;
+	res->type = mCORE_MEMORY_SEARCH_INT;
+	res->width = width;
+	res->segment = -1; // TODO
+	res->guessDivisor = 1;
+	res->guessMultiplier = 1;
+	res->oldValue = value;
+	res->lastValue = raw;
+}
+
+static uint32_t _loadNative(const void* mem, int width, size_t index) {
+	switch (width) {
+	case 1:
+		return ((const uint8_t*) mem)[index];
+	case 2:
+		return ((const uint16_t*) mem)[index];
+	default:
+		return ((const uint32_t*) mem)[index];
+	}
+}
+
+// Appends the matches flagged in mask for the chunk at mem in address order, returning the new total found
+static size_t _appendMask(struct mCoreMemorySearchResults* out, unsigned mask, const void* mem, uint32_t address, int width, uint32_t value, size_t found, size_t limit) {
+	size_t n;
+	for (n = 0; mask && (!limit || found < limit); mask >>= 1, ++n) {
+		if (mask & 1) {
+			_appendInt(out, address + n * width, width, value, _loadNative(mem, width, n));
+			++found;
+		}
+	}
+	return found;
+}
+
 static size_t _search32(const void* mem, size_t size, const struct mCoreMemoryBlock* block, uint32_t value32, enum mCoreMemorySearchOp op, struct mCoreMemorySearchResults* out, size_t limit) {
 	const uint32_t* mem32 = mem;
 	size_t found = 0;
@@ -30,16 +247,15 @@ static size_t _search32(const void* mem, size_t size, const struct mCoreMemoryBl
 	uint32_t end = size; // TODO: Segments
 	size_t i;
 	// TODO: Big endian
-	for (i = 0; (!limit || found < limit) && i < end; i += 4) {
+	for (i = 0; (!limit || found < limit) && i + SEARCH_CHUNK <= end; i += SEARCH_CHUNK) {
+		unsigned mask = _match32(&mem32[i >> 2], value32, op);
+		if (mask) {
+			found = _appendMask(out, mask, &mem32[i >> 2], start + i, 4, value32, found, limit);
+		}
+	}
+	for (; (!limit || found < limit) && i < end; i += 4) {
 		if (_op(mem32[i >> 2], value32, op)) {
-			struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsAppend(out);
-			res->address = start + i;
-			res->type = mCORE_MEMORY_SEARCH_INT;
-			res->width = 4;
-			res->segment = -1; // TODO
-			res->guessDivisor = 1;
-			res->guessMultiplier = 1;
-			res->oldValue = value32;
+			_appendInt(out, start + i, 4, value32, mem32[i >> 2]);
 			++found;
 		}
 	}
@@ -53,16 +269,15 @@ static size_t _search16(const void* mem, size_t size, const struct mCoreMemoryBl
 	uint32_t end = size; // TODO: Segments
 	size_t i;
 	// TODO: Big endian
-	for (i = 0; (!limit || found < limit) && i < end; i += 2) {
+	for (i = 0; (!limit || found < limit) && i + SEARCH_CHUNK <= end; i += SEARCH_CHUNK) {
+		unsigned mask = _match16(&mem16[i >> 1], value16, op);
+		if (mask) {
+			found = _appendMask(out, mask, &mem16[i >> 1], start + i, 2, value16, found, limit);
+		}
+	}
+	for (; (!limit || found < limit) && i < end; i += 2) {
 		if (_op(mem16[i >> 1], value16, op)) {
-			struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsAppend(out);
-			res->address = start + i;
-			res->type = mCORE_MEMORY_SEARCH_INT;
-			res->width = 2;
-			res->segment = -1; // TODO
-			res->guessDivisor = 1;
-			res->guessMultiplier = 1;
-			res->oldValue = value16;
+			_appendInt(out, start + i, 2, value16, mem16[i >> 1]);
 			++found;
 		}
 	}
@@ -75,16 +290,15 @@ static size_t _search8(const void* mem, size_t size, const struct mCoreMemoryBlo
 	uint32_t start = block->start;
 	uint32_t end = size; // TODO: Segments
 	size_t i;
-	for (i = 0; (!limit || found < limit) && i < end; ++i) {
+	for (i = 0; (!limit || found < limit) && i + SEARCH_CHUNK <= end; i += SEARCH_CHUNK) {
+		unsigned mask = _match8(&mem8[i], value8, op);
+		if (mask) {
+			found = _appendMask(out, mask, &mem8[i], start + i, 1, value8, found, limit);
+		}
+	}
+	for (; (!limit || found < limit) && i < end; ++i) {
 		if (_op(mem8[i], value8, op)) {
-			struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsAppend(out);
-			res->address = start + i;
-			res->type = mCORE_MEMORY_SEARCH_INT;
-			res->width = 1;
-			res->segment = -1; // TODO
-			res->guessDivisor = 1;
-			res->guessMultiplier = 1;
-			res->oldValue = value8;
+			_appendInt(out, start + i, 1, value8, mem8[i]);
 			++found;
 		}
 	}
@@ -105,19 +319,41 @@ static size_t _searchInt(const void* mem, size_t size, const struct mCoreMemoryB
 	return 0;
 }
 
+static bool _matchStr(const char* memStr, const char* valueStr, int len, uint32_t start, uint32_t i, struct mCoreMemorySearchResults* out) {
+	if (memcmp(valueStr, &memStr[i], len)) {
+		return false;
+	}
+	struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsAppend(out);
+	res->address = start + i;
+	res->type = mCORE_MEMORY_SEARCH_STRING;
+	res->width = len;
+	res->segment = -1; // TODO
+	return true;
+}
+
 static size_t _searchStr(const void* mem, size_t size, const struct mCoreMemoryBlock* block, const char* valueStr, int len, struct mCoreMemorySearchResults* out, size_t limit) {
 	const char* memStr = mem;
 	size_t found = 0;
 	uint32_t start = block->start;
 	uint32_t end = size; // TODO: Segments
-	size_t i;
-	for (i = 0; (!limit || found < limit) && i < end - len; ++i) {
-		if (!memcmp(valueStr, &memStr[i], len)) {
-			struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsAppend(out);
-			res->address = start + i;
-			res->type = mCORE_MEMORY_SEARCH_STRING;
-			res->width = len;
-			res->segment = -1; // TODO
+	size_t i = 0;
+	if (len > 0) {
+		if ((uint32_t) len > end) {
+			return 0;
+		}
+		// Only positions where the first character matches need a full comparison
+		for (; (!limit || found < limit) && i + SEARCH_CHUNK <= end; i += SEARCH_CHUNK) {
+			unsigned mask = _match8((const uint8_t*) &memStr[i], valueStr[0], mCORE_MEMORY_SEARCH_EQUAL);
+			uint32_t offset;
+			for (offset = i; mask && (!limit || found < limit) && offset < end - len; mask >>= 1, ++offset) {
+				if ((mask & 1) && _matchStr(memStr, valueStr, len, start, offset, out)) {
+					++found;
+				}
+			}
+		}
+	}
+	for (; (!limit || found < limit) && i < end - len; ++i) {
+		if (_matchStr(memStr, valueStr, len, start, i, out)) {
 			++found;
 		}
 	}
@@ -217,13 +453,121 @@ static size_t _search(const void* mem, size_t size, const struct mCoreMemoryBloc
 	return 0;
 }
 
+struct mCoreMemorySearchJob {
+	const struct mCoreMemoryBlock* block;
+	const void* mem;
+	size_t size;
+	struct mCoreMemorySearchResults results;
+	size_t found;
+	bool done;
+};
+
+struct mCoreMemorySearchContext {
+	const struct mCoreMemorySearchParams* params;
+	size_t limit;
+	struct mCoreMemorySearchJob* jobs;
+	size_t nJobs;
+	size_t nextJob;
+	size_t donePrefix;
+	size_t prefixFound;
+	Mutex mutex;
+};
+
+#ifndef DISABLE_THREADING
+static void _searchJobs(struct mCoreMemorySearchContext* context) {
+	MutexLock(&context->mutex);
+	// Once the blocks finished in order hold enough results, the remaining blocks would be discarded anyway
+	while (context->nextJob < context->nJobs && (!context->limit || context->prefixFound < context->limit)) {
+		struct mCoreMemorySearchJob* job = &context->jobs[context->nextJob];
+		++context->nextJob;
+		MutexUnlock(&context->mutex);
+		job->found = _search(job->mem, job->size, job->block, context->params, &job->results, context->limit);
+		MutexLock(&context->mutex);
+		job->done = true;
+		while (context->donePrefix < context->nJobs && context->jobs[context->donePrefix].done) {
+			context->prefixFound += context->jobs[context->donePrefix].found;
+			++context->donePrefix;
+		}
+	}
+	MutexUnlock(&context->mutex);
+}
+
+static THREAD_ENTRY _searchThread(void* user) {
+	ThreadSetName("Memory Search Thread");
+	_searchJobs(user);
+
+#ifdef _3DS
+	svcExitThread();
+#endif
+	return 0;
+}
+
+// Whether a block's results can be merged as-is after the blocks before it found the given number of results
+static bool _searchJobUsable(const struct mCoreMemorySearchContext* context, const struct mCoreMemorySearchJob* job, size_t found) {
+	if (!job->done) {
+		return false;
+	}
+	if (context->params->type != mCORE_MEMORY_SEARCH_GUESS || !context->limit || !found) {
+		return true;
+	}
+	// Guesses search several values in turn, so a block searched with a tighter limit
+	// doesn't necessarily find a prefix of what it finds with a looser one
+	return job->found <= context->limit - found;
+}
+
+static void _searchParallel(struct mCoreMemorySearchContext* context, struct mCoreMemorySearchResults* out) {
+	Thread threads[SEARCH_THREADS - 1];
+	size_t nThreads = context->nJobs < SEARCH_THREADS ? context->nJobs - 1 : SEARCH_THREADS - 1;
+	size_t t;
+	MutexInit(&context->mutex);
+	for (t = 0; t < nThreads; ++t) {
+		ThreadCreate(&threads[t], _searchThread, context);
+	}
+	_searchJobs(context);
+	for (t = 0; t < nThreads; ++t) {
+		ThreadJoin(threads[t]);
+	}
+	MutexDeinit(&context->mutex);
+
+	size_t limit = context->limit;
+	size_t found = 0;
+	size_t b;
+	for (b = 0; b < context->nJobs; ++b) {
+		struct mCoreMemorySearchJob* job = &context->jobs[b];
+		if (!limit || found < limit) {
+			if (_searchJobUsable(context, job, found)) {
+				size_t nResults = job->found;
+				if (limit && context->params->type != mCORE_MEMORY_SEARCH_GUESS && nResults > limit - found) {
+					nResults = limit - found;
+				}
+				size_t i;
+				for (i = 0; i < nResults; ++i) {
+					*mCoreMemorySearchResultsAppend(out) = *mCoreMemorySearchResultsGetPointer(&job->results, i);
+				}
+				found += nResults;
+			} else {
+				found += _search(job->mem, job->size, job->block, context->params, out, limit ? limit - found : 0);
+			}
+		}
+		mCoreMemorySearchResultsDeinit(&job->results);
+	}
+}
+#endif
+
 void mCoreMemorySearch(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* out, size_t limit) {
 	const struct mCoreMemoryBlock* blocks;
 	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
 	size_t found = 0;
 
+	struct mCoreMemorySearchContext context = {
+		.params = params,
+		.limit = limit,
+		.jobs = calloc(nBlocks, sizeof(struct mCoreMemorySearchJob)),
+	};
+	size_t totalSize = 0;
+
 	size_t b;
-	for (b = 0; (!limit || found < limit) && b < nBlocks; ++b) {
+	for (b = 0; b < nBlocks; ++b) {
 		size_t size;
 		const struct mCoreMemoryBlock* block = &blocks[b];
 		if (!(block->flags & params->memoryFlags)) {
@@ -236,94 +580,251 @@ void mCoreMemorySearch(struct mCore* core, const struct mCoreMemorySearchParams*
 		if (size > block->end - block->start) {
 			size = block->end - block->start; // TOOD: Segments
 		}
-		found += _search(mem, size, block, params, out, limit ? limit - found : 0);
+		struct mCoreMemorySearchJob* job = &context.jobs[context.nJobs];
+		++context.nJobs;
+		job->block = block;
+		job->mem = mem;
+		job->size = size;
+		totalSize += size;
 	}
+
+#ifndef DISABLE_THREADING
+	// Each block collects up to limit results before they are merged, so unbounded searches stay serial
+	if (context.nJobs > 1 && totalSize >= SEARCH_THREAD_MIN_SIZE && limit && limit <= SEARCH_THREAD_MAX_LIMIT) {
+		for (b = 0; b < context.nJobs; ++b) {
+			mCoreMemorySearchResultsInit(&context.jobs[b].results, 0);
+		}
+		_searchParallel(&context, out);
+		free(context.jobs);
+		return;
+	}
+#endif
+
+	for (b = 0; (!limit || found < limit) && b < context.nJobs; ++b) {
+		const struct mCoreMemorySearchJob* job = &context.jobs[b];
+		found += _search(job->mem, job->size, job->block, params, out, limit ? limit - found : 0);
+	}
+	free(context.jobs);
 }
 
-bool _testGuess(struct mCore* core, struct mCoreMemorySearchResult* res, const struct mCoreMemorySearchParams* params) {
-	int64_t value;
+// A memory block that can be read straight from its backing memory instead of going through the bus
+struct mCoreMemorySearchView {
+	const struct mCoreMemoryBlock* block;
+	const uint8_t* mem;
+	size_t size;
+	const uint32_t* dirty;
+};
+
+static size_t _searchViews(struct mCore* core, struct mCoreMemorySearchView* views) {
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
+	size_t nViews = 0;
+	size_t b;
+	for (b = 0; b < nBlocks; ++b) {
+		const struct mCoreMemoryBlock* block = &blocks[b];
+		if (block->flags & mCORE_MEMORY_VIRTUAL) {
+			continue;
+		}
+		struct mCoreMemorySearchView* view = &views[nViews];
+		++nViews;
+		view->block = block;
+		view->size = block->end - block->start;
+		// Banked blocks are read through whichever bank is currently mapped, so only flat blocks qualify.
+		// The blocks that support dirty tracking are exactly those backed by plain memory;
+		// the rest are kept so lookups still land somewhere, but get read over the bus
+		if (block->maxSegment || !core->trackMemoryBlockDirty(core, block->id, true)) {
+			continue;
+		}
+		size_t size;
+		void* mem = core->getMemoryBlock(core, block->id, &size);
+		size_t nPages;
+		const uint32_t* dirty = core->getMemoryBlockDirty(core, block->id, &nPages);
+		if (!mem || !dirty) {
+			continue;
+		}
+		if (size < view->size) {
+			view->size = size;
+		}
+		view->mem = mem;
+		view->dirty = dirty;
+	}
+	return nViews;
+}
+
+static const struct mCoreMemorySearchView* _findView(const struct mCoreMemorySearchView* views, size_t nViews, const struct mCoreMemorySearchResult* res, size_t* hint) {
+	if (res->segment >= 0) {
+		return NULL;
+	}
+	// Results mostly come in address order, so the previous result's block is usually the right one
+	const struct mCoreMemorySearchView* view = &views[*hint];
+	if (*hint >= nViews || res->address - view->block->start >= view->size) {
+		view = NULL;
+		size_t v;
+		for (v = 0; v < nViews; ++v) {
+			if (res->address - views[v].block->start < views[v].size) {
+				*hint = v;
+				view = &views[v];
+				break;
+			}
+		}
+	}
+	if (!view || !view->mem) {
+		return NULL;
+	}
+	return view;
+}
+
+static uint32_t _readValue(struct mCore* core, const struct mCoreMemorySearchView* view, const struct mCoreMemorySearchResult* res, int width) {
+	if (view && width > 0 && !(res->address & (width - 1))) {
+		uint32_t offset = res->address - view->block->start;
+		if (offset + width <= view->size) {
+			uint32_t value = 0;
+			switch (width) {
+			case 1:
+				value = view->mem[offset];
+				break;
+			case 2:
+				LOAD_16LE(value, offset, view->mem);
+				break;
+			case 4:
+				LOAD_32LE(value, offset, view->mem);
+				break;
+			}
+			return value;
+		}
+	}
+	switch (width) {
+	case 1:
+		return core->rawRead8(core, res->address, res->segment);
+	case 2:
+		return core->rawRead16(core, res->address, res->segment);
+	case 4:
+		return core->rawRead32(core, res->address, res->segment);
+	default:
+		return 0;
+	}
+}
+
+static bool _isClean(const struct mCoreMemorySearchView* view, const struct mCoreMemorySearchResult* res) {
+	if (!view || res->width <= 0 || (res->address & (res->width - 1))) {
+		return false;
+	}
+	uint32_t page = (res->address - view->block->start) >> mCORE_MEMORY_DIRTY_PAGE_SHIFT;
+	return !(view->dirty[page >> 5] & (1U << (page & 0x1F)));
+}
+
+static bool _testGuess(struct mCore* core, const struct mCoreMemorySearchView* view, struct mCoreMemorySearchResult* res, const struct mCoreMemorySearchParams* params, const int64_t* guesses) {
 	int32_t offset = 0;
-	char* end;
 	if (params->op == mCORE_MEMORY_SEARCH_DELTA) {
 		offset = res->oldValue;
 	}
 
-	value = strtoll(params->valueStr, &end, 10);
-	if (end) {
+	// Decimal, then hex
+	int i;
+	for (i = 0; i < 2; ++i) {
+		int64_t value = guesses[i];
 		res->oldValue += value;
-		if (_op(core->rawRead8(core, res->address, res->segment) * res->guessDivisor / res->guessMultiplier, value + offset, params->op)) {
+		if (_op(_readValue(core, view, res, 1) * res->guessDivisor / res->guessMultiplier, value + offset, params->op)) {
 			return true;
 		}
-		if (!(res->address & 1) && (res->width >= 2 || res->width == -1) && _op(core->rawRead16(core, res->address, res->segment) * res->guessDivisor / res->guessMultiplier, value + offset, params->op)) {
+		if (!(res->address & 1) && (res->width >= 2 || res->width == -1) && _op(_readValue(core, view, res, 2) * res->guessDivisor / res->guessMultiplier, value + offset, params->op)) {
 			return true;
 		}
-		if (!(res->address & 3) && (res->width >= 4 || res->width == -1) && _op(core->rawRead32(core, res->address, res->segment) * res->guessDivisor / res->guessMultiplier, value + offset, params->op)) {
+		if (!(res->address & 3) && (res->width >= 4 || res->width == -1) && _op(_readValue(core, view, res, 4) * res->guessDivisor / res->guessMultiplier, value + offset, params->op)) {
 			return true;
 		}
 		res->oldValue -= value;
 	}
+	return false;
+}
 
-	value = strtoll(params->valueStr, &end, 16);
-	if (end) {
-		res->oldValue += value;
-		if (_op(core->rawRead8(core, res->address, res->segment) * res->guessDivisor / res->guessMultiplier, value + offset, params->op)) {
-			return true;
-		}
-		if (!(res->address & 1) && (res->width >= 2 || res->width == -1) && _op(core->rawRead16(core, res->address, res->segment) * res->guessDivisor / res->guessMultiplier, value + offset, params->op)) {
-			return true;
-		}
-		if (!(res->address & 3) && (res->width >= 4 || res->width == -1) && _op(core->rawRead32(core, res->address, res->segment) * res->guessDivisor / res->guessMultiplier, value + offset, params->op)) {
-			return true;
+// Returns whether the result still matches, reusing its last value if it is known to be unchanged
+static bool _testResult(struct mCore* core, const struct mCoreMemorySearchView* view, bool clean, struct mCoreMemorySearchResult* res, const struct mCoreMemorySearchParams* params, const int64_t* guesses) {
+	switch (res->type) {
+	case mCORE_MEMORY_SEARCH_INT:
+		if (params->type == mCORE_MEMORY_SEARCH_GUESS) {
+			return _testGuess(core, view, res, params, guesses);
+		} else if (params->type == mCORE_MEMORY_SEARCH_INT) {
+			int32_t oldValue = params->valueInt;
+			if (params->op == mCORE_MEMORY_SEARCH_DELTA) {
+				oldValue += res->oldValue;
+			}
+			int32_t value;
+			if (clean && params->width == res->width) {
+				value = res->lastValue;
+			} else {
+				value = _readValue(core, view, res, params->width);
+			}
+			if (!_op(value, oldValue, params->op)) {
+				return false;
+			}
+			res->oldValue = value;
 		}
-		res->oldValue -= value;
+		break;
+	case mCORE_MEMORY_SEARCH_STRING:
+	case mCORE_MEMORY_SEARCH_GUESS:
+		// TOOD
+		break;
 	}
-	return false;
+	return true;
+}
+
+static void _parseGuesses(const struct mCoreMemorySearchParams* params, int64_t* guesses) {
+	if (params->type != mCORE_MEMORY_SEARCH_GUESS) {
+		return;
+	}
+	guesses[0] = strtoll(params->valueStr, NULL, 10);
+	guesses[1] = strtoll(params->valueStr, NULL, 16);
 }
 
 void mCoreMemorySearchRepeat(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* inout) {
+	int64_t guesses[2];
+	_parseGuesses(params, guesses);
 	size_t i;
 	for (i = 0; i < mCoreMemorySearchResultsSize(inout); ++i) {
 		struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsGetPointer(inout, i);
-		switch (res->type) {
-		case mCORE_MEMORY_SEARCH_INT:
-			if (params->type == mCORE_MEMORY_SEARCH_GUESS) {
-				if (!_testGuess(core, res, params)) {
-					*res = *mCoreMemorySearchResultsGetPointer(inout, mCoreMemorySearchResultsSize(inout) - 1);
-					mCoreMemorySearchResultsResize(inout, -1);
-					--i;
-				}
-			} else if (params->type == mCORE_MEMORY_SEARCH_INT) {
-				int32_t oldValue = params->valueInt;
-				if (params->op == mCORE_MEMORY_SEARCH_DELTA) {
-					oldValue += res->oldValue;
-				}
-				int32_t value = 0;
-				switch (params->width) {
-				case 1:
-					value = core->rawRead8(core, res->address, res->segment);
-					break;
-				case 2:
-					value = core->rawRead16(core, res->address, res->segment);
-					break;
-				case 4:
-					value = core->rawRead32(core, res->address, res->segment);
-					break;
-				default:
-					break;
-				}
-				if (!_op(value, oldValue, params->op)) {
-					*res = *mCoreMemorySearchResultsGetPointer(inout, mCoreMemorySearchResultsSize(inout) - 1);
-					mCoreMemorySearchResultsResize(inout, -1);
-					--i;
-				} else {
-					res->oldValue = value;
-				}
-			}
-			break;
-		case mCORE_MEMORY_SEARCH_STRING:
-		case mCORE_MEMORY_SEARCH_GUESS:
-			// TOOD
-			break;
+		if (!_testResult(core, NULL, false, res, params, guesses)) {
+			*res = *mCoreMemorySearchResultsGetPointer(inout, mCoreMemorySearchResultsSize(inout) - 1);
+			mCoreMemorySearchResultsResize(inout, -1);
+			--i;
+		}
+	}
+}
+
+void mCoreMemorySearchRepeatDirty(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* inout) {
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
+	struct mCoreMemorySearchView* views = calloc(nBlocks + 1, sizeof(*views));
+	size_t nViews = _searchViews(core, views);
+	size_t hint = 0;
+
+	int64_t guesses[2];
+	_parseGuesses(params, guesses);
+	size_t size = mCoreMemorySearchResultsSize(inout);
+	size_t kept = 0;
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsGetPointer(inout, i);
+		const struct mCoreMemorySearchView* view = _findView(views, nViews, res, &hint);
+		bool clean = _isClean(view, res);
+		if (!_testResult(core, view, clean, res, params, guesses)) {
+			continue;
+		}
+		if (view && !clean && res->type == mCORE_MEMORY_SEARCH_INT) {
+			res->lastValue = _readValue(core, view, res, res->width);
+		}
+		if (kept != i) {
+			*mCoreMemorySearchResultsGetPointer(inout, kept) = *res;
+		}
+		++kept;
+	}
+	mCoreMemorySearchResultsResize(inout, (ssize_t) kept - (ssize_t) size);
+
+	// Every remaining result now holds the value its page had as of this clear
+	for (i = 0; i < nViews; ++i) {
+		if (views[i].dirty) {
+			core->clearMemoryBlockDirty(core, views[i].block->id);
 		}
 	}
+	free(views);
 }
@@ -0,0 +1,216 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/metrics.h>
+
+#include <mgba/feature/video-logger.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+const uint32_t mCoreMetricsFrameBuckets[mCORE_METRICS_FRAME_BUCKETS] = {
+	// 16743 is one frame at the native GBA and GB refresh rate
+	1000, 2000, 4000, 8000, 12000, 16743, 20000, 33486, 50000, 100000
+};
+
+static const char* const _phaseNames[mCORE_METRICS_PHASE_MAX] = {
+	[mCORE_METRICS_EMULATION] = "emulation",
+	[mCORE_METRICS_VIDEO_SYNC] = "video_sync",
+	[mCORE_METRICS_AUDIO_SYNC] = "audio_sync",
+	[mCORE_METRICS_RENDER] = "render",
+	[mCORE_METRICS_REWIND] = "rewind",
+};
+
+uint64_t mCoreMetricsTime(void) {
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER count;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&count);
+	return (count.QuadPart / frequency.QuadPart) * 1000000ULL + (count.QuadPart % frequency.QuadPart) * 1000000ULL / frequency.QuadPart;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return 1000000ULL * tv.tv_sec + tv.tv_usec;
+#endif
+}
+
+void mCoreMetricsReset(struct mCoreMetrics* metrics) {
+	memset(metrics, 0, sizeof(*metrics));
+}
+
+void mCoreMetricsAddFrame(struct mCoreMetrics* metrics, uint64_t frameTime) {
+	size_t bucket;
+	for (bucket = 0; bucket < mCORE_METRICS_FRAME_BUCKETS; ++bucket) {
+		if (frameTime <= mCoreMetricsFrameBuckets[bucket]) {
+			break;
+		}
+	}
+	++metrics->frameTimeBuckets[bucket];
+	++metrics->frames;
+	metrics->frameTimeTotal += frameTime;
+	if (frameTime > metrics->frameTimeMax) {
+		metrics->frameTimeMax = frameTime;
+	}
+}
+
+void mCoreMetricsMerge(struct mCoreMetrics* metrics, const struct mCoreMetrics* other) {
+	size_t i;
+	metrics->frames += other->frames;
+	for (i = 0; i <= mCORE_METRICS_FRAME_BUCKETS; ++i) {
+		metrics->frameTimeBuckets[i] += other->frameTimeBuckets[i];
+	}
+	metrics->frameTimeTotal += other->frameTimeTotal;
+	if (other->frameTimeMax > metrics->frameTimeMax) {
+		metrics->frameTimeMax = other->frameTimeMax;
+	}
+	for (i = 0; i < mCORE_METRICS_PHASE_MAX; ++i) {
+		metrics->phaseTime[i] += other->phaseTime[i];
+	}
+	metrics->audioUnderruns += other->audioUnderruns;
+	metrics->audioOverruns += other->audioOverruns;
+	metrics->audioUnderrunEvents += other->audioUnderrunEvents;
+	metrics->audioTarget += other->audioTarget;
+	if (other->audioJitterMax > metrics->audioJitterMax) {
+		metrics->audioJitterMax = other->audioJitterMax;
+	}
+	metrics->videoQueueDepth += other->videoQueueDepth;
+	if (other->videoQueueMaxDepth > metrics->videoQueueMaxDepth) {
+		metrics->videoQueueMaxDepth = other->videoQueueMaxDepth;
+	}
+}
+
+void mCoreMetricsRecorderInit(struct mCoreMetricsRecorder* recorder) {
+	memset(recorder, 0, sizeof(*recorder));
+}
+
+void mCoreMetricsRecorderFrame(struct mCoreMetricsRecorder* recorder, const uint64_t waits[mCORE_METRICS_PHASE_MAX]) {
+	uint64_t now = mCoreMetricsTime();
+	size_t i;
+	if (recorder->lastFrame) {
+		uint64_t frameTime = now - recorder->lastFrame;
+		uint64_t waited = 0;
+		for (i = mCORE_METRICS_EMULATION + 1; i < mCORE_METRICS_PHASE_MAX; ++i) {
+			uint64_t phase = waits[i] - recorder->lastWaits[i];
+			recorder->metrics.phaseTime[i] += phase;
+			waited += phase;
+		}
+		// Waits that started before a skip can finish inside this frame and add up to more than it
+		if (waited < frameTime) {
+			recorder->metrics.phaseTime[mCORE_METRICS_EMULATION] += frameTime - waited;
+		}
+		mCoreMetricsAddFrame(&recorder->metrics, frameTime);
+	}
+	memcpy(recorder->lastWaits, waits, sizeof(recorder->lastWaits));
+	recorder->lastFrame = now;
+}
+
+void mCoreMetricsRecorderSkip(struct mCoreMetricsRecorder* recorder) {
+	recorder->lastFrame = 0;
+}
+
+void mCoreMetricsSampleVideoLogger(struct mCoreMetrics* metrics, struct mVideoLogger* logger) {
+	if (!logger || !logger->queueDepth) {
+		metrics->videoQueueDepth = 0;
+		return;
+	}
+	metrics->videoQueueDepth = logger->queueDepth(logger);
+	if (metrics->videoQueueDepth > metrics->videoQueueMaxDepth) {
+		metrics->videoQueueMaxDepth = metrics->videoQueueDepth;
+	}
+}
+
+struct mCoreMetricsFormatter {
+	char* buffer;
+	size_t size;
+	size_t length;
+	const char* labels;
+};
+
+static void _format(struct mCoreMetricsFormatter* formatter, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	// Keep counting once the buffer is full, so the caller learns how much it needs
+	char* out = NULL;
+	size_t left = 0;
+	if (formatter->length < formatter->size) {
+		out = &formatter->buffer[formatter->length];
+		left = formatter->size - formatter->length;
+	}
+	int written = vsnprintf(out, left, format, args);
+	va_end(args);
+	if (written > 0) {
+		formatter->length += written;
+	}
+}
+
+static void _family(struct mCoreMetricsFormatter* formatter, const char* name, const char* type, const char* help) {
+	_format(formatter, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void _sample(struct mCoreMetricsFormatter* formatter, const char* name, const char* extraLabel, double value) {
+	bool hasLabels = formatter->labels && formatter->labels[0];
+	_format(formatter, "%s", name);
+	if (hasLabels || extraLabel) {
+		_format(formatter, "{%s%s%s}", hasLabels ? formatter->labels : "", hasLabels && extraLabel ? "," : "", extraLabel ? extraLabel : "");
+	}
+	_format(formatter, " %.15g\n", value);
+}
+
+size_t mCoreMetricsFormatPrometheus(const struct mCoreMetrics* metrics, const char* labels, char* buffer, size_t size) {
+	struct mCoreMetricsFormatter formatter = {
+		.buffer = buffer,
+		.size = size,
+		.labels = labels
+	};
+	if (size) {
+		buffer[0] = '\0';
+	}
+	char label[64];
+	size_t i;
+
+	_family(&formatter, "mgba_frames_total", "counter", "Frames emulated");
+	_sample(&formatter, "mgba_frames_total", NULL, metrics->frames);
+
+	_family(&formatter, "mgba_frame_time_seconds", "histogram", "Wall-clock time between the ends of consecutive frames");
+	uint64_t cumulative = 0;
+	for (i = 0; i < mCORE_METRICS_FRAME_BUCKETS; ++i) {
+		cumulative += metrics->frameTimeBuckets[i];
+		snprintf(label, sizeof(label), "le=\"%g\"", mCoreMetricsFrameBuckets[i] / 1000000.);
+		_sample(&formatter, "mgba_frame_time_seconds_bucket", label, cumulative);
+	}
+	cumulative += metrics->frameTimeBuckets[mCORE_METRICS_FRAME_BUCKETS];
+	_sample(&formatter, "mgba_frame_time_seconds_bucket", "le=\"+Inf\"", cumulative);
+	_sample(&formatter, "mgba_frame_time_seconds_sum", NULL, metrics->frameTimeTotal / 1000000.);
+	_sample(&formatter, "mgba_frame_time_seconds_count", NULL, metrics->frames);
+
+	_family(&formatter, "mgba_frame_time_max_seconds", "gauge", "Longest time between the ends of consecutive frames");
+	_sample(&formatter, "mgba_frame_time_max_seconds", NULL, metrics->frameTimeMax / 1000000.);
+
+	_family(&formatter, "mgba_thread_seconds_total", "counter", "Emulation thread time by what it was doing");
+	for (i = 0; i < mCORE_METRICS_PHASE_MAX; ++i) {
+		snprintf(label, sizeof(label), "phase=\"%s\"", _phaseNames[i]);
+		_sample(&formatter, "mgba_thread_seconds_total", label, metrics->phaseTime[i] / 1000000.);
+	}
+
+	_family(&formatter, "mgba_audio_underruns_total", "counter", "Audio frames padded with silence because none were ready");
+	_sample(&formatter, "mgba_audio_underruns_total", NULL, metrics->audioUnderruns);
+	_family(&formatter, "mgba_audio_overruns_total", "counter", "Audio frames dropped because the audio buffer was full");
+	_sample(&formatter, "mgba_audio_overruns_total", NULL, metrics->audioOverruns);
+	_family(&formatter, "mgba_audio_underrun_events_total", "counter", "Audio device reads that came up short");
+	_sample(&formatter, "mgba_audio_underrun_events_total", NULL, metrics->audioUnderrunEvents);
+	_family(&formatter, "mgba_audio_target_frames", "gauge", "Audio frames kept queued for a pulling audio device");
+	_sample(&formatter, "mgba_audio_target_frames", NULL, metrics->audioTarget);
+	_family(&formatter, "mgba_audio_jitter_max_seconds", "gauge", "Furthest a pulling audio device has strayed from its period");
+	_sample(&formatter, "mgba_audio_jitter_max_seconds", NULL, metrics->audioJitterMax / 1000000.);
+
+	_family(&formatter, "mgba_video_queue_bytes", "gauge", "Bytes queued for the render thread at the last frame");
+	_sample(&formatter, "mgba_video_queue_bytes", NULL, metrics->videoQueueDepth);
+	_family(&formatter, "mgba_video_queue_max_bytes", "gauge", "Most bytes queued for the render thread at the end of a frame");
+	_sample(&formatter, "mgba_video_queue_max_bytes", NULL, metrics->videoQueueMaxDepth);
+
+	return formatter.length;
+}
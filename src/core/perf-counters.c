@@ -0,0 +1,94 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/perf-counters.h>
+
+#include <mgba-util/vfs.h>
+
+void mPerfCountersReset(struct mPerfCounters* counters) {
+	memset(counters, 0, sizeof(*counters));
+}
+
+void mPerfCountersCountEvent(struct mPerfCounters* counters, const char* name) {
+	++counters->eventsFired;
+	size_t i;
+	// Names are string literals, so comparing the pointers is enough to tell them apart
+	for (i = 0; i < counters->nEvents; ++i) {
+		if (counters->events[i].name == name) {
+			++counters->events[i].fired;
+			return;
+		}
+	}
+	if (counters->nEvents < mPERF_COUNTER_MAX_EVENTS) {
+		counters->events[i].name = name;
+		counters->events[i].fired = 1;
+		++counters->nEvents;
+	}
+}
+
+static bool _dumpLine(struct VFile* vf, const char* counter, int mode, const char* index, uint64_t value) {
+	if (!value) {
+		return true;
+	}
+	char line[256];
+	int length;
+	if (mode < 0) {
+		length = snprintf(line, sizeof(line), "%s,,%s,%" PRIu64 "\n", counter, index, value);
+	} else {
+		length = snprintf(line, sizeof(line), "%s,%i,%s,%" PRIu64 "\n", counter, mode, index, value);
+	}
+	if (length < 0 || (size_t) length >= sizeof(line)) {
+		return false;
+	}
+	return vf->write(vf, line, length) == length;
+}
+
+static bool _dumpArray(struct VFile* vf, const char* counter, int mode, const uint64_t* values, size_t count) {
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		char index[16];
+		snprintf(index, sizeof(index), "0x%03X", (unsigned) i);
+		if (!_dumpLine(vf, counter, mode, index, values[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool mPerfCountersDump(const struct mPerfCounters* counters, struct VFile* vf) {
+	static const char header[] = "counter,mode,index,value\n";
+	if (vf->write(vf, header, strlen(header)) != (ssize_t) strlen(header)) {
+		return false;
+	}
+	int mode;
+	for (mode = 0; mode < mPERF_COUNTER_MODES; ++mode) {
+		if (!_dumpLine(vf, "instructions", mode, "", counters->instructions[mode])) {
+			return false;
+		}
+		if (!_dumpArray(vf, "handler", mode, counters->handlers[mode], mPERF_COUNTER_HANDLERS)) {
+			return false;
+		}
+	}
+	if (!_dumpArray(vf, "instruction_region", -1, counters->instructionRegions, mPERF_COUNTER_REGIONS)) {
+		return false;
+	}
+	if (!_dumpArray(vf, "memory_accesses", -1, counters->memoryAccesses, mPERF_COUNTER_REGIONS)) {
+		return false;
+	}
+	if (!_dumpLine(vf, "conditions_failed", -1, "", counters->conditionsFailed) ||
+	    !_dumpLine(vf, "waitstate_cycles", -1, "", counters->waitstateCycles) ||
+	    !_dumpLine(vf, "dma_cycles", -1, "", counters->dmaCycles) ||
+	    !_dumpLine(vf, "idle_loop_skips", -1, "", counters->idleLoopSkips) ||
+	    !_dumpLine(vf, "events_fired", -1, "", counters->eventsFired)) {
+		return false;
+	}
+	size_t i;
+	for (i = 0; i < counters->nEvents; ++i) {
+		if (!_dumpLine(vf, "event", -1, counters->events[i].name, counters->events[i].fired)) {
+			return false;
+		}
+	}
+	return true;
+}
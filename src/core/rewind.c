@@ -7,29 +7,203 @@
 
 #include <mgba/core/core.h>
 #include <mgba/core/serialize.h>
-#include <mgba-util/patch/fast.h>
+#include <mgba/core/trace.h>
+#include <mgba-util/memory.h>
 #include <mgba-util/vfs.h>
 
-DEFINE_VECTOR(mCoreRewindPatches, struct PatchFast);
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+// Snapshots are stored as tables of reference-counted pages. A page that is
+// identical to the same page of the previous snapshot is shared instead of
+// copied, so each interval only costs the pages that actually changed.
+// Released pages are kept on a free list and reused by later snapshots.
+//
+// When the context has a memory budget, the newest quarter of the snapshots is
+// kept at full granularity. Pages that only older snapshots still reference are
+// compressed, and when the budget is exceeded the older snapshot with the
+// closest neighbors is dropped, so spacing grows with age instead of the
+// horizon being cut off.
+struct mCoreRewindPage {
+	size_t refs;
+	struct mCoreRewindPage* next;
+	// Zero while the page is stored uncompressed
+	size_t compressedSize;
+	uint8_t* data;
+};
+
+DEFINE_VECTOR(mCoreRewindSnapshots, struct mCoreRewindSnapshot);
 
-void _rewindDiff(struct mCoreRewindContext* context);
+void _rewindDiff(struct mCoreRewindContext* context, const struct mCoreRewindArena* arena);
 
 #ifndef DISABLE_THREADING
 THREAD_ENTRY _rewindThread(void* context);
 #endif
 
+static size_t _pageBytes(const struct mCoreRewindPage* page) {
+	return sizeof(*page) + (page->compressedSize ? page->compressedSize : M_CORE_REWIND_PAGE_SIZE);
+}
+
+static struct mCoreRewindPage* _allocPage(struct mCoreRewindContext* context) {
+	struct mCoreRewindPage* page = context->freePages;
+	if (page) {
+		context->freePages = page->next;
+		return page;
+	}
+	page = malloc(sizeof(*page));
+	page->compressedSize = 0;
+	page->data = malloc(M_CORE_REWIND_PAGE_SIZE);
+	context->bytes += _pageBytes(page);
+	return page;
+}
+
+static void _freePage(struct mCoreRewindContext* context, struct mCoreRewindPage* page) {
+	context->bytes -= _pageBytes(page);
+	free(page->data);
+	free(page);
+}
+
+static void _releaseSnapshot(struct mCoreRewindContext* context, struct mCoreRewindSnapshot* snapshot) {
+	if (!snapshot->size) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < snapshot->nPages; ++i) {
+		struct mCoreRewindPage* page = snapshot->pages[i];
+		--page->refs;
+		if (page->refs) {
+			continue;
+		}
+		if (page->compressedSize) {
+			// Compressed buffers are the wrong size for reuse
+			_freePage(context, page);
+		} else {
+			page->next = context->freePages;
+			context->freePages = page;
+		}
+	}
+	snapshot->size = 0;
+}
+
+// Age 0 is the newest snapshot
+static struct mCoreRewindSnapshot* _snapshotAt(struct mCoreRewindContext* context, size_t age) {
+	size_t capacity = mCoreRewindSnapshotsSize(&context->snapshots);
+	return mCoreRewindSnapshotsGetPointer(&context->snapshots, (context->current + capacity - age) % capacity);
+}
+
+static size_t _recentSnapshots(const struct mCoreRewindContext* context) {
+	size_t recent = context->size / 4;
+	return recent ? recent : 1;
+}
+
+static void _dropSnapshot(struct mCoreRewindContext* context, size_t age) {
+	struct mCoreRewindSnapshot dropped = *_snapshotAt(context, age);
+	_releaseSnapshot(context, &dropped);
+	for (; age + 1 < context->size; ++age) {
+		*_snapshotAt(context, age) = *_snapshotAt(context, age + 1);
+	}
+	*_snapshotAt(context, age) = dropped;
+	--context->size;
+}
+
+static size_t _thinCandidate(struct mCoreRewindContext* context) {
+	// Falls back to the oldest snapshot when there is nothing older than the recent ones to thin
+	size_t candidate = context->size - 1;
+	uint32_t closest = UINT32_MAX;
+	size_t age;
+	for (age = _recentSnapshots(context); age + 1 < context->size; ++age) {
+		uint32_t gap = _snapshotAt(context, age - 1)->sequence - _snapshotAt(context, age + 1)->sequence;
+		if (gap < closest) {
+			closest = gap;
+			candidate = age;
+		}
+	}
+	return candidate;
+}
+
+#ifdef USE_ZLIB
+static void _compressSnapshot(struct mCoreRewindContext* context, struct mCoreRewindSnapshot* snapshot, const struct mCoreRewindSnapshot* newer) {
+	uint8_t buffer[M_CORE_REWIND_PAGE_SIZE];
+	z_stream* zstream = context->compressor;
+	if (!zstream) {
+		// Pages are small, so a small window compresses them just as well at a fraction of the setup cost
+		zstream = calloc(1, sizeof(*zstream));
+		if (deflateInit2(zstream, Z_BEST_SPEED, Z_DEFLATED, 12, 5, Z_DEFAULT_STRATEGY) != Z_OK) {
+			free(zstream);
+			return;
+		}
+		context->compressor = zstream;
+	}
+	snapshot->compressed = true;
+	size_t i;
+	for (i = 0; i < snapshot->nPages; ++i) {
+		struct mCoreRewindPage* page = snapshot->pages[i];
+		if (page->compressedSize) {
+			continue;
+		}
+		if (i < newer->nPages && newer->pages[i] == page) {
+			// Still shared with a recent snapshot, which may be diffed against
+			continue;
+		}
+		deflateReset(zstream);
+		zstream->next_in = page->data;
+		zstream->avail_in = M_CORE_REWIND_PAGE_SIZE;
+		zstream->next_out = buffer;
+		zstream->avail_out = sizeof(buffer);
+		if (deflate(zstream, Z_FINISH) != Z_STREAM_END) {
+			// Didn't get any smaller
+			continue;
+		}
+		size_t compressedSize = sizeof(buffer) - zstream->avail_out;
+		context->bytes -= _pageBytes(page);
+		page->data = realloc(page->data, compressedSize);
+		memcpy(page->data, buffer, compressedSize);
+		page->compressedSize = compressedSize;
+		context->bytes += _pageBytes(page);
+	}
+}
+#endif
+
+static void _enforceBudget(struct mCoreRewindContext* context) {
+	while (context->bytes > context->budget) {
+		struct mCoreRewindPage* page = context->freePages;
+		if (page) {
+			context->freePages = page->next;
+			_freePage(context, page);
+			continue;
+		}
+		if (context->size <= 1) {
+			break;
+		}
+		_dropSnapshot(context, _thinCandidate(context));
+	}
+}
+
 void mCoreRewindContextInit(struct mCoreRewindContext* context, size_t entries, bool onThread) {
 	if (context->currentState) {
 		return;
 	}
-	mCoreRewindPatchesInit(&context->patchMemory, entries);
+	// One extra snapshot is kept so that there are always `entries` states to rewind to
+	mCoreRewindSnapshotsInit(&context->snapshots, entries + 1);
 	size_t e;
-	for (e = 0; e < entries; ++e) {
-		initPatchFast(mCoreRewindPatchesAppend(&context->patchMemory));
+	for (e = 0; e <= entries; ++e) {
+		struct mCoreRewindSnapshot* snapshot = mCoreRewindSnapshotsAppend(&context->snapshots);
+		snapshot->size = 0;
+		snapshot->nPages = 0;
+		snapshot->pages = NULL;
+		snapshot->sequence = 0;
+		snapshot->compressed = false;
 	}
-	context->previousState = VFileMemChunk(0, 0);
 	context->currentState = VFileMemChunk(0, 0);
+	context->freePages = NULL;
+	context->current = 0;
 	context->size = 0;
+	context->bytes = 0;
+	context->sequence = 0;
+	context->compressor = NULL;
+	memset(context->arenas, 0, sizeof(context->arenas));
+	context->pending = 0;
 #ifndef DISABLE_THREADING
 	context->onThread = onThread;
 	context->ready = false;
@@ -58,117 +232,228 @@ void mCoreRewindContextDeinit(struct mCoreRewindContext* context) {
 		ConditionDeinit(&context->cond);
 	}
 #endif
-	context->previousState->close(context->previousState);
 	context->currentState->close(context->currentState);
-	context->previousState = NULL;
 	context->currentState = NULL;
+	size_t a;
+	for (a = 0; a < sizeof(context->arenas) / sizeof(*context->arenas); ++a) {
+		if (context->arenas[a].data) {
+			mappedMemoryFree(context->arenas[a].data, context->arenas[a].capacity);
+		}
+	}
+	memset(context->arenas, 0, sizeof(context->arenas));
+#ifdef USE_ZLIB
+	if (context->compressor) {
+		deflateEnd(context->compressor);
+		free(context->compressor);
+		context->compressor = NULL;
+	}
+#endif
 	size_t s;
-	for (s = 0; s < mCoreRewindPatchesSize(&context->patchMemory); ++s) {
-		deinitPatchFast(mCoreRewindPatchesGetPointer(&context->patchMemory, s));
+	for (s = 0; s < mCoreRewindSnapshotsSize(&context->snapshots); ++s) {
+		struct mCoreRewindSnapshot* snapshot = mCoreRewindSnapshotsGetPointer(&context->snapshots, s);
+		_releaseSnapshot(context, snapshot);
+		free(snapshot->pages);
+	}
+	mCoreRewindSnapshotsDeinit(&context->snapshots);
+	while (context->freePages) {
+		struct mCoreRewindPage* page = context->freePages;
+		context->freePages = page->next;
+		_freePage(context, page);
+	}
+}
+
+static void _captureState(struct mCoreRewindArena* arena, struct mCore* core) {
+	int flags = SAVESTATE_SAVEDATA | SAVESTATE_RTC;
+	arena->size = mCoreSaveStateBuffer(core, arena->data, arena->capacity, flags);
+	if (arena->size <= arena->capacity) {
+		return;
+	}
+	// Only happens for the first snapshots, or if the save data grows
+	if (arena->data) {
+		mappedMemoryFree(arena->data, arena->capacity);
 	}
-	mCoreRewindPatchesDeinit(&context->patchMemory);
+	arena->capacity = arena->size;
+	arena->data = anonymousMemoryMap(arena->capacity);
+	mCoreSaveStateBuffer(core, arena->data, arena->capacity, flags);
 }
 
 void mCoreRewindAppend(struct mCoreRewindContext* context, struct mCore* core) {
 #ifndef DISABLE_THREADING
 	if (context->onThread) {
+		// The diff thread only reads the pending arena, and only while holding the mutex
+		unsigned next = context->pending ^ 1;
+		_captureState(&context->arenas[next], core);
 		MutexLock(&context->mutex);
-	}
-#endif
-	struct VFile* nextState = context->previousState;
-	mCoreSaveStateNamed(core, nextState, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
-	context->previousState = context->currentState;
-	context->currentState = nextState;
-#ifndef DISABLE_THREADING
-	if (context->onThread) {
+		// A pending state the diff thread never got to is dropped in favor of this one
+		context->pending = next;
 		context->ready = true;
 		ConditionWake(&context->cond);
 		MutexUnlock(&context->mutex);
 		return;
 	}
 #endif
-	_rewindDiff(context);
+	_captureState(&context->arenas[context->pending], core);
+	_rewindDiff(context, &context->arenas[context->pending]);
 }
 
-void _rewindDiff(struct mCoreRewindContext* context) {
-	++context->current;
-	if (context->size < mCoreRewindPatchesSize(&context->patchMemory)) {
+void _rewindDiff(struct mCoreRewindContext* context, const struct mCoreRewindArena* arena) {
+	size_t capacity = mCoreRewindSnapshotsSize(&context->snapshots);
+	if (context->budget && context->size == capacity) {
+		// Make room by thinning out old snapshots rather than overwriting the oldest
+		_dropSnapshot(context, _thinCandidate(context));
+	}
+	struct mCoreRewindSnapshot* previous = NULL;
+	if (context->size) {
+		previous = mCoreRewindSnapshotsGetPointer(&context->snapshots, context->current);
+		++context->current;
+		if (context->current >= capacity) {
+			context->current = 0;
+		}
+	}
+	if (context->size < capacity) {
 		++context->size;
 	}
-	if (context->current >= mCoreRewindPatchesSize(&context->patchMemory)) {
-		context->current = 0;
+	struct mCoreRewindSnapshot* snapshot = mCoreRewindSnapshotsGetPointer(&context->snapshots, context->current);
+	_releaseSnapshot(context, snapshot);
+
+	size_t size = arena->size;
+	size_t nPages = (size + M_CORE_REWIND_PAGE_SIZE - 1) / M_CORE_REWIND_PAGE_SIZE;
+	if (nPages != snapshot->nPages) {
+		snapshot->pages = realloc(snapshot->pages, nPages * sizeof(*snapshot->pages));
+		snapshot->nPages = nPages;
+	}
+	snapshot->size = size;
+	snapshot->compressed = false;
+	snapshot->sequence = context->sequence;
+	++context->sequence;
+
+	const uint8_t* state = arena->data;
+	size_t i;
+	for (i = 0; i < nPages; ++i) {
+		size_t offset = i * M_CORE_REWIND_PAGE_SIZE;
+		size_t length = size - offset;
+		if (length > M_CORE_REWIND_PAGE_SIZE) {
+			length = M_CORE_REWIND_PAGE_SIZE;
+		}
+		struct mCoreRewindPage* page = NULL;
+		if (previous && i < previous->nPages && offset + length <= previous->size) {
+			page = previous->pages[i];
+			if (page->compressedSize || memcmp(page->data, &state[offset], length) != 0) {
+				page = NULL;
+			}
+		}
+		if (page) {
+			++page->refs;
+		} else {
+			page = _allocPage(context);
+			page->refs = 1;
+			memcpy(page->data, &state[offset], length);
+		}
+		snapshot->pages[i] = page;
 	}
-	struct PatchFast* patch = mCoreRewindPatchesGetPointer(&context->patchMemory, context->current);
-	size_t size2 = context->currentState->size(context->currentState);
-	size_t size = context->previousState->size(context->previousState);
-	if (size2 > size) {
-		context->previousState->truncate(context->previousState, size2);
-		size = size2;
-	} else if (size > size2) {
-		context->currentState->truncate(context->currentState, size);
+
+	if (context->budget) {
+#ifdef USE_ZLIB
+		// Older snapshots are compressed from oldest to newest, so this stops at the last one done
+		size_t age;
+		for (age = _recentSnapshots(context); age < context->size; ++age) {
+			struct mCoreRewindSnapshot* old = _snapshotAt(context, age);
+			if (old->compressed) {
+				break;
+			}
+			_compressSnapshot(context, old, _snapshotAt(context, age - 1));
+		}
+#endif
+		_enforceBudget(context);
 	}
-	void* current = context->previousState->map(context->previousState, size, MAP_READ);
-	void* next = context->currentState->map(context->currentState, size, MAP_READ);
-	diffPatchFast(patch, current, next, size);
-	context->previousState->unmap(context->previousState, current, size);
-	context->currentState->unmap(context->currentState, next, size);
 }
 
 bool mCoreRewindRestore(struct mCoreRewindContext* context, struct mCore* core) {
+	return mCoreRewindRestoreSteps(context, core, 1) == 1;
+}
+
+size_t mCoreRewindRestoreSteps(struct mCoreRewindContext* context, struct mCore* core, size_t steps) {
 #ifndef DISABLE_THREADING
 	if (context->onThread) {
 		MutexLock(&context->mutex);
+		if (context->ready) {
+			_rewindDiff(context, &context->arenas[context->pending]);
+			context->ready = false;
+		}
 	}
 #endif
-	if (!context->size) {
+	// Every snapshot holds a whole state, so the ones skipped over are only released, never loaded
+	size_t rewound = 0;
+	while (rewound < steps && context->size >= 2) {
+		--context->size;
+		_releaseSnapshot(context, mCoreRewindSnapshotsGetPointer(&context->snapshots, context->current));
+		if (context->current == 0) {
+			context->current = mCoreRewindSnapshotsSize(&context->snapshots);
+		}
+		--context->current;
+		++rewound;
+	}
+	if (!rewound) {
 #ifndef DISABLE_THREADING
 		if (context->onThread) {
 			MutexUnlock(&context->mutex);
 		}
 #endif
-		return false;
+		return 0;
 	}
-	--context->size;
 
-	mCoreLoadStateNamed(core, context->previousState, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
-	if (context->current == 0) {
-		context->current = mCoreRewindPatchesSize(&context->patchMemory);
-	}
-	--context->current;
-
-	struct PatchFast* patch = mCoreRewindPatchesGetPointer(&context->patchMemory, context->current);
-	size_t size2 = context->previousState->size(context->previousState);
-	size_t size = context->currentState->size(context->currentState);
-	if (size2 < size) {
-		size = size2;
-	}
-	void* current = context->currentState->map(context->currentState, size, MAP_READ);
-	void* previous = context->previousState->map(context->previousState, size, MAP_WRITE);
-	patch->d.applyPatch(&patch->d, previous, size, current, size);
-	context->currentState->unmap(context->currentState, current, size);
-	context->previousState->unmap(context->previousState, previous, size);
-	struct VFile* nextState = context->previousState;
-	context->previousState = context->currentState;
-	context->currentState = nextState;
+	struct mCoreRewindSnapshot* snapshot = mCoreRewindSnapshotsGetPointer(&context->snapshots, context->current);
+	context->currentState->truncate(context->currentState, snapshot->size);
+	uint8_t* state = context->currentState->map(context->currentState, snapshot->size, MAP_WRITE);
+	size_t i;
+	for (i = 0; i < snapshot->nPages; ++i) {
+		size_t offset = i * M_CORE_REWIND_PAGE_SIZE;
+		size_t length = snapshot->size - offset;
+		if (length > M_CORE_REWIND_PAGE_SIZE) {
+			length = M_CORE_REWIND_PAGE_SIZE;
+		}
+		const struct mCoreRewindPage* page = snapshot->pages[i];
+#ifdef USE_ZLIB
+		if (page->compressedSize) {
+			uint8_t buffer[M_CORE_REWIND_PAGE_SIZE];
+			uLongf bufferSize = sizeof(buffer);
+			uncompress(buffer, &bufferSize, page->data, page->compressedSize);
+			memcpy(&state[offset], buffer, length);
+			continue;
+		}
+#endif
+		memcpy(&state[offset], page->data, length);
+	}
+	context->currentState->unmap(context->currentState, state, snapshot->size);
+	mCoreLoadStateNamed(core, context->currentState, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
 #ifndef DISABLE_THREADING
 	if (context->onThread) {
 		MutexUnlock(&context->mutex);
 	}
 #endif
-	return true;
+	return rewound;
 }
 
 #ifndef DISABLE_THREADING
 THREAD_ENTRY _rewindThread(void* context) {
 	struct mCoreRewindContext* rewindContext = context;
 	ThreadSetName("Rewind Diff Thread");
+	mTRACE_THREAD("Rewind Diff Thread");
+	if (rewindContext->affinity) {
+		ThreadSetAffinity(rewindContext->affinity);
+	}
+	if (rewindContext->highPriority) {
+		ThreadSetHighPriority();
+	}
 	MutexLock(&rewindContext->mutex);
 	while (rewindContext->onThread) {
 		while (!rewindContext->ready && rewindContext->onThread) {
 			ConditionWait(&rewindContext->cond, &rewindContext->mutex);
 		}
 		if (rewindContext->ready) {
-			_rewindDiff(rewindContext);
+			mTRACE_BEGIN(trace);
+			_rewindDiff(rewindContext, &rewindContext->arenas[rewindContext->pending]);
+			mTRACE_END(trace, "rewindDiff");
 		}
 		rewindContext->ready = false;
 	}
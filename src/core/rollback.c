@@ -0,0 +1,158 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/rollback.h>
+
+#include <mgba/core/core.h>
+#include <mgba-util/memory.h>
+
+static struct mRollbackInput* _input(struct mRollback* rollback, int32_t frame) {
+	return &rollback->inputs[frame % (rollback->window * 2)];
+}
+
+static void _predict(struct mRollback* rollback, int32_t frame) {
+	struct mRollbackInput* input = _input(rollback, frame);
+	input->predicted = 0;
+	int i;
+	for (i = 0; i < rollback->nPlayers; ++i) {
+		if (i == rollback->localPlayer || rollback->confirmed[i] >= frame) {
+			continue;
+		}
+		// Buttons tend to be held for many frames, so the last known keys are the best guess
+		input->keys[i] = rollback->confirmedKeys[i];
+		input->predicted |= 1 << i;
+	}
+}
+
+static void _step(struct mRollback* rollback, int32_t frame, bool save) {
+	struct mCore* core = rollback->core;
+	const struct mRollbackInput* input = _input(rollback, frame);
+	if (save) {
+		core->saveState(core, rollback->states[frame % rollback->window]);
+	}
+	if (rollback->applyInputs) {
+		rollback->applyInputs(rollback, input->keys);
+	} else {
+		uint32_t keys = 0;
+		int i;
+		for (i = 0; i < rollback->nPlayers; ++i) {
+			keys |= input->keys[i];
+		}
+		core->setKeys(core, keys);
+	}
+	core->runFrame(core);
+}
+
+static void _resimulate(struct mRollback* rollback) {
+	struct mCore* core = rollback->core;
+	int32_t frame = rollback->rollbackFrame;
+	int32_t depth = rollback->frame - frame;
+	core->loadState(core, rollback->states[frame % rollback->window]);
+	core->setOutputSuppressed(core, true, true);
+	for (; frame < rollback->frame; ++frame) {
+		_predict(rollback, frame);
+		// The state at the start of the first replayed frame is the one just loaded
+		_step(rollback, frame, frame != rollback->rollbackFrame);
+	}
+	core->setOutputSuppressed(core, false, false);
+
+	++rollback->stats.rollbacks;
+	rollback->stats.framesResimulated += depth;
+	if (depth > rollback->stats.maxRollback) {
+		rollback->stats.maxRollback = depth;
+	}
+	rollback->rollbackFrame = -1;
+}
+
+bool mRollbackInit(struct mRollback* rollback, struct mCore* core, int nPlayers, int localPlayer, size_t window) {
+	memset(rollback, 0, sizeof(*rollback));
+	if (nPlayers < 1 || nPlayers > mROLLBACK_MAX_PLAYERS || localPlayer < 0 || localPlayer >= nPlayers) {
+		return false;
+	}
+	if (!window) {
+		window = mROLLBACK_DEFAULT_WINDOW;
+	}
+	rollback->core = core;
+	rollback->nPlayers = nPlayers;
+	rollback->localPlayer = localPlayer;
+	rollback->window = window;
+	rollback->stateSize = core->stateSize(core);
+	rollback->states = calloc(window, sizeof(*rollback->states));
+	rollback->inputs = calloc(window * 2, sizeof(*rollback->inputs));
+	size_t i;
+	for (i = 0; i < window; ++i) {
+		rollback->states[i] = anonymousMemoryMap(rollback->stateSize);
+	}
+	for (i = 0; i < mROLLBACK_MAX_PLAYERS; ++i) {
+		rollback->confirmed[i] = -1;
+	}
+	rollback->rollbackFrame = -1;
+	return true;
+}
+
+void mRollbackDeinit(struct mRollback* rollback) {
+	size_t i;
+	if (rollback->states) {
+		for (i = 0; i < rollback->window; ++i) {
+			mappedMemoryFree(rollback->states[i], rollback->stateSize);
+		}
+	}
+	free(rollback->states);
+	free(rollback->inputs);
+	rollback->states = NULL;
+	rollback->inputs = NULL;
+}
+
+bool mRollbackAddInput(struct mRollback* rollback, int player, int32_t frame, uint32_t keys) {
+	if (player < 0 || player >= rollback->nPlayers || player == rollback->localPlayer) {
+		return false;
+	}
+	// Input has to arrive in order, and no further ahead than the input ring reaches
+	if (frame != rollback->confirmed[player] + 1 || frame >= rollback->frame + (int32_t) rollback->window) {
+		return false;
+	}
+	struct mRollbackInput* input = _input(rollback, frame);
+	if (frame < rollback->frame) {
+		if (input->keys[player] != keys && (rollback->rollbackFrame < 0 || frame < rollback->rollbackFrame)) {
+			rollback->rollbackFrame = frame;
+		}
+		input->predicted &= ~(1 << player);
+	}
+	input->keys[player] = keys;
+	rollback->confirmed[player] = frame;
+	rollback->confirmedKeys[player] = keys;
+	return true;
+}
+
+bool mRollbackRunFrame(struct mRollback* rollback, uint32_t localKeys) {
+	// Anything older than the window can't be replayed, so wait for the other players instead
+	if (rollback->frame - mRollbackConfirmedFrame(rollback) > (int32_t) rollback->window) {
+		++rollback->stats.stalls;
+		return false;
+	}
+	if (rollback->rollbackFrame >= 0) {
+		_resimulate(rollback);
+	}
+
+	struct mRollbackInput* input = _input(rollback, rollback->frame);
+	input->keys[rollback->localPlayer] = localKeys;
+	_predict(rollback, rollback->frame);
+	_step(rollback, rollback->frame, true);
+	rollback->confirmed[rollback->localPlayer] = rollback->frame;
+	++rollback->frame;
+	++rollback->stats.framesRun;
+	return true;
+}
+
+int32_t mRollbackConfirmedFrame(const struct mRollback* rollback) {
+	int32_t confirmed = rollback->frame - 1;
+	int i;
+	for (i = 0; i < rollback->nPlayers; ++i) {
+		if (i != rollback->localPlayer && rollback->confirmed[i] < confirmed) {
+			confirmed = rollback->confirmed[i];
+		}
+	}
+	return confirmed;
+}
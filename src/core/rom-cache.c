@@ -0,0 +1,275 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/rom-cache.h>
+
+#include <mgba-util/crc32.h>
+#include <mgba-util/vfs.h>
+
+struct mROMCacheEntry {
+	struct mROMCache* cache;
+	struct VFile* backing;
+	void* data;
+	size_t size;
+	uint32_t crc32;
+	size_t refs;
+};
+
+struct VFileROMCache {
+	struct VFile d;
+	struct mROMCacheEntry* entry;
+	size_t offset;
+};
+
+static bool _vfrcClose(struct VFile* vf);
+static off_t _vfrcSeek(struct VFile* vf, off_t offset, int whence);
+static ssize_t _vfrcRead(struct VFile* vf, void* buffer, size_t size);
+static ssize_t _vfrcWrite(struct VFile* vf, const void* buffer, size_t size);
+static void* _vfrcMap(struct VFile* vf, size_t size, int flags);
+static void _vfrcUnmap(struct VFile* vf, void* memory, size_t size);
+static void _vfrcTruncate(struct VFile* vf, size_t size);
+static ssize_t _vfrcSize(struct VFile* vf);
+static bool _vfrcSync(struct VFile* vf, const void* buffer, size_t size);
+
+static inline void _lock(struct mROMCache* cache) {
+#ifndef DISABLE_THREADING
+	MutexLock(&cache->mutex);
+#else
+	UNUSED(cache);
+#endif
+}
+
+static inline void _unlock(struct mROMCache* cache) {
+#ifndef DISABLE_THREADING
+	MutexUnlock(&cache->mutex);
+#else
+	UNUSED(cache);
+#endif
+}
+
+void mROMCacheInit(struct mROMCache* cache) {
+	TableInit(&cache->entries, 0, NULL);
+#ifndef DISABLE_THREADING
+	MutexInit(&cache->mutex);
+#endif
+}
+
+void mROMCacheDeinit(struct mROMCache* cache) {
+	TableDeinit(&cache->entries);
+#ifndef DISABLE_THREADING
+	MutexDeinit(&cache->mutex);
+#endif
+}
+
+static struct VFile* _openEntry(struct mROMCacheEntry* entry) {
+	struct VFileROMCache* vfrc = malloc(sizeof(*vfrc));
+	if (!vfrc) {
+		return NULL;
+	}
+	++entry->refs;
+	vfrc->entry = entry;
+	vfrc->offset = 0;
+	vfrc->d.close = _vfrcClose;
+	vfrc->d.seek = _vfrcSeek;
+	vfrc->d.read = _vfrcRead;
+	vfrc->d.readline = VFileReadline;
+	vfrc->d.write = _vfrcWrite;
+	vfrc->d.map = _vfrcMap;
+	vfrc->d.unmap = _vfrcUnmap;
+	vfrc->d.truncate = _vfrcTruncate;
+	vfrc->d.size = _vfrcSize;
+	vfrc->d.sync = _vfrcSync;
+	return &vfrc->d;
+}
+
+struct VFile* mROMCacheOpen(struct mROMCache* cache, struct VFile* vf) {
+	if (!vf) {
+		return NULL;
+	}
+	ssize_t size = vf->size(vf);
+	if (size <= 0) {
+		return vf;
+	}
+	void* data = vf->map(vf, size, MAP_READ);
+	if (!data) {
+		return vf;
+	}
+	uint32_t crc32 = doCrc32(data, size);
+
+	_lock(cache);
+	struct mROMCacheEntry* entry = TableLookup(&cache->entries, crc32);
+	if (entry) {
+		if (entry->size != (size_t) size || memcmp(entry->data, data, size) != 0) {
+			// CRC32 collision with a different ROM; leave this one unshared
+			_unlock(cache);
+			vf->unmap(vf, data, size);
+			return vf;
+		}
+		struct VFile* shared = _openEntry(entry);
+		_unlock(cache);
+		if (shared) {
+			vf->unmap(vf, data, size);
+			vf->close(vf);
+			return shared;
+		}
+		vf->unmap(vf, data, size);
+		return vf;
+	}
+
+	entry = malloc(sizeof(*entry));
+	if (!entry) {
+		_unlock(cache);
+		vf->unmap(vf, data, size);
+		return vf;
+	}
+	entry->cache = cache;
+	entry->backing = vf;
+	entry->data = data;
+	entry->size = size;
+	entry->crc32 = crc32;
+	entry->refs = 0;
+	struct VFile* shared = _openEntry(entry);
+	if (!shared) {
+		_unlock(cache);
+		free(entry);
+		vf->unmap(vf, data, size);
+		return vf;
+	}
+	TableInsert(&cache->entries, crc32, entry);
+	_unlock(cache);
+	return shared;
+}
+
+struct VFile* mROMCacheOpenCRC32(struct mROMCache* cache, uint32_t crc32) {
+	_lock(cache);
+	struct mROMCacheEntry* entry = TableLookup(&cache->entries, crc32);
+	struct VFile* vf = NULL;
+	if (entry) {
+		vf = _openEntry(entry);
+	}
+	_unlock(cache);
+	return vf;
+}
+
+bool mROMCacheIsShared(const struct VFile* vf) {
+	return vf->close == _vfrcClose;
+}
+
+bool mROMCacheGetCRC32(const struct VFile* vf, uint32_t* crc32) {
+	if (!mROMCacheIsShared(vf)) {
+		return false;
+	}
+	*crc32 = ((const struct VFileROMCache*) vf)->entry->crc32;
+	return true;
+}
+
+static bool _vfrcClose(struct VFile* vf) {
+	struct VFileROMCache* vfrc = (struct VFileROMCache*) vf;
+	struct mROMCacheEntry* entry = vfrc->entry;
+	struct mROMCache* cache = entry->cache;
+	free(vfrc);
+
+	_lock(cache);
+	--entry->refs;
+	if (entry->refs) {
+		_unlock(cache);
+		return true;
+	}
+	TableRemove(&cache->entries, entry->crc32);
+	_unlock(cache);
+
+	entry->backing->unmap(entry->backing, entry->data, entry->size);
+	entry->backing->close(entry->backing);
+	free(entry);
+	return true;
+}
+
+static off_t _vfrcSeek(struct VFile* vf, off_t offset, int whence) {
+	struct VFileROMCache* vfrc = (struct VFileROMCache*) vf;
+
+	size_t position;
+	switch (whence) {
+	case SEEK_SET:
+		if (offset < 0) {
+			return -1;
+		}
+		position = offset;
+		break;
+	case SEEK_CUR:
+		if (offset < 0 && ((vfrc->offset < (size_t) -offset) || (offset == INT_MIN))) {
+			return -1;
+		}
+		position = vfrc->offset + offset;
+		break;
+	case SEEK_END:
+		if (offset < 0 && ((vfrc->entry->size < (size_t) -offset) || (offset == INT_MIN))) {
+			return -1;
+		}
+		position = vfrc->entry->size + offset;
+		break;
+	default:
+		return -1;
+	}
+
+	if (position > vfrc->entry->size) {
+		return -1;
+	}
+
+	vfrc->offset = position;
+	return position;
+}
+
+static ssize_t _vfrcRead(struct VFile* vf, void* buffer, size_t size) {
+	struct VFileROMCache* vfrc = (struct VFileROMCache*) vf;
+
+	if (size + vfrc->offset >= vfrc->entry->size) {
+		size = vfrc->entry->size - vfrc->offset;
+	}
+
+	memcpy(buffer, (const uint8_t*) vfrc->entry->data + vfrc->offset, size);
+	vfrc->offset += size;
+	return size;
+}
+
+static ssize_t _vfrcWrite(struct VFile* vf, const void* buffer, size_t size) {
+	UNUSED(vf);
+	UNUSED(buffer);
+	UNUSED(size);
+	return -1;
+}
+
+static void* _vfrcMap(struct VFile* vf, size_t size, int flags) {
+	struct VFileROMCache* vfrc = (struct VFileROMCache*) vf;
+
+	// The mapping is shared with every other core, so it can never be written through
+	if (flags & MAP_WRITE || size > vfrc->entry->size) {
+		return NULL;
+	}
+
+	return vfrc->entry->data;
+}
+
+static void _vfrcUnmap(struct VFile* vf, void* memory, size_t size) {
+	UNUSED(vf);
+	UNUSED(memory);
+	UNUSED(size);
+}
+
+static void _vfrcTruncate(struct VFile* vf, size_t size) {
+	UNUSED(vf);
+	UNUSED(size);
+}
+
+static ssize_t _vfrcSize(struct VFile* vf) {
+	struct VFileROMCache* vfrc = (struct VFileROMCache*) vf;
+	return vfrc->entry->size;
+}
+
+static bool _vfrcSync(struct VFile* vf, const void* buffer, size_t size) {
+	UNUSED(vf);
+	UNUSED(buffer);
+	UNUSED(size);
+	return false;
+}
@@ -5,79 +5,115 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/core/scripting.h>
 
-#include <mgba-util/table.h>
+#include <mgba/core/core.h>
+#include <mgba/core/interface.h>
+#include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 
-struct mScriptBridge {
-	struct Table engines;
-	struct mDebugger* debugger;
+struct mScriptWatchRange {
+	uint32_t start;
+	uint32_t end;
 };
 
-struct mScriptInfo {
-	const char* name;
-	struct VFile* vf;
-	bool success;
-};
+DECLARE_VECTOR(mScriptEngineList, struct mScriptEngine*);
+DEFINE_VECTOR(mScriptEngineList, struct mScriptEngine*);
+DECLARE_VECTOR(mScriptWatchRangeList, struct mScriptWatchRange);
+DEFINE_VECTOR(mScriptWatchRangeList, struct mScriptWatchRange);
 
-struct mScriptSymbol {
-	const char* name;
-	int32_t* out;
-	bool success;
-};
+struct mScriptBridge {
+	// Engines are walked on every frame and watched write, so they're kept flat
+	struct mScriptEngineList engines;
+	struct mDebugger* debugger;
+	struct mCore* core;
+	struct mCoreCallbacks callbacks;
 
-static void _seDeinit(void* value) {
-	struct mScriptEngine* se = value;
-	se->deinit(se);
-}
+	struct mCoreMemoryHook hook;
+	uint32_t* watchedPages;
+	struct mScriptWatchRangeList watches;
+	bool hookInstalled;
+};
 
-static void _seTryLoad(const char* key, void* value, void* user) {
-	UNUSED(key);
-	struct mScriptEngine* se = value;
-	struct mScriptInfo* si = user;
-	if (!si->success && se->isScript(se, si->name, si->vf)) {
-		si->success = se->loadScript(se, si->name, si->vf);
+static void _frameStarted(void* context) {
+	struct mScriptBridge* sb = context;
+	size_t i;
+	for (i = 0; i < mScriptEngineListSize(&sb->engines); ++i) {
+		struct mScriptEngine* se = *mScriptEngineListGetPointer(&sb->engines, i);
+		if (se->frameStarted) {
+			se->frameStarted(se);
+		}
 	}
 }
 
-static void _seLookupSymbol(const char* key, void* value, void* user) {
-	UNUSED(key);
-	struct mScriptEngine* se = value;
-	struct mScriptSymbol* si = user;
-	if (!si->success) {
-		si->success = se->lookupSymbol(se, si->name, si->out);
+static void _frameEnded(void* context) {
+	struct mScriptBridge* sb = context;
+	size_t i;
+	for (i = 0; i < mScriptEngineListSize(&sb->engines); ++i) {
+		struct mScriptEngine* se = *mScriptEngineListGetPointer(&sb->engines, i);
+		if (se->frameEnded) {
+			se->frameEnded(se);
+		}
 	}
 }
 
-static void _seRun(const char* key, void* value, void* user) {
-	UNUSED(key);
-	UNUSED(user);
-	struct mScriptEngine* se = value;
-	se->run(se);
+static void _memoryWritten(void* context, uint32_t address, int width, uint32_t value) {
+	struct mScriptBridge* sb = context;
+	// The page bitmap only narrows things down, so check the ranges themselves too
+	bool watched = false;
+	size_t i;
+	for (i = 0; i < mScriptWatchRangeListSize(&sb->watches); ++i) {
+		const struct mScriptWatchRange* range = mScriptWatchRangeListGetConstPointer(&sb->watches, i);
+		if (address < range->end && address + width > range->start) {
+			watched = true;
+			break;
+		}
+	}
+	if (!watched) {
+		return;
+	}
+	for (i = 0; i < mScriptEngineListSize(&sb->engines); ++i) {
+		struct mScriptEngine* se = *mScriptEngineListGetPointer(&sb->engines, i);
+		if (se->memoryWritten) {
+			se->memoryWritten(se, address, width, value);
+		}
+	}
 }
 
-#ifdef USE_DEBUGGERS
-struct mScriptDebuggerEntry {
-	enum mDebuggerEntryReason reason;
-	struct mDebuggerEntryInfo* info;
-};
-
-static void _seDebuggerEnter(const char* key, void* value, void* user) {
-	UNUSED(key);
-	struct mScriptEngine* se = value;
-	struct mScriptDebuggerEntry* entry = user;
-	se->debuggerEntered(se, entry->reason, entry->info);
+static void _removeHook(struct mScriptBridge* sb) {
+	if (sb->hookInstalled && sb->core) {
+		sb->core->setMemoryHook(sb->core, NULL);
+	}
+	sb->hookInstalled = false;
 }
-#endif
 
 struct mScriptBridge* mScriptBridgeCreate(void) {
 	struct mScriptBridge* sb = malloc(sizeof(*sb));
-	HashTableInit(&sb->engines, 0, _seDeinit);
+	mScriptEngineListInit(&sb->engines, 0);
+	mScriptWatchRangeListInit(&sb->watches, 0);
 	sb->debugger = NULL;
+	sb->core = NULL;
+	sb->watchedPages = NULL;
+	sb->hookInstalled = false;
+	sb->hook.context = sb;
+	sb->hook.written = _memoryWritten;
+	sb->hook.pages = NULL;
+	sb->callbacks = (struct mCoreCallbacks) {
+		.context = sb,
+		.videoFrameStarted = _frameStarted,
+		.videoFrameEnded = _frameEnded,
+	};
 	return sb;
 }
 
 void mScriptBridgeDestroy(struct mScriptBridge* sb) {
-	HashTableDeinit(&sb->engines);
+	_removeHook(sb);
+	size_t i;
+	for (i = 0; i < mScriptEngineListSize(&sb->engines); ++i) {
+		struct mScriptEngine* se = *mScriptEngineListGetPointer(&sb->engines, i);
+		se->deinit(se);
+	}
+	mScriptEngineListDeinit(&sb->engines);
+	mScriptWatchRangeListDeinit(&sb->watches);
+	free(sb->watchedPages);
 	free(sb);
 }
 
@@ -86,7 +122,16 @@ void mScriptBridgeInstallEngine(struct mScriptBridge* sb, struct mScriptEngine*
 		return;
 	}
 	const char* name = se->name(se);
-	HashTableInsert(&sb->engines, name, se);
+	size_t i;
+	for (i = 0; i < mScriptEngineListSize(&sb->engines); ++i) {
+		struct mScriptEngine** old = mScriptEngineListGetPointer(&sb->engines, i);
+		if (strcmp((*old)->name(*old), name) == 0) {
+			(*old)->deinit(*old);
+			*old = se;
+			return;
+		}
+	}
+	*mScriptEngineListAppend(&sb->engines) = se;
 }
 
 #ifdef USE_DEBUGGERS
@@ -100,16 +145,20 @@ struct mDebugger* mScriptBridgeGetDebugger(struct mScriptBridge* sb) {
 }
 
 void mScriptBridgeDebuggerEntered(struct mScriptBridge* sb, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
-	struct mScriptDebuggerEntry entry = {
-		.reason = reason,
-		.info = info
-	};
-	HashTableEnumerate(&sb->engines, _seDebuggerEnter, &entry);
+	size_t i;
+	for (i = 0; i < mScriptEngineListSize(&sb->engines); ++i) {
+		struct mScriptEngine* se = *mScriptEngineListGetPointer(&sb->engines, i);
+		se->debuggerEntered(se, reason, info);
+	}
 }
 #endif
 
 void mScriptBridgeRun(struct mScriptBridge* sb) {
-	HashTableEnumerate(&sb->engines, _seRun, NULL);
+	size_t i;
+	for (i = 0; i < mScriptEngineListSize(&sb->engines); ++i) {
+		struct mScriptEngine* se = *mScriptEngineListGetPointer(&sb->engines, i);
+		se->run(se);
+	}
 }
 
 bool mScriptBridgeLoadScript(struct mScriptBridge* sb, const char* name) {
@@ -117,22 +166,117 @@ bool mScriptBridgeLoadScript(struct mScriptBridge* sb, const char* name) {
 	if (!vf) {
 		return false;
 	}
-	struct mScriptInfo info = {
-		.name = name,
-		.vf = vf,
-		.success = false
-	};
-	HashTableEnumerate(&sb->engines, _seTryLoad, &info);
+	bool success = false;
+	size_t i;
+	for (i = 0; i < mScriptEngineListSize(&sb->engines) && !success; ++i) {
+		struct mScriptEngine* se = *mScriptEngineListGetPointer(&sb->engines, i);
+		if (se->isScript(se, name, vf)) {
+			success = se->loadScript(se, name, vf);
+		}
+	}
 	vf->close(vf);
-	return info.success;
+	return success;
 }
 
 bool mScriptBridgeLookupSymbol(struct mScriptBridge* sb, const char* name, int32_t* out) {
-	struct mScriptSymbol info = {
-		.name = name,
-		.out = out,
-		.success = false
-	};
-	HashTableEnumerate(&sb->engines, _seLookupSymbol, &info);
-	return info.success;
+	size_t i;
+	for (i = 0; i < mScriptEngineListSize(&sb->engines); ++i) {
+		struct mScriptEngine* se = *mScriptEngineListGetPointer(&sb->engines, i);
+		if (se->lookupSymbol(se, name, out)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void mScriptBridgeSetCore(struct mScriptBridge* sb, struct mCore* core) {
+	if (sb->core == core) {
+		return;
+	}
+	_removeHook(sb);
+	sb->core = core;
+	if (!core) {
+		return;
+	}
+	core->addCoreCallbacks(core, &sb->callbacks);
+	if (mScriptWatchRangeListSize(&sb->watches) && core->setMemoryHook) {
+		core->setMemoryHook(core, &sb->hook);
+		sb->hookInstalled = true;
+	}
+}
+
+struct mCore* mScriptBridgeGetCore(struct mScriptBridge* sb) {
+	return sb->core;
+}
+
+void mScriptBridgeWatchWrites(struct mScriptBridge* sb, uint32_t address, uint32_t size) {
+	if (!size) {
+		return;
+	}
+	if (!sb->watchedPages) {
+		sb->watchedPages = calloc(mCORE_MEMORY_HOOK_PAGES / 32, sizeof(uint32_t));
+		sb->hook.pages = sb->watchedPages;
+	}
+	uint32_t end = address + size;
+	if (end < address) {
+		// Clamp rather than wrap around the address space
+		end = 0xFFFFFFFF;
+	}
+	struct mScriptWatchRange* range = mScriptWatchRangeListAppend(&sb->watches);
+	range->start = address;
+	range->end = end;
+
+	uint32_t page;
+	for (page = address >> mCORE_MEMORY_HOOK_PAGE_SHIFT; page <= (end - 1) >> mCORE_MEMORY_HOOK_PAGE_SHIFT; ++page) {
+		sb->watchedPages[page >> 5] |= 1U << (page & 0x1F);
+		if (page == mCORE_MEMORY_HOOK_PAGES - 1) {
+			break;
+		}
+	}
+	if (!sb->hookInstalled && sb->core && sb->core->setMemoryHook) {
+		sb->core->setMemoryHook(sb->core, &sb->hook);
+		sb->hookInstalled = true;
+	}
+}
+
+void mScriptBridgeClearWriteWatches(struct mScriptBridge* sb) {
+	_removeHook(sb);
+	mScriptWatchRangeListClear(&sb->watches);
+	if (sb->watchedPages) {
+		memset(sb->watchedPages, 0, mCORE_MEMORY_HOOK_PAGES / 32 * sizeof(uint32_t));
+	}
+}
+
+size_t mScriptBridgeReadRange(struct mScriptBridge* sb, uint32_t address, void* buffer, size_t size) {
+	struct mCore* core = sb->core;
+	if (!core) {
+		return 0;
+	}
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
+	size_t i;
+	for (i = 0; i < nBlocks; ++i) {
+		const struct mCoreMemoryBlock* block = &blocks[i];
+		if ((block->flags & mCORE_MEMORY_VIRTUAL) || !(block->flags & mCORE_MEMORY_MAPPED)) {
+			continue;
+		}
+		if (address < block->start || address + size > block->end) {
+			continue;
+		}
+		if (block->maxSegment && address + size > block->segmentStart) {
+			break;
+		}
+		size_t blockSize = 0;
+		const uint8_t* base = core->getMemoryBlock(core, block->id, &blockSize);
+		if (base && address - block->start + size <= blockSize) {
+			memcpy(buffer, &base[address - block->start], size);
+			return size;
+		}
+		break;
+	}
+	uint8_t* out = buffer;
+	for (i = 0; i < size; ++i) {
+		out[i] = core->busRead8(core, address + i);
+	}
+	return size;
 }
@@ -5,9 +5,11 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/core/serialize.h>
 
+#include <mgba/core/async-writer.h>
 #include <mgba/core/core.h>
 #include <mgba/core/cheats.h>
 #include <mgba/core/interface.h>
+#include <mgba/core/trace.h>
 #include <mgba-util/memory.h>
 #include <mgba-util/vfs.h>
 
@@ -65,21 +67,35 @@ bool mStateExtdataGet(struct mStateExtdata* extdata, enum mStateExtdataTag tag,
 	return true;
 }
 
-bool mStateExtdataSerialize(struct mStateExtdata* extdata, struct VFile* vf) {
-	ssize_t position = vf->seek(vf, 0, SEEK_CUR);
-	ssize_t size = sizeof(struct mStateExtdataHeader);
-	size_t i = 0;
+static size_t _extdataHeaderSize(const struct mStateExtdata* extdata) {
+	size_t size = sizeof(struct mStateExtdataHeader);
+	size_t i;
 	for (i = 1; i < EXTDATA_MAX; ++i) {
 		if (extdata->data[i].data) {
 			size += sizeof(struct mStateExtdataHeader);
 		}
 	}
 	if (size == sizeof(struct mStateExtdataHeader)) {
-		return true;
+		return 0;
 	}
-	struct mStateExtdataHeader* header = malloc(size);
-	position += size;
+	return size;
+}
 
+static size_t _extdataSize(const struct mStateExtdata* extdata) {
+	size_t size = _extdataHeaderSize(extdata);
+	size_t i;
+	for (i = 1; i < EXTDATA_MAX; ++i) {
+		if (extdata->data[i].data) {
+			size += extdata->data[i].size;
+		}
+	}
+	return size;
+}
+
+// Fills in the header table for extdata whose headers begin at position in the output
+static void _extdataWriteHeaders(const struct mStateExtdata* extdata, struct mStateExtdataHeader* header, int64_t position) {
+	position += _extdataHeaderSize(extdata);
+	size_t i;
 	size_t j;
 	for (i = 1, j = 0; i < EXTDATA_MAX; ++i) {
 		if (extdata->data[i].data) {
@@ -90,9 +106,18 @@ bool mStateExtdataSerialize(struct mStateExtdata* extdata, struct VFile* vf) {
 			++j;
 		}
 	}
-	header[j].tag = 0;
-	header[j].size = 0;
-	header[j].offset = 0;
+	memset(&header[j], 0, sizeof(header[j]));
+}
+
+bool mStateExtdataSerialize(struct mStateExtdata* extdata, struct VFile* vf) {
+	ssize_t position = vf->seek(vf, 0, SEEK_CUR);
+	ssize_t size = _extdataHeaderSize(extdata);
+	size_t i;
+	if (!size) {
+		return true;
+	}
+	struct mStateExtdataHeader* header = malloc(size);
+	_extdataWriteHeaders(extdata, header, position);
 
 	if (vf->write(vf, header, size) != size) {
 		free(header);
@@ -149,33 +174,14 @@ bool mStateExtdataDeserialize(struct mStateExtdata* extdata, struct VFile* vf) {
 }
 
 #ifdef USE_PNG
-static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata) {
-	size_t stride;
-	const void* pixels = 0;
-
-	core->getPixels(core, &pixels, &stride);
-	if (!pixels) {
-		return false;
-	}
-
-	size_t stateSize = core->stateSize(core);
-	void* state = anonymousMemoryMap(stateSize);
-	if (!state) {
-		return false;
-	}
-	core->saveState(core, state);
-
+static bool _writePNGState(struct VFile* vf, unsigned width, unsigned height, const void* pixels, size_t stride, const void* state, size_t stateSize, struct mStateExtdata* extdata, int level) {
 	uLongf len = compressBound(stateSize);
 	void* buffer = malloc(len);
 	if (!buffer) {
-		mappedMemoryFree(state, stateSize);
 		return false;
 	}
-	compress(buffer, &len, (const Bytef*) state, stateSize);
-	mappedMemoryFree(state, stateSize);
+	compress2(buffer, &len, (const Bytef*) state, stateSize, level);
 
-	unsigned width, height;
-	core->desiredVideoDimensions(core, &width, &height);
 	png_structp png = PNGWriteOpen(vf);
 	png_infop info = PNGWriteHeader(png, width, height);
 	if (!png || !info) {
@@ -183,6 +189,7 @@ static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExt
 		free(buffer);
 		return false;
 	}
+	png_set_compression_level(png, level);
 	PNGWritePixels(png, width, height, stride, pixels);
 	PNGWriteCustomChunk(png, "gbAs", len, buffer);
 	if (extdata) {
@@ -198,7 +205,7 @@ static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExt
 			}
 			STORE_32LE(i, 0, data);
 			STORE_32LE(extdata->data[i].size, sizeof(uint32_t), data);
-			compress((Bytef*) (data + 2), &len, extdata->data[i].data, extdata->data[i].size);
+			compress2((Bytef*) (data + 2), &len, extdata->data[i].data, extdata->data[i].size, level);
 			PNGWriteCustomChunk(png, "gbAx", len + sizeof(uint32_t) * 2, data);
 			free(data);
 		}
@@ -208,6 +215,33 @@ static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExt
 	return true;
 }
 
+static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata) {
+	size_t stride;
+	const void* pixels = 0;
+	void* converted;
+	if (!mCoreGetNativePixels(core, &pixels, &stride, &converted)) {
+		return false;
+	}
+
+	size_t stateSize = core->stateSize(core);
+	void* state = anonymousMemoryMap(stateSize);
+	if (!state) {
+		free(converted);
+		return false;
+	}
+	mTRACE_BEGIN(trace);
+	core->saveState(core, state);
+	mTRACE_END(trace, "saveState");
+
+	unsigned width, height;
+	core->desiredVideoDimensions(core, &width, &height);
+	int level = core->opts.fastCompression ? Z_BEST_SPEED : Z_DEFAULT_COMPRESSION;
+	bool success = _writePNGState(vf, width, height, pixels, stride, state, stateSize, extdata, level);
+	mappedMemoryFree(state, stateSize);
+	free(converted);
+	return success;
+}
+
 static int _loadPNGChunkHandler(png_structp png, png_unknown_chunkp chunk) {
 	struct mBundledState* bundle = png_get_user_chunk_ptr(png);
 	if (!bundle) {
@@ -299,11 +333,7 @@ static void* _loadPNGState(struct mCore* core, struct VFile* vf, struct mStateEx
 }
 #endif
 
-bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
-	struct mStateExtdata extdata;
-	mStateExtdataInit(&extdata);
-	size_t stateSize = core->stateSize(core);
-
+static struct VFile* _collectExtdata(struct mCore* core, struct mStateExtdata* extdata, int flags) {
 	if (flags & SAVESTATE_METADATA) {
 		uint64_t* creationUsec = malloc(sizeof(*creationUsec));
 		if (creationUsec) {
@@ -334,20 +364,29 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 				.data = creationUsec,
 				.clean = free
 			};
-			mStateExtdataPut(&extdata, EXTDATA_META_TIME, &item);
+			mStateExtdataPut(extdata, EXTDATA_META_TIME, &item);
 		}
 	}
 
 	if (flags & SAVESTATE_SAVEDATA) {
+		// Extdata is always written out before it's released, so save data held in memory can be borrowed
+		const void* view = NULL;
+		size_t size = core->savedataView ? core->savedataView(core, &view) : 0;
 		void* sram = NULL;
-		size_t size = core->savedataClone(core, &sram);
 		if (size) {
+			struct mStateExtdataItem item = {
+				.size = size,
+				.data = (void*) view,
+				.clean = NULL
+			};
+			mStateExtdataPut(extdata, EXTDATA_SAVEDATA, &item);
+		} else if ((size = core->savedataClone(core, &sram))) {
 			struct mStateExtdataItem item = {
 				.size = size,
 				.data = sram,
 				.clean = free
 			};
-			mStateExtdataPut(&extdata, EXTDATA_SAVEDATA, &item);
+			mStateExtdataPut(extdata, EXTDATA_SAVEDATA, &item);
 		}
 	}
 	struct VFile* cheatVf = 0;
@@ -361,16 +400,24 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 				.data = cheatVf->map(cheatVf, cheatVf->size(cheatVf), MAP_READ),
 				.clean = 0
 			};
-			mStateExtdataPut(&extdata, EXTDATA_CHEATS, &item);
+			mStateExtdataPut(extdata, EXTDATA_CHEATS, &item);
 		}
 	}
 	if (flags & SAVESTATE_RTC) {
 		struct mStateExtdataItem item;
 		if (core->rtc.d.serialize) {
 			core->rtc.d.serialize(&core->rtc.d, &item);
-			mStateExtdataPut(&extdata, EXTDATA_RTC, &item);
+			mStateExtdataPut(extdata, EXTDATA_RTC, &item);
 		}
 	}
+	return cheatVf;
+}
+
+bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
+	struct mStateExtdata extdata;
+	mStateExtdataInit(&extdata);
+	size_t stateSize = core->stateSize(core);
+	struct VFile* cheatVf = _collectExtdata(core, &extdata, flags);
 #ifdef USE_PNG
 	if (!(flags & SAVESTATE_SCREENSHOT)) {
 #else
@@ -385,7 +432,9 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 			}
 			return false;
 		}
+		mTRACE_BEGIN(trace);
 		core->saveState(core, state);
+		mTRACE_END(trace, "saveState");
 		vf->unmap(vf, state, stateSize);
 		vf->seek(vf, stateSize, SEEK_SET);
 		mStateExtdataSerialize(&extdata, vf);
@@ -399,6 +448,9 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 	else {
 		bool success = _savePNGState(core, vf, &extdata);
 		mStateExtdataDeinit(&extdata);
+		if (cheatVf) {
+			cheatVf->close(cheatVf);
+		}
 		return success;
 	}
 #endif
@@ -406,6 +458,126 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 	return false;
 }
 
+#ifdef USE_PNG
+struct mPNGStateJob {
+	struct mAsyncWriterJob d;
+	struct VFile* vf;
+	unsigned width;
+	unsigned height;
+	void* pixels;
+	void* state;
+	size_t stateSize;
+	struct mStateExtdata extdata;
+	int level;
+};
+
+static void _writePNGStateJob(struct mAsyncWriterJob* writerJob) {
+	struct mPNGStateJob* job = (struct mPNGStateJob*) writerJob;
+	mTRACE_BEGIN(trace);
+	if (!_writePNGState(job->vf, job->width, job->height, job->pixels, job->width, job->state, job->stateSize, &job->extdata, job->level)) {
+		mLOG(SAVESTATE, ERROR, "Failed to write savestate");
+	}
+	mTRACE_END(trace, "saveStateWrite");
+	job->vf->close(job->vf);
+	mStateExtdataDeinit(&job->extdata);
+	mappedMemoryFree(job->state, job->stateSize);
+	free(job->pixels);
+	free(job);
+}
+
+// Borrowed items only live until the core runs again, so the writer gets its own copies
+static bool _ownExtdata(struct mStateExtdata* extdata) {
+	bool success = true;
+	uint32_t i;
+	for (i = 1; i < EXTDATA_MAX; ++i) {
+		struct mStateExtdataItem* item = &extdata->data[i];
+		if (!item->data || item->clean) {
+			continue;
+		}
+		void* data = malloc(item->size);
+		if (data) {
+			memcpy(data, item->data, item->size);
+			item->clean = free;
+		} else {
+			success = false;
+		}
+		item->data = data;
+	}
+	return success;
+}
+
+static bool _queuePNGState(struct mCore* core, struct VFile* vf, int flags) {
+	size_t stride;
+	const void* pixels = 0;
+	void* converted;
+	if (!mCoreGetNativePixels(core, &pixels, &stride, &converted)) {
+		return false;
+	}
+
+	struct mPNGStateJob* job = calloc(1, sizeof(*job));
+	if (!job) {
+		free(converted);
+		return false;
+	}
+	core->desiredVideoDimensions(core, &job->width, &job->height);
+	job->stateSize = core->stateSize(core);
+	job->state = anonymousMemoryMap(job->stateSize);
+	job->pixels = malloc(job->width * job->height * BYTES_PER_PIXEL);
+	if (!job->state || !job->pixels) {
+		if (job->state) {
+			mappedMemoryFree(job->state, job->stateSize);
+		}
+		free(job->pixels);
+		free(job);
+		free(converted);
+		return false;
+	}
+	mTRACE_BEGIN(trace);
+	core->saveState(core, job->state);
+	mTRACE_END(trace, "saveState");
+	unsigned y;
+	for (y = 0; y < job->height; ++y) {
+		memcpy((uint8_t*) job->pixels + y * job->width * BYTES_PER_PIXEL, (const uint8_t*) pixels + y * stride * BYTES_PER_PIXEL, job->width * BYTES_PER_PIXEL);
+	}
+	free(converted);
+
+	mStateExtdataInit(&job->extdata);
+	struct VFile* cheatVf = _collectExtdata(core, &job->extdata, flags);
+	bool success = _ownExtdata(&job->extdata);
+	if (cheatVf) {
+		cheatVf->close(cheatVf);
+	}
+	if (!success) {
+		mStateExtdataDeinit(&job->extdata);
+		mappedMemoryFree(job->state, job->stateSize);
+		free(job->pixels);
+		free(job);
+		return false;
+	}
+
+	job->vf = vf;
+	job->level = core->opts.fastCompression ? Z_BEST_SPEED : Z_DEFAULT_COMPRESSION;
+	job->d.run = _writePNGStateJob;
+	mAsyncWriterSubmit(core->asyncWriter, &job->d);
+	return true;
+}
+#endif
+
+bool mCoreSaveStateNamedDeferred(struct mCore* core, struct VFile* vf, int flags) {
+#ifdef USE_PNG
+	if (core->asyncWriter && (flags & SAVESTATE_SCREENSHOT)) {
+		if (_queuePNGState(core, vf, flags)) {
+			return true;
+		}
+		vf->close(vf);
+		return false;
+	}
+#endif
+	bool success = mCoreSaveStateNamed(core, vf, flags);
+	vf->close(vf);
+	return success;
+}
+
 void* mCoreExtractState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata) {
 #ifdef USE_PNG
 	if (isPNG(vf)) {
@@ -425,21 +597,12 @@ void* mCoreExtractState(struct mCore* core, struct VFile* vf, struct mStateExtda
 	return state;
 }
 
-bool mCoreLoadStateNamed(struct mCore* core, struct VFile* vf, int flags) {
-	struct mStateExtdata extdata;
-	mStateExtdataInit(&extdata);
-	void* state = mCoreExtractState(core, vf, &extdata);
-	if (!state) {
-		return false;
-	}
-	bool success = core->loadState(core, state);
-	mappedMemoryFree(state, core->stateSize(core));
-
+static void _applyExtdata(struct mCore* core, struct mStateExtdata* extdata, int flags) {
 	unsigned width, height;
 	core->desiredVideoDimensions(core, &width, &height);
 
 	struct mStateExtdataItem item;
-	if (flags & SAVESTATE_SCREENSHOT && mStateExtdataGet(&extdata, EXTDATA_SCREENSHOT, &item)) {
+	if (flags & SAVESTATE_SCREENSHOT && mStateExtdataGet(extdata, EXTDATA_SCREENSHOT, &item)) {
 		mLOG(SAVESTATE, INFO, "Loading screenshot");
 		if (item.size >= (int) (width * height) * 4) {
 			core->putPixels(core, item.data, width);
@@ -447,14 +610,14 @@ bool mCoreLoadStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 			mLOG(SAVESTATE, WARN, "Savestate includes invalid screenshot");
 		}
 	}
-	if (mStateExtdataGet(&extdata, EXTDATA_SAVEDATA, &item)) {
+	if (mStateExtdataGet(extdata, EXTDATA_SAVEDATA, &item)) {
 		mLOG(SAVESTATE, INFO, "Loading savedata");
 		if (item.data) {
 			core->savedataRestore(core, item.data, item.size, flags & SAVESTATE_SAVEDATA);
 		}
 	}
 	struct mCheatDevice* device;
-	if (flags & SAVESTATE_CHEATS && (device = core->cheatDevice(core)) && mStateExtdataGet(&extdata, EXTDATA_CHEATS, &item)) {
+	if (flags & SAVESTATE_CHEATS && (device = core->cheatDevice(core)) && mStateExtdataGet(extdata, EXTDATA_CHEATS, &item)) {
 		mLOG(SAVESTATE, INFO, "Loading cheats");
 		if (item.size) {
 			struct VFile* svf = VFileFromMemory(item.data, item.size);
@@ -465,12 +628,135 @@ bool mCoreLoadStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 			}
 		}
 	}
-	if (flags & SAVESTATE_RTC && mStateExtdataGet(&extdata, EXTDATA_RTC, &item)) {
+	if (flags & SAVESTATE_RTC && mStateExtdataGet(extdata, EXTDATA_RTC, &item)) {
 		mLOG(SAVESTATE, INFO, "Loading RTC");
 		if (core->rtc.d.deserialize) {
 			core->rtc.d.deserialize(&core->rtc.d, &item);
 		}
 	}
+}
+
+bool mCoreLoadStateNamed(struct mCore* core, struct VFile* vf, int flags) {
+	struct mStateExtdata extdata;
+	mStateExtdataInit(&extdata);
+	void* state = mCoreExtractState(core, vf, &extdata);
+	if (!state) {
+		return false;
+	}
+	mTRACE_BEGIN(trace);
+	bool success = core->loadState(core, state);
+	mTRACE_END(trace, "loadState");
+	mappedMemoryFree(state, core->stateSize(core));
+	_applyExtdata(core, &extdata, flags);
+	mStateExtdataDeinit(&extdata);
+	return success;
+}
+
+size_t mCoreSaveStateBuffer(struct mCore* core, void* buffer, size_t size, int flags) {
+	struct mStateExtdata extdata;
+	mStateExtdataInit(&extdata);
+	size_t stateSize = core->stateSize(core);
+	struct VFile* cheatVf = _collectExtdata(core, &extdata, flags);
+	size_t totalSize = stateSize + _extdataSize(&extdata);
+	if (buffer && size >= totalSize) {
+		uint8_t* out = buffer;
+		if (!((uintptr_t) out & (M_STATE_BUFFER_ALIGNMENT - 1))) {
+			mTRACE_BEGIN(trace);
+			core->saveState(core, out);
+			mTRACE_END(trace, "saveState");
+		} else {
+			void* state = anonymousMemoryMap(stateSize);
+			mTRACE_BEGIN(trace);
+			core->saveState(core, state);
+			mTRACE_END(trace, "saveState");
+			memcpy(out, state, stateSize);
+			mappedMemoryFree(state, stateSize);
+		}
+		size_t headerSize = _extdataHeaderSize(&extdata);
+		if (headerSize) {
+			_extdataWriteHeaders(&extdata, (struct mStateExtdataHeader*) &out[stateSize], stateSize);
+			size_t offset = stateSize + headerSize;
+			size_t i;
+			for (i = 1; i < EXTDATA_MAX; ++i) {
+				if (extdata.data[i].data) {
+					memcpy(&out[offset], extdata.data[i].data, extdata.data[i].size);
+					offset += extdata.data[i].size;
+				}
+			}
+		}
+	}
+	mStateExtdataDeinit(&extdata);
+	if (cheatVf) {
+		cheatVf->close(cheatVf);
+	}
+	return totalSize;
+}
+
+size_t mCoreSaveStateBufferBound(struct mCore* core, int flags, size_t maxSavedataSize) {
+	struct mStateExtdata extdata;
+	mStateExtdataInit(&extdata);
+	struct VFile* cheatVf = _collectExtdata(core, &extdata, flags & ~SAVESTATE_SAVEDATA);
+	size_t size = core->stateSize(core) + _extdataSize(&extdata);
+	if (flags & SAVESTATE_SAVEDATA) {
+		// Save data adds its own header, plus the terminating one if it's the only item
+		size += maxSavedataSize + sizeof(struct mStateExtdataHeader);
+		if (!_extdataHeaderSize(&extdata)) {
+			size += sizeof(struct mStateExtdataHeader);
+		}
+	}
+	mStateExtdataDeinit(&extdata);
+	if (cheatVf) {
+		cheatVf->close(cheatVf);
+	}
+	return size;
+}
+
+bool mCoreLoadStateBuffer(struct mCore* core, const void* buffer, size_t size, int flags) {
+	size_t stateSize = core->stateSize(core);
+	if (size < stateSize) {
+		return false;
+	}
+	const uint8_t* in = buffer;
+	struct mStateExtdata extdata;
+	mStateExtdataInit(&extdata);
+	size_t offset = stateSize;
+	while (offset + sizeof(struct mStateExtdataHeader) <= size) {
+		uint32_t tag;
+		int32_t itemSize;
+		int64_t itemOffset;
+		LOAD_32LE(tag, offset + offsetof(struct mStateExtdataHeader, tag), in);
+		LOAD_32LE(itemSize, offset + offsetof(struct mStateExtdataHeader, size), in);
+		LOAD_64LE(itemOffset, offset + offsetof(struct mStateExtdataHeader, offset), in);
+		offset += sizeof(struct mStateExtdataHeader);
+		if (tag == EXTDATA_NONE) {
+			break;
+		}
+		if (tag >= EXTDATA_MAX || itemSize < 0 || itemOffset < 0 || (uint64_t) itemOffset + itemSize > size) {
+			continue;
+		}
+		// Items point straight into the caller's buffer, so there is nothing to clean up
+		struct mStateExtdataItem item = {
+			.data = (void*) &in[itemOffset],
+			.size = itemSize,
+			.clean = NULL
+		};
+		mStateExtdataPut(&extdata, tag, &item);
+	}
+
+	bool success;
+	if (!((uintptr_t) in & (M_STATE_BUFFER_ALIGNMENT - 1))) {
+		mTRACE_BEGIN(trace);
+		success = core->loadState(core, in);
+		mTRACE_END(trace, "loadState");
+	} else {
+		void* state = anonymousMemoryMap(stateSize);
+		memcpy(state, in, stateSize);
+		mTRACE_BEGIN(trace);
+		success = core->loadState(core, state);
+		mTRACE_END(trace, "loadState");
+		mappedMemoryFree(state, stateSize);
+	}
+	_applyExtdata(core, &extdata, flags);
 	mStateExtdataDeinit(&extdata);
 	return success;
 }
@@ -0,0 +1,307 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/startup.h>
+
+#include <mgba/core/cheats.h>
+#include <mgba/core/core.h>
+#include <mgba/core/metrics.h>
+#include <mgba-util/vfs.h>
+#ifndef DISABLE_THREADING
+#include <mgba-util/threading.h>
+#endif
+
+#if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
+mLOG_DEFINE_CATEGORY(STARTUP, "Startup", "core.startup");
+
+static const char* const _assetNames[mCORE_STARTUP_ASSET_MAX] = {
+	[mCORE_STARTUP_ROM] = "ROM",
+	[mCORE_STARTUP_BIOS] = "BIOS",
+	[mCORE_STARTUP_SAVE] = "save",
+	[mCORE_STARTUP_PATCH] = "patch",
+	[mCORE_STARTUP_CHEATS] = "cheats",
+};
+
+struct mCoreStartupContext {
+	struct mCoreStartup* startup;
+	struct mCore* core;
+	// Holds the ROM as opened by the calling thread until it's been read
+	struct VFile* files[mCORE_STARTUP_ASSET_MAX];
+	bool cheatAutoload;
+
+	size_t next;
+#ifndef DISABLE_THREADING
+	Mutex mutex;
+#endif
+};
+
+// Copies a file into memory so that applying it later doesn't wait on the disk
+static struct VFile* _readAll(struct VFile* vf) {
+	if (!vf) {
+		return NULL;
+	}
+	ssize_t size = vf->size(vf);
+	if (size < 0) {
+		vf->close(vf);
+		return NULL;
+	}
+	struct VFile* vfm = VFileMemChunk(NULL, size);
+	if (!vfm) {
+		vf->close(vf);
+		return NULL;
+	}
+	if (size) {
+		uint8_t* buffer = vfm->map(vfm, size, MAP_WRITE);
+		ssize_t offset = 0;
+		vf->seek(vf, 0, SEEK_SET);
+		while (offset < size) {
+			ssize_t read = vf->read(vf, &buffer[offset], size - offset);
+			if (read <= 0) {
+				break;
+			}
+			offset += read;
+		}
+		vfm->unmap(vfm, buffer, size);
+		if (offset < size) {
+			vfm->close(vfm);
+			vfm = NULL;
+		}
+	}
+	vf->close(vf);
+	return vfm;
+}
+
+static struct VFile* _findBIOS(struct mCore* core) {
+	if (core->platform(core) != PLATFORM_GBA || !core->opts.useBios) {
+		return NULL;
+	}
+	// Same order the GBA core looks in when it resets without a BIOS
+	struct VFile* vf = NULL;
+	if (core->opts.bios) {
+		vf = VFileOpen(core->opts.bios, O_RDONLY);
+	}
+	if (!vf) {
+		const char* configPath = mCoreConfigGetValue(&core->config, "gba.bios");
+		if (configPath) {
+			vf = VFileOpen(configPath, O_RDONLY);
+		}
+	}
+	if (!vf) {
+		char path[PATH_MAX];
+		mCoreConfigDirectory(path, PATH_MAX);
+		strncat(path, PATH_SEP "gba_bios.bin", PATH_MAX - strlen(path));
+		vf = VFileOpen(path, O_RDONLY);
+	}
+	return vf;
+}
+
+static struct VFile* _findPatch(struct mCoreStartup* startup, struct mCore* core) {
+	if (startup->patch) {
+		return VFileOpen(startup->patch, O_RDONLY);
+	}
+	if (!startup->autoloadPatch) {
+		return NULL;
+	}
+	static const char* const suffixes[] = { ".ups", ".ips", ".bps" };
+	size_t i;
+	for (i = 0; i < sizeof(suffixes) / sizeof(*suffixes); ++i) {
+		struct VFile* vf = mDirectorySetOpenSuffix(&core->dirs, core->dirs.patch, suffixes[i], O_RDONLY);
+		if (vf) {
+			return vf;
+		}
+	}
+	return NULL;
+}
+
+// Only opens and reads; nothing here may touch the core, since the readers run side by side
+static void _read(struct mCoreStartupContext* context, enum mCoreStartupAsset asset) {
+	struct mCoreStartup* startup = context->startup;
+	struct mCore* core = context->core;
+	struct VFile** vf = &context->files[asset];
+	uint64_t start = mCoreMetricsTime();
+	switch (asset) {
+	case mCORE_STARTUP_ROM:
+		*vf = _readAll(*vf);
+		break;
+	case mCORE_STARTUP_BIOS:
+		*vf = _readAll(_findBIOS(core));
+		break;
+	case mCORE_STARTUP_SAVE:
+		// Saves are written back while running, so this stays a real file
+		if (startup->autoloadSave) {
+			*vf = mDirectorySetOpenSuffix(&core->dirs, core->dirs.save, ".sav", O_CREAT | O_RDWR);
+		}
+		break;
+	case mCORE_STARTUP_PATCH:
+		*vf = _readAll(_findPatch(startup, core));
+		break;
+	case mCORE_STARTUP_CHEATS:
+		if (startup->autoloadCheats && context->cheatAutoload) {
+			*vf = _readAll(mDirectorySetOpenSuffix(&core->dirs, core->dirs.cheats, ".cheats", O_RDONLY));
+		}
+		break;
+	case mCORE_STARTUP_ASSET_MAX:
+		break;
+	}
+	startup->readTime[asset] = mCoreMetricsTime() - start;
+}
+
+#ifndef DISABLE_THREADING
+static void _drain(struct mCoreStartupContext* context) {
+	MutexLock(&context->mutex);
+	while (context->next < mCORE_STARTUP_ASSET_MAX) {
+		enum mCoreStartupAsset asset = context->next;
+		++context->next;
+		MutexUnlock(&context->mutex);
+		_read(context, asset);
+		MutexLock(&context->mutex);
+	}
+	MutexUnlock(&context->mutex);
+}
+
+static THREAD_ENTRY _startupThread(void* context) {
+	ThreadSetName("Startup Thread");
+	_drain(context);
+	return 0;
+}
+#endif
+
+static void _readAssets(struct mCoreStartupContext* context) {
+#ifndef DISABLE_THREADING
+	size_t nThreads = context->startup->nThreads;
+	if (nThreads > mCORE_STARTUP_MAX_THREADS) {
+		nThreads = mCORE_STARTUP_MAX_THREADS;
+	}
+	if (nThreads > mCORE_STARTUP_ASSET_MAX) {
+		nThreads = mCORE_STARTUP_ASSET_MAX;
+	}
+	if (nThreads > 1) {
+		Thread threads[mCORE_STARTUP_MAX_THREADS];
+		bool started[mCORE_STARTUP_MAX_THREADS] = { false };
+		size_t i;
+		MutexInit(&context->mutex);
+		for (i = 1; i < nThreads; ++i) {
+			started[i] = !ThreadCreate(&threads[i], _startupThread, context);
+		}
+		// The calling thread reads too, so a failure to start any threads just means reading serially
+		_drain(context);
+		for (i = 1; i < nThreads; ++i) {
+			if (started[i]) {
+				ThreadJoin(threads[i]);
+			}
+		}
+		MutexDeinit(&context->mutex);
+		return;
+	}
+#endif
+	for (context->next = 0; context->next < mCORE_STARTUP_ASSET_MAX; ++context->next) {
+		_read(context, context->next);
+	}
+}
+
+static void _apply(struct mCoreStartupContext* context, enum mCoreStartupAsset asset) {
+	struct mCoreStartup* startup = context->startup;
+	struct mCore* core = context->core;
+	struct VFile* vf = context->files[asset];
+	context->files[asset] = NULL;
+	uint64_t start = mCoreMetricsTime();
+	bool loaded = false;
+	switch (asset) {
+	case mCORE_STARTUP_ROM:
+		loaded = vf && core->loadROM(core, vf);
+		if (!loaded && vf) {
+			vf->close(vf);
+		}
+		break;
+	case mCORE_STARTUP_BIOS:
+		// If this one isn't usable, the core will still go looking for one on reset
+		loaded = vf && core->loadBIOS(core, vf, 0);
+		if (!loaded && vf) {
+			vf->close(vf);
+		}
+		break;
+	case mCORE_STARTUP_SAVE:
+		if (startup->autoloadSave) {
+			loaded = core->loadSave(core, vf);
+		}
+		break;
+	case mCORE_STARTUP_PATCH:
+		if (vf) {
+			// Patches are applied right away, so the file isn't needed afterwards
+			loaded = core->loadPatch(core, vf);
+			vf->close(vf);
+		}
+		break;
+	case mCORE_STARTUP_CHEATS:
+		if (vf) {
+			loaded = mCheatParseFile(core->cheatDevice(core), vf);
+			vf->close(vf);
+		}
+		if (startup->autoloadCheats) {
+			int cheatAuto;
+			if (!mCoreConfigGetIntValue(&core->config, "cheatAutosave", &cheatAuto) || cheatAuto) {
+				core->cheatDevice(core)->autosave = true;
+			}
+		}
+		break;
+	case mCORE_STARTUP_ASSET_MAX:
+		break;
+	}
+	startup->loaded[asset] = loaded;
+	startup->applyTime[asset] = mCoreMetricsTime() - start;
+}
+
+void mCoreStartupInit(struct mCoreStartup* startup) {
+	memset(startup, 0, sizeof(*startup));
+	startup->nThreads = 4;
+	startup->autoloadSave = true;
+	startup->autoloadPatch = true;
+	startup->autoloadCheats = true;
+}
+
+bool mCoreStartupLoad(struct mCoreStartup* startup, struct mCore* core, const char* path) {
+	memset(startup->loaded, 0, sizeof(startup->loaded));
+	memset(startup->readTime, 0, sizeof(startup->readTime));
+	memset(startup->applyTime, 0, sizeof(startup->applyTime));
+	uint64_t start = mCoreMetricsTime();
+
+	struct mCoreStartupContext context = {
+		.startup = startup,
+		.core = core,
+	};
+	// Opening the ROM is what tells us where everything else lives, so it can't wait on anything
+	context.files[mCORE_STARTUP_ROM] = mDirectorySetOpenPath(&core->dirs, path, core->isROM);
+	startup->openTime = mCoreMetricsTime() - start;
+	if (!context.files[mCORE_STARTUP_ROM]) {
+		startup->totalTime = startup->openTime;
+		return false;
+	}
+	int cheatAuto;
+	context.cheatAutoload = !mCoreConfigGetIntValue(&core->config, "cheatAutoload", &cheatAuto) || cheatAuto;
+
+	_readAssets(&context);
+	uint64_t readTime = mCoreMetricsTime() - start - startup->openTime;
+
+	enum mCoreStartupAsset asset;
+	for (asset = 0; asset < mCORE_STARTUP_ASSET_MAX; ++asset) {
+		if (asset == mCORE_STARTUP_ROM || startup->loaded[mCORE_STARTUP_ROM]) {
+			_apply(&context, asset);
+		} else if (context.files[asset]) {
+			context.files[asset]->close(context.files[asset]);
+			context.files[asset] = NULL;
+		}
+	}
+	startup->totalTime = mCoreMetricsTime() - start;
+
+	mLOG(STARTUP, INFO, "Loaded in %u us: open %u us, read %u us, apply %u us",
+	     (unsigned) startup->totalTime, (unsigned) startup->openTime, (unsigned) readTime,
+	     (unsigned) (startup->totalTime - startup->openTime - readTime));
+	for (asset = 0; asset < mCORE_STARTUP_ASSET_MAX; ++asset) {
+		mLOG(STARTUP, DEBUG, "%s: read %u us, apply %u us%s", _assetNames[asset], (unsigned) startup->readTime[asset],
+		     (unsigned) startup->applyTime[asset], startup->loaded[asset] ? "" : " (not loaded)");
+	}
+	return startup->loaded[mCORE_STARTUP_ROM];
+}
+#endif
@@ -0,0 +1,122 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/state-hash.h>
+
+#include <mgba/core/core.h>
+#include <mgba-util/hash.h>
+#include <mgba-util/memory.h>
+
+void mStateHasherInit(struct mStateHasher* hasher, struct mCore* core, bool incremental) {
+	memset(hasher, 0, sizeof(*hasher));
+	hasher->core = core;
+	hasher->stateSize = core->stateSize(core);
+	hasher->state = anonymousMemoryMap(hasher->stateSize);
+
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
+	size_t i;
+	for (i = 0; i < nBlocks && hasher->nBlocks < mSTATE_HASH_MAX_BLOCKS; ++i) {
+		if ((blocks[i].flags & mCORE_MEMORY_VIRTUAL) || !(blocks[i].flags & mCORE_MEMORY_WRITE)) {
+			continue;
+		}
+		struct mStateHashBlock* block = &hasher->blocks[hasher->nBlocks];
+		block->id = blocks[i].id;
+		block->name = blocks[i].internalName;
+		if (incremental && core->trackMemoryBlockDirty) {
+			block->tracked = core->trackMemoryBlockDirty(core, block->id, true);
+		}
+		++hasher->nBlocks;
+	}
+	hasher->hash.nBlocks = hasher->nBlocks;
+}
+
+void mStateHasherDeinit(struct mStateHasher* hasher) {
+	size_t i;
+	for (i = 0; i < hasher->nBlocks; ++i) {
+		free(hasher->blocks[i].pageHashes);
+	}
+	mappedMemoryFree(hasher->state, hasher->stateSize);
+}
+
+static uint64_t _hashBlock(struct mStateHasher* hasher, struct mStateHashBlock* block) {
+	struct mCore* core = hasher->core;
+	size_t size = 0;
+	const uint8_t* data = core->getMemoryBlock(core, block->id, &size);
+	if (!data) {
+		size = 0;
+	}
+	if (size != block->size || !block->pageHashes) {
+		free(block->pageHashes);
+		block->size = size;
+		block->nPages = (size + mCORE_MEMORY_DIRTY_PAGE_SIZE - 1) >> mCORE_MEMORY_DIRTY_PAGE_SHIFT;
+		block->pageHashes = calloc(block->nPages + 1, sizeof(*block->pageHashes));
+		block->valid = false;
+	}
+
+	const uint32_t* dirty = NULL;
+	size_t dirtyPages = 0;
+	if (block->tracked && block->valid) {
+		dirty = core->getMemoryBlockDirty(core, block->id, &dirtyPages);
+	}
+	size_t page;
+	for (page = 0; page < block->nPages; ++page) {
+		if (dirty && page < dirtyPages) {
+			if (!dirty[page >> 5]) {
+				// Skip the rest of a clean word
+				page |= 0x1F;
+				continue;
+			}
+			if (!(dirty[page >> 5] & (1U << (page & 0x1F)))) {
+				continue;
+			}
+		}
+		size_t offset = page << mCORE_MEMORY_DIRTY_PAGE_SHIFT;
+		size_t length = size - offset;
+		if (length > mCORE_MEMORY_DIRTY_PAGE_SIZE) {
+			length = mCORE_MEMORY_DIRTY_PAGE_SIZE;
+		}
+		STORE_64LE(hash64(&data[offset], length, page), page << 3, block->pageHashes);
+	}
+	if (block->tracked) {
+		core->clearMemoryBlockDirty(core, block->id);
+	}
+	block->valid = true;
+	return hash64(block->pageHashes, block->nPages * sizeof(*block->pageHashes), size);
+}
+
+uint64_t mStateHasherUpdate(struct mStateHasher* hasher) {
+	struct mCore* core = hasher->core;
+	struct mStateHash* hash = &hasher->hash;
+	if (core->saveState(core, hasher->state)) {
+		hash->state = hash64(hasher->state, hasher->stateSize, 0);
+	} else {
+		hash->state = 0;
+	}
+
+	uint64_t combined[mSTATE_HASH_MAX_BLOCKS + 1];
+	STORE_64LE(hash->state, 0, combined);
+	size_t i;
+	for (i = 0; i < hasher->nBlocks; ++i) {
+		hash->blocks[i] = _hashBlock(hasher, &hasher->blocks[i]);
+		STORE_64LE(hash->blocks[i], (i + 1) << 3, combined);
+	}
+	hash->combined = hash64(combined, (hasher->nBlocks + 1) * sizeof(*combined), 0);
+	return hash->combined;
+}
+
+ssize_t mStateHashCompare(const struct mStateHash* a, const struct mStateHash* b) {
+	if (a->combined == b->combined) {
+		return -1;
+	}
+	size_t nBlocks = a->nBlocks < b->nBlocks ? a->nBlocks : b->nBlocks;
+	size_t i;
+	for (i = 0; i < nBlocks; ++i) {
+		if (a->blocks[i] != b->blocks[i]) {
+			return i;
+		}
+	}
+	return nBlocks;
+}
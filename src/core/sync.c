@@ -6,6 +6,32 @@
 #include <mgba/core/sync.h>
 
 #include <mgba/core/blip_buf.h>
+#include <mgba/core/metrics.h>
+#include <mgba/core/trace.h>
+
+#define AUDIO_FRAME_SIZE (2 * sizeof(int16_t))
+#define AUDIO_DISCARD_FRAMES 0x100
+#define AUDIO_RING_WAIT_MS 5
+
+// How many reads the pull model's margins take to shrink by about a third
+#define AUDIO_PULL_JITTER_DECAY 64
+#define AUDIO_PULL_UNDERRUN_DECAY 512
+// Gaps longer than this many periods are pauses, not jitter
+#define AUDIO_PULL_MAX_GAP 8
+
+// Microseconds left to spin after sleeping, to begin with and at the least
+#define FRAME_PACING_START_MARGIN 2000
+#define FRAME_PACING_MIN_MARGIN 200
+
+static inline void _spinPause(void) {
+#ifdef _WIN32
+	YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+	__asm__ __volatile__("yield");
+#endif
+}
 
 static void _changeVideoSync(struct mCoreSync* sync, bool frameOn) {
 	// Make sure the video thread can process events while the GBA thread is paused
@@ -17,19 +43,75 @@ static void _changeVideoSync(struct mCoreSync* sync, bool frameOn) {
 	MutexUnlock(&sync->videoFrameMutex);
 }
 
+static void _paceFrame(struct mCoreSync* sync) {
+	if (sync->fpsTarget <= 0) {
+		return;
+	}
+	double period = 1000000. / sync->fpsTarget;
+	uint64_t now = mCoreMetricsTime();
+	double deadline = sync->frameDeadline + period;
+	// Start over instead of racing to catch up after falling behind, e.g. after a pause
+	if (!sync->frameDeadline || now > deadline + period || deadline > now + 2 * period) {
+		sync->frameDeadline = now;
+		return;
+	}
+	sync->frameDeadline = deadline;
+	if (now >= deadline) {
+		return;
+	}
+
+	uint64_t start = now;
+	mTRACE_BEGIN(trace);
+	if (!sync->framePacingMargin) {
+		sync->framePacingMargin = FRAME_PACING_START_MARGIN;
+	}
+	if (deadline - now > sync->framePacingMargin) {
+		uint32_t sleep = deadline - now - sync->framePacingMargin;
+		if (!ThreadSleep(sleep)) {
+			now = mCoreMetricsTime();
+			uint32_t overslept = now > start + sleep ? now - start - sleep : 0;
+			// Shrink the margin slowly, so one punctual wakeup doesn't lead to a run of late frames
+			uint32_t margin = sync->framePacingMargin - sync->framePacingMargin / 16;
+			if (margin < overslept + FRAME_PACING_MIN_MARGIN) {
+				margin = overslept + FRAME_PACING_MIN_MARGIN;
+			}
+			if (margin > period / 2) {
+				margin = period / 2;
+			}
+			sync->framePacingMargin = margin;
+		}
+	}
+	while (now < deadline) {
+		_spinPause();
+		now = mCoreMetricsTime();
+	}
+	mTRACE_END(trace, "framePacing");
+	sync->videoWaitTime += now - start;
+}
+
 void mCoreSyncPostFrame(struct mCoreSync* sync) {
 	if (!sync) {
 		return;
 	}
 
+	if (sync->framePacing) {
+		_paceFrame(sync);
+	}
+
 	MutexLock(&sync->videoFrameMutex);
 	++sync->videoFramePending;
+	uint64_t start = sync->videoFrameWait ? mCoreMetricsTime() : 0;
+	mTRACE_BEGIN(trace);
 	do {
 		ConditionWake(&sync->videoFrameAvailableCond);
 		if (sync->videoFrameWait) {
 			ConditionWait(&sync->videoFrameRequiredCond, &sync->videoFrameMutex);
 		}
 	} while (sync->videoFrameWait && sync->videoFramePending);
+	mTRACE_END(trace, "videoSyncWait");
+	if (start) {
+		sync->videoWaitTime += mCoreMetricsTime() - start;
+	}
 	MutexUnlock(&sync->videoFrameMutex);
 }
 
@@ -78,17 +160,128 @@ void mCoreSyncSetVideoSync(struct mCoreSync* sync, bool wait) {
 	_changeVideoSync(sync, wait);
 }
 
-bool mCoreSyncProduceAudio(struct mCoreSync* sync, const struct blip_t* buf, size_t samples) {
+// How full the producer may fill the ring, in bytes
+static size_t _audioLimit(struct mCoreSync* sync) {
+	uint32_t target;
+	ATOMIC_LOAD(target, sync->audioTarget);
+	size_t capacity = RingSPSCCapacity(&sync->audioRing);
+	if (!target || target * AUDIO_FRAME_SIZE > capacity) {
+		return capacity;
+	}
+	return target * AUDIO_FRAME_SIZE;
+}
+
+static size_t _transferAudio(struct mCoreSync* sync, struct blip_t* left, struct blip_t* right) {
+	size_t transferred = 0;
+	size_t available = blip_samples_avail(left);
+	size_t limit = _audioLimit(sync);
+	size_t queued = RingSPSCSize(&sync->audioRing);
+	size_t room = limit > queued ? (limit - queued) / AUDIO_FRAME_SIZE : 0;
+	if (available > room) {
+		available = room;
+	}
+	while (available) {
+		size_t length = AUDIO_FRAME_SIZE;
+		int16_t* span = RingSPSCReserve(&sync->audioRing, &length);
+		if (!span) {
+			break;
+		}
+		length /= AUDIO_FRAME_SIZE;
+		if (length > available) {
+			length = available;
+		}
+		blip_read_samples_stereo(left, right, span, length);
+		RingSPSCCommit(&sync->audioRing, length * AUDIO_FRAME_SIZE);
+		transferred += length;
+		available -= length;
+	}
+	return transferred;
+}
+
+static void _discardAudio(struct mCoreSync* sync, struct blip_t* left, struct blip_t* right) {
+	int16_t discard[AUDIO_DISCARD_FRAMES * 2];
+	size_t available = blip_samples_avail(left);
+	ATOMIC_ADD(sync->audioOverruns, available);
+	while (available) {
+		size_t length = available;
+		if (length > AUDIO_DISCARD_FRAMES) {
+			length = AUDIO_DISCARD_FRAMES;
+		}
+		blip_read_samples_stereo(left, right, discard, length);
+		available -= length;
+	}
+}
+
+static void _adjustAudioRate(struct mCoreSync* sync, struct blip_t* left, struct blip_t* right) {
+	if (sync->audioRateControl <= 0 || sync->audioSampleRate <= 0) {
+		return;
+	}
+	// Produce slightly faster while the ring is under half full, and slightly slower above it
+	double fill = (double) RingSPSCSize(&sync->audioRing) / _audioLimit(sync);
+	if (fill > 1) {
+		fill = 1;
+	}
+	double sampleRate = sync->audioSampleRate * (1 + sync->audioRateControl * (1 - 2 * fill));
+	blip_set_rates(left, sync->audioClockRate, sampleRate);
+	blip_set_rates(right, sync->audioClockRate, sampleRate);
+}
+
+static bool _produceAudioRing(struct mCoreSync* sync, struct blip_t* left, struct blip_t* right, size_t samples) {
+	uint32_t pullFrames;
+	ATOMIC_LOAD(pullFrames, sync->audioPullFrames);
+	if (pullFrames && samples > pullFrames) {
+		samples = pullFrames;
+	}
+	if ((size_t) blip_samples_avail(left) < samples) {
+		return false;
+	}
+	_transferAudio(sync, left, right);
+	_adjustAudioRate(sync, left, right);
+	bool progress = false;
+	while ((size_t) blip_samples_avail(left) >= samples) {
+		if (!sync->audioWait) {
+			_discardAudio(sync, left, right);
+			break;
+		}
+		// The consumer only takes the mutex to wake us if it sees this flag. The timeout covers
+		// the wake-up it can miss by reading the flag just before it is set.
+		uint64_t start = mCoreMetricsTime();
+		mTRACE_BEGIN(trace);
+		ATOMIC_STORE(sync->audioProducerWaiting, 1);
+		ConditionWaitTimed(&sync->audioRequiredCond, &sync->audioBufferMutex, AUDIO_RING_WAIT_MS);
+		ATOMIC_STORE(sync->audioProducerWaiting, 0);
+		mTRACE_END(trace, "audioSyncWait");
+		sync->audioWaitTime += mCoreMetricsTime() - start;
+		progress = _transferAudio(sync, left, right) > 0;
+	}
+	return progress;
+}
+
+bool mCoreSyncProduceAudio(struct mCoreSync* sync, struct blip_t* left, struct blip_t* right, size_t samples) {
 	if (!sync) {
 		return true;
 	}
 
-	size_t produced = blip_samples_avail(buf);
+	if (sync->audioRing.data) {
+		mTRACE_BEGIN(trace);
+		bool progress = _produceAudioRing(sync, left, right, samples);
+		mTRACE_END(trace, "audioProduce");
+		MutexUnlock(&sync->audioBufferMutex);
+		return progress;
+	}
+
+	size_t produced = blip_samples_avail(left);
 	size_t producedNew = produced;
-	while (sync->audioWait && producedNew >= samples) {
-		ConditionWait(&sync->audioRequiredCond, &sync->audioBufferMutex);
-		produced = producedNew;
-		producedNew = blip_samples_avail(buf);
+	if (sync->audioWait && producedNew >= samples) {
+		uint64_t start = mCoreMetricsTime();
+		mTRACE_BEGIN(trace);
+		do {
+			ConditionWait(&sync->audioRequiredCond, &sync->audioBufferMutex);
+			produced = producedNew;
+			producedNew = blip_samples_avail(left);
+		} while (sync->audioWait && producedNew >= samples);
+		mTRACE_END(trace, "audioSyncWait");
+		sync->audioWaitTime += mCoreMetricsTime() - start;
 	}
 	MutexUnlock(&sync->audioBufferMutex);
 	return producedNew != produced;
@@ -118,3 +311,142 @@ void mCoreSyncConsumeAudio(struct mCoreSync* sync) {
 	ConditionWake(&sync->audioRequiredCond);
 	MutexUnlock(&sync->audioBufferMutex);
 }
+
+void mCoreSyncInitAudioRing(struct mCoreSync* sync, size_t frames) {
+	if (!sync) {
+		return;
+	}
+
+	MutexLock(&sync->audioBufferMutex);
+	if (!sync->audioRing.data) {
+		RingSPSCInit(&sync->audioRing, frames * AUDIO_FRAME_SIZE);
+		sync->audioProducerWaiting = 0;
+		sync->audioOverruns = 0;
+		sync->audioUnderruns = 0;
+		sync->audioUnderrunEvents = 0;
+		sync->audioJitterMax = 0;
+	}
+	MutexUnlock(&sync->audioBufferMutex);
+}
+
+void mCoreSyncDeinitAudioRing(struct mCoreSync* sync) {
+	if (!sync) {
+		return;
+	}
+
+	MutexLock(&sync->audioBufferMutex);
+	if (sync->audioRing.data) {
+		RingSPSCDeinit(&sync->audioRing);
+	}
+	MutexUnlock(&sync->audioBufferMutex);
+}
+
+bool mCoreSyncHasAudioRing(const struct mCoreSync* sync) {
+	return sync && sync->audioRing.data;
+}
+
+size_t mCoreSyncAudioAvailable(struct mCoreSync* sync) {
+	return RingSPSCSize(&sync->audioRing) / AUDIO_FRAME_SIZE;
+}
+
+static void _updatePullTarget(struct mCoreSync* sync, size_t frames, size_t read) {
+	uint64_t now = mCoreMetricsTime();
+	double rate = sync->audioSampleRate;
+	if (sync->audioLastRead && rate > 0) {
+		double period = frames * 1000000. / rate;
+		double interval = now - sync->audioLastRead;
+		if (interval < period * AUDIO_PULL_MAX_GAP) {
+			// Follow a late callback straight away, but only forget it gradually
+			float deviation = interval > period ? interval - period : period - interval;
+			sync->audioJitter -= sync->audioJitter / AUDIO_PULL_JITTER_DECAY;
+			if (deviation > sync->audioJitter) {
+				sync->audioJitter = deviation;
+			}
+			if (deviation > sync->audioJitterMax) {
+				ATOMIC_STORE(sync->audioJitterMax, (uint32_t) deviation);
+			}
+		}
+	}
+	sync->audioLastRead = now;
+
+	sync->audioUnderrunMargin -= sync->audioUnderrunMargin / AUDIO_PULL_UNDERRUN_DECAY;
+	if (read < frames) {
+		ATOMIC_ADD(sync->audioUnderrunEvents, 1);
+		sync->audioUnderrunMargin += frames - read;
+	}
+
+	// One callback being read, one being produced in handoff-sized pieces, and the margins
+	double target = 2. * frames + sync->audioUnderrunMargin;
+	if (rate > 0) {
+		target += sync->audioJitter * rate / 1000000.;
+	}
+	size_t capacity = RingSPSCCapacity(&sync->audioRing) / AUDIO_FRAME_SIZE;
+	if (target > capacity) {
+		target = capacity;
+	}
+	ATOMIC_STORE(sync->audioTarget, (uint32_t) target);
+}
+
+size_t mCoreSyncReadAudio(struct mCoreSync* sync, int16_t* output, size_t frames) {
+	mTRACE_BEGIN(trace);
+	size_t read = 0;
+	while (read < frames) {
+		size_t length = AUDIO_FRAME_SIZE;
+		const int16_t* span = RingSPSCPeek(&sync->audioRing, &length);
+		if (!span) {
+			break;
+		}
+		length /= AUDIO_FRAME_SIZE;
+		if (length > frames - read) {
+			length = frames - read;
+		}
+		memcpy(&output[read * 2], span, length * AUDIO_FRAME_SIZE);
+		RingSPSCConsume(&sync->audioRing, length * AUDIO_FRAME_SIZE);
+		read += length;
+	}
+	if (read < frames) {
+		memset(&output[read * 2], 0, (frames - read) * AUDIO_FRAME_SIZE);
+		ATOMIC_ADD(sync->audioUnderruns, frames - read);
+	}
+	if (sync->audioPullFrames && frames) {
+		_updatePullTarget(sync, frames, read);
+	}
+
+	uint32_t waiting;
+	ATOMIC_LOAD(waiting, sync->audioProducerWaiting);
+	if (waiting) {
+		MutexLock(&sync->audioBufferMutex);
+		ConditionWake(&sync->audioRequiredCond);
+		MutexUnlock(&sync->audioBufferMutex);
+	}
+	mTRACE_END(trace, "audioConsume");
+	return read;
+}
+
+void mCoreSyncSetAudioRates(struct mCoreSync* sync, struct blip_t* left, struct blip_t* right, double clockRate, double sampleRate) {
+	if (sync) {
+		MutexLock(&sync->audioBufferMutex);
+		sync->audioClockRate = clockRate;
+		sync->audioSampleRate = sampleRate;
+	}
+	blip_set_rates(left, clockRate, sampleRate);
+	blip_set_rates(right, clockRate, sampleRate);
+	if (sync) {
+		MutexUnlock(&sync->audioBufferMutex);
+	}
+}
+
+void mCoreSyncSetAudioPull(struct mCoreSync* sync, size_t deviceFrames) {
+	if (!sync) {
+		return;
+	}
+
+	MutexLock(&sync->audioBufferMutex);
+	sync->audioLastRead = 0;
+	sync->audioJitter = 0;
+	sync->audioUnderrunMargin = 0;
+	ATOMIC_STORE(sync->audioPullFrames, (uint32_t) deviceFrames);
+	ATOMIC_STORE(sync->audioTarget, (uint32_t) (deviceFrames * 2));
+	ConditionWake(&sync->audioRequiredCond);
+	MutexUnlock(&sync->audioBufferMutex);
+}
@@ -0,0 +1,76 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/async-writer.h>
+
+#define N_JOBS 32
+
+struct TestJob {
+	struct mAsyncWriterJob d;
+	int* order;
+	int* count;
+	int id;
+};
+
+static void _runJob(struct mAsyncWriterJob* job) {
+	struct TestJob* test = (struct TestJob*) job;
+	test->order[*test->count] = test->id;
+	++*test->count;
+}
+
+static void _submitJobs(struct mAsyncWriter* writer, struct TestJob* jobs, int* order, int* count) {
+	int i;
+	for (i = 0; i < N_JOBS; ++i) {
+		jobs[i].d.run = _runJob;
+		jobs[i].order = order;
+		jobs[i].count = count;
+		jobs[i].id = i;
+		mAsyncWriterSubmit(writer, &jobs[i].d);
+	}
+}
+
+M_TEST_DEFINE(flushRunsInOrder) {
+	struct mAsyncWriter writer;
+	struct TestJob jobs[N_JOBS];
+	int order[N_JOBS];
+	int count = 0;
+	mAsyncWriterInit(&writer);
+	_submitJobs(&writer, jobs, order, &count);
+	mAsyncWriterFlush(&writer);
+	assert_int_equal(count, N_JOBS);
+	int i;
+	for (i = 0; i < N_JOBS; ++i) {
+		assert_int_equal(order[i], i);
+	}
+	mAsyncWriterDeinit(&writer);
+	assert_int_equal(count, N_JOBS);
+}
+
+M_TEST_DEFINE(deinitDrains) {
+	struct mAsyncWriter writer;
+	struct TestJob jobs[N_JOBS];
+	int order[N_JOBS];
+	int count = 0;
+	mAsyncWriterInit(&writer);
+	_submitJobs(&writer, jobs, order, &count);
+	mAsyncWriterDeinit(&writer);
+	assert_int_equal(count, N_JOBS);
+	assert_int_equal(order[N_JOBS - 1], N_JOBS - 1);
+}
+
+M_TEST_DEFINE(flushEmpty) {
+	struct mAsyncWriter writer;
+	mAsyncWriterInit(&writer);
+	mAsyncWriterFlush(&writer);
+	mAsyncWriterFlush(&writer);
+	mAsyncWriterDeinit(&writer);
+}
+
+M_TEST_SUITE_DEFINE(mAsyncWriter,
+	cmocka_unit_test(flushRunsInOrder),
+	cmocka_unit_test(deinitDrains),
+	cmocka_unit_test(flushEmpty))
@@ -0,0 +1,90 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+#include "core/test/test-core.h"
+
+#include <mgba/core/batch.h>
+
+#define N_CORES 13
+
+static void _initCores(struct TestCore* cores, struct mCore** list) {
+	size_t i;
+	for (i = 0; i < N_CORES; ++i) {
+		TestCoreInit(&cores[i]);
+		list[i] = &cores[i].d;
+	}
+}
+
+static uint32_t _expectedHash(const uint32_t* keys, unsigned frames) {
+	uint32_t hash = 0;
+	unsigned i;
+	for (i = 0; i < frames; ++i) {
+		hash = hash * 31 + keys[i] + 1;
+	}
+	return hash;
+}
+
+static void _runBatch(size_t nThreads) {
+	struct TestCore cores[N_CORES];
+	struct mCore* list[N_CORES];
+	_initCores(cores, list);
+	uint32_t keys[N_CORES * 5];
+	size_t i;
+	for (i = 0; i < N_CORES * 5; ++i) {
+		keys[i] = (i * 7) & 0x3FF;
+	}
+
+	struct mCoreBatch batch;
+	mCoreBatchInit(&batch, nThreads);
+	for (i = 0; i < 3; ++i) {
+		mCoreBatchStep(&batch, list, N_CORES, 5, keys, false);
+	}
+	for (i = 0; i < N_CORES; ++i) {
+		assert_int_equal(cores[i].state.frame, 15);
+		assert_int_equal(cores[i].shownFrames, 15);
+		uint32_t hash = _expectedHash(&keys[i * 5], 5);
+		hash = hash * (31 * 31 * 31 * 31 * 31) + _expectedHash(&keys[i * 5], 5);
+		hash = hash * (31 * 31 * 31 * 31 * 31) + _expectedHash(&keys[i * 5], 5);
+		assert_int_equal(cores[i].state.hash, hash);
+	}
+	mCoreBatchDeinit(&batch);
+}
+
+M_TEST_DEFINE(singleThread) {
+	_runBatch(1);
+}
+
+M_TEST_DEFINE(manyThreads) {
+	_runBatch(4);
+}
+
+M_TEST_DEFINE(renderLast) {
+	struct TestCore cores[N_CORES];
+	struct mCore* list[N_CORES];
+	_initCores(cores, list);
+
+	struct mCoreBatch batch;
+	mCoreBatchInit(&batch, 3);
+	mCoreBatchStep(&batch, list, N_CORES, 4, NULL, true);
+	mCoreBatchStep(&batch, list, N_CORES - 1, 1, NULL, true);
+	size_t i;
+	for (i = 0; i < N_CORES; ++i) {
+		assert_int_equal(cores[i].keys, 0);
+		assert_false(cores[i].suppressed);
+	}
+	for (i = 0; i < N_CORES - 1; ++i) {
+		assert_int_equal(cores[i].state.frame, 5);
+		assert_int_equal(cores[i].shownFrames, 2);
+	}
+	assert_int_equal(cores[N_CORES - 1].state.frame, 4);
+	assert_int_equal(cores[N_CORES - 1].shownFrames, 1);
+	mCoreBatchDeinit(&batch);
+}
+
+M_TEST_SUITE_DEFINE(mCoreBatch,
+	cmocka_unit_test(singleThread),
+	cmocka_unit_test(manyThreads),
+	cmocka_unit_test(renderLast))
@@ -0,0 +1,106 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/bitmap-cache.h>
+
+#define WIDTH 4
+#define HEIGHT 3
+#define BACK_BUFFER 0x100
+
+static void _init(struct mBitmapCache* cache, uint16_t* vram, int bpp, bool usesPalette) {
+	mBitmapCacheInit(cache);
+	mBitmapCacheConfigure(cache, mBitmapCacheConfigurationFillShouldStore(0));
+	mBitmapCacheSystemInfo config = mBitmapCacheSystemInfoSetEntryBPP(0, bpp);
+	config = mBitmapCacheSystemInfoSetUsesPalette(config, usesPalette);
+	config = mBitmapCacheSystemInfoSetWidth(config, WIDTH);
+	config = mBitmapCacheSystemInfoSetHeight(config, HEIGHT);
+	config = mBitmapCacheSystemInfoSetBuffers(config, 2);
+	mBitmapCacheConfigureSystem(cache, config);
+	cache->vram = (uint8_t*) vram;
+	cache->bitsStart[0] = 0;
+	cache->bitsStart[1] = BACK_BUFFER;
+	cache->buffer = 0;
+}
+
+M_TEST_DEFINE(onlyWrittenRowsDirty) {
+	struct mBitmapCache cache = { 0 };
+	uint16_t vram[0x100] = { 0 };
+	struct mBitmapCacheEntry entries[HEIGHT * 2] = { { 0 } };
+	_init(&cache, vram, 4, false);
+
+	unsigned y;
+	for (y = 0; y < HEIGHT; ++y) {
+		assert_false(mBitmapCacheCheckRow(&cache, entries, y));
+		mBitmapCacheCleanRow(&cache, entries, y);
+		assert_true(mBitmapCacheCheckRow(&cache, entries, y));
+	}
+
+	vram[WIDTH + 2] = 0x7C1F;
+	mBitmapCacheWriteVRAM(&cache, (WIDTH + 2) * 2);
+	assert_true(mBitmapCacheCheckRow(&cache, entries, 0));
+	assert_false(mBitmapCacheCheckRow(&cache, entries, 1));
+	assert_true(mBitmapCacheCheckRow(&cache, entries, 2));
+
+	mBitmapCacheCleanRow(&cache, entries, 1);
+	assert_true(mBitmapCacheCheckRow(&cache, entries, 1));
+	assert_int_equal(mBitmapCacheGetRow(&cache, 1)[2], mColorFrom555(0x7C1F));
+	assert_int_equal(mBitmapCacheGetRow(&cache, 1)[1], mColorFrom555(0));
+	mBitmapCacheDeinit(&cache);
+}
+
+M_TEST_DEFINE(backBufferWrite) {
+	struct mBitmapCache cache = { 0 };
+	uint16_t vram[0x100] = { 0 };
+	struct mBitmapCacheEntry entries[HEIGHT * 2] = { { 0 } };
+	_init(&cache, vram, 4, false);
+
+	unsigned y;
+	for (y = 0; y < HEIGHT; ++y) {
+		mBitmapCacheCleanRow(&cache, entries, y);
+	}
+	cache.buffer = 1;
+	for (y = 0; y < HEIGHT; ++y) {
+		mBitmapCacheCleanRow(&cache, entries, y);
+	}
+
+	// Drawing the next frame into the buffer that isn't shown leaves the shown one alone
+	vram[(BACK_BUFFER >> 1) + WIDTH * 2] = 0x03E0;
+	mBitmapCacheWriteVRAM(&cache, BACK_BUFFER + WIDTH * 4);
+	cache.buffer = 0;
+	assert_true(mBitmapCacheCheckRow(&cache, entries, 2));
+	cache.buffer = 1;
+	assert_true(mBitmapCacheCheckRow(&cache, entries, 1));
+	assert_false(mBitmapCacheCheckRow(&cache, entries, 2));
+	mBitmapCacheCleanRow(&cache, entries, 2);
+	assert_int_equal(mBitmapCacheGetRow(&cache, 2)[0], mColorFrom555(0x03E0));
+	mBitmapCacheDeinit(&cache);
+}
+
+M_TEST_DEFINE(paletteChange) {
+	struct mBitmapCache cache = { 0 };
+	uint16_t vram[0x100] = { 0 };
+	struct mBitmapCacheEntry entries[HEIGHT * 2] = { { 0 } };
+	_init(&cache, vram, 3, true);
+	((uint8_t*) vram)[WIDTH + 3] = 5;
+
+	unsigned y;
+	for (y = 0; y < HEIGHT; ++y) {
+		mBitmapCacheCleanRow(&cache, entries, y);
+	}
+	mBitmapCacheWritePalette(&cache, 5, 0x1234);
+	for (y = 0; y < HEIGHT; ++y) {
+		assert_false(mBitmapCacheCheckRow(&cache, entries, y));
+	}
+	mBitmapCacheCleanRow(&cache, entries, 1);
+	assert_int_equal(mBitmapCacheGetRow(&cache, 1)[3], 0x1234);
+	mBitmapCacheDeinit(&cache);
+}
+
+M_TEST_SUITE_DEFINE(BitmapCache,
+	cmocka_unit_test(onlyWrittenRowsDirty),
+	cmocka_unit_test(backBufferWrite),
+	cmocka_unit_test(paletteChange))
@@ -0,0 +1,67 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/config.h>
+
+M_TEST_DEFINE(layeredLookup) {
+	struct mCoreConfig config;
+	mCoreConfigInit(&config, "test");
+	int value = 0;
+	assert_false(mCoreConfigGetIntValue(&config, "frameskip", &value));
+	assert_null(mCoreConfigGetValue(&config, "frameskip"));
+
+	mCoreConfigSetDefaultIntValue(&config, "frameskip", 1);
+	assert_true(mCoreConfigGetIntValue(&config, "frameskip", &value));
+	assert_int_equal(value, 1);
+
+	mCoreConfigSetIntValue(&config, "frameskip", 2);
+	assert_true(mCoreConfigGetIntValue(&config, "frameskip", &value));
+	assert_int_equal(value, 2);
+
+	ConfigurationSetIntValue(&config.configTable, "ports.test", "frameskip", 3);
+	assert_true(mCoreConfigGetIntValue(&config, "frameskip", &value));
+	assert_int_equal(value, 3);
+
+	mCoreConfigSetOverrideIntValue(&config, "frameskip", 4);
+	assert_true(mCoreConfigGetIntValue(&config, "frameskip", &value));
+	assert_int_equal(value, 4);
+
+	mCoreConfigSetOverrideValue(&config, "frameskip", NULL);
+	assert_true(mCoreConfigGetIntValue(&config, "frameskip", &value));
+	assert_int_equal(value, 3);
+	mCoreConfigDeinit(&config);
+}
+
+M_TEST_DEFINE(typedLookup) {
+	struct mCoreConfig config;
+	mCoreConfigInit(&config, NULL);
+	mCoreConfigSetValue(&config, "key", "0x20");
+	int intValue = 0;
+	unsigned uintValue = 0;
+	float floatValue = 0;
+	assert_true(mCoreConfigGetIntValue(&config, "key", &intValue));
+	assert_int_equal(intValue, 0x20);
+	assert_false(mCoreConfigGetUIntValue(&config, "key", &uintValue));
+	assert_true(mCoreConfigGetIntValue(&config, "key", &intValue));
+	assert_int_equal(intValue, 0x20);
+
+	mCoreConfigSetValue(&config, "key", "1.5");
+	assert_false(mCoreConfigGetIntValue(&config, "key", &intValue));
+	assert_int_equal(intValue, 0x20);
+	assert_true(mCoreConfigGetFloatValue(&config, "key", &floatValue));
+	assert_true(floatValue == 1.5f);
+	assert_string_equal(mCoreConfigGetValue(&config, "key"), "1.5");
+
+	ConfigurationClearValue(mCoreConfigGetInput(&config), NULL, "key");
+	assert_false(mCoreConfigGetFloatValue(&config, "key", &floatValue));
+	assert_null(mCoreConfigGetValue(&config, "key"));
+	mCoreConfigDeinit(&config);
+}
+
+M_TEST_SUITE_DEFINE(mCoreConfig,
+	cmocka_unit_test(layeredLookup),
+	cmocka_unit_test(typedLookup))
@@ -0,0 +1,212 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/core-pool.h>
+#include <mgba-util/vfs.h>
+#ifdef M_CORE_GB
+#include <mgba/internal/gb/gb.h>
+
+#define ROM_SIZE 0x8000
+#define WRAM_BASE 0xC000
+
+static struct VFile* _makeROM(uint8_t seed) {
+	struct VFile* vf = VFileMemChunk(NULL, ROM_SIZE);
+	GBSynthesizeROM(vf);
+	vf->seek(vf, 0x4000, SEEK_SET);
+	vf->write(vf, &seed, 1);
+	return vf;
+}
+
+static void _put32(uint8_t* out, uint32_t value) {
+	out[0] = value;
+	out[1] = value >> 8;
+	out[2] = value >> 16;
+	out[3] = value >> 24;
+}
+#endif
+
+struct PoolCounts {
+	int setup;
+	int teardown;
+};
+
+static void _setup(struct mCorePool* pool, struct mCore* core) {
+	UNUSED(core);
+	struct PoolCounts* counts = pool->context;
+	++counts->setup;
+}
+
+static void _teardown(struct mCorePool* pool, struct mCore* core) {
+	UNUSED(core);
+	struct PoolCounts* counts = pool->context;
+	++counts->teardown;
+}
+
+M_TEST_DEFINE(resetToBaseline) {
+#ifdef M_CORE_GB
+	struct mCorePool pool;
+	mCorePoolInit(&pool);
+	struct mCore* core = mCorePoolAcquire(&pool, _makeROM(1));
+	assert_non_null(core);
+	uint32_t frame = core->frameCounter(core);
+	uint8_t wram = core->rawRead8(core, WRAM_BASE, -1);
+
+	core->rawWrite8(core, WRAM_BASE, -1, wram ^ 0xFF);
+	core->runFrame(core);
+	core->runFrame(core);
+	assert_int_not_equal(core->frameCounter(core), frame);
+	assert_true(mCorePoolResetCore(&pool, core));
+	assert_int_equal(core->frameCounter(core), frame);
+	assert_int_equal(core->rawRead8(core, WRAM_BASE, -1), wram);
+
+	// Released cores come back already reset, even when the ROM is opened again
+	core->rawWrite8(core, WRAM_BASE, -1, wram ^ 0xFF);
+	mCorePoolRelease(&pool, core);
+	struct mCore* again = mCorePoolAcquire(&pool, _makeROM(1));
+	assert_ptr_equal(again, core);
+	assert_int_equal(core->rawRead8(core, WRAM_BASE, -1), wram);
+	mCorePoolRelease(&pool, again);
+	mCorePoolDeinit(&pool);
+#endif
+}
+
+M_TEST_DEFINE(coresPerROM) {
+#ifdef M_CORE_GB
+	struct PoolCounts counts = { 0 };
+	struct mCorePool pool;
+	mCorePoolInit(&pool);
+	pool.setup = _setup;
+	pool.teardown = _teardown;
+	pool.context = &counts;
+	pool.maxIdle = 1;
+
+	struct mCore* a = mCorePoolAcquire(&pool, _makeROM(1));
+	struct mCore* b = mCorePoolAcquire(&pool, _makeROM(1));
+	struct mCore* c = mCorePoolAcquire(&pool, _makeROM(2));
+	assert_non_null(a);
+	assert_non_null(b);
+	assert_non_null(c);
+	assert_ptr_not_equal(a, b);
+	assert_int_equal(counts.setup, 3);
+
+	uint32_t crc32;
+	a->checksum(a, &crc32, CHECKSUM_CRC32);
+	assert_null(mCorePoolAcquireCRC32(&pool, crc32 + 1));
+
+	// Only one idle core is kept per ROM
+	mCorePoolRelease(&pool, a);
+	mCorePoolRelease(&pool, b);
+	assert_int_equal(counts.teardown, 1);
+	struct mCore* d = mCorePoolAcquireCRC32(&pool, crc32);
+	assert_ptr_equal(d, a);
+	assert_int_equal(counts.setup, 3);
+
+	mCorePoolRelease(&pool, c);
+	mCorePoolRelease(&pool, d);
+	mCorePoolDeinit(&pool);
+	assert_int_equal(counts.teardown, 3);
+#endif
+}
+
+M_TEST_DEFINE(hibernateAndWake) {
+#ifdef M_CORE_GB
+	struct mCorePool pool;
+	mCorePoolInit(&pool);
+	struct mCore* core = mCorePoolAcquire(&pool, _makeROM(1));
+	assert_non_null(core);
+	uint8_t wram = core->rawRead8(core, WRAM_BASE, -1);
+	core->rawWrite8(core, WRAM_BASE, -1, wram ^ 0x5A);
+	core->runFrame(core);
+	core->runFrame(core);
+	uint32_t frame = core->frameCounter(core);
+
+	struct mCoreHibernation* hibernation = mCorePoolHibernate(&pool, core);
+	assert_non_null(hibernation);
+	assert_true(mCoreHibernationSize(hibernation) < core->stateSize(core) / 4);
+
+	// The core went back to the pool, so whoever acquires next gets it, reset
+	struct mCore* other = mCorePoolAcquire(&pool, _makeROM(1));
+	assert_ptr_equal(other, core);
+	assert_int_equal(other->rawRead8(other, WRAM_BASE, -1), wram);
+
+	// Round trip through a file as well, and wake into a newly created core
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mCoreHibernationSave(hibernation, vf));
+	mCoreHibernationFree(hibernation);
+	vf->seek(vf, 0, SEEK_SET);
+	hibernation = mCoreHibernationLoad(vf);
+	vf->close(vf);
+	assert_non_null(hibernation);
+
+	struct mCore* woken = mCorePoolWake(&pool, hibernation);
+	assert_non_null(woken);
+	assert_ptr_not_equal(woken, other);
+	assert_int_equal(woken->frameCounter(woken), frame);
+	assert_int_equal(woken->rawRead8(woken, WRAM_BASE, -1), wram ^ 0x5A);
+
+	mCorePoolRelease(&pool, other);
+	mCorePoolRelease(&pool, woken);
+	mCorePoolDeinit(&pool);
+#endif
+}
+
+M_TEST_DEFINE(hibernationCorrupt) {
+#ifdef M_CORE_GB
+	struct mCorePool pool;
+	mCorePoolInit(&pool);
+	struct mCore* core = mCorePoolAcquire(&pool, _makeROM(1));
+	assert_non_null(core);
+	core->runFrame(core);
+	uint32_t stateSize = core->stateSize(core);
+	struct mCoreHibernation* hibernation = mCorePoolHibernate(&pool, core);
+	assert_non_null(hibernation);
+	uint32_t crc32 = mCoreHibernationCRC32(hibernation);
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mCoreHibernationSave(hibernation, vf));
+	mCoreHibernationFree(hibernation);
+
+	// Cut off partway through the state
+	vf->truncate(vf, vf->size(vf) - 4);
+	vf->seek(vf, 0, SEEK_SET);
+	assert_null(mCoreHibernationLoad(vf));
+	vf->close(vf);
+
+	// A run that claims to go past the end of the state
+	uint8_t file[32];
+	_put32(&file[0], 0x4249484D);
+	_put32(&file[4], crc32);
+	_put32(&file[8], stateSize);
+	_put32(&file[12], 8);
+	_put32(&file[16], 0);
+	_put32(&file[20], 0);
+	_put32(&file[24], stateSize);
+	_put32(&file[28], 1);
+	vf = VFileFromConstMemory(file, sizeof(file));
+	hibernation = mCoreHibernationLoad(vf);
+	vf->close(vf);
+	assert_non_null(hibernation);
+	assert_null(mCorePoolWake(&pool, hibernation));
+	mCorePoolDeinit(&pool);
+#endif
+}
+
+M_TEST_DEFINE(unloadable) {
+	struct mCorePool pool;
+	mCorePoolInit(&pool);
+	assert_null(mCorePoolAcquire(&pool, NULL));
+	assert_null(mCorePoolAcquire(&pool, VFileMemChunk(NULL, 0)));
+	assert_null(mCorePoolAcquireCRC32(&pool, 0));
+	mCorePoolDeinit(&pool);
+}
+
+M_TEST_SUITE_DEFINE(mCorePool,
+	cmocka_unit_test(resetToBaseline),
+	cmocka_unit_test(coresPerROM),
+	cmocka_unit_test(hibernateAndWake),
+	cmocka_unit_test(hibernationCorrupt),
+	cmocka_unit_test(unloadable))
@@ -6,6 +6,7 @@
 #include "util/test/suite.h"
 
 #include <mgba/core/core.h>
+#include <mgba-util/crc32.h>
 #include <mgba-util/vfs.h>
 
 #if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
@@ -28,9 +29,93 @@ M_TEST_DEFINE(findEmpty) {
 	vf->close(vf);
 }
 
+M_TEST_DEFINE(identifyEmpty) {
+	struct mCoreRomInfo info;
+	assert_false(mCoreIdentifyVF(NULL, &info));
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_non_null(vf);
+	assert_false(mCoreIdentifyVF(vf, &info));
+	assert_int_equal(info.platform, PLATFORM_NONE);
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(identifyGBA) {
+#ifdef M_CORE_GBA
+	uint8_t rom[0x400] = { 0 };
+	rom[0x3] = 0xEA;
+	rom[0xB2] = 0x96;
+	memcpy(&rom[0xA0], "IDENTIFY", 8);
+	memcpy(&rom[0xAC], "TEST", 4);
+	size_t i;
+	for (i = 0xC0; i < sizeof(rom); ++i) {
+		rom[i] = i * 7;
+	}
+
+	struct mCoreRomInfo info;
+	struct VFile* vf = VFileFromConstMemory(rom, sizeof(rom));
+	assert_true(mCoreIdentifyVF(vf, &info));
+	vf->close(vf);
+	assert_int_equal(info.platform, PLATFORM_GBA);
+	assert_string_equal(info.title, "IDENTIFY");
+	assert_string_equal(info.code, "AGB-TEST");
+	assert_int_equal(info.size, sizeof(rom));
+
+	vf = VFileFromConstMemory(rom, sizeof(rom));
+	struct mCore* core = mCoreFindVF(vf);
+	vf->close(vf);
+	assert_non_null(core);
+	assert_true(core->init(core));
+	assert_true(core->loadROM(core, VFileFromConstMemory(rom, sizeof(rom))));
+	char title[17] = { 0 };
+	char code[9] = { 0 };
+	uint32_t crc32;
+	core->getGameTitle(core, title);
+	core->getGameCode(core, code);
+	core->checksum(core, &crc32, CHECKSUM_CRC32);
+	assert_string_equal(title, info.title);
+	assert_string_equal(code, info.code);
+	assert_int_equal(crc32, info.crc32);
+	core->deinit(core);
+#endif
+}
+
+M_TEST_DEFINE(checksumAfterWrite) {
+#ifdef M_CORE_GBA
+	uint8_t rom[0x400] = { 0 };
+	rom[0x3] = 0xEA;
+	rom[0xB2] = 0x96;
+	size_t i;
+	for (i = 0xC0; i < sizeof(rom); ++i) {
+		rom[i] = i * 13;
+	}
+	uint32_t expected = doCrc32(rom, sizeof(rom));
+
+	struct VFile* vf = VFileFromConstMemory(rom, sizeof(rom));
+	struct mCore* core = mCoreFindVF(vf);
+	vf->close(vf);
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	assert_true(core->loadROM(core, VFileFromConstMemory(rom, sizeof(rom))));
+	core->reset(core);
+
+	// Writing to the ROM copies it, and the checksum must still describe the original
+	core->rawWrite8(core, 0x08000200, -1, 0x55);
+	assert_int_equal(core->rawRead8(core, 0x08000200, -1), 0x55);
+	uint32_t crc32;
+	core->checksum(core, &crc32, CHECKSUM_CRC32);
+	assert_int_equal(crc32, expected);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+#endif
+}
+
 M_TEST_SUITE_DEFINE(mCore,
 #if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
 	cmocka_unit_test(findNullPath),
 #endif
 	cmocka_unit_test(findNullVF),
-	cmocka_unit_test(findEmpty))
+	cmocka_unit_test(findEmpty),
+	cmocka_unit_test(identifyEmpty),
+	cmocka_unit_test(identifyGBA),
+	cmocka_unit_test(checksumAfterWrite))
@@ -0,0 +1,147 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/lockstep-link.h>
+
+#define BASE_PORT 0x7A10
+#define MAX_PORTS 32
+
+static bool _connectPair(struct mLockstepLink* a, struct mLockstepLink* b) {
+	struct Address localhost = {
+		.version = IPV4,
+		.ipv4 = 0x7F000001
+	};
+	Socket server = INVALID_SOCKET;
+	int port;
+	for (port = BASE_PORT; port < BASE_PORT + MAX_PORTS; ++port) {
+		server = SocketOpenTCP(port, &localhost);
+		if (!SOCKET_FAILED(server)) {
+			break;
+		}
+	}
+	if (SOCKET_FAILED(server) || SOCKET_FAILED(SocketListen(server, 1))) {
+		return false;
+	}
+	Socket client = SocketConnectTCP(port, &localhost);
+	Socket accepted = SocketAccept(server, NULL);
+	SocketClose(server);
+	mLockstepLinkInit(a, client);
+	mLockstepLinkInit(b, accepted);
+	return !a->failed && !b->failed;
+}
+
+static void _pollUntil(struct mLockstepLink* link, uint64_t frames) {
+	int tries;
+	for (tries = 0; tries < 100 && link->stats.framesReceived < frames; ++tries) {
+		assert_true(mLockstepLinkPoll(link, 10));
+	}
+	assert_true(link->stats.framesReceived >= frames);
+}
+
+M_TEST_SUITE_SETUP(mLockstepLink) {
+	SocketSubsystemInit();
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(mLockstepLink) {
+	SocketSubsystemDeinit();
+	return 0;
+}
+
+M_TEST_DEFINE(batchedEvents) {
+	struct mLockstepLink a;
+	struct mLockstepLink b;
+	assert_true(_connectPair(&a, &b));
+	a.lookahead = 1000;
+	b.lookahead = 1000;
+
+	int i;
+	for (i = 0; i < 100; ++i) {
+		struct mLockstepLinkEvent event = {
+			.when = 2000 + i * 10,
+			.type = 1,
+			.player = 0,
+			.data = 0x10000 + i
+		};
+		assert_true(mLockstepLinkQueue(&a, &event));
+	}
+	// The first batch fills up and goes out on its own
+	assert_int_equal(a.stats.framesSent, 1);
+	assert_true(mLockstepLinkFlush(&a, 1500));
+	assert_int_equal(a.stats.framesSent, 2);
+	assert_int_equal(a.stats.eventsSent, 100);
+	// Nothing changed, so nothing is sent
+	assert_true(mLockstepLinkFlush(&a, 1500));
+	assert_int_equal(a.stats.framesSent, 2);
+
+	_pollUntil(&b, 2);
+	assert_int_equal(b.stats.eventsReceived, 100);
+	assert_int_equal(b.remoteHorizon, 1500);
+
+	struct mLockstepLinkEvent event;
+	assert_false(mLockstepLinkNextEvent(&b, 1999, &event));
+	assert_int_equal(mLockstepLinkBudget(&b, 1900), 100);
+	for (i = 0; i < 100; ++i) {
+		assert_true(mLockstepLinkNextEvent(&b, 2000 + i * 10, &event));
+		assert_int_equal(event.when, 2000 + i * 10);
+		assert_int_equal(event.data, 0x10000 + i);
+	}
+	assert_false(mLockstepLinkNextEvent(&b, 10000, &event));
+	// With no pending events, only the remote horizon limits how far ahead this side can run
+	assert_int_equal(mLockstepLinkBudget(&b, 2000), 500);
+	assert_int_equal(mLockstepLinkBudget(&b, 3000), 0);
+
+	mLockstepLinkDeinit(&a);
+	mLockstepLinkDeinit(&b);
+}
+
+M_TEST_DEFINE(roundTrip) {
+	struct mLockstepLink a;
+	struct mLockstepLink b;
+	assert_true(_connectPair(&a, &b));
+	b.lookahead = 200;
+
+	// The first flush carries a ping, which the other side answers when it polls
+	assert_true(mLockstepLinkFlush(&a, 100));
+	_pollUntil(&b, 1);
+	_pollUntil(&a, 1);
+	assert_int_equal(a.stats.rttSamples, 1);
+	assert_int_equal(mLockstepLinkAverageRtt(&a.stats), a.stats.lastRtt);
+	assert_true(a.stats.minRtt <= a.stats.maxRtt);
+
+	assert_true(mLockstepLinkFlush(&a, 1000));
+	assert_true(mLockstepLinkWaitUntil(&b, 1200, 1000));
+	assert_false(mLockstepLinkWaitUntil(&b, 1201, 20));
+	assert_int_equal(b.remoteHorizon, 1000);
+
+	mLockstepLinkDeinit(&a);
+	assert_false(mLockstepLinkWaitUntil(&b, 5000, 1000));
+	assert_true(b.failed);
+	mLockstepLinkDeinit(&b);
+}
+
+M_TEST_DEFINE(horizonWraps) {
+	struct mLockstepLink a;
+	struct mLockstepLink b;
+	assert_true(_connectPair(&a, &b));
+	a.localHorizon = 0xFFFFFF00;
+	b.remoteHorizon = 0xFFFFFF00;
+	b.lookahead = 0x200;
+
+	assert_true(mLockstepLinkFlush(&a, 0x80));
+	_pollUntil(&b, 1);
+	assert_int_equal(b.remoteHorizon, 0x80);
+	assert_int_equal(mLockstepLinkBudget(&b, 0xFFFFFFF0), 0x290);
+
+	mLockstepLinkDeinit(&a);
+	mLockstepLinkDeinit(&b);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mLockstepLink,
+	cmocka_unit_test(batchedEvents),
+	cmocka_unit_test(roundTrip),
+	cmocka_unit_test(horizonWraps))
@@ -0,0 +1,98 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/log.h>
+
+#define MAX_MESSAGES 32
+
+mLOG_DEFINE_CATEGORY(TEST, "Test", "test.log")
+
+struct TestLogger {
+	struct mLogger d;
+	int nMessages;
+	enum mLogLevel levels[MAX_MESSAGES];
+	char messages[MAX_MESSAGES][64];
+};
+
+static void _collect(struct mLogger* log, int category, enum mLogLevel level, const char* format, va_list args) {
+	UNUSED(category);
+	struct TestLogger* logger = (struct TestLogger*) log;
+	if (logger->nMessages >= MAX_MESSAGES) {
+		return;
+	}
+	logger->levels[logger->nMessages] = level;
+	vsnprintf(logger->messages[logger->nMessages], sizeof(logger->messages[0]), format, args);
+	++logger->nMessages;
+}
+
+static void _log(struct mLogger* logger, enum mLogLevel level, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	logger->log(logger, _mLOG_CAT_TEST, level, format, args);
+	va_end(args);
+}
+
+M_TEST_DEFINE(filterLevels) {
+	struct mLogFilter filter;
+	mLogFilterInit(&filter);
+	filter.defaultLevels = mLOG_ALL & ~mLOG_DEBUG;
+	assert_true(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_INFO));
+	assert_false(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_DEBUG));
+
+	mLogFilterSet(&filter, "test.log", mLOG_DEBUG);
+	assert_true(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_DEBUG));
+	assert_false(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_INFO));
+	assert_true(mLogFilterTest(&filter, _mLOG_CAT_STATUS, mLOG_INFO));
+
+	mLogFilterReset(&filter, "test.log");
+	assert_true(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_INFO));
+	assert_false(mLogFilterTest(&filter, _mLOG_CAT_TEST, mLOG_DEBUG));
+	mLogFilterDeinit(&filter);
+}
+
+M_TEST_DEFINE(asyncOrder) {
+	struct TestLogger backend = { .d = { .log = _collect } };
+	struct mLogger* logger = mAsyncLoggerCreate(&backend.d);
+	_log(logger, mLOG_INFO, "first %i", 1);
+	_log(logger, mLOG_WARN, "second %s", "message");
+	_log(logger, mLOG_INFO, "first %i", 3);
+	mAsyncLoggerFlush(logger);
+	assert_int_equal(backend.nMessages, 3);
+	assert_string_equal(backend.messages[0], "first 1");
+	assert_string_equal(backend.messages[1], "second message");
+	assert_int_equal(backend.levels[1], mLOG_WARN);
+	assert_string_equal(backend.messages[2], "first 3");
+
+	_log(logger, mLOG_FATAL, "fatal");
+	assert_int_equal(backend.nMessages, 4);
+	assert_string_equal(backend.messages[3], "fatal");
+	mAsyncLoggerDestroy(logger);
+}
+
+M_TEST_DEFINE(asyncRepeats) {
+	struct TestLogger backend = { .d = { .log = _collect } };
+	struct mLogger* logger = mAsyncLoggerCreate(&backend.d);
+	int i;
+	for (i = 0; i < 100; ++i) {
+		_log(logger, mLOG_GAME_ERROR, "spam %i", i);
+	}
+	_log(logger, mLOG_INFO, "done");
+	mAsyncLoggerDestroy(logger);
+
+	assert_true(backend.nMessages > 2);
+	assert_true(backend.nMessages < 20);
+	assert_string_equal(backend.messages[0], "spam 0");
+	assert_string_equal(backend.messages[backend.nMessages - 1], "done");
+	int skipped;
+	assert_int_equal(sscanf(backend.messages[backend.nMessages - 2], "Last message repeated %i more times", &skipped), 1);
+	assert_int_equal(skipped + backend.nMessages - 2, 100);
+}
+
+M_TEST_SUITE_DEFINE(mLog,
+	cmocka_unit_test(filterLevels),
+	cmocka_unit_test(asyncOrder),
+	cmocka_unit_test(asyncRepeats))
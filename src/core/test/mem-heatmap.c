@@ -0,0 +1,79 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/mem-heatmap.h>
+
+#include <mgba-util/vfs.h>
+
+M_TEST_DEFINE(pages) {
+	struct mMemoryHeatmap heatmap;
+	mMemoryHeatmapInit(&heatmap);
+	mMemoryHeatmapReset(&heatmap, 10);
+	assert_ptr_equal(mMemoryHeatmapGetPage(&heatmap, 0x02000000), mMemoryHeatmapGetPage(&heatmap, 0x02000FFF));
+	assert_ptr_not_equal(mMemoryHeatmapGetPage(&heatmap, 0x02000000), mMemoryHeatmapGetPage(&heatmap, 0x02001000));
+	// The top nybble is past what any core decodes, so it wraps
+	assert_ptr_equal(mMemoryHeatmapGetPage(&heatmap, 0x13000000), mMemoryHeatmapGetPage(&heatmap, 0x03000000));
+
+	mMemoryHeatmapGetPage(&heatmap, 0x02000010)->accesses[mMEMORY_HEATMAP_READ] += 3;
+	mMemoryHeatmapGetPage(&heatmap, 0x02000010)->cycles[mMEMORY_HEATMAP_READ] += 9;
+	mMemoryHeatmapGetPage(&heatmap, 0x02001010)->accesses[mMEMORY_HEATMAP_WRITE] += 2;
+	mMemoryHeatmapGetPage(&heatmap, 0x02002000)->accesses[mMEMORY_HEATMAP_EXECUTE] += 1;
+
+	struct mMemoryHeatmapPage sum;
+	mMemoryHeatmapSum(&heatmap, 0x02000000, 2, &sum);
+	assert_int_equal(sum.accesses[mMEMORY_HEATMAP_READ], 3);
+	assert_int_equal(sum.cycles[mMEMORY_HEATMAP_READ], 9);
+	assert_int_equal(sum.accesses[mMEMORY_HEATMAP_WRITE], 2);
+	assert_int_equal(sum.accesses[mMEMORY_HEATMAP_EXECUTE], 0);
+
+	// Sums stop at the end of the map instead of wrapping
+	mMemoryHeatmapSum(&heatmap, 0x0FFFF000, 4, &sum);
+	assert_int_equal(sum.accesses[mMEMORY_HEATMAP_READ], 0);
+
+	mMemoryHeatmapReset(&heatmap, 20);
+	mMemoryHeatmapSum(&heatmap, 0x02000000, 3, &sum);
+	assert_int_equal(sum.accesses[mMEMORY_HEATMAP_READ], 0);
+	assert_int_equal(sum.accesses[mMEMORY_HEATMAP_WRITE], 0);
+	assert_int_equal(sum.accesses[mMEMORY_HEATMAP_EXECUTE], 0);
+	assert_int_equal(heatmap.firstFrame, 20);
+	mMemoryHeatmapDeinit(&heatmap);
+}
+
+M_TEST_DEFINE(dump) {
+	struct mMemoryHeatmap heatmap;
+	mMemoryHeatmapInit(&heatmap);
+	mMemoryHeatmapReset(&heatmap, 5);
+	mMemoryHeatmapMarkFrame(&heatmap, 65);
+	struct mMemoryHeatmapPage* page = mMemoryHeatmapGetPage(&heatmap, 0x08000100);
+	page->accesses[mMEMORY_HEATMAP_EXECUTE] = 100;
+	page->cycles[mMEMORY_HEATMAP_EXECUTE] = 400;
+	page = mMemoryHeatmapGetPage(&heatmap, 0x03007F00);
+	page->accesses[mMEMORY_HEATMAP_READ] = 1;
+	page->accesses[mMEMORY_HEATMAP_WRITE] = 2;
+	page->cycles[mMEMORY_HEATMAP_WRITE] = 2;
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mMemoryHeatmapDump(&heatmap, vf));
+	size_t size = vf->size(vf);
+	char* csv = calloc(size + 1, 1);
+	vf->seek(vf, 0, SEEK_SET);
+	vf->read(vf, csv, size);
+	vf->close(vf);
+
+	assert_string_equal(csv,
+		"first_frame,last_frame\n"
+		"5,65\n"
+		"address,reads,writes,executes,read_cycles,write_cycles,execute_cycles\n"
+		"0x03007000,1,2,0,0,2,0\n"
+		"0x08000000,0,0,100,0,0,400\n");
+	free(csv);
+	mMemoryHeatmapDeinit(&heatmap);
+}
+
+M_TEST_SUITE_DEFINE(mMemoryHeatmap,
+	cmocka_unit_test(pages),
+	cmocka_unit_test(dump))
@@ -0,0 +1,129 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+#include "core/test/test-core.h"
+
+#include <mgba/core/mem-probe.h>
+
+#define RAM_SIZE 0x100
+#define ROM_SIZE 0x80
+
+static uint8_t _ram[RAM_SIZE];
+static uint8_t _rom[ROM_SIZE];
+static uint8_t _banks[2][RAM_SIZE];
+
+static const struct mCoreMemoryBlock _blocks[] = {
+	{ -1, "mem", "All", "All", 0, 0x10000000, 0x10000000, mCORE_MEMORY_VIRTUAL, 0, 0 },
+	{ 0, "ram", "RAM", "RAM", 0x02000000, 0x02000000 + RAM_SIZE, RAM_SIZE, mCORE_MEMORY_RW | mCORE_MEMORY_MAPPED, 0, 0 },
+	{ 1, "banked", "Banked", "Banked", 0x03000000, 0x03000000 + RAM_SIZE, RAM_SIZE * 2, mCORE_MEMORY_RW | mCORE_MEMORY_MAPPED, 1, 0x03000080 },
+	// Bigger than the ROM that is loaded into it
+	{ 2, "rom", "ROM", "ROM", 0x08000000, 0x08000000 + ROM_SIZE * 2, ROM_SIZE * 2, mCORE_MEMORY_READ | mCORE_MEMORY_MAPPED, 0, 0 },
+};
+
+M_TEST_SUITE_SETUP(MemoryProbe) {
+	static struct TestCore core;
+	TestCoreInit(&core);
+	core.blocks = _blocks;
+	core.nBlocks = sizeof(_blocks) / sizeof(*_blocks);
+	TestCoreMapBlock(&core, 1, _ram, sizeof(_ram));
+	TestCoreMapBlock(&core, 2, _banks, sizeof(_banks));
+	TestCoreMapBlock(&core, 3, _rom, sizeof(_rom));
+	size_t i;
+	for (i = 0; i < RAM_SIZE; ++i) {
+		_ram[i] = i;
+		_banks[0][i] = i ^ 0x55;
+		_banks[1][i] = i ^ 0xAA;
+	}
+	for (i = 0; i < ROM_SIZE; ++i) {
+		_rom[i] = ~i;
+	}
+	*state = &core;
+	return 0;
+}
+
+M_TEST_DEFINE(matchesBus) {
+	struct TestCore* test = *state;
+	struct mCore* core = &test->d;
+	static const struct {
+		uint32_t address;
+		int width;
+	} probes[] = {
+		{ 0x02000000, 1 },
+		{ 0x02000010, 2 },
+		{ 0x020000FC, 4 },
+		{ 0x02000011, 2 },
+		{ 0x03000010, 4 },
+		{ 0x03000090, 4 },
+		{ 0x0800007C, 4 },
+		{ 0x08000080, 2 },
+		{ 0x05000000, 1 },
+	};
+	struct mCoreMemoryProbeList list;
+	mCoreMemoryProbeListInit(&list, core);
+	size_t i;
+	for (i = 0; i < sizeof(probes) / sizeof(*probes); ++i) {
+		assert_int_equal(mCoreMemoryProbeListAdd(&list, probes[i].address, probes[i].width), i);
+	}
+
+	uint32_t values[sizeof(probes) / sizeof(*probes)];
+	int bank;
+	for (bank = 0; bank < 2; ++bank) {
+		test->segment = bank;
+		mCoreMemoryProbeListRead(&list, values);
+		for (i = 0; i < sizeof(probes) / sizeof(*probes); ++i) {
+			uint32_t expected;
+			switch (probes[i].width) {
+			case 1:
+				expected = core->busRead8(core, probes[i].address);
+				break;
+			case 2:
+				expected = core->busRead16(core, probes[i].address);
+				break;
+			default:
+				expected = core->busRead32(core, probes[i].address);
+				break;
+			}
+			assert_int_equal(values[i], expected);
+		}
+	}
+	test->segment = 0;
+	mCoreMemoryProbeListDeinit(&list);
+}
+
+M_TEST_DEFINE(directReads) {
+	struct TestCore* test = *state;
+	struct mCore* core = &test->d;
+	struct mCoreMemoryProbeList list;
+	mCoreMemoryProbeListInit(&list, core);
+	uint32_t address;
+	for (address = 0x02000000; address < 0x02000000 + RAM_SIZE; address += 4) {
+		mCoreMemoryProbeListAdd(&list, address, 4);
+	}
+	// Below where the banks start
+	mCoreMemoryProbeListAdd(&list, 0x03000040, 2);
+	mCoreMemoryProbeListAdd(&list, 0x08000000, 1);
+
+	uint32_t values[RAM_SIZE / 4 + 2];
+	test->busReads = 0;
+	mCoreMemoryProbeListRead(&list, values);
+	assert_int_equal(test->busReads, 0);
+	assert_int_equal(values[1], 0x07060504);
+	assert_int_equal(values[RAM_SIZE / 4], 0x4140 ^ 0x5555);
+	assert_int_equal(values[RAM_SIZE / 4 + 1], 0xFF);
+
+	// The banked half, misaligned probes and anything past what's loaded go through the bus
+	mCoreMemoryProbeListClear(&list);
+	mCoreMemoryProbeListAdd(&list, 0x03000080, 1);
+	mCoreMemoryProbeListAdd(&list, 0x02000001, 4);
+	mCoreMemoryProbeListAdd(&list, 0x08000080, 1);
+	mCoreMemoryProbeListRead(&list, values);
+	assert_int_equal(test->busReads, 3);
+	mCoreMemoryProbeListDeinit(&list);
+}
+
+M_TEST_SUITE_DEFINE_SETUP(MemoryProbe,
+	cmocka_unit_test(matchesBus),
+	cmocka_unit_test(directReads))
@@ -0,0 +1,266 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+#include "core/test/test-core.h"
+
+#include <mgba/core/mem-search.h>
+
+#define SMALL_SIZE 0x105
+#define LARGE_SIZE 0x100022
+
+static uint8_t _small[SMALL_SIZE + 3];
+static uint8_t _large[LARGE_SIZE + 2];
+
+static const struct mCoreMemoryBlock _blocks[] = {
+	{ 0, "small", "Small", "Small", 0x02000000, 0x02000000 + SMALL_SIZE, SMALL_SIZE, mCORE_MEMORY_RW | mCORE_MEMORY_MAPPED, 0, 0 },
+	{ 1, "large", "Large", "Large", 0x08000000, 0x08000000 + LARGE_SIZE, LARGE_SIZE, mCORE_MEMORY_READ | mCORE_MEMORY_MAPPED, 0, 0 },
+};
+
+static void _fill(uint8_t* mem, size_t size, uint32_t seed) {
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		seed = seed * 1103515245 + 12345;
+		mem[i] = seed >> 16;
+	}
+	// Plant some full-width matches, including near the ends of the blocks
+	STORE_32LE(0x12345678, 0x40, mem);
+	STORE_32LE(0x12345678, size & ~3, mem);
+	STORE_32LE(0x12345678, (size & ~3) - 4, mem);
+	memcpy(&mem[size - 9], "mGBA", 4);
+	memcpy(&mem[size - 4], "mGBA", 4);
+	memcpy(&mem[0x13], "mGBA", 4);
+}
+
+M_TEST_SUITE_SETUP(MemorySearch) {
+	static struct TestCore core;
+	TestCoreInit(&core);
+	core.blocks = _blocks;
+	core.nBlocks = sizeof(_blocks) / sizeof(*_blocks);
+	TestCoreMapBlock(&core, 0, _small, SMALL_SIZE);
+	TestCoreMapBlock(&core, 1, _large, LARGE_SIZE);
+	_fill(_small, SMALL_SIZE, 1);
+	_fill(_large, LARGE_SIZE, 2);
+	*state = &core.d;
+	return 0;
+}
+
+static bool _referenceOp(uint32_t value, const struct mCoreMemorySearchParams* params) {
+	uint32_t match = params->valueInt;
+	if (params->width < 4) {
+		match &= (1 << (params->width * 8)) - 1;
+	} else {
+		// 32-bit values compare signed
+		value ^= 0x80000000;
+		match ^= 0x80000000;
+	}
+	switch (params->op) {
+	case mCORE_MEMORY_SEARCH_GREATER:
+		return value > match;
+	case mCORE_MEMORY_SEARCH_LESS:
+		return value < match;
+	default:
+		return value == match;
+	}
+}
+
+static void _referenceSearch(const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* out, size_t limit) {
+	size_t b;
+	for (b = 0; b < sizeof(_blocks) / sizeof(*_blocks); ++b) {
+		if (!(_blocks[b].flags & params->memoryFlags)) {
+			continue;
+		}
+		const uint8_t* mem = b ? _large : _small;
+		size_t size = _blocks[b].size;
+		size_t i;
+		if (params->type == mCORE_MEMORY_SEARCH_STRING) {
+			size_t len = strlen(params->valueStr);
+			for (i = 0; i < size - len; ++i) {
+				if (limit && mCoreMemorySearchResultsSize(out) >= limit) {
+					return;
+				}
+				if (!memcmp(&mem[i], params->valueStr, len)) {
+					mCoreMemorySearchResultsAppend(out)->address = _blocks[b].start + i;
+				}
+			}
+			continue;
+		}
+		for (i = 0; i < size; i += params->width) {
+			if (limit && mCoreMemorySearchResultsSize(out) >= limit) {
+				return;
+			}
+			uint32_t value;
+			switch (params->width) {
+			case 1:
+				value = mem[i];
+				break;
+			case 2:
+				LOAD_16LE(value, i, mem);
+				break;
+			default:
+				LOAD_32LE(value, i, mem);
+				break;
+			}
+			if (_referenceOp(value, params)) {
+				mCoreMemorySearchResultsAppend(out)->address = _blocks[b].start + i;
+			}
+		}
+	}
+}
+
+static void _compareSearch(struct mCore* core, const struct mCoreMemorySearchParams* params, size_t limit) {
+	struct mCoreMemorySearchResults expected;
+	struct mCoreMemorySearchResults results;
+	mCoreMemorySearchResultsInit(&expected, 0);
+	mCoreMemorySearchResultsInit(&results, 0);
+	_referenceSearch(params, &expected, limit);
+	mCoreMemorySearch(core, params, &results, limit);
+
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), mCoreMemorySearchResultsSize(&expected));
+	size_t i;
+	for (i = 0; i < mCoreMemorySearchResultsSize(&results); ++i) {
+		const struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsGetConstPointer(&results, i);
+		assert_int_equal(res->address, mCoreMemorySearchResultsGetConstPointer(&expected, i)->address);
+		assert_int_equal(res->type, params->type);
+		if (params->type == mCORE_MEMORY_SEARCH_INT) {
+			assert_int_equal(res->width, params->width);
+			assert_int_equal(res->oldValue, params->valueInt);
+		}
+	}
+	mCoreMemorySearchResultsDeinit(&expected);
+	mCoreMemorySearchResultsDeinit(&results);
+}
+
+static void _compareInt(struct mCore* core, int width, enum mCoreMemorySearchOp op, int32_t value) {
+	struct mCoreMemorySearchParams params = {
+		.memoryFlags = mCORE_MEMORY_READ,
+		.type = mCORE_MEMORY_SEARCH_INT,
+		.op = op,
+		.align = width,
+		.width = width,
+		.valueInt = value,
+	};
+	_compareSearch(core, &params, 0);
+	_compareSearch(core, &params, 1);
+	_compareSearch(core, &params, 77);
+	_compareSearch(core, &params, 10000);
+}
+
+M_TEST_DEFINE(searchInt8) {
+	_compareInt(*state, 1, mCORE_MEMORY_SEARCH_EQUAL, 0x78);
+	_compareInt(*state, 1, mCORE_MEMORY_SEARCH_GREATER, 0xFD);
+	_compareInt(*state, 1, mCORE_MEMORY_SEARCH_LESS, 0x02);
+	_compareInt(*state, 1, mCORE_MEMORY_SEARCH_GREATER, 0x7F);
+}
+
+M_TEST_DEFINE(searchInt16) {
+	_compareInt(*state, 2, mCORE_MEMORY_SEARCH_EQUAL, 0x5678);
+	_compareInt(*state, 2, mCORE_MEMORY_SEARCH_GREATER, 0xFFF0);
+	_compareInt(*state, 2, mCORE_MEMORY_SEARCH_LESS, 0x0010);
+	_compareInt(*state, 2, mCORE_MEMORY_SEARCH_LESS, 0x8001);
+}
+
+M_TEST_DEFINE(searchInt32) {
+	_compareInt(*state, 4, mCORE_MEMORY_SEARCH_EQUAL, 0x12345678);
+	_compareInt(*state, 4, mCORE_MEMORY_SEARCH_GREATER, 0x7FF00000);
+	_compareInt(*state, 4, mCORE_MEMORY_SEARCH_LESS, -0x7FF00000);
+	_compareInt(*state, 4, mCORE_MEMORY_SEARCH_GREATER, -5);
+}
+
+M_TEST_DEFINE(searchString) {
+	struct mCoreMemorySearchParams params = {
+		.memoryFlags = mCORE_MEMORY_READ,
+		.type = mCORE_MEMORY_SEARCH_STRING,
+		.op = mCORE_MEMORY_SEARCH_EQUAL,
+		.align = -1,
+		.width = 4,
+		.valueStr = "mGBA",
+	};
+	_compareSearch(*state, &params, 0);
+	_compareSearch(*state, &params, 3);
+
+	params.width = 1;
+	params.valueStr = "m";
+	_compareSearch(*state, &params, 0);
+	_compareSearch(*state, &params, 500);
+}
+
+static bool _hasAddress(const struct mCoreMemorySearchResults* results, uint32_t address) {
+	size_t i;
+	for (i = 0; i < mCoreMemorySearchResultsSize(results); ++i) {
+		if (mCoreMemorySearchResultsGetConstPointer(results, i)->address == address) {
+			return true;
+		}
+	}
+	return false;
+}
+
+M_TEST_DEFINE(repeatDirty) {
+	struct mCore* core = *state;
+	struct mCoreMemorySearchParams params = {
+		.memoryFlags = mCORE_MEMORY_READ,
+		.type = mCORE_MEMORY_SEARCH_INT,
+		.op = mCORE_MEMORY_SEARCH_EQUAL,
+		.align = 1,
+		.width = 1,
+		.valueInt = 0xA5,
+	};
+	_small[0x10] = 0xA5;
+	_small[0x20] = 0xA5;
+	_small[0x104] = 0xA5;
+	_large[0x30] = 0xA5;
+	struct mCoreMemorySearchResults results;
+	struct mCoreMemorySearchResults expected;
+	mCoreMemorySearchResultsInit(&results, 0);
+	mCoreMemorySearchResultsInit(&expected, 0);
+	mCoreMemorySearch(core, &params, &results, 0);
+	mCoreMemorySearchResultsCopy(&expected, &results);
+	size_t found = mCoreMemorySearchResultsSize(&results);
+	assert_true(found >= 4);
+
+	// Tracking starts with every page dirty, so the first pass matches a plain repeat
+	_small[0x20] = 0;
+	_large[0x30] = 0;
+	mCoreMemorySearchRepeatDirty(core, &params, &results);
+	mCoreMemorySearchRepeat(core, &params, &expected);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), found - 2);
+	assert_int_equal(mCoreMemorySearchResultsSize(&expected), found - 2);
+	size_t i;
+	for (i = 1; i < mCoreMemorySearchResultsSize(&results); ++i) {
+		assert_true(mCoreMemorySearchResultsGetPointer(&results, i - 1)->address < mCoreMemorySearchResultsGetPointer(&results, i)->address);
+	}
+
+	// Writes that mark their page are picked up
+	TestCoreWrite8((struct TestCore*) core, 0x02000010, 0);
+	mCoreMemorySearchRepeatDirty(core, &params, &results);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), found - 3);
+	assert_false(_hasAddress(&results, 0x02000010));
+	assert_true(_hasAddress(&results, 0x02000104));
+
+	// Pages that were not marked are not read again
+	_small[0x104] = 0;
+	params.op = mCORE_MEMORY_SEARCH_DELTA;
+	params.valueInt = 0;
+	mCoreMemorySearchRepeatDirty(core, &params, &results);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), found - 3);
+	assert_true(_hasAddress(&results, 0x02000104));
+	TestCoreWrite8((struct TestCore*) core, 0x02000104, 0);
+	mCoreMemorySearchRepeatDirty(core, &params, &results);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), found - 4);
+	assert_false(_hasAddress(&results, 0x02000104));
+
+	mCoreMemorySearchResultsDeinit(&results);
+	mCoreMemorySearchResultsDeinit(&expected);
+	TestCoreDeinit((struct TestCore*) core);
+	_fill(_small, SMALL_SIZE, 1);
+	_fill(_large, LARGE_SIZE, 2);
+}
+
+M_TEST_SUITE_DEFINE_SETUP(MemorySearch,
+	cmocka_unit_test(searchInt8),
+	cmocka_unit_test(searchInt16),
+	cmocka_unit_test(searchInt32),
+	cmocka_unit_test(searchString),
+	cmocka_unit_test(repeatDirty))
@@ -0,0 +1,116 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/metrics.h>
+
+M_TEST_DEFINE(frameBuckets) {
+	struct mCoreMetrics metrics;
+	mCoreMetricsReset(&metrics);
+	mCoreMetricsAddFrame(&metrics, 0);
+	mCoreMetricsAddFrame(&metrics, 1000);
+	mCoreMetricsAddFrame(&metrics, 1001);
+	mCoreMetricsAddFrame(&metrics, 16743);
+	mCoreMetricsAddFrame(&metrics, 1000000);
+	assert_int_equal(metrics.frames, 5);
+	assert_int_equal(metrics.frameTimeBuckets[0], 2);
+	assert_int_equal(metrics.frameTimeBuckets[1], 1);
+	assert_int_equal(metrics.frameTimeBuckets[5], 1);
+	assert_int_equal(metrics.frameTimeBuckets[mCORE_METRICS_FRAME_BUCKETS], 1);
+	assert_int_equal(metrics.frameTimeTotal, 1018744);
+	assert_int_equal(metrics.frameTimeMax, 1000000);
+}
+
+M_TEST_DEFINE(merge) {
+	struct mCoreMetrics a;
+	struct mCoreMetrics b;
+	mCoreMetricsReset(&a);
+	mCoreMetricsReset(&b);
+	mCoreMetricsAddFrame(&a, 500);
+	mCoreMetricsAddFrame(&b, 30000);
+	a.phaseTime[mCORE_METRICS_RENDER] = 3;
+	b.phaseTime[mCORE_METRICS_RENDER] = 4;
+	a.videoQueueMaxDepth = 10;
+	b.videoQueueMaxDepth = 20;
+	b.audioUnderruns = 7;
+	a.audioJitterMax = 300;
+	b.audioJitterMax = 200;
+	mCoreMetricsMerge(&a, &b);
+	assert_int_equal(a.frames, 2);
+	assert_int_equal(a.frameTimeBuckets[0], 1);
+	assert_int_equal(a.frameTimeBuckets[7], 1);
+	assert_int_equal(a.frameTimeMax, 30000);
+	assert_int_equal(a.phaseTime[mCORE_METRICS_RENDER], 7);
+	assert_int_equal(a.videoQueueMaxDepth, 20);
+	assert_int_equal(a.audioUnderruns, 7);
+	assert_int_equal(a.audioJitterMax, 300);
+}
+
+M_TEST_DEFINE(recorderPhases) {
+	struct mCoreMetricsRecorder recorder;
+	mCoreMetricsRecorderInit(&recorder);
+	uint64_t waits[mCORE_METRICS_PHASE_MAX] = { 0 };
+
+	// The first frame only sets the baseline
+	waits[mCORE_METRICS_VIDEO_SYNC] = 100;
+	mCoreMetricsRecorderFrame(&recorder, waits);
+	assert_int_equal(recorder.metrics.frames, 0);
+
+	mCoreMetricsRecorderFrame(&recorder, waits);
+	assert_int_equal(recorder.metrics.frames, 1);
+	assert_int_equal(recorder.metrics.phaseTime[mCORE_METRICS_VIDEO_SYNC], 0);
+	assert_int_equal(recorder.metrics.phaseTime[mCORE_METRICS_EMULATION], recorder.metrics.frameTimeTotal);
+
+	// Waits longer than the frame itself can't make the emulation time go backwards
+	uint64_t emulation = recorder.metrics.phaseTime[mCORE_METRICS_EMULATION];
+	waits[mCORE_METRICS_VIDEO_SYNC] += 10000000;
+	mCoreMetricsRecorderFrame(&recorder, waits);
+	assert_int_equal(recorder.metrics.frames, 2);
+	assert_int_equal(recorder.metrics.phaseTime[mCORE_METRICS_VIDEO_SYNC], 10000000);
+	assert_int_equal(recorder.metrics.phaseTime[mCORE_METRICS_EMULATION], emulation);
+
+	// After a skip the totals can restart from anywhere, e.g. for a new core
+	mCoreMetricsRecorderSkip(&recorder);
+	waits[mCORE_METRICS_VIDEO_SYNC] = 0;
+	mCoreMetricsRecorderFrame(&recorder, waits);
+	assert_int_equal(recorder.metrics.frames, 2);
+	mCoreMetricsRecorderFrame(&recorder, waits);
+	assert_int_equal(recorder.metrics.frames, 3);
+	assert_int_equal(recorder.metrics.phaseTime[mCORE_METRICS_VIDEO_SYNC], 10000000);
+}
+
+M_TEST_DEFINE(formatPrometheus) {
+	struct mCoreMetrics metrics;
+	mCoreMetricsReset(&metrics);
+	mCoreMetricsAddFrame(&metrics, 1500);
+	mCoreMetricsAddFrame(&metrics, 2500);
+	metrics.phaseTime[mCORE_METRICS_REWIND] = 250000;
+
+	char buffer[0x1000];
+	size_t length = mCoreMetricsFormatPrometheus(&metrics, "session=\"a\"", buffer, sizeof(buffer));
+	assert_int_equal(length, strlen(buffer));
+	assert_non_null(strstr(buffer, "# TYPE mgba_frame_time_seconds histogram\n"));
+	assert_non_null(strstr(buffer, "\nmgba_frames_total{session=\"a\"} 2\n"));
+	assert_non_null(strstr(buffer, "\nmgba_frame_time_seconds_bucket{session=\"a\",le=\"0.001\"} 0\n"));
+	assert_non_null(strstr(buffer, "\nmgba_frame_time_seconds_bucket{session=\"a\",le=\"0.002\"} 1\n"));
+	assert_non_null(strstr(buffer, "\nmgba_frame_time_seconds_bucket{session=\"a\",le=\"+Inf\"} 2\n"));
+	assert_non_null(strstr(buffer, "\nmgba_frame_time_seconds_sum{session=\"a\"} 0.004\n"));
+	assert_non_null(strstr(buffer, "\nmgba_thread_seconds_total{session=\"a\",phase=\"rewind\"} 0.25\n"));
+
+	size_t unlabeled = mCoreMetricsFormatPrometheus(&metrics, NULL, buffer, sizeof(buffer));
+	assert_non_null(strstr(buffer, "\nmgba_frames_total 2\n"));
+
+	// A short buffer still reports the full length
+	char small[16];
+	assert_int_equal(mCoreMetricsFormatPrometheus(&metrics, NULL, small, sizeof(small)), unlabeled);
+	assert_int_equal(strlen(small), sizeof(small) - 1);
+}
+
+M_TEST_SUITE_DEFINE(mCoreMetrics,
+	cmocka_unit_test(frameBuckets),
+	cmocka_unit_test(merge),
+	cmocka_unit_test(recorderPhases),
+	cmocka_unit_test(formatPrometheus))
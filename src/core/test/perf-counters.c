@@ -0,0 +1,79 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/perf-counters.h>
+
+#include <mgba-util/vfs.h>
+
+static const char* _names[mPERF_COUNTER_MAX_EVENTS + 1] = {
+	"0", "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11", "12", "13", "14", "15", "16",
+	"17", "18", "19", "20", "21", "22", "23", "24", "25", "26", "27", "28", "29", "30", "31", "32"
+};
+
+M_TEST_DEFINE(countEvents) {
+	struct mPerfCounters counters;
+	mPerfCountersReset(&counters);
+	mPerfCountersCountEvent(&counters, "a");
+	mPerfCountersCountEvent(&counters, "b");
+	mPerfCountersCountEvent(&counters, "a");
+	assert_int_equal(counters.eventsFired, 3);
+	assert_int_equal(counters.nEvents, 2);
+	assert_string_equal(counters.events[0].name, "a");
+	assert_int_equal(counters.events[0].fired, 2);
+	assert_string_equal(counters.events[1].name, "b");
+	assert_int_equal(counters.events[1].fired, 1);
+}
+
+M_TEST_DEFINE(overflowEvents) {
+	struct mPerfCounters counters;
+	mPerfCountersReset(&counters);
+	size_t i;
+	for (i = 0; i < mPERF_COUNTER_MAX_EVENTS + 1; ++i) {
+		mPerfCountersCountEvent(&counters, _names[i]);
+	}
+	mPerfCountersCountEvent(&counters, _names[mPERF_COUNTER_MAX_EVENTS]);
+	assert_int_equal(counters.nEvents, mPERF_COUNTER_MAX_EVENTS);
+	assert_int_equal(counters.eventsFired, mPERF_COUNTER_MAX_EVENTS + 2);
+	assert_ptr_equal(counters.events[mPERF_COUNTER_MAX_EVENTS - 1].name, _names[mPERF_COUNTER_MAX_EVENTS - 1]);
+
+	mPerfCountersReset(&counters);
+	assert_int_equal(counters.nEvents, 0);
+	assert_int_equal(counters.eventsFired, 0);
+}
+
+M_TEST_DEFINE(dumpCounters) {
+	struct mPerfCounters* counters = malloc(sizeof(*counters));
+	mPerfCountersReset(counters);
+	counters->instructions[1] = 7;
+	counters->handlers[1][0x2A] = 5;
+	counters->instructionRegions[8] = 7;
+	counters->conditionsFailed = 2;
+	mPerfCountersCountEvent(counters, "Video");
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mPerfCountersDump(counters, vf));
+	static const char expected[] =
+		"counter,mode,index,value\n"
+		"instructions,1,,7\n"
+		"handler,1,0x02A,5\n"
+		"instruction_region,,0x008,7\n"
+		"conditions_failed,,,2\n"
+		"events_fired,,,1\n"
+		"event,,Video,1\n";
+	char buffer[sizeof(expected)] = {0};
+	assert_int_equal(vf->size(vf), sizeof(expected) - 1);
+	vf->seek(vf, 0, SEEK_SET);
+	vf->read(vf, buffer, sizeof(buffer) - 1);
+	assert_string_equal(buffer, expected);
+	vf->close(vf);
+	free(counters);
+}
+
+M_TEST_SUITE_DEFINE(mPerfCounters,
+	cmocka_unit_test(countEvents),
+	cmocka_unit_test(overflowEvents),
+	cmocka_unit_test(dumpCounters))
@@ -0,0 +1,193 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/rewind.h>
+
+#define N_PAGES 16
+#define N_ENTRIES 64
+#define N_FRAMES 400
+#define BUDGET 0x20000
+
+struct TestCoreState {
+	int32_t frame;
+	uint8_t pages[N_PAGES][M_CORE_REWIND_PAGE_SIZE];
+};
+
+struct TestCore {
+	struct mCore d;
+	struct TestCoreState state;
+	int loads;
+};
+
+static size_t _stateSize(struct mCore* core) {
+	UNUSED(core);
+	return sizeof(struct TestCoreState);
+}
+
+static bool _saveState(struct mCore* core, void* state) {
+	memcpy(state, &((struct TestCore*) core)->state, sizeof(struct TestCoreState));
+	return true;
+}
+
+static bool _loadState(struct mCore* core, const void* state) {
+	memcpy(&((struct TestCore*) core)->state, state, sizeof(struct TestCoreState));
+	++((struct TestCore*) core)->loads;
+	return true;
+}
+
+static size_t _savedataClone(struct mCore* core, void** sram) {
+	UNUSED(core);
+	UNUSED(sram);
+	return 0;
+}
+
+static void _desiredVideoDimensions(struct mCore* core, unsigned* width, unsigned* height) {
+	UNUSED(core);
+	*width = 0;
+	*height = 0;
+}
+
+// One page of the state changes per frame, besides the frame counter
+static void _advance(struct TestCoreState* state) {
+	++state->frame;
+	memset(state->pages[state->frame % N_PAGES], state->frame, M_CORE_REWIND_PAGE_SIZE);
+}
+
+static void _initCore(struct TestCore* core) {
+	memset(core, 0, sizeof(*core));
+	core->d.stateSize = _stateSize;
+	core->d.saveState = _saveState;
+	core->d.loadState = _loadState;
+	core->d.savedataClone = _savedataClone;
+	core->d.desiredVideoDimensions = _desiredVideoDimensions;
+}
+
+M_TEST_DEFINE(budgetThinsOldSnapshots) {
+	static struct TestCore core;
+	static struct TestCoreState expected;
+	_initCore(&core);
+	struct mCoreRewindContext rewind = { .budget = BUDGET };
+	mCoreRewindContextInit(&rewind, N_ENTRIES, false);
+
+	int i;
+	for (i = 0; i < N_FRAMES; ++i) {
+		_advance(&core.state);
+		mCoreRewindAppend(&rewind, &core.d);
+		assert_true(rewind.bytes <= BUDGET);
+	}
+
+	// Restores walk back through all retained snapshots, which are further apart the older they are
+	int32_t last = core.state.frame;
+	bool sparse = false;
+	while (mCoreRewindRestore(&rewind, &core.d)) {
+		assert_true(core.state.frame < last);
+		if (last - core.state.frame > 1) {
+			sparse = true;
+		}
+		last = core.state.frame;
+
+		memset(&expected, 0, sizeof(expected));
+		while (expected.frame < last) {
+			_advance(&expected);
+		}
+		assert_memory_equal(&core.state, &expected, sizeof(expected));
+	}
+	assert_true(sparse);
+	// The horizon reaches further back than the entry count alone would allow
+	assert_true(last < N_FRAMES - N_ENTRIES);
+
+	mCoreRewindContextDeinit(&rewind);
+	assert_int_equal(rewind.bytes, 0);
+}
+
+M_TEST_DEFINE(noBudgetKeepsEveryEntry) {
+	static struct TestCore core;
+	_initCore(&core);
+	struct mCoreRewindContext rewind = { .budget = 0 };
+	mCoreRewindContextInit(&rewind, N_ENTRIES, false);
+
+	int i;
+	for (i = 0; i < N_FRAMES; ++i) {
+		_advance(&core.state);
+		mCoreRewindAppend(&rewind, &core.d);
+	}
+	for (i = 1; i <= N_ENTRIES; ++i) {
+		assert_true(mCoreRewindRestore(&rewind, &core.d));
+		assert_int_equal(core.state.frame, N_FRAMES - i);
+	}
+	assert_false(mCoreRewindRestore(&rewind, &core.d));
+
+	mCoreRewindContextDeinit(&rewind);
+}
+
+M_TEST_DEFINE(restoreStepsLoadsOnce) {
+	static struct TestCore core;
+	_initCore(&core);
+	struct mCoreRewindContext rewind = { .budget = 0 };
+	mCoreRewindContextInit(&rewind, N_ENTRIES, false);
+
+	int i;
+	for (i = 0; i < N_FRAMES; ++i) {
+		_advance(&core.state);
+		mCoreRewindAppend(&rewind, &core.d);
+	}
+	assert_int_equal(mCoreRewindRestoreSteps(&rewind, &core.d, 10), 10);
+	assert_int_equal(core.loads, 1);
+	assert_int_equal(core.state.frame, N_FRAMES - 10);
+
+	// Each step lands where the same number of single restores would have
+	assert_true(mCoreRewindRestore(&rewind, &core.d));
+	assert_int_equal(core.state.frame, N_FRAMES - 11);
+
+	// Asking for more than is held stops at the oldest snapshot
+	assert_int_equal(mCoreRewindRestoreSteps(&rewind, &core.d, SIZE_MAX), N_ENTRIES - 11);
+	assert_int_equal(core.loads, 3);
+	assert_int_equal(core.state.frame, N_FRAMES - N_ENTRIES);
+	assert_int_equal(mCoreRewindRestoreSteps(&rewind, &core.d, 5), 0);
+	assert_int_equal(core.loads, 3);
+
+	mCoreRewindContextDeinit(&rewind);
+}
+
+#ifndef DISABLE_THREADING
+M_TEST_DEFINE(diffThreadKeepsNewestState) {
+	static struct TestCore core;
+	static struct TestCoreState expected;
+	_initCore(&core);
+	struct mCoreRewindContext rewind = { .budget = 0 };
+	mCoreRewindContextInit(&rewind, N_ENTRIES, true);
+
+	int i;
+	for (i = 0; i < N_FRAMES; ++i) {
+		_advance(&core.state);
+		mCoreRewindAppend(&rewind, &core.d);
+	}
+	// States the diff thread falls behind on may be dropped, but whatever is restored
+	// has to match the frame it was captured on
+	int32_t last = core.state.frame;
+	while (mCoreRewindRestore(&rewind, &core.d)) {
+		assert_true(core.state.frame < last);
+		last = core.state.frame;
+		memset(&expected, 0, sizeof(expected));
+		while (expected.frame < last) {
+			_advance(&expected);
+		}
+		assert_memory_equal(&core.state, &expected, sizeof(expected));
+	}
+
+	mCoreRewindContextDeinit(&rewind);
+}
+#endif
+
+M_TEST_SUITE_DEFINE(mCoreRewind,
+	cmocka_unit_test(budgetThinsOldSnapshots),
+	cmocka_unit_test(noBudgetKeepsEveryEntry),
+#ifndef DISABLE_THREADING
+	cmocka_unit_test(diffThreadKeepsNewestState),
+#endif
+	cmocka_unit_test(restoreStepsLoadsOnce))
@@ -0,0 +1,109 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+#include "core/test/test-core.h"
+
+#include <mgba/core/rollback.h>
+
+#define N_FRAMES 60
+
+static uint32_t _localKeys(int32_t frame) {
+	return (frame / 3) & 1;
+}
+
+static uint32_t _remoteKeys(int32_t frame) {
+	return ((frame / 7) & 3) << 4;
+}
+
+static uint32_t _expectedHash(int32_t frames) {
+	uint32_t hash = 0;
+	int32_t i;
+	for (i = 0; i < frames; ++i) {
+		hash = hash * 31 + (_localKeys(i) | _remoteKeys(i)) + 1;
+	}
+	return hash;
+}
+
+M_TEST_DEFINE(lateInput) {
+	struct TestCore core;
+	TestCoreInit(&core);
+	struct mRollback rollback;
+	assert_true(mRollbackInit(&rollback, &core.d, 2, 0, 8));
+
+	// Remote input trails by three frames, so every change in it is a misprediction
+	int32_t frame;
+	for (frame = 0; frame < N_FRAMES; ++frame) {
+		if (frame >= 3) {
+			assert_true(mRollbackAddInput(&rollback, 1, frame - 3, _remoteKeys(frame - 3)));
+		}
+		assert_true(mRollbackRunFrame(&rollback, _localKeys(frame)));
+	}
+	for (frame = N_FRAMES - 3; frame < N_FRAMES; ++frame) {
+		assert_true(mRollbackAddInput(&rollback, 1, frame, _remoteKeys(frame)));
+	}
+	assert_int_equal(mRollbackConfirmedFrame(&rollback), N_FRAMES - 1);
+	assert_true(mRollbackRunFrame(&rollback, _localKeys(N_FRAMES)));
+
+	assert_int_equal(core.state.frame, N_FRAMES + 1);
+	assert_int_equal(core.state.hash, _expectedHash(N_FRAMES + 1));
+	assert_int_equal(core.shownFrames, N_FRAMES + 1);
+	assert_true(rollback.stats.rollbacks > 0);
+	assert_true(rollback.stats.maxRollback <= 4);
+	assert_int_equal(rollback.stats.framesRun, N_FRAMES + 1);
+	mRollbackDeinit(&rollback);
+}
+
+M_TEST_DEFINE(earlyInput) {
+	struct TestCore core;
+	TestCoreInit(&core);
+	struct mRollback rollback;
+	assert_true(mRollbackInit(&rollback, &core.d, 2, 1, 4));
+
+	int32_t frame;
+	for (frame = 0; frame < 4; ++frame) {
+		assert_true(mRollbackAddInput(&rollback, 0, frame, _localKeys(frame)));
+	}
+	// Past the end of the input ring
+	assert_false(mRollbackAddInput(&rollback, 0, 4, _localKeys(4)));
+	// Out of order
+	assert_false(mRollbackAddInput(&rollback, 0, 5, _localKeys(5)));
+	assert_false(mRollbackAddInput(&rollback, 1, 0, 0));
+
+	for (frame = 0; frame < 4; ++frame) {
+		assert_true(mRollbackRunFrame(&rollback, _remoteKeys(frame)));
+	}
+	assert_int_equal(rollback.stats.rollbacks, 0);
+	assert_int_equal(core.state.hash, _expectedHash(4));
+	mRollbackDeinit(&rollback);
+}
+
+M_TEST_DEFINE(stallOutsideWindow) {
+	struct TestCore core;
+	TestCoreInit(&core);
+	struct mRollback rollback;
+	assert_true(mRollbackInit(&rollback, &core.d, 2, 0, 4));
+
+	int32_t frame;
+	for (frame = 0; frame < 4; ++frame) {
+		assert_true(mRollbackRunFrame(&rollback, _localKeys(frame)));
+	}
+	assert_false(mRollbackRunFrame(&rollback, _localKeys(4)));
+	assert_int_equal(rollback.stats.stalls, 1);
+
+	for (frame = 0; frame < 4; ++frame) {
+		assert_true(mRollbackAddInput(&rollback, 1, frame, _remoteKeys(frame) | 0x100));
+	}
+	assert_true(mRollbackRunFrame(&rollback, _localKeys(4)));
+	assert_int_equal(rollback.stats.rollbacks, 1);
+	assert_int_equal(rollback.stats.framesResimulated, 4);
+	assert_int_equal(core.shownFrames, 5);
+	mRollbackDeinit(&rollback);
+}
+
+M_TEST_SUITE_DEFINE(mRollback,
+	cmocka_unit_test(lateInput),
+	cmocka_unit_test(earlyInput),
+	cmocka_unit_test(stallOutsideWindow))
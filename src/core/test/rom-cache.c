@@ -0,0 +1,95 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/rom-cache.h>
+#include <mgba-util/crc32.h>
+#include <mgba-util/vfs.h>
+
+#define ROM_SIZE 0x1000
+
+static struct VFile* _makeROM(uint8_t seed) {
+	struct VFile* vf = VFileMemChunk(NULL, ROM_SIZE);
+	uint8_t* data = vf->map(vf, ROM_SIZE, MAP_WRITE);
+	size_t i;
+	for (i = 0; i < ROM_SIZE; ++i) {
+		data[i] = i * 7 + seed;
+	}
+	vf->unmap(vf, data, ROM_SIZE);
+	return vf;
+}
+
+M_TEST_DEFINE(shareIdentical) {
+	struct mROMCache cache;
+	mROMCacheInit(&cache);
+	struct VFile* a = mROMCacheOpen(&cache, _makeROM(1));
+	struct VFile* b = mROMCacheOpen(&cache, _makeROM(1));
+	assert_true(mROMCacheIsShared(a));
+	assert_true(mROMCacheIsShared(b));
+	assert_int_equal(a->size(a), ROM_SIZE);
+	void* mapA = a->map(a, ROM_SIZE, MAP_READ);
+	void* mapB = b->map(b, ROM_SIZE, MAP_READ);
+	assert_non_null(mapA);
+	assert_ptr_equal(mapA, mapB);
+	assert_null(a->map(a, ROM_SIZE, MAP_WRITE));
+
+	uint32_t crc32;
+	assert_true(mROMCacheGetCRC32(b, &crc32));
+	assert_int_equal(crc32, doCrc32(mapA, ROM_SIZE));
+	struct VFile* c = mROMCacheOpenCRC32(&cache, crc32);
+	assert_non_null(c);
+	assert_ptr_equal(c->map(c, ROM_SIZE, MAP_READ), mapA);
+	a->close(a);
+	b->close(b);
+	c->close(c);
+	mROMCacheDeinit(&cache);
+}
+
+M_TEST_DEFINE(distinctROMs) {
+	struct mROMCache cache;
+	mROMCacheInit(&cache);
+	struct VFile* a = mROMCacheOpen(&cache, _makeROM(1));
+	struct VFile* b = mROMCacheOpen(&cache, _makeROM(2));
+	assert_ptr_not_equal(a->map(a, ROM_SIZE, MAP_READ), b->map(b, ROM_SIZE, MAP_READ));
+	a->close(a);
+	b->close(b);
+	mROMCacheDeinit(&cache);
+}
+
+M_TEST_DEFINE(releaseLastReference) {
+	struct mROMCache cache;
+	mROMCacheInit(&cache);
+	struct VFile* a = mROMCacheOpen(&cache, _makeROM(3));
+	uint8_t buffer[16];
+	assert_int_equal(a->seek(a, -16, SEEK_END), ROM_SIZE - 16);
+	assert_int_equal(a->read(a, buffer, sizeof(buffer)), sizeof(buffer));
+	assert_int_equal(buffer[0], (uint8_t) ((ROM_SIZE - 16) * 7 + 3));
+	assert_int_equal(a->write(a, buffer, sizeof(buffer)), -1);
+
+	uint32_t crc32 = doCrc32(a->map(a, ROM_SIZE, MAP_READ), ROM_SIZE);
+	a->close(a);
+	assert_null(mROMCacheOpenCRC32(&cache, crc32));
+	mROMCacheDeinit(&cache);
+}
+
+M_TEST_DEFINE(unshareable) {
+	struct mROMCache cache;
+	mROMCacheInit(&cache);
+	struct VFile* empty = VFileMemChunk(NULL, 0);
+	assert_ptr_equal(mROMCacheOpen(&cache, empty), empty);
+	assert_false(mROMCacheIsShared(empty));
+	uint32_t crc32;
+	assert_false(mROMCacheGetCRC32(empty, &crc32));
+	empty->close(empty);
+	assert_null(mROMCacheOpen(&cache, NULL));
+	mROMCacheDeinit(&cache);
+}
+
+M_TEST_SUITE_DEFINE(mROMCache,
+	cmocka_unit_test(shareIdentical),
+	cmocka_unit_test(distinctROMs),
+	cmocka_unit_test(releaseLastReference),
+	cmocka_unit_test(unshareable))
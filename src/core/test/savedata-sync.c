@@ -0,0 +1,80 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/interface.h>
+#include <mgba-util/vfs.h>
+
+#define SECTOR_SIZE (1 << mSAVEDATA_SECTOR_SHIFT)
+#define SAVE_SIZE (SECTOR_SIZE * 4)
+
+M_TEST_DEFINE(sectorRange) {
+	assert_int_equal(mSavedataSectorRange(0, 0), 0);
+	assert_int_equal(mSavedataSectorRange(0, 1), 0x1);
+	assert_int_equal(mSavedataSectorRange(SECTOR_SIZE - 1, 2), 0x3);
+	assert_int_equal(mSavedataSectorRange(SECTOR_SIZE, SECTOR_SIZE * 3), 0xE);
+	assert_int_equal(mSavedataSector(SECTOR_SIZE * 31), 0x80000000);
+	assert_int_equal(mSavedataSector(SECTOR_SIZE * 40), 0x80000000);
+	assert_int_equal(mSavedataSectorRange(SECTOR_SIZE * 30, SECTOR_SIZE * 10), 0xC0000000);
+}
+
+struct RecordingVFile {
+	struct VFile d;
+	const uint8_t* base;
+	size_t offsets[4];
+	size_t sizes[4];
+	int nSyncs;
+};
+
+static bool _recordSync(struct VFile* vf, const void* buffer, size_t size) {
+	struct RecordingVFile* rvf = (struct RecordingVFile*) vf;
+	if (rvf->nSyncs >= 4) {
+		return false;
+	}
+	rvf->offsets[rvf->nSyncs] = (const uint8_t*) buffer - rvf->base;
+	rvf->sizes[rvf->nSyncs] = size;
+	++rvf->nSyncs;
+	return true;
+}
+
+M_TEST_DEFINE(syncOnlyDirtySectors) {
+	static uint8_t data[SAVE_SIZE];
+	struct RecordingVFile vf = { .base = data };
+	vf.d.sync = _recordSync;
+
+	assert_true(mSavedataSyncSectors(&vf.d, data, SAVE_SIZE, mSavedataSector(SECTOR_SIZE) | mSavedataSector(SECTOR_SIZE * 3)));
+	assert_int_equal(vf.nSyncs, 2);
+	assert_int_equal(vf.offsets[0], SECTOR_SIZE);
+	assert_int_equal(vf.sizes[0], SECTOR_SIZE);
+	assert_int_equal(vf.offsets[1], SECTOR_SIZE * 3);
+	assert_int_equal(vf.sizes[1], SECTOR_SIZE);
+
+	vf.nSyncs = 0;
+	assert_true(mSavedataSyncSectors(&vf.d, data, SAVE_SIZE, mSavedataSectorRange(SECTOR_SIZE - 1, 2)));
+	assert_int_equal(vf.nSyncs, 1);
+	assert_int_equal(vf.offsets[0], 0);
+	assert_int_equal(vf.sizes[0], SECTOR_SIZE * 2);
+}
+
+M_TEST_DEFINE(syncAllSectors) {
+	static uint8_t data[SAVE_SIZE + 1];
+	struct RecordingVFile vf = { .base = data };
+	vf.d.sync = _recordSync;
+
+	assert_true(mSavedataSyncSectors(&vf.d, data, SAVE_SIZE + 1, mSAVEDATA_SECTORS_ALL));
+	assert_int_equal(vf.nSyncs, 1);
+	assert_int_equal(vf.offsets[0], 0);
+	assert_int_equal(vf.sizes[0], SAVE_SIZE + 1);
+
+	vf.nSyncs = 0;
+	assert_true(mSavedataSyncSectors(&vf.d, data, SAVE_SIZE + 1, 0));
+	assert_int_equal(vf.nSyncs, 0);
+}
+
+M_TEST_SUITE_DEFINE(mSavedataSync,
+	cmocka_unit_test(sectorRange),
+	cmocka_unit_test(syncOnlyDirtySectors),
+	cmocka_unit_test(syncAllSectors))
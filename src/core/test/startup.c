@@ -0,0 +1,177 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/cheats.h>
+#include <mgba/core/core.h>
+#include <mgba/core/startup.h>
+#include <mgba-util/vfs.h>
+
+#if defined(M_CORE_GBA) && !defined(_WIN32) && (!defined(MINIMAL_CORE) || MINIMAL_CORE < 2)
+#define STARTUP_TESTS
+#include <unistd.h>
+
+#define PATCHED_OFFSET 0x200
+
+struct StartupTestContext {
+	char dir[64];
+	char rom[PATH_MAX];
+};
+
+static void _writeFile(const struct StartupTestContext* context, const char* name, const void* data, size_t size) {
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s" PATH_SEP "%s", context->dir, name);
+	struct VFile* vf = VFileOpen(path, O_CREAT | O_TRUNC | O_WRONLY);
+	assert_non_null(vf);
+	assert_int_equal(vf->write(vf, data, size), size);
+	vf->close(vf);
+}
+
+static void _removeFile(const struct StartupTestContext* context, const char* name) {
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s" PATH_SEP "%s", context->dir, name);
+	unlink(path);
+}
+#endif
+
+M_TEST_SUITE_SETUP(mCoreStartup) {
+#ifdef STARTUP_TESTS
+	struct StartupTestContext* context = calloc(1, sizeof(*context));
+	strncpy(context->dir, "/tmp/mgba-startup-XXXXXX", sizeof(context->dir) - 1);
+	if (!mkdtemp(context->dir)) {
+		free(context);
+		return -1;
+	}
+	snprintf(context->rom, sizeof(context->rom), "%s" PATH_SEP "game.gba", context->dir);
+
+	uint8_t rom[0x400] = { 0 };
+	rom[0x3] = 0xEA;
+	rom[0xB2] = 0x96;
+	size_t i;
+	for (i = 0xC0; i < sizeof(rom); ++i) {
+		rom[i] = i * 7;
+	}
+	_writeFile(context, "game.gba", rom, sizeof(rom));
+	static const uint8_t patch[] = {
+		'P', 'A', 'T', 'C', 'H',
+		0x00, PATCHED_OFFSET >> 8, PATCHED_OFFSET & 0xFF, 0x00, 0x01, 0x5A,
+		'E', 'O', 'F'
+	};
+	_writeFile(context, "game.ips", patch, sizeof(patch));
+	static const char cheats[] = "# Startup\n";
+	_writeFile(context, "game.cheats", cheats, strlen(cheats));
+	*state = context;
+#endif
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(mCoreStartup) {
+#ifdef STARTUP_TESTS
+	struct StartupTestContext* context = *state;
+	_removeFile(context, "game.gba");
+	_removeFile(context, "game.ips");
+	_removeFile(context, "game.cheats");
+	_removeFile(context, "game.sav");
+	rmdir(context->dir);
+	free(context);
+#endif
+	return 0;
+}
+
+#ifdef STARTUP_TESTS
+static struct mCore* _createCore(const struct StartupTestContext* context) {
+	struct mCore* core = mCoreFind(context->rom);
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	return core;
+}
+
+static void _destroyCore(struct mCore* core) {
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+static void _loadEverything(struct StartupTestContext* context, size_t nThreads) {
+	struct mCore* core = _createCore(context);
+	struct mCoreStartup startup;
+	mCoreStartupInit(&startup);
+	startup.nThreads = nThreads;
+	assert_true(mCoreStartupLoad(&startup, core, context->rom));
+	core->reset(core);
+
+	assert_true(startup.loaded[mCORE_STARTUP_ROM]);
+	assert_false(startup.loaded[mCORE_STARTUP_BIOS]);
+	assert_true(startup.loaded[mCORE_STARTUP_SAVE]);
+	assert_true(startup.loaded[mCORE_STARTUP_PATCH]);
+	assert_true(startup.loaded[mCORE_STARTUP_CHEATS]);
+	assert_true(startup.totalTime >= startup.openTime);
+
+	assert_int_equal(core->rawRead8(core, 0x08000000 + PATCHED_OFFSET, -1), 0x5A);
+	assert_int_equal(core->rawRead8(core, 0x08000000 + PATCHED_OFFSET + 1, -1), (uint8_t) ((PATCHED_OFFSET + 1) * 7));
+	struct mCheatDevice* device = core->cheatDevice(core);
+	assert_int_equal(mCheatSetsSize(&device->cheats), 1);
+	assert_string_equal(mCheatSetsGetPointer(&device->cheats, 0)[0]->name, "Startup");
+	assert_true(device->autosave);
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s" PATH_SEP "game.sav", context->dir);
+	assert_int_equal(access(path, F_OK), 0);
+	_destroyCore(core);
+}
+#endif
+
+M_TEST_DEFINE(loadThreaded) {
+#ifdef STARTUP_TESTS
+	_loadEverything(*state, 4);
+#endif
+}
+
+M_TEST_DEFINE(loadSerial) {
+#ifdef STARTUP_TESTS
+	_loadEverything(*state, 1);
+#endif
+}
+
+M_TEST_DEFINE(autoloadDisabled) {
+#ifdef STARTUP_TESTS
+	struct StartupTestContext* context = *state;
+	struct mCore* core = _createCore(context);
+	struct mCoreStartup startup;
+	mCoreStartupInit(&startup);
+	startup.autoloadPatch = false;
+	startup.autoloadCheats = false;
+	assert_true(mCoreStartupLoad(&startup, core, context->rom));
+	core->reset(core);
+	assert_false(startup.loaded[mCORE_STARTUP_PATCH]);
+	assert_false(startup.loaded[mCORE_STARTUP_CHEATS]);
+	assert_int_equal(core->rawRead8(core, 0x08000000 + PATCHED_OFFSET, -1), (uint8_t) (PATCHED_OFFSET * 7));
+	_destroyCore(core);
+#endif
+}
+
+M_TEST_DEFINE(missingROM) {
+#ifdef STARTUP_TESTS
+	struct StartupTestContext* context = *state;
+	struct mCore* core = _createCore(context);
+	struct mCoreStartup startup;
+	mCoreStartupInit(&startup);
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s" PATH_SEP "missing.gba", context->dir);
+	assert_false(mCoreStartupLoad(&startup, core, path));
+	size_t i;
+	for (i = 0; i < mCORE_STARTUP_ASSET_MAX; ++i) {
+		assert_false(startup.loaded[i]);
+	}
+	_destroyCore(core);
+#endif
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mCoreStartup,
+	cmocka_unit_test(loadThreaded),
+	cmocka_unit_test(loadSerial),
+	cmocka_unit_test(autoloadDisabled),
+	cmocka_unit_test(missingROM))
@@ -0,0 +1,154 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+#include "core/test/test-core.h"
+
+#include <mgba/core/state-hash.h>
+#include <mgba-util/hash.h>
+
+#define RAM_SIZE 0x1000
+
+static const struct mCoreMemoryBlock _testBlocks[] = {
+	{ -1, "mem", "All", "All", 0, 0x10000, 0x10000, mCORE_MEMORY_VIRTUAL },
+	{ 1, "rom", "ROM", "ROM", 0, 0x8000, 0x8000, mCORE_MEMORY_READ | mCORE_MEMORY_MAPPED },
+	{ 2, "ram", "RAM", "RAM", 0x8000, 0x8000 + RAM_SIZE, RAM_SIZE, mCORE_MEMORY_RW | mCORE_MEMORY_MAPPED },
+	{ 3, "io", "I/O", "I/O", 0xFF00, 0xFF10, 0x10, mCORE_MEMORY_RW | mCORE_MEMORY_MAPPED },
+};
+
+struct StateHashTestCore {
+	struct TestCore d;
+	uint8_t ram[RAM_SIZE];
+	uint8_t io[0x10];
+};
+
+static void _initCore(struct StateHashTestCore* core) {
+	TestCoreInit(&core->d);
+	core->d.blocks = _testBlocks;
+	core->d.nBlocks = sizeof(_testBlocks) / sizeof(*_testBlocks);
+	memset(core->ram, 0, sizeof(core->ram));
+	memset(core->io, 0, sizeof(core->io));
+	TestCoreMapBlock(&core->d, 2, core->ram, sizeof(core->ram));
+	TestCoreMapBlock(&core->d, 3, core->io, sizeof(core->io));
+}
+
+static void _write(struct StateHashTestCore* core, uint32_t offset, uint8_t value) {
+	TestCoreWrite8(&core->d, _testBlocks[2].start + offset, value);
+}
+
+M_TEST_DEFINE(incrementalMatchesFull) {
+	struct StateHashTestCore incremental;
+	struct StateHashTestCore full;
+	_initCore(&incremental);
+	_initCore(&full);
+	struct mStateHasher incrementalHasher;
+	struct mStateHasher fullHasher;
+	mStateHasherInit(&incrementalHasher, &incremental.d.d, true);
+	mStateHasherInit(&fullHasher, &full.d.d, false);
+	assert_true(incrementalHasher.blocks[0].tracked);
+	assert_false(fullHasher.blocks[0].tracked);
+
+	int frame;
+	for (frame = 0; frame < 64; ++frame) {
+		uint32_t offset = (frame * 0x1F3) % RAM_SIZE;
+		_write(&incremental, offset, frame);
+		_write(&full, offset, frame);
+		incremental.d.state.hash += frame;
+		full.d.state.hash += frame;
+		assert_int_equal(mStateHasherUpdate(&incrementalHasher), mStateHasherUpdate(&fullHasher));
+		assert_int_equal(mStateHashCompare(&incrementalHasher.hash, &fullHasher.hash), -1);
+	}
+
+	mStateHasherDeinit(&incrementalHasher);
+	mStateHasherDeinit(&fullHasher);
+	TestCoreDeinit(&incremental.d);
+	TestCoreDeinit(&full.d);
+}
+
+M_TEST_DEFINE(skipsReadOnlyBlocks) {
+	struct StateHashTestCore core;
+	_initCore(&core);
+	struct mStateHasher hasher;
+	mStateHasherInit(&hasher, &core.d.d, false);
+	assert_int_equal(hasher.nBlocks, 2);
+	assert_string_equal(hasher.blocks[0].name, "ram");
+	assert_string_equal(hasher.blocks[1].name, "io");
+	assert_int_equal(hasher.hash.nBlocks, 2);
+	mStateHasherDeinit(&hasher);
+}
+
+M_TEST_DEFINE(compareFindsBlock) {
+	struct StateHashTestCore a;
+	struct StateHashTestCore b;
+	_initCore(&a);
+	_initCore(&b);
+	struct mStateHasher hasherA;
+	struct mStateHasher hasherB;
+	mStateHasherInit(&hasherA, &a.d.d, true);
+	mStateHasherInit(&hasherB, &b.d.d, true);
+	mStateHasherUpdate(&hasherA);
+	mStateHasherUpdate(&hasherB);
+	assert_int_equal(mStateHashCompare(&hasherA.hash, &hasherB.hash), -1);
+
+	TestCoreWrite8(&b.d, _testBlocks[3].start + 3, 1);
+	mStateHasherUpdate(&hasherA);
+	mStateHasherUpdate(&hasherB);
+	assert_int_equal(mStateHashCompare(&hasherA.hash, &hasherB.hash), 1);
+
+	TestCoreWrite8(&b.d, _testBlocks[3].start + 3, 0);
+	_write(&b, RAM_SIZE - 1, 1);
+	mStateHasherUpdate(&hasherA);
+	mStateHasherUpdate(&hasherB);
+	assert_int_equal(mStateHashCompare(&hasherA.hash, &hasherB.hash), 0);
+
+	_write(&b, RAM_SIZE - 1, 0);
+	b.d.state.hash = 1;
+	mStateHasherUpdate(&hasherA);
+	mStateHasherUpdate(&hasherB);
+	assert_int_equal(mStateHashCompare(&hasherA.hash, &hasherB.hash), 2);
+
+	mStateHasherDeinit(&hasherA);
+	mStateHasherDeinit(&hasherB);
+	TestCoreDeinit(&a.d);
+	TestCoreDeinit(&b.d);
+}
+
+M_TEST_DEFINE(hash64Vectors) {
+	static const uint64_t text[5] = { 0 };
+	assert_int_equal(hash64(text, 0, 0), 0xEF46DB3751D8E999ULL);
+	static union {
+		uint64_t align;
+		char text[40];
+	} spam = { .text = "Nobody inspects the spammish repetition" };
+	assert_int_equal(hash64(spam.text, strlen(spam.text), 0), 0xFBCEA83C8A378BF1ULL);
+}
+
+M_TEST_DEFINE(dirtyRestoreMarksChanged) {
+	uint8_t live[RAM_SIZE + 0x80];
+	uint8_t saved[RAM_SIZE + 0x80];
+	memset(live, 0x11, sizeof(live));
+	memset(saved, 0x11, sizeof(saved));
+	saved[0x123] = 0x22;
+	saved[RAM_SIZE + 0x7F] = 0x33;
+
+	struct mCoreMemoryDirty dirty;
+	mCoreMemoryDirtyInit(&dirty, sizeof(live));
+	mCoreMemoryDirtyClear(&dirty);
+	assert_int_equal(mCoreMemoryDirtyRestore(&dirty, live, saved, sizeof(live)), 2);
+	assert_memory_equal(live, saved, sizeof(live));
+	assert_int_equal(dirty.bitmap[0], (1U << 1) | (1U << (RAM_SIZE >> mCORE_MEMORY_DIRTY_PAGE_SHIFT)));
+
+	mCoreMemoryDirtyClear(&dirty);
+	assert_int_equal(mCoreMemoryDirtyRestore(&dirty, live, saved, sizeof(live)), 0);
+	assert_int_equal(dirty.bitmap[0], 0);
+	mCoreMemoryDirtyDeinit(&dirty);
+}
+
+M_TEST_SUITE_DEFINE(mStateHash,
+	cmocka_unit_test(incrementalMatchesFull),
+	cmocka_unit_test(skipsReadOnlyBlocks),
+	cmocka_unit_test(compareFindsBlock),
+	cmocka_unit_test(hash64Vectors),
+	cmocka_unit_test(dirtyRestoreMarksChanged))
@@ -0,0 +1,118 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/blip_buf.h>
+#include <mgba/core/sync.h>
+
+#define RATE 48000
+#define RING_FRAMES 4096
+#define DEVICE_FRAMES 256
+
+struct SyncTestContext {
+	struct mCoreSync sync;
+	blip_t* left;
+	blip_t* right;
+};
+
+M_TEST_SUITE_SETUP(mCoreSync) {
+	struct SyncTestContext* context = calloc(1, sizeof(*context));
+	MutexInit(&context->sync.audioBufferMutex);
+	ConditionInit(&context->sync.audioRequiredCond);
+	context->left = blip_new(0x4000);
+	context->right = blip_new(0x4000);
+	// Equal rates make every clock a sample
+	mCoreSyncSetAudioRates(&context->sync, context->left, context->right, RATE, RATE);
+	mCoreSyncInitAudioRing(&context->sync, RING_FRAMES);
+	*state = context;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(mCoreSync) {
+	struct SyncTestContext* context = *state;
+	mCoreSyncDeinitAudioRing(&context->sync);
+	blip_delete(context->left);
+	blip_delete(context->right);
+	ConditionDeinit(&context->sync.audioRequiredCond);
+	MutexDeinit(&context->sync.audioBufferMutex);
+	free(context);
+	return 0;
+}
+
+static void _produce(struct SyncTestContext* context, unsigned frames) {
+	blip_end_frame(context->left, frames);
+	blip_end_frame(context->right, frames);
+	mCoreSyncLockAudio(&context->sync);
+	mCoreSyncProduceAudio(&context->sync, context->left, context->right, 1024);
+}
+
+static void _drain(struct SyncTestContext* context) {
+	int16_t buffer[RING_FRAMES * 2];
+	mCoreSyncReadAudio(&context->sync, buffer, mCoreSyncAudioAvailable(&context->sync));
+	blip_clear(context->left);
+	blip_clear(context->right);
+}
+
+M_TEST_DEFINE(pullKeepsTargetQueued) {
+	struct SyncTestContext* context = *state;
+	mCoreSyncSetAudioPull(&context->sync, DEVICE_FRAMES);
+	context->sync.audioWait = false;
+	uint32_t overruns = context->sync.audioOverruns;
+
+	// Without waiting, whatever is past the target is dropped instead of queued
+	_produce(context, 3000);
+	assert_int_equal(mCoreSyncAudioAvailable(&context->sync), DEVICE_FRAMES * 2);
+	assert_int_equal(context->sync.audioOverruns - overruns, 3000 - DEVICE_FRAMES * 2);
+	_drain(context);
+
+	mCoreSyncSetAudioPull(&context->sync, 0);
+	_produce(context, 3000);
+	assert_int_equal(mCoreSyncAudioAvailable(&context->sync), 3000);
+	_drain(context);
+}
+
+M_TEST_DEFINE(pullHandsOverEarly) {
+	struct SyncTestContext* context = *state;
+	context->sync.audioWait = false;
+
+	// Batches smaller than the producer asks for stay in the blip buffers...
+	mCoreSyncSetAudioPull(&context->sync, 0);
+	_produce(context, DEVICE_FRAMES);
+	assert_int_equal(mCoreSyncAudioAvailable(&context->sync), 0);
+	blip_clear(context->left);
+	blip_clear(context->right);
+
+	// ...unless a pulling device only needs that many
+	mCoreSyncSetAudioPull(&context->sync, DEVICE_FRAMES);
+	_produce(context, DEVICE_FRAMES);
+	assert_int_equal(mCoreSyncAudioAvailable(&context->sync), DEVICE_FRAMES);
+	_drain(context);
+}
+
+M_TEST_DEFINE(pullUnderrunGrowsTarget) {
+	struct SyncTestContext* context = *state;
+	mCoreSyncSetAudioPull(&context->sync, DEVICE_FRAMES);
+	context->sync.audioWait = false;
+	uint32_t events = context->sync.audioUnderrunEvents;
+	int16_t buffer[DEVICE_FRAMES * 2];
+
+	_produce(context, DEVICE_FRAMES);
+	assert_int_equal(mCoreSyncReadAudio(&context->sync, buffer, DEVICE_FRAMES), DEVICE_FRAMES);
+	assert_int_equal(context->sync.audioUnderrunEvents, events);
+	uint32_t target = context->sync.audioTarget;
+	assert_true(target >= DEVICE_FRAMES * 2);
+
+	assert_int_equal(mCoreSyncReadAudio(&context->sync, buffer, DEVICE_FRAMES), 0);
+	assert_int_equal(context->sync.audioUnderrunEvents, events + 1);
+	assert_true(context->sync.audioTarget >= target + DEVICE_FRAMES - 1);
+	assert_true(context->sync.audioTarget <= RING_FRAMES);
+	_drain(context);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mCoreSync,
+	cmocka_unit_test(pullKeepsTargetQueued),
+	cmocka_unit_test(pullHandsOverEarly),
+	cmocka_unit_test(pullUnderrunGrowsTarget))
@@ -0,0 +1,269 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef TEST_M_TEST_CORE_H
+#define TEST_M_TEST_CORE_H
+
+#include <mgba/core/core.h>
+#include <mgba/core/interface.h>
+
+#define TEST_CORE_MAX_BLOCKS 4
+
+// A stand-in for a real core, for testing code that only drives it through struct mCore. Its whole
+// savestate is how many frames it has run and a hash of the keys held on each of them. Its memory
+// map is whatever blocks the test gives it.
+struct TestCoreState {
+	int32_t frame;
+	uint32_t hash;
+};
+
+struct TestCore {
+	struct mCore d;
+	struct TestCoreState state;
+	uint32_t keys;
+	bool suppressed;
+	int shownFrames;
+
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks;
+	// What backs each of the blocks, by position in the list, and how much of it is loaded
+	void* memory[TEST_CORE_MAX_BLOCKS];
+	size_t memorySize[TEST_CORE_MAX_BLOCKS];
+	struct mCoreMemoryDirty dirty[TEST_CORE_MAX_BLOCKS];
+	// Which segment of banked blocks the bus sees
+	int segment;
+	int busReads;
+};
+
+static size_t _testCoreStateSize(struct mCore* core) {
+	UNUSED(core);
+	return sizeof(struct TestCoreState);
+}
+
+static bool _testCoreSaveState(struct mCore* core, void* state) {
+	memcpy(state, &((struct TestCore*) core)->state, sizeof(struct TestCoreState));
+	return true;
+}
+
+static bool _testCoreLoadState(struct mCore* core, const void* state) {
+	memcpy(&((struct TestCore*) core)->state, state, sizeof(struct TestCoreState));
+	return true;
+}
+
+static void _testCoreSetKeys(struct mCore* core, uint32_t keys) {
+	((struct TestCore*) core)->keys = keys;
+}
+
+static uint32_t _testCoreGetKeys(struct mCore* core) {
+	return ((struct TestCore*) core)->keys;
+}
+
+static void _testCoreSetOutputSuppressed(struct mCore* core, bool video, bool audio) {
+	UNUSED(audio);
+	((struct TestCore*) core)->suppressed = video;
+}
+
+static void _testCoreRunFrame(struct mCore* core) {
+	struct TestCore* test = (struct TestCore*) core;
+	test->state.hash = test->state.hash * 31 + test->keys + 1;
+	++test->state.frame;
+	if (!test->suppressed) {
+		++test->shownFrames;
+	}
+}
+
+static ssize_t _testCoreFindBlock(const struct TestCore* core, size_t id) {
+	size_t i;
+	for (i = 0; i < core->nBlocks; ++i) {
+		if (core->blocks[i].id == id && core->memory[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static size_t _testCoreListMemoryBlocks(const struct mCore* core, const struct mCoreMemoryBlock** blocks) {
+	const struct TestCore* test = (const struct TestCore*) core;
+	*blocks = test->blocks;
+	return test->nBlocks;
+}
+
+static void* _testCoreGetMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
+	struct TestCore* test = (struct TestCore*) core;
+	ssize_t block = _testCoreFindBlock(test, id);
+	if (block < 0) {
+		return NULL;
+	}
+	*sizeOut = test->memorySize[block];
+	return test->memory[block];
+}
+
+static bool _testCoreTrackMemoryBlockDirty(struct mCore* core, size_t id, bool enable) {
+	struct TestCore* test = (struct TestCore*) core;
+	ssize_t block = _testCoreFindBlock(test, id);
+	if (block < 0 || !(test->blocks[block].flags & mCORE_MEMORY_WRITE)) {
+		return false;
+	}
+	if (!enable) {
+		mCoreMemoryDirtyDeinit(&test->dirty[block]);
+	} else if (!test->dirty[block].bitmap) {
+		mCoreMemoryDirtyInit(&test->dirty[block], test->memorySize[block]);
+	}
+	return true;
+}
+
+static const uint32_t* _testCoreGetMemoryBlockDirty(struct mCore* core, size_t id, size_t* pagesOut) {
+	struct TestCore* test = (struct TestCore*) core;
+	ssize_t block = _testCoreFindBlock(test, id);
+	if (block < 0 || !test->dirty[block].bitmap) {
+		return NULL;
+	}
+	*pagesOut = test->dirty[block].nPages;
+	return test->dirty[block].bitmap;
+}
+
+// Finds the block that maps the address, and the offset into what backs it. Segments of banked
+// blocks are stored one after another.
+static ssize_t _testCoreMapAddress(const struct TestCore* core, uint32_t address, int segment, uint32_t* offset) {
+	size_t i;
+	for (i = 0; i < core->nBlocks; ++i) {
+		const struct mCoreMemoryBlock* block = &core->blocks[i];
+		if (!core->memory[i] || address < block->start || address >= block->end) {
+			continue;
+		}
+		*offset = address - block->start;
+		if (block->maxSegment && address >= block->segmentStart) {
+			*offset += (segment < 0 ? core->segment : segment) * (block->end - block->start);
+		}
+		if (*offset >= core->memorySize[i]) {
+			return -1;
+		}
+		return i;
+	}
+	return -1;
+}
+
+static const uint8_t* _testCoreRawPointer(struct mCore* core, uint32_t address, int segment) {
+	struct TestCore* test = (struct TestCore*) core;
+	uint32_t offset;
+	ssize_t block = _testCoreMapAddress(test, address, segment, &offset);
+	if (block < 0) {
+		return NULL;
+	}
+	return &((const uint8_t*) test->memory[block])[offset];
+}
+
+static uint32_t _testCoreRawRead8(struct mCore* core, uint32_t address, int segment) {
+	const uint8_t* pointer = _testCoreRawPointer(core, address, segment);
+	return pointer ? *pointer : 0;
+}
+
+static uint32_t _testCoreRawRead16(struct mCore* core, uint32_t address, int segment) {
+	const uint8_t* pointer = _testCoreRawPointer(core, address, segment);
+	uint32_t value = 0;
+	if (pointer) {
+		LOAD_16LE(value, 0, pointer);
+	}
+	return value;
+}
+
+static uint32_t _testCoreRawRead32(struct mCore* core, uint32_t address, int segment) {
+	const uint8_t* pointer = _testCoreRawPointer(core, address, segment);
+	uint32_t value = 0;
+	if (pointer) {
+		LOAD_32LE(value, 0, pointer);
+	}
+	return value;
+}
+
+static uint32_t _testCoreBusRead(const struct TestCore* core, uint32_t address) {
+	uint32_t offset;
+	ssize_t block = _testCoreMapAddress(core, address, -1, &offset);
+	if (block < 0) {
+		// Open bus
+		return (address >> 1) & 0xFF;
+	}
+	return ((const uint8_t*) core->memory[block])[offset];
+}
+
+static uint32_t _testCoreBusRead8(struct mCore* core, uint32_t address) {
+	struct TestCore* test = (struct TestCore*) core;
+	++test->busReads;
+	return _testCoreBusRead(test, address);
+}
+
+static uint32_t _testCoreBusRead16(struct mCore* core, uint32_t address) {
+	struct TestCore* test = (struct TestCore*) core;
+	++test->busReads;
+	return _testCoreBusRead(test, address) | (_testCoreBusRead(test, address + 1) << 8);
+}
+
+static uint32_t _testCoreBusRead32(struct mCore* core, uint32_t address) {
+	struct TestCore* test = (struct TestCore*) core;
+	++test->busReads;
+	uint32_t value = 0;
+	int i;
+	for (i = 3; i >= 0; --i) {
+		value = (value << 8) | _testCoreBusRead(test, address + i);
+	}
+	return value;
+}
+
+static void _testCoreClearMemoryBlockDirty(struct mCore* core, size_t id) {
+	struct TestCore* test = (struct TestCore*) core;
+	ssize_t block = _testCoreFindBlock(test, id);
+	if (block >= 0) {
+		mCoreMemoryDirtyClear(&test->dirty[block]);
+	}
+}
+
+static inline void TestCoreInit(struct TestCore* core) {
+	memset(core, 0, sizeof(*core));
+	core->d.stateSize = _testCoreStateSize;
+	core->d.saveState = _testCoreSaveState;
+	core->d.loadState = _testCoreLoadState;
+	core->d.setKeys = _testCoreSetKeys;
+	core->d.getKeys = _testCoreGetKeys;
+	core->d.setOutputSuppressed = _testCoreSetOutputSuppressed;
+	core->d.runFrame = _testCoreRunFrame;
+	// Each step is a whole frame
+	core->d.step = _testCoreRunFrame;
+	core->d.listMemoryBlocks = _testCoreListMemoryBlocks;
+	core->d.getMemoryBlock = _testCoreGetMemoryBlock;
+	core->d.trackMemoryBlockDirty = _testCoreTrackMemoryBlockDirty;
+	core->d.getMemoryBlockDirty = _testCoreGetMemoryBlockDirty;
+	core->d.clearMemoryBlockDirty = _testCoreClearMemoryBlockDirty;
+	core->d.rawRead8 = _testCoreRawRead8;
+	core->d.rawRead16 = _testCoreRawRead16;
+	core->d.rawRead32 = _testCoreRawRead32;
+	core->d.busRead8 = _testCoreBusRead8;
+	core->d.busRead16 = _testCoreBusRead16;
+	core->d.busRead32 = _testCoreBusRead32;
+}
+
+static inline void TestCoreDeinit(struct TestCore* core) {
+	size_t i;
+	for (i = 0; i < TEST_CORE_MAX_BLOCKS; ++i) {
+		mCoreMemoryDirtyDeinit(&core->dirty[i]);
+	}
+}
+
+static inline void TestCoreMapBlock(struct TestCore* core, size_t block, void* memory, size_t size) {
+	core->memory[block] = memory;
+	core->memorySize[block] = size;
+}
+
+// Writes the way the core itself would, marking the page dirty if the block is being tracked
+static inline void TestCoreWrite8(struct TestCore* core, uint32_t address, uint8_t value) {
+	uint32_t offset;
+	ssize_t block = _testCoreMapAddress(core, address, -1, &offset);
+	if (block < 0) {
+		return;
+	}
+	((uint8_t*) core->memory[block])[offset] = value;
+	mCoreMemoryDirtyMark(&core->dirty[block], offset);
+}
+
+#endif
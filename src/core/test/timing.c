@@ -0,0 +1,180 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/timing.h>
+
+struct mTimingTestContext {
+	struct mTiming timing;
+	int32_t cycles;
+	int32_t nextEvent;
+	size_t nFired;
+	uint32_t lastWhen;
+	bool outOfOrder;
+};
+
+static void _fire(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	struct mTimingTestContext* ctx = context;
+	uint32_t when = timing->masterCycles - cyclesLate;
+	if (ctx->nFired && (int32_t) (when - ctx->lastWhen) < 0) {
+		ctx->outOfOrder = true;
+	}
+	ctx->lastWhen = when;
+	++ctx->nFired;
+}
+
+static void _initEvent(struct mTimingEvent* event, struct mTimingTestContext* ctx, unsigned priority) {
+	event->context = ctx;
+	event->callback = _fire;
+	event->name = "Test";
+	event->priority = priority;
+	event->index = (size_t) -1;
+}
+
+M_TEST_SUITE_SETUP(mTiming) {
+	struct mTimingTestContext* ctx = calloc(1, sizeof(*ctx));
+	ctx->nextEvent = INT_MAX;
+	mTimingInit(&ctx->timing, &ctx->cycles, &ctx->nextEvent);
+	*state = ctx;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(mTiming) {
+	struct mTimingTestContext* ctx = *state;
+	mTimingDeinit(&ctx->timing);
+	free(ctx);
+	return 0;
+}
+
+M_TEST_DEFINE(scheduleOrder) {
+	struct mTimingTestContext* ctx = *state;
+	struct mTimingEvent events[4];
+	size_t i;
+	for (i = 0; i < 4; ++i) {
+		_initEvent(&events[i], ctx, 0);
+	}
+	mTimingClear(&ctx->timing);
+	mTimingSchedule(&ctx->timing, &events[0], 40);
+	mTimingSchedule(&ctx->timing, &events[1], 10);
+	mTimingSchedule(&ctx->timing, &events[2], 30);
+	mTimingSchedule(&ctx->timing, &events[3], 20);
+	assert_int_equal(ctx->nextEvent, 10);
+	assert_int_equal(mTimingNextEvent(&ctx->timing), 10);
+	assert_int_equal(mTimingUntil(&ctx->timing, &events[2]), 30);
+	assert_int_equal(mTimingTick(&ctx->timing, 25), 5);
+	assert_false(mTimingIsScheduled(&ctx->timing, &events[1]));
+	assert_false(mTimingIsScheduled(&ctx->timing, &events[3]));
+	assert_true(mTimingIsScheduled(&ctx->timing, &events[0]));
+	assert_true(mTimingIsScheduled(&ctx->timing, &events[2]));
+	mTimingTick(&ctx->timing, 15);
+	assert_null(ctx->timing.root);
+	assert_int_equal(ctx->timing.listSize, 0);
+}
+
+M_TEST_DEFINE(priorityTiebreak) {
+	struct mTimingTestContext* ctx = *state;
+	struct mTimingEvent low;
+	struct mTimingEvent high;
+	struct mTimingEvent late;
+	_initEvent(&low, ctx, 2);
+	_initEvent(&high, ctx, 1);
+	_initEvent(&late, ctx, 1);
+	mTimingClear(&ctx->timing);
+	mTimingSchedule(&ctx->timing, &low, 10);
+	mTimingSchedule(&ctx->timing, &late, 10);
+	mTimingSchedule(&ctx->timing, &high, 10);
+	assert_ptr_equal(ctx->timing.root, &late);
+	mTimingDeschedule(&ctx->timing, &late);
+	assert_ptr_equal(ctx->timing.root, &high);
+	mTimingDeschedule(&ctx->timing, &high);
+	assert_ptr_equal(ctx->timing.root, &low);
+	assert_false(mTimingIsScheduled(&ctx->timing, &high));
+}
+
+M_TEST_DEFINE(reschedule) {
+	struct mTimingTestContext* ctx = *state;
+	struct mTimingEvent a;
+	struct mTimingEvent b;
+	_initEvent(&a, ctx, 0);
+	_initEvent(&b, ctx, 0);
+	mTimingClear(&ctx->timing);
+	mTimingSchedule(&ctx->timing, &a, 10);
+	mTimingSchedule(&ctx->timing, &b, 20);
+	mTimingSchedule(&ctx->timing, &a, 30);
+	assert_int_equal(ctx->timing.listSize, 2);
+	assert_ptr_equal(ctx->timing.root, &b);
+	assert_ptr_equal(b.next, &a);
+	// Moving it ahead of its old place instead
+	mTimingSchedule(&ctx->timing, &a, 5);
+	assert_int_equal(ctx->timing.listSize, 2);
+	assert_ptr_equal(ctx->timing.root, &a);
+	assert_ptr_equal(a.next, &b);
+	assert_null(b.next);
+	mTimingDeschedule(&ctx->timing, &a);
+	mTimingDeschedule(&ctx->timing, &a);
+	assert_int_equal(ctx->timing.listSize, 1);
+}
+
+M_TEST_DEFINE(interrupt) {
+	struct mTimingTestContext* ctx = *state;
+	struct mTimingEvent a;
+	_initEvent(&a, ctx, 0);
+	mTimingClear(&ctx->timing);
+	mTimingSchedule(&ctx->timing, &a, 0);
+	mTimingInterrupt(&ctx->timing);
+	assert_true(mTimingIsScheduled(&ctx->timing, &a));
+	ctx->nFired = 0;
+	mTimingTick(&ctx->timing, 0);
+	assert_int_equal(ctx->nFired, 0);
+	mTimingTick(&ctx->timing, 0);
+	assert_int_equal(ctx->nFired, 1);
+}
+
+M_TEST_DEFINE(heapFallback) {
+	struct mTimingTestContext* ctx = *state;
+	struct mTimingEvent events[mTIMING_LIST_MAX * 2];
+	size_t nEvents = sizeof(events) / sizeof(*events);
+	size_t i;
+	mTimingClear(&ctx->timing);
+	for (i = 0; i < nEvents; ++i) {
+		_initEvent(&events[i], ctx, i & 3);
+		mTimingSchedule(&ctx->timing, &events[i], (i * 37) % 101 + 1);
+		assert_int_equal(ctx->timing.useHeap, i >= mTIMING_LIST_MAX);
+	}
+	for (i = 0; i < nEvents; i += 5) {
+		mTimingSchedule(&ctx->timing, &events[i], (i * 13) % 101 + 1);
+	}
+	for (i = 1; i < nEvents; i += 7) {
+		mTimingDeschedule(&ctx->timing, &events[i]);
+		assert_false(mTimingIsScheduled(&ctx->timing, &events[i]));
+	}
+	size_t nScheduled = 0;
+	for (i = 0; i < nEvents; ++i) {
+		nScheduled += mTimingIsScheduled(&ctx->timing, &events[i]);
+	}
+	assert_int_equal(nScheduled, nEvents - (nEvents + 5) / 7);
+	assert_true(ctx->timing.useHeap);
+
+	ctx->nFired = 0;
+	ctx->outOfOrder = false;
+	for (i = 0; i < 102; ++i) {
+		mTimingTick(&ctx->timing, 1);
+		if (ctx->nFired >= nScheduled - mTIMING_LIST_MAX / 2) {
+			assert_false(ctx->timing.useHeap);
+		}
+	}
+	assert_int_equal(ctx->nFired, nScheduled);
+	assert_false(ctx->outOfOrder);
+	assert_null(ctx->timing.root);
+	assert_int_equal(ctx->timing.listSize, 0);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mTiming,
+	cmocka_unit_test(scheduleOrder),
+	cmocka_unit_test(priorityTiebreak),
+	cmocka_unit_test(reschedule),
+	cmocka_unit_test(interrupt),
+	cmocka_unit_test(heapFallback))
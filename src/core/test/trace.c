@@ -0,0 +1,77 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/trace.h>
+#include <mgba-util/vfs.h>
+
+static char* _export(void) {
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mTraceWriteChrome(vf));
+	size_t size = vf->size(vf);
+	char* json = calloc(size + 1, 1);
+	vf->seek(vf, 0, SEEK_SET);
+	vf->read(vf, json, size);
+	vf->close(vf);
+	return json;
+}
+
+static size_t _count(const char* haystack, const char* needle) {
+	size_t count = 0;
+	while ((haystack = strstr(haystack, needle))) {
+		++count;
+		++haystack;
+	}
+	return count;
+}
+
+M_TEST_DEFINE(disabled) {
+	mTraceSetEnabled(false);
+	assert_int_equal(mTraceBegin(), 0);
+	mTraceClear();
+	mTraceEnd("never", 0);
+	char* json = _export();
+	assert_null(strstr(json, "\"never\""));
+	free(json);
+}
+
+M_TEST_DEFINE(exportChrome) {
+	mTraceClear();
+	mTraceSetThreadName("Test \"Thread\"");
+	mTraceRecord("frame", 100, 150);
+	mTraceRecord("render", 120, 110);
+	char* json = _export();
+	assert_int_equal(strncmp(json, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 39), 0);
+	assert_non_null(strstr(json, "\"args\":{\"name\":\"Test \\\"Thread\\\"\"}"));
+	assert_non_null(strstr(json, "\"ts\":100,\"dur\":50,\"name\":\"frame\"}"));
+	// Spans that end before they start come out empty rather than huge
+	assert_non_null(strstr(json, "\"ts\":120,\"dur\":0,\"name\":\"render\"}"));
+	assert_non_null(strstr(json, "\n]}\n"));
+	free(json);
+
+	mTraceClear();
+	json = _export();
+	assert_null(strstr(json, "\"frame\""));
+	free(json);
+}
+
+M_TEST_DEFINE(wrapAround) {
+	mTraceClear();
+	size_t i;
+	for (i = 0; i < mTRACE_THREAD_EVENTS + 10; ++i) {
+		mTraceRecord(i < 10 ? "old" : "new", i + 1, i + 2);
+	}
+	char* json = _export();
+	assert_int_equal(_count(json, "\"old\""), 0);
+	// The slot after the newest event is treated as in flight, so one more is dropped
+	assert_int_equal(_count(json, "\"new\""), mTRACE_THREAD_EVENTS - 1);
+	free(json);
+}
+
+M_TEST_SUITE_DEFINE(mTrace,
+	cmocka_unit_test(disabled),
+	cmocka_unit_test(exportChrome),
+	cmocka_unit_test(wrapAround))
@@ -8,6 +8,9 @@
 #include <mgba/core/blip_buf.h>
 #include <mgba/core/core.h>
 #include <mgba/core/serialize.h>
+#include <mgba/core/trace.h>
+#include <mgba/feature/video-logger.h>
+#include <mgba-util/memory.h>
 #include <mgba-util/patch.h>
 #include <mgba-util/vfs.h>
 
@@ -38,10 +41,23 @@ static BOOL CALLBACK _createTLS(PINIT_ONCE once, PVOID param, PVOID* context) {
 #endif
 
 static void _mCoreLog(struct mLogger* logger, int category, enum mLogLevel level, const char* format, va_list args);
+static void _mCoreLogPrint(struct mLogger* logger, int category, enum mLogLevel level, const char* format, va_list args);
+
+static struct mLogger _printLogger = {
+	.log = _mCoreLogPrint
+};
+
+// The state is only changed with stateMutex held, but the emulation thread's run loop and the
+// polling queries read it without the lock, so every access outside the mutex is atomic
+static inline enum mCoreThreadState _loadState(struct mCoreThreadInternal* threadContext) {
+	enum mCoreThreadState state;
+	ATOMIC_LOAD(state, threadContext->state);
+	return state;
+}
 
 static void _changeState(struct mCoreThreadInternal* threadContext, enum mCoreThreadState newState, bool broadcast) {
 	MutexLock(&threadContext->stateMutex);
-	threadContext->state = newState;
+	ATOMIC_STORE(threadContext->state, newState);
 	if (broadcast) {
 		ConditionWake(&threadContext->stateCond);
 	}
@@ -92,7 +108,7 @@ static void _waitUntilNotState(struct mCoreThreadInternal* threadContext, enum m
 }
 
 static void _pauseThread(struct mCoreThreadInternal* threadContext) {
-	threadContext->state = THREAD_PAUSING;
+	ATOMIC_STORE(threadContext->state, THREAD_PAUSING);
 	_waitUntilNotState(threadContext, THREAD_PAUSING);
 }
 
@@ -101,22 +117,82 @@ void _frameStarted(void* context) {
 	if (!thread) {
 		return;
 	}
+	thread->impl->keysPolled = false;
+	if (thread->impl->runAheadSpeculating) {
+		return;
+	}
+#ifdef ENABLE_TRACE
+	thread->impl->traceFrameStart = mTraceBegin();
+#endif
 	if (thread->core->opts.rewindEnable && thread->core->opts.rewindBufferCapacity > 0) {
-		if (thread->impl->state != THREAD_REWINDING) {
+		uint64_t start = mCoreMetricsTime();
+		mTRACE_BEGIN(trace);
+		if (_loadState(thread->impl) != THREAD_REWINDING) {
 			mCoreRewindAppend(&thread->impl->rewind, thread->core);
-		} else if (thread->impl->state == THREAD_REWINDING) {
+		} else {
 			if (!mCoreRewindRestore(&thread->impl->rewind, thread->core)) {
 				mCoreRewindAppend(&thread->impl->rewind, thread->core);
 			}
 		}
+		mTRACE_END(trace, "rewind");
+		thread->impl->rewindTime += mCoreMetricsTime() - start;
 	}
 }
 
+static void _pollKeys(struct mCoreThread* thread) {
+	// Run-ahead has to replay the same keys for every frame it runs, so it samples them up front
+	if (!thread->keysReadCallback || !thread->core->opts.lateInput || thread->core->opts.runAhead > 0) {
+		return;
+	}
+	if (thread->impl->keysPolled) {
+		return;
+	}
+	thread->impl->keysPolled = true;
+	thread->keysReadCallback(thread);
+}
+
+static void _recordMetrics(struct mCoreThread* thread) {
+	struct mCoreThreadInternal* impl = thread->impl;
+	struct mCoreMetrics* metrics = &impl->metricsRecorder.metrics;
+	uint64_t waits[mCORE_METRICS_PHASE_MAX] = {
+		[mCORE_METRICS_VIDEO_SYNC] = impl->sync.videoWaitTime,
+		[mCORE_METRICS_AUDIO_SYNC] = impl->sync.audioWaitTime,
+		[mCORE_METRICS_REWIND] = impl->rewindTime,
+	};
+	if (thread->core->videoLogger) {
+		waits[mCORE_METRICS_RENDER] = thread->core->videoLogger->blockedTime;
+	}
+	mCoreMetricsRecorderFrame(&impl->metricsRecorder, waits);
+	mCoreMetricsSampleVideoLogger(metrics, thread->core->videoLogger);
+	uint32_t audioUnderruns;
+	uint32_t audioOverruns;
+	ATOMIC_LOAD(audioUnderruns, impl->sync.audioUnderruns);
+	ATOMIC_LOAD(audioOverruns, impl->sync.audioOverruns);
+	metrics->audioUnderruns = audioUnderruns;
+	metrics->audioOverruns = audioOverruns;
+	uint32_t audioUnderrunEvents;
+	ATOMIC_LOAD(audioUnderrunEvents, impl->sync.audioUnderrunEvents);
+	metrics->audioUnderrunEvents = audioUnderrunEvents;
+	ATOMIC_LOAD(metrics->audioTarget, impl->sync.audioTarget);
+	ATOMIC_LOAD(metrics->audioJitterMax, impl->sync.audioJitterMax);
+
+	MutexLock(&impl->metricsMutex);
+	impl->metrics = *metrics;
+	MutexUnlock(&impl->metricsMutex);
+}
+
 void _frameEnded(void* context) {
 	struct mCoreThread* thread = context;
-	if (!thread) {
+	if (!thread || thread->impl->runAheadHidden) {
 		return;
 	}
+#ifdef ENABLE_TRACE
+	mTraceEnd("frame", thread->impl->traceFrameStart);
+	thread->impl->traceFrameStart = 0;
+#endif
+	_recordMetrics(thread);
+	// Keep the keys from going stale in frames where the game never reads them
+	_pollKeys(thread);
 	if (thread->frameCallback) {
 		thread->frameCallback(thread);
 	}
@@ -130,6 +206,14 @@ void _crashed(void* context) {
 	_changeState(thread->impl, THREAD_CRASHED, true);
 }
 
+void _keysRead(void* context) {
+	struct mCoreThread* thread = context;
+	if (!thread) {
+		return;
+	}
+	_pollKeys(thread);
+}
+
 void _coreSleep(void* context) {
 	struct mCoreThread* thread = context;
 	if (!thread) {
@@ -140,6 +224,131 @@ void _coreSleep(void* context) {
 	}
 }
 
+static void _runAhead(struct mCoreThread* threadContext) {
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	struct mCore* core = threadContext->core;
+	size_t size = mCoreSaveStateBuffer(core, NULL, 0, 0);
+	if (size > impl->runAheadStateSize) {
+		if (impl->runAheadState) {
+			mappedMemoryFree(impl->runAheadState, impl->runAheadStateSize);
+		}
+		impl->runAheadState = anonymousMemoryMap(size);
+		impl->runAheadStateSize = size;
+	}
+
+	// Advance the real timeline, keeping its audio but not its video
+	impl->runAheadHidden = true;
+	core->setOutputSuppressed(core, true, false);
+	core->runFrame(core);
+
+	if (_loadState(impl) == THREAD_RUNNING) {
+		mCoreSaveStateBuffer(core, impl->runAheadState, size, 0);
+		impl->runAheadSpeculating = true;
+		core->setOutputSuppressed(core, true, true);
+		int i;
+		for (i = 1; i < core->opts.runAhead; ++i) {
+			core->runFrame(core);
+		}
+
+		// Only the last speculative frame is shown
+		impl->runAheadHidden = false;
+		core->setOutputSuppressed(core, false, true);
+		core->runFrame(core);
+		mCoreLoadStateBuffer(core, impl->runAheadState, size, 0);
+		impl->runAheadSpeculating = false;
+	}
+
+	impl->runAheadHidden = false;
+	core->setOutputSuppressed(core, false, false);
+}
+
+static THREAD_ENTRY _runAheadThread(void* context) {
+	struct mCoreThread* threadContext = context;
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	struct mCore* core = threadContext->runAheadCore;
+	ThreadSetName("Run-ahead Thread");
+	mTRACE_THREAD("Run-ahead Thread");
+
+	MutexLock(&impl->runAheadMutex);
+	while (true) {
+		while (!impl->runAheadPending && !impl->runAheadExiting) {
+			ConditionWait(&impl->runAheadCond, &impl->runAheadMutex);
+		}
+		if (impl->runAheadExiting) {
+			break;
+		}
+		impl->runAheadPending = false;
+		impl->runAheadBusy = true;
+		MutexUnlock(&impl->runAheadMutex);
+
+		// The state buffer is left alone by the emulation thread until this job is done
+		bool present = mCoreLoadStateBuffer(core, impl->runAheadState, impl->runAheadJobSize, 0);
+		if (present) {
+			core->setKeys(core, impl->runAheadKeys);
+			core->setOutputSuppressed(core, true, true);
+			int i;
+			for (i = 1; i < impl->runAheadFrames; ++i) {
+				core->runFrame(core);
+			}
+			core->setOutputSuppressed(core, false, true);
+			core->runFrame(core);
+		}
+
+		MutexLock(&impl->runAheadMutex);
+		impl->runAheadBusy = false;
+		impl->runAheadPresent = present;
+		ConditionWake(&impl->runAheadDoneCond);
+	}
+	MutexUnlock(&impl->runAheadMutex);
+	return 0;
+}
+
+static void _runAheadSecondInstance(struct mCoreThread* threadContext) {
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	struct mCore* core = threadContext->core;
+
+	// The primary only keeps the real timeline and its audio; every shown frame comes from the second instance
+	impl->runAheadHidden = true;
+	core->setOutputSuppressed(core, true, false);
+	core->runFrame(core);
+	core->setOutputSuppressed(core, false, false);
+	impl->runAheadHidden = false;
+
+	MutexLock(&impl->runAheadMutex);
+	while (impl->runAheadPending || impl->runAheadBusy) {
+		ConditionWait(&impl->runAheadDoneCond, &impl->runAheadMutex);
+	}
+	bool present = impl->runAheadPresent;
+	impl->runAheadPresent = false;
+	MutexUnlock(&impl->runAheadMutex);
+
+	// The video buffer is shared, so the finished frame has to be handed off before the next job draws over it
+	if (present) {
+		mCoreSyncPostFrame(&impl->sync);
+		if (threadContext->frameCallback) {
+			threadContext->frameCallback(threadContext);
+		}
+	}
+
+	size_t size = mCoreSaveStateBuffer(core, NULL, 0, 0);
+	if (size > impl->runAheadStateSize) {
+		if (impl->runAheadState) {
+			mappedMemoryFree(impl->runAheadState, impl->runAheadStateSize);
+		}
+		impl->runAheadState = anonymousMemoryMap(size);
+		impl->runAheadStateSize = size;
+	}
+	mCoreSaveStateBuffer(core, impl->runAheadState, size, 0);
+	MutexLock(&impl->runAheadMutex);
+	impl->runAheadJobSize = size;
+	impl->runAheadKeys = core->getKeys(core);
+	// The result is shown one real frame later, so run one extra frame to make up for it
+	impl->runAheadFrames = core->opts.runAhead + 1;
+	impl->runAheadPending = true;
+	ConditionWake(&impl->runAheadCond);
+	MutexUnlock(&impl->runAheadMutex);
+}
+
 static THREAD_ENTRY _mCoreThreadRun(void* context) {
 	struct mCoreThread* threadContext = context;
 #ifdef USE_PTHREADS
@@ -151,6 +360,7 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 #endif
 
 	ThreadSetName("CPU Thread");
+	mTRACE_THREAD("CPU Thread");
 
 #if !defined(_WIN32) && defined(USE_PTHREADS)
 	sigset_t signals;
@@ -159,15 +369,33 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 #endif
 
 	struct mCore* core = threadContext->core;
+
+	// Pin before the core touches its memory, so first-touch allocation places it on this CPU's node
+	uint64_t affinity;
+	if (mCoreConfigGetCPUMaskValue(&core->config, "threadAffinity", &affinity) && affinity) {
+		if (ThreadSetAffinity(affinity) < 0) {
+			mLOG(STATUS, WARN, "Could not set CPU thread affinity");
+		}
+	}
+	int highPriority;
+	if (mCoreConfigGetIntValue(&core->config, "threadHighPriority", &highPriority) && highPriority) {
+		if (ThreadSetHighPriority() < 0) {
+			mLOG(STATUS, WARN, "Could not raise CPU thread priority");
+		}
+	}
+
 	struct mCoreCallbacks callbacks = {
 		.videoFrameStarted = _frameStarted,
 		.videoFrameEnded = _frameEnded,
 		.coreCrashed = _crashed,
 		.sleep = _coreSleep,
+		.keysRead = _keysRead,
 		.context = threadContext
 	};
 	core->addCoreCallbacks(core, &callbacks);
 	core->setSync(core, &threadContext->impl->sync);
+	mAsyncWriterInit(&threadContext->impl->asyncWriter);
+	core->asyncWriter = &threadContext->impl->asyncWriter;
 
 	struct mLogFilter filter;
 	if (!threadContext->logger.d.filter) {
@@ -189,7 +417,12 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 	}
 
 	struct mCoreThreadInternal* impl = threadContext->impl;
-	while (impl->state < THREAD_EXITING) {
+	if (threadContext->runAheadCore) {
+		threadContext->runAheadCore->setSync(threadContext->runAheadCore, NULL);
+		threadContext->runAheadCore->reset(threadContext->runAheadCore);
+		ThreadCreate(&impl->runAheadThread, _runAheadThread, threadContext);
+	}
+	while (_loadState(impl) < THREAD_EXITING) {
 #ifdef USE_DEBUGGERS
 		struct mDebugger* debugger = core->debugger;
 		if (debugger) {
@@ -200,8 +433,17 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 		} else
 #endif
 		{
-			while (impl->state <= THREAD_MAX_RUNNING) {
-				core->runLoop(core);
+			enum mCoreThreadState state;
+			while ((state = _loadState(impl)) <= THREAD_MAX_RUNNING) {
+				if (core->opts.runAhead > 0 && state == THREAD_RUNNING) {
+					if (threadContext->runAheadCore) {
+						_runAheadSecondInstance(threadContext);
+					} else {
+						_runAhead(threadContext);
+					}
+				} else {
+					core->runLoop(core);
+				}
 			}
 		}
 
@@ -212,14 +454,14 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 
 			switch (deferred) {
 			case THREAD_INTERRUPTING:
-				impl->state = THREAD_INTERRUPTED;
+				ATOMIC_STORE(impl->state, THREAD_INTERRUPTED);
 				ConditionWake(&impl->stateCond);
 				break;
 			case THREAD_PAUSING:
-				impl->state = THREAD_PAUSED;
+				ATOMIC_STORE(impl->state, THREAD_PAUSED);
 				break;
 			case THREAD_RESETING:
-				impl->state = THREAD_RUNNING;
+				ATOMIC_STORE(impl->state, THREAD_RUNNING);
 				break;
 			default:
 				break;
@@ -239,12 +481,14 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 				if (impl->sync.audioWait) {
 					MutexUnlock(&impl->stateMutex);
 					mCoreSyncLockAudio(&impl->sync);
-					mCoreSyncProduceAudio(&impl->sync, core->getAudioChannel(core, 0), core->getAudioBufferSize(core));
+					mCoreSyncProduceAudio(&impl->sync, core->getAudioChannel(core, 0), core->getAudioChannel(core, 1), core->getAudioBufferSize(core));
 					MutexLock(&impl->stateMutex);
 				}
 			}
 		}
 		MutexUnlock(&impl->stateMutex);
+		// Time spent out of the run loop isn't part of any frame
+		mCoreMetricsRecorderSkip(&impl->metricsRecorder);
 		switch (deferred) {
 		case THREAD_PAUSING:
 			if (threadContext->pauseCallback) {
@@ -260,7 +504,7 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 			if (threadContext->run) {
 				threadContext->run(threadContext);
 			}
-			threadContext->impl->state = threadContext->impl->savedState;
+			ATOMIC_STORE(threadContext->impl->state, threadContext->impl->savedState);
 			break;
 		case THREAD_RESETING:
 			core->reset(core);
@@ -273,9 +517,19 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 		}
 	}
 
-	while (impl->state < THREAD_SHUTDOWN) {
+	while (_loadState(impl) < THREAD_SHUTDOWN) {
 		_changeState(impl, THREAD_SHUTDOWN, false);
 	}
+	// The sync goes away with the thread, so let the core finish anything still using it
+	core->setSync(core, NULL);
+
+	if (threadContext->runAheadCore) {
+		MutexLock(&impl->runAheadMutex);
+		impl->runAheadExiting = true;
+		ConditionWake(&impl->runAheadCond);
+		MutexUnlock(&impl->runAheadMutex);
+		ThreadJoin(impl->runAheadThread);
+	}
 
 	if (core->opts.rewindEnable) {
 		 mCoreRewindContextDeinit(&impl->rewind);
@@ -285,6 +539,8 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 		threadContext->cleanCallback(threadContext);
 	}
 	core->clearCoreCallbacks(core);
+	core->asyncWriter = NULL;
+	mAsyncWriterDeinit(&impl->asyncWriter);
 
 	if (threadContext->logger.d.filter == &filter) {
 		mLogFilterDeinit(&filter);
@@ -309,6 +565,11 @@ bool mCoreThreadStart(struct mCoreThread* threadContext) {
 
 	MutexInit(&threadContext->impl->stateMutex);
 	ConditionInit(&threadContext->impl->stateCond);
+	MutexInit(&threadContext->impl->runAheadMutex);
+	ConditionInit(&threadContext->impl->runAheadCond);
+	ConditionInit(&threadContext->impl->runAheadDoneCond);
+	MutexInit(&threadContext->impl->metricsMutex);
+	mCoreMetricsRecorderInit(&threadContext->impl->metricsRecorder);
 
 	MutexInit(&threadContext->impl->sync.videoFrameMutex);
 	ConditionInit(&threadContext->impl->sync.videoFrameAvailableCond);
@@ -328,7 +589,13 @@ bool mCoreThreadStart(struct mCoreThread* threadContext) {
 
 	threadContext->impl->sync.audioWait = threadContext->core->opts.audioSync;
 	threadContext->impl->sync.videoFrameWait = threadContext->core->opts.videoSync;
+	threadContext->impl->sync.framePacing = threadContext->core->opts.framePacing;
 	threadContext->impl->sync.fpsTarget = threadContext->core->opts.fpsTarget;
+	threadContext->impl->sync.audioRateControl = threadContext->core->opts.audioRateControl;
+
+	if (threadContext->logger.d.log == _mCoreLog) {
+		threadContext->impl->asyncLogger = mAsyncLoggerCreate(&_printLogger);
+	}
 
 	MutexLock(&threadContext->impl->stateMutex);
 	ThreadCreate(&threadContext->impl->thread, _mCoreThreadRun, threadContext);
@@ -344,45 +611,33 @@ bool mCoreThreadHasStarted(struct mCoreThread* threadContext) {
 	if (!threadContext->impl) {
 		return false;
 	}
-	bool hasStarted;
-	MutexLock(&threadContext->impl->stateMutex);
-	hasStarted = threadContext->impl->state > THREAD_INITIALIZED;
-	MutexUnlock(&threadContext->impl->stateMutex);
-	return hasStarted;
+	return _loadState(threadContext->impl) > THREAD_INITIALIZED;
 }
 
 bool mCoreThreadHasExited(struct mCoreThread* threadContext) {
 	if (!threadContext->impl) {
 		return false;
 	}
-	bool hasExited;
-	MutexLock(&threadContext->impl->stateMutex);
-	hasExited = threadContext->impl->state > THREAD_EXITING;
-	MutexUnlock(&threadContext->impl->stateMutex);
-	return hasExited;
+	return _loadState(threadContext->impl) > THREAD_EXITING;
 }
 
 bool mCoreThreadHasCrashed(struct mCoreThread* threadContext) {
 	if (!threadContext->impl) {
 		return false;
 	}
-	bool hasExited;
-	MutexLock(&threadContext->impl->stateMutex);
-	hasExited = threadContext->impl->state == THREAD_CRASHED;
-	MutexUnlock(&threadContext->impl->stateMutex);
-	return hasExited;
+	return _loadState(threadContext->impl) == THREAD_CRASHED;
 }
 
 void mCoreThreadMarkCrashed(struct mCoreThread* threadContext) {
 	MutexLock(&threadContext->impl->stateMutex);
-	threadContext->impl->state = THREAD_CRASHED;
+	ATOMIC_STORE(threadContext->impl->state, THREAD_CRASHED);
 	MutexUnlock(&threadContext->impl->stateMutex);
 }
 
 void mCoreThreadEnd(struct mCoreThread* threadContext) {
 	MutexLock(&threadContext->impl->stateMutex);
 	_waitOnInterrupt(threadContext->impl);
-	threadContext->impl->state = THREAD_EXITING;
+	ATOMIC_STORE(threadContext->impl->state, THREAD_EXITING);
 	ConditionWake(&threadContext->impl->stateCond);
 	MutexUnlock(&threadContext->impl->stateMutex);
 	MutexLock(&threadContext->impl->sync.audioBufferMutex);
@@ -403,7 +658,7 @@ void mCoreThreadReset(struct mCoreThread* threadContext) {
 	if (threadContext->impl->state == THREAD_INTERRUPTED || threadContext->impl->state == THREAD_INTERRUPTING) {
 		threadContext->impl->savedState = THREAD_RESETING;
 	} else {
-		threadContext->impl->state = THREAD_RESETING;
+		ATOMIC_STORE(threadContext->impl->state, THREAD_RESETING);
 	}
 	ConditionWake(&threadContext->impl->stateCond);
 	MutexUnlock(&threadContext->impl->stateMutex);
@@ -414,9 +669,16 @@ void mCoreThreadJoin(struct mCoreThread* threadContext) {
 		return;
 	}
 	ThreadJoin(threadContext->impl->thread);
+	if (threadContext->impl->asyncLogger) {
+		mAsyncLoggerDestroy(threadContext->impl->asyncLogger);
+	}
 
 	MutexDeinit(&threadContext->impl->stateMutex);
 	ConditionDeinit(&threadContext->impl->stateCond);
+	MutexDeinit(&threadContext->impl->runAheadMutex);
+	ConditionDeinit(&threadContext->impl->runAheadCond);
+	ConditionDeinit(&threadContext->impl->runAheadDoneCond);
+	MutexDeinit(&threadContext->impl->metricsMutex);
 
 	MutexDeinit(&threadContext->impl->sync.videoFrameMutex);
 	ConditionWake(&threadContext->impl->sync.videoFrameAvailableCond);
@@ -426,6 +688,12 @@ void mCoreThreadJoin(struct mCoreThread* threadContext) {
 
 	ConditionWake(&threadContext->impl->sync.audioRequiredCond);
 	ConditionDeinit(&threadContext->impl->sync.audioRequiredCond);
+	if (threadContext->impl->sync.audioRing.data) {
+		RingSPSCDeinit(&threadContext->impl->sync.audioRing);
+	}
+	if (threadContext->impl->runAheadState) {
+		mappedMemoryFree(threadContext->impl->runAheadState, threadContext->impl->runAheadStateSize);
+	}
 	MutexDeinit(&threadContext->impl->sync.audioBufferMutex);
 
 	free(threadContext->impl);
@@ -436,7 +704,8 @@ bool mCoreThreadIsActive(struct mCoreThread* threadContext) {
 	if (!threadContext->impl) {
 		return false;
 	}
-	return threadContext->impl->state >= THREAD_RUNNING && threadContext->impl->state < THREAD_EXITING;
+	enum mCoreThreadState state = _loadState(threadContext->impl);
+	return state >= THREAD_RUNNING && state < THREAD_EXITING;
 }
 
 void mCoreThreadInterrupt(struct mCoreThread* threadContext) {
@@ -451,7 +720,7 @@ void mCoreThreadInterrupt(struct mCoreThread* threadContext) {
 	}
 	threadContext->impl->savedState = threadContext->impl->state;
 	_waitOnInterrupt(threadContext->impl);
-	threadContext->impl->state = THREAD_INTERRUPTING;
+	ATOMIC_STORE(threadContext->impl->state, THREAD_INTERRUPTING);
 	ConditionWake(&threadContext->impl->stateCond);
 	_waitUntilNotState(threadContext->impl, THREAD_INTERRUPTING);
 	MutexUnlock(&threadContext->impl->stateMutex);
@@ -465,13 +734,13 @@ void mCoreThreadInterruptFromThread(struct mCoreThread* threadContext) {
 	++threadContext->impl->interruptDepth;
 	if (threadContext->impl->interruptDepth > 1 || !mCoreThreadIsActive(threadContext)) {
 		if (threadContext->impl->state == THREAD_INTERRUPTING) {
-			threadContext->impl->state = THREAD_INTERRUPTED;
+			ATOMIC_STORE(threadContext->impl->state, THREAD_INTERRUPTED);
 		}
 		MutexUnlock(&threadContext->impl->stateMutex);
 		return;
 	}
 	threadContext->impl->savedState = threadContext->impl->state;
-	threadContext->impl->state = THREAD_INTERRUPTING;
+	ATOMIC_STORE(threadContext->impl->state, THREAD_INTERRUPTING);
 	ConditionWake(&threadContext->impl->stateCond);
 	MutexUnlock(&threadContext->impl->stateMutex);
 }
@@ -483,7 +752,7 @@ void mCoreThreadContinue(struct mCoreThread* threadContext) {
 	MutexLock(&threadContext->impl->stateMutex);
 	--threadContext->impl->interruptDepth;
 	if (threadContext->impl->interruptDepth < 1 && mCoreThreadIsActive(threadContext)) {
-		threadContext->impl->state = threadContext->impl->savedState;
+		ATOMIC_STORE(threadContext->impl->state, threadContext->impl->savedState);
 		ConditionWake(&threadContext->impl->stateCond);
 	}
 	MutexUnlock(&threadContext->impl->stateMutex);
@@ -494,7 +763,7 @@ void mCoreThreadRunFunction(struct mCoreThread* threadContext, void (*run)(struc
 	threadContext->run = run;
 	_waitOnInterrupt(threadContext->impl);
 	threadContext->impl->savedState = threadContext->impl->state;
-	threadContext->impl->state = THREAD_RUN_ON;
+	ATOMIC_STORE(threadContext->impl->state, THREAD_RUN_ON);
 	ConditionWake(&threadContext->impl->stateCond);
 	_waitUntilNotState(threadContext->impl, THREAD_RUN_ON);
 	MutexUnlock(&threadContext->impl->stateMutex);
@@ -519,7 +788,7 @@ void mCoreThreadUnpause(struct mCoreThread* threadContext) {
 	MutexLock(&threadContext->impl->stateMutex);
 	_waitOnInterrupt(threadContext->impl);
 	if (threadContext->impl->state == THREAD_PAUSED || threadContext->impl->state == THREAD_PAUSING) {
-		threadContext->impl->state = THREAD_RUNNING;
+		ATOMIC_STORE(threadContext->impl->state, THREAD_RUNNING);
 		ConditionWake(&threadContext->impl->stateCond);
 		frameOn = threadContext->impl->frameWasOn;
 	}
@@ -545,7 +814,7 @@ void mCoreThreadTogglePause(struct mCoreThread* threadContext) {
 	MutexLock(&threadContext->impl->stateMutex);
 	_waitOnInterrupt(threadContext->impl);
 	if (threadContext->impl->state == THREAD_PAUSED || threadContext->impl->state == THREAD_PAUSING) {
-		threadContext->impl->state = THREAD_RUNNING;
+		ATOMIC_STORE(threadContext->impl->state, THREAD_RUNNING);
 		ConditionWake(&threadContext->impl->stateCond);
 		frameOn = threadContext->impl->frameWasOn;
 	} else if (threadContext->impl->state == THREAD_RUNNING) {
@@ -562,7 +831,7 @@ void mCoreThreadPauseFromThread(struct mCoreThread* threadContext) {
 	bool frameOn = true;
 	MutexLock(&threadContext->impl->stateMutex);
 	if (threadContext->impl->state == THREAD_RUNNING || (threadContext->impl->interruptDepth && threadContext->impl->savedState == THREAD_RUNNING)) {
-		threadContext->impl->state = THREAD_PAUSING;
+		ATOMIC_STORE(threadContext->impl->state, THREAD_PAUSING);
 		frameOn = false;
 	}
 	MutexUnlock(&threadContext->impl->stateMutex);
@@ -582,10 +851,10 @@ void mCoreThreadSetRewinding(struct mCoreThread* threadContext, bool rewinding)
 	}
 	_waitOnInterrupt(threadContext->impl);
 	if (rewinding && threadContext->impl->state == THREAD_RUNNING) {
-		threadContext->impl->state = THREAD_REWINDING;
+		ATOMIC_STORE(threadContext->impl->state, THREAD_REWINDING);
 	}
 	if (!rewinding && threadContext->impl->state == THREAD_REWINDING) {
-		threadContext->impl->state = THREAD_RUNNING;
+		ATOMIC_STORE(threadContext->impl->state, THREAD_RUNNING);
 	}
 	MutexUnlock(&threadContext->impl->stateMutex);
 }
@@ -593,18 +862,33 @@ void mCoreThreadSetRewinding(struct mCoreThread* threadContext, bool rewinding)
 void mCoreThreadRewindParamsChanged(struct mCoreThread* threadContext) {
 	struct mCore* core = threadContext->core;
 	if (core->opts.rewindEnable && core->opts.rewindBufferCapacity > 0) {
+		int highPriority = 0;
+		unsigned budget = 0;
+		threadContext->impl->rewind.affinity = 0;
+		mCoreConfigGetCPUMaskValue(&core->config, "rewindThreadAffinity", &threadContext->impl->rewind.affinity);
+		mCoreConfigGetIntValue(&core->config, "threadHighPriority", &highPriority);
+		threadContext->impl->rewind.highPriority = highPriority;
+		// The budget is given in KiB
+		mCoreConfigGetUIntValue(&core->config, "rewindBufferBudget", &budget);
+		threadContext->impl->rewind.budget = (size_t) budget << 10;
 		 mCoreRewindContextInit(&threadContext->impl->rewind, core->opts.rewindBufferCapacity, true);
 	} else {
 		 mCoreRewindContextDeinit(&threadContext->impl->rewind);
 	}
 }
 
+void mCoreThreadGetMetrics(struct mCoreThread* threadContext, struct mCoreMetrics* metrics) {
+	MutexLock(&threadContext->impl->metricsMutex);
+	*metrics = threadContext->impl->metrics;
+	MutexUnlock(&threadContext->impl->metricsMutex);
+}
+
 void mCoreThreadWaitFromThread(struct mCoreThread* threadContext) {
 	MutexLock(&threadContext->impl->stateMutex);
 	if (threadContext->impl->interruptDepth && threadContext->impl->savedState == THREAD_RUNNING) {
 		threadContext->impl->savedState = THREAD_WAITING;
 	} else if (threadContext->impl->state == THREAD_RUNNING) {
-		threadContext->impl->state = THREAD_WAITING;
+		ATOMIC_STORE(threadContext->impl->state, THREAD_WAITING);
 	}
 	MutexUnlock(&threadContext->impl->stateMutex);
 }
@@ -614,7 +898,7 @@ void mCoreThreadStopWaiting(struct mCoreThread* threadContext) {
 	if (threadContext->impl->interruptDepth && threadContext->impl->savedState == THREAD_WAITING) {
 		threadContext->impl->savedState = THREAD_RUNNING;
 	} else if (threadContext->impl->state == THREAD_WAITING) {
-		threadContext->impl->state = THREAD_RUNNING;
+		ATOMIC_STORE(threadContext->impl->state, THREAD_RUNNING);
 		ConditionWake(&threadContext->impl->stateCond);
 	}
 	MutexUnlock(&threadContext->impl->stateMutex);
@@ -642,13 +926,23 @@ struct mCoreThread* mCoreThreadGet(void) {
 }
 #endif
 
-static void _mCoreLog(struct mLogger* logger, int category, enum mLogLevel level, const char* format, va_list args) {
+static void _mCoreLogPrint(struct mLogger* logger, int category, enum mLogLevel level, const char* format, va_list args) {
 	UNUSED(logger);
 	UNUSED(level);
 	printf("%s: ", mLogCategoryName(category));
 	vprintf(format, args);
 	printf("\n");
+}
+
+static void _mCoreLog(struct mLogger* logger, int category, enum mLogLevel level, const char* format, va_list args) {
 	struct mCoreThread* thread = mCoreThreadGet();
+#ifndef DISABLE_THREADING
+	// Printing is handed off so that a game spamming the log doesn't stall emulation on stdout
+	if (thread && thread->impl && thread->impl->asyncLogger) {
+		thread->impl->asyncLogger->log(thread->impl->asyncLogger, category, level, format, args);
+	} else
+#endif
+	_mCoreLogPrint(logger, category, level, format, args);
 	if (thread && level == mLOG_FATAL) {
 #ifndef DISABLE_THREADING
 		mCoreThreadMarkCrashed(thread);
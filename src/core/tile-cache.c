@@ -7,6 +7,16 @@
 
 #include <mgba-util/memory.h>
 
+#ifndef COLOR_16_BIT
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TILE_CACHE_SIMD_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TILE_CACHE_SIMD_NEON
+#endif
+#endif
+
 void mTileCacheInit(struct mTileCache* cache) {
 	// TODO: Reconfigurable cache for space savings
 	cache->cache = NULL;
@@ -14,6 +24,8 @@ void mTileCacheInit(struct mTileCache* cache) {
 	cache->status = NULL;
 	cache->globalPaletteVersion = NULL;
 	cache->palette = NULL;
+	cache->opaquePalette = NULL;
+	cache->version = 0;
 }
 
 static void _freeCache(struct mTileCache* cache) {
@@ -31,6 +43,8 @@ static void _freeCache(struct mTileCache* cache) {
 	cache->globalPaletteVersion = NULL;
 	free(cache->palette);
 	cache->palette = NULL;
+	free(cache->opaquePalette);
+	cache->opaquePalette = NULL;
 }
 
 static void _redoCacheSize(struct mTileCache* cache) {
@@ -48,6 +62,7 @@ static void _redoCacheSize(struct mTileCache* cache) {
 	cache->status = anonymousMemoryMap(tiles * size * sizeof(*cache->status));
 	cache->globalPaletteVersion = malloc(size * sizeof(*cache->globalPaletteVersion));
 	cache->palette = malloc(size * bpp * sizeof(*cache->palette));
+	cache->opaquePalette = malloc(size * bpp * sizeof(*cache->opaquePalette));
 }
 
 void mTileCacheConfigure(struct mTileCache* cache, mTileCacheConfiguration config) {
@@ -79,6 +94,7 @@ void mTileCacheWriteVRAM(struct mTileCache* cache, uint32_t address) {
 	if (address >= mTileCacheSystemInfoGetMaxTiles(cache->sysConfig)) {
 		return;
 	}
+	++cache->version;
 	size_t i;
 	for (i = 0; i < count; ++i) {
 		cache->status[address * count + i].vramClean = 0;
@@ -96,65 +112,101 @@ void mTileCacheWritePalette(struct mTileCache* cache, uint32_t entry, color_t co
 		return;
 	}
 	cache->palette[entry] = color;
+	unsigned colorMask = (1 << (1 << cache->bpp)) - 1;
+	cache->opaquePalette[entry] = (entry & colorMask) ? color | 0xFF000000 : color;
 	entry >>= (1 << mTileCacheSystemInfoGetPaletteBPP(cache->sysConfig));
 	++cache->globalPaletteVersion[entry];
+	++cache->version;
 }
 
+#if defined(TILE_CACHE_SIMD_SSE2)
+static inline __m128i _select2bpp(__m128i lower, __m128i upper, __m128i bits, const __m128i* colors) {
+	__m128i lo = _mm_cmpeq_epi32(_mm_and_si128(lower, bits), bits);
+	__m128i hi = _mm_cmpeq_epi32(_mm_and_si128(upper, bits), bits);
+	__m128i even = _mm_or_si128(_mm_and_si128(lo, colors[1]), _mm_andnot_si128(lo, colors[0]));
+	__m128i odd = _mm_or_si128(_mm_and_si128(lo, colors[3]), _mm_andnot_si128(lo, colors[2]));
+	return _mm_or_si128(_mm_and_si128(hi, odd), _mm_andnot_si128(hi, even));
+}
+#elif defined(TILE_CACHE_SIMD_NEON)
+static inline uint32x4_t _select2bpp(uint32x4_t lower, uint32x4_t upper, uint32x4_t bits, const uint32x4_t* colors) {
+	uint32x4_t lo = vtstq_u32(lower, bits);
+	uint32x4_t hi = vtstq_u32(upper, bits);
+	return vbslq_u32(hi, vbslq_u32(lo, colors[3], colors[2]), vbslq_u32(lo, colors[1], colors[0]));
+}
+#endif
+
+// The opaque palette already has the alpha bit set on every entry but the transparent one,
+// so each pixel is a single lookup
 static void _regenerateTile4(struct mTileCache* cache, color_t* tile, unsigned tileId, unsigned paletteId) {
 	uint8_t* start = (uint8_t*) &cache->vram[tileId << 3];
 	paletteId <<= 2;
-	color_t* palette = &cache->palette[paletteId];
+	const color_t* palette = &cache->opaquePalette[paletteId];
 	int i;
+#if defined(TILE_CACHE_SIMD_SSE2)
+	// With only four colors, selecting between them from the bitplanes beats looking them up
+	const __m128i colors[4] = {
+		_mm_set1_epi32(palette[0]), _mm_set1_epi32(palette[1]), _mm_set1_epi32(palette[2]), _mm_set1_epi32(palette[3])
+	};
+	const __m128i left = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+	const __m128i right = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+	for (i = 0; i < 8; ++i) {
+		__m128i lower = _mm_set1_epi32(start[0]);
+		__m128i upper = _mm_set1_epi32(start[1]);
+		start += 2;
+		_mm_storeu_si128((__m128i*) &tile[0], _select2bpp(lower, upper, left, colors));
+		_mm_storeu_si128((__m128i*) &tile[4], _select2bpp(lower, upper, right, colors));
+		tile += 8;
+	}
+#elif defined(TILE_CACHE_SIMD_NEON)
+	const uint32x4_t colors[4] = {
+		vdupq_n_u32(palette[0]), vdupq_n_u32(palette[1]), vdupq_n_u32(palette[2]), vdupq_n_u32(palette[3])
+	};
+	static const uint32_t leftBits[4] = { 0x80, 0x40, 0x20, 0x10 };
+	static const uint32_t rightBits[4] = { 0x08, 0x04, 0x02, 0x01 };
+	const uint32x4_t left = vld1q_u32(leftBits);
+	const uint32x4_t right = vld1q_u32(rightBits);
+	for (i = 0; i < 8; ++i) {
+		uint32x4_t lower = vdupq_n_u32(start[0]);
+		uint32x4_t upper = vdupq_n_u32(start[1]);
+		start += 2;
+		vst1q_u32(&tile[0], _select2bpp(lower, upper, left, colors));
+		vst1q_u32(&tile[4], _select2bpp(lower, upper, right, colors));
+		tile += 8;
+	}
+#else
 	for (i = 0; i < 8; ++i) {
-		uint8_t tileDataLower = start[0];
-		uint8_t tileDataUpper = start[1];
+		unsigned tileDataLower = start[0];
+		unsigned tileDataUpper = start[1] << 1;
 		start += 2;
-		int pixel;
-		pixel = ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
-		tile[0] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-		tile[1] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-		tile[2] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-		tile[3] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-		tile[4] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-		tile[5] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-		tile[6] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-		tile[7] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
+		tile[0] = palette[((tileDataUpper >> 7) & 2) | ((tileDataLower >> 7) & 1)];
+		tile[1] = palette[((tileDataUpper >> 6) & 2) | ((tileDataLower >> 6) & 1)];
+		tile[2] = palette[((tileDataUpper >> 5) & 2) | ((tileDataLower >> 5) & 1)];
+		tile[3] = palette[((tileDataUpper >> 4) & 2) | ((tileDataLower >> 4) & 1)];
+		tile[4] = palette[((tileDataUpper >> 3) & 2) | ((tileDataLower >> 3) & 1)];
+		tile[5] = palette[((tileDataUpper >> 2) & 2) | ((tileDataLower >> 2) & 1)];
+		tile[6] = palette[((tileDataUpper >> 1) & 2) | ((tileDataLower >> 1) & 1)];
+		tile[7] = palette[(tileDataUpper & 2) | (tileDataLower & 1)];
 		tile += 8;
 	}
+#endif
 }
 
 static void _regenerateTile16(struct mTileCache* cache, color_t* tile, unsigned tileId, unsigned paletteId) {
 	uint32_t* start = (uint32_t*) &cache->vram[tileId << 4];
 	paletteId <<= 4;
-	color_t* palette = &cache->palette[paletteId];
+	const color_t* palette = &cache->opaquePalette[paletteId];
 	int i;
 	for (i = 0; i < 8; ++i) {
 		uint32_t line = *start;
 		++start;
-		int pixel;
-		pixel = line & 0xF;
-		tile[0] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 4) & 0xF;
-		tile[1] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 8) & 0xF;
-		tile[2] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 12) & 0xF;
-		tile[3] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 16) & 0xF;
-		tile[4] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 20) & 0xF;
-		tile[5] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 24) & 0xF;
-		tile[6] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 28) & 0xF;
-		tile[7] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
+		tile[0] = palette[line & 0xF];
+		tile[1] = palette[(line >> 4) & 0xF];
+		tile[2] = palette[(line >> 8) & 0xF];
+		tile[3] = palette[(line >> 12) & 0xF];
+		tile[4] = palette[(line >> 16) & 0xF];
+		tile[5] = palette[(line >> 20) & 0xF];
+		tile[6] = palette[(line >> 24) & 0xF];
+		tile[7] = palette[line >> 28];
 		tile += 8;
 	}
 }
@@ -162,35 +214,42 @@ static void _regenerateTile16(struct mTileCache* cache, color_t* tile, unsigned
 static void _regenerateTile256(struct mTileCache* cache, color_t* tile, unsigned tileId, unsigned paletteId) {
 	uint32_t* start = (uint32_t*) &cache->vram[tileId << 5];
 	paletteId <<= 8;
-	color_t* palette = &cache->palette[paletteId];
+	const color_t* palette = &cache->opaquePalette[paletteId];
 	int i;
 	for (i = 0; i < 8; ++i) {
 		uint32_t line = *start;
 		++start;
-		int pixel;
-		pixel = line & 0xFF;
-		tile[0] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 8) & 0xFF;
-		tile[1] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 16) & 0xFF;
-		tile[2] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 24) & 0xFF;
-		tile[3] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
+		tile[0] = palette[line & 0xFF];
+		tile[1] = palette[(line >> 8) & 0xFF];
+		tile[2] = palette[(line >> 16) & 0xFF];
+		tile[3] = palette[line >> 24];
 
 		line = *start;
 		++start;
-		pixel = line & 0xFF;
-		tile[4] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 8) & 0xFF;
-		tile[5] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 16) & 0xFF;
-		tile[6] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 24) & 0xFF;
-		tile[7] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
+		tile[4] = palette[line & 0xFF];
+		tile[5] = palette[(line >> 8) & 0xFF];
+		tile[6] = palette[(line >> 16) & 0xFF];
+		tile[7] = palette[line >> 24];
 		tile += 8;
 	}
 }
 
+static bool _regenerateTile(struct mTileCache* cache, color_t* tile, unsigned tileId, unsigned paletteId) {
+	switch (cache->bpp) {
+	case 1:
+		_regenerateTile4(cache, tile, tileId, paletteId);
+		return true;
+	case 2:
+		_regenerateTile16(cache, tile, tileId, paletteId);
+		return true;
+	case 3:
+		_regenerateTile256(cache, tile, tileId, paletteId);
+		return true;
+	default:
+		return false;
+	}
+}
+
 static inline color_t* _tileLookup(struct mTileCache* cache, unsigned tileId, unsigned paletteId) {
 	if (mTileCacheConfigurationIsShouldStore(cache->config)) {
 		unsigned tiles = mTileCacheSystemInfoGetMaxTiles(cache->sysConfig);
@@ -210,7 +269,6 @@ static inline color_t* _tileLookup(struct mTileCache* cache, unsigned tileId, un
 
 const color_t* mTileCacheGetTile(struct mTileCache* cache, unsigned tileId, unsigned paletteId) {
 	unsigned count = cache->entriesPerTile;
-	unsigned bpp = cache->bpp;
 	struct mTileCacheEntry* status = &cache->status[tileId * count + paletteId];
 	struct mTileCacheEntry desiredStatus = {
 		.paletteVersion = cache->globalPaletteVersion[paletteId],
@@ -220,18 +278,8 @@ const color_t* mTileCacheGetTile(struct mTileCache* cache, unsigned tileId, unsi
 	};
 	color_t* tile = _tileLookup(cache, tileId, paletteId);
 	if (!mTileCacheConfigurationIsShouldStore(cache->config) || memcmp(status, &desiredStatus, sizeof(*status))) {
-		switch (bpp) {
-		case 0:
+		if (!_regenerateTile(cache, tile, tileId, paletteId)) {
 			return NULL;
-		case 1:
-			_regenerateTile4(cache, tile, tileId, paletteId);
-			break;
-		case 2:
-			_regenerateTile16(cache, tile, tileId, paletteId);
-			break;
-		case 3:
-			_regenerateTile256(cache, tile, tileId, paletteId);
-			break;
 		}
 		*status = desiredStatus;
 	}
@@ -240,7 +288,6 @@ const color_t* mTileCacheGetTile(struct mTileCache* cache, unsigned tileId, unsi
 
 const color_t* mTileCacheGetTileIfDirty(struct mTileCache* cache, struct mTileCacheEntry* entry, unsigned tileId, unsigned paletteId) {
 	unsigned count = cache->entriesPerTile;
-	unsigned bpp = cache->bpp;
 	struct mTileCacheEntry* status = &cache->status[tileId * count + paletteId];
 	struct mTileCacheEntry desiredStatus = {
 		.paletteVersion = cache->globalPaletteVersion[paletteId],
@@ -251,18 +298,8 @@ const color_t* mTileCacheGetTileIfDirty(struct mTileCache* cache, struct mTileCa
 	color_t* tile = NULL;
 	if (memcmp(status, &desiredStatus, sizeof(*status))) {
 		tile = _tileLookup(cache, tileId, paletteId);
-		switch (bpp) {
-		case 0:
+		if (!_regenerateTile(cache, tile, tileId, paletteId)) {
 			return NULL;
-		case 1:
-			_regenerateTile4(cache, tile, tileId, paletteId);
-			break;
-		case 2:
-			_regenerateTile16(cache, tile, tileId, paletteId);
-			break;
-		case 3:
-			_regenerateTile256(cache, tile, tileId, paletteId);
-			break;
 		}
 		*status = desiredStatus;
 	}
@@ -273,6 +310,33 @@ const color_t* mTileCacheGetTileIfDirty(struct mTileCache* cache, struct mTileCa
 	return tile;
 }
 
+size_t mTileCacheRegenerateDirty(struct mTileCache* cache, unsigned paletteId) {
+	if (!mTileCacheConfigurationIsShouldStore(cache->config) || !cache->bpp) {
+		return 0;
+	}
+	unsigned count = cache->entriesPerTile;
+	unsigned tiles = mTileCacheSystemInfoGetMaxTiles(cache->sysConfig);
+	struct mTileCacheEntry desiredStatus = {
+		.paletteVersion = cache->globalPaletteVersion[paletteId],
+		.vramClean = 1,
+		.paletteId = paletteId
+	};
+	struct mTileCacheEntry* status = &cache->status[paletteId];
+	color_t* tile = &cache->cache[(paletteId * tiles) << 6];
+	size_t regenerated = 0;
+	unsigned tileId;
+	for (tileId = 0; tileId < tiles; ++tileId, status += count, tile += 64) {
+		desiredStatus.vramVersion = status->vramVersion;
+		if (!memcmp(status, &desiredStatus, sizeof(*status))) {
+			continue;
+		}
+		_regenerateTile(cache, tile, tileId, paletteId);
+		*status = desiredStatus;
+		++regenerated;
+	}
+	return regenerated;
+}
+
 const color_t* mTileCacheGetPalette(struct mTileCache* cache, unsigned paletteId) {
 	return &cache->palette[paletteId << (1 << cache->bpp)];
 }
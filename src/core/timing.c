@@ -5,96 +5,332 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/core/timing.h>
 
+#include <mgba/core/perf-counters.h>
+
+DEFINE_VECTOR(mTimingEventHeap, struct mTimingEvent*);
+DEFINE_VECTOR(mTimingTraceEntryList, struct mTimingTraceEntry);
+
+#ifdef ENABLE_PERF_COUNTERS
+static void _mTimingTraceRecord(struct mTiming* timing, enum mTimingTraceOp op, const struct mTimingEvent* event, uint32_t value) {
+	struct mTimingTrace* trace = timing->trace;
+	size_t id = 0;
+	if (event) {
+		for (id = 0; id < trace->nEvents; ++id) {
+			if (trace->events[id].event == event) {
+				break;
+			}
+		}
+		if (id == trace->nEvents) {
+			if (id == mTIMING_TRACE_MAX_EVENTS) {
+				trace->overflowed = true;
+				return;
+			}
+			trace->events[id].event = event;
+			trace->events[id].name = event->name;
+			trace->events[id].priority = event->priority;
+			++trace->nEvents;
+		}
+	}
+	struct mTimingTraceEntry* entry = mTimingTraceEntryListAppend(&trace->entries);
+	entry->op = op;
+	entry->event = id;
+	entry->value = value;
+}
+
+#define TRACE(OP, EVENT, VALUE) \
+	if (UNLIKELY(timing->trace)) { \
+		_mTimingTraceRecord(timing, OP, EVENT, VALUE); \
+	}
+#else
+#define TRACE(OP, EVENT, VALUE)
+#endif
+
+// Events are ordered by deadline, then priority, then scheduling order
+static inline bool _mTimingEventBefore(const struct mTimingEvent* a, const struct mTimingEvent* b) {
+	int32_t diff = a->when - b->when;
+	if (diff) {
+		return diff < 0;
+	}
+	if (a->priority != b->priority) {
+		return a->priority < b->priority;
+	}
+	return (int32_t) (a->order - b->order) < 0;
+}
+
+static void _mTimingSiftUp(struct mTiming* timing, size_t index) {
+	struct mTimingEvent** heap = timing->heap.vector;
+	struct mTimingEvent* event = heap[index];
+	while (index) {
+		size_t parent = (index - 1) >> 1;
+		if (!_mTimingEventBefore(event, heap[parent])) {
+			break;
+		}
+		heap[index] = heap[parent];
+		heap[index]->index = index;
+		index = parent;
+	}
+	heap[index] = event;
+	event->index = index;
+}
+
+static void _mTimingSiftDown(struct mTiming* timing, size_t index) {
+	struct mTimingEvent** heap = timing->heap.vector;
+	size_t size = timing->heap.size;
+	struct mTimingEvent* event = heap[index];
+	while (true) {
+		size_t child = index * 2 + 1;
+		if (child >= size) {
+			break;
+		}
+		if (child + 1 < size && _mTimingEventBefore(heap[child + 1], heap[child])) {
+			++child;
+		}
+		if (!_mTimingEventBefore(heap[child], event)) {
+			break;
+		}
+		heap[index] = heap[child];
+		heap[index]->index = index;
+		index = child;
+	}
+	heap[index] = event;
+	event->index = index;
+}
+
+static void _mTimingHeapRemove(struct mTiming* timing, size_t index) {
+	struct mTimingEvent** heap = timing->heap.vector;
+	size_t last = timing->heap.size - 1;
+	timing->heap.size = last;
+	if (index == last) {
+		return;
+	}
+	heap[index] = heap[last];
+	heap[index]->index = index;
+	if (index && _mTimingEventBefore(heap[index], heap[(index - 1) >> 1])) {
+		_mTimingSiftUp(timing, index);
+	} else {
+		_mTimingSiftDown(timing, index);
+	}
+}
+
+static void _mTimingUseHeap(struct mTiming* timing) {
+	// The list is already sorted, which is a valid heap as it is
+	mTimingEventHeapClear(&timing->heap);
+	struct mTimingEvent* event;
+	for (event = timing->root; event; event = event->next) {
+		event->index = timing->heap.size;
+		*mTimingEventHeapAppend(&timing->heap) = event;
+	}
+	timing->root = NULL;
+	timing->listSize = 0;
+	timing->useHeap = true;
+}
+
+static void _mTimingUseList(struct mTiming* timing) {
+	struct mTimingEvent** tail = &timing->root;
+	timing->listSize = timing->heap.size;
+	while (timing->heap.size) {
+		struct mTimingEvent* event = timing->heap.vector[0];
+		_mTimingHeapRemove(timing, 0);
+		*tail = event;
+		tail = &event->next;
+	}
+	*tail = NULL;
+	timing->useHeap = false;
+}
+
+static bool _mTimingHeapHas(const struct mTiming* timing, const struct mTimingEvent* event) {
+	return event->index < timing->heap.size && timing->heap.vector[event->index] == event;
+}
+
+static bool _mTimingListRemove(struct mTiming* timing, struct mTimingEvent** previous, struct mTimingEvent* event) {
+	struct mTimingEvent* next = *previous;
+	while (next) {
+		if (next == event) {
+			*previous = next->next;
+			--timing->listSize;
+			return true;
+		}
+		previous = &next->next;
+		next = next->next;
+	}
+	return false;
+}
+
+static void _mTimingListSchedule(struct mTiming* timing, struct mTimingEvent* event) {
+	struct mTimingEvent** previous = &timing->root;
+	struct mTimingEvent* next = timing->root;
+	bool pending = false;
+	while (next) {
+		if (next == event) {
+			// Already pending ahead of its new place
+			*previous = next->next;
+			--timing->listSize;
+			next = *previous;
+			pending = true;
+			continue;
+		}
+		// Ties go after the events already in the list, which keeps them in scheduling order
+		int32_t diff = event->when - next->when;
+		if (diff < 0 || (!diff && event->priority < next->priority)) {
+			break;
+		}
+		previous = &next->next;
+		next = next->next;
+	}
+	if (!pending && next) {
+		pending = _mTimingListRemove(timing, &next->next, event);
+	}
+	if (pending) {
+		TRACE(mTIMING_TRACE_RESCHEDULE, event, event->when);
+	} else {
+		TRACE(mTIMING_TRACE_SCHEDULE, event, event->when);
+	}
+	event->next = next;
+	*previous = event;
+	++timing->listSize;
+}
+
 void mTimingInit(struct mTiming* timing, int32_t* relativeCycles, int32_t* nextEvent) {
 	timing->root = NULL;
-	timing->reroot = NULL;
+	timing->listSize = 0;
+	timing->useHeap = false;
+	mTimingEventHeapInit(&timing->heap, 0);
+	timing->order = 0;
+	timing->interrupted = false;
 	timing->masterCycles = 0;
 	timing->relativeCycles = relativeCycles;
 	timing->nextEvent = nextEvent;
+	timing->perfCounters = NULL;
+	timing->trace = NULL;
 }
 
 void mTimingDeinit(struct mTiming* timing) {
-	UNUSED(timing);
+	mTimingEventHeapDeinit(&timing->heap);
 }
 
 void mTimingClear(struct mTiming* timing) {
 	timing->root = NULL;
-	timing->reroot = NULL;
+	timing->listSize = 0;
+	timing->useHeap = false;
+	mTimingEventHeapClear(&timing->heap);
+	timing->interrupted = false;
 	timing->masterCycles = 0;
+#ifdef ENABLE_PERF_COUNTERS
+	if (timing->trace) {
+		_mTimingTraceRecord(timing, mTIMING_TRACE_CLEAR, NULL, 0);
+		timing->trace->masterCycles = 0;
+	}
+#endif
 }
 
 void mTimingSchedule(struct mTiming* timing, struct mTimingEvent* event, int32_t when) {
 	int32_t nextEvent = when + *timing->relativeCycles;
 	event->when = nextEvent + timing->masterCycles;
+	event->order = timing->order;
+	++timing->order;
 	if (nextEvent < *timing->nextEvent) {
 		*timing->nextEvent = nextEvent;
 	}
-	if (timing->reroot) {
-		timing->root = timing->reroot;
-		timing->reroot = NULL;
-	}
-	struct mTimingEvent** previous = &timing->root;
-	struct mTimingEvent* next = timing->root;
-	unsigned priority = event->priority;
-	while (next) {
-		int32_t nextWhen = next->when - timing->masterCycles;
-		if (nextWhen > nextEvent || (nextWhen == nextEvent && next->priority > priority)) {
-			break;
+	timing->interrupted = false;
+	if (!timing->useHeap) {
+		_mTimingListSchedule(timing, event);
+		if (timing->listSize > mTIMING_LIST_MAX) {
+			_mTimingUseHeap(timing);
 		}
-		previous = &next->next;
-		next = next->next;
+		return;
 	}
-	event->next = next;
-	*previous = event;
+	if (_mTimingHeapHas(timing, event)) {
+		TRACE(mTIMING_TRACE_RESCHEDULE, event, event->when);
+		_mTimingHeapRemove(timing, event->index);
+	} else {
+		TRACE(mTIMING_TRACE_SCHEDULE, event, event->when);
+	}
+	size_t index = timing->heap.size;
+	*mTimingEventHeapAppend(&timing->heap) = event;
+	_mTimingSiftUp(timing, index);
 }
 
 void mTimingDeschedule(struct mTiming* timing, struct mTimingEvent* event) {
-	if (timing->reroot) {
-		timing->root = timing->reroot;
-		timing->reroot = NULL;
-	}
-	struct mTimingEvent** previous = &timing->root;
-	struct mTimingEvent* next = timing->root;
-	while (next) {
-		if (next == event) {
-			*previous = next->next;
-			return;
+	TRACE(mTIMING_TRACE_DESCHEDULE, event, 0);
+	timing->interrupted = false;
+	if (!timing->useHeap) {
+		_mTimingListRemove(timing, &timing->root, event);
+	} else if (_mTimingHeapHas(timing, event)) {
+		_mTimingHeapRemove(timing, event->index);
+		if (timing->heap.size <= mTIMING_LIST_MAX / 2) {
+			_mTimingUseList(timing);
 		}
-		previous = &next->next;
-		next = next->next;
 	}
 }
 
 bool mTimingIsScheduled(const struct mTiming* timing, const struct mTimingEvent* event) {
-	const struct mTimingEvent* next = timing->root;
-	if (!next) {
-		next = timing->reroot;
+	if (timing->useHeap) {
+		return _mTimingHeapHas(timing, event);
 	}
-	while (next) {
+	const struct mTimingEvent* next;
+	for (next = timing->root; next; next = next->next) {
 		if (next == event) {
 			return true;
 		}
-		next = next->next;
 	}
 	return false;
 }
 
+static inline struct mTimingEvent* _mTimingFirst(const struct mTiming* timing) {
+	if (!timing->useHeap) {
+		return timing->root;
+	}
+	return timing->heap.size ? timing->heap.vector[0] : NULL;
+}
+
+void mTimingInterrupt(struct mTiming* timing) {
+	if (!_mTimingFirst(timing)) {
+		return;
+	}
+	TRACE(mTIMING_TRACE_INTERRUPT, NULL, 0);
+	timing->interrupted = true;
+}
+
 int32_t mTimingTick(struct mTiming* timing, int32_t cycles) {
+#ifdef ENABLE_PERF_COUNTERS
+	if (timing->trace) {
+		if (timing->masterCycles != timing->trace->masterCycles) {
+			_mTimingTraceRecord(timing, mTIMING_TRACE_SET_MASTER, NULL, timing->masterCycles);
+		}
+		_mTimingTraceRecord(timing, mTIMING_TRACE_TICK, NULL, cycles);
+		timing->trace->masterCycles = timing->masterCycles + cycles;
+	}
+#endif
 	timing->masterCycles += cycles;
 	uint32_t masterCycles = timing->masterCycles;
-	while (timing->root) {
-		struct mTimingEvent* next = timing->root;
+	struct mTimingEvent* next;
+	while (!timing->interrupted && (next = _mTimingFirst(timing))) {
 		int32_t nextWhen = next->when - masterCycles;
 		if (nextWhen > 0) {
+			TRACE(mTIMING_TRACE_TICK_END, NULL, 0);
 			return nextWhen;
 		}
-		timing->root = next->next;
+		if (!timing->useHeap) {
+			timing->root = next->next;
+			--timing->listSize;
+		} else {
+			_mTimingHeapRemove(timing, 0);
+			if (timing->heap.size <= mTIMING_LIST_MAX / 2) {
+				_mTimingUseList(timing);
+			}
+		}
+#ifdef ENABLE_PERF_COUNTERS
+		if (timing->perfCounters) {
+			mPerfCountersCountEvent(timing->perfCounters, next->name);
+		}
+#endif
+		TRACE(mTIMING_TRACE_FIRE, next, 0);
 		next->callback(timing, next->context, -nextWhen);
 	}
-	if (timing->reroot) {
-		timing->root = timing->reroot;
-		timing->reroot = NULL;
-		*timing->nextEvent = mTimingNextEvent(timing); 
+	TRACE(mTIMING_TRACE_TICK_END, NULL, 0);
+	if (timing->interrupted) {
+		timing->interrupted = false;
+		*timing->nextEvent = mTimingNextEvent(timing);
 	}
 	return *timing->nextEvent;
 }
@@ -104,7 +340,7 @@ int32_t mTimingCurrentTime(const struct mTiming* timing) {
 }
 
 int32_t mTimingNextEvent(struct mTiming* timing) {
-	struct mTimingEvent* next = timing->root;
+	struct mTimingEvent* next = _mTimingFirst(timing);
 	if (!next) {
 		return INT_MAX;
 	}
@@ -114,3 +350,12 @@ int32_t mTimingNextEvent(struct mTiming* timing) {
 int32_t mTimingUntil(const struct mTiming* timing, const struct mTimingEvent* event) {
 	return event->when - timing->masterCycles - *timing->relativeCycles;
 }
+
+void mTimingTraceInit(struct mTimingTrace* trace) {
+	memset(trace, 0, sizeof(*trace));
+	mTimingTraceEntryListInit(&trace->entries, 0);
+}
+
+void mTimingTraceDeinit(struct mTimingTrace* trace) {
+	mTimingTraceEntryListDeinit(&trace->entries);
+}
@@ -0,0 +1,223 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/trace.h>
+
+#include <mgba/core/metrics.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vfs.h>
+
+#ifdef DISABLE_THREADING
+#define TRACE_THREAD_LOCAL
+#elif defined(_MSC_VER)
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL __thread
+#endif
+
+#define TRACE_EVENT_MASK (mTRACE_THREAD_EVENTS - 1)
+
+struct mTraceBuffer {
+	const char* threadName;
+	// Only the owning thread writes head, and only readers write tail
+	uint32_t head;
+	uint32_t tail;
+	struct mTraceEvent events[mTRACE_THREAD_EVENTS];
+};
+
+static int _enabled = 0;
+static int _nBuffers = 0;
+static struct mTraceBuffer* _buffers[mTRACE_MAX_THREADS];
+
+static TRACE_THREAD_LOCAL struct mTraceBuffer* _threadBuffer = NULL;
+static TRACE_THREAD_LOCAL const char* _threadName = NULL;
+// Set once a thread finds every slot taken, so it stops trying
+static TRACE_THREAD_LOCAL bool _threadDropped = false;
+
+void mTraceSetEnabled(bool enabled) {
+	ATOMIC_STORE(_enabled, enabled);
+}
+
+bool mTraceIsEnabled(void) {
+	int enabled;
+	ATOMIC_LOAD(enabled, _enabled);
+	return enabled;
+}
+
+void mTraceClear(void) {
+	int nBuffers;
+	ATOMIC_LOAD(nBuffers, _nBuffers);
+	if (nBuffers > mTRACE_MAX_THREADS) {
+		nBuffers = mTRACE_MAX_THREADS;
+	}
+	int i;
+	for (i = 0; i < nBuffers; ++i) {
+		struct mTraceBuffer* buffer;
+		ATOMIC_LOAD_PTR(buffer, _buffers[i]);
+		if (buffer) {
+			uint32_t head;
+			ATOMIC_LOAD(head, buffer->head);
+			ATOMIC_STORE(buffer->tail, head);
+		}
+	}
+}
+
+static struct mTraceBuffer* _getBuffer(void) {
+	if (_threadBuffer || _threadDropped) {
+		return _threadBuffer;
+	}
+	int slot = ATOMIC_ADD(_nBuffers, 1) - 1;
+	if (slot >= mTRACE_MAX_THREADS) {
+		_threadDropped = true;
+		return NULL;
+	}
+	struct mTraceBuffer* buffer = calloc(1, sizeof(*buffer));
+	if (!buffer) {
+		_threadDropped = true;
+		return NULL;
+	}
+	buffer->threadName = _threadName;
+	ATOMIC_STORE_PTR(_buffers[slot], buffer);
+	_threadBuffer = buffer;
+	return buffer;
+}
+
+uint64_t mTraceBegin(void) {
+	if (!mTraceIsEnabled()) {
+		return 0;
+	}
+	return mCoreMetricsTime();
+}
+
+void mTraceEnd(const char* name, uint64_t start) {
+	if (!start) {
+		return;
+	}
+	mTraceRecord(name, start, mCoreMetricsTime());
+}
+
+void mTraceRecord(const char* name, uint64_t start, uint64_t end) {
+	struct mTraceBuffer* buffer = _getBuffer();
+	if (!buffer) {
+		return;
+	}
+	uint32_t head = buffer->head;
+	struct mTraceEvent* event = &buffer->events[head & TRACE_EVENT_MASK];
+	event->name = name;
+	event->start = start;
+	event->duration = end > start ? end - start : 0;
+	ATOMIC_STORE(buffer->head, head + 1);
+}
+
+void mTraceSetThreadName(const char* name) {
+	_threadName = name;
+	if (_threadBuffer) {
+		ATOMIC_STORE_PTR(_threadBuffer->threadName, name);
+	}
+}
+
+static bool _writeString(struct VFile* vf, const char* string) {
+	char out[128];
+	size_t length = 0;
+	out[length++] = '"';
+	for (; *string && length < sizeof(out) - 3; ++string) {
+		if (*string == '"' || *string == '\\') {
+			out[length++] = '\\';
+		} else if ((unsigned char) *string < 0x20) {
+			continue;
+		}
+		out[length++] = *string;
+	}
+	out[length++] = '"';
+	return vf->write(vf, out, length) == (ssize_t) length;
+}
+
+static bool _writeFormat(struct VFile* vf, const char* format, ...) {
+	char line[128];
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if (length < 0 || (size_t) length >= sizeof(line)) {
+		return false;
+	}
+	return vf->write(vf, line, length) == length;
+}
+
+static bool _writeThread(struct VFile* vf, int tid, struct mTraceBuffer* buffer, struct mTraceEvent* events, bool* first) {
+	const char* threadName;
+	ATOMIC_LOAD_PTR(threadName, buffer->threadName);
+	if (threadName) {
+		if (!_writeFormat(vf, "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":", *first ? "" : ",", tid)) {
+			return false;
+		}
+		if (!_writeString(vf, threadName) || !_writeFormat(vf, "}}")) {
+			return false;
+		}
+		*first = false;
+	}
+
+	uint32_t head;
+	uint32_t tail;
+	ATOMIC_LOAD(head, buffer->head);
+	ATOMIC_LOAD(tail, buffer->tail);
+	uint32_t count = head - tail;
+	if (count > mTRACE_THREAD_EVENTS) {
+		count = mTRACE_THREAD_EVENTS;
+	}
+	uint32_t i;
+	for (i = 0; i < count; ++i) {
+		events[i] = buffer->events[(head - count + i) & TRACE_EVENT_MASK];
+	}
+	// The thread may have lapped the oldest events while they were being copied. The slot after
+	// head counts as taken too, since it may be half written.
+	uint32_t newHead;
+	ATOMIC_LOAD(newHead, buffer->head);
+	uint32_t skip = 0;
+	if (newHead - head + 1 + count > mTRACE_THREAD_EVENTS) {
+		skip = newHead - head + 1 + count - mTRACE_THREAD_EVENTS;
+		if (skip > count) {
+			skip = count;
+		}
+	}
+
+	for (i = skip; i < count; ++i) {
+		if (!_writeFormat(vf, "%s\n{\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%" PRIu64 ",\"dur\":%" PRIu64 ",\"name\":", *first ? "" : ",", tid, events[i].start, events[i].duration)) {
+			return false;
+		}
+		if (!_writeString(vf, events[i].name) || !_writeFormat(vf, "}")) {
+			return false;
+		}
+		*first = false;
+	}
+	return true;
+}
+
+bool mTraceWriteChrome(struct VFile* vf) {
+	struct mTraceEvent* events = malloc(sizeof(*events) * mTRACE_THREAD_EVENTS);
+	if (!events) {
+		return false;
+	}
+	int nBuffers;
+	ATOMIC_LOAD(nBuffers, _nBuffers);
+	if (nBuffers > mTRACE_MAX_THREADS) {
+		nBuffers = mTRACE_MAX_THREADS;
+	}
+	bool success = _writeFormat(vf, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	bool first = true;
+	int i;
+	for (i = 0; i < nBuffers && success; ++i) {
+		struct mTraceBuffer* buffer;
+		ATOMIC_LOAD_PTR(buffer, _buffers[i]);
+		if (buffer) {
+			success = _writeThread(vf, i + 1, buffer, events, &first);
+		}
+	}
+	if (success) {
+		success = _writeFormat(vf, "\n]}\n");
+	}
+	free(events);
+	return success;
+}
@@ -10,6 +10,9 @@
 #include <mgba/core/core.h>
 #include <mgba/core/version.h>
 #include <mgba/internal/debugger/parser.h>
+#include <mgba/internal/debugger/profiler.h>
+#include <mgba/internal/debugger/reverse.h>
+#include <mgba/internal/debugger/trace.h>
 #include <mgba-util/string.h>
 #include <mgba-util/vfs.h>
 
@@ -25,6 +28,8 @@
 #include <pthread.h>
 #endif
 
+#define BINARY_TRACE_BUFFER_SIZE 4096
+
 const char* ERROR_MISSING_ARGS = "Arguments missing"; // TODO: share
 const char* ERROR_OVERFLOW = "Arguments overflow";
 const char* ERROR_INVALID_ARGS = "Invalid arguments";
@@ -50,6 +55,9 @@ static void _readByte(struct CLIDebugger*, struct CLIDebugVector*);
 static void _reset(struct CLIDebugger*, struct CLIDebugVector*);
 static void _readHalfword(struct CLIDebugger*, struct CLIDebugVector*);
 static void _readWord(struct CLIDebugger*, struct CLIDebugVector*);
+static void _record(struct CLIDebugger*, struct CLIDebugVector*);
+static void _reverseContinue(struct CLIDebugger*, struct CLIDebugVector*);
+static void _reverseStep(struct CLIDebugger*, struct CLIDebugVector*);
 static void _setBreakpoint(struct CLIDebugger*, struct CLIDebugVector*);
 static void _clearBreakpoint(struct CLIDebugger*, struct CLIDebugVector*);
 static void _listBreakpoints(struct CLIDebugger*, struct CLIDebugVector*);
@@ -57,8 +65,17 @@ static void _setReadWriteWatchpoint(struct CLIDebugger*, struct CLIDebugVector*)
 static void _setReadWatchpoint(struct CLIDebugger*, struct CLIDebugVector*);
 static void _setWriteWatchpoint(struct CLIDebugger*, struct CLIDebugVector*);
 static void _setWriteChangedWatchpoint(struct CLIDebugger*, struct CLIDebugVector*);
+static void _setRangeWatchpoint(struct CLIDebugger*, struct CLIDebugVector*);
 static void _listWatchpoints(struct CLIDebugger*, struct CLIDebugVector*);
+static void _profile(struct CLIDebugger*, struct CLIDebugVector*);
+static void _profileCallers(struct CLIDebugger*, struct CLIDebugVector*);
+static void _profileSave(struct CLIDebugger*, struct CLIDebugVector*);
+static void _profileStop(struct CLIDebugger*, struct CLIDebugVector*);
 static void _trace(struct CLIDebugger*, struct CLIDebugVector*);
+static void _traceBinary(struct CLIDebugger*, struct CLIDebugVector*);
+static void _traceMemory(struct CLIDebugger*, struct CLIDebugVector*);
+static void _traceRing(struct CLIDebugger*, struct CLIDebugVector*);
+static void _traceSave(struct CLIDebugger*, struct CLIDebugVector*);
 static void _writeByte(struct CLIDebugger*, struct CLIDebugVector*);
 static void _writeHalfword(struct CLIDebugger*, struct CLIDebugVector*);
 static void _writeRegister(struct CLIDebugger*, struct CLIDebugVector*);
@@ -96,14 +113,27 @@ static struct CLIDebuggerCommandSummary _debuggerCommands[] = {
 	{ "print", _print, "S+", "Print a value" },
 	{ "print/t", _printBin, "S+", "Print a value as binary" },
 	{ "print/x", _printHex, "S+", "Print a value as hexadecimal" },
+	{ "profile", _profile, "i", "Sample the program counter every N cycles" },
+	{ "profile/callers", _profileCallers, "i", "Sample the program counter and its caller every N cycles" },
+	{ "profile/save", _profileSave, "S", "Save the sampled stacks in folded format for flame graphs" },
+	{ "profile/stop", _profileStop, "", "Stop sampling" },
 	{ "q", _quit, "", "Quit the emulator" },
 	{ "quit", _quit, "", "Quit the emulator" },
+	{ "rc", _reverseContinue, "", "Continue execution backwards" },
+	{ "record", _record, "i", "Keep checkpoints every N instructions for running backwards, or stop with 0" },
 	{ "reset", _reset, "", "Reset the emulation" },
+	{ "reverse-continue", _reverseContinue, "", "Continue execution backwards" },
+	{ "reverse-step", _reverseStep, "", "Go back to the previous instruction" },
 	{ "r/1", _readByte, "I", "Read a byte from a specified offset" },
 	{ "r/2", _readHalfword, "I", "Read a halfword from a specified offset" },
 	{ "r/4", _readWord, "I", "Read a word from a specified offset" },
+	{ "rs", _reverseStep, "", "Go back to the previous instruction" },
 	{ "status", _printStatus, "", "Print the current status" },
 	{ "trace", _trace, "Is", "Trace a number of instructions" },
+	{ "trace/binary", _traceBinary, "IS", "Record a number of instructions into a binary trace file" },
+	{ "trace/memory", _traceMemory, "I", "Set whether binary traces record memory accesses" },
+	{ "trace/ring", _traceRing, "I", "Keep a binary trace of the most recent records in memory, or stop with 0" },
+	{ "trace/save", _traceSave, "S", "Save the in-memory binary trace to a file" },
 	{ "w", _setReadWriteWatchpoint, "Is", "Set a watchpoint" },
 	{ "w/1", _writeByte, "II", "Write a byte at a specified offset" },
 	{ "w/2", _writeHalfword, "II", "Write a halfword at a specified offset" },
@@ -112,6 +142,7 @@ static struct CLIDebuggerCommandSummary _debuggerCommands[] = {
 	{ "watch", _setReadWriteWatchpoint, "Is", "Set a watchpoint" },
 	{ "watch/c", _setWriteChangedWatchpoint, "Is", "Set a change watchpoint" },
 	{ "watch/r", _setReadWatchpoint, "Is", "Set a read watchpoint" },
+	{ "watch/range", _setRangeWatchpoint, "IIs", "Set a watchpoint on SIZE bytes starting at an address" },
 	{ "watch/w", _setWriteWatchpoint, "Is", "Set a write watchpoint" },
 	{ "x/1", _dumpByte, "Ii", "Examine bytes at a specified offset" },
 	{ "x/2", _dumpHalfword, "Ii", "Examine halfwords at a specified offset" },
@@ -156,7 +187,7 @@ static void _continue(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
 
 static void _next(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
 	UNUSED(dv);
-	debugger->d.core->step(debugger->d.core);
+	mDebuggerStep(&debugger->d);
 	_printStatus(debugger, 0);
 }
 
@@ -292,9 +323,17 @@ static void _readByte(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
 	debugger->backend->printf(debugger->backend, " 0x%02X\n", value);
 }
 
+static void _forgetHistory(struct CLIDebugger* debugger) {
+	// Replays can't reproduce changes made by hand, so anything from before them is unreachable
+	if (debugger->d.reverse) {
+		mDebuggerReverseClear(debugger->d.reverse);
+	}
+}
+
 static void _reset(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
 	UNUSED(dv);
 	debugger->d.core->reset(debugger->d.core);
+	_forgetHistory(debugger);
 	_printStatus(debugger, 0);
 }
 
@@ -348,6 +387,7 @@ static void _writeByte(struct CLIDebugger* debugger, struct CLIDebugVector* dv)
 	} else {
 		debugger->d.core->busWrite8(debugger->d.core, address, value);
 	}
+	_forgetHistory(debugger);
 }
 
 static void _writeHalfword(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
@@ -370,6 +410,7 @@ static void _writeHalfword(struct CLIDebugger* debugger, struct CLIDebugVector*
 	} else {
 		debugger->d.core->busWrite16(debugger->d.core, address, value);
 	}
+	_forgetHistory(debugger);
 }
 
 static void _writeRegister(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
@@ -383,7 +424,9 @@ static void _writeRegister(struct CLIDebugger* debugger, struct CLIDebugVector*
 	}
 	if (!debugger->d.platform->setRegister(debugger->d.platform, dv->charValue, dv->next->intValue)) {
 		debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
+		return;
 	}
+	_forgetHistory(debugger);
 }
 
 static void _writeWord(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
@@ -402,6 +445,7 @@ static void _writeWord(struct CLIDebugger* debugger, struct CLIDebugVector* dv)
 	} else {
 		debugger->d.core->busWrite32(debugger->d.core, address, value);
 	}
+	_forgetHistory(debugger);
 }
 
 static void _dumpByte(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
@@ -575,6 +619,10 @@ static void _setWatchpoint(struct CLIDebugger* debugger, struct CLIDebugVector*
 		.segment = dv->segmentValue,
 		.type = type
 	};
+	if (dv->next && dv->next->type == CLIDV_INT_TYPE) {
+		watchpoint.size = dv->next->intValue;
+		dv = dv->next;
+	}
 	if (dv->next && dv->next->type == CLIDV_CHAR_TYPE) {
 		struct ParseTree* tree = _parseTree((const char*[]) { dv->next->charValue, NULL });
 		if (tree) {
@@ -606,6 +654,14 @@ static void _setWriteChangedWatchpoint(struct CLIDebugger* debugger, struct CLID
 	_setWatchpoint(debugger, dv, WATCHPOINT_WRITE_CHANGE);
 }
 
+static void _setRangeWatchpoint(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (!dv || !dv->next || dv->next->type != CLIDV_INT_TYPE) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_MISSING_ARGS);
+		return;
+	}
+	_setWatchpoint(debugger, dv, WATCHPOINT_RW);
+}
+
 static void _clearBreakpoint(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
 	if (!dv || dv->type != CLIDV_INT_TYPE) {
 		debugger->backend->printf(debugger->backend, "%s\n", ERROR_MISSING_ARGS);
@@ -641,9 +697,14 @@ static void _listWatchpoints(struct CLIDebugger* debugger, struct CLIDebugVector
 	for (i = 0; i < mWatchpointListSize(&watchpoints); ++i) {
 		struct mWatchpoint* watchpoint = mWatchpointListGetPointer(&watchpoints, i);
 		if (watchpoint->segment >= 0) {
-			debugger->backend->printf(debugger->backend, "%" PRIz "i: %02X:%X\n", watchpoint->id, watchpoint->segment, watchpoint->address);
+			debugger->backend->printf(debugger->backend, "%" PRIz "i: %02X:%X", watchpoint->id, watchpoint->segment, watchpoint->address);
 		} else {
-			debugger->backend->printf(debugger->backend, "%" PRIz "i: 0x%X\n", watchpoint->id, watchpoint->address);
+			debugger->backend->printf(debugger->backend, "%" PRIz "i: 0x%X", watchpoint->id, watchpoint->address);
+		}
+		if (watchpoint->size > 1) {
+			debugger->backend->printf(debugger->backend, "-0x%X\n", watchpoint->address + watchpoint->size - 1);
+		} else {
+			debugger->backend->printf(debugger->backend, "\n");
 		}
 	}
 	mWatchpointListDeinit(&watchpoints);
@@ -673,10 +734,187 @@ static void _trace(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
 	}
 }
 
+static void _stopBinaryTrace(struct CLIDebugger* debugger) {
+	if (!debugger->d.trace) {
+		return;
+	}
+	struct VFile* vf = debugger->binaryTrace.vf;
+	mDebuggerSetTrace(&debugger->d, NULL);
+	mDebuggerTraceDeinit(&debugger->binaryTrace);
+	if (vf) {
+		vf->close(vf);
+	}
+}
+
+static void _startBinaryTrace(struct CLIDebugger* debugger, size_t capacity, struct VFile* vf, int32_t count) {
+	_stopBinaryTrace(debugger);
+	mDebuggerTraceInit(&debugger->binaryTrace, capacity, vf, debugger->d.core->platform(debugger->d.core));
+	debugger->binaryTrace.remaining = count;
+	debugger->binaryTrace.accesses = debugger->traceAccesses;
+	mDebuggerSetTrace(&debugger->d, &debugger->binaryTrace);
+}
+
+static void _traceBinary(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (!dv || dv->type != CLIDV_INT_TYPE || !dv->next || !dv->next->charValue) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_MISSING_ARGS);
+		return;
+	}
+	if (dv->intValue == 0) {
+		return;
+	}
+	struct VFile* vf = VFileOpen(dv->next->charValue, O_CREAT | O_WRONLY | O_TRUNC);
+	if (!vf) {
+		debugger->backend->printf(debugger->backend, "Could not open %s\n", dv->next->charValue);
+		return;
+	}
+	_startBinaryTrace(debugger, BINARY_TRACE_BUFFER_SIZE, vf, dv->intValue);
+	debugger->d.state = DEBUGGER_RUNNING;
+}
+
+static void _traceMemory(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (!dv || dv->type != CLIDV_INT_TYPE) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_MISSING_ARGS);
+		return;
+	}
+	debugger->traceAccesses = dv->intValue != 0;
+	if (debugger->d.trace) {
+		debugger->binaryTrace.accesses = debugger->traceAccesses;
+		mDebuggerSetTrace(&debugger->d, &debugger->binaryTrace);
+	}
+}
+
+static void _traceRing(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (!dv || dv->type != CLIDV_INT_TYPE) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_MISSING_ARGS);
+		return;
+	}
+	if (dv->intValue <= 0) {
+		_stopBinaryTrace(debugger);
+		return;
+	}
+	_startBinaryTrace(debugger, dv->intValue, NULL, -1);
+}
+
+static void _traceSave(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (!dv || !dv->charValue) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_MISSING_ARGS);
+		return;
+	}
+	if (!debugger->d.trace || debugger->binaryTrace.vf) {
+		debugger->backend->printf(debugger->backend, "No in-memory trace is being recorded\n");
+		return;
+	}
+	struct VFile* vf = VFileOpen(dv->charValue, O_CREAT | O_WRONLY | O_TRUNC);
+	if (!vf) {
+		debugger->backend->printf(debugger->backend, "Could not open %s\n", dv->charValue);
+		return;
+	}
+	mDebuggerTraceSave(&debugger->binaryTrace, vf, debugger->d.core->platform(debugger->d.core));
+	vf->close(vf);
+	debugger->backend->printf(debugger->backend, "Saved %" PRIz "u records\n", debugger->binaryTrace.size);
+}
+
+static void _startProfile(struct CLIDebugger* debugger, struct CLIDebugVector* dv, bool callers) {
+	int32_t interval = mDEBUGGER_PROFILER_DEFAULT_INTERVAL;
+	if (dv) {
+		if (dv->type != CLIDV_INT_TYPE || dv->intValue <= 0) {
+			debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
+			return;
+		}
+		interval = dv->intValue;
+	}
+	mDebuggerProfilerStart(&debugger->profiler, &debugger->d, interval, callers);
+	debugger->backend->printf(debugger->backend, "Sampling every %" PRIi32 " cycles\n", interval);
+}
+
+static void _profile(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	_startProfile(debugger, dv, false);
+}
+
+static void _profileCallers(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	_startProfile(debugger, dv, true);
+}
+
+static void _profileSave(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (!dv || !dv->charValue) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_MISSING_ARGS);
+		return;
+	}
+	struct VFile* vf = VFileOpen(dv->charValue, O_CREAT | O_WRONLY | O_TRUNC);
+	if (!vf) {
+		debugger->backend->printf(debugger->backend, "Could not open %s\n", dv->charValue);
+		return;
+	}
+	if (mDebuggerProfilerWriteFolded(&debugger->profiler, vf)) {
+		debugger->backend->printf(debugger->backend, "Saved %" PRIu64 " samples\n", debugger->profiler.samples);
+	} else {
+		debugger->backend->printf(debugger->backend, "Could not write %s\n", dv->charValue);
+	}
+	vf->close(vf);
+}
+
+static void _profileStop(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	UNUSED(dv);
+	mDebuggerProfilerStop(&debugger->profiler);
+}
+
+static void _record(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	uint64_t interval = mDEBUGGER_REVERSE_DEFAULT_INTERVAL;
+	if (dv) {
+		if (dv->type != CLIDV_INT_TYPE || dv->intValue < 0) {
+			debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
+			return;
+		}
+		if (!dv->intValue) {
+			mDebuggerSetReverse(&debugger->d, NULL);
+			return;
+		}
+		interval = dv->intValue;
+	}
+	debugger->reverse.interval = interval;
+	mDebuggerSetReverse(&debugger->d, &debugger->reverse);
+	debugger->backend->printf(debugger->backend, "Keeping %" PRIz "u checkpoints, one every %" PRIu64 " instructions\n", debugger->reverse.capacity, interval);
+}
+
+static bool _checkReverse(struct CLIDebugger* debugger, enum mDebuggerReverseResult result) {
+	switch (result) {
+	case REVERSE_STOPPED:
+		return true;
+	case REVERSE_BEGINNING:
+		debugger->backend->printf(debugger->backend, "Reached the beginning of the recording\n");
+		return true;
+	case REVERSE_UNAVAILABLE:
+		debugger->backend->printf(debugger->backend, "Nothing recorded to go back to\n");
+		break;
+	}
+	return false;
+}
+
+static void _reverseStep(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	UNUSED(dv);
+	if (_checkReverse(debugger, mDebuggerReverseStep(&debugger->reverse))) {
+		_printStatus(debugger, 0);
+	}
+}
+
+static void _reverseContinue(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	UNUSED(dv);
+	enum mDebuggerEntryReason reason;
+	struct mDebuggerEntryInfo info;
+	bool hasInfo;
+	enum mDebuggerReverseResult result = mDebuggerReverseContinue(&debugger->reverse, &reason, &info, &hasInfo);
+	if (result == REVERSE_STOPPED) {
+		debugger->d.entered(&debugger->d, reason, hasInfo ? &info : NULL);
+	}
+	if (_checkReverse(debugger, result)) {
+		_printStatus(debugger, 0);
+	}
+}
+
 static bool _doTrace(struct CLIDebugger* debugger) {
 	char trace[1024];
 	trace[sizeof(trace) - 1] = '\0';
-	debugger->d.core->step(debugger->d.core);
+	mDebuggerStep(&debugger->d);
 	size_t traceSize = sizeof(trace) - 2;
 	debugger->d.platform->trace(debugger->d.platform, trace, &traceSize);
 	if (traceSize + 1 <= sizeof(trace)) {
@@ -902,6 +1140,10 @@ static void _commandLine(struct mDebugger* debugger) {
 	struct CLIDebugger* cliDebugger = (struct CLIDebugger*) debugger;
 	const char* line;
 		size_t len;
+	if (debugger->trace && cliDebugger->binaryTrace.vf && !cliDebugger->binaryTrace.remaining) {
+		cliDebugger->backend->printf(cliDebugger->backend, "Recorded %" PRIu64 " instructions\n", cliDebugger->binaryTrace.total);
+		_stopBinaryTrace(cliDebugger);
+	}
 	_printStatus(cliDebugger, 0);
 	while (debugger->state == DEBUGGER_PAUSED) {
 		line = cliDebugger->backend->readline(cliDebugger->backend, &len);
@@ -926,6 +1168,9 @@ static void _reportEntry(struct mDebugger* debugger, enum mDebuggerEntryReason r
 	if (cliDebugger->traceRemaining > 0) {
 		cliDebugger->traceRemaining = 0;
 	}
+	if (debugger->trace && cliDebugger->binaryTrace.vf) {
+		cliDebugger->binaryTrace.remaining = 0;
+	}
 	switch (reason) {
 	case DEBUGGER_ENTER_MANUAL:
 	case DEBUGGER_ENTER_ATTACHED:
@@ -962,6 +1207,11 @@ static void _cliDebuggerInit(struct mDebugger* debugger) {
 	struct CLIDebugger* cliDebugger = (struct CLIDebugger*) debugger;
 	cliDebugger->traceRemaining = 0;
 	cliDebugger->traceVf = NULL;
+	cliDebugger->traceAccesses = false;
+	debugger->trace = NULL;
+	debugger->reverse = NULL;
+	mDebuggerProfilerInit(&cliDebugger->profiler);
+	mDebuggerReverseInit(&cliDebugger->reverse, 0, 0);
 	cliDebugger->backend->init(cliDebugger->backend);
 }
 
@@ -971,6 +1221,10 @@ static void _cliDebuggerDeinit(struct mDebugger* debugger) {
 		cliDebugger->traceVf->close(cliDebugger->traceVf);
 		cliDebugger->traceVf = NULL;
 	}
+	_stopBinaryTrace(cliDebugger);
+	mDebuggerProfilerDeinit(&cliDebugger->profiler);
+	mDebuggerSetReverse(debugger, NULL);
+	mDebuggerReverseDeinit(&cliDebugger->reverse);
 
 	if (cliDebugger->system) {
 		if (cliDebugger->system->deinit) {
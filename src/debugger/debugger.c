@@ -8,7 +8,10 @@
 #include <mgba/core/core.h>
 
 #include <mgba/internal/debugger/cli-debugger.h>
+#include <mgba/internal/debugger/profiler.h>
+#include <mgba/internal/debugger/reverse.h>
 #include <mgba/internal/debugger/symbols.h>
+#include <mgba/internal/debugger/trace.h>
 
 #ifdef USE_GDB_STUB
 #include <mgba/internal/debugger/gdb-stub.h>
@@ -79,19 +82,41 @@ void mDebuggerAttach(struct mDebugger* debugger, struct mCore* core) {
 	core->attachDebugger(core, debugger);
 }
 
+static void _traceStep(struct mDebugger* debugger) {
+	struct mDebuggerTrace* trace = debugger->trace;
+	mDebuggerTraceInstruction(trace, debugger->platform);
+	mDebuggerStep(debugger);
+	debugger->platform->checkBreakpoints(debugger->platform);
+	if (!trace->remaining) {
+		mDebuggerTraceFlush(trace);
+		if (debugger->state == DEBUGGER_RUNNING) {
+			debugger->state = DEBUGGER_PAUSED;
+		}
+	}
+}
+
 void mDebuggerRun(struct mDebugger* debugger) {
+	if (debugger->profiler) {
+		mDebuggerProfilerUpdate(debugger->profiler);
+	}
 	switch (debugger->state) {
 	case DEBUGGER_RUNNING:
-		if (!debugger->platform->hasBreakpoints(debugger->platform)) {
+		if (debugger->trace && debugger->trace->remaining) {
+			_traceStep(debugger);
+		} else if (!debugger->platform->hasBreakpoints(debugger->platform) && !debugger->reverse) {
 			debugger->core->runLoop(debugger->core);
 		} else {
-			debugger->core->step(debugger->core);
+			mDebuggerStep(debugger);
 			debugger->platform->checkBreakpoints(debugger->platform);
 		}
 		break;
 	case DEBUGGER_CUSTOM:
-		debugger->core->step(debugger->core);
-		debugger->platform->checkBreakpoints(debugger->platform);
+		if (debugger->trace && debugger->trace->remaining) {
+			_traceStep(debugger);
+		} else {
+			mDebuggerStep(debugger);
+			debugger->platform->checkBreakpoints(debugger->platform);
+		}
 		debugger->custom(debugger);
 		break;
 	case DEBUGGER_PAUSED:
@@ -113,8 +138,47 @@ void mDebuggerRunFrame(struct mDebugger* debugger) {
 	} while (debugger->core->frameCounter(debugger->core) == frame);
 }
 
+void mDebuggerSetTrace(struct mDebugger* debugger, struct mDebuggerTrace* trace) {
+	debugger->trace = trace;
+	debugger->platform->traceAccesses(debugger->platform, trace && trace->accesses);
+}
+
+void mDebuggerSetReverse(struct mDebugger* debugger, struct mDebuggerReverse* reverse) {
+	if (debugger->reverse) {
+		debugger->reverse->d = NULL;
+	}
+	debugger->reverse = reverse;
+	if (reverse) {
+		reverse->d = debugger;
+		mDebuggerReverseClear(reverse);
+	}
+}
+
+void mDebuggerStep(struct mDebugger* debugger) {
+	struct mDebuggerReverse* reverse = debugger->reverse;
+	if (reverse) {
+		mDebuggerReverseWillStep(reverse);
+	}
+	debugger->core->step(debugger->core);
+	if (reverse) {
+		mDebuggerReverseDidStep(reverse);
+	}
+}
+
 void mDebuggerEnter(struct mDebugger* debugger, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
 	debugger->state = DEBUGGER_PAUSED;
+	if (debugger->reverse && debugger->reverse->replaying) {
+		// Replays only note where they would have stopped. The platform still sees the entry,
+		// since it may have to step over a software breakpoint, but it isn't passed on.
+		mDebuggerReverseRecordEntry(debugger->reverse, reason, info);
+		void (*entered)(struct mDebugger*, enum mDebuggerEntryReason, struct mDebuggerEntryInfo*) = debugger->entered;
+		debugger->entered = NULL;
+		if (debugger->platform->entered) {
+			debugger->platform->entered(debugger->platform, reason, info);
+		}
+		debugger->entered = entered;
+		return;
+	}
 	if (debugger->platform->entered) {
 		debugger->platform->entered(debugger->platform, reason, info);
 	}
@@ -18,6 +18,11 @@
 
 #define SOCKET_TIMEOUT 50
 
+// Largest packet payload we accept or send, excluding the framing characters
+#define GDB_STUB_MAX_PACKET (GDB_STUB_MAX_LINE - 8)
+#define GDB_STUB_MAX_MEMORY_MAP 2048
+#define GDB_STUB_QUEUE_SIZE (GDB_STUB_MAX_LINE * 4)
+
 enum GDBError {
 	GDB_NO_ERROR = 0x00,
 	GDB_BAD_ARGUMENTS = 0x06,
@@ -31,11 +36,21 @@ enum {
 
 static void _sendMessage(struct GDBStub* stub);
 
+static void _gdbStubInit(struct mDebugger* debugger) {
+	struct GDBStub* stub = (struct GDBStub*) debugger;
+	// Continuing already goes one instruction at a time so it can poll, so keeping history costs
+	// little more than the checkpoints themselves
+	mDebuggerReverseInit(&stub->reverse, 0, 0);
+	mDebuggerSetReverse(debugger, &stub->reverse);
+}
+
 static void _gdbStubDeinit(struct mDebugger* debugger) {
 	struct GDBStub* stub = (struct GDBStub*) debugger;
 	if (!SOCKET_FAILED(stub->socket)) {
 		GDBStubShutdown(stub);
 	}
+	mDebuggerSetReverse(debugger, NULL);
+	mDebuggerReverseDeinit(&stub->reverse);
 }
 
 static void _gdbStubEntered(struct mDebugger* debugger, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
@@ -212,13 +227,51 @@ static void _continue(struct GDBStub* stub, const char* message) {
 }
 
 static void _step(struct GDBStub* stub, const char* message) {
-	stub->d.core->step(stub->d.core);
+	mDebuggerStep(&stub->d);
 	snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "S%02x", SIGTRAP);
 	_sendMessage(stub);
 	// TODO: parse message
 	UNUSED(message);
 }
 
+static void _reverse(struct GDBStub* stub, const char* message) {
+	enum mDebuggerReverseResult result;
+	enum mDebuggerEntryReason reason = DEBUGGER_ENTER_MANUAL;
+	struct mDebuggerEntryInfo info;
+	bool hasInfo = false;
+	switch (message[0]) {
+	case 's':
+		result = mDebuggerReverseStep(&stub->reverse);
+		break;
+	case 'c':
+		result = mDebuggerReverseContinue(&stub->reverse, &reason, &info, &hasInfo);
+		break;
+	default:
+		_error(stub, GDB_UNSUPPORTED_COMMAND);
+		return;
+	}
+	switch (result) {
+	case REVERSE_STOPPED:
+		if (message[0] == 'c') {
+			_gdbStubEntered(&stub->d, reason, hasInfo ? &info : NULL);
+			if (stub->d.state == DEBUGGER_PAUSED) {
+				return;
+			}
+			// Writes that didn't change anything aren't reported, but the stop still needs a reply
+			stub->d.state = DEBUGGER_PAUSED;
+		}
+		snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "S%02x", SIGTRAP);
+		break;
+	case REVERSE_BEGINNING:
+		snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "T%02xreplaylog:begin;", SIGTRAP);
+		break;
+	case REVERSE_UNAVAILABLE:
+		_error(stub, GDB_BAD_ARGUMENTS);
+		return;
+	}
+	_sendMessage(stub);
+}
+
 static void _writeMemoryBinary(struct GDBStub* stub, const char* message) {
 	const char* readAddress = message;
 	unsigned i = 0;
@@ -229,7 +282,20 @@ static void _writeMemoryBinary(struct GDBStub* stub, const char* message) {
 	uint32_t size = _readHex(readAddress, &i);
 	readAddress += i + 1;
 
-	if (size > 512) {
+	if (size > GDB_STUB_MAX_PACKET) {
+		_error(stub, GDB_BAD_ARGUMENTS);
+		return;
+	}
+
+	// Make sure the packet actually holds as many bytes as it claims before patching anything
+	const char* data;
+	uint32_t length = 0;
+	for (data = readAddress; *data != '#' && length < size; ++data, ++length) {
+		if (*data == 0x7D) {
+			++data;
+		}
+	}
+	if (length < size) {
 		_error(stub, GDB_BAD_ARGUMENTS);
 		return;
 	}
@@ -248,6 +314,7 @@ static void _writeMemoryBinary(struct GDBStub* stub, const char* message) {
 		GBAPatch8(cpu, address + i, byte, 0);
 	}
 
+	mDebuggerReverseClear(&stub->reverse);
 	strncpy(stub->outgoing, "OK", GDB_STUB_MAX_LINE - 4);
 	_sendMessage(stub);
 }
@@ -263,7 +330,12 @@ static void _writeMemory(struct GDBStub* stub, const char* message) {
 	uint32_t size = _readHex(readAddress, &i);
 	readAddress += i + 1;
 
-	if (size > 512) {
+	if (size > GDB_STUB_MAX_PACKET / 2) {
+		_error(stub, GDB_BAD_ARGUMENTS);
+		return;
+	}
+	const char* terminator = strchr(readAddress, '#');
+	if (!terminator || (uint32_t) (terminator - readAddress) < size * 2) {
 		_error(stub, GDB_BAD_ARGUMENTS);
 		return;
 	}
@@ -274,22 +346,57 @@ static void _writeMemory(struct GDBStub* stub, const char* message) {
 		GBAPatch8(cpu, address + i, byte, 0);
 	}
 
+	mDebuggerReverseClear(&stub->reverse);
 	strncpy(stub->outgoing, "OK", GDB_STUB_MAX_LINE - 4);
 	_sendMessage(stub);
 }
 
+static const uint8_t* _memoryBlock(struct GDBStub* stub, uint32_t address, uint32_t size) {
+	// Plain memory can be copied straight out of the backing arrays, which are stored
+	// little-endian; anything with side effects or mirroring goes through the bus
+	switch (address >> BASE_OFFSET) {
+	case REGION_WORKING_RAM:
+	case REGION_WORKING_IRAM:
+	case REGION_PALETTE_RAM:
+	case REGION_VRAM:
+	case REGION_OAM:
+	case REGION_CART0:
+	case REGION_CART1:
+	case REGION_CART2:
+		break;
+	default:
+		return NULL;
+	}
+	size_t blockSize = 0;
+	const uint8_t* block = stub->d.core->getMemoryBlock(stub->d.core, address >> BASE_OFFSET, &blockSize);
+	uint32_t offset = address & OFFSET_MASK;
+	if (!block || offset > blockSize || size > blockSize - offset) {
+		return NULL;
+	}
+	return &block[offset];
+}
+
 static void _readMemory(struct GDBStub* stub, const char* message) {
 	const char* readAddress = message;
 	unsigned i = 0;
 	uint32_t address = _readHex(readAddress, &i);
 	readAddress += i + 1;
 	uint32_t size = _readHex(readAddress, &i);
-	if (size > 512) {
+	if (size > GDB_STUB_MAX_PACKET / 2) {
 		_error(stub, GDB_BAD_ARGUMENTS);
 		return;
 	}
-	struct ARMCore* cpu = stub->d.core->cpu;
 	int writeAddress = 0;
+	const uint8_t* block = _memoryBlock(stub, address, size);
+	if (block) {
+		for (i = 0; i < size; ++i, writeAddress += 2) {
+			_int2hex8(block[i], &stub->outgoing[writeAddress]);
+		}
+		stub->outgoing[writeAddress] = 0;
+		_sendMessage(stub);
+		return;
+	}
+	struct ARMCore* cpu = stub->d.core->cpu;
 	for (i = 0; i < size; ++i, writeAddress += 2) {
 		uint8_t byte = cpu->memory.load8(cpu, address + i, 0);
 		_int2hex8(byte, &stub->outgoing[writeAddress]);
@@ -313,6 +420,7 @@ static void _writeGPRs(struct GDBStub* stub, const char* message) {
 		ThumbWritePC(cpu);
 	}
 
+	mDebuggerReverseClear(&stub->reverse);
 	strncpy(stub->outgoing, "OK", GDB_STUB_MAX_LINE - 4);
 	_sendMessage(stub);
 }
@@ -384,6 +492,7 @@ static void _writeRegister(struct GDBStub* stub, const char* message) {
 		return;
 	}
 
+	mDebuggerReverseClear(&stub->reverse);
 	strncpy(stub->outgoing, "OK", GDB_STUB_MAX_LINE - 4);
 	_sendMessage(stub);
 }
@@ -434,7 +543,53 @@ static void _processQSupportedCommand(struct GDBStub* stub, const char* message)
 		}
 		message = end + 1;
 	}
-	strncpy(stub->outgoing, "swbreak+;hwbreak+", GDB_STUB_MAX_LINE - 4);
+	snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "PacketSize=%x;qXfer:memory-map:read+;swbreak+;hwbreak+;ReverseStep+;ReverseContinue+", GDB_STUB_MAX_PACKET);
+}
+
+static void _processQXferMemoryMapCommand(struct GDBStub* stub, const char* message) {
+	char map[GDB_STUB_MAX_MEMORY_MAP];
+	size_t mapLength = snprintf(map, sizeof(map), "<?xml version=\"1.0\"?>"
+	                                              "<!DOCTYPE memory-map PUBLIC \"+//IDN gnu.org//DTD GDB Memory Map V1.0//EN\" \"http://sourceware.org/gdb/gdb-memory-map.dtd\">"
+	                                              "<memory-map>");
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = stub->d.core->listMemoryBlocks(stub->d.core, &blocks);
+	size_t i;
+	for (i = 0; i < nBlocks && mapLength < sizeof(map); ++i) {
+		if (!(blocks[i].flags & mCORE_MEMORY_MAPPED)) {
+			continue;
+		}
+		mapLength += snprintf(&map[mapLength], sizeof(map) - mapLength, "<memory type=\"%s\" start=\"0x%08x\" length=\"0x%x\"/>",
+		                      (blocks[i].flags & mCORE_MEMORY_WRITE) ? "ram" : "rom", blocks[i].start, blocks[i].end - blocks[i].start);
+	}
+	if (mapLength < sizeof(map)) {
+		mapLength += snprintf(&map[mapLength], sizeof(map) - mapLength, "</memory-map>");
+	}
+	if (mapLength >= sizeof(map)) {
+		_error(stub, GDB_BAD_ARGUMENTS);
+		return;
+	}
+
+	unsigned read = 0;
+	uint32_t offset = _readHex(message, &read);
+	message += read + 1;
+	read = 0;
+	uint32_t length = _readHex(message, &read);
+	if (length > GDB_STUB_MAX_PACKET - 1) {
+		length = GDB_STUB_MAX_PACKET - 1;
+	}
+	if (offset > mapLength) {
+		_error(stub, GDB_BAD_ARGUMENTS);
+		return;
+	}
+	if (length >= mapLength - offset) {
+		stub->outgoing[0] = 'l';
+		length = mapLength - offset;
+	} else {
+		stub->outgoing[0] = 'm';
+	}
+	memcpy(&stub->outgoing[1], &map[offset], length);
+	stub->outgoing[length + 1] = '\0';
+	_sendMessage(stub);
 }
 
 static void _processQReadCommand(struct GDBStub* stub, const char* message) {
@@ -455,6 +610,9 @@ static void _processQReadCommand(struct GDBStub* stub, const char* message) {
 		strncpy(stub->outgoing, "l", GDB_STUB_MAX_LINE - 4);
 	} else if (!strncmp("Supported:", message, 10)) {
 		_processQSupportedCommand(stub, message + 10);
+	} else if (!strncmp("Xfer:memory-map:read::", message, 22)) {
+		_processQXferMemoryMapCommand(stub, message + 22);
+		return;
 	}
 	_sendMessage(stub);
 }
@@ -495,7 +653,8 @@ static void _setBreakpoint(struct GDBStub* stub, const char* message) {
 		.type = BREAKPOINT_HARDWARE
 	};
 	struct mWatchpoint watchpoint = {
-		.address = address
+		.address = address,
+		.size = kind
 	};
 
 	switch (message[0]) {
@@ -567,6 +726,20 @@ static void _clearBreakpoint(struct GDBStub* stub, const char* message) {
 	_sendMessage(stub);
 }
 
+static size_t _packetLength(const char* message, size_t length) {
+	if (!length) {
+		return 0;
+	}
+	if (message[0] != '$') {
+		return 1;
+	}
+	const char* terminator = memchr(message, '#', length);
+	if (!terminator || (size_t) (terminator - message) + 3 > length) {
+		return 0;
+	}
+	return terminator - message + 3;
+}
+
 size_t _parseGDBMessage(struct GDBStub* stub, const char* message) {
 	uint8_t checksum = 0;
 	int parsed = 1;
@@ -622,6 +795,9 @@ size_t _parseGDBMessage(struct GDBStub* stub, const char* message) {
 		snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "S%02x", SIGINT);
 		_sendMessage(stub);
 		break;
+	case 'b':
+		_reverse(stub, message);
+		break;
 	case 'c':
 		_continue(stub, message);
 		break;
@@ -679,10 +855,233 @@ size_t _parseGDBMessage(struct GDBStub* stub, const char* message) {
 	return parsed;
 }
 
+// Hands on every complete packet in the line buffer, keeping any partial one for the next read.
+// A line that fills up without a complete packet is handed on as NULL. Stops early if the
+// handler returns false.
+static bool _splitPackets(struct GDBStub* stub, bool (*handle)(struct GDBStub*, const char* packet, size_t length)) {
+	size_t position = 0;
+	size_t packetLength;
+	bool keepGoing = true;
+	while (keepGoing && (packetLength = _packetLength(&stub->line[position], stub->lineLength - position))) {
+		char next = stub->line[position + packetLength];
+		stub->line[position + packetLength] = '\0';
+		keepGoing = handle(stub, &stub->line[position], packetLength);
+		stub->line[position + packetLength] = next;
+		position += packetLength;
+	}
+	if (position) {
+		stub->lineLength -= position;
+		memmove(stub->line, &stub->line[position], stub->lineLength + 1);
+	} else if (stub->lineLength == GDB_STUB_MAX_LINE - 1) {
+		keepGoing = handle(stub, NULL, 0);
+		stub->lineLength = 0;
+	}
+	return keepGoing;
+}
+
+static bool _handlePacket(struct GDBStub* stub, const char* packet, size_t length) {
+	UNUSED(length);
+	if (!packet) {
+		mLOG(DEBUGGER, WARN, "Packet too long");
+		_nak(stub);
+		return true;
+	}
+	_parseGDBMessage(stub, packet);
+	return true;
+}
+
+#ifndef DISABLE_THREADING
+static bool _queueRecord(struct GDBStub* stub, enum GDBStubRecordType type, const char* data, size_t length) {
+	struct GDBStubRecord* record = &stub->networkRecord;
+	record->type = type;
+	record->length = length;
+	record->connection = stub->networkConnection;
+	if (length) {
+		memcpy(record->data, data, length);
+	}
+	size_t size = offsetof(struct GDBStubRecord, data) + length;
+	bool queued = true;
+	MutexLock(&stub->queueMutex);
+	while (!RingSPSCWrite(&stub->queue, record, size)) {
+		// The emulation thread hasn't caught up yet, so stop reading and let TCP hold the peer back
+		uint32_t running;
+		ATOMIC_LOAD(running, stub->networkRunning);
+		if (!running) {
+			queued = false;
+			break;
+		}
+		ConditionWaitTimed(&stub->queueCond, &stub->queueMutex, SOCKET_TIMEOUT);
+	}
+	ConditionWake(&stub->queueCond);
+	MutexUnlock(&stub->queueMutex);
+	return queued;
+}
+
+static bool _queuePacket(struct GDBStub* stub, const char* packet, size_t length) {
+	if (!packet) {
+		return _queueRecord(stub, GDB_RECORD_OVERFLOW, NULL, 0);
+	}
+	return _queueRecord(stub, GDB_RECORD_PACKET, packet, length);
+}
+
+static THREAD_ENTRY _networkThread(void* context) {
+	struct GDBStub* stub = context;
+	ThreadSetName("GDB Stub");
+	bool peerLost = false;
+	while (true) {
+		uint32_t flag;
+		ATOMIC_LOAD(flag, stub->networkRunning);
+		if (!flag) {
+			break;
+		}
+		ATOMIC_LOAD(flag, stub->hangupRequested);
+		if (flag) {
+			ATOMIC_STORE(stub->hangupRequested, 0);
+			if (!SOCKET_FAILED(stub->networkConnection)) {
+				SocketClose(stub->networkConnection);
+				stub->networkConnection = INVALID_SOCKET;
+			}
+			stub->lineLength = 0;
+			peerLost = false;
+		}
+
+		if (SOCKET_FAILED(stub->networkConnection)) {
+			Socket reads = stub->socket;
+			SocketPoll(1, &reads, 0, 0, SOCKET_TIMEOUT);
+			Socket connection = SocketAccept(stub->socket, 0);
+			if (SOCKET_FAILED(connection)) {
+				continue;
+			}
+			if (!SocketSetBlocking(connection, false)) {
+				SocketClose(connection);
+				continue;
+			}
+			// Replies are small and latency-bound, so don't let them wait on Nagle's algorithm
+			SocketSetTCPPush(connection, 1);
+			stub->networkConnection = connection;
+			_queueRecord(stub, GDB_RECORD_ATTACHED, NULL, 0);
+			continue;
+		}
+
+		if (peerLost) {
+			// Replies may still be sent on it until the emulation thread has seen it go
+			MutexLock(&stub->queueMutex);
+			ConditionWaitTimed(&stub->queueCond, &stub->queueMutex, SOCKET_TIMEOUT);
+			MutexUnlock(&stub->queueMutex);
+			continue;
+		}
+
+		Socket reads = stub->networkConnection;
+		SocketPoll(1, &reads, 0, 0, SOCKET_TIMEOUT);
+		ssize_t messageLen = SocketRecv(stub->networkConnection, &stub->line[stub->lineLength], GDB_STUB_MAX_LINE - 1 - stub->lineLength);
+		if (messageLen == -1 && SocketWouldBlock()) {
+			continue;
+		}
+		if (messageLen <= 0) {
+			peerLost = true;
+			_queueRecord(stub, GDB_RECORD_DETACHED, NULL, 0);
+			continue;
+		}
+		mLOG(DEBUGGER, DEBUG, "< %.*s", (int) messageLen, &stub->line[stub->lineLength]);
+		stub->lineLength += messageLen;
+		stub->line[stub->lineLength] = '\0';
+		_splitPackets(stub, _queuePacket);
+	}
+
+	if (!SOCKET_FAILED(stub->networkConnection)) {
+		SocketClose(stub->networkConnection);
+		stub->networkConnection = INVALID_SOCKET;
+	}
+	return 0;
+}
+
+static void _startNetworkThread(struct GDBStub* stub) {
+	stub->networkConnection = INVALID_SOCKET;
+	stub->hangupRequested = 0;
+	stub->lineLength = 0;
+	RingSPSCInit(&stub->queue, GDB_STUB_QUEUE_SIZE);
+	MutexInit(&stub->queueMutex);
+	ConditionInit(&stub->queueCond);
+	ATOMIC_STORE(stub->networkRunning, 1);
+	stub->threaded = !ThreadCreate(&stub->networkThread, _networkThread, stub);
+	if (!stub->threaded) {
+		// Fall back to polling the socket from the emulation thread
+		ATOMIC_STORE(stub->networkRunning, 0);
+		ConditionDeinit(&stub->queueCond);
+		MutexDeinit(&stub->queueMutex);
+		RingSPSCDeinit(&stub->queue);
+	}
+}
+
+static void _stopNetworkThread(struct GDBStub* stub) {
+	if (!stub->threaded) {
+		return;
+	}
+	ATOMIC_STORE(stub->networkRunning, 0);
+	MutexLock(&stub->queueMutex);
+	ConditionWake(&stub->queueCond);
+	MutexUnlock(&stub->queueMutex);
+	ThreadJoin(stub->networkThread);
+	stub->threaded = false;
+	ConditionDeinit(&stub->queueCond);
+	MutexDeinit(&stub->queueMutex);
+	RingSPSCDeinit(&stub->queue);
+	stub->lineLength = 0;
+}
+
+// Handles whatever the network thread has queued. With nothing queued this is a single atomic
+// load, so polling costs the emulation thread next to nothing however slow the link is.
+static void _drainQueue(struct GDBStub* stub) {
+	if (stub->shouldBlock && !RingSPSCSize(&stub->queue)) {
+		MutexLock(&stub->queueMutex);
+		if (!RingSPSCSize(&stub->queue)) {
+			ConditionWaitTimed(&stub->queueCond, &stub->queueMutex, SOCKET_TIMEOUT);
+		}
+		MutexUnlock(&stub->queueMutex);
+	}
+	struct GDBStubRecord* record = &stub->record;
+	bool drained = false;
+	while (RingSPSCRead(&stub->queue, record, offsetof(struct GDBStubRecord, data))) {
+		drained = true;
+		if (record->length) {
+			RingSPSCRead(&stub->queue, record->data, record->length);
+		}
+		record->data[record->length] = '\0';
+		switch (record->type) {
+		case GDB_RECORD_ATTACHED:
+			stub->connection = record->connection;
+			mDebuggerEnter(&stub->d, DEBUGGER_ENTER_ATTACHED, 0);
+			break;
+		case GDB_RECORD_DETACHED:
+			mLOG(DEBUGGER, WARN, "Connection lost");
+			GDBStubHangup(stub);
+			break;
+		case GDB_RECORD_PACKET:
+			// Anything left over from a connection that was already hung up is dropped
+			if (!SOCKET_FAILED(stub->connection)) {
+				_parseGDBMessage(stub, record->data);
+			}
+			break;
+		case GDB_RECORD_OVERFLOW:
+			if (!SOCKET_FAILED(stub->connection)) {
+				_handlePacket(stub, NULL, 0);
+			}
+			break;
+		}
+	}
+	if (drained) {
+		// The network thread may be waiting for room
+		MutexLock(&stub->queueMutex);
+		ConditionWake(&stub->queueCond);
+		MutexUnlock(&stub->queueMutex);
+	}
+}
+#endif
+
 void GDBStubCreate(struct GDBStub* stub) {
 	stub->socket = INVALID_SOCKET;
 	stub->connection = INVALID_SOCKET;
-	stub->d.init = 0;
+	stub->d.init = _gdbStubInit;
 	stub->d.deinit = _gdbStubDeinit;
 	stub->d.paused = _gdbStubWait;
 	stub->d.entered = _gdbStubEntered;
@@ -690,7 +1089,12 @@ void GDBStubCreate(struct GDBStub* stub) {
 	stub->d.type = DEBUGGER_GDB;
 	stub->untilPoll = GDB_STUB_INTERVAL;
 	stub->lineAck = GDB_ACK_PENDING;
+	stub->lineLength = 0;
 	stub->shouldBlock = false;
+#ifndef DISABLE_THREADING
+	stub->threaded = false;
+	stub->networkConnection = INVALID_SOCKET;
+#endif
 }
 
 bool GDBStubListen(struct GDBStub* stub, int port, const struct Address* bindAddress) {
@@ -709,6 +1113,9 @@ bool GDBStubListen(struct GDBStub* stub, int port, const struct Address* bindAdd
 	if (err) {
 		goto cleanup;
 	}
+#ifndef DISABLE_THREADING
+	_startNetworkThread(stub);
+#endif
 
 	return true;
 
@@ -720,9 +1127,19 @@ cleanup:
 }
 
 void GDBStubHangup(struct GDBStub* stub) {
-	if (!SOCKET_FAILED(stub->connection)) {
-		SocketClose(stub->connection);
+#ifndef DISABLE_THREADING
+	if (stub->threaded) {
+		// The network thread may be polling it, so it does the closing once it sees the request
 		stub->connection = INVALID_SOCKET;
+		ATOMIC_STORE(stub->hangupRequested, 1);
+	} else
+#endif
+	{
+		if (!SOCKET_FAILED(stub->connection)) {
+			SocketClose(stub->connection);
+			stub->connection = INVALID_SOCKET;
+		}
+		stub->lineLength = 0;
 	}
 	if (stub->d.state == DEBUGGER_PAUSED) {
 		stub->d.state = DEBUGGER_RUNNING;
@@ -731,6 +1148,9 @@ void GDBStubHangup(struct GDBStub* stub) {
 
 void GDBStubShutdown(struct GDBStub* stub) {
 	GDBStubHangup(stub);
+#ifndef DISABLE_THREADING
+	_stopNetworkThread(stub);
+#endif
 	if (!SOCKET_FAILED(stub->socket)) {
 		SocketClose(stub->socket);
 		stub->socket = INVALID_SOCKET;
@@ -744,6 +1164,12 @@ void GDBStubUpdate(struct GDBStub* stub) {
 		}
 		return;
 	}
+#ifndef DISABLE_THREADING
+	if (stub->threaded) {
+		_drainQueue(stub);
+		return;
+	}
+#endif
 	if (stub->connection == INVALID_SOCKET) {
 		if (stub->shouldBlock) {
 			Socket reads = stub->socket;
@@ -754,6 +1180,8 @@ void GDBStubUpdate(struct GDBStub* stub) {
 			if (!SocketSetBlocking(stub->connection, false)) {
 				goto connectionLost;
 			}
+			// Replies are small and latency-bound, so don't let them wait on Nagle's algorithm
+			SocketSetTCPPush(stub->connection, 1);
 			mDebuggerEnter(&stub->d, DEBUGGER_ENTER_ATTACHED, 0);
 		} else if (SocketWouldBlock()) {
 			return;
@@ -766,7 +1194,7 @@ void GDBStubUpdate(struct GDBStub* stub) {
 			Socket reads = stub->connection;
 			SocketPoll(1, &reads, 0, 0, SOCKET_TIMEOUT);
 		}
-		ssize_t messageLen = SocketRecv(stub->connection, stub->line, GDB_STUB_MAX_LINE - 1);
+		ssize_t messageLen = SocketRecv(stub->connection, &stub->line[stub->lineLength], GDB_STUB_MAX_LINE - 1 - stub->lineLength);
 		if (messageLen == 0) {
 			goto connectionLost;
 		}
@@ -776,12 +1204,10 @@ void GDBStubUpdate(struct GDBStub* stub) {
 			}
 			goto connectionLost;
 		}
-		stub->line[messageLen] = '\0';
-		mLOG(DEBUGGER, DEBUG, "< %s", stub->line);
-		ssize_t position = 0;
-		while (position < messageLen) {
-			position += _parseGDBMessage(stub, &stub->line[position]);
-		}
+		mLOG(DEBUGGER, DEBUG, "< %.*s", (int) messageLen, &stub->line[stub->lineLength]);
+		stub->lineLength += messageLen;
+		stub->line[stub->lineLength] = '\0';
+		_splitPackets(stub, _handlePacket);
 	}
 
 connectionLost:
@@ -7,10 +7,42 @@
 
 #include <mgba/core/core.h>
 #include <mgba/debugger/debugger.h>
+#include <mgba/internal/debugger/symbols.h>
 #include <mgba-util/string.h>
 
 DEFINE_VECTOR(LexVector, struct Token);
 
+enum ParseInstructionType {
+	PARSE_CONSTANT,
+	PARSE_REGISTER,
+	PARSE_IDENTIFIER,
+	PARSE_SEGMENT,
+	PARSE_OPERATION,
+};
+
+struct ParseInstruction {
+	enum ParseInstructionType type;
+	union {
+		struct {
+			int32_t value;
+			int segment;
+		} constant;
+		const char* name;
+		enum Operation operation;
+	};
+};
+
+DECLARE_VECTOR(ParseInstructionList, struct ParseInstruction);
+DEFINE_VECTOR(ParseInstructionList, struct ParseInstruction);
+
+struct ParseProgram {
+	struct ParseInstructionList instructions;
+	int32_t* stack;
+	size_t depth;
+	size_t maxDepth;
+	bool valid;
+};
+
 enum LexState {
 	LEX_ERROR = -1,
 	LEX_ROOT = 0,
@@ -498,6 +530,7 @@ static struct ParseTree* _parseTreeCreate() {
 	tree->token.type = TOKEN_ERROR_TYPE;
 	tree->rhs = 0;
 	tree->lhs = 0;
+	tree->program = NULL;
 	return tree;
 }
 
@@ -586,6 +619,7 @@ void parseLexedExpression(struct ParseTree* tree, struct LexVector* lv) {
 	tree->token.type = TOKEN_ERROR_TYPE;
 	tree->lhs = 0;
 	tree->rhs = 0;
+	tree->program = NULL;
 
 	int openParens = 0;
 	_parseExpression(tree, lv, 0, INT_MAX, &openParens);
@@ -624,6 +658,13 @@ void parseFree(struct ParseTree* tree) {
 	if (tree->token.type == TOKEN_IDENTIFIER_TYPE) {
 		free(tree->token.identifierValue);
 	}
+
+	if (tree->program) {
+		ParseInstructionListDeinit(&tree->program->instructions);
+		free(tree->program->stack);
+		free(tree->program);
+		tree->program = NULL;
+	}
 }
 
 static bool _performOperation(struct mDebugger* debugger, enum Operation operation, int32_t current, int32_t next, int32_t* value, int* segment) {
@@ -717,60 +758,181 @@ static bool _performOperation(struct mDebugger* debugger, enum Operation operati
 	return true;
 }
 
-bool mDebuggerEvaluateParseTree(struct mDebugger* debugger, struct ParseTree* tree, int32_t* value, int* segment) {
-	if (!value) {
+static bool _isBinaryOperation(enum Operation operation) {
+	switch (operation) {
+	case OP_NEGATE:
+	case OP_FLIP:
+	case OP_NOT:
+	case OP_DEREFERENCE:
+		return false;
+	default:
+		return true;
+	}
+}
+
+static void _emit(struct ParseProgram* program, const struct ParseInstruction* instruction) {
+	*ParseInstructionListAppend(&program->instructions) = *instruction;
+	switch (instruction->type) {
+	case PARSE_CONSTANT:
+	case PARSE_REGISTER:
+	case PARSE_IDENTIFIER:
+		++program->depth;
+		if (program->depth > program->maxDepth) {
+			program->maxDepth = program->depth;
+		}
+		break;
+	case PARSE_SEGMENT:
+		--program->depth;
+		break;
+	case PARSE_OPERATION:
+		if (_isBinaryOperation(instruction->operation)) {
+			--program->depth;
+		}
+		break;
+	}
+}
+
+static void _compileIdentifier(struct mDebugger* debugger, const char* name, struct ParseInstruction* instruction) {
+	// Resolve the identifier the same way mDebuggerLookupIdentifier would, but only once.
+	// Symbols and I/O register names are fixed addresses, so they become constants.
+	instruction->type = PARSE_IDENTIFIER;
+	instruction->name = name;
+	if (!debugger) {
+		return;
+	}
+#ifdef ENABLE_SCRIPTING
+	if (debugger->bridge) {
+		return;
+	}
+#endif
+	int32_t value;
+	int segment = -1;
+	if (debugger->core->symbolTable && mDebuggerSymbolLookup(debugger->core->symbolTable, name, &value, &segment)) {
+		instruction->type = PARSE_CONSTANT;
+		instruction->constant.value = value;
+		instruction->constant.segment = segment;
+		return;
+	}
+	segment = -1;
+	if (debugger->core->lookupIdentifier(debugger->core, name, &value, &segment)) {
+		instruction->type = PARSE_CONSTANT;
+		instruction->constant.value = value;
+		instruction->constant.segment = segment;
+		return;
+	}
+	if (debugger->platform && debugger->platform->getRegister(debugger->platform, name, &value)) {
+		instruction->type = PARSE_REGISTER;
+	}
+}
+
+static bool _compileTree(struct mDebugger* debugger, struct ParseTree* tree, struct ParseProgram* program) {
+	if (!tree) {
 		return false;
 	}
-	int32_t lhs, rhs;
+	struct ParseInstruction instruction;
 	switch (tree->token.type) {
 	case TOKEN_UINT_TYPE:
-		if (segment) {
-			*segment = -1;
-		}
-		*value = tree->token.uintValue;
-		return true;
+		instruction.type = PARSE_CONSTANT;
+		instruction.constant.value = tree->token.uintValue;
+		instruction.constant.segment = -1;
+		break;
 	case TOKEN_SEGMENT_TYPE:
-		if (!mDebuggerEvaluateParseTree(debugger, tree->rhs, value, segment)) {
+		if (!_compileTree(debugger, tree->rhs, program) || !_compileTree(debugger, tree->lhs, program)) {
 			return false;
 		}
-		return mDebuggerEvaluateParseTree(debugger, tree->lhs, segment, NULL);
+		instruction.type = PARSE_SEGMENT;
+		break;
 	case TOKEN_OPERATOR_TYPE:
-		switch (tree->token.operatorValue) {
-		case OP_ASSIGN:
-		case OP_ADD:
-		case OP_SUBTRACT:
-		case OP_MULTIPLY:
-		case OP_DIVIDE:
-		case OP_MODULO:
-		case OP_AND:
-		case OP_OR:
-		case OP_XOR:
-		case OP_LESS:
-		case OP_GREATER:
-		case OP_EQUAL:
-		case OP_NOT_EQUAL:
-		case OP_LOGICAL_AND:
-		case OP_LOGICAL_OR:
-		case OP_LE:
-		case OP_GE:
-		case OP_SHIFT_L:
-		case OP_SHIFT_R:
-			if (!mDebuggerEvaluateParseTree(debugger, tree->lhs, &lhs, segment)) {
+		if (_isBinaryOperation(tree->token.operatorValue) && !_compileTree(debugger, tree->lhs, program)) {
+			return false;
+		}
+		if (!_compileTree(debugger, tree->rhs, program)) {
+			return false;
+		}
+		instruction.type = PARSE_OPERATION;
+		instruction.operation = tree->token.operatorValue;
+		break;
+	case TOKEN_IDENTIFIER_TYPE:
+		_compileIdentifier(debugger, tree->token.identifierValue, &instruction);
+		break;
+	case TOKEN_ERROR_TYPE:
+	default:
+		return false;
+	}
+	_emit(program, &instruction);
+	return true;
+}
+
+static struct ParseProgram* _compile(struct mDebugger* debugger, struct ParseTree* tree) {
+	struct ParseProgram* program = malloc(sizeof(*program));
+	ParseInstructionListInit(&program->instructions, 0);
+	program->depth = 0;
+	program->maxDepth = 0;
+	program->valid = _compileTree(debugger, tree, program);
+	program->stack = malloc(sizeof(*program->stack) * (program->maxDepth + 1));
+	return program;
+}
+
+bool mDebuggerEvaluateParseTree(struct mDebugger* debugger, struct ParseTree* tree, int32_t* value, int* segment) {
+	if (!value) {
+		return false;
+	}
+	if (!tree->program) {
+		tree->program = _compile(debugger, tree);
+	}
+	struct ParseProgram* program = tree->program;
+	if (!program->valid) {
+		return false;
+	}
+
+	int32_t* stack = program->stack;
+	size_t depth = 0;
+	int currentSegment = -1;
+	size_t i;
+	for (i = 0; i < ParseInstructionListSize(&program->instructions); ++i) {
+		const struct ParseInstruction* instruction = ParseInstructionListGetConstPointer(&program->instructions, i);
+		int32_t lhs = 0;
+		int32_t rhs;
+		switch (instruction->type) {
+		case PARSE_CONSTANT:
+			stack[depth] = instruction->constant.value;
+			currentSegment = instruction->constant.segment;
+			++depth;
+			break;
+		case PARSE_REGISTER:
+			if (!debugger->platform->getRegister(debugger->platform, instruction->name, &stack[depth])) {
 				return false;
 			}
-			// Fall through
-		default:
-			if (!mDebuggerEvaluateParseTree(debugger, tree->rhs, &rhs, segment)) {
+			currentSegment = -1;
+			++depth;
+			break;
+		case PARSE_IDENTIFIER:
+			if (!mDebuggerLookupIdentifier(debugger, instruction->name, &stack[depth], &currentSegment)) {
 				return false;
 			}
+			++depth;
+			break;
+		case PARSE_SEGMENT:
+			--depth;
+			currentSegment = stack[depth];
+			break;
+		case PARSE_OPERATION:
+			--depth;
+			rhs = stack[depth];
+			if (_isBinaryOperation(instruction->operation)) {
+				--depth;
+				lhs = stack[depth];
+			}
+			if (!_performOperation(debugger, instruction->operation, lhs, rhs, &stack[depth], &currentSegment)) {
+				return false;
+			}
+			++depth;
 			break;
 		}
-		return _performOperation(debugger, tree->token.operatorValue, lhs, rhs, value, segment);
-	case TOKEN_IDENTIFIER_TYPE:
-		return mDebuggerLookupIdentifier(debugger, tree->token.identifierValue, value, segment);
-	case TOKEN_ERROR_TYPE:
-	default:
-		break;
 	}
-	return false;
+	*value = stack[0];
+	if (segment) {
+		*segment = currentSegment;
+	}
+	return true;
 }
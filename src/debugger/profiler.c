@@ -0,0 +1,164 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/debugger/profiler.h>
+
+#include <mgba/core/core.h>
+#include <mgba/debugger/debugger.h>
+#include <mgba/internal/debugger/symbols.h>
+#include <mgba-util/vector.h>
+#include <mgba-util/vfs.h>
+
+#define MAX_FRAME_NAME 128
+
+struct mDebuggerProfilerStack {
+	const char* stack;
+	uint64_t count;
+};
+
+DECLARE_VECTOR(mDebuggerProfilerStackList, struct mDebuggerProfilerStack);
+DEFINE_VECTOR(mDebuggerProfilerStackList, struct mDebuggerProfilerStack);
+
+static void _sampleEvent(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	struct mDebuggerProfiler* profiler = context;
+	mTimingSchedule(timing, &profiler->event, profiler->interval - cyclesLate);
+	mDebuggerProfilerSample(profiler);
+}
+
+void mDebuggerProfilerInit(struct mDebuggerProfiler* profiler) {
+	profiler->d = NULL;
+	profiler->event.context = profiler;
+	profiler->event.callback = _sampleEvent;
+	profiler->event.name = "Debugger Profiler";
+	profiler->event.priority = 0x90;
+	profiler->interval = mDEBUGGER_PROFILER_DEFAULT_INTERVAL;
+	profiler->callers = false;
+	profiler->running = false;
+	profiler->samples = 0;
+	HashTableInit(&profiler->stacks, 0, free);
+}
+
+void mDebuggerProfilerDeinit(struct mDebuggerProfiler* profiler) {
+	mDebuggerProfilerStop(profiler);
+	HashTableDeinit(&profiler->stacks);
+}
+
+void mDebuggerProfilerStart(struct mDebuggerProfiler* profiler, struct mDebugger* debugger, int32_t interval, bool callers) {
+	mDebuggerProfilerStop(profiler);
+	mDebuggerProfilerClear(profiler);
+	profiler->d = debugger;
+	profiler->interval = interval > 0 ? interval : mDEBUGGER_PROFILER_DEFAULT_INTERVAL;
+	profiler->callers = callers;
+	profiler->running = true;
+	debugger->profiler = profiler;
+	mTimingSchedule(debugger->core->timing, &profiler->event, profiler->interval);
+}
+
+void mDebuggerProfilerStop(struct mDebuggerProfiler* profiler) {
+	if (!profiler->running) {
+		return;
+	}
+	mTimingDeschedule(profiler->d->core->timing, &profiler->event);
+	if (profiler->d->profiler == profiler) {
+		profiler->d->profiler = NULL;
+	}
+	profiler->running = false;
+}
+
+void mDebuggerProfilerClear(struct mDebuggerProfiler* profiler) {
+	HashTableClear(&profiler->stacks);
+	profiler->samples = 0;
+}
+
+void mDebuggerProfilerUpdate(struct mDebuggerProfiler* profiler) {
+	struct mTiming* timing = profiler->d->core->timing;
+	if (profiler->running && !mTimingIsScheduled(timing, &profiler->event)) {
+		mTimingSchedule(timing, &profiler->event, profiler->interval);
+	}
+}
+
+static const char* _frameName(struct mDebuggerProfiler* profiler, uint32_t address, int segment, char* out) {
+	struct mDebuggerSymbols* symbols = profiler->d->core->symbolTable;
+	if (symbols) {
+		const char* name = mDebuggerSymbolReverseLookup(symbols, address, segment, NULL);
+		if (name) {
+			return name;
+		}
+	}
+	if (segment >= 0) {
+		snprintf(out, MAX_FRAME_NAME, "%02X:%04X", segment, address);
+	} else {
+		snprintf(out, MAX_FRAME_NAME, "0x%08X", address);
+	}
+	return out;
+}
+
+void mDebuggerProfilerSample(struct mDebuggerProfiler* profiler) {
+	struct mDebuggerPlatform* platform = profiler->d->platform;
+	uint32_t pc;
+	int segment;
+	uint32_t returnAddress;
+	bool hasCaller = platform->getCallFrame(platform, &pc, &segment, &returnAddress) && profiler->callers;
+
+	char frame[MAX_FRAME_NAME];
+	char stack[MAX_FRAME_NAME * 2 + 2];
+	const char* name = _frameName(profiler, pc, segment, frame);
+	const char* caller = NULL;
+	if (hasCaller && profiler->d->core->symbolTable) {
+		// The return address follows the call, so back up into the calling instruction. Without a symbol
+		// for it there is no telling whether the return address is a stale leftover, so leave it out.
+		caller = mDebuggerSymbolReverseLookup(profiler->d->core->symbolTable, (returnAddress & ~1) - 1, -1, NULL);
+		if (caller && strcmp(caller, name) == 0) {
+			caller = NULL;
+		}
+	}
+	if (caller) {
+		snprintf(stack, sizeof(stack), "%s;%s", caller, name);
+		name = stack;
+	}
+
+	uint64_t* count = HashTableLookup(&profiler->stacks, name);
+	if (!count) {
+		count = malloc(sizeof(*count));
+		*count = 0;
+		HashTableInsert(&profiler->stacks, name, count);
+	}
+	++*count;
+	++profiler->samples;
+}
+
+static void _collectStack(const char* key, void* value, void* user) {
+	struct mDebuggerProfilerStack* stack = mDebuggerProfilerStackListAppend(user);
+	stack->stack = key;
+	stack->count = *(uint64_t*) value;
+}
+
+static int _compareStacks(const void* a, const void* b) {
+	const struct mDebuggerProfilerStack* x = a;
+	const struct mDebuggerProfilerStack* y = b;
+	return strcmp(x->stack, y->stack);
+}
+
+bool mDebuggerProfilerWriteFolded(const struct mDebuggerProfiler* profiler, struct VFile* vf) {
+	struct mDebuggerProfilerStackList stacks;
+	mDebuggerProfilerStackListInit(&stacks, HashTableSize(&profiler->stacks));
+	HashTableEnumerate(&profiler->stacks, _collectStack, &stacks);
+	qsort(mDebuggerProfilerStackListGetPointer(&stacks, 0), mDebuggerProfilerStackListSize(&stacks), sizeof(struct mDebuggerProfilerStack), _compareStacks);
+
+	bool success = true;
+	size_t i;
+	for (i = 0; i < mDebuggerProfilerStackListSize(&stacks); ++i) {
+		const struct mDebuggerProfilerStack* stack = mDebuggerProfilerStackListGetConstPointer(&stacks, i);
+		char count[32];
+		int length = snprintf(count, sizeof(count), " %" PRIu64 "\n", stack->count);
+		ssize_t stackLength = strlen(stack->stack);
+		if (vf->write(vf, stack->stack, stackLength) != stackLength || vf->write(vf, count, length) != length) {
+			success = false;
+			break;
+		}
+	}
+	mDebuggerProfilerStackListDeinit(&stacks);
+	return success;
+}
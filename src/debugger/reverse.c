@@ -0,0 +1,252 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/debugger/reverse.h>
+
+#include <mgba/core/core.h>
+#include <mgba-util/memory.h>
+
+DEFINE_VECTOR(mDebuggerKeyLog, struct mDebuggerKeyChange);
+
+void mDebuggerReverseInit(struct mDebuggerReverse* reverse, size_t capacity, uint64_t interval) {
+	memset(reverse, 0, sizeof(*reverse));
+	if (!capacity) {
+		capacity = mDEBUGGER_REVERSE_DEFAULT_CHECKPOINTS;
+	}
+	if (!interval) {
+		interval = mDEBUGGER_REVERSE_DEFAULT_INTERVAL;
+	}
+	reverse->capacity = capacity;
+	reverse->interval = interval;
+	reverse->checkpoints = calloc(capacity, sizeof(*reverse->checkpoints));
+	mDebuggerKeyLogInit(&reverse->keys, 0);
+}
+
+static void _freeStates(struct mDebuggerReverse* reverse) {
+	size_t i;
+	for (i = 0; i < reverse->capacity; ++i) {
+		if (reverse->checkpoints[i].state) {
+			mappedMemoryFree(reverse->checkpoints[i].state, reverse->stateSize);
+			reverse->checkpoints[i].state = NULL;
+		}
+	}
+}
+
+void mDebuggerReverseDeinit(struct mDebuggerReverse* reverse) {
+	_freeStates(reverse);
+	free(reverse->checkpoints);
+	reverse->checkpoints = NULL;
+	mDebuggerKeyLogDeinit(&reverse->keys);
+}
+
+void mDebuggerReverseClear(struct mDebuggerReverse* reverse) {
+	reverse->start = 0;
+	reverse->size = 0;
+	reverse->instruction = 0;
+	mDebuggerKeyLogClear(&reverse->keys);
+}
+
+static struct mDebuggerCheckpoint* _checkpoint(struct mDebuggerReverse* reverse, size_t index) {
+	return &reverse->checkpoints[(reverse->start + index) % reverse->capacity];
+}
+
+static void _takeCheckpoint(struct mDebuggerReverse* reverse) {
+	struct mCore* core = reverse->d->core;
+	size_t stateSize = core->stateSize(core);
+	if (stateSize != reverse->stateSize) {
+		// Loading a different game changes the size, which makes every checkpoint useless anyway
+		_freeStates(reverse);
+		mDebuggerReverseClear(reverse);
+		reverse->stateSize = stateSize;
+	}
+
+	struct mDebuggerCheckpoint* checkpoint;
+	if (reverse->size < reverse->capacity) {
+		checkpoint = _checkpoint(reverse, reverse->size);
+		++reverse->size;
+	} else {
+		checkpoint = _checkpoint(reverse, 0);
+		reverse->start = (reverse->start + 1) % reverse->capacity;
+	}
+	if (!checkpoint->state) {
+		checkpoint->state = anonymousMemoryMap(stateSize);
+	}
+	core->saveState(core, checkpoint->state);
+	checkpoint->instruction = reverse->instruction;
+	checkpoint->keys = core->getKeys(core);
+	reverse->lastKeys = checkpoint->keys;
+
+	// Changes from before the oldest checkpoint can never be replayed again
+	uint64_t oldest = _checkpoint(reverse, 0)->instruction;
+	size_t stale = 0;
+	while (stale < mDebuggerKeyLogSize(&reverse->keys) && mDebuggerKeyLogGetPointer(&reverse->keys, stale)->instruction < oldest) {
+		++stale;
+	}
+	if (stale) {
+		mDebuggerKeyLogShift(&reverse->keys, 0, stale);
+	}
+}
+
+void mDebuggerReverseWillStep(struct mDebuggerReverse* reverse) {
+	reverse->stepping = true;
+	if (reverse->replaying) {
+		return;
+	}
+	if (!reverse->size || reverse->instruction - _checkpoint(reverse, reverse->size - 1)->instruction >= reverse->interval) {
+		_takeCheckpoint(reverse);
+		return;
+	}
+	struct mCore* core = reverse->d->core;
+	uint32_t keys = core->getKeys(core);
+	if (keys != reverse->lastKeys) {
+		struct mDebuggerKeyChange* change = mDebuggerKeyLogAppend(&reverse->keys);
+		change->instruction = reverse->instruction;
+		change->keys = keys;
+		reverse->lastKeys = keys;
+	}
+}
+
+void mDebuggerReverseDidStep(struct mDebuggerReverse* reverse) {
+	++reverse->instruction;
+	reverse->stepping = false;
+	if (reverse->pendingHit) {
+		reverse->lastHit = reverse->instruction;
+		reverse->pendingHit = false;
+	}
+}
+
+void mDebuggerReverseRecordEntry(struct mDebuggerReverse* reverse, enum mDebuggerEntryReason reason, const struct mDebuggerEntryInfo* info) {
+	// Watchpoints fire partway through a step, so they count as stopping once it's done.
+	// Breakpoints are checked between steps and stop right where they are.
+	if (reverse->stepping) {
+		reverse->pendingHit = true;
+	} else {
+		reverse->lastHit = reverse->instruction;
+	}
+	reverse->hitReason = reason;
+	reverse->hitHasInfo = info != NULL;
+	if (info) {
+		reverse->hitInfo = *info;
+	}
+}
+
+// Newest checkpoint from strictly before position, or -1
+static ssize_t _find(struct mDebuggerReverse* reverse, uint64_t position) {
+	ssize_t i;
+	for (i = reverse->size - 1; i >= 0; --i) {
+		if (_checkpoint(reverse, i)->instruction < position) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void _beginReplay(struct mDebuggerReverse* reverse) {
+	struct mCore* core = reverse->d->core;
+	reverse->replaying = true;
+	core->setOutputSuppressed(core, true, true);
+}
+
+static void _endReplay(struct mDebuggerReverse* reverse) {
+	struct mCore* core = reverse->d->core;
+	reverse->replaying = false;
+	reverse->pendingHit = false;
+	core->setOutputSuppressed(core, false, false);
+	reverse->d->state = DEBUGGER_PAUSED;
+
+	// Anything recorded past here is the future now, and running forward records it again
+	while (reverse->size && _checkpoint(reverse, reverse->size - 1)->instruction > reverse->instruction) {
+		--reverse->size;
+	}
+	size_t keep = mDebuggerKeyLogSize(&reverse->keys);
+	while (keep && mDebuggerKeyLogGetPointer(&reverse->keys, keep - 1)->instruction > reverse->instruction) {
+		--keep;
+	}
+	mDebuggerKeyLogResize(&reverse->keys, (ssize_t) keep - (ssize_t) mDebuggerKeyLogSize(&reverse->keys));
+	reverse->lastKeys = core->getKeys(core);
+}
+
+// Restores a checkpoint and steps forward to the position, noting the last entry on the way
+static void _replay(struct mDebuggerReverse* reverse, size_t index, uint64_t position) {
+	struct mDebugger* debugger = reverse->d;
+	struct mCore* core = debugger->core;
+	const struct mDebuggerCheckpoint* checkpoint = _checkpoint(reverse, index);
+	core->loadState(core, checkpoint->state);
+	core->setKeys(core, checkpoint->keys);
+	reverse->instruction = checkpoint->instruction;
+	reverse->lastHit = 0;
+
+	size_t nextKey = 0;
+	size_t nKeys = mDebuggerKeyLogSize(&reverse->keys);
+	while (nextKey < nKeys && mDebuggerKeyLogGetPointer(&reverse->keys, nextKey)->instruction < reverse->instruction) {
+		++nextKey;
+	}
+	while (reverse->instruction < position) {
+		if (nextKey < nKeys) {
+			const struct mDebuggerKeyChange* change = mDebuggerKeyLogGetPointer(&reverse->keys, nextKey);
+			if (change->instruction == reverse->instruction) {
+				core->setKeys(core, change->keys);
+				++nextKey;
+			}
+		}
+		mDebuggerStep(debugger);
+		debugger->platform->checkBreakpoints(debugger->platform);
+	}
+}
+
+enum mDebuggerReverseResult mDebuggerReverseStep(struct mDebuggerReverse* reverse) {
+	if (!reverse->d || !reverse->size) {
+		return REVERSE_UNAVAILABLE;
+	}
+	ssize_t index = _find(reverse, reverse->instruction);
+	if (index < 0) {
+		return REVERSE_BEGINNING;
+	}
+	_beginReplay(reverse);
+	_replay(reverse, index, reverse->instruction - 1);
+	_endReplay(reverse);
+	return REVERSE_STOPPED;
+}
+
+enum mDebuggerReverseResult mDebuggerReverseContinue(struct mDebuggerReverse* reverse, enum mDebuggerEntryReason* reason, struct mDebuggerEntryInfo* info, bool* hasInfo) {
+	if (!reverse->d || !reverse->size) {
+		return REVERSE_UNAVAILABLE;
+	}
+	if (!reverse->instruction) {
+		return REVERSE_BEGINNING;
+	}
+	_beginReplay(reverse);
+	// Each pass replays one checkpoint's span, newest first, for entries up to and including end
+	uint64_t end = reverse->instruction - 1;
+	ssize_t index;
+	while ((index = _find(reverse, end)) >= 0) {
+		_replay(reverse, index, end);
+		if (reverse->lastHit) {
+			uint64_t hit = reverse->lastHit;
+			enum mDebuggerEntryReason hitReason = reverse->hitReason;
+			struct mDebuggerEntryInfo hitInfo = reverse->hitInfo;
+			bool hitHasInfo = reverse->hitHasInfo;
+			if (hit != end) {
+				_replay(reverse, index, hit);
+			}
+			_endReplay(reverse);
+			if (reason) {
+				*reason = hitReason;
+			}
+			if (info) {
+				*info = hitInfo;
+			}
+			if (hasInfo) {
+				*hasInfo = hitHasInfo;
+			}
+			return REVERSE_STOPPED;
+		}
+		end = _checkpoint(reverse, index)->instruction;
+	}
+	// Nothing was hit, so stop as far back as the history goes
+	_replay(reverse, 0, _checkpoint(reverse, 0)->instruction);
+	_endReplay(reverse);
+	return REVERSE_BEGINNING;
+}
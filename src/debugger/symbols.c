@@ -7,28 +7,214 @@
 
 #include <mgba-util/string.h>
 #include <mgba-util/table.h>
+#include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 
 struct mDebuggerSymbol {
 	int32_t value;
 	int segment;
+	uint32_t size;
+};
+
+struct mDebuggerSymbolIndexEntry {
+	int32_t value;
+	int segment;
+	uint32_t size;
+	const char* name;
+};
+
+DECLARE_VECTOR(mDebuggerSymbolIndex, struct mDebuggerSymbolIndexEntry);
+DEFINE_VECTOR(mDebuggerSymbolIndex, struct mDebuggerSymbolIndexEntry);
+
+#define SYMBOL_CHUNK_SIZE 1024
+#define SYMBOL_SMALL_RUN 16
+
+// Symbols are carved out of chunks that are only freed along with the table, so loading
+// a large symbol table doesn't cost an allocation per symbol. Replaced or removed
+// symbols are left in place until then.
+struct mDebuggerSymbolChunk {
+	struct mDebuggerSymbolChunk* next;
+	size_t used;
+	struct mDebuggerSymbol symbols[SYMBOL_CHUNK_SIZE];
 };
 
 struct mDebuggerSymbols {
 	struct Table names;
+	struct mDebuggerSymbolChunk* chunks;
+
+	// Sorted by segment and address; names point into the keys of the names table,
+	// so the index is thrown away whenever a symbol is added or removed
+	struct mDebuggerSymbolIndex index;
+	bool indexDirty;
 };
 
 struct mDebuggerSymbols* mDebuggerSymbolTableCreate(void) {
 	struct mDebuggerSymbols* st = malloc(sizeof(*st));
-	HashTableInit(&st->names, 0, free);
+	HashTableInit(&st->names, 0, NULL);
+	st->chunks = NULL;
+	mDebuggerSymbolIndexInit(&st->index, 0);
+	st->indexDirty = false;
 	return st;
 }
 
 void mDebuggerSymbolTableDestroy(struct mDebuggerSymbols* st) {
 	HashTableDeinit(&st->names);
+	while (st->chunks) {
+		struct mDebuggerSymbolChunk* next = st->chunks->next;
+		free(st->chunks);
+		st->chunks = next;
+	}
+	mDebuggerSymbolIndexDeinit(&st->index);
 	free(st);
 }
 
+void mDebuggerSymbolTableReserve(struct mDebuggerSymbols* st, size_t count) {
+	HashTableReserve(&st->names, HashTableSize(&st->names) + count);
+}
+
+static struct mDebuggerSymbol* _allocSymbol(struct mDebuggerSymbols* st) {
+	if (!st->chunks || st->chunks->used == SYMBOL_CHUNK_SIZE) {
+		struct mDebuggerSymbolChunk* chunk = malloc(sizeof(*chunk));
+		chunk->next = st->chunks;
+		chunk->used = 0;
+		st->chunks = chunk;
+	}
+	return &st->chunks->symbols[st->chunks->used++];
+}
+
+static void _invalidateIndex(struct mDebuggerSymbols* st) {
+	mDebuggerSymbolIndexClear(&st->index);
+	st->indexDirty = true;
+}
+
+static void _indexSymbol(const char* name, void* value, void* user) {
+	struct mDebuggerSymbol* sym = value;
+	struct mDebuggerSymbolIndexEntry* entry = mDebuggerSymbolIndexAppend(user);
+	entry->value = sym->value;
+	entry->segment = sym->segment;
+	entry->size = sym->size;
+	entry->name = name;
+}
+
+static int _compareIndexEntries(const void* a, const void* b) {
+	const struct mDebuggerSymbolIndexEntry* x = a;
+	const struct mDebuggerSymbolIndexEntry* y = b;
+	if (x->segment != y->segment) {
+		return x->segment < y->segment ? -1 : 1;
+	}
+	if (x->value != y->value) {
+		return (uint32_t) x->value < (uint32_t) y->value ? -1 : 1;
+	}
+	// Among symbols at the same address, the lookup picks the last one, so prefer the
+	// largest and then the alphabetically first to keep results stable
+	if (x->size != y->size) {
+		return x->size < y->size ? -1 : 1;
+	}
+	return strcmp(y->name, x->name);
+}
+
+static inline uint64_t _indexKey(const struct mDebuggerSymbolIndexEntry* entry) {
+	return ((uint64_t) ((uint32_t) entry->segment ^ 0x80000000) << 32) | (uint32_t) entry->value;
+}
+
+// Sorts by segment and address with a stable LSD radix sort, skipping the bytes that are
+// the same in every key (usually most of the segment), and then settles ties the same way
+// _compareIndexEntries does. Symbol files from linkers run into the hundreds of thousands
+// of entries, which qsort is noticeably slow at.
+static void _sortIndex(struct mDebuggerSymbolIndexEntry* entries, size_t size) {
+	if (size < 2) {
+		return;
+	}
+	struct mDebuggerSymbolIndexEntry* scratch = malloc(size * sizeof(*scratch));
+	struct mDebuggerSymbolIndexEntry* in = entries;
+	struct mDebuggerSymbolIndexEntry* out = scratch;
+	size_t counts[256];
+	unsigned shift;
+	size_t i;
+	for (shift = 0; shift < 64; shift += 8) {
+		memset(counts, 0, sizeof(counts));
+		for (i = 0; i < size; ++i) {
+			++counts[(_indexKey(&in[i]) >> shift) & 0xFF];
+		}
+		if (counts[(_indexKey(&in[0]) >> shift) & 0xFF] == size) {
+			continue;
+		}
+		size_t offset = 0;
+		for (i = 0; i < 256; ++i) {
+			size_t count = counts[i];
+			counts[i] = offset;
+			offset += count;
+		}
+		for (i = 0; i < size; ++i) {
+			out[counts[(_indexKey(&in[i]) >> shift) & 0xFF]++] = in[i];
+		}
+		struct mDebuggerSymbolIndexEntry* swap = in;
+		in = out;
+		out = swap;
+	}
+	if (in != entries) {
+		memcpy(entries, in, size * sizeof(*entries));
+	}
+	free(scratch);
+
+	size_t start;
+	for (start = 0; start < size; start = i) {
+		uint64_t key = _indexKey(&entries[start]);
+		for (i = start + 1; i < size && _indexKey(&entries[i]) == key; ++i);
+		size_t run = i - start;
+		if (run < 2) {
+			continue;
+		}
+		if (run > SYMBOL_SMALL_RUN) {
+			qsort(&entries[start], run, sizeof(*entries), _compareIndexEntries);
+			continue;
+		}
+		size_t j;
+		for (j = start + 1; j < i; ++j) {
+			struct mDebuggerSymbolIndexEntry entry = entries[j];
+			size_t k;
+			for (k = j; k > start && _compareIndexEntries(&entries[k - 1], &entry) > 0; --k) {
+				entries[k] = entries[k - 1];
+			}
+			entries[k] = entry;
+		}
+	}
+}
+
+static void _buildIndex(struct mDebuggerSymbols* st) {
+	mDebuggerSymbolIndexClear(&st->index);
+	mDebuggerSymbolIndexEnsureCapacity(&st->index, HashTableSize(&st->names));
+	HashTableEnumerate(&st->names, _indexSymbol, &st->index);
+	_sortIndex(mDebuggerSymbolIndexGetPointer(&st->index, 0), mDebuggerSymbolIndexSize(&st->index));
+	st->indexDirty = false;
+}
+
+static const struct mDebuggerSymbolIndexEntry* _findPreceding(const struct mDebuggerSymbolIndex* index, uint32_t value, int segment) {
+	size_t low = 0;
+	size_t high = mDebuggerSymbolIndexSize(index);
+	// Find the first entry after (segment, value)
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		const struct mDebuggerSymbolIndexEntry* entry = mDebuggerSymbolIndexGetConstPointer(index, mid);
+		if (entry->segment < segment || (entry->segment == segment && (uint32_t) entry->value <= value)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	if (!low) {
+		return NULL;
+	}
+	const struct mDebuggerSymbolIndexEntry* entry = mDebuggerSymbolIndexGetConstPointer(index, low - 1);
+	if (entry->segment != segment) {
+		return NULL;
+	}
+	if (entry->size && value - (uint32_t) entry->value >= entry->size) {
+		return NULL;
+	}
+	return entry;
+}
+
 bool mDebuggerSymbolLookup(const struct mDebuggerSymbols* st, const char* name, int32_t* value, int* segment) {
 	struct mDebuggerSymbol* sym = HashTableLookup(&st->names, name);
 	if (!sym) {
@@ -40,16 +226,40 @@ bool mDebuggerSymbolLookup(const struct mDebuggerSymbols* st, const char* name,
 }
 
 void mDebuggerSymbolAdd(struct mDebuggerSymbols* st, const char* name, int32_t value, int segment) {
-	struct mDebuggerSymbol* sym = malloc(sizeof(*sym));
+	mDebuggerSymbolAddSized(st, name, value, segment, 0);
+}
+
+void mDebuggerSymbolAddSized(struct mDebuggerSymbols* st, const char* name, int32_t value, int segment, uint32_t size) {
+	struct mDebuggerSymbol* sym = _allocSymbol(st);
 	sym->value = value;
 	sym->segment = segment;
+	sym->size = size;
+	_invalidateIndex(st);
 	HashTableInsert(&st->names, name, sym);
 }
 
 void mDebuggerSymbolRemove(struct mDebuggerSymbols* st, const char* name) {
+	_invalidateIndex(st);
 	HashTableRemove(&st->names, name);
 }
 
+const char* mDebuggerSymbolReverseLookup(struct mDebuggerSymbols* st, int32_t value, int segment, uint32_t* offset) {
+	if (st->indexDirty) {
+		_buildIndex(st);
+	}
+	const struct mDebuggerSymbolIndexEntry* entry = _findPreceding(&st->index, value, segment);
+	if (!entry && segment >= 0) {
+		entry = _findPreceding(&st->index, value, -1);
+	}
+	if (!entry) {
+		return NULL;
+	}
+	if (offset) {
+		*offset = value - entry->value;
+	}
+	return entry->name;
+}
+
 void mDebuggerLoadARMIPSSymbols(struct mDebuggerSymbols* st, struct VFile* vf) {
 	char line[512];
 
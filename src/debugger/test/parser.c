@@ -135,6 +135,52 @@ M_TEST_DEFINE(parseUnaryChainedOperator) {
 	assert_int_equal(tree->rhs->rhs->token.uintValue, 2);
 }
 
+M_TEST_DEFINE(evaluateConstantExpression) {
+	PARSE("1 + 2 * 3 - -4");
+
+	int32_t value;
+	int segment;
+	assert_true(mDebuggerEvaluateParseTree(NULL, tree, &value, &segment));
+	assert_int_equal(value, 11);
+	assert_int_equal(segment, -1);
+
+	// Evaluating again reuses the compiled form
+	assert_true(mDebuggerEvaluateParseTree(NULL, tree, &value, &segment));
+	assert_int_equal(value, 11);
+}
+
+M_TEST_DEFINE(evaluateParentheticalExpression) {
+	PARSE("(1 + 2) * 3 == 9 && ~0 == -1");
+
+	int32_t value;
+	assert_true(mDebuggerEvaluateParseTree(NULL, tree, &value, NULL));
+	assert_int_equal(value, 1);
+}
+
+M_TEST_DEFINE(evaluateSegment) {
+	PARSE("0x2:10 + 1");
+
+	int32_t value;
+	int segment;
+	assert_true(mDebuggerEvaluateParseTree(NULL, tree, &value, &segment));
+	assert_int_equal(value, 0x11);
+	assert_int_equal(segment, 2);
+}
+
+M_TEST_DEFINE(evaluateDivideByZero) {
+	PARSE("1 / 0");
+
+	int32_t value;
+	assert_false(mDebuggerEvaluateParseTree(NULL, tree, &value, NULL));
+}
+
+M_TEST_DEFINE(evaluateError) {
+	PARSE("1 +");
+
+	int32_t value;
+	assert_false(mDebuggerEvaluateParseTree(NULL, tree, &value, NULL));
+}
+
 M_TEST_SUITE_DEFINE(Parser,
 	cmocka_unit_test_setup_teardown(parseEmpty, parseSetup, parseTeardown),
 	cmocka_unit_test_setup_teardown(parseInt, parseSetup, parseTeardown),
@@ -145,4 +191,9 @@ M_TEST_SUITE_DEFINE(Parser,
 	cmocka_unit_test_setup_teardown(parseParentheticalExpression, parseSetup, parseTeardown),
 	cmocka_unit_test_setup_teardown(parseParentheticalAddMultplyExpression, parseSetup, parseTeardown),
 	cmocka_unit_test_setup_teardown(parseIsolatedOperator, parseSetup, parseTeardown),
-	cmocka_unit_test_setup_teardown(parseUnaryChainedOperator, parseSetup, parseTeardown))
+	cmocka_unit_test_setup_teardown(parseUnaryChainedOperator, parseSetup, parseTeardown),
+	cmocka_unit_test_setup_teardown(evaluateConstantExpression, parseSetup, parseTeardown),
+	cmocka_unit_test_setup_teardown(evaluateParentheticalExpression, parseSetup, parseTeardown),
+	cmocka_unit_test_setup_teardown(evaluateSegment, parseSetup, parseTeardown),
+	cmocka_unit_test_setup_teardown(evaluateDivideByZero, parseSetup, parseTeardown),
+	cmocka_unit_test_setup_teardown(evaluateError, parseSetup, parseTeardown))
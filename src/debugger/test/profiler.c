@@ -0,0 +1,136 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/debugger/debugger.h>
+#include <mgba/internal/debugger/profiler.h>
+#include <mgba/internal/debugger/symbols.h>
+#include <mgba-util/vfs.h>
+
+struct ProfilerTestContext {
+	struct mDebuggerPlatform platform;
+	struct mDebugger debugger;
+	struct mCore core;
+	struct mTiming timing;
+	int32_t relativeCycles;
+	int32_t nextEvent;
+	uint32_t pc;
+	uint32_t returnAddress;
+	bool hasReturnAddress;
+	struct mDebuggerProfiler profiler;
+};
+
+static bool _getCallFrame(struct mDebuggerPlatform* platform, uint32_t* pc, int* segment, uint32_t* returnAddress) {
+	struct ProfilerTestContext* context = (struct ProfilerTestContext*) platform;
+	*pc = context->pc;
+	*segment = -1;
+	*returnAddress = context->returnAddress;
+	return context->hasReturnAddress;
+}
+
+static void _runCycles(struct ProfilerTestContext* context, int32_t cycles) {
+	context->relativeCycles = 0;
+	mTimingTick(&context->timing, cycles);
+}
+
+static void _assertFolded(struct ProfilerTestContext* context, const char* expected) {
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mDebuggerProfilerWriteFolded(&context->profiler, vf));
+	char buffer[256] = {0};
+	vf->seek(vf, 0, SEEK_SET);
+	vf->read(vf, buffer, sizeof(buffer) - 1);
+	vf->close(vf);
+	assert_string_equal(buffer, expected);
+}
+
+M_TEST_SUITE_SETUP(Profiler) {
+	struct ProfilerTestContext* context = calloc(1, sizeof(*context));
+	context->platform.getCallFrame = _getCallFrame;
+	context->debugger.platform = &context->platform;
+	context->debugger.core = &context->core;
+	context->core.timing = &context->timing;
+	context->core.symbolTable = mDebuggerSymbolTableCreate();
+	mDebuggerSymbolAddSized(context->core.symbolTable, "main", 0x08000100, -1, 0x100);
+	mDebuggerSymbolAddSized(context->core.symbolTable, "caller", 0x08000400, -1, 0x40);
+	mTimingInit(&context->timing, &context->relativeCycles, &context->nextEvent);
+	mDebuggerProfilerInit(&context->profiler);
+	*state = context;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(Profiler) {
+	struct ProfilerTestContext* context = *state;
+	mDebuggerProfilerDeinit(&context->profiler);
+	mTimingDeinit(&context->timing);
+	mDebuggerSymbolTableDestroy(context->core.symbolTable);
+	free(context);
+	return 0;
+}
+
+M_TEST_DEFINE(profileInterval) {
+	struct ProfilerTestContext* context = *state;
+	context->pc = 0x08000120;
+	context->hasReturnAddress = false;
+	mDebuggerProfilerStart(&context->profiler, &context->debugger, 100, false);
+	_runCycles(context, 1050);
+	mDebuggerProfilerStop(&context->profiler);
+	_runCycles(context, 1000);
+	assert_int_equal(context->profiler.samples, 10);
+	assert_null(context->debugger.profiler);
+	_assertFolded(context, "main 10\n");
+}
+
+M_TEST_DEFINE(profileCallers) {
+	struct ProfilerTestContext* context = *state;
+	context->hasReturnAddress = true;
+	mDebuggerProfilerStart(&context->profiler, &context->debugger, 100, true);
+	context->pc = 0x08000120;
+	context->returnAddress = 0x08000411;
+	_runCycles(context, 300);
+	// A return address into the same function is most likely stale
+	context->returnAddress = 0x08000131;
+	_runCycles(context, 200);
+	// So is one into code without a symbol
+	context->returnAddress = 0x02000001;
+	_runCycles(context, 100);
+	mDebuggerProfilerStop(&context->profiler);
+	assert_int_equal(context->profiler.samples, 6);
+	_assertFolded(context, "caller;main 3\nmain 3\n");
+}
+
+M_TEST_DEFINE(profileUnknown) {
+	struct ProfilerTestContext* context = *state;
+	context->hasReturnAddress = false;
+	mDebuggerProfilerStart(&context->profiler, &context->debugger, 100, false);
+	context->pc = 0x03000010;
+	_runCycles(context, 200);
+	context->pc = 0x08000300;
+	_runCycles(context, 100);
+	mDebuggerProfilerStop(&context->profiler);
+	_assertFolded(context, "0x03000010 2\n0x08000300 1\n");
+}
+
+M_TEST_DEFINE(profileReschedule) {
+	struct ProfilerTestContext* context = *state;
+	context->pc = 0x08000120;
+	context->hasReturnAddress = false;
+	mDebuggerProfilerStart(&context->profiler, &context->debugger, 100, false);
+	_runCycles(context, 100);
+	mTimingClear(&context->timing);
+	_runCycles(context, 500);
+	assert_int_equal(context->profiler.samples, 1);
+	mDebuggerProfilerUpdate(&context->profiler);
+	_runCycles(context, 200);
+	mDebuggerProfilerStop(&context->profiler);
+	assert_int_equal(context->profiler.samples, 3);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(Profiler,
+	cmocka_unit_test(profileInterval),
+	cmocka_unit_test(profileCallers),
+	cmocka_unit_test(profileUnknown),
+	cmocka_unit_test(profileReschedule))
@@ -0,0 +1,153 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+#include "core/test/test-core.h"
+
+#include <mgba/debugger/debugger.h>
+#include <mgba/internal/debugger/reverse.h>
+
+struct ReverseTestContext {
+	struct mDebuggerPlatform platform;
+	struct mDebugger debugger;
+	struct TestCore core;
+	uint32_t breakpoints[2];
+	struct mDebuggerReverse reverse;
+};
+
+static void _checkBreakpoints(struct mDebuggerPlatform* platform) {
+	struct ReverseTestContext* context = (struct ReverseTestContext*) platform;
+	size_t i;
+	for (i = 0; i < sizeof(context->breakpoints) / sizeof(*context->breakpoints); ++i) {
+		if (context->breakpoints[i] && (uint32_t) context->core.state.frame == context->breakpoints[i]) {
+			struct mDebuggerEntryInfo info = {
+				.address = context->core.state.frame
+			};
+			mDebuggerEnter(&context->debugger, DEBUGGER_ENTER_BREAKPOINT, &info);
+		}
+	}
+}
+
+static void _reset(struct ReverseTestContext* context) {
+	memset(&context->core.state, 0, sizeof(context->core.state));
+	context->core.keys = 0;
+	mDebuggerReverseClear(&context->reverse);
+}
+
+static void _run(struct ReverseTestContext* context, uint32_t steps) {
+	while (steps--) {
+		mDebuggerStep(&context->debugger);
+		context->platform.checkBreakpoints(&context->platform);
+	}
+}
+
+M_TEST_SUITE_SETUP(Reverse) {
+	struct ReverseTestContext* context = calloc(1, sizeof(*context));
+	context->platform.checkBreakpoints = _checkBreakpoints;
+	context->debugger.platform = &context->platform;
+	TestCoreInit(&context->core);
+	context->debugger.core = &context->core.d;
+	mDebuggerReverseInit(&context->reverse, 4, 10);
+	mDebuggerSetReverse(&context->debugger, &context->reverse);
+	*state = context;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(Reverse) {
+	struct ReverseTestContext* context = *state;
+	mDebuggerSetReverse(&context->debugger, NULL);
+	mDebuggerReverseDeinit(&context->reverse);
+	free(context);
+	return 0;
+}
+
+M_TEST_DEFINE(reverseUnavailable) {
+	struct ReverseTestContext* context = *state;
+	_reset(context);
+	assert_int_equal(mDebuggerReverseStep(&context->reverse), REVERSE_UNAVAILABLE);
+	_run(context, 5);
+	mDebuggerReverseClear(&context->reverse);
+	assert_int_equal(mDebuggerReverseContinue(&context->reverse, NULL, NULL, NULL), REVERSE_UNAVAILABLE);
+}
+
+M_TEST_DEFINE(reverseStep) {
+	struct ReverseTestContext* context = *state;
+	_reset(context);
+	uint32_t hashes[36];
+	uint32_t i;
+	for (i = 0; i < 35; ++i) {
+		if (i == 5) {
+			context->core.keys = 1;
+		} else if (i == 22) {
+			context->core.keys = 2;
+		}
+		hashes[i] = context->core.state.hash;
+		_run(context, 1);
+	}
+	hashes[35] = context->core.state.hash;
+
+	for (i = 34; i >= 29; --i) {
+		assert_int_equal(mDebuggerReverseStep(&context->reverse), REVERSE_STOPPED);
+		assert_int_equal(context->core.state.frame, i);
+		assert_int_equal(context->core.state.hash, hashes[i]);
+	}
+	assert_false(context->core.suppressed);
+	assert_int_equal(context->debugger.state, DEBUGGER_PAUSED);
+
+	// Going forward again picks up from the keys that were held at that point
+	_run(context, 3);
+	assert_int_equal(context->core.state.frame, 32);
+	assert_int_equal(context->core.state.hash, hashes[32]);
+
+	// Crossing a key change and a checkpoint
+	for (i = 31; i >= 20; --i) {
+		assert_int_equal(mDebuggerReverseStep(&context->reverse), REVERSE_STOPPED);
+		assert_int_equal(context->core.state.hash, hashes[i]);
+	}
+}
+
+M_TEST_DEFINE(reverseBeginning) {
+	struct ReverseTestContext* context = *state;
+	_reset(context);
+	_run(context, 100);
+	// Only the four newest checkpoints are kept
+	assert_int_equal(mDebuggerReverseContinue(&context->reverse, NULL, NULL, NULL), REVERSE_BEGINNING);
+	assert_int_equal(context->core.state.frame, 60);
+	assert_int_equal(mDebuggerReverseStep(&context->reverse), REVERSE_BEGINNING);
+	assert_int_equal(context->core.state.frame, 60);
+}
+
+M_TEST_DEFINE(reverseContinue) {
+	struct ReverseTestContext* context = *state;
+	_reset(context);
+	context->breakpoints[0] = 17;
+	context->breakpoints[1] = 23;
+	_run(context, 30);
+
+	enum mDebuggerEntryReason reason;
+	struct mDebuggerEntryInfo info;
+	bool hasInfo;
+	assert_int_equal(mDebuggerReverseContinue(&context->reverse, &reason, &info, &hasInfo), REVERSE_STOPPED);
+	assert_int_equal(context->core.state.frame, 23);
+	assert_int_equal(reason, DEBUGGER_ENTER_BREAKPOINT);
+	assert_true(hasInfo);
+	assert_int_equal(info.address, 23);
+
+	// Stopped on a breakpoint, the next one back is the earlier hit
+	assert_int_equal(mDebuggerReverseContinue(&context->reverse, &reason, &info, &hasInfo), REVERSE_STOPPED);
+	assert_int_equal(context->core.state.frame, 17);
+	assert_int_equal(info.address, 17);
+
+	assert_int_equal(mDebuggerReverseContinue(&context->reverse, &reason, &info, &hasInfo), REVERSE_BEGINNING);
+	assert_int_equal(context->core.state.frame, 0);
+	context->breakpoints[0] = 0;
+	context->breakpoints[1] = 0;
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(Reverse,
+	cmocka_unit_test(reverseUnavailable),
+	cmocka_unit_test(reverseStep),
+	cmocka_unit_test(reverseBeginning),
+	cmocka_unit_test(reverseContinue))
@@ -0,0 +1,123 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/internal/debugger/symbols.h>
+
+M_TEST_SUITE_SETUP(Symbols) {
+	struct mDebuggerSymbols* st = mDebuggerSymbolTableCreate();
+	mDebuggerSymbolAddSized(st, "main", 0x08000100, -1, 0x40);
+	mDebuggerSymbolAddSized(st, "helper", 0x08000200, -1, 0x10);
+	mDebuggerSymbolAdd(st, "label", 0x08000120, -1);
+	mDebuggerSymbolAdd(st, "buffer", 0x03000000, -1);
+	mDebuggerSymbolAdd(st, "bank1", 0x4000, 1);
+	*state = st;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(Symbols) {
+	mDebuggerSymbolTableDestroy(*state);
+	return 0;
+}
+
+M_TEST_DEFINE(reverseLookupExact) {
+	struct mDebuggerSymbols* st = *state;
+	uint32_t offset = 1;
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x08000100, -1, &offset), "main");
+	assert_int_equal(offset, 0);
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x08000200, -1, &offset), "helper");
+	assert_int_equal(offset, 0);
+}
+
+M_TEST_DEFINE(reverseLookupContained) {
+	struct mDebuggerSymbols* st = *state;
+	uint32_t offset = 0;
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x08000110, -1, &offset), "main");
+	assert_int_equal(offset, 0x10);
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x0800020E, -1, &offset), "helper");
+	assert_int_equal(offset, 0xE);
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x03001000, -1, &offset), "buffer");
+	assert_int_equal(offset, 0x1000);
+}
+
+M_TEST_DEFINE(reverseLookupNearest) {
+	struct mDebuggerSymbols* st = *state;
+	uint32_t offset = 0;
+	// Unsized symbols extend up to whatever follows them
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x08000130, -1, &offset), "label");
+	assert_int_equal(offset, 0x10);
+}
+
+M_TEST_DEFINE(reverseLookupOutside) {
+	struct mDebuggerSymbols* st = *state;
+	assert_null(mDebuggerSymbolReverseLookup(st, 0x02000000, -1, NULL));
+	assert_null(mDebuggerSymbolReverseLookup(st, 0x08000210, -1, NULL));
+}
+
+M_TEST_DEFINE(reverseLookupSegment) {
+	struct mDebuggerSymbols* st = *state;
+	uint32_t offset = 0;
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x4010, 1, &offset), "bank1");
+	assert_int_equal(offset, 0x10);
+	assert_null(mDebuggerSymbolReverseLookup(st, 0x4010, -1, NULL));
+	assert_null(mDebuggerSymbolReverseLookup(st, 0x4010, 2, NULL));
+}
+
+M_TEST_DEFINE(reverseLookupModified) {
+	struct mDebuggerSymbols* st = *state;
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x08000120, -1, NULL), "label");
+	mDebuggerSymbolRemove(st, "label");
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x08000120, -1, NULL), "main");
+	mDebuggerSymbolAddSized(st, "helper", 0x08000300, -1, 0x10);
+	assert_null(mDebuggerSymbolReverseLookup(st, 0x08000200, -1, NULL));
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x08000304, -1, NULL), "helper");
+	mDebuggerSymbolAdd(st, "label", 0x08000120, -1);
+	mDebuggerSymbolAddSized(st, "helper", 0x08000200, -1, 0x10);
+}
+
+M_TEST_DEFINE(reverseLookupLarge) {
+	struct mDebuggerSymbols* st = mDebuggerSymbolTableCreate();
+	char name[32];
+	uint32_t i;
+	mDebuggerSymbolTableReserve(st, 0x3000);
+	// Added out of order and spread over several segments, including negative addresses
+	for (i = 0; i < 0x1000; ++i) {
+		uint32_t n = (i * 0x9E5) & 0xFFF;
+		snprintf(name, sizeof(name), "f%u", n);
+		mDebuggerSymbolAddSized(st, name, 0x80000000 + n * 0x10, -1, 0x10);
+		snprintf(name, sizeof(name), "g%u", n);
+		mDebuggerSymbolAddSized(st, name, 0x4000 + n * 0x10, n & 1, 0x10);
+	}
+	// Ties at the same address go to the largest symbol, then the alphabetically first
+	mDebuggerSymbolAddSized(st, "tieB", 0x80000100, -1, 0x20);
+	mDebuggerSymbolAddSized(st, "tieA", 0x80000100, -1, 0x20);
+	mDebuggerSymbolAddSized(st, "tieC", 0x80000100, -1, 0x8);
+
+	uint32_t offset;
+	for (i = 0; i < 0x1000; ++i) {
+		if (i == 0x10) {
+			continue;
+		}
+		snprintf(name, sizeof(name), "f%u", i);
+		assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x80000000 + i * 0x10 + 4, -1, &offset), name);
+		assert_int_equal(offset, 4);
+		snprintf(name, sizeof(name), "g%u", i);
+		assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x4000 + i * 0x10 + 8, i & 1, &offset), name);
+		assert_int_equal(offset, 8);
+		assert_null(mDebuggerSymbolReverseLookup(st, 0x4000 + i * 0x10, !(i & 1), NULL));
+	}
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x80000104, -1, NULL), "tieA");
+	mDebuggerSymbolTableDestroy(st);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(Symbols,
+	cmocka_unit_test(reverseLookupExact),
+	cmocka_unit_test(reverseLookupContained),
+	cmocka_unit_test(reverseLookupNearest),
+	cmocka_unit_test(reverseLookupOutside),
+	cmocka_unit_test(reverseLookupSegment),
+	cmocka_unit_test(reverseLookupModified),
+	cmocka_unit_test(reverseLookupLarge))
@@ -0,0 +1,103 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/debugger/debugger.h>
+#include <mgba/internal/debugger/trace.h>
+#include <mgba-util/vfs.h>
+
+struct TraceTestPlatform {
+	struct mDebuggerPlatform d;
+	uint32_t nextAddress;
+};
+
+static void _traceInstruction(struct mDebuggerPlatform* d, struct mDebuggerTraceRecord* out) {
+	struct TraceTestPlatform* platform = (struct TraceTestPlatform*) d;
+	out->type = TRACE_INSTRUCTION;
+	out->width = 4;
+	out->segment = -1;
+	out->address = platform->nextAddress;
+	out->value = ~platform->nextAddress;
+	out->state = 0x1F;
+	platform->nextAddress += 4;
+}
+
+M_TEST_DEFINE(traceRing) {
+	struct TraceTestPlatform platform = { .nextAddress = 0 };
+	platform.d.traceInstruction = _traceInstruction;
+	struct mDebuggerTrace trace;
+	mDebuggerTraceInit(&trace, 4, NULL, 0);
+
+	int i;
+	for (i = 0; i < 6; ++i) {
+		mDebuggerTraceInstruction(&trace, &platform.d);
+	}
+	assert_int_equal(trace.size, 4);
+	assert_int_equal(trace.total, 6);
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mDebuggerTraceSave(&trace, vf, 0));
+	mDebuggerTraceDeinit(&trace);
+
+	vf->seek(vf, 0, SEEK_SET);
+	struct mDebuggerTraceHeader header;
+	assert_true(mDebuggerTraceReadHeader(vf, &header));
+	struct mDebuggerTraceRecord records[8];
+	assert_int_equal(mDebuggerTraceReadRecords(vf, records, 8), 4);
+	for (i = 0; i < 4; ++i) {
+		assert_int_equal(records[i].type, TRACE_INSTRUCTION);
+		assert_int_equal(records[i].address, (i + 2) * 4);
+		assert_int_equal(records[i].value, (uint32_t) ~((i + 2) * 4));
+		assert_int_equal(records[i].segment, -1);
+	}
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(traceStream) {
+	struct TraceTestPlatform platform = { .nextAddress = 0x08000000 };
+	platform.d.traceInstruction = _traceInstruction;
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	struct mDebuggerTrace trace;
+	mDebuggerTraceInit(&trace, 4, vf, 1);
+	trace.remaining = 10;
+	trace.accesses = true;
+
+	int i;
+	for (i = 0; i < 10; ++i) {
+		mDebuggerTraceInstruction(&trace, &platform.d);
+		mDebuggerTraceAccess(&trace, TRACE_WRITE, 0x03000000 + i, i, 1, -1);
+	}
+	assert_int_equal(trace.total, 10);
+	assert_int_equal(trace.remaining, 0);
+	mDebuggerTraceDeinit(&trace);
+
+	vf->seek(vf, 0, SEEK_SET);
+	struct mDebuggerTraceHeader header;
+	assert_true(mDebuggerTraceReadHeader(vf, &header));
+	assert_int_equal(header.platform, 1);
+	struct mDebuggerTraceRecord records[32];
+	assert_int_equal(mDebuggerTraceReadRecords(vf, records, 32), 20);
+	for (i = 0; i < 10; ++i) {
+		assert_int_equal(records[i * 2].type, TRACE_INSTRUCTION);
+		assert_int_equal(records[i * 2].address, 0x08000000 + i * 4);
+		assert_int_equal(records[i * 2 + 1].type, TRACE_WRITE);
+		assert_int_equal(records[i * 2 + 1].address, 0x03000000 + i);
+	}
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(traceBadHeader) {
+	static const char data[16] = "not a trace file";
+	struct VFile* vf = VFileFromConstMemory(data, sizeof(data));
+	struct mDebuggerTraceHeader header;
+	assert_false(mDebuggerTraceReadHeader(vf, &header));
+	vf->close(vf);
+}
+
+M_TEST_SUITE_DEFINE(Trace,
+	cmocka_unit_test(traceRing),
+	cmocka_unit_test(traceStream),
+	cmocka_unit_test(traceBadHeader))
@@ -0,0 +1,191 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/debugger/trace.h>
+
+#include <mgba/debugger/debugger.h>
+#include <mgba-util/vfs.h>
+
+#define TRACE_RECORD_SIZE 16
+#define TRACE_HEADER_SIZE 16
+#define TRACE_WRITE_CHUNK 256
+
+static void _writeHeader(struct VFile* vf, int platform) {
+	uint8_t header[TRACE_HEADER_SIZE];
+	memcpy(header, mDEBUGGER_TRACE_MAGIC, 4);
+	STORE_32LE(mDEBUGGER_TRACE_VERSION, 4, header);
+	STORE_32LE(platform, 8, header);
+	STORE_32LE(TRACE_RECORD_SIZE, 12, header);
+	vf->write(vf, header, sizeof(header));
+}
+
+static void _writeRecords(struct VFile* vf, const struct mDebuggerTraceRecord* records, size_t count) {
+	uint8_t buffer[TRACE_RECORD_SIZE * TRACE_WRITE_CHUNK];
+	while (count) {
+		size_t chunk = count;
+		if (chunk > TRACE_WRITE_CHUNK) {
+			chunk = TRACE_WRITE_CHUNK;
+		}
+		size_t i;
+		for (i = 0; i < chunk; ++i) {
+			const struct mDebuggerTraceRecord* record = &records[i];
+			uint8_t* out = &buffer[i * TRACE_RECORD_SIZE];
+			out[0] = record->type;
+			out[1] = record->width;
+			STORE_16LE(record->segment, 2, out);
+			STORE_32LE(record->address, 4, out);
+			STORE_32LE(record->value, 8, out);
+			STORE_32LE(record->state, 12, out);
+		}
+		vf->write(vf, buffer, chunk * TRACE_RECORD_SIZE);
+		records += chunk;
+		count -= chunk;
+	}
+}
+
+void mDebuggerTraceInit(struct mDebuggerTrace* trace, size_t capacity, struct VFile* vf, int platform) {
+	if (!capacity) {
+		capacity = 1;
+	}
+	trace->records = malloc(sizeof(*trace->records) * capacity);
+	trace->capacity = capacity;
+	trace->start = 0;
+	trace->size = 0;
+	trace->vf = vf;
+	trace->accesses = false;
+	trace->remaining = -1;
+	trace->total = 0;
+	if (vf) {
+		_writeHeader(vf, platform);
+	}
+}
+
+void mDebuggerTraceDeinit(struct mDebuggerTrace* trace) {
+	mDebuggerTraceFlush(trace);
+	free(trace->records);
+	trace->records = NULL;
+	trace->capacity = 0;
+	trace->size = 0;
+}
+
+static struct mDebuggerTraceRecord* _nextRecord(struct mDebuggerTrace* trace) {
+	if (trace->size == trace->capacity) {
+		if (trace->vf) {
+			mDebuggerTraceFlush(trace);
+		} else {
+			// The ring is full, so drop the oldest record
+			struct mDebuggerTraceRecord* record = &trace->records[trace->start];
+			++trace->start;
+			if (trace->start == trace->capacity) {
+				trace->start = 0;
+			}
+			return record;
+		}
+	}
+	size_t index = trace->start + trace->size;
+	if (index >= trace->capacity) {
+		index -= trace->capacity;
+	}
+	++trace->size;
+	return &trace->records[index];
+}
+
+void mDebuggerTraceInstruction(struct mDebuggerTrace* trace, struct mDebuggerPlatform* platform) {
+	if (!trace->remaining) {
+		return;
+	}
+	struct mDebuggerTraceRecord* record = _nextRecord(trace);
+	platform->traceInstruction(platform, record);
+	++trace->total;
+	if (trace->remaining > 0) {
+		--trace->remaining;
+	}
+}
+
+void mDebuggerTraceAccess(struct mDebuggerTrace* trace, enum mDebuggerTraceRecordType type, uint32_t address, uint32_t value, int width, int segment) {
+	if (!trace->accesses || !trace->total) {
+		return;
+	}
+	struct mDebuggerTraceRecord* record = _nextRecord(trace);
+	record->type = type;
+	record->width = width;
+	record->segment = segment;
+	record->address = address;
+	record->value = value;
+	record->state = 0;
+}
+
+void mDebuggerTraceFlush(struct mDebuggerTrace* trace) {
+	if (!trace->vf || !trace->size) {
+		return;
+	}
+	_writeRecords(trace->vf, trace->records, trace->size);
+	trace->start = 0;
+	trace->size = 0;
+}
+
+bool mDebuggerTraceSave(const struct mDebuggerTrace* trace, struct VFile* vf, int platform) {
+	if (!vf) {
+		return false;
+	}
+	_writeHeader(vf, platform);
+	size_t firstSize = trace->size;
+	if (trace->start + firstSize > trace->capacity) {
+		firstSize = trace->capacity - trace->start;
+	}
+	_writeRecords(vf, &trace->records[trace->start], firstSize);
+	_writeRecords(vf, trace->records, trace->size - firstSize);
+	return true;
+}
+
+bool mDebuggerTraceReadHeader(struct VFile* vf, struct mDebuggerTraceHeader* header) {
+	uint8_t buffer[TRACE_HEADER_SIZE];
+	if (vf->read(vf, buffer, sizeof(buffer)) != sizeof(buffer)) {
+		return false;
+	}
+	if (memcmp(buffer, mDEBUGGER_TRACE_MAGIC, 4) != 0) {
+		return false;
+	}
+	memcpy(header->magic, buffer, 4);
+	LOAD_32LE(header->version, 4, buffer);
+	LOAD_32LE(header->platform, 8, buffer);
+	LOAD_32LE(header->recordSize, 12, buffer);
+	return header->version == mDEBUGGER_TRACE_VERSION && header->recordSize == TRACE_RECORD_SIZE;
+}
+
+size_t mDebuggerTraceReadRecords(struct VFile* vf, struct mDebuggerTraceRecord* records, size_t count) {
+	uint8_t buffer[TRACE_RECORD_SIZE * TRACE_WRITE_CHUNK];
+	size_t total = 0;
+	while (count) {
+		size_t chunk = count;
+		if (chunk > TRACE_WRITE_CHUNK) {
+			chunk = TRACE_WRITE_CHUNK;
+		}
+		size_t requested = chunk * TRACE_RECORD_SIZE;
+		ssize_t size = vf->read(vf, buffer, requested);
+		if (size <= 0) {
+			break;
+		}
+		chunk = size / TRACE_RECORD_SIZE;
+		size_t i;
+		for (i = 0; i < chunk; ++i) {
+			const uint8_t* in = &buffer[i * TRACE_RECORD_SIZE];
+			struct mDebuggerTraceRecord* record = &records[i];
+			record->type = in[0];
+			record->width = in[1];
+			LOAD_16LE(record->segment, 2, in);
+			LOAD_32LE(record->address, 4, in);
+			LOAD_32LE(record->value, 8, in);
+			LOAD_32LE(record->state, 12, in);
+		}
+		records += chunk;
+		count -= chunk;
+		total += chunk;
+		if ((size_t) size < requested) {
+			break;
+		}
+	}
+	return total;
+}
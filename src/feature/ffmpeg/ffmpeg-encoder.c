@@ -6,6 +6,7 @@
 #include "ffmpeg-encoder.h"
 
 #include <mgba/core/core.h>
+#include <mgba/core/trace.h>
 #include <mgba/gba/interface.h>
 
 #include <libavcodec/version.h>
@@ -29,11 +30,42 @@
 static void _ffmpegPostVideoFrame(struct mAVStream*, const color_t* pixels, size_t stride);
 static void _ffmpegPostAudioFrame(struct mAVStream*, int16_t left, int16_t right);
 static void _ffmpegSetVideoDimensions(struct mAVStream*, unsigned width, unsigned height);
+static void _ffmpegEncodeAudio(struct FFmpegEncoder*, const uint16_t* samples);
+static void _ffmpegEncodeVideo(struct FFmpegEncoder*, const void* pixels, int stride, int width, int height);
+#ifndef DISABLE_THREADING
+static void _ffmpegStartThread(struct FFmpegEncoder*);
+static void _ffmpegStopThread(struct FFmpegEncoder*);
+#endif
 
 enum {
 	PREFERRED_SAMPLE_RATE = 0x8000
 };
 
+static enum AVPixelFormat _ffmpegInputFormat(void) {
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+	return AV_PIX_FMT_RGB565;
+#else
+	return AV_PIX_FMT_BGR555;
+#endif
+#else
+#ifndef USE_LIBAV
+	return AV_PIX_FMT_0BGR32;
+#else
+	return AV_PIX_FMT_BGR32;
+#endif
+#endif
+}
+
+static bool _ffmpegUsesHardwareFrames(const struct FFmpegEncoder* encoder) {
+#ifdef FFMPEG_USE_HWACCEL
+	return encoder->hwDeviceType != AV_HWDEVICE_TYPE_NONE;
+#else
+	UNUSED(encoder);
+	return false;
+#endif
+}
+
 void FFmpegEncoderInit(struct FFmpegEncoder* encoder) {
 	av_register_all();
 
@@ -45,6 +77,7 @@ void FFmpegEncoderInit(struct FFmpegEncoder* encoder) {
 	encoder->audioCodec = NULL;
 	encoder->videoCodec = NULL;
 	encoder->containerFormat = NULL;
+	encoder->hwDeviceName = NULL;
 	FFmpegEncoderSetAudio(encoder, "flac", 0);
 	FFmpegEncoderSetVideo(encoder, "png", 0);
 	FFmpegEncoderSetContainer(encoder, "matroska");
@@ -63,6 +96,20 @@ void FFmpegEncoderInit(struct FFmpegEncoder* encoder) {
 	encoder->video = NULL;
 	encoder->videoStream = NULL;
 	encoder->videoFrame = NULL;
+	encoder->sourceFrame = NULL;
+#ifdef FFMPEG_USE_HWACCEL
+	encoder->hwDevice = NULL;
+	encoder->hwFrames = NULL;
+	encoder->hwFrame = NULL;
+#endif
+	encoder->scaleWidth = 0;
+	encoder->scaleHeight = 0;
+	encoder->dropFrames = false;
+	memset(&encoder->statistics, 0, sizeof(encoder->statistics));
+#ifndef DISABLE_THREADING
+	memset(encoder->slots, 0, sizeof(encoder->slots));
+	encoder->threadRunning = false;
+#endif
 }
 
 bool FFmpegEncoderSetAudio(struct FFmpegEncoder* encoder, const char* acodec, unsigned abr) {
@@ -162,15 +209,34 @@ bool FFmpegEncoderSetVideo(struct FFmpegEncoder* encoder, const char* vcodec, un
 	size_t i;
 	size_t j;
 	int priority = INT_MAX;
+	enum AVPixelFormat input = _ffmpegInputFormat();
 	encoder->pixFormat = AV_PIX_FMT_NONE;
 	for (i = 0; codec->pix_fmts[i] != AV_PIX_FMT_NONE; ++i) {
 		for (j = 0; j < sizeof(priorities) / sizeof(*priorities); ++j) {
-			if (codec->pix_fmts[i] == priorities[j].format && priority > priorities[j].priority) {
+			if (codec->pix_fmts[i] != priorities[j].format) {
+				continue;
+			}
+			// Among equally good formats, prefer the one frames come in as, since it needs no scaling
+			if (priority > priorities[j].priority || (priority == priorities[j].priority && codec->pix_fmts[i] == input)) {
 				priority = priorities[j].priority;
 				encoder->pixFormat = codec->pix_fmts[i];
 			}
 		}
 	}
+#ifdef FFMPEG_USE_HWACCEL
+	encoder->hwDeviceType = AV_HWDEVICE_TYPE_NONE;
+	if (encoder->pixFormat == AV_PIX_FMT_NONE) {
+		// Encoders like VAAPI and QSV only take frames that already live on the device
+		const AVCodecHWConfig* config;
+		for (i = 0; (config = avcodec_get_hw_config(codec, i)); ++i) {
+			if (config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_FRAMES_CTX) {
+				encoder->pixFormat = config->pix_fmt;
+				encoder->hwDeviceType = config->device_type;
+				break;
+			}
+		}
+	}
+#endif
 	if (encoder->pixFormat == AV_PIX_FMT_NONE) {
 		return false;
 	}
@@ -188,11 +254,23 @@ bool FFmpegEncoderSetContainer(struct FFmpegEncoder* encoder, const char* contai
 	return true;
 }
 
+void FFmpegEncoderSetHardwareDevice(struct FFmpegEncoder* encoder, const char* device) {
+	encoder->hwDeviceName = device;
+}
+
 void FFmpegEncoderSetDimensions(struct FFmpegEncoder* encoder, int width, int height) {
 	encoder->width = width > 0 ? width : GBA_VIDEO_HORIZONTAL_PIXELS;
 	encoder->height = height > 0 ? height : GBA_VIDEO_VERTICAL_PIXELS;
 }
 
+void FFmpegEncoderSetDropFrames(struct FFmpegEncoder* encoder, bool dropFrames) {
+	encoder->dropFrames = dropFrames;
+}
+
+void FFmpegEncoderGetStatistics(const struct FFmpegEncoder* encoder, struct FFmpegEncoderStatistics* statistics) {
+	*statistics = encoder->statistics;
+}
+
 bool FFmpegEncoderVerifyContainer(struct FFmpegEncoder* encoder) {
 	AVOutputFormat* oformat = av_guess_format(encoder->containerFormat, 0, 0);
 	AVCodec* acodec = avcodec_find_encoder_by_name(encoder->audioCodec);
@@ -209,6 +287,34 @@ bool FFmpegEncoderVerifyContainer(struct FFmpegEncoder* encoder) {
 	return true;
 }
 
+static bool _ffmpegInitHardwareFrames(struct FFmpegEncoder* encoder) {
+#ifdef FFMPEG_USE_HWACCEL
+	if (av_hwdevice_ctx_create(&encoder->hwDevice, encoder->hwDeviceType, encoder->hwDeviceName, NULL, 0) < 0) {
+		return false;
+	}
+	encoder->hwFrames = av_hwframe_ctx_alloc(encoder->hwDevice);
+	if (!encoder->hwFrames) {
+		return false;
+	}
+	AVHWFramesContext* frames = (AVHWFramesContext*) encoder->hwFrames->data;
+	frames->format = encoder->pixFormat;
+	// NV12 is the surface format every supported device encodes from
+	frames->sw_format = AV_PIX_FMT_NV12;
+	frames->width = encoder->width;
+	frames->height = encoder->height;
+	frames->initial_pool_size = 16;
+	if (av_hwframe_ctx_init(encoder->hwFrames) < 0) {
+		return false;
+	}
+	encoder->video->hw_frames_ctx = av_buffer_ref(encoder->hwFrames);
+	encoder->hwFrame = av_frame_alloc();
+	return encoder->video->hw_frames_ctx && encoder->hwFrame;
+#else
+	UNUSED(encoder);
+	return false;
+#endif
+}
+
 bool FFmpegEncoderOpen(struct FFmpegEncoder* encoder, const char* outfile) {
 	AVCodec* acodec = avcodec_find_encoder_by_name(encoder->audioCodec);
 	AVCodec* vcodec = avcodec_find_encoder_by_name(encoder->videoCodec);
@@ -223,6 +329,7 @@ bool FFmpegEncoderOpen(struct FFmpegEncoder* encoder, const char* outfile) {
 	encoder->currentAudioSample = 0;
 	encoder->currentAudioFrame = 0;
 	encoder->currentVideoFrame = 0;
+	memset(&encoder->statistics, 0, sizeof(encoder->statistics));
 
 	AVOutputFormat* oformat = av_guess_format(encoder->containerFormat, 0, 0);
 #ifndef USE_LIBAV
@@ -335,7 +442,7 @@ bool FFmpegEncoderOpen(struct FFmpegEncoder* encoder, const char* outfile) {
 #endif
 		}
 
-		if (encoder->video->codec->id == AV_CODEC_ID_H264 &&
+		if (encoder->video->codec->id == AV_CODEC_ID_H264 && !_ffmpegUsesHardwareFrames(encoder) &&
 		    (strcasecmp(encoder->containerFormat, "mp4") ||
 		        strcasecmp(encoder->containerFormat, "m4v") ||
 		        strcasecmp(encoder->containerFormat, "mov"))) {
@@ -362,21 +469,36 @@ bool FFmpegEncoderOpen(struct FFmpegEncoder* encoder, const char* outfile) {
 			encoder->video->pix_fmt = AV_PIX_FMT_YUV444P;
 		}
 
+		if (_ffmpegUsesHardwareFrames(encoder) && !_ffmpegInitHardwareFrames(encoder)) {
+			FFmpegEncoderClose(encoder);
+			return false;
+		}
 		if (avcodec_open2(encoder->video, vcodec, 0) < 0) {
 			FFmpegEncoderClose(encoder);
 			return false;
 		}
 #if LIBAVCODEC_VERSION_MAJOR >= 55
 		encoder->videoFrame = av_frame_alloc();
+		encoder->sourceFrame = av_frame_alloc();
 #else
 		encoder->videoFrame = avcodec_alloc_frame();
+		encoder->sourceFrame = avcodec_alloc_frame();
 #endif
+		// With hardware frames, this is the software frame that gets uploaded to the device
 		encoder->videoFrame->format = encoder->video->pix_fmt;
+#ifdef FFMPEG_USE_HWACCEL
+		if (encoder->hwFrames) {
+			encoder->videoFrame->format = ((AVHWFramesContext*) encoder->hwFrames->data)->sw_format;
+		}
+#endif
 		encoder->videoFrame->width = encoder->video->width;
 		encoder->videoFrame->height = encoder->video->height;
 		encoder->videoFrame->pts = 0;
+		encoder->sourceFrame->format = encoder->videoFrame->format;
+		encoder->sourceFrame->width = encoder->videoFrame->width;
+		encoder->sourceFrame->height = encoder->videoFrame->height;
 		_ffmpegSetVideoDimensions(&encoder->d, encoder->iwidth, encoder->iheight);
-		av_image_alloc(encoder->videoFrame->data, encoder->videoFrame->linesize, encoder->video->width, encoder->video->height, encoder->video->pix_fmt, 32);
+		av_image_alloc(encoder->videoFrame->data, encoder->videoFrame->linesize, encoder->video->width, encoder->video->height, encoder->videoFrame->format, 32);
 #ifdef FFMPEG_USE_CODECPAR
 		avcodec_parameters_from_context(encoder->videoStream->codecpar, encoder->video);
 #endif
@@ -386,10 +508,17 @@ bool FFmpegEncoderOpen(struct FFmpegEncoder* encoder, const char* outfile) {
 		FFmpegEncoderClose(encoder);
 		return false;
 	}
+#ifndef DISABLE_THREADING
+	_ffmpegStartThread(encoder);
+#endif
 	return true;
 }
 
 void FFmpegEncoderClose(struct FFmpegEncoder* encoder) {
+#ifndef DISABLE_THREADING
+	// Everything still queued gets encoded before the trailer goes out
+	_ffmpegStopThread(encoder);
+#endif
 	if (encoder->context && encoder->context->pb) {
 		av_write_trailer(encoder->context);
 		avio_close(encoder->context->pb);
@@ -442,15 +571,33 @@ void FFmpegEncoderClose(struct FFmpegEncoder* encoder) {
 #endif
 	}
 
+	if (encoder->sourceFrame) {
+#if LIBAVCODEC_VERSION_MAJOR >= 55
+		av_frame_free(&encoder->sourceFrame);
+#else
+		avcodec_free_frame(&encoder->sourceFrame);
+#endif
+	}
+
 	if (encoder->video) {
 		avcodec_close(encoder->video);
 		encoder->video = NULL;
 	}
 
+#ifdef FFMPEG_USE_HWACCEL
+	if (encoder->hwFrame) {
+		av_frame_free(&encoder->hwFrame);
+	}
+	av_buffer_unref(&encoder->hwFrames);
+	av_buffer_unref(&encoder->hwDevice);
+#endif
+
 	if (encoder->scaleContext) {
 		sws_freeContext(encoder->scaleContext);
 		encoder->scaleContext = NULL;
 	}
+	encoder->scaleWidth = 0;
+	encoder->scaleHeight = 0;
 
 	if (encoder->context) {
 		avformat_free_context(encoder->context);
@@ -462,6 +609,48 @@ bool FFmpegEncoderIsOpen(struct FFmpegEncoder* encoder) {
 	return !!encoder->context;
 }
 
+#ifndef DISABLE_THREADING
+// Returns NULL if the slot is dropped; the slot's buffer is only reallocated when it's too small
+static struct FFmpegEncoderSlot* _ffmpegAcquireSlot(struct FFmpegEncoder* encoder, enum FFmpegEncoderSlotType type, size_t size) {
+	int32_t read;
+	ATOMIC_LOAD(read, encoder->queueRead);
+	int queued = (encoder->queueWrite - read + FFMPEG_QUEUE_SLOTS * 2) % (FFMPEG_QUEUE_SLOTS * 2);
+	if (queued == FFMPEG_QUEUE_SLOTS) {
+		if (type == FFMPEG_SLOT_VIDEO && encoder->dropFrames) {
+			++encoder->statistics.droppedFrames;
+			return NULL;
+		}
+		// Audio is never dropped, since gaps in it are far more noticeable than a skipped frame
+		++encoder->statistics.stalls;
+		MutexLock(&encoder->queueMutex);
+		while (queued == FFMPEG_QUEUE_SLOTS) {
+			ConditionWait(&encoder->queueDrained, &encoder->queueMutex);
+			ATOMIC_LOAD(read, encoder->queueRead);
+			queued = (encoder->queueWrite - read + FFMPEG_QUEUE_SLOTS * 2) % (FFMPEG_QUEUE_SLOTS * 2);
+		}
+		MutexUnlock(&encoder->queueMutex);
+	}
+	if ((unsigned) queued + 1 > encoder->statistics.maxQueued) {
+		encoder->statistics.maxQueued = queued + 1;
+	}
+	struct FFmpegEncoderSlot* slot = &encoder->slots[encoder->queueWrite % FFMPEG_QUEUE_SLOTS];
+	if (slot->capacity < size) {
+		free(slot->data);
+		slot->data = malloc(size);
+		slot->capacity = size;
+	}
+	slot->type = type;
+	return slot;
+}
+
+static void _ffmpegSubmitSlot(struct FFmpegEncoder* encoder) {
+	MutexLock(&encoder->queueMutex);
+	ATOMIC_STORE(encoder->queueWrite, (encoder->queueWrite + 1) % (FFMPEG_QUEUE_SLOTS * 2));
+	ConditionWake(&encoder->queueFilled);
+	MutexUnlock(&encoder->queueMutex);
+}
+#endif
+
 void _ffmpegPostAudioFrame(struct mAVStream* stream, int16_t left, int16_t right) {
 	struct FFmpegEncoder* encoder = (struct FFmpegEncoder*) stream;
 	if (!encoder->context || !encoder->audioCodec) {
@@ -481,12 +670,24 @@ void _ffmpegPostAudioFrame(struct mAVStream* stream, int16_t left, int16_t right
 	if (encoder->currentAudioSample * 4 < encoder->audioBufferSize) {
 		return;
 	}
+	encoder->currentAudioSample = 0;
 
+#ifndef DISABLE_THREADING
+	if (encoder->threadRunning) {
+		struct FFmpegEncoderSlot* slot = _ffmpegAcquireSlot(encoder, FFMPEG_SLOT_AUDIO, encoder->audioBufferSize);
+		memcpy(slot->data, encoder->audioBuffer, encoder->audioBufferSize);
+		_ffmpegSubmitSlot(encoder);
+		return;
+	}
+#endif
+	_ffmpegEncodeAudio(encoder, encoder->audioBuffer);
+}
+
+static void _ffmpegEncodeAudio(struct FFmpegEncoder* encoder, const uint16_t* samples) {
 	int channelSize = 2 * av_get_bytes_per_sample(encoder->audio->sample_fmt);
-	encoder->currentAudioSample = 0;
 #ifdef USE_LIBAVRESAMPLE
 	avresample_convert(encoder->resampleContext, 0, 0, 0,
-	                   (uint8_t**) &encoder->audioBuffer, 0, encoder->audioBufferSize / 4);
+	                   (uint8_t**) &samples, 0, encoder->audioBufferSize / 4);
 
 	if (avresample_available(encoder->resampleContext) < encoder->audioFrame->nb_samples) {
 		return;
@@ -494,21 +695,21 @@ void _ffmpegPostAudioFrame(struct mAVStream* stream, int16_t left, int16_t right
 #if LIBAVCODEC_VERSION_MAJOR >= 55
 	av_frame_make_writable(encoder->audioFrame);
 #endif
-	int samples = avresample_read(encoder->resampleContext, encoder->audioFrame->data, encoder->postaudioBufferSize / channelSize);
+	int converted = avresample_read(encoder->resampleContext, encoder->audioFrame->data, encoder->postaudioBufferSize / channelSize);
 #else
 #if LIBAVCODEC_VERSION_MAJOR >= 55
 	av_frame_make_writable(encoder->audioFrame);
 #endif
 	if (swr_get_out_samples(encoder->resampleContext, 1) < encoder->audioFrame->nb_samples) {
-		swr_convert(encoder->resampleContext, NULL, 0, (const uint8_t**) &encoder->audioBuffer, encoder->audioBufferSize / 4);
+		swr_convert(encoder->resampleContext, NULL, 0, (const uint8_t**) &samples, encoder->audioBufferSize / 4);
 		return;
 	}
-	int samples = swr_convert(encoder->resampleContext, encoder->audioFrame->data, encoder->postaudioBufferSize / channelSize,
-	                          (const uint8_t**) &encoder->audioBuffer, encoder->audioBufferSize / 4);
+	int converted = swr_convert(encoder->resampleContext, encoder->audioFrame->data, encoder->postaudioBufferSize / channelSize,
+	                            (const uint8_t**) &samples, encoder->audioBufferSize / 4);
 #endif
 
 	encoder->audioFrame->pts = encoder->currentAudioFrame;
-	encoder->currentAudioFrame += samples;
+	encoder->currentAudioFrame += converted;
 
 	AVPacket packet;
 	av_init_packet(&packet);
@@ -574,28 +775,79 @@ void _ffmpegPostVideoFrame(struct mAVStream* stream, const color_t* pixels, size
 		return;
 	}
 	stride *= BYTES_PER_PIXEL;
+	++encoder->statistics.videoFrames;
+
+#ifndef DISABLE_THREADING
+	if (encoder->threadRunning) {
+		size_t rowSize = encoder->iwidth * BYTES_PER_PIXEL;
+		struct FFmpegEncoderSlot* slot = _ffmpegAcquireSlot(encoder, FFMPEG_SLOT_VIDEO, rowSize * encoder->iheight);
+		if (!slot) {
+			return;
+		}
+		slot->width = encoder->iwidth;
+		slot->height = encoder->iheight;
+		int y;
+		for (y = 0; y < encoder->iheight; ++y) {
+			memcpy((uint8_t*) slot->data + y * rowSize, (const uint8_t*) pixels + y * stride, rowSize);
+		}
+		_ffmpegSubmitSlot(encoder);
+		return;
+	}
+#endif
+	_ffmpegEncodeVideo(encoder, pixels, stride, encoder->iwidth, encoder->iheight);
+}
+
+static void _ffmpegEncodeVideo(struct FFmpegEncoder* encoder, const void* pixels, int stride, int width, int height) {
+	AVFrame* frame = encoder->videoFrame;
+	if (frame->format == _ffmpegInputFormat() && frame->width == width && frame->height == height) {
+		// Already in the encoder's format and size, so hand the pixels over without scaling
+		frame = encoder->sourceFrame;
+		frame->data[0] = (uint8_t*) pixels;
+		frame->linesize[0] = stride;
+	} else {
+		if (!encoder->scaleContext || encoder->scaleWidth != width || encoder->scaleHeight != height) {
+			if (encoder->scaleContext) {
+				sws_freeContext(encoder->scaleContext);
+			}
+			encoder->scaleContext = sws_getContext(width, height, _ffmpegInputFormat(),
+			    frame->width, frame->height, frame->format,
+			    SWS_POINT, 0, 0, 0);
+			encoder->scaleWidth = width;
+			encoder->scaleHeight = height;
+		}
+#if LIBAVCODEC_VERSION_MAJOR >= 55
+		av_frame_make_writable(frame);
+#endif
+		sws_scale(encoder->scaleContext, (const uint8_t* const*) &pixels, &stride, 0, height, frame->data, frame->linesize);
+	}
+	frame->pts = av_rescale_q(encoder->currentVideoFrame, encoder->video->time_base, encoder->videoStream->time_base);
+	++encoder->currentVideoFrame;
+
+#ifdef FFMPEG_USE_HWACCEL
+	if (encoder->hwFrame) {
+		av_frame_unref(encoder->hwFrame);
+		if (av_hwframe_get_buffer(encoder->hwFrames, encoder->hwFrame, 0) < 0 || av_hwframe_transfer_data(encoder->hwFrame, frame, 0) < 0) {
+			return;
+		}
+		encoder->hwFrame->pts = frame->pts;
+		frame = encoder->hwFrame;
+	}
+#endif
 
 	AVPacket packet;
 
 	av_init_packet(&packet);
 	packet.data = 0;
 	packet.size = 0;
-#if LIBAVCODEC_VERSION_MAJOR >= 55
-	av_frame_make_writable(encoder->videoFrame);
-#endif
-	encoder->videoFrame->pts = av_rescale_q(encoder->currentVideoFrame, encoder->video->time_base, encoder->videoStream->time_base);
-	++encoder->currentVideoFrame;
-
-	sws_scale(encoder->scaleContext, (const uint8_t* const*) &pixels, (const int*) &stride, 0, encoder->iheight, encoder->videoFrame->data, encoder->videoFrame->linesize);
 
 	int gotData;
 #ifdef FFMPEG_USE_PACKETS
-	avcodec_send_frame(encoder->video, encoder->videoFrame);
+	avcodec_send_frame(encoder->video, frame);
 	gotData = avcodec_receive_packet(encoder->video, &packet) == 0;
 #else
-	avcodec_encode_video2(encoder->video, &packet, encoder->videoFrame, &gotData);
+	avcodec_encode_video2(encoder->video, &packet, frame, &gotData);
 #endif
-	packet.pts = encoder->videoFrame->pts;
+	packet.pts = frame->pts;
 	if (gotData) {
 #ifndef FFMPEG_USE_PACKET_UNREF
 		if (encoder->video->coded_frame->key_frame) {
@@ -617,25 +869,86 @@ static void _ffmpegSetVideoDimensions(struct mAVStream* stream, unsigned width,
 	if (!encoder->context || !encoder->videoCodec) {
 		return;
 	}
+	// The scaler is rebuilt by whichever thread encodes the first frame at the new size
 	encoder->iwidth = width;
 	encoder->iheight = height;
-	if (encoder->scaleContext) {
-		sws_freeContext(encoder->scaleContext);
+}
+
+#ifndef DISABLE_THREADING
+static void _ffmpegEncodeSlot(struct FFmpegEncoder* encoder, struct FFmpegEncoderSlot* slot) {
+	switch (slot->type) {
+	case FFMPEG_SLOT_VIDEO:
+		_ffmpegEncodeVideo(encoder, slot->data, slot->width * BYTES_PER_PIXEL, slot->width, slot->height);
+		break;
+	case FFMPEG_SLOT_AUDIO:
+		_ffmpegEncodeAudio(encoder, slot->data);
+		break;
 	}
-	encoder->scaleContext = sws_getContext(encoder->iwidth, encoder->iheight,
-#ifdef COLOR_16_BIT
-#ifdef COLOR_5_6_5
-	    AV_PIX_FMT_RGB565,
-#else
-	    AV_PIX_FMT_BGR555,
-#endif
-#else
-#ifndef USE_LIBAV
-	    AV_PIX_FMT_0BGR32,
-#else
-	    AV_PIX_FMT_BGR32,
-#endif
-#endif
-	    encoder->videoFrame->width, encoder->videoFrame->height, encoder->video->pix_fmt,
-	    SWS_POINT, 0, 0, 0);
 }
+
+static THREAD_ENTRY _ffmpegEncoderThread(void* context) {
+	struct FFmpegEncoder* encoder = context;
+	ThreadSetName("FFmpeg Encoder");
+	mTRACE_THREAD("FFmpeg Encoder");
+	while (true) {
+		int32_t write;
+		ATOMIC_LOAD(write, encoder->queueWrite);
+		if (write == encoder->queueRead) {
+			MutexLock(&encoder->queueMutex);
+			ATOMIC_LOAD(write, encoder->queueWrite);
+			bool done = write == encoder->queueRead && encoder->threadDone;
+			if (write == encoder->queueRead && !done) {
+				ConditionWait(&encoder->queueFilled, &encoder->queueMutex);
+			}
+			MutexUnlock(&encoder->queueMutex);
+			if (done) {
+				break;
+			}
+			continue;
+		}
+		mTRACE_BEGIN(trace);
+		_ffmpegEncodeSlot(encoder, &encoder->slots[encoder->queueRead % FFMPEG_QUEUE_SLOTS]);
+		mTRACE_END(trace, "encode");
+		MutexLock(&encoder->queueMutex);
+		ATOMIC_STORE(encoder->queueRead, (encoder->queueRead + 1) % (FFMPEG_QUEUE_SLOTS * 2));
+		ConditionWake(&encoder->queueDrained);
+		MutexUnlock(&encoder->queueMutex);
+	}
+	return 0;
+}
+
+static void _ffmpegStartThread(struct FFmpegEncoder* encoder) {
+	encoder->queueRead = 0;
+	encoder->queueWrite = 0;
+	encoder->threadDone = false;
+	MutexInit(&encoder->queueMutex);
+	ConditionInit(&encoder->queueFilled);
+	ConditionInit(&encoder->queueDrained);
+	encoder->threadRunning = !ThreadCreate(&encoder->thread, _ffmpegEncoderThread, encoder);
+	if (!encoder->threadRunning) {
+		ConditionDeinit(&encoder->queueDrained);
+		ConditionDeinit(&encoder->queueFilled);
+		MutexDeinit(&encoder->queueMutex);
+	}
+}
+
+static void _ffmpegStopThread(struct FFmpegEncoder* encoder) {
+	if (encoder->threadRunning) {
+		MutexLock(&encoder->queueMutex);
+		encoder->threadDone = true;
+		ConditionWake(&encoder->queueFilled);
+		MutexUnlock(&encoder->queueMutex);
+		ThreadJoin(encoder->thread);
+		ConditionDeinit(&encoder->queueDrained);
+		ConditionDeinit(&encoder->queueFilled);
+		MutexDeinit(&encoder->queueMutex);
+		encoder->threadRunning = false;
+	}
+	size_t i;
+	for (i = 0; i < FFMPEG_QUEUE_SLOTS; ++i) {
+		free(encoder->slots[i].data);
+		encoder->slots[i].data = NULL;
+		encoder->slots[i].capacity = 0;
+	}
+}
+#endif
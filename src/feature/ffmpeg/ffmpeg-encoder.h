@@ -11,6 +11,9 @@
 CXX_GUARD_START
 
 #include <mgba/internal/gba/gba.h>
+#ifndef DISABLE_THREADING
+#include <mgba-util/threading.h>
+#endif
 
 #include <libavformat/avformat.h>
 #include <libavcodec/version.h>
@@ -34,6 +37,34 @@ CXX_GUARD_START
 #define FFMPEG_USE_PACKET_UNREF
 #endif
 
+// Version 58.18 in FFmpeg
+#if !defined(USE_LIBAV) && LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 18, 100)
+#define FFMPEG_USE_HWACCEL
+#include <libavutil/hwcontext.h>
+#endif
+
+#define FFMPEG_QUEUE_SLOTS 16
+
+enum FFmpegEncoderSlotType {
+	FFMPEG_SLOT_VIDEO,
+	FFMPEG_SLOT_AUDIO
+};
+
+struct FFmpegEncoderSlot {
+	enum FFmpegEncoderSlotType type;
+	int width;
+	int height;
+	void* data;
+	size_t capacity;
+};
+
+struct FFmpegEncoderStatistics {
+	unsigned videoFrames;
+	unsigned droppedFrames;
+	unsigned stalls;
+	unsigned maxQueued;
+};
+
 struct FFmpegEncoder {
 	struct mAVStream d;
 	struct AVFormatContext* context;
@@ -77,14 +108,47 @@ struct FFmpegEncoder {
 	int iheight;
 	int64_t currentVideoFrame;
 	struct SwsContext* scaleContext;
+	int scaleWidth;
+	int scaleHeight;
 	struct AVStream* videoStream;
+	// Wraps frames that are already in the encoder's format, so they can skip sws_scale
+	struct AVFrame* sourceFrame;
+
+	const char* hwDeviceName;
+#ifdef FFMPEG_USE_HWACCEL
+	enum AVHWDeviceType hwDeviceType;
+	struct AVBufferRef* hwDevice;
+	struct AVBufferRef* hwFrames;
+	struct AVFrame* hwFrame;
+#endif
+
+	bool dropFrames;
+	struct FFmpegEncoderStatistics statistics;
+
+#ifndef DISABLE_THREADING
+	// Single producer, single consumer: the emulation thread fills slots and the encoder thread empties them
+	struct FFmpegEncoderSlot slots[FFMPEG_QUEUE_SLOTS];
+	int32_t queueRead;
+	int32_t queueWrite;
+	bool threadRunning;
+	bool threadDone;
+	Thread thread;
+	Mutex queueMutex;
+	Condition queueFilled;
+	Condition queueDrained;
+#endif
 };
 
 void FFmpegEncoderInit(struct FFmpegEncoder*);
 bool FFmpegEncoderSetAudio(struct FFmpegEncoder*, const char* acodec, unsigned abr);
 bool FFmpegEncoderSetVideo(struct FFmpegEncoder*, const char* vcodec, unsigned vbr);
 bool FFmpegEncoderSetContainer(struct FFmpegEncoder*, const char* container);
+// Device path or name passed to FFmpeg for hardware encoders, e.g. a DRM render node for VAAPI; NULL means the default
+void FFmpegEncoderSetHardwareDevice(struct FFmpegEncoder*, const char* device);
 void FFmpegEncoderSetDimensions(struct FFmpegEncoder*, int width, int height);
+// With dropFrames set, video frames are discarded instead of stalling emulation when the encoder falls behind
+void FFmpegEncoderSetDropFrames(struct FFmpegEncoder*, bool dropFrames);
+void FFmpegEncoderGetStatistics(const struct FFmpegEncoder*, struct FFmpegEncoderStatistics*);
 bool FFmpegEncoderVerifyContainer(struct FFmpegEncoder*);
 bool FFmpegEncoderOpen(struct FFmpegEncoder*, const char* outfile);
 void FFmpegEncoderClose(struct FFmpegEncoder*);
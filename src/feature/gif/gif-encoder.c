@@ -0,0 +1,923 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "gif-encoder.h"
+
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/video.h>
+#include <mgba-util/vfs.h>
+
+#ifdef USE_PNG
+#include <zlib.h>
+#endif
+
+enum {
+	GIF_COLOR_SPACE = 0x8000,
+	GIF_MAX_COLORS = 256,
+	GIF_MAX_DELAY = 0xFFFF,
+	GIF_LZW_MAX_CODE = 4095,
+	GIF_LZW_HASH_BITS = 13,
+	GIF_LZW_HASH_SIZE = 1 << GIF_LZW_HASH_BITS,
+	GIF_BLOCK_SIZE = 255,
+	APNG_DELAY_DENOMINATOR = 1000,
+};
+
+struct GIFEncoderRect {
+	unsigned x;
+	unsigned y;
+	unsigned width;
+	unsigned height;
+};
+
+struct GIFBitWriter {
+	uint32_t bits;
+	unsigned nBits;
+	uint8_t block[GIF_BLOCK_SIZE + 1];
+};
+
+struct GIFColorBox {
+	size_t start;
+	size_t end;
+	int channel;
+	uint64_t score;
+};
+
+static void _gifPostVideoFrame(struct mAVStream*, const color_t* pixels, size_t stride);
+static void _gifVideoDimensionsChanged(struct mAVStream*, unsigned width, unsigned height);
+static void _gifProcessFrame(struct GIFEncoder*, struct GIFEncoderFrame*);
+static void _gifFreeBuffers(struct GIFEncoder*);
+
+#ifndef DISABLE_THREADING
+static void _gifStartThread(struct GIFEncoder*);
+static void _gifStopThread(struct GIFEncoder*);
+#endif
+
+void GIFEncoderInit(struct GIFEncoder* encoder) {
+	memset(encoder, 0, sizeof(*encoder));
+
+	encoder->d.videoDimensionsChanged = _gifVideoDimensionsChanged;
+	encoder->d.postVideoFrame = _gifPostVideoFrame;
+	encoder->d.postAudioFrame = 0;
+	encoder->d.postAudioBuffer = 0;
+
+	encoder->format = GIF_ENCODER_FORMAT_GIF;
+	encoder->frameskip = 2;
+	encoder->delayMs = -1;
+
+	encoder->iwidth = GBA_VIDEO_HORIZONTAL_PIXELS;
+	encoder->iheight = GBA_VIDEO_VERTICAL_PIXELS;
+}
+
+void GIFEncoderSetParams(struct GIFEncoder* encoder, int frameskip, int delayMs) {
+	if (GIFEncoderIsOpen(encoder)) {
+		return;
+	}
+	encoder->frameskip = frameskip;
+	encoder->delayMs = delayMs;
+}
+
+bool GIFEncoderSetFormat(struct GIFEncoder* encoder, enum GIFEncoderFormat format) {
+	if (GIFEncoderIsOpen(encoder)) {
+		return false;
+	}
+#ifndef USE_PNG
+	if (format == GIF_ENCODER_FORMAT_APNG) {
+		return false;
+	}
+#endif
+	encoder->format = format;
+	return true;
+}
+
+static inline void _put16LE(uint8_t* out, unsigned value) {
+	out[0] = value;
+	out[1] = value >> 8;
+}
+
+static bool _gifAppend(struct GIFEncoder* encoder, const void* data, size_t size) {
+	if (encoder->outputSize + size > encoder->outputCapacity) {
+		size_t capacity = encoder->outputCapacity ? encoder->outputCapacity : 0x1000;
+		while (capacity < encoder->outputSize + size) {
+			capacity *= 2;
+		}
+		uint8_t* output = realloc(encoder->output, capacity);
+		if (!output) {
+			encoder->failed = true;
+			return false;
+		}
+		encoder->output = output;
+		encoder->outputCapacity = capacity;
+	}
+	memcpy(&encoder->output[encoder->outputSize], data, size);
+	encoder->outputSize += size;
+	return true;
+}
+
+static void _gifAppendByte(struct GIFEncoder* encoder, uint8_t byte) {
+	_gifAppend(encoder, &byte, 1);
+}
+
+static void _gifFlushOutput(struct GIFEncoder* encoder) {
+	if (encoder->outputSize && encoder->vf->write(encoder->vf, encoder->output, encoder->outputSize) != (ssize_t) encoder->outputSize) {
+		encoder->failed = true;
+	}
+	encoder->outputSize = 0;
+}
+
+static uint64_t _gifFramePeriod(const struct GIFEncoder* encoder) {
+	if (encoder->delayMs >= 0) {
+		return encoder->delayMs;
+	}
+	return (uint64_t) (encoder->frameskip + 1) * VIDEO_TOTAL_LENGTH;
+}
+
+// Timestamps are kept exact and only rounded per frame, so rounded delays don't drift over a long clip
+static uint64_t _gifUnits(const struct GIFEncoder* encoder, uint64_t ticks) {
+	uint64_t unitsPerSecond = encoder->format == GIF_ENCODER_FORMAT_APNG ? APNG_DELAY_DENOMINATOR : 100;
+	uint64_t ticksPerSecond = encoder->delayMs >= 0 ? 1000 : GBA_ARM7TDMI_FREQUENCY;
+	return ticks * unitsPerSecond / ticksPerSecond;
+}
+
+static inline uint16_t _gifColor(color_t color) {
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+	return (color >> 11) | ((color >> 1) & 0x3E0) | ((color & 0x1F) << 10);
+#else
+	return color & 0x7FFF;
+#endif
+#else
+	return M_RGB8_TO_BGR5(color);
+#endif
+}
+
+static uint16_t _gifPendingPixel(const struct GIFEncoder* encoder, unsigned x, unsigned y) {
+	if (x < encoder->pending.width && y < encoder->pending.height) {
+		return encoder->pending.pixels[y * encoder->pending.width + x];
+	}
+	return encoder->canvas[y * encoder->width + x];
+}
+
+static bool _gifChangedRect(const struct GIFEncoder* encoder, struct GIFEncoderRect* rect) {
+	unsigned width = encoder->pending.width < encoder->width ? encoder->pending.width : encoder->width;
+	unsigned height = encoder->pending.height < encoder->height ? encoder->pending.height : encoder->height;
+	unsigned left = width;
+	unsigned right = 0;
+	unsigned top = height;
+	unsigned bottom = 0;
+	unsigned y;
+	for (y = 0; y < height; ++y) {
+		const uint16_t* row = &encoder->pending.pixels[y * encoder->pending.width];
+		const uint16_t* previous = &encoder->canvas[y * encoder->width];
+		if (!memcmp(row, previous, width * sizeof(*row))) {
+			continue;
+		}
+		unsigned x;
+		for (x = 0; x < left && row[x] == previous[x]; ++x);
+		left = x;
+		for (x = width; x > right && row[x - 1] == previous[x - 1]; --x);
+		right = x;
+		if (top > y) {
+			top = y;
+		}
+		bottom = y + 1;
+	}
+	if (top >= bottom) {
+		return false;
+	}
+	rect->x = left;
+	rect->y = top;
+	rect->width = right - left;
+	rect->height = bottom - top;
+	return true;
+}
+
+static void _gifMeasureBox(const struct GIFEncoder* encoder, struct GIFColorBox* box) {
+	unsigned min[3] = { 0x1F, 0x1F, 0x1F };
+	unsigned max[3] = { 0, 0, 0 };
+	uint64_t population = 0;
+	size_t i;
+	for (i = box->start; i < box->end; ++i) {
+		uint16_t color = encoder->colors[i];
+		int channel;
+		for (channel = 0; channel < 3; ++channel) {
+			unsigned value = (color >> (channel * 5)) & 0x1F;
+			if (value < min[channel]) {
+				min[channel] = value;
+			}
+			if (value > max[channel]) {
+				max[channel] = value;
+			}
+		}
+		population += encoder->colorCounts[color];
+	}
+	box->channel = 0;
+	int channel;
+	for (channel = 1; channel < 3; ++channel) {
+		if (max[channel] - min[channel] > max[box->channel] - min[box->channel]) {
+			box->channel = channel;
+		}
+	}
+	box->score = box->end - box->start > 1 ? (max[box->channel] - min[box->channel] + 1) * population : 0;
+}
+
+static void _gifSplitBox(struct GIFEncoder* encoder, struct GIFColorBox* box, struct GIFColorBox* split) {
+	// Counting sort along the widest channel; there are only 32 possible values
+	size_t buckets[33] = { 0 };
+	int shift = box->channel * 5;
+	uint64_t population = 0;
+	size_t i;
+	for (i = box->start; i < box->end; ++i) {
+		++buckets[((encoder->colors[i] >> shift) & 0x1F) + 1];
+		population += encoder->colorCounts[encoder->colors[i]];
+	}
+	for (i = 1; i < 33; ++i) {
+		buckets[i] += buckets[i - 1];
+	}
+	for (i = box->start; i < box->end; ++i) {
+		uint16_t color = encoder->colors[i];
+		encoder->sortedColors[box->start + buckets[(color >> shift) & 0x1F]++] = color;
+	}
+	memcpy(&encoder->colors[box->start], &encoder->sortedColors[box->start], (box->end - box->start) * sizeof(*encoder->colors));
+
+	uint64_t accumulated = 0;
+	size_t median;
+	for (median = box->start; median < box->end - 1; ++median) {
+		accumulated += encoder->colorCounts[encoder->colors[median]];
+		if (accumulated * 2 >= population) {
+			break;
+		}
+	}
+	++median;
+	if (median >= box->end) {
+		median = box->end - 1;
+	}
+	split->start = median;
+	split->end = box->end;
+	box->end = median;
+	_gifMeasureBox(encoder, box);
+	_gifMeasureBox(encoder, split);
+}
+
+// Fills in the palette and colorLookup for every color in colors, and clears their counts
+static unsigned _gifBuildPalette(struct GIFEncoder* encoder, size_t nColors, unsigned limit, uint16_t* palette) {
+	size_t i;
+	if (nColors <= limit) {
+		// The common case: the frame fits in a palette as-is, so it's stored losslessly
+		for (i = 0; i < nColors; ++i) {
+			uint16_t color = encoder->colors[i];
+			palette[i] = color;
+			encoder->colorLookup[color] = i;
+			encoder->colorCounts[color] = 0;
+		}
+		return nColors;
+	}
+
+	struct GIFColorBox boxes[GIF_MAX_COLORS];
+	unsigned nBoxes = 1;
+	boxes[0].start = 0;
+	boxes[0].end = nColors;
+	_gifMeasureBox(encoder, &boxes[0]);
+	while (nBoxes < limit) {
+		unsigned best = 0;
+		unsigned box;
+		for (box = 1; box < nBoxes; ++box) {
+			if (boxes[box].score > boxes[best].score) {
+				best = box;
+			}
+		}
+		if (!boxes[best].score) {
+			break;
+		}
+		_gifSplitBox(encoder, &boxes[best], &boxes[nBoxes]);
+		++nBoxes;
+	}
+
+	unsigned box;
+	for (box = 0; box < nBoxes; ++box) {
+		uint64_t sum[3] = { 0, 0, 0 };
+		uint64_t population = 0;
+		for (i = boxes[box].start; i < boxes[box].end; ++i) {
+			uint16_t color = encoder->colors[i];
+			uint32_t count = encoder->colorCounts[color];
+			sum[0] += M_R5(color) * count;
+			sum[1] += M_G5(color) * count;
+			sum[2] += M_B5(color) * count;
+			population += count;
+			encoder->colorLookup[color] = box;
+			encoder->colorCounts[color] = 0;
+		}
+		palette[box] = ((sum[0] + population / 2) / population) |
+		               (((sum[1] + population / 2) / population) << 5) |
+		               (((sum[2] + population / 2) / population) << 10);
+	}
+	return nBoxes;
+}
+
+static void _gifPutCode(struct GIFEncoder* encoder, struct GIFBitWriter* writer, unsigned code, unsigned size) {
+	writer->bits |= code << writer->nBits;
+	writer->nBits += size;
+	while (writer->nBits >= 8) {
+		++writer->block[0];
+		writer->block[writer->block[0]] = writer->bits;
+		writer->bits >>= 8;
+		writer->nBits -= 8;
+		if (writer->block[0] == GIF_BLOCK_SIZE) {
+			_gifAppend(encoder, writer->block, GIF_BLOCK_SIZE + 1);
+			writer->block[0] = 0;
+		}
+	}
+}
+
+static size_t _gifLzwFind(const struct GIFEncoder* encoder, uint32_t key) {
+	size_t slot = (key * 2654435761U) >> (32 - GIF_LZW_HASH_BITS);
+	while (encoder->lzwKeys[slot] && encoder->lzwKeys[slot] != key + 1) {
+		slot = (slot + 1) & (GIF_LZW_HASH_SIZE - 1);
+	}
+	return slot;
+}
+
+static void _gifCompress(struct GIFEncoder* encoder, const uint8_t* indices, size_t count, unsigned minCodeSize) {
+	_gifAppendByte(encoder, minCodeSize);
+	unsigned clear = 1 << minCodeSize;
+	unsigned codeSize = minCodeSize + 1;
+	unsigned maxCode = clear + 1;
+	struct GIFBitWriter writer = { .bits = 0, .nBits = 0 };
+	writer.block[0] = 0;
+	memset(encoder->lzwKeys, 0, GIF_LZW_HASH_SIZE * sizeof(*encoder->lzwKeys));
+
+	_gifPutCode(encoder, &writer, clear, codeSize);
+	unsigned current = indices[0];
+	size_t i;
+	for (i = 1; i < count; ++i) {
+		uint32_t key = (current << 8) | indices[i];
+		size_t slot = _gifLzwFind(encoder, key);
+		if (encoder->lzwKeys[slot]) {
+			current = encoder->lzwCodes[slot];
+			continue;
+		}
+		_gifPutCode(encoder, &writer, current, codeSize);
+		++maxCode;
+		encoder->lzwKeys[slot] = key + 1;
+		encoder->lzwCodes[slot] = maxCode;
+		if (maxCode >= (1U << codeSize)) {
+			++codeSize;
+		}
+		if (maxCode == GIF_LZW_MAX_CODE) {
+			_gifPutCode(encoder, &writer, clear, codeSize);
+			memset(encoder->lzwKeys, 0, GIF_LZW_HASH_SIZE * sizeof(*encoder->lzwKeys));
+			codeSize = minCodeSize + 1;
+			maxCode = clear + 1;
+		}
+		current = indices[i];
+	}
+	_gifPutCode(encoder, &writer, current, codeSize);
+	_gifPutCode(encoder, &writer, clear + 1, codeSize);
+	if (writer.nBits) {
+		_gifPutCode(encoder, &writer, 0, 8 - writer.nBits);
+	}
+	if (writer.block[0]) {
+		_gifAppend(encoder, writer.block, writer.block[0] + 1);
+	}
+	_gifAppendByte(encoder, 0);
+}
+
+static void _gifWriteHeader(struct GIFEncoder* encoder) {
+	uint8_t header[13] = { 'G', 'I', 'F', '8', '9', 'a' };
+	_put16LE(&header[6], encoder->width);
+	_put16LE(&header[8], encoder->height);
+	_gifAppend(encoder, header, sizeof(header));
+
+	static const uint8_t loop[19] = {
+		0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00
+	};
+	_gifAppend(encoder, loop, sizeof(loop));
+	_gifFlushOutput(encoder);
+}
+
+static void _gifWriteFrame(struct GIFEncoder* encoder, const struct GIFEncoderRect* rect, unsigned delay) {
+	// Every frame but the first leaves unchanged pixels transparent, which costs one palette entry
+	bool transparent = encoder->writtenFrames > 0;
+	size_t nColors = 0;
+	unsigned x, y;
+	for (y = rect->y; y < rect->y + rect->height; ++y) {
+		for (x = rect->x; x < rect->x + rect->width; ++x) {
+			uint16_t color = _gifPendingPixel(encoder, x, y);
+			if (transparent && color == encoder->canvas[y * encoder->width + x]) {
+				continue;
+			}
+			if (!encoder->colorCounts[color]) {
+				encoder->colors[nColors] = color;
+				++nColors;
+			}
+			++encoder->colorCounts[color];
+		}
+	}
+
+	uint16_t palette[GIF_MAX_COLORS];
+	unsigned nEntries = _gifBuildPalette(encoder, nColors, GIF_MAX_COLORS - transparent, palette);
+	unsigned transparentIndex = nEntries;
+	nEntries += transparent;
+	unsigned bits = 1;
+	while ((1U << bits) < nEntries) {
+		++bits;
+	}
+
+	uint8_t* index = encoder->indices;
+	for (y = rect->y; y < rect->y + rect->height; ++y) {
+		for (x = rect->x; x < rect->x + rect->width; ++x) {
+			uint16_t color = _gifPendingPixel(encoder, x, y);
+			if (transparent && color == encoder->canvas[y * encoder->width + x]) {
+				*index = transparentIndex;
+			} else {
+				*index = encoder->colorLookup[color];
+			}
+			++index;
+		}
+	}
+
+	uint8_t control[8] = { 0x21, 0xF9, 0x04 };
+	// Disposal method 1 keeps the frame in place, so the next one only has to cover what changed
+	control[3] = (1 << 2) | transparent;
+	_put16LE(&control[4], delay);
+	control[6] = transparent ? transparentIndex : 0;
+	_gifAppend(encoder, control, sizeof(control));
+
+	uint8_t descriptor[10] = { 0x2C };
+	_put16LE(&descriptor[1], rect->x);
+	_put16LE(&descriptor[3], rect->y);
+	_put16LE(&descriptor[5], rect->width);
+	_put16LE(&descriptor[7], rect->height);
+	descriptor[9] = 0x80 | (bits - 1);
+	_gifAppend(encoder, descriptor, sizeof(descriptor));
+
+	uint8_t colorTable[GIF_MAX_COLORS * 3] = { 0 };
+	unsigned i;
+	for (i = 0; i < transparentIndex; ++i) {
+		colorTable[i * 3] = M_R8(palette[i]);
+		colorTable[i * 3 + 1] = M_G8(palette[i]);
+		colorTable[i * 3 + 2] = M_B8(palette[i]);
+	}
+	_gifAppend(encoder, colorTable, 3 << bits);
+
+	_gifCompress(encoder, encoder->indices, rect->width * rect->height, bits < 2 ? 2 : bits);
+	_gifFlushOutput(encoder);
+}
+
+#ifdef USE_PNG
+static inline void _put16BE(uint8_t* out, unsigned value) {
+	out[0] = value >> 8;
+	out[1] = value;
+}
+
+static inline void _put32BE(uint8_t* out, uint32_t value) {
+	out[0] = value >> 24;
+	out[1] = value >> 16;
+	out[2] = value >> 8;
+	out[3] = value;
+}
+
+static void _apngFillRow(const struct GIFEncoder* encoder, uint8_t* out, const struct GIFEncoderRect* rect, unsigned y) {
+	unsigned x;
+	for (x = 0; x < rect->width; ++x) {
+		uint16_t color = _gifPendingPixel(encoder, rect->x + x, y);
+		out[x * 3] = M_R8(color);
+		out[x * 3 + 1] = M_G8(color);
+		out[x * 3 + 2] = M_B8(color);
+	}
+}
+
+static bool _apngWriteImage(struct GIFEncoder* encoder, const struct GIFEncoderRect* rect) {
+	if (setjmp(png_jmpbuf(encoder->png))) {
+		return false;
+	}
+	unsigned y;
+	for (y = 0; y < rect->height; ++y) {
+		_apngFillRow(encoder, encoder->indices, rect, rect->y + y);
+		png_write_row(encoder->png, encoder->indices);
+	}
+	return true;
+}
+
+static bool _apngWriteFrameData(struct GIFEncoder* encoder, const struct GIFEncoderRect* rect) {
+	size_t rowSize = rect->width * 3 + 1;
+	uint8_t* rows = encoder->indices;
+	unsigned y;
+	for (y = 0; y < rect->height; ++y) {
+		uint8_t* row = &rows[y * rowSize];
+		_apngFillRow(encoder, &row[1], rect, rect->y + y);
+		// Sub filter, applied back to front so each byte still sees its unfiltered neighbor
+		row[0] = 1;
+		size_t i;
+		for (i = rowSize - 1; i > 3; --i) {
+			row[i] -= row[i - 3];
+		}
+	}
+
+	uLongf compressedSize = compressBound(rowSize * rect->height);
+	encoder->outputSize = 0;
+	if (encoder->outputCapacity < compressedSize + 4) {
+		uint8_t* output = realloc(encoder->output, compressedSize + 4);
+		if (!output) {
+			return false;
+		}
+		encoder->output = output;
+		encoder->outputCapacity = compressedSize + 4;
+	}
+	if (compress2(&encoder->output[4], &compressedSize, rows, rowSize * rect->height, Z_DEFAULT_COMPRESSION) != Z_OK) {
+		return false;
+	}
+	_put32BE(encoder->output, encoder->sequence);
+	++encoder->sequence;
+	return PNGWriteCustomChunk(encoder->png, "fdAT", compressedSize + 4, encoder->output);
+}
+
+static void _apngWriteFrame(struct GIFEncoder* encoder, const struct GIFEncoderRect* rect, unsigned delay) {
+	uint8_t control[26];
+	_put32BE(&control[0], encoder->sequence);
+	_put32BE(&control[4], rect->width);
+	_put32BE(&control[8], rect->height);
+	_put32BE(&control[12], rect->x);
+	_put32BE(&control[16], rect->y);
+	_put16BE(&control[20], delay);
+	_put16BE(&control[22], APNG_DELAY_DENOMINATOR);
+	// No disposal and no blending: each frame replaces its rectangle and stays up
+	control[24] = 0;
+	control[25] = 0;
+	++encoder->sequence;
+	if (!PNGWriteCustomChunk(encoder->png, "fcTL", sizeof(control), control)) {
+		encoder->failed = true;
+		return;
+	}
+	bool success;
+	if (!encoder->writtenFrames) {
+		// The first frame doubles as the default image, so it goes through libpng as the regular IDAT
+		success = _apngWriteImage(encoder, rect);
+	} else {
+		success = _apngWriteFrameData(encoder, rect);
+	}
+	if (!success) {
+		encoder->failed = true;
+	}
+}
+
+static void _apngPatchFrameCount(struct GIFEncoder* encoder) {
+	// The frame count isn't known until the end, so the acTL chunk is rewritten in place
+	uint8_t chunk[16];
+	memcpy(chunk, "acTL", 4);
+	_put32BE(&chunk[4], encoder->writtenFrames);
+	_put32BE(&chunk[8], 0);
+	_put32BE(&chunk[12], crc32(0, chunk, 12));
+	if (encoder->vf->seek(encoder->vf, encoder->actlOffset + 4, SEEK_SET) < 0 || encoder->vf->write(encoder->vf, chunk, sizeof(chunk)) != sizeof(chunk)) {
+		encoder->failed = true;
+	}
+}
+#endif
+
+static void _gifFlush(struct GIFEncoder* encoder, uint64_t endTicks) {
+	encoder->hasPending = false;
+	uint64_t delay = _gifUnits(encoder, endTicks) - _gifUnits(encoder, encoder->pending.ticks);
+	if (delay > GIF_MAX_DELAY) {
+		delay = GIF_MAX_DELAY;
+	}
+
+	struct GIFEncoderRect rect = { 0, 0, encoder->width, encoder->height };
+	if (encoder->writtenFrames && !_gifChangedRect(encoder, &rect)) {
+		// Only reached when a still frame outlasts the longest possible delay
+		rect.width = 1;
+		rect.height = 1;
+	}
+
+	switch (encoder->format) {
+	case GIF_ENCODER_FORMAT_GIF:
+		_gifWriteFrame(encoder, &rect, delay);
+		break;
+	case GIF_ENCODER_FORMAT_APNG:
+#ifdef USE_PNG
+		_apngWriteFrame(encoder, &rect, delay);
+#endif
+		break;
+	}
+
+	unsigned y;
+	for (y = rect.y; y < rect.y + rect.height; ++y) {
+		unsigned x;
+		for (x = rect.x; x < rect.x + rect.width; ++x) {
+			encoder->canvas[y * encoder->width + x] = _gifPendingPixel(encoder, x, y);
+		}
+	}
+	++encoder->writtenFrames;
+}
+
+static void _gifProcessFrame(struct GIFEncoder* encoder, struct GIFEncoderFrame* frame) {
+	if (encoder->failed) {
+		return;
+	}
+	if (encoder->hasPending) {
+		if (frame->width == encoder->pending.width && frame->height == encoder->pending.height &&
+		    !memcmp(frame->pixels, encoder->pending.pixels, frame->width * frame->height * sizeof(*frame->pixels)) &&
+		    _gifUnits(encoder, frame->ticks) - _gifUnits(encoder, encoder->pending.ticks) < GIF_MAX_DELAY) {
+			// Nothing changed, so the pending frame just stays up longer
+			return;
+		}
+		_gifFlush(encoder, frame->ticks);
+	}
+	// Trade buffers instead of copying; the slot gets the old pending buffer to fill next
+	struct GIFEncoderFrame pending = encoder->pending;
+	encoder->pending = *frame;
+	*frame = pending;
+	encoder->hasPending = true;
+}
+
+bool GIFEncoderOpen(struct GIFEncoder* encoder, const char* outfile) {
+	if (encoder->vf) {
+		return false;
+	}
+	encoder->vf = VFileOpen(outfile, O_WRONLY | O_CREAT | O_TRUNC);
+	if (!encoder->vf) {
+		return false;
+	}
+	encoder->width = encoder->iwidth;
+	encoder->height = encoder->iheight;
+	size_t pixels = encoder->width * encoder->height;
+	encoder->canvas = calloc(pixels, sizeof(*encoder->canvas));
+	// Big enough for either a frame of palette indices or a frame of filtered RGB rows
+	encoder->indices = malloc((encoder->width * 3 + 1) * encoder->height);
+	encoder->colorCounts = calloc(GIF_COLOR_SPACE, sizeof(*encoder->colorCounts));
+	encoder->colorLookup = malloc(GIF_COLOR_SPACE);
+	encoder->colors = malloc(GIF_COLOR_SPACE * sizeof(*encoder->colors));
+	encoder->sortedColors = malloc(GIF_COLOR_SPACE * sizeof(*encoder->sortedColors));
+	encoder->lzwKeys = malloc(GIF_LZW_HASH_SIZE * sizeof(*encoder->lzwKeys));
+	encoder->lzwCodes = malloc(GIF_LZW_HASH_SIZE * sizeof(*encoder->lzwCodes));
+	encoder->outputSize = 0;
+	encoder->currentFrame = 0;
+	encoder->capturedFrames = 0;
+	encoder->lastTicks = 0;
+	encoder->writtenFrames = 0;
+	encoder->hasPending = false;
+	encoder->failed = !encoder->canvas || !encoder->indices || !encoder->colorCounts || !encoder->colorLookup ||
+	                  !encoder->colors || !encoder->sortedColors || !encoder->lzwKeys || !encoder->lzwCodes;
+
+	switch (encoder->format) {
+	case GIF_ENCODER_FORMAT_GIF:
+		_gifWriteHeader(encoder);
+		break;
+	case GIF_ENCODER_FORMAT_APNG:
+#ifdef USE_PNG
+		encoder->png = PNGWriteOpen(encoder->vf);
+		encoder->info = encoder->png ? PNGWriteHeader(encoder->png, encoder->width, encoder->height) : NULL;
+		if (!encoder->info) {
+			encoder->failed = true;
+			break;
+		}
+		encoder->actlOffset = encoder->vf->seek(encoder->vf, 0, SEEK_CUR);
+		encoder->sequence = 0;
+		uint8_t control[8] = { 0 };
+		if (!PNGWriteCustomChunk(encoder->png, "acTL", sizeof(control), control)) {
+			encoder->failed = true;
+		}
+#else
+		encoder->failed = true;
+#endif
+		break;
+	}
+
+	if (encoder->failed) {
+#ifdef USE_PNG
+		if (encoder->png) {
+			PNGWriteClose(encoder->png, encoder->info);
+			encoder->png = NULL;
+			encoder->info = NULL;
+		}
+#endif
+		encoder->vf->close(encoder->vf);
+		encoder->vf = NULL;
+		_gifFreeBuffers(encoder);
+		return false;
+	}
+
+#ifndef DISABLE_THREADING
+	_gifStartThread(encoder);
+#endif
+	return true;
+}
+
+bool GIFEncoderClose(struct GIFEncoder* encoder) {
+	if (!encoder->vf) {
+		return false;
+	}
+#ifndef DISABLE_THREADING
+	_gifStopThread(encoder);
+#endif
+	if (encoder->hasPending && !encoder->failed) {
+		_gifFlush(encoder, encoder->lastTicks + _gifFramePeriod(encoder));
+	}
+
+	switch (encoder->format) {
+	case GIF_ENCODER_FORMAT_GIF:
+		_gifAppendByte(encoder, 0x3B);
+		_gifFlushOutput(encoder);
+		break;
+	case GIF_ENCODER_FORMAT_APNG:
+#ifdef USE_PNG
+		PNGWriteClose(encoder->png, encoder->info);
+		encoder->png = NULL;
+		encoder->info = NULL;
+		if (encoder->writtenFrames) {
+			_apngPatchFrameCount(encoder);
+		}
+#endif
+		break;
+	}
+	bool success = !encoder->failed && encoder->writtenFrames;
+
+	encoder->vf->close(encoder->vf);
+	encoder->vf = NULL;
+	_gifFreeBuffers(encoder);
+	return success;
+}
+
+bool GIFEncoderIsOpen(struct GIFEncoder* encoder) {
+	return !!encoder->vf;
+}
+
+static void _gifFreeBuffers(struct GIFEncoder* encoder) {
+	free(encoder->canvas);
+	free(encoder->indices);
+	free(encoder->colorCounts);
+	free(encoder->colorLookup);
+	free(encoder->colors);
+	free(encoder->sortedColors);
+	free(encoder->lzwKeys);
+	free(encoder->lzwCodes);
+	free(encoder->output);
+	free(encoder->pending.pixels);
+	encoder->canvas = NULL;
+	encoder->indices = NULL;
+	encoder->colorCounts = NULL;
+	encoder->colorLookup = NULL;
+	encoder->colors = NULL;
+	encoder->sortedColors = NULL;
+	encoder->lzwKeys = NULL;
+	encoder->lzwCodes = NULL;
+	encoder->output = NULL;
+	encoder->outputCapacity = 0;
+	encoder->pending.pixels = NULL;
+	encoder->pending.capacity = 0;
+#ifdef DISABLE_THREADING
+	free(encoder->incoming.pixels);
+	encoder->incoming.pixels = NULL;
+	encoder->incoming.capacity = 0;
+#endif
+}
+
+#ifndef DISABLE_THREADING
+static struct GIFEncoderFrame* _gifAcquireFrame(struct GIFEncoder* encoder) {
+	int32_t read;
+	ATOMIC_LOAD(read, encoder->queueRead);
+	if ((encoder->queueWrite - read + GIF_ENCODER_QUEUE_SLOTS * 2) % (GIF_ENCODER_QUEUE_SLOTS * 2) == GIF_ENCODER_QUEUE_SLOTS) {
+		MutexLock(&encoder->queueMutex);
+		while (true) {
+			ATOMIC_LOAD(read, encoder->queueRead);
+			if ((encoder->queueWrite - read + GIF_ENCODER_QUEUE_SLOTS * 2) % (GIF_ENCODER_QUEUE_SLOTS * 2) != GIF_ENCODER_QUEUE_SLOTS) {
+				break;
+			}
+			ConditionWait(&encoder->queueDrained, &encoder->queueMutex);
+		}
+		MutexUnlock(&encoder->queueMutex);
+	}
+	return &encoder->slots[encoder->queueWrite % GIF_ENCODER_QUEUE_SLOTS];
+}
+
+static void _gifSubmitFrame(struct GIFEncoder* encoder) {
+	if (!encoder->threadRunning) {
+		_gifProcessFrame(encoder, &encoder->slots[encoder->queueWrite % GIF_ENCODER_QUEUE_SLOTS]);
+		return;
+	}
+	MutexLock(&encoder->queueMutex);
+	ATOMIC_STORE(encoder->queueWrite, (encoder->queueWrite + 1) % (GIF_ENCODER_QUEUE_SLOTS * 2));
+	ConditionWake(&encoder->queueFilled);
+	MutexUnlock(&encoder->queueMutex);
+}
+
+static THREAD_ENTRY _gifEncoderThread(void* context) {
+	struct GIFEncoder* encoder = context;
+	ThreadSetName("GIF Encoder");
+	while (true) {
+		int32_t write;
+		ATOMIC_LOAD(write, encoder->queueWrite);
+		if (write == encoder->queueRead) {
+			MutexLock(&encoder->queueMutex);
+			ATOMIC_LOAD(write, encoder->queueWrite);
+			bool done = write == encoder->queueRead && encoder->threadDone;
+			if (write == encoder->queueRead && !done) {
+				ConditionWait(&encoder->queueFilled, &encoder->queueMutex);
+			}
+			MutexUnlock(&encoder->queueMutex);
+			if (done) {
+				break;
+			}
+			continue;
+		}
+		_gifProcessFrame(encoder, &encoder->slots[encoder->queueRead % GIF_ENCODER_QUEUE_SLOTS]);
+		MutexLock(&encoder->queueMutex);
+		ATOMIC_STORE(encoder->queueRead, (encoder->queueRead + 1) % (GIF_ENCODER_QUEUE_SLOTS * 2));
+		ConditionWake(&encoder->queueDrained);
+		MutexUnlock(&encoder->queueMutex);
+	}
+	return 0;
+}
+
+static void _gifStartThread(struct GIFEncoder* encoder) {
+	encoder->queueRead = 0;
+	encoder->queueWrite = 0;
+	encoder->threadDone = false;
+	MutexInit(&encoder->queueMutex);
+	ConditionInit(&encoder->queueFilled);
+	ConditionInit(&encoder->queueDrained);
+	encoder->threadRunning = !ThreadCreate(&encoder->thread, _gifEncoderThread, encoder);
+	if (!encoder->threadRunning) {
+		ConditionDeinit(&encoder->queueDrained);
+		ConditionDeinit(&encoder->queueFilled);
+		MutexDeinit(&encoder->queueMutex);
+	}
+}
+
+static void _gifStopThread(struct GIFEncoder* encoder) {
+	if (encoder->threadRunning) {
+		MutexLock(&encoder->queueMutex);
+		encoder->threadDone = true;
+		ConditionWake(&encoder->queueFilled);
+		MutexUnlock(&encoder->queueMutex);
+		ThreadJoin(encoder->thread);
+		ConditionDeinit(&encoder->queueDrained);
+		ConditionDeinit(&encoder->queueFilled);
+		MutexDeinit(&encoder->queueMutex);
+		encoder->threadRunning = false;
+	}
+	size_t i;
+	for (i = 0; i < GIF_ENCODER_QUEUE_SLOTS; ++i) {
+		free(encoder->slots[i].pixels);
+		encoder->slots[i].pixels = NULL;
+		encoder->slots[i].capacity = 0;
+	}
+}
+#else
+static struct GIFEncoderFrame* _gifAcquireFrame(struct GIFEncoder* encoder) {
+	return &encoder->incoming;
+}
+
+static void _gifSubmitFrame(struct GIFEncoder* encoder) {
+	_gifProcessFrame(encoder, &encoder->incoming);
+}
+#endif
+
+static void _gifPostVideoFrame(struct mAVStream* stream, const color_t* pixels, size_t stride) {
+	struct GIFEncoder* encoder = (struct GIFEncoder*) stream;
+	if (!encoder->vf) {
+		return;
+	}
+	if (encoder->currentFrame % (encoder->frameskip + 1)) {
+		++encoder->currentFrame;
+		return;
+	}
+
+	uint64_t ticks;
+	if (encoder->delayMs >= 0) {
+		ticks = (uint64_t) encoder->capturedFrames * encoder->delayMs;
+	} else {
+		ticks = (uint64_t) encoder->currentFrame * VIDEO_TOTAL_LENGTH;
+	}
+	++encoder->currentFrame;
+	++encoder->capturedFrames;
+	encoder->lastTicks = ticks;
+
+	struct GIFEncoderFrame* frame = _gifAcquireFrame(encoder);
+	size_t size = encoder->iwidth * encoder->iheight;
+	if (frame->capacity < size) {
+		free(frame->pixels);
+		frame->pixels = malloc(size * sizeof(*frame->pixels));
+		frame->capacity = size;
+	}
+	frame->width = encoder->iwidth;
+	frame->height = encoder->iheight;
+	frame->ticks = ticks;
+	unsigned y;
+	for (y = 0; y < frame->height; ++y) {
+		const color_t* row = &pixels[stride * y];
+		uint16_t* out = &frame->pixels[frame->width * y];
+		unsigned x;
+		for (x = 0; x < frame->width; ++x) {
+			out[x] = _gifColor(row[x]);
+		}
+	}
+	_gifSubmitFrame(encoder);
+}
+
+static void _gifVideoDimensionsChanged(struct mAVStream* stream, unsigned width, unsigned height) {
+	struct GIFEncoder* encoder = (struct GIFEncoder*) stream;
+	// The image keeps the size it was opened with; frames of another size are clipped or padded to it
+	encoder->iwidth = width;
+	encoder->iheight = height;
+}
@@ -0,0 +1,105 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GIF_ENCODER
+#define GIF_ENCODER
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/interface.h>
+#include <mgba-util/png-io.h>
+#ifndef DISABLE_THREADING
+#include <mgba-util/threading.h>
+#endif
+
+#define GIF_ENCODER_QUEUE_SLOTS 4
+
+enum GIFEncoderFormat {
+	GIF_ENCODER_FORMAT_GIF,
+	GIF_ENCODER_FORMAT_APNG
+};
+
+// A captured frame, converted to 15-bit BGR
+struct GIFEncoderFrame {
+	uint16_t* pixels;
+	size_t capacity;
+	unsigned width;
+	unsigned height;
+	uint64_t ticks;
+};
+
+struct GIFEncoder {
+	struct mAVStream d;
+	struct VFile* vf;
+	enum GIFEncoderFormat format;
+	bool failed;
+
+	unsigned currentFrame;
+	unsigned capturedFrames;
+	int frameskip;
+	int delayMs;
+	uint64_t lastTicks;
+
+	unsigned iwidth;
+	unsigned iheight;
+	// The size of the image, fixed when the file is opened
+	unsigned width;
+	unsigned height;
+
+	// The source pixels behind every frame written so far, used to find what changed
+	uint16_t* canvas;
+	// The newest distinct frame, held back until its duration is known
+	struct GIFEncoderFrame pending;
+	bool hasPending;
+	unsigned writtenFrames;
+
+	uint8_t* indices;
+	uint32_t* colorCounts;
+	uint8_t* colorLookup;
+	uint16_t* colors;
+	uint16_t* sortedColors;
+	uint32_t* lzwKeys;
+	uint16_t* lzwCodes;
+	uint8_t* output;
+	size_t outputSize;
+	size_t outputCapacity;
+
+#ifdef USE_PNG
+	png_structp png;
+	png_infop info;
+	int32_t actlOffset;
+	uint32_t sequence;
+#endif
+
+#ifndef DISABLE_THREADING
+	struct GIFEncoderFrame slots[GIF_ENCODER_QUEUE_SLOTS];
+	// Both indices run modulo twice the slot count, so a full queue can be told apart from an empty one
+	int32_t queueRead;
+	int32_t queueWrite;
+	bool threadRunning;
+	bool threadDone;
+	Thread thread;
+	Mutex queueMutex;
+	Condition queueFilled;
+	Condition queueDrained;
+#else
+	struct GIFEncoderFrame incoming;
+#endif
+};
+
+void GIFEncoderInit(struct GIFEncoder*);
+// delayMs is the length of each recorded frame, or -1 to follow the emulated frame rate
+void GIFEncoderSetParams(struct GIFEncoder* encoder, int frameskip, int delayMs);
+// Returns false if the format isn't supported in this build; APNG needs libpng
+bool GIFEncoderSetFormat(struct GIFEncoder* encoder, enum GIFEncoderFormat format);
+bool GIFEncoderOpen(struct GIFEncoder*, const char* outfile);
+bool GIFEncoderClose(struct GIFEncoder*);
+bool GIFEncoderIsOpen(struct GIFEncoder*);
+
+CXX_GUARD_END
+
+#endif
@@ -102,40 +102,140 @@ static void _drawBackground(struct GUIBackground* background, void* context) {
 	}
 }
 
+struct mGUIThumbnailJob {
+	struct mAsyncWriterJob d;
+	struct mGUIThumbnail* thumbnail;
+	struct VDir* dir;
+	char name[PATH_MAX + 14];
+};
+
+static void _loadThumbnailJob(struct mAsyncWriterJob* writerJob) {
+	struct mGUIThumbnailJob* job = (struct mGUIThumbnailJob*) writerJob;
+	struct mGUIThumbnail* thumbnail = job->thumbnail;
+	struct VFile* vf = job->dir->openFile(job->dir, job->name, O_RDONLY);
+	bool success = false;
+	if (vf && isPNG(vf)) {
+		png_structp png = PNGReadOpen(vf, PNG_HEADER_BYTES);
+		png_infop info = png_create_info_struct(png);
+		png_infop end = png_create_info_struct(png);
+		if (png && info && end) {
+			success = PNGReadHeader(png, info);
+			success = success && PNGReadPixels(png, info, thumbnail->pixels, thumbnail->width, thumbnail->height, thumbnail->width);
+			success = success && PNGReadFooter(png, end);
+		}
+		PNGReadClose(png, info, end);
+	}
+	if (vf) {
+		vf->close(vf);
+	}
+	ATOMIC_STORE(thumbnail->status, success ? mGUI_THUMBNAIL_LOADED : mGUI_THUMBNAIL_FAILED);
+	free(job);
+}
+
+static struct mGUIThumbnail* _findThumbnail(struct mGUIBackground* background, int slot) {
+	size_t i;
+	for (i = 0; i < mGUI_THUMBNAIL_CACHE_SIZE; ++i) {
+		if (background->thumbnails[i].slot == slot) {
+			return &background->thumbnails[i];
+		}
+	}
+	return NULL;
+}
+
+static void _requestThumbnail(struct mGUIBackground* background, int slot, unsigned width, unsigned height) {
+	struct mCore* core = background->p->core;
+	struct mGUIThumbnail* thumbnail = NULL;
+	size_t i;
+	// Entries are recycled in turn, skipping any the writer is still decoding into
+	for (i = 0; i < mGUI_THUMBNAIL_CACHE_SIZE && !thumbnail; ++i) {
+		struct mGUIThumbnail* candidate = &background->thumbnails[background->nextThumbnail];
+		background->nextThumbnail = (background->nextThumbnail + 1) % mGUI_THUMBNAIL_CACHE_SIZE;
+		int status;
+		ATOMIC_LOAD(status, candidate->status);
+		if (status != mGUI_THUMBNAIL_LOADING) {
+			thumbnail = candidate;
+		}
+	}
+	if (!thumbnail) {
+		return;
+	}
+	size_t size = width * height * 4;
+	if (thumbnail->pixels && thumbnail->size != size) {
+		mappedMemoryFree(thumbnail->pixels, thumbnail->size);
+		thumbnail->pixels = NULL;
+	}
+	if (!thumbnail->pixels) {
+		thumbnail->pixels = anonymousMemoryMap(size);
+		thumbnail->size = size;
+	}
+	thumbnail->slot = slot;
+	thumbnail->width = width;
+	thumbnail->height = height;
+	struct mGUIThumbnailJob* job = malloc(sizeof(*job));
+	if (!thumbnail->pixels || !job) {
+		free(job);
+		thumbnail->status = mGUI_THUMBNAIL_FAILED;
+		return;
+	}
+	job->d.run = _loadThumbnailJob;
+	job->thumbnail = thumbnail;
+	job->dir = core->dirs.state;
+	// mCoreGetState flushes the writer, so it can't be called from a job running on it
+	snprintf(job->name, sizeof(job->name), "%s.ss%i", core->dirs.baseName, slot);
+	thumbnail->status = mGUI_THUMBNAIL_LOADING;
+	mAsyncWriterSubmit(&background->p->writer, &job->d);
+}
+
+static void _invalidateThumbnail(struct mGUIBackground* background, int slot) {
+	struct mGUIThumbnail* thumbnail = _findThumbnail(background, slot);
+	if (!thumbnail) {
+		return;
+	}
+	int status;
+	ATOMIC_LOAD(status, thumbnail->status);
+	if (status == mGUI_THUMBNAIL_LOADING) {
+		mAsyncWriterFlush(&background->p->writer);
+	}
+	thumbnail->slot = -1;
+	thumbnail->status = mGUI_THUMBNAIL_EMPTY;
+}
+
+static void _freeThumbnails(struct mGUIBackground* background) {
+	mAsyncWriterFlush(&background->p->writer);
+	size_t i;
+	for (i = 0; i < mGUI_THUMBNAIL_CACHE_SIZE; ++i) {
+		struct mGUIThumbnail* thumbnail = &background->thumbnails[i];
+		if (thumbnail->pixels) {
+			mappedMemoryFree(thumbnail->pixels, thumbnail->size);
+			thumbnail->pixels = NULL;
+		}
+		thumbnail->slot = -1;
+		thumbnail->status = mGUI_THUMBNAIL_EMPTY;
+	}
+}
+
 static void _drawState(struct GUIBackground* background, void* id) {
 	struct mGUIBackground* gbaBackground = (struct mGUIBackground*) background;
 	int stateId = ((int) id) >> 16;
 	if (gbaBackground->p->drawScreenshot) {
 		unsigned w, h;
 		gbaBackground->p->core->desiredVideoDimensions(gbaBackground->p->core, &w, &h);
-		if (gbaBackground->screenshot && gbaBackground->screenshotId == (int) id) {
-			gbaBackground->p->drawScreenshot(gbaBackground->p, gbaBackground->screenshot, w, h, true);
-			return;
+		struct mGUIThumbnail* thumbnail = _findThumbnail(gbaBackground, stateId);
+		if (thumbnail && (thumbnail->width != w || thumbnail->height != h)) {
+			_invalidateThumbnail(gbaBackground, stateId);
+			thumbnail = NULL;
 		}
-		struct VFile* vf = mCoreGetState(gbaBackground->p->core, stateId, false);
-		color_t* pixels = gbaBackground->screenshot;
-		if (!pixels) {
-			pixels = anonymousMemoryMap(w * h * 4);
-			gbaBackground->screenshot = pixels;
-		}
-		bool success = false;
-		if (vf && isPNG(vf) && pixels) {
-			png_structp png = PNGReadOpen(vf, PNG_HEADER_BYTES);
-			png_infop info = png_create_info_struct(png);
-			png_infop end = png_create_info_struct(png);
-			if (png && info && end) {
-				success = PNGReadHeader(png, info);
-				success = success && PNGReadPixels(png, info, pixels, w, h, w);
-				success = success && PNGReadFooter(png, end);
-			}
-			PNGReadClose(png, info, end);
+		if (!thumbnail) {
+			// The menu redraws every frame, so the thumbnail shows up once the writer has decoded it
+			_requestThumbnail(gbaBackground, stateId, w, h);
+			thumbnail = _findThumbnail(gbaBackground, stateId);
 		}
-		if (vf) {
-			vf->close(vf);
+		int status = mGUI_THUMBNAIL_FAILED;
+		if (thumbnail) {
+			ATOMIC_LOAD(status, thumbnail->status);
 		}
-		if (success) {
-			gbaBackground->p->drawScreenshot(gbaBackground->p, pixels, w, h, true);
-			gbaBackground->screenshotId = (int) id;
+		if (status == mGUI_THUMBNAIL_LOADED) {
+			gbaBackground->p->drawScreenshot(gbaBackground->p, thumbnail->pixels, w, h, true);
 		} else if (gbaBackground->p->drawFrame) {
 			gbaBackground->p->drawFrame(gbaBackground->p, true);
 		}
@@ -189,6 +289,7 @@ void mGUIInit(struct mGUIRunner* runner, const char* port) {
 	runner->lastFpsCheck = 0;
 	runner->totalDelta = 0;
 	CircleBufferInit(&runner->fpsBuffer, FPS_BUFFER_SIZE * sizeof(uint32_t));
+	mAsyncWriterInit(&runner->writer);
 
 	mInputMapInit(&runner->params.keyMap, &_mGUIKeyInfo);
 	mCoreConfigInit(&runner->config, runner->port);
@@ -246,6 +347,7 @@ void mGUIDeinit(struct mGUIRunner* runner) {
 	if (runner->teardown) {
 		runner->teardown(runner);
 	}
+	mAsyncWriterDeinit(&runner->writer);
 	CircleBufferDeinit(&runner->fpsBuffer);
 	mInputMapDeinit(&runner->params.keyMap);
 	mCoreConfigDeinit(&runner->config);
@@ -289,10 +391,12 @@ void mGUIRun(struct mGUIRunner* runner, const char* path) {
 		.d = {
 			.draw = _drawState
 		},
-		.p = runner,
-		.screenshot = 0,
-		.screenshotId = 0
+		.p = runner
 	};
+	size_t i;
+	for (i = 0; i < mGUI_THUMBNAIL_CACHE_SIZE; ++i) {
+		drawState.thumbnails[i].slot = -1;
+	}
 	struct GUIMenu pauseMenu = {
 		.title = "Game Paused",
 		.index = 0,
@@ -377,6 +481,7 @@ void mGUIRun(struct mGUIRunner* runner, const char* path) {
 	}
 	mLOG(GUI_RUNNER, DEBUG, "Loading config...");
 	mCoreLoadForeignConfig(runner->core, &runner->config);
+	runner->core->asyncWriter = &runner->writer;
 
 	mLOG(GUI_RUNNER, DEBUG, "Loading save...");
 	mCoreAutoloadSave(runner->core);
@@ -511,6 +616,7 @@ void mGUIRun(struct mGUIRunner* runner, const char* path) {
 				if (frame == AUTOSAVE_GRANULARITY) {
 					frame = 0;
 					_tryAutosave(runner);
+					_invalidateThumbnail(&drawState, 0);
 				}
 				++frame;
 			}
@@ -537,6 +643,7 @@ void mGUIRun(struct mGUIRunner* runner, const char* path) {
 				runner->core->reset(runner->core);
 				break;
 			case RUNNER_SAVE_STATE:
+				_invalidateThumbnail(&drawState, ((int) item->data) >> 16);
 				mCoreSaveState(runner->core, ((int) item->data) >> 16, SAVESTATE_SCREENSHOT | SAVESTATE_SAVEDATA | SAVESTATE_RTC | SAVESTATE_METADATA);
 				break;
 			case RUNNER_LOAD_STATE:
@@ -587,12 +694,8 @@ void mGUIRun(struct mGUIRunner* runner, const char* path) {
 
 	mLOG(GUI_RUNNER, DEBUG, "Unloading game...");
 	runner->core->unloadROM(runner->core);
-	drawState.screenshotId = 0;
-	if (drawState.screenshot) {
-		unsigned w, h;
-		runner->core->desiredVideoDimensions(runner->core, &w, &h);
-		mappedMemoryFree(drawState.screenshot, w * h * 4);
-	}
+	_freeThumbnails(&drawState);
+	runner->core->asyncWriter = NULL;
 
 	if (runner->config.port) {
 		mLOG(GUI_RUNNER, DEBUG, "Saving key sources...");
@@ -10,6 +10,7 @@
 
 CXX_GUARD_START
 
+#include <mgba/core/async-writer.h>
 #include <mgba/core/config.h>
 #include "feature/gui/remap.h"
 #include <mgba/internal/gba/hardware.h>
@@ -26,12 +27,31 @@ enum mGUIInput {
 	mGUI_INPUT_FAST_FORWARD_TOGGLE
 };
 
+#define mGUI_THUMBNAIL_CACHE_SIZE 4
+
+enum mGUIThumbnailStatus {
+	mGUI_THUMBNAIL_EMPTY = 0,
+	mGUI_THUMBNAIL_LOADING,
+	mGUI_THUMBNAIL_LOADED,
+	mGUI_THUMBNAIL_FAILED
+};
+
+struct mGUIThumbnail {
+	color_t* pixels;
+	size_t size;
+	unsigned width;
+	unsigned height;
+	int slot;
+	// Written by the runner's writer thread while LOADING, so read it atomically
+	int status;
+};
+
 struct mGUIBackground {
 	struct GUIBackground d;
 	struct mGUIRunner* p;
 
-	color_t* screenshot;
-	int screenshotId;
+	struct mGUIThumbnail thumbnails[mGUI_THUMBNAIL_CACHE_SIZE];
+	unsigned nextThumbnail;
 };
 
 struct mCore;
@@ -61,6 +81,8 @@ struct mGUIRunner {
 #ifndef DISABLE_THREADING
 	struct mGUIAutosaveContext autosave;
 #endif
+	// Encodes manual savestates and decodes their thumbnails off the GUI thread
+	struct mAsyncWriter writer;
 
 	struct mInputMap guiKeys;
 	struct mCoreConfig config;
@@ -0,0 +1,274 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/feature/shared-memory.h>
+
+#include <mgba/core/core.h>
+#include <mgba-util/vfs.h>
+
+#define MIN_VIDEO_WIDTH 256
+#define MIN_VIDEO_HEIGHT 224
+#define ALIGNMENT 64
+
+static void _videoDimensionsChanged(struct mAVStream* stream, unsigned width, unsigned height);
+static void _postAudioFrame(struct mAVStream* stream, int16_t left, int16_t right);
+
+static uint32_t _align(uint32_t offset) {
+	return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+bool mSharedMemoryInit(struct mSharedMemory* shm, struct mCore* core, const char* path) {
+	memset(shm, 0, sizeof(*shm));
+	shm->core = core;
+	shm->d.videoDimensionsChanged = _videoDimensionsChanged;
+	shm->d.postAudioFrame = _postAudioFrame;
+
+	// Lay out the mapping before creating it, since its size has to be known up front
+	struct mSharedMemoryHeader layout;
+	memset(&layout, 0, sizeof(layout));
+	layout.magic = mSHARED_MEMORY_MAGIC;
+	layout.version = mSHARED_MEMORY_VERSION;
+	layout.platform = core->platform(core);
+	layout.runState = mSHARED_MEMORY_RUNNING;
+
+	unsigned width, height;
+	core->desiredVideoDimensions(core, &width, &height);
+	// Leave room for the largest size the core may switch to, such as SGB borders
+	unsigned stride = width > MIN_VIDEO_WIDTH ? width : MIN_VIDEO_WIDTH;
+	unsigned rows = height > MIN_VIDEO_HEIGHT ? height : MIN_VIDEO_HEIGHT;
+	uint32_t offset = _align(sizeof(layout));
+	layout.videoOffset = offset;
+	layout.videoWidth = width;
+	layout.videoHeight = height;
+	layout.videoStride = stride;
+	offset = _align(offset + stride * rows * BYTES_PER_PIXEL);
+
+	layout.audioOffset = offset;
+	layout.audioCapacity = mSHARED_MEMORY_AUDIO_FRAMES;
+	offset = _align(offset + mSHARED_MEMORY_AUDIO_FRAMES * 2 * sizeof(int16_t));
+
+	layout.stateOffset = offset;
+	layout.stateCapacity = core->stateSize(core);
+	offset = _align(offset + layout.stateCapacity);
+
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
+	size_t i;
+	for (i = 0; i < nBlocks && layout.nBlocks < mSHARED_MEMORY_MAX_BLOCKS; ++i) {
+		if ((blocks[i].flags & mCORE_MEMORY_VIRTUAL) || !(blocks[i].flags & mCORE_MEMORY_WRITE)) {
+			continue;
+		}
+		size_t size = 0;
+		if (!core->getMemoryBlock(core, blocks[i].id, &size) || !size) {
+			continue;
+		}
+		struct mSharedMemoryBlock* block = &layout.blocks[layout.nBlocks];
+		strncpy(block->name, blocks[i].internalName, sizeof(block->name) - 1);
+		block->start = blocks[i].start;
+		block->size = size;
+		block->offset = offset;
+		offset = _align(offset + size);
+		shm->blockIds[layout.nBlocks] = blocks[i].id;
+		if (core->trackMemoryBlockDirty) {
+			shm->blockTracked[layout.nBlocks] = core->trackMemoryBlockDirty(core, blocks[i].id, true);
+		}
+		++layout.nBlocks;
+	}
+	layout.size = offset;
+
+	shm->vf = VFileOpen(path, O_CREAT | O_TRUNC | O_RDWR);
+	if (!shm->vf) {
+		return false;
+	}
+	shm->vf->truncate(shm->vf, layout.size);
+	shm->memory = shm->vf->map(shm->vf, layout.size, MAP_WRITE);
+	if (!shm->memory) {
+		shm->vf->close(shm->vf);
+		shm->vf = NULL;
+		return false;
+	}
+	shm->size = layout.size;
+	shm->header = (struct mSharedMemoryHeader*) shm->memory;
+	memset(shm->memory, 0, shm->size);
+	memcpy(shm->header, &layout, sizeof(layout));
+
+	core->setVideoBuffer(core, (color_t*) &shm->memory[layout.videoOffset], stride);
+	core->setAVStream(core, &shm->d);
+	return true;
+}
+
+void mSharedMemoryDeinit(struct mSharedMemory* shm) {
+	struct mCore* core = shm->core;
+	if (!shm->vf) {
+		return;
+	}
+	core->setAVStream(core, NULL);
+	core->setVideoBuffer(core, NULL, 0);
+	size_t i;
+	for (i = 0; i < shm->header->nBlocks; ++i) {
+		if (shm->blockTracked[i]) {
+			core->trackMemoryBlockDirty(core, shm->blockIds[i], false);
+		}
+	}
+	shm->vf->unmap(shm->vf, shm->memory, shm->size);
+	shm->vf->close(shm->vf);
+	shm->vf = NULL;
+	shm->memory = NULL;
+	shm->header = NULL;
+}
+
+static void _publishBlocks(struct mSharedMemory* shm) {
+	struct mSharedMemoryHeader* header = shm->header;
+	struct mCore* core = shm->core;
+	size_t i;
+	for (i = 0; i < header->nBlocks; ++i) {
+		struct mSharedMemoryBlock* block = &header->blocks[i];
+		size_t size = 0;
+		const uint8_t* data = core->getMemoryBlock(core, shm->blockIds[i], &size);
+		if (!data) {
+			continue;
+		}
+		if (size > block->size) {
+			size = block->size;
+		}
+		uint8_t* mirror = &shm->memory[block->offset];
+		const uint32_t* dirty = NULL;
+		size_t dirtyPages = 0;
+		if (shm->blockTracked[i] && shm->blocksValid) {
+			dirty = core->getMemoryBlockDirty(core, shm->blockIds[i], &dirtyPages);
+		}
+		if (!dirty) {
+			memcpy(mirror, data, size);
+		} else {
+			size_t page;
+			for (page = 0; page < dirtyPages; ++page) {
+				if (!dirty[page >> 5]) {
+					// Skip the rest of a clean word
+					page |= 0x1F;
+					continue;
+				}
+				if (!(dirty[page >> 5] & (1U << (page & 0x1F)))) {
+					continue;
+				}
+				size_t offset = page << mCORE_MEMORY_DIRTY_PAGE_SHIFT;
+				if (offset >= size) {
+					break;
+				}
+				size_t length = size - offset;
+				if (length > mCORE_MEMORY_DIRTY_PAGE_SIZE) {
+					length = mCORE_MEMORY_DIRTY_PAGE_SIZE;
+				}
+				memcpy(&mirror[offset], &data[offset], length);
+			}
+		}
+		if (shm->blockTracked[i]) {
+			core->clearMemoryBlockDirty(core, shm->blockIds[i]);
+		}
+	}
+	shm->blocksValid = true;
+}
+
+static int32_t _runCommand(struct mSharedMemory* shm, uint32_t command, uint32_t argument) {
+	struct mSharedMemoryHeader* header = shm->header;
+	struct mCore* core = shm->core;
+	switch (command) {
+	case mSHARED_MEMORY_COMMAND_RUN:
+		header->stepsRemaining = 0;
+		header->runState = mSHARED_MEMORY_RUNNING;
+		return 0;
+	case mSHARED_MEMORY_COMMAND_PAUSE:
+		header->stepsRemaining = 0;
+		header->runState = mSHARED_MEMORY_PAUSED;
+		return 0;
+	case mSHARED_MEMORY_COMMAND_STEP:
+		header->stepsRemaining = argument ? argument : 1;
+		header->runState = mSHARED_MEMORY_PAUSED;
+		return 0;
+	case mSHARED_MEMORY_COMMAND_RESET:
+		core->reset(core);
+		shm->blocksValid = false;
+		return 0;
+	case mSHARED_MEMORY_COMMAND_SAVE_STATE:
+		return core->saveState(core, &shm->memory[header->stateOffset]) ? 0 : -1;
+	case mSHARED_MEMORY_COMMAND_LOAD_STATE:
+		if (!core->loadState(core, &shm->memory[header->stateOffset])) {
+			return -1;
+		}
+		shm->blocksValid = false;
+		return 0;
+	case mSHARED_MEMORY_COMMAND_QUIT:
+		header->runState = mSHARED_MEMORY_QUITTING;
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+bool mSharedMemoryPoll(struct mSharedMemory* shm) {
+	struct mSharedMemoryHeader* header = shm->header;
+	uint32_t sequence;
+	ATOMIC_LOAD(sequence, header->commandSequence);
+	if (sequence != header->resultSequence) {
+		// Loading a state or resetting changes what the mirrors should show,
+		// so this is published like a frame is
+		ATOMIC_STORE(header->frameSequence, header->frameSequence + 1);
+		header->result = _runCommand(shm, header->command, header->argument);
+		_publishBlocks(shm);
+		ATOMIC_STORE(header->frameSequence, header->frameSequence + 1);
+		ATOMIC_STORE(header->resultSequence, sequence);
+	}
+	switch (header->runState) {
+	case mSHARED_MEMORY_RUNNING:
+		return true;
+	case mSHARED_MEMORY_PAUSED:
+		if (header->stepsRemaining) {
+			--header->stepsRemaining;
+			return true;
+		}
+		return false;
+	default:
+		return false;
+	}
+}
+
+bool mSharedMemoryIsQuitting(const struct mSharedMemory* shm) {
+	return shm->header->runState == mSHARED_MEMORY_QUITTING;
+}
+
+void mSharedMemoryFrameStarted(struct mSharedMemory* shm) {
+	struct mSharedMemoryHeader* header = shm->header;
+	ATOMIC_STORE(header->frameSequence, header->frameSequence + 1);
+	uint32_t keys;
+	ATOMIC_LOAD(keys, header->keys);
+	shm->core->setKeys(shm->core, keys);
+}
+
+void mSharedMemoryFrameEnded(struct mSharedMemory* shm) {
+	struct mSharedMemoryHeader* header = shm->header;
+	_publishBlocks(shm);
+	++header->frameCounter;
+	ATOMIC_STORE(header->frameSequence, header->frameSequence + 1);
+}
+
+static void _videoDimensionsChanged(struct mAVStream* stream, unsigned width, unsigned height) {
+	struct mSharedMemory* shm = (struct mSharedMemory*) stream;
+	struct mSharedMemoryHeader* header = shm->header;
+	unsigned rows = (header->audioOffset - header->videoOffset) / (header->videoStride * BYTES_PER_PIXEL);
+	if (width > header->videoStride || height > rows) {
+		return;
+	}
+	header->videoWidth = width;
+	header->videoHeight = height;
+}
+
+static void _postAudioFrame(struct mAVStream* stream, int16_t left, int16_t right) {
+	struct mSharedMemory* shm = (struct mSharedMemory*) stream;
+	struct mSharedMemoryHeader* header = shm->header;
+	int16_t* audio = (int16_t*) &shm->memory[header->audioOffset];
+	uint32_t index = header->audioWrite % header->audioCapacity;
+	audio[index * 2] = left;
+	audio[index * 2 + 1] = right;
+	ATOMIC_STORE(header->audioWrite, header->audioWrite + 1);
+}
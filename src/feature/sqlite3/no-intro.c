@@ -47,7 +47,10 @@ struct NoIntroDB* NoIntroDBLoad(const char* path) {
 			"flags INTEGER DEFAULT 0,"
 			"gid INTEGER NOT NULL REFERENCES games(gid) ON DELETE CASCADE"
 		");\n"
-		"CREATE INDEX IF NOT EXISTS crc32 ON roms (crc32);";
+		"CREATE INDEX IF NOT EXISTS crc32 ON roms (crc32);\n"
+		// Replacing an older DAT cascades through these, which would otherwise scan both tables once per row
+		"CREATE INDEX IF NOT EXISTS gamesDbid ON games (dbid);\n"
+		"CREATE INDEX IF NOT EXISTS romsGid ON roms (gid);";
 	if (sqlite3_exec(db->db, createTables, NULL, NULL, NULL)) {
 		goto error;
 	}
@@ -102,7 +105,8 @@ bool NoIntroDBLoadClrMamePro(struct NoIntroDB* db, struct VFile* vf) {
 		return false;
 	}
 
-	size_t remainingInTransaction = 0;
+	// Committing as it goes would sync the database over and over, so the whole file is imported at once
+	sqlite3_exec(db->db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
 
 	while (true) {
 		ssize_t bytesRead = vf->readline(vf, line, sizeof(line));
@@ -130,13 +134,6 @@ bool NoIntroDBLoadClrMamePro(struct NoIntroDB* db, struct VFile* vf) {
 				if (!fieldName) {
 					break;
 				}
-				if (!remainingInTransaction) {
-					remainingInTransaction = 16;
-					sqlite3_exec(db->db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
-				} else {
-					--remainingInTransaction;
-				}
-
 				if (strcmp(fieldName, "clrmamepro") == 0) {
 					free((void*) dbType);
 					free((void*) dbVersion);
@@ -194,9 +191,6 @@ bool NoIntroDBLoadClrMamePro(struct NoIntroDB* db, struct VFile* vf) {
 					free((void*) buffer.romName);
 					buffer.romName = NULL;
 				}
-				if (!remainingInTransaction) {
-					sqlite3_exec(db->db, "COMMIT;", NULL, NULL, NULL);
-				}
 				break;
 			case '"':
 				++token;
@@ -268,9 +262,7 @@ bool NoIntroDBLoadClrMamePro(struct NoIntroDB* db, struct VFile* vf) {
 	sqlite3_finalize(gameTable);
 	sqlite3_finalize(romTable);
 
-	if (remainingInTransaction) {
-		sqlite3_exec(db->db, "COMMIT;", NULL, NULL, NULL);
-	}
+	sqlite3_exec(db->db, "COMMIT;", NULL, NULL, NULL);
 	sqlite3_exec(db->db, "VACUUM", NULL, NULL, NULL);
 
 	return true;
@@ -282,10 +274,7 @@ void NoIntroDBDestroy(struct NoIntroDB* db) {
 	free(db);
 }
 
-bool NoIntroDBLookupGameByCRC(const struct NoIntroDB* db, uint32_t crc32, struct NoIntroGame* game) {
-	if (!db) {
-		return false;
-	}
+static bool _lookupGameByCRC(const struct NoIntroDB* db, uint32_t crc32, struct NoIntroGame* game) {
 	sqlite3_clear_bindings(db->crc32);
 	sqlite3_reset(db->crc32);
 	sqlite3_bind_int(db->crc32, 1, crc32);
@@ -300,3 +289,31 @@ bool NoIntroDBLookupGameByCRC(const struct NoIntroDB* db, uint32_t crc32, struct
 	game->verified = sqlite3_column_int(db->crc32, 8);
 	return true;
 }
+
+bool NoIntroDBLookupGameByCRC(const struct NoIntroDB* db, uint32_t crc32, struct NoIntroGame* game) {
+	if (!db) {
+		return false;
+	}
+	return _lookupGameByCRC(db, crc32, game);
+}
+
+size_t NoIntroDBLookupGamesByCRC(const struct NoIntroDB* db, const uint32_t* crc32s, size_t count, void (*found)(void* context, size_t index, const struct NoIntroGame*), void* context) {
+	if (!db) {
+		return 0;
+	}
+	// Holding one read transaction saves locking the database again for every lookup
+	sqlite3_exec(db->db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+	size_t matches = 0;
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		struct NoIntroGame game;
+		if (!crc32s[i] || !_lookupGameByCRC(db, crc32s[i], &game)) {
+			continue;
+		}
+		found(context, i, &game);
+		++matches;
+	}
+	sqlite3_reset(db->crc32);
+	sqlite3_exec(db->db, "COMMIT;", NULL, NULL, NULL);
+	return matches;
+}
@@ -27,6 +27,9 @@ struct NoIntroDB* NoIntroDBLoad(const char* path);
 bool NoIntroDBLoadClrMamePro(struct NoIntroDB* db, struct VFile* vf);
 void NoIntroDBDestroy(struct NoIntroDB* db);
 bool NoIntroDBLookupGameByCRC(const struct NoIntroDB* db, uint32_t crc32, struct NoIntroGame* game);
+// Calls `found` for each CRC that matches, with the index it had in `crc32s`. The game is only valid
+// for the duration of the call.
+size_t NoIntroDBLookupGamesByCRC(const struct NoIntroDB* db, const uint32_t* crc32s, size_t count, void (*found)(void* context, size_t index, const struct NoIntroGame*), void* context);
 
 CXX_GUARD_END
 
@@ -5,7 +5,9 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/feature/thread-proxy.h>
 
+#include <mgba/core/metrics.h>
 #include <mgba/core/tile-cache.h>
+#include <mgba/core/trace.h>
 #include <mgba/internal/gba/gba.h>
 
 #ifndef DISABLE_THREADING
@@ -24,10 +26,13 @@ static void _lock(struct mVideoLogger* logger);
 static void _unlock(struct mVideoLogger* logger);
 static void _wait(struct mVideoLogger* logger);
 static void _wake(struct mVideoLogger* logger, int y);
+static size_t _queueDepth(struct mVideoLogger* logger);
 
 void mVideoThreadProxyCreate(struct mVideoThreadProxy* renderer) {
 	mVideoLoggerRendererCreate(&renderer->d, false);
 	renderer->d.block = true;
+	renderer->affinity = 0;
+	renderer->highPriority = false;
 
 	renderer->d.init = mVideoThreadProxyInit;
 	renderer->d.reset = mVideoThreadProxyReset;
@@ -40,6 +45,7 @@ void mVideoThreadProxyCreate(struct mVideoThreadProxy* renderer) {
 	renderer->d.writeData = _writeData;
 	renderer->d.readData = _readData;
 	renderer->d.postEvent = _postEvent;
+	renderer->d.queueDepth = _queueDepth;
 }
 
 void mVideoThreadProxyInit(struct mVideoLogger* logger) {
@@ -103,6 +109,7 @@ static bool _writeData(struct mVideoLogger* logger, const void* data, size_t len
 	struct mVideoThreadProxy* proxyRenderer = (struct mVideoThreadProxy*) logger;
 	while (!RingFIFOWrite(&proxyRenderer->dirtyQueue, data, length)) {
 		mLOG(GBA_VIDEO, DEBUG, "Can't write %"PRIz"u bytes. Proxy thread asleep?", length);
+		uint64_t start = mCoreMetricsTime();
 		MutexLock(&proxyRenderer->mutex);
 		if (proxyRenderer->threadState == PROXY_THREAD_STOPPED) {
 			mLOG(GBA_VIDEO, ERROR, "Proxy thread stopped prematurely!");
@@ -112,6 +119,7 @@ static bool _writeData(struct mVideoLogger* logger, const void* data, size_t len
 		ConditionWake(&proxyRenderer->toThreadCond);
 		ConditionWait(&proxyRenderer->fromThreadCond, &proxyRenderer->mutex);
 		MutexUnlock(&proxyRenderer->mutex);
+		logger->blockedTime += mCoreMetricsTime() - start;
 	}
 	return true;
 }
@@ -154,13 +162,22 @@ static void _wait(struct mVideoLogger* logger) {
 		return;
 	}
 	MutexLock(&proxyRenderer->mutex);
-	while (RingFIFOSize(&proxyRenderer->dirtyQueue)) {
-		ConditionWake(&proxyRenderer->toThreadCond);
-		ConditionWait(&proxyRenderer->fromThreadCond, &proxyRenderer->mutex);
+	if (RingFIFOSize(&proxyRenderer->dirtyQueue)) {
+		uint64_t start = mCoreMetricsTime();
+		do {
+			ConditionWake(&proxyRenderer->toThreadCond);
+			ConditionWait(&proxyRenderer->fromThreadCond, &proxyRenderer->mutex);
+		} while (RingFIFOSize(&proxyRenderer->dirtyQueue));
+		logger->blockedTime += mCoreMetricsTime() - start;
 	}
 	MutexUnlock(&proxyRenderer->mutex);
 }
 
+static size_t _queueDepth(struct mVideoLogger* logger) {
+	struct mVideoThreadProxy* proxyRenderer = (struct mVideoThreadProxy*) logger;
+	return RingFIFOSize(&proxyRenderer->dirtyQueue);
+}
+
 static void _unlock(struct mVideoLogger* logger) {
 	struct mVideoThreadProxy* proxyRenderer = (struct mVideoThreadProxy*) logger;
 	MutexUnlock(&proxyRenderer->mutex);
@@ -168,7 +185,13 @@ static void _unlock(struct mVideoLogger* logger) {
 
 static void _wake(struct mVideoLogger* logger, int y) {
 	struct mVideoThreadProxy* proxyRenderer = (struct mVideoThreadProxy*) logger;
-	if ((y & 15) == 15) {
+	if ((y & 15) != 15) {
+		return;
+	}
+	// A busy thread drains the queue before sleeping again, so it only needs a nudge when idle
+	enum mVideoThreadProxyState threadState;
+	ATOMIC_LOAD(threadState, proxyRenderer->threadState);
+	if (threadState == PROXY_THREAD_IDLE) {
 		ConditionWake(&proxyRenderer->toThreadCond);
 	}
 }
@@ -176,29 +199,40 @@ static void _wake(struct mVideoLogger* logger, int y) {
 static THREAD_ENTRY _proxyThread(void* logger) {
 	struct mVideoThreadProxy* proxyRenderer = logger;
 	ThreadSetName("Proxy Renderer Thread");
+	mTRACE_THREAD("Proxy Renderer Thread");
+	if (proxyRenderer->affinity) {
+		ThreadSetAffinity(proxyRenderer->affinity);
+	}
+	if (proxyRenderer->highPriority) {
+		ThreadSetHighPriority();
+	}
 
 	MutexLock(&proxyRenderer->mutex);
 	while (proxyRenderer->threadState != PROXY_THREAD_STOPPED) {
-		ConditionWait(&proxyRenderer->toThreadCond, &proxyRenderer->mutex);
-		if (proxyRenderer->threadState == PROXY_THREAD_STOPPED) {
-			break;
+		if (!proxyRenderer->event && !RingFIFOSize(&proxyRenderer->dirtyQueue)) {
+			ConditionWait(&proxyRenderer->toThreadCond, &proxyRenderer->mutex);
+			if (proxyRenderer->threadState == PROXY_THREAD_STOPPED) {
+				break;
+			}
 		}
-		proxyRenderer->threadState = PROXY_THREAD_BUSY;
+		ATOMIC_STORE(proxyRenderer->threadState, PROXY_THREAD_BUSY);
 		if (proxyRenderer->event) {
 			proxyRenderer->d.handleEvent(&proxyRenderer->d, proxyRenderer->event);
 			proxyRenderer->event = 0;
 		} else {
 			MutexUnlock(&proxyRenderer->mutex);
+			mTRACE_BEGIN(trace);
 			if (!mVideoLoggerRendererRun(&proxyRenderer->d, false)) {
 				// FIFO was corrupted
 				proxyRenderer->threadState = PROXY_THREAD_STOPPED;
 				mLOG(GBA_VIDEO, ERROR, "Proxy thread queue got corrupted!");
 			}
+			mTRACE_END(trace, "rendererFlush");
 			MutexLock(&proxyRenderer->mutex);
 		}
 		ConditionWake(&proxyRenderer->fromThreadCond);
 		if (proxyRenderer->threadState != PROXY_THREAD_STOPPED) {
-			proxyRenderer->threadState = PROXY_THREAD_IDLE;
+			ATOMIC_STORE(proxyRenderer->threadState, PROXY_THREAD_IDLE);
 		}
 	}
 	MutexUnlock(&proxyRenderer->mutex);
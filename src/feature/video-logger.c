@@ -9,6 +9,8 @@
 #include <mgba-util/memory.h>
 #include <mgba-util/vfs.h>
 #include <mgba-util/math.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
 
 #ifdef M_CORE_GBA
 #include <mgba/gba/core.h>
@@ -23,20 +25,28 @@
 
 #define BUFFER_BASE_SIZE 0x20000
 #define MAX_BLOCK_SIZE 0x800000
+#define DEFAULT_KEYFRAME_INTERVAL 300
+#define DEFAULT_COMPRESSION_LEVEL 9
+#define FAST_COMPRESSION_LEVEL 1
+#define COMPRESS_THREADS 2
+#define COMPRESS_QUEUE_SIZE 8
+#define VRAM_BLOCK_SIZE 0x1000
+#define VRAM_BLOCK_WORDS (VRAM_BLOCK_SIZE / 4)
 
 const char mVL_MAGIC[] = "mVL\0";
 
 static const struct mVLDescriptor {
 	enum mPlatform platform;
 	struct mCore* (*open)(void);
+	bool (*seek)(struct mCore*, uint32_t frame);
 } _descriptors[] = {
 #ifdef M_CORE_GBA
-	{ PLATFORM_GBA, GBAVideoLogPlayerCreate },
+	{ PLATFORM_GBA, GBAVideoLogPlayerCreate, GBAVideoLogPlayerSeek },
 #endif
 #ifdef M_CORE_GB
-	{ PLATFORM_GB, GBVideoLogPlayerCreate },
+	{ PLATFORM_GB, GBVideoLogPlayerCreate, GBVideoLogPlayerSeek },
 #endif
-	{ PLATFORM_NONE, 0 }
+	{ PLATFORM_NONE, 0, 0 }
 };
 
 enum mVLBlockType {
@@ -44,6 +54,8 @@ enum mVLBlockType {
 	mVL_BLOCK_INITIAL_STATE,
 	mVL_BLOCK_CHANNEL_HEADER,
 	mVL_BLOCK_DATA,
+	mVL_BLOCK_KEYFRAME,
+	mVL_BLOCK_INDEX,
 	mVL_BLOCK_FOOTER = 0x784C566D
 };
 
@@ -69,6 +81,29 @@ struct mVideoLogHeader {
 	uint32_t nChannels;
 };
 
+// The index block sits right before the footer, and the footer's flags field holds its total size.
+// Each entry points at a keyframe block holding a savestate taken right after the given number of frames.
+struct mVLIndexEntry {
+	uint32_t frame;
+	uint32_t channelId;
+	uint64_t offset;
+};
+
+DECLARE_VECTOR(mVLIndex, struct mVLIndexEntry);
+DEFINE_VECTOR(mVLIndex, struct mVLIndexEntry);
+
+#ifdef USE_ZLIB
+struct mVLCompressJob {
+	uint32_t blockType;
+	uint32_t channelId;
+	void* data;
+	size_t size;
+	struct VFile* compressed;
+	ssize_t indexEntry;
+	bool done;
+};
+#endif
+
 struct mVideoLogContext;
 struct mVideoLogChannel {
 	struct mVideoLogContext* p;
@@ -79,6 +114,8 @@ struct mVideoLogChannel {
 
 	off_t currentPointer;
 	size_t bufferRemaining;
+	uint32_t frames;
+	uint32_t keyframe;
 #ifdef USE_ZLIB
 	bool inflating;
 	z_stream inflateStream;
@@ -96,6 +133,28 @@ struct mVideoLogContext {
 	bool write;
 	uint32_t activeChannel;
 	struct VFile* backing;
+
+	struct mCore* core;
+	uint32_t keyframeInterval;
+	struct mVLIndex index;
+
+	int compressionLevel;
+#ifdef USE_ZLIB
+	// Scratch buffers for compressed blocks, recycled instead of reallocated per block
+	struct VFileMemArena* arena;
+#endif
+#if defined(USE_ZLIB) && !defined(DISABLE_THREADING)
+	// Blocks are compressed by a pool of threads, and written by whichever one finds the oldest block done
+	bool compressing;
+	bool compressExit;
+	Thread compressThreads[COMPRESS_THREADS];
+	Mutex compressMutex;
+	Condition compressCond;
+	struct mVLCompressJob jobs[COMPRESS_QUEUE_SIZE];
+	unsigned jobHead;
+	unsigned jobNext;
+	unsigned jobTail;
+#endif
 };
 
 
@@ -105,6 +164,7 @@ static bool _readData(struct mVideoLogger* logger, void* data, size_t length, bo
 
 static ssize_t mVideoLoggerReadChannel(struct mVideoLogChannel* channel, void* data, size_t length);
 static ssize_t mVideoLoggerWriteChannel(struct mVideoLogChannel* channel, const void* data, size_t length);
+static void _writeKeyframe(struct mVideoLogChannel* channel);
 
 static inline size_t _roundUp(size_t value, int shift) {
 	value += (1 << shift) - 1;
@@ -129,6 +189,9 @@ void mVideoLoggerRendererCreate(struct mVideoLogger* logger, bool readonly) {
 	logger->unlock = NULL;
 	logger->wait = NULL;
 	logger->wake = NULL;
+
+	logger->queueDepth = NULL;
+	logger->blockedTime = 0;
 }
 
 void mVideoLoggerRendererInit(struct mVideoLogger* logger) {
@@ -138,6 +201,10 @@ void mVideoLoggerRendererInit(struct mVideoLogger* logger) {
 
 	logger->vramDirtyBitmap = calloc(_roundUp(logger->vramSize, 17), sizeof(uint32_t));
 	logger->oamDirtyBitmap = calloc(_roundUp(logger->oamSize, 6), sizeof(uint32_t));
+	logger->vramShadow = NULL;
+	if (logger->writeData != _writeNull) {
+		logger->vramShadow = anonymousMemoryMap(logger->vramSize);
+	}
 
 	if (logger->init) {
 		logger->init(logger);
@@ -155,11 +222,19 @@ void mVideoLoggerRendererDeinit(struct mVideoLogger* logger) {
 
 	free(logger->vramDirtyBitmap);
 	free(logger->oamDirtyBitmap);
+	if (logger->vramShadow) {
+		mappedMemoryFree(logger->vramShadow, logger->vramSize);
+		logger->vramShadow = NULL;
+	}
 }
 
 void mVideoLoggerRendererReset(struct mVideoLogger* logger) {
 	memset(logger->vramDirtyBitmap, 0, sizeof(uint32_t) * _roundUp(logger->vramSize, 17));
 	memset(logger->oamDirtyBitmap, 0, sizeof(uint32_t) * _roundUp(logger->oamSize, 6));
+	if (logger->vramShadow) {
+		// The reset copies VRAM over wholesale, which is what the other end starts from
+		memcpy(logger->vramShadow, logger->vram, logger->vramSize);
+	}
 
 	if (logger->reset) {
 		logger->reset(logger);
@@ -204,6 +279,64 @@ void mVideoLoggerRendererWriteOAM(struct mVideoLogger* logger, uint32_t address,
 	logger->writeData(logger, &dirty, sizeof(dirty));
 }
 
+static void _writeVRAMBlock(struct mVideoLogger* logger, uint32_t address) {
+	const uint32_t* block = (const uint32_t*) logger->vramBlock(logger, address);
+	uint32_t* shadow = &logger->vramShadow[address >> 2];
+	uint32_t delta[VRAM_BLOCK_WORDS];
+	size_t size = 0;
+	size_t i = 0;
+	while (i < VRAM_BLOCK_WORDS) {
+		if (block[i] == shadow[i]) {
+			++i;
+			continue;
+		}
+		size_t start = i;
+		size_t end = i + 1;
+		// A run header costs a word, so gaps of a single word are cheaper sent than skipped
+		for (i = end; i < VRAM_BLOCK_WORDS && i <= end + 1; ++i) {
+			if (block[i] != shadow[i]) {
+				end = i + 1;
+			}
+		}
+		i = end;
+		size_t length = end - start;
+		if (size + 1 + length >= VRAM_BLOCK_WORDS) {
+			// Most of the block changed, so the whole block is smaller
+			size = VRAM_BLOCK_WORDS;
+			break;
+		}
+		struct mVideoLoggerVRAMRun run = { start, length };
+		memcpy(&delta[size], &run, sizeof(run));
+		memcpy(&delta[size + 1], &block[start], length * 4);
+		memcpy(&shadow[start], &block[start], length * 4);
+		size += 1 + length;
+	}
+	if (size == VRAM_BLOCK_WORDS) {
+		memcpy(shadow, block, VRAM_BLOCK_SIZE);
+		struct mVideoLoggerDirtyInfo dirty = {
+			DIRTY_VRAM,
+			address,
+			VRAM_BLOCK_SIZE,
+			0xDEADBEEF,
+		};
+		logger->writeData(logger, &dirty, sizeof(dirty));
+		logger->writeData(logger, block, VRAM_BLOCK_SIZE);
+		return;
+	}
+	if (!size) {
+		// Written back with the same values, which the other end already has
+		return;
+	}
+	struct mVideoLoggerDirtyInfo dirty = {
+		DIRTY_VRAM_DELTA,
+		address,
+		size * 4,
+		0xDEADBEEF,
+	};
+	logger->writeData(logger, &dirty, sizeof(dirty));
+	logger->writeData(logger, delta, size * 4);
+}
+
 static void _flushVRAM(struct mVideoLogger* logger) {
 	size_t i;
 	for (i = 0; i < _roundUp(logger->vramSize, 17); ++i) {
@@ -215,14 +348,19 @@ static void _flushVRAM(struct mVideoLogger* logger) {
 				if (!(bitmap & (1 << j))) {
 					continue;
 				}
+				uint32_t address = (i << 17) + j * VRAM_BLOCK_SIZE;
+				if (logger->vramShadow) {
+					_writeVRAMBlock(logger, address);
+					continue;
+				}
 				struct mVideoLoggerDirtyInfo dirty = {
 					DIRTY_VRAM,
-					j * 0x1000,
-					0x1000,
+					address,
+					VRAM_BLOCK_SIZE,
 					0xDEADBEEF,
 				};
 				logger->writeData(logger, &dirty, sizeof(dirty));
-				logger->writeData(logger, logger->vramBlock(logger, j * 0x1000), 0x1000);
+				logger->writeData(logger, logger->vramBlock(logger, address), VRAM_BLOCK_SIZE);
 			}
 		}
 	}
@@ -261,6 +399,12 @@ void mVideoLoggerRendererFlush(struct mVideoLogger* logger) {
 	if (logger->wait) {
 		logger->wait(logger);
 	}
+	if (logger->writeData == _writeData) {
+		// Deltas are against what was sent, so a player seeking here has to start from that too
+		_flushVRAM(logger);
+		// Players stop at each flush, so this is the only place a keyframe can line up with a frame
+		_writeKeyframe(logger->dataContext);
+	}
 }
 
 void mVideoLoggerRendererFinishFrame(struct mVideoLogger* logger) {
@@ -271,6 +415,10 @@ void mVideoLoggerRendererFinishFrame(struct mVideoLogger* logger) {
 		0xDEADBEEF,
 	};
 	logger->writeData(logger, &dirty, sizeof(dirty));
+	if (logger->writeData == _writeData) {
+		struct mVideoLogChannel* channel = logger->dataContext;
+		++channel->frames;
+	}
 }
 
 void mVideoLoggerWriteBuffer(struct mVideoLogger* logger, uint32_t bufferId, uint32_t offset, uint32_t length, const void* data) {
@@ -297,6 +445,7 @@ bool mVideoLoggerRendererRun(struct mVideoLogger* logger, bool block) {
 		case DIRTY_FRAME:
 		case DIRTY_RANGE:
 		case DIRTY_BUFFER:
+		case DIRTY_VRAM_DELTA:
 			if (!logger->parsePacket(logger, &item)) {
 				return true;
 			}
@@ -308,6 +457,36 @@ bool mVideoLoggerRendererRun(struct mVideoLogger* logger, bool block) {
 	return !block;
 }
 
+bool mVideoLoggerRendererReadVRAMDelta(struct mVideoLogger* logger, const struct mVideoLoggerDirtyInfo* item,
+                                       void (*written)(struct mVideoLogger*, uint32_t address, uint32_t length)) {
+	uint32_t delta[VRAM_BLOCK_WORDS];
+	if (item->value >= VRAM_BLOCK_SIZE || (item->value & 3)) {
+		// Not something the writer produces, and there's no telling how long it is
+		return false;
+	}
+	if (!logger->readData(logger, delta, item->value, true)) {
+		return false;
+	}
+	if (item->address > logger->vramSize - VRAM_BLOCK_SIZE || (item->address & (VRAM_BLOCK_SIZE - 1))) {
+		return true;
+	}
+	uint32_t* block = (uint32_t*) &logger->vram[item->address >> 1];
+	size_t size = item->value >> 2;
+	size_t i = 0;
+	while (i < size) {
+		struct mVideoLoggerVRAMRun run;
+		memcpy(&run, &delta[i], sizeof(run));
+		++i;
+		if (run.length > size - i || run.offset + run.length > VRAM_BLOCK_WORDS) {
+			break;
+		}
+		memcpy(&block[run.offset], &delta[i], run.length * 4);
+		written(logger, item->address + run.offset * 4, run.length * 4);
+		i += run.length;
+	}
+	return true;
+}
+
 static bool _writeData(struct mVideoLogger* logger, const void* data, size_t length) {
 	struct mVideoLogChannel* channel = logger->dataContext;
 	return mVideoLoggerWriteChannel(channel, data, length) == (ssize_t) length;
@@ -334,7 +513,7 @@ static void _copyVf(struct VFile* dest, struct VFile* src) {
 	src->unmap(src, mem, size);
 }
 
-static void _compress(struct VFile* dest, struct VFile* src) {
+static void _compress(struct VFile* dest, struct VFile* src, int level) {
 	uint8_t writeBuffer[0x800];
 	uint8_t compressBuffer[0x400];
 	z_stream zstr;
@@ -344,7 +523,7 @@ static void _compress(struct VFile* dest, struct VFile* src) {
 	zstr.avail_in = 0;
 	zstr.avail_out = sizeof(compressBuffer);
 	zstr.next_out = (Bytef*) compressBuffer;
-	if (deflateInit(&zstr, 9) != Z_OK) {
+	if (deflateInit(&zstr, level) != Z_OK) {
 		return;
 	}
 
@@ -450,6 +629,211 @@ static bool _decompress(struct VFile* dest, struct VFile* src, size_t compressed
 }
 #endif
 
+static void _writeState(struct mVideoLogContext* context, uint32_t blockType, uint32_t channelId, const void* state, size_t size) {
+	struct mVLBlockHeader header = { 0 };
+	STORE_32LE(blockType, 0, &header.blockType);
+	STORE_32LE(channelId, 0, &header.channelId);
+#ifdef USE_ZLIB
+	STORE_32LE(mVL_FLAG_BLOCK_COMPRESSED, 0, &header.flags);
+
+	struct VFile* vfm = VFileMemArenaChunk(context->arena);
+	struct VFile* src = VFileFromConstMemory(state, size);
+	_compress(vfm, src, context->compressionLevel);
+	src->close(src);
+	STORE_32LE(vfm->size(vfm), 0, &header.length);
+	context->backing->write(context->backing, &header, sizeof(header));
+	_copyVf(context->backing, vfm);
+	vfm->close(vfm);
+#else
+	STORE_32LE(size, 0, &header.length);
+	context->backing->write(context->backing, &header, sizeof(header));
+	context->backing->write(context->backing, state, size);
+#endif
+}
+
+static bool _readState(struct mVideoLogContext* context, const struct mVLBlockHeader* header, void** state, size_t* size) {
+	if (header->flags & mVL_FLAG_BLOCK_COMPRESSED) {
+#ifdef USE_ZLIB
+		struct VFile* vfm = VFileMemArenaChunk(context->arena);
+		if (!_decompress(vfm, context->backing, header->length)) {
+			vfm->close(vfm);
+			return false;
+		}
+		*size = vfm->size(vfm);
+		*state = anonymousMemoryMap(*size);
+		void* mem = vfm->map(vfm, *size, MAP_READ);
+		memcpy(*state, mem, *size);
+		vfm->unmap(vfm, mem, *size);
+		vfm->close(vfm);
+#else
+		return false;
+#endif
+	} else {
+		*size = header->length;
+		*state = anonymousMemoryMap(header->length);
+		context->backing->read(context->backing, *state, *size);
+	}
+	return true;
+}
+
+static void _loadState(struct mCore* core, const void* state, size_t stateSize) {
+	size_t size = core->stateSize(core);
+	if (size <= stateSize) {
+		core->loadState(core, state);
+	} else {
+		void* extendedState = anonymousMemoryMap(size);
+		memcpy(extendedState, state, stateSize);
+		core->loadState(core, extendedState);
+		mappedMemoryFree(extendedState, size);
+	}
+}
+
+#ifdef USE_ZLIB
+static void _compressJob(struct mVideoLogContext* context, struct mVLCompressJob* job) {
+	job->compressed = VFileMemArenaChunk(context->arena);
+	struct VFile* src = VFileFromConstMemory(job->data, job->size);
+	_compress(job->compressed, src, context->compressionLevel);
+	src->close(src);
+	free(job->data);
+	job->data = NULL;
+}
+
+static void _writeJob(struct mVideoLogContext* context, struct mVLCompressJob* job) {
+	if (job->indexEntry >= 0) {
+		mVLIndexGetPointer(&context->index, job->indexEntry)->offset = context->backing->seek(context->backing, 0, SEEK_CUR);
+	}
+
+	struct mVLBlockHeader header = { 0 };
+	STORE_32LE(job->blockType, 0, &header.blockType);
+	STORE_32LE(job->channelId, 0, &header.channelId);
+	STORE_32LE(mVL_FLAG_BLOCK_COMPRESSED, 0, &header.flags);
+	STORE_32LE(job->compressed->size(job->compressed), 0, &header.length);
+	context->backing->write(context->backing, &header, sizeof(header));
+	_copyVf(context->backing, job->compressed);
+	job->compressed->close(job->compressed);
+	job->compressed = NULL;
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _compressThread(void* user) {
+	struct mVideoLogContext* context = user;
+	ThreadSetName("Video Log Compression Thread");
+
+	MutexLock(&context->compressMutex);
+	while (true) {
+		if (context->jobNext == context->jobTail) {
+			if (context->compressExit) {
+				break;
+			}
+			ConditionWait(&context->compressCond, &context->compressMutex);
+			continue;
+		}
+		struct mVLCompressJob* job = &context->jobs[context->jobNext % COMPRESS_QUEUE_SIZE];
+		++context->jobNext;
+		MutexUnlock(&context->compressMutex);
+		_compressJob(context, job);
+		MutexLock(&context->compressMutex);
+		job->done = true;
+
+		// Blocks must land in the file in the order they were submitted
+		while (context->jobHead != context->jobNext) {
+			job = &context->jobs[context->jobHead % COMPRESS_QUEUE_SIZE];
+			if (!job->done) {
+				break;
+			}
+			_writeJob(context, job);
+			++context->jobHead;
+		}
+		ConditionWake(&context->compressCond);
+	}
+	MutexUnlock(&context->compressMutex);
+
+#ifdef _3DS
+	svcExitThread();
+#endif
+	return 0;
+}
+
+static void _startCompressThreads(struct mVideoLogContext* context) {
+	if (context->compressing) {
+		return;
+	}
+	MutexInit(&context->compressMutex);
+	ConditionInit(&context->compressCond);
+	context->jobHead = 0;
+	context->jobNext = 0;
+	context->jobTail = 0;
+	context->compressExit = false;
+	context->compressing = true;
+	size_t i;
+	for (i = 0; i < COMPRESS_THREADS; ++i) {
+		ThreadCreate(&context->compressThreads[i], _compressThread, context);
+	}
+}
+
+static void _stopCompressThreads(struct mVideoLogContext* context) {
+	if (!context->compressing) {
+		return;
+	}
+	MutexLock(&context->compressMutex);
+	context->compressExit = true;
+	ConditionWake(&context->compressCond);
+	MutexUnlock(&context->compressMutex);
+	size_t i;
+	for (i = 0; i < COMPRESS_THREADS; ++i) {
+		ThreadJoin(context->compressThreads[i]);
+	}
+	MutexDeinit(&context->compressMutex);
+	ConditionDeinit(&context->compressCond);
+	context->compressing = false;
+}
+#endif
+
+static void _submitCompressed(struct mVideoLogContext* context, uint32_t blockType, uint32_t channelId, void* data, size_t size, ssize_t indexEntry) {
+	struct mVLCompressJob job = {
+		.blockType = blockType,
+		.channelId = channelId,
+		.data = data,
+		.size = size,
+		.indexEntry = indexEntry,
+	};
+#ifndef DISABLE_THREADING
+	_startCompressThreads(context);
+	MutexLock(&context->compressMutex);
+	while (context->jobTail - context->jobHead >= COMPRESS_QUEUE_SIZE) {
+		ConditionWait(&context->compressCond, &context->compressMutex);
+	}
+	context->jobs[context->jobTail % COMPRESS_QUEUE_SIZE] = job;
+	++context->jobTail;
+	ConditionWake(&context->compressCond);
+	MutexUnlock(&context->compressMutex);
+#else
+	_compressJob(context, &job);
+	_writeJob(context, &job);
+#endif
+}
+#endif
+
+static ssize_t _appendIndex(struct mVideoLogContext* context, uint32_t frame, uint32_t channelId, off_t offset) {
+#if defined(USE_ZLIB) && !defined(DISABLE_THREADING)
+	// The compression threads fill in offsets as they write keyframes out
+	if (context->compressing) {
+		MutexLock(&context->compressMutex);
+	}
+#endif
+	struct mVLIndexEntry* entry = mVLIndexAppend(&context->index);
+	entry->frame = frame;
+	entry->channelId = channelId;
+	entry->offset = offset;
+	ssize_t location = mVLIndexSize(&context->index) - 1;
+#if defined(USE_ZLIB) && !defined(DISABLE_THREADING)
+	if (context->compressing) {
+		MutexUnlock(&context->compressMutex);
+	}
+#endif
+	return location;
+}
+
 void mVideoLoggerAttachChannel(struct mVideoLogger* logger, struct mVideoLogContext* context, size_t channelId) {
 	if (channelId >= mVL_MAX_CHANNELS) {
 		return;
@@ -464,6 +848,16 @@ struct mVideoLogContext* mVideoLogContextCreate(struct mCore* core) {
 	context->write = !!core;
 	context->initialStateSize = 0;
 	context->initialState = NULL;
+	context->core = core;
+	context->keyframeInterval = core ? DEFAULT_KEYFRAME_INTERVAL : 0;
+	context->compressionLevel = DEFAULT_COMPRESSION_LEVEL;
+	if (core && core->opts.fastCompression) {
+		context->compressionLevel = FAST_COMPRESSION_LEVEL;
+	}
+	mVLIndexInit(&context->index, 0);
+#ifdef USE_ZLIB
+	context->arena = VFileMemArenaCreate();
+#endif
 
 	if (core) {
 		context->initialStateSize = core->stateSize(core);
@@ -496,24 +890,7 @@ void mVideoLogContextWriteHeader(struct mVideoLogContext* context, struct mCore*
 	STORE_32LE(flags, 0, &header.flags);
 	context->backing->write(context->backing, &header, sizeof(header));
 	if (context->initialState) {
-		struct mVLBlockHeader chheader = { 0 };
-		STORE_32LE(mVL_BLOCK_INITIAL_STATE, 0, &chheader.blockType);
-#ifdef USE_ZLIB
-		STORE_32LE(mVL_FLAG_BLOCK_COMPRESSED, 0, &chheader.flags);
-
-		struct VFile* vfm = VFileMemChunk(NULL, 0);
-		struct VFile* src = VFileFromConstMemory(context->initialState, context->initialStateSize);
-		_compress(vfm, src);
-		src->close(src);
-		STORE_32LE(vfm->size(vfm), 0, &chheader.length);
-		context->backing->write(context->backing, &chheader, sizeof(chheader));
-		_copyVf(context->backing, vfm);
-		vfm->close(vfm);
-#else
-		STORE_32LE(context->initialStateSize, 0, &chheader.length);
-		context->backing->write(context->backing, &chheader, sizeof(chheader));
-		context->backing->write(context->backing, context->initialState, context->initialStateSize);
-#endif
+		_writeState(context, mVL_BLOCK_INITIAL_STATE, 0, context->initialState, context->initialStateSize);
 	}
 
  	size_t i;
@@ -573,31 +950,68 @@ bool _readHeader(struct mVideoLogContext* context) {
 			context->initialState = NULL;
 			context->initialStateSize = 0;
 		}
-		if (header.flags & mVL_FLAG_BLOCK_COMPRESSED) {
-#ifdef USE_ZLIB
-			struct VFile* vfm = VFileMemChunk(NULL, 0);
-			if (!_decompress(vfm, context->backing, header.length)) {
-				vfm->close(vfm);
-				return false;
-			}
-			context->initialStateSize = vfm->size(vfm);
-			context->initialState = anonymousMemoryMap(context->initialStateSize);
-			void* mem = vfm->map(vfm, context->initialStateSize, MAP_READ);
-			memcpy(context->initialState, mem, context->initialStateSize);
-			vfm->unmap(vfm, mem, context->initialStateSize);
-			vfm->close(vfm);
-#else
+		if (!_readState(context, &header, &context->initialState, &context->initialStateSize)) {
 			return false;
-#endif
-		} else {
-			context->initialStateSize = header.length;
-			context->initialState = anonymousMemoryMap(header.length);
-			context->backing->read(context->backing, context->initialState, context->initialStateSize);
 		}
 	}
 	return true;
 }
 
+static void _readIndex(struct mVideoLogContext* context) {
+	mVLIndexClear(&context->index);
+	struct mVLBlockHeader header;
+	ssize_t size = context->backing->size(context->backing);
+	if (size < (ssize_t) (sizeof(struct mVideoLogHeader) + sizeof(header) * 2)) {
+		return;
+	}
+	context->backing->seek(context->backing, size - sizeof(header), SEEK_SET);
+	if (!_readBlockHeader(context, &header) || header.blockType != mVL_BLOCK_FOOTER) {
+		return;
+	}
+	size_t indexSize = header.flags;
+	if (indexSize < sizeof(header) || indexSize > size - sizeof(header) - sizeof(struct mVideoLogHeader)) {
+		return;
+	}
+	context->backing->seek(context->backing, size - sizeof(header) - indexSize, SEEK_SET);
+	if (!_readBlockHeader(context, &header) || header.blockType != mVL_BLOCK_INDEX) {
+		return;
+	}
+	if (header.length != indexSize - sizeof(header) || header.length % sizeof(struct mVLIndexEntry)) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < header.length / sizeof(struct mVLIndexEntry); ++i) {
+		struct mVLIndexEntry buffer;
+		if (context->backing->read(context->backing, &buffer, sizeof(buffer)) != sizeof(buffer)) {
+			mVLIndexClear(&context->index);
+			return;
+		}
+		struct mVLIndexEntry* entry = mVLIndexAppend(&context->index);
+		LOAD_32LE(entry->frame, 0, &buffer.frame);
+		LOAD_32LE(entry->channelId, 0, &buffer.channelId);
+		LOAD_64LE(entry->offset, 0, &buffer.offset);
+	}
+}
+
+static size_t _writeIndex(struct mVideoLogContext* context) {
+	size_t nEntries = mVLIndexSize(&context->index);
+	struct mVLBlockHeader header = { 0 };
+	STORE_32LE(mVL_BLOCK_INDEX, 0, &header.blockType);
+	STORE_32LE(nEntries * sizeof(struct mVLIndexEntry), 0, &header.length);
+	context->backing->write(context->backing, &header, sizeof(header));
+
+	size_t i;
+	for (i = 0; i < nEntries; ++i) {
+		const struct mVLIndexEntry* entry = mVLIndexGetConstPointer(&context->index, i);
+		struct mVLIndexEntry buffer;
+		STORE_32LE(entry->frame, 0, &buffer.frame);
+		STORE_32LE(entry->channelId, 0, &buffer.channelId);
+		STORE_64LE(entry->offset, 0, &buffer.offset);
+		context->backing->write(context->backing, &buffer, sizeof(buffer));
+	}
+	return sizeof(header) + nEntries * sizeof(struct mVLIndexEntry);
+}
+
 bool mVideoLogContextLoad(struct mVideoLogContext* context, struct VFile* vf) {
 	context->backing = vf;
 
@@ -606,6 +1020,7 @@ bool mVideoLogContextLoad(struct mVideoLogContext* context, struct VFile* vf) {
 	}
 
 	off_t pointer = context->backing->seek(context->backing, 0, SEEK_CUR);
+	_readIndex(context);
 
 	size_t i;
 	for (i = 0; i < context->nChannels; ++i) {
@@ -623,25 +1038,13 @@ bool mVideoLogContextLoad(struct mVideoLogContext* context, struct VFile* vf) {
 #ifdef USE_ZLIB
 static void _flushBufferCompressed(struct mVideoLogContext* context) {
 	struct CircleBuffer* buffer = &context->channels[context->activeChannel].buffer;
-	if (!CircleBufferSize(buffer)) {
+	size_t size = CircleBufferSize(buffer);
+	if (!size) {
 		return;
 	}
-	struct VFile* vfm = VFileMemChunk(NULL, 0);
-	struct VFile* src = VFileFIFO(buffer);
-	_compress(vfm, src);
-	src->close(src);
-
-	size_t size = vfm->size(vfm);
-
-	struct mVLBlockHeader header = { 0 };
-	STORE_32LE(mVL_BLOCK_DATA, 0, &header.blockType);
-	STORE_32LE(context->activeChannel, 0, &header.channelId);
-	STORE_32LE(mVL_FLAG_BLOCK_COMPRESSED, 0, &header.flags);
-	STORE_32LE(size, 0, &header.length);
-
-	context->backing->write(context->backing, &header, sizeof(header));
-	_copyVf(context->backing, vfm);
-	vfm->close(vfm);
+	void* data = malloc(size);
+	CircleBufferRead(buffer, data, size);
+	_submitCompressed(context, mVL_BLOCK_DATA, context->activeChannel, data, size, -1);
 }
 #endif
 
@@ -673,11 +1076,21 @@ static void _flushBuffer(struct mVideoLogContext* context) {
 void mVideoLogContextDestroy(struct mCore* core, struct mVideoLogContext* context) {
 	if (context->write) {
 		_flushBuffer(context);
+#if defined(USE_ZLIB) && !defined(DISABLE_THREADING)
+		_stopCompressThreads(context);
+#endif
+
+		size_t indexSize = 0;
+		if (mVLIndexSize(&context->index)) {
+			indexSize = _writeIndex(context);
+		}
 
 		struct mVLBlockHeader header = { 0 };
 		STORE_32LE(mVL_BLOCK_FOOTER, 0, &header.blockType);
+		STORE_32LE(indexSize, 0, &header.flags);
 		context->backing->write(context->backing, &header, sizeof(header));
 	}
+	mVLIndexDeinit(&context->index);
 
 	if (core) {
 		core->endVideoLog(core);
@@ -696,26 +1109,14 @@ void mVideoLogContextDestroy(struct mCore* core, struct mVideoLogContext* contex
 		}
 #endif
 	}
+#ifdef USE_ZLIB
+	VFileMemArenaDestroy(context->arena);
+#endif
 
 	free(context);
 }
 
-void mVideoLogContextRewind(struct mVideoLogContext* context, struct mCore* core) {
-	_readHeader(context);
-	if (core) {
-		size_t size = core->stateSize(core);
-		if (size <= context->initialStateSize) {
-			core->loadState(core, context->initialState);
-		} else {
-			void* extendedState = anonymousMemoryMap(size);
-			memcpy(extendedState, context->initialState, context->initialStateSize);
-			core->loadState(core, extendedState);
-			mappedMemoryFree(extendedState, size);
-		}
-	}
-
-	off_t pointer = context->backing->seek(context->backing, 0, SEEK_CUR);
-
+static void _resetChannels(struct mVideoLogContext* context, off_t pointer) {
 	size_t i;
 	for (i = 0; i < context->nChannels; ++i) {
 		CircleBufferClear(&context->channels[i].buffer);
@@ -730,6 +1131,57 @@ void mVideoLogContextRewind(struct mVideoLogContext* context, struct mCore* core
 	}
 }
 
+void mVideoLogContextRewind(struct mVideoLogContext* context, struct mCore* core) {
+	_readHeader(context);
+	if (core) {
+		_loadState(core, context->initialState, context->initialStateSize);
+	}
+
+	off_t pointer = context->backing->seek(context->backing, 0, SEEK_CUR);
+	_resetChannels(context, pointer);
+}
+
+uint32_t mVideoLogContextSeek(struct mVideoLogContext* context, struct mCore* core, uint32_t frame) {
+	const struct mVLIndexEntry* best = NULL;
+	size_t i;
+	for (i = 0; i < mVLIndexSize(&context->index); ++i) {
+		const struct mVLIndexEntry* entry = mVLIndexGetConstPointer(&context->index, i);
+		// Players only ever read the first channel
+		if (entry->channelId || entry->frame > frame) {
+			continue;
+		}
+		if (!best || entry->frame > best->frame) {
+			best = entry;
+		}
+	}
+
+	if (best) {
+		struct mVLBlockHeader header;
+		void* state;
+		size_t size;
+		context->backing->seek(context->backing, best->offset, SEEK_SET);
+		if (_readBlockHeader(context, &header) && header.blockType == mVL_BLOCK_KEYFRAME && _readState(context, &header, &state, &size)) {
+			if (core) {
+				_loadState(core, state, size);
+			}
+			mappedMemoryFree(state, size);
+			_resetChannels(context, best->offset + sizeof(header) + header.length);
+			return best->frame;
+		}
+	}
+
+	mVideoLogContextRewind(context, core);
+	return 0;
+}
+
+void mVideoLogContextSetKeyframeInterval(struct mVideoLogContext* context, uint32_t frames) {
+	context->keyframeInterval = frames;
+}
+
+void mVideoLogContextSetCompressionLevel(struct mVideoLogContext* context, int level) {
+	context->compressionLevel = level;
+}
+
 void* mVideoLogContextInitialState(struct mVideoLogContext* context, size_t* size) {
 	if (size) {
 		*size = context->initialStateSize;
@@ -737,6 +1189,31 @@ void* mVideoLogContextInitialState(struct mVideoLogContext* context, size_t* siz
 	return context->initialState;
 }
 
+static void _writeKeyframe(struct mVideoLogChannel* channel) {
+	struct mVideoLogContext* context = channel->p;
+	if (!context->core || !context->backing || !context->keyframeInterval) {
+		return;
+	}
+	if (channel->frames - channel->keyframe < context->keyframeInterval) {
+		return;
+	}
+	channel->keyframe = channel->frames;
+	_flushBuffer(context);
+
+	uint32_t channelId = channel - context->channels;
+	size_t size = context->core->stateSize(context->core);
+	void* state = malloc(size);
+	context->core->saveState(context->core, state);
+#ifdef USE_ZLIB
+	ssize_t indexEntry = _appendIndex(context, channel->frames, channelId, 0);
+	_submitCompressed(context, mVL_BLOCK_KEYFRAME, channelId, state, size, indexEntry);
+#else
+	_appendIndex(context, channel->frames, channelId, context->backing->seek(context->backing, 0, SEEK_CUR));
+	_writeState(context, mVL_BLOCK_KEYFRAME, channelId, state, size);
+	free(state);
+#endif
+}
+
 int mVideoLoggerAddChannel(struct mVideoLogContext* context) {
 	if (context->nChannels >= mVL_MAX_CHANNELS) {
 		return -1;
@@ -944,17 +1421,26 @@ static ssize_t mVideoLoggerWriteChannel(struct mVideoLogChannel* channel, const
 	return read;
 }
 
-struct mCore* mVideoLogCoreFind(struct VFile* vf) {
+static bool _readMagic(struct VFile* vf, struct mVideoLogHeader* header) {
 	if (!vf) {
-		return NULL;
+		return false;
 	}
-	struct mVideoLogHeader header = { { 0 } };
 	vf->seek(vf, 0, SEEK_SET);
-	ssize_t read = vf->read(vf, &header, sizeof(header));
-	if (read != sizeof(header)) {
-		return NULL;
+	ssize_t read = vf->read(vf, header, sizeof(*header));
+	if (read != sizeof(*header)) {
+		return false;
 	}
-	if (memcmp(header.magic, mVL_MAGIC, sizeof(header.magic)) != 0) {
+	return memcmp(header->magic, mVL_MAGIC, sizeof(header->magic)) == 0;
+}
+
+bool mVideoLogIsCompatible(struct VFile* vf) {
+	struct mVideoLogHeader header = { { 0 } };
+	return _readMagic(vf, &header);
+}
+
+struct mCore* mVideoLogCoreFind(struct VFile* vf) {
+	struct mVideoLogHeader header = { { 0 } };
+	if (!_readMagic(vf, &header)) {
 		return NULL;
 	}
 	enum mPlatform platform;
@@ -972,3 +1458,17 @@ struct mCore* mVideoLogCoreFind(struct VFile* vf) {
 	}
 	return core;
 }
+
+bool mVideoLogPlayerSeek(struct mCore* core, uint32_t frame) {
+	enum mPlatform platform = core->platform(core);
+	const struct mVLDescriptor* descriptor;
+	for (descriptor = &_descriptors[0]; descriptor->platform != PLATFORM_NONE; ++descriptor) {
+		if (platform == descriptor->platform) {
+			break;
+		}
+	}
+	if (!descriptor->seek) {
+		return false;
+	}
+	return descriptor->seek(core, frame);
+}
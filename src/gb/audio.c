@@ -39,12 +39,10 @@ static int32_t _updateSquareChannel(struct GBAudioSquareChannel* ch);
 
 static int8_t _coalesceNoiseChannel(struct GBAudioNoiseChannel* ch);
 
+static void _updateChannel3(struct GBAudio* audio, int32_t steps);
+static void _updateChannel4(struct GBAudio* audio);
+
 static void _updateFrame(struct mTiming* timing, void* user, uint32_t cyclesLate);
-static void _updateChannel1(struct mTiming* timing, void* user, uint32_t cyclesLate);
-static void _updateChannel2(struct mTiming* timing, void* user, uint32_t cyclesLate);
-static void _updateChannel3(struct mTiming* timing, void* user, uint32_t cyclesLate);
-static void _fadeChannel3(struct mTiming* timing, void* user, uint32_t cyclesLate);
-static void _updateChannel4(struct mTiming* timing, void* user, uint32_t cyclesLate);
 static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate);
 
 void GBAudioInit(struct GBAudio* audio, size_t samples, uint8_t* nr52, enum GBAudioStyle style) {
@@ -60,6 +58,8 @@ void GBAudioInit(struct GBAudio* audio, size_t samples, uint8_t* nr52, enum GBAu
 	audio->forceDisableCh[2] = false;
 	audio->forceDisableCh[3] = false;
 	audio->masterVolume = GB_AUDIO_VOLUME_MAX;
+	audio->suppressOutput = false;
+	audio->skipSynthesis = false;
 	audio->nr52 = nr52;
 	audio->style = style;
 	if (style == GB_AUDIO_GBA) {
@@ -72,26 +72,6 @@ void GBAudioInit(struct GBAudio* audio, size_t samples, uint8_t* nr52, enum GBAu
 	audio->frameEvent.name = "GB Audio Frame Sequencer";
 	audio->frameEvent.callback = _updateFrame;
 	audio->frameEvent.priority = 0x10;
-	audio->ch1Event.context = audio;
-	audio->ch1Event.name = "GB Audio Channel 1";
-	audio->ch1Event.callback = _updateChannel1;
-	audio->ch1Event.priority = 0x11;
-	audio->ch2Event.context = audio;
-	audio->ch2Event.name = "GB Audio Channel 2";
-	audio->ch2Event.callback = _updateChannel2;
-	audio->ch2Event.priority = 0x12;
-	audio->ch3Event.context = audio;
-	audio->ch3Event.name = "GB Audio Channel 3";
-	audio->ch3Event.callback = _updateChannel3;
-	audio->ch3Event.priority = 0x13;
-	audio->ch3Fade.context = audio;
-	audio->ch3Fade.name = "GB Audio Channel 3 Memory";
-	audio->ch3Fade.callback = _fadeChannel3;
-	audio->ch3Fade.priority = 0x14;
-	audio->ch4Event.context = audio;
-	audio->ch4Event.name = "GB Audio Channel 4";
-	audio->ch4Event.callback = _updateChannel4;
-	audio->ch4Event.priority = 0x15;
 	audio->sampleEvent.context = audio;
 	audio->sampleEvent.name = "GB Audio Sample";
 	audio->sampleEvent.callback = _sample;
@@ -105,12 +85,12 @@ void GBAudioDeinit(struct GBAudio* audio) {
 
 void GBAudioReset(struct GBAudio* audio) {
 	mTimingDeschedule(audio->timing, &audio->frameEvent);
-	mTimingDeschedule(audio->timing, &audio->ch1Event);
-	mTimingDeschedule(audio->timing, &audio->ch2Event);
-	mTimingDeschedule(audio->timing, &audio->ch3Event);
-	mTimingDeschedule(audio->timing, &audio->ch3Fade);
-	mTimingDeschedule(audio->timing, &audio->ch4Event);
 	mTimingDeschedule(audio->timing, &audio->sampleEvent);
+	audio->ch1Edge.pending = false;
+	audio->ch2Edge.pending = false;
+	audio->ch3Edge.pending = false;
+	audio->ch3Fade.pending = false;
+	audio->ch4Edge.pending = false;
 	if (audio->style != GB_AUDIO_GBA) {
 		mTimingSchedule(audio->timing, &audio->sampleEvent, 0);
 	}
@@ -167,32 +147,37 @@ void GBAudioResizeBuffer(struct GBAudio* audio, size_t samples) {
 }
 
 void GBAudioWriteNR10(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	if (!_writeSweep(&audio->ch1.sweep, value)) {
-		mTimingDeschedule(audio->timing, &audio->ch1Event);
+		audio->ch1Edge.pending = false;
 		audio->playingCh1 = false;
 		*audio->nr52 &= ~0x0001;
 	}
 }
 
 void GBAudioWriteNR11(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	_writeDuty(&audio->ch1.envelope, value);
 	audio->ch1.control.length = 64 - audio->ch1.envelope.length;
 }
 
 void GBAudioWriteNR12(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	if (!_writeEnvelope(&audio->ch1.envelope, value, audio->style)) {
-		mTimingDeschedule(audio->timing, &audio->ch1Event);
+		audio->ch1Edge.pending = false;
 		audio->playingCh1 = false;
 		*audio->nr52 &= ~0x0001;
 	}
 }
 
 void GBAudioWriteNR13(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	audio->ch1.control.frequency &= 0x700;
 	audio->ch1.control.frequency |= GBAudioRegisterControlGetFrequency(value);
 }
 
 void GBAudioWriteNR14(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	audio->ch1.control.frequency &= 0xFF;
 	audio->ch1.control.frequency |= GBAudioRegisterControlGetFrequency(value << 8);
 	bool wasStop = audio->ch1.control.stop;
@@ -200,7 +185,7 @@ void GBAudioWriteNR14(struct GBAudio* audio, uint8_t value) {
 	if (!wasStop && audio->ch1.control.stop && audio->ch1.control.length && !(audio->frame & 1)) {
 		--audio->ch1.control.length;
 		if (audio->ch1.control.length == 0) {
-			mTimingDeschedule(audio->timing, &audio->ch1Event);
+			audio->ch1Edge.pending = false;
 			audio->playingCh1 = false;
 		}
 	}
@@ -219,8 +204,8 @@ void GBAudioWriteNR14(struct GBAudio* audio, uint8_t value) {
 		}
 		if (audio->playingCh1 && audio->ch1.envelope.dead != 2) {
 			_updateSquareChannel(&audio->ch1);
-			mTimingDeschedule(audio->timing, &audio->ch1Event);
-			mTimingSchedule(audio->timing, &audio->ch1Event, 0);
+			audio->ch1Edge.when = mTimingCurrentTime(audio->timing);
+			audio->ch1Edge.pending = true;
 		}
 	}
 	*audio->nr52 &= ~0x0001;
@@ -228,24 +213,28 @@ void GBAudioWriteNR14(struct GBAudio* audio, uint8_t value) {
 }
 
 void GBAudioWriteNR21(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	_writeDuty(&audio->ch2.envelope, value);
 	audio->ch2.control.length = 64 - audio->ch2.envelope.length;
 }
 
 void GBAudioWriteNR22(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	if (!_writeEnvelope(&audio->ch2.envelope, value, audio->style)) {
-		mTimingDeschedule(audio->timing, &audio->ch2Event);
+		audio->ch2Edge.pending = false;
 		audio->playingCh2 = false;
 		*audio->nr52 &= ~0x0002;
 	}
 }
 
 void GBAudioWriteNR23(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	audio->ch2.control.frequency &= 0x700;
 	audio->ch2.control.frequency |= GBAudioRegisterControlGetFrequency(value);
 }
 
 void GBAudioWriteNR24(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	audio->ch2.control.frequency &= 0xFF;
 	audio->ch2.control.frequency |= GBAudioRegisterControlGetFrequency(value << 8);
 	bool wasStop = audio->ch2.control.stop;
@@ -253,7 +242,7 @@ void GBAudioWriteNR24(struct GBAudio* audio, uint8_t value) {
 	if (!wasStop && audio->ch2.control.stop && audio->ch2.control.length && !(audio->frame & 1)) {
 		--audio->ch2.control.length;
 		if (audio->ch2.control.length == 0) {
-			mTimingDeschedule(audio->timing, &audio->ch2Event);
+			audio->ch2Edge.pending = false;
 			audio->playingCh2 = false;
 		}
 	}
@@ -268,8 +257,8 @@ void GBAudioWriteNR24(struct GBAudio* audio, uint8_t value) {
 		}
 		if (audio->playingCh2 && audio->ch2.envelope.dead != 2) {
 			_updateSquareChannel(&audio->ch2);
-			mTimingDeschedule(audio->timing, &audio->ch2Event);
-			mTimingSchedule(audio->timing, &audio->ch2Event, 0);
+			audio->ch2Edge.when = mTimingCurrentTime(audio->timing);
+			audio->ch2Edge.pending = true;
 		}
 	}
 	*audio->nr52 &= ~0x0002;
@@ -277,6 +266,7 @@ void GBAudioWriteNR24(struct GBAudio* audio, uint8_t value) {
 }
 
 void GBAudioWriteNR30(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	audio->ch3.enable = GBAudioRegisterBankGetEnable(value);
 	if (!audio->ch3.enable) {
 		audio->playingCh3 = false;
@@ -285,19 +275,23 @@ void GBAudioWriteNR30(struct GBAudio* audio, uint8_t value) {
 }
 
 void GBAudioWriteNR31(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	audio->ch3.length = 256 - value;
 }
 
 void GBAudioWriteNR32(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	audio->ch3.volume = GBAudioRegisterBankVolumeGetVolumeGB(value);
 }
 
 void GBAudioWriteNR33(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	audio->ch3.rate &= 0x700;
 	audio->ch3.rate |= GBAudioRegisterControlGetRate(value);
 }
 
 void GBAudioWriteNR34(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	audio->ch3.rate &= 0xFF;
 	audio->ch3.rate |= GBAudioRegisterControlGetRate(value << 8);
 	bool wasStop = audio->ch3.stop;
@@ -331,43 +325,48 @@ void GBAudioWriteNR34(struct GBAudio* audio, uint8_t value) {
 		audio->ch3.window = 0;
 		audio->ch3.sample = 0;
 	}
-	mTimingDeschedule(audio->timing, &audio->ch3Fade);
-	mTimingDeschedule(audio->timing, &audio->ch3Event);
+	audio->ch3Fade.pending = false;
+	audio->ch3Edge.pending = false;
 	if (audio->playingCh3) {
 		audio->ch3.readable = audio->style != GB_AUDIO_DMG;
 		// TODO: Where does this cycle delay come from?
-		mTimingSchedule(audio->timing, &audio->ch3Event, audio->timingFactor * 4 + 2 * (2048 - audio->ch3.rate));
+		audio->ch3Edge.when = mTimingCurrentTime(audio->timing) + audio->timingFactor * 4 + 2 * (2048 - audio->ch3.rate);
+		audio->ch3Edge.pending = true;
 	}
 	*audio->nr52 &= ~0x0004;
 	*audio->nr52 |= audio->playingCh3 << 2;
 }
 
 void GBAudioWriteNR41(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	_writeDuty(&audio->ch4.envelope, value);
 	audio->ch4.length = 64 - audio->ch4.envelope.length;
 }
 
 void GBAudioWriteNR42(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	if (!_writeEnvelope(&audio->ch4.envelope, value, audio->style)) {
-		mTimingDeschedule(audio->timing, &audio->ch4Event);
+		audio->ch4Edge.pending = false;
 		audio->playingCh4 = false;
 		*audio->nr52 &= ~0x0008;
 	}
 }
 
 void GBAudioWriteNR43(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	audio->ch4.ratio = GBAudioRegisterNoiseFeedbackGetRatio(value);
 	audio->ch4.frequency = GBAudioRegisterNoiseFeedbackGetFrequency(value);
 	audio->ch4.power = GBAudioRegisterNoiseFeedbackGetPower(value);
 }
 
 void GBAudioWriteNR44(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	bool wasStop = audio->ch4.stop;
 	audio->ch4.stop = GBAudioRegisterNoiseControlGetStop(value);
 	if (!wasStop && audio->ch4.stop && audio->ch4.length && !(audio->frame & 1)) {
 		--audio->ch4.length;
 		if (audio->ch4.length == 0) {
-			mTimingDeschedule(audio->timing, &audio->ch4Event);
+			audio->ch4Edge.pending = false;
 			audio->playingCh4 = false;
 		}
 	}
@@ -386,8 +385,8 @@ void GBAudioWriteNR44(struct GBAudio* audio, uint8_t value) {
 			}
 		}
 		if (audio->playingCh4 && audio->ch4.envelope.dead != 2) {
-			mTimingDeschedule(audio->timing, &audio->ch4Event);
-			mTimingSchedule(audio->timing, &audio->ch4Event, 0);
+			audio->ch4Edge.when = mTimingCurrentTime(audio->timing);
+			audio->ch4Edge.pending = true;
 		}
 	}
 	*audio->nr52 &= ~0x0008;
@@ -411,6 +410,7 @@ void GBAudioWriteNR51(struct GBAudio* audio, uint8_t value) {
 }
 
 void GBAudioWriteNR52(struct GBAudio* audio, uint8_t value) {
+	GBAudioSync(audio);
 	bool wasEnable = audio->enable;
 	audio->enable = GBAudioEnableGetEnable(value);
 	if (!audio->enable) {
@@ -474,6 +474,8 @@ void GBAudioWriteNR52(struct GBAudio* audio, uint8_t value) {
 		audio->frame = 7;
 
 		if (audio->p) {
+			// The timer only schedules frame sequencer ticks while audio is enabled
+			GBTimerUpdateScheduling(&audio->p->timer);
 			unsigned timingFactor = 0x400 >> !audio->p->doubleSpeed;
 			if (audio->p->timer.internalDiv & timingFactor) {
 				audio->skipFrame = true;
@@ -484,13 +486,13 @@ void GBAudioWriteNR52(struct GBAudio* audio, uint8_t value) {
 
 void _updateFrame(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 	struct GBAudio* audio = user;
-	GBAudioUpdateFrame(audio, timing);
+	GBAudioUpdateFrame(audio, mTimingCurrentTime(timing) - cyclesLate);
 	if (audio->style == GB_AUDIO_GBA) {
 		mTimingSchedule(timing, &audio->frameEvent, audio->timingFactor * FRAME_CYCLES - cyclesLate);
 	}
 }
 
-void GBAudioUpdateFrame(struct GBAudio* audio, struct mTiming* timing) {
+void GBAudioUpdateFrame(struct GBAudio* audio, int32_t timestamp) {
 	if (!audio->enable) {
 		return;
 	}
@@ -498,6 +500,7 @@ void GBAudioUpdateFrame(struct GBAudio* audio, struct mTiming* timing) {
 		audio->skipFrame = false;
 		return;
 	}
+	GBAudioRun(audio, timestamp);
 	int frame = (audio->frame + 1) & 7;
 	audio->frame = frame;
 
@@ -518,7 +521,7 @@ void GBAudioUpdateFrame(struct GBAudio* audio, struct mTiming* timing) {
 		if (audio->ch1.control.length && audio->ch1.control.stop) {
 			--audio->ch1.control.length;
 			if (audio->ch1.control.length == 0) {
-				mTimingDeschedule(timing, &audio->ch1Event);
+				audio->ch1Edge.pending = false;
 				audio->playingCh1 = 0;
 				*audio->nr52 &= ~0x0001;
 			}
@@ -527,7 +530,7 @@ void GBAudioUpdateFrame(struct GBAudio* audio, struct mTiming* timing) {
 		if (audio->ch2.control.length && audio->ch2.control.stop) {
 			--audio->ch2.control.length;
 			if (audio->ch2.control.length == 0) {
-				mTimingDeschedule(timing, &audio->ch2Event);
+				audio->ch2Edge.pending = false;
 				audio->playingCh2 = 0;
 				*audio->nr52 &= ~0x0002;
 			}
@@ -536,7 +539,7 @@ void GBAudioUpdateFrame(struct GBAudio* audio, struct mTiming* timing) {
 		if (audio->ch3.length && audio->ch3.stop) {
 			--audio->ch3.length;
 			if (audio->ch3.length == 0) {
-				mTimingDeschedule(timing, &audio->ch3Event);
+				audio->ch3Edge.pending = false;
 				audio->playingCh3 = 0;
 				*audio->nr52 &= ~0x0004;
 			}
@@ -545,7 +548,7 @@ void GBAudioUpdateFrame(struct GBAudio* audio, struct mTiming* timing) {
 		if (audio->ch4.length && audio->ch4.stop) {
 			--audio->ch4.length;
 			if (audio->ch4.length == 0) {
-				mTimingDeschedule(timing, &audio->ch4Event);
+				audio->ch4Edge.pending = false;
 				audio->playingCh4 = 0;
 				*audio->nr52 &= ~0x0008;
 			}
@@ -557,7 +560,7 @@ void GBAudioUpdateFrame(struct GBAudio* audio, struct mTiming* timing) {
 			if (audio->ch1.envelope.nextStep == 0) {
 				_updateEnvelope(&audio->ch1.envelope);
 				if (audio->ch1.envelope.dead == 2) {
-					mTimingDeschedule(timing, &audio->ch1Event);
+					audio->ch1Edge.pending = false;
 				}
 				_updateSquareSample(&audio->ch1);
 			}
@@ -568,7 +571,7 @@ void GBAudioUpdateFrame(struct GBAudio* audio, struct mTiming* timing) {
 			if (audio->ch2.envelope.nextStep == 0) {
 				_updateEnvelope(&audio->ch2.envelope);
 				if (audio->ch2.envelope.dead == 2) {
-					mTimingDeschedule(timing, &audio->ch2Event);
+					audio->ch2Edge.pending = false;
 				}
 				_updateSquareSample(&audio->ch2);
 			}
@@ -581,7 +584,7 @@ void GBAudioUpdateFrame(struct GBAudio* audio, struct mTiming* timing) {
 				audio->ch4.samples -= audio->ch4.sample;
 				_updateEnvelope(&audio->ch4.envelope);
 				if (audio->ch4.envelope.dead == 2) {
-					mTimingDeschedule(timing, &audio->ch4Event);
+					audio->ch4Edge.pending = false;
 				}
 				audio->ch4.sample = sample * audio->ch4.envelope.currentVolume;
 				audio->ch4.samples += audio->ch4.sample;
@@ -646,6 +649,17 @@ void GBAudioSamplePSG(struct GBAudio* audio, int16_t* left, int16_t* right) {
 
 static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 	struct GBAudio* audio = user;
+	if (audio->skipSynthesis) {
+		// Register accesses and the frame sequencer still run the channels often enough on their own
+		mTimingSchedule(timing, &audio->sampleEvent, audio->sampleInterval * audio->timingFactor - cyclesLate);
+		return;
+	}
+	// Channels still have to keep up when nothing is output, or catching up later would take ages
+	GBAudioRun(audio, mTimingCurrentTime(timing) - cyclesLate + 1);
+	if (audio->suppressOutput) {
+		mTimingSchedule(timing, &audio->sampleEvent, audio->sampleInterval * audio->timingFactor - cyclesLate);
+		return;
+	}
 	int16_t sampleLeft = 0;
 	int16_t sampleRight = 0;
 	GBAudioSamplePSG(audio, &sampleLeft, &sampleRight);
@@ -679,7 +693,7 @@ static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 		audio->p->stream->postAudioFrame(audio->p->stream, sampleLeft, sampleRight);
 	}
 	bool wait = produced >= audio->samples;
-	if (!mCoreSyncProduceAudio(audio->p->sync, audio->left, audio->samples)) {
+	if (!mCoreSyncProduceAudio(audio->p->sync, audio->left, audio->right, audio->samples)) {
 		// Interrupted
 		audio->p->earlyExit = true;
 	}
@@ -831,22 +845,75 @@ static bool _updateSweep(struct GBAudioSquareChannel* ch, bool initial) {
 	return true;
 }
 
-static void _updateChannel1(struct mTiming* timing, void* user, uint32_t cyclesLate) {
-	struct GBAudio* audio = user;
-	struct GBAudioSquareChannel* ch = &audio->ch1;
-	int cycles = _updateSquareChannel(ch);
-	mTimingSchedule(timing, &audio->ch1Event, audio->timingFactor * cycles - cyclesLate);
+static bool _edgeDue(const struct GBAudioEdge* edge, int32_t timestamp) {
+	return edge->pending && (int32_t) (timestamp - edge->when) > 0;
 }
 
-static void _updateChannel2(struct mTiming* timing, void* user, uint32_t cyclesLate) {
-	struct GBAudio* audio = user;
-	struct GBAudioSquareChannel* ch = &audio->ch2;
-	int cycles = _updateSquareChannel(ch);
-	mTimingSchedule(timing, &audio->ch2Event, audio->timingFactor * cycles - cyclesLate);
+static void _runSquareChannel(struct GBAudioSquareChannel* ch, struct GBAudioEdge* edge, unsigned timingFactor, int32_t timestamp) {
+	if (!_edgeDue(edge, timestamp)) {
+		return;
+	}
+	// A whole duty cycle flips the output twice and leaves it where it started, so only the last one needs stepping
+	int32_t cycle = timingFactor * 32 * (2048 - ch->control.frequency);
+	int32_t behind = timestamp - edge->when;
+	if (behind > cycle) {
+		edge->when += cycle * ((behind - 1) / cycle);
+	}
+	while (_edgeDue(edge, timestamp)) {
+		edge->when += timingFactor * _updateSquareChannel(ch);
+	}
 }
 
-static void _updateChannel3(struct mTiming* timing, void* user, uint32_t cyclesLate) {
-	struct GBAudio* audio = user;
+static void _runChannel3(struct GBAudio* audio, int32_t timestamp) {
+	if (_edgeDue(&audio->ch3Edge, timestamp)) {
+		int32_t period = audio->timingFactor * 2 * (2048 - audio->ch3.rate);
+		int32_t steps = (timestamp - audio->ch3Edge.when - 1) / period + 1;
+		int32_t last = audio->ch3Edge.when + (steps - 1) * period;
+		_updateChannel3(audio, steps);
+		audio->ch3.readable = true;
+		if (audio->style == GB_AUDIO_DMG) {
+			audio->ch3Fade.when = last + 2;
+			audio->ch3Fade.pending = true;
+		}
+		audio->ch3Edge.when = last + period;
+	}
+	if (_edgeDue(&audio->ch3Fade, timestamp)) {
+		audio->ch3Fade.pending = false;
+		audio->ch3.readable = false;
+	}
+}
+
+static void _runChannel4(struct GBAudio* audio, int32_t timestamp) {
+	struct GBAudioNoiseChannel* ch = &audio->ch4;
+	if (!_edgeDue(&audio->ch4Edge, timestamp)) {
+		return;
+	}
+	int32_t cycles = ch->ratio ? 2 * ch->ratio : 1;
+	cycles <<= ch->frequency;
+	cycles *= 8 * audio->timingFactor;
+	if (audio->skipSynthesis) {
+		audio->ch4Edge.when += cycles * ((timestamp - audio->ch4Edge.when - 1) / cycles + 1);
+		return;
+	}
+	while (_edgeDue(&audio->ch4Edge, timestamp)) {
+		_updateChannel4(audio);
+		audio->ch4Edge.when += cycles;
+	}
+}
+
+void GBAudioRun(struct GBAudio* audio, int32_t timestamp) {
+	_runSquareChannel(&audio->ch1, &audio->ch1Edge, audio->timingFactor, timestamp);
+	_runSquareChannel(&audio->ch2, &audio->ch2Edge, audio->timingFactor, timestamp);
+	_runChannel3(audio, timestamp);
+	_runChannel4(audio, timestamp);
+}
+
+void GBAudioSync(struct GBAudio* audio) {
+	// The GB CPU gets to an access before any edges due on the same cycle, but the GBA's gets there after them
+	GBAudioRun(audio, mTimingCurrentTime(audio->timing) + (audio->style == GB_AUDIO_GBA));
+}
+
+static void _updateChannel3(struct GBAudio* audio, int32_t steps) {
 	struct GBAudioWaveChannel* ch = &audio->ch3;
 	int i;
 	int volume;
@@ -870,7 +937,7 @@ static void _updateChannel3(struct mTiming* timing, void* user, uint32_t cyclesL
 	switch (audio->style) {
 	case GB_AUDIO_DMG:
 	default:
-		++ch->window;
+		ch->window += steps;
 		ch->window &= 0x1F;
 		ch->sample = ch->wavedata8[ch->window >> 1];
 		if (!(ch->window & 1)) {
@@ -889,13 +956,18 @@ static void _updateChannel3(struct mTiming* timing, void* user, uint32_t cyclesL
 			start = 3;
 			end = 0;
 		}
-		uint32_t bitsCarry = ch->wavedata32[end] & 0x000000F0;
-		uint32_t bits;
-		for (i = start; i >= end; --i) {
-			bits = ch->wavedata32[i] & 0x000000F0;
-			ch->wavedata32[i] = ((ch->wavedata32[i] & 0x0F0F0F0F) << 4) | ((ch->wavedata32[i] & 0xF0F0F000) >> 12);
-			ch->wavedata32[i] |= bitsCarry << 20;
-			bitsCarry = bits;
+		// Each step rotates the bank(s) by a sample, so whole trips around them can be dropped
+		steps = (steps - 1) % ((start - end + 1) * 8) + 1;
+		uint32_t bitsCarry = 0;
+		for (; steps; --steps) {
+			bitsCarry = ch->wavedata32[end] & 0x000000F0;
+			uint32_t bits;
+			for (i = start; i >= end; --i) {
+				bits = ch->wavedata32[i] & 0x000000F0;
+				ch->wavedata32[i] = ((ch->wavedata32[i] & 0x0F0F0F0F) << 4) | ((ch->wavedata32[i] & 0xF0F0F000) >> 12);
+				ch->wavedata32[i] |= bitsCarry << 20;
+				bitsCarry = bits;
+			}
 		}
 		ch->sample = bitsCarry >> 4;
 		break;
@@ -904,37 +976,16 @@ static void _updateChannel3(struct mTiming* timing, void* user, uint32_t cyclesL
 		ch->sample += ch->sample << 1;
 	}
 	ch->sample >>= volume;
-	audio->ch3.readable = true;
-	if (audio->style == GB_AUDIO_DMG) {
-		mTimingDeschedule(audio->timing, &audio->ch3Fade);
-		mTimingSchedule(timing, &audio->ch3Fade, 2 - cyclesLate);
-	}
-	int cycles = 2 * (2048 - ch->rate);
-	mTimingSchedule(timing, &audio->ch3Event, audio->timingFactor * cycles - cyclesLate);
-}
-static void _fadeChannel3(struct mTiming* timing, void* user, uint32_t cyclesLate) {
-	UNUSED(timing);
-	UNUSED(cyclesLate);
-	struct GBAudio* audio = user;
-	audio->ch3.readable = false;
 }
 
-static void _updateChannel4(struct mTiming* timing, void* user, uint32_t cyclesLate) {
-	struct GBAudio* audio = user;
+static void _updateChannel4(struct GBAudio* audio) {
 	struct GBAudioNoiseChannel* ch = &audio->ch4;
-
-	int32_t cycles = ch->ratio ? 2 * ch->ratio : 1;
-	cycles <<= ch->frequency;
-	cycles *= 8 * audio->timingFactor;
-
 	int lsb = ch->lfsr & 1;
 	ch->sample = lsb * ch->envelope.currentVolume;
 	++ch->nSamples;
 	ch->samples += ch->sample;
 	ch->lfsr >>= 1;
 	ch->lfsr ^= (lsb * 0x60) << (ch->power ? 0 : 8);
-
-	mTimingSchedule(timing, &audio->ch4Event, cycles - cyclesLate);
 }
 
 void GBAudioPSGSerialize(const struct GBAudio* audio, struct GBSerializedPSGState* state, uint32_t* flagsOut) {
@@ -956,7 +1007,7 @@ void GBAudioPSGSerialize(const struct GBAudio* audio, struct GBSerializedPSGStat
 	ch1Flags = GBSerializedAudioEnvelopeSetNextStep(ch1Flags, audio->ch1.envelope.nextStep);
 	ch1Flags = GBSerializedAudioEnvelopeSetFrequency(ch1Flags, audio->ch1.sweep.realFrequency);
 	STORE_32LE(ch1Flags, 0, &state->ch1.envelope);
-	STORE_32LE(audio->ch1Event.when - mTimingCurrentTime(audio->timing), 0, &state->ch1.nextEvent);
+	STORE_32LE(audio->ch1Edge.when - mTimingCurrentTime(audio->timing), 0, &state->ch1.nextEvent);
 
 	flags = GBSerializedAudioFlagsSetCh2Volume(flags, audio->ch2.envelope.currentVolume);
 	flags = GBSerializedAudioFlagsSetCh2Dead(flags, audio->ch2.envelope.dead);
@@ -964,12 +1015,12 @@ void GBAudioPSGSerialize(const struct GBAudio* audio, struct GBSerializedPSGStat
 	ch2Flags = GBSerializedAudioEnvelopeSetLength(ch2Flags, audio->ch2.control.length);
 	ch2Flags = GBSerializedAudioEnvelopeSetNextStep(ch2Flags, audio->ch2.envelope.nextStep);
 	STORE_32LE(ch2Flags, 0, &state->ch2.envelope);
-	STORE_32LE(audio->ch2Event.when - mTimingCurrentTime(audio->timing), 0, &state->ch2.nextEvent);
+	STORE_32LE(audio->ch2Edge.when - mTimingCurrentTime(audio->timing), 0, &state->ch2.nextEvent);
 
 	flags = GBSerializedAudioFlagsSetCh3Readable(flags, audio->ch3.readable);
 	memcpy(state->ch3.wavebanks, audio->ch3.wavedata32, sizeof(state->ch3.wavebanks));
 	STORE_16LE(audio->ch3.length, 0, &state->ch3.length);
-	STORE_32LE(audio->ch3Event.when - mTimingCurrentTime(audio->timing), 0, &state->ch3.nextEvent);
+	STORE_32LE(audio->ch3Edge.when - mTimingCurrentTime(audio->timing), 0, &state->ch3.nextEvent);
 	STORE_32LE(audio->ch3Fade.when - mTimingCurrentTime(audio->timing), 0, &state->ch1.nextCh3Fade);
 
 	flags = GBSerializedAudioFlagsSetCh4Volume(flags, audio->ch4.envelope.currentVolume);
@@ -978,7 +1029,7 @@ void GBAudioPSGSerialize(const struct GBAudio* audio, struct GBSerializedPSGStat
 	ch4Flags = GBSerializedAudioEnvelopeSetLength(ch4Flags, audio->ch4.length);
 	ch4Flags = GBSerializedAudioEnvelopeSetNextStep(ch4Flags, audio->ch4.envelope.nextStep);
 	STORE_32LE(ch4Flags, 0, &state->ch4.envelope);
-	STORE_32LE(audio->ch4Event.when - mTimingCurrentTime(audio->timing), 0, &state->ch4.nextEvent);
+	STORE_32LE(audio->ch4Edge.when - mTimingCurrentTime(audio->timing), 0, &state->ch4.nextEvent);
 
 	STORE_32LE(flags, 0, flagsOut);
 }
@@ -1016,7 +1067,10 @@ void GBAudioPSGDeserialize(struct GBAudio* audio, const struct GBSerializedPSGSt
 	audio->ch1.sweep.realFrequency = GBSerializedAudioEnvelopeGetFrequency(ch1Flags);
 	LOAD_32LE(when, 0, &state->ch1.nextEvent);
 	if (audio->ch1.envelope.dead < 2 && audio->playingCh1) {
-		mTimingSchedule(audio->timing, &audio->ch1Event, when);
+		audio->ch1Edge.when = mTimingCurrentTime(audio->timing) + (int32_t) when;
+		audio->ch1Edge.pending = true;
+	} else {
+		audio->ch1Edge.pending = false;
 	}
 
 	LOAD_32LE(ch2Flags, 0, &state->ch2.envelope);
@@ -1027,7 +1081,10 @@ void GBAudioPSGDeserialize(struct GBAudio* audio, const struct GBSerializedPSGSt
 	audio->ch2.envelope.nextStep = GBSerializedAudioEnvelopeGetNextStep(ch2Flags);
 	LOAD_32LE(when, 0, &state->ch2.nextEvent);
 	if (audio->ch2.envelope.dead < 2 && audio->playingCh2) {
-		mTimingSchedule(audio->timing, &audio->ch2Event, when);
+		audio->ch2Edge.when = mTimingCurrentTime(audio->timing) + (int32_t) when;
+		audio->ch2Edge.pending = true;
+	} else {
+		audio->ch2Edge.pending = false;
 	}
 
 	audio->ch3.readable = GBSerializedAudioFlagsGetCh3Readable(flags);
@@ -1036,11 +1093,17 @@ void GBAudioPSGDeserialize(struct GBAudio* audio, const struct GBSerializedPSGSt
 	LOAD_16LE(audio->ch3.length, 0, &state->ch3.length);
 	LOAD_32LE(when, 0, &state->ch3.nextEvent);
 	if (audio->playingCh3) {
-		mTimingSchedule(audio->timing, &audio->ch3Event, when);
+		audio->ch3Edge.when = mTimingCurrentTime(audio->timing) + (int32_t) when;
+		audio->ch3Edge.pending = true;
+	} else {
+		audio->ch3Edge.pending = false;
 	}
 	LOAD_32LE(when, 0, &state->ch1.nextCh3Fade);
 	if (audio->ch3.readable && audio->style == GB_AUDIO_DMG) {
-		mTimingSchedule(audio->timing, &audio->ch3Fade, when);
+		audio->ch3Fade.when = mTimingCurrentTime(audio->timing) + (int32_t) when;
+		audio->ch3Fade.pending = true;
+	} else {
+		audio->ch3Fade.pending = false;
 	}
 
 	LOAD_32LE(ch4Flags, 0, &state->ch4.envelope);
@@ -1051,7 +1114,10 @@ void GBAudioPSGDeserialize(struct GBAudio* audio, const struct GBSerializedPSGSt
 	LOAD_32LE(audio->ch4.lfsr, 0, &state->ch4.lfsr);
 	LOAD_32LE(when, 0, &state->ch4.nextEvent);
 	if (audio->ch4.envelope.dead < 2 && audio->playingCh4) {
-		mTimingSchedule(audio->timing, &audio->ch4Event, when);
+		audio->ch4Edge.when = mTimingCurrentTime(audio->timing) + (int32_t) when;
+		audio->ch4Edge.pending = true;
+	} else {
+		audio->ch4Edge.pending = false;
 	}
 }
 
@@ -58,6 +58,39 @@ static void _unpatchROM(struct mCheatDevice* device, struct GBCheatSet* cheats)
 	}
 }
 
+static void _updateRegions(struct mCheatDevice* device) {
+	struct GB* gb = device->p->board;
+	struct GBMemory* memory = &gb->memory;
+	// OAM DMA can lock the CPU out of work RAM, so leave those accesses to the bus
+	bool dma = memory->dmaRemaining;
+	device->regions[0] = (struct mCheatMemoryRegion) {
+		.start = GB_BASE_WORKING_RAM_BANK0,
+		.end = GB_BASE_WORKING_RAM_BANK1,
+		.mask = GB_SIZE_WORKING_RAM_BANK0 - 1,
+		.size = GB_SIZE_WORKING_RAM_BANK0,
+		.memory = dma || !memory->wram ? NULL : memory->wram,
+		.dirty = &memory->wramDirtyPages
+	};
+	device->regions[1] = (struct mCheatMemoryRegion) {
+		.start = GB_BASE_WORKING_RAM_BANK1,
+		.end = GB_BASE_WORKING_RAM_BANK1 + GB_SIZE_WORKING_RAM_BANK0,
+		.mask = GB_SIZE_WORKING_RAM_BANK0 - 1,
+		.size = GB_SIZE_WORKING_RAM_BANK0,
+		.memory = dma || !memory->wramBank ? NULL : memory->wramBank,
+		.dirty = &memory->wramDirtyPages,
+		.dirtyBase = memory->wramBank - memory->wram
+	};
+	device->regions[2] = (struct mCheatMemoryRegion) {
+		.start = GB_BASE_HRAM,
+		.end = GB_BASE_IE,
+		.mask = GB_SIZE_HRAM,
+		.size = GB_SIZE_HRAM,
+		.memory = memory->hram,
+		.dirty = &memory->hramDirtyPages
+	};
+	device->nRegions = 3;
+}
+
 static void GBCheatSetDeinit(struct mCheatSet* set);
 static void GBCheatAddSet(struct mCheatSet* cheats, struct mCheatDevice* device);
 static void GBCheatRemoveSet(struct mCheatSet* cheats, struct mCheatDevice* device);
@@ -92,6 +125,7 @@ struct mCheatDevice* GBCheatDeviceCreate(void) {
 	struct mCheatDevice* device = malloc(sizeof(*device));
 	mCheatDeviceCreate(device);
 	device->createSet = GBCheatSetCreate;
+	device->updateRegions = _updateRegions;
 	return device;
 }
 
@@ -15,6 +15,9 @@
 #include <mgba/internal/gb/gb.h>
 #include <mgba/internal/gb/mbc.h>
 #include <mgba/internal/gb/overrides.h>
+#ifdef BUILD_GLES2
+#include <mgba/internal/gb/renderers/gl.h>
+#endif
 #include <mgba/internal/gb/renderers/software.h>
 #include <mgba/internal/gb/renderers/proxy.h>
 #include <mgba/internal/gb/serialize.h>
@@ -64,6 +67,9 @@ struct mVideoLogContext;
 struct GBCore {
 	struct mCore d;
 	struct GBVideoSoftwareRenderer renderer;
+#ifdef BUILD_GLES2
+	struct GBVideoGLRenderer glRenderer;
+#endif
 	struct GBVideoProxyRenderer proxyRenderer;
 	struct mVideoLogContext* logContext;
 	struct mCoreCallbacks logCallbacks;
@@ -90,6 +96,7 @@ static bool _GBCoreInit(struct mCore* core) {
 	gbcore->overrides = NULL;
 	gbcore->debuggerPlatform = NULL;
 	gbcore->cheatDevice = NULL;
+	gbcore->logContext = NULL;
 
 	GBCreate(gb);
 	memset(gbcore->components, 0, sizeof(gbcore->components));
@@ -101,6 +108,11 @@ static bool _GBCoreInit(struct mCore* core) {
 	GBVideoSoftwareRendererCreate(&gbcore->renderer);
 	gbcore->renderer.outputBuffer = NULL;
 
+#ifdef BUILD_GLES2
+	GBVideoGLRendererCreate(&gbcore->glRenderer);
+	gbcore->glRenderer.outputTex = -1;
+#endif
+
 	gbcore->keys = 0;
 	gb->keySource = &gbcore->keys;
 
@@ -141,6 +153,12 @@ static enum mPlatform _GBCorePlatform(const struct mCore* core) {
 static bool _GBCoreSupportsFeature(const struct mCore* core, enum mCoreFeature feature) {
 	UNUSED(core);
 	switch (feature) {
+	case mCORE_FEATURE_OPENGL:
+#ifdef BUILD_GLES2
+		return true;
+#else
+		return false;
+#endif
 	default:
 		return false;
 	}
@@ -160,6 +178,7 @@ static void _GBCoreLoadConfig(struct mCore* core, const struct mCoreConfig* conf
 	} else {
 		gb->audio.masterVolume = core->opts.volume;
 	}
+	gb->audio.skipSynthesis = core->opts.skipAudio;
 	gb->video.frameskip = core->opts.frameskip;
 
 	int color;
@@ -208,6 +227,8 @@ static void _GBCoreLoadConfig(struct mCore* core, const struct mCoreConfig* conf
 	mCoreConfigCopyValue(&core->config, config, "cgb.model");
 	mCoreConfigCopyValue(&core->config, config, "useCgbColors");
 	mCoreConfigCopyValue(&core->config, config, "allowOpposingDirections");
+	mCoreConfigCopyValue(&core->config, config, "hwaccelVideo");
+	mCoreConfigCopyValue(&core->config, config, "videoScale");
 
 	int fakeBool = 0;
 	mCoreConfigGetIntValue(config, "allowOpposingDirections", &fakeBool);
@@ -226,12 +247,19 @@ static void _GBCoreLoadConfig(struct mCore* core, const struct mCoreConfig* conf
 
 static void _GBCoreDesiredVideoDimensions(struct mCore* core, unsigned* width, unsigned* height) {
 	struct GB* gb = core->board;
+#ifdef BUILD_GLES2
+	struct GBCore* gbcore = (struct GBCore*) core;
+	int scale = gbcore->glRenderer.scale;
+#else
+	int scale = 1;
+#endif
+
 	if (gb && (!(gb->model & GB_MODEL_SGB) || !gb->video.sgbBorders)) {
-		*width = GB_VIDEO_HORIZONTAL_PIXELS;
-		*height = GB_VIDEO_VERTICAL_PIXELS;
+		*width = GB_VIDEO_HORIZONTAL_PIXELS * scale;
+		*height = GB_VIDEO_VERTICAL_PIXELS * scale;
 	} else {
-		*width = 256;
-		*height = 224;
+		*width = 256 * scale;
+		*height = 224 * scale;
 	}
 }
 
@@ -241,19 +269,49 @@ static void _GBCoreSetVideoBuffer(struct mCore* core, color_t* buffer, size_t st
 	gbcore->renderer.outputBufferStride = stride;
 }
 
+static bool _GBCoreSetVideoBufferFormat(struct mCore* core, enum mColorFormat format) {
+	UNUSED(core);
+	// The GB renderer writes pixels straight into the buffer as it goes, so it only draws color_t
+	return format == mCOLOR_NATIVE;
+}
+
+static enum mColorFormat _GBCoreVideoBufferFormat(const struct mCore* core) {
+	UNUSED(core);
+	return mCOLOR_NATIVE;
+}
+
 static void _GBCoreSetVideoGLTex(struct mCore* core, unsigned texid) {
+#ifdef BUILD_GLES2
+	struct GBCore* gbcore = (struct GBCore*) core;
+	gbcore->glRenderer.outputTex = texid;
+#else
 	UNUSED(core);
 	UNUSED(texid);
+#endif
 }
 
-static void _GBCoreGetPixels(struct mCore* core, const void** buffer, size_t* stride) {
+static struct GBVideoRenderer* _GBCoreActiveRenderer(struct mCore* core) {
 	struct GBCore* gbcore = (struct GBCore*) core;
-	gbcore->renderer.d.getPixels(&gbcore->renderer.d, stride, buffer);
+#ifdef BUILD_GLES2
+	struct GB* gb = core->board;
+	if (gb->video.renderer == &gbcore->glRenderer.d) {
+		return &gbcore->glRenderer.d;
+	}
+	if (gb->video.renderer == &gbcore->proxyRenderer.d && gbcore->proxyRenderer.backend == &gbcore->glRenderer.d) {
+		return &gbcore->glRenderer.d;
+	}
+#endif
+	return &gbcore->renderer.d;
+}
+
+static void _GBCoreGetPixels(struct mCore* core, const void** buffer, size_t* stride) {
+	struct GBVideoRenderer* renderer = _GBCoreActiveRenderer(core);
+	renderer->getPixels(renderer, stride, buffer);
 }
 
 static void _GBCorePutPixels(struct mCore* core, const void* buffer, size_t stride) {
-	struct GBCore* gbcore = (struct GBCore*) core;
-	gbcore->renderer.d.putPixels(&gbcore->renderer.d, stride, buffer);
+	struct GBVideoRenderer* renderer = _GBCoreActiveRenderer(core);
+	renderer->putPixels(renderer, stride, buffer);
 }
 
 static struct blip_t* _GBCoreGetAudioChannel(struct mCore* core, int ch) {
@@ -298,6 +356,40 @@ static void _GBCoreSetAVStream(struct mCore* core, struct mAVStream* stream) {
 	}
 }
 
+static void _GBCoreSetOutputSuppressed(struct mCore* core, bool video, bool audio) {
+	struct GB* gb = core->board;
+	if (video != gb->video.suppressOutput) {
+		gb->video.suppressOutput = video;
+		gb->video.frameskipCounter = video;
+	}
+	gb->audio.suppressOutput = audio;
+}
+
+static bool _GBCoreSetPerfCounters(struct mCore* core, struct mPerfCounters* counters) {
+#ifdef ENABLE_PERF_COUNTERS
+	struct GB* gb = core->board;
+	gb->cpu->perfCounters = counters;
+	gb->timing.perfCounters = counters;
+	return true;
+#else
+	UNUSED(core);
+	UNUSED(counters);
+	return false;
+#endif
+}
+
+static bool _GBCoreSetMemoryHeatmap(struct mCore* core, struct mMemoryHeatmap* heatmap) {
+#ifdef ENABLE_PERF_COUNTERS
+	struct GB* gb = core->board;
+	gb->cpu->heatmap = heatmap;
+	return true;
+#else
+	UNUSED(core);
+	UNUSED(heatmap);
+	return false;
+#endif
+}
+
 static bool _GBCoreLoadROM(struct mCore* core, struct VFile* vf) {
 	return GBLoadROM(core->board, vf);
 }
@@ -345,18 +437,45 @@ static void _GBCoreUnloadROM(struct mCore* core) {
 static void _GBCoreChecksum(const struct mCore* core, void* data, enum mCoreChecksumType type) {
 	struct GB* gb = (struct GB*) core->board;
 	switch (type) {
-	case CHECKSUM_CRC32:
-		memcpy(data, &gb->romCrc32, sizeof(gb->romCrc32));
+	case CHECKSUM_CRC32: {
+		uint32_t crc32 = GBGetROMCrc32(gb);
+		memcpy(data, &crc32, sizeof(crc32));
 		break;
 	}
+	}
 	return;
 }
 
+static void _GBCoreMarkMemoryDirty(struct GB* gb) {
+	mCoreMemoryDirtyMarkAll(&gb->memory.vramDirtyPages);
+	mCoreMemoryDirtyMarkAll(&gb->memory.sramDirtyPages);
+	mCoreMemoryDirtyMarkAll(&gb->memory.wramDirtyPages);
+	mCoreMemoryDirtyMarkAll(&gb->memory.oamDirtyPages);
+	mCoreMemoryDirtyMarkAll(&gb->memory.hramDirtyPages);
+}
+
+static struct GBVideoRenderer* _GBCoreSelectRenderer(struct mCore* core) {
+	struct GBCore* gbcore = (struct GBCore*) core;
+	struct GBVideoRenderer* renderer = NULL;
+	if (gbcore->renderer.outputBuffer) {
+		renderer = &gbcore->renderer.d;
+	}
+#ifdef BUILD_GLES2
+	int fakeBool;
+	if (gbcore->glRenderer.outputTex != (unsigned) -1 && mCoreConfigGetIntValue(&core->config, "hwaccelVideo", &fakeBool) && fakeBool) {
+		renderer = &gbcore->glRenderer.d;
+		mCoreConfigGetIntValue(&core->config, "videoScale", &gbcore->glRenderer.scale);
+	}
+#endif
+	return renderer;
+}
+
 static void _GBCoreReset(struct mCore* core) {
 	struct GBCore* gbcore = (struct GBCore*) core;
 	struct GB* gb = (struct GB*) core->board;
-	if (gbcore->renderer.outputBuffer) {
-		GBVideoAssociateRenderer(&gb->video, &gbcore->renderer.d);
+	struct GBVideoRenderer* renderer = _GBCoreSelectRenderer(core);
+	if (renderer) {
+		GBVideoAssociateRenderer(&gb->video, renderer);
 	}
 
 	if (gb->memory.rom) {
@@ -466,6 +585,7 @@ static void _GBCoreReset(struct mCore* core) {
 	if (core->opts.skipBios) {
 		GBSkipBIOS(core->board);
 	}
+	_GBCoreMarkMemoryDirty(gb);
 }
 
 static void _GBCoreRunFrame(struct mCore* core) {
@@ -493,7 +613,11 @@ static size_t _GBCoreStateSize(struct mCore* core) {
 }
 
 static bool _GBCoreLoadState(struct mCore* core, const void* state) {
-	return GBDeserialize(core->board, state);
+	if (!GBDeserialize(core->board, state)) {
+		return false;
+	}
+	_GBCoreMarkMemoryDirty(core->board);
+	return true;
 }
 
 static bool _GBCoreSaveState(struct mCore* core, void* state) {
@@ -522,6 +646,11 @@ static void _GBCoreClearKeys(struct mCore* core, uint32_t keys) {
 	gbcore->keys &= ~keys;
 }
 
+static uint32_t _GBCoreGetKeys(struct mCore* core) {
+	struct GBCore* gbcore = (struct GBCore*) core;
+	return gbcore->keys;
+}
+
 static int32_t _GBCoreFrameCounter(const struct mCore* core) {
 	const struct GB* gb = core->board;
 	return gb->video.frameCounter;
@@ -677,6 +806,64 @@ void* _GBGetMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
 	}
 }
 
+static struct mCoreMemoryDirty* _GBMemoryBlockDirty(struct GB* gb, size_t id, size_t* sizeOut) {
+	switch (id) {
+	case GB_REGION_VRAM:
+		*sizeOut = GB_SIZE_VRAM;
+		return &gb->memory.vramDirtyPages;
+	case GB_REGION_EXTERNAL_RAM:
+		*sizeOut = gb->sramSize;
+		return &gb->memory.sramDirtyPages;
+	case GB_REGION_WORKING_RAM_BANK0:
+		*sizeOut = GB_SIZE_WORKING_RAM;
+		return &gb->memory.wramDirtyPages;
+	case GB_BASE_OAM:
+		*sizeOut = GB_SIZE_OAM;
+		return &gb->memory.oamDirtyPages;
+	case GB_BASE_HRAM:
+		*sizeOut = GB_SIZE_HRAM;
+		return &gb->memory.hramDirtyPages;
+	default:
+		return NULL;
+	}
+}
+
+static bool _GBTrackMemoryBlockDirty(struct mCore* core, size_t id, bool enable) {
+	size_t size;
+	struct mCoreMemoryDirty* dirty = _GBMemoryBlockDirty(core->board, id, &size);
+	if (!dirty) {
+		return false;
+	}
+	if (!enable) {
+		mCoreMemoryDirtyDeinit(dirty);
+	} else if (!dirty->bitmap) {
+		mCoreMemoryDirtyInit(dirty, size);
+	}
+	return true;
+}
+
+static const uint32_t* _GBGetMemoryBlockDirty(struct mCore* core, size_t id, size_t* pagesOut) {
+	size_t size;
+	struct mCoreMemoryDirty* dirty = _GBMemoryBlockDirty(core->board, id, &size);
+	if (!dirty || !dirty->bitmap) {
+		return NULL;
+	}
+	*pagesOut = dirty->nPages;
+	return dirty->bitmap;
+}
+
+static void _GBClearMemoryBlockDirty(struct mCore* core, size_t id) {
+	size_t size;
+	struct mCoreMemoryDirty* dirty = _GBMemoryBlockDirty(core->board, id, &size);
+	if (dirty) {
+		mCoreMemoryDirtyClear(dirty);
+	}
+}
+
+static void _GBSetMemoryHook(struct mCore* core, struct mCoreMemoryHook* hook) {
+	GBMemorySetHook(core->board, hook);
+}
+
 #ifdef USE_DEBUGGERS
 static bool _GBCoreSupportsDebuggerType(struct mCore* core, enum mDebuggerType type) {
 	UNUSED(core);
@@ -773,8 +960,19 @@ static size_t _GBCoreSavedataClone(struct mCore* core, void** sram) {
 	return gb->sramSize;
 }
 
+static size_t _GBCoreSavedataView(struct mCore* core, const void** sram) {
+	struct GB* gb = core->board;
+	if (!gb->memory.sram || !gb->sramSize) {
+		*sram = NULL;
+		return 0;
+	}
+	*sram = gb->memory.sram;
+	return gb->sramSize;
+}
+
 static bool _GBCoreSavedataRestore(struct mCore* core, const void* sram, size_t size, bool writeback) {
 	struct GB* gb = core->board;
+	mCoreMemoryDirtyMarkAll(&gb->memory.sramDirtyPages);
 	if (!writeback) {
 		struct VFile* vf = VFileMemChunk(sram, size);
 		GBSavedataMask(gb, vf, true);
@@ -846,14 +1044,26 @@ static void _GBCoreAdjustVideoLayer(struct mCore* core, size_t id, int32_t x, in
 	case 0:
 		gbcore->renderer.offsetScx = x;
 		gbcore->renderer.offsetScy = y;
+#ifdef BUILD_GLES2
+		gbcore->glRenderer.offsetScx = x;
+		gbcore->glRenderer.offsetScy = y;
+#endif
 		break;
 	case 1:
 		gbcore->renderer.offsetWx = x;
 		gbcore->renderer.offsetWy = y;
+#ifdef BUILD_GLES2
+		gbcore->glRenderer.offsetWx = x;
+		gbcore->glRenderer.offsetWy = y;
+#endif
 		break;
 	case 2:
 		gbcore->renderer.objOffsetX = x;
 		gbcore->renderer.objOffsetY = y;
+#ifdef BUILD_GLES2
+		gbcore->glRenderer.objOffsetX = x;
+		gbcore->glRenderer.objOffsetY = y;
+#endif
 		break;
 	default:
 		return;
@@ -892,6 +1102,7 @@ struct mCore* GBCoreCreate(void) {
 	core->cpu = NULL;
 	core->board = NULL;
 	core->debugger = NULL;
+	core->asyncWriter = NULL;
 	core->symbolTable = NULL;
 	core->init = _GBCoreInit;
 	core->deinit = _GBCoreDeinit;
@@ -901,6 +1112,8 @@ struct mCore* GBCoreCreate(void) {
 	core->loadConfig = _GBCoreLoadConfig;
 	core->desiredVideoDimensions = _GBCoreDesiredVideoDimensions;
 	core->setVideoBuffer = _GBCoreSetVideoBuffer;
+	core->setVideoBufferFormat = _GBCoreSetVideoBufferFormat;
+	core->videoBufferFormat = _GBCoreVideoBufferFormat;
 	core->setVideoGLTex = _GBCoreSetVideoGLTex;
 	core->getPixels = _GBCoreGetPixels;
 	core->putPixels = _GBCorePutPixels;
@@ -908,6 +1121,9 @@ struct mCore* GBCoreCreate(void) {
 	core->setAudioBufferSize = _GBCoreSetAudioBufferSize;
 	core->getAudioBufferSize = _GBCoreGetAudioBufferSize;
 	core->setAVStream = _GBCoreSetAVStream;
+	core->setOutputSuppressed = _GBCoreSetOutputSuppressed;
+	core->setPerfCounters = _GBCoreSetPerfCounters;
+	core->setMemoryHeatmap = _GBCoreSetMemoryHeatmap;
 	core->addCoreCallbacks = _GBCoreAddCoreCallbacks;
 	core->clearCoreCallbacks = _GBCoreClearCoreCallbacks;
 	core->isROM = GBIsROM;
@@ -928,6 +1144,7 @@ struct mCore* GBCoreCreate(void) {
 	core->setKeys = _GBCoreSetKeys;
 	core->addKeys = _GBCoreAddKeys;
 	core->clearKeys = _GBCoreClearKeys;
+	core->getKeys = _GBCoreGetKeys;
 	core->frameCounter = _GBCoreFrameCounter;
 	core->frameCycles = _GBCoreFrameCycles;
 	core->frequency = _GBCoreFrequency;
@@ -948,6 +1165,10 @@ struct mCore* GBCoreCreate(void) {
 	core->rawWrite32 = _GBCoreRawWrite32;
 	core->listMemoryBlocks = _GBListMemoryBlocks;
 	core->getMemoryBlock = _GBGetMemoryBlock;
+	core->trackMemoryBlockDirty = _GBTrackMemoryBlockDirty;
+	core->getMemoryBlockDirty = _GBGetMemoryBlockDirty;
+	core->clearMemoryBlockDirty = _GBClearMemoryBlockDirty;
+	core->setMemoryHook = _GBSetMemoryHook;
 #ifdef USE_DEBUGGERS
 	core->supportsDebuggerType = _GBCoreSupportsDebuggerType;
 	core->debuggerPlatform = _GBCoreDebuggerPlatform;
@@ -959,6 +1180,7 @@ struct mCore* GBCoreCreate(void) {
 #endif
 	core->cheatDevice = _GBCoreCheatDevice;
 	core->savedataClone = _GBCoreSavedataClone;
+	core->savedataView = _GBCoreSavedataView;
 	core->savedataRestore = _GBCoreSavedataRestore;
 	core->listVideoLayers = _GBCoreListVideoLayers;
 	core->listAudioChannels = _GBCoreListAudioChannels;
@@ -1013,9 +1235,11 @@ static void _GBVLPReset(struct mCore* core) {
 	struct GB* gb = (struct GB*) core->board;
 	if (gb->video.renderer == &gbcore->proxyRenderer.d) {
 		GBVideoProxyRendererUnshim(&gb->video, &gbcore->proxyRenderer);
-	} else if (gbcore->renderer.outputBuffer) {
-		struct GBVideoRenderer* renderer = &gbcore->renderer.d;
-		GBVideoAssociateRenderer(&gb->video, renderer);
+	} else {
+		struct GBVideoRenderer* renderer = _GBCoreSelectRenderer(core);
+		if (renderer) {
+			GBVideoAssociateRenderer(&gb->video, renderer);
+		}
 	}
 
 	LR35902Reset(core->cpu);
@@ -1044,7 +1268,7 @@ static bool _GBVLPLoadState(struct mCore* core, const void* buffer) {
 	struct GB* gb = (struct GB*) core->board;
 	const struct GBSerializedState* state = buffer;
 
-	gb->timing.root = NULL;
+	mTimingClear(&gb->timing);
 	gb->model = state->model;
 
 	gb->cpu->pc = GB_BASE_HRAM;
@@ -1078,8 +1302,34 @@ struct mCore* GBVideoLogPlayerCreate(void) {
 	core->isROM = _returnTrue;
 	return core;
 }
+
+bool GBVideoLogPlayerSeek(struct mCore* core, uint32_t frame) {
+	struct GBCore* gbcore = (struct GBCore*) core;
+	struct GB* gb = core->board;
+	if (core->loadROM != _GBVLPLoadROM || !gbcore->logContext) {
+		return false;
+	}
+
+	GBVideoProxyRendererUnshim(&gb->video, &gbcore->proxyRenderer);
+	uint32_t keyframe = mVideoLogContextSeek(gbcore->logContext, core, frame);
+	GBVideoProxyRendererShim(&gb->video, &gbcore->proxyRenderer);
+
+	// Replay the frames between the keyframe and the target so the renderer catches up
+	for (; keyframe < frame; ++keyframe) {
+		if (!mVideoLoggerRendererRun(gbcore->proxyRenderer.logger, true)) {
+			return false;
+		}
+	}
+	return true;
+}
 #else
 struct mCore* GBVideoLogPlayerCreate(void) {
 	return false;
 }
+
+bool GBVideoLogPlayerSeek(struct mCore* core, uint32_t frame) {
+	UNUSED(core);
+	UNUSED(frame);
+	return false;
+}
 #endif
@@ -28,6 +28,7 @@ static void GBVideoProxyRendererPutPixels(struct GBVideoRenderer* renderer, size
 
 static bool _parsePacket(struct mVideoLogger* logger, const struct mVideoLoggerDirtyInfo* packet);
 static uint16_t* _vramBlock(struct mVideoLogger* logger, uint32_t address);
+static void _vramWritten(struct mVideoLogger* logger, uint32_t address, uint32_t length);
 
 void GBVideoProxyRendererCreate(struct GBVideoProxyRenderer* renderer, struct GBVideoRenderer* backend) {
 	renderer->d.init = GBVideoProxyRendererInit;
@@ -135,7 +136,16 @@ static bool _parsePacket(struct mVideoLogger* logger, const struct mVideoLoggerD
 	case DIRTY_VRAM:
 		if (item->address <= GB_SIZE_VRAM - 0x1000) {
 			logger->readData(logger, &logger->vram[item->address >> 1], 0x1000, true);
-			proxyRenderer->backend->writeVRAM(proxyRenderer->backend, item->address);
+			// The whole block may have changed, so notify the backend once per tile
+			uint32_t address;
+			for (address = item->address; address < item->address + 0x1000; address += 16) {
+				proxyRenderer->backend->writeVRAM(proxyRenderer->backend, address);
+			}
+		}
+		break;
+	case DIRTY_VRAM_DELTA:
+		if (!mVideoLoggerRendererReadVRAMDelta(logger, item, _vramWritten)) {
+			return false;
 		}
 		break;
 	case DIRTY_SCANLINE:
@@ -180,6 +190,14 @@ static uint16_t* _vramBlock(struct mVideoLogger* logger, uint32_t address) {
 	return (uint16_t*) &proxyRenderer->d.vram[address];
 }
 
+static void _vramWritten(struct mVideoLogger* logger, uint32_t address, uint32_t length) {
+	struct GBVideoProxyRenderer* proxyRenderer = logger->context;
+	uint32_t end = address + length;
+	for (address &= ~0xF; address < end; address += 16) {
+		proxyRenderer->backend->writeVRAM(proxyRenderer->backend, address);
+	}
+}
+
 uint8_t GBVideoProxyRendererWriteVideoRegister(struct GBVideoRenderer* renderer, uint16_t address, uint8_t value) {
 	struct GBVideoProxyRenderer* proxyRenderer = (struct GBVideoProxyRenderer*) renderer;
 
@@ -11,6 +11,7 @@
 
 #include <mgba/core/core.h>
 #include <mgba/core/cheats.h>
+#include <mgba/core/rom-cache.h>
 #include <mgba-util/crc32.h>
 #include <mgba-util/memory.h>
 #include <mgba-util/math.h>
@@ -127,7 +128,9 @@ bool GBLoadROM(struct GB* gb, struct VFile* vf) {
 	gb->yankedRomSize = 0;
 	gb->memory.romBase = gb->memory.rom;
 	gb->memory.romSize = gb->pristineRomSize;
-	gb->romCrc32 = doCrc32(gb->memory.rom, gb->memory.romSize);
+	// Hashing would page in the whole mapping, so wait until the checksum is needed,
+	// unless the cache already hashed the file
+	gb->romCrc32Pending = !mROMCacheGetCRC32(vf, &gb->romCrc32);
 	GBMBCInit(gb);
 
 	if (gb->cpu) {
@@ -150,6 +153,7 @@ static void GBSramDeinit(struct GB* gb) {
 		mappedMemoryFree(gb->memory.sram, gb->sramSize);
 	}
 	gb->memory.sram = 0;
+	GBMemoryUpdateReadPages(&gb->memory);
 }
 
 bool GBLoadSave(struct GB* gb, struct VFile* vf) {
@@ -220,6 +224,12 @@ void GBResizeSram(struct GB* gb, size_t size) {
 	if (gb->sramSize < size) {
 		gb->sramSize = size;
 	}
+	gb->sramDirtySectors = mSAVEDATA_SECTORS_ALL;
+	GBMemoryUpdateReadPages(&gb->memory);
+	if (gb->memory.sramDirtyPages.bitmap) {
+		mCoreMemoryDirtyDeinit(&gb->memory.sramDirtyPages);
+		mCoreMemoryDirtyInit(&gb->memory.sramDirtyPages, gb->sramSize);
+	}
 }
 
 void GBSramClean(struct GB* gb, uint32_t frameCount) {
@@ -240,8 +250,10 @@ void GBSramClean(struct GB* gb, uint32_t frameCount) {
 		if (gb->memory.mbcType == GB_MBC3_RTC) {
 			GBMBCRTCWrite(gb);
 		}
+		uint32_t sectors = gb->sramDirtySectors;
 		gb->sramDirty = 0;
-		if (gb->memory.sram && gb->sramVf->sync(gb->sramVf, gb->memory.sram, gb->sramSize)) {
+		gb->sramDirtySectors = 0;
+		if (gb->memory.sram && mSavedataSyncSectors(gb->sramVf, gb->memory.sram, gb->sramSize, sectors)) {
 			mLOG(GB_MEM, INFO, "Savedata synced");
 		} else {
 			mLOG(GB_MEM, INFO, "Savedata failed to sync!");
@@ -274,6 +286,7 @@ void GBSavedataUnmask(struct GB* gb) {
 		vf->read(vf, gb->memory.sram, gb->sramSize);
 		gb->sramMaskWriteback = false;
 	}
+	gb->sramDirtySectors = mSAVEDATA_SECTORS_ALL;
 	GBMBCSwitchSramBank(gb, gb->memory.sramCurrentBank);
 	vf->close(vf);
 }
@@ -299,7 +312,9 @@ void GBUnloadROM(struct GB* gb) {
 	}
 	gb->memory.rom = NULL;
 	gb->memory.mbcType = GB_MBC_AUTODETECT;
+	GBMemoryUpdateReadPages(&gb->memory);
 	gb->isPristine = false;
+	gb->romCrc32Pending = false;
 
 	gb->sramMaskWriteback = false;
 	GBSramDeinit(gb);
@@ -330,32 +345,46 @@ void GBLoadBIOS(struct GB* gb, struct VFile* vf) {
 }
 
 void GBApplyPatch(struct GB* gb, struct Patch* patch) {
-	size_t patchedSize = patch->outputSize(patch, gb->memory.romSize);
-	if (!patchedSize) {
-		return;
-	}
-	if (patchedSize > GB_SIZE_CART_MAX) {
-		patchedSize = GB_SIZE_CART_MAX;
-	}
-	void* newRom = anonymousMemoryMap(GB_SIZE_CART_MAX);
-	if (!patch->applyPatch(patch, gb->memory.rom, gb->pristineRomSize, newRom, patchedSize)) {
-		mappedMemoryFree(newRom, GB_SIZE_CART_MAX);
-		return;
-	}
-	if (gb->romVf) {
+	// A pristine ROM is a private mapping of its file, so patching it where it lies only copies the pages the
+	// patch writes. Mappings handed out by the ROM cache are shared with other cores and must be left alone.
+	if (gb->isPristine && gb->romVf && !mROMCacheIsShared(gb->romVf) && patch->applyPatchInPlace &&
+	    patch->applyPatchInPlace(patch, gb->memory.rom, gb->memory.romSize)) {
+		mLOG(GB, DEBUG, "Patched ROM in place");
+	} else {
+		size_t patchedSize = patch->outputSize(patch, gb->memory.romSize);
+		if (!patchedSize) {
+			return;
+		}
+		if (patchedSize > GB_SIZE_CART_MAX) {
+			patchedSize = GB_SIZE_CART_MAX;
+		}
+		void* newRom = anonymousMemoryMap(GB_SIZE_CART_MAX);
+		if (!patch->applyPatch(patch, gb->memory.rom, gb->pristineRomSize, newRom, patchedSize)) {
+			mappedMemoryFree(newRom, GB_SIZE_CART_MAX);
+			return;
+		}
+		if (gb->romVf) {
 #ifndef FIXED_ROM_BUFFER
-		gb->romVf->unmap(gb->romVf, gb->memory.rom, gb->pristineRomSize);
+			gb->romVf->unmap(gb->romVf, gb->memory.rom, gb->pristineRomSize);
 #endif
-		gb->romVf->close(gb->romVf);
-		gb->romVf = NULL;
+			gb->romVf->close(gb->romVf);
+			gb->romVf = NULL;
+		}
+		gb->isPristine = false;
+		if (gb->memory.romBase == gb->memory.rom) {
+			gb->memory.romBase = newRom;
+		}
+		gb->memory.rom = newRom;
+		gb->memory.romSize = patchedSize;
 	}
-	gb->isPristine = false;
-	if (gb->memory.romBase == gb->memory.rom) {
-		gb->memory.romBase = newRom;
+	if (patch->hasOutputCrc32) {
+		// Validating the patch already checksummed the output
+		gb->romCrc32 = patch->outputCrc32;
+		gb->romCrc32Pending = false;
+	} else {
+		gb->romCrc32Pending = true;
 	}
-	gb->memory.rom = newRom;
-	gb->memory.romSize = patchedSize;
-	gb->romCrc32 = doCrc32(gb->memory.rom, gb->memory.romSize);
+	GBMemoryUpdateReadPages(&gb->memory);
 	gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 }
 
@@ -553,6 +582,8 @@ void GBSkipBIOS(struct GB* gb) {
 	cpu->sp = 0xFFFE;
 	cpu->pc = 0x100;
 
+	// Restart the DIV phase, since I/O writes during reset may have already batched ticks
+	gb->timer.nextDiv = GB_DMG_DIV_PERIOD;
 	mTimingDeschedule(&gb->timing, &gb->timer.event);
 	mTimingSchedule(&gb->timing, &gb->timer.event, 0);
 
@@ -567,6 +598,7 @@ void GBUnmapBIOS(struct GB* gb) {
 	if (gb->memory.romBase < gb->memory.rom || gb->memory.romBase > &gb->memory.rom[gb->memory.romSize - 1]) {
 		free(gb->memory.romBase);
 		gb->memory.romBase = gb->memory.rom;
+		GBMemoryUpdateReadPages(&gb->memory);
 	}
 	// XXX: Force AGB registers for AGB-mode
 	if (gb->model == GB_MODEL_AGB && gb->cpu->pc == 0x100) {
@@ -724,7 +756,11 @@ static void _enableInterrupts(struct mTiming* timing, void* user, uint32_t cycle
 void GBHalt(struct LR35902Core* cpu) {
 	struct GB* gb = (struct GB*) cpu->master;
 	if (!(gb->memory.ie & gb->memory.io[REG_IF] & 0x1F)) {
-		cpu->cycles = cpu->nextEvent;
+		// The instruction still has its final cycle to account for, so stop one short of
+		// the next event to avoid running it late
+		if (cpu->nextEvent > cpu->cycles) {
+			cpu->cycles = cpu->nextEvent - 1;
+		}
 		cpu->halted = true;
 	} else if (gb->model < GB_MODEL_CGB) {
 		mLOG(GB, STUB, "Unimplemented HALT bug");
@@ -737,8 +773,12 @@ void GBStop(struct LR35902Core* cpu) {
 		mLOG(GB, GAME_ERROR, "Hit illegal stop at address %04X:%02X", cpu->pc, cpu->bus);
 	}
 	if (gb->memory.io[REG_KEY1] & 1) {
+		GBTimerSync(&gb->timer);
+		GBAudioSync(&gb->audio);
+		GBVideoSync(&gb->video);
 		gb->doubleSpeed ^= 1;
 		gb->audio.timingFactor = gb->doubleSpeed + 1;
+		GBTimerUpdateScheduling(&gb->timer);
 		gb->memory.io[REG_KEY1] = 0;
 		gb->memory.io[REG_KEY1] |= gb->doubleSpeed << 7;
 	} else if (cpu->bus) {
@@ -791,6 +831,25 @@ bool GBIsROM(struct VFile* vf) {
 	return true;
 }
 
+static void _cartridgeGameTitle(const struct GBCartridge* cart, char* out) {
+	if (cart->oldLicensee != 0x33) {
+		memcpy(out, cart->titleLong, 16);
+	} else {
+		memcpy(out, cart->titleShort, 11);
+	}
+}
+
+static void _cartridgeGameCode(const struct GBCartridge* cart, char* out) {
+	if (cart->cgb == 0xC0) {
+		memcpy(out, "CGB-????", 8);
+	} else {
+		memcpy(out, "DMG-????", 8);
+	}
+	if (cart->oldLicensee == 0x33) {
+		memcpy(&out[4], cart->maker, 4);
+	}
+}
+
 void GBGetGameTitle(const struct GB* gb, char* out) {
 	const struct GBCartridge* cart = NULL;
 	if (gb->memory.rom) {
@@ -799,11 +858,7 @@ void GBGetGameTitle(const struct GB* gb, char* out) {
 	if (!cart) {
 		return;
 	}
-	if (cart->oldLicensee != 0x33) {
-		memcpy(out, cart->titleLong, 16);
-	} else {
-		memcpy(out, cart->titleShort, 11);
-	}
+	_cartridgeGameTitle(cart, out);
 }
 
 void GBGetGameCode(const struct GB* gb, char* out) {
@@ -815,14 +870,28 @@ void GBGetGameCode(const struct GB* gb, char* out) {
 	if (!cart) {
 		return;
 	}
-	if (cart->cgb == 0xC0) {
-		memcpy(out, "CGB-????", 8);
-	} else {
-		memcpy(out, "DMG-????", 8);
+	_cartridgeGameCode(cart, out);
+}
+
+uint32_t GBGetROMCrc32(struct GB* gb) {
+	if (gb->romCrc32Pending) {
+		// Either the ROM is still the untouched mapping, since copying it on write computes this first,
+		// or it was patched without the patch having checksummed the result
+		gb->romCrc32 = doCrc32(gb->memory.rom, gb->memory.romSize);
+		gb->romCrc32Pending = false;
 	}
-	if (cart->oldLicensee == 0x33) {
-		memcpy(&out[4], cart->maker, 4);
+	return gb->romCrc32;
+}
+
+bool GBIdentifyROM(struct VFile* vf, char* title, char* code) {
+	struct GBCartridge cart;
+	if (vf->seek(vf, 0x100, SEEK_SET) < 0 || vf->read(vf, &cart, sizeof(cart)) != sizeof(cart)) {
+		return false;
 	}
+	_cartridgeGameTitle(&cart, title);
+	memset(code, 0, 8);
+	_cartridgeGameCode(&cart, code);
+	return true;
 }
 
 void GBFrameStarted(struct GB* gb) {
@@ -850,7 +919,7 @@ void GBFrameEnded(struct GB* gb) {
 	}
 
 	// TODO: Move to common code
-	if (gb->stream && gb->stream->postVideoFrame) {
+	if (gb->stream && gb->stream->postVideoFrame && !gb->video.suppressOutput) {
 		const color_t* pixels;
 		size_t stride;
 		gb->video.renderer->getPixels(gb->video.renderer, &stride, (const void**) &pixels);
@@ -375,6 +375,7 @@ void GBIOWrite(struct GB* gb, unsigned address, uint8_t value) {
 		}
 		break;
 	case REG_NR52:
+		GBTimerSync(&gb->timer);
 		GBAudioWriteNR52(&gb->audio, value);
 		value &= 0x80;
 		value |= gb->memory.io[REG_NR52] & 0x0F;
@@ -395,6 +396,7 @@ void GBIOWrite(struct GB* gb, unsigned address, uint8_t value) {
 	case REG_WAVE_D:
 	case REG_WAVE_E:
 	case REG_WAVE_F:
+		GBAudioSync(&gb->audio);
 		if (!gb->audio.playingCh3 || gb->audio.style != GB_AUDIO_DMG) {
 			gb->audio.ch3.wavedata8[address - REG_WAVE_0] = value;
 		} else if(gb->audio.ch3.readable) {
@@ -409,16 +411,23 @@ void GBIOWrite(struct GB* gb, unsigned address, uint8_t value) {
 		}
 		return;
 	case REG_TIMA:
+		GBTimerSync(&gb->timer);
 		if (value && mTimingUntil(&gb->timing, &gb->timer.irq) > 1) {
 			mTimingDeschedule(&gb->timing, &gb->timer.irq);
 		}
 		if (mTimingUntil(&gb->timing, &gb->timer.irq) == -1) {
 			return;
 		}
-		break;
+		gb->memory.io[REG_TIMA] = value;
+		GBTimerUpdateScheduling(&gb->timer);
+		return;
 	case REG_TMA:
 		if (mTimingUntil(&gb->timing, &gb->timer.irq) == -1) {
+			GBTimerSync(&gb->timer);
 			gb->memory.io[REG_TIMA] = value;
+			gb->memory.io[REG_TMA] = value;
+			GBTimerUpdateScheduling(&gb->timer);
+			return;
 		}
 		break;
 	case REG_TAC:
@@ -495,6 +504,7 @@ void GBIOWrite(struct GB* gb, unsigned address, uint8_t value) {
 				gb->memory.io[REG_BCPD] = gb->video.palette[gb->video.bcpIndex >> 1] >> (8 * (gb->video.bcpIndex & 1));
 				break;
 			case REG_BCPD:
+				GBVideoSync(&gb->video);
 				if (gb->video.mode != 3) {
 					GBVideoProcessDots(&gb->video, 0);
 					GBVideoWritePalette(&gb->video, address, value);
@@ -506,6 +516,7 @@ void GBIOWrite(struct GB* gb, unsigned address, uint8_t value) {
 				gb->memory.io[REG_OCPD] = gb->video.palette[8 * 4 + (gb->video.ocpIndex >> 1)] >> (8 * (gb->video.ocpIndex & 1));
 				break;
 			case REG_OCPD:
+				GBVideoSync(&gb->video);
 				if (gb->video.mode != 3) {
 					GBVideoProcessDots(&gb->video, 0);
 					GBVideoWritePalette(&gb->video, address, value);
@@ -588,6 +599,13 @@ uint8_t GBIORead(struct GB* gb, unsigned address) {
 		return _readKeysFiltered(gb);
 	case REG_IE:
 		return gb->memory.ie;
+	case REG_DIV:
+	case REG_TIMA:
+		GBTimerSync(&gb->timer);
+		break;
+	case REG_STAT:
+		GBVideoSync(&gb->video);
+		break;
 	case REG_WAVE_0:
 	case REG_WAVE_1:
 	case REG_WAVE_2:
@@ -604,6 +622,7 @@ uint8_t GBIORead(struct GB* gb, unsigned address) {
 	case REG_WAVE_D:
 	case REG_WAVE_E:
 	case REG_WAVE_F:
+		GBAudioSync(&gb->audio);
 		if (gb->audio.playingCh3) {
 			if (gb->audio.ch3.readable || gb->audio.style != GB_AUDIO_DMG) {
 				return gb->audio.ch3.wavedata8[gb->audio.ch3.window >> 1];
@@ -634,11 +653,8 @@ uint8_t GBIORead(struct GB* gb, unsigned address) {
 	case REG_NR50:
 	case REG_NR51:
 	case REG_NR52:
-	case REG_DIV:
-	case REG_TIMA:
 	case REG_TMA:
 	case REG_TAC:
-	case REG_STAT:
 	case REG_LCDC:
 	case REG_SCY:
 	case REG_SCX:
@@ -704,14 +720,14 @@ void GBIODeserialize(struct GB* gb, const struct GBSerializedState* state) {
 		gb->audio.ch1.control.stop = GBAudioRegisterControlGetStop(gb->memory.io[REG_NR14] << 8);
 		GBIOWrite(gb, REG_NR21, gb->memory.io[REG_NR21]);
 		GBIOWrite(gb, REG_NR22, gb->memory.io[REG_NR22]);
-		GBIOWrite(gb, REG_NR22, gb->memory.io[REG_NR23]);
+		GBIOWrite(gb, REG_NR23, gb->memory.io[REG_NR23]);
 		gb->audio.ch2.control.frequency &= 0xFF;
 		gb->audio.ch2.control.frequency |= GBAudioRegisterControlGetFrequency(gb->memory.io[REG_NR24] << 8);
 		gb->audio.ch2.control.stop = GBAudioRegisterControlGetStop(gb->memory.io[REG_NR24] << 8);
 		GBIOWrite(gb, REG_NR30, gb->memory.io[REG_NR30]);
 		GBIOWrite(gb, REG_NR31, gb->memory.io[REG_NR31]);
 		GBIOWrite(gb, REG_NR32, gb->memory.io[REG_NR32]);
-		GBIOWrite(gb, REG_NR32, gb->memory.io[REG_NR33]);
+		GBIOWrite(gb, REG_NR33, gb->memory.io[REG_NR33]);
 		gb->audio.ch3.rate &= 0xFF;
 		gb->audio.ch3.rate |= GBAudioRegisterControlGetRate(gb->memory.io[REG_NR34] << 8);
 		gb->audio.ch3.stop = GBAudioRegisterControlGetStop(gb->memory.io[REG_NR34] << 8);
@@ -55,6 +55,7 @@ void GBMBCSwitchBank(struct GB* gb, int bank) {
 	}
 	gb->memory.romBank = &gb->memory.rom[bankStart];
 	gb->memory.currentBank = bank;
+	GBMemoryUpdateReadPages(&gb->memory);
 	if (gb->cpu->pc < GB_BASE_VRAM) {
 		gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 	}
@@ -67,6 +68,7 @@ void GBMBCSwitchBank0(struct GB* gb, int bank) {
 		bankStart &= (gb->memory.romSize - 1);
 	}
 	gb->memory.romBase = &gb->memory.rom[bankStart];
+	GBMemoryUpdateReadPages(&gb->memory);
 	if (gb->cpu->pc < GB_SIZE_CART_BANK0) {
 		gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 	}
@@ -89,6 +91,7 @@ void GBMBCSwitchHalfBank(struct GB* gb, int half, int bank) {
 		gb->memory.mbcState.mbc6.romBank1 = &gb->memory.rom[bankStart];
 		gb->memory.mbcState.mbc6.currentBank1 = bank;
 	}
+	GBMemoryUpdateReadPages(&gb->memory);
 	if (gb->cpu->pc < GB_BASE_VRAM) {
 		gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 	}
@@ -128,6 +131,7 @@ void GBMBCSwitchSramBank(struct GB* gb, int bank) {
 	}
 	gb->memory.sramBank = &gb->memory.sram[bankStart];
 	gb->memory.sramCurrentBank = bank;
+	GBMemoryUpdateReadPages(&gb->memory);
 }
 
 void GBMBCSwitchSramHalfBank(struct GB* gb, int half, int bank) {
@@ -144,6 +148,7 @@ void GBMBCSwitchSramHalfBank(struct GB* gb, int half, int bank) {
 		gb->memory.mbcState.mbc6.sramBank1 = &gb->memory.sram[bankStart];
 		gb->memory.mbcState.mbc6.currentSramBank1 = bank;
 	}
+	GBMemoryUpdateReadPages(&gb->memory);
 }
 
 void GBMBCInit(struct GB* gb) {
@@ -334,6 +339,7 @@ void GBMBCInit(struct GB* gb) {
 	if (gb->memory.mbcType == GB_MBC3_RTC) {
 		GBMBCRTCRead(gb);
 	}
+	GBMemoryUpdateReadPages(&gb->memory);
 }
 
 static void _latchRtc(struct mRTCSource* rtc, uint8_t* rtcRegs, time_t* rtcLastLatch) {
@@ -6,6 +6,7 @@
 #include <mgba/internal/gb/memory.h>
 
 #include <mgba/core/interface.h>
+#include <mgba/core/perf-counters.h>
 #include <mgba/internal/gb/gb.h>
 #include <mgba/internal/gb/io.h>
 #include <mgba/internal/gb/mbc.h>
@@ -115,6 +116,8 @@ void GBMemoryInit(struct GB* gb) {
 	cpu->memory.store8 = GBStore8;
 	cpu->memory.currentSegment = GBCurrentSegment;
 	cpu->memory.setActiveRegion = GBSetActiveRegion;
+	gb->memory.hook = NULL;
+	gb->memory.hookInstalled = false;
 
 	gb->memory.wram = 0;
 	gb->memory.wramBank = 0;
@@ -125,20 +128,33 @@ void GBMemoryInit(struct GB* gb) {
 	gb->memory.mbcType = GB_MBC_AUTODETECT;
 	gb->memory.mbcRead = NULL;
 	gb->memory.mbcWrite = NULL;
+	memset(gb->memory.readPages, 0, sizeof(gb->memory.readPages));
 
 	gb->memory.rtc = NULL;
 	gb->memory.rotation = NULL;
 	gb->memory.rumble = NULL;
 	gb->memory.cam = NULL;
 
+	memset(&gb->memory.vramDirtyPages, 0, sizeof(gb->memory.vramDirtyPages));
+	memset(&gb->memory.sramDirtyPages, 0, sizeof(gb->memory.sramDirtyPages));
+	memset(&gb->memory.wramDirtyPages, 0, sizeof(gb->memory.wramDirtyPages));
+	memset(&gb->memory.oamDirtyPages, 0, sizeof(gb->memory.oamDirtyPages));
+	memset(&gb->memory.hramDirtyPages, 0, sizeof(gb->memory.hramDirtyPages));
+
 	GBIOInit(gb);
 }
 
 void GBMemoryDeinit(struct GB* gb) {
+	memset(gb->memory.readPages, 0, sizeof(gb->memory.readPages));
 	mappedMemoryFree(gb->memory.wram, GB_SIZE_WORKING_RAM);
 	if (gb->memory.rom) {
 		mappedMemoryFree(gb->memory.rom, gb->memory.romSize);
 	}
+	mCoreMemoryDirtyDeinit(&gb->memory.vramDirtyPages);
+	mCoreMemoryDirtyDeinit(&gb->memory.sramDirtyPages);
+	mCoreMemoryDirtyDeinit(&gb->memory.wramDirtyPages);
+	mCoreMemoryDirtyDeinit(&gb->memory.oamDirtyPages);
+	mCoreMemoryDirtyDeinit(&gb->memory.hramDirtyPages);
 }
 
 void GBMemoryReset(struct GB* gb) {
@@ -209,6 +225,7 @@ void GBMemoryReset(struct GB* gb) {
 		break;
 	}
 	gb->memory.sramBank = gb->memory.sram;
+	GBMemoryUpdateReadPages(&gb->memory);
 
 	if (!gb->memory.wram) {
 		GBMemoryDeinit(gb);
@@ -222,11 +239,74 @@ void GBMemorySwitchWramBank(struct GBMemory* memory, int bank) {
 	}
 	memory->wramBank = &memory->wram[GB_SIZE_WORKING_RAM_BANK0 * bank];
 	memory->wramCurrentBank = bank;
+	GBMemoryUpdateReadPages(memory);
+}
+
+static void _hookStore8(struct LR35902Core* cpu, uint16_t address, int8_t value) {
+	struct GBMemory* memory = &((struct GB*) cpu->master)->memory;
+	memory->unhookedStore8(cpu, address, value);
+	if (memory->hook && mCoreMemoryHookWatches(memory->hook, address)) {
+		memory->hook->written(memory->hook->context, address, 1, (uint8_t) value);
+	}
+}
+
+void GBMemorySetHook(struct GB* gb, struct mCoreMemoryHook* hook) {
+	struct LR35902Core* cpu = gb->cpu;
+	struct GBMemory* memory = &gb->memory;
+	memory->hook = hook;
+	if (hook && !memory->hookInstalled) {
+		memory->unhookedStore8 = cpu->memory.store8;
+		cpu->memory.store8 = _hookStore8;
+		memory->hookInstalled = true;
+	} else if (!hook && memory->hookInstalled && cpu->memory.store8 == _hookStore8) {
+		// If something else, like the debugger, has wrapped the shim since, it stays and just passes stores through
+		cpu->memory.store8 = memory->unhookedStore8;
+		memory->hookInstalled = false;
+	}
+}
+
+void GBMemoryUpdateReadPages(struct GBMemory* memory) {
+	memset(memory->readPages, 0, sizeof(memory->readPages));
+	int i;
+	if (memory->rom && memory->romBase) {
+		for (i = 0; i < GB_SIZE_CART_BANK0 / GB_SIZE_READ_PAGE; ++i) {
+			memory->readPages[GB_REGION_CART_BANK0 + i] = &memory->romBase[i * GB_SIZE_READ_PAGE];
+		}
+	}
+	if (memory->rom && memory->romBank) {
+		if (memory->mbcType == GB_MBC6) {
+			memory->readPages[GB_REGION_CART_BANK1] = memory->romBank;
+			memory->readPages[GB_REGION_CART_BANK1 + 1] = &memory->romBank[GB_SIZE_READ_PAGE];
+			if (memory->mbcState.mbc6.romBank1) {
+				memory->readPages[GB_REGION_CART_BANK1 + 2] = memory->mbcState.mbc6.romBank1;
+				memory->readPages[GB_REGION_CART_BANK1 + 3] = &memory->mbcState.mbc6.romBank1[GB_SIZE_READ_PAGE];
+			}
+		} else {
+			for (i = 0; i < GB_SIZE_CART_BANK0 / GB_SIZE_READ_PAGE; ++i) {
+				memory->readPages[GB_REGION_CART_BANK1 + i] = &memory->romBank[i * GB_SIZE_READ_PAGE];
+			}
+		}
+	}
+	// RTC registers and mappers with their own read handlers (MBC2, MBC6, MBC7, TAMA5, camera) keep the slow path
+	if (memory->sramAccess && !memory->rtcAccess && !memory->mbcRead && memory->sram && memory->sramBank) {
+		memory->readPages[GB_REGION_EXTERNAL_RAM] = memory->sramBank;
+		memory->readPages[GB_REGION_EXTERNAL_RAM + 1] = &memory->sramBank[GB_SIZE_READ_PAGE];
+	}
+	if (memory->wram && memory->wramBank) {
+		memory->readPages[GB_REGION_WORKING_RAM_BANK0] = memory->wram;
+		memory->readPages[GB_REGION_WORKING_RAM_BANK1] = memory->wramBank;
+		memory->readPages[GB_REGION_WORKING_RAM_BANK1_MIRROR] = memory->wram;
+	}
 }
 
 uint8_t GBLoad8(struct LR35902Core* cpu, uint16_t address) {
 	struct GB* gb = (struct GB*) cpu->master;
 	struct GBMemory* memory = &gb->memory;
+#ifdef ENABLE_PERF_COUNTERS
+	if (cpu->perfCounters) {
+		++cpu->perfCounters->memoryAccesses[address >> 12];
+	}
+#endif
 	if (gb->memory.dmaRemaining) {
 		const enum GBBus* block = gb->model < GB_MODEL_CGB ? _oamBlockDMG : _oamBlockCGB;
 		enum GBBus dmaBus = block[memory->dmaSource >> 13];
@@ -238,6 +318,10 @@ uint8_t GBLoad8(struct LR35902Core* cpu, uint16_t address) {
 			return 0xFF;
 		}
 	}
+	const uint8_t* page = memory->readPages[address >> 12];
+	if (page) {
+		return page[address & (GB_SIZE_READ_PAGE - 1)];
+	}
 	switch (address >> 12) {
 	case GB_REGION_CART_BANK0:
 	case GB_REGION_CART_BANK0 + 1:
@@ -255,6 +339,7 @@ uint8_t GBLoad8(struct LR35902Core* cpu, uint16_t address) {
 		return memory->romBank[address & (GB_SIZE_CART_BANK0 - 1)];
 	case GB_REGION_VRAM:
 	case GB_REGION_VRAM + 1:
+		GBVideoSync(&gb->video);
 		if (gb->video.mode != 3) {
 			return gb->video.vramBank[address & (GB_SIZE_VRAM_BANK0 - 1)];
 		}
@@ -281,6 +366,8 @@ uint8_t GBLoad8(struct LR35902Core* cpu, uint16_t address) {
 			return memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)];
 		}
 		if (address < GB_BASE_UNUSABLE) {
+			GBMemorySyncDMA(gb, 0);
+			GBVideoSync(&gb->video);
 			if (gb->video.mode < 2) {
 				return gb->video.oam.raw[address & 0xFF];
 			}
@@ -303,6 +390,11 @@ uint8_t GBLoad8(struct LR35902Core* cpu, uint16_t address) {
 void GBStore8(struct LR35902Core* cpu, uint16_t address, int8_t value) {
 	struct GB* gb = (struct GB*) cpu->master;
 	struct GBMemory* memory = &gb->memory;
+#ifdef ENABLE_PERF_COUNTERS
+	if (cpu->perfCounters) {
+		++cpu->perfCounters->memoryAccesses[address >> 12];
+	}
+#endif
 	if (gb->memory.dmaRemaining) {
 		const enum GBBus* block = gb->model < GB_MODEL_CGB ? _oamBlockDMG : _oamBlockCGB;
 		enum GBBus dmaBus = block[memory->dmaSource >> 13];
@@ -324,13 +416,16 @@ void GBStore8(struct LR35902Core* cpu, uint16_t address, int8_t value) {
 	case GB_REGION_CART_BANK1 + 2:
 	case GB_REGION_CART_BANK1 + 3:
 		memory->mbcWrite(gb, address, value);
+		GBMemoryUpdateReadPages(memory);
 		cpu->memory.setActiveRegion(cpu, cpu->pc);
 		return;
 	case GB_REGION_VRAM:
 	case GB_REGION_VRAM + 1:
+		GBVideoSync(&gb->video);
 		if (gb->video.mode != 3) {
 			gb->video.renderer->writeVRAM(gb->video.renderer, (address & (GB_SIZE_VRAM_BANK0 - 1)) | (GB_SIZE_VRAM_BANK0 * gb->video.vramCurrentBank));
 			gb->video.vramBank[address & (GB_SIZE_VRAM_BANK0 - 1)] = value;
+			mCoreMemoryDirtyMark(&memory->vramDirtyPages, (address & (GB_SIZE_VRAM_BANK0 - 1)) | (GB_SIZE_VRAM_BANK0 * gb->video.vramCurrentBank));
 		}
 		return;
 	case GB_REGION_EXTERNAL_RAM:
@@ -339,24 +434,35 @@ void GBStore8(struct LR35902Core* cpu, uint16_t address, int8_t value) {
 			memory->rtcRegs[memory->activeRtcReg] = value;
 		} else if (memory->sramAccess && memory->sram && memory->mbcType != GB_MBC2) {
 			memory->sramBank[address & (GB_SIZE_EXTERNAL_RAM - 1)] = value;
+			mCoreMemoryDirtyMark(&memory->sramDirtyPages, (memory->sramBank - memory->sram) + (address & (GB_SIZE_EXTERNAL_RAM - 1)));
+			gb->sramDirtySectors |= mSavedataSector((memory->sramBank - memory->sram) + (address & (GB_SIZE_EXTERNAL_RAM - 1)));
 		} else {
 			memory->mbcWrite(gb, address, value);
+			GBMemoryUpdateReadPages(memory);
+			// Mappers that handle SRAM themselves don't say which byte they wrote
+			mCoreMemoryDirtyMarkAll(&memory->sramDirtyPages);
+			gb->sramDirtySectors = mSAVEDATA_SECTORS_ALL;
 		}
 		gb->sramDirty |= GB_SRAM_DIRT_NEW;
 		return;
 	case GB_REGION_WORKING_RAM_BANK0:
 	case GB_REGION_WORKING_RAM_BANK0 + 2:
 		memory->wram[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)] = value;
+		mCoreMemoryDirtyMark(&memory->wramDirtyPages, address & (GB_SIZE_WORKING_RAM_BANK0 - 1));
 		return;
 	case GB_REGION_WORKING_RAM_BANK1:
 		memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)] = value;
+		mCoreMemoryDirtyMark(&memory->wramDirtyPages, (memory->wramBank - memory->wram) + (address & (GB_SIZE_WORKING_RAM_BANK0 - 1)));
 		return;
 	default:
 		if (address < GB_BASE_OAM) {
 			memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)] = value;
+			mCoreMemoryDirtyMark(&memory->wramDirtyPages, (memory->wramBank - memory->wram) + (address & (GB_SIZE_WORKING_RAM_BANK0 - 1)));
 		} else if (address < GB_BASE_UNUSABLE) {
+			GBVideoSync(&gb->video);
 			if (gb->video.mode < 2) {
 				gb->video.oam.raw[address & 0xFF] = value;
+				mCoreMemoryDirtyMark(&memory->oamDirtyPages, address & 0xFF);
 				gb->video.renderer->writeOAM(gb->video.renderer, address & 0xFF);
 			}
 		} else if (address < GB_BASE_IO) {
@@ -365,6 +471,7 @@ void GBStore8(struct LR35902Core* cpu, uint16_t address, int8_t value) {
 			GBIOWrite(gb, address & (GB_SIZE_IO - 1), value);
 		} else if (address < GB_BASE_IE) {
 			memory->hram[address & GB_SIZE_HRAM] = value;
+			mCoreMemoryDirtyMark(&memory->hramDirtyPages, address & GB_SIZE_HRAM);
 		} else {
 			GBIOWrite(gb, REG_IE, value);
 		}
@@ -464,6 +571,8 @@ uint8_t GBView8(struct LR35902Core* cpu, uint16_t address, int segment) {
 			return memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)];
 		}
 		if (address < GB_BASE_UNUSABLE) {
+			GBMemorySyncDMA(gb, 0);
+			GBVideoSync(&gb->video);
 			if (gb->video.mode < 2) {
 				return gb->video.oam.raw[address & 0xFF];
 			}
@@ -487,14 +596,62 @@ void GBMemoryDMA(struct GB* gb, uint16_t base) {
 	if (base > 0xF100) {
 		return;
 	}
+	// Bytes the previous DMA already copied stay copied
+	GBMemorySyncDMA(gb, 0);
 	mTimingDeschedule(&gb->timing, &gb->memory.dmaEvent);
-	mTimingSchedule(&gb->timing, &gb->memory.dmaEvent, 8);
+	// The event marks when the last byte lands; everything before it is copied on demand
+	mTimingSchedule(&gb->timing, &gb->memory.dmaEvent, 8 + 4 * (GB_SIZE_OAM - 1));
 	if (gb->cpu->cycles + 8 < gb->cpu->nextEvent) {
 		gb->cpu->nextEvent = gb->cpu->cycles + 8;
 	}
 	gb->memory.dmaSource = base;
 	gb->memory.dmaDest = 0;
-	gb->memory.dmaRemaining = 0xA0;
+	gb->memory.dmaRemaining = GB_SIZE_OAM;
+}
+
+void GBMemorySyncDMA(struct GB* gb, uint32_t cyclesLate) {
+	struct GBMemory* memory = &gb->memory;
+	if (!memory->dmaRemaining) {
+		return;
+	}
+	// One byte lands every 4 cycles, counting back from the last one
+	int32_t until = mTimingUntil(&gb->timing, &memory->dmaEvent) + (int32_t) cyclesLate;
+	int remaining = 0;
+	if (until > 0) {
+		remaining = (until + 3) >> 2;
+	}
+	if (remaining >= memory->dmaRemaining) {
+		return;
+	}
+	GBVideoSync(&gb->video);
+	int dmaRemaining = memory->dmaRemaining;
+	// Clearing this lets the source reads through the bus conflict check
+	memory->dmaRemaining = 0;
+#ifdef ENABLE_PERF_COUNTERS
+	if (gb->cpu->perfCounters) {
+		gb->cpu->perfCounters->dmaCycles += 4 * (dmaRemaining - remaining);
+	}
+#endif
+	for (; dmaRemaining > remaining; --dmaRemaining) {
+		// TODO: Can DMA write OAM during modes 2-3?
+		gb->video.oam.raw[memory->dmaDest] = GBLoad8(gb->cpu, memory->dmaSource);
+		mCoreMemoryDirtyMark(&memory->oamDirtyPages, memory->dmaDest);
+		gb->video.renderer->writeOAM(gb->video.renderer, memory->dmaDest);
+		++memory->dmaSource;
+		++memory->dmaDest;
+	}
+	memory->dmaRemaining = remaining;
+}
+
+static int32_t _hdmaBlockCycles(int remaining) {
+	// HDMA moves 0x10 bytes per block at 2 cycles a byte; the block event fires when its last byte would land
+	return 2 * ((remaining - 1) & 0xF);
+}
+
+void GBMemoryScheduleHDMA(struct GB* gb) {
+	gb->cpuBlocked = true;
+	mTimingDeschedule(&gb->timing, &gb->memory.hdmaEvent);
+	mTimingSchedule(&gb->timing, &gb->memory.hdmaEvent, _hdmaBlockCycles(gb->memory.hdmaRemaining));
 }
 
 uint8_t GBMemoryWriteHDMA5(struct GB* gb, uint8_t value) {
@@ -510,6 +667,7 @@ uint8_t GBMemoryWriteHDMA5(struct GB* gb, uint8_t value) {
 	gb->memory.hdmaDest &= 0x1FF0;
 	gb->memory.hdmaDest |= 0x8000;
 	bool wasHdma = gb->memory.isHdma;
+	GBVideoSync(&gb->video);
 	gb->memory.isHdma = value & 0x80;
 	if ((!wasHdma && !gb->memory.isHdma) || (GBRegisterLCDCIsEnable(gb->memory.io[REG_LCDC]) && gb->video.mode == 0)) {
 		if (gb->memory.isHdma) {
@@ -517,8 +675,7 @@ uint8_t GBMemoryWriteHDMA5(struct GB* gb, uint8_t value) {
 		} else {
 			gb->memory.hdmaRemaining = ((value & 0x7F) + 1) * 0x10;
 		}
-		gb->cpuBlocked = true;
-		mTimingSchedule(&gb->timing, &gb->memory.hdmaEvent, 0);
+		GBMemoryScheduleHDMA(gb);
 	} else if (gb->memory.isHdma && !GBRegisterLCDCIsEnable(gb->memory.io[REG_LCDC])) {
 		return 0x80 | ((value + 1) & 0x7F);
 	}
@@ -526,45 +683,62 @@ uint8_t GBMemoryWriteHDMA5(struct GB* gb, uint8_t value) {
 }
 
 void _GBMemoryDMAService(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	UNUSED(timing);
 	struct GB* gb = context;
-	int dmaRemaining = gb->memory.dmaRemaining;
-	gb->memory.dmaRemaining = 0;
-	uint8_t b = GBLoad8(gb->cpu, gb->memory.dmaSource);
-	// TODO: Can DMA write OAM during modes 2-3?
-	gb->video.oam.raw[gb->memory.dmaDest] = b;
-	gb->video.renderer->writeOAM(gb->video.renderer, gb->memory.dmaDest);
-	++gb->memory.dmaSource;
-	++gb->memory.dmaDest;
-	gb->memory.dmaRemaining = dmaRemaining - 1;
-	if (gb->memory.dmaRemaining) {
-		mTimingSchedule(timing, &gb->memory.dmaEvent, 4 - cyclesLate);
-	}
+	GBMemorySyncDMA(gb, cyclesLate);
 }
 
 void _GBMemoryHDMAService(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	struct GB* gb = context;
-	gb->cpuBlocked = true;
-	uint8_t b = gb->cpu->memory.load8(gb->cpu, gb->memory.hdmaSource);
-	gb->cpu->memory.store8(gb->cpu, gb->memory.hdmaDest, b);
-	++gb->memory.hdmaSource;
-	++gb->memory.hdmaDest;
-	--gb->memory.hdmaRemaining;
-	if (gb->memory.hdmaRemaining) {
-		mTimingDeschedule(timing, &gb->memory.hdmaEvent);
-		mTimingSchedule(timing, &gb->memory.hdmaEvent, 2 - cyclesLate);
+	struct GBMemory* memory = &gb->memory;
+	struct LR35902Core* cpu = gb->cpu;
+	int length = ((memory->hdmaRemaining - 1) & 0xF) + 1;
+	int i;
+	if (cpu->memory.store8 == GBStore8 && !memory->dmaRemaining && memory->hdmaDest + length <= GB_BASE_EXTERNAL_RAM) {
+		// Nothing is watching stores and the block stays in VRAM, so it can skip the bus
+		uint8_t block[0x10];
+		for (i = 0; i < length; ++i) {
+			block[i] = cpu->memory.load8(cpu, memory->hdmaSource + i);
+		}
+		GBVideoSync(&gb->video);
+		if (gb->video.mode != 3) {
+			uint16_t dest = (memory->hdmaDest & (GB_SIZE_VRAM_BANK0 - 1)) | (GB_SIZE_VRAM_BANK0 * gb->video.vramCurrentBank);
+			memcpy(&gb->video.vramBank[memory->hdmaDest & (GB_SIZE_VRAM_BANK0 - 1)], block, length);
+			for (i = 0; i < length; ++i) {
+				gb->video.renderer->writeVRAM(gb->video.renderer, dest + i);
+				mCoreMemoryDirtyMark(&memory->vramDirtyPages, dest + i);
+			}
+		}
+	} else {
+		for (i = 0; i < length; ++i) {
+			uint8_t b = cpu->memory.load8(cpu, memory->hdmaSource + i);
+			cpu->memory.store8(cpu, memory->hdmaDest + i, b);
+		}
+	}
+	memory->hdmaSource += length;
+	memory->hdmaDest += length;
+	memory->hdmaRemaining -= length;
+#ifdef ENABLE_PERF_COUNTERS
+	if (cpu->perfCounters) {
+		cpu->perfCounters->dmaCycles += 2 * length;
+	}
+#endif
+	if (memory->hdmaRemaining) {
+		mTimingDeschedule(timing, &memory->hdmaEvent);
+		mTimingSchedule(timing, &memory->hdmaEvent, 2 + _hdmaBlockCycles(memory->hdmaRemaining) - cyclesLate);
 	} else {
 		gb->cpuBlocked = false;
-		gb->memory.io[REG_HDMA1] = gb->memory.hdmaSource >> 8;
-		gb->memory.io[REG_HDMA2] = gb->memory.hdmaSource;
-		gb->memory.io[REG_HDMA3] = gb->memory.hdmaDest >> 8;
-		gb->memory.io[REG_HDMA4] = gb->memory.hdmaDest;
-		if (gb->memory.isHdma) {
-			--gb->memory.io[REG_HDMA5];
-			if (gb->memory.io[REG_HDMA5] == 0xFF) {
-				gb->memory.isHdma = false;
+		memory->io[REG_HDMA1] = memory->hdmaSource >> 8;
+		memory->io[REG_HDMA2] = memory->hdmaSource;
+		memory->io[REG_HDMA3] = memory->hdmaDest >> 8;
+		memory->io[REG_HDMA4] = memory->hdmaDest;
+		if (memory->isHdma) {
+			--memory->io[REG_HDMA5];
+			if (memory->io[REG_HDMA5] == 0xFF) {
+				memory->isHdma = false;
 			}
 		} else {
-			gb->memory.io[REG_HDMA5] = 0xFF;
+			memory->io[REG_HDMA5] = 0xFF;
 		}
 	}
 }
@@ -603,10 +777,12 @@ void GBPatch8(struct LR35902Core* cpu, uint16_t address, int8_t value, int8_t* o
 		if (segment < 0) {
 			oldValue = gb->video.vramBank[address & (GB_SIZE_VRAM_BANK0 - 1)];
 			gb->video.vramBank[address & (GB_SIZE_VRAM_BANK0 - 1)] = value;
+			mCoreMemoryDirtyMark(&memory->vramDirtyPages, (address & (GB_SIZE_VRAM_BANK0 - 1)) + GB_SIZE_VRAM_BANK0 * gb->video.vramCurrentBank);
 			gb->video.renderer->writeVRAM(gb->video.renderer, (address & (GB_SIZE_VRAM_BANK0 - 1)) + GB_SIZE_VRAM_BANK0 * gb->video.vramCurrentBank);
 		} else if (segment < 2) {
 			oldValue = gb->video.vram[(address & (GB_SIZE_VRAM_BANK0 - 1)) + segment * GB_SIZE_VRAM_BANK0];
 			gb->video.vramBank[(address & (GB_SIZE_VRAM_BANK0 - 1)) + segment * GB_SIZE_VRAM_BANK0] = value;
+			mCoreMemoryDirtyMark(&memory->vramDirtyPages, (address & (GB_SIZE_VRAM_BANK0 - 1)) + segment * GB_SIZE_VRAM_BANK0);
 			gb->video.renderer->writeVRAM(gb->video.renderer, (address & (GB_SIZE_VRAM_BANK0 - 1)) + segment * GB_SIZE_VRAM_BANK0);
 		} else {
 			return;
@@ -620,14 +796,17 @@ void GBPatch8(struct LR35902Core* cpu, uint16_t address, int8_t value, int8_t* o
 	case GB_REGION_WORKING_RAM_BANK0 + 2:
 		oldValue = memory->wram[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)];
 		memory->wram[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)] = value;
+		mCoreMemoryDirtyMark(&memory->wramDirtyPages, address & (GB_SIZE_WORKING_RAM_BANK0 - 1));
 		break;
 	case GB_REGION_WORKING_RAM_BANK1:
 		if (segment < 0) {
 			oldValue = memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)];
 			memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)] = value;
+			mCoreMemoryDirtyMark(&memory->wramDirtyPages, (memory->wramBank - memory->wram) + (address & (GB_SIZE_WORKING_RAM_BANK0 - 1)));
 		} else if (segment < 8) {
 			oldValue = memory->wram[(address & (GB_SIZE_WORKING_RAM_BANK0 - 1)) + segment * GB_SIZE_WORKING_RAM_BANK0];
 			memory->wram[(address & (GB_SIZE_WORKING_RAM_BANK0 - 1)) + segment * GB_SIZE_WORKING_RAM_BANK0] = value;
+			mCoreMemoryDirtyMark(&memory->wramDirtyPages, (address & (GB_SIZE_WORKING_RAM_BANK0 - 1)) + segment * GB_SIZE_WORKING_RAM_BANK0);
 		} else {
 			return;
 		}
@@ -636,9 +815,11 @@ void GBPatch8(struct LR35902Core* cpu, uint16_t address, int8_t value, int8_t* o
 		if (address < GB_BASE_OAM) {
 			oldValue = memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)];
 			memory->wramBank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)] = value;
+			mCoreMemoryDirtyMark(&memory->wramDirtyPages, (memory->wramBank - memory->wram) + (address & (GB_SIZE_WORKING_RAM_BANK0 - 1)));
 		} else if (address < GB_BASE_UNUSABLE) {
 			oldValue = gb->video.oam.raw[address & 0xFF];
 			gb->video.oam.raw[address & 0xFF] = value;
+			mCoreMemoryDirtyMark(&memory->oamDirtyPages, address & 0xFF);
 			gb->video.renderer->writeOAM(gb->video.renderer, address & 0xFF);
 		} else if (address < GB_BASE_HRAM) {
 			mLOG(GB_MEM, STUB, "Unimplemented memory Patch8: 0x%08X", address);
@@ -646,6 +827,7 @@ void GBPatch8(struct LR35902Core* cpu, uint16_t address, int8_t value, int8_t* o
 		} else if (address < GB_BASE_IE) {
 			oldValue = memory->hram[address & GB_SIZE_HRAM];
 			memory->hram[address & GB_SIZE_HRAM] = value;
+			mCoreMemoryDirtyMark(&memory->hramDirtyPages, address & GB_SIZE_HRAM);
 		} else {
 			mLOG(GB_MEM, STUB, "Unimplemented memory Patch8: 0x%08X", address);
 			return;
@@ -674,8 +856,17 @@ void GBMemorySerialize(const struct GB* gb, struct GBSerializedState* state) {
 	state->memory.dmaRemaining = memory->dmaRemaining;
 	memcpy(state->memory.rtcRegs, memory->rtcRegs, sizeof(state->memory.rtcRegs));
 
-	STORE_32LE(memory->dmaEvent.when - mTimingCurrentTime(&gb->timing), 0, &state->memory.dmaNext);
-	STORE_32LE(memory->hdmaEvent.when - mTimingCurrentTime(&gb->timing), 0, &state->memory.hdmaNext);
+	// Savestates count down to the next byte, not to the end of the transfer or block
+	int32_t when = memory->dmaEvent.when - mTimingCurrentTime(&gb->timing);
+	if (memory->dmaRemaining) {
+		when -= 4 * (memory->dmaRemaining - 1);
+	}
+	STORE_32LE(when, 0, &state->memory.dmaNext);
+	when = memory->hdmaEvent.when - mTimingCurrentTime(&gb->timing);
+	if (memory->hdmaRemaining) {
+		when -= _hdmaBlockCycles(memory->hdmaRemaining);
+	}
+	STORE_32LE(when, 0, &state->memory.hdmaNext);
 
 	GBSerializedMemoryFlags flags = 0;
 	flags = GBSerializedMemoryFlagsSetSramAccess(flags, memory->sramAccess);
@@ -738,11 +929,11 @@ void GBMemoryDeserialize(struct GB* gb, const struct GBSerializedState* state) {
 	uint32_t when;
 	LOAD_32LE(when, 0, &state->memory.dmaNext);
 	if (memory->dmaRemaining) {
-		mTimingSchedule(&gb->timing, &memory->dmaEvent, when);
+		mTimingSchedule(&gb->timing, &memory->dmaEvent, when + 4 * (memory->dmaRemaining - 1));
 	}
 	LOAD_32LE(when, 0, &state->memory.hdmaNext);
 	if (memory->hdmaRemaining) {
-		mTimingSchedule(&gb->timing, &memory->hdmaEvent, when);
+		mTimingSchedule(&gb->timing, &memory->hdmaEvent, when + _hdmaBlockCycles(memory->hdmaRemaining));
 	}
 
 	GBSerializedMemoryFlags flags;
@@ -787,12 +978,14 @@ void GBMemoryDeserialize(struct GB* gb, const struct GBSerializedState* state) {
 	default:
 		break;
 	}
+	GBMemoryUpdateReadPages(memory);
 }
 
 void _pristineCow(struct GB* gb) {
 	if (!gb->isPristine) {
 		return;
 	}
+	GBGetROMCrc32(gb);
 	void* newRom = anonymousMemoryMap(GB_SIZE_CART_MAX);
 	memcpy(newRom, gb->memory.rom, gb->memory.romSize);
 	memset(((uint8_t*) newRom) + gb->memory.romSize, 0xFF, GB_SIZE_CART_MAX - gb->memory.romSize);
@@ -0,0 +1,1014 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/gb/renderers/gl.h>
+
+#if defined(BUILD_GLES2) || defined(BUILD_GLES3)
+
+#include <mgba/core/cache-set.h>
+#include <mgba/internal/gb/io.h>
+#include <mgba/internal/gb/renderers/cache-set.h>
+#include <mgba-util/memory.h>
+
+#define SGB_BORDER_WIDTH 256
+#define SGB_BORDER_HEIGHT 224
+
+static void GBVideoGLRendererInit(struct GBVideoRenderer* renderer, enum GBModel model, bool borders);
+static void GBVideoGLRendererDeinit(struct GBVideoRenderer* renderer);
+static uint8_t GBVideoGLRendererWriteVideoRegister(struct GBVideoRenderer* renderer, uint16_t address, uint8_t value);
+static void GBVideoGLRendererWriteSGBPacket(struct GBVideoRenderer* renderer, uint8_t* data);
+static void GBVideoGLRendererWritePalette(struct GBVideoRenderer* renderer, int index, uint16_t value);
+static void GBVideoGLRendererWriteVRAM(struct GBVideoRenderer* renderer, uint16_t address);
+static void GBVideoGLRendererWriteOAM(struct GBVideoRenderer* renderer, uint16_t oam);
+static void GBVideoGLRendererDrawRange(struct GBVideoRenderer* renderer, int startX, int endX, int y, struct GBObj* obj, size_t oamMax);
+static void GBVideoGLRendererFinishScanline(struct GBVideoRenderer* renderer, int y);
+static void GBVideoGLRendererFinishFrame(struct GBVideoRenderer* renderer);
+static void GBVideoGLRendererEnableSGBBorder(struct GBVideoRenderer* renderer, bool enable);
+static void GBVideoGLRendererGetPixels(struct GBVideoRenderer* renderer, size_t* stride, const void** pixels);
+static void GBVideoGLRendererPutPixels(struct GBVideoRenderer* renderer, size_t stride, const void* pixels);
+
+static void _flush(struct GBVideoGLRenderer* renderer);
+
+static const GLchar* const _gles3Header =
+	"#version 300 es\n"
+	"#define OUT(n) layout(location = n)\n"
+	"precision highp float;\n"
+	"precision highp int;\n";
+
+static const GLchar* const _gl3Header =
+	"#version 130\n"
+	"#define OUT(n)\n"
+	"precision highp float;\n";
+
+static const char* const _vertexShader =
+	"in ivec2 position;\n"
+	"in ivec4 params;\n"
+	"uniform ivec2 dims;\n"
+	"flat out ivec4 span;\n"
+
+	"void main() {\n"
+	"	span = params;\n"
+	"	gl_Position = vec4(vec2(position) * 2. / vec2(dims) - 1., 0., 1.);\n"
+	"}";
+
+// Mirrors GBVideoSoftwareRendererDrawBackground, GBVideoSoftwareRendererDrawObj and the palette
+// lookup at the end of GBVideoSoftwareRendererDrawRange, one output pixel at a time
+static const char* const _renderSpan =
+	"uniform highp usampler2D vram;\n"
+	"uniform sampler2D palette;\n"
+	"uniform highp usampler2D lookup;\n"
+	"uniform highp usampler2D attributes;\n"
+	"uniform highp usampler2D objects;\n"
+	"uniform int scale;\n"
+	"uniform ivec2 offset;\n"
+	"uniform ivec2 objOffset;\n"
+	"uniform int model;\n"
+	"flat in ivec4 span;\n"
+	"OUT(0) out vec4 color;\n"
+	"OUT(1) out uint index;\n"
+
+	"int fetchVram(int address) {\n"
+	"	return int(texelFetch(vram, ivec2(address & 255, address >> 8), 0).r);\n"
+	"}\n"
+
+	"int tilePixel(int address, int x) {\n"
+	"	int lo = fetchVram(address) >> (7 - x);\n"
+	"	int hi = fetchVram(address + 1) >> (7 - x);\n"
+	"	return ((hi & 1) << 1) | (lo & 1);\n"
+	"}\n"
+
+	"void main() {\n"
+	"	ivec2 coord = ivec2(gl_FragCoord.xy) / scale - offset;\n"
+	"	int flags = span.z;\n"
+	"	int row = 0;\n"
+	"	if ((flags & 1) == 0) {\n"
+	"		int sx = (coord.x + span.x) & 0xFF;\n"
+	"		int map = ((flags & 2) != 0 ? 0x1C00 : 0x1800) + ((span.y >> 3) & 0x1F) * 0x20 + (sx >> 3);\n"
+	"		int bgTile = fetchVram(map);\n"
+	"		int data = 0;\n"
+	"		if ((flags & 4) == 0) {\n"
+	"			data = 0x1000;\n"
+	"			if (bgTile >= 0x80) {\n"
+	"				bgTile -= 0x100;\n"
+	"			}\n"
+	"		}\n"
+	"		int localX = sx & 7;\n"
+	"		int localY = span.y & 7;\n"
+	"		if ((model & 1) != 0) {\n"
+	"			int attrs = fetchVram(map + 0x2000);\n"
+	"			row = (attrs & 7) * 4;\n"
+	"			if ((attrs & 0x80) != 0 && (flags & 8) != 0) {\n"
+	"				row |= 0x80;\n"
+	"			}\n"
+	"			if ((attrs & 8) != 0) {\n"
+	"				data += 0x2000;\n"
+	"			}\n"
+	"			if ((attrs & 0x40) != 0) {\n"
+	"				localY = 7 - localY;\n"
+	"			}\n"
+	"			if ((attrs & 0x20) != 0) {\n"
+	"				localX = 7 - localX;\n"
+	"			}\n"
+	"		}\n"
+	"		row |= tilePixel(data + (bgTile * 8 + localY) * 2, localX);\n"
+	"	}\n"
+	"	if ((flags & 0x10) != 0) {\n"
+	"		bool objSize = (flags & 0x20) != 0;\n"
+	"		int nObj = (flags >> 8) & 0xF;\n"
+	"		for (int i = 0; i < nObj; ++i) {\n"
+	"			ivec4 obj = ivec4(texelFetch(objects, ivec2(i, coord.y), 0));\n"
+	"			int objX = obj.y + objOffset.x;\n"
+	"			if (coord.x < objX - 8 || coord.x >= objX) {\n"
+	"				continue;\n"
+	"			}\n"
+	"			int objY = obj.x + objOffset.y;\n"
+	"			int attr = obj.w;\n"
+	"			int tileOffset = 0;\n"
+	"			int localY = (coord.y - objY - 16) & 7;\n"
+	"			if ((attr & 0x40) != 0) {\n"
+	"				localY = 7 - localY;\n"
+	"				if (objSize && coord.y - objY < -8) {\n"
+	"					++tileOffset;\n"
+	"				}\n"
+	"			} else if (objSize && coord.y - objY >= -8) {\n"
+	"				++tileOffset;\n"
+	"			}\n"
+	"			if (objSize && (obj.z & 1) != 0) {\n"
+	"				--tileOffset;\n"
+	"			}\n"
+	"			int mask = (attr & 0x80) != 0 ? 0x63 : 0x60;\n"
+	"			int mask2 = (attr & 0x80) != 0 ? 0 : 0x83;\n"
+	"			int p;\n"
+	"			int data = 0;\n"
+	"			if ((model & 1) != 0) {\n"
+	"				p = ((attr & 7) + 8) * 4;\n"
+	"				if ((attr & 8) != 0) {\n"
+	"					data = 0x2000;\n"
+	"				}\n"
+	"				if ((flags & 8) == 0) {\n"
+	"					mask = 0x60;\n"
+	"					mask2 = 0x83;\n"
+	"				}\n"
+	"			} else {\n"
+	"				p = (((attr >> 4) & 1) + 8) * 4;\n"
+	"			}\n"
+	"			int localX = (coord.x - objX) & 7;\n"
+	"			if ((attr & 0x20) != 0) {\n"
+	"				localX = 7 - localX;\n"
+	"			}\n"
+	"			int pixel = tilePixel(data + ((obj.z + tileOffset) * 8 + localY) * 2, localX);\n"
+	"			if (pixel != 0 && (row & mask) == 0 && (row & mask2) <= 0x80) {\n"
+	"				row = p | pixel;\n"
+	"			}\n"
+	"		}\n"
+	"	}\n"
+	"	index = uint(row);\n"
+	"	int mode = (flags >> 6) & 3;\n"
+	"	if (mode == 2) {\n"
+	"		color = vec4(0., 0., 0., 1.);\n"
+	"	} else if (mode == 3) {\n"
+	"		color = texelFetch(palette, ivec2(0, 0), 0);\n"
+	"	} else {\n"
+	"		int p = 0;\n"
+	"		if ((model & 2) != 0) {\n"
+	"			p = int(texelFetch(attributes, ivec2(coord.x >> 5, coord.y >> 3), 0).r);\n"
+	"			p = ((p >> (6 - ((coord.x >> 2) & 6))) & 3) << 2;\n"
+	"		}\n"
+	"		color = texelFetch(palette, ivec2(p | int(texelFetch(lookup, ivec2(row & 0x7F, 0), 0).r), 0), 0);\n"
+	"	}\n"
+	"}";
+
+static const char* const _renderBorder =
+	"uniform sampler2D border;\n"
+	"uniform int scale;\n"
+	"OUT(0) out vec4 color;\n"
+
+	"void main() {\n"
+	"	vec4 pixel = texelFetch(border, ivec2(gl_FragCoord.xy) / scale, 0);\n"
+	"	if (pixel.a < 0.5) {\n"
+	"		discard;\n"
+	"	}\n"
+	"	color = pixel;\n"
+	"}";
+
+void GBVideoGLRendererCreate(struct GBVideoGLRenderer* renderer) {
+	renderer->d.init = GBVideoGLRendererInit;
+	renderer->d.deinit = GBVideoGLRendererDeinit;
+	renderer->d.writeVideoRegister = GBVideoGLRendererWriteVideoRegister;
+	renderer->d.writeSGBPacket = GBVideoGLRendererWriteSGBPacket;
+	renderer->d.writePalette = GBVideoGLRendererWritePalette;
+	renderer->d.writeVRAM = GBVideoGLRendererWriteVRAM;
+	renderer->d.writeOAM = GBVideoGLRendererWriteOAM;
+	renderer->d.drawRange = GBVideoGLRendererDrawRange;
+	renderer->d.finishScanline = GBVideoGLRendererFinishScanline;
+	renderer->d.finishFrame = GBVideoGLRendererFinishFrame;
+	renderer->d.enableSGBBorder = GBVideoGLRendererEnableSGBBorder;
+	renderer->d.getPixels = GBVideoGLRendererGetPixels;
+	renderer->d.putPixels = GBVideoGLRendererPutPixels;
+
+	renderer->d.disableBG = false;
+	renderer->d.disableOBJ = false;
+	renderer->d.disableWIN = false;
+
+	renderer->scale = 1;
+	memset(renderer->rawPalette, 0, sizeof(renderer->rawPalette));
+	memset(renderer->palette, 0, sizeof(renderer->palette));
+}
+
+static bool _hasBorders(const struct GBVideoGLRenderer* renderer) {
+	return renderer->model & GB_MODEL_SGB && renderer->sgbBorders;
+}
+
+static void _dimensions(const struct GBVideoGLRenderer* renderer, int* width, int* height) {
+	if (_hasBorders(renderer)) {
+		*width = SGB_BORDER_WIDTH;
+		*height = SGB_BORDER_HEIGHT;
+	} else {
+		*width = GB_VIDEO_HORIZONTAL_PIXELS;
+		*height = GB_VIDEO_VERTICAL_PIXELS;
+	}
+}
+
+static uint32_t _convertColor(enum GBModel model, uint16_t value) {
+	if (model == GB_MODEL_AGB) {
+		unsigned r = M_R5(value);
+		unsigned g = M_G5(value);
+		unsigned b = M_B5(value);
+		r = (r * r) >> 2;
+		g = (g * g) >> 2;
+		b = (b * b) >> 2;
+		return r | (g << 8) | (b << 16);
+	}
+	uint32_t color = M_RGB5_TO_BGR8(value);
+	color |= (color >> 5) & 0x070707;
+	return color;
+}
+
+static void _initTexture(GLuint tex, GLenum internalFormat, GLenum format, GLenum type, int width, int height) {
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+}
+
+static void _initOutput(struct GBVideoGLRenderer* glRenderer) {
+	int width;
+	int height;
+	_dimensions(glRenderer, &width, &height);
+	glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo);
+	_initTexture(glRenderer->outputTex, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE, width * glRenderer->scale, height * glRenderer->scale);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, glRenderer->outputTex, 0);
+	_initTexture(glRenderer->tex[GB_GL_TEX_INDEX], GL_R8UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, width * glRenderer->scale, height * glRenderer->scale);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, glRenderer->tex[GB_GL_TEX_INDEX], 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static GLuint _compileProgram(const char** shaderBuffer, GLuint vs, const char* fragment, char* log) {
+	GLuint program = glCreateProgram();
+	GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
+	shaderBuffer[1] = fragment;
+	glAttachShader(program, vs);
+	glAttachShader(program, fs);
+	glShaderSource(fs, 2, shaderBuffer, 0);
+	glCompileShader(fs);
+	glGetShaderInfoLog(fs, 2048, 0, log);
+	if (log[0]) {
+		mLOG(GB, ERROR, "Fragment shader compilation failure: %s", log);
+	}
+	glBindAttribLocation(program, 0, "position");
+	glBindAttribLocation(program, 1, "params");
+#ifndef BUILD_GLES3
+	glBindFragDataLocation(program, 0, "color");
+	glBindFragDataLocation(program, 1, "index");
+#endif
+	glLinkProgram(program);
+	glGetProgramInfoLog(program, 2048, 0, log);
+	if (log[0]) {
+		mLOG(GB, ERROR, "Program link failure: %s", log);
+	}
+	glDeleteShader(fs);
+	return program;
+}
+
+static void GBVideoGLRendererInit(struct GBVideoRenderer* renderer, enum GBModel model, bool sgbBorders) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	glRenderer->lcdc = 0;
+	glRenderer->scy = 0;
+	glRenderer->scx = 0;
+	glRenderer->wy = 0;
+	glRenderer->currentWy = 0;
+	glRenderer->currentWx = 0;
+	glRenderer->lastY = GB_VIDEO_VERTICAL_PIXELS;
+	glRenderer->lastX = 0;
+	glRenderer->hasWindow = false;
+	glRenderer->wx = 0;
+	glRenderer->model = model;
+	glRenderer->sgbTransfer = 0;
+	glRenderer->sgbCommandHeader = 0;
+	glRenderer->sgbBorders = sgbBorders;
+	glRenderer->objOffsetX = 0;
+	glRenderer->objOffsetY = 0;
+	glRenderer->offsetScx = 0;
+	glRenderer->offsetScy = 0;
+	glRenderer->offsetWx = 0;
+	glRenderer->offsetWy = 0;
+
+	int i;
+	for (i = 0; i < 64; ++i) {
+		glRenderer->lookup[i] = i;
+	}
+	memset(glRenderer->objThisLine, 0, sizeof(glRenderer->objThisLine));
+	glRenderer->nSpans = 0;
+	glRenderer->frozenSpans = false;
+	glRenderer->vramDirty = ~0ULL;
+	glRenderer->paletteDirty = true;
+	glRenderer->lookupDirty = true;
+	glRenderer->objDirtyStart = 0;
+	glRenderer->objDirtyEnd = GB_VIDEO_VERTICAL_PIXELS;
+	glRenderer->borderDirty = false;
+
+	glRenderer->temporaryBuffer = NULL;
+	glRenderer->transferRow = malloc(GB_VIDEO_HORIZONTAL_PIXELS * glRenderer->scale * 4 * sizeof(*glRenderer->transferRow));
+	glRenderer->border = NULL;
+	if (model & GB_MODEL_SGB) {
+		glRenderer->border = calloc(SGB_BORDER_WIDTH * SGB_BORDER_HEIGHT, sizeof(*glRenderer->border));
+	}
+
+	glGenFramebuffers(1, &glRenderer->fbo);
+	glGenTextures(GB_GL_TEX_MAX, glRenderer->tex);
+	_initTexture(glRenderer->tex[GB_GL_TEX_VRAM], GL_R8UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, GB_GL_VRAM_ROW_SIZE, GB_GL_VRAM_ROWS);
+	_initTexture(glRenderer->tex[GB_GL_TEX_PALETTE], GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 128, 1);
+	_initTexture(glRenderer->tex[GB_GL_TEX_LOOKUP], GL_R8UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, 64, 1);
+	_initTexture(glRenderer->tex[GB_GL_TEX_ATTRIBUTES], GL_R8UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, 5, GB_VIDEO_VERTICAL_PIXELS / 8);
+	_initTexture(glRenderer->tex[GB_GL_TEX_OBJ], GL_RGBA8UI, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, 10, GB_VIDEO_VERTICAL_PIXELS);
+	_initTexture(glRenderer->tex[GB_GL_TEX_BORDER], GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, SGB_BORDER_WIDTH, SGB_BORDER_HEIGHT);
+	_initOutput(glRenderer);
+
+	glGenBuffers(1, &glRenderer->vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, glRenderer->vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(glRenderer->vertices), NULL, GL_STREAM_DRAW);
+	glGenVertexArrays(1, &glRenderer->vao);
+	glBindVertexArray(glRenderer->vao);
+	glEnableVertexAttribArray(0);
+	glVertexAttribIPointer(0, 2, GL_INT, sizeof(struct GBVideoGLVertex), (const void*) offsetof(struct GBVideoGLVertex, x));
+	glEnableVertexAttribArray(1);
+	glVertexAttribIPointer(1, 4, GL_INT, sizeof(struct GBVideoGLVertex), (const void*) offsetof(struct GBVideoGLVertex, sx));
+
+	char log[2048];
+	const GLchar* shaderBuffer[2];
+	const GLubyte* version = glGetString(GL_VERSION);
+	if (strncmp((const char*) version, "OpenGL ES ", strlen("OpenGL ES "))) {
+		shaderBuffer[0] = _gl3Header;
+	} else {
+		shaderBuffer[0] = _gles3Header;
+	}
+
+	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+	shaderBuffer[1] = _vertexShader;
+	glShaderSource(vs, 2, shaderBuffer, 0);
+	glCompileShader(vs);
+	glGetShaderInfoLog(vs, 2048, 0, log);
+	if (log[0]) {
+		mLOG(GB, ERROR, "Vertex shader compilation failure: %s", log);
+	}
+	glRenderer->program = _compileProgram(shaderBuffer, vs, _renderSpan, log);
+	glRenderer->borderProgram = _compileProgram(shaderBuffer, vs, _renderBorder, log);
+	glDeleteShader(vs);
+
+	// Sampler units and the model never change for the lifetime of the programs
+	glUseProgram(glRenderer->program);
+	glUniform1i(glGetUniformLocation(glRenderer->program, "vram"), GB_GL_TEX_VRAM);
+	glUniform1i(glGetUniformLocation(glRenderer->program, "palette"), GB_GL_TEX_PALETTE);
+	glUniform1i(glGetUniformLocation(glRenderer->program, "lookup"), GB_GL_TEX_LOOKUP);
+	glUniform1i(glGetUniformLocation(glRenderer->program, "attributes"), GB_GL_TEX_ATTRIBUTES);
+	glUniform1i(glGetUniformLocation(glRenderer->program, "objects"), GB_GL_TEX_OBJ);
+	glUniform1i(glGetUniformLocation(glRenderer->program, "model"), (model >= GB_MODEL_CGB ? 1 : 0) | (model & GB_MODEL_SGB ? 2 : 0));
+	glUseProgram(glRenderer->borderProgram);
+	glUniform1i(glGetUniformLocation(glRenderer->borderProgram, "border"), GB_GL_TEX_BORDER);
+	glUseProgram(0);
+	glBindVertexArray(0);
+}
+
+static void GBVideoGLRendererDeinit(struct GBVideoRenderer* renderer) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	free(glRenderer->temporaryBuffer);
+	glRenderer->temporaryBuffer = NULL;
+	free(glRenderer->transferRow);
+	glRenderer->transferRow = NULL;
+	free(glRenderer->border);
+	glRenderer->border = NULL;
+
+	glDeleteFramebuffers(1, &glRenderer->fbo);
+	glDeleteTextures(GB_GL_TEX_MAX, glRenderer->tex);
+	glDeleteBuffers(1, &glRenderer->vbo);
+	glDeleteVertexArrays(1, &glRenderer->vao);
+	glDeleteProgram(glRenderer->program);
+	glDeleteProgram(glRenderer->borderProgram);
+}
+
+static void _uploadVRAM(struct GBVideoGLRenderer* glRenderer) {
+	uint64_t dirty = glRenderer->vramDirty;
+	if (!dirty) {
+		return;
+	}
+	glRenderer->vramDirty = 0;
+	glActiveTexture(GL_TEXTURE0 + GB_GL_TEX_VRAM);
+	glBindTexture(GL_TEXTURE_2D, glRenderer->tex[GB_GL_TEX_VRAM]);
+	int start;
+	for (start = 0; start < GB_GL_VRAM_ROWS; ++start) {
+		if (!(dirty & (1ULL << start))) {
+			continue;
+		}
+		int end = start + 1;
+		while (end < GB_GL_VRAM_ROWS && (dirty & (1ULL << end))) {
+			++end;
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, start, GB_GL_VRAM_ROW_SIZE, end - start, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &glRenderer->d.vram[start * GB_GL_VRAM_ROW_SIZE]);
+		start = end;
+	}
+}
+
+static void _uploadState(struct GBVideoGLRenderer* glRenderer) {
+	if (glRenderer->paletteDirty) {
+		glRenderer->paletteDirty = false;
+		glActiveTexture(GL_TEXTURE0 + GB_GL_TEX_PALETTE);
+		glBindTexture(GL_TEXTURE_2D, glRenderer->tex[GB_GL_TEX_PALETTE]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 128, 1, GL_RGBA, GL_UNSIGNED_BYTE, glRenderer->palette);
+	}
+	if (glRenderer->lookupDirty) {
+		glRenderer->lookupDirty = false;
+		glActiveTexture(GL_TEXTURE0 + GB_GL_TEX_LOOKUP);
+		glBindTexture(GL_TEXTURE_2D, glRenderer->tex[GB_GL_TEX_LOOKUP]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 64, 1, GL_RED_INTEGER, GL_UNSIGNED_BYTE, glRenderer->lookup);
+	}
+	if (glRenderer->model & GB_MODEL_SGB && glRenderer->d.sgbAttributes) {
+		// Only 90 bytes, and packets rewrite them without going through the renderer on load
+		glActiveTexture(GL_TEXTURE0 + GB_GL_TEX_ATTRIBUTES);
+		glBindTexture(GL_TEXTURE_2D, glRenderer->tex[GB_GL_TEX_ATTRIBUTES]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 5, GB_VIDEO_VERTICAL_PIXELS / 8, GL_RED_INTEGER, GL_UNSIGNED_BYTE, glRenderer->d.sgbAttributes);
+	}
+	if (glRenderer->objDirtyStart < glRenderer->objDirtyEnd) {
+		glActiveTexture(GL_TEXTURE0 + GB_GL_TEX_OBJ);
+		glBindTexture(GL_TEXTURE_2D, glRenderer->tex[GB_GL_TEX_OBJ]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, glRenderer->objDirtyStart, 10, glRenderer->objDirtyEnd - glRenderer->objDirtyStart, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, glRenderer->objThisLine[glRenderer->objDirtyStart]);
+		glRenderer->objDirtyStart = GB_VIDEO_VERTICAL_PIXELS;
+		glRenderer->objDirtyEnd = 0;
+	}
+	if (glRenderer->borderDirty) {
+		glActiveTexture(GL_TEXTURE0 + GB_GL_TEX_BORDER);
+		glBindTexture(GL_TEXTURE_2D, glRenderer->tex[GB_GL_TEX_BORDER]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, SGB_BORDER_WIDTH, SGB_BORDER_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, glRenderer->border);
+	}
+}
+
+static void _setSpanVertices(struct GBVideoGLVertex* vertices, int startX, int endX, int startY, int endY, int sx, int sy, int flags) {
+	static const int corners[GB_GL_VERTICES_PER_SPAN][2] = {
+		{ 0, 0 }, { 1, 0 }, { 0, 1 },
+		{ 0, 1 }, { 1, 0 }, { 1, 1 },
+	};
+	int i;
+	for (i = 0; i < GB_GL_VERTICES_PER_SPAN; ++i) {
+		vertices[i].x = corners[i][0] ? endX : startX;
+		vertices[i].y = corners[i][1] ? endY : startY;
+		vertices[i].sx = sx;
+		vertices[i].sy = sy;
+		vertices[i].flags = flags;
+		vertices[i].padding = 0;
+	}
+}
+
+// Draws every queued span, so anything they read may be changed afterwards
+static void _flush(struct GBVideoGLRenderer* glRenderer) {
+	if (!glRenderer->nSpans && !glRenderer->borderDirty) {
+		return;
+	}
+	int width;
+	int height;
+	_dimensions(glRenderer, &width, &height);
+	int nVertices = glRenderer->nSpans * GB_GL_VERTICES_PER_SPAN;
+	if (glRenderer->borderDirty) {
+		_setSpanVertices(&glRenderer->vertices[nVertices], 0, width, 0, height, 0, 0, 0);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	_uploadVRAM(glRenderer);
+	_uploadState(glRenderer);
+
+	int i;
+	for (i = 0; i < GB_GL_TEX_INDEX; ++i) {
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, glRenderer->tex[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo);
+	glViewport(0, 0, width * glRenderer->scale, height * glRenderer->scale);
+	glBindVertexArray(glRenderer->vao);
+	glBindBuffer(GL_ARRAY_BUFFER, glRenderer->vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(glRenderer->vertices), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, (nVertices + (glRenderer->borderDirty ? GB_GL_VERTICES_PER_SPAN : 0)) * sizeof(struct GBVideoGLVertex), glRenderer->vertices);
+
+	if (glRenderer->nSpans) {
+		GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		if (glRenderer->frozenSpans) {
+			drawBuffers[0] = GL_NONE;
+		}
+		glDrawBuffers(2, drawBuffers);
+		glUseProgram(glRenderer->program);
+		glUniform2i(glGetUniformLocation(glRenderer->program, "dims"), width, height);
+		glUniform1i(glGetUniformLocation(glRenderer->program, "scale"), glRenderer->scale);
+		if (_hasBorders(glRenderer)) {
+			glUniform2i(glGetUniformLocation(glRenderer->program, "offset"), (SGB_BORDER_WIDTH - GB_VIDEO_HORIZONTAL_PIXELS) / 2, (SGB_BORDER_HEIGHT - GB_VIDEO_VERTICAL_PIXELS) / 2);
+		} else {
+			glUniform2i(glGetUniformLocation(glRenderer->program, "offset"), 0, 0);
+		}
+		glUniform2i(glGetUniformLocation(glRenderer->program, "objOffset"), glRenderer->objOffsetX, glRenderer->objOffsetY);
+		glDrawArrays(GL_TRIANGLES, 0, nVertices);
+	}
+	if (glRenderer->borderDirty) {
+		GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_NONE };
+		glDrawBuffers(2, drawBuffers);
+		glUseProgram(glRenderer->borderProgram);
+		glUniform2i(glGetUniformLocation(glRenderer->borderProgram, "dims"), width, height);
+		glUniform1i(glGetUniformLocation(glRenderer->borderProgram, "scale"), glRenderer->scale);
+		glDrawArrays(GL_TRIANGLES, nVertices, GB_GL_VERTICES_PER_SPAN);
+	}
+
+	glUseProgram(0);
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glRenderer->nSpans = 0;
+	glRenderer->borderDirty = false;
+}
+
+static void _queueSpan(struct GBVideoGLRenderer* glRenderer, int startX, int endX, int startY, int endY, int sx, int sy, int flags) {
+	if (startX >= endX) {
+		return;
+	}
+	bool frozen = ((flags >> GB_GL_SPAN_MODE_SHIFT) & 3) == 1;
+	if (glRenderer->nSpans == GB_GL_SPANS_MAX || (glRenderer->nSpans && frozen != glRenderer->frozenSpans)) {
+		_flush(glRenderer);
+	}
+	glRenderer->frozenSpans = frozen;
+	if (_hasBorders(glRenderer)) {
+		startX += (SGB_BORDER_WIDTH - GB_VIDEO_HORIZONTAL_PIXELS) / 2;
+		endX += (SGB_BORDER_WIDTH - GB_VIDEO_HORIZONTAL_PIXELS) / 2;
+		startY += (SGB_BORDER_HEIGHT - GB_VIDEO_VERTICAL_PIXELS) / 2;
+		endY += (SGB_BORDER_HEIGHT - GB_VIDEO_VERTICAL_PIXELS) / 2;
+	}
+	_setSpanVertices(&glRenderer->vertices[glRenderer->nSpans * GB_GL_VERTICES_PER_SPAN], startX, endX, startY, endY, sx & 0xFF, sy & 0xFF, flags);
+	++glRenderer->nSpans;
+}
+
+static void _clearScreen(struct GBVideoGLRenderer* renderer) {
+	if (renderer->model & GB_MODEL_SGB) {
+		return;
+	}
+	_queueSpan(renderer, 0, GB_VIDEO_HORIZONTAL_PIXELS, 0, GB_VIDEO_VERTICAL_PIXELS, 0, 0, GB_GL_SPAN_ZERO | (3 << GB_GL_SPAN_MODE_SHIFT));
+}
+
+static void _regenerateSGBBorder(struct GBVideoGLRenderer* renderer) {
+	int i;
+	for (i = 0; i < 0x40; ++i) {
+		uint16_t color;
+		LOAD_16LE(color, 0x800 + i * 2, renderer->d.sgbMapRam);
+		renderer->d.writePalette(&renderer->d, i + 0x40, color);
+	}
+	// Skipped tiles keep whatever was drawn there before, as they do in the software renderer
+	int x, y;
+	for (y = 0; y < SGB_BORDER_HEIGHT; ++y) {
+		for (x = 0; x < SGB_BORDER_WIDTH; x += 8) {
+			if (x >= 48 && x < 208 && y >= 40 && y < 184) {
+				continue;
+			}
+			uint16_t mapData;
+			LOAD_16LE(mapData, (x >> 2) + (y & ~7) * 8, renderer->d.sgbMapRam);
+			if (UNLIKELY(SGBBgAttributesGetTile(mapData) >= 0x100)) {
+				continue;
+			}
+
+			int localY = y & 0x7;
+			if (SGBBgAttributesIsYFlip(mapData)) {
+				localY = 7 - localY;
+			}
+			uint8_t tileData[4];
+			tileData[0] = renderer->d.sgbCharRam[(SGBBgAttributesGetTile(mapData) * 16 + localY) * 2 + 0x00];
+			tileData[1] = renderer->d.sgbCharRam[(SGBBgAttributesGetTile(mapData) * 16 + localY) * 2 + 0x01];
+			tileData[2] = renderer->d.sgbCharRam[(SGBBgAttributesGetTile(mapData) * 16 + localY) * 2 + 0x10];
+			tileData[3] = renderer->d.sgbCharRam[(SGBBgAttributesGetTile(mapData) * 16 + localY) * 2 + 0x11];
+
+			size_t base = y * SGB_BORDER_WIDTH + x;
+			int paletteBase = SGBBgAttributesGetPalette(mapData) * 0x10;
+			int colorSelector;
+
+			int flip = 0;
+			if (SGBBgAttributesIsXFlip(mapData)) {
+				flip = 7;
+			}
+			for (i = 7; i >= 0; --i) {
+				colorSelector = (tileData[0] >> i & 0x1) << 0 | (tileData[1] >> i & 0x1) << 1 | (tileData[2] >> i & 0x1) << 2 | (tileData[3] >> i & 0x1) << 3;
+				renderer->border[(base + 7 - i) ^ flip] = renderer->palette[paletteBase | colorSelector] | 0xFF000000;
+			}
+		}
+	}
+	renderer->borderDirty = true;
+}
+
+static bool _inWindow(struct GBVideoGLRenderer* renderer) {
+	return GBRegisterLCDCIsWindow(renderer->lcdc) && GB_VIDEO_HORIZONTAL_PIXELS + 7 > renderer->wx;
+}
+
+static void GBVideoGLRendererUpdateWindow(struct GBVideoGLRenderer* renderer, bool before, bool after, uint8_t oldWy) {
+	if (renderer->lastY >= GB_VIDEO_VERTICAL_PIXELS || !(after || before)) {
+		return;
+	}
+	if (renderer->lastY >= oldWy) {
+		if (!after) {
+			renderer->currentWy -= renderer->lastY;
+			renderer->hasWindow = true;
+		} else if (!before) {
+			if (!renderer->hasWindow) {
+				renderer->currentWy = renderer->lastY - renderer->wy;
+				if (renderer->lastY >= renderer->wy && renderer->lastX > renderer->wx) {
+					++renderer->currentWy;
+				}
+			} else {
+				renderer->currentWy += renderer->lastY;
+			}
+		} else if (renderer->wy != oldWy) {
+			renderer->currentWy += oldWy - renderer->wy;
+			renderer->hasWindow = true;
+		}
+	}
+}
+
+static void _writeLookup(struct GBVideoGLRenderer* renderer, int base, uint8_t value) {
+	int i;
+	for (i = 0; i < 4; ++i) {
+		uint8_t entry = (value >> (i * 2)) & 3;
+		if (renderer->lookup[base + i] != entry) {
+			_flush(renderer);
+			renderer->lookup[base + i] = entry;
+			renderer->lookupDirty = true;
+		}
+	}
+}
+
+static uint8_t GBVideoGLRendererWriteVideoRegister(struct GBVideoRenderer* renderer, uint16_t address, uint8_t value) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (renderer->cache) {
+		GBVideoCacheWriteVideoRegister(renderer->cache, address, value);
+	}
+	bool wasWindow = _inWindow(glRenderer);
+	uint8_t wy = glRenderer->wy;
+	switch (address) {
+	case REG_LCDC:
+		glRenderer->lcdc = value;
+		GBVideoGLRendererUpdateWindow(glRenderer, wasWindow, _inWindow(glRenderer), wy);
+		break;
+	case REG_SCY:
+		glRenderer->scy = value;
+		break;
+	case REG_SCX:
+		glRenderer->scx = value;
+		break;
+	case REG_WY:
+		glRenderer->wy = value;
+		GBVideoGLRendererUpdateWindow(glRenderer, wasWindow, _inWindow(glRenderer), wy);
+		break;
+	case REG_WX:
+		glRenderer->wx = value;
+		GBVideoGLRendererUpdateWindow(glRenderer, wasWindow, _inWindow(glRenderer), wy);
+		break;
+	case REG_BGP:
+		_writeLookup(glRenderer, 0, value);
+		break;
+	case REG_OBP0:
+		_writeLookup(glRenderer, 0x20, value);
+		break;
+	case REG_OBP1:
+		_writeLookup(glRenderer, 0x24, value);
+		break;
+	}
+	return value;
+}
+
+static void GBVideoGLRendererWriteSGBPacket(struct GBVideoRenderer* renderer, uint8_t* data) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	_flush(glRenderer);
+	memcpy(glRenderer->sgbPacket, data, sizeof(glRenderer->sgbPacket));
+	glRenderer->sgbCommandHeader = data[0];
+	glRenderer->sgbTransfer = 0;
+	int set;
+	switch (glRenderer->sgbCommandHeader >> 3) {
+	case SGB_PAL_SET:
+		glRenderer->sgbPacket[1] = data[9];
+		if (!(data[9] & 0x80)) {
+			break;
+		}
+		// Fall through
+	case SGB_ATTR_SET:
+		set = glRenderer->sgbPacket[1] & 0x3F;
+		if (set <= 0x2C) {
+			memcpy(renderer->sgbAttributes, &renderer->sgbAttributeFiles[set * 90], 90);
+		}
+		break;
+	case SGB_ATTR_BLK:
+	case SGB_ATTR_LIN:
+	case SGB_ATTR_DIV:
+	case SGB_ATTR_CHR:
+		GBVideoRendererWriteSGBAttributes(renderer, glRenderer->sgbPacket);
+		break;
+	case SGB_ATRC_EN:
+	case SGB_MASK_EN:
+		if (glRenderer->sgbBorders && !renderer->sgbRenderMode) {
+			_regenerateSGBBorder(glRenderer);
+		}
+	}
+}
+
+static void GBVideoGLRendererWritePalette(struct GBVideoRenderer* renderer, int index, uint16_t value) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	uint16_t raw = value;
+	if (glRenderer->model & GB_MODEL_SGB) {
+		if (index < 0x10 && index && !(index & 3)) {
+			raw = glRenderer->rawPalette[0];
+		} else if (index >= 0x40 && !(index & 0xF)) {
+			raw = glRenderer->rawPalette[0];
+		}
+	}
+	if (renderer->cache) {
+		mCacheSetWritePalette(renderer->cache, index, mColorFrom555(raw));
+	}
+	uint32_t color = _convertColor(glRenderer->model, raw);
+	if (glRenderer->palette[index] != color) {
+		_flush(glRenderer);
+		glRenderer->palette[index] = color;
+		glRenderer->paletteDirty = true;
+	}
+	glRenderer->rawPalette[index] = raw;
+
+	if (glRenderer->model & GB_MODEL_SGB && !index && GBRegisterLCDCIsEnable(glRenderer->lcdc)) {
+		renderer->writePalette(renderer, 0x04, value);
+		renderer->writePalette(renderer, 0x08, value);
+		renderer->writePalette(renderer, 0x0C, value);
+		renderer->writePalette(renderer, 0x40, value);
+		renderer->writePalette(renderer, 0x50, value);
+		renderer->writePalette(renderer, 0x60, value);
+		renderer->writePalette(renderer, 0x70, value);
+		if (glRenderer->sgbBorders && !renderer->sgbRenderMode) {
+			_regenerateSGBBorder(glRenderer);
+		}
+	}
+}
+
+static void GBVideoGLRendererWriteVRAM(struct GBVideoRenderer* renderer, uint16_t address) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (renderer->cache) {
+		mCacheSetWriteVRAM(renderer->cache, address);
+	}
+	// This is called before the byte is stored, so the queued spans have to be drawn with the old one
+	_flush(glRenderer);
+	glRenderer->vramDirty |= 1ULL << (address / GB_GL_VRAM_ROW_SIZE);
+}
+
+static void GBVideoGLRendererWriteOAM(struct GBVideoRenderer* renderer, uint16_t oam) {
+	UNUSED(renderer);
+	UNUSED(oam);
+	// Nothing to do
+}
+
+static void GBVideoGLRendererDrawRange(struct GBVideoRenderer* renderer, int startX, int endX, int y, struct GBObj* obj, size_t oamMax) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	glRenderer->lastY = y;
+	glRenderer->lastX = endX;
+
+	int flags = renderer->sgbRenderMode << GB_GL_SPAN_MODE_SHIFT;
+	if (GBRegisterLCDCIsBgEnable(glRenderer->lcdc)) {
+		flags |= GB_GL_SPAN_BG_ENABLE;
+	}
+	if (GBRegisterLCDCIsTileData(glRenderer->lcdc)) {
+		flags |= GB_GL_SPAN_TILE_DATA;
+	}
+	if (GBRegisterLCDCIsObjSize(glRenderer->lcdc)) {
+		flags |= GB_GL_SPAN_OBJ_SIZE;
+	}
+	if (GBRegisterLCDCIsObjEnable(glRenderer->lcdc) && !renderer->disableOBJ && oamMax) {
+		if (oamMax > 10) {
+			oamMax = 10;
+		}
+		memcpy(glRenderer->objThisLine[y], obj, oamMax * sizeof(*obj));
+		if (y < glRenderer->objDirtyStart) {
+			glRenderer->objDirtyStart = y;
+		}
+		if (y >= glRenderer->objDirtyEnd) {
+			glRenderer->objDirtyEnd = y + 1;
+		}
+		flags |= GB_GL_SPAN_OBJ_ENABLE | (oamMax << GB_GL_SPAN_NOBJ_SHIFT);
+	}
+	int bgFlags = flags;
+	if (GBRegisterLCDCIsTileMap(glRenderer->lcdc)) {
+		bgFlags |= GB_GL_SPAN_MAP;
+	}
+	int sx = glRenderer->scx - glRenderer->offsetScx;
+	int sy = glRenderer->scy + y - glRenderer->offsetScy;
+
+	if (GBRegisterLCDCIsBgEnable(glRenderer->lcdc) || glRenderer->model >= GB_MODEL_CGB) {
+		int wy = glRenderer->wy + glRenderer->currentWy;
+		int wx = glRenderer->wx + glRenderer->currentWx - 7;
+		if (GBRegisterLCDCIsWindow(glRenderer->lcdc) && wy == y && wx <= endX) {
+			glRenderer->hasWindow = true;
+		}
+		if (GBRegisterLCDCIsWindow(glRenderer->lcdc) && glRenderer->hasWindow && wx <= endX) {
+			int windowX = wx > startX ? wx : startX;
+			if (!renderer->disableBG) {
+				_queueSpan(glRenderer, startX, windowX, y, y + 1, sx, sy, bgFlags);
+			} else {
+				_queueSpan(glRenderer, startX, windowX, y, y + 1, 0, 0, flags | GB_GL_SPAN_ZERO);
+			}
+
+			int windowFlags = flags;
+			if (GBRegisterLCDCIsWindowTileMap(glRenderer->lcdc)) {
+				windowFlags |= GB_GL_SPAN_MAP;
+			}
+			if (!renderer->disableWIN) {
+				_queueSpan(glRenderer, windowX, endX, y, y + 1, -wx - glRenderer->offsetWx, y - wy - glRenderer->offsetWy, windowFlags);
+			} else {
+				_queueSpan(glRenderer, windowX, endX, y, y + 1, 0, 0, flags | GB_GL_SPAN_ZERO);
+			}
+		} else if (!renderer->disableBG) {
+			_queueSpan(glRenderer, startX, endX, y, y + 1, sx, sy, bgFlags);
+		} else {
+			_queueSpan(glRenderer, startX, endX, y, y + 1, 0, 0, flags | GB_GL_SPAN_ZERO);
+		}
+	} else {
+		_queueSpan(glRenderer, startX, endX, y, y + 1, 0, 0, flags | GB_GL_SPAN_ZERO);
+	}
+}
+
+static void GBVideoGLRendererFinishScanline(struct GBVideoRenderer* renderer, int y) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+
+	glRenderer->lastX = 0;
+	glRenderer->currentWx = 0;
+
+	if (glRenderer->sgbTransfer == 1) {
+		size_t offset = 2 * ((y & 7) + (y >> 3) * GB_VIDEO_HORIZONTAL_PIXELS);
+		if (offset >= 0x1000) {
+			return;
+		}
+		uint8_t* buffer = NULL;
+		switch (glRenderer->sgbCommandHeader >> 3) {
+		case SGB_PAL_TRN:
+			buffer = renderer->sgbPalRam;
+			break;
+		case SGB_CHR_TRN:
+			buffer = &renderer->sgbCharRam[SGB_SIZE_CHAR_RAM / 2 * (glRenderer->sgbPacket[1] & 1)];
+			break;
+		case SGB_PCT_TRN:
+			buffer = renderer->sgbMapRam;
+			break;
+		case SGB_ATTR_TRN:
+			buffer = renderer->sgbAttributeFiles;
+			break;
+		default:
+			break;
+		}
+		if (buffer) {
+			// The transfer is encoded in the color indices, which only exist on the GPU
+			_flush(glRenderer);
+			int scale = glRenderer->scale;
+			int x = 0;
+			if (_hasBorders(glRenderer)) {
+				x = (SGB_BORDER_WIDTH - GB_VIDEO_HORIZONTAL_PIXELS) / 2;
+				y += (SGB_BORDER_HEIGHT - GB_VIDEO_VERTICAL_PIXELS) / 2;
+			}
+			glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo);
+			glReadBuffer(GL_COLOR_ATTACHMENT1);
+			glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+			glPixelStorei(GL_PACK_ALIGNMENT, 4);
+			glReadPixels(x * scale, y * scale, GB_VIDEO_HORIZONTAL_PIXELS * scale, 1, GL_RGBA_INTEGER, GL_UNSIGNED_INT, glRenderer->transferRow);
+			glReadBuffer(GL_COLOR_ATTACHMENT0);
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+			int i;
+			for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS; i += 8) {
+				if (UNLIKELY(offset + (i << 1) + 1 >= 0x1000)) {
+					break;
+				}
+				uint8_t hi = 0;
+				uint8_t lo = 0;
+				int j;
+				for (j = 0; j < 8; ++j) {
+					uint32_t pixel = glRenderer->transferRow[(i + j) * scale * 4];
+					hi |= ((pixel >> 1) & 1) << (7 - j);
+					lo |= (pixel & 1) << (7 - j);
+				}
+				buffer[offset + (i << 1) + 0] = lo;
+				buffer[offset + (i << 1) + 1] = hi;
+			}
+		}
+	}
+}
+
+static void GBVideoGLRendererFinishFrame(struct GBVideoRenderer* renderer) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+
+	if (!GBRegisterLCDCIsEnable(glRenderer->lcdc)) {
+		_clearScreen(glRenderer);
+	}
+	if (glRenderer->model & GB_MODEL_SGB) {
+		switch (glRenderer->sgbCommandHeader >> 3) {
+		case SGB_PAL_SET:
+		case SGB_ATTR_SET:
+			if (glRenderer->sgbPacket[1] & 0x40) {
+				renderer->sgbRenderMode = 0;
+			}
+			break;
+		case SGB_PAL_TRN:
+		case SGB_CHR_TRN:
+		case SGB_PCT_TRN:
+			if (glRenderer->sgbTransfer > 0 && glRenderer->sgbBorders && !renderer->sgbRenderMode) {
+				_regenerateSGBBorder(glRenderer);
+			}
+			// Fall through
+		case SGB_ATTR_TRN:
+			++glRenderer->sgbTransfer;
+			if (glRenderer->sgbTransfer == 5) {
+				glRenderer->sgbCommandHeader = 0;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	_flush(glRenderer);
+	glRenderer->lastY = GB_VIDEO_VERTICAL_PIXELS;
+	glRenderer->lastX = 0;
+	glRenderer->currentWy = 0;
+	glRenderer->currentWx = 0;
+	glRenderer->hasWindow = false;
+}
+
+static void GBVideoGLRendererEnableSGBBorder(struct GBVideoRenderer* renderer, bool enable) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (glRenderer->model & GB_MODEL_SGB) {
+		if (enable == glRenderer->sgbBorders) {
+			return;
+		}
+		_flush(glRenderer);
+		glRenderer->sgbBorders = enable;
+		free(glRenderer->temporaryBuffer);
+		glRenderer->temporaryBuffer = NULL;
+		_initOutput(glRenderer);
+		if (glRenderer->sgbBorders && !renderer->sgbRenderMode) {
+			_regenerateSGBBorder(glRenderer);
+		}
+	}
+}
+
+static void GBVideoGLRendererGetPixels(struct GBVideoRenderer* renderer, size_t* stride, const void** pixels) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	int width;
+	int height;
+	_dimensions(glRenderer, &width, &height);
+	width *= glRenderer->scale;
+	height *= glRenderer->scale;
+	if (!glRenderer->temporaryBuffer) {
+		glRenderer->temporaryBuffer = malloc(width * height * BYTES_PER_PIXEL);
+	}
+	_flush(glRenderer);
+	glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glPixelStorei(GL_PACK_ROW_LENGTH, width);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*) glRenderer->temporaryBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	*stride = width;
+	*pixels = glRenderer->temporaryBuffer;
+}
+
+static void GBVideoGLRendererPutPixels(struct GBVideoRenderer* renderer, size_t stride, const void* pixels) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	int width;
+	int height;
+	_dimensions(glRenderer, &width, &height);
+	width *= glRenderer->scale;
+	height *= glRenderer->scale;
+	// Anything still queued would otherwise be drawn over the pixels once it's flushed
+	_flush(glRenderer);
+	// Same layout GetPixels reads back, so what it returned can be put back as-is
+	glBindTexture(GL_TEXTURE_2D, glRenderer->outputTex);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+#endif
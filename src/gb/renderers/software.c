@@ -91,70 +91,44 @@ static void _regenerateSGBBorder(struct GBVideoSoftwareRenderer* renderer) {
 	}
 }
 
-static inline void _setAttribute(uint8_t* sgbAttributes, unsigned x, unsigned y, int palette) {
-	int p = sgbAttributes[(x >> 2) + 5 * y];
-	p &= ~(3 << (2 * (3 - (x & 3))));
-	p |= palette << (2 * (3 - (x & 3)));
-	sgbAttributes[(x >> 2) + 5 * y] = p;
+static void _invalidateTiles(struct GBVideoSoftwareRenderer* renderer) {
+	memset(renderer->tileDirty, 0xFF, sizeof(renderer->tileDirty));
+	renderer->tileVram = renderer->d.vram;
 }
 
-static void _parseAttrBlock(struct GBVideoSoftwareRenderer* renderer, int start) {
-	uint8_t block[6];
-	memcpy(block, &renderer->sgbPacket[start], 6);
-	unsigned x0 = block[2];
-	unsigned x1 = block[4];
-	unsigned y0 = block[3];
-	unsigned y1 = block[5];
-	unsigned x, y;
-	int pIn = block[1] & 3;
-	int pPerim = (block[1] >> 2) & 3;
-	int pOut = (block[1] >> 4) & 3;
-
-	for (y = 0; y < GB_VIDEO_VERTICAL_PIXELS / 8; ++y) {
-		for (x = 0; x < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++x) {
-			if (y > y0 && y < y1 && x > x0 && x < x1) {
-				if (block[0] & 1) {
-					_setAttribute(renderer->d.sgbAttributes, x, y, pIn);
-				}
-			} else if (y < y0 || y > y1 || x < x0 || x > x1) {
-				if (block[0] & 4) {
-					_setAttribute(renderer->d.sgbAttributes, x, y, pOut);
-				}
-			} else {
-				if (block[0] & 2) {
-					_setAttribute(renderer->d.sgbAttributes, x, y, pPerim);
-				} else if (block[0] & 1) {
-					_setAttribute(renderer->d.sgbAttributes, x, y, pIn);
-				} else if (block[0] & 4) {
-					_setAttribute(renderer->d.sgbAttributes, x, y, pOut);
-				}
-			}
+static void _decodeTile(struct GBVideoSoftwareRenderer* renderer, unsigned tile) {
+	const uint8_t* data = &renderer->d.vram[(tile / (GB_BASE_MAP / 16)) * GB_SIZE_VRAM_BANK0 + (tile % (GB_BASE_MAP / 16)) * 16];
+	int y;
+	for (y = 0; y < 8; ++y) {
+		uint8_t tileDataLower = data[y * 2];
+		uint8_t tileDataUpper = data[y * 2 + 1];
+		uint8_t* row = renderer->tileRows[tile * 8 + y];
+		uint8_t* flipped = renderer->tileRowsFlipped[tile * 8 + y];
+		int x;
+		for (x = 0; x < 8; ++x) {
+			uint8_t pixel = (((tileDataUpper >> (7 - x)) & 1) << 1) | ((tileDataLower >> (7 - x)) & 1);
+			row[x] = pixel;
+			flipped[7 - x] = pixel;
 		}
 	}
+	renderer->tileDirty[tile >> 5] &= ~(1U << (tile & 31));
 }
 
-static void _parseAttrLine(struct GBVideoSoftwareRenderer* renderer, int start) {
-	uint8_t byte = renderer->sgbPacket[start];
-	unsigned line = byte & 0x1F;
-	int pal = (byte >> 5) & 3;
-
-	if (byte & 0x80) {
-		if (line > GB_VIDEO_VERTICAL_PIXELS / 8) {
-			return;
-		}
-		int x;
-		for (x = 0; x < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++x) {
-			_setAttribute(renderer->d.sgbAttributes, x, line, pal);
-		}
-	} else {
-		if (line > GB_VIDEO_HORIZONTAL_PIXELS / 8) {
-			return;
-		}
-		int y;
-		for (y = 0; y < GB_VIDEO_VERTICAL_PIXELS / 8; ++y) {
-			_setAttribute(renderer->d.sgbAttributes, line, y, pal);
-		}
+// Returns the unpacked row for the tile data bytes at address, which must lie outside the maps
+static inline const uint8_t* _tileRow(struct GBVideoSoftwareRenderer* renderer, unsigned address, bool xflip) {
+	unsigned row = ((address / GB_SIZE_VRAM_BANK0) * GB_BASE_MAP + (address & (GB_SIZE_VRAM_BANK0 - 1))) >> 1;
+	unsigned tile = row >> 3;
+	if (renderer->tileDirty[tile >> 5] & (1U << (tile & 31))) {
+		_decodeTile(renderer, tile);
 	}
+	return xflip ? renderer->tileRowsFlipped[row] : renderer->tileRows[row];
+}
+
+static inline void _copyTileRow(uint8_t* dest, const uint8_t* tileRow, int p) {
+	uint64_t pixels;
+	memcpy(&pixels, tileRow, sizeof(pixels));
+	pixels |= p * 0x0101010101010101ULL;
+	memcpy(dest, &pixels, sizeof(pixels));
 }
 
 static bool _inWindow(struct GBVideoSoftwareRenderer* renderer) {
@@ -205,6 +179,7 @@ static void GBVideoSoftwareRendererInit(struct GBVideoRenderer* renderer, enum G
 	softwareRenderer->offsetScy = 0;
 	softwareRenderer->offsetWx = 0;
 	softwareRenderer->offsetWy = 0;
+	_invalidateTiles(softwareRenderer);
 
 	int i;
 	for (i = 0; i < 64; ++i) {
@@ -295,17 +270,9 @@ static uint8_t GBVideoSoftwareRendererWriteVideoRegister(struct GBVideoRenderer*
 static void GBVideoSoftwareRendererWriteSGBPacket(struct GBVideoRenderer* renderer, uint8_t* data) {
 	struct GBVideoSoftwareRenderer* softwareRenderer = (struct GBVideoSoftwareRenderer*) renderer;
 	memcpy(softwareRenderer->sgbPacket, data, sizeof(softwareRenderer->sgbPacket));
-	int i;
 	softwareRenderer->sgbCommandHeader = data[0];
 	softwareRenderer->sgbTransfer = 0;
 	int set;
-	int sets;
-	int attrX;
-	int attrY;
-	int attrDirection;
-	int pBefore;
-	int pAfter;
-	int pDiv;
 	switch (softwareRenderer->sgbCommandHeader >> 3) {
 	case SGB_PAL_SET:
 		softwareRenderer->sgbPacket[1] = data[9];
@@ -320,108 +287,10 @@ static void GBVideoSoftwareRendererWriteSGBPacket(struct GBVideoRenderer* render
 		}
 		break;
 	case SGB_ATTR_BLK:
-		sets = softwareRenderer->sgbPacket[1];
-		i = 2;
-		for (; i < (softwareRenderer->sgbCommandHeader & 7) << 4 && sets; i += 6, --sets) {
-			_parseAttrBlock(softwareRenderer, i);
-		}
-		break;
 	case SGB_ATTR_LIN:
-		sets = softwareRenderer->sgbPacket[1];
-		i = 2;
-		for (; i < (softwareRenderer->sgbCommandHeader & 7) << 4 && sets; ++i, --sets) {
-			_parseAttrLine(softwareRenderer, i);
-		}
-		break;
 	case SGB_ATTR_DIV:
-		pAfter = softwareRenderer->sgbPacket[1] & 3;
-		pBefore = (softwareRenderer->sgbPacket[1] >> 2) & 3;
-		pDiv = (softwareRenderer->sgbPacket[1] >> 4) & 3;
-		attrX = softwareRenderer->sgbPacket[2];
-		if (softwareRenderer->sgbPacket[1] & 0x40) {
-			if (attrX > GB_VIDEO_VERTICAL_PIXELS / 8) {
-				attrX = GB_VIDEO_VERTICAL_PIXELS / 8;
-			}
-			int j;
-			for (j = 0; j < attrX; ++j) {
-				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
-					_setAttribute(renderer->sgbAttributes, i, j, pBefore);
-				}
-			}
-			if (attrX < GB_VIDEO_VERTICAL_PIXELS / 8) {
-				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
-					_setAttribute(renderer->sgbAttributes, i, attrX, pDiv);
-				}
-
-			}
-			for (; j < GB_VIDEO_VERTICAL_PIXELS / 8; ++j) {
-				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
-					_setAttribute(renderer->sgbAttributes, i, j, pAfter);
-				}
-			}
-		} else {
-			if (attrX > GB_VIDEO_HORIZONTAL_PIXELS / 8) {
-				attrX = GB_VIDEO_HORIZONTAL_PIXELS / 8;
-			}
-			int j;
-			for (j = 0; j < attrX; ++j) {
-				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
-					_setAttribute(renderer->sgbAttributes, j, i, pBefore);
-				}
-			}
-			if (attrX < GB_VIDEO_HORIZONTAL_PIXELS / 8) {
-				for (i = 0; i < GB_VIDEO_VERTICAL_PIXELS / 8; ++i) {
-					_setAttribute(renderer->sgbAttributes, attrX, i, pDiv);
-				}
-
-			}
-			for (; j < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++j) {
-				for (i = 0; i < GB_VIDEO_VERTICAL_PIXELS / 8; ++i) {
-					_setAttribute(renderer->sgbAttributes, j, i, pAfter);
-				}
-			}
-		}
-		break;
 	case SGB_ATTR_CHR:
-		attrX = softwareRenderer->sgbPacket[1];
-		attrY = softwareRenderer->sgbPacket[2];
-		if (attrX >= GB_VIDEO_HORIZONTAL_PIXELS / 8) {
-			attrX = 0;
-		}
-		if (attrY >= GB_VIDEO_VERTICAL_PIXELS / 8) {
-			attrY = 0;
-		}
-		sets = softwareRenderer->sgbPacket[3];
-		sets |= softwareRenderer->sgbPacket[4] << 8;
-		attrDirection = softwareRenderer->sgbPacket[5];
-		i = 6;
-		for (; i < (softwareRenderer->sgbCommandHeader & 7) << 4 && sets; ++i) {
-			int j;
-			for (j = 0; j < 4 && sets; ++j, --sets) {
-				uint8_t p = softwareRenderer->sgbPacket[i] >> (6 - j * 2);
-				_setAttribute(renderer->sgbAttributes, attrX, attrY, p & 3);
-				if (attrDirection) {
-					++attrY;
-					if (attrY >= GB_VIDEO_VERTICAL_PIXELS / 8) {
-						attrY = 0;
-						++attrX;
-					}
-					if (attrX >= GB_VIDEO_HORIZONTAL_PIXELS / 8) {
-						attrX = 0;
-					}
-				} else {
-					++attrX;
-					if (attrX >= GB_VIDEO_HORIZONTAL_PIXELS / 8) {
-						attrX = 0;
-						++attrY;
-					}
-					if (attrY >= GB_VIDEO_VERTICAL_PIXELS / 8) {
-						attrY = 0;
-					}
-				}
-			}
-		}
-
+		GBVideoRendererWriteSGBAttributes(renderer, softwareRenderer->sgbPacket);
 		break;
 	case SGB_ATRC_EN:
 	case SGB_MASK_EN:
@@ -483,6 +352,12 @@ static void GBVideoSoftwareRendererWriteVRAM(struct GBVideoRenderer* renderer, u
 	if (renderer->cache) {
 		mCacheSetWriteVRAM(renderer->cache, address);
 	}
+	// This is called before the byte is stored, so the tile can only be marked for decoding
+	if ((address & (GB_SIZE_VRAM_BANK0 - 1)) < GB_BASE_MAP) {
+		struct GBVideoSoftwareRenderer* softwareRenderer = (struct GBVideoSoftwareRenderer*) renderer;
+		unsigned tile = (address / GB_SIZE_VRAM_BANK0) * (GB_BASE_MAP / 16) + ((address & (GB_SIZE_VRAM_BANK0 - 1)) >> 4);
+		softwareRenderer->tileDirty[tile >> 5] |= 1U << (tile & 31);
+	}
 }
 
 static void GBVideoSoftwareRendererWriteOAM(struct GBVideoRenderer* renderer, uint16_t oam) {
@@ -495,6 +370,9 @@ static void GBVideoSoftwareRendererDrawRange(struct GBVideoRenderer* renderer, i
 	struct GBVideoSoftwareRenderer* softwareRenderer = (struct GBVideoSoftwareRenderer*) renderer;
 	softwareRenderer->lastY = y;
 	softwareRenderer->lastX = endX;
+	if (softwareRenderer->tileVram != softwareRenderer->d.vram) {
+		_invalidateTiles(softwareRenderer);
+	}
 	uint8_t* maps = &softwareRenderer->d.vram[GB_BASE_MAP];
 	if (GBRegisterLCDCIsTileMap(softwareRenderer->lcdc)) {
 		maps += GB_SIZE_MAP;
@@ -735,7 +613,7 @@ static void GBVideoSoftwareRendererEnableSGBBorder(struct GBVideoRenderer* rende
 }
 
 static void GBVideoSoftwareRendererDrawBackground(struct GBVideoSoftwareRenderer* renderer, uint8_t* maps, int startX, int endX, int sx, int sy) {
-	uint8_t* data = renderer->d.vram;
+	unsigned data = 0;
 	uint8_t* attr = &maps[GB_SIZE_VRAM_BANK0];
 	if (!GBRegisterLCDCIsTileData(renderer->lcdc)) {
 		data += 0x1000;
@@ -749,10 +627,10 @@ static void GBVideoSoftwareRendererDrawBackground(struct GBVideoSoftwareRenderer
 	if ((startX + sx) & 7) {
 		int startX2 = startX + 8 - ((startX + sx) & 7);
 		for (x = startX; x < startX2; ++x) {
-			uint8_t* localData = data;
+			unsigned localData = data;
 			int localY = bottomY;
 			int topX = ((x + sx) >> 3) & 0x1F;
-			int bottomX = 7 - ((x + sx) & 7);
+			bool xflip = false;
 			int bgTile;
 			if (GBRegisterLCDCIsTileData(renderer->lcdc)) {
 				bgTile = maps[topX + topY];
@@ -772,22 +650,18 @@ static void GBVideoSoftwareRendererDrawBackground(struct GBVideoSoftwareRenderer
 				if (GBObjAttributesIsYFlip(attrs)) {
 					localY = 7 - bottomY;
 				}
-				if (GBObjAttributesIsXFlip(attrs)) {
-					bottomX = 7 - bottomX;
-				}
+				xflip = GBObjAttributesIsXFlip(attrs);
 			}
-			uint8_t tileDataLower = localData[(bgTile * 8 + localY) * 2];
-			uint8_t tileDataUpper = localData[(bgTile * 8 + localY) * 2 + 1];
-			tileDataUpper >>= bottomX;
-			tileDataLower >>= bottomX;
-			renderer->row[x] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
+			const uint8_t* tileRow = _tileRow(renderer, localData + (bgTile * 8 + localY) * 2, xflip);
+			renderer->row[x] = p | tileRow[(x + sx) & 7];
 		}
 		startX = startX2;
 	}
 	for (x = startX; x < endX; x += 8) {
-		uint8_t* localData = data;
+		unsigned localData = data;
 		int localY = bottomY;
 		int topX = ((x + sx) >> 3) & 0x1F;
+		bool xflip = false;
 		int bgTile;
 		if (GBRegisterLCDCIsTileData(renderer->lcdc)) {
 			bgTile = maps[topX + topY];
@@ -807,30 +681,9 @@ static void GBVideoSoftwareRendererDrawBackground(struct GBVideoSoftwareRenderer
 			if (GBObjAttributesIsYFlip(attrs)) {
 				localY = 7 - bottomY;
 			}
-			if (GBObjAttributesIsXFlip(attrs)) {
-				uint8_t tileDataLower = localData[(bgTile * 8 + localY) * 2];
-				uint8_t tileDataUpper = localData[(bgTile * 8 + localY) * 2 + 1];
-				renderer->row[x + 0] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-				renderer->row[x + 1] = p | (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-				renderer->row[x + 2] = p | ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-				renderer->row[x + 3] = p | ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-				renderer->row[x + 4] = p | ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-				renderer->row[x + 5] = p | ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-				renderer->row[x + 6] = p | ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-				renderer->row[x + 7] = p | ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
-				continue;
-			}
+			xflip = GBObjAttributesIsXFlip(attrs);
 		}
-		uint8_t tileDataLower = localData[(bgTile * 8 + localY) * 2];
-		uint8_t tileDataUpper = localData[(bgTile * 8 + localY) * 2 + 1];
-		renderer->row[x + 7] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-		renderer->row[x + 6] = p | (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-		renderer->row[x + 5] = p | ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-		renderer->row[x + 4] = p | ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-		renderer->row[x + 3] = p | ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-		renderer->row[x + 2] = p | ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-		renderer->row[x + 1] = p | ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-		renderer->row[x + 0] = p | ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
+		_copyTileRow(&renderer->row[x], _tileRow(renderer, localData + (bgTile * 8 + localY) * 2, xflip), p);
 	}
 }
 
@@ -849,7 +702,7 @@ static void GBVideoSoftwareRendererDrawObj(struct GBVideoSoftwareRenderer* rende
 	if (startX < 0) {
 		startX = 0;
 	}
-	uint8_t* data = renderer->d.vram;
+	unsigned data = 0;
 	int tileOffset = 0;
 	int bottomY;
 	int objY = obj->y + renderer->objOffsetY;
@@ -882,98 +735,14 @@ static void GBVideoSoftwareRendererDrawObj(struct GBVideoSoftwareRenderer* rende
 	} else {
 		p = (GBObjAttributesGetPalette(obj->attr) + 8) * 4;
 	}
-	int bottomX;
-	int x = startX;
-	if ((x - objX) & 7) {
-		for (; x < endX; ++x) {
-			if (GBObjAttributesIsXFlip(obj->attr)) {
-				bottomX = (x - objX) & 7;
-			} else {
-				bottomX = 7 - ((x - objX) & 7);
-			}
-			int objTile = obj->tile + tileOffset;
-			uint8_t tileDataLower = data[(objTile * 8 + bottomY) * 2];
-			uint8_t tileDataUpper = data[(objTile * 8 + bottomY) * 2 + 1];
-			tileDataUpper >>= bottomX;
-			tileDataLower >>= bottomX;
-			color_t current = renderer->row[x];
-			if (((tileDataUpper | tileDataLower) & 1) && !(current & mask) && (current & mask2) <= 0x80) {
-				renderer->row[x] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-			}
-		}
-	} else if (GBObjAttributesIsXFlip(obj->attr)) {
-		int objTile = obj->tile + tileOffset;
-		uint8_t tileDataLower = data[(objTile * 8 + bottomY) * 2];
-		uint8_t tileDataUpper = data[(objTile * 8 + bottomY) * 2 + 1];
-		color_t current;
-		current = renderer->row[x];
-		if (((tileDataUpper | tileDataLower) & 1) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-		}
-		current = renderer->row[x + 1];
-		if (((tileDataUpper | tileDataLower) & 2) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x + 1] = p | (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-		}
-		current = renderer->row[x + 2];
-		if (((tileDataUpper | tileDataLower) & 4) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x + 2] = p | ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-		}
-		current = renderer->row[x + 3];
-		if (((tileDataUpper | tileDataLower) & 8) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x + 3] = p | ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-		}
-		current = renderer->row[x + 4];
-		if (((tileDataUpper | tileDataLower) & 16) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x + 4] = p | ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-		}
-		current = renderer->row[x + 5];
-		if (((tileDataUpper | tileDataLower) & 32) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x + 5] = p | ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-		}
-		current = renderer->row[x + 6];
-		if (((tileDataUpper | tileDataLower) & 64) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x + 6] = p | ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-		}
-		current = renderer->row[x + 7];
-		if (((tileDataUpper | tileDataLower) & 128) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x + 7] = p | ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
-		}
-	} else {
-		int objTile = obj->tile + tileOffset;
-		uint8_t tileDataLower = data[(objTile * 8 + bottomY) * 2];
-		uint8_t tileDataUpper = data[(objTile * 8 + bottomY) * 2 + 1];
-		color_t current;
-		current = renderer->row[x + 7];
-		if (((tileDataUpper | tileDataLower) & 1) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x + 7] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-		}
-		current = renderer->row[x + 6];
-		if (((tileDataUpper | tileDataLower) & 2) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x + 6] = p | (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-		}
-		current = renderer->row[x + 5];
-		if (((tileDataUpper | tileDataLower) & 4) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x + 5] = p | ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-		}
-		current = renderer->row[x + 4];
-		if (((tileDataUpper | tileDataLower) & 8) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x + 4] = p | ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-		}
-		current = renderer->row[x + 3];
-		if (((tileDataUpper | tileDataLower) & 16) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x + 3] = p | ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-		}
-		current = renderer->row[x + 2];
-		if (((tileDataUpper | tileDataLower) & 32) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x + 2] = p | ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-		}
-		current = renderer->row[x + 1];
-		if (((tileDataUpper | tileDataLower) & 64) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x + 1] = p | ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-		}
-		current = renderer->row[x];
-		if (((tileDataUpper | tileDataLower) & 128) && !(current & mask) && (current & mask2) <= 0x80) {
-			renderer->row[x] = p | ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
+	int objTile = obj->tile + tileOffset;
+	const uint8_t* tileRow = _tileRow(renderer, data + (objTile * 8 + bottomY) * 2, GBObjAttributesIsXFlip(obj->attr));
+	int x;
+	for (x = startX; x < endX; ++x) {
+		uint8_t pixel = tileRow[(x - objX) & 7];
+		color_t current = renderer->row[x];
+		if (pixel && !(current & mask) && (current & mask2) <= 0x80) {
+			renderer->row[x] = p | pixel;
 		}
 	}
 }
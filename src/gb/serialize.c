@@ -20,8 +20,10 @@ static void GBSGBSerialize(struct GB* gb, struct GBSerializedState* state);
 static void GBSGBDeserialize(struct GB* gb, const struct GBSerializedState* state);
 
 void GBSerialize(struct GB* gb, struct GBSerializedState* state) {
+	// Not every field before the memory dumps gets written, so clear them to keep states reproducible
+	memset(state, 0, offsetof(struct GBSerializedState, oam));
 	STORE_32LE(GB_SAVESTATE_MAGIC + GB_SAVESTATE_VERSION, 0, &state->versionMagic);
-	STORE_32LE(gb->romCrc32, 0, &state->romCrc32);
+	STORE_32LE(GBGetROMCrc32(gb), 0, &state->romCrc32);
 	STORE_32LE(gb->timing.masterCycles, 0, &state->masterCycles);
 
 	if (gb->memory.rom) {
@@ -58,14 +60,21 @@ void GBSerialize(struct GB* gb, struct GBSerializedState* state) {
 	STORE_32LE(flags, 0, &state->cpu.flags);
 	STORE_32LE(gb->eiPending.when - mTimingCurrentTime(&gb->timing), 0, &state->cpu.eiPending);
 
+	GBTimerSync(&gb->timer);
+	GBAudioSync(&gb->audio);
+	GBMemorySyncDMA(gb, 0);
+	GBVideoSync(&gb->video);
 	GBMemorySerialize(gb, state);
 	GBIOSerialize(gb, state);
 	GBVideoSerialize(&gb->video, state);
 	GBTimerSerialize(&gb->timer, state);
 	GBAudioSerialize(&gb->audio, state);
 
+	memset(state->reserved2, 0, sizeof(state->reserved2));
 	if (gb->model & GB_MODEL_SGB) {
 		GBSGBSerialize(gb, state);
+	} else {
+		memset(&state->sgb, 0, sizeof(state->sgb));
 	}
 }
 
@@ -96,7 +105,7 @@ bool GBDeserialize(struct GB* gb, const struct GBSerializedState* state) {
 		}
 	}
 	LOAD_32LE(ucheck, 0, &state->romCrc32);
-	if (ucheck != gb->romCrc32) {
+	if (ucheck != GBGetROMCrc32(gb)) {
 		mLOG(GB_STATE, WARN, "Savestate is for a different version of the game");
 	}
 	LOAD_32LE(check, 0, &state->cpu.cycles);
@@ -165,7 +174,6 @@ bool GBDeserialize(struct GB* gb, const struct GBSerializedState* state) {
 
 	LOAD_32LE(gb->cpu->cycles, 0, &state->cpu.cycles);
 	LOAD_32LE(gb->cpu->nextEvent, 0, &state->cpu.nextEvent);
-	gb->timing.root = NULL;
 
 	uint32_t when;
 	LOAD_32LE(when, 0, &state->cpu.eiPending);
@@ -193,8 +201,7 @@ bool GBDeserialize(struct GB* gb, const struct GBSerializedState* state) {
 
 	gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 
-	gb->timing.reroot = gb->timing.root;
-	gb->timing.root = NULL;
+	mTimingInterrupt(&gb->timing);
 
 	return true;
 }
@@ -9,6 +9,7 @@
 #include <mgba/internal/gb/io.h>
 
 #define LOCKSTEP_INCREMENT 512
+#define LOCKSTEP_MAX_BUDGET 280896
 
 static bool GBSIOLockstepNodeInit(struct GBSIODriver* driver);
 static void GBSIOLockstepNodeDeinit(struct GBSIODriver* driver);
@@ -22,6 +23,43 @@ void GBSIOLockstepInit(struct GBSIOLockstep* lockstep) {
 	lockstep->pendingSB[0] = 0xFF;
 	lockstep->pendingSB[1] = 0xFF;
 	lockstep->masterClaimed = false;
+	lockstep->cycleBudget = GB_LOCKSTEP_DEFAULT_BUDGET;
+	lockstep->idleStep = LOCKSTEP_INCREMENT;
+}
+
+void GBSIOLockstepSetCycleBudget(struct GBSIOLockstep* lockstep, int32_t cycles) {
+	if (cycles < LOCKSTEP_INCREMENT) {
+		cycles = LOCKSTEP_INCREMENT;
+	} else if (cycles > LOCKSTEP_MAX_BUDGET) {
+		// Four frames; any further and the slave visibly lags behind
+		cycles = LOCKSTEP_MAX_BUDGET;
+	}
+	lockstep->cycleBudget = cycles;
+	if (lockstep->idleStep > cycles) {
+		lockstep->idleStep = cycles;
+	}
+}
+
+static void _rescheduleNow(struct GBSIOLockstepNode* node) {
+	struct mTiming* timing = &node->d.p->p->timing;
+	bool scheduled = mTimingIsScheduled(timing, &node->event);
+	int oldWhen = node->event.when;
+
+	mTimingDeschedule(timing, &node->event);
+	mTimingSchedule(timing, &node->event, 0);
+
+	// Only the cycles that actually elapsed count towards what gets posted to the other GB
+	if (scheduled) {
+		node->eventDiff -= oldWhen - node->event.when;
+	}
+}
+
+static int32_t _idleStep(struct GBSIOLockstep* lockstep) {
+	int32_t step = lockstep->idleStep;
+	if (step < lockstep->cycleBudget) {
+		lockstep->idleStep = step * 2 < lockstep->cycleBudget ? step * 2 : lockstep->cycleBudget;
+	}
+	return step;
 }
 
 void GBSIOLockstepNodeCreate(struct GBSIOLockstepNode* node) {
@@ -108,7 +146,7 @@ static int32_t _masterUpdate(struct GBSIOLockstepNode* node) {
 	switch (node->p->d.transferActive) {
 	case TRANSFER_IDLE:
 		// If the master hasn't initiated a transfer, it can keep going.
-		node->nextEvent += LOCKSTEP_INCREMENT;
+		node->nextEvent += _idleStep(node->p);
 		break;
 	case TRANSFER_STARTING:
 		// Start the transfer, but wait for the other GBs to catch up
@@ -136,7 +174,8 @@ static int32_t _masterUpdate(struct GBSIOLockstepNode* node) {
 		// Everything's settled. We're done.
 		_finishTransfer(node);
 		ATOMIC_STORE(node->p->masterClaimed, false);
-		node->nextEvent += LOCKSTEP_INCREMENT;
+		node->p->idleStep = LOCKSTEP_INCREMENT;
+		node->nextEvent += _idleStep(node->p);
 		ATOMIC_STORE(node->p->d.transferActive, TRANSFER_IDLE);
 		break;
 	}
@@ -233,8 +272,8 @@ static uint8_t GBSIOLockstepNodeWriteSC(struct GBSIODriver* driver, uint8_t valu
 			node->p->d.transferActive = TRANSFER_STARTING;
 			node->p->d.transferCycles = GBSIOCyclesPerTransfer[(value >> 1) & 1];
 			mTimingDeschedule(&driver->p->p->timing, &driver->p->event);
-			mTimingDeschedule(&driver->p->p->timing, &node->event);
-			mTimingSchedule(&driver->p->p->timing, &node->event, 0);
+			// Don't leave the transfer waiting out the rest of the idle step
+			_rescheduleNow(node);
 		} else {
 			mLOG(GB_SIO, FATAL, "GBSIOLockstepNodeWriteSC() failed to write to masterClaimed\n");
 		}
@@ -6,6 +6,7 @@
 #include "util/test/suite.h"
 
 #include <mgba/core/core.h>
+#include <mgba/core/serialize.h>
 #include <mgba/gb/core.h>
 #include <mgba/internal/gb/gb.h>
 #include <mgba-util/vfs.h>
@@ -59,9 +60,85 @@ M_TEST_DEFINE(isROM) {
 	core->deinit(core);
 }
 
+M_TEST_DEFINE(stateBuffer) {
+	struct VFile* vf = VFileMemChunk(NULL, 2048);
+	GBSynthesizeROM(vf);
+	struct mCore* core = mCoreFindVF(vf);
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	assert_true(core->loadROM(core, vf));
+	core->reset(core);
+
+	size_t size = mCoreSaveStateBuffer(core, NULL, 0, SAVESTATE_RTC);
+	assert_true(size >= core->stateSize(core));
+	uint8_t* buffer = malloc(size);
+	uint8_t* unaligned = malloc(size + 1);
+	assert_int_equal(mCoreSaveStateBuffer(core, buffer, size - 1, SAVESTATE_RTC), size);
+	assert_int_equal(mCoreSaveStateBuffer(core, buffer, size, SAVESTATE_RTC), size);
+	assert_int_equal(mCoreSaveStateBuffer(core, &unaligned[1], size, SAVESTATE_RTC), size);
+	assert_memory_equal(buffer, &unaligned[1], size);
+
+	struct VFile* vfm = VFileMemChunk(NULL, 0);
+	assert_true(mCoreSaveStateNamed(core, vfm, SAVESTATE_RTC));
+	assert_int_equal(vfm->size(vfm), size);
+	vfm->close(vfm);
+
+	assert_true(mCoreLoadStateBuffer(core, buffer, size, SAVESTATE_RTC));
+	assert_true(mCoreLoadStateBuffer(core, &unaligned[1], size, SAVESTATE_RTC));
+	assert_false(mCoreLoadStateBuffer(core, buffer, core->stateSize(core) - 1, SAVESTATE_RTC));
+	free(buffer);
+	free(unaligned);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_DEFINE(stateBufferSavedata) {
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	GBSynthesizeROM(vf);
+	// MBC1 with 8 kiB of battery-backed RAM
+	uint8_t cart[] = { 0x03, 0x00, 0x02 };
+	vf->seek(vf, 0x147, SEEK_SET);
+	vf->write(vf, cart, sizeof(cart));
+	struct mCore* core = mCoreFindVF(vf);
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	assert_true(core->loadROM(core, vf));
+	core->reset(core);
+
+	struct GB* gb = core->board;
+	const void* view;
+	assert_int_equal(core->savedataView(core, &view), 0x2000);
+	assert_ptr_equal(view, gb->memory.sram);
+	memset(gb->memory.sram, 0x5A, 0x2000);
+
+	int flags = SAVESTATE_SAVEDATA | SAVESTATE_RTC;
+	size_t bound = mCoreSaveStateBufferBound(core, flags, 0x20000);
+	size_t size = mCoreSaveStateBuffer(core, NULL, 0, flags);
+	assert_true(size > core->stateSize(core) + 0x2000);
+	assert_true(bound >= size);
+	assert_true(mCoreSaveStateBufferBound(core, flags, 0x2000) >= size);
+	uint8_t* buffer = malloc(bound);
+	assert_int_equal(mCoreSaveStateBuffer(core, buffer, bound, flags), size);
+
+	memset(gb->memory.sram, 0, 0x2000);
+	assert_true(mCoreLoadStateBuffer(core, buffer, bound, flags));
+	uint8_t expected[0x2000];
+	memset(expected, 0x5A, sizeof(expected));
+	assert_memory_equal(gb->memory.sram, expected, sizeof(expected));
+	free(buffer);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
 M_TEST_SUITE_DEFINE(GBCore,
 	cmocka_unit_test(create),
 	cmocka_unit_test(platform),
 	cmocka_unit_test(reset),
 	cmocka_unit_test(loadNullROM),
-	cmocka_unit_test(isROM))
+	cmocka_unit_test(isROM),
+	cmocka_unit_test(stateBuffer),
+	cmocka_unit_test(stateBufferSavedata))
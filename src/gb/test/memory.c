@@ -74,7 +74,60 @@ M_TEST_DEFINE(patchROMBank2) {
 	assert_int_equal(GBView8(gb->cpu, GB_SIZE_CART_BANK0, 2), newExpected);
 }
 
+M_TEST_DEFINE(dirtyWRAM) {
+	struct mCore* core = *state;
+	struct GB* gb = core->board;
+	size_t nPages;
+
+	core->reset(core);
+	assert_null(core->getMemoryBlockDirty(core, GB_REGION_WORKING_RAM_BANK0, &nPages));
+	assert_true(core->trackMemoryBlockDirty(core, GB_REGION_WORKING_RAM_BANK0, true));
+	const uint32_t* dirty = core->getMemoryBlockDirty(core, GB_REGION_WORKING_RAM_BANK0, &nPages);
+	assert_non_null(dirty);
+	assert_int_equal(nPages, GB_SIZE_WORKING_RAM / mCORE_MEMORY_DIRTY_PAGE_SIZE);
+	assert_int_equal(dirty[0], 0xFFFFFFFF);
+
+	core->clearMemoryBlockDirty(core, GB_REGION_WORKING_RAM_BANK0);
+	assert_int_equal(dirty[0], 0);
+	GBStore8(gb->cpu, GB_BASE_WORKING_RAM_BANK0 + 0x123, 1);
+	GBStore8(gb->cpu, GB_BASE_WORKING_RAM_BANK1 + 0x10, 1);
+	assert_int_equal(dirty[0], 0x00000002 | (1 << (GB_SIZE_WORKING_RAM_BANK0 / mCORE_MEMORY_DIRTY_PAGE_SIZE)));
+
+	core->clearMemoryBlockDirty(core, GB_REGION_WORKING_RAM_BANK0);
+	GBPatch8(gb->cpu, GB_BASE_WORKING_RAM_BANK0 + 0x345, 2, NULL, -1);
+	assert_int_equal(dirty[0], 0x00000008);
+
+	assert_true(core->trackMemoryBlockDirty(core, GB_REGION_WORKING_RAM_BANK0, false));
+	assert_null(core->getMemoryBlockDirty(core, GB_REGION_WORKING_RAM_BANK0, &nPages));
+	assert_false(core->trackMemoryBlockDirty(core, GB_REGION_CART_BANK0, true));
+}
+
+M_TEST_DEFINE(loadFollowsBanks) {
+	struct mCore* core = *state;
+	struct GB* gb = core->board;
+
+	core->reset(core);
+	gb->memory.rom[GB_SIZE_CART_BANK0 * 2 + 0x123] = 0x5A;
+	gb->memory.rom[GB_SIZE_CART_BANK0 * 3 + 0x123] = 0xA5;
+	GBMBCSwitchBank(gb, 2);
+	assert_int_equal(GBLoad8(gb->cpu, GB_BASE_CART_BANK1 + 0x123), 0x5A);
+	GBMBCSwitchBank(gb, 3);
+	assert_int_equal(GBLoad8(gb->cpu, GB_BASE_CART_BANK1 + 0x123), 0xA5);
+
+	GBMemorySwitchWramBank(&gb->memory, 3);
+	GBStore8(gb->cpu, GB_BASE_WORKING_RAM_BANK1 + 0x10, 0x77);
+	assert_int_equal(gb->memory.wram[GB_SIZE_WORKING_RAM_BANK0 * 3 + 0x10], 0x77);
+	assert_int_equal(GBLoad8(gb->cpu, GB_BASE_WORKING_RAM_BANK1 + 0x10), 0x77);
+	GBMemorySwitchWramBank(&gb->memory, 4);
+	assert_int_not_equal(GBLoad8(gb->cpu, GB_BASE_WORKING_RAM_BANK1 + 0x10), 0x77);
+
+	GBStore8(gb->cpu, GB_BASE_WORKING_RAM_BANK0 + 0x20, 0x33);
+	assert_int_equal(GBLoad8(gb->cpu, 0xE020), 0x33);
+}
+
 M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(GBMemory,
 	cmocka_unit_test(patchROMBank0),
 	cmocka_unit_test(patchROMBank1),
-	cmocka_unit_test(patchROMBank2))
+	cmocka_unit_test(patchROMBank2),
+	cmocka_unit_test(dirtyWRAM),
+	cmocka_unit_test(loadFollowsBanks))
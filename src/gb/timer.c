@@ -10,6 +10,8 @@
 #include <mgba/internal/gb/io.h>
 #include <mgba/internal/gb/serialize.h>
 
+#define GB_TIMER_MAX_BATCH 0x4000
+
 void _GBTimerIRQ(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	UNUSED(timing);
 	UNUSED(cyclesLate);
@@ -17,11 +19,29 @@ void _GBTimerIRQ(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	timer->p->memory.io[REG_TIMA] = timer->p->memory.io[REG_TMA];
 	timer->p->memory.io[REG_IF] |= (1 << GB_IRQ_TIMER);
 	GBUpdateIRQs(timer->p);
+	GBTimerUpdateScheduling(timer);
 }
 
-static void _GBTimerDivIncrement(struct GBTimer* timer, uint32_t cyclesLate) {
+// The last pending tick is due at timestamp, with the ones before it spaced out backwards
+static void _GBTimerDivIncrement(struct GBTimer* timer, uint32_t cyclesLate, int32_t timestamp) {
+	unsigned timingFactor = 0x3FF >> !timer->p->doubleSpeed;
 	while (timer->nextDiv >= GB_DMG_DIV_PERIOD) {
-		timer->nextDiv -= GB_DMG_DIV_PERIOD;
+		// Ticks that neither clock TIMA nor the frame sequencer only advance DIV, so skip straight past them
+		uint32_t skip = timer->nextDiv / GB_DMG_DIV_PERIOD - 1;
+		if (timer->timaPeriod > 0) {
+			uint32_t timaToGo = (timer->timaPeriod - 1) - (timer->internalDiv & (timer->timaPeriod - 1));
+			if (timaToGo < skip) {
+				skip = timaToGo;
+			}
+		}
+		if (timer->p->audio.enable) {
+			uint32_t frameToGo = timingFactor - (timer->internalDiv & timingFactor);
+			if (frameToGo < skip) {
+				skip = frameToGo;
+			}
+		}
+		timer->internalDiv += skip;
+		timer->nextDiv -= GB_DMG_DIV_PERIOD * (skip + 1);
 
 		// Make sure to trigger when the correct bit is a falling edge
 		if (timer->timaPeriod > 0 && (timer->internalDiv & (timer->timaPeriod - 1)) == timer->timaPeriod - 1) {
@@ -30,29 +50,42 @@ static void _GBTimerDivIncrement(struct GBTimer* timer, uint32_t cyclesLate) {
 				mTimingSchedule(&timer->p->timing, &timer->irq, 7 - ((timer->p->cpu->executionState - cyclesLate) & 3));
 			}
 		}
-		unsigned timingFactor = 0x3FF >> !timer->p->doubleSpeed;
 		if ((timer->internalDiv & timingFactor) == timingFactor) {
-			GBAudioUpdateFrame(&timer->p->audio, &timer->p->timing);
+			// The channels' own events would have run first on this cycle
+			GBAudioUpdateFrame(&timer->p->audio, timestamp - timer->nextDiv + 1);
 		}
 		++timer->internalDiv;
 		timer->p->memory.io[REG_DIV] = timer->internalDiv >> 4;
 	}
 }
 
+// DIV and TIMA are only brought up to date when they are observed, so the event only needs
+// to fire on ticks with side effects: TIMA overflowing, and the frame sequencer while audio is on
+static uint32_t _GBTimerTicksToGo(struct GBTimer* timer) {
+	uint32_t ticksToGo = GB_TIMER_MAX_BATCH;
+	if (timer->timaPeriod) {
+		ticksToGo = timer->timaPeriod - (timer->internalDiv & (timer->timaPeriod - 1));
+		ticksToGo += (0xFF - timer->p->memory.io[REG_TIMA]) * timer->timaPeriod;
+	}
+	if (timer->p->audio.enable) {
+		unsigned timingFactor = 0x3FF >> !timer->p->doubleSpeed;
+		uint32_t frameToGo = timingFactor - (timer->internalDiv & timingFactor) + 1;
+		if (frameToGo < ticksToGo) {
+			ticksToGo = frameToGo;
+		}
+	}
+	if (ticksToGo > GB_TIMER_MAX_BATCH) {
+		ticksToGo = GB_TIMER_MAX_BATCH;
+	}
+	return ticksToGo;
+}
+
 void _GBTimerUpdate(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	struct GBTimer* timer = context;
 	timer->nextDiv += cyclesLate;
-	_GBTimerDivIncrement(timer, cyclesLate);
+	_GBTimerDivIncrement(timer, cyclesLate, mTimingCurrentTime(timing));
 	// Batch div increments
-	int divsToGo = 16 - (timer->internalDiv & 15);
-	int timaToGo = INT_MAX;
-	if (timer->timaPeriod) {
-		timaToGo = timer->timaPeriod - (timer->internalDiv & (timer->timaPeriod - 1));
-	}
-	if (timaToGo < divsToGo) {
-		divsToGo = timaToGo;
-	}
-	timer->nextDiv = GB_DMG_DIV_PERIOD * divsToGo;
+	timer->nextDiv = GB_DMG_DIV_PERIOD * _GBTimerTicksToGo(timer);
 	mTimingSchedule(timing, &timer->event, timer->nextDiv - cyclesLate);
 }
 
@@ -73,7 +106,7 @@ void GBTimerReset(struct GBTimer* timer) {
 void GBTimerDivReset(struct GBTimer* timer) {
 	timer->nextDiv -= mTimingUntil(&timer->p->timing, &timer->event);
 	mTimingDeschedule(&timer->p->timing, &timer->event);
-	_GBTimerDivIncrement(timer, 0);
+	_GBTimerDivIncrement(timer, 0, mTimingCurrentTime(&timer->p->timing));
 	if (((timer->internalDiv << 1) | ((timer->nextDiv >> 3) & 1)) & timer->timaPeriod) {
 		++timer->p->memory.io[REG_TIMA];
 		if (!timer->p->memory.io[REG_TIMA]) {
@@ -82,7 +115,7 @@ void GBTimerDivReset(struct GBTimer* timer) {
 	}
 	unsigned timingFactor = 0x400 >> !timer->p->doubleSpeed;
 	if (timer->internalDiv & timingFactor) {
-		GBAudioUpdateFrame(&timer->p->audio, &timer->p->timing);
+		GBAudioUpdateFrame(&timer->p->audio, mTimingCurrentTime(&timer->p->timing));
 	}
 	timer->p->memory.io[REG_DIV] = 0;
 	timer->internalDiv = 0;
@@ -90,11 +123,37 @@ void GBTimerDivReset(struct GBTimer* timer) {
 	mTimingSchedule(&timer->p->timing, &timer->event, timer->nextDiv - ((timer->p->cpu->executionState + 1) & 3));
 }
 
+void GBTimerSync(struct GBTimer* timer) {
+	// The ticks left in this batch are spaced out backwards from the event itself. Only the ones
+	// strictly before now have been observable, matching when their own event would have run.
+	int32_t until = mTimingUntil(&timer->p->timing, &timer->event);
+	int32_t pending = timer->nextDiv / GB_DMG_DIV_PERIOD;
+	int32_t future = 0;
+	if (until >= 0) {
+		future = until / GB_DMG_DIV_PERIOD + 1;
+	}
+	if (future >= pending) {
+		return;
+	}
+	timer->nextDiv -= GB_DMG_DIV_PERIOD * future;
+	_GBTimerDivIncrement(timer, 0, mTimingCurrentTime(&timer->p->timing) + until - GB_DMG_DIV_PERIOD * future);
+	timer->nextDiv += GB_DMG_DIV_PERIOD * future;
+}
+
+void GBTimerUpdateScheduling(struct GBTimer* timer) {
+	GBTimerSync(timer);
+	// Keep the next pending tick where it is and only move the end of the batch
+	int32_t until = mTimingUntil(&timer->p->timing, &timer->event);
+	until -= GB_DMG_DIV_PERIOD * (timer->nextDiv / GB_DMG_DIV_PERIOD - 1);
+	timer->nextDiv = GB_DMG_DIV_PERIOD * _GBTimerTicksToGo(timer);
+	mTimingSchedule(&timer->p->timing, &timer->event, until + timer->nextDiv - GB_DMG_DIV_PERIOD);
+}
+
 uint8_t GBTimerUpdateTAC(struct GBTimer* timer, GBRegisterTAC tac) {
 	if (GBRegisterTACIsRun(tac)) {
 		timer->nextDiv -= mTimingUntil(&timer->p->timing, &timer->event);
 		mTimingDeschedule(&timer->p->timing, &timer->event);
-		_GBTimerDivIncrement(timer, (timer->p->cpu->executionState + 2) & 3);
+		_GBTimerDivIncrement(timer, (timer->p->cpu->executionState + 2) & 3, mTimingCurrentTime(&timer->p->timing));
 
 		switch (GBRegisterTACGetClock(tac)) {
 		case 0:
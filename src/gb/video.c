@@ -37,6 +37,8 @@ static void _endMode1(struct mTiming* timing, void* context, uint32_t cyclesLate
 static void _endMode2(struct mTiming* timing, void* context, uint32_t cyclesLate);
 static void _endMode3(struct mTiming* timing, void* context, uint32_t cyclesLate);
 static void _updateFrameCount(struct mTiming* timing, void* context, uint32_t cyclesLate);
+static void _scheduleMode(struct GBVideo* video, void (*callback)(struct mTiming*, void*, uint32_t), int32_t next, uint32_t cyclesLate);
+static void _replayModes(struct GBVideo* video);
 
 static struct GBVideoRenderer dummyRenderer = {
 	.init = GBVideoDummyRendererInit,
@@ -60,6 +62,7 @@ void GBVideoInit(struct GBVideo* video) {
 	video->renderer->sgbRenderMode = 0;
 	video->vram = anonymousMemoryMap(GB_SIZE_VRAM);
 	video->frameskip = 0;
+	video->suppressOutput = false;
 
 	video->modeEvent.context = video;
 	video->modeEvent.name = "GB Video Mode";
@@ -97,12 +100,16 @@ void GBVideoReset(struct GBVideo* video) {
 	video->x = 0;
 	video->mode = 1;
 	video->stat = 1;
+	video->lazyLine = false;
+	video->lazyMode = NULL;
 
 	video->frameCounter = 0;
 	video->frameskipCounter = 0;
+	video->sgbTransferFrames = 0;
 
 	GBVideoSwitchBank(video, 0);
 	video->renderer->vram = video->vram;
+	memset(video->vram, 0, GB_SIZE_VRAM);
 	memset(&video->oam, 0, sizeof(video->oam));
 	video->renderer->oam = &video->oam;
 	memset(&video->palette, 0, sizeof(video->palette));
@@ -215,23 +222,28 @@ static bool _statIRQAsserted(struct GBVideo* video, GBRegisterSTAT stat) {
 }
 
 void _endMode0(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	UNUSED(timing);
 	struct GBVideo* video = context;
+	if (video->lazyLine) {
+		_replayModes(video);
+	}
 	if (video->frameskipCounter <= 0) {
 		video->renderer->finishScanline(video->renderer, video->ly);
 	}
 	int lyc = video->p->memory.io[REG_LYC];
 	int32_t next;
+	void (*callback)(struct mTiming*, void*, uint32_t);
 	++video->ly;
 	video->p->memory.io[REG_LY] = video->ly;
 	GBRegisterSTAT oldStat = video->stat;
 	if (video->ly < GB_VIDEO_VERTICAL_PIXELS) {
 		next = GB_VIDEO_MODE_2_LENGTH;
 		video->mode = 2;
-		video->modeEvent.callback = _endMode2;
+		callback = _endMode2;
 	} else {
 		next = GB_VIDEO_HORIZONTAL_LENGTH;
 		video->mode = 1;
-		video->modeEvent.callback = _endMode1;
+		callback = _endMode1;
 
 		mTimingDeschedule(&video->p->timing, &video->frameEvent);
 		mTimingSchedule(&video->p->timing, &video->frameEvent, -cyclesLate);
@@ -255,10 +267,11 @@ void _endMode0(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 
 	GBUpdateIRQs(video->p);
 	video->p->memory.io[REG_STAT] = video->stat;
-	mTimingSchedule(timing, &video->modeEvent, (next << video->p->doubleSpeed) - cyclesLate);
+	_scheduleMode(video, callback, next, cyclesLate);
 }
 
 void _endMode1(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	UNUSED(timing);
 	struct GBVideo* video = context;
 	if (!GBRegisterLCDCIsEnable(video->p->memory.io[REG_LCDC])) {
 		return;
@@ -267,12 +280,13 @@ void _endMode1(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	// TODO: One M-cycle delay
 	++video->ly;
 	int32_t next;
+	void (*callback)(struct mTiming*, void*, uint32_t) = _endMode1;
 	if (video->ly == GB_VIDEO_VERTICAL_TOTAL_PIXELS + 1) {
 		video->ly = 0;
 		video->p->memory.io[REG_LY] = video->ly;
 		next = GB_VIDEO_MODE_2_LENGTH;
 		video->mode = 2;
-		video->modeEvent.callback = _endMode2;
+		callback = _endMode2;
 	} else if (video->ly == GB_VIDEO_VERTICAL_TOTAL_PIXELS) {
 		video->p->memory.io[REG_LY] = 0;
 		next = GB_VIDEO_HORIZONTAL_LENGTH - 8;
@@ -292,17 +306,17 @@ void _endMode1(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 		GBUpdateIRQs(video->p);
 	}
 	video->p->memory.io[REG_STAT] = video->stat;
-	mTimingSchedule(timing, &video->modeEvent, (next << video->p->doubleSpeed) - cyclesLate);
+	_scheduleMode(video, callback, next, cyclesLate);
 }
 
 void _endMode2(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	struct GBVideo* video = context;
+	GBMemorySyncDMA(video->p, cyclesLate);
 	_cleanOAM(video, video->ly);
 	video->x = -(video->p->memory.io[REG_SCX] & 7);
 	video->dotClock = mTimingCurrentTime(timing) - cyclesLate + 5 - (video->x << video->p->doubleSpeed);
 	int32_t next = GB_VIDEO_MODE_3_LENGTH_BASE + video->objMax * 6 - video->x;
 	video->mode = 3;
-	video->modeEvent.callback = _endMode3;
 	GBRegisterSTAT oldStat = video->stat;
 	video->stat = GBRegisterSTATSetMode(video->stat, video->mode);
 	if (!_statIRQAsserted(video, oldStat) && _statIRQAsserted(video, video->stat)) {
@@ -310,20 +324,18 @@ void _endMode2(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 		GBUpdateIRQs(video->p);
 	}
 	video->p->memory.io[REG_STAT] = video->stat;
-	mTimingSchedule(timing, &video->modeEvent, (next << video->p->doubleSpeed) - cyclesLate);
+	_scheduleMode(video, _endMode3, next, cyclesLate);
 }
 
 void _endMode3(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	UNUSED(timing);
 	struct GBVideo* video = context;
 	GBVideoProcessDots(video, cyclesLate);
 	if (video->ly < GB_VIDEO_VERTICAL_PIXELS && video->p->memory.isHdma && video->p->memory.io[REG_HDMA5] != 0xFF) {
 		video->p->memory.hdmaRemaining = 0x10;
-		video->p->cpuBlocked = true;
-		mTimingDeschedule(timing, &video->p->memory.hdmaEvent);
-		mTimingSchedule(timing, &video->p->memory.hdmaEvent, 0);
+		GBMemoryScheduleHDMA(video->p);
 	}
 	video->mode = 0;
-	video->modeEvent.callback = _endMode0;
 	GBRegisterSTAT oldStat = video->stat;
 	video->stat = GBRegisterSTATSetMode(video->stat, video->mode);
 	if (!_statIRQAsserted(video, oldStat) && _statIRQAsserted(video, video->stat)) {
@@ -333,7 +345,65 @@ void _endMode3(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	video->p->memory.io[REG_STAT] = video->stat;
 	// TODO: Cache SCX & 7 in case it changes
 	int32_t next = GB_VIDEO_MODE_0_LENGTH_BASE - video->objMax * 6 - (video->p->memory.io[REG_SCX] & 7);
-	mTimingSchedule(timing, &video->modeEvent, (next << video->p->doubleSpeed) - cyclesLate);
+	_scheduleMode(video, _endMode0, next, cyclesLate);
+}
+
+static bool _isLineObserved(const struct GBVideo* video) {
+	// The end of mode 2 never raises an IRQ, but the end of mode 3 can raise one and start an HDMA
+	return GBRegisterSTATIsHblankIRQ(video->stat) || video->p->memory.isHdma;
+}
+
+static void _scheduleMode(struct GBVideo* video, void (*callback)(struct mTiming*, void*, uint32_t), int32_t next, uint32_t cyclesLate) {
+	struct mTiming* timing = &video->p->timing;
+	int32_t when = (next << video->p->doubleSpeed) - cyclesLate;
+	if (video->lazyLine) {
+		if (callback == _endMode0) {
+			// modeEvent is already scheduled for the end of the line
+			video->lazyLine = false;
+		} else {
+			video->lazyMode = callback;
+			video->lazyModeWhen = mTimingCurrentTime(timing) + when;
+		}
+		return;
+	}
+	if (callback == _endMode2 && !_isLineObserved(video)) {
+		video->lazyLine = true;
+		video->lazyMode = _endMode2;
+		video->lazyModeWhen = mTimingCurrentTime(timing) + when;
+		// Modes 3 and 0 always add up to the same length, regardless of SCX and sprites
+		callback = _endMode0;
+		when += (GB_VIDEO_MODE_3_LENGTH_BASE + GB_VIDEO_MODE_0_LENGTH_BASE) << video->p->doubleSpeed;
+	}
+	video->modeEvent.callback = callback;
+	mTimingSchedule(timing, &video->modeEvent, when);
+}
+
+static void _replayModes(struct GBVideo* video) {
+	struct mTiming* timing = &video->p->timing;
+	while (video->lazyLine && video->lazyMode) {
+		int32_t cyclesLate = mTimingCurrentTime(timing) - video->lazyModeWhen;
+		if (cyclesLate < 0) {
+			break;
+		}
+		void (*callback)(struct mTiming*, void*, uint32_t) = video->lazyMode;
+		// Clearing this keeps GBVideoSync calls made by the callback from reentering
+		video->lazyMode = NULL;
+		callback(timing, video, cyclesLate);
+	}
+}
+
+void GBVideoSync(struct GBVideo* video) {
+	if (!video->lazyLine || !video->lazyMode) {
+		return;
+	}
+	_replayModes(video);
+	if (video->lazyLine) {
+		// Something is watching the rest of this line, so go back to scheduling each mode
+		struct mTiming* timing = &video->p->timing;
+		video->lazyLine = false;
+		video->modeEvent.callback = video->lazyMode;
+		mTimingSchedule(timing, &video->modeEvent, video->lazyModeWhen - mTimingCurrentTime(timing));
+	}
 }
 
 void _updateFrameCount(struct mTiming* timing, void* context, uint32_t cyclesLate) {
@@ -345,12 +415,22 @@ void _updateFrameCount(struct mTiming* timing, void* context, uint32_t cyclesLat
 	}
 
 	GBFrameEnded(video->p);
-	mCoreSyncPostFrame(video->p->sync);
+	if (!video->suppressOutput) {
+		mCoreSyncPostFrame(video->p->sync);
+	}
 	--video->frameskipCounter;
 	if (video->frameskipCounter < 0) {
 		video->renderer->finishFrame(video->renderer);
 		video->frameskipCounter = video->frameskip;
 	}
+	if (video->sgbTransferFrames > 0) {
+		// The transfer is read out of the next frame even when nothing is shown, e.g. the real
+		// timeline under run-ahead; otherwise only the speculative copy would ever see it
+		--video->sgbTransferFrames;
+		video->frameskipCounter = 0;
+	} else if (video->suppressOutput && video->frameskipCounter <= 0) {
+		video->frameskipCounter = 1;
+	}
 	++video->frameCounter;
 
 	if (!GBRegisterLCDCIsEnable(video->p->memory.io[REG_LCDC])) {
@@ -385,6 +465,7 @@ static void _cleanOAM(struct GBVideo* video, int y) {
 }
 
 void GBVideoProcessDots(struct GBVideo* video, uint32_t cyclesLate) {
+	GBVideoSync(video);
 	if (video->mode != 3) {
 		return;
 	}
@@ -404,12 +485,12 @@ void GBVideoProcessDots(struct GBVideo* video, uint32_t cyclesLate) {
 }
 
 void GBVideoWriteLCDC(struct GBVideo* video, GBRegisterLCDC value) {
+	GBVideoSync(video);
 	if (!GBRegisterLCDCIsEnable(video->p->memory.io[REG_LCDC]) && GBRegisterLCDCIsEnable(value)) {
 		video->mode = 2;
-		video->modeEvent.callback = _endMode2;
 		int32_t next = GB_VIDEO_MODE_2_LENGTH - 5; // TODO: Why is this fudge factor needed? Might be related to T-cycles for load/store differing
 		mTimingDeschedule(&video->p->timing, &video->modeEvent);
-		mTimingSchedule(&video->p->timing, &video->modeEvent, next << video->p->doubleSpeed);
+		_scheduleMode(video, _endMode2, next, 0);
 
 		video->ly = 0;
 		video->p->memory.io[REG_LY] = 0;
@@ -442,6 +523,7 @@ void GBVideoWriteLCDC(struct GBVideo* video, GBRegisterLCDC value) {
 }
 
 void GBVideoWriteSTAT(struct GBVideo* video, GBRegisterSTAT value) {
+	GBVideoSync(video);
 	GBRegisterSTAT oldStat = video->stat;
 	video->stat = (video->stat & 0x7) | (value & 0x78);
 	if (!GBRegisterLCDCIsEnable(video->p->memory.io[REG_LCDC]) || video->p->model >= GB_MODEL_CGB) {
@@ -455,6 +537,7 @@ void GBVideoWriteSTAT(struct GBVideo* video, GBRegisterSTAT value) {
 }
 
 void GBVideoWriteLYC(struct GBVideo* video, uint8_t value) {
+	GBVideoSync(video);
 	GBRegisterSTAT oldStat = video->stat;
 	if (GBRegisterLCDCIsEnable(video->p->memory.io[REG_LCDC])) {
 		video->stat = GBRegisterSTATSetLYC(video->stat, value == video->ly);
@@ -689,12 +772,16 @@ void GBVideoWriteSGBPacket(struct GBVideo* video, uint8_t* data) {
 	case SGB_ATTR_DIV:
 	case SGB_ATTR_CHR:
 	case SGB_ATTR_LIN:
-	case SGB_PAL_TRN:
 	case SGB_ATRC_EN:
+	case SGB_ATTR_SET:
+		break;
+	case SGB_PAL_TRN:
 	case SGB_CHR_TRN:
 	case SGB_PCT_TRN:
 	case SGB_ATTR_TRN:
-	case SGB_ATTR_SET:
+		// The renderer reads the transfer back out of the next frame, so neither frame may be skipped
+		video->frameskipCounter = 0;
+		video->sgbTransferFrames = 1;
 		break;
 	case SGB_MLT_REQ:
 		video->p->sgbControllers = video->sgbPacketBuffer[1] & 0x3;
@@ -710,6 +797,191 @@ void GBVideoWriteSGBPacket(struct GBVideo* video, uint8_t* data) {
 	video->renderer->writeSGBPacket(video->renderer, video->sgbPacketBuffer);
 }
 
+static inline void _setAttribute(uint8_t* sgbAttributes, unsigned x, unsigned y, int palette) {
+	int p = sgbAttributes[(x >> 2) + 5 * y];
+	p &= ~(3 << (2 * (3 - (x & 3))));
+	p |= palette << (2 * (3 - (x & 3)));
+	sgbAttributes[(x >> 2) + 5 * y] = p;
+}
+
+static void _parseAttrBlock(struct GBVideoRenderer* renderer, const uint8_t* packet, int start) {
+	uint8_t block[6];
+	memcpy(block, &packet[start], 6);
+	unsigned x0 = block[2];
+	unsigned x1 = block[4];
+	unsigned y0 = block[3];
+	unsigned y1 = block[5];
+	unsigned x, y;
+	int pIn = block[1] & 3;
+	int pPerim = (block[1] >> 2) & 3;
+	int pOut = (block[1] >> 4) & 3;
+
+	for (y = 0; y < GB_VIDEO_VERTICAL_PIXELS / 8; ++y) {
+		for (x = 0; x < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++x) {
+			if (y > y0 && y < y1 && x > x0 && x < x1) {
+				if (block[0] & 1) {
+					_setAttribute(renderer->sgbAttributes, x, y, pIn);
+				}
+			} else if (y < y0 || y > y1 || x < x0 || x > x1) {
+				if (block[0] & 4) {
+					_setAttribute(renderer->sgbAttributes, x, y, pOut);
+				}
+			} else {
+				if (block[0] & 2) {
+					_setAttribute(renderer->sgbAttributes, x, y, pPerim);
+				} else if (block[0] & 1) {
+					_setAttribute(renderer->sgbAttributes, x, y, pIn);
+				} else if (block[0] & 4) {
+					_setAttribute(renderer->sgbAttributes, x, y, pOut);
+				}
+			}
+		}
+	}
+}
+
+static void _parseAttrLine(struct GBVideoRenderer* renderer, const uint8_t* packet, int start) {
+	uint8_t byte = packet[start];
+	unsigned line = byte & 0x1F;
+	int pal = (byte >> 5) & 3;
+
+	if (byte & 0x80) {
+		if (line > GB_VIDEO_VERTICAL_PIXELS / 8) {
+			return;
+		}
+		int x;
+		for (x = 0; x < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++x) {
+			_setAttribute(renderer->sgbAttributes, x, line, pal);
+		}
+	} else {
+		if (line > GB_VIDEO_HORIZONTAL_PIXELS / 8) {
+			return;
+		}
+		int y;
+		for (y = 0; y < GB_VIDEO_VERTICAL_PIXELS / 8; ++y) {
+			_setAttribute(renderer->sgbAttributes, line, y, pal);
+		}
+	}
+}
+
+void GBVideoRendererWriteSGBAttributes(struct GBVideoRenderer* renderer, const uint8_t* packet) {
+	int i;
+	int sets;
+	int attrX;
+	int attrY;
+	int attrDirection;
+	int pBefore;
+	int pAfter;
+	int pDiv;
+	switch (packet[0] >> 3) {
+	case SGB_ATTR_BLK:
+		sets = packet[1];
+		i = 2;
+		for (; i < (packet[0] & 7) << 4 && sets; i += 6, --sets) {
+			_parseAttrBlock(renderer, packet, i);
+		}
+		break;
+	case SGB_ATTR_LIN:
+		sets = packet[1];
+		i = 2;
+		for (; i < (packet[0] & 7) << 4 && sets; ++i, --sets) {
+			_parseAttrLine(renderer, packet, i);
+		}
+		break;
+	case SGB_ATTR_DIV:
+		pAfter = packet[1] & 3;
+		pBefore = (packet[1] >> 2) & 3;
+		pDiv = (packet[1] >> 4) & 3;
+		attrX = packet[2];
+		if (packet[1] & 0x40) {
+			if (attrX > GB_VIDEO_VERTICAL_PIXELS / 8) {
+				attrX = GB_VIDEO_VERTICAL_PIXELS / 8;
+			}
+			int j;
+			for (j = 0; j < attrX; ++j) {
+				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
+					_setAttribute(renderer->sgbAttributes, i, j, pBefore);
+				}
+			}
+			if (attrX < GB_VIDEO_VERTICAL_PIXELS / 8) {
+				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
+					_setAttribute(renderer->sgbAttributes, i, attrX, pDiv);
+				}
+
+			}
+			for (; j < GB_VIDEO_VERTICAL_PIXELS / 8; ++j) {
+				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
+					_setAttribute(renderer->sgbAttributes, i, j, pAfter);
+				}
+			}
+		} else {
+			if (attrX > GB_VIDEO_HORIZONTAL_PIXELS / 8) {
+				attrX = GB_VIDEO_HORIZONTAL_PIXELS / 8;
+			}
+			int j;
+			for (j = 0; j < attrX; ++j) {
+				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
+					_setAttribute(renderer->sgbAttributes, j, i, pBefore);
+				}
+			}
+			if (attrX < GB_VIDEO_HORIZONTAL_PIXELS / 8) {
+				for (i = 0; i < GB_VIDEO_VERTICAL_PIXELS / 8; ++i) {
+					_setAttribute(renderer->sgbAttributes, attrX, i, pDiv);
+				}
+
+			}
+			for (; j < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++j) {
+				for (i = 0; i < GB_VIDEO_VERTICAL_PIXELS / 8; ++i) {
+					_setAttribute(renderer->sgbAttributes, j, i, pAfter);
+				}
+			}
+		}
+		break;
+	case SGB_ATTR_CHR:
+		attrX = packet[1];
+		attrY = packet[2];
+		if (attrX >= GB_VIDEO_HORIZONTAL_PIXELS / 8) {
+			attrX = 0;
+		}
+		if (attrY >= GB_VIDEO_VERTICAL_PIXELS / 8) {
+			attrY = 0;
+		}
+		sets = packet[3];
+		sets |= packet[4] << 8;
+		attrDirection = packet[5];
+		i = 6;
+		for (; i < (packet[0] & 7) << 4 && sets; ++i) {
+			int j;
+			for (j = 0; j < 4 && sets; ++j, --sets) {
+				uint8_t p = packet[i] >> (6 - j * 2);
+				_setAttribute(renderer->sgbAttributes, attrX, attrY, p & 3);
+				if (attrDirection) {
+					++attrY;
+					if (attrY >= GB_VIDEO_VERTICAL_PIXELS / 8) {
+						attrY = 0;
+						++attrX;
+					}
+					if (attrX >= GB_VIDEO_HORIZONTAL_PIXELS / 8) {
+						attrX = 0;
+					}
+				} else {
+					++attrX;
+					if (attrX >= GB_VIDEO_HORIZONTAL_PIXELS / 8) {
+						attrX = 0;
+						++attrY;
+					}
+					if (attrY >= GB_VIDEO_VERTICAL_PIXELS / 8) {
+						attrY = 0;
+					}
+				}
+			}
+		}
+
+		break;
+	default:
+		break;
+	}
+}
+
 static void GBVideoDummyRendererInit(struct GBVideoRenderer* renderer, enum GBModel model, bool borders) {
 	UNUSED(renderer);
 	UNUSED(model);
@@ -833,6 +1105,8 @@ void GBVideoDeserialize(struct GBVideo* video, const struct GBSerializedState* s
 	video->bcpIncrement = GBSerializedVideoFlagsGetBcpIncrement(flags);
 	video->ocpIncrement = GBSerializedVideoFlagsGetOcpIncrement(flags);
 	video->mode = GBSerializedVideoFlagsGetMode(flags);
+	video->lazyLine = false;
+	video->lazyMode = NULL;
 	LOAD_16LE(video->bcpIndex, 0, &state->video.bcpIndex);
 	video->bcpIndex &= 0x3F;
 	LOAD_16LE(video->ocpIndex, 0, &state->video.ocpIndex);
@@ -13,8 +13,10 @@
 #include <mgba/internal/gba/io.h>
 #include <mgba/internal/gba/serialize.h>
 #include <mgba/internal/gba/video.h>
+#include <mgba-util/threading.h>
 
 #define MP2K_LOCK_MAX 8
+#define SYNTH_QUEUE_SIZE 8
 
 #ifdef _3DS
 #define blip_add_delta blip_add_delta_fast
@@ -28,6 +30,42 @@ const int GBA_AUDIO_VOLUME_MAX = 0x100;
 
 static const int CLOCKS_PER_FRAME = 0x800;
 
+// The levels a batch of samples is synthesized against, and the clock at the end of that batch
+struct GBAAudioSynthState {
+	int32_t clock;
+	int16_t lastLeft;
+	int16_t lastRight;
+};
+
+#ifndef DISABLE_THREADING
+struct GBAAudioSynthJob {
+	struct GBAStereoSample batch[GBA_AUDIO_BATCH_SIZE];
+	int batchLength;
+	int32_t sampleInterval;
+	bool fastSynthesis;
+};
+
+// Mixed sample batches are logged here by the emulation thread and synthesized into the blip
+// buffers by a worker thread. Only the batches cross threads; the PSG and FIFOs stay where the game can see them.
+struct GBAAudioSynthesizer {
+	struct GBAAudio* p;
+	Thread thread;
+	Mutex mutex;
+	Condition jobCond;
+	Condition doneCond;
+	bool exit;
+
+	struct GBAAudioSynthJob jobs[SYNTH_QUEUE_SIZE];
+	unsigned head;
+	unsigned tail;
+
+	// While attached, the worker owns the blip buffers and this state rather than the GBAAudio
+	bool attached;
+	bool interrupted;
+	struct GBAAudioSynthState state;
+};
+#endif
+
 static int _applyBias(struct GBAAudio* audio, int sample);
 static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate);
 
@@ -48,17 +86,23 @@ void GBAAudioInit(struct GBAAudio* audio, size_t samples) {
 	// Guess too large; we hang producing extra samples if we guess too low
 	blip_set_rates(audio->psg.left, GBA_ARM7TDMI_FREQUENCY, 96000);
 	blip_set_rates(audio->psg.right, GBA_ARM7TDMI_FREQUENCY, 96000);
-	CircleBufferInit(&audio->chA.fifo, GBA_AUDIO_FIFO_SIZE);
-	CircleBufferInit(&audio->chB.fifo, GBA_AUDIO_FIFO_SIZE);
+	CircleBufferMaskedInit(&audio->chA.fifo, GBA_AUDIO_FIFO_SIZE);
+	CircleBufferMaskedInit(&audio->chB.fifo, GBA_AUDIO_FIFO_SIZE);
 
 	audio->externalMixing = false;
 	audio->forceDisableChA = false;
 	audio->forceDisableChB = false;
 	audio->masterVolume = GBA_AUDIO_VOLUME_MAX;
+	audio->suppressOutput = false;
+	audio->skipSynthesis = false;
+	audio->fastSynthesis = false;
+	audio->batchLength = 0;
 	audio->mixer = NULL;
+	audio->synth = NULL;
 }
 
 void GBAAudioReset(struct GBAAudio* audio) {
+	GBAAudioFinishSynthesis(audio);
 	GBAudioReset(&audio->psg);
 	mTimingDeschedule(&audio->p->timing, &audio->sampleEvent);
 	mTimingSchedule(&audio->p->timing, &audio->sampleEvent, 0);
@@ -84,22 +128,26 @@ void GBAAudioReset(struct GBAAudio* audio) {
 	blip_clear(audio->psg.left);
 	blip_clear(audio->psg.right);
 	audio->clock = 0;
-	CircleBufferClear(&audio->chA.fifo);
-	CircleBufferClear(&audio->chB.fifo);
+	audio->batchLength = 0;
+	CircleBufferMaskedClear(&audio->chA.fifo);
+	CircleBufferMaskedClear(&audio->chB.fifo);
 }
 
 void GBAAudioDeinit(struct GBAAudio* audio) {
+	GBAAudioSetThreadedSynthesis(audio, false);
 	GBAudioDeinit(&audio->psg);
-	CircleBufferDeinit(&audio->chA.fifo);
-	CircleBufferDeinit(&audio->chB.fifo);
+	CircleBufferMaskedDeinit(&audio->chA.fifo);
+	CircleBufferMaskedDeinit(&audio->chB.fifo);
 }
 
 void GBAAudioResizeBuffer(struct GBAAudio* audio, size_t samples) {
+	GBAAudioFinishSynthesis(audio);
 	mCoreSyncLockAudio(audio->p->sync);
 	audio->samples = samples;
 	blip_clear(audio->psg.left);
 	blip_clear(audio->psg.right);
 	audio->clock = 0;
+	audio->batchLength = 0;
 	mCoreSyncConsumeAudio(audio->p->sync);
 }
 
@@ -158,9 +206,9 @@ void GBAAudioWriteSOUND2CNT_HI(struct GBAAudio* audio, uint16_t value) {
 }
 
 void GBAAudioWriteSOUND3CNT_LO(struct GBAAudio* audio, uint16_t value) {
+	GBAudioWriteNR30(&audio->psg, value);
 	audio->psg.ch3.size = GBAudioRegisterBankGetSize(value);
 	audio->psg.ch3.bank = GBAudioRegisterBankGetBank(value);
-	GBAudioWriteNR30(&audio->psg, value);
 }
 
 void GBAAudioWriteSOUND3CNT_HI(struct GBAAudio* audio, uint16_t value) {
@@ -199,10 +247,10 @@ void GBAAudioWriteSOUNDCNT_HI(struct GBAAudio* audio, uint16_t value) {
 	audio->chBLeft = GBARegisterSOUNDCNT_HIGetChBLeft(value);
 	audio->chBTimer = GBARegisterSOUNDCNT_HIGetChBTimer(value);
 	if (GBARegisterSOUNDCNT_HIIsChAReset(value)) {
-		CircleBufferClear(&audio->chA.fifo);
+		CircleBufferMaskedClear(&audio->chA.fifo);
 	}
 	if (GBARegisterSOUNDCNT_HIIsChBReset(value)) {
-		CircleBufferClear(&audio->chB.fifo);
+		CircleBufferMaskedClear(&audio->chB.fifo);
 	}
 }
 
@@ -216,11 +264,12 @@ void GBAAudioWriteSOUNDBIAS(struct GBAAudio* audio, uint16_t value) {
 }
 
 void GBAAudioWriteWaveRAM(struct GBAAudio* audio, int address, uint32_t value) {
+	GBAudioSync(&audio->psg);
 	audio->psg.ch3.wavedata32[address | (!audio->psg.ch3.bank * 4)] = value;
 }
 
 void GBAAudioWriteFIFO(struct GBAAudio* audio, int address, uint32_t value) {
-	struct CircleBuffer* fifo;
+	struct CircleBufferMasked* fifo;
 	switch (address) {
 	case REG_FIFO_A_LO:
 		fifo = &audio->chA.fifo;
@@ -232,13 +281,14 @@ void GBAAudioWriteFIFO(struct GBAAudio* audio, int address, uint32_t value) {
 		mLOG(GBA_AUDIO, ERROR, "Bad FIFO write to address 0x%03x", address);
 		return;
 	}
-	int i;
-	for (i = 0; i < 4; ++i) {
-		while (!CircleBufferWrite8(fifo, value >> (8 * i))) {
-			int8_t dummy;
-			CircleBufferRead8(fifo, &dummy);
-		}
+	// A full FIFO drops its oldest bytes to make room
+	size_t size = CircleBufferMaskedSize(fifo) + sizeof(value);
+	if (size > CircleBufferMaskedCapacity(fifo)) {
+		CircleBufferMaskedDiscard(fifo, size - CircleBufferMaskedCapacity(fifo));
 	}
+	uint8_t bytes[sizeof(value)];
+	STORE_32LE(value, 0, bytes);
+	CircleBufferMaskedWrite(fifo, bytes, sizeof(bytes));
 }
 
 void GBAAudioSampleFIFO(struct GBAAudio* audio, int fifoId, int32_t cycles) {
@@ -251,7 +301,7 @@ void GBAAudioSampleFIFO(struct GBAAudio* audio, int fifoId, int32_t cycles) {
 		mLOG(GBA_AUDIO, ERROR, "Bad FIFO write to address 0x%03x", fifoId);
 		return;
 	}
-	if (CircleBufferSize(&channel->fifo) <= 4 * sizeof(int32_t) && channel->dmaSource > 0) {
+	if (CircleBufferMaskedSize(&channel->fifo) <= 4 * sizeof(int32_t) && channel->dmaSource > 0) {
 		struct GBADMA* dma = &audio->p->memory.dma[channel->dmaSource];
 		if (GBADMARegisterGetTiming(dma->reg) == GBA_DMA_TIMING_CUSTOM) {
 			dma->when = mTimingCurrentTime(&audio->p->timing) - cycles;
@@ -261,7 +311,7 @@ void GBAAudioSampleFIFO(struct GBAAudio* audio, int fifoId, int32_t cycles) {
 			channel->dmaSource = 0;
 		}
 	}
-	CircleBufferRead8(&channel->fifo, (int8_t*) &channel->sample);
+	CircleBufferMaskedRead8(&channel->fifo, &channel->sample);
 }
 
 static int _applyBias(struct GBAAudio* audio, int sample) {
@@ -276,6 +326,15 @@ static int _applyBias(struct GBAAudio* audio, int sample) {
 
 static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 	struct GBAAudio* audio = user;
+	if (audio->skipSynthesis) {
+		mTimingSchedule(timing, &audio->sampleEvent, audio->sampleInterval - cyclesLate);
+		return;
+	}
+	GBAudioRun(&audio->psg, mTimingCurrentTime(timing) - cyclesLate + 1);
+	if (audio->suppressOutput) {
+		mTimingSchedule(timing, &audio->sampleEvent, audio->sampleInterval - cyclesLate);
+		return;
+	}
 	int16_t sampleLeft = 0;
 	int16_t sampleRight = 0;
 	int psgShift = 4 - audio->volume;
@@ -308,29 +367,233 @@ static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 		}
 	}
 
-	sampleLeft = _applyBias(audio, sampleLeft);
-	sampleRight = _applyBias(audio, sampleRight);
+	struct GBAStereoSample* sample = &audio->batch[audio->batchLength];
+	sample->left = _applyBias(audio, sampleLeft);
+	sample->right = _applyBias(audio, sampleRight);
+	++audio->batchLength;
+	// The clock runs ahead of the blip buffers until the batch is flushed, so the mixer's deltas still line up
+	audio->clock += audio->sampleInterval;
+	if (audio->batchLength == GBA_AUDIO_BATCH_SIZE) {
+		GBAAudioFlush(audio);
+	}
 
-	mCoreSyncLockAudio(audio->p->sync);
-	unsigned produced;
-	if ((size_t) blip_samples_avail(audio->psg.left) < audio->samples) {
-		blip_add_delta(audio->psg.left, audio->clock, sampleLeft - audio->lastLeft);
-		blip_add_delta(audio->psg.right, audio->clock, sampleRight - audio->lastRight);
-		audio->lastLeft = sampleLeft;
-		audio->lastRight = sampleRight;
-		audio->clock += audio->sampleInterval;
-		if (audio->clock >= CLOCKS_PER_FRAME) {
-			blip_end_frame(audio->psg.left, CLOCKS_PER_FRAME);
-			blip_end_frame(audio->psg.right, CLOCKS_PER_FRAME);
-			audio->clock -= CLOCKS_PER_FRAME;
+	mTimingSchedule(timing, &audio->sampleEvent, audio->sampleInterval - cyclesLate);
+}
+
+static void _addDelta(struct blip_t* buffer, bool fast, int32_t clock, int delta) {
+	if (fast) {
+		blip_add_delta_fast(buffer, clock, delta);
+	} else {
+		blip_add_delta(buffer, clock, delta);
+	}
+}
+
+// Must be called with the audio lock held
+static void _synthesize(struct GBAAudio* audio, struct GBAAudioSynthState* state, const struct GBAStereoSample* batch, int length, int32_t interval, bool fast) {
+	int32_t clock = state->clock - length * interval;
+	if ((size_t) blip_samples_avail(audio->psg.left) >= audio->samples) {
+		// The buffers are full, so the batch is dropped as if it had never been clocked in
+		state->clock = clock;
+		return;
+	}
+	int i;
+	for (i = 0; i < length; ++i) {
+		const struct GBAStereoSample* sample = &batch[i];
+		// Silence and held levels are common, and an empty delta adds nothing
+		if (sample->left != state->lastLeft) {
+			_addDelta(audio->psg.left, fast, clock, sample->left - state->lastLeft);
+			state->lastLeft = sample->left;
+		}
+		if (sample->right != state->lastRight) {
+			_addDelta(audio->psg.right, fast, clock, sample->right - state->lastRight);
+			state->lastRight = sample->right;
+		}
+		clock += interval;
+	}
+	// Frames still end on the same boundaries as when samples were added one at a time
+	int32_t frames = state->clock / CLOCKS_PER_FRAME * CLOCKS_PER_FRAME;
+	if (frames) {
+		blip_end_frame(audio->psg.left, frames);
+		blip_end_frame(audio->psg.right, frames);
+		state->clock -= frames;
+	}
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _synthThread(void* context) {
+	struct GBAAudioSynthesizer* synth = context;
+	struct GBAAudio* audio = synth->p;
+	ThreadSetName("Audio Synthesis Thread");
+
+	MutexLock(&synth->mutex);
+	while (true) {
+		if (synth->tail == synth->head) {
+			if (synth->exit) {
+				break;
+			}
+			ConditionWait(&synth->jobCond, &synth->mutex);
+			continue;
+		}
+		struct GBAAudioSynthJob* job = &synth->jobs[synth->tail % SYNTH_QUEUE_SIZE];
+		MutexUnlock(&synth->mutex);
+
+		struct mCoreSync* sync = audio->p->sync;
+		mCoreSyncLockAudio(sync);
+		synth->state.clock += job->batchLength * job->sampleInterval;
+		_synthesize(audio, &synth->state, job->batch, job->batchLength, job->sampleInterval, job->fastSynthesis);
+		bool progress = mCoreSyncProduceAudio(sync, audio->psg.left, audio->psg.right, audio->samples);
+
+		MutexLock(&synth->mutex);
+		if (!progress) {
+			synth->interrupted = true;
 		}
+		++synth->tail;
+		ConditionWake(&synth->doneCond);
+	}
+	MutexUnlock(&synth->mutex);
+
+#ifdef _3DS
+	svcExitThread();
+#endif
+	return 0;
+}
+
+static bool _canSynthesizeOffThread(struct GBAAudio* audio) {
+	if (!audio->synth) {
+		return false;
+	}
+	// The mixer adds its deltas straight into the blip buffers as it steps
+	if (audio->mixer) {
+		return false;
+	}
+	// Stream consumers that read the blip buffers expect to do so on this thread
+	if (audio->p->stream && audio->p->stream->postAudioBuffer) {
+		return false;
 	}
-	produced = blip_samples_avail(audio->psg.left);
+	return true;
+}
+
+static void _postBatch(struct GBAAudio* audio) {
+	struct GBAAudioSynthesizer* synth = audio->synth;
+	MutexLock(&synth->mutex);
+	if (!synth->attached) {
+		synth->state.clock = audio->clock - audio->batchLength * audio->sampleInterval;
+		synth->state.lastLeft = audio->lastLeft;
+		synth->state.lastRight = audio->lastRight;
+		synth->attached = true;
+	}
+	// Waiting here keeps the emulation paced by the audio sync once the worker is blocked on it
+	while (synth->head - synth->tail == SYNTH_QUEUE_SIZE) {
+		ConditionWait(&synth->doneCond, &synth->mutex);
+	}
+	struct GBAAudioSynthJob* job = &synth->jobs[synth->head % SYNTH_QUEUE_SIZE];
+	memcpy(job->batch, audio->batch, audio->batchLength * sizeof(*audio->batch));
+	job->batchLength = audio->batchLength;
+	job->sampleInterval = audio->sampleInterval;
+	job->fastSynthesis = audio->fastSynthesis;
+	++synth->head;
+	ConditionWake(&synth->jobCond);
+	if (synth->interrupted) {
+		synth->interrupted = false;
+		audio->p->earlyExit = true;
+	}
+	MutexUnlock(&synth->mutex);
+	// While attached, the clock here only counts the batch that has yet to be posted
+	audio->clock = 0;
+}
+#endif
+
+void GBAAudioSetThreadedSynthesis(struct GBAAudio* audio, bool enable) {
+#ifndef DISABLE_THREADING
+	if (enable == !!audio->synth) {
+		return;
+	}
+	if (enable) {
+		struct GBAAudioSynthesizer* synth = calloc(1, sizeof(*synth));
+		synth->p = audio;
+		MutexInit(&synth->mutex);
+		ConditionInit(&synth->jobCond);
+		ConditionInit(&synth->doneCond);
+		ThreadCreate(&synth->thread, _synthThread, synth);
+		audio->synth = synth;
+		return;
+	}
+	struct GBAAudioSynthesizer* synth = audio->synth;
+	GBAAudioFinishSynthesis(audio);
+	MutexLock(&synth->mutex);
+	synth->exit = true;
+	ConditionWake(&synth->jobCond);
+	MutexUnlock(&synth->mutex);
+	ThreadJoin(synth->thread);
+	MutexDeinit(&synth->mutex);
+	ConditionDeinit(&synth->jobCond);
+	ConditionDeinit(&synth->doneCond);
+	free(synth);
+	audio->synth = NULL;
+#else
+	UNUSED(audio);
+	UNUSED(enable);
+#endif
+}
+
+void GBAAudioFinishSynthesis(struct GBAAudio* audio) {
+#ifndef DISABLE_THREADING
+	struct GBAAudioSynthesizer* synth = audio->synth;
+	if (!synth) {
+		return;
+	}
+	MutexLock(&synth->mutex);
+	while (synth->tail != synth->head) {
+		ConditionWait(&synth->doneCond, &synth->mutex);
+	}
+	if (synth->attached) {
+		audio->clock += synth->state.clock;
+		audio->lastLeft = synth->state.lastLeft;
+		audio->lastRight = synth->state.lastRight;
+		synth->attached = false;
+	}
+	if (synth->interrupted) {
+		synth->interrupted = false;
+		audio->p->earlyExit = true;
+	}
+	MutexUnlock(&synth->mutex);
+#else
+	UNUSED(audio);
+#endif
+}
+
+void GBAAudioFlush(struct GBAAudio* audio) {
+	if (!audio->batchLength) {
+		return;
+	}
+	int i;
 	if (audio->p->stream && audio->p->stream->postAudioFrame) {
-		audio->p->stream->postAudioFrame(audio->p->stream, sampleLeft, sampleRight);
+		for (i = 0; i < audio->batchLength; ++i) {
+			audio->p->stream->postAudioFrame(audio->p->stream, audio->batch[i].left, audio->batch[i].right);
+		}
+	}
+#ifndef DISABLE_THREADING
+	if (_canSynthesizeOffThread(audio)) {
+		_postBatch(audio);
+		audio->batchLength = 0;
+		return;
 	}
+	GBAAudioFinishSynthesis(audio);
+#endif
+	mCoreSyncLockAudio(audio->p->sync);
+	struct GBAAudioSynthState state = {
+		.clock = audio->clock,
+		.lastLeft = audio->lastLeft,
+		.lastRight = audio->lastRight
+	};
+	_synthesize(audio, &state, audio->batch, audio->batchLength, audio->sampleInterval, audio->fastSynthesis);
+	audio->clock = state.clock;
+	audio->lastLeft = state.lastLeft;
+	audio->lastRight = state.lastRight;
+	audio->batchLength = 0;
+	unsigned produced = blip_samples_avail(audio->psg.left);
 	bool wait = produced >= audio->samples;
-	if (!mCoreSyncProduceAudio(audio->p->sync, audio->psg.left, audio->samples)) {
+	if (!mCoreSyncProduceAudio(audio->p->sync, audio->psg.left, audio->psg.right, audio->samples)) {
 		// Interrupted
 		audio->p->earlyExit = true;
 	}
@@ -338,16 +601,14 @@ static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 	if (wait && audio->p->stream && audio->p->stream->postAudioBuffer) {
 		audio->p->stream->postAudioBuffer(audio->p->stream, audio->psg.left, audio->psg.right);
 	}
-
-	mTimingSchedule(timing, &audio->sampleEvent, audio->sampleInterval - cyclesLate);
 }
 
 void GBAAudioSerialize(const struct GBAAudio* audio, struct GBASerializedState* state) {
 	GBAudioPSGSerialize(&audio->psg, &state->audio.psg, &state->audio.flags);
 
-	CircleBufferDump(&audio->chA.fifo, state->audio.fifoA, sizeof(state->audio.fifoA));
-	CircleBufferDump(&audio->chB.fifo, state->audio.fifoB, sizeof(state->audio.fifoB));
-	uint32_t fifoSize = CircleBufferSize(&audio->chA.fifo);
+	CircleBufferMaskedPeek(&audio->chA.fifo, state->audio.fifoA, sizeof(state->audio.fifoA));
+	CircleBufferMaskedPeek(&audio->chB.fifo, state->audio.fifoB, sizeof(state->audio.fifoB));
+	uint32_t fifoSize = CircleBufferMaskedSize(&audio->chA.fifo);
 	STORE_32(fifoSize, 0, &state->audio.fifoSize);
 	STORE_32(audio->sampleEvent.when - mTimingCurrentTime(&audio->p->timing), 0, &state->audio.nextSample);
 }
@@ -355,18 +616,15 @@ void GBAAudioSerialize(const struct GBAAudio* audio, struct GBASerializedState*
 void GBAAudioDeserialize(struct GBAAudio* audio, const struct GBASerializedState* state) {
 	GBAudioPSGDeserialize(&audio->psg, &state->audio.psg, &state->audio.flags);
 
-	CircleBufferClear(&audio->chA.fifo);
-	CircleBufferClear(&audio->chB.fifo);
+	CircleBufferMaskedClear(&audio->chA.fifo);
+	CircleBufferMaskedClear(&audio->chB.fifo);
 	uint32_t fifoSize;
 	LOAD_32(fifoSize, 0, &state->audio.fifoSize);
-	if (state->audio.fifoSize > CircleBufferCapacity(&audio->chA.fifo)) {
-		fifoSize = CircleBufferCapacity(&audio->chA.fifo);
-	}
-	size_t i;
-	for (i = 0; i < fifoSize; ++i) {
-		CircleBufferWrite8(&audio->chA.fifo, state->audio.fifoA[i]);
-		CircleBufferWrite8(&audio->chB.fifo, state->audio.fifoB[i]);
+	if (fifoSize > CircleBufferMaskedCapacity(&audio->chA.fifo)) {
+		fifoSize = CircleBufferMaskedCapacity(&audio->chA.fifo);
 	}
+	CircleBufferMaskedWrite(&audio->chA.fifo, state->audio.fifoA, fifoSize);
+	CircleBufferMaskedWrite(&audio->chB.fifo, state->audio.fifoB, fifoSize);
 
 	uint32_t when;
 	LOAD_32(when, 0, &state->audio.nextSample);
@@ -22,6 +22,8 @@ static void _unHuffman(struct GBA* gba);
 static void _unRl(struct GBA* gba, int width);
 static void _unFilter(struct GBA* gba, int inwidth, int outwidth);
 static void _unBitPack(struct GBA* gba);
+static bool _CpuSet(struct GBA* gba);
+static bool _CpuFastSet(struct GBA* gba);
 
 static int _mulWait(int32_t r) {
 	if ((r & 0xFFFFFF00) == 0xFFFFFF00 || !(r & 0xFFFFFF00)) {
@@ -471,6 +473,9 @@ void GBASwi16(struct ARMCore* cpu, int immediate) {
 		if (cpu->gprs[1] & (cpu->gprs[2] & (1 << 26) ? 3 : 1)) {
 			mLOG(GBA_BIOS, GAME_ERROR, "Misaligned CpuSet destination");
 		}
+		if (immediate == 0xB ? _CpuSet(gba) : _CpuFastSet(gba)) {
+			break;
+		}
 		ARMRaiseSWI(cpu);
 		break;
 	case 0xD:
@@ -601,11 +606,158 @@ uint32_t GBAChecksum(uint32_t* memory, size_t size) {
 	return sum;
 }
 
+// The decompression routines work byte by byte, so they go straight to host memory when the buffers are in
+// directly mapped RAM, ROM or VRAM. Anything outside of those spans, like mirrors, open bus or I/O, still goes
+// through the bus, and so do misaligned accesses, so the results match the bus path exactly.
+struct GBADecompressSpan {
+	uint32_t base;
+	uint32_t size;
+	uint8_t* data;
+};
+
+struct GBADecompressor {
+	struct GBA* gba;
+	struct GBADecompressSpan source;
+	struct GBADecompressSpan dest;
+	int destRegion;
+	bool destVRAM;
+};
+
+static void _decompressSpan(struct GBADecompressSpan* span, const struct GBAMemoryPage* page, uint32_t address) {
+	span->base = address & ~page->mask;
+	span->size = page->size;
+	span->data = page->data;
+}
+
+static void _decompressorInit(struct GBADecompressor* decompressor, struct GBA* gba, uint32_t source, uint32_t dest) {
+	struct ARMCore* cpu = gba->cpu;
+	struct GBAMemory* memory = &gba->memory;
+	memset(decompressor, 0, sizeof(*decompressor));
+	decompressor->gba = gba;
+	decompressor->destRegion = dest >> BASE_OFFSET;
+	// Memory shims, e.g. debugger watchpoints, need to see every access
+	if (cpu->memory.load8 != GBALoad8 || cpu->memory.load16 != GBALoad16 || cpu->memory.load32 != GBALoad32 ||
+	    cpu->memory.store8 != GBAStore8 || cpu->memory.store16 != GBAStore16 || cpu->memory.store32 != GBAStore32) {
+		return;
+	}
+	_decompressSpan(&decompressor->source, &memory->loadPages[source >> BASE_OFFSET], source);
+	if (decompressor->destRegion == REGION_VRAM) {
+		// VRAM has no store page since the renderer needs to hear about writes, which the stores below handle
+		_decompressSpan(&decompressor->dest, &memory->loadPages[REGION_VRAM], dest);
+		decompressor->destVRAM = true;
+	} else {
+		_decompressSpan(&decompressor->dest, &memory->storePages[decompressor->destRegion], dest);
+	}
+}
+
+static inline uint32_t _decompressLoad8(struct GBADecompressor* decompressor, uint32_t address) {
+	uint32_t offset = address - decompressor->source.base;
+	if (offset < decompressor->source.size) {
+		return decompressor->source.data[offset];
+	}
+	offset = address - decompressor->dest.base;
+	if (offset < decompressor->dest.size) {
+		return decompressor->dest.data[offset];
+	}
+	struct ARMCore* cpu = decompressor->gba->cpu;
+	return cpu->memory.load8(cpu, address, 0);
+}
+
+static inline uint32_t _decompressLoad16(struct GBADecompressor* decompressor, uint32_t address) {
+	uint32_t value;
+	if (!(address & 1)) {
+		uint32_t offset = address - decompressor->source.base;
+		if (offset < decompressor->source.size) {
+			LOAD_16(value, offset, decompressor->source.data);
+			return value;
+		}
+		offset = address - decompressor->dest.base;
+		if (offset < decompressor->dest.size) {
+			LOAD_16(value, offset, decompressor->dest.data);
+			return value;
+		}
+	}
+	struct ARMCore* cpu = decompressor->gba->cpu;
+	return cpu->memory.load16(cpu, address, 0);
+}
+
+static inline uint32_t _decompressLoad32(struct GBADecompressor* decompressor, uint32_t address) {
+	uint32_t value;
+	if (!(address & 3)) {
+		uint32_t offset = address - decompressor->source.base;
+		if (offset < decompressor->source.size) {
+			LOAD_32(value, offset, decompressor->source.data);
+			return value;
+		}
+	}
+	struct ARMCore* cpu = decompressor->gba->cpu;
+	return cpu->memory.load32(cpu, address, 0);
+}
+
+static inline void _decompressStore8(struct GBADecompressor* decompressor, uint32_t address, uint8_t value) {
+	uint32_t offset = address - decompressor->dest.base;
+	// Byte stores to VRAM are special, so they always take the bus
+	if (offset < decompressor->dest.size && !decompressor->destVRAM) {
+		decompressor->dest.data[offset] = value;
+		mCoreMemoryDirtyMark(&decompressor->gba->memory.dirtyPages[decompressor->destRegion], offset);
+		return;
+	}
+	struct ARMCore* cpu = decompressor->gba->cpu;
+	cpu->memory.store8(cpu, address, value, 0);
+}
+
+static inline void _decompressStore16(struct GBADecompressor* decompressor, uint32_t address, uint16_t value) {
+	uint32_t offset = address - decompressor->dest.base;
+	if (!(address & 1) && offset < decompressor->dest.size) {
+		struct GBA* gba = decompressor->gba;
+		if (decompressor->destVRAM) {
+			uint16_t oldValue;
+			LOAD_16(oldValue, offset, decompressor->dest.data);
+			if (oldValue == value) {
+				return;
+			}
+		}
+		STORE_16(value, offset, decompressor->dest.data);
+		mCoreMemoryDirtyMark(&gba->memory.dirtyPages[decompressor->destRegion], offset);
+		if (decompressor->destVRAM) {
+			gba->video.renderer->writeVRAM(gba->video.renderer, offset);
+		}
+		return;
+	}
+	struct ARMCore* cpu = decompressor->gba->cpu;
+	cpu->memory.store16(cpu, address, value, 0);
+}
+
+static inline void _decompressStore32(struct GBADecompressor* decompressor, uint32_t address, uint32_t value) {
+	uint32_t offset = address - decompressor->dest.base;
+	if (!(address & 3) && offset < decompressor->dest.size) {
+		struct GBA* gba = decompressor->gba;
+		if (decompressor->destVRAM) {
+			uint32_t oldValue;
+			LOAD_32(oldValue, offset, decompressor->dest.data);
+			if (oldValue == value) {
+				return;
+			}
+		}
+		STORE_32(value, offset, decompressor->dest.data);
+		mCoreMemoryDirtyMark(&gba->memory.dirtyPages[decompressor->destRegion], offset);
+		if (decompressor->destVRAM) {
+			gba->video.renderer->writeVRAM(gba->video.renderer, offset + 2);
+			gba->video.renderer->writeVRAM(gba->video.renderer, offset);
+		}
+		return;
+	}
+	struct ARMCore* cpu = decompressor->gba->cpu;
+	cpu->memory.store32(cpu, address, value, 0);
+}
+
 static void _unLz77(struct GBA* gba, int width) {
 	struct ARMCore* cpu = gba->cpu;
+	struct GBADecompressor decompressor;
+	_decompressorInit(&decompressor, gba, cpu->gprs[0], cpu->gprs[1]);
 	uint32_t source = cpu->gprs[0];
 	uint32_t dest = cpu->gprs[1];
-	int remaining = (cpu->memory.load32(cpu, source, 0) & 0xFFFFFF00) >> 8;
+	int remaining = (_decompressLoad32(&decompressor, source) & 0xFFFFFF00) >> 8;
 	// We assume the signature byte (0x10) is correct
 	int blockheader = 0; // Some compilers warn if this isn't set, even though it's trivially provably always set
 	source += 4;
@@ -618,7 +770,7 @@ static void _unLz77(struct GBA* gba, int width) {
 		if (blocksRemaining) {
 			if (blockheader & 0x80) {
 				// Compressed
-				int block = cpu->memory.load8(cpu, source + 1, 0) | (cpu->memory.load8(cpu, source, 0) << 8);
+				int block = _decompressLoad8(&decompressor, source + 1) | (_decompressLoad8(&decompressor, source) << 8);
 				source += 2;
 				disp = dest - (block & 0x0FFF) - 1;
 				bytes = (block >> 12) + 3;
@@ -627,35 +779,35 @@ static void _unLz77(struct GBA* gba, int width) {
 						--remaining;
 					}
 					if (width == 2) {
-						byte = (int16_t) cpu->memory.load16(cpu, disp & ~1, 0);
+						byte = (int16_t) _decompressLoad16(&decompressor, disp & ~1);
 						if (dest & 1) {
 							byte >>= (disp & 1) * 8;
 							halfword |= byte << 8;
-							cpu->memory.store16(cpu, dest ^ 1, halfword, 0);
+							_decompressStore16(&decompressor, dest ^ 1, halfword);
 						} else {
 							byte >>= (disp & 1) * 8;
 							halfword = byte & 0xFF;
 						}
 					} else {
-						byte = cpu->memory.load8(cpu, disp, 0);
-						cpu->memory.store8(cpu, dest, byte, 0);
+						byte = _decompressLoad8(&decompressor, disp);
+						_decompressStore8(&decompressor, dest, byte);
 					}
 					++disp;
 					++dest;
 				}
 			} else {
 				// Uncompressed
-				byte = cpu->memory.load8(cpu, source, 0);
+				byte = _decompressLoad8(&decompressor, source);
 				++source;
 				if (width == 2) {
 					if (dest & 1) {
 						halfword |= byte << 8;
-						cpu->memory.store16(cpu, dest ^ 1, halfword, 0);
+						_decompressStore16(&decompressor, dest ^ 1, halfword);
 					} else {
 						halfword = byte;
 					}
 				} else {
-					cpu->memory.store8(cpu, dest, byte, 0);
+					_decompressStore8(&decompressor, dest, byte);
 				}
 				++dest;
 				--remaining;
@@ -663,7 +815,7 @@ static void _unLz77(struct GBA* gba, int width) {
 			blockheader <<= 1;
 			--blocksRemaining;
 		} else {
-			blockheader = cpu->memory.load8(cpu, source, 0);
+			blockheader = _decompressLoad8(&decompressor, source);
 			++source;
 			blocksRemaining = 8;
 		}
@@ -680,9 +832,11 @@ DECL_BIT(HuffmanNode, LTerm, 7);
 
 static void _unHuffman(struct GBA* gba) {
 	struct ARMCore* cpu = gba->cpu;
+	struct GBADecompressor decompressor;
+	_decompressorInit(&decompressor, gba, cpu->gprs[0], cpu->gprs[1]);
 	uint32_t source = cpu->gprs[0] & 0xFFFFFFFC;
 	uint32_t dest = cpu->gprs[1];
-	uint32_t header = cpu->memory.load32(cpu, source, 0);
+	uint32_t header = _decompressLoad32(&decompressor, source);
 	int remaining = header >> 8;
 	unsigned bits = header & 0xF;
 	if (bits == 0) {
@@ -694,7 +848,7 @@ static void _unHuffman(struct GBA* gba) {
 		return;
 	}
 	// We assume the signature byte (0x20) is correct
-	int treesize = (cpu->memory.load8(cpu, source + 4, 0) << 1) + 1;
+	int treesize = (_decompressLoad8(&decompressor, source + 4) << 1) + 1;
 	int block = 0;
 	uint32_t treeBase = source + 5;
 	source += 5 + treesize;
@@ -703,28 +857,28 @@ static void _unHuffman(struct GBA* gba) {
 	int bitsRemaining;
 	int readBits;
 	int bitsSeen = 0;
-	node = cpu->memory.load8(cpu, nPointer, 0);
+	node = _decompressLoad8(&decompressor, nPointer);
 	while (remaining > 0) {
-		uint32_t bitstream = cpu->memory.load32(cpu, source, 0);
+		uint32_t bitstream = _decompressLoad32(&decompressor, source);
 		source += 4;
 		for (bitsRemaining = 32; bitsRemaining > 0 && remaining > 0; --bitsRemaining, bitstream <<= 1) {
 			uint32_t next = (nPointer & ~1) + HuffmanNodeGetOffset(node) * 2 + 2;
 			if (bitstream & 0x80000000) {
 				// Go right
 				if (HuffmanNodeIsRTerm(node)) {
-					readBits = cpu->memory.load8(cpu, next + 1, 0);
+					readBits = _decompressLoad8(&decompressor, next + 1);
 				} else {
 					nPointer = next + 1;
-					node = cpu->memory.load8(cpu, nPointer, 0);
+					node = _decompressLoad8(&decompressor, nPointer);
 					continue;
 				}
 			} else {
 				// Go left
 				if (HuffmanNodeIsLTerm(node)) {
-					readBits = cpu->memory.load8(cpu, next, 0);
+					readBits = _decompressLoad8(&decompressor, next);
 				} else {
 					nPointer = next;
-					node = cpu->memory.load8(cpu, nPointer, 0);
+					node = _decompressLoad8(&decompressor, nPointer);
 					continue;
 				}
 			}
@@ -732,10 +886,10 @@ static void _unHuffman(struct GBA* gba) {
 			block |= (readBits & ((1 << bits) - 1)) << bitsSeen;
 			bitsSeen += bits;
 			nPointer = treeBase;
-			node = cpu->memory.load8(cpu, nPointer, 0);
+			node = _decompressLoad8(&decompressor, nPointer);
 			if (bitsSeen == 32) {
 				bitsSeen = 0;
-				cpu->memory.store32(cpu, dest, block, 0);
+				_decompressStore32(&decompressor, dest, block);
 				dest += 4;
 				remaining -= 4;
 				block = 0;
@@ -748,8 +902,10 @@ static void _unHuffman(struct GBA* gba) {
 
 static void _unRl(struct GBA* gba, int width) {
 	struct ARMCore* cpu = gba->cpu;
+	struct GBADecompressor decompressor;
+	_decompressorInit(&decompressor, gba, cpu->gprs[0], cpu->gprs[1]);
 	uint32_t source = cpu->gprs[0];
-	int remaining = (cpu->memory.load32(cpu, source & 0xFFFFFFFC, 0) & 0xFFFFFF00) >> 8;
+	int remaining = (_decompressLoad32(&decompressor, source & 0xFFFFFFFC) & 0xFFFFFF00) >> 8;
 	int padding = (4 - remaining) & 0x3;
 	// We assume the signature byte (0x30) is correct
 	int blockheader;
@@ -758,25 +914,25 @@ static void _unRl(struct GBA* gba, int width) {
 	uint32_t dest = cpu->gprs[1];
 	int halfword = 0;
 	while (remaining > 0) {
-		blockheader = cpu->memory.load8(cpu, source, 0);
+		blockheader = _decompressLoad8(&decompressor, source);
 		++source;
 		if (blockheader & 0x80) {
 			// Compressed
 			blockheader &= 0x7F;
 			blockheader += 3;
-			block = cpu->memory.load8(cpu, source, 0);
+			block = _decompressLoad8(&decompressor, source);
 			++source;
 			while (blockheader-- && remaining) {
 				--remaining;
 				if (width == 2) {
 					if (dest & 1) {
 						halfword |= block << 8;
-						cpu->memory.store16(cpu, dest ^ 1, halfword, 0);
+						_decompressStore16(&decompressor, dest ^ 1, halfword);
 					} else {
 						halfword = block;
 					}
 				} else {
-					cpu->memory.store8(cpu, dest, block, 0);
+					_decompressStore8(&decompressor, dest, block);
 				}
 				++dest;
 			}
@@ -785,17 +941,17 @@ static void _unRl(struct GBA* gba, int width) {
 			blockheader++;
 			while (blockheader-- && remaining) {
 				--remaining;
-				int byte = cpu->memory.load8(cpu, source, 0);
+				int byte = _decompressLoad8(&decompressor, source);
 				++source;
 				if (width == 2) {
 					if (dest & 1) {
 						halfword |= byte << 8;
-						cpu->memory.store16(cpu, dest ^ 1, halfword, 0);
+						_decompressStore16(&decompressor, dest ^ 1, halfword);
 					} else {
 						halfword = byte;
 					}
 				} else {
-					cpu->memory.store8(cpu, dest, byte, 0);
+					_decompressStore8(&decompressor, dest, byte);
 				}
 				++dest;
 			}
@@ -807,11 +963,11 @@ static void _unRl(struct GBA* gba, int width) {
 			++dest;
 		}
 		for (; padding > 0; padding -= 2, dest += 2) {
-			cpu->memory.store16(cpu, dest, 0, 0);
+			_decompressStore16(&decompressor, dest, 0);
 		}
 	} else {
 		while (padding--) {
-			cpu->memory.store8(cpu, dest, 0, 0);
+			_decompressStore8(&decompressor, dest, 0);
 			++dest;
 		}
 	}
@@ -821,9 +977,11 @@ static void _unRl(struct GBA* gba, int width) {
 
 static void _unFilter(struct GBA* gba, int inwidth, int outwidth) {
 	struct ARMCore* cpu = gba->cpu;
+	struct GBADecompressor decompressor;
+	_decompressorInit(&decompressor, gba, cpu->gprs[0], cpu->gprs[1]);
 	uint32_t source = cpu->gprs[0] & 0xFFFFFFFC;
 	uint32_t dest = cpu->gprs[1];
-	uint32_t header = cpu->memory.load32(cpu, source, 0);
+	uint32_t header = _decompressLoad32(&decompressor, source);
 	int remaining = header >> 8;
 	// We assume the signature nybble (0x8) is correct
 	uint16_t halfword = 0;
@@ -832,25 +990,25 @@ static void _unFilter(struct GBA* gba, int inwidth, int outwidth) {
 	while (remaining > 0) {
 		uint16_t new;
 		if (inwidth == 1) {
-			new = cpu->memory.load8(cpu, source, 0);
+			new = _decompressLoad8(&decompressor, source);
 		} else {
-			new = cpu->memory.load16(cpu, source, 0);
+			new = _decompressLoad16(&decompressor, source);
 		}
 		new += old;
 		if (outwidth > inwidth) {
 			halfword >>= 8;
 			halfword |= (new << 8);
 			if (source & 1) {
-				cpu->memory.store16(cpu, dest, halfword, 0);
+				_decompressStore16(&decompressor, dest, halfword);
 				dest += outwidth;
 				remaining -= outwidth;
 			}
 		} else if (outwidth == 1) {
-			cpu->memory.store8(cpu, dest, new, 0);
+			_decompressStore8(&decompressor, dest, new);
 			dest += outwidth;
 			remaining -= outwidth;
 		} else {
-			cpu->memory.store16(cpu, dest, new, 0);
+			_decompressStore16(&decompressor, dest, new);
 			dest += outwidth;
 			remaining -= outwidth;
 		}
@@ -921,3 +1079,144 @@ static void _unBitPack(struct GBA* gba) {
 	cpu->gprs[0] = source;
 	cpu->gprs[1] = dest;
 }
+
+static uint8_t* _bulkSpan(struct GBAMemoryPage* page, uint32_t address, uint32_t length) {
+	uint32_t offset = address & page->mask;
+	if (!page->size || offset + length > page->size) {
+		return NULL;
+	}
+	return &page->data[offset];
+}
+
+static bool _bulkSetAllowed(struct GBA* gba, uint32_t source, uint32_t dest, uint32_t length, bool word, bool fill, uint8_t** sourceSpan, uint8_t** destSpan) {
+	struct ARMCore* cpu = gba->cpu;
+	struct GBAMemory* memory = &gba->memory;
+	if (!length || ((source | dest) & (word ? 3 : 1))) {
+		return false;
+	}
+	// Memory shims, e.g. debugger watchpoints, need to see every access
+	if (word ? cpu->memory.load32 != GBALoad32 || cpu->memory.store32 != GBAStore32 : cpu->memory.load16 != GBALoad16 || cpu->memory.store16 != GBAStore16) {
+		return false;
+	}
+	*destSpan = _bulkSpan(&memory->storePages[dest >> BASE_OFFSET], dest, length);
+	if (!*destSpan) {
+		return false;
+	}
+	if (fill) {
+		return true;
+	}
+	*sourceSpan = _bulkSpan(&memory->loadPages[source >> BASE_OFFSET], source, length);
+	if (!*sourceSpan) {
+		return false;
+	}
+	// A forward copy onto a later overlapping range repeats data, which memmove wouldn't
+	return !(*destSpan > *sourceSpan && *destSpan < *sourceSpan + length);
+}
+
+static void _bulkFill(uint8_t* dest, uint32_t value, uint32_t length, bool word) {
+	if (!word) {
+		value = (value & 0xFFFF) | (value << 16);
+	}
+	if ((value & 0xFF) * 0x01010101U == value) {
+		memset(dest, value & 0xFF, length);
+		return;
+	}
+	uint32_t i;
+	for (i = 0; i + 4 <= length; i += 4) {
+		STORE_32(value, i, dest);
+	}
+	if (i < length) {
+		STORE_16(value, i, dest);
+	}
+}
+
+// These mirror the register results of the built-in BIOS so that taking the slow path when the
+// buffers aren't in directly mapped memory doesn't change behavior. The cycle counts follow its loops.
+static bool _CpuSet(struct GBA* gba) {
+	struct ARMCore* cpu = gba->cpu;
+	struct GBAMemory* memory = &gba->memory;
+	uint32_t source = cpu->gprs[0];
+	uint32_t dest = cpu->gprs[1];
+	bool word = cpu->gprs[2] & 0x04000000;
+	bool fill = cpu->gprs[2] & 0x01000000;
+	uint32_t units = cpu->gprs[2] & 0x000FFFFF;
+	uint32_t length = units * (word ? 4 : 2);
+	uint8_t* sourceSpan = NULL;
+	uint8_t* destSpan = NULL;
+	if (!_bulkSetAllowed(gba, source, dest, length, word, fill, &sourceSpan, &destSpan)) {
+		return false;
+	}
+
+	int sourceRegion = source >> BASE_OFFSET;
+	int destRegion = dest >> BASE_OFFSET;
+	int cycles = 16;
+	if (fill) {
+		uint32_t value;
+		if (word) {
+			value = cpu->memory.load32(cpu, source, &cycles);
+			cpu->gprs[0] = source + 4;
+			cycles += 3 + memory->waitstatesNonseq32[destRegion];
+		} else {
+			value = (uint16_t) cpu->memory.load16(cpu, source, &cycles);
+			cycles += 1 + memory->waitstatesNonseq16[destRegion];
+		}
+		_bulkFill(destSpan, value, length, word);
+		cpu->gprs[2] = value;
+		cycles += units * (6 + (word ? memory->waitstatesNonseq32[destRegion] : memory->waitstatesNonseq16[destRegion]));
+	} else {
+		memmove(destSpan, sourceSpan, length);
+		if (word) {
+			LOAD_32(cpu->gprs[2], length - 4, destSpan);
+			cycles += units * (9 + memory->waitstatesNonseq32[sourceRegion] + memory->waitstatesNonseq32[destRegion]);
+		} else {
+			uint16_t value;
+			LOAD_16(value, length - 2, destSpan);
+			cpu->gprs[2] = value;
+			cycles += units * (9 + memory->waitstatesNonseq16[sourceRegion] + memory->waitstatesNonseq16[destRegion]);
+		}
+		cpu->gprs[0] = source + length;
+	}
+	mCoreMemoryDirtyMarkRange(&memory->dirtyPages[destRegion], dest & memory->storePages[destRegion].mask, length);
+	cpu->gprs[1] = dest + length;
+	cpu->gprs[3] = dest + length;
+	cpu->cycles += cycles;
+	return true;
+}
+
+static bool _CpuFastSet(struct GBA* gba) {
+	struct ARMCore* cpu = gba->cpu;
+	struct GBAMemory* memory = &gba->memory;
+	uint32_t source = cpu->gprs[0];
+	uint32_t dest = cpu->gprs[1];
+	bool fill = cpu->gprs[2] & 0x01000000;
+	uint32_t end = dest + (cpu->gprs[2] & 0x000FFFFF) * 4;
+	// The built-in BIOS always transfers whole blocks of eight words
+	uint32_t blocks = ((cpu->gprs[2] & 0x000FFFFF) + 7) >> 3;
+	uint32_t length = blocks * 32;
+	uint8_t* sourceSpan = NULL;
+	uint8_t* destSpan = NULL;
+	if (!_bulkSetAllowed(gba, source, dest, length, true, fill, &sourceSpan, &destSpan)) {
+		return false;
+	}
+
+	int sourceRegion = source >> BASE_OFFSET;
+	int destRegion = dest >> BASE_OFFSET;
+	int cycles = 30;
+	if (fill) {
+		uint32_t value = cpu->memory.load32(cpu, source, &cycles);
+		_bulkFill(destSpan, value, length, true);
+		cpu->gprs[3] = value;
+		cycles += 10 + blocks * (13 + memory->waitstatesNonseq32[destRegion] + 7 * memory->waitstatesSeq32[destRegion]);
+	} else {
+		memmove(destSpan, sourceSpan, length);
+		LOAD_32(cpu->gprs[3], length - 32, destSpan);
+		cpu->gprs[0] = source + length;
+		cycles += blocks * (23 + memory->waitstatesNonseq32[sourceRegion] + 7 * memory->waitstatesSeq32[sourceRegion] +
+		                    memory->waitstatesNonseq32[destRegion] + 7 * memory->waitstatesSeq32[destRegion]);
+	}
+	mCoreMemoryDirtyMarkRange(&memory->dirtyPages[destRegion], dest & memory->storePages[destRegion].mask, length);
+	cpu->gprs[1] = dest + length;
+	cpu->gprs[2] = end;
+	cpu->cycles += cycles;
+	return true;
+}
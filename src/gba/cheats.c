@@ -63,6 +63,27 @@ static void _unpatchROM(struct mCheatDevice* device, struct GBACheatSet* cheats)
 	}
 }
 
+static void _updateRegions(struct mCheatDevice* device) {
+	struct GBA* gba = device->p->board;
+	device->regions[0] = (struct mCheatMemoryRegion) {
+		.start = BASE_WORKING_RAM,
+		.end = BASE_WORKING_IRAM,
+		.mask = SIZE_WORKING_RAM - 1,
+		.size = SIZE_WORKING_RAM,
+		.memory = (uint8_t*) gba->memory.wram,
+		.dirty = &gba->memory.dirtyPages[REGION_WORKING_RAM]
+	};
+	device->regions[1] = (struct mCheatMemoryRegion) {
+		.start = BASE_WORKING_IRAM,
+		.end = BASE_IO,
+		.mask = SIZE_WORKING_IRAM - 1,
+		.size = SIZE_WORKING_IRAM,
+		.memory = (uint8_t*) gba->memory.iwram,
+		.dirty = &gba->memory.dirtyPages[REGION_WORKING_IRAM]
+	};
+	device->nRegions = 2;
+}
+
 static void GBACheatSetDeinit(struct mCheatSet* set);
 static void GBACheatAddSet(struct mCheatSet* cheats, struct mCheatDevice* device);
 static void GBACheatRemoveSet(struct mCheatSet* cheats, struct mCheatDevice* device);
@@ -108,6 +129,7 @@ struct mCheatDevice* GBACheatDeviceCreate(void) {
 	struct mCheatDevice* device = malloc(sizeof(*device));
 	mCheatDeviceCreate(device);
 	device->createSet = GBACheatSetCreate;
+	device->updateRegions = _updateRegions;
 	return device;
 }
 
@@ -7,6 +7,8 @@
 
 #include <mgba/core/core.h>
 #include <mgba/core/log.h>
+#include <mgba/core/serialize.h>
+#include <mgba/core/version.h>
 #include <mgba/internal/arm/debugger/debugger.h>
 #include <mgba/internal/debugger/symbols.h>
 #include <mgba/internal/gba/cheats.h>
@@ -21,13 +23,16 @@
 #ifdef BUILD_GLES2
 #include <mgba/internal/gba/renderers/gl.h>
 #endif
+#include <mgba/internal/gba/renderers/parallel.h>
 #include <mgba/internal/gba/renderers/proxy.h>
 #include <mgba/internal/gba/renderers/video-software.h>
+#include <mgba/internal/gba/rr/rr.h>
 #include <mgba/internal/gba/savedata.h>
 #include <mgba/internal/gba/serialize.h>
 #ifdef USE_ELF
 #include <mgba-util/elf-read.h>
 #endif
+#include <mgba-util/crc32.h>
 #include <mgba-util/memory.h>
 #include <mgba-util/patch.h>
 #include <mgba-util/vfs.h>
@@ -134,6 +139,9 @@ struct GBACore {
 	struct GBAVideoGLRenderer glRenderer;
 #endif
 	struct GBAVideoProxyRenderer proxyRenderer;
+#ifndef DISABLE_THREADING
+	struct GBAVideoParallelRenderer parallelRenderer;
+#endif
 	struct mVideoLogContext* logContext;
 	struct mCoreCallbacks logCallbacks;
 #ifndef DISABLE_THREADING
@@ -142,9 +150,13 @@ struct GBACore {
 	int keys;
 	struct mCPUComponent* components[CPU_COMPONENT_MAX];
 	const struct Configuration* overrides;
+	struct Configuration overrideDatabase;
+	char* overrideDatabasePath;
 	struct mDebuggerPlatform* debuggerPlatform;
 	struct mCheatDevice* cheatDevice;
 	struct GBAAudioMixer* audioMixer;
+	// Set while booting through the BIOS, until the game is running and its state can be cached
+	bool bootStatePending;
 };
 
 static bool _GBACoreInit(struct mCore* core) {
@@ -164,10 +176,13 @@ static bool _GBACoreInit(struct mCore* core) {
 	core->symbolTable = NULL;
 	core->videoLogger = NULL;
 	gbacore->overrides = NULL;
+	ConfigurationInit(&gbacore->overrideDatabase);
+	gbacore->overrideDatabasePath = NULL;
 	gbacore->debuggerPlatform = NULL;
 	gbacore->cheatDevice = NULL;
 	gbacore->logContext = NULL;
 	gbacore->audioMixer = NULL;
+	gbacore->bootStatePending = false;
 
 	GBACreate(gba);
 	// TODO: Restore cheats
@@ -200,7 +215,25 @@ static bool _GBACoreInit(struct mCore* core) {
 	return true;
 }
 
+static void _GBACoreRecordIdleLoop(struct mCore* core) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	struct GBA* gba = core->board;
+	const struct GBACartridge* cart = (const struct GBACartridge*) gba->memory.rom;
+	if (!gba->idleLoopDetected || !gbacore->overrideDatabasePath || !cart) {
+		return;
+	}
+	struct GBACartridgeOverride override;
+	memcpy(override.id, &cart->id, sizeof(override.id));
+	override.idleLoop = gba->idleLoop;
+	GBAOverrideSaveIdleLoop(&gbacore->overrideDatabase, &override);
+	if (!ConfigurationWrite(&gbacore->overrideDatabase, gbacore->overrideDatabasePath)) {
+		mLOG(GBA, WARN, "Could not write override database %s", gbacore->overrideDatabasePath);
+	}
+	gba->idleLoopDetected = false;
+}
+
 static void _GBACoreDeinit(struct mCore* core) {
+	_GBACoreRecordIdleLoop(core);
 	ARMDeinit(core->cpu);
 	GBADestroy(core->board);
 	mappedMemoryFree(core->cpu, sizeof(struct ARMCore));
@@ -216,6 +249,8 @@ static void _GBACoreDeinit(struct mCore* core) {
 	}
 	free(gbacore->cheatDevice);
 	free(gbacore->audioMixer);
+	ConfigurationDeinit(&gbacore->overrideDatabase);
+	free(gbacore->overrideDatabasePath);
 	mCoreConfigFreeOpts(&core->opts);
 	free(core);
 }
@@ -241,6 +276,7 @@ static bool _GBACoreSupportsFeature(const struct mCore* core, enum mCoreFeature
 
 static void _GBACoreSetSync(struct mCore* core, struct mCoreSync* sync) {
 	struct GBA* gba = core->board;
+	GBAAudioFinishSynthesis(&gba->audio);
 	gba->sync = sync;
 }
 
@@ -251,11 +287,27 @@ static void _GBACoreLoadConfig(struct mCore* core, const struct mCoreConfig* con
 	} else {
 		gba->audio.masterVolume = core->opts.volume;
 	}
+	gba->audio.skipSynthesis = core->opts.skipAudio;
+	gba->audio.psg.skipSynthesis = core->opts.skipAudio;
 	gba->video.frameskip = core->opts.frameskip;
 
 #if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
 	struct GBACore* gbacore = (struct GBACore*) core;
 	gbacore->overrides = mCoreConfigGetOverridesConst(config);
+
+	const char* overrideDatabase = mCoreConfigGetValue(config, "gba.overrideDatabase");
+	if (!overrideDatabase || !gbacore->overrideDatabasePath || strcmp(overrideDatabase, gbacore->overrideDatabasePath) != 0) {
+		_GBACoreRecordIdleLoop(core);
+		ConfigurationDeinit(&gbacore->overrideDatabase);
+		ConfigurationInit(&gbacore->overrideDatabase);
+		free(gbacore->overrideDatabasePath);
+		gbacore->overrideDatabasePath = NULL;
+		// A missing file just starts out empty, since detected idle loops get written back to it
+		if (overrideDatabase) {
+			ConfigurationRead(&gbacore->overrideDatabase, overrideDatabase);
+			gbacore->overrideDatabasePath = strdup(overrideDatabase);
+		}
+	}
 #endif
 
 	const char* idleOptimization = mCoreConfigGetValue(config, "idleOptimization");
@@ -277,23 +329,39 @@ static void _GBACoreLoadConfig(struct mCore* core, const struct mCoreConfig* con
 	mCoreConfigGetIntValue(config, "allowOpposingDirections", &fakeBool);
 	gba->allowOpposingDirections = fakeBool;
 
+	if (mCoreConfigGetIntValue(config, "gba.blockCache", &fakeBool)) {
+		ARMSetBlockCache(core->cpu, fakeBool);
+	}
+
+	if (mCoreConfigGetIntValue(config, "gba.audioFastSynthesis", &fakeBool)) {
+		gba->audio.fastSynthesis = fakeBool;
+	}
+
+	if (mCoreConfigGetIntValue(config, "gba.audioThreadedSynthesis", &fakeBool)) {
+		GBAAudioSetThreadedSynthesis(&gba->audio, fakeBool);
+	}
+
 	mCoreConfigCopyValue(&core->config, config, "allowOpposingDirections");
 	mCoreConfigCopyValue(&core->config, config, "gba.bios");
 	mCoreConfigCopyValue(&core->config, config, "gba.audioHle");
 
 #ifndef DISABLE_THREADING
 	mCoreConfigCopyValue(&core->config, config, "threadedVideo");
+	mCoreConfigCopyValue(&core->config, config, "videoThreads");
 #endif
 	mCoreConfigCopyValue(&core->config, config, "hwaccelVideo");
 	mCoreConfigCopyValue(&core->config, config, "videoScale");
+	mCoreConfigCopyValue(&core->config, config, "videoReadbackLatency");
 }
 
 static void _GBACoreDesiredVideoDimensions(struct mCore* core, unsigned* width, unsigned* height) {
+	int scale = 1;
 #ifdef BUILD_GLES2
 	struct GBACore* gbacore = (struct GBACore*) core;
-	int scale = gbacore->glRenderer.scale;
-#else
-	int scale = 1;
+	// Once the texture is gone the software renderer is drawing again, whatever the GL one was scaled to
+	if (gbacore->glRenderer.outputTex != (unsigned) -1) {
+		scale = gbacore->glRenderer.scale;
+	}
 #endif
 
 	*width = GBA_VIDEO_HORIZONTAL_PIXELS * scale;
@@ -307,6 +375,44 @@ static void _GBACoreSetVideoBuffer(struct mCore* core, color_t* buffer, size_t s
 	memset(gbacore->renderer.scanlineDirty, 0xFFFFFFFF, sizeof(gbacore->renderer.scanlineDirty));
 }
 
+static bool _GBACoreSetVideoBufferFormat(struct mCore* core, enum mColorFormat format) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	bool tiled = format & mCOLOR_TILED_4X4;
+	switch (format & ~mCOLOR_TILED_4X4) {
+	case mCOLOR_NATIVE:
+		gbacore->renderer.outputRGB565 = false;
+		break;
+#ifndef COLOR_16_BIT
+	case mCOLOR_RGB565:
+		if (tiled) {
+			return false;
+		}
+		gbacore->renderer.outputRGB565 = true;
+		break;
+#endif
+	default:
+		return false;
+	}
+	gbacore->renderer.outputTiled = tiled;
+	memset(gbacore->renderer.scanlineDirty, 0xFFFFFFFF, sizeof(gbacore->renderer.scanlineDirty));
+	return true;
+}
+
+static enum mColorFormat _GBACoreVideoBufferFormat(const struct mCore* core) {
+	const struct GBACore* gbacore = (const struct GBACore*) core;
+#ifdef BUILD_GLES2
+	const struct GBA* gba = core->board;
+	if (gba->video.renderer == &gbacore->glRenderer.d) {
+		// Frames are read back from the GL renderer as they are
+		return mCOLOR_NATIVE;
+	}
+#endif
+	if (gbacore->renderer.outputTiled) {
+		return mCOLOR_NATIVE | mCOLOR_TILED_4X4;
+	}
+	return gbacore->renderer.outputRGB565 ? mCOLOR_RGB565 : mCOLOR_NATIVE;
+}
+
 static void _GBACoreSetVideoGLTex(struct mCore* core, unsigned texid) {
 #ifdef BUILD_GLES2
 	struct GBACore* gbacore = (struct GBACore*) core;
@@ -369,6 +475,41 @@ static void _GBACoreSetAVStream(struct mCore* core, struct mAVStream* stream) {
 	}
 }
 
+static void _GBACoreSetOutputSuppressed(struct mCore* core, bool video, bool audio) {
+	struct GBA* gba = core->board;
+	if (video != gba->video.suppressOutput) {
+		GBAVideoSyncHblank(&gba->video);
+		gba->video.suppressOutput = video;
+		gba->video.frameskipCounter = video;
+	}
+	gba->audio.suppressOutput = audio;
+}
+
+static bool _GBACoreSetPerfCounters(struct mCore* core, struct mPerfCounters* counters) {
+#ifdef ENABLE_PERF_COUNTERS
+	struct GBA* gba = core->board;
+	gba->cpu->perfCounters = counters;
+	gba->timing.perfCounters = counters;
+	return true;
+#else
+	UNUSED(core);
+	UNUSED(counters);
+	return false;
+#endif
+}
+
+static bool _GBACoreSetMemoryHeatmap(struct mCore* core, struct mMemoryHeatmap* heatmap) {
+#ifdef ENABLE_PERF_COUNTERS
+	struct GBA* gba = core->board;
+	gba->cpu->heatmap = heatmap;
+	return true;
+#else
+	UNUSED(core);
+	UNUSED(heatmap);
+	return false;
+#endif
+}
+
 static bool _GBACoreLoadROM(struct mCore* core, struct VFile* vf) {
 #ifdef USE_ELF
 	struct ELF* elf = ELFOpen(vf);
@@ -425,19 +566,122 @@ static void _GBACoreUnloadROM(struct mCore* core) {
 		mCheatDeviceDestroy(gbacore->cheatDevice);
 		gbacore->cheatDevice = NULL;
 	}
+	_GBACoreRecordIdleLoop(core);
 	return GBAUnloadROM(core->board);
 }
 
 static void _GBACoreChecksum(const struct mCore* core, void* data, enum mCoreChecksumType type) {
 	struct GBA* gba = (struct GBA*) core->board;
 	switch (type) {
-	case CHECKSUM_CRC32:
-		memcpy(data, &gba->romCrc32, sizeof(gba->romCrc32));
+	case CHECKSUM_CRC32: {
+		uint32_t crc32 = GBAGetROMCrc32(gba);
+		memcpy(data, &crc32, sizeof(crc32));
 		break;
 	}
+	}
 	return;
 }
 
+static struct GBAVideoRenderer* _GBACoreSoftwareRenderer(struct mCore* core) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+#ifndef DISABLE_THREADING
+	int threads;
+	if (mCoreConfigGetIntValue(&core->config, "videoThreads", &threads) && threads > 1) {
+		GBAVideoParallelRendererCreate(&gbacore->parallelRenderer, &gbacore->renderer, threads);
+		return &gbacore->parallelRenderer.d;
+	}
+#endif
+	return &gbacore->renderer.d;
+}
+
+static struct GBAVideoRenderer* _GBACoreSelectRenderer(struct mCore* core) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	struct GBAVideoRenderer* renderer = NULL;
+	if (gbacore->renderer.outputBuffer) {
+		renderer = _GBACoreSoftwareRenderer(core);
+	}
+#ifdef BUILD_GLES2
+	int fakeBool;
+	if (gbacore->glRenderer.outputTex != (unsigned) -1 && mCoreConfigGetIntValue(&core->config, "hwaccelVideo", &fakeBool) && fakeBool) {
+		renderer = &gbacore->glRenderer.d;
+		mCoreConfigGetIntValue(&core->config, "videoScale", &gbacore->glRenderer.scale);
+		if (mCoreConfigGetIntValue(&core->config, "videoReadbackLatency", &fakeBool)) {
+			gbacore->glRenderer.readbackLatency = fakeBool;
+		}
+	}
+#endif
+	return renderer;
+}
+
+static void _GBACoreMarkMemoryDirty(struct GBA* gba) {
+	size_t i;
+	for (i = 0; i < sizeof(gba->memory.dirtyPages) / sizeof(*gba->memory.dirtyPages); ++i) {
+		mCoreMemoryDirtyMarkAll(&gba->memory.dirtyPages[i]);
+	}
+}
+
+#if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
+static bool _GBACoreBootStatePath(struct mCore* core, char* path, size_t size) {
+	struct GBA* gba = core->board;
+	const char* cacheDir = mCoreConfigGetValue(&core->config, "gba.bootStateCache");
+	if (!cacheDir || !cacheDir[0] || core->opts.skipBios || !gba->memory.fullBios || !gba->memory.rom) {
+		return false;
+	}
+	if (gba->rr && (gba->rr->isPlaying(gba->rr) || gba->rr->isRecording(gba->rr))) {
+		return false;
+	}
+	// The state is cached a little after the game starts, so it depends on the whole ROM. It's also only
+	// trusted from the build that made it, since emulation changes don't always change the state format.
+	uint32_t build = doCrc32(gitCommit, strlen(gitCommit));
+	snprintf(path, size, "%s" PATH_SEP "%08X-%08X-%08X.ss0", cacheDir, gba->biosChecksum, GBAGetROMCrc32(gba), build);
+	return true;
+}
+
+static void _GBACoreLoadBootState(struct mCore* core) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	char path[PATH_MAX];
+	if (!_GBACoreBootStatePath(core, path, sizeof(path))) {
+		return;
+	}
+	struct VFile* vf = VFileOpen(path, O_RDONLY);
+	if (vf) {
+		// Save data and the RTC are left as they are, since booting wouldn't have touched them
+		bool loaded = mCoreLoadStateNamed(core, vf, 0);
+		vf->close(vf);
+		if (loaded) {
+			return;
+		}
+		mLOG(GBA, WARN, "Could not load cached boot state %s", path);
+	}
+	gbacore->bootStatePending = true;
+}
+
+static void _GBACoreSaveBootState(struct mCore* core) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	struct GBA* gba = core->board;
+	if (gba->cpu->gprs[ARM_PC] < SIZE_BIOS) {
+		return;
+	}
+	gbacore->bootStatePending = false;
+	char path[PATH_MAX];
+	if (!_GBACoreBootStatePath(core, path, sizeof(path))) {
+		return;
+	}
+	// Written under another name first, so that another instance never loads a partial state
+	char tmpPath[PATH_MAX + 32];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp%p", path, (void*) core);
+	struct VFile* vf = VFileOpen(tmpPath, O_CREAT | O_TRUNC | O_RDWR);
+	if (!vf) {
+		return;
+	}
+	bool saved = mCoreSaveStateNamed(core, vf, 0);
+	vf->close(vf);
+	if (!saved || rename(tmpPath, path) != 0) {
+		remove(tmpPath);
+	}
+}
+#endif
+
 static void _GBACoreReset(struct mCore* core) {
 	struct GBACore* gbacore = (struct GBACore*) core;
 	struct GBA* gba = (struct GBA*) core->board;
@@ -446,29 +690,26 @@ static void _GBACoreReset(struct mCore* core) {
 	    || gbacore->glRenderer.outputTex != (unsigned) -1
 #endif
 	) {
-		struct GBAVideoRenderer* renderer;
-		if (gbacore->renderer.outputBuffer) {
-			renderer = &gbacore->renderer.d;
-		}
-		int fakeBool;
-#ifdef BUILD_GLES2
-		if (gbacore->glRenderer.outputTex != (unsigned) -1 && mCoreConfigGetIntValue(&core->config, "hwaccelVideo", &fakeBool) && fakeBool) {
-			renderer = &gbacore->glRenderer.d;
-			mCoreConfigGetIntValue(&core->config, "videoScale", &gbacore->glRenderer.scale);
-		}
-#endif
+		struct GBAVideoRenderer* renderer = _GBACoreSelectRenderer(core);
 #ifndef DISABLE_THREADING
+		int fakeBool;
 		if (mCoreConfigGetIntValue(&core->config, "threadedVideo", &fakeBool) && fakeBool) {
 			if (!core->videoLogger) {
 				core->videoLogger = &gbacore->threadProxy.d;
 			}
+			mCoreConfigGetCPUMaskValue(&core->config, "renderThreadAffinity", &gbacore->threadProxy.affinity);
+			if (mCoreConfigGetIntValue(&core->config, "threadHighPriority", &fakeBool)) {
+				gbacore->threadProxy.highPriority = fakeBool;
+			}
 		}
 #endif
+#ifndef MINIMAL_CORE
 		if (core->videoLogger) {
 			gbacore->proxyRenderer.logger = core->videoLogger;
 			GBAVideoProxyRendererCreate(&gbacore->proxyRenderer, renderer);
 			renderer = &gbacore->proxyRenderer.d;
 		}
+#endif
 		GBAVideoAssociateRenderer(&gba->video, renderer);
 	}
 
@@ -482,7 +723,7 @@ static void _GBACoreReset(struct mCore* core) {
 	}
 #endif
 
-	GBAOverrideApplyDefaults(gba, gbacore->overrides);
+	GBAOverrideApplyDefaults(gba, &gbacore->overrideDatabase, gbacore->overrides);
 
 #if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
 	if (!gba->biosVf && core->opts.useBios) {
@@ -531,6 +772,11 @@ static void _GBACoreReset(struct mCore* core) {
 	if (core->opts.skipBios && (gba->romVf || gba->memory.rom)) {
 		GBASkipBIOS(core->board);
 	}
+	gbacore->bootStatePending = false;
+#if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
+	_GBACoreLoadBootState(core);
+#endif
+	_GBACoreMarkMemoryDirty(gba);
 }
 
 static void _GBACoreRunFrame(struct mCore* core) {
@@ -539,10 +785,22 @@ static void _GBACoreRunFrame(struct mCore* core) {
 	while (gba->video.frameCounter == frameCounter) {
 		ARMRunLoop(core->cpu);
 	}
+#if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
+	struct GBACore* gbacore = (struct GBACore*) core;
+	if (gbacore->bootStatePending) {
+		_GBACoreSaveBootState(core);
+	}
+#endif
 }
 
 static void _GBACoreRunLoop(struct mCore* core) {
 	ARMRunLoop(core->cpu);
+#if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
+	struct GBACore* gbacore = (struct GBACore*) core;
+	if (gbacore->bootStatePending) {
+		_GBACoreSaveBootState(core);
+	}
+#endif
 }
 
 static void _GBACoreStep(struct mCore* core) {
@@ -555,7 +813,15 @@ static size_t _GBACoreStateSize(struct mCore* core) {
 }
 
 static bool _GBACoreLoadState(struct mCore* core, const void* state) {
-	return GBADeserialize(core->board, state);
+	if (!GBADeserialize(core->board, state)) {
+		return false;
+	}
+	// Whatever was loaded isn't a boot any more
+	((struct GBACore*) core)->bootStatePending = false;
+	// RAM, VRAM, OAM and palette mark their own changed pages while being restored
+	struct GBA* gba = core->board;
+	mCoreMemoryDirtyMarkAll(&gba->memory.dirtyPages[REGION_CART_SRAM]);
+	return true;
 }
 
 static bool _GBACoreSaveState(struct mCore* core, void* state) {
@@ -580,6 +846,11 @@ static void _GBACoreClearKeys(struct mCore* core, uint32_t keys) {
 	gbacore->keys &= ~keys;
 }
 
+static uint32_t _GBACoreGetKeys(struct mCore* core) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	return gbacore->keys;
+}
+
 static int32_t _GBACoreFrameCounter(const struct mCore* core) {
 	const struct GBA* gba = core->board;
 	return gba->video.frameCounter;
@@ -752,6 +1023,60 @@ void* _GBAGetMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
 	}
 }
 
+static struct mCoreMemoryDirty* _GBAMemoryBlockDirty(struct GBA* gba, size_t id) {
+	switch (id) {
+	case REGION_WORKING_RAM:
+	case REGION_WORKING_IRAM:
+	case REGION_PALETTE_RAM:
+	case REGION_VRAM:
+	case REGION_OAM:
+		return &gba->memory.dirtyPages[id];
+	case REGION_CART_SRAM:
+		// Flash and EEPROM are written through command sequences and are not tracked
+		if (gba->memory.savedata.type == SAVEDATA_SRAM) {
+			return &gba->memory.dirtyPages[id];
+		}
+		return NULL;
+	default:
+		return NULL;
+	}
+}
+
+static bool _GBATrackMemoryBlockDirty(struct mCore* core, size_t id, bool enable) {
+	struct mCoreMemoryDirty* dirty = _GBAMemoryBlockDirty(core->board, id);
+	if (!dirty) {
+		return false;
+	}
+	if (!enable) {
+		mCoreMemoryDirtyDeinit(dirty);
+	} else if (!dirty->bitmap) {
+		size_t size;
+		_GBAGetMemoryBlock(core, id, &size);
+		mCoreMemoryDirtyInit(dirty, size);
+	}
+	return true;
+}
+
+static const uint32_t* _GBAGetMemoryBlockDirty(struct mCore* core, size_t id, size_t* pagesOut) {
+	struct mCoreMemoryDirty* dirty = _GBAMemoryBlockDirty(core->board, id);
+	if (!dirty || !dirty->bitmap) {
+		return NULL;
+	}
+	*pagesOut = dirty->nPages;
+	return dirty->bitmap;
+}
+
+static void _GBAClearMemoryBlockDirty(struct mCore* core, size_t id) {
+	struct mCoreMemoryDirty* dirty = _GBAMemoryBlockDirty(core->board, id);
+	if (dirty) {
+		mCoreMemoryDirtyClear(dirty);
+	}
+}
+
+static void _GBASetMemoryHook(struct mCore* core, struct mCoreMemoryHook* hook) {
+	GBAMemorySetHook(core->board, hook);
+}
+
 #ifdef USE_DEBUGGERS
 static bool _GBACoreSupportsDebuggerType(struct mCore* core, enum mDebuggerType type) {
 	UNUSED(core);
@@ -877,6 +1202,17 @@ static size_t _GBACoreSavedataClone(struct mCore* core, void** sram) {
 	return size;
 }
 
+static size_t _GBACoreSavedataView(struct mCore* core, const void** sram) {
+	struct GBA* gba = core->board;
+	size_t size = GBASavedataSize(&gba->memory.savedata);
+	if (!size || !gba->memory.savedata.data) {
+		*sram = NULL;
+		return 0;
+	}
+	*sram = gba->memory.savedata.data;
+	return size;
+}
+
 static bool _GBACoreSavedataRestore(struct mCore* core, const void* sram, size_t size, bool writeback) {
 	struct VFile* vf = VFileMemChunk(sram, size);
 	if (!vf) {
@@ -890,6 +1226,7 @@ static bool _GBACoreSavedataRestore(struct mCore* core, const void* sram, size_t
 	} else {
 		GBASavedataMask(&gba->memory.savedata, vf, true);
 	}
+	mCoreMemoryDirtyMarkAll(&gba->memory.dirtyPages[REGION_CART_SRAM]);
 	return success;
 }
 
@@ -1003,6 +1340,7 @@ struct mCore* GBACoreCreate(void) {
 	core->cpu = NULL;
 	core->board = NULL;
 	core->debugger = NULL;
+	core->asyncWriter = NULL;
 	core->init = _GBACoreInit;
 	core->deinit = _GBACoreDeinit;
 	core->platform = _GBACorePlatform;
@@ -1011,6 +1349,8 @@ struct mCore* GBACoreCreate(void) {
 	core->loadConfig = _GBACoreLoadConfig;
 	core->desiredVideoDimensions = _GBACoreDesiredVideoDimensions;
 	core->setVideoBuffer = _GBACoreSetVideoBuffer;
+	core->setVideoBufferFormat = _GBACoreSetVideoBufferFormat;
+	core->videoBufferFormat = _GBACoreVideoBufferFormat;
 	core->setVideoGLTex = _GBACoreSetVideoGLTex;
 	core->getPixels = _GBACoreGetPixels;
 	core->putPixels = _GBACorePutPixels;
@@ -1020,6 +1360,9 @@ struct mCore* GBACoreCreate(void) {
 	core->addCoreCallbacks = _GBACoreAddCoreCallbacks;
 	core->clearCoreCallbacks = _GBACoreClearCoreCallbacks;
 	core->setAVStream = _GBACoreSetAVStream;
+	core->setOutputSuppressed = _GBACoreSetOutputSuppressed;
+	core->setPerfCounters = _GBACoreSetPerfCounters;
+	core->setMemoryHeatmap = _GBACoreSetMemoryHeatmap;
 	core->isROM = GBAIsROM;
 	core->loadROM = _GBACoreLoadROM;
 	core->loadBIOS = _GBACoreLoadBIOS;
@@ -1038,6 +1381,7 @@ struct mCore* GBACoreCreate(void) {
 	core->setKeys = _GBACoreSetKeys;
 	core->addKeys = _GBACoreAddKeys;
 	core->clearKeys = _GBACoreClearKeys;
+	core->getKeys = _GBACoreGetKeys;
 	core->frameCounter = _GBACoreFrameCounter;
 	core->frameCycles = _GBACoreFrameCycles;
 	core->frequency = _GBACoreFrequency;
@@ -1058,6 +1402,10 @@ struct mCore* GBACoreCreate(void) {
 	core->rawWrite32 = _GBACoreRawWrite32;
 	core->listMemoryBlocks = _GBAListMemoryBlocks;
 	core->getMemoryBlock = _GBAGetMemoryBlock;
+	core->trackMemoryBlockDirty = _GBATrackMemoryBlockDirty;
+	core->getMemoryBlockDirty = _GBAGetMemoryBlockDirty;
+	core->clearMemoryBlockDirty = _GBAClearMemoryBlockDirty;
+	core->setMemoryHook = _GBASetMemoryHook;
 #ifdef USE_DEBUGGERS
 	core->supportsDebuggerType = _GBACoreSupportsDebuggerType;
 	core->debuggerPlatform = _GBACoreDebuggerPlatform;
@@ -1069,6 +1417,7 @@ struct mCore* GBACoreCreate(void) {
 #endif
 	core->cheatDevice = _GBACoreCheatDevice;
 	core->savedataClone = _GBACoreSavedataClone;
+	core->savedataView = _GBACoreSavedataView;
 	core->savedataRestore = _GBACoreSavedataRestore;
 	core->listVideoLayers = _GBACoreListVideoLayers;
 	core->listAudioChannels = _GBACoreListAudioChannels;
@@ -1123,9 +1472,11 @@ static void _GBAVLPReset(struct mCore* core) {
 	struct GBA* gba = (struct GBA*) core->board;
 	if (gba->video.renderer == &gbacore->proxyRenderer.d) {
 		GBAVideoProxyRendererUnshim(&gba->video, &gbacore->proxyRenderer);
-	} else if (gbacore->renderer.outputBuffer) {
-		struct GBAVideoRenderer* renderer = &gbacore->renderer.d;
-		GBAVideoAssociateRenderer(&gba->video, renderer);
+	} else {
+		struct GBAVideoRenderer* renderer = _GBACoreSelectRenderer(core);
+		if (renderer) {
+			GBAVideoAssociateRenderer(&gba->video, renderer);
+		}
 	}
 
 	ARMReset(core->cpu);
@@ -1153,7 +1504,7 @@ static bool _GBAVLPLoadROM(struct mCore* core, struct VFile* vf) {
 static bool _GBAVLPLoadState(struct mCore* core, const void* state) {
 	struct GBA* gba = (struct GBA*) core->board;
 
-	gba->timing.root = NULL;
+	mTimingClear(&gba->timing);
 	gba->cpu->gprs[ARM_PC] = BASE_WORKING_RAM;
 	gba->cpu->memory.setActiveRegion(gba->cpu, gba->cpu->gprs[ARM_PC]);
 
@@ -1183,8 +1534,34 @@ struct mCore* GBAVideoLogPlayerCreate(void) {
 	core->isROM = _returnTrue;
 	return core;
 }
+
+bool GBAVideoLogPlayerSeek(struct mCore* core, uint32_t frame) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	struct GBA* gba = core->board;
+	if (core->loadROM != _GBAVLPLoadROM || !gbacore->logContext) {
+		return false;
+	}
+
+	GBAVideoProxyRendererUnshim(&gba->video, &gbacore->proxyRenderer);
+	uint32_t keyframe = mVideoLogContextSeek(gbacore->logContext, core, frame);
+	GBAVideoProxyRendererShim(&gba->video, &gbacore->proxyRenderer);
+
+	// Replay the frames between the keyframe and the target so the renderer catches up
+	for (; keyframe < frame; ++keyframe) {
+		if (!mVideoLoggerRendererRun(gbacore->proxyRenderer.logger, true)) {
+			return false;
+		}
+	}
+	return true;
+}
 #else
 struct mCore* GBAVideoLogPlayerCreate(void) {
 	return false;
 }
+
+bool GBAVideoLogPlayerSeek(struct mCore* core, uint32_t frame) {
+	UNUSED(core);
+	UNUSED(frame);
+	return false;
+}
 #endif
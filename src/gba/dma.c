@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gba/dma.h>
 
+#include <mgba/core/perf-counters.h>
 #include <mgba/internal/gba/gba.h>
 #include <mgba/internal/gba/io.h>
 
@@ -70,6 +71,8 @@ uint16_t GBADMAWriteCNT_HI(struct GBA* gba, int dma, uint16_t control) {
 	struct GBAMemory* memory = &gba->memory;
 	struct GBADMA* currentDma = &memory->dma[dma];
 	int wasEnabled = GBADMARegisterIsEnable(currentDma->reg);
+	// This might start an HBlank DMA during a line that skipped its HBlank event
+	GBAVideoSyncHblank(&gba->video);
 	if (dma < 3) {
 		control &= 0xF7E0;
 	} else {
@@ -224,7 +227,49 @@ void GBADMAUpdate(struct GBA* gba) {
 	}
 }
 
-void GBADMAService(struct GBA* gba, int number, struct GBADMA* info) {
+static bool _isPlainDMARegion(uint32_t region, bool write) {
+	switch (region) {
+	case REGION_WORKING_RAM:
+	case REGION_WORKING_IRAM:
+	case REGION_PALETTE_RAM:
+	case REGION_VRAM:
+	case REGION_OAM:
+		return true;
+	case REGION_CART0:
+	case REGION_CART0_EX:
+	case REGION_CART1:
+	case REGION_CART1_EX:
+	case REGION_CART2:
+		// Cartridge writes may reach GPIO or the Matrix mapper
+		return !write;
+	default:
+		// I/O, SRAM, EEPROM and open bus all have side effects or depend on the DMA state
+		return false;
+	}
+}
+
+static bool _canBatchDMA(struct GBA* gba, int number, struct GBADMA* info) {
+	if (!(info->nextCount & 0xFFFFF)) {
+		return false;
+	}
+	if (!info->nextSource || !_isPlainDMARegion(info->nextSource >> BASE_OFFSET, false) || !_isPlainDMARegion(info->nextDest >> BASE_OFFSET, true)) {
+		return false;
+	}
+	// The next unit must land strictly before anything else that could observe or preempt it
+	int32_t untilNext = mTimingNextEvent(&gba->timing);
+	if ((int32_t) (info->when - mTimingCurrentTime(&gba->timing)) >= untilNext) {
+		return false;
+	}
+	int i;
+	for (i = 0; i < 4; ++i) {
+		if (i != number && GBADMARegisterIsEnable(gba->memory.dma[i].reg) && gba->memory.dma[i].nextCount) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void _GBADMAServiceUnit(struct GBA* gba, int number, struct GBADMA* info) {
 	struct GBAMemory* memory = &gba->memory;
 	struct ARMCore* cpu = gba->cpu;
 	uint32_t width = 2 << GBADMARegisterGetWidth(info->reg);
@@ -252,6 +297,11 @@ void GBADMAService(struct GBA* gba, int number, struct GBADMA* info) {
 		}
 	}
 	info->when += cycles;
+#ifdef ENABLE_PERF_COUNTERS
+	if (cpu->perfCounters) {
+		cpu->perfCounters->dmaCycles += cycles;
+	}
+#endif
 
 	gba->performingDMA = 1 | (number << 1);
 	if (width == 4) {
@@ -300,5 +350,14 @@ void GBADMAService(struct GBA* gba, int number, struct GBADMA* info) {
 			info->when += 2;
 		}
 	}
+}
+
+void GBADMAService(struct GBA* gba, int number, struct GBADMA* info) {
+	// Units that only move plain memory can't be told apart from each other by anything
+	// but another event or DMA, so run as many back to back as fit before one could intervene
+	// rather than rescheduling the event for every single unit
+	do {
+		_GBADMAServiceUnit(gba, number, info);
+	} while (_canBatchDMA(gba, number, info));
 	GBADMAUpdate(gba);
 }
@@ -8,8 +8,61 @@
 #include <mgba/core/blip_buf.h>
 #include <mgba/internal/gba/gba.h>
 #include <mgba/internal/gba/video.h>
+#include <mgba-util/threading.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define MP2K_SIMD_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MP2K_SIMD_NEON
+#endif
 
 #define OVERSAMPLE 2
+#define RENDER_QUEUE_SIZE 8
+#define RENDER_BLOCK 256
+
+// What one track plays over one tick, resolved from the context the last VBlank loaded
+struct GBAMP2kVoice {
+	bool active;
+	bool audible;
+	// Host copy of the instrument samples, or NULL if they have to be read over the bus
+	const int8_t* data;
+	uint32_t dataLimit;
+	uint32_t sampleBase;
+	uint32_t loopOffset;
+	uint32_t endOffset;
+	double freq;
+	int leftVolume;
+	int rightVolume;
+	int envelope;
+};
+
+struct GBAMP2kRenderJob {
+	struct GBAMP2kVoice voices[MP2K_MAX_SOUND_CHANNELS];
+	int32_t interval;
+	size_t length;
+	size_t capacity;
+	struct GBAStereoSample* output;
+};
+
+// Ticks are rendered in the order they are posted, one tick ahead of playback. Jobs between
+// done and tail belong to the render thread, and jobs between read and done are played back.
+struct GBAMP2kRenderQueue {
+	struct GBAMP2kRenderJob jobs[RENDER_QUEUE_SIZE];
+	unsigned tail;
+	unsigned done;
+	unsigned read;
+	size_t readOffset;
+	size_t primed;
+#ifndef DISABLE_THREADING
+	bool running;
+	bool exit;
+	Thread thread;
+	Mutex mutex;
+	Condition cond;
+#endif
+};
 
 static void _mp2kInit(void* cpu, struct mCPUComponent* component);
 static void _mp2kDeinit(struct mCPUComponent* component);
@@ -43,16 +96,40 @@ void _mp2kInit(void* cpu, struct mCPUComponent* component) {
 	size_t i;
 	for (i = 0; i < MP2K_MAX_SOUND_CHANNELS; ++i) {
 		mixer->activeTracks[i].channel = &mixer->context.chans[i];
-		CircleBufferInit(&mixer->activeTracks[i].buffer, 0x10000);
 	}
+	mixer->queue = calloc(1, sizeof(*mixer->queue));
+}
+
+#ifndef DISABLE_THREADING
+static void _stopRenderThread(struct GBAMP2kRenderQueue* queue) {
+	if (!queue->running) {
+		return;
+	}
+	MutexLock(&queue->mutex);
+	queue->exit = true;
+	ConditionWake(&queue->cond);
+	MutexUnlock(&queue->mutex);
+	ThreadJoin(queue->thread);
+	MutexDeinit(&queue->mutex);
+	ConditionDeinit(&queue->cond);
+	queue->running = false;
 }
+#endif
 
 void _mp2kDeinit(struct mCPUComponent* component) {
 	struct GBAAudioMixer* mixer = (struct GBAAudioMixer*) component;
+	if (!mixer->queue) {
+		return;
+	}
+#ifndef DISABLE_THREADING
+	_stopRenderThread(mixer->queue);
+#endif
 	size_t i;
-	for (i = 0; i < MP2K_MAX_SOUND_CHANNELS; ++i) {
-		CircleBufferDeinit(&mixer->activeTracks[i].buffer);
+	for (i = 0; i < RENDER_QUEUE_SIZE; ++i) {
+		free(mixer->queue->jobs[i].output);
 	}
+	free(mixer->queue);
+	mixer->queue = NULL;
 }
 
 static void _loadInstrument(struct ARMCore* cpu, struct GBAMP2kInstrument* instrument, uint32_t base) {
@@ -89,64 +166,305 @@ static void _lookupInstrument(struct ARMCore* cpu, struct GBAMP2kInstrument* ins
 	}
 }
 
-static void _stepSample(struct GBAAudioMixer* mixer, struct GBAMP2kTrack* track) {
+static const int8_t* _hostSamples(struct GBA* gba, uint32_t base, uint32_t loopOffset, uint32_t endOffset, uint32_t* limit) {
+	// Only ROM can't change under the render thread
+	if (base >> BASE_OFFSET < REGION_CART0 || base >> BASE_OFFSET > REGION_CART2_EX || !gba->memory.rom) {
+		return NULL;
+	}
+	uint32_t offset = base & (SIZE_CART0 - 1);
+	if (offset >= gba->memory.romSize || endOffset > gba->memory.romSize - offset || loopOffset >= endOffset) {
+		return NULL;
+	}
+	*limit = gba->memory.romSize - offset;
+	return (const int8_t*) gba->memory.rom + offset;
+}
+
+static bool _snapshotVoice(struct GBAAudioMixer* mixer, struct GBAMP2kTrack* track, struct GBAMP2kVoice* voice) {
 	struct ARMCore* cpu = mixer->p->p->cpu;
 	struct ARMMemory* memory = &cpu->memory;
 	uint32_t headerAddress;
 	struct GBAMP2kInstrument instrument = track->track.instrument;
 
+	voice->active = track->channel->status > 0;
+	voice->audible = false;
+	voice->data = NULL;
+	if (!voice->active) {
+		return true;
+	}
+
 	uint8_t note = track->track.key;
 	_lookupInstrument(cpu, &instrument, note);
-	double freq;
 
 	switch (instrument.type) {
 	case 0x00:
 	case 0x08:
 	case 0x40:
 	case 0x80:
-		freq = GBA_ARM7TDMI_FREQUENCY / (double) track->channel->freq;
+		voice->freq = GBA_ARM7TDMI_FREQUENCY / (double) track->channel->freq;
 		break;
 	default:
 		// We don't care about PSG channels
-		return;
+		return true;
 	}
 	headerAddress = instrument.data.waveData;
 	if (headerAddress < 0x20) {
 		mLOG(GBA_AUDIO, ERROR, "Audio track has invalid instrument");
-		return;
+		return true;
 	}
-	uint32_t loopOffset = memory->load32(cpu, headerAddress + 0x8, 0);
-	uint32_t endOffset = memory->load32(cpu, headerAddress + 0xC, 0);
-	uint32_t sampleBase = headerAddress + 0x10;
+	voice->audible = true;
+	voice->loopOffset = memory->load32(cpu, headerAddress + 0x8, 0);
+	voice->endOffset = memory->load32(cpu, headerAddress + 0xC, 0);
+	voice->sampleBase = headerAddress + 0x10;
+	voice->leftVolume = track->channel->leftVolume;
+	voice->rightVolume = track->channel->rightVolume;
+	voice->envelope = track->channel->envelopeV;
+	voice->data = _hostSamples(mixer->p->p, voice->sampleBase, voice->loopOffset, voice->endOffset, &voice->dataLimit);
+	return voice->data;
+}
+
+static void _resampleVoice(struct GBAAudioMixer* mixer, struct GBAMP2kTrack* track, const struct GBAMP2kVoice* voice, int32_t interval, int16_t* samples, size_t length) {
 	uint32_t sampleI = track->samplePlaying;
 	double sampleOffset = track->currentOffset;
-	double updates = VIDEO_TOTAL_LENGTH / (mixer->tempo * mixer->p->sampleInterval / OVERSAMPLE);
-	int nSample;
-	for (nSample = 0; nSample < updates; ++nSample) {
-		int8_t sample = memory->load8(cpu, sampleBase + sampleI, 0);
-
-		struct GBAStereoSample stereo = {
-			(sample * track->channel->leftVolume * track->channel->envelopeV) >> 9,
-			(sample * track->channel->rightVolume * track->channel->envelopeV) >> 9
-		};
-
-		CircleBufferWrite16(&track->buffer, stereo.left);
-		CircleBufferWrite16(&track->buffer, stereo.right);
-
-		sampleOffset += mixer->p->sampleInterval / OVERSAMPLE;
-		while (sampleOffset > freq) {
-			sampleOffset -= freq;
-			++sampleI;
-			if (sampleI >= endOffset) {
-				sampleI = loopOffset;
+	size_t i;
+	if (voice->data) {
+		for (i = 0; i < length; ++i) {
+			// A track that just changed instruments can start past the end of the new one
+			samples[i] = sampleI < voice->dataLimit ? voice->data[sampleI] : 0;
+			sampleOffset += interval;
+			while (sampleOffset > voice->freq) {
+				sampleOffset -= voice->freq;
+				++sampleI;
+				if (sampleI >= voice->endOffset) {
+					sampleI = voice->loopOffset;
+				}
+			}
+		}
+	} else {
+		struct ARMCore* cpu = mixer->p->p->cpu;
+		for (i = 0; i < length; ++i) {
+			samples[i] = (int8_t) cpu->memory.load8(cpu, voice->sampleBase + sampleI, 0);
+			sampleOffset += interval;
+			while (sampleOffset > voice->freq) {
+				sampleOffset -= voice->freq;
+				++sampleI;
+				if (sampleI >= voice->endOffset) {
+					sampleI = voice->loopOffset;
+				}
 			}
 		}
 	}
-
 	track->samplePlaying = sampleI;
 	track->currentOffset = sampleOffset;
 }
 
+#ifdef MP2K_SIMD_SSE2
+static inline __m128i _scaleSamples(__m128i samples, __m128i volume, __m128i envelope) {
+	// sample * volume always fits in 16 bits, but the envelope needs the full 32-bit product
+	__m128i product = _mm_mullo_epi16(samples, volume);
+	__m128i lo = _mm_mullo_epi16(product, envelope);
+	__m128i hi = _mm_mulhi_epi16(product, envelope);
+	return _mm_packs_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 9), _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 9));
+}
+#elif defined(MP2K_SIMD_NEON)
+static inline int16x8_t _scaleSamples(int16x8_t samples, int16_t volume, int16_t envelope) {
+	int16x8_t product = vmulq_n_s16(samples, volume);
+	int32x4_t lo = vmull_n_s16(vget_low_s16(product), envelope);
+	int32x4_t hi = vmull_n_s16(vget_high_s16(product), envelope);
+	return vcombine_s16(vshrn_n_s32(lo, 9), vshrn_n_s32(hi, 9));
+}
+#endif
+
+static void _mixVoice(const struct GBAMP2kVoice* voice, const int16_t* samples, int16_t* left, int16_t* right, size_t length) {
+	size_t i = 0;
+#ifdef MP2K_SIMD_SSE2
+	__m128i leftVolume = _mm_set1_epi16(voice->leftVolume);
+	__m128i rightVolume = _mm_set1_epi16(voice->rightVolume);
+	__m128i envelope = _mm_set1_epi16(voice->envelope);
+	for (; i + 8 <= length; i += 8) {
+		__m128i sample = _mm_loadu_si128((const __m128i*) &samples[i]);
+		__m128i* l = (__m128i*) &left[i];
+		__m128i* r = (__m128i*) &right[i];
+		_mm_storeu_si128(l, _mm_add_epi16(_mm_loadu_si128(l), _scaleSamples(sample, leftVolume, envelope)));
+		_mm_storeu_si128(r, _mm_add_epi16(_mm_loadu_si128(r), _scaleSamples(sample, rightVolume, envelope)));
+	}
+#elif defined(MP2K_SIMD_NEON)
+	for (; i + 8 <= length; i += 8) {
+		int16x8_t sample = vld1q_s16(&samples[i]);
+		vst1q_s16(&left[i], vaddq_s16(vld1q_s16(&left[i]), _scaleSamples(sample, voice->leftVolume, voice->envelope)));
+		vst1q_s16(&right[i], vaddq_s16(vld1q_s16(&right[i]), _scaleSamples(sample, voice->rightVolume, voice->envelope)));
+	}
+#endif
+	for (; i < length; ++i) {
+		left[i] += (samples[i] * voice->leftVolume * voice->envelope) >> 9;
+		right[i] += (samples[i] * voice->rightVolume * voice->envelope) >> 9;
+	}
+}
+
+static void _renderJob(struct GBAAudioMixer* mixer, struct GBAMP2kRenderJob* job) {
+	int16_t samples[RENDER_BLOCK];
+	int16_t left[RENDER_BLOCK];
+	int16_t right[RENDER_BLOCK];
+	size_t offset;
+	for (offset = 0; offset < job->length; offset += RENDER_BLOCK) {
+		size_t length = job->length - offset;
+		if (length > RENDER_BLOCK) {
+			length = RENDER_BLOCK;
+		}
+		memset(left, 0, sizeof(left));
+		memset(right, 0, sizeof(right));
+		size_t i;
+		for (i = 0; i < MP2K_MAX_SOUND_CHANNELS; ++i) {
+			const struct GBAMP2kVoice* voice = &job->voices[i];
+			struct GBAMP2kTrack* track = &mixer->activeTracks[i];
+			if (!voice->active) {
+				track->currentOffset = 0;
+				track->samplePlaying = 0;
+				continue;
+			}
+			if (!voice->audible) {
+				continue;
+			}
+			_resampleVoice(mixer, track, voice, job->interval, samples, length);
+			_mixVoice(voice, samples, left, right, length);
+		}
+		for (i = 0; i < length; ++i) {
+			job->output[offset + i].left = left[i];
+			job->output[offset + i].right = right[i];
+		}
+	}
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _renderThread(void* context) {
+	struct GBAAudioMixer* mixer = context;
+	struct GBAMP2kRenderQueue* queue = mixer->queue;
+	ThreadSetName("MP2K Mixer Thread");
+
+	MutexLock(&queue->mutex);
+	while (true) {
+		if (queue->done == queue->tail) {
+			if (queue->exit) {
+				break;
+			}
+			ConditionWait(&queue->cond, &queue->mutex);
+			continue;
+		}
+		struct GBAMP2kRenderJob* job = &queue->jobs[queue->done % RENDER_QUEUE_SIZE];
+		MutexUnlock(&queue->mutex);
+		_renderJob(mixer, job);
+		MutexLock(&queue->mutex);
+		ATOMIC_STORE(queue->done, queue->done + 1);
+		ConditionWake(&queue->cond);
+	}
+	MutexUnlock(&queue->mutex);
+
+#ifdef _3DS
+	svcExitThread();
+#endif
+	return 0;
+}
+
+static void _waitForRender(struct GBAMP2kRenderQueue* queue, unsigned job) {
+	unsigned done;
+	ATOMIC_LOAD(done, queue->done);
+	if ((int) (done - job) > 0 || !queue->running) {
+		return;
+	}
+	MutexLock(&queue->mutex);
+	while ((int) (queue->done - job) <= 0) {
+		ConditionWait(&queue->cond, &queue->mutex);
+	}
+	MutexUnlock(&queue->mutex);
+}
+#endif
+
+static void _postTick(struct GBAAudioMixer* mixer, size_t length) {
+	struct GBAMP2kRenderQueue* queue = mixer->queue;
+	if (queue->tail - queue->read >= RENDER_QUEUE_SIZE) {
+		// Playback fell a whole queue behind, so drop the oldest tick instead of waiting on ourselves
+#ifndef DISABLE_THREADING
+		_waitForRender(queue, queue->read);
+#endif
+		++queue->read;
+		queue->readOffset = 0;
+	}
+	struct GBAMP2kRenderJob* job = &queue->jobs[queue->tail % RENDER_QUEUE_SIZE];
+	if (job->capacity < length) {
+		job->output = realloc(job->output, length * sizeof(*job->output));
+		job->capacity = length;
+	}
+	job->length = length;
+	job->interval = mixer->p->sampleInterval / OVERSAMPLE;
+	bool offThread = true;
+	size_t i;
+	for (i = 0; i < MP2K_MAX_SOUND_CHANNELS; ++i) {
+		if (!_snapshotVoice(mixer, &mixer->activeTracks[i], &job->voices[i])) {
+			offThread = false;
+		}
+	}
+	if (!queue->tail) {
+		// Playback runs one tick behind so the render thread has a tick's worth of time to finish
+		queue->primed = length;
+	}
+
+#ifndef DISABLE_THREADING
+	if (offThread) {
+		if (!queue->running) {
+			MutexInit(&queue->mutex);
+			ConditionInit(&queue->cond);
+			queue->exit = false;
+			queue->running = true;
+			ThreadCreate(&queue->thread, _renderThread, mixer);
+		}
+		MutexLock(&queue->mutex);
+		++queue->tail;
+		ConditionWake(&queue->cond);
+		MutexUnlock(&queue->mutex);
+		return;
+	}
+	// Samples outside of ROM have to be read over the bus, which only this thread may touch
+	_waitForRender(queue, queue->tail - 1);
+#else
+	UNUSED(offThread);
+#endif
+	_renderJob(mixer, job);
+#ifndef DISABLE_THREADING
+	if (queue->running) {
+		MutexLock(&queue->mutex);
+	}
+#endif
+	++queue->tail;
+	ATOMIC_STORE(queue->done, queue->tail);
+#ifndef DISABLE_THREADING
+	if (queue->running) {
+		MutexUnlock(&queue->mutex);
+	}
+#endif
+}
+
+static struct GBAStereoSample _nextSample(struct GBAAudioMixer* mixer) {
+	struct GBAMP2kRenderQueue* queue = mixer->queue;
+	if (queue->primed) {
+		--queue->primed;
+		struct GBAStereoSample silence = {0};
+		return silence;
+	}
+	if (queue->read == queue->tail) {
+		return mixer->last;
+	}
+	struct GBAMP2kRenderJob* job = &queue->jobs[queue->read % RENDER_QUEUE_SIZE];
+#ifndef DISABLE_THREADING
+	_waitForRender(queue, queue->read);
+#endif
+	struct GBAStereoSample sample = job->output[queue->readOffset];
+	++queue->readOffset;
+	if (queue->readOffset >= job->length) {
+		queue->readOffset = 0;
+		++queue->read;
+	}
+	return sample;
+}
+
 static void _mp2kReload(struct GBAAudioMixer* mixer) {
 	struct ARMCore* cpu = mixer->p->p->cpu;
 	struct ARMMemory* memory = &cpu->memory;
@@ -259,36 +577,21 @@ bool _mp2kEngage(struct GBAAudioMixer* mixer, uint32_t address) {
 void _mp2kStep(struct GBAAudioMixer* mixer) {
 	mixer->frame += mixer->p->sampleInterval;
 
-	while (mixer->frame >= VIDEO_TOTAL_LENGTH / mixer->tempo) {
-		int i;
-		for (i = 0; i < MP2K_MAX_SOUND_CHANNELS; ++i) {
-			struct GBAMP2kTrack* track = &mixer->activeTracks[i];
-			if (track->channel->status > 0) {
-				_stepSample(mixer, track);
-			} else {
-				track->currentOffset = 0;
-				track->samplePlaying = 0;
-				CircleBufferClear(&track->buffer);
-			}
+	double tick = VIDEO_TOTAL_LENGTH / mixer->tempo;
+	while (mixer->frame >= tick) {
+		mixer->frame -= tick;
+		// Render exactly as many samples as get played before the next tick
+		size_t steps = ceil((tick - mixer->frame) / mixer->p->sampleInterval);
+		if (!steps) {
+			steps = 1;
 		}
-		mixer->frame -= VIDEO_TOTAL_LENGTH / mixer->tempo;
+		_postTick(mixer, steps * OVERSAMPLE);
 	}
 
 	uint32_t interval = mixer->p->sampleInterval / OVERSAMPLE;
 	int i;
 	for (i = 0; i < OVERSAMPLE; ++i) {
-		struct GBAStereoSample sample = {0};
-		size_t track;
-		for (track = 0; track < MP2K_MAX_SOUND_CHANNELS; ++track) {
-			if (!mixer->activeTracks[track].channel->status) {
-				continue;
-			}
-			int16_t value;
-			CircleBufferRead16(&mixer->activeTracks[track].buffer, &value);
-			sample.left += value;
-			CircleBufferRead16(&mixer->activeTracks[track].buffer, &value);
-			sample.right += value;
-		}
+		struct GBAStereoSample sample = _nextSample(mixer);
 		if (mixer->p->externalMixing) {
 			blip_add_delta(mixer->p->psg.left, mixer->p->clock + i * interval, sample.left - mixer->last.left);
 			blip_add_delta(mixer->p->psg.right, mixer->p->clock + i * interval, sample.left - mixer->last.left);
@@ -24,6 +24,7 @@ static void GBAVideoProxyRendererPutPixels(struct GBAVideoRenderer* renderer, si
 static void _handleEvent(struct mVideoLogger* logger, enum mVideoLoggerEvent event);
 static bool _parsePacket(struct mVideoLogger* logger, const struct mVideoLoggerDirtyInfo* packet);
 static uint16_t* _vramBlock(struct mVideoLogger* logger, uint32_t address);
+static void _vramWritten(struct mVideoLogger* logger, uint32_t address, uint32_t length);
 
 void GBAVideoProxyRendererCreate(struct GBAVideoProxyRenderer* renderer, struct GBAVideoRenderer* backend) {
 	renderer->d.init = GBAVideoProxyRendererInit;
@@ -180,11 +181,17 @@ static bool _parsePacket(struct mVideoLogger* logger, const struct mVideoLoggerD
 	case DIRTY_VRAM:
 		if (item->address <= SIZE_VRAM - 0x1000) {
 			logger->readData(logger, &logger->vram[item->address >> 1], 0x1000, true);
-			proxyRenderer->backend->writeVRAM(proxyRenderer->backend, item->address);
+			// The whole block may have changed, not just its first row
+			_vramWritten(logger, item->address, 0x1000);
 		} else {
 			logger->readData(logger, NULL, 0x1000, true);
 		}
 		break;
+	case DIRTY_VRAM_DELTA:
+		if (!mVideoLoggerRendererReadVRAMDelta(logger, item, _vramWritten)) {
+			return false;
+		}
+		break;
 	case DIRTY_SCANLINE:
 		proxyRenderer->backend->disableBG[0] = proxyRenderer->d.disableBG[0];
 		proxyRenderer->backend->disableBG[1] = proxyRenderer->d.disableBG[1];
@@ -211,6 +218,15 @@ static uint16_t* _vramBlock(struct mVideoLogger* logger, uint32_t address) {
 	return &proxyRenderer->d.vram[address >> 1];
 }
 
+static void _vramWritten(struct mVideoLogger* logger, uint32_t address, uint32_t length) {
+	struct GBAVideoProxyRenderer* proxyRenderer = logger->context;
+	uint32_t end = address + length;
+	// Notify once per 4bpp tile, the finest granularity any backend tracks
+	for (address &= ~0x1F; address < end; address += 0x20) {
+		proxyRenderer->backend->writeVRAM(proxyRenderer->backend, address);
+	}
+}
+
 uint16_t GBAVideoProxyRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
 	struct GBAVideoProxyRenderer* proxyRenderer = (struct GBAVideoProxyRenderer*) renderer;
 	switch (address) {
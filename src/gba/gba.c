@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gba/gba.h>
 
+#include <mgba/core/rom-cache.h>
 #include <mgba/internal/arm/isa-inlines.h>
 #include <mgba/internal/arm/debugger/debugger.h>
 #include <mgba/internal/arm/decoder.h>
@@ -109,6 +110,7 @@ static void GBAInit(void* cpu, struct mCPUComponent* component) {
 
 	gba->idleOptimization = IDLE_LOOP_REMOVE;
 	gba->idleLoop = IDLE_LOOP_NONE;
+	gba->idleLoopDetected = false;
 
 	gba->hardCrash = true;
 	gba->allowOpposingDirections = true;
@@ -128,6 +130,7 @@ static void GBAInit(void* cpu, struct mCPUComponent* component) {
 }
 
 void GBAUnloadROM(struct GBA* gba) {
+	GBAMatrixDeinit(gba);
 	if (gba->memory.rom && !gba->isPristine) {
 		if (gba->yankedRomSize) {
 			gba->yankedRomSize = 0;
@@ -146,6 +149,8 @@ void GBAUnloadROM(struct GBA* gba) {
 	}
 	gba->memory.rom = NULL;
 	gba->isPristine = false;
+	gba->romCrc32Pending = false;
+	GBAMemoryUpdatePages(gba);
 
 	gba->memory.savedata.maskWriteback = false;
 	GBASavedataUnmask(&gba->memory.savedata);
@@ -155,6 +160,7 @@ void GBAUnloadROM(struct GBA* gba) {
 		gba->memory.savedata.realVf = 0;
 	}
 	gba->idleLoop = IDLE_LOOP_NONE;
+	gba->idleLoopDetected = false;
 }
 
 void GBADestroy(struct GBA* gba) {
@@ -166,8 +172,8 @@ void GBADestroy(struct GBA* gba) {
 		gba->biosVf = 0;
 	}
 
-	GBAMemoryDeinit(gba);
 	GBAVideoDeinit(&gba->video);
+	GBAMemoryDeinit(gba);
 	GBAAudioDeinit(&gba->audio);
 	GBASIODeinit(&gba->sio);
 	gba->rr = 0;
@@ -233,6 +239,7 @@ void GBAReset(struct ARMCore* cpu) {
 
 	gba->lastJump = 0;
 	gba->haltPending = false;
+	gba->haltPendingEvent = false;
 	gba->idleDetectionStep = 0;
 	gba->idleDetectionFailures = 0;
 
@@ -338,6 +345,8 @@ bool GBALoadNull(struct GBA* gba) {
 	gba->memory.romMask = SIZE_CART0 - 1;
 	gba->memory.mirroring = false;
 	gba->romCrc32 = 0;
+	gba->romCrc32Pending = false;
+	GBAMemoryUpdatePages(gba);
 
 	if (gba->cpu) {
 		gba->cpu->memory.setActiveRegion(gba->cpu, gba->cpu->gprs[ARM_PC]);
@@ -359,6 +368,8 @@ bool GBALoadMB(struct GBA* gba, struct VFile* vf) {
 	gba->memory.romSize = 0;
 	gba->memory.romMask = 0;
 	gba->romCrc32 = doCrc32(gba->memory.wram, gba->pristineRomSize);
+	gba->romCrc32Pending = false;
+	GBAMemoryUpdatePages(gba);
 	if (gba->cpu && gba->memory.activeRegion == REGION_WORKING_RAM) {
 		gba->cpu->memory.setActiveRegion(gba->cpu, gba->cpu->gprs[ARM_PC]);
 	}
@@ -400,9 +411,19 @@ bool GBALoadROM(struct GBA* gba, struct VFile* vf) {
 	gba->yankedRomSize = 0;
 	gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
 	gba->memory.mirroring = false;
-	gba->romCrc32 = doCrc32(gba->memory.rom, gba->memory.romSize);
+	if (gba->isPristine && mROMCacheGetCRC32(vf, &gba->romCrc32)) {
+		// The cache already hashed the whole file, which is exactly what's mapped
+		gba->romCrc32Pending = false;
+	} else if (gba->isPristine) {
+		// Hashing would page in the whole mapping, so wait until the checksum is needed
+		gba->romCrc32Pending = true;
+	} else {
+		gba->romCrc32 = doCrc32(gba->memory.rom, gba->memory.romSize);
+		gba->romCrc32Pending = false;
+	}
 	if (popcount32(gba->memory.romSize) != 1) {
 		// This ROM is either a bad dump or homebrew. Emulate flash cart behavior.
+		GBAGetROMCrc32(gba);
 #ifndef FIXED_ROM_BUFFER
 		void* newRom = anonymousMemoryMap(SIZE_CART0);
 		memcpy(newRom, gba->memory.rom, gba->pristineRomSize);
@@ -412,6 +433,7 @@ bool GBALoadROM(struct GBA* gba, struct VFile* vf) {
 		gba->memory.romMask = SIZE_CART0 - 1;
 		gba->isPristine = false;
 	}
+	GBAMemoryUpdatePages(gba);
 	if (gba->cpu && gba->memory.activeRegion >= REGION_CART0) {
 		gba->cpu->memory.setActiveRegion(gba->cpu, gba->cpu->gprs[ARM_PC]);
 	}
@@ -430,6 +452,7 @@ void GBAYankROM(struct GBA* gba) {
 	gba->yankedRomSize = gba->memory.romSize;
 	gba->memory.romSize = 0;
 	gba->memory.romMask = 0;
+	GBAMemoryUpdatePages(gba);
 	GBARaiseIRQ(gba, IRQ_GAMEPAK, 0);
 }
 
@@ -459,28 +482,42 @@ void GBALoadBIOS(struct GBA* gba, struct VFile* vf) {
 }
 
 void GBAApplyPatch(struct GBA* gba, struct Patch* patch) {
-	size_t patchedSize = patch->outputSize(patch, gba->memory.romSize);
-	if (!patchedSize || patchedSize > SIZE_CART0) {
-		return;
-	}
-	void* newRom = anonymousMemoryMap(SIZE_CART0);
-	if (!patch->applyPatch(patch, gba->memory.rom, gba->pristineRomSize, newRom, patchedSize)) {
-		mappedMemoryFree(newRom, SIZE_CART0);
-		return;
-	}
-	if (gba->romVf) {
+	// A pristine ROM is a private mapping of its file, so patching it where it lies only copies the pages the
+	// patch writes. Mappings handed out by the ROM cache are shared with other cores and must be left alone.
+	if (gba->isPristine && gba->romVf && !mROMCacheIsShared(gba->romVf) && patch->applyPatchInPlace &&
+	    patch->applyPatchInPlace(patch, gba->memory.rom, gba->memory.romSize)) {
+		mLOG(GBA, DEBUG, "Patched ROM in place");
+	} else {
+		size_t patchedSize = patch->outputSize(patch, gba->memory.romSize);
+		if (!patchedSize || patchedSize > SIZE_CART0) {
+			return;
+		}
+		void* newRom = anonymousMemoryMap(SIZE_CART0);
+		if (!patch->applyPatch(patch, gba->memory.rom, gba->pristineRomSize, newRom, patchedSize)) {
+			mappedMemoryFree(newRom, SIZE_CART0);
+			return;
+		}
+		if (gba->romVf) {
 #ifndef FIXED_ROM_BUFFER
-		gba->romVf->unmap(gba->romVf, gba->memory.rom, gba->pristineRomSize);
+			gba->romVf->unmap(gba->romVf, gba->memory.rom, gba->pristineRomSize);
 #endif
-		gba->romVf->close(gba->romVf);
-		gba->romVf = NULL;
+			gba->romVf->close(gba->romVf);
+			gba->romVf = NULL;
+		}
+		gba->isPristine = false;
+		gba->memory.rom = newRom;
+		gba->memory.hw.gpioBase = &((uint16_t*) gba->memory.rom)[GPIO_REG_DATA >> 1];
+		gba->memory.romSize = patchedSize;
+		gba->memory.romMask = SIZE_CART0 - 1;
 	}
-	gba->isPristine = false;
-	gba->memory.rom = newRom;
-	gba->memory.hw.gpioBase = &((uint16_t*) gba->memory.rom)[GPIO_REG_DATA >> 1];
-	gba->memory.romSize = patchedSize;
-	gba->memory.romMask = SIZE_CART0 - 1;
-	gba->romCrc32 = doCrc32(gba->memory.rom, gba->memory.romSize);
+	if (patch->hasOutputCrc32) {
+		// Validating the patch already checksummed the output
+		gba->romCrc32 = patch->outputCrc32;
+		gba->romCrc32Pending = false;
+	} else {
+		gba->romCrc32Pending = true;
+	}
+	GBAMemoryUpdatePages(gba);
 }
 
 void GBARaiseIRQ(struct GBA* gba, enum GBAIRQ irq, uint32_t cyclesLate) {
@@ -681,14 +718,18 @@ bool GBAIsBIOS(struct VFile* vf) {
 	return true;
 }
 
+static void _cartridgeGameCode(const struct GBACartridge* cart, char* out) {
+	memcpy(out, "AGB-", 4);
+	memcpy(&out[4], &cart->id, 4);
+}
+
 void GBAGetGameCode(const struct GBA* gba, char* out) {
 	memset(out, 0, 8);
 	if (!gba->memory.rom) {
 		return;
 	}
 
-	memcpy(out, "AGB-", 4);
-	memcpy(&out[4], &((struct GBACartridge*) gba->memory.rom)->id, 4);
+	_cartridgeGameCode((struct GBACartridge*) gba->memory.rom, out);
 }
 
 void GBAGetGameTitle(const struct GBA* gba, char* out) {
@@ -703,6 +744,38 @@ void GBAGetGameTitle(const struct GBA* gba, char* out) {
 	strncpy(out, "(BIOS)", 12);
 }
 
+uint32_t GBAGetROMCrc32(struct GBA* gba) {
+	if (gba->romCrc32Pending) {
+		// Either the ROM is still the untouched mapping, since copying it on write computes this first,
+		// or it was patched without the patch having checksummed the result
+		gba->romCrc32 = doCrc32(gba->memory.rom, gba->memory.romSize);
+		gba->romCrc32Pending = false;
+	}
+	return gba->romCrc32;
+}
+
+bool GBAIdentifyROM(struct VFile* vf, char* title, char* code) {
+#ifdef USE_ELF
+	struct ELF* elf = ELFOpen(vf);
+	if (elf) {
+		ELFClose(elf);
+		return false;
+	}
+#endif
+	// Multiboot images and oversized ROMs don't checksum the file as-is when loaded
+	if (GBAIsMB(vf) || vf->size(vf) > SIZE_CART0) {
+		return false;
+	}
+	struct GBACartridge cart;
+	if (vf->seek(vf, 0, SEEK_SET) < 0 || vf->read(vf, &cart, sizeof(cart)) != sizeof(cart)) {
+		return false;
+	}
+	memcpy(title, cart.title, sizeof(cart.title));
+	memset(code, 0, 8);
+	_cartridgeGameCode(&cart, code);
+	return true;
+}
+
 void GBAHitStub(struct ARMCore* cpu, uint32_t opcode) {
 	struct GBA* gba = (struct GBA*) cpu->master;
 	UNUSED(gba);
@@ -799,6 +872,7 @@ void GBAFrameStarted(struct GBA* gba) {
 }
 
 void GBAFrameEnded(struct GBA* gba) {
+	GBAAudioFlush(&gba->audio);
 	GBASavedataClean(&gba->memory.savedata, gba->video.frameCounter);
 
 	if (gba->rr) {
@@ -816,7 +890,7 @@ void GBAFrameEnded(struct GBA* gba) {
 		}
 	}
 
-	if (gba->stream && gba->stream->postVideoFrame) {
+	if (gba->stream && gba->stream->postVideoFrame && !gba->video.suppressOutput) {
 		const color_t* pixels;
 		size_t stride;
 		gba->video.renderer->getPixels(gba->video.renderer, &stride, (const void**) &pixels);
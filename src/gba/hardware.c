@@ -5,7 +5,9 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gba/hardware.h>
 
+#include <mgba/core/rom-cache.h>
 #include <mgba/internal/arm/macros.h>
+#include <mgba/internal/gba/gba.h>
 #include <mgba/internal/gba/io.h>
 #include <mgba/internal/gba/serialize.h>
 #include <mgba-util/formatting.h>
@@ -76,10 +78,19 @@ void GBAHardwareClear(struct GBACartridgeHardware* hw) {
 	}
 }
 
+// GPIO registers are mirrored into ROM, which must not be written while other cores share it
+static void _unshareGPIO(struct GBACartridgeHardware* hw) {
+	struct GBA* gba = hw->p;
+	if (gba->isPristine && gba->romVf && mROMCacheIsShared(gba->romVf)) {
+		GBAPristineCow(gba);
+	}
+}
+
 void GBAHardwareGPIOWrite(struct GBACartridgeHardware* hw, uint32_t address, uint16_t value) {
 	if (!hw->gpioBase) {
 		return;
 	}
+	_unshareGPIO(hw);
 	switch (address) {
 	case GPIO_REG_DATA:
 		hw->pinState &= ~hw->direction;
@@ -140,6 +151,7 @@ void _readPins(struct GBACartridgeHardware* hw) {
 
 void _outputPins(struct GBACartridgeHardware* hw, unsigned pins) {
 	if (hw->readWrite) {
+		_unshareGPIO(hw);
 		uint16_t old;
 		LOAD_16(old, 0, hw->gpioBase);
 		old &= hw->direction;
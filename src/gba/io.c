@@ -402,10 +402,12 @@ void GBAIOWrite(struct GBA* gba, uint32_t address, uint16_t value) {
 			break;
 		case REG_SOUNDCNT_HI:
 			GBAAudioWriteSOUNDCNT_HI(&gba->audio, value);
+			GBATimerUpdateScheduling(gba);
 			value &= 0x770F;
 			break;
 		case REG_SOUNDCNT_X:
 			GBAAudioWriteSOUNDCNT_X(&gba->audio, value);
+			GBATimerUpdateScheduling(gba);
 			value &= 0x0080;
 			value |= gba->memory.io[REG_SOUNDCNT_X >> 1] & 0xF;
 			break;
@@ -703,13 +705,32 @@ bool GBAIOIsReadConstant(uint32_t address) {
 	}
 }
 
+bool GBAIOIsReadEventDriven(uint32_t address) {
+	// These only change when a scheduled event fires, never between two events
+	switch (address) {
+	default:
+		return false;
+	case REG_DISPSTAT:
+	case REG_VCOUNT:
+	case REG_IF:
+		return true;
+	}
+}
+
 uint16_t GBAIORead(struct GBA* gba, uint32_t address) {
-	if (!GBAIOIsReadConstant(address)) {
+	if (GBAIOIsReadEventDriven(address)) {
+		// Polling these can skip ahead to the next event, but not all the way to an IRQ
+		gba->haltPendingEvent = true;
+	} else if (!GBAIOIsReadConstant(address)) {
 		// Most IO reads need to disable idle removal
 		gba->haltPending = false;
 	}
 
 	switch (address) {
+	case REG_DISPSTAT:
+		GBAVideoSyncHblank(&gba->video);
+		break;
+
 	// Reading this takes two cycles (1N+1I), so let's remove them preemptively
 	case REG_TM0CNT_LO:
 		GBATimerUpdateRegister(gba, 0, 4);
@@ -856,7 +877,6 @@ uint16_t GBAIORead(struct GBA* gba, uint32_t address) {
 		}
 		// Fall through
 	case REG_DISPCNT:
-	case REG_DISPSTAT:
 	case REG_VCOUNT:
 	case REG_BG0CNT:
 	case REG_BG1CNT:
@@ -979,8 +999,12 @@ void GBAIODeserialize(struct GBA* gba, const struct GBASerializedState* state) {
 			gba->timers[i].lastEvent = when + mTimingCurrentTime(&gba->timing);
 		}
 		LOAD_32(when, 0, &state->timers[i].nextEvent);
-		if (GBATimerFlagsIsEnable(gba->timers[i].flags)) {
+		// Count-up timers are driven by the previous timer's overflows and never have an event of their own
+		if (GBATimerFlagsIsEnable(gba->timers[i].flags) && !(i > 0 && GBATimerFlagsIsCountUp(gba->timers[i].flags))) {
 			mTimingSchedule(&gba->timing, &gba->timers[i].event, when);
+		} else {
+			// Audio register writes above may have rescheduled timers from before the load
+			mTimingDeschedule(&gba->timing, &gba->timers[i].event);
 		}
 
 		LOAD_16(gba->memory.dma[i].reg, (REG_DMA0CNT_HI + i * 12), state->io);
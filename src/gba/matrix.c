@@ -10,12 +10,70 @@
 #include <mgba/internal/gba/memory.h>
 #include <mgba-util/vfs.h>
 
+#define MATRIX_CHUNK_SHIFT 9
+#define MATRIX_CHUNK_SIZE (1 << MATRIX_CHUNK_SHIFT)
+#define MATRIX_CHUNKS (SIZE_CART0 >> MATRIX_CHUNK_SHIFT)
+
+static void _copyMatrix(struct GBA* gba, uint32_t paddr, uint32_t vaddr, uint32_t size) {
+	gba->romVf->seek(gba->romVf, paddr, SEEK_SET);
+	gba->romVf->read(gba->romVf, &((uint8_t*) gba->memory.rom)[vaddr], size);
+}
+
 static void _remapMatrix(struct GBA* gba) {
-	gba->romVf->seek(gba->romVf, gba->memory.matrix.paddr, SEEK_SET);
-	gba->romVf->read(gba->romVf, &gba->memory.rom[gba->memory.matrix.vaddr >> 2], gba->memory.matrix.size);
+	struct GBAMatrix* matrix = &gba->memory.matrix;
+	uint32_t paddr = matrix->paddr;
+	uint32_t vaddr = matrix->vaddr;
+	uint32_t size = matrix->size;
+	if (size > SIZE_CART0 - vaddr) {
+		size = SIZE_CART0 - vaddr;
+	}
+	if (!size) {
+		return;
+	}
+	uint32_t chunk = vaddr >> MATRIX_CHUNK_SHIFT;
+	uint32_t end = (vaddr + size + MATRIX_CHUNK_SIZE - 1) >> MATRIX_CHUNK_SHIFT;
+	if (!matrix->resident || ((paddr | vaddr | size) & (MATRIX_CHUNK_SIZE - 1))) {
+		_copyMatrix(gba, paddr, vaddr, size);
+		if (matrix->resident) {
+			// Partial chunks can't be tracked, so they'll be copied again next time
+			for (; chunk < end; ++chunk) {
+				matrix->resident[chunk] = 0;
+			}
+		}
+		return;
+	}
+
+	// Games tend to map the same banks over and over, so only copy the chunks that changed,
+	// coalescing them into as few reads as possible
+	uint32_t source = (paddr >> MATRIX_CHUNK_SHIFT) + 1;
+	uint32_t run = 0;
+	uint32_t runLength = 0;
+	for (; chunk < end; ++chunk, ++source) {
+		if (matrix->resident[chunk] == source) {
+			if (runLength) {
+				_copyMatrix(gba, (matrix->resident[run] - 1) << MATRIX_CHUNK_SHIFT, run << MATRIX_CHUNK_SHIFT, runLength << MATRIX_CHUNK_SHIFT);
+				runLength = 0;
+			}
+			continue;
+		}
+		matrix->resident[chunk] = source;
+		if (!runLength) {
+			run = chunk;
+		}
+		++runLength;
+	}
+	if (runLength) {
+		_copyMatrix(gba, (matrix->resident[run] - 1) << MATRIX_CHUNK_SHIFT, run << MATRIX_CHUNK_SHIFT, runLength << MATRIX_CHUNK_SHIFT);
+	}
 }
 
 void GBAMatrixReset(struct GBA* gba) {
+	if (!gba->memory.matrix.resident) {
+		gba->memory.matrix.resident = malloc(MATRIX_CHUNKS * sizeof(uint32_t));
+	}
+	// The buffer's contents aren't known after a reset
+	memset(gba->memory.matrix.resident, 0, MATRIX_CHUNKS * sizeof(uint32_t));
+
 	gba->memory.matrix.paddr = 0x200;
 	gba->memory.matrix.size = 0x1000;
 
@@ -30,6 +88,11 @@ void GBAMatrixReset(struct GBA* gba) {
 	_remapMatrix(gba);
 }
 
+void GBAMatrixDeinit(struct GBA* gba) {
+	free(gba->memory.matrix.resident);
+	gba->memory.matrix.resident = NULL;
+}
+
 void GBAMatrixWrite(struct GBA* gba, uint32_t address, uint32_t value) {
 	switch (address) {
 	case 0x0:
@@ -5,6 +5,8 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gba/memory.h>
 
+#include <mgba/core/mem-heatmap.h>
+#include <mgba/core/perf-counters.h>
 #include <mgba/internal/arm/decoder.h>
 #include <mgba/internal/arm/macros.h>
 #include <mgba/internal/gba/gba.h>
@@ -21,7 +23,6 @@
 
 mLOG_DEFINE_CATEGORY(GBA_MEM, "GBA Memory", "gba.memory");
 
-static void _pristineCow(struct GBA* gba);
 static void _agbPrintStore(struct GBA* gba, uint32_t address, int16_t value);
 static int16_t  _agbPrintLoad(struct GBA* gba, uint32_t address);
 static uint8_t _deadbeef[4] = { 0x10, 0xB7, 0x10, 0xE7 }; // Illegal instruction on both ARM and Thumb
@@ -37,6 +38,31 @@ static const char GBA_BASE_WAITSTATES_SEQ_32[16] = { 0, 0, 5, 0, 0, 1, 1, 0, 5,
 static const char GBA_ROM_WAITSTATES[] = { 4, 3, 2, 8 };
 static const char GBA_ROM_WAITSTATES_SEQ[] = { 2, 1, 4, 1, 8, 1 };
 
+#ifdef ENABLE_PERF_COUNTERS
+// The heatmap page is picked before the address gets masked, and billed once the final wait is known
+#define COUNT_ACCESSES(KIND, ADDRESS, COUNT) \
+	struct mMemoryHeatmapPage* heatPage = NULL; \
+	if (cpu->perfCounters) { \
+		cpu->perfCounters->memoryAccesses[((ADDRESS) >> BASE_OFFSET) & (mPERF_COUNTER_REGIONS - 1)] += (COUNT); \
+	} \
+	if (cpu->heatmap) { \
+		heatPage = mMemoryHeatmapGetPage(cpu->heatmap, ADDRESS); \
+		heatPage->accesses[mMEMORY_HEATMAP_ ## KIND] += (COUNT); \
+	}
+#define COUNT_CYCLES(KIND, CYCLES) \
+	if (heatPage) { \
+		heatPage->cycles[mMEMORY_HEATMAP_ ## KIND] += (CYCLES); \
+	}
+#define COUNT_STALL(CYCLES) \
+	if (cpu->perfCounters) { \
+		cpu->perfCounters->waitstateCycles += (CYCLES); \
+	}
+#else
+#define COUNT_ACCESSES(KIND, ADDRESS, COUNT)
+#define COUNT_CYCLES(KIND, CYCLES)
+#define COUNT_STALL(CYCLES)
+#endif
+
 void GBAMemoryInit(struct GBA* gba) {
 	struct ARMCore* cpu = gba->cpu;
 	cpu->memory.load32 = GBALoad32;
@@ -48,6 +74,8 @@ void GBAMemoryInit(struct GBA* gba) {
 	cpu->memory.store8 = GBAStore8;
 	cpu->memory.storeMultiple = GBAStoreMultiple;
 	cpu->memory.stall = GBAMemoryStall;
+	gba->memory.hook = NULL;
+	gba->memory.hookInstalled = false;
 
 	gba->memory.bios = (uint32_t*) hleBios;
 	gba->memory.fullBios = 0;
@@ -57,6 +85,9 @@ void GBAMemoryInit(struct GBA* gba) {
 	gba->memory.romSize = 0;
 	gba->memory.romMask = 0;
 	gba->memory.hw.p = gba;
+	memset(gba->memory.dirtyPages, 0, sizeof(gba->memory.dirtyPages));
+	memset(gba->memory.loadPages, 0, sizeof(gba->memory.loadPages));
+	memset(gba->memory.storePages, 0, sizeof(gba->memory.storePages));
 
 	int i;
 	for (i = 0; i < 16; ++i) {
@@ -71,6 +102,19 @@ void GBAMemoryInit(struct GBA* gba) {
 		gba->memory.waitstatesNonseq32[i] = 0;
 		gba->memory.waitstatesSeq32[i] = 0;
 	}
+	for (i = 0; i <= GBA_PREFETCH_MAX_SEQ; ++i) {
+		int wait;
+		for (wait = 0; wait <= GBA_PREFETCH_MAX_WAIT; ++wait) {
+			// Enough sequential loads to cover the wait, but always at least one
+			int loads = (wait + i) / (i + 1);
+			if (loads < 1) {
+				loads = 1;
+			} else if (loads > GBA_PREFETCH_MAX_LOADS) {
+				loads = GBA_PREFETCH_MAX_LOADS;
+			}
+			gba->memory.prefetchLoads[i][wait] = loads;
+		}
+	}
 
 	gba->memory.activeRegion = -1;
 	cpu->memory.activeRegion = 0;
@@ -86,16 +130,23 @@ void GBAMemoryInit(struct GBA* gba) {
 	gba->memory.agbPrint = 0;
 	memset(&gba->memory.agbPrintCtx, 0, sizeof(gba->memory.agbPrintCtx));
 	gba->memory.agbPrintBuffer = NULL;
+	gba->memory.matrix.resident = NULL;
 
-	gba->memory.wram = anonymousMemoryMap(SIZE_WORKING_RAM + SIZE_WORKING_IRAM);
+	// WRAM, IWRAM and VRAM share one arena, so they can sit in a single huge page
+	gba->memory.wram = hugeMemoryMap(GBA_MEMORY_ARENA_SIZE);
 	gba->memory.iwram = &gba->memory.wram[SIZE_WORKING_RAM >> 2];
+	gba->video.vram = (uint16_t*) &gba->memory.wram[(SIZE_WORKING_RAM + SIZE_WORKING_IRAM) >> 2];
 
 	GBADMAInit(gba);
 	GBAVFameInit(&gba->memory.vfame);
 }
 
 void GBAMemoryDeinit(struct GBA* gba) {
-	mappedMemoryFree(gba->memory.wram, SIZE_WORKING_RAM + SIZE_WORKING_IRAM);
+	hugeMemoryFree(gba->memory.wram, GBA_MEMORY_ARENA_SIZE);
+	size_t i;
+	for (i = 0; i < sizeof(gba->memory.dirtyPages) / sizeof(*gba->memory.dirtyPages); ++i) {
+		mCoreMemoryDirtyDeinit(&gba->memory.dirtyPages[i]);
+	}
 	if (gba->memory.rom) {
 		mappedMemoryFree(gba->memory.rom, gba->memory.romSize);
 	}
@@ -124,6 +175,7 @@ void GBAMemoryReset(struct GBA* gba) {
 
 	gba->memory.prefetch = false;
 	gba->memory.lastPrefetchedPc = 0;
+	gba->memory.biosPrefetch = 0;
 
 	if (!gba->memory.wram || !gba->memory.iwram) {
 		GBAMemoryDeinit(gba);
@@ -131,80 +183,220 @@ void GBAMemoryReset(struct GBA* gba) {
 	}
 
 	GBADMAReset(gba);
-	memset(&gba->memory.matrix, 0, sizeof(gba->memory.matrix));
+	gba->memory.matrix.cmd = 0;
+	gba->memory.matrix.paddr = 0;
+	gba->memory.matrix.vaddr = 0;
+	gba->memory.matrix.size = 0;
+	GBAMemoryUpdatePages(gba);
+}
+
+static void _mapPage(struct GBAMemoryPage* page, void* data, uint32_t mask, uint32_t size) {
+	page->data = data;
+	page->mask = mask;
+	page->size = data ? size : 0;
+}
+
+void GBAMemoryUpdatePages(struct GBA* gba) {
+	struct GBAMemory* memory = &gba->memory;
+	memset(memory->loadPages, 0, sizeof(memory->loadPages));
+	memset(memory->storePages, 0, sizeof(memory->storePages));
+
+	// BIOS and I/O reads, VRAM mirrors and everything that notifies the renderer on write stay on the slow path
+	_mapPage(&memory->loadPages[REGION_WORKING_RAM], memory->wram, SIZE_WORKING_RAM - 1, SIZE_WORKING_RAM);
+	_mapPage(&memory->loadPages[REGION_WORKING_IRAM], memory->iwram, SIZE_WORKING_IRAM - 1, SIZE_WORKING_IRAM);
+	_mapPage(&memory->loadPages[REGION_PALETTE_RAM], gba->video.palette, SIZE_PALETTE_RAM - 1, SIZE_PALETTE_RAM);
+	_mapPage(&memory->loadPages[REGION_VRAM], gba->video.vram, 0x0001FFFF, SIZE_VRAM);
+	_mapPage(&memory->loadPages[REGION_OAM], gba->video.oam.raw, SIZE_OAM - 1, SIZE_OAM);
+	_mapPage(&memory->storePages[REGION_WORKING_RAM], memory->wram, SIZE_WORKING_RAM - 1, SIZE_WORKING_RAM);
+	_mapPage(&memory->storePages[REGION_WORKING_IRAM], memory->iwram, SIZE_WORKING_IRAM - 1, SIZE_WORKING_IRAM);
+
+	// Out of bounds ROM reads are open bus, mirrored or special hardware, and CART2_EX may be EEPROM
+	int i;
+	for (i = REGION_CART0; i < REGION_CART2_EX; ++i) {
+		_mapPage(&memory->loadPages[i], memory->rom, SIZE_CART0 - 1, memory->romSize);
+	}
+}
+
+static void _hookStore32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycleCounter) {
+	struct GBAMemory* memory = &((struct GBA*) cpu->master)->memory;
+	memory->unhooked.store32(cpu, address, value, cycleCounter);
+	if (memory->hook && mCoreMemoryHookWatches(memory->hook, address)) {
+		memory->hook->written(memory->hook->context, address & ~3, 4, value);
+	}
+}
+
+static void _hookStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycleCounter) {
+	struct GBAMemory* memory = &((struct GBA*) cpu->master)->memory;
+	memory->unhooked.store16(cpu, address, value, cycleCounter);
+	if (memory->hook && mCoreMemoryHookWatches(memory->hook, address)) {
+		memory->hook->written(memory->hook->context, address & ~1, 2, (uint16_t) value);
+	}
+}
+
+static void _hookStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCounter) {
+	struct GBAMemory* memory = &((struct GBA*) cpu->master)->memory;
+	memory->unhooked.store8(cpu, address, value, cycleCounter);
+	if (memory->hook && mCoreMemoryHookWatches(memory->hook, address)) {
+		memory->hook->written(memory->hook->context, address, 1, (uint8_t) value);
+	}
+}
+
+static uint32_t _hookStoreMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum LSMDirection direction, int* cycleCounter) {
+	struct GBAMemory* memory = &((struct GBA*) cpu->master)->memory;
+	uint32_t base = address;
+	if (direction & LSM_D) {
+		base -= (popcount32(mask) << 2) - 4;
+		if (direction & LSM_B) {
+			base -= 4;
+		}
+	} else if (direction & LSM_B) {
+		base += 4;
+	}
+	base &= ~3;
+	uint32_t result = memory->unhooked.storeMultiple(cpu, address, mask, direction, cycleCounter);
+	if (memory->hook) {
+		// Registers are stored in ascending order from the lowest address
+		int reg;
+		for (reg = 0; reg <= ARM_PC; ++reg) {
+			if (!(mask & (1 << reg))) {
+				continue;
+			}
+			if (mCoreMemoryHookWatches(memory->hook, base)) {
+				uint32_t value = cpu->gprs[reg];
+				if (reg == ARM_PC) {
+					value += WORD_SIZE_ARM;
+				}
+				memory->hook->written(memory->hook->context, base, 4, value);
+			}
+			base += 4;
+		}
+	}
+	return result;
+}
+
+void GBAMemorySetHook(struct GBA* gba, struct mCoreMemoryHook* hook) {
+	struct ARMCore* cpu = gba->cpu;
+	struct GBAMemory* memory = &gba->memory;
+	memory->hook = hook;
+	if (hook && !memory->hookInstalled) {
+		memory->unhooked = cpu->memory;
+		cpu->memory.store32 = _hookStore32;
+		cpu->memory.store16 = _hookStore16;
+		cpu->memory.store8 = _hookStore8;
+		cpu->memory.storeMultiple = _hookStoreMultiple;
+		memory->hookInstalled = true;
+	} else if (!hook && memory->hookInstalled && cpu->memory.store32 == _hookStore32) {
+		// If something else, like the debugger, has wrapped the shims since, they stay and just pass stores through
+		cpu->memory.store32 = memory->unhooked.store32;
+		cpu->memory.store16 = memory->unhooked.store16;
+		cpu->memory.store8 = memory->unhooked.store8;
+		cpu->memory.storeMultiple = memory->unhooked.storeMultiple;
+		memory->hookInstalled = false;
+	}
+}
+
+static bool _isIdleLoopLoadAllowed(uint32_t address, int width) {
+	if ((address >> BASE_OFFSET) != REGION_IO) {
+		return true;
+	}
+	address &= OFFSET_MASK & ~1;
+	if (!GBAIOIsReadConstant(address) && !GBAIOIsReadEventDriven(address)) {
+		return false;
+	}
+	if (width == 4) {
+		address |= 2;
+		return GBAIOIsReadConstant(address) || GBAIOIsReadEventDriven(address);
+	}
+	return true;
 }
 
 static void _analyzeForIdleLoop(struct GBA* gba, struct ARMCore* cpu, uint32_t address) {
 	struct ARMInstructionInfo info;
 	uint32_t nextAddress = address;
+	int instructionWidth = cpu->executionMode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM;
 	memset(gba->taintedRegisters, 0, sizeof(gba->taintedRegisters));
-	if (cpu->executionMode == MODE_THUMB) {
-		while (true) {
+	while (true) {
+		if (cpu->executionMode == MODE_THUMB) {
 			uint16_t opcode;
 			LOAD_16(opcode, nextAddress & cpu->memory.activeMask, cpu->memory.activeRegion);
 			ARMDecodeThumb(opcode, &info);
-			switch (info.branchType) {
-			case ARM_BRANCH_NONE:
-				if (info.operandFormat & ARM_OPERAND_MEMORY_2) {
-					if (info.mnemonic == ARM_MN_STR || gba->taintedRegisters[info.memory.baseReg]) {
-						gba->idleDetectionStep = -1;
-						return;
-					}
-					uint32_t loadAddress = gba->cachedRegisters[info.memory.baseReg];
-					uint32_t offset = 0;
-					if (info.memory.format & ARM_MEMORY_IMMEDIATE_OFFSET) {
-						offset = info.memory.offset.immediate;
-					} else if (info.memory.format & ARM_MEMORY_REGISTER_OFFSET) {
-						int reg = info.memory.offset.reg;
-						if (gba->cachedRegisters[reg]) {
-							gba->idleDetectionStep = -1;
-							return;
-						}
-						offset = gba->cachedRegisters[reg];
-					}
-					if (info.memory.format & ARM_MEMORY_OFFSET_SUBTRACT) {
-						loadAddress -= offset;
-					} else {
-						loadAddress += offset;
-					}
-					if ((loadAddress >> BASE_OFFSET) == REGION_IO && !GBAIOIsReadConstant(loadAddress)) {
+		} else {
+			uint32_t opcode;
+			LOAD_32(opcode, nextAddress & cpu->memory.activeMask, cpu->memory.activeRegion);
+			ARMDecodeARM(opcode, &info);
+		}
+		switch (info.branchType) {
+		case ARM_BRANCH_NONE:
+			if (info.mnemonic == ARM_MN_LDM || info.mnemonic == ARM_MN_STM || info.mnemonic == ARM_MN_SWP) {
+				gba->idleDetectionStep = -1;
+				return;
+			}
+			if (info.operandFormat & ARM_OPERAND_MEMORY_2) {
+				if (info.mnemonic == ARM_MN_STR || gba->taintedRegisters[info.memory.baseReg]) {
+					gba->idleDetectionStep = -1;
+					return;
+				}
+				uint32_t loadAddress = gba->cachedRegisters[info.memory.baseReg];
+				uint32_t offset = 0;
+				if (info.memory.format & ARM_MEMORY_IMMEDIATE_OFFSET) {
+					offset = info.memory.offset.immediate;
+				} else if (info.memory.format & ARM_MEMORY_REGISTER_OFFSET) {
+					int reg = info.memory.offset.reg;
+					if (gba->cachedRegisters[reg]) {
 						gba->idleDetectionStep = -1;
 						return;
 					}
-					if ((loadAddress >> BASE_OFFSET) < REGION_CART0 || (loadAddress >> BASE_OFFSET) > REGION_CART2_EX) {
-						gba->taintedRegisters[info.op1.reg] = true;
-					} else {
-						switch (info.memory.width) {
-						case 1:
-							gba->cachedRegisters[info.op1.reg] = GBALoad8(cpu, loadAddress, 0);
-							break;
-						case 2:
-							gba->cachedRegisters[info.op1.reg] = GBALoad16(cpu, loadAddress, 0);
-							break;
-						case 4:
-							gba->cachedRegisters[info.op1.reg] = GBALoad32(cpu, loadAddress, 0);
-							break;
-						}
-					}
-				} else if (info.operandFormat & ARM_OPERAND_AFFECTED_1) {
-					gba->taintedRegisters[info.op1.reg] = true;
+					offset = gba->cachedRegisters[reg];
 				}
-				nextAddress += WORD_SIZE_THUMB;
-				break;
-			case ARM_BRANCH:
-				if ((uint32_t) info.op1.immediate + nextAddress + WORD_SIZE_THUMB * 2 == address) {
-					gba->idleLoop = address;
-					gba->idleOptimization = IDLE_LOOP_REMOVE;
+				if (info.memory.baseReg == ARM_PC) {
+					// PC-relative literal loads see the prefetched PC
+					loadAddress = (nextAddress + instructionWidth * 2) & ~3;
 				}
-				gba->idleDetectionStep = -1;
-				return;
-			default:
-				gba->idleDetectionStep = -1;
-				return;
+				if (info.memory.format & ARM_MEMORY_POST_INCREMENT) {
+					offset = 0;
+				}
+				if (info.memory.format & ARM_MEMORY_OFFSET_SUBTRACT) {
+					loadAddress -= offset;
+				} else {
+					loadAddress += offset;
+				}
+				// Registers that only events can change are fine to poll, since the loop just waits for the next event
+				if (!_isIdleLoopLoadAllowed(loadAddress, info.memory.width)) {
+					gba->idleDetectionStep = -1;
+					return;
+				}
+				if ((loadAddress >> BASE_OFFSET) < REGION_CART0 || (loadAddress >> BASE_OFFSET) > REGION_CART2_EX) {
+					gba->taintedRegisters[info.op1.reg] = true;
+				} else {
+					switch (info.memory.width) {
+					case 1:
+						gba->cachedRegisters[info.op1.reg] = GBALoad8(cpu, loadAddress, 0);
+						break;
+					case 2:
+						gba->cachedRegisters[info.op1.reg] = GBALoad16(cpu, loadAddress, 0);
+						break;
+					case 4:
+						gba->cachedRegisters[info.op1.reg] = GBALoad32(cpu, loadAddress, 0);
+						break;
+					}
+				}
+			} else if (info.operandFormat & ARM_OPERAND_AFFECTED_1) {
+				gba->taintedRegisters[info.op1.reg] = true;
+			}
+			nextAddress += instructionWidth;
+			break;
+		case ARM_BRANCH:
+			if ((uint32_t) info.op1.immediate + nextAddress + instructionWidth * 2 == address) {
+				gba->idleLoop = address;
+				gba->idleLoopDetected = true;
+				gba->idleOptimization = IDLE_LOOP_REMOVE;
 			}
+			gba->idleDetectionStep = -1;
+			return;
+		default:
+			gba->idleDetectionStep = -1;
+			return;
 		}
-	} else {
-		gba->idleDetectionStep = -1;
 	}
 }
 
@@ -217,9 +409,22 @@ static void GBASetActiveRegion(struct ARMCore* cpu, uint32_t address) {
 		if (address == gba->idleLoop) {
 			if (gba->haltPending) {
 				gba->haltPending = false;
-				GBAHalt(gba);
+#ifdef ENABLE_PERF_COUNTERS
+				if (cpu->perfCounters) {
+					++cpu->perfCounters->idleLoopSkips;
+				}
+#endif
+				if (gba->haltPendingEvent) {
+					// The loop polled a register that the next event may change, so only skip up to it
+					if (cpu->cycles < cpu->nextEvent) {
+						cpu->cycles = cpu->nextEvent;
+					}
+				} else {
+					GBAHalt(gba);
+				}
 			} else {
 				gba->haltPending = true;
+				gba->haltPendingEvent = false;
 			}
 		} else if (gba->idleOptimization >= IDLE_LOOP_DETECT && newRegion == memory->activeRegion) {
 			if (address == gba->lastJump) {
@@ -435,46 +640,53 @@ uint32_t GBALoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	struct GBAMemory* memory = &gba->memory;
 	uint32_t value = 0;
 	int wait = 0;
+	COUNT_ACCESSES(READ, address, 1);
 	char* waitstatesRegion = memory->waitstatesNonseq32;
 
-	switch (address >> BASE_OFFSET) {
-	case REGION_BIOS:
-		LOAD_BIOS;
-		break;
-	case REGION_WORKING_RAM:
-		LOAD_WORKING_RAM;
-		break;
-	case REGION_WORKING_IRAM:
-		LOAD_WORKING_IRAM;
-		break;
-	case REGION_IO:
-		LOAD_IO;
-		break;
-	case REGION_PALETTE_RAM:
-		LOAD_PALETTE_RAM;
-		break;
-	case REGION_VRAM:
-		LOAD_VRAM;
-		break;
-	case REGION_OAM:
-		LOAD_OAM;
-		break;
-	case REGION_CART0:
-	case REGION_CART0_EX:
-	case REGION_CART1:
-	case REGION_CART1_EX:
-	case REGION_CART2:
-	case REGION_CART2_EX:
-		LOAD_CART;
-		break;
-	case REGION_CART_SRAM:
-	case REGION_CART_SRAM_MIRROR:
-		LOAD_SRAM;
-		break;
-	default:
-		mLOG(GBA_MEM, GAME_ERROR, "Bad memory Load32: 0x%08X", address);
-		LOAD_BAD;
-		break;
+	const struct GBAMemoryPage* page = &memory->loadPages[address >> BASE_OFFSET];
+	if ((address & page->mask) < page->size) {
+		LOAD_32(value, address & page->mask & -4, page->data);
+		wait = memory->waitstatesNonseq32[address >> BASE_OFFSET];
+	} else {
+		switch (address >> BASE_OFFSET) {
+		case REGION_BIOS:
+			LOAD_BIOS;
+			break;
+		case REGION_WORKING_RAM:
+			LOAD_WORKING_RAM;
+			break;
+		case REGION_WORKING_IRAM:
+			LOAD_WORKING_IRAM;
+			break;
+		case REGION_IO:
+			LOAD_IO;
+			break;
+		case REGION_PALETTE_RAM:
+			LOAD_PALETTE_RAM;
+			break;
+		case REGION_VRAM:
+			LOAD_VRAM;
+			break;
+		case REGION_OAM:
+			LOAD_OAM;
+			break;
+		case REGION_CART0:
+		case REGION_CART0_EX:
+		case REGION_CART1:
+		case REGION_CART1_EX:
+		case REGION_CART2:
+		case REGION_CART2_EX:
+			LOAD_CART;
+			break;
+		case REGION_CART_SRAM:
+		case REGION_CART_SRAM_MIRROR:
+			LOAD_SRAM;
+			break;
+		default:
+			mLOG(GBA_MEM, GAME_ERROR, "Bad memory Load32: 0x%08X", address);
+			LOAD_BAD;
+			break;
+		}
 	}
 
 	if (cycleCounter) {
@@ -483,6 +695,7 @@ uint32_t GBALoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 			wait = GBAMemoryStall(cpu, wait);
 		}
 		*cycleCounter += wait;
+		COUNT_CYCLES(READ, wait);
 	}
 	// Unaligned 32-bit loads are "rotated" so they make some semblance of sense
 	int rotate = (address & 3) << 3;
@@ -494,102 +707,109 @@ uint32_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	struct GBAMemory* memory = &gba->memory;
 	uint32_t value = 0;
 	int wait = 0;
+	COUNT_ACCESSES(READ, address, 1);
 
-	switch (address >> BASE_OFFSET) {
-	case REGION_BIOS:
-		if (address < SIZE_BIOS) {
-			if (memory->activeRegion == REGION_BIOS) {
-				LOAD_16(value, address & -2, memory->bios);
+	const struct GBAMemoryPage* page = &memory->loadPages[address >> BASE_OFFSET];
+	if ((address & page->mask) < page->size) {
+		LOAD_16(value, address & page->mask & -2, page->data);
+		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
+	} else {
+		switch (address >> BASE_OFFSET) {
+		case REGION_BIOS:
+			if (address < SIZE_BIOS) {
+				if (memory->activeRegion == REGION_BIOS) {
+					LOAD_16(value, address & -2, memory->bios);
+				} else {
+					mLOG(GBA_MEM, GAME_ERROR, "Bad BIOS Load16: 0x%08X", address);
+					value = (memory->biosPrefetch >> ((address & 2) * 8)) & 0xFFFF;
+				}
 			} else {
-				mLOG(GBA_MEM, GAME_ERROR, "Bad BIOS Load16: 0x%08X", address);
-				value = (memory->biosPrefetch >> ((address & 2) * 8)) & 0xFFFF;
+				mLOG(GBA_MEM, GAME_ERROR, "Bad memory Load16: 0x%08X", address);
+				LOAD_BAD;
+				value = (value >> ((address & 2) * 8)) & 0xFFFF;
 			}
-		} else {
-			mLOG(GBA_MEM, GAME_ERROR, "Bad memory Load16: 0x%08X", address);
-			LOAD_BAD;
-			value = (value >> ((address & 2) * 8)) & 0xFFFF;
-		}
-		break;
-	case REGION_WORKING_RAM:
-		LOAD_16(value, address & (SIZE_WORKING_RAM - 2), memory->wram);
-		wait = memory->waitstatesNonseq16[REGION_WORKING_RAM];
-		break;
-	case REGION_WORKING_IRAM:
-		LOAD_16(value, address & (SIZE_WORKING_IRAM - 2), memory->iwram);
-		break;
-	case REGION_IO:
-		value = GBAIORead(gba, address & (OFFSET_MASK - 1));
-		break;
-	case REGION_PALETTE_RAM:
-		LOAD_16(value, address & (SIZE_PALETTE_RAM - 2), gba->video.palette);
-		break;
-	case REGION_VRAM:
-		if ((address & 0x0001FFFF) >= SIZE_VRAM) {
-			if ((address & (SIZE_VRAM | 0x00014000)) == SIZE_VRAM && (GBARegisterDISPCNTGetMode(gba->memory.io[REG_DISPCNT >> 1]) >= 3)) {
-				mLOG(GBA_MEM, GAME_ERROR, "Bad VRAM Load16: 0x%08X", address);
-				value = 0;
-				break;
+			break;
+		case REGION_WORKING_RAM:
+			LOAD_16(value, address & (SIZE_WORKING_RAM - 2), memory->wram);
+			wait = memory->waitstatesNonseq16[REGION_WORKING_RAM];
+			break;
+		case REGION_WORKING_IRAM:
+			LOAD_16(value, address & (SIZE_WORKING_IRAM - 2), memory->iwram);
+			break;
+		case REGION_IO:
+			value = GBAIORead(gba, address & (OFFSET_MASK - 1));
+			break;
+		case REGION_PALETTE_RAM:
+			LOAD_16(value, address & (SIZE_PALETTE_RAM - 2), gba->video.palette);
+			break;
+		case REGION_VRAM:
+			if ((address & 0x0001FFFF) >= SIZE_VRAM) {
+				if ((address & (SIZE_VRAM | 0x00014000)) == SIZE_VRAM && (GBARegisterDISPCNTGetMode(gba->memory.io[REG_DISPCNT >> 1]) >= 3)) {
+					mLOG(GBA_MEM, GAME_ERROR, "Bad VRAM Load16: 0x%08X", address);
+					value = 0;
+					break;
+				}
+				address &= 0x00017FFE;
 			}
-			address &= 0x00017FFE;
-		}
-		LOAD_16(value, address & 0x0001FFFE, gba->video.vram);
-		break;
-	case REGION_OAM:
-		LOAD_16(value, address & (SIZE_OAM - 2), gba->video.oam.raw);
-		break;
-	case REGION_CART0:
-	case REGION_CART0_EX:
-	case REGION_CART1:
-	case REGION_CART1_EX:
-	case REGION_CART2:
-		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
-		if ((address & (SIZE_CART0 - 1)) < memory->romSize) {
-			LOAD_16(value, address & (SIZE_CART0 - 2), memory->rom);
-		} else if (memory->mirroring && (address & memory->romMask) < memory->romSize) {
-			LOAD_16(value, address & memory->romMask, memory->rom);
-		} else if (memory->vfame.cartType) {
-			value = GBAVFameGetPatternValue(address, 16);
-		} else if ((address & (SIZE_CART0 - 1)) >= AGB_PRINT_BASE) {
-			uint32_t agbPrintAddr = address & 0x00FFFFFF;
-			if (agbPrintAddr == AGB_PRINT_PROTECT) {
-				value = memory->agbPrint;
-			} else if (agbPrintAddr < AGB_PRINT_TOP || (agbPrintAddr & 0x00FFFFF8) == (AGB_PRINT_STRUCT & 0x00FFFFF8)) {
-				value = _agbPrintLoad(gba, address);
+			LOAD_16(value, address & 0x0001FFFE, gba->video.vram);
+			break;
+		case REGION_OAM:
+			LOAD_16(value, address & (SIZE_OAM - 2), gba->video.oam.raw);
+			break;
+		case REGION_CART0:
+		case REGION_CART0_EX:
+		case REGION_CART1:
+		case REGION_CART1_EX:
+		case REGION_CART2:
+			wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
+			if ((address & (SIZE_CART0 - 1)) < memory->romSize) {
+				LOAD_16(value, address & (SIZE_CART0 - 2), memory->rom);
+			} else if (memory->mirroring && (address & memory->romMask) < memory->romSize) {
+				LOAD_16(value, address & memory->romMask, memory->rom);
+			} else if (memory->vfame.cartType) {
+				value = GBAVFameGetPatternValue(address, 16);
+			} else if ((address & (SIZE_CART0 - 1)) >= AGB_PRINT_BASE) {
+				uint32_t agbPrintAddr = address & 0x00FFFFFF;
+				if (agbPrintAddr == AGB_PRINT_PROTECT) {
+					value = memory->agbPrint;
+				} else if (agbPrintAddr < AGB_PRINT_TOP || (agbPrintAddr & 0x00FFFFF8) == (AGB_PRINT_STRUCT & 0x00FFFFF8)) {
+					value = _agbPrintLoad(gba, address);
+				} else {
+					mLOG(GBA_MEM, GAME_ERROR, "Out of bounds ROM Load16: 0x%08X", address);
+					value = (address >> 1) & 0xFFFF;
+				}
 			} else {
 				mLOG(GBA_MEM, GAME_ERROR, "Out of bounds ROM Load16: 0x%08X", address);
 				value = (address >> 1) & 0xFFFF;
 			}
-		} else {
-			mLOG(GBA_MEM, GAME_ERROR, "Out of bounds ROM Load16: 0x%08X", address);
-			value = (address >> 1) & 0xFFFF;
-		}
-		break;
-	case REGION_CART2_EX:
-		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
-		if (memory->savedata.type == SAVEDATA_EEPROM || memory->savedata.type == SAVEDATA_EEPROM512) {
-			value = GBASavedataReadEEPROM(&memory->savedata);
-		} else if ((address & (SIZE_CART0 - 1)) < memory->romSize) {
-			LOAD_16(value, address & (SIZE_CART0 - 2), memory->rom);
-		} else if (memory->mirroring && (address & memory->romMask) < memory->romSize) {
-			LOAD_16(value, address & memory->romMask, memory->rom);
-		} else if (memory->vfame.cartType) {
-			value = GBAVFameGetPatternValue(address, 16);
-		} else {
-			mLOG(GBA_MEM, GAME_ERROR, "Out of bounds ROM Load16: 0x%08X", address);
-			value = (address >> 1) & 0xFFFF;
+			break;
+		case REGION_CART2_EX:
+			wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
+			if (memory->savedata.type == SAVEDATA_EEPROM || memory->savedata.type == SAVEDATA_EEPROM512) {
+				value = GBASavedataReadEEPROM(&memory->savedata);
+			} else if ((address & (SIZE_CART0 - 1)) < memory->romSize) {
+				LOAD_16(value, address & (SIZE_CART0 - 2), memory->rom);
+			} else if (memory->mirroring && (address & memory->romMask) < memory->romSize) {
+				LOAD_16(value, address & memory->romMask, memory->rom);
+			} else if (memory->vfame.cartType) {
+				value = GBAVFameGetPatternValue(address, 16);
+			} else {
+				mLOG(GBA_MEM, GAME_ERROR, "Out of bounds ROM Load16: 0x%08X", address);
+				value = (address >> 1) & 0xFFFF;
+			}
+			break;
+		case REGION_CART_SRAM:
+		case REGION_CART_SRAM_MIRROR:
+			wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
+			value = GBALoad8(cpu, address, 0);
+			value |= value << 8;
+			break;
+		default:
+			mLOG(GBA_MEM, GAME_ERROR, "Bad memory Load16: 0x%08X", address);
+			LOAD_BAD;
+			value = (value >> ((address & 2) * 8)) & 0xFFFF;
+			break;
 		}
-		break;
-	case REGION_CART_SRAM:
-	case REGION_CART_SRAM_MIRROR:
-		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
-		value = GBALoad8(cpu, address, 0);
-		value |= value << 8;
-		break;
-	default:
-		mLOG(GBA_MEM, GAME_ERROR, "Bad memory Load16: 0x%08X", address);
-		LOAD_BAD;
-		value = (value >> ((address & 2) * 8)) & 0xFFFF;
-		break;
 	}
 
 	if (cycleCounter) {
@@ -598,6 +818,7 @@ uint32_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 			wait = GBAMemoryStall(cpu, wait);
 		}
 		*cycleCounter += wait;
+		COUNT_CYCLES(READ, wait);
 	}
 	// Unaligned 16-bit loads are "unpredictable", but the GBA rotates them, so we have to, too.
 	int rotate = (address & 1) << 3;
@@ -609,94 +830,101 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	struct GBAMemory* memory = &gba->memory;
 	uint32_t value = 0;
 	int wait = 0;
+	COUNT_ACCESSES(READ, address, 1);
 
-	switch (address >> BASE_OFFSET) {
-	case REGION_BIOS:
-		if (address < SIZE_BIOS) {
-			if (memory->activeRegion == REGION_BIOS) {
-				value = ((uint8_t*) memory->bios)[address];
+	const struct GBAMemoryPage* page = &memory->loadPages[address >> BASE_OFFSET];
+	if ((address & page->mask) < page->size) {
+		value = page->data[address & page->mask];
+		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
+	} else {
+		switch (address >> BASE_OFFSET) {
+		case REGION_BIOS:
+			if (address < SIZE_BIOS) {
+				if (memory->activeRegion == REGION_BIOS) {
+					value = ((uint8_t*) memory->bios)[address];
+				} else {
+					mLOG(GBA_MEM, GAME_ERROR, "Bad BIOS Load8: 0x%08X", address);
+					value = (memory->biosPrefetch >> ((address & 3) * 8)) & 0xFF;
+				}
 			} else {
-				mLOG(GBA_MEM, GAME_ERROR, "Bad BIOS Load8: 0x%08X", address);
-				value = (memory->biosPrefetch >> ((address & 3) * 8)) & 0xFF;
+				mLOG(GBA_MEM, GAME_ERROR, "Bad memory Load8: 0x%08x", address);
+				LOAD_BAD;
+				value = (value >> ((address & 3) * 8)) & 0xFF;
 			}
-		} else {
+			break;
+		case REGION_WORKING_RAM:
+			value = ((uint8_t*) memory->wram)[address & (SIZE_WORKING_RAM - 1)];
+			wait = memory->waitstatesNonseq16[REGION_WORKING_RAM];
+			break;
+		case REGION_WORKING_IRAM:
+			value = ((uint8_t*) memory->iwram)[address & (SIZE_WORKING_IRAM - 1)];
+			break;
+		case REGION_IO:
+			value = (GBAIORead(gba, address & 0xFFFE) >> ((address & 0x0001) << 3)) & 0xFF;
+			break;
+		case REGION_PALETTE_RAM:
+			value = ((uint8_t*) gba->video.palette)[address & (SIZE_PALETTE_RAM - 1)];
+			break;
+		case REGION_VRAM:
+			if ((address & 0x0001FFFF) >= SIZE_VRAM) {
+				if ((address & (SIZE_VRAM | 0x00014000)) == SIZE_VRAM && (GBARegisterDISPCNTGetMode(gba->memory.io[REG_DISPCNT >> 1]) >= 3)) {
+					mLOG(GBA_MEM, GAME_ERROR, "Bad VRAM Load8: 0x%08X", address);
+					value = 0;
+					break;
+				}
+				address &= 0x00017FFF;
+			}
+			value = ((uint8_t*) gba->video.vram)[address & 0x0001FFFF];
+			break;
+		case REGION_OAM:
+			value = ((uint8_t*) gba->video.oam.raw)[address & (SIZE_OAM - 1)];
+			break;
+		case REGION_CART0:
+		case REGION_CART0_EX:
+		case REGION_CART1:
+		case REGION_CART1_EX:
+		case REGION_CART2:
+		case REGION_CART2_EX:
+			wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
+			if ((address & (SIZE_CART0 - 1)) < memory->romSize) {
+				value = ((uint8_t*) memory->rom)[address & (SIZE_CART0 - 1)];
+			} else if (memory->mirroring && (address & memory->romMask) < memory->romSize) {
+				value = ((uint8_t*) memory->rom)[address & memory->romMask];
+			} else if (memory->vfame.cartType) {
+				value = GBAVFameGetPatternValue(address, 8);
+			} else {
+				mLOG(GBA_MEM, GAME_ERROR, "Out of bounds ROM Load8: 0x%08X", address);
+				value = (address >> 1) & 0xFF;
+			}
+			break;
+		case REGION_CART_SRAM:
+		case REGION_CART_SRAM_MIRROR:
+			wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
+			if (memory->savedata.type == SAVEDATA_AUTODETECT) {
+				mLOG(GBA_MEM, INFO, "Detected SRAM savegame");
+				GBASavedataInitSRAM(&memory->savedata);
+			}
+			if (gba->performingDMA == 1) {
+				break;
+			}
+			if (memory->savedata.type == SAVEDATA_SRAM) {
+				value = memory->savedata.data[address & (SIZE_CART_SRAM - 1)];
+			} else if (memory->savedata.type == SAVEDATA_FLASH512 || memory->savedata.type == SAVEDATA_FLASH1M) {
+				value = GBASavedataReadFlash(&memory->savedata, address);
+			} else if (memory->hw.devices & HW_TILT) {
+				value = GBAHardwareTiltRead(&memory->hw, address & OFFSET_MASK);
+			} else {
+				mLOG(GBA_MEM, GAME_ERROR, "Reading from non-existent SRAM: 0x%08X", address);
+				value = 0xFF;
+			}
+			value &= 0xFF;
+			break;
+		default:
 			mLOG(GBA_MEM, GAME_ERROR, "Bad memory Load8: 0x%08x", address);
 			LOAD_BAD;
 			value = (value >> ((address & 3) * 8)) & 0xFF;
-		}
-		break;
-	case REGION_WORKING_RAM:
-		value = ((uint8_t*) memory->wram)[address & (SIZE_WORKING_RAM - 1)];
-		wait = memory->waitstatesNonseq16[REGION_WORKING_RAM];
-		break;
-	case REGION_WORKING_IRAM:
-		value = ((uint8_t*) memory->iwram)[address & (SIZE_WORKING_IRAM - 1)];
-		break;
-	case REGION_IO:
-		value = (GBAIORead(gba, address & 0xFFFE) >> ((address & 0x0001) << 3)) & 0xFF;
-		break;
-	case REGION_PALETTE_RAM:
-		value = ((uint8_t*) gba->video.palette)[address & (SIZE_PALETTE_RAM - 1)];
-		break;
-	case REGION_VRAM:
-		if ((address & 0x0001FFFF) >= SIZE_VRAM) {
-			if ((address & (SIZE_VRAM | 0x00014000)) == SIZE_VRAM && (GBARegisterDISPCNTGetMode(gba->memory.io[REG_DISPCNT >> 1]) >= 3)) {
-				mLOG(GBA_MEM, GAME_ERROR, "Bad VRAM Load8: 0x%08X", address);
-				value = 0;
-				break;
-			}
-			address &= 0x00017FFF;
-		}
-		value = ((uint8_t*) gba->video.vram)[address & 0x0001FFFF];
-		break;
-	case REGION_OAM:
-		value = ((uint8_t*) gba->video.oam.raw)[address & (SIZE_OAM - 1)];
-		break;
-	case REGION_CART0:
-	case REGION_CART0_EX:
-	case REGION_CART1:
-	case REGION_CART1_EX:
-	case REGION_CART2:
-	case REGION_CART2_EX:
-		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
-		if ((address & (SIZE_CART0 - 1)) < memory->romSize) {
-			value = ((uint8_t*) memory->rom)[address & (SIZE_CART0 - 1)];
-		} else if (memory->mirroring && (address & memory->romMask) < memory->romSize) {
-			value = ((uint8_t*) memory->rom)[address & memory->romMask];
-		} else if (memory->vfame.cartType) {
-			value = GBAVFameGetPatternValue(address, 8);
-		} else {
-			mLOG(GBA_MEM, GAME_ERROR, "Out of bounds ROM Load8: 0x%08X", address);
-			value = (address >> 1) & 0xFF;
-		}
-		break;
-	case REGION_CART_SRAM:
-	case REGION_CART_SRAM_MIRROR:
-		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
-		if (memory->savedata.type == SAVEDATA_AUTODETECT) {
-			mLOG(GBA_MEM, INFO, "Detected SRAM savegame");
-			GBASavedataInitSRAM(&memory->savedata);
-		}
-		if (gba->performingDMA == 1) {
 			break;
 		}
-		if (memory->savedata.type == SAVEDATA_SRAM) {
-			value = memory->savedata.data[address & (SIZE_CART_SRAM - 1)];
-		} else if (memory->savedata.type == SAVEDATA_FLASH512 || memory->savedata.type == SAVEDATA_FLASH1M) {
-			value = GBASavedataReadFlash(&memory->savedata, address);
-		} else if (memory->hw.devices & HW_TILT) {
-			value = GBAHardwareTiltRead(&memory->hw, address & OFFSET_MASK);
-		} else {
-			mLOG(GBA_MEM, GAME_ERROR, "Reading from non-existent SRAM: 0x%08X", address);
-			value = 0xFF;
-		}
-		value &= 0xFF;
-		break;
-	default:
-		mLOG(GBA_MEM, GAME_ERROR, "Bad memory Load8: 0x%08x", address);
-		LOAD_BAD;
-		value = (value >> ((address & 3) * 8)) & 0xFF;
-		break;
 	}
 
 	if (cycleCounter) {
@@ -705,16 +933,19 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 			wait = GBAMemoryStall(cpu, wait);
 		}
 		*cycleCounter += wait;
+		COUNT_CYCLES(READ, wait);
 	}
 	return value;
 }
 
 #define STORE_WORKING_RAM \
 	STORE_32(value, address & (SIZE_WORKING_RAM - 4), memory->wram); \
+	mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_WORKING_RAM], address & (SIZE_WORKING_RAM - 4)); \
 	wait += waitstatesRegion[REGION_WORKING_RAM];
 
 #define STORE_WORKING_IRAM \
-	STORE_32(value, address & (SIZE_WORKING_IRAM - 4), memory->iwram);
+	STORE_32(value, address & (SIZE_WORKING_IRAM - 4), memory->iwram); \
+	mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_WORKING_IRAM], address & (SIZE_WORKING_IRAM - 4));
 
 #define STORE_IO \
 	GBAIOWrite32(gba, address & (OFFSET_MASK - 3), value);
@@ -723,6 +954,7 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	LOAD_32(oldValue, address & (SIZE_PALETTE_RAM - 4), gba->video.palette); \
 	if (oldValue != value) { \
 		STORE_32(value, address & (SIZE_PALETTE_RAM - 4), gba->video.palette); \
+		mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_PALETTE_RAM], address & (SIZE_PALETTE_RAM - 4)); \
 		gba->video.renderer->writePalette(gba->video.renderer, (address & (SIZE_PALETTE_RAM - 4)) + 2, value >> 16); \
 		gba->video.renderer->writePalette(gba->video.renderer, address & (SIZE_PALETTE_RAM - 4), value); \
 	} \
@@ -739,6 +971,7 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	LOAD_32(oldValue, address & 0x0001FFFC, gba->video.vram); \
 	if (oldValue != value) { \
 		STORE_32(value, address & 0x0001FFFC, gba->video.vram); \
+		mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_VRAM], address & 0x0001FFFC); \
 		gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x0001FFFC) + 2); \
 		gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x0001FFFC)); \
 	} \
@@ -748,6 +981,7 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	LOAD_32(oldValue, address & (SIZE_OAM - 4), gba->video.oam.raw); \
 	if (oldValue != value) { \
 		STORE_32(value, address & (SIZE_OAM - 4), gba->video.oam.raw); \
+		mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_OAM], address & (SIZE_OAM - 4)); \
 		gba->video.renderer->writeOAM(gba->video.renderer, (address & (SIZE_OAM - 4)) >> 1); \
 		gba->video.renderer->writeOAM(gba->video.renderer, ((address & (SIZE_OAM - 4)) >> 1) + 1); \
 	}
@@ -777,43 +1011,51 @@ void GBAStore32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycle
 	struct GBA* gba = (struct GBA*) cpu->master;
 	struct GBAMemory* memory = &gba->memory;
 	int wait = 0;
+	COUNT_ACCESSES(WRITE, address, 1);
 	int32_t oldValue;
 	char* waitstatesRegion = memory->waitstatesNonseq32;
 
-	switch (address >> BASE_OFFSET) {
-	case REGION_WORKING_RAM:
-		STORE_WORKING_RAM;
-		break;
-	case REGION_WORKING_IRAM:
-		STORE_WORKING_IRAM
-		break;
-	case REGION_IO:
-		STORE_IO;
-		break;
-	case REGION_PALETTE_RAM:
-		STORE_PALETTE_RAM;
-		break;
-	case REGION_VRAM:
-		STORE_VRAM;
-		break;
-	case REGION_OAM:
-		STORE_OAM;
-		break;
-	case REGION_CART0:
-	case REGION_CART0_EX:
-	case REGION_CART1:
-	case REGION_CART1_EX:
-	case REGION_CART2:
-	case REGION_CART2_EX:
-		STORE_CART;
-		break;
-	case REGION_CART_SRAM:
-	case REGION_CART_SRAM_MIRROR:
-		STORE_SRAM;
-		break;
-	default:
-		STORE_BAD;
-		break;
+	const struct GBAMemoryPage* page = &memory->storePages[address >> BASE_OFFSET];
+	if ((address & page->mask) < page->size) {
+		STORE_32(value, address & page->mask & -4, page->data);
+		mCoreMemoryDirtyMark(&memory->dirtyPages[address >> BASE_OFFSET], address & page->mask & -4);
+		wait = memory->waitstatesNonseq32[address >> BASE_OFFSET];
+	} else {
+		switch (address >> BASE_OFFSET) {
+		case REGION_WORKING_RAM:
+			STORE_WORKING_RAM;
+			break;
+		case REGION_WORKING_IRAM:
+			STORE_WORKING_IRAM
+			break;
+		case REGION_IO:
+			STORE_IO;
+			break;
+		case REGION_PALETTE_RAM:
+			STORE_PALETTE_RAM;
+			break;
+		case REGION_VRAM:
+			STORE_VRAM;
+			break;
+		case REGION_OAM:
+			STORE_OAM;
+			break;
+		case REGION_CART0:
+		case REGION_CART0_EX:
+		case REGION_CART1:
+		case REGION_CART1_EX:
+		case REGION_CART2:
+		case REGION_CART2_EX:
+			STORE_CART;
+			break;
+		case REGION_CART_SRAM:
+		case REGION_CART_SRAM_MIRROR:
+			STORE_SRAM;
+			break;
+		default:
+			STORE_BAD;
+			break;
+		}
 	}
 
 	if (cycleCounter) {
@@ -822,6 +1064,7 @@ void GBAStore32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycle
 			wait = GBAMemoryStall(cpu, wait);
 		}
 		*cycleCounter += wait;
+		COUNT_CYCLES(WRITE, wait);
 	}
 }
 
@@ -829,92 +1072,105 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 	struct GBA* gba = (struct GBA*) cpu->master;
 	struct GBAMemory* memory = &gba->memory;
 	int wait = 0;
+	COUNT_ACCESSES(WRITE, address, 1);
 	int16_t oldValue;
 
-	switch (address >> BASE_OFFSET) {
-	case REGION_WORKING_RAM:
-		STORE_16(value, address & (SIZE_WORKING_RAM - 2), memory->wram);
-		wait = memory->waitstatesNonseq16[REGION_WORKING_RAM];
-		break;
-	case REGION_WORKING_IRAM:
-		STORE_16(value, address & (SIZE_WORKING_IRAM - 2), memory->iwram);
-		break;
-	case REGION_IO:
-		GBAIOWrite(gba, address & (OFFSET_MASK - 1), value);
-		break;
-	case REGION_PALETTE_RAM:
-		LOAD_16(oldValue, address & (SIZE_PALETTE_RAM - 2), gba->video.palette);
-		if (oldValue != value) {
-			STORE_16(value, address & (SIZE_PALETTE_RAM - 2), gba->video.palette);
-			gba->video.renderer->writePalette(gba->video.renderer, address & (SIZE_PALETTE_RAM - 2), value);
-		}
-		break;
-	case REGION_VRAM:
-		if ((address & 0x0001FFFF) >= SIZE_VRAM) {
-			if ((address & (SIZE_VRAM | 0x00014000)) == SIZE_VRAM && (GBARegisterDISPCNTGetMode(gba->memory.io[REG_DISPCNT >> 1]) >= 3)) {
-				mLOG(GBA_MEM, GAME_ERROR, "Bad VRAM Store16: 0x%08X", address);
-				break;
+	const struct GBAMemoryPage* page = &memory->storePages[address >> BASE_OFFSET];
+	if ((address & page->mask) < page->size) {
+		STORE_16(value, address & page->mask & -2, page->data);
+		mCoreMemoryDirtyMark(&memory->dirtyPages[address >> BASE_OFFSET], address & page->mask & -2);
+		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
+	} else {
+		switch (address >> BASE_OFFSET) {
+		case REGION_WORKING_RAM:
+			STORE_16(value, address & (SIZE_WORKING_RAM - 2), memory->wram);
+			mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_WORKING_RAM], address & (SIZE_WORKING_RAM - 2));
+			wait = memory->waitstatesNonseq16[REGION_WORKING_RAM];
+			break;
+		case REGION_WORKING_IRAM:
+			STORE_16(value, address & (SIZE_WORKING_IRAM - 2), memory->iwram);
+			mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_WORKING_IRAM], address & (SIZE_WORKING_IRAM - 2));
+			break;
+		case REGION_IO:
+			GBAIOWrite(gba, address & (OFFSET_MASK - 1), value);
+			break;
+		case REGION_PALETTE_RAM:
+			LOAD_16(oldValue, address & (SIZE_PALETTE_RAM - 2), gba->video.palette);
+			if (oldValue != value) {
+				STORE_16(value, address & (SIZE_PALETTE_RAM - 2), gba->video.palette);
+				mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_PALETTE_RAM], address & (SIZE_PALETTE_RAM - 2));
+				gba->video.renderer->writePalette(gba->video.renderer, address & (SIZE_PALETTE_RAM - 2), value);
 			}
-			address &= 0x00017FFE;
-		}
-		LOAD_16(oldValue, address & 0x0001FFFE, gba->video.vram);
-		if (value != oldValue) {
-			STORE_16(value, address & 0x0001FFFE, gba->video.vram);
-			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFE);
-		}
-		break;
-	case REGION_OAM:
-		LOAD_16(oldValue, address & (SIZE_OAM - 2), gba->video.oam.raw);
-		if (value != oldValue) {
-			STORE_16(value, address & (SIZE_OAM - 2), gba->video.oam.raw);
-			gba->video.renderer->writeOAM(gba->video.renderer, (address & (SIZE_OAM - 2)) >> 1);
-		}
-		break;
-	case REGION_CART0:
-		if (memory->hw.devices != HW_NONE && IS_GPIO_REGISTER(address & 0xFFFFFE)) {
-			uint32_t reg = address & 0xFFFFFE;
-			GBAHardwareGPIOWrite(&memory->hw, reg, value);
 			break;
-		}
-		if (memory->matrix.size && (address & 0x01FFFF00) == 0x00800100) {
-			GBAMatrixWrite16(gba, address & 0x3C, value);
+		case REGION_VRAM:
+			if ((address & 0x0001FFFF) >= SIZE_VRAM) {
+				if ((address & (SIZE_VRAM | 0x00014000)) == SIZE_VRAM && (GBARegisterDISPCNTGetMode(gba->memory.io[REG_DISPCNT >> 1]) >= 3)) {
+					mLOG(GBA_MEM, GAME_ERROR, "Bad VRAM Store16: 0x%08X", address);
+					break;
+				}
+				address &= 0x00017FFE;
+			}
+			LOAD_16(oldValue, address & 0x0001FFFE, gba->video.vram);
+			if (value != oldValue) {
+				STORE_16(value, address & 0x0001FFFE, gba->video.vram);
+				mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_VRAM], address & 0x0001FFFE);
+				gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFE);
+			}
 			break;
-		}
-		// Fall through
-	case REGION_CART0_EX:
-		if ((address & 0x00FFFFFF) >= AGB_PRINT_BASE) {
-			uint32_t agbPrintAddr = address & 0x00FFFFFF;
-			if (agbPrintAddr == AGB_PRINT_PROTECT) {
-				memory->agbPrint = value;
-				_agbPrintStore(gba, address, value);
+		case REGION_OAM:
+			LOAD_16(oldValue, address & (SIZE_OAM - 2), gba->video.oam.raw);
+			if (value != oldValue) {
+				STORE_16(value, address & (SIZE_OAM - 2), gba->video.oam.raw);
+				mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_OAM], address & (SIZE_OAM - 2));
+				gba->video.renderer->writeOAM(gba->video.renderer, (address & (SIZE_OAM - 2)) >> 1);
+			}
+			break;
+		case REGION_CART0:
+			if (memory->hw.devices != HW_NONE && IS_GPIO_REGISTER(address & 0xFFFFFE)) {
+				uint32_t reg = address & 0xFFFFFE;
+				GBAHardwareGPIOWrite(&memory->hw, reg, value);
 				break;
 			}
-			if (memory->agbPrint == 0x20 && (agbPrintAddr < AGB_PRINT_TOP || (agbPrintAddr & 0x00FFFFF8) == (AGB_PRINT_STRUCT & 0x00FFFFF8))) {
-				_agbPrintStore(gba, address, value);
+			if (memory->matrix.size && (address & 0x01FFFF00) == 0x00800100) {
+				GBAMatrixWrite16(gba, address & 0x3C, value);
 				break;
 			}
-		}
-		mLOG(GBA_MEM, GAME_ERROR, "Bad cartridge Store16: 0x%08X", address);
-		break;
-	case REGION_CART2_EX:
-		if (memory->savedata.type == SAVEDATA_AUTODETECT) {
-			mLOG(GBA_MEM, INFO, "Detected EEPROM savegame");
-			GBASavedataInitEEPROM(&memory->savedata);
-		}
-		if (memory->savedata.type == SAVEDATA_EEPROM512 || memory->savedata.type == SAVEDATA_EEPROM) {
-			GBASavedataWriteEEPROM(&memory->savedata, value, 1);
+			// Fall through
+		case REGION_CART0_EX:
+			if ((address & 0x00FFFFFF) >= AGB_PRINT_BASE) {
+				uint32_t agbPrintAddr = address & 0x00FFFFFF;
+				if (agbPrintAddr == AGB_PRINT_PROTECT) {
+					memory->agbPrint = value;
+					_agbPrintStore(gba, address, value);
+					break;
+				}
+				if (memory->agbPrint == 0x20 && (agbPrintAddr < AGB_PRINT_TOP || (agbPrintAddr & 0x00FFFFF8) == (AGB_PRINT_STRUCT & 0x00FFFFF8))) {
+					_agbPrintStore(gba, address, value);
+					break;
+				}
+			}
+			mLOG(GBA_MEM, GAME_ERROR, "Bad cartridge Store16: 0x%08X", address);
+			break;
+		case REGION_CART2_EX:
+			if (memory->savedata.type == SAVEDATA_AUTODETECT) {
+				mLOG(GBA_MEM, INFO, "Detected EEPROM savegame");
+				GBASavedataInitEEPROM(&memory->savedata);
+			}
+			if (memory->savedata.type == SAVEDATA_EEPROM512 || memory->savedata.type == SAVEDATA_EEPROM) {
+				GBASavedataWriteEEPROM(&memory->savedata, value, 1);
+				break;
+			}
+			mLOG(GBA_MEM, GAME_ERROR, "Bad memory Store16: 0x%08X", address);
+			break;
+		case REGION_CART_SRAM:
+		case REGION_CART_SRAM_MIRROR:
+			GBAStore8(cpu, (address & ~0x1), value, cycleCounter);
+			GBAStore8(cpu, (address & ~0x1) | 1, value, cycleCounter);
+			break;
+		default:
+			mLOG(GBA_MEM, GAME_ERROR, "Bad memory Store16: 0x%08X", address);
 			break;
 		}
-		mLOG(GBA_MEM, GAME_ERROR, "Bad memory Store16: 0x%08X", address);
-		break;
-	case REGION_CART_SRAM:
-	case REGION_CART_SRAM_MIRROR:
-		GBAStore8(cpu, (address & ~0x1), value, cycleCounter);
-		GBAStore8(cpu, (address & ~0x1) | 1, value, cycleCounter);
-		break;
-	default:
-		mLOG(GBA_MEM, GAME_ERROR, "Bad memory Store16: 0x%08X", address);
-		break;
 	}
 
 	if (cycleCounter) {
@@ -923,6 +1179,7 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 			wait = GBAMemoryStall(cpu, wait);
 		}
 		*cycleCounter += wait;
+		COUNT_CYCLES(WRITE, wait);
 	}
 }
 
@@ -930,69 +1187,85 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 	struct GBA* gba = (struct GBA*) cpu->master;
 	struct GBAMemory* memory = &gba->memory;
 	int wait = 0;
+	COUNT_ACCESSES(WRITE, address, 1);
 	uint16_t oldValue;
 
-	switch (address >> BASE_OFFSET) {
-	case REGION_WORKING_RAM:
-		((int8_t*) memory->wram)[address & (SIZE_WORKING_RAM - 1)] = value;
-		wait = memory->waitstatesNonseq16[REGION_WORKING_RAM];
-		break;
-	case REGION_WORKING_IRAM:
-		((int8_t*) memory->iwram)[address & (SIZE_WORKING_IRAM - 1)] = value;
-		break;
-	case REGION_IO:
-		GBAIOWrite8(gba, address & OFFSET_MASK, value);
-		break;
-	case REGION_PALETTE_RAM:
-		GBAStore16(cpu, address & ~1, ((uint8_t) value) | ((uint8_t) value << 8), cycleCounter);
-		break;
-	case REGION_VRAM:
-		if ((address & 0x0001FFFF) >= ((GBARegisterDISPCNTGetMode(gba->memory.io[REG_DISPCNT >> 1]) >= 3) ? 0x00014000 : 0x00010000)) {
-			mLOG(GBA_MEM, GAME_ERROR, "Cannot Store8 to OBJ: 0x%08X", address);
+	const struct GBAMemoryPage* page = &memory->storePages[address >> BASE_OFFSET];
+	if ((address & page->mask) < page->size) {
+		page->data[address & page->mask] = value;
+		mCoreMemoryDirtyMark(&memory->dirtyPages[address >> BASE_OFFSET], address & page->mask);
+		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
+	} else {
+		switch (address >> BASE_OFFSET) {
+		case REGION_WORKING_RAM:
+			((int8_t*) memory->wram)[address & (SIZE_WORKING_RAM - 1)] = value;
+			mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_WORKING_RAM], address & (SIZE_WORKING_RAM - 1));
+			wait = memory->waitstatesNonseq16[REGION_WORKING_RAM];
 			break;
-		}
-		oldValue = gba->video.renderer->vram[(address & 0x1FFFE) >> 1];
-		if (oldValue != (((uint8_t) value) | (value << 8))) {
-			gba->video.renderer->vram[(address & 0x1FFFE) >> 1] = ((uint8_t) value) | (value << 8);
-			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFE);
-		}
-		break;
-	case REGION_OAM:
-		mLOG(GBA_MEM, GAME_ERROR, "Cannot Store8 to OAM: 0x%08X", address);
-		break;
-	case REGION_CART0:
-		mLOG(GBA_MEM, STUB, "Unimplemented memory Store8: 0x%08X", address);
-		break;
-	case REGION_CART_SRAM:
-	case REGION_CART_SRAM_MIRROR:
-		if (memory->savedata.type == SAVEDATA_AUTODETECT) {
-			if (address == SAVEDATA_FLASH_BASE) {
-				mLOG(GBA_MEM, INFO, "Detected Flash savegame");
-				GBASavedataInitFlash(&memory->savedata);
-			} else {
-				mLOG(GBA_MEM, INFO, "Detected SRAM savegame");
-				GBASavedataInitSRAM(&memory->savedata);
+		case REGION_WORKING_IRAM:
+			((int8_t*) memory->iwram)[address & (SIZE_WORKING_IRAM - 1)] = value;
+			mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_WORKING_IRAM], address & (SIZE_WORKING_IRAM - 1));
+			break;
+		case REGION_IO:
+			GBAIOWrite8(gba, address & OFFSET_MASK, value);
+			break;
+		case REGION_PALETTE_RAM:
+			GBAStore16(cpu, address & ~1, ((uint8_t) value) | ((uint8_t) value << 8), cycleCounter);
+			break;
+		case REGION_VRAM:
+			if ((address & 0x0001FFFF) >= ((GBARegisterDISPCNTGetMode(gba->memory.io[REG_DISPCNT >> 1]) >= 3) ? 0x00014000 : 0x00010000)) {
+				mLOG(GBA_MEM, GAME_ERROR, "Cannot Store8 to OBJ: 0x%08X", address);
+				break;
 			}
-		}
-		if (memory->savedata.type == SAVEDATA_FLASH512 || memory->savedata.type == SAVEDATA_FLASH1M) {
-			GBASavedataWriteFlash(&memory->savedata, address, value);
-		} else if (memory->savedata.type == SAVEDATA_SRAM) {
-			if (memory->vfame.cartType) {
-				GBAVFameSramWrite(&memory->vfame, address, value, memory->savedata.data);
+			oldValue = gba->video.renderer->vram[(address & 0x1FFFE) >> 1];
+			if (oldValue != (((uint8_t) value) | (value << 8))) {
+				gba->video.renderer->vram[(address & 0x1FFFE) >> 1] = ((uint8_t) value) | (value << 8);
+				mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_VRAM], address & 0x0001FFFE);
+				gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFE);
+			}
+			break;
+		case REGION_OAM:
+			mLOG(GBA_MEM, GAME_ERROR, "Cannot Store8 to OAM: 0x%08X", address);
+			break;
+		case REGION_CART0:
+			mLOG(GBA_MEM, STUB, "Unimplemented memory Store8: 0x%08X", address);
+			break;
+		case REGION_CART_SRAM:
+		case REGION_CART_SRAM_MIRROR:
+			if (memory->savedata.type == SAVEDATA_AUTODETECT) {
+				if (address == SAVEDATA_FLASH_BASE) {
+					mLOG(GBA_MEM, INFO, "Detected Flash savegame");
+					GBASavedataInitFlash(&memory->savedata);
+				} else {
+					mLOG(GBA_MEM, INFO, "Detected SRAM savegame");
+					GBASavedataInitSRAM(&memory->savedata);
+				}
+			}
+			if (memory->savedata.type == SAVEDATA_FLASH512 || memory->savedata.type == SAVEDATA_FLASH1M) {
+				GBASavedataWriteFlash(&memory->savedata, address, value);
+			} else if (memory->savedata.type == SAVEDATA_SRAM) {
+				if (memory->vfame.cartType) {
+					GBAVFameSramWrite(&memory->vfame, address, value, memory->savedata.data);
+					// Vast Fame carts scramble the address, so the written page is not known here
+					mCoreMemoryDirtyMarkAll(&memory->dirtyPages[REGION_CART_SRAM]);
+					memory->savedata.dirtySectors = mSAVEDATA_SECTORS_ALL;
+				} else {
+					memory->savedata.data[address & (SIZE_CART_SRAM - 1)] = value;
+					mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_CART_SRAM], address & (SIZE_CART_SRAM - 1));
+					memory->savedata.dirtySectors |= mSavedataSector(address & (SIZE_CART_SRAM - 1));
+				}
+				memory->savedata.dirty |= SAVEDATA_DIRT_NEW;
+			} else if (memory->hw.devices & HW_TILT) {
+				GBAHardwareTiltWrite(&memory->hw, address & OFFSET_MASK, value);
 			} else {
-				memory->savedata.data[address & (SIZE_CART_SRAM - 1)] = value;
+				mLOG(GBA_MEM, GAME_ERROR, "Writing to non-existent SRAM: 0x%08X", address);
 			}
-			memory->savedata.dirty |= SAVEDATA_DIRT_NEW;
-		} else if (memory->hw.devices & HW_TILT) {
-			GBAHardwareTiltWrite(&memory->hw, address & OFFSET_MASK, value);
-		} else {
-			mLOG(GBA_MEM, GAME_ERROR, "Writing to non-existent SRAM: 0x%08X", address);
+			wait = memory->waitstatesNonseq16[REGION_CART_SRAM];
+			break;
+		default:
+			mLOG(GBA_MEM, GAME_ERROR, "Bad memory Store8: 0x%08X", address);
+			break;
 		}
-		wait = memory->waitstatesNonseq16[REGION_CART_SRAM];
-		break;
-	default:
-		mLOG(GBA_MEM, GAME_ERROR, "Bad memory Store8: 0x%08X", address);
-		break;
 	}
 
 	if (cycleCounter) {
@@ -1001,6 +1274,7 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 			wait = GBAMemoryStall(cpu, wait);
 		}
 		*cycleCounter += wait;
+		COUNT_CYCLES(WRITE, wait);
 	}
 }
 
@@ -1115,6 +1389,34 @@ uint8_t GBAView8(struct ARMCore* cpu, uint32_t address) {
 	return value;
 }
 
+static void _markPatched(struct GBAMemory* memory, uint32_t address) {
+	switch (address >> BASE_OFFSET) {
+	case REGION_WORKING_RAM:
+		mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_WORKING_RAM], address & (SIZE_WORKING_RAM - 1));
+		break;
+	case REGION_WORKING_IRAM:
+		mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_WORKING_IRAM], address & (SIZE_WORKING_IRAM - 1));
+		break;
+	case REGION_PALETTE_RAM:
+		mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_PALETTE_RAM], address & (SIZE_PALETTE_RAM - 1));
+		break;
+	case REGION_VRAM:
+		if ((address & 0x0001FFFF) < SIZE_VRAM) {
+			mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_VRAM], address & 0x0001FFFF);
+		} else {
+			mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_VRAM], address & 0x00017FFF);
+		}
+		break;
+	case REGION_OAM:
+		mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_OAM], address & (SIZE_OAM - 1));
+		break;
+	case REGION_CART_SRAM:
+	case REGION_CART_SRAM_MIRROR:
+		mCoreMemoryDirtyMark(&memory->dirtyPages[REGION_CART_SRAM], address & (SIZE_CART_SRAM - 1));
+		break;
+	}
+}
+
 void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* old) {
 	struct GBA* gba = (struct GBA*) cpu->master;
 	struct GBAMemory* memory = &gba->memory;
@@ -1159,10 +1461,11 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 	case REGION_CART1_EX:
 	case REGION_CART2:
 	case REGION_CART2_EX:
-		_pristineCow(gba);
+		GBAPristineCow(gba);
 		if ((address & (SIZE_CART0 - 4)) >= gba->memory.romSize) {
 			gba->memory.romSize = (address & (SIZE_CART0 - 4)) + 4;
 			gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
+			GBAMemoryUpdatePages(gba);
 		}
 		LOAD_32(oldValue, address & (SIZE_CART0 - 4), gba->memory.rom);
 		STORE_32(value, address & (SIZE_CART0 - 4), gba->memory.rom);
@@ -1172,6 +1475,7 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 		if (memory->savedata.type == SAVEDATA_SRAM) {
 			LOAD_32(oldValue, address & (SIZE_CART_SRAM - 4), memory->savedata.data);
 			STORE_32(value, address & (SIZE_CART_SRAM - 4), memory->savedata.data);
+			memory->savedata.dirtySectors |= mSavedataSector(address & (SIZE_CART_SRAM - 4));
 		} else {
 			mLOG(GBA_MEM, GAME_ERROR, "Writing to non-existent SRAM: 0x%08X", address);
 		}
@@ -1180,6 +1484,7 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 		mLOG(GBA_MEM, WARN, "Bad memory Patch16: 0x%08X", address);
 		break;
 	}
+	_markPatched(memory, address);
 	if (old) {
 		*old = oldValue;
 	}
@@ -1227,10 +1532,11 @@ void GBAPatch16(struct ARMCore* cpu, uint32_t address, int16_t value, int16_t* o
 	case REGION_CART1_EX:
 	case REGION_CART2:
 	case REGION_CART2_EX:
-		_pristineCow(gba);
+		GBAPristineCow(gba);
 		if ((address & (SIZE_CART0 - 1)) >= gba->memory.romSize) {
 			gba->memory.romSize = (address & (SIZE_CART0 - 2)) + 2;
 			gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
+			GBAMemoryUpdatePages(gba);
 		}
 		LOAD_16(oldValue, address & (SIZE_CART0 - 2), gba->memory.rom);
 		STORE_16(value, address & (SIZE_CART0 - 2), gba->memory.rom);
@@ -1240,6 +1546,7 @@ void GBAPatch16(struct ARMCore* cpu, uint32_t address, int16_t value, int16_t* o
 		if (memory->savedata.type == SAVEDATA_SRAM) {
 			LOAD_16(oldValue, address & (SIZE_CART_SRAM - 2), memory->savedata.data);
 			STORE_16(value, address & (SIZE_CART_SRAM - 2), memory->savedata.data);
+			memory->savedata.dirtySectors |= mSavedataSector(address & (SIZE_CART_SRAM - 2));
 		} else {
 			mLOG(GBA_MEM, GAME_ERROR, "Writing to non-existent SRAM: 0x%08X", address);
 		}
@@ -1248,6 +1555,7 @@ void GBAPatch16(struct ARMCore* cpu, uint32_t address, int16_t value, int16_t* o
 		mLOG(GBA_MEM, WARN, "Bad memory Patch16: 0x%08X", address);
 		break;
 	}
+	_markPatched(memory, address);
 	if (old) {
 		*old = oldValue;
 	}
@@ -1285,10 +1593,11 @@ void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old)
 	case REGION_CART1_EX:
 	case REGION_CART2:
 	case REGION_CART2_EX:
-		_pristineCow(gba);
+		GBAPristineCow(gba);
 		if ((address & (SIZE_CART0 - 1)) >= gba->memory.romSize) {
 			gba->memory.romSize = (address & (SIZE_CART0 - 2)) + 2;
 			gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
+			GBAMemoryUpdatePages(gba);
 		}
 		oldValue = ((int8_t*) memory->rom)[address & (SIZE_CART0 - 1)];
 		((int8_t*) memory->rom)[address & (SIZE_CART0 - 1)] = value;
@@ -1298,6 +1607,7 @@ void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old)
 		if (memory->savedata.type == SAVEDATA_SRAM) {
 			oldValue = ((int8_t*) memory->savedata.data)[address & (SIZE_CART_SRAM - 1)];
 			((int8_t*) memory->savedata.data)[address & (SIZE_CART_SRAM - 1)] = value;
+			memory->savedata.dirtySectors |= mSavedataSector(address & (SIZE_CART_SRAM - 1));
 		} else {
 			mLOG(GBA_MEM, GAME_ERROR, "Writing to non-existent SRAM: 0x%08X", address);
 		}
@@ -1306,6 +1616,7 @@ void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old)
 		mLOG(GBA_MEM, WARN, "Bad memory Patch8: 0x%08X", address);
 		break;
 	}
+	_markPatched(memory, address);
 	if (old) {
 		*old = oldValue;
 	}
@@ -1364,44 +1675,61 @@ uint32_t GBALoadMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum L
 		address &= 0xFFFFFFFC;
 	}
 	int wait = memory->waitstatesSeq32[region] - memory->waitstatesNonseq32[region];
-
-	switch (region) {
-	case REGION_BIOS:
-		LDM_LOOP(LOAD_BIOS);
-		break;
-	case REGION_WORKING_RAM:
-		LDM_LOOP(LOAD_WORKING_RAM);
-		break;
-	case REGION_WORKING_IRAM:
-		LDM_LOOP(LOAD_WORKING_IRAM);
-		break;
-	case REGION_IO:
-		LDM_LOOP(LOAD_IO);
-		break;
-	case REGION_PALETTE_RAM:
-		LDM_LOOP(LOAD_PALETTE_RAM);
-		break;
-	case REGION_VRAM:
-		LDM_LOOP(LOAD_VRAM);
-		break;
-	case REGION_OAM:
-		LDM_LOOP(LOAD_OAM);
-		break;
-	case REGION_CART0:
-	case REGION_CART0_EX:
-	case REGION_CART1:
-	case REGION_CART1_EX:
-	case REGION_CART2:
-	case REGION_CART2_EX:
-		LDM_LOOP(LOAD_CART);
-		break;
-	case REGION_CART_SRAM:
-	case REGION_CART_SRAM_MIRROR:
-		LDM_LOOP(LOAD_SRAM);
-		break;
-	default:
-		LDM_LOOP(LOAD_BAD);
-		break;
+	COUNT_ACCESSES(READ, address, popcount32(mask));
+
+	// Transfers that stay inside one directly mapped page skip the per-register dispatch
+	const struct GBAMemoryPage* page = &memory->loadPages[region];
+	uint32_t start = address & page->mask;
+	uint32_t length = popcount32(mask) << 2;
+	if (page->size && start + length <= page->size) {
+		const uint8_t* data = &page->data[start];
+		for (i = 0; i < 16; ++i) {
+			if (mask & (1 << i)) {
+				LOAD_32(cpu->gprs[i], 0, data);
+				data += 4;
+			}
+		}
+		wait += (length >> 2) * (memory->waitstatesSeq32[region] + 1);
+		address += length;
+	} else {
+		switch (region) {
+		case REGION_BIOS:
+			LDM_LOOP(LOAD_BIOS);
+			break;
+		case REGION_WORKING_RAM:
+			LDM_LOOP(LOAD_WORKING_RAM);
+			break;
+		case REGION_WORKING_IRAM:
+			LDM_LOOP(LOAD_WORKING_IRAM);
+			break;
+		case REGION_IO:
+			LDM_LOOP(LOAD_IO);
+			break;
+		case REGION_PALETTE_RAM:
+			LDM_LOOP(LOAD_PALETTE_RAM);
+			break;
+		case REGION_VRAM:
+			LDM_LOOP(LOAD_VRAM);
+			break;
+		case REGION_OAM:
+			LDM_LOOP(LOAD_OAM);
+			break;
+		case REGION_CART0:
+		case REGION_CART0_EX:
+		case REGION_CART1:
+		case REGION_CART1_EX:
+		case REGION_CART2:
+		case REGION_CART2_EX:
+			LDM_LOOP(LOAD_CART);
+			break;
+		case REGION_CART_SRAM:
+		case REGION_CART_SRAM_MIRROR:
+			LDM_LOOP(LOAD_SRAM);
+			break;
+		default:
+			LDM_LOOP(LOAD_BAD);
+			break;
+		}
 	}
 
 	if (cycleCounter) {
@@ -1410,6 +1738,7 @@ uint32_t GBALoadMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum L
 			wait = GBAMemoryStall(cpu, wait);
 		}
 		*cycleCounter += wait;
+		COUNT_CYCLES(READ, wait);
 	}
 
 	if (direction & LSM_B) {
@@ -1480,41 +1809,64 @@ uint32_t GBAStoreMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum
 		address &= 0xFFFFFFFC;
 	}
 	int wait = memory->waitstatesSeq32[region] - memory->waitstatesNonseq32[region];
-
-	switch (region) {
-	case REGION_WORKING_RAM:
-		STM_LOOP(STORE_WORKING_RAM);
-		break;
-	case REGION_WORKING_IRAM:
-		STM_LOOP(STORE_WORKING_IRAM);
-		break;
-	case REGION_IO:
-		STM_LOOP(STORE_IO);
-		break;
-	case REGION_PALETTE_RAM:
-		STM_LOOP(STORE_PALETTE_RAM);
-		break;
-	case REGION_VRAM:
-		STM_LOOP(STORE_VRAM);
-		break;
-	case REGION_OAM:
-		STM_LOOP(STORE_OAM);
-		break;
-	case REGION_CART0:
-	case REGION_CART0_EX:
-	case REGION_CART1:
-	case REGION_CART1_EX:
-	case REGION_CART2:
-	case REGION_CART2_EX:
-		STM_LOOP(STORE_CART);
-		break;
-	case REGION_CART_SRAM:
-	case REGION_CART_SRAM_MIRROR:
-		STM_LOOP(STORE_SRAM);
-		break;
-	default:
-		STM_LOOP(STORE_BAD);
-		break;
+	COUNT_ACCESSES(WRITE, address, popcount32(mask));
+
+	const struct GBAMemoryPage* page = &memory->storePages[region];
+	uint32_t start = address & page->mask;
+	uint32_t length = popcount32(mask) << 2;
+	if (page->size && length && start + length <= page->size) {
+		uint8_t* data = &page->data[start];
+		for (i = 0; i < 16; ++i) {
+			if (mask & (1 << i)) {
+				value = cpu->gprs[i];
+				if (i == ARM_PC) {
+					value += WORD_SIZE_ARM;
+				}
+				STORE_32(value, 0, data);
+				data += 4;
+			}
+		}
+		// At most 64 bytes are written, so only the first and last words can land in different dirty pages
+		mCoreMemoryDirtyMark(&memory->dirtyPages[region], start);
+		mCoreMemoryDirtyMark(&memory->dirtyPages[region], start + length - 4);
+		wait += (length >> 2) * (memory->waitstatesSeq32[region] + 1);
+		address += length;
+	} else {
+		switch (region) {
+		case REGION_WORKING_RAM:
+			STM_LOOP(STORE_WORKING_RAM);
+			break;
+		case REGION_WORKING_IRAM:
+			STM_LOOP(STORE_WORKING_IRAM);
+			break;
+		case REGION_IO:
+			STM_LOOP(STORE_IO);
+			break;
+		case REGION_PALETTE_RAM:
+			STM_LOOP(STORE_PALETTE_RAM);
+			break;
+		case REGION_VRAM:
+			STM_LOOP(STORE_VRAM);
+			break;
+		case REGION_OAM:
+			STM_LOOP(STORE_OAM);
+			break;
+		case REGION_CART0:
+		case REGION_CART0_EX:
+		case REGION_CART1:
+		case REGION_CART1_EX:
+		case REGION_CART2:
+		case REGION_CART2_EX:
+			STM_LOOP(STORE_CART);
+			break;
+		case REGION_CART_SRAM:
+		case REGION_CART_SRAM_MIRROR:
+			STM_LOOP(STORE_SRAM);
+			break;
+		default:
+			STM_LOOP(STORE_BAD);
+			break;
+		}
 	}
 
 	if (cycleCounter) {
@@ -1522,6 +1874,7 @@ uint32_t GBAStoreMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum
 			wait = GBAMemoryStall(cpu, wait);
 		}
 		*cycleCounter += wait;
+		COUNT_CYCLES(WRITE, wait);
 	}
 
 	if (direction & LSM_B) {
@@ -1583,6 +1936,7 @@ int32_t GBAMemoryStall(struct ARMCore* cpu, int32_t wait) {
 
 	if (memory->activeRegion < REGION_CART0 || !memory->prefetch) {
 		// The wait is the stall
+		COUNT_STALL(wait);
 		return wait;
 	}
 
@@ -1590,7 +1944,7 @@ int32_t GBAMemoryStall(struct ARMCore* cpu, int32_t wait) {
 
 	// Don't prefetch too much if we're overlapping with a previous prefetch
 	uint32_t dist = (memory->lastPrefetchedPc - cpu->gprs[ARM_PC]);
-	int32_t maxLoads = 8;
+	int32_t maxLoads = GBA_PREFETCH_MAX_LOADS;
 	if (dist < 16) {
 		previousLoads = dist >> 1;
 		maxLoads -= previousLoads;
@@ -1600,13 +1954,11 @@ int32_t GBAMemoryStall(struct ARMCore* cpu, int32_t wait) {
 	int32_t n2s = cpu->memory.activeNonseqCycles16 - cpu->memory.activeSeqCycles16 + 1;
 
 	// Figure out how many sequential loads we can jam in
-	int32_t stall = s;
-	int32_t loads = 1;
-
-	while (stall < wait && loads < maxLoads) {
-		stall += s;
-		++loads;
+	int32_t loads = memory->prefetchLoads[s - 1][wait < GBA_PREFETCH_MAX_WAIT ? wait : GBA_PREFETCH_MAX_WAIT];
+	if (loads > maxLoads) {
+		loads = maxLoads;
 	}
+	int32_t stall = s * loads;
 	if (stall > wait) {
 		// The wait cannot take less time than the prefetch stalls
 		wait = stall;
@@ -1619,6 +1971,7 @@ int32_t GBAMemoryStall(struct ARMCore* cpu, int32_t wait) {
 
 	// The next |loads|S waitstates disappear entirely, so long as they're all in a row
 	cpu->cycles -= (s - 1) * loads;
+	COUNT_STALL(wait - (s - 1) * loads);
 	return wait;
 }
 
@@ -1628,14 +1981,15 @@ void GBAMemorySerialize(const struct GBAMemory* memory, struct GBASerializedStat
 }
 
 void GBAMemoryDeserialize(struct GBAMemory* memory, const struct GBASerializedState* state) {
-	memcpy(memory->wram, state->wram, SIZE_WORKING_RAM);
-	memcpy(memory->iwram, state->iwram, SIZE_WORKING_IRAM);
+	mCoreMemoryDirtyRestore(&memory->dirtyPages[REGION_WORKING_RAM], memory->wram, state->wram, SIZE_WORKING_RAM);
+	mCoreMemoryDirtyRestore(&memory->dirtyPages[REGION_WORKING_IRAM], memory->iwram, state->iwram, SIZE_WORKING_IRAM);
 }
 
-void _pristineCow(struct GBA* gba) {
+void GBAPristineCow(struct GBA* gba) {
 	if (!gba->isPristine) {
 		return;
 	}
+	GBAGetROMCrc32(gba);
 #if !defined(FIXED_ROM_BUFFER) && !defined(__wii__)
 	void* newRom = anonymousMemoryMap(SIZE_CART0);
 	memcpy(newRom, gba->memory.rom, gba->memory.romSize);
@@ -1652,6 +2006,7 @@ void _pristineCow(struct GBA* gba) {
 	gba->memory.hw.gpioBase = &((uint16_t*) gba->memory.rom)[GPIO_REG_DATA >> 1];
 #endif
 	gba->isPristine = false;
+	GBAMemoryUpdatePages(gba);
 }
 
 void GBAPrintFlush(struct GBA* gba) {
@@ -1689,11 +2044,11 @@ static void _agbPrintStore(struct GBA* gba, uint32_t address, int16_t value) {
 		(&memory->agbPrintCtx.request)[(address & 7) >> 1] = value;
 	}
 	if (memory->romSize == SIZE_CART0) {
-		_pristineCow(gba);
+		GBAPristineCow(gba);
 		memcpy(&memory->rom[AGB_PRINT_FLUSH_ADDR >> 2], _agbPrintFunc, sizeof(_agbPrintFunc));
 		STORE_16(value, address & (SIZE_CART0 - 2), memory->rom);
 	} else if (memory->agbPrintCtx.bank == 0xFD && memory->romSize >= SIZE_CART0 / 2) {
-		_pristineCow(gba);
+		GBAPristineCow(gba);
 		STORE_16(value, address & (SIZE_CART0 / 2 - 2), memory->rom);
 	}
 }
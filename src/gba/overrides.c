@@ -186,7 +186,13 @@ static const struct GBACartridgeOverride _overrides[] = {
 	{ { 0, 0, 0, 0 }, 0, 0, IDLE_LOOP_NONE, false }
 };
 
+static bool _overrideFindConfig(const struct Configuration* config, struct GBACartridgeOverride* override);
+
 bool GBAOverrideFind(const struct Configuration* config, struct GBACartridgeOverride* override) {
+	return GBAOverrideFindWithDatabase(NULL, config, override);
+}
+
+bool GBAOverrideFindWithDatabase(const struct Configuration* database, const struct Configuration* config, struct GBACartridgeOverride* override) {
 	override->savetype = SAVEDATA_AUTODETECT;
 	override->hardware = HW_NONE;
 	override->idleLoop = IDLE_LOOP_NONE;
@@ -209,51 +215,61 @@ bool GBAOverrideFind(const struct Configuration* config, struct GBACartridgeOver
 		}
 	}
 
-	if (config) {
-		char sectionName[16];
-		snprintf(sectionName, sizeof(sectionName), "override.%c%c%c%c", override->id[0], override->id[1], override->id[2], override->id[3]);
-		const char* savetype = ConfigurationGetValue(config, sectionName, "savetype");
-		const char* hardware = ConfigurationGetValue(config, sectionName, "hardware");
-		const char* idleLoop = ConfigurationGetValue(config, sectionName, "idleLoop");
+	// Entries in the user's own overrides take precedence over the database
+	if (database && _overrideFindConfig(database, override)) {
+		found = true;
+	}
+	if (config && _overrideFindConfig(config, override)) {
+		found = true;
+	}
+	return found;
+}
 
-		if (savetype) {
-			if (strcasecmp(savetype, "SRAM") == 0) {
-				found = true;
-				override->savetype = SAVEDATA_SRAM;
-			} else if (strcasecmp(savetype, "EEPROM") == 0) {
-				found = true;
-				override->savetype = SAVEDATA_EEPROM;
-			} else if (strcasecmp(savetype, "EEPROM512") == 0) {
-				found = true;
-				override->savetype = SAVEDATA_EEPROM512;
-			} else if (strcasecmp(savetype, "FLASH512") == 0) {
-				found = true;
-				override->savetype = SAVEDATA_FLASH512;
-			} else if (strcasecmp(savetype, "FLASH1M") == 0) {
-				found = true;
-				override->savetype = SAVEDATA_FLASH1M;
-			} else if (strcasecmp(savetype, "NONE") == 0) {
-				found = true;
-				override->savetype = SAVEDATA_FORCE_NONE;
-			}
+static bool _overrideFindConfig(const struct Configuration* config, struct GBACartridgeOverride* override) {
+	bool found = false;
+	char sectionName[16];
+	snprintf(sectionName, sizeof(sectionName), "override.%c%c%c%c", override->id[0], override->id[1], override->id[2], override->id[3]);
+	const char* savetype = ConfigurationGetValue(config, sectionName, "savetype");
+	const char* hardware = ConfigurationGetValue(config, sectionName, "hardware");
+	const char* idleLoop = ConfigurationGetValue(config, sectionName, "idleLoop");
+
+	if (savetype) {
+		if (strcasecmp(savetype, "SRAM") == 0) {
+			found = true;
+			override->savetype = SAVEDATA_SRAM;
+		} else if (strcasecmp(savetype, "EEPROM") == 0) {
+			found = true;
+			override->savetype = SAVEDATA_EEPROM;
+		} else if (strcasecmp(savetype, "EEPROM512") == 0) {
+			found = true;
+			override->savetype = SAVEDATA_EEPROM512;
+		} else if (strcasecmp(savetype, "FLASH512") == 0) {
+			found = true;
+			override->savetype = SAVEDATA_FLASH512;
+		} else if (strcasecmp(savetype, "FLASH1M") == 0) {
+			found = true;
+			override->savetype = SAVEDATA_FLASH1M;
+		} else if (strcasecmp(savetype, "NONE") == 0) {
+			found = true;
+			override->savetype = SAVEDATA_FORCE_NONE;
 		}
+	}
 
-		if (hardware) {
-			char* end;
-			long type = strtoul(hardware, &end, 0);
-			if (end && !*end) {
-				override->hardware = type;
-				found = true;
-			}
+	if (hardware) {
+		char* end;
+		long type = strtoul(hardware, &end, 0);
+		if (end && !*end) {
+			override->hardware = type;
+			found = true;
 		}
+	}
 
-		if (idleLoop) {
-			char* end;
-			uint32_t address = strtoul(idleLoop, &end, 16);
-			if (end && !*end) {
-				override->idleLoop = address;
-				found = true;
-			}
+	if (idleLoop) {
+		char* end;
+		uint32_t address = strtoul(idleLoop, &end, 16);
+		if (end && !*end) {
+			override->idleLoop = address;
+			found = true;
 		}
 	}
 	return found;
@@ -300,6 +316,19 @@ void GBAOverrideSave(struct Configuration* config, const struct GBACartridgeOver
 	}
 }
 
+void GBAOverrideSaveIdleLoop(struct Configuration* config, const struct GBACartridgeOverride* override) {
+	char sectionName[16];
+	snprintf(sectionName, sizeof(sectionName), "override.%c%c%c%c", override->id[0], override->id[1], override->id[2], override->id[3]);
+	if (override->idleLoop == IDLE_LOOP_NONE) {
+		ConfigurationClearValue(config, sectionName, "idleLoop");
+		return;
+	}
+	// Written in hex to match how idleLoop is parsed
+	char address[9];
+	snprintf(address, sizeof(address), "%08X", override->idleLoop);
+	ConfigurationSetValue(config, sectionName, "idleLoop", address);
+}
+
 void GBAOverrideApply(struct GBA* gba, const struct GBACartridgeOverride* override) {
 	if (override->savetype != SAVEDATA_AUTODETECT) {
 		GBASavedataForceType(&gba->memory.savedata, override->savetype);
@@ -337,6 +366,7 @@ void GBAOverrideApply(struct GBA* gba, const struct GBACartridgeOverride* overri
 
 	if (override->idleLoop != IDLE_LOOP_NONE) {
 		gba->idleLoop = override->idleLoop;
+		gba->idleLoopDetected = false;
 		if (gba->idleOptimization == IDLE_LOOP_DETECT) {
 			gba->idleOptimization = IDLE_LOOP_REMOVE;
 		}
@@ -347,18 +377,18 @@ void GBAOverrideApply(struct GBA* gba, const struct GBACartridgeOverride* overri
 	}
 }
 
-void GBAOverrideApplyDefaults(struct GBA* gba, const struct Configuration* overrides) {
+void GBAOverrideApplyDefaults(struct GBA* gba, const struct Configuration* database, const struct Configuration* overrides) {
 	struct GBACartridgeOverride override = { .idleLoop = IDLE_LOOP_NONE };
 	const struct GBACartridge* cart = (const struct GBACartridge*) gba->memory.rom;
 	if (cart) {
 		memcpy(override.id, &cart->id, sizeof(override.id));
 
-		if (!strncmp("pokemon red version", &((const char*) gba->memory.rom)[0x108], 20) && gba->romCrc32 != 0xDD88761C) {
+		if (!strncmp("pokemon red version", &((const char*) gba->memory.rom)[0x108], 20) && GBAGetROMCrc32(gba) != 0xDD88761C) {
 			// Enable FLASH1M and RTC on Pokémon FireRed ROM hacks
 			override.savetype = SAVEDATA_FLASH1M;
 			override.hardware = HW_RTC;
 			GBAOverrideApply(gba, &override);
-		} else if (GBAOverrideFind(overrides, &override)) {
+		} else if (GBAOverrideFindWithDatabase(database, overrides, &override)) {
 			GBAOverrideApply(gba, &override);
 		}
 	}
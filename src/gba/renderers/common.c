@@ -7,27 +7,35 @@
 
 #include <mgba/gba/interface.h>
 
+bool GBAVideoRendererCleanSprite(const struct GBAObj* oam, struct GBAVideoRendererSprite* sprite, int offsetY) {
+	struct GBAObj obj;
+	LOAD_16LE(obj.a, 0, &oam->a);
+	LOAD_16LE(obj.b, 0, &oam->b);
+	LOAD_16LE(obj.c, 0, &oam->c);
+	if (!GBAObjAttributesAIsTransformed(obj.a) && GBAObjAttributesAIsDisable(obj.a)) {
+		return false;
+	}
+	int height = GBAVideoObjSizes[GBAObjAttributesAGetShape(obj.a) * 4 + GBAObjAttributesBGetSize(obj.b)][1];
+	if (GBAObjAttributesAIsTransformed(obj.a)) {
+		height <<= GBAObjAttributesAGetDoubleSize(obj.a);
+	}
+	if (GBAObjAttributesAGetY(obj.a) >= GBA_VIDEO_VERTICAL_PIXELS && GBAObjAttributesAGetY(obj.a) + height < VIDEO_VERTICAL_TOTAL_PIXELS) {
+		return false;
+	}
+	int y = GBAObjAttributesAGetY(obj.a) + offsetY;
+	sprite->y = y;
+	sprite->endY = y + height;
+	sprite->obj = obj;
+	return true;
+}
+
 int GBAVideoRendererCleanOAM(struct GBAObj* oam, struct GBAVideoRendererSprite* sprites, int offsetY) {
 	int i;
 	int oamMax = 0;
 	for (i = 0; i < 128; ++i) {
-		struct GBAObj obj;
-		LOAD_16LE(obj.a, 0, &oam[i].a);
-		LOAD_16LE(obj.b, 0, &oam[i].b);
-		LOAD_16LE(obj.c, 0, &oam[i].c);
-		if (GBAObjAttributesAIsTransformed(obj.a) || !GBAObjAttributesAIsDisable(obj.a)) {
-			int height = GBAVideoObjSizes[GBAObjAttributesAGetShape(obj.a) * 4 + GBAObjAttributesBGetSize(obj.b)][1];
-			if (GBAObjAttributesAIsTransformed(obj.a)) {
-				height <<= GBAObjAttributesAGetDoubleSize(obj.a);
-			}
-			if (GBAObjAttributesAGetY(obj.a) < GBA_VIDEO_VERTICAL_PIXELS || GBAObjAttributesAGetY(obj.a) + height >= VIDEO_VERTICAL_TOTAL_PIXELS) {
-				int y = GBAObjAttributesAGetY(obj.a) + offsetY;
-				sprites[oamMax].y = y;
-				sprites[oamMax].endY = y + height;
-				sprites[oamMax].obj = obj;
-				++oamMax;
-			}
+		if (GBAVideoRendererCleanSprite(&oam[i], &sprites[oamMax], offsetY)) {
+			++oamMax;
 		}
 	}
 	return oamMax;
-}
\ No newline at end of file
+}
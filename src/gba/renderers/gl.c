@@ -45,6 +45,7 @@ static void GBAVideoGLRendererDrawWindow(struct GBAVideoGLRenderer* renderer, in
 
 static void _cleanRegister(struct GBAVideoGLRenderer* renderer, int address, uint16_t value);
 static void _drawScanlines(struct GBAVideoGLRenderer* renderer, int lastY);
+static void _drawSpritesBatched(struct GBAVideoGLRenderer* renderer, int y);
 static void _finalizeLayers(struct GBAVideoGLRenderer* renderer);
 
 #define TEST_LAYER_ENABLED(X) !glRenderer->d.disableBG[X] && glRenderer->bg[X].enabled == 4
@@ -54,6 +55,17 @@ struct GBAVideoGLUniform {
 	int type;
 };
 
+// One entry of the OBJ uniform buffer, laid out as std140
+struct GBAVideoGLObj {
+	GLint bounds[4];
+	GLint dims[4];
+	GLint tile[4];
+	GLint inflags[4];
+	GLint mosaic[4];
+	GLfloat transform[4];
+	GLfloat objwin[4];
+};
+
 static const GLchar* const _gles3Header =
 	"#version 300 es\n"
 	"#define OUT(n) layout(location = n)\n"
@@ -65,6 +77,11 @@ static const GLchar* const _gl3Header =
 	"#define OUT(n)\n"
 	"precision highp float;\n";
 
+static const GLchar* const _gl31Header =
+	"#version 140\n"
+	"#define OUT(n)\n"
+	"precision highp float;\n";
+
 static const char* const _vertexShader =
 	"in vec2 position;\n"
 	"uniform ivec2 loc;\n"
@@ -454,10 +471,7 @@ static const struct GBAVideoGLUniform _uniformsObj[] = {
 	{ 0 }
 };
 
-static const char* const _renderObj =
-	"in vec2 texCoord;\n"
-	"uniform sampler2D vram;\n"
-	"uniform sampler2D palette;\n"
+static const char* const _renderObjUniforms =
 	"uniform int charBase;\n"
 	"uniform int stride;\n"
 	"uniform int localPalette;\n"
@@ -465,7 +479,12 @@ static const char* const _renderObj =
 	"uniform mat2x2 transform;\n"
 	"uniform ivec4 dims;\n"
 	"uniform vec4 objwin;\n"
-	"uniform ivec4 mosaic;\n"
+	"uniform ivec4 mosaic;\n";
+
+static const char* const _renderObj =
+	"in vec2 texCoord;\n"
+	"uniform sampler2D vram;\n"
+	"uniform sampler2D palette;\n"
 	"OUT(0) out vec4 color;\n"
 	"OUT(1) out vec4 flags;\n"
 	"OUT(2) out vec3 window;\n"
@@ -499,6 +518,65 @@ static const char* const _renderObj =
 	"	window = objwin.yzw;\n"
 	"}";
 
+static const struct GBAVideoGLUniform _uniformsObjBatch[] = {
+	{ "maxPos", GBA_GL_VS_MAXPOS, },
+	{ "vram", GBA_GL_OBJ_VRAM, },
+	{ "palette", GBA_GL_OBJ_PALETTE, },
+	{ "objBase", GBA_GL_OBJ_BASE, },
+	{ 0 }
+};
+
+// Must match struct GBAVideoGLObj
+#define OBJ_BLOCK \
+	"struct Obj {\n" \
+	"	ivec4 bounds;\n" \
+	"	ivec4 size;\n" \
+	"	ivec4 tile;\n" \
+	"	ivec4 layerFlags;\n" \
+	"	ivec4 mosaicParams;\n" \
+	"	vec4 matrix;\n" \
+	"	vec4 windowParams;\n" \
+	"};\n" \
+	"layout(std140) uniform Objs {\n" \
+	"	Obj objs[128];\n" \
+	"};\n"
+
+static const char* const _objBatchVertexShader =
+	"in vec2 position;\n"
+	"uniform ivec2 maxPos;\n"
+	"uniform int objBase;\n"
+	OBJ_BLOCK
+	"flat out int objIndex;\n"
+	"out vec2 texCoord;\n"
+
+	"void main() {\n"
+	"	objIndex = objBase + gl_InstanceID;\n"
+	"	ivec4 bounds = objs[objIndex].bounds;\n"
+	"	texCoord = position * vec2(bounds.zw);\n"
+	"	gl_Position = vec4((vec2(bounds.xy) + texCoord) / vec2(maxPos) * 2. - 1., 0., 1.);\n"
+	"}";
+
+// Stands in for _renderObjUniforms, reading the same values from the instance's entry instead
+static const char* const _renderObjBatchUniforms =
+	OBJ_BLOCK
+	"flat in int objIndex;\n"
+	"#define charBase objs[objIndex].tile.x\n"
+	"#define stride objs[objIndex].tile.y\n"
+	"#define localPalette objs[objIndex].tile.z\n"
+	"#define inflags objs[objIndex].layerFlags\n"
+	"#define transform mat2x2(objs[objIndex].matrix)\n"
+	"#define dims objs[objIndex].size\n"
+	"#define objwin objs[objIndex].windowParams\n"
+	"#define mosaic objs[objIndex].mosaicParams\n";
+
+static const char* const _renderTileBatch =
+	"vec4 renderTile(int tile, int paletteId, ivec2 localCoord) {\n"
+	"	if (objs[objIndex].tile.w != 0) {\n"
+	"		return renderTile256(tile, paletteId, localCoord);\n"
+	"	}\n"
+	"	return renderTile16(tile, paletteId, localCoord);\n"
+	"}";
+
 static const struct GBAVideoGLUniform _uniformsFinalize[] = {
 	{ "loc", GBA_GL_VS_LOC, },
 	{ "maxPos", GBA_GL_VS_MAXPOS, },
@@ -613,6 +691,7 @@ void GBAVideoGLRendererCreate(struct GBAVideoGLRenderer* renderer) {
 	renderer->d.disableOBJ = false;
 
 	renderer->scale = 1;
+	renderer->readbackLatency = false;
 }
 
 static void _compileShader(struct GBAVideoGLRenderer* glRenderer, struct GBAVideoGLShader* shader, const char** shaderBuffer, int shaderBufferLines, GLuint vs, const struct GBAVideoGLUniform* uniforms, char* log) {
@@ -647,6 +726,10 @@ static void _compileShader(struct GBAVideoGLRenderer* glRenderer, struct GBAVide
 	glVertexAttribPointer(positionLocation, 2, GL_INT, GL_FALSE, 0, NULL);
 
 	size_t i;
+	// Uniforms a program doesn't declare are ignored when set, like the ones the compiler drops
+	for (i = 0; i < GBA_GL_UNIFORM_MAX; ++i) {
+		shader->uniforms[i] = -1;
+	}
 	for (i = 0; uniforms[i].name; ++i) {
 		shader->uniforms[uniforms[i].type] = glGetUniformLocation(program, uniforms[i].name);
 	}
@@ -678,12 +761,32 @@ void GBAVideoGLRendererInit(struct GBAVideoRenderer* renderer) {
 	glBindTexture(GL_TEXTURE_2D, glRenderer->paletteTex);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+#ifdef BUILD_GLES3
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB565, 16, GBA_GL_PALETTE_ROWS, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, 0);
+#else
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB5_A1, 16, GBA_GL_PALETTE_ROWS, 0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, 0);
+#endif
 
 	glGenTextures(1, &glRenderer->vramTex);
 	glBindTexture(GL_TEXTURE_2D, glRenderer->vramTex);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA4, 256, 192, 0, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4, 0);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA4, 256, GBA_GL_VRAM_ROWS, 0, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4, 0);
+
+	glGenBuffers(1, &glRenderer->vramPbo);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, glRenderer->vramPbo);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, GBA_GL_VRAM_ROWS * GBA_GL_VRAM_ROW_SIZE, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	glGenBuffers(GBA_GL_READBACK_BUFFERS, glRenderer->readbackPbo);
+	int i;
+	for (i = 0; i < GBA_GL_READBACK_BUFFERS; ++i) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, glRenderer->readbackPbo[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * glRenderer->scale * glRenderer->scale * BYTES_PER_PIXEL, NULL, GL_STREAM_READ);
+		glRenderer->readbackFence[i] = 0;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glRenderer->readbackFrames = 0;
 
 	glBindTexture(GL_TEXTURE_2D, glRenderer->layers[GBA_GL_TEX_AFFINE_2]);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -719,7 +822,6 @@ void GBAVideoGLRendererInit(struct GBAVideoRenderer* renderer) {
 	glBindBuffer(GL_ARRAY_BUFFER, glRenderer->vbo);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(_vertices), _vertices, GL_STATIC_DRAW);
 
-	int i;
 	for (i = 0; i < 4; ++i) {
 		struct GBAVideoGLBackground* bg = &glRenderer->bg[i];
 		bg->index = i;
@@ -753,12 +855,18 @@ void GBAVideoGLRendererInit(struct GBAVideoRenderer* renderer) {
 	}
 
 	char log[2048];
-	const GLchar* shaderBuffer[4];
+	const GLchar* shaderBuffer[9];
 	const GLubyte* version = glGetString(GL_VERSION);
 	if (strncmp((const char*) version, "OpenGL ES ", strlen("OpenGL ES "))) {
 		shaderBuffer[0] = _gl3Header;
+		GLint major = 0;
+		GLint minor = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+		glRenderer->objBatching = major > 3 || (major == 3 && minor >= 1);
 	} else {
 		shaderBuffer[0] = _gles3Header;
+		glRenderer->objBatching = true;
 	}
 
 	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
@@ -795,23 +903,85 @@ void GBAVideoGLRendererInit(struct GBAVideoRenderer* renderer) {
 	shaderBuffer[2] = _interpolate;
 	_compileShader(glRenderer, &glRenderer->bgShader[5], shaderBuffer, 3, vs, _uniformsMode35, log);
 
-	shaderBuffer[1] = _renderObj;
+	shaderBuffer[1] = _renderObjUniforms;
+	shaderBuffer[2] = _renderObj;
 
-	shaderBuffer[2] = _renderTile16;
-	_compileShader(glRenderer, &glRenderer->objShader[0], shaderBuffer, 3, vs, _uniformsObj, log);
+	shaderBuffer[3] = _renderTile16;
+	_compileShader(glRenderer, &glRenderer->objShader[0], shaderBuffer, 4, vs, _uniformsObj, log);
 #ifndef BUILD_GLES3
 	glBindFragDataLocation(glRenderer->objShader[0].program, 2, "window");
 #endif
 
-	shaderBuffer[2] = _renderTile256;
-	_compileShader(glRenderer, &glRenderer->objShader[1], shaderBuffer, 3, vs, _uniformsObj, log);
+	shaderBuffer[3] = _renderTile256;
+	_compileShader(glRenderer, &glRenderer->objShader[1], shaderBuffer, 4, vs, _uniformsObj, log);
 #ifndef BUILD_GLES3
 	glBindFragDataLocation(glRenderer->objShader[1].program, 2, "window");
 #endif
 
+	if (glRenderer->objBatching) {
+		if (shaderBuffer[0] == _gl3Header) {
+			shaderBuffer[0] = _gl31Header;
+		}
+		GLuint objVs = glCreateShader(GL_VERTEX_SHADER);
+		shaderBuffer[1] = _objBatchVertexShader;
+		glShaderSource(objVs, 2, shaderBuffer, 0);
+		glCompileShader(objVs);
+		glGetShaderInfoLog(objVs, 2048, 0, log);
+		if (log[0]) {
+			mLOG(GBA_VIDEO, ERROR, "Vertex shader compilation failure: %s", log);
+		}
+
+		// Both tile formats are compiled in under their own names, and the instance picks one
+		shaderBuffer[1] = _renderObjBatchUniforms;
+		shaderBuffer[2] = _renderObj;
+		shaderBuffer[3] = "\n#define renderTile renderTile16\n";
+		shaderBuffer[4] = _renderTile16;
+		shaderBuffer[5] = "\n#undef renderTile\n#define renderTile renderTile256\n";
+		shaderBuffer[6] = _renderTile256;
+		shaderBuffer[7] = "\n#undef renderTile\n";
+		shaderBuffer[8] = _renderTileBatch;
+		_compileShader(glRenderer, &glRenderer->objBatchShader, shaderBuffer, 9, objVs, _uniformsObjBatch, log);
+#ifndef BUILD_GLES3
+		glBindFragDataLocation(glRenderer->objBatchShader.program, 2, "window");
+#endif
+		glUniformBlockBinding(glRenderer->objBatchShader.program, glGetUniformBlockIndex(glRenderer->objBatchShader.program, "Objs"), 0);
+		glDeleteShader(objVs);
+
+		glGenBuffers(1, &glRenderer->objUbo);
+		glBindBuffer(GL_UNIFORM_BUFFER, glRenderer->objUbo);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(struct GBAVideoGLObj) * 128, NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
 	shaderBuffer[1] = _finalize;
 	_compileShader(glRenderer, &glRenderer->finalizeShader, shaderBuffer, 2, vs, _uniformsFinalize, log);
 
+	// Sampler units and other uniforms that never change are only set once per program
+	for (i = 0; i < 6; ++i) {
+		const GLuint* uniforms = glRenderer->bgShader[i].uniforms;
+		glUseProgram(glRenderer->bgShader[i].program);
+		glUniform2i(uniforms[GBA_GL_VS_MAXPOS], GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
+		glUniform1i(uniforms[GBA_GL_BG_VRAM], 0);
+		glUniform1i(uniforms[GBA_GL_BG_PALETTE], 1);
+		if (i >= 2) {
+			glUniform1i(uniforms[GBA_GL_BG_TRANSFORM], 2);
+		}
+	}
+	for (i = 0; i < 2; ++i) {
+		const GLuint* uniforms = glRenderer->objShader[i].uniforms;
+		glUseProgram(glRenderer->objShader[i].program);
+		glUniform1i(uniforms[GBA_GL_OBJ_VRAM], 0);
+		glUniform1i(uniforms[GBA_GL_OBJ_PALETTE], 1);
+	}
+	if (glRenderer->objBatching) {
+		const GLuint* uniforms = glRenderer->objBatchShader.uniforms;
+		glUseProgram(glRenderer->objBatchShader.program);
+		glUniform2i(uniforms[GBA_GL_VS_MAXPOS], GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
+		glUniform1i(uniforms[GBA_GL_OBJ_VRAM], 0);
+		glUniform1i(uniforms[GBA_GL_OBJ_PALETTE], 1);
+	}
+	glUseProgram(0);
+
 	glBindVertexArray(0);
 	glDeleteShader(vs);
 
@@ -827,16 +997,31 @@ void GBAVideoGLRendererDeinit(struct GBAVideoRenderer* renderer) {
 	glDeleteTextures(GBA_GL_TEX_MAX, glRenderer->layers);
 	glDeleteTextures(1, &glRenderer->paletteTex);
 	glDeleteTextures(1, &glRenderer->vramTex);
+	glDeleteBuffers(1, &glRenderer->vramPbo);
+	glDeleteBuffers(1, &glRenderer->vbo);
+	glDeleteBuffers(GBA_GL_READBACK_BUFFERS, glRenderer->readbackPbo);
+	int i;
+	for (i = 0; i < GBA_GL_READBACK_BUFFERS; ++i) {
+		if (glRenderer->readbackFence[i]) {
+			glDeleteSync(glRenderer->readbackFence[i]);
+			glRenderer->readbackFence[i] = 0;
+		}
+	}
 
 	_deleteShader(&glRenderer->bgShader[0]);
 	_deleteShader(&glRenderer->bgShader[1]);
 	_deleteShader(&glRenderer->bgShader[2]);
 	_deleteShader(&glRenderer->bgShader[3]);
+	_deleteShader(&glRenderer->bgShader[4]);
+	_deleteShader(&glRenderer->bgShader[5]);
 	_deleteShader(&glRenderer->objShader[0]);
 	_deleteShader(&glRenderer->objShader[1]);
+	if (glRenderer->objBatching) {
+		_deleteShader(&glRenderer->objBatchShader);
+		glDeleteBuffers(1, &glRenderer->objUbo);
+	}
 	_deleteShader(&glRenderer->finalizeShader);
 
-	int i;
 	for (i = 0; i < 4; ++i) {
 		struct GBAVideoGLBackground* bg = &glRenderer->bg[i];
 		glDeleteFramebuffers(1, &bg->fbo);
@@ -848,17 +1033,27 @@ void GBAVideoGLRendererDeinit(struct GBAVideoRenderer* renderer) {
 void GBAVideoGLRendererReset(struct GBAVideoRenderer* renderer) {
 	struct GBAVideoGLRenderer* glRenderer = (struct GBAVideoGLRenderer*) renderer;
 
-	glRenderer->paletteDirty = true;
-	glRenderer->vramDirty = 0xFFFFFF;
+	glRenderer->paletteDirty = 0xFFFFFFFF;
+	glRenderer->readbackFrames = 0;
+	memset(glRenderer->vramDirty, 0xFF, sizeof(glRenderer->vramDirty));
 	glRenderer->firstAffine = -1;
 	glRenderer->firstY = -1;
 	glRenderer->dispcnt = 0;
 	glRenderer->mosaic = 0;
+	// Registers restored after a reset may match what was shadowed before it, so none can be skipped
+	memset(glRenderer->shadowRegs, 0, sizeof(glRenderer->shadowRegs));
+	// Same identity transforms the I/O registers reset to
+	glRenderer->shadowRegs[REG_BG2PA >> 1] = 0x100;
+	glRenderer->shadowRegs[REG_BG2PD >> 1] = 0x100;
+	glRenderer->shadowRegs[REG_BG3PA >> 1] = 0x100;
+	glRenderer->shadowRegs[REG_BG3PD >> 1] = 0x100;
+	glRenderer->regsDirty = (1ULL << (sizeof(glRenderer->shadowRegs) / sizeof(*glRenderer->shadowRegs))) - 1;
 }
 
 void GBAVideoGLRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address) {
 	struct GBAVideoGLRenderer* glRenderer = (struct GBAVideoGLRenderer*) renderer;
-	glRenderer->vramDirty |= 1 << (address >> 12);
+	address /= GBA_GL_VRAM_ROW_SIZE;
+	glRenderer->vramDirty[address >> 5] |= 1U << (address & 31);
 }
 
 void GBAVideoGLRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam) {
@@ -872,10 +1067,9 @@ void GBAVideoGLRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t
 #ifdef BUILD_GLES3
 	glRenderer->shadowPalette[address >> 1] = ((value & 0x1F) << 11) | ((value & 0x3E0) << 1) | ((value & 0x7C00) >> 10);
 #else
-	UNUSED(address);
 	UNUSED(value);
 #endif
-	glRenderer->paletteDirty = true;
+	glRenderer->paletteDirty |= 1U << (address >> 5);
 }
 
 uint16_t GBAVideoGLRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
@@ -1124,6 +1318,92 @@ void _cleanRegister(struct GBAVideoGLRenderer* glRenderer, int address, uint16_t
 	}
 }
 
+static bool _vramDirty(const struct GBAVideoGLRenderer* renderer) {
+	size_t i;
+	for (i = 0; i < GBA_GL_VRAM_ROWS / 32; ++i) {
+		if (renderer->vramDirty[i]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void _uploadPalette(struct GBAVideoGLRenderer* renderer) {
+	glBindTexture(GL_TEXTURE_2D, renderer->paletteTex);
+	int first = -1;
+	int i;
+	for (i = 0; i <= GBA_GL_PALETTE_ROWS; ++i) {
+		if (i < GBA_GL_PALETTE_ROWS && (renderer->paletteDirty & (1U << i))) {
+			if (first < 0) {
+				first = i;
+			}
+			continue;
+		}
+		if (first < 0) {
+			continue;
+		}
+#ifdef BUILD_GLES3
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first, 16, i - first, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, &renderer->shadowPalette[16 * first]);
+#else
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first, 16, i - first, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, &renderer->d.palette[16 * first]);
+#endif
+		first = -1;
+	}
+	renderer->paletteDirty = 0;
+}
+
+static void _uploadVRAM(struct GBAVideoGLRenderer* renderer) {
+	int runStart[GBA_GL_VRAM_ROWS / 2];
+	int runLength[GBA_GL_VRAM_ROWS / 2];
+	int runs = 0;
+	int rows = 0;
+	int first = -1;
+	int i;
+	for (i = 0; i <= GBA_GL_VRAM_ROWS; ++i) {
+		if (i < GBA_GL_VRAM_ROWS && (renderer->vramDirty[i >> 5] & (1U << (i & 31)))) {
+			if (first < 0) {
+				first = i;
+			}
+			continue;
+		}
+		if (first < 0) {
+			continue;
+		}
+		runStart[runs] = first;
+		runLength[runs] = i - first;
+		rows += i - first;
+		++runs;
+		first = -1;
+	}
+	memset(renderer->vramDirty, 0, sizeof(renderer->vramDirty));
+
+	glBindTexture(GL_TEXTURE_2D, renderer->vramTex);
+	// Dirty rows are packed into a freshly orphaned buffer so that the copy never waits for
+	// the driver to finish with the previous upload
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, renderer->vramPbo);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, GBA_GL_VRAM_ROWS * GBA_GL_VRAM_ROW_SIZE, NULL, GL_STREAM_DRAW);
+	uint8_t* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, rows * GBA_GL_VRAM_ROW_SIZE, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (!staging) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		for (i = 0; i < runs; ++i) {
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, runStart[i], 256, runLength[i], GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4, &renderer->d.vram[256 * runStart[i]]);
+		}
+		return;
+	}
+	size_t offset = 0;
+	for (i = 0; i < runs; ++i) {
+		memcpy(&staging[offset], &renderer->d.vram[256 * runStart[i]], runLength[i] * GBA_GL_VRAM_ROW_SIZE);
+		offset += runLength[i] * GBA_GL_VRAM_ROW_SIZE;
+	}
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	offset = 0;
+	for (i = 0; i < runs; ++i) {
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, runStart[i], 256, runLength[i], GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4, (const void*) offset);
+		offset += runLength[i] * GBA_GL_VRAM_ROW_SIZE;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
 void GBAVideoGLRendererDrawScanline(struct GBAVideoRenderer* renderer, int y) {
 	struct GBAVideoGLRenderer* glRenderer = (struct GBAVideoGLRenderer*) renderer;
 
@@ -1137,7 +1417,7 @@ void GBAVideoGLRendererDrawScanline(struct GBAVideoRenderer* renderer, int y) {
 		glRenderer->firstAffine = -1;
 	}
 
-	if (glRenderer->paletteDirty || glRenderer->vramDirty || glRenderer->oamDirty || glRenderer->regsDirty) {
+	if (glRenderer->paletteDirty || _vramDirty(glRenderer) || glRenderer->oamDirty || glRenderer->regsDirty) {
 		if (glRenderer->firstY >= 0) {
 			_drawScanlines(glRenderer, y - 1);
 			glBindVertexArray(0);
@@ -1160,28 +1440,11 @@ void GBAVideoGLRendererDrawScanline(struct GBAVideoRenderer* renderer, int y) {
 	glRenderer->regsDirty = 0;
 
 	if (glRenderer->paletteDirty) {
-		glBindTexture(GL_TEXTURE_2D, glRenderer->paletteTex);
-#ifdef BUILD_GLES3
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB565, 16, 32, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, glRenderer->shadowPalette);
-#else
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB5_A1, 16, 32, 0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, glRenderer->d.palette);
-#endif
-		glRenderer->paletteDirty = false;
+		_uploadPalette(glRenderer);
 	}
-
-	int first = -1;
-	glBindTexture(GL_TEXTURE_2D, glRenderer->vramTex);
-	for (i = 0; i < 25; ++i) {
-		if (!(glRenderer->vramDirty & (1 << i))) {
-			if (first >= 0) {
-				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 8 * first, 256, 8 * (i - first), GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4, &glRenderer->d.vram[2048 * first]);
-				first = -1;
-			}
-		} else if (first < 0) {
-			first = i;
-		}
+	if (_vramDirty(glRenderer)) {
+		_uploadVRAM(glRenderer);
 	}
-	glRenderer->vramDirty = 0;
 
 	if (glRenderer->oamDirty) {
 		glRenderer->oamMax = GBAVideoRendererCleanOAM(glRenderer->d.oam->obj, glRenderer->sprites, 0);
@@ -1222,6 +1485,13 @@ void _drawScanlines(struct GBAVideoGLRenderer* glRenderer, int y) {
 	}
 	glEnable(GL_SCISSOR_TEST);
 
+	// Every background and sprite samples VRAM and the palette from the same units
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, glRenderer->vramTex);
+	glActiveTexture(GL_TEXTURE0 + 1);
+	glBindTexture(GL_TEXTURE_2D, glRenderer->paletteTex);
+	glRenderer->activeShader = NULL;
+
 	uint32_t backdrop = M_RGB5_TO_RGB8(glRenderer->d.palette[0]);
 	glViewport(0, 0, 1, GBA_VIDEO_VERTICAL_PIXELS);
 	glScissor(0, glRenderer->firstY, 1, y - glRenderer->firstY + 1);
@@ -1236,14 +1506,19 @@ void _drawScanlines(struct GBAVideoGLRenderer* glRenderer, int y) {
 
 	GBAVideoGLRendererDrawWindow(glRenderer, y);
 	if (GBARegisterDISPCNTIsObjEnable(glRenderer->dispcnt) && !glRenderer->d.disableOBJ) {
-		int i;
-		for (i = glRenderer->oamMax; i--;) {
-			struct GBAVideoRendererSprite* sprite = &glRenderer->sprites[i];
-			if ((y < sprite->y && (sprite->endY - 256 < 0 || glRenderer->firstY >= sprite->endY - 256)) || glRenderer->firstY >= sprite->endY) {
-				continue;
+		glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo[GBA_GL_FBO_OBJ]);
+		if (glRenderer->objBatching) {
+			_drawSpritesBatched(glRenderer, y);
+		} else {
+			int i;
+			for (i = glRenderer->oamMax; i--;) {
+				struct GBAVideoRendererSprite* sprite = &glRenderer->sprites[i];
+				if ((y < sprite->y && (sprite->endY - 256 < 0 || glRenderer->firstY >= sprite->endY - 256)) || glRenderer->firstY >= sprite->endY) {
+					continue;
+				}
+
+				GBAVideoGLRendererDrawSprite(glRenderer, &sprite->obj, y, sprite->y);
 			}
-
-			GBAVideoGLRendererDrawSprite(glRenderer, &sprite->obj, y, sprite->y);
 		}
 	}
 
@@ -1286,6 +1561,20 @@ void _drawScanlines(struct GBAVideoGLRenderer* glRenderer, int y) {
 	glRenderer->firstY = -1;
 }
 
+// Reads the output framebuffer into dest, or into the bound pixel pack buffer at that offset.
+// The pack state is put back afterwards, since the frontend may share this context.
+static void _readPixels(struct GBAVideoGLRenderer* renderer, void* dest) {
+	GLint rowLength;
+	GLint alignment;
+	glGetIntegerv(GL_PACK_ROW_LENGTH, &rowLength);
+	glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+	glPixelStorei(GL_PACK_ROW_LENGTH, GBA_VIDEO_HORIZONTAL_PIXELS * renderer->scale);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, GBA_VIDEO_HORIZONTAL_PIXELS * renderer->scale, GBA_VIDEO_VERTICAL_PIXELS * renderer->scale, GL_RGBA, GL_UNSIGNED_BYTE, dest);
+	glPixelStorei(GL_PACK_ROW_LENGTH, rowLength);
+	glPixelStorei(GL_PACK_ALIGNMENT, alignment);
+}
+
 void GBAVideoGLRendererFinishFrame(struct GBAVideoRenderer* renderer) {
 	struct GBAVideoGLRenderer* glRenderer = (struct GBAVideoGLRenderer*) renderer;
 	_drawScanlines(glRenderer, GBA_VIDEO_VERTICAL_PIXELS - 1);
@@ -1297,20 +1586,54 @@ void GBAVideoGLRendererFinishFrame(struct GBAVideoRenderer* renderer) {
 	glRenderer->bg[2].affine.sy = glRenderer->bg[2].refy;
 	glRenderer->bg[3].affine.sx = glRenderer->bg[3].refx;
 	glRenderer->bg[3].affine.sy = glRenderer->bg[3].refy;
+
+	if (glRenderer->readbackLatency) {
+		unsigned index = glRenderer->readbackFrames % GBA_GL_READBACK_BUFFERS;
+		glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo[GBA_GL_FBO_OUTPUT]);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, glRenderer->readbackPbo[index]);
+		_readPixels(glRenderer, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (glRenderer->readbackFence[index]) {
+			glDeleteSync(glRenderer->readbackFence[index]);
+		}
+		glRenderer->readbackFence[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		++glRenderer->readbackFrames;
+	}
+}
+
+static bool _readbackPrevious(struct GBAVideoGLRenderer* renderer, size_t size) {
+	if (!renderer->readbackLatency || renderer->readbackFrames < 2) {
+		return false;
+	}
+	// The most recent frame may still be in flight, but the one before it has had a whole
+	// frame to finish, so waiting on its fence shouldn't stall
+	unsigned index = (renderer->readbackFrames - 2) % GBA_GL_READBACK_BUFFERS;
+	glClientWaitSync(renderer->readbackFence[index], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, renderer->readbackPbo[index]);
+	const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+	if (mapped) {
+		memcpy(renderer->temporaryBuffer, mapped, size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return mapped;
 }
 
 void GBAVideoGLRendererGetPixels(struct GBAVideoRenderer* renderer, size_t* stride, const void** pixels) {
 	struct GBAVideoGLRenderer* glRenderer = (struct GBAVideoGLRenderer*) renderer;
+	size_t size = GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * glRenderer->scale * glRenderer->scale * BYTES_PER_PIXEL;
 	*stride = GBA_VIDEO_HORIZONTAL_PIXELS * glRenderer->scale;
 	if (!glRenderer->temporaryBuffer) {
-		glRenderer->temporaryBuffer = anonymousMemoryMap(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * glRenderer->scale * glRenderer->scale * BYTES_PER_PIXEL);
+		glRenderer->temporaryBuffer = anonymousMemoryMap(size);
+	}
+	*pixels = glRenderer->temporaryBuffer;
+	if (_readbackPrevious(glRenderer, size)) {
+		return;
 	}
 	glFinish();
 	glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo[GBA_GL_FBO_OUTPUT]);
-	glPixelStorei(GL_PACK_ROW_LENGTH, GBA_VIDEO_HORIZONTAL_PIXELS * glRenderer->scale);
-	glPixelStorei(GL_PACK_ALIGNMENT, 1);
-	glReadPixels(0, 0, GBA_VIDEO_HORIZONTAL_PIXELS * glRenderer->scale, GBA_VIDEO_VERTICAL_PIXELS * glRenderer->scale, GL_RGBA, GL_UNSIGNED_BYTE, (void*) glRenderer->temporaryBuffer);
-	*pixels = glRenderer->temporaryBuffer;
+	_readPixels(glRenderer, glRenderer->temporaryBuffer);
 }
 
 void GBAVideoGLRendererPutPixels(struct GBAVideoRenderer* renderer, size_t stride, const void* pixels) {
@@ -1437,7 +1760,16 @@ void _finalizeLayers(struct GBAVideoGLRenderer* renderer) {
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void GBAVideoGLRendererDrawSprite(struct GBAVideoGLRenderer* renderer, struct GBAObj* sprite, int y, int spriteY) {
+static void _useShader(struct GBAVideoGLRenderer* renderer, const struct GBAVideoGLShader* shader) {
+	if (renderer->activeShader == shader) {
+		return;
+	}
+	glUseProgram(shader->program);
+	glBindVertexArray(shader->vao);
+	renderer->activeShader = shader;
+}
+
+static void _prepareSprite(struct GBAVideoGLRenderer* renderer, const struct GBAObj* sprite, int spriteY, struct GBAVideoGLObj* obj) {
 	int width = GBAVideoObjSizes[GBAObjAttributesAGetShape(sprite->a) * 4 + GBAObjAttributesBGetSize(sprite->b)][0];
 	int height = GBAVideoObjSizes[GBAObjAttributesAGetShape(sprite->a) * 4 + GBAObjAttributesBGetSize(sprite->b)][1];
 	int32_t x = (uint32_t) GBAObjAttributesBGetX(sprite->b) << 23;
@@ -1458,27 +1790,22 @@ void GBAVideoGLRendererDrawSprite(struct GBAVideoGLRenderer* renderer, struct GB
 		totalHeight <<= 1;
 	}
 
-	const struct GBAVideoGLShader* shader = &renderer->objShader[GBAObjAttributesAGet256Color(sprite->a)];
-	const GLuint* uniforms = shader->uniforms;
-	glBindFramebuffer(GL_FRAMEBUFFER, renderer->fbo[GBA_GL_FBO_OBJ]);
-	glViewport(x * renderer->scale, spriteY * renderer->scale, totalWidth * renderer->scale, totalHeight * renderer->scale);
-	glScissor(x * renderer->scale, renderer->firstY * renderer->scale, totalWidth * renderer->scale, (y - renderer->firstY + 1) * renderer->scale);
-	glUseProgram(shader->program);
-	glBindVertexArray(shader->vao);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, renderer->vramTex);
-	glActiveTexture(GL_TEXTURE0 + 1);
-	glBindTexture(GL_TEXTURE_2D, renderer->paletteTex);
-	glUniform2i(uniforms[GBA_GL_VS_LOC], totalHeight, 0);
-	glUniform2i(uniforms[GBA_GL_VS_MAXPOS], totalWidth, totalHeight);
-	glUniform1i(uniforms[GBA_GL_OBJ_VRAM], 0);
-	glUniform1i(uniforms[GBA_GL_OBJ_PALETTE], 1);
-	glUniform1i(uniforms[GBA_GL_OBJ_CHARBASE], charBase);
-	glUniform1i(uniforms[GBA_GL_OBJ_STRIDE], stride);
-	glUniform1i(uniforms[GBA_GL_OBJ_LOCALPALETTE], GBAObjAttributesCGetPalette(sprite->c));
-	glUniform4i(uniforms[GBA_GL_OBJ_INFLAGS], GBAObjAttributesCGetPriority(sprite->c) << 3,
-	                                          (renderer->target1Obj || GBAObjAttributesAGetMode(sprite->a) == OBJ_MODE_SEMITRANSPARENT) | (renderer->target2Obj * 2) | (renderer->blendEffect * 4),
-	                                          renderer->blda, GBAObjAttributesAGetMode(sprite->a) == OBJ_MODE_SEMITRANSPARENT);
+	obj->bounds[0] = x;
+	obj->bounds[1] = spriteY;
+	obj->bounds[2] = totalWidth;
+	obj->bounds[3] = totalHeight;
+	obj->dims[0] = width;
+	obj->dims[1] = height;
+	obj->dims[2] = totalWidth;
+	obj->dims[3] = totalHeight;
+	obj->tile[0] = charBase;
+	obj->tile[1] = stride;
+	obj->tile[2] = GBAObjAttributesCGetPalette(sprite->c);
+	obj->tile[3] = GBAObjAttributesAGet256Color(sprite->a);
+	obj->inflags[0] = GBAObjAttributesCGetPriority(sprite->c) << 3;
+	obj->inflags[1] = (renderer->target1Obj || GBAObjAttributesAGetMode(sprite->a) == OBJ_MODE_SEMITRANSPARENT) | (renderer->target2Obj * 2) | (renderer->blendEffect * 4);
+	obj->inflags[2] = renderer->blda;
+	obj->inflags[3] = GBAObjAttributesAGetMode(sprite->a) == OBJ_MODE_SEMITRANSPARENT;
 	if (GBAObjAttributesAIsTransformed(sprite->a)) {
 		struct GBAOAMMatrix mat;
 		LOAD_16(mat.a, 0, &renderer->d.oam->mat[GBAObjAttributesBGetMatIndex(sprite->b)].a);
@@ -1486,50 +1813,117 @@ void GBAVideoGLRendererDrawSprite(struct GBAVideoGLRenderer* renderer, struct GB
 		LOAD_16(mat.c, 0, &renderer->d.oam->mat[GBAObjAttributesBGetMatIndex(sprite->b)].c);
 		LOAD_16(mat.d, 0, &renderer->d.oam->mat[GBAObjAttributesBGetMatIndex(sprite->b)].d);
 
-		glUniformMatrix2fv(uniforms[GBA_GL_OBJ_TRANSFORM], 1, GL_FALSE, (GLfloat[]) { mat.a / 256.f, mat.c / 256.f, mat.b / 256.f, mat.d / 256.f });
+		obj->transform[0] = mat.a / 256.f;
+		obj->transform[1] = mat.c / 256.f;
+		obj->transform[2] = mat.b / 256.f;
+		obj->transform[3] = mat.d / 256.f;
 	} else {
-		int flipX = 1;
-		int flipY = 1;
-		if (GBAObjAttributesBIsHFlip(sprite->b)) {
-			flipX = -1;
-		}
-		if (GBAObjAttributesBIsVFlip(sprite->b)) {
-			flipY = -1;
-		}
-		glUniformMatrix2fv(uniforms[GBA_GL_OBJ_TRANSFORM], 1, GL_FALSE, (GLfloat[]) { flipX, 0, 0, flipY });
+		obj->transform[0] = GBAObjAttributesBIsHFlip(sprite->b) ? -1 : 1;
+		obj->transform[1] = 0;
+		obj->transform[2] = 0;
+		obj->transform[3] = GBAObjAttributesBIsVFlip(sprite->b) ? -1 : 1;
 	}
-	glUniform4i(uniforms[GBA_GL_OBJ_DIMS], width, height, totalWidth, totalHeight);
 	if (GBAObjAttributesAGetMode(sprite->a) == OBJ_MODE_OBJWIN) {
 		int window = ~renderer->objwin & 0x3F;
-		glUniform4f(uniforms[GBA_GL_OBJ_OBJWIN], 1, window / 128.f, renderer->bldb / 16.f, renderer->bldy / 16.f);
-		glDrawBuffers(3, (GLenum[]) { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 });
+		obj->objwin[0] = 1;
+		obj->objwin[1] = window / 128.f;
+		obj->objwin[2] = renderer->bldb / 16.f;
+		obj->objwin[3] = renderer->bldy / 16.f;
 	} else {
-		glUniform4f(uniforms[GBA_GL_OBJ_OBJWIN], 0, 0, 0, 0);
-		glDrawBuffers(2, (GLenum[]) { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 });
+		memset(obj->objwin, 0, sizeof(obj->objwin));
 	}
 	if (GBAObjAttributesAIsMosaic(sprite->a) && GBAObjAttributesAGetMode(sprite->a) != OBJ_MODE_OBJWIN) {
 		int mosaicH = GBAMosaicControlGetObjH(renderer->mosaic) + 1;
 		if (GBAObjAttributesBIsHFlip(sprite->b)) {
 			mosaicH = -mosaicH;
 		}
-		glUniform4i(uniforms[GBA_GL_OBJ_MOSAIC], mosaicH, GBAMosaicControlGetObjV(renderer->mosaic) + 1, x, spriteY);
+		obj->mosaic[0] = mosaicH;
+		obj->mosaic[1] = GBAMosaicControlGetObjV(renderer->mosaic) + 1;
+		obj->mosaic[2] = x;
+		obj->mosaic[3] = spriteY;
+	} else {
+		memset(obj->mosaic, 0, sizeof(obj->mosaic));
+	}
+}
+
+void GBAVideoGLRendererDrawSprite(struct GBAVideoGLRenderer* renderer, struct GBAObj* sprite, int y, int spriteY) {
+	struct GBAVideoGLObj obj;
+	_prepareSprite(renderer, sprite, spriteY, &obj);
+
+	const struct GBAVideoGLShader* shader = &renderer->objShader[obj.tile[3]];
+	const GLuint* uniforms = shader->uniforms;
+	glViewport(obj.bounds[0] * renderer->scale, obj.bounds[1] * renderer->scale, obj.bounds[2] * renderer->scale, obj.bounds[3] * renderer->scale);
+	glScissor(obj.bounds[0] * renderer->scale, renderer->firstY * renderer->scale, obj.bounds[2] * renderer->scale, (y - renderer->firstY + 1) * renderer->scale);
+	_useShader(renderer, shader);
+	glUniform2i(uniforms[GBA_GL_VS_LOC], obj.bounds[3], 0);
+	glUniform2i(uniforms[GBA_GL_VS_MAXPOS], obj.bounds[2], obj.bounds[3]);
+	glUniform1i(uniforms[GBA_GL_OBJ_CHARBASE], obj.tile[0]);
+	glUniform1i(uniforms[GBA_GL_OBJ_STRIDE], obj.tile[1]);
+	glUniform1i(uniforms[GBA_GL_OBJ_LOCALPALETTE], obj.tile[2]);
+	glUniform4iv(uniforms[GBA_GL_OBJ_INFLAGS], 1, obj.inflags);
+	glUniformMatrix2fv(uniforms[GBA_GL_OBJ_TRANSFORM], 1, GL_FALSE, obj.transform);
+	glUniform4iv(uniforms[GBA_GL_OBJ_DIMS], 1, obj.dims);
+	glUniform4fv(uniforms[GBA_GL_OBJ_OBJWIN], 1, obj.objwin);
+	glUniform4iv(uniforms[GBA_GL_OBJ_MOSAIC], 1, obj.mosaic);
+	if (obj.objwin[0] > 0) {
+		glDrawBuffers(3, (GLenum[]) { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 });
 	} else {
-		glUniform4i(uniforms[GBA_GL_OBJ_MOSAIC], 0, 0, 0, 0);
+		glDrawBuffers(2, (GLenum[]) { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 });
 	}
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 	glDrawBuffers(1, (GLenum[]) { GL_COLOR_ATTACHMENT0 });
 }
 
+// Draws the same sprites as calling GBAVideoGLRendererDrawSprite on each of them in turn, but with
+// one instanced draw per run of sprites that do or don't write the OBJ window
+static void _drawSpritesBatched(struct GBAVideoGLRenderer* renderer, int y) {
+	struct GBAVideoGLObj objs[128];
+	int nObjs = 0;
+	int i;
+	for (i = renderer->oamMax; i--;) {
+		struct GBAVideoRendererSprite* sprite = &renderer->sprites[i];
+		if ((y < sprite->y && (sprite->endY - 256 < 0 || renderer->firstY >= sprite->endY - 256)) || renderer->firstY >= sprite->endY) {
+			continue;
+		}
+		_prepareSprite(renderer, &sprite->obj, sprite->y, &objs[nObjs]);
+		++nObjs;
+	}
+	if (!nObjs) {
+		return;
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, renderer->objUbo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(objs), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(*objs) * nObjs, objs);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, renderer->objUbo);
+
+	const GLuint* uniforms = renderer->objBatchShader.uniforms;
+	glViewport(0, 0, GBA_VIDEO_HORIZONTAL_PIXELS * renderer->scale, GBA_VIDEO_VERTICAL_PIXELS * renderer->scale);
+	glScissor(0, renderer->firstY * renderer->scale, GBA_VIDEO_HORIZONTAL_PIXELS * renderer->scale, (y - renderer->firstY + 1) * renderer->scale);
+	_useShader(renderer, &renderer->objBatchShader);
+	int start = 0;
+	for (i = 1; i <= nObjs; ++i) {
+		bool objwin = objs[start].objwin[0] > 0;
+		if (i < nObjs && (objs[i].objwin[0] > 0) == objwin) {
+			continue;
+		}
+		if (objwin) {
+			glDrawBuffers(3, (GLenum[]) { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 });
+		} else {
+			glDrawBuffers(2, (GLenum[]) { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 });
+		}
+		glUniform1i(uniforms[GBA_GL_OBJ_BASE], start);
+		glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, i - start);
+		start = i;
+	}
+	glDrawBuffers(1, (GLenum[]) { GL_COLOR_ATTACHMENT0 });
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, 0);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
 void _prepareBackground(struct GBAVideoGLRenderer* renderer, struct GBAVideoGLBackground* background, const GLuint* uniforms) {
 	glBindFramebuffer(GL_FRAMEBUFFER, background->fbo);
 	glViewport(0, 0, GBA_VIDEO_HORIZONTAL_PIXELS * renderer->scale, GBA_VIDEO_VERTICAL_PIXELS * renderer->scale);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, renderer->vramTex);
-	glActiveTexture(GL_TEXTURE0 + 1);
-	glBindTexture(GL_TEXTURE_2D, renderer->paletteTex);
-	glUniform2i(uniforms[GBA_GL_VS_MAXPOS], GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
-	glUniform1i(uniforms[GBA_GL_BG_VRAM], 0);
-	glUniform1i(uniforms[GBA_GL_BG_PALETTE], 1);
 	if (background->mosaic) {
 		glUniform2i(uniforms[GBA_GL_BG_MOSAIC], GBAMosaicControlGetBgV(renderer->mosaic) + 1, GBAMosaicControlGetBgH(renderer->mosaic) + 1);
 	} else {
@@ -1557,8 +1951,7 @@ void GBAVideoGLRendererDrawBackgroundMode0(struct GBAVideoGLRenderer* renderer,
 
 	const struct GBAVideoGLShader* shader = &renderer->bgShader[background->multipalette ? 1 : 0];
 	const GLuint* uniforms = shader->uniforms;
-	glUseProgram(shader->program);
-	glBindVertexArray(shader->vao);
+	_useShader(renderer, shader);
 	_prepareBackground(renderer, background, uniforms);
 	glUniform1i(uniforms[GBA_GL_BG_SCREENBASE], background->screenBase);
 	glUniform1i(uniforms[GBA_GL_BG_CHARBASE], background->charBase);
@@ -1596,15 +1989,13 @@ void _prepareTransform(struct GBAVideoGLRenderer* renderer, struct GBAVideoGLBac
 
 	glActiveTexture(GL_TEXTURE0 + 2);
 	glBindTexture(GL_TEXTURE_2D, renderer->layers[GBA_GL_TEX_AFFINE_2 + background->index - 2]);
-	glUniform1i(uniforms[GBA_GL_BG_TRANSFORM], 2);
 	_prepareBackground(renderer, background, uniforms);
 }
 
 void GBAVideoGLRendererDrawBackgroundMode2(struct GBAVideoGLRenderer* renderer, struct GBAVideoGLBackground* background, int y) {
 	const struct GBAVideoGLShader* shader = &renderer->bgShader[background->overflow ? 2 : 3];
 	const GLuint* uniforms = shader->uniforms;
-	glUseProgram(shader->program);
-	glBindVertexArray(shader->vao);
+	_useShader(renderer, shader);
 	_prepareTransform(renderer, background, uniforms, y);
 	glUniform1i(uniforms[GBA_GL_BG_SCREENBASE], background->screenBase);
 	glUniform1i(uniforms[GBA_GL_BG_CHARBASE], background->charBase);
@@ -1618,8 +2009,7 @@ void GBAVideoGLRendererDrawBackgroundMode3(struct GBAVideoGLRenderer* renderer,
 	const GLuint* uniforms = shader->uniforms;
 	glBindFramebuffer(GL_FRAMEBUFFER, background->fbo);
 	glViewport(0, 0, GBA_VIDEO_HORIZONTAL_PIXELS * renderer->scale, GBA_VIDEO_VERTICAL_PIXELS * renderer->scale);
-	glUseProgram(shader->program);
-	glBindVertexArray(shader->vao);
+	_useShader(renderer, shader);
 	_prepareTransform(renderer, background, uniforms, y);
 	glUniform1i(uniforms[GBA_GL_BG_CHARBASE], 0);
 	glUniform2i(uniforms[GBA_GL_BG_SIZE], GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
@@ -1632,8 +2022,7 @@ void GBAVideoGLRendererDrawBackgroundMode4(struct GBAVideoGLRenderer* renderer,
 	const GLuint* uniforms = shader->uniforms;
 	glBindFramebuffer(GL_FRAMEBUFFER, background->fbo);
 	glViewport(0, 0, GBA_VIDEO_HORIZONTAL_PIXELS * renderer->scale, GBA_VIDEO_VERTICAL_PIXELS * renderer->scale);
-	glUseProgram(shader->program);
-	glBindVertexArray(shader->vao);
+	_useShader(renderer, shader);
 	_prepareTransform(renderer, background, uniforms, y);
 	glUniform1i(uniforms[GBA_GL_BG_CHARBASE], GBARegisterDISPCNTIsFrameSelect(renderer->dispcnt) ? 0xA000 : 0);
 	glUniform2i(uniforms[GBA_GL_BG_SIZE], GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
@@ -1646,8 +2035,7 @@ void GBAVideoGLRendererDrawBackgroundMode5(struct GBAVideoGLRenderer* renderer,
 	const GLuint* uniforms = shader->uniforms;
 	glBindFramebuffer(GL_FRAMEBUFFER, background->fbo);
 	glViewport(0, 0, GBA_VIDEO_HORIZONTAL_PIXELS * renderer->scale, GBA_VIDEO_VERTICAL_PIXELS * renderer->scale);
-	glUseProgram(shader->program);
-	glBindVertexArray(shader->vao);
+	_useShader(renderer, shader);
 	_prepareTransform(renderer, background, uniforms, y);
 	glUniform1i(uniforms[GBA_GL_BG_CHARBASE], GBARegisterDISPCNTIsFrameSelect(renderer->dispcnt) ? 0x5000 : 0);
 	glUniform2i(uniforms[GBA_GL_BG_SIZE], 160, 128);
@@ -0,0 +1,639 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/gba/renderers/observation.h>
+
+#include <mgba/core/cache-set.h>
+#include <mgba/internal/arm/macros.h>
+#include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/renderers/cache-set.h>
+
+#define NO_PIXEL 0xFFFF
+#define OBJ_BASE 0x10000
+#define BITMAP_OBJ_BASE 0x14000
+#define BITMAP_FRAME 0xA000
+
+static void GBAVideoObservationRendererInit(struct GBAVideoRenderer* renderer);
+static void GBAVideoObservationRendererReset(struct GBAVideoRenderer* renderer);
+static void GBAVideoObservationRendererDeinit(struct GBAVideoRenderer* renderer);
+static uint16_t GBAVideoObservationRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
+static void GBAVideoObservationRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address);
+static void GBAVideoObservationRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
+static void GBAVideoObservationRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam);
+static void GBAVideoObservationRendererDrawScanline(struct GBAVideoRenderer* renderer, int y);
+static void GBAVideoObservationRendererFinishFrame(struct GBAVideoRenderer* renderer);
+static void GBAVideoObservationRendererGetPixels(struct GBAVideoRenderer* renderer, size_t* stride, const void** pixels);
+static void GBAVideoObservationRendererPutPixels(struct GBAVideoRenderer* renderer, size_t stride, const void* pixels);
+
+void GBAVideoObservationRendererCreate(struct GBAVideoObservationRenderer* renderer) {
+	memset(renderer, 0, sizeof(*renderer));
+	renderer->d.init = GBAVideoObservationRendererInit;
+	renderer->d.reset = GBAVideoObservationRendererReset;
+	renderer->d.deinit = GBAVideoObservationRendererDeinit;
+	renderer->d.writeVideoRegister = GBAVideoObservationRendererWriteVideoRegister;
+	renderer->d.writeVRAM = GBAVideoObservationRendererWriteVRAM;
+	renderer->d.writePalette = GBAVideoObservationRendererWritePalette;
+	renderer->d.writeOAM = GBAVideoObservationRendererWriteOAM;
+	renderer->d.drawScanline = GBAVideoObservationRendererDrawScanline;
+	renderer->d.finishFrame = GBAVideoObservationRendererFinishFrame;
+	renderer->d.getPixels = GBAVideoObservationRendererGetPixels;
+	renderer->d.putPixels = GBAVideoObservationRendererPutPixels;
+	renderer->scale = 1;
+}
+
+static unsigned _scale(const struct GBAVideoObservationRenderer* renderer) {
+	if (!renderer->scale) {
+		return 1;
+	}
+	if (renderer->scale > GBA_OBSERVATION_MAX_SCALE) {
+		return GBA_OBSERVATION_MAX_SCALE;
+	}
+	return renderer->scale;
+}
+
+unsigned GBAVideoObservationWidth(const struct GBAVideoObservationRenderer* renderer) {
+	unsigned scale = _scale(renderer);
+	return (GBA_VIDEO_HORIZONTAL_PIXELS + scale - 1) / scale;
+}
+
+unsigned GBAVideoObservationHeight(const struct GBAVideoObservationRenderer* renderer) {
+	unsigned scale = _scale(renderer);
+	return (GBA_VIDEO_VERTICAL_PIXELS + scale - 1) / scale;
+}
+
+static uint8_t _luma(uint16_t color) {
+	unsigned r = color & 0x1F;
+	unsigned g = (color >> 5) & 0x1F;
+	unsigned b = (color >> 10) & 0x1F;
+	r = (r << 3) | (r >> 2);
+	g = (g << 3) | (g >> 2);
+	b = (b << 3) | (b >> 2);
+	return (r * 77 + g * 150 + b * 29) >> 8;
+}
+
+static void GBAVideoObservationRendererInit(struct GBAVideoRenderer* renderer) {
+	GBAVideoObservationRendererReset(renderer);
+}
+
+static void GBAVideoObservationRendererReset(struct GBAVideoRenderer* renderer) {
+	struct GBAVideoObservationRenderer* observationRenderer = (struct GBAVideoObservationRenderer*) renderer;
+	observationRenderer->dispcnt = 0x0080;
+	memset(observationRenderer->bg, 0, sizeof(observationRenderer->bg));
+	int i;
+	for (i = 2; i < 4; ++i) {
+		observationRenderer->bg[i].dx = 256;
+		observationRenderer->bg[i].dmy = 256;
+	}
+	for (i = 0; i < SIZE_PALETTE_RAM / 2; ++i) {
+		uint16_t color;
+		LOAD_16(color, i << 1, renderer->palette);
+		observationRenderer->luma[i] = _luma(color);
+	}
+	observationRenderer->tilemapLayers = 0;
+	observationRenderer->oamMax = 0;
+	observationRenderer->oamDirty = true;
+}
+
+static void GBAVideoObservationRendererDeinit(struct GBAVideoRenderer* renderer) {
+	UNUSED(renderer);
+	// Nothing to do
+}
+
+static void _writeReference(int32_t* reference, int32_t* latched, uint16_t value, bool high) {
+	if (high) {
+		*reference = (*reference & 0x0000FFFF) | (value << 16);
+		*reference <<= 4;
+		*reference >>= 4;
+	} else {
+		*reference = (*reference & 0xFFFF0000) | value;
+	}
+	*latched = *reference;
+}
+
+static uint16_t GBAVideoObservationRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
+	struct GBAVideoObservationRenderer* observationRenderer = (struct GBAVideoObservationRenderer*) renderer;
+	if (renderer->cache) {
+		GBAVideoCacheWriteVideoRegister(renderer->cache, address, value);
+	}
+	struct GBAVideoObservationBackground* bg;
+	switch (address) {
+	case REG_DISPCNT:
+		value &= 0xFFF7;
+		observationRenderer->dispcnt = value;
+		break;
+	case REG_BG0CNT:
+	case REG_BG1CNT:
+		value &= 0xDFFF;
+		observationRenderer->bg[(address - REG_BG0CNT) >> 1].control = value;
+		break;
+	case REG_BG2CNT:
+	case REG_BG3CNT:
+		observationRenderer->bg[(address - REG_BG0CNT) >> 1].control = value;
+		break;
+	case REG_BG0HOFS:
+	case REG_BG1HOFS:
+	case REG_BG2HOFS:
+	case REG_BG3HOFS:
+		value &= 0x01FF;
+		observationRenderer->bg[(address - REG_BG0HOFS) >> 2].x = value;
+		break;
+	case REG_BG0VOFS:
+	case REG_BG1VOFS:
+	case REG_BG2VOFS:
+	case REG_BG3VOFS:
+		value &= 0x01FF;
+		observationRenderer->bg[(address - REG_BG0VOFS) >> 2].y = value;
+		break;
+	case REG_BG2PA:
+	case REG_BG3PA:
+		observationRenderer->bg[address < REG_BG3PA ? 2 : 3].dx = value;
+		break;
+	case REG_BG2PB:
+	case REG_BG3PB:
+		observationRenderer->bg[address < REG_BG3PA ? 2 : 3].dmx = value;
+		break;
+	case REG_BG2PC:
+	case REG_BG3PC:
+		observationRenderer->bg[address < REG_BG3PA ? 2 : 3].dy = value;
+		break;
+	case REG_BG2PD:
+	case REG_BG3PD:
+		observationRenderer->bg[address < REG_BG3PA ? 2 : 3].dmy = value;
+		break;
+	case REG_BG2X_LO:
+	case REG_BG2X_HI:
+	case REG_BG3X_LO:
+	case REG_BG3X_HI:
+		bg = &observationRenderer->bg[address < REG_BG3PA ? 2 : 3];
+		_writeReference(&bg->refx, &bg->sx, value, address & 2);
+		break;
+	case REG_BG2Y_LO:
+	case REG_BG2Y_HI:
+	case REG_BG3Y_LO:
+	case REG_BG3Y_HI:
+		bg = &observationRenderer->bg[address < REG_BG3PA ? 2 : 3];
+		_writeReference(&bg->refy, &bg->sy, value, address & 2);
+		break;
+	case REG_BLDCNT:
+		value &= 0x3FFF;
+		break;
+	case REG_BLDALPHA:
+		value &= 0x1F1F;
+		break;
+	case REG_WININ:
+	case REG_WINOUT:
+		value &= 0x3F3F;
+		break;
+	default:
+		break;
+	}
+	return value;
+}
+
+static void GBAVideoObservationRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address) {
+	if (renderer->cache) {
+		mCacheSetWriteVRAM(renderer->cache, address);
+	}
+}
+
+static void GBAVideoObservationRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
+	struct GBAVideoObservationRenderer* observationRenderer = (struct GBAVideoObservationRenderer*) renderer;
+	observationRenderer->luma[address >> 1] = _luma(value);
+	if (renderer->cache) {
+		mCacheSetWritePalette(renderer->cache, address >> 1, mColorFrom555(value));
+	}
+}
+
+static void GBAVideoObservationRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam) {
+	UNUSED(oam);
+	struct GBAVideoObservationRenderer* observationRenderer = (struct GBAVideoObservationRenderer*) renderer;
+	observationRenderer->oamDirty = true;
+}
+
+static inline uint8_t _vram8(const struct GBAVideoObservationRenderer* renderer, uint32_t address) {
+	uint16_t value;
+	LOAD_16(value, address & 0x1FFFE, renderer->d.vram);
+	return address & 1 ? value >> 8 : value;
+}
+
+static inline uint16_t _vram16(const struct GBAVideoObservationRenderer* renderer, uint32_t address) {
+	uint16_t value;
+	LOAD_16(value, address & 0x1FFFE, renderer->d.vram);
+	return value;
+}
+
+static uint16_t _textMapEntry(const struct GBAVideoObservationRenderer* renderer, const struct GBAVideoObservationBackground* bg, unsigned x, unsigned y) {
+	unsigned size = GBARegisterBGCNTGetSize(bg->control);
+	x &= (size & 1) ? 0x1FF : 0xFF;
+	y &= (size & 2) ? 0x1FF : 0xFF;
+	unsigned block = (x >> 8) + ((y >> 8) << (size & 1));
+	uint32_t address = GBARegisterBGCNTGetScreenBase(bg->control) * 0x800 + block * 0x800 + (((y >> 3) & 0x1F) * 32 + ((x >> 3) & 0x1F)) * 2;
+	return _vram16(renderer, address);
+}
+
+static uint64_t _reverseNibbles(uint64_t row) {
+	row = ((row >> 4) & 0x0F0F0F0F) | ((row & 0x0F0F0F0F) << 4);
+	row = ((row >> 8) & 0x00FF00FF) | ((row & 0x00FF00FF) << 8);
+	return ((row >> 16) | (row << 16)) & 0xFFFFFFFF;
+}
+
+static uint64_t _reverseBytes(uint64_t row) {
+	row = ((row >> 8) & 0x00FF00FF00FF00FFULL) | ((row & 0x00FF00FF00FF00FFULL) << 8);
+	row = ((row >> 16) & 0x0000FFFF0000FFFFULL) | ((row & 0x0000FFFF0000FFFFULL) << 16);
+	return (row >> 32) | (row << 32);
+}
+
+static void _drawTextLine(const struct GBAVideoObservationRenderer* renderer, const struct GBAVideoObservationBackground* bg, int y, unsigned scale, unsigned width, uint16_t* line) {
+	unsigned localY = y + bg->y;
+	uint32_t charBase = GBARegisterBGCNTGetCharBase(bg->control) * 0x4000;
+	bool is256 = GBARegisterBGCNTIs256Color(bg->control);
+	unsigned bits = is256 ? 8 : 4;
+	unsigned mask = is256 ? 0xFF : 0xF;
+	unsigned column = 0;
+	// Each tile row is fetched once and every sample that lands in it is taken from there
+	while (column < width) {
+		unsigned localX = column * scale + bg->x;
+		uint16_t map = _textMapEntry(renderer, bg, localX, localY);
+		unsigned tileY = (localY & 7) ^ (GBA_TEXT_MAP_VFLIP(map) ? 7 : 0);
+		uint32_t address = charBase + (is256 ? GBA_TEXT_MAP_TILE(map) * 64 + tileY * 8 : GBA_TEXT_MAP_TILE(map) * 32 + tileY * 4);
+		unsigned tileX = localX & 7;
+		unsigned samples = (8 - tileX + scale - 1) / scale;
+		if (samples > width - column) {
+			samples = width - column;
+		}
+		uint64_t row = 0;
+		if (address < OBJ_BASE) {
+			uint32_t low;
+			LOAD_32(low, address & 0x1FFFC, renderer->d.vram);
+			row = low;
+			if (is256) {
+				uint32_t high;
+				LOAD_32(high, (address + 4) & 0x1FFFC, renderer->d.vram);
+				row |= (uint64_t) high << 32;
+			}
+		}
+		if (row && GBA_TEXT_MAP_HFLIP(map)) {
+			row = is256 ? _reverseBytes(row) : _reverseNibbles(row);
+		}
+		if (row) {
+			unsigned palette = is256 ? 0 : GBA_TEXT_MAP_PALETTE(map) * 16;
+			unsigned i;
+			if (samples == 8) {
+				// A whole tile at full resolution, which the compiler can unroll
+				if (is256) {
+					for (i = 0; i < 8; ++i) {
+						unsigned index = (row >> (i * 8)) & 0xFF;
+						uint16_t current = line[column + i];
+						line[column + i] = (index != 0) & (current == NO_PIXEL) ? index : current;
+					}
+				} else {
+					for (i = 0; i < 8; ++i) {
+						unsigned index = (row >> (i * 4)) & 0xF;
+						uint16_t current = line[column + i];
+						line[column + i] = (index != 0) & (current == NO_PIXEL) ? palette + index : current;
+					}
+				}
+			} else {
+				for (i = 0; i < samples; ++i) {
+					unsigned index = (row >> ((tileX + i * scale) * bits)) & mask;
+					uint16_t current = line[column + i];
+					line[column + i] = (index != 0) & (current == NO_PIXEL) ? palette + index : current;
+				}
+			}
+		}
+		column += samples;
+	}
+}
+
+static bool _affineCoordinates(const struct GBAVideoObservationBackground* bg, int32_t sx, int32_t sy, unsigned x, unsigned size, unsigned* outX, unsigned* outY) {
+	int32_t tx = (sx + bg->dx * (int32_t) x) >> 8;
+	int32_t ty = (sy + bg->dy * (int32_t) x) >> 8;
+	if (GBARegisterBGCNTIsOverflow(bg->control)) {
+		tx &= size - 1;
+		ty &= size - 1;
+	} else if (tx < 0 || ty < 0 || tx >= (int32_t) size || ty >= (int32_t) size) {
+		return false;
+	}
+	*outX = tx;
+	*outY = ty;
+	return true;
+}
+
+static uint16_t _affinePixel(const struct GBAVideoObservationRenderer* renderer, const struct GBAVideoObservationBackground* bg, unsigned x) {
+	unsigned size = 128 << GBARegisterBGCNTGetSize(bg->control);
+	unsigned tx, ty;
+	if (!_affineCoordinates(bg, bg->sx, bg->sy, x, size, &tx, &ty)) {
+		return NO_PIXEL;
+	}
+	uint8_t tile = _vram8(renderer, GBARegisterBGCNTGetScreenBase(bg->control) * 0x800 + (ty >> 3) * (size >> 3) + (tx >> 3));
+	uint32_t address = GBARegisterBGCNTGetCharBase(bg->control) * 0x4000 + tile * 64 + (ty & 7) * 8 + (tx & 7);
+	if (address >= OBJ_BASE) {
+		return NO_PIXEL;
+	}
+	uint8_t index = _vram8(renderer, address);
+	return index ? index : NO_PIXEL;
+}
+
+static uint16_t _bitmapPixel(const struct GBAVideoObservationRenderer* renderer, const struct GBAVideoObservationBackground* bg, int mode, unsigned x) {
+	int32_t tx = (bg->sx + bg->dx * (int32_t) x) >> 8;
+	int32_t ty = (bg->sy + bg->dy * (int32_t) x) >> 8;
+	int32_t width = mode == 5 ? 160 : GBA_VIDEO_HORIZONTAL_PIXELS;
+	int32_t height = mode == 5 ? 128 : GBA_VIDEO_VERTICAL_PIXELS;
+	if (tx < 0 || ty < 0 || tx >= width || ty >= height) {
+		return NO_PIXEL;
+	}
+	uint32_t frame = mode != 3 && GBARegisterDISPCNTIsFrameSelect(renderer->dispcnt) ? BITMAP_FRAME : 0;
+	if (mode == 4) {
+		uint8_t index = _vram8(renderer, frame + ty * width + tx);
+		return index ? index : NO_PIXEL;
+	}
+	return (_vram16(renderer, frame + (ty * width + tx) * 2) & 0x7FFF) | GBA_OBSERVATION_DIRECT_COLOR;
+}
+
+static void _drawBackgroundLine(const struct GBAVideoObservationRenderer* renderer, int mode, int index, int y, unsigned scale, unsigned width, uint16_t* line) {
+	const struct GBAVideoObservationBackground* bg = &renderer->bg[index];
+	if (mode == 0 || (mode == 1 && index < 2)) {
+		_drawTextLine(renderer, bg, y, scale, width, line);
+		return;
+	}
+	unsigned column;
+	for (column = 0; column < width; ++column) {
+		if (line[column] == NO_PIXEL) {
+			line[column] = mode >= 3 ? _bitmapPixel(renderer, bg, mode, column * scale) : _affinePixel(renderer, bg, column * scale);
+		}
+	}
+}
+
+static void _drawSprite(const struct GBAVideoObservationRenderer* renderer, const struct GBAVideoRendererSprite* sprite, int y, unsigned scale, uint16_t* pixels, uint8_t* priorities) {
+	struct GBAObj obj = sprite->obj;
+	enum GBAVideoObjMode mode = GBAObjAttributesAGetMode(obj.a);
+	if (mode == OBJ_MODE_OBJWIN || mode == 3) {
+		return;
+	}
+	int width = GBAVideoObjSizes[GBAObjAttributesAGetShape(obj.a) * 4 + GBAObjAttributesBGetSize(obj.b)][0];
+	int height = GBAVideoObjSizes[GBAObjAttributesAGetShape(obj.a) * 4 + GBAObjAttributesBGetSize(obj.b)][1];
+	int totalWidth = width;
+	int totalHeight = height;
+	bool transformed = GBAObjAttributesAIsTransformed(obj.a);
+	if (transformed) {
+		totalWidth <<= GBAObjAttributesAGetDoubleSize(obj.a);
+		totalHeight <<= GBAObjAttributesAGetDoubleSize(obj.a);
+	}
+	int localY = y - sprite->y;
+	if (localY < 0) {
+		localY += 256;
+	}
+	int x = GBAObjAttributesBGetX(obj.b);
+	if (x >= GBA_VIDEO_HORIZONTAL_PIXELS) {
+		x -= 512;
+	}
+	int start = x < 0 ? 0 : x;
+	start = (start + scale - 1) / scale * scale;
+	int end = x + totalWidth;
+	if (end > GBA_VIDEO_HORIZONTAL_PIXELS) {
+		end = GBA_VIDEO_HORIZONTAL_PIXELS;
+	}
+
+	bool is256 = GBAObjAttributesAIs256Color(obj.a);
+	unsigned tileBase = GBAObjAttributesCGetTile(obj.c);
+	unsigned palette = 256 + (is256 ? 0 : GBAObjAttributesCGetPalette(obj.c) * 16);
+	unsigned priority = GBAObjAttributesCGetPriority(obj.c);
+	unsigned stride = GBARegisterDISPCNTIsObjCharacterMapping(renderer->dispcnt) ? (width >> 3) << is256 : 32;
+	uint32_t minAddress = GBARegisterDISPCNTGetMode(renderer->dispcnt) >= 3 ? BITMAP_OBJ_BASE : OBJ_BASE;
+	int16_t mat[4] = { 0 };
+	if (transformed) {
+		const struct GBAOAMMatrix* source = &renderer->d.oam->mat[GBAObjAttributesBGetMatIndex(obj.b)];
+		LOAD_16(mat[0], 0, &source->a);
+		LOAD_16(mat[1], 0, &source->b);
+		LOAD_16(mat[2], 0, &source->c);
+		LOAD_16(mat[3], 0, &source->d);
+	}
+
+	int screenX;
+	for (screenX = start; screenX < end; screenX += scale) {
+		unsigned column = screenX / scale;
+		if (pixels[column] != NO_PIXEL && priorities[column] <= priority) {
+			continue;
+		}
+		int tx, ty;
+		if (transformed) {
+			int dx = screenX - x - (totalWidth >> 1);
+			int dy = localY - (totalHeight >> 1);
+			tx = ((mat[0] * dx + mat[1] * dy) >> 8) + (width >> 1);
+			ty = ((mat[2] * dx + mat[3] * dy) >> 8) + (height >> 1);
+			if (tx < 0 || ty < 0 || tx >= width || ty >= height) {
+				continue;
+			}
+		} else {
+			tx = screenX - x;
+			ty = localY;
+			if (GBAObjAttributesBIsHFlip(obj.b)) {
+				tx = width - 1 - tx;
+			}
+			if (GBAObjAttributesBIsVFlip(obj.b)) {
+				ty = height - 1 - ty;
+			}
+		}
+		unsigned tile = (tileBase + (ty >> 3) * stride + ((tx >> 3) << is256)) & 0x3FF;
+		uint32_t address = OBJ_BASE + tile * 32;
+		uint8_t index;
+		if (is256) {
+			address += (ty & 7) * 8 + (tx & 7);
+			if (address < minAddress) {
+				continue;
+			}
+			index = _vram8(renderer, address);
+		} else {
+			address += (ty & 7) * 4 + ((tx & 7) >> 1);
+			if (address < minAddress) {
+				continue;
+			}
+			index = _vram8(renderer, address);
+			index = tx & 1 ? index >> 4 : index & 0xF;
+		}
+		if (index) {
+			pixels[column] = palette + index;
+			priorities[column] = priority;
+		}
+	}
+}
+
+static void _writeLine(struct GBAVideoObservationRenderer* renderer, unsigned row, unsigned width, const uint16_t* line) {
+	unsigned column;
+	if (renderer->format == GBA_OBSERVATION_GRAY8) {
+		uint8_t* out = &((uint8_t*) renderer->pixels)[row * renderer->stride];
+		for (column = 0; column < width; ++column) {
+			uint16_t sample = line[column];
+			if (sample == NO_PIXEL) {
+				out[column] = renderer->luma[0];
+			} else {
+				out[column] = sample & GBA_OBSERVATION_DIRECT_COLOR ? _luma(sample) : renderer->luma[sample];
+			}
+		}
+	} else {
+		// Samples that no layer covered show the backdrop
+		uint16_t* out = &((uint16_t*) renderer->pixels)[row * renderer->stride];
+		for (column = 0; column < width; ++column) {
+			uint16_t sample = line[column];
+			out[column] = sample == NO_PIXEL ? 0 : sample;
+		}
+	}
+}
+
+static void _drawSampledLine(struct GBAVideoObservationRenderer* renderer, int y, unsigned scale) {
+	unsigned row = y / scale;
+	unsigned width = GBAVideoObservationWidth(renderer);
+	uint16_t line[GBA_VIDEO_HORIZONTAL_PIXELS];
+	unsigned column;
+	if (GBARegisterDISPCNTIsForcedBlank(renderer->dispcnt)) {
+		for (column = 0; column < width; ++column) {
+			line[column] = 0x7FFF | GBA_OBSERVATION_DIRECT_COLOR;
+		}
+		_writeLine(renderer, row, width, line);
+		return;
+	}
+
+	int mode = GBARegisterDISPCNTGetMode(renderer->dispcnt);
+	unsigned enabled = (renderer->dispcnt >> 8) & 0xF;
+	switch (mode) {
+	case 0:
+		break;
+	case 1:
+		enabled &= 0x7;
+		break;
+	case 2:
+		enabled &= 0xC;
+		break;
+	case 3:
+	case 4:
+	case 5:
+		enabled &= 0x4;
+		break;
+	default:
+		enabled = 0;
+		break;
+	}
+
+	uint16_t objPixels[GBA_VIDEO_HORIZONTAL_PIXELS];
+	uint8_t objPriorities[GBA_VIDEO_HORIZONTAL_PIXELS];
+	unsigned objLayers = 0;
+	int i;
+	if (GBARegisterDISPCNTIsObjEnable(renderer->dispcnt) && !renderer->d.disableOBJ) {
+		if (renderer->oamDirty) {
+			renderer->oamMax = GBAVideoRendererCleanOAM(renderer->d.oam->obj, renderer->sprites, 0);
+			renderer->oamDirty = false;
+		}
+		memset(objPixels, 0xFF, width * sizeof(*objPixels));
+		memset(objPriorities, 0, width * sizeof(*objPriorities));
+		for (i = 0; i < renderer->oamMax; ++i) {
+			const struct GBAVideoRendererSprite* sprite = &renderer->sprites[i];
+			if ((y < sprite->y && (sprite->endY - 256 < 0 || y >= sprite->endY - 256)) || y >= sprite->endY) {
+				continue;
+			}
+			_drawSprite(renderer, sprite, y, scale, objPixels, objPriorities);
+			objLayers |= 1 << GBAObjAttributesCGetPriority(sprite->obj.c);
+		}
+	}
+
+	// Layers are drawn front to back, each only filling in what is still uncovered
+	memset(line, 0xFF, width * sizeof(*line));
+	unsigned priority;
+	for (priority = 0; priority < 4; ++priority) {
+		if (objLayers & (1 << priority)) {
+			for (column = 0; column < width; ++column) {
+				uint16_t current = line[column];
+				line[column] = (current == NO_PIXEL) & (objPriorities[column] == priority) ? objPixels[column] : current;
+			}
+		}
+		for (i = 0; i < 4; ++i) {
+			if ((enabled & (1 << i)) && !renderer->d.disableBG[i] && GBARegisterBGCNTGetPriority(renderer->bg[i].control) == priority) {
+				_drawBackgroundLine(renderer, mode, i, y, scale, width, line);
+			}
+		}
+	}
+	_writeLine(renderer, row, width, line);
+}
+
+static void GBAVideoObservationRendererDrawScanline(struct GBAVideoRenderer* renderer, int y) {
+	struct GBAVideoObservationRenderer* observationRenderer = (struct GBAVideoObservationRenderer*) renderer;
+	unsigned scale = _scale(observationRenderer);
+	if (observationRenderer->pixels && observationRenderer->format != GBA_OBSERVATION_NONE && !(y % scale)) {
+		_drawSampledLine(observationRenderer, y, scale);
+	}
+	// The affine reference points move along every line, whether or not it was sampled
+	if (GBARegisterDISPCNTGetMode(observationRenderer->dispcnt) != 0) {
+		int i;
+		for (i = 2; i < 4; ++i) {
+			observationRenderer->bg[i].sx += observationRenderer->bg[i].dmx;
+			observationRenderer->bg[i].sy += observationRenderer->bg[i].dmy;
+		}
+	}
+}
+
+static void _copyTilemap(struct GBAVideoObservationRenderer* renderer, int mode, int index) {
+	const struct GBAVideoObservationBackground* bg = &renderer->bg[index];
+	uint16_t* out = renderer->tilemaps[index];
+	unsigned x, y;
+	if (mode == 0 || (mode == 1 && index < 2)) {
+		for (y = 0; y < GBA_OBSERVATION_TILEMAP_HEIGHT; ++y) {
+			for (x = 0; x < GBA_OBSERVATION_TILEMAP_WIDTH; ++x) {
+				out[y * GBA_OBSERVATION_TILEMAP_WIDTH + x] = _textMapEntry(renderer, bg, bg->x + x * 8, bg->y + y * 8);
+			}
+		}
+		return;
+	}
+	unsigned size = 128 << GBARegisterBGCNTGetSize(bg->control);
+	for (y = 0; y < GBA_OBSERVATION_TILEMAP_HEIGHT; ++y) {
+		int32_t sx = bg->refx + bg->dmx * (int32_t) (y * 8);
+		int32_t sy = bg->refy + bg->dmy * (int32_t) (y * 8);
+		for (x = 0; x < GBA_OBSERVATION_TILEMAP_WIDTH; ++x) {
+			unsigned tx, ty;
+			uint16_t tile = NO_PIXEL;
+			if (_affineCoordinates(bg, sx, sy, x * 8, size, &tx, &ty)) {
+				tile = _vram8(renderer, GBARegisterBGCNTGetScreenBase(bg->control) * 0x800 + (ty >> 3) * (size >> 3) + (tx >> 3));
+			}
+			out[y * GBA_OBSERVATION_TILEMAP_WIDTH + x] = tile;
+		}
+	}
+}
+
+static void GBAVideoObservationRendererFinishFrame(struct GBAVideoRenderer* renderer) {
+	struct GBAVideoObservationRenderer* observationRenderer = (struct GBAVideoObservationRenderer*) renderer;
+	int mode = GBARegisterDISPCNTGetMode(observationRenderer->dispcnt);
+	unsigned layers = 0;
+	if (mode < 3 && !GBARegisterDISPCNTIsForcedBlank(observationRenderer->dispcnt)) {
+		unsigned enabled = (observationRenderer->dispcnt >> 8) & 0xF;
+		int i;
+		for (i = 0; i < 4; ++i) {
+			bool present = mode == 0 || (mode == 1 && i < 3) || (mode == 2 && i >= 2);
+			if (!present || !(enabled & (1 << i)) || !observationRenderer->tilemaps[i]) {
+				continue;
+			}
+			_copyTilemap(observationRenderer, mode, i);
+			layers |= 1 << i;
+		}
+	}
+	observationRenderer->tilemapLayers = layers;
+
+	int i;
+	for (i = 2; i < 4; ++i) {
+		observationRenderer->bg[i].sx = observationRenderer->bg[i].refx;
+		observationRenderer->bg[i].sy = observationRenderer->bg[i].refy;
+	}
+}
+
+static void GBAVideoObservationRendererGetPixels(struct GBAVideoRenderer* renderer, size_t* stride, const void** pixels) {
+	UNUSED(renderer);
+	UNUSED(stride);
+	UNUSED(pixels);
+	// Observations are written straight into the caller's buffers
+}
+
+static void GBAVideoObservationRendererPutPixels(struct GBAVideoRenderer* renderer, size_t stride, const void* pixels) {
+	UNUSED(renderer);
+	UNUSED(stride);
+	UNUSED(pixels);
+	// Nothing to do
+}
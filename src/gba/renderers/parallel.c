@@ -0,0 +1,432 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/gba/renderers/parallel.h>
+
+#ifndef DISABLE_THREADING
+
+#include <mgba/core/cache-set.h>
+#include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/renderers/cache-set.h>
+
+#include <mgba-util/memory.h>
+
+// Each worker owns a full software renderer and replays every command of the
+// frame, but only rasterizes the scanlines where y % nWorkers == index. The
+// other scanlines are run through GBAVideoSoftwareRendererSkipScanline so the
+// per-line state (affine reference points, background enable delays, caches)
+// stays identical to a renderer that drew every line.
+
+DEFINE_VECTOR(GBAVideoParallelCommandList, struct GBAVideoParallelCommand);
+DEFINE_VECTOR(GBAVideoParallelVRAMBlockList, struct GBAVideoParallelVRAMBlock);
+
+enum GBAVideoParallelCommandType {
+	PARALLEL_REGISTER = 0,
+	PARALLEL_VRAM,
+	PARALLEL_PALETTE,
+	PARALLEL_OAM,
+	PARALLEL_SCANLINE,
+	PARALLEL_FRAME,
+};
+
+static void GBAVideoParallelRendererInit(struct GBAVideoRenderer* renderer);
+static void GBAVideoParallelRendererReset(struct GBAVideoRenderer* renderer);
+static void GBAVideoParallelRendererDeinit(struct GBAVideoRenderer* renderer);
+static uint16_t GBAVideoParallelRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
+static void GBAVideoParallelRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address);
+static void GBAVideoParallelRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
+static void GBAVideoParallelRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam);
+static void GBAVideoParallelRendererDrawScanline(struct GBAVideoRenderer* renderer, int y);
+static void GBAVideoParallelRendererFinishFrame(struct GBAVideoRenderer* renderer);
+static void GBAVideoParallelRendererGetPixels(struct GBAVideoRenderer* renderer, size_t* stride, const void** pixels);
+static void GBAVideoParallelRendererPutPixels(struct GBAVideoRenderer* renderer, size_t stride, const void* pixels);
+
+static THREAD_ENTRY _workerThread(void* context);
+
+void GBAVideoParallelRendererCreate(struct GBAVideoParallelRenderer* renderer, struct GBAVideoSoftwareRenderer* backend, int threads) {
+	renderer->d.init = GBAVideoParallelRendererInit;
+	renderer->d.reset = GBAVideoParallelRendererReset;
+	renderer->d.deinit = GBAVideoParallelRendererDeinit;
+	renderer->d.writeVideoRegister = GBAVideoParallelRendererWriteVideoRegister;
+	renderer->d.writeVRAM = GBAVideoParallelRendererWriteVRAM;
+	renderer->d.writeOAM = GBAVideoParallelRendererWriteOAM;
+	renderer->d.writePalette = GBAVideoParallelRendererWritePalette;
+	renderer->d.drawScanline = GBAVideoParallelRendererDrawScanline;
+	renderer->d.finishFrame = GBAVideoParallelRendererFinishFrame;
+	renderer->d.getPixels = GBAVideoParallelRendererGetPixels;
+	renderer->d.putPixels = GBAVideoParallelRendererPutPixels;
+
+	renderer->d.disableBG[0] = false;
+	renderer->d.disableBG[1] = false;
+	renderer->d.disableBG[2] = false;
+	renderer->d.disableBG[3] = false;
+	renderer->d.disableOBJ = false;
+
+	renderer->backend = backend;
+	if (threads < 1) {
+		threads = 1;
+	} else if (threads > GBA_VIDEO_PARALLEL_MAX_THREADS) {
+		threads = GBA_VIDEO_PARALLEL_MAX_THREADS;
+	}
+	renderer->threads = threads;
+}
+
+static void _copyMemory(struct GBAVideoParallelRenderer* parallelRenderer) {
+	int i;
+	for (i = 0; i < parallelRenderer->nWorkers; ++i) {
+		struct GBAVideoParallelWorker* worker = &parallelRenderer->workers[i];
+		memcpy(worker->vram, parallelRenderer->d.vram, SIZE_VRAM);
+		memcpy(worker->palette, parallelRenderer->d.palette, SIZE_PALETTE_RAM);
+		memcpy(worker->oam.raw, parallelRenderer->d.oam->raw, SIZE_OAM);
+	}
+	parallelRenderer->vramDirty = 0;
+}
+
+static void _runCommands(struct GBAVideoParallelRenderer* parallelRenderer, struct GBAVideoParallelWorker* worker) {
+	struct GBAVideoSoftwareRenderer* softwareRenderer = worker->renderer;
+	struct GBAVideoRenderer* backend = &softwareRenderer->d;
+	int nWorkers = parallelRenderer->nWorkers;
+	size_t i;
+	for (i = 0; i < GBAVideoParallelCommandListSize(&parallelRenderer->commands); ++i) {
+		const struct GBAVideoParallelCommand* command = GBAVideoParallelCommandListGetConstPointer(&parallelRenderer->commands, i);
+		switch (command->type) {
+		case PARALLEL_REGISTER:
+			backend->writeVideoRegister(backend, command->address, command->value);
+			break;
+		case PARALLEL_VRAM:
+			memcpy(&worker->vram[command->address >> 1], GBAVideoParallelVRAMBlockListGetConstPointer(&parallelRenderer->vramBlocks, command->value)->data, 0x1000);
+			backend->writeVRAM(backend, command->address);
+			break;
+		case PARALLEL_PALETTE:
+			worker->palette[command->address >> 1] = command->value;
+			backend->writePalette(backend, command->address, command->value);
+			break;
+		case PARALLEL_OAM:
+			worker->oam.raw[command->address] = command->value;
+			backend->writeOAM(backend, command->address);
+			break;
+		case PARALLEL_SCANLINE:
+			if ((int) command->address % nWorkers == worker->index) {
+				backend->drawScanline(backend, command->address);
+			} else {
+				GBAVideoSoftwareRendererSkipScanline(softwareRenderer, command->address);
+			}
+			break;
+		case PARALLEL_FRAME:
+			backend->finishFrame(backend);
+			break;
+		}
+	}
+}
+
+static void _syncWorkers(struct GBAVideoParallelRenderer* parallelRenderer) {
+	struct GBAVideoSoftwareRenderer* primary = parallelRenderer->backend;
+	int i;
+	for (i = 0; i < parallelRenderer->nWorkers; ++i) {
+		struct GBAVideoSoftwareRenderer* softwareRenderer = parallelRenderer->workers[i].renderer;
+		memcpy(softwareRenderer->d.disableBG, parallelRenderer->d.disableBG, sizeof(softwareRenderer->d.disableBG));
+		softwareRenderer->d.disableOBJ = parallelRenderer->d.disableOBJ;
+		if (softwareRenderer == primary) {
+			continue;
+		}
+
+		// The core adjusts the output buffer and layer offsets on the software renderer directly
+		bool dirty = false;
+		if (softwareRenderer->outputBuffer != primary->outputBuffer || softwareRenderer->outputBufferStride != primary->outputBufferStride || softwareRenderer->outputRGB565 != primary->outputRGB565 || softwareRenderer->outputTiled != primary->outputTiled) {
+			softwareRenderer->outputBuffer = primary->outputBuffer;
+			softwareRenderer->outputBufferStride = primary->outputBufferStride;
+			softwareRenderer->outputRGB565 = primary->outputRGB565;
+			softwareRenderer->outputTiled = primary->outputTiled;
+			dirty = true;
+		}
+		int bg;
+		for (bg = 0; bg < 4; ++bg) {
+			if (softwareRenderer->bg[bg].offsetX != primary->bg[bg].offsetX || softwareRenderer->bg[bg].offsetY != primary->bg[bg].offsetY) {
+				softwareRenderer->bg[bg].offsetX = primary->bg[bg].offsetX;
+				softwareRenderer->bg[bg].offsetY = primary->bg[bg].offsetY;
+				dirty = true;
+			}
+		}
+		if (softwareRenderer->objOffsetX != primary->objOffsetX || softwareRenderer->objOffsetY != primary->objOffsetY) {
+			softwareRenderer->objOffsetX = primary->objOffsetX;
+			softwareRenderer->objOffsetY = primary->objOffsetY;
+			softwareRenderer->oamDirty = 1;
+			dirty = true;
+		}
+		if (dirty) {
+			memset(softwareRenderer->scanlineDirty, 0xFFFFFFFF, sizeof(softwareRenderer->scanlineDirty));
+		}
+	}
+}
+
+static void _flush(struct GBAVideoParallelRenderer* parallelRenderer) {
+	if (!GBAVideoParallelCommandListSize(&parallelRenderer->commands)) {
+		return;
+	}
+	_syncWorkers(parallelRenderer);
+
+	MutexLock(&parallelRenderer->mutex);
+	++parallelRenderer->frame;
+	parallelRenderer->pending = parallelRenderer->nWorkers - 1;
+	ConditionWake(&parallelRenderer->toWorkers);
+	MutexUnlock(&parallelRenderer->mutex);
+
+	_runCommands(parallelRenderer, &parallelRenderer->workers[0]);
+
+	MutexLock(&parallelRenderer->mutex);
+	while (parallelRenderer->pending) {
+		ConditionWait(&parallelRenderer->fromWorkers, &parallelRenderer->mutex);
+	}
+	MutexUnlock(&parallelRenderer->mutex);
+
+	GBAVideoParallelCommandListClear(&parallelRenderer->commands);
+	GBAVideoParallelVRAMBlockListClear(&parallelRenderer->vramBlocks);
+}
+
+static void _flushVRAM(struct GBAVideoParallelRenderer* parallelRenderer) {
+	uint32_t bitmap = parallelRenderer->vramDirty;
+	parallelRenderer->vramDirty = 0;
+	int i;
+	for (i = 0; bitmap; ++i, bitmap >>= 1) {
+		if (!(bitmap & 1)) {
+			continue;
+		}
+		struct GBAVideoParallelCommand* command = GBAVideoParallelCommandListAppend(&parallelRenderer->commands);
+		command->type = PARALLEL_VRAM;
+		command->address = i * 0x1000;
+		command->value = GBAVideoParallelVRAMBlockListSize(&parallelRenderer->vramBlocks);
+		struct GBAVideoParallelVRAMBlock* block = GBAVideoParallelVRAMBlockListAppend(&parallelRenderer->vramBlocks);
+		memcpy(block->data, &parallelRenderer->d.vram[command->address >> 1], 0x1000);
+	}
+}
+
+static void _pushCommand(struct GBAVideoParallelRenderer* parallelRenderer, enum GBAVideoParallelCommandType type, uint32_t address, uint16_t value) {
+	struct GBAVideoParallelCommand* command = GBAVideoParallelCommandListAppend(&parallelRenderer->commands);
+	command->type = type;
+	command->address = address;
+	command->value = value;
+}
+
+static void GBAVideoParallelRendererInit(struct GBAVideoRenderer* renderer) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+
+	GBAVideoParallelCommandListInit(&parallelRenderer->commands, 0x1000);
+	GBAVideoParallelVRAMBlockListInit(&parallelRenderer->vramBlocks, 0x20);
+	MutexInit(&parallelRenderer->mutex);
+	ConditionInit(&parallelRenderer->toWorkers);
+	ConditionInit(&parallelRenderer->fromWorkers);
+	parallelRenderer->frame = 0;
+	parallelRenderer->pending = 0;
+	parallelRenderer->stopping = false;
+
+	parallelRenderer->nWorkers = parallelRenderer->threads;
+	parallelRenderer->workers = calloc(parallelRenderer->nWorkers, sizeof(*parallelRenderer->workers));
+	int i;
+	for (i = 0; i < parallelRenderer->nWorkers; ++i) {
+		struct GBAVideoParallelWorker* worker = &parallelRenderer->workers[i];
+		worker->p = parallelRenderer;
+		worker->index = i;
+		worker->frame = 0;
+		worker->vram = anonymousMemoryMap(SIZE_VRAM);
+		if (i) {
+			worker->renderer = malloc(sizeof(*worker->renderer));
+			GBAVideoSoftwareRendererCreate(worker->renderer);
+			worker->renderer->outputBuffer = parallelRenderer->backend->outputBuffer;
+			worker->renderer->outputBufferStride = parallelRenderer->backend->outputBufferStride;
+			worker->renderer->outputRGB565 = parallelRenderer->backend->outputRGB565;
+			worker->renderer->outputTiled = parallelRenderer->backend->outputTiled;
+		} else {
+			worker->renderer = parallelRenderer->backend;
+		}
+		worker->renderer->d.cache = NULL;
+		worker->renderer->d.palette = worker->palette;
+		worker->renderer->d.vram = worker->vram;
+		worker->renderer->d.oam = &worker->oam;
+	}
+	_copyMemory(parallelRenderer);
+
+	parallelRenderer->backend->d.init(&parallelRenderer->backend->d);
+	for (i = 1; i < parallelRenderer->nWorkers; ++i) {
+		struct GBAVideoParallelWorker* worker = &parallelRenderer->workers[i];
+		worker->renderer->d.reset(&worker->renderer->d);
+		ThreadCreate(&worker->thread, _workerThread, worker);
+	}
+}
+
+static void GBAVideoParallelRendererReset(struct GBAVideoRenderer* renderer) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_flush(parallelRenderer);
+	_copyMemory(parallelRenderer);
+
+	int i;
+	for (i = 0; i < parallelRenderer->nWorkers; ++i) {
+		struct GBAVideoSoftwareRenderer* softwareRenderer = parallelRenderer->workers[i].renderer;
+		softwareRenderer->d.vram = parallelRenderer->workers[i].vram;
+		softwareRenderer->d.reset(&softwareRenderer->d);
+	}
+}
+
+static void GBAVideoParallelRendererDeinit(struct GBAVideoRenderer* renderer) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_flush(parallelRenderer);
+
+	MutexLock(&parallelRenderer->mutex);
+	parallelRenderer->stopping = true;
+	ConditionWake(&parallelRenderer->toWorkers);
+	MutexUnlock(&parallelRenderer->mutex);
+
+	int i;
+	for (i = 0; i < parallelRenderer->nWorkers; ++i) {
+		struct GBAVideoParallelWorker* worker = &parallelRenderer->workers[i];
+		if (i) {
+			ThreadJoin(worker->thread);
+		}
+		worker->renderer->d.deinit(&worker->renderer->d);
+		if (i) {
+			free(worker->renderer);
+		}
+		mappedMemoryFree(worker->vram, SIZE_VRAM);
+	}
+	free(parallelRenderer->workers);
+	parallelRenderer->workers = NULL;
+	parallelRenderer->nWorkers = 0;
+
+	GBAVideoParallelCommandListDeinit(&parallelRenderer->commands);
+	GBAVideoParallelVRAMBlockListDeinit(&parallelRenderer->vramBlocks);
+	ConditionDeinit(&parallelRenderer->fromWorkers);
+	ConditionDeinit(&parallelRenderer->toWorkers);
+	MutexDeinit(&parallelRenderer->mutex);
+}
+
+static uint16_t GBAVideoParallelRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	if (renderer->cache) {
+		GBAVideoCacheWriteVideoRegister(renderer->cache, address, value);
+	}
+	if (address > REG_BLDY) {
+		mLOG(GBA_VIDEO, GAME_ERROR, "Invalid video register: 0x%03X", address);
+		return value;
+	}
+	_pushCommand(parallelRenderer, PARALLEL_REGISTER, address, value);
+
+	// Mirror the masking done by the software renderer, since the workers run too late to report it
+	switch (address) {
+	case REG_DISPCNT:
+		value &= 0xFFF7;
+		break;
+	case REG_BG0CNT:
+	case REG_BG1CNT:
+		value &= 0xDFFF;
+		break;
+	case REG_BG0HOFS:
+	case REG_BG0VOFS:
+	case REG_BG1HOFS:
+	case REG_BG1VOFS:
+	case REG_BG2HOFS:
+	case REG_BG2VOFS:
+	case REG_BG3HOFS:
+	case REG_BG3VOFS:
+		value &= 0x01FF;
+		break;
+	case REG_BLDCNT:
+		value &= 0x3FFF;
+		break;
+	case REG_BLDALPHA:
+		value &= 0x1F1F;
+		break;
+	case REG_BLDY:
+		value &= 0x1F;
+		if (value > 0x10) {
+			value = 0x10;
+		}
+		break;
+	case REG_WININ:
+	case REG_WINOUT:
+		value &= 0x3F3F;
+		break;
+	}
+	return value;
+}
+
+static void GBAVideoParallelRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	if (renderer->cache) {
+		mCacheSetWriteVRAM(renderer->cache, address);
+	}
+	if (address < SIZE_VRAM) {
+		parallelRenderer->vramDirty |= 1 << (address >> 12);
+	}
+}
+
+static void GBAVideoParallelRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	if (renderer->cache) {
+		mCacheSetWritePalette(renderer->cache, address >> 1, mColorFrom555(value));
+	}
+	_pushCommand(parallelRenderer, PARALLEL_PALETTE, address, value);
+}
+
+static void GBAVideoParallelRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_pushCommand(parallelRenderer, PARALLEL_OAM, oam, parallelRenderer->d.oam->raw[oam]);
+}
+
+static void GBAVideoParallelRendererDrawScanline(struct GBAVideoRenderer* renderer, int y) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_flushVRAM(parallelRenderer);
+	_pushCommand(parallelRenderer, PARALLEL_SCANLINE, y, 0);
+}
+
+static void GBAVideoParallelRendererFinishFrame(struct GBAVideoRenderer* renderer) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_pushCommand(parallelRenderer, PARALLEL_FRAME, 0, 0);
+	_flush(parallelRenderer);
+}
+
+static void GBAVideoParallelRendererGetPixels(struct GBAVideoRenderer* renderer, size_t* stride, const void** pixels) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_flush(parallelRenderer);
+	parallelRenderer->backend->d.getPixels(&parallelRenderer->backend->d, stride, pixels);
+}
+
+static void GBAVideoParallelRendererPutPixels(struct GBAVideoRenderer* renderer, size_t stride, const void* pixels) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_flush(parallelRenderer);
+	parallelRenderer->backend->d.putPixels(&parallelRenderer->backend->d, stride, pixels);
+}
+
+static THREAD_ENTRY _workerThread(void* context) {
+	struct GBAVideoParallelWorker* worker = context;
+	struct GBAVideoParallelRenderer* parallelRenderer = worker->p;
+	ThreadSetName("Video Worker Thread");
+
+	MutexLock(&parallelRenderer->mutex);
+	while (true) {
+		while (worker->frame == parallelRenderer->frame && !parallelRenderer->stopping) {
+			ConditionWait(&parallelRenderer->toWorkers, &parallelRenderer->mutex);
+		}
+		if (parallelRenderer->stopping) {
+			break;
+		}
+		worker->frame = parallelRenderer->frame;
+		MutexUnlock(&parallelRenderer->mutex);
+
+		_runCommands(parallelRenderer, worker);
+
+		MutexLock(&parallelRenderer->mutex);
+		--parallelRenderer->pending;
+		if (!parallelRenderer->pending) {
+			ConditionWake(&parallelRenderer->fromWorkers);
+		}
+	}
+	MutexUnlock(&parallelRenderer->mutex);
+
+#ifdef _3DS
+	svcExitThread();
+#endif
+	return 0;
+}
+
+#endif
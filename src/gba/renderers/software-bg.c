@@ -30,11 +30,6 @@
 			--mosaicWait; \
 		}
 
-#define MODE_2_NO_MOSAIC(COORD) \
-	COORD \
-	mapData = screenBase[(localX >> 11) + (((localY >> 7) & 0x7F0) << background->size)]; \
-	pixelData = charBase[(mapData << 6) + ((localY & 0x700) >> 5) + ((localX & 0x700) >> 8)];
-
 #define MODE_2_LOOP(MOSAIC, COORD, BLEND, OBJWIN) \
 	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) { \
 		x += background->dx; \
@@ -47,21 +42,183 @@
 		} \
 	}
 
+#define MODE_2_COMPOSITE(BLEND, OBJWIN) \
+	for (outX = fetchStart, pixel = &renderer->row[outX]; outX < fetchEnd; ++outX, ++pixel) { \
+		pixelData = indices[outX]; \
+		if (pixelData) { \
+			uint32_t current = *pixel; \
+			COMPOSITE_256_ ## OBJWIN (BLEND, 0); \
+		} \
+	}
+
 #define DRAW_BACKGROUND_MODE_2(BLEND, OBJWIN) \
-	if (background->overflow) { \
-		if (mosaicH > 1) { \
+	if (mosaicH > 1) { \
+		if (background->overflow) { \
 			MODE_2_LOOP(MODE_2_MOSAIC, MODE_2_COORD_OVERFLOW, BLEND, OBJWIN); \
 		} else { \
-			MODE_2_LOOP(MODE_2_NO_MOSAIC, MODE_2_COORD_OVERFLOW, BLEND, OBJWIN); \
-		} \
-	} else { \
-		if (mosaicH > 1) { \
 			MODE_2_LOOP(MODE_2_MOSAIC, MODE_2_COORD_NO_OVERFLOW, BLEND, OBJWIN); \
-		} else { \
-			MODE_2_LOOP(MODE_2_NO_MOSAIC, MODE_2_COORD_NO_OVERFLOW, BLEND, OBJWIN); \
 		} \
+	} else { \
+		MODE_2_COMPOSITE(BLEND, OBJWIN); \
+	}
+
+static int32_t _floorDiv(int64_t a, int64_t b) {
+	if (a >= 0) {
+		return a / b;
+	}
+	return -((-a + b - 1) / b);
+}
+
+// Narrows [*start, *end) down to the steps where coord + step * delta lands inside the map
+static void _clipAffine(int32_t coord, int32_t delta, int32_t size, int* start, int* end) {
+	int64_t low;
+	int64_t high;
+	if (!delta) {
+		if (coord < 0 || coord >= size) {
+			*end = *start;
+		}
+		return;
+	}
+	if (delta > 0) {
+		low = -(int64_t) _floorDiv(coord, delta);
+		high = (int64_t) _floorDiv((int64_t) size - 1 - coord, delta) + 1;
+	} else {
+		low = -(int64_t) _floorDiv((int64_t) size - 1 - coord, -delta);
+		high = (int64_t) _floorDiv(coord, -delta) + 1;
+	}
+	if (low > *start) {
+		*start = low < *end ? low : *end;
+	}
+	if (high < *end) {
+		*end = high > *start ? high : *start;
+	}
+}
+
+// Looks up the palette index of every pixel in a span up front, starting from the coordinates of the first pixel.
+// Pixels that fall off a map that doesn't wrap are clipped off the ends of the span rather than checked one at a
+// time, and [*start, *end) is narrowed to what is left.
+static void _fetchMode2(const struct GBAVideoSoftwareBackground* background, const uint8_t* screenBase, const uint8_t* charBase, int32_t x, int32_t y, int* start, int* end, uint8_t* out) {
+	int32_t sizeMask = (0x8000 << background->size) - 1;
+	int32_t dx = background->dx;
+	int32_t dy = background->dy;
+	int length = *end - *start;
+	int outX = 0;
+
+	if (!background->overflow) {
+		int clipStart = 0;
+		int clipEnd = length;
+		_clipAffine(x, dx, sizeMask + 1, &clipStart, &clipEnd);
+		_clipAffine(y, dy, sizeMask + 1, &clipStart, &clipEnd);
+		x += dx * clipStart;
+		y += dy * clipStart;
+		out += *start + clipStart;
+		length = clipEnd - clipStart;
+		*end = *start + clipEnd;
+		*start += clipStart;
+	} else {
+		out += *start;
+	}
+
+	// Once clipped, masking the coordinates only matters for maps that wrap
+	if (!dy) {
+		// Without rotation the whole span samples a single row of the map
+		y &= sizeMask;
+		const uint8_t* screenRow = &screenBase[((y >> 7) & 0x7F0) << background->size];
+		const uint8_t* charRow = &charBase[(y & 0x700) >> 5];
+		for (; outX < length; ++outX, x += dx) {
+			int32_t localX = x & sizeMask;
+			out[outX] = charRow[(screenRow[localX >> 11] << 6) + ((localX & 0x700) >> 8)];
+		}
+		return;
 	}
 
+#if defined(SOFTWARE_SIMD_SSE2) || defined(SOFTWARE_SIMD_NEON)
+	// There are no gathers to lean on, so only the offsets are computed in vectors and the loads stay scalar
+	uint32_t mapOffsets[4];
+	uint32_t charOffsets[4];
+#ifdef SOFTWARE_SIMD_SSE2
+	const __m128i vSizeMask = _mm_set1_epi32(sizeMask);
+	const __m128i vRowMask = _mm_set1_epi32(0x7F0);
+	const __m128i vTileMask = _mm_set1_epi32(0x700);
+	const __m128i vSize = _mm_cvtsi32_si128(background->size);
+	const __m128i vStepX = _mm_set1_epi32(dx * 4);
+	const __m128i vStepY = _mm_set1_epi32(dy * 4);
+	__m128i vx = _mm_setr_epi32(x, x + dx, x + dx * 2, x + dx * 3);
+	__m128i vy = _mm_setr_epi32(y, y + dy, y + dy * 2, y + dy * 3);
+	for (; outX <= length - 4; outX += 4) {
+		__m128i localX = _mm_and_si128(vx, vSizeMask);
+		__m128i localY = _mm_and_si128(vy, vSizeMask);
+		__m128i map = _mm_add_epi32(_mm_srli_epi32(localX, 11), _mm_sll_epi32(_mm_and_si128(_mm_srli_epi32(localY, 7), vRowMask), vSize));
+		__m128i tile = _mm_add_epi32(_mm_srli_epi32(_mm_and_si128(localY, vTileMask), 5), _mm_srli_epi32(_mm_and_si128(localX, vTileMask), 8));
+		_mm_storeu_si128((__m128i*) mapOffsets, map);
+		_mm_storeu_si128((__m128i*) charOffsets, tile);
+		vx = _mm_add_epi32(vx, vStepX);
+		vy = _mm_add_epi32(vy, vStepY);
+#else
+	const uint32x4_t vSizeMask = vdupq_n_u32(sizeMask);
+	const uint32x4_t vRowMask = vdupq_n_u32(0x7F0);
+	const uint32x4_t vTileMask = vdupq_n_u32(0x700);
+	const int32x4_t vSize = vdupq_n_s32(background->size);
+	const uint32x4_t vStepX = vdupq_n_u32(dx * 4);
+	const uint32x4_t vStepY = vdupq_n_u32(dy * 4);
+	const uint32_t laneX[4] = { x, x + dx, x + dx * 2, x + dx * 3 };
+	const uint32_t laneY[4] = { y, y + dy, y + dy * 2, y + dy * 3 };
+	uint32x4_t vx = vld1q_u32(laneX);
+	uint32x4_t vy = vld1q_u32(laneY);
+	for (; outX <= length - 4; outX += 4) {
+		uint32x4_t localX = vandq_u32(vx, vSizeMask);
+		uint32x4_t localY = vandq_u32(vy, vSizeMask);
+		uint32x4_t map = vaddq_u32(vshrq_n_u32(localX, 11), vshlq_u32(vandq_u32(vshrq_n_u32(localY, 7), vRowMask), vSize));
+		uint32x4_t tile = vaddq_u32(vshrq_n_u32(vandq_u32(localY, vTileMask), 5), vshrq_n_u32(vandq_u32(localX, vTileMask), 8));
+		vst1q_u32(mapOffsets, map);
+		vst1q_u32(charOffsets, tile);
+		vx = vaddq_u32(vx, vStepX);
+		vy = vaddq_u32(vy, vStepY);
+#endif
+		out[outX] = charBase[(screenBase[mapOffsets[0]] << 6) + charOffsets[0]];
+		out[outX + 1] = charBase[(screenBase[mapOffsets[1]] << 6) + charOffsets[1]];
+		out[outX + 2] = charBase[(screenBase[mapOffsets[2]] << 6) + charOffsets[2]];
+		out[outX + 3] = charBase[(screenBase[mapOffsets[3]] << 6) + charOffsets[3]];
+	}
+	x += dx * outX;
+	y += dy * outX;
+#endif
+
+	for (; outX < length; ++outX, x += dx, y += dy) {
+		int32_t localX = x & sizeMask;
+		int32_t localY = y & sizeMask;
+		uint8_t mapData = screenBase[(localX >> 11) + (((localY >> 7) & 0x7F0) << background->size)];
+		out[outX] = charBase[(mapData << 6) + ((localY & 0x700) >> 5) + ((localX & 0x700) >> 8)];
+	}
+}
+
+// Bitmaps that aren't scaled, rotated or mosaicked sample consecutive pixels of a single row, so the
+// span can be clipped to the bitmap once instead of checking every pixel. x and y are the coordinates
+// before the first pixel, as BACKGROUND_BITMAP_INIT leaves them. If the layer can be drawn this way,
+// [*start, *end) is narrowed to the pixels that land on the bitmap and *offset is the index of the
+// one drawn at *start.
+static bool _clipBitmapRow(const struct GBAVideoSoftwareBackground* background, int mosaicH, int32_t x, int32_t y, int width, int height, int* start, int* end, int* offset) {
+	if (background->dx != 0x100 || background->dy || mosaicH) {
+		return false;
+	}
+	int32_t column = (x + background->dx) >> 8;
+	int32_t row = y >> 8;
+	if (y < 0 || row >= height) {
+		*end = *start;
+		*offset = 0;
+		return true;
+	}
+	if (column < 0) {
+		*start = -column < *end - *start ? *start - column : *end;
+		column = 0;
+	}
+	if (*end - *start > width - column) {
+		*end = column < width ? *start + width - column : *start;
+	}
+	*offset = column + row * width;
+	return true;
+}
+
 void GBAVideoSoftwareRendererDrawBackgroundMode2(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* background, int inY) {
 	int sizeAdjusted = 0x8000 << background->size;
 
@@ -71,10 +228,17 @@ void GBAVideoSoftwareRendererDrawBackgroundMode2(struct GBAVideoSoftwareRenderer
 	uint8_t* charBase = &((uint8_t*) renderer->d.vram)[background->charBase];
 	uint8_t mapData;
 	uint8_t pixelData = 0;
+	uint8_t indices[GBA_VIDEO_HORIZONTAL_PIXELS];
+	int fetchStart = renderer->start;
+	int fetchEnd = renderer->end;
 
 	int outX;
 	uint32_t* pixel;
 
+	if (mosaicH <= 1) {
+		_fetchMode2(background, screenBase, charBase, x + background->dx, y + background->dy, &fetchStart, &fetchEnd, indices);
+	}
+
 	if (!objwinSlowPath) {
 		if (!(flags & FLAG_TARGET_2)) {
 			DRAW_BACKGROUND_MODE_2(NoBlend, NO_OBJWIN);
@@ -90,6 +254,36 @@ void GBAVideoSoftwareRendererDrawBackgroundMode2(struct GBAVideoSoftwareRenderer
 	}
 }
 
+// Converts and draws a run of direct color pixels, as modes 3 and 5 store them
+static void _drawBitmapRow15(struct GBAVideoSoftwareRenderer* renderer, const uint16_t* vram, int start, int end, uint32_t flags, int variant) {
+	if (variant && renderer->blendEffect != BLEND_BRIGHTEN && renderer->blendEffect != BLEND_DARKEN) {
+		return;
+	}
+	// Where nothing but the backdrop is drawn yet, every background is in front, so the row goes straight in
+	bool bare = renderer->windows[renderer->currentSpan].bare;
+	uint32_t bareFlags = flags & ~FLAG_TARGET_2;
+	uint32_t* pixel = &renderer->row[start];
+	int length = end - start;
+	int i;
+	for (i = 0; i < length; ++i) {
+		uint32_t color;
+		LOAD_16(color, i << 1, vram);
+		color = mColorFrom555(color);
+		if (variant) {
+			if (renderer->blendEffect == BLEND_BRIGHTEN) {
+				color = _brighten(color, renderer->bldy);
+			} else {
+				color = _darken(color, renderer->bldy);
+			}
+		}
+		if (bare) {
+			pixel[i] = color | bareFlags;
+		} else {
+			_compositeBlendObjwin(renderer, &pixel[i], color | flags, pixel[i]);
+		}
+	}
+}
+
 void GBAVideoSoftwareRendererDrawBackgroundMode3(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* background, int inY) {
 	BACKGROUND_BITMAP_INIT;
 
@@ -97,6 +291,13 @@ void GBAVideoSoftwareRendererDrawBackgroundMode3(struct GBAVideoSoftwareRenderer
 
 	int outX;
 	uint32_t* pixel;
+	int start = renderer->start;
+	int end = renderer->end;
+	int offset;
+	if (!objwinSlowPath && _clipBitmapRow(background, mosaicH, x, y, GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS, &start, &end, &offset)) {
+		_drawBitmapRow15(renderer, &renderer->d.vram[offset], start, end, flags, variant);
+		return;
+	}
 	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) {
 		BACKGROUND_BITMAP_ITERATE(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
 
@@ -136,6 +337,26 @@ void GBAVideoSoftwareRendererDrawBackgroundMode4(struct GBAVideoSoftwareRenderer
 
 	int outX;
 	uint32_t* pixel;
+	int start = renderer->start;
+	int end = renderer->end;
+	int rowOffset;
+	if (!objwinSlowPath && _clipBitmapRow(background, mosaicH, x, y, GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS, &start, &end, &rowOffset)) {
+		const uint8_t* indices = &((const uint8_t*) renderer->d.vram)[offset + rowOffset];
+		bool bare = renderer->windows[renderer->currentSpan].bare;
+		uint32_t bareFlags = flags & ~FLAG_TARGET_2;
+		for (outX = start, pixel = &renderer->row[outX]; outX < end; ++outX, ++pixel, ++indices) {
+			color = *indices;
+			if (!color) {
+				continue;
+			}
+			if (bare) {
+				*pixel = palette[color] | bareFlags;
+			} else if (IS_WRITABLE(*pixel)) {
+				_compositeBlendNoObjwin(renderer, pixel, palette[color] | flags, *pixel);
+			}
+		}
+		return;
+	}
 	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) {
 		BACKGROUND_BITMAP_ITERATE(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
 
@@ -174,6 +395,13 @@ void GBAVideoSoftwareRendererDrawBackgroundMode5(struct GBAVideoSoftwareRenderer
 
 	int outX;
 	uint32_t* pixel;
+	int start = renderer->start;
+	int end = renderer->end;
+	int rowOffset;
+	if (!objwinSlowPath && _clipBitmapRow(background, mosaicH, x, y, 160, 128, &start, &end, &rowOffset)) {
+		_drawBitmapRow15(renderer, &renderer->d.vram[(offset >> 1) + rowOffset], start, end, flags, variant);
+		return;
+	}
 	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) {
 		BACKGROUND_BITMAP_ITERATE(160, 128);
 
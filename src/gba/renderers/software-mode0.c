@@ -145,6 +145,20 @@
 		x = 0; \
 	}
 
+#define BACKGROUND_STORE_PIXEL_16(IDX) \
+	pixelData = tileData & 0xF; \
+	if (pixelData) { \
+		pixel[IDX] = palette[pixelData] | bareFlags; \
+	} \
+	tileData >>= 4;
+
+#define BACKGROUND_STORE_PIXEL_256(IDX) \
+	pixelData = tileData & 0xFF; \
+	if (pixelData) { \
+		pixel[IDX] = palette[pixelData] | bareFlags; \
+	} \
+	tileData >>= 8;
+
 #define DRAW_BACKGROUND_MODE_0_TILES_16(BLEND, OBJWIN) \
 	for (; tileX < tileEnd; ++tileX) { \
 		mapData = background->mapCache[(localX >> 3) & 0x3F]; \
@@ -161,7 +175,31 @@
 			continue; \
 		} \
 		LOAD_32(tileData, charBase, vram); \
-		if (tileData) { \
+		if (!tileData) { \
+			pixel += 8; \
+			continue; \
+		} \
+		if (bare) { \
+			if (!GBA_TEXT_MAP_HFLIP(mapData)) { \
+				BACKGROUND_STORE_PIXEL_16(0); \
+				BACKGROUND_STORE_PIXEL_16(1); \
+				BACKGROUND_STORE_PIXEL_16(2); \
+				BACKGROUND_STORE_PIXEL_16(3); \
+				BACKGROUND_STORE_PIXEL_16(4); \
+				BACKGROUND_STORE_PIXEL_16(5); \
+				BACKGROUND_STORE_PIXEL_16(6); \
+				BACKGROUND_STORE_PIXEL_16(7); \
+			} else { \
+				BACKGROUND_STORE_PIXEL_16(7); \
+				BACKGROUND_STORE_PIXEL_16(6); \
+				BACKGROUND_STORE_PIXEL_16(5); \
+				BACKGROUND_STORE_PIXEL_16(4); \
+				BACKGROUND_STORE_PIXEL_16(3); \
+				BACKGROUND_STORE_PIXEL_16(2); \
+				BACKGROUND_STORE_PIXEL_16(1); \
+				BACKGROUND_STORE_PIXEL_16(0); \
+			} \
+		} else { \
 			if (!GBA_TEXT_MAP_HFLIP(mapData)) { \
 				BACKGROUND_DRAW_PIXEL_16(BLEND, OBJWIN, 0); \
 				BACKGROUND_DRAW_PIXEL_16(BLEND, OBJWIN, 1); \
@@ -294,35 +332,63 @@
 		if (!GBA_TEXT_MAP_HFLIP(mapData)) { \
 			LOAD_32(tileData, charBase, vram); \
 			if (tileData) { \
+				if (bare) { \
+					BACKGROUND_STORE_PIXEL_256(0); \
+					BACKGROUND_STORE_PIXEL_256(1); \
+					BACKGROUND_STORE_PIXEL_256(2); \
+					BACKGROUND_STORE_PIXEL_256(3); \
+				} else { \
 					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
 					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
 					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
 					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
+				} \
 			} \
 			pixel += 4; \
 			LOAD_32(tileData, charBase + 4, vram); \
 			if (tileData) { \
+				if (bare) { \
+					BACKGROUND_STORE_PIXEL_256(0); \
+					BACKGROUND_STORE_PIXEL_256(1); \
+					BACKGROUND_STORE_PIXEL_256(2); \
+					BACKGROUND_STORE_PIXEL_256(3); \
+				} else { \
 					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
 					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
 					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
 					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
+				} \
 			} \
 			pixel += 4; \
 		} else { \
 			LOAD_32(tileData, charBase + 4, vram); \
 			if (tileData) { \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
+				if (bare) { \
+					BACKGROUND_STORE_PIXEL_256(3); \
+					BACKGROUND_STORE_PIXEL_256(2); \
+					BACKGROUND_STORE_PIXEL_256(1); \
+					BACKGROUND_STORE_PIXEL_256(0); \
+				} else { \
+					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
+					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
+					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
+					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
+				} \
 			} \
 			pixel += 4; \
 			LOAD_32(tileData, charBase, vram); \
 			if (tileData) { \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
+				if (bare) { \
+					BACKGROUND_STORE_PIXEL_256(3); \
+					BACKGROUND_STORE_PIXEL_256(2); \
+					BACKGROUND_STORE_PIXEL_256(1); \
+					BACKGROUND_STORE_PIXEL_256(0); \
+				} else { \
+					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
+					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
+					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
+					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
+				} \
 			} \
 			pixel += 4; \
 		} \
@@ -472,7 +538,7 @@ void GBAVideoSoftwareRendererDrawBackgroundMode0(struct GBAVideoSoftwareRenderer
 	flags |= FLAG_TARGET_2 * background->target2;
 	int objwinFlags = FLAG_TARGET_1 * (background->target1 && renderer->blendEffect == BLEND_ALPHA && GBAWindowControlIsBlendEnable(renderer->objwin.packed));
 	objwinFlags |= flags;
-	flags |= FLAG_TARGET_1 * (background->target1 && renderer->blendEffect == BLEND_ALPHA && GBAWindowControlIsBlendEnable(renderer->currentWindow.packed));
+	flags |= FLAG_TARGET_1 * (background->target1 && renderer->currentBlend == BLEND_ALPHA);
 	if (renderer->blendEffect == BLEND_ALPHA && renderer->blda == 0x10 && renderer->bldb == 0) {
 		flags &= ~(FLAG_TARGET_1 | FLAG_TARGET_2);
 		objwinFlags &= ~(FLAG_TARGET_1 | FLAG_TARGET_2);
@@ -480,13 +546,17 @@ void GBAVideoSoftwareRendererDrawBackgroundMode0(struct GBAVideoSoftwareRenderer
 
 	uint32_t screenBase;
 	uint32_t charBase;
-	int variant = background->target1 && GBAWindowControlIsBlendEnable(renderer->currentWindow.packed) && (renderer->blendEffect == BLEND_BRIGHTEN || renderer->blendEffect == BLEND_DARKEN);
+	int variant = background->target1 && (renderer->currentBlend == BLEND_BRIGHTEN || renderer->currentBlend == BLEND_DARKEN);
 	color_t* mainPalette = renderer->normalPalette;
 	if (variant) {
 		mainPalette = renderer->variantPalette;
 	}
 	color_t* palette = mainPalette;
 	PREPARE_OBJWIN;
+	// Until something is drawn in this span it only holds the backdrop, which every background is
+	// in front of, so whole tiles can be stored there without compositing each pixel
+	bool bare = !objwinSlowPath && renderer->windows[renderer->currentSpan].bare;
+	uint32_t bareFlags = flags & ~FLAG_TARGET_2;
 
 	int outX = renderer->start;
 
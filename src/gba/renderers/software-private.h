@@ -15,6 +15,16 @@
 #define VIDEO_CHECKS true
 #endif
 
+#ifndef COLOR_16_BIT
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SOFTWARE_SIMD_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SOFTWARE_SIMD_NEON
+#endif
+#endif
+
 void GBAVideoSoftwareRendererDrawBackgroundMode0(struct GBAVideoSoftwareRenderer* renderer,
                                                  struct GBAVideoSoftwareBackground* background, int y);
 void GBAVideoSoftwareRendererDrawBackgroundMode2(struct GBAVideoSoftwareRenderer* renderer,
@@ -191,14 +201,13 @@ static inline void _compositeNoBlendNoObjwin(struct GBAVideoSoftwareRenderer* re
 	int objwinFlags = FLAG_TARGET_1 * (background->target1 && renderer->blendEffect == BLEND_ALPHA &&                 \
 	                                   GBAWindowControlIsBlendEnable(renderer->objwin.packed));                       \
 	objwinFlags |= flags;                                                                                             \
-	flags |= FLAG_TARGET_1 * (background->target1 && renderer->blendEffect == BLEND_ALPHA &&                          \
-	                          GBAWindowControlIsBlendEnable(renderer->currentWindow.packed));                         \
+	flags |= FLAG_TARGET_1 * (background->target1 && renderer->currentBlend == BLEND_ALPHA);                          \
 	if (renderer->blendEffect == BLEND_ALPHA && renderer->blda == 0x10 && renderer->bldb == 0) {                      \
 		flags &= ~(FLAG_TARGET_1 | FLAG_TARGET_2);                                                                    \
 		objwinFlags &= ~(FLAG_TARGET_1 | FLAG_TARGET_2);                                                              \
 	}                                                                                                                 \
-	int variant = background->target1 && GBAWindowControlIsBlendEnable(renderer->currentWindow.packed) &&             \
-	    (renderer->blendEffect == BLEND_BRIGHTEN || renderer->blendEffect == BLEND_DARKEN);                           \
+	int variant = background->target1 &&                                                                              \
+	    (renderer->currentBlend == BLEND_BRIGHTEN || renderer->currentBlend == BLEND_DARKEN);                         \
 	color_t* palette = renderer->normalPalette;                                                                       \
 	if (variant) {                                                                                                    \
 		palette = renderer->variantPalette;                                                                           \
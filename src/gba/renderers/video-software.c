@@ -11,6 +11,7 @@
 #include <mgba/internal/gba/renderers/cache-set.h>
 
 #include <mgba-util/arm-algo.h>
+#include <mgba-util/math.h>
 #include <mgba-util/memory.h>
 
 #define DIRTY_SCANLINE(R, Y) R->scanlineDirty[Y >> 5] |= (1 << (Y & 0x1F))
@@ -36,12 +37,36 @@ static void GBAVideoSoftwareRendererWriteBGY_LO(struct GBAVideoSoftwareBackgroun
 static void GBAVideoSoftwareRendererWriteBGY_HI(struct GBAVideoSoftwareBackground* bg, uint16_t value);
 static void GBAVideoSoftwareRendererWriteBLDCNT(struct GBAVideoSoftwareRenderer* renderer, uint16_t value);
 
+static bool _checkScanline(struct GBAVideoSoftwareRenderer* renderer, int y);
+static void _resolveSpans(struct GBAVideoSoftwareRenderer* softwareRenderer) {
+	int w;
+	for (w = 0; w < softwareRenderer->nWindows; ++w) {
+		struct Window* window = &softwareRenderer->windows[w];
+		if (GBAWindowControlIsBlendEnable(window->control.packed)) {
+			window->blend = softwareRenderer->blendEffect;
+		} else {
+			window->blend = BLEND_NONE;
+		}
+		if (softwareRenderer->target1Bd && (window->blend == BLEND_BRIGHTEN || window->blend == BLEND_DARKEN)) {
+			window->backdrop = softwareRenderer->variantPalette[0];
+		} else {
+			window->backdrop = softwareRenderer->normalPalette[0];
+		}
+	}
+}
+
+static void _fillWhite(struct GBAVideoSoftwareRenderer* renderer, int y);
 static void _drawScanline(struct GBAVideoSoftwareRenderer* renderer, int y);
+static void _advanceScanline(struct GBAVideoSoftwareRenderer* renderer, int y);
 
 static void _updatePalettes(struct GBAVideoSoftwareRenderer* renderer);
+static void _blendBackdrop(uint32_t* row, int length, uint32_t backdrop, int blda, int bldb);
+static void _brightenRow(uint32_t* out, const uint32_t* in, int length, int y, uint32_t mask, uint32_t match);
+static void _darkenRow(uint32_t* out, const uint32_t* in, int length, int y, uint32_t mask, uint32_t match);
 
 static void _breakWindow(struct GBAVideoSoftwareRenderer* softwareRenderer, struct WindowN* win, int y);
 static void _breakWindowInner(struct GBAVideoSoftwareRenderer* softwareRenderer, struct WindowN* win);
+static void _resolveSpans(struct GBAVideoSoftwareRenderer* softwareRenderer);
 
 void GBAVideoSoftwareRendererCreate(struct GBAVideoSoftwareRenderer* renderer) {
 	renderer->d.init = GBAVideoSoftwareRendererInit;
@@ -63,6 +88,8 @@ void GBAVideoSoftwareRendererCreate(struct GBAVideoSoftwareRenderer* renderer) {
 	renderer->d.disableOBJ = false;
 
 	renderer->temporaryBuffer = 0;
+	renderer->outputRGB565 = false;
+	renderer->outputTiled = false;
 }
 
 static void GBAVideoSoftwareRendererInit(struct GBAVideoRenderer* renderer) {
@@ -72,11 +99,7 @@ static void GBAVideoSoftwareRendererInit(struct GBAVideoRenderer* renderer) {
 
 	int y;
 	for (y = 0; y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
-		color_t* row = &softwareRenderer->outputBuffer[softwareRenderer->outputBufferStride * y];
-		int x;
-		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
-			row[x] = GBA_COLOR_WHITE;
-		}
+		_fillWhite(softwareRenderer, y);
 	}
 }
 
@@ -108,7 +131,6 @@ static void GBAVideoSoftwareRendererReset(struct GBAVideoRenderer* renderer) {
 	softwareRenderer->objwin = (struct WindowControl) { .priority = 2 };
 	softwareRenderer->winout = (struct WindowControl) { .priority = 3 };
 	softwareRenderer->oamDirty = 1;
-	softwareRenderer->oamMax = 0;
 
 	softwareRenderer->mosaic = 0;
 	softwareRenderer->nextY = 0;
@@ -402,10 +424,58 @@ static void GBAVideoSoftwareRendererWriteVRAM(struct GBAVideoRenderer* renderer,
 	softwareRenderer->bg[3].yCache = -1;
 }
 
+static void _updateSpriteLines(struct GBAVideoSoftwareRenderer* renderer, int index, bool visible) {
+	const struct GBAVideoRendererSprite* sprite = &renderer->sprites[index];
+	uint32_t bit = 1U << (index & 0x1F);
+	// A sprite covers [y, endY) and, if it wraps past the bottom, also [0, endY - 256)
+	int ranges[2][2] = {
+		{ sprite->y < 0 ? 0 : sprite->y, sprite->endY },
+		{ 0, sprite->endY - 256 }
+	};
+	int r;
+	for (r = 0; r < 2; ++r) {
+		int end = ranges[r][1];
+		if (end > GBA_VIDEO_VERTICAL_PIXELS) {
+			end = GBA_VIDEO_VERTICAL_PIXELS;
+		}
+		int y;
+		for (y = ranges[r][0]; y < end; ++y) {
+			if (visible) {
+				renderer->scanlineSprites[y][index >> 5] |= bit;
+			} else {
+				renderer->scanlineSprites[y][index >> 5] &= ~bit;
+			}
+		}
+	}
+}
+
+static void _cleanSprite(struct GBAVideoSoftwareRenderer* renderer, int index) {
+	_updateSpriteLines(renderer, index, false);
+	if (GBAVideoRendererCleanSprite(&renderer->d.oam->obj[index], &renderer->sprites[index], renderer->objOffsetY)) {
+		_updateSpriteLines(renderer, index, true);
+	} else {
+		renderer->sprites[index].y = 0;
+		renderer->sprites[index].endY = 0;
+	}
+}
+
+static void _cleanOAM(struct GBAVideoSoftwareRenderer* renderer) {
+	memset(renderer->scanlineSprites, 0, sizeof(renderer->scanlineSprites));
+	int i;
+	for (i = 0; i < 128; ++i) {
+		renderer->sprites[i].y = 0;
+		renderer->sprites[i].endY = 0;
+		_cleanSprite(renderer, i);
+	}
+	renderer->oamDirty = false;
+}
+
 static void GBAVideoSoftwareRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam) {
 	struct GBAVideoSoftwareRenderer* softwareRenderer = (struct GBAVideoSoftwareRenderer*) renderer;
-	UNUSED(oam);
-	softwareRenderer->oamDirty = 1;
+	// The fourth halfword of each entry is an affine parameter and doesn't affect the sprite itself
+	if (!softwareRenderer->oamDirty && (oam & 3) != 3) {
+		_cleanSprite(softwareRenderer, oam >> 2);
+	}
 	memset(softwareRenderer->scanlineDirty, 0xFFFFFFFF, sizeof(softwareRenderer->scanlineDirty));
 }
 
@@ -497,9 +567,7 @@ static void _breakWindowInner(struct GBAVideoSoftwareRenderer* softwareRenderer,
 #endif
 }
 
-static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* renderer, int y) {
-	struct GBAVideoSoftwareRenderer* softwareRenderer = (struct GBAVideoSoftwareRenderer*) renderer;
-
+static bool _checkScanline(struct GBAVideoSoftwareRenderer* softwareRenderer, int y) {
 	if (y == GBA_VIDEO_VERTICAL_PIXELS - 1) {
 		softwareRenderer->nextY = 0;
 	} else {
@@ -532,19 +600,51 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 			softwareRenderer->bg[3].sx += softwareRenderer->bg[3].dmx;
 			softwareRenderer->bg[3].sy += softwareRenderer->bg[3].dmy;
 		}
-		return;
+		return false;
 	}
 
 	CLEAN_SCANLINE(softwareRenderer, y);
+	return true;
+}
 
-	color_t* row = &softwareRenderer->outputBuffer[softwareRenderer->outputBufferStride * y];
-	if (GBARegisterDISPCNTIsForcedBlank(softwareRenderer->dispcnt)) {
-		int x;
+static void _fillWhite(struct GBAVideoSoftwareRenderer* renderer, int y) {
+	int x;
+	if (renderer->outputTiled) {
+		color_t* tileRow = &renderer->outputBuffer[mColorTiledOffset(renderer->outputBufferStride, 0, y)];
+		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; x += 4) {
+			tileRow[x * 4] = GBA_COLOR_WHITE;
+			tileRow[x * 4 + 1] = GBA_COLOR_WHITE;
+			tileRow[x * 4 + 2] = GBA_COLOR_WHITE;
+			tileRow[x * 4 + 3] = GBA_COLOR_WHITE;
+		}
+		return;
+	}
+#ifndef COLOR_16_BIT
+	if (renderer->outputRGB565) {
+		uint16_t* row = &((uint16_t*) renderer->outputBuffer)[renderer->outputBufferStride * y];
 		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
-			row[x] = GBA_COLOR_WHITE;
+			row[x] = 0xFFFF;
 		}
 		return;
 	}
+#endif
+	color_t* row = &renderer->outputBuffer[renderer->outputBufferStride * y];
+	for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
+		row[x] = GBA_COLOR_WHITE;
+	}
+}
+
+static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* renderer, int y) {
+	struct GBAVideoSoftwareRenderer* softwareRenderer = (struct GBAVideoSoftwareRenderer*) renderer;
+
+	if (!_checkScanline(softwareRenderer, y)) {
+		return;
+	}
+
+	if (GBARegisterDISPCNTIsForcedBlank(softwareRenderer->dispcnt)) {
+		_fillWhite(softwareRenderer, y);
+		return;
+	}
 
 	int x;
 	for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; x += 4) {
@@ -573,17 +673,15 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 		softwareRenderer->blendDirty = false;
 	}
 
+	_resolveSpans(softwareRenderer);
+
 	int w;
 	x = 0;
 	for (w = 0; w < softwareRenderer->nWindows; ++w) {
 		// TOOD: handle objwin on backdrop
-		uint32_t backdrop = FLAG_UNWRITTEN | FLAG_PRIORITY | FLAG_IS_BACKGROUND;
-		if (!softwareRenderer->target1Bd || softwareRenderer->blendEffect == BLEND_NONE || softwareRenderer->blendEffect == BLEND_ALPHA || !GBAWindowControlIsBlendEnable(softwareRenderer->windows[w].control.packed)) {
-			backdrop |= softwareRenderer->normalPalette[0];
-		} else {
-			backdrop |= softwareRenderer->variantPalette[0];
-		}
+		uint32_t backdrop = FLAG_UNWRITTEN | FLAG_PRIORITY | FLAG_IS_BACKGROUND | softwareRenderer->windows[w].backdrop;
 		int end = softwareRenderer->windows[w].endX;
+		softwareRenderer->windows[w].bare = true;
 		for (; x < end - 3; x += 4) {
 			softwareRenderer->row[x] = backdrop;
 			softwareRenderer->row[x + 1] = backdrop;
@@ -598,21 +696,14 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 	_drawScanline(softwareRenderer, y);
 
 	if (softwareRenderer->target2Bd) {
+		// Neighboring spans usually share a backdrop, so blend each run of them in one go
 		x = 0;
 		for (w = 0; w < softwareRenderer->nWindows; ++w) {
-			uint32_t backdrop = 0;
-			if (!softwareRenderer->target1Bd || softwareRenderer->blendEffect == BLEND_NONE || softwareRenderer->blendEffect == BLEND_ALPHA || !GBAWindowControlIsBlendEnable(softwareRenderer->windows[w].control.packed)) {
-				backdrop |= softwareRenderer->normalPalette[0];
-			} else {
-				backdrop |= softwareRenderer->variantPalette[0];
-			}
+			color_t backdrop = softwareRenderer->windows[w].backdrop;
+			for (; w + 1 < softwareRenderer->nWindows && softwareRenderer->windows[w + 1].backdrop == backdrop; ++w);
 			int end = softwareRenderer->windows[w].endX;
-			for (; x < end; ++x) {
-				uint32_t color = softwareRenderer->row[x];
-				if (color & FLAG_TARGET_1) {
-					softwareRenderer->row[x] = _mix(softwareRenderer->bldb, backdrop, softwareRenderer->blda, color);
-				}
-			}
+			_blendBackdrop(&softwareRenderer->row[x], end - x, backdrop, softwareRenderer->blda, softwareRenderer->bldb);
+			x = end;
 		}
 	}
 	if (softwareRenderer->target1Obj && (softwareRenderer->blendEffect == BLEND_DARKEN || softwareRenderer->blendEffect == BLEND_BRIGHTEN)) {
@@ -626,28 +717,35 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 			}
 		}
 		for (w = 0; w < softwareRenderer->nWindows; ++w) {
-			if (!GBAWindowControlIsBlendEnable(softwareRenderer->windows[w].control.packed)) {
+			int start = x;
+			x = softwareRenderer->windows[w].endX;
+			if (softwareRenderer->windows[w].blend == BLEND_NONE) {
 				continue;
 			}
-			int end = softwareRenderer->windows[w].endX;
+			for (; w + 1 < softwareRenderer->nWindows && softwareRenderer->windows[w + 1].blend != BLEND_NONE; ++w) {
+				x = softwareRenderer->windows[w + 1].endX;
+			}
 			if (softwareRenderer->blendEffect == BLEND_DARKEN) {
-				for (; x < end; ++x) {
-					uint32_t color = softwareRenderer->row[x];
-					if ((color & mask) == match) {
-						softwareRenderer->row[x] = _darken(color, softwareRenderer->bldy);
-					}
-				}
-			} else if (softwareRenderer->blendEffect == BLEND_BRIGHTEN) {
-				for (; x < end; ++x) {
-					uint32_t color = softwareRenderer->row[x];
-					if ((color & mask) == match) {
-						softwareRenderer->row[x] = _brighten(color, softwareRenderer->bldy);
-					}
-				}
+				_darkenRow(&softwareRenderer->row[start], &softwareRenderer->row[start], x - start, softwareRenderer->bldy, mask, match);
+			} else {
+				_brightenRow(&softwareRenderer->row[start], &softwareRenderer->row[start], x - start, softwareRenderer->bldy, mask, match);
 			}
 		}
 	}
 
+	if (softwareRenderer->outputTiled) {
+		// Each run of four pixels is one row of a tile, and the next tile starts 16 pixels later
+		color_t* tileRow = &softwareRenderer->outputBuffer[mColorTiledOffset(softwareRenderer->outputBufferStride, 0, y)];
+		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; x += 4) {
+			tileRow[x * 4] = softwareRenderer->row[x];
+			tileRow[x * 4 + 1] = softwareRenderer->row[x + 1];
+			tileRow[x * 4 + 2] = softwareRenderer->row[x + 2];
+			tileRow[x * 4 + 3] = softwareRenderer->row[x + 3];
+		}
+		return;
+	}
+
+	color_t* row = &softwareRenderer->outputBuffer[softwareRenderer->outputBufferStride * y];
 #ifdef COLOR_16_BIT
 	for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; x += 4) {
 		row[x] = softwareRenderer->row[x];
@@ -656,10 +754,31 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 		row[x + 3] = softwareRenderer->row[x + 3];
 	}
 #else
+	if (softwareRenderer->outputRGB565) {
+		uint16_t* row16 = &((uint16_t*) softwareRenderer->outputBuffer)[softwareRenderer->outputBufferStride * y];
+		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
+			row16[x] = mColorToRGB565(softwareRenderer->row[x]);
+		}
+		return;
+	}
 	memcpy(row, softwareRenderer->row, GBA_VIDEO_HORIZONTAL_PIXELS * sizeof(*row));
 #endif
 }
 
+void GBAVideoSoftwareRendererSkipScanline(struct GBAVideoSoftwareRenderer* softwareRenderer, int y) {
+	if (!_checkScanline(softwareRenderer, y)) {
+		return;
+	}
+	if (GBARegisterDISPCNTIsForcedBlank(softwareRenderer->dispcnt)) {
+		return;
+	}
+	if (softwareRenderer->blendDirty) {
+		_updatePalettes(softwareRenderer);
+		softwareRenderer->blendDirty = false;
+	}
+	_advanceScanline(softwareRenderer, y);
+}
+
 static void GBAVideoSoftwareRendererFinishFrame(struct GBAVideoRenderer* renderer) {
 	struct GBAVideoSoftwareRenderer* softwareRenderer = (struct GBAVideoSoftwareRenderer*) renderer;
 
@@ -698,6 +817,27 @@ static void GBAVideoSoftwareRendererPutPixels(struct GBAVideoRenderer* renderer,
 
 	const color_t* colorPixels = pixels;
 	unsigned i;
+	if (softwareRenderer->outputTiled) {
+		for (i = 0; i < GBA_VIDEO_VERTICAL_PIXELS; ++i) {
+			unsigned x;
+			for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
+				softwareRenderer->outputBuffer[mColorTiledOffset(softwareRenderer->outputBufferStride, x, i)] = colorPixels[stride * i + x];
+			}
+		}
+		return;
+	}
+#ifndef COLOR_16_BIT
+	if (softwareRenderer->outputRGB565) {
+		for (i = 0; i < GBA_VIDEO_VERTICAL_PIXELS; ++i) {
+			uint16_t* row = &((uint16_t*) softwareRenderer->outputBuffer)[softwareRenderer->outputBufferStride * i];
+			unsigned x;
+			for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
+				row[x] = mColorToRGB565(colorPixels[stride * i + x]);
+			}
+		}
+		return;
+	}
+#endif
 	for (i = 0; i < GBA_VIDEO_VERTICAL_PIXELS; ++i) {
 		memmove(&softwareRenderer->outputBuffer[softwareRenderer->outputBufferStride * i], &colorPixels[stride * i], GBA_VIDEO_HORIZONTAL_PIXELS * BYTES_PER_PIXEL);
 	}
@@ -726,6 +866,7 @@ static void GBAVideoSoftwareRendererUpdateDISPCNT(struct GBAVideoSoftwareRendere
 
 static void GBAVideoSoftwareRendererWriteBGCNT(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* bg, uint16_t value) {
 	UNUSED(renderer);
+	bg->yCache = -1;
 	bg->priority = GBARegisterBGCNTGetPriority(value);
 	bg->charBase = GBARegisterBGCNTGetCharBase(value) << 14;
 	bg->mosaic = GBARegisterBGCNTGetMosaic(value);
@@ -794,20 +935,23 @@ static void _drawScanline(struct GBAVideoSoftwareRenderer* renderer, int y) {
 	int spriteLayers = 0;
 	if (GBARegisterDISPCNTIsObjEnable(renderer->dispcnt) && !renderer->d.disableOBJ) {
 		if (renderer->oamDirty) {
-			renderer->oamMax = GBAVideoRendererCleanOAM(renderer->d.oam->obj, renderer->sprites, renderer->objOffsetY);
-			renderer->oamDirty = false;
+			_cleanOAM(renderer);
 		}
 		renderer->spriteCyclesRemaining = GBARegisterDISPCNTIsHblankIntervalFree(renderer->dispcnt) ? OBJ_HBLANK_FREE_LENGTH : OBJ_LENGTH;
 		int mosaicV = GBAMosaicControlGetObjV(renderer->mosaic) + 1;
 		int mosaicY = y - (y % mosaicV);
 		int i;
-		for (i = 0; i < renderer->oamMax; ++i) {
+		for (i = 0; i < 128; ++i) {
+			uint32_t bits = renderer->scanlineSprites[y][i >> 5] >> (i & 0x1F);
+			if (!bits) {
+				// Skip the rest of an empty word
+				i |= 0x1F;
+				continue;
+			}
+			i += ctz32(bits);
 			struct GBAVideoRendererSprite* sprite = &renderer->sprites[i];
 			int localY = y;
 			renderer->end = 0;
-			if ((y < sprite->y && (sprite->endY - 256 < 0 || y >= sprite->endY - 256)) || y >= sprite->endY) {
-				continue;
-			}
 			if (GBAObjAttributesAIsMosaic(sprite->obj.a)) {
 				localY = mosaicY;
 				if (localY < sprite->y) {
@@ -822,6 +966,7 @@ static void _drawScanline(struct GBAVideoSoftwareRenderer* renderer, int y) {
 					break;
 				}
 				renderer->currentWindow = renderer->windows[w].control;
+				renderer->currentBlend = renderer->windows[w].blend;
 				renderer->start = renderer->end;
 				renderer->end = renderer->windows[w].endX;
 				if (!GBAWindowControlIsObjEnable(renderer->currentWindow.packed) && !GBARegisterDISPCNTIsObjwinEnable(renderer->dispcnt)) {
@@ -844,14 +989,19 @@ static void _drawScanline(struct GBAVideoSoftwareRenderer* renderer, int y) {
 			renderer->start = renderer->end;
 			renderer->end = renderer->windows[w].endX;
 			renderer->currentWindow = renderer->windows[w].control;
+			renderer->currentBlend = renderer->windows[w].blend;
+			renderer->currentSpan = w;
 			if (spriteLayers & (1 << priority)) {
 				GBAVideoSoftwareRendererPostprocessSprite(renderer, priority);
+				renderer->windows[w].bare = false;
 			}
 			if (TEST_LAYER_ENABLED(0) && GBARegisterDISPCNTGetMode(renderer->dispcnt) < 2) {
 				GBAVideoSoftwareRendererDrawBackgroundMode0(renderer, &renderer->bg[0], y);
+				renderer->windows[w].bare = false;
 			}
 			if (TEST_LAYER_ENABLED(1) && GBARegisterDISPCNTGetMode(renderer->dispcnt) < 2) {
 				GBAVideoSoftwareRendererDrawBackgroundMode0(renderer, &renderer->bg[1], y);
+				renderer->windows[w].bare = false;
 			}
 			if (TEST_LAYER_ENABLED(2)) {
 				switch (GBARegisterDISPCNTGetMode(renderer->dispcnt)) {
@@ -872,6 +1022,7 @@ static void _drawScanline(struct GBAVideoSoftwareRenderer* renderer, int y) {
 					GBAVideoSoftwareRendererDrawBackgroundMode5(renderer, &renderer->bg[2], y);
 					break;
 				}
+				renderer->windows[w].bare = false;
 			}
 			if (TEST_LAYER_ENABLED(3)) {
 				switch (GBARegisterDISPCNTGetMode(renderer->dispcnt)) {
@@ -882,9 +1033,14 @@ static void _drawScanline(struct GBAVideoSoftwareRenderer* renderer, int y) {
 					GBAVideoSoftwareRendererDrawBackgroundMode2(renderer, &renderer->bg[3], y);
 					break;
 				}
+				renderer->windows[w].bare = false;
 			}
 		}
 	}
+	_advanceScanline(renderer, y);
+}
+
+static void _advanceScanline(struct GBAVideoSoftwareRenderer* renderer, int y) {
 	if (GBARegisterDISPCNTGetMode(renderer->dispcnt) != 0) {
 		renderer->bg[2].sx += renderer->bg[2].dmx;
 		renderer->bg[2].sy += renderer->bg[2].dmy;
@@ -913,16 +1069,166 @@ static void _drawScanline(struct GBAVideoSoftwareRenderer* renderer, int y) {
 static void _updatePalettes(struct GBAVideoSoftwareRenderer* renderer) {
 	int i;
 	if (renderer->blendEffect == BLEND_BRIGHTEN) {
+#ifndef COLOR_16_BIT
+		_brightenRow(renderer->variantPalette, renderer->normalPalette, 512, renderer->bldy, 0, 0);
+#else
 		for (i = 0; i < 512; ++i) {
 			renderer->variantPalette[i] = _brighten(renderer->normalPalette[i], renderer->bldy);
 		}
+#endif
 	} else if (renderer->blendEffect == BLEND_DARKEN) {
+#ifndef COLOR_16_BIT
+		_darkenRow(renderer->variantPalette, renderer->normalPalette, 512, renderer->bldy, 0, 0);
+#else
 		for (i = 0; i < 512; ++i) {
 			renderer->variantPalette[i] = _darken(renderer->normalPalette[i], renderer->bldy);
 		}
+#endif
 	} else {
 		for (i = 0; i < 512; ++i) {
 			renderer->variantPalette[i] = renderer->normalPalette[i];
 		}
 	}
 }
+
+// The vector paths below work on four 8888 pixels at a time, widening each channel to 16 bits.
+// They have to reproduce the scalar rounding exactly: _darken truncates the red channel but
+// effectively rounds green and blue up, due to how the shifted channels are masked.
+#ifdef SOFTWARE_SIMD_SSE2
+static inline __m128i _select(__m128i mask, __m128i a, __m128i b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#endif
+
+static void _blendBackdrop(uint32_t* row, int length, uint32_t backdrop, int blda, int bldb) {
+	int x = 0;
+#ifdef SOFTWARE_SIMD_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i target = _mm_set1_epi32(FLAG_TARGET_1);
+	const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i wA = _mm_set1_epi16(blda);
+	const __m128i wB = _mm_set1_epi16(bldb);
+	__m128i b = _mm_unpacklo_epi8(_mm_set1_epi32(backdrop), zero);
+	b = _mm_mullo_epi16(b, wB);
+	for (; x <= length - 4; x += 4) {
+		__m128i color = _mm_loadu_si128((__m128i*) &row[x]);
+		__m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(color, zero), wA);
+		__m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(color, zero), wA);
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, b), 4);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, b), 4);
+		__m128i mixed = _mm_and_si128(_mm_packus_epi16(lo, hi), colorMask);
+		__m128i mask = _mm_cmpeq_epi32(_mm_and_si128(color, target), target);
+		_mm_storeu_si128((__m128i*) &row[x], _select(mask, mixed, color));
+	}
+#elif defined(SOFTWARE_SIMD_NEON)
+	const uint32x4_t target = vdupq_n_u32(FLAG_TARGET_1);
+	const uint32x4_t colorMask = vdupq_n_u32(0x00FFFFFF);
+	const uint16x8_t wA = vdupq_n_u16(blda);
+	uint16x8_t b = vmulq_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(backdrop))), vdupq_n_u16(bldb));
+	for (; x <= length - 4; x += 4) {
+		uint32x4_t color = vld1q_u32(&row[x]);
+		uint8x16_t bytes = vreinterpretq_u8_u32(color);
+		uint16x8_t lo = vshrq_n_u16(vmlaq_u16(b, vmovl_u8(vget_low_u8(bytes)), wA), 4);
+		uint16x8_t hi = vshrq_n_u16(vmlaq_u16(b, vmovl_u8(vget_high_u8(bytes)), wA), 4);
+		uint32x4_t mixed = vandq_u32(vreinterpretq_u32_u8(vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi))), colorMask);
+		vst1q_u32(&row[x], vbslq_u32(vtstq_u32(color, target), mixed, color));
+	}
+#endif
+	for (; x < length; ++x) {
+		uint32_t color = row[x];
+		if (color & FLAG_TARGET_1) {
+			row[x] = _mix(bldb, backdrop, blda, color);
+		}
+	}
+}
+
+static void _brightenRow(uint32_t* out, const uint32_t* in, int length, int y, uint32_t mask, uint32_t match) {
+	int x = 0;
+#ifdef SOFTWARE_SIMD_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i max = _mm_set1_epi16(0xFF);
+	const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i vy = _mm_set1_epi16(y);
+	const __m128i vmask = _mm_set1_epi32(mask);
+	const __m128i vmatch = _mm_set1_epi32(match);
+	for (; x <= length - 4; x += 4) {
+		__m128i color = _mm_loadu_si128((const __m128i*) &in[x]);
+		__m128i lo = _mm_unpacklo_epi8(color, zero);
+		__m128i hi = _mm_unpackhi_epi8(color, zero);
+		lo = _mm_add_epi16(lo, _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(max, lo), vy), 4));
+		hi = _mm_add_epi16(hi, _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(max, hi), vy), 4));
+		__m128i brightened = _mm_and_si128(_mm_packus_epi16(lo, hi), colorMask);
+		__m128i select = _mm_cmpeq_epi32(_mm_and_si128(color, vmask), vmatch);
+		_mm_storeu_si128((__m128i*) &out[x], _select(select, brightened, color));
+	}
+#elif defined(SOFTWARE_SIMD_NEON)
+	const uint16x8_t max = vdupq_n_u16(0xFF);
+	const uint32x4_t colorMask = vdupq_n_u32(0x00FFFFFF);
+	const uint16x8_t vy = vdupq_n_u16(y);
+	const uint32x4_t vmask = vdupq_n_u32(mask);
+	const uint32x4_t vmatch = vdupq_n_u32(match);
+	for (; x <= length - 4; x += 4) {
+		uint32x4_t color = vld1q_u32(&in[x]);
+		uint8x16_t bytes = vreinterpretq_u8_u32(color);
+		uint16x8_t lo = vmovl_u8(vget_low_u8(bytes));
+		uint16x8_t hi = vmovl_u8(vget_high_u8(bytes));
+		lo = vaddq_u16(lo, vshrq_n_u16(vmulq_u16(vsubq_u16(max, lo), vy), 4));
+		hi = vaddq_u16(hi, vshrq_n_u16(vmulq_u16(vsubq_u16(max, hi), vy), 4));
+		uint32x4_t brightened = vandq_u32(vreinterpretq_u32_u8(vcombine_u8(vmovn_u16(lo), vmovn_u16(hi))), colorMask);
+		vst1q_u32(&out[x], vbslq_u32(vceqq_u32(vandq_u32(color, vmask), vmatch), brightened, color));
+	}
+#endif
+	for (; x < length; ++x) {
+		uint32_t color = in[x];
+		if ((color & mask) == match) {
+			color = _brighten(color, y);
+		}
+		out[x] = color;
+	}
+}
+
+static void _darkenRow(uint32_t* out, const uint32_t* in, int length, int y, uint32_t mask, uint32_t match) {
+	int x = 0;
+#ifdef SOFTWARE_SIMD_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set_epi16(0, 15, 15, 0, 0, 15, 15, 0);
+	const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i vy = _mm_set1_epi16(y);
+	const __m128i vmask = _mm_set1_epi32(mask);
+	const __m128i vmatch = _mm_set1_epi32(match);
+	for (; x <= length - 4; x += 4) {
+		__m128i color = _mm_loadu_si128((const __m128i*) &in[x]);
+		__m128i lo = _mm_unpacklo_epi8(color, zero);
+		__m128i hi = _mm_unpackhi_epi8(color, zero);
+		lo = _mm_sub_epi16(lo, _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, vy), round), 4));
+		hi = _mm_sub_epi16(hi, _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, vy), round), 4));
+		__m128i darkened = _mm_and_si128(_mm_packus_epi16(lo, hi), colorMask);
+		__m128i select = _mm_cmpeq_epi32(_mm_and_si128(color, vmask), vmatch);
+		_mm_storeu_si128((__m128i*) &out[x], _select(select, darkened, color));
+	}
+#elif defined(SOFTWARE_SIMD_NEON)
+	static const uint16_t roundData[8] = { 0, 15, 15, 0, 0, 15, 15, 0 };
+	const uint16x8_t round = vld1q_u16(roundData);
+	const uint32x4_t colorMask = vdupq_n_u32(0x00FFFFFF);
+	const uint16x8_t vy = vdupq_n_u16(y);
+	const uint32x4_t vmask = vdupq_n_u32(mask);
+	const uint32x4_t vmatch = vdupq_n_u32(match);
+	for (; x <= length - 4; x += 4) {
+		uint32x4_t color = vld1q_u32(&in[x]);
+		uint8x16_t bytes = vreinterpretq_u8_u32(color);
+		uint16x8_t lo = vmovl_u8(vget_low_u8(bytes));
+		uint16x8_t hi = vmovl_u8(vget_high_u8(bytes));
+		lo = vsubq_u16(lo, vshrq_n_u16(vmlaq_u16(round, lo, vy), 4));
+		hi = vsubq_u16(hi, vshrq_n_u16(vmlaq_u16(round, hi, vy), 4));
+		uint32x4_t darkened = vandq_u32(vreinterpretq_u32_u8(vcombine_u8(vmovn_u16(lo), vmovn_u16(hi))), colorMask);
+		vst1q_u32(&out[x], vbslq_u32(vceqq_u32(vandq_u32(color, vmask), vmatch), darkened, color));
+	}
+#endif
+	for (; x < length; ++x) {
+		uint32_t color = in[x];
+		if ((color & mask) == match) {
+			color = _darken(color, y);
+		}
+		out[x] = color;
+	}
+}
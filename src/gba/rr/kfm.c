@@ -0,0 +1,652 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/gba/rr/kfm.h>
+
+#include <mgba/internal/arm/arm.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/serialize.h>
+#include <mgba-util/hash.h>
+#include <mgba-util/memory.h>
+#include <mgba-util/vfs.h>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+#define KFM_MAGIC "GBAk"
+#define KFM_VERSION 1
+
+// All fields are little-endian 32-bit words following the magic
+enum {
+	KFM_HEADER_VERSION = 0x04,
+	KFM_HEADER_INIT_FROM = 0x08,
+	KFM_HEADER_INTERVAL = 0x0C,
+	KFM_HEADER_FRAMES = 0x10,
+	KFM_HEADER_LAG_FRAMES = 0x14,
+	KFM_HEADER_RR_COUNT = 0x18,
+	KFM_HEADER_FLAGS = 0x1C,
+	KFM_HEADER_INPUT_OFFSET = 0x20,
+	KFM_HEADER_KEYFRAMES = 0x24,
+	KFM_HEADER_INDEX_OFFSET = 0x28,
+	KFM_HEADER_SIZE = 0x2C
+};
+
+enum {
+	KFM_FLAG_COMPRESSED = 1
+};
+
+enum {
+	KFM_INPUT_KEYS = 0x03FF,
+	KFM_INPUT_LAG = 0x8000
+};
+
+DEFINE_VECTOR(GBAKFMKeyframeList, struct GBAKFMKeyframe);
+DEFINE_VECTOR(GBAKFMInputList, uint16_t);
+
+static void GBAKFMContextDestroy(struct GBARRContext*);
+
+static bool GBAKFMStartPlaying(struct GBARRContext*, bool autorecord);
+static void GBAKFMStopPlaying(struct GBARRContext*);
+static bool GBAKFMStartRecording(struct GBARRContext*);
+static void GBAKFMStopRecording(struct GBARRContext*);
+
+static bool GBAKFMIsPlaying(const struct GBARRContext*);
+static bool GBAKFMIsRecording(const struct GBARRContext*);
+
+static void GBAKFMNextFrame(struct GBARRContext*);
+static void GBAKFMLogInput(struct GBARRContext*, uint16_t input);
+static uint16_t GBAKFMQueryInput(struct GBARRContext*);
+static bool GBAKFMQueryReset(struct GBARRContext*);
+
+static void GBAKFMStateSaved(struct GBARRContext* rr, struct GBASerializedState* state);
+static void GBAKFMStateLoaded(struct GBARRContext* rr, const struct GBASerializedState* state);
+
+static struct VFile* GBAKFMOpenSavedata(struct GBARRContext*, int flags);
+static struct VFile* GBAKFMOpenSavestate(struct GBARRContext*, int flags);
+
+static void _serializeKeyframe(struct GBAKFMContext*, bool frameEnding);
+static bool _takeKeyframe(struct GBAKFMContext*, bool frameEnding);
+static bool _readKeyframe(struct GBAKFMContext*, const struct GBAKFMKeyframe*);
+static bool _loadKeyframe(struct GBAKFMContext*, const struct GBAKFMKeyframe*);
+static void _truncate(struct GBAKFMContext*, uint32_t frame);
+static bool _writeIndex(struct GBAKFMContext*);
+static void _streamEndReached(struct GBAKFMContext*);
+
+void GBAKFMContextCreate(struct GBAKFMContext* kfm, struct GBA* gba) {
+	memset(kfm, 0, sizeof(*kfm));
+
+	kfm->d.destroy = GBAKFMContextDestroy;
+
+	kfm->d.startPlaying = GBAKFMStartPlaying;
+	kfm->d.stopPlaying = GBAKFMStopPlaying;
+	kfm->d.startRecording = GBAKFMStartRecording;
+	kfm->d.stopRecording = GBAKFMStopRecording;
+
+	kfm->d.isPlaying = GBAKFMIsPlaying;
+	kfm->d.isRecording = GBAKFMIsRecording;
+
+	kfm->d.nextFrame = GBAKFMNextFrame;
+	kfm->d.logInput = GBAKFMLogInput;
+	kfm->d.queryInput = GBAKFMQueryInput;
+	kfm->d.queryReset = GBAKFMQueryReset;
+
+	kfm->d.stateSaved = GBAKFMStateSaved;
+	kfm->d.stateLoaded = GBAKFMStateLoaded;
+
+	kfm->d.openSavedata = GBAKFMOpenSavedata;
+	kfm->d.openSavestate = GBAKFMOpenSavestate;
+
+	kfm->gba = gba;
+	kfm->keyframeInterval = GBA_KFM_DEFAULT_INTERVAL;
+	GBAKFMKeyframeListInit(&kfm->keyframes, 0);
+	GBAKFMInputListInit(&kfm->inputs, 0);
+	kfm->state = anonymousMemoryMap(sizeof(struct GBASerializedState));
+}
+
+void GBAKFMContextDestroy(struct GBARRContext* rr) {
+	struct GBAKFMContext* kfm = (struct GBAKFMContext*) rr;
+	if (kfm->movieFile) {
+		kfm->movieFile->close(kfm->movieFile);
+	}
+	GBAKFMKeyframeListDeinit(&kfm->keyframes);
+	GBAKFMInputListDeinit(&kfm->inputs);
+	mappedMemoryFree(kfm->state, sizeof(struct GBASerializedState));
+}
+
+bool GBAKFMSetStream(struct GBAKFMContext* kfm, struct VFile* vf) {
+	if (kfm->movieFile && kfm->movieFile != vf) {
+		kfm->movieFile->close(kfm->movieFile);
+	}
+	kfm->movieFile = vf;
+	GBAKFMKeyframeListClear(&kfm->keyframes);
+	GBAKFMInputListClear(&kfm->inputs);
+	kfm->d.frames = 0;
+	kfm->d.lagFrames = 0;
+	kfm->d.rrCount = 0;
+	kfm->writeOffset = KFM_HEADER_SIZE;
+	if (vf->size(vf) == 0) {
+		return true;
+	}
+
+	uint8_t header[KFM_HEADER_SIZE];
+	vf->seek(vf, 0, SEEK_SET);
+	if (vf->read(vf, header, sizeof(header)) != sizeof(header) || memcmp(header, KFM_MAGIC, 4) != 0) {
+		return false;
+	}
+	uint32_t version;
+	uint32_t initFrom;
+	uint32_t frames;
+	uint32_t inputOffset;
+	uint32_t nKeyframes;
+	uint32_t indexOffset;
+	LOAD_32LE(version, KFM_HEADER_VERSION, header);
+	LOAD_32LE(initFrom, KFM_HEADER_INIT_FROM, header);
+	LOAD_32LE(kfm->keyframeInterval, KFM_HEADER_INTERVAL, header);
+	LOAD_32LE(frames, KFM_HEADER_FRAMES, header);
+	LOAD_32LE(kfm->d.rrCount, KFM_HEADER_RR_COUNT, header);
+	LOAD_32LE(inputOffset, KFM_HEADER_INPUT_OFFSET, header);
+	LOAD_32LE(nKeyframes, KFM_HEADER_KEYFRAMES, header);
+	LOAD_32LE(indexOffset, KFM_HEADER_INDEX_OFFSET, header);
+	if (version != KFM_VERSION) {
+		mLOG(GBA_RR, ERROR, "Unsupported movie version: %u", version);
+		return false;
+	}
+#ifndef USE_ZLIB
+	uint32_t flags;
+	LOAD_32LE(flags, KFM_HEADER_FLAGS, header);
+	if (flags & KFM_FLAG_COMPRESSED) {
+		mLOG(GBA_RR, ERROR, "Movie keyframes are compressed but zlib support is not available");
+		return false;
+	}
+#endif
+	kfm->d.initFrom = initFrom & INIT_FROM_BOTH;
+	if (!kfm->keyframeInterval) {
+		kfm->keyframeInterval = GBA_KFM_DEFAULT_INTERVAL;
+	}
+
+	GBAKFMInputListResize(&kfm->inputs, frames);
+	vf->seek(vf, inputOffset, SEEK_SET);
+	size_t i;
+	for (i = 0; i < frames; ++i) {
+		uint8_t buffer[2];
+		if (vf->read(vf, buffer, sizeof(buffer)) != sizeof(buffer)) {
+			mLOG(GBA_RR, ERROR, "Movie input stream is truncated");
+			GBAKFMInputListClear(&kfm->inputs);
+			return false;
+		}
+		uint16_t input;
+		LOAD_16LE(input, 0, buffer);
+		*GBAKFMInputListGetPointer(&kfm->inputs, i) = input;
+	}
+
+	vf->seek(vf, indexOffset, SEEK_SET);
+	for (i = 0; i < nKeyframes; ++i) {
+		uint8_t buffer[12];
+		if (vf->read(vf, buffer, sizeof(buffer)) != sizeof(buffer)) {
+			mLOG(GBA_RR, ERROR, "Movie keyframe index is truncated");
+			GBAKFMInputListClear(&kfm->inputs);
+			GBAKFMKeyframeListClear(&kfm->keyframes);
+			return false;
+		}
+		struct GBAKFMKeyframe* keyframe = GBAKFMKeyframeListAppend(&kfm->keyframes);
+		LOAD_32LE(keyframe->frame, 0, buffer);
+		LOAD_32LE(keyframe->offset, 4, buffer);
+		LOAD_32LE(keyframe->size, 8, buffer);
+		kfm->writeOffset = keyframe->offset + keyframe->size;
+	}
+	return true;
+}
+
+bool GBAKFMCreateStream(struct GBAKFMContext* kfm, enum GBARRInitFrom initFrom, uint32_t keyframeInterval) {
+	if (!kfm->movieFile || kfm->isPlaying || kfm->isRecording) {
+		return false;
+	}
+	kfm->movieFile->truncate(kfm->movieFile, 0);
+	GBAKFMKeyframeListClear(&kfm->keyframes);
+	GBAKFMInputListClear(&kfm->inputs);
+	kfm->d.initFrom = initFrom;
+	kfm->d.frames = 0;
+	kfm->d.lagFrames = 0;
+	kfm->d.rrCount = 0;
+	kfm->keyframeInterval = keyframeInterval ? keyframeInterval : GBA_KFM_DEFAULT_INTERVAL;
+	kfm->writeOffset = KFM_HEADER_SIZE;
+	return _writeIndex(kfm);
+}
+
+uint32_t GBAKFMFrameCount(const struct GBAKFMContext* kfm) {
+	return GBAKFMInputListSize(&kfm->inputs);
+}
+
+bool GBAKFMSeek(struct GBAKFMContext* kfm, uint32_t frame) {
+	if (kfm->isRecording || frame > GBAKFMInputListSize(&kfm->inputs)) {
+		return false;
+	}
+
+	// Keyframes are appended in frame order, so binary search for the closest one. Apart from the first,
+	// which is taken when recording starts, they are captured partway through the frame end handler,
+	// so one tagged with the target frame itself is slightly past it and can't be used.
+	const struct GBAKFMKeyframe* keyframe = NULL;
+	if (GBAKFMKeyframeListSize(&kfm->keyframes)) {
+		keyframe = GBAKFMKeyframeListGetConstPointer(&kfm->keyframes, 0);
+		if (keyframe->frame > frame) {
+			return false;
+		}
+	}
+	size_t low = 1;
+	size_t high = GBAKFMKeyframeListSize(&kfm->keyframes);
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		const struct GBAKFMKeyframe* candidate = GBAKFMKeyframeListGetConstPointer(&kfm->keyframes, mid);
+		if (candidate->frame < frame) {
+			keyframe = candidate;
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	if (!keyframe || !_loadKeyframe(kfm, keyframe)) {
+		return false;
+	}
+
+	kfm->isPlaying = true;
+	kfm->autorecord = false;
+	kfm->inputThisFrame = false;
+	kfm->d.frames = keyframe->frame;
+	kfm->d.lagFrames = 0;
+	size_t i;
+	for (i = 0; i < keyframe->frame; ++i) {
+		if (*GBAKFMInputListGetPointer(&kfm->inputs, i) & KFM_INPUT_LAG) {
+			++kfm->d.lagFrames;
+		}
+	}
+	mLOG(GBA_RR, DEBUG, "Seeking to frame %u from keyframe at %u", frame, keyframe->frame);
+	while (kfm->d.frames < frame && kfm->isPlaying) {
+		ARMRunLoop(kfm->gba->cpu);
+	}
+	return kfm->d.frames == frame;
+}
+
+size_t GBAKFMKeyframeCount(const struct GBAKFMContext* kfm) {
+	return GBAKFMKeyframeListSize(&kfm->keyframes);
+}
+
+enum GBAKFMVerifyResult GBAKFMVerifySegment(struct GBAKFMContext* kfm, size_t index, uint64_t* expected, uint64_t* actual) {
+	if (kfm->isRecording || kfm->isPlaying || index + 1 >= GBAKFMKeyframeListSize(&kfm->keyframes)) {
+		return GBA_KFM_VERIFY_ERROR;
+	}
+	const struct GBAKFMKeyframe* keyframe = GBAKFMKeyframeListGetConstPointer(&kfm->keyframes, index);
+	const struct GBAKFMKeyframe* next = GBAKFMKeyframeListGetConstPointer(&kfm->keyframes, index + 1);
+	if (!_readKeyframe(kfm, next)) {
+		return GBA_KFM_VERIFY_ERROR;
+	}
+	uint64_t expectedHash = hash64(kfm->state, sizeof(struct GBASerializedState), 0);
+	if (!_loadKeyframe(kfm, keyframe)) {
+		return GBA_KFM_VERIFY_ERROR;
+	}
+
+	kfm->isPlaying = true;
+	kfm->autorecord = false;
+	kfm->inputThisFrame = false;
+	kfm->d.frames = keyframe->frame;
+	kfm->verifyFrame = next->frame;
+	while (kfm->isPlaying) {
+		ARMRunLoop(kfm->gba->cpu);
+	}
+	kfm->verifyFrame = 0;
+	if (kfm->d.frames != next->frame) {
+		return GBA_KFM_VERIFY_ERROR;
+	}
+	uint64_t actualHash = hash64(kfm->state, sizeof(struct GBASerializedState), 0);
+	if (expected) {
+		*expected = expectedHash;
+	}
+	if (actual) {
+		*actual = actualHash;
+	}
+	mLOG(GBA_RR, DEBUG, "Verified frames %u to %u: %016" PRIX64 ", expected %016" PRIX64, keyframe->frame, next->frame, actualHash, expectedHash);
+	return actualHash == expectedHash ? GBA_KFM_VERIFY_MATCH : GBA_KFM_VERIFY_MISMATCH;
+}
+
+bool GBAKFMStartPlaying(struct GBARRContext* rr, bool autorecord) {
+	if (rr->isRecording(rr) || rr->isPlaying(rr)) {
+		return false;
+	}
+
+	struct GBAKFMContext* kfm = (struct GBAKFMContext*) rr;
+	if (!GBAKFMInputListSize(&kfm->inputs)) {
+		return false;
+	}
+	kfm->isPlaying = true;
+	kfm->autorecord = autorecord;
+	kfm->inputThisFrame = false;
+	kfm->d.frames = 0;
+	kfm->d.lagFrames = 0;
+	return true;
+}
+
+void GBAKFMStopPlaying(struct GBARRContext* rr) {
+	struct GBAKFMContext* kfm = (struct GBAKFMContext*) rr;
+	kfm->isPlaying = false;
+}
+
+bool GBAKFMStartRecording(struct GBARRContext* rr) {
+	if (rr->isRecording(rr) || rr->isPlaying(rr)) {
+		return false;
+	}
+
+	struct GBAKFMContext* kfm = (struct GBAKFMContext*) rr;
+	if (!kfm->movieFile || !kfm->gba) {
+		return false;
+	}
+	kfm->isRecording = true;
+	kfm->inputThisFrame = false;
+	_truncate(kfm, kfm->d.frames);
+	if (!GBAKFMKeyframeListSize(&kfm->keyframes)) {
+		// Seeking needs somewhere to start from, even before the first interval elapses
+		return _takeKeyframe(kfm, false);
+	}
+	return true;
+}
+
+void GBAKFMStopRecording(struct GBARRContext* rr) {
+	if (!rr->isRecording(rr)) {
+		return;
+	}
+
+	struct GBAKFMContext* kfm = (struct GBAKFMContext*) rr;
+	kfm->isRecording = false;
+	_writeIndex(kfm);
+}
+
+bool GBAKFMIsPlaying(const struct GBARRContext* rr) {
+	const struct GBAKFMContext* kfm = (const struct GBAKFMContext*) rr;
+	return kfm->isPlaying;
+}
+
+bool GBAKFMIsRecording(const struct GBARRContext* rr) {
+	const struct GBAKFMContext* kfm = (const struct GBAKFMContext*) rr;
+	return kfm->isRecording;
+}
+
+void GBAKFMNextFrame(struct GBARRContext* rr) {
+	if (!rr->isRecording(rr) && !rr->isPlaying(rr)) {
+		return;
+	}
+
+	struct GBAKFMContext* kfm = (struct GBAKFMContext*) rr;
+	if (rr->isRecording(rr)) {
+		uint16_t input = kfm->currentInput & KFM_INPUT_KEYS;
+		if (!kfm->inputThisFrame) {
+			input |= KFM_INPUT_LAG;
+			++kfm->d.lagFrames;
+		}
+		*GBAKFMInputListAppend(&kfm->inputs) = input;
+		++kfm->d.frames;
+		kfm->inputThisFrame = false;
+		if (kfm->d.frames % kfm->keyframeInterval == 0) {
+			_takeKeyframe(kfm, true);
+		}
+		return;
+	}
+
+	uint16_t input = *GBAKFMInputListGetPointer(&kfm->inputs, kfm->d.frames);
+	if (!kfm->inputThisFrame) {
+		++kfm->d.lagFrames;
+		if (!(input & KFM_INPUT_LAG)) {
+			mLOG(GBA_RR, WARN, "Lag frame %u does not match movie", kfm->d.frames);
+		}
+	} else if (input & KFM_INPUT_LAG) {
+		mLOG(GBA_RR, WARN, "Frame %u was a lag frame in movie", kfm->d.frames);
+	}
+	++kfm->d.frames;
+	kfm->inputThisFrame = false;
+	if (kfm->verifyFrame && kfm->d.frames == kfm->verifyFrame) {
+		// Captured at the same point the keyframe being checked against was
+		_serializeKeyframe(kfm, true);
+		kfm->isPlaying = false;
+		return;
+	}
+	if (kfm->d.frames >= GBAKFMInputListSize(&kfm->inputs)) {
+		_streamEndReached(kfm);
+	}
+}
+
+void GBAKFMLogInput(struct GBARRContext* rr, uint16_t keys) {
+	if (!rr->isRecording(rr)) {
+		return;
+	}
+
+	struct GBAKFMContext* kfm = (struct GBAKFMContext*) rr;
+	kfm->currentInput = keys;
+	kfm->inputThisFrame = true;
+}
+
+uint16_t GBAKFMQueryInput(struct GBARRContext* rr) {
+	if (!rr->isPlaying(rr)) {
+		return 0;
+	}
+
+	struct GBAKFMContext* kfm = (struct GBAKFMContext*) rr;
+	kfm->inputThisFrame = true;
+	return *GBAKFMInputListGetPointer(&kfm->inputs, kfm->d.frames) & KFM_INPUT_KEYS;
+}
+
+bool GBAKFMQueryReset(struct GBARRContext* rr) {
+	UNUSED(rr);
+	return false;
+}
+
+void GBAKFMStateSaved(struct GBARRContext* rr, struct GBASerializedState* state) {
+	if (rr->isRecording(rr) || rr->isPlaying(rr)) {
+		// The associated stream of a keyframed movie is the frame the state was taken on
+		state->associatedStreamId = rr->frames;
+	}
+}
+
+void GBAKFMStateLoaded(struct GBARRContext* rr, const struct GBASerializedState* state) {
+	struct GBAKFMContext* kfm = (struct GBAKFMContext*) rr;
+	if (kfm->internalState) {
+		return;
+	}
+	uint32_t frame = state->associatedStreamId;
+	if (frame > GBAKFMInputListSize(&kfm->inputs)) {
+		mLOG(GBA_RR, WARN, "Loaded state from frame %u is past the end of the movie", frame);
+		if (rr->isPlaying(rr)) {
+			rr->stopPlaying(rr);
+		}
+		return;
+	}
+	kfm->inputThisFrame = false;
+	if (rr->isRecording(rr)) {
+		_truncate(kfm, frame);
+		++kfm->d.rrCount;
+	} else if (rr->isPlaying(rr)) {
+		kfm->d.frames = frame;
+		if (frame == GBAKFMInputListSize(&kfm->inputs)) {
+			_streamEndReached(kfm);
+		}
+	}
+}
+
+struct VFile* GBAKFMOpenSavedata(struct GBARRContext* rr, int flags) {
+	UNUSED(rr);
+	UNUSED(flags);
+	return NULL;
+}
+
+struct VFile* GBAKFMOpenSavestate(struct GBARRContext* rr, int flags) {
+	UNUSED(rr);
+	UNUSED(flags);
+	return NULL;
+}
+
+void _serializeKeyframe(struct GBAKFMContext* kfm, bool frameEnding) {
+	kfm->internalState = true;
+	GBASerialize(kfm->gba, kfm->state);
+	kfm->internalState = false;
+	if (frameEnding) {
+		// nextFrame runs before the video unit bumps its frame counter, so store the value it will
+		// have once the frame has ended; otherwise a restored keyframe would lag behind by one
+		STORE_32LE(kfm->gba->video.frameCounter + 1, 0, &kfm->state->video.frameCounter);
+	}
+}
+
+bool _takeKeyframe(struct GBAKFMContext* kfm, bool frameEnding) {
+	_serializeKeyframe(kfm, frameEnding);
+
+	const void* data = kfm->state;
+	size_t size = sizeof(struct GBASerializedState);
+#ifdef USE_ZLIB
+	uLongf compressedSize = compressBound(size);
+	void* compressed = malloc(compressedSize);
+	if (compress2(compressed, &compressedSize, (const Bytef*) kfm->state, size, Z_BEST_SPEED) == Z_OK) {
+		data = compressed;
+		size = compressedSize;
+	} else {
+		free(compressed);
+		mLOG(GBA_RR, ERROR, "Failed to compress keyframe");
+		return false;
+	}
+#endif
+
+	struct VFile* vf = kfm->movieFile;
+	bool success = vf->seek(vf, kfm->writeOffset, SEEK_SET) >= 0 && vf->write(vf, data, size) == (ssize_t) size;
+	if (success) {
+		struct GBAKFMKeyframe* keyframe = GBAKFMKeyframeListAppend(&kfm->keyframes);
+		keyframe->frame = kfm->d.frames;
+		keyframe->offset = kfm->writeOffset;
+		keyframe->size = size;
+		kfm->writeOffset += size;
+		mLOG(GBA_RR, DEBUG, "Keyframe at frame %u: %" PRIz "u bytes", kfm->d.frames, size);
+	} else {
+		mLOG(GBA_RR, ERROR, "Failed to write keyframe at frame %u", kfm->d.frames);
+	}
+#ifdef USE_ZLIB
+	free(compressed);
+#endif
+	return success;
+}
+
+bool _readKeyframe(struct GBAKFMContext* kfm, const struct GBAKFMKeyframe* keyframe) {
+	struct VFile* vf = kfm->movieFile;
+	void* data = malloc(keyframe->size);
+	if (vf->seek(vf, keyframe->offset, SEEK_SET) < 0 || vf->read(vf, data, keyframe->size) != (ssize_t) keyframe->size) {
+		free(data);
+		mLOG(GBA_RR, ERROR, "Failed to read keyframe at frame %u", keyframe->frame);
+		return false;
+	}
+	bool success = true;
+	if (keyframe->size == sizeof(struct GBASerializedState)) {
+		memcpy(kfm->state, data, keyframe->size);
+	} else {
+#ifdef USE_ZLIB
+		uLongf size = sizeof(struct GBASerializedState);
+		success = uncompress((Bytef*) kfm->state, &size, data, keyframe->size) == Z_OK && size == sizeof(struct GBASerializedState);
+#else
+		success = false;
+#endif
+	}
+	free(data);
+	if (!success) {
+		mLOG(GBA_RR, ERROR, "Keyframe at frame %u is corrupted", keyframe->frame);
+	}
+	return success;
+}
+
+bool _loadKeyframe(struct GBAKFMContext* kfm, const struct GBAKFMKeyframe* keyframe) {
+	if (!_readKeyframe(kfm, keyframe)) {
+		return false;
+	}
+
+	kfm->internalState = true;
+	bool success = GBADeserialize(kfm->gba, kfm->state);
+	kfm->internalState = false;
+	return success;
+}
+
+void _truncate(struct GBAKFMContext* kfm, uint32_t frame) {
+	if (frame < GBAKFMInputListSize(&kfm->inputs)) {
+		GBAKFMInputListResize(&kfm->inputs, (ssize_t) frame - (ssize_t) GBAKFMInputListSize(&kfm->inputs));
+	}
+	kfm->d.frames = GBAKFMInputListSize(&kfm->inputs);
+	kfm->d.lagFrames = 0;
+	size_t i;
+	for (i = 0; i < kfm->d.frames; ++i) {
+		if (*GBAKFMInputListGetPointer(&kfm->inputs, i) & KFM_INPUT_LAG) {
+			++kfm->d.lagFrames;
+		}
+	}
+
+	size_t nKeyframes = GBAKFMKeyframeListSize(&kfm->keyframes);
+	while (nKeyframes && GBAKFMKeyframeListGetPointer(&kfm->keyframes, nKeyframes - 1)->frame > frame) {
+		--nKeyframes;
+	}
+	GBAKFMKeyframeListResize(&kfm->keyframes, (ssize_t) nKeyframes - (ssize_t) GBAKFMKeyframeListSize(&kfm->keyframes));
+	if (nKeyframes) {
+		const struct GBAKFMKeyframe* last = GBAKFMKeyframeListGetPointer(&kfm->keyframes, nKeyframes - 1);
+		kfm->writeOffset = last->offset + last->size;
+	} else {
+		kfm->writeOffset = KFM_HEADER_SIZE;
+	}
+}
+
+bool _writeIndex(struct GBAKFMContext* kfm) {
+	struct VFile* vf = kfm->movieFile;
+	uint32_t frames = GBAKFMInputListSize(&kfm->inputs);
+	uint32_t nKeyframes = GBAKFMKeyframeListSize(&kfm->keyframes);
+	uint32_t inputOffset = kfm->writeOffset;
+	uint32_t indexOffset = inputOffset + frames * 2;
+	size_t trailerSize = frames * 2 + nKeyframes * 12;
+	uint8_t* trailer = malloc(trailerSize ? trailerSize : 1);
+	size_t i;
+	for (i = 0; i < frames; ++i) {
+		STORE_16LE(*GBAKFMInputListGetPointer(&kfm->inputs, i), i * 2, trailer);
+	}
+	for (i = 0; i < nKeyframes; ++i) {
+		const struct GBAKFMKeyframe* keyframe = GBAKFMKeyframeListGetPointer(&kfm->keyframes, i);
+		STORE_32LE(keyframe->frame, frames * 2 + i * 12, trailer);
+		STORE_32LE(keyframe->offset, frames * 2 + i * 12 + 4, trailer);
+		STORE_32LE(keyframe->size, frames * 2 + i * 12 + 8, trailer);
+	}
+
+	uint8_t header[KFM_HEADER_SIZE];
+	memcpy(header, KFM_MAGIC, 4);
+	STORE_32LE(KFM_VERSION, KFM_HEADER_VERSION, header);
+	STORE_32LE(kfm->d.initFrom, KFM_HEADER_INIT_FROM, header);
+	STORE_32LE(kfm->keyframeInterval, KFM_HEADER_INTERVAL, header);
+	STORE_32LE(frames, KFM_HEADER_FRAMES, header);
+	STORE_32LE(kfm->d.lagFrames, KFM_HEADER_LAG_FRAMES, header);
+	STORE_32LE(kfm->d.rrCount, KFM_HEADER_RR_COUNT, header);
+#ifdef USE_ZLIB
+	STORE_32LE(KFM_FLAG_COMPRESSED, KFM_HEADER_FLAGS, header);
+#else
+	STORE_32LE(0, KFM_HEADER_FLAGS, header);
+#endif
+	STORE_32LE(inputOffset, KFM_HEADER_INPUT_OFFSET, header);
+	STORE_32LE(nKeyframes, KFM_HEADER_KEYFRAMES, header);
+	STORE_32LE(indexOffset, KFM_HEADER_INDEX_OFFSET, header);
+
+	bool success = vf->seek(vf, inputOffset, SEEK_SET) >= 0 && vf->write(vf, trailer, trailerSize) == (ssize_t) trailerSize;
+	free(trailer);
+	success = success && vf->seek(vf, 0, SEEK_SET) >= 0 && vf->write(vf, header, sizeof(header)) == sizeof(header);
+	if (!success) {
+		mLOG(GBA_RR, ERROR, "Failed to write movie index");
+		return false;
+	}
+	vf->truncate(vf, indexOffset + nKeyframes * 12);
+	return true;
+}
+
+void _streamEndReached(struct GBAKFMContext* kfm) {
+	if (!kfm->isPlaying) {
+		return;
+	}
+
+	kfm->isPlaying = false;
+	if (kfm->autorecord) {
+		kfm->isRecording = true;
+	}
+}
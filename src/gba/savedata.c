@@ -49,6 +49,7 @@ void GBASavedataInit(struct GBASavedata* savedata, struct VFile* vf) {
 	savedata->mapMode = MAP_WRITE;
 	savedata->maskWriteback = false;
 	savedata->dirty = 0;
+	savedata->dirtySectors = 0;
 	savedata->dirtAge = 0;
 	savedata->dust.name = "GBA Savedata Settling";
 	savedata->dust.priority = 0x70;
@@ -178,6 +179,7 @@ bool GBASavedataLoad(struct GBASavedata* savedata, struct VFile* in) {
 		}
 		ssize_t size = GBASavedataSize(savedata);
 		in->seek(in, 0, SEEK_SET);
+		savedata->dirtySectors = mSAVEDATA_SECTORS_ALL;
 		return in->read(in, savedata->data, size) == size;
 	} else if (savedata->vf) {
 		off_t read = 0;
@@ -265,6 +267,7 @@ void GBASavedataInitFlash(struct GBASavedata* savedata) {
 	}
 
 	savedata->currentBank = savedata->data;
+	savedata->dirtySectors = mSAVEDATA_SECTORS_ALL;
 	if (end < SIZE_CART_FLASH512) {
 		memset(&savedata->data[end], 0xFF, flashSize - end);
 	}
@@ -292,6 +295,7 @@ void GBASavedataInitEEPROM(struct GBASavedata* savedata) {
 		}
 		savedata->data = savedata->vf->map(savedata->vf, eepromSize, savedata->mapMode);
 	}
+	savedata->dirtySectors = mSAVEDATA_SECTORS_ALL;
 	if (end < SIZE_CART_EEPROM512) {
 		memset(&savedata->data[end], 0xFF, SIZE_CART_EEPROM512 - end);
 	}
@@ -315,6 +319,7 @@ void GBASavedataInitSRAM(struct GBASavedata* savedata) {
 		}
 		savedata->data = savedata->vf->map(savedata->vf, SIZE_CART_SRAM, savedata->mapMode);
 	}
+	savedata->dirtySectors = mSAVEDATA_SECTORS_ALL;
 
 	if (end < SIZE_CART_SRAM) {
 		memset(&savedata->data[end], 0xFF, SIZE_CART_SRAM - end);
@@ -345,6 +350,7 @@ void GBASavedataWriteFlash(struct GBASavedata* savedata, uint16_t address, uint8
 		switch (savedata->command) {
 		case FLASH_COMMAND_PROGRAM:
 			savedata->dirty |= SAVEDATA_DIRT_NEW;
+			savedata->dirtySectors |= mSavedataSector(&savedata->currentBank[address] - savedata->data);
 			savedata->currentBank[address] = value;
 			savedata->command = FLASH_COMMAND_NONE;
 			mTimingDeschedule(savedata->timing, &savedata->dust);
@@ -445,6 +451,7 @@ static void _ensureEeprom(struct GBASavedata* savedata, uint32_t size) {
 	} else {
 		savedata->data = savedata->vf->map(savedata->vf, SIZE_CART_EEPROM, savedata->mapMode);
 	}
+	savedata->dirtySectors = mSAVEDATA_SECTORS_ALL;
 }
 
 void GBASavedataWriteEEPROM(struct GBASavedata* savedata, uint16_t value, uint32_t writeSize) {
@@ -477,6 +484,7 @@ void GBASavedataWriteEEPROM(struct GBASavedata* savedata, uint16_t value, uint32
 			current &= ~(1 << (0x7 - (savedata->writeAddress & 0x7)));
 			current |= (value & 0x1) << (0x7 - (savedata->writeAddress & 0x7));
 			savedata->dirty |= SAVEDATA_DIRT_NEW;
+			savedata->dirtySectors |= mSavedataSector(savedata->writeAddress >> 3);
 			savedata->data[savedata->writeAddress >> 3] = current;
 			mTimingDeschedule(savedata->timing, &savedata->dust);
 			mTimingSchedule(savedata->timing, &savedata->dust, EEPROM_SETTLE_CYCLES);
@@ -542,8 +550,10 @@ void GBASavedataClean(struct GBASavedata* savedata, uint32_t frameCount) {
 		}
 		if (savedata->mapMode & MAP_WRITE) {
 			size_t size = GBASavedataSize(savedata);
+			uint32_t sectors = savedata->dirtySectors;
 			savedata->dirty = 0;
-			if (savedata->data && savedata->vf->sync(savedata->vf, savedata->data, size)) {
+			savedata->dirtySectors = 0;
+			if (savedata->data && mSavedataSyncSectors(savedata->vf, savedata->data, size, sectors)) {
 				mLOG(GBA_SAVE, INFO, "Savedata synced");
 			} else {
 				mLOG(GBA_SAVE, INFO, "Savedata failed to sync!");
@@ -611,6 +621,7 @@ void _flashSwitchBank(struct GBASavedata* savedata, int bank) {
 			} else {
 				savedata->data = savedata->vf->map(savedata->vf, SIZE_CART_FLASH1M, MAP_WRITE);
 			}
+			savedata->dirtySectors = mSAVEDATA_SECTORS_ALL;
 		}
 	}
 }
@@ -622,6 +633,7 @@ void _flashErase(struct GBASavedata* savedata) {
 	if (savedata->type == SAVEDATA_FLASH1M) {
 		size = SIZE_CART_FLASH1M;
 	}
+	savedata->dirtySectors |= mSavedataSectorRange(0, size);
 	memset(savedata->data, 0xFF, size);
 }
 
@@ -635,5 +647,6 @@ void _flashEraseSector(struct GBASavedata* savedata, uint16_t sectorStart) {
 	savedata->settling = sectorStart >> 12;
 	mTimingDeschedule(savedata->timing, &savedata->dust);
 	mTimingSchedule(savedata->timing, &savedata->dust, FLASH_ERASE_CYCLES);
+	savedata->dirtySectors |= mSavedataSectorRange(&savedata->currentBank[sectorStart & ~(size - 1)] - savedata->data, size);
 	memset(&savedata->currentBank[sectorStart & ~(size - 1)], 0xFF, size);
 }
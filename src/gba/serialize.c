@@ -25,9 +25,11 @@ struct GBABundledState {
 };
 
 void GBASerialize(struct GBA* gba, struct GBASerializedState* state) {
+	// Not every field and I/O register gets written, so clear them to keep states reproducible
+	memset(state, 0, offsetof(struct GBASerializedState, pram));
 	STORE_32(GBA_SAVESTATE_MAGIC + GBA_SAVESTATE_VERSION, 0, &state->versionMagic);
 	STORE_32(gba->biosChecksum, 0, &state->biosChecksum);
-	STORE_32(gba->romCrc32, 0, &state->romCrc32);
+	STORE_32(GBAGetROMCrc32(gba), 0, &state->romCrc32);
 	STORE_32(gba->timing.masterCycles, 0, &state->masterCycles);
 
 	if (gba->memory.rom) {
@@ -68,6 +70,8 @@ void GBASerialize(struct GBA* gba, struct GBASerializedState* state) {
 	}
 	STORE_32(miscFlags, 0, &state->miscFlags);
 
+	GBAudioSync(&gba->audio.psg);
+	GBAVideoSyncHblank(&gba->video);
 	GBAMemorySerialize(&gba->memory, state);
 	GBAIOSerialize(gba, state);
 	GBAVideoSerialize(&gba->video, state);
@@ -111,7 +115,7 @@ bool GBADeserialize(struct GBA* gba, const struct GBASerializedState* state) {
 		error = true;
 	}
 	LOAD_32(ucheck, 0, &state->romCrc32);
-	if (ucheck != gba->romCrc32) {
+	if (ucheck != GBAGetROMCrc32(gba)) {
 		mLOG(GBA_STATE, WARN, "Savestate is for a different version of the game");
 	}
 	LOAD_32(check, 0, &state->cpu.cycles);
@@ -199,8 +203,7 @@ bool GBADeserialize(struct GBA* gba, const struct GBASerializedState* state) {
 		gba->rr->stateLoaded(gba->rr, state);
 	}
 
-	gba->timing.reroot = gba->timing.root;
-	gba->timing.root = NULL;
+	mTimingInterrupt(&gba->timing);
 
 	return true;
 }
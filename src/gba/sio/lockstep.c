@@ -10,6 +10,7 @@
 
 #define LOCKSTEP_INCREMENT 2000
 #define LOCKSTEP_TRANSFER 512
+#define LOCKSTEP_MAX_BUDGET 280896
 
 static bool GBASIOLockstepNodeInit(struct GBASIODriver* driver);
 static void GBASIOLockstepNodeDeinit(struct GBASIODriver* driver);
@@ -30,6 +31,30 @@ void GBASIOLockstepInit(struct GBASIOLockstep* lockstep) {
 	lockstep->multiRecv[2] = 0xFFFF;
 	lockstep->multiRecv[3] = 0xFFFF;
 	lockstep->attachedMulti = 0;
+	lockstep->cycleBudget = GBA_LOCKSTEP_DEFAULT_BUDGET;
+}
+
+void GBASIOLockstepSetCycleBudget(struct GBASIOLockstep* lockstep, int32_t cycles) {
+	if (cycles < LOCKSTEP_TRANSFER) {
+		cycles = LOCKSTEP_TRANSFER;
+	} else if (cycles > LOCKSTEP_MAX_BUDGET) {
+		// Four frames; any further and the slaves visibly lag behind
+		cycles = LOCKSTEP_MAX_BUDGET;
+	}
+	lockstep->cycleBudget = cycles;
+}
+
+static void _rescheduleNow(struct GBASIOLockstepNode* node) {
+	struct mTiming* timing = &node->d.p->p->timing;
+	bool scheduled = mTimingIsScheduled(timing, &node->event);
+	int oldWhen = node->event.when;
+
+	mTimingDeschedule(timing, &node->event);
+	mTimingSchedule(timing, &node->event, 0);
+
+	if (scheduled) {
+		node->eventDiff -= oldWhen - node->event.when;
+	}
 }
 
 void GBASIOLockstepNodeCreate(struct GBASIOLockstepNode* node) {
@@ -182,16 +207,7 @@ static uint16_t GBASIOLockstepNodeMultiWriteRegister(struct GBASIODriver* driver
 				mLOG(GBA_SIO, DEBUG, "Lockstep %i: Transfer initiated", node->id);
 				ATOMIC_STORE(node->p->d.transferActive, TRANSFER_STARTING);
 				ATOMIC_STORE(node->p->d.transferCycles, GBASIOCyclesPerTransfer[node->d.p->multiplayerControl.baud][node->p->d.attached - 1]);
-
-				bool scheduled = mTimingIsScheduled(&driver->p->p->timing, &node->event);
-				int oldWhen = node->event.when;
-
-				mTimingDeschedule(&driver->p->p->timing, &node->event);
-				mTimingSchedule(&driver->p->p->timing, &node->event, 0);
-
-				if (scheduled) {
-					node->eventDiff -= oldWhen - node->event.when;
-				}
+				_rescheduleNow(node);
 			} else {
 				value &= ~0x0080;
 			}
@@ -277,7 +293,7 @@ static int32_t _masterUpdate(struct GBASIOLockstepNode* node) {
 	switch (transferActive) {
 	case TRANSFER_IDLE:
 		// If the master hasn't initiated a transfer, it can keep going.
-		node->nextEvent += LOCKSTEP_INCREMENT;
+		node->nextEvent += node->p->cycleBudget;
 		node->d.p->multiplayerControl.ready = attachedMulti == attached;
 		break;
 	case TRANSFER_STARTING:
@@ -313,7 +329,7 @@ static int32_t _masterUpdate(struct GBASIOLockstepNode* node) {
 	case TRANSFER_FINISHED:
 		// Everything's settled. We're done.
 		_finishTransfer(node);
-		node->nextEvent += LOCKSTEP_INCREMENT;
+		node->nextEvent += node->p->cycleBudget;
 		ATOMIC_STORE(node->p->d.transferActive, TRANSFER_IDLE);
 		break;
 	}
@@ -458,16 +474,18 @@ static uint16_t GBASIOLockstepNodeNormalWriteRegister(struct GBASIODriver* drive
 			driver->p->normalControl.si = 1;
 		}
 		if (value & 0x0080 && !node->id) {
-			// Internal shift clock
-			if (value & 1) {
-				ATOMIC_STORE(node->p->d.transferActive, TRANSFER_STARTING);
-			}
 			// Frequency
 			if (value & 2) {
 				node->p->d.transferCycles = GBA_ARM7TDMI_FREQUENCY / 1024;
 			} else {
 				node->p->d.transferCycles = GBA_ARM7TDMI_FREQUENCY / 8192;
 			}
+			// Internal shift clock
+			if (value & 1) {
+				ATOMIC_STORE(node->p->d.transferActive, TRANSFER_STARTING);
+				// Don't leave the transfer waiting out the rest of the budget
+				_rescheduleNow(node);
+			}
 		}
 	} else if (address == REG_SIODATA32_LO) {
 		mLOG(GBA_SIO, DEBUG, "Lockstep %i: SIODATA32_LO <- %04x", node->id, value);
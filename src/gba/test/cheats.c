@@ -9,6 +9,7 @@
 #include <mgba/core/core.h>
 #include <mgba/gba/core.h>
 #include <mgba/internal/gba/cheats.h>
+#include <mgba/internal/gba/memory.h>
 
 #include "gba/cheats/parv3.h"
 #include "gba/cheats/gameshark.h"
@@ -1051,10 +1052,43 @@ M_TEST_DEFINE(doPARv3IfButton) {
 	mCheatSetDeinit(set);
 }
 
+M_TEST_DEFINE(doPARv3Direct) {
+	struct mCore* core = *state;
+	struct mCheatDevice* device = core->cheatDevice(core);
+	assert_non_null(device);
+	struct mCheatSet* set = device->createSet(device, NULL);
+	assert_non_null(set);
+	GBACheatSetGameSharkVersion((struct GBACheatSet*) set, GBA_GS_PARV3_RAW);
+	assert_true(set->addLine(set, "00380010 00000042", GBA_CHEAT_PRO_ACTION_REPLAY));
+	assert_true(set->addLine(set, "04300104 12345678", GBA_CHEAT_PRO_ACTION_REPLAY));
+
+	core->reset(core);
+	assert_true(core->trackMemoryBlockDirty(core, REGION_WORKING_IRAM, true));
+	core->clearMemoryBlockDirty(core, REGION_WORKING_IRAM);
+	size_t pages;
+	const uint32_t* dirty = core->getMemoryBlockDirty(core, REGION_WORKING_IRAM, &pages);
+	assert_non_null(dirty);
+	assert_int_equal(dirty[0] & 7, 0);
+
+	mCheatRefresh(device, set);
+	assert_int_equal(core->rawRead8(core, 0x03000010, -1), 0x42);
+	assert_int_equal(core->rawRead32(core, 0x03000104, -1), 0x12345678);
+	assert_int_equal(dirty[0] & 7, 3);
+
+	assert_true(set->addLine(set, "02300200 00005678", GBA_CHEAT_PRO_ACTION_REPLAY));
+	mCheatRefresh(device, set);
+	assert_int_equal(core->rawRead16(core, 0x03000200, -1), 0x5678);
+	assert_int_equal(dirty[0] & 7, 7);
+
+	core->trackMemoryBlockDirty(core, REGION_WORKING_IRAM, false);
+	mCheatSetDeinit(set);
+}
+
 M_TEST_SUITE_DEFINE(GBACheats,
 	cmocka_unit_test_setup_teardown(createSet, cheatsSetup, cheatsTeardown),
 	cmocka_unit_test_setup_teardown(addRawPARv3, cheatsSetup, cheatsTeardown),
 	cmocka_unit_test_setup_teardown(doPARv3Assign, cheatsSetup, cheatsTeardown),
+	cmocka_unit_test_setup_teardown(doPARv3Direct, cheatsSetup, cheatsTeardown),
 	cmocka_unit_test_setup_teardown(doPARv3Slide1, cheatsSetup, cheatsTeardown),
 	cmocka_unit_test_setup_teardown(doPARv3Slide2, cheatsSetup, cheatsTeardown),
 	cmocka_unit_test_setup_teardown(doPARv3Slide4, cheatsSetup, cheatsTeardown),
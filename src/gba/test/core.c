@@ -7,6 +7,7 @@
 
 #include <mgba/core/core.h>
 #include <mgba/gba/core.h>
+#include <mgba/gba/interface.h>
 
 M_TEST_DEFINE(create) {
 	struct mCore* core = GBACoreCreate();
@@ -44,8 +45,46 @@ M_TEST_DEFINE(loadNullROM) {
 	core->deinit(core);
 }
 
+M_TEST_DEFINE(tiledVideoBuffer) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	color_t* buffer = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, BYTES_PER_PIXEL);
+	core->setVideoBuffer(core, buffer, GBA_VIDEO_HORIZONTAL_PIXELS);
+	assert_true(core->setVideoBufferFormat(core, mCOLOR_NATIVE | mCOLOR_TILED_4X4));
+	assert_int_equal(core->videoBufferFormat(core), mCOLOR_NATIVE | mCOLOR_TILED_4X4);
+	core->reset(core);
+
+	color_t* frame = malloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * BYTES_PER_PIXEL);
+	size_t i;
+	for (i = 0; i < GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS; ++i) {
+		frame[i] = i;
+	}
+	core->putPixels(core, frame, GBA_VIDEO_HORIZONTAL_PIXELS);
+	// The second row of the first tile comes right after its first row, then the next tile follows
+	assert_int_equal(buffer[4], frame[GBA_VIDEO_HORIZONTAL_PIXELS]);
+	assert_int_equal(buffer[16], frame[4]);
+	assert_int_equal(buffer[GBA_VIDEO_HORIZONTAL_PIXELS * 4], frame[GBA_VIDEO_HORIZONTAL_PIXELS * 4]);
+
+	const void* pixels;
+	size_t stride;
+	void* converted;
+	assert_true(mCoreGetNativePixels(core, &pixels, &stride, &converted));
+	assert_int_equal(stride, GBA_VIDEO_HORIZONTAL_PIXELS);
+	assert_memory_equal(pixels, frame, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * BYTES_PER_PIXEL);
+	free(converted);
+
+	assert_true(core->setVideoBufferFormat(core, mCOLOR_NATIVE));
+	free(frame);
+	free(buffer);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
 M_TEST_SUITE_DEFINE(GBACore,
 	cmocka_unit_test(create),
 	cmocka_unit_test(platform),
 	cmocka_unit_test(reset),
-	cmocka_unit_test(loadNullROM))
+	cmocka_unit_test(loadNullROM),
+	cmocka_unit_test(tiledVideoBuffer))
@@ -0,0 +1,250 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/renderers/observation.h>
+#include <mgba/internal/gba/renderers/video-software.h>
+
+// Draws the same frame with the software renderer and the observation renderer
+struct ObservationScene {
+	uint16_t palette[SIZE_PALETTE_RAM / 2];
+	uint16_t vram[SIZE_VRAM / 2];
+	union GBAOAM oam;
+	struct GBAVideoSoftwareRenderer software;
+	struct GBAVideoObservationRenderer observation;
+	color_t frame[GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS];
+	uint16_t samples[GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS];
+};
+
+static void _attach(struct ObservationScene* scene, struct GBAVideoRenderer* renderer) {
+	renderer->palette = scene->palette;
+	renderer->vram = scene->vram;
+	renderer->oam = &scene->oam;
+	renderer->cache = NULL;
+	renderer->init(renderer);
+}
+
+static struct ObservationScene* _createScene(void) {
+	struct ObservationScene* scene = calloc(1, sizeof(*scene));
+	uint32_t seed = 0x1234567;
+	size_t i;
+	for (i = 0; i < SIZE_PALETTE_RAM / 2; ++i) {
+		scene->palette[i] = (i * 0x1357) & 0x7FFF;
+	}
+	// Sparse pixel data, so that layers underneath show through
+	for (i = 0; i < SIZE_VRAM / 2; ++i) {
+		seed = seed * 1103515245 + 12345;
+		scene->vram[i] = (seed >> 16) & ((seed & 0x100) ? 0xF0F0 : 0x0F00);
+	}
+	for (i = 0; i < 128; ++i) {
+		scene->oam.obj[i].a = 0x0200;
+	}
+	GBAVideoSoftwareRendererCreate(&scene->software);
+	scene->software.outputBuffer = scene->frame;
+	scene->software.outputBufferStride = GBA_VIDEO_HORIZONTAL_PIXELS;
+	_attach(scene, &scene->software.d);
+	GBAVideoObservationRendererCreate(&scene->observation);
+	scene->observation.format = GBA_OBSERVATION_PALETTE_INDEX;
+	scene->observation.pixels = scene->samples;
+	scene->observation.stride = GBA_VIDEO_HORIZONTAL_PIXELS;
+	_attach(scene, &scene->observation.d);
+	return scene;
+}
+
+static void _destroyScene(struct ObservationScene* scene) {
+	scene->software.d.deinit(&scene->software.d);
+	scene->observation.d.deinit(&scene->observation.d);
+	free(scene);
+}
+
+static void _writeRegister(struct ObservationScene* scene, uint32_t address, uint16_t value) {
+	scene->software.d.writeVideoRegister(&scene->software.d, address, value);
+	scene->observation.d.writeVideoRegister(&scene->observation.d, address, value);
+}
+
+static void _setMap(struct ObservationScene* scene, uint32_t screenBase, uint16_t mask) {
+	size_t i;
+	for (i = 0; i < 0x400; ++i) {
+		scene->vram[(screenBase >> 1) + i] = (i * 0x2B7) & mask;
+	}
+}
+
+static void _draw(struct ObservationScene* scene) {
+	size_t i;
+	for (i = 0; i < SIZE_PALETTE_RAM; i += 2) {
+		scene->software.d.writePalette(&scene->software.d, i, scene->palette[i >> 1]);
+		scene->observation.d.writePalette(&scene->observation.d, i, scene->palette[i >> 1]);
+	}
+	for (i = 0; i < SIZE_VRAM; i += 2) {
+		scene->software.d.writeVRAM(&scene->software.d, i);
+		scene->observation.d.writeVRAM(&scene->observation.d, i);
+	}
+	for (i = 0; i < SIZE_OAM / 2; ++i) {
+		scene->software.d.writeOAM(&scene->software.d, i);
+		scene->observation.d.writeOAM(&scene->observation.d, i);
+	}
+	int y;
+	for (y = 0; y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+		scene->software.d.drawScanline(&scene->software.d, y);
+		scene->observation.d.drawScanline(&scene->observation.d, y);
+	}
+	scene->software.d.finishFrame(&scene->software.d);
+	scene->observation.d.finishFrame(&scene->observation.d);
+}
+
+static void _assertMatches(struct ObservationScene* scene) {
+	unsigned scale = scene->observation.scale;
+	unsigned x, y;
+	for (y = 0; y < GBAVideoObservationHeight(&scene->observation); ++y) {
+		for (x = 0; x < GBAVideoObservationWidth(&scene->observation); ++x) {
+			uint16_t sample = scene->samples[y * scene->observation.stride + x];
+			uint16_t color = sample & GBA_OBSERVATION_DIRECT_COLOR ? sample & 0x7FFF : scene->palette[sample];
+			color_t pixel = scene->frame[y * scale * GBA_VIDEO_HORIZONTAL_PIXELS + x * scale];
+#ifndef COLOR_16_BIT
+			// The top byte isn't part of the color
+			pixel &= 0x00FFFFFF;
+#endif
+			assert_int_equal(mColorFrom555(color), pixel);
+		}
+	}
+}
+
+static void _setSprites(struct ObservationScene* scene) {
+	// A plain sprite in front of everything...
+	scene->oam.obj[0].a = 30 | (OBJ_SHAPE_SQUARE << 14);
+	scene->oam.obj[0].b = 20 | (1 << 14) | (1 << 12);
+	scene->oam.obj[0].c = 4 | (0 << 10) | (3 << 12);
+	// ...and a rotated, double-sized 256-color one behind the first background
+	scene->oam.obj[1].a = 50 | 0x0300 | 0x2000;
+	scene->oam.obj[1].b = 100 | (2 << 14) | (1 << 9);
+	scene->oam.obj[1].c = 64 | (2 << 10);
+	scene->oam.mat[1].a = 0xB5;
+	scene->oam.mat[1].b = -0xB5;
+	scene->oam.mat[1].c = 0xB5;
+	scene->oam.mat[1].d = 0xB5;
+	// Wrapping around from the bottom of the screen
+	scene->oam.obj[2].a = 250 | (OBJ_SHAPE_HORIZONTAL << 14);
+	scene->oam.obj[2].b = 200 | (1 << 14);
+	scene->oam.obj[2].c = 96 | (1 << 10) | (5 << 12);
+}
+
+M_TEST_DEFINE(textMode) {
+	struct ObservationScene* scene = _createScene();
+	_setMap(scene, 0xF800, 0xFFFF);
+	_setMap(scene, 0xF000, 0x03FF);
+	_setSprites(scene);
+	_writeRegister(scene, REG_BG0CNT, 1 | (31 << 8));
+	_writeRegister(scene, REG_BG1CNT, 0 | (1 << 2) | 0x80 | (30 << 8));
+	_writeRegister(scene, REG_BG0HOFS, 13);
+	_writeRegister(scene, REG_BG0VOFS, 301);
+	_writeRegister(scene, REG_BG1HOFS, 77);
+	_writeRegister(scene, REG_DISPCNT, 0x1300 | 0x40);
+	_draw(scene);
+	_assertMatches(scene);
+	_destroyScene(scene);
+}
+
+M_TEST_DEFINE(affineMode) {
+	struct ObservationScene* scene = _createScene();
+	_setMap(scene, 0xF800, 0xFFFF);
+	_setMap(scene, 0xE000, 0xFFFF);
+	_setSprites(scene);
+	_writeRegister(scene, REG_BG0CNT, 2 | (31 << 8));
+	_writeRegister(scene, REG_BG2CNT, 1 | (1 << 2) | (28 << 8) | (1 << 14) | 0x2000);
+	_writeRegister(scene, REG_BG2PA, 0xE0);
+	_writeRegister(scene, REG_BG2PB, 0x40);
+	_writeRegister(scene, REG_BG2PC, -0x40);
+	_writeRegister(scene, REG_BG2PD, 0xE0);
+	_writeRegister(scene, REG_BG2X_LO, 0x1234);
+	_writeRegister(scene, REG_BG2X_HI, 0xFFFF);
+	_writeRegister(scene, REG_BG2Y_LO, 0x5678);
+	_writeRegister(scene, REG_DISPCNT, 0x1500 | 1);
+	_draw(scene);
+	_assertMatches(scene);
+	_destroyScene(scene);
+}
+
+M_TEST_DEFINE(bitmapMode) {
+	struct ObservationScene* scene = _createScene();
+	_setSprites(scene);
+	// Only the upper half of sprite VRAM is left in bitmap modes
+	scene->oam.obj[1].c = 576;
+	_writeRegister(scene, REG_BG2CNT, 1);
+	_writeRegister(scene, REG_BG2PA, 0x100);
+	_writeRegister(scene, REG_BG2PD, 0x100);
+	_writeRegister(scene, REG_DISPCNT, 0x1400 | 3);
+	_draw(scene);
+	_assertMatches(scene);
+
+	_writeRegister(scene, REG_DISPCNT, 0x1400 | 0x10 | 4);
+	_draw(scene);
+	_assertMatches(scene);
+	_destroyScene(scene);
+}
+
+M_TEST_DEFINE(downscaledGray) {
+	struct ObservationScene* scene = _createScene();
+	_setMap(scene, 0xF800, 0xFFFF);
+	_setSprites(scene);
+	_writeRegister(scene, REG_BG0CNT, 1 | (31 << 8));
+	_writeRegister(scene, REG_DISPCNT, 0x1100);
+	scene->observation.scale = 4;
+	scene->observation.stride = 60;
+	_draw(scene);
+	assert_int_equal(GBAVideoObservationWidth(&scene->observation), 60);
+	assert_int_equal(GBAVideoObservationHeight(&scene->observation), 40);
+	_assertMatches(scene);
+
+	uint8_t gray[60 * 40];
+	scene->observation.format = GBA_OBSERVATION_GRAY8;
+	scene->observation.pixels = gray;
+	_draw(scene);
+	unsigned i;
+	for (i = 0; i < sizeof(gray); ++i) {
+		uint16_t color = scene->palette[scene->samples[i]];
+		unsigned r = (color & 0x1F) * 0x21 >> 2;
+		unsigned g = ((color >> 5) & 0x1F) * 0x21 >> 2;
+		unsigned b = ((color >> 10) & 0x1F) * 0x21 >> 2;
+		assert_int_equal(gray[i], (r * 77 + g * 150 + b * 29) >> 8);
+	}
+	_destroyScene(scene);
+}
+
+M_TEST_DEFINE(tilemaps) {
+	struct ObservationScene* scene = _createScene();
+	uint16_t maps[4][GBA_OBSERVATION_TILEMAP_WIDTH * GBA_OBSERVATION_TILEMAP_HEIGHT];
+	int i;
+	for (i = 0; i < 4; ++i) {
+		scene->observation.tilemaps[i] = maps[i];
+	}
+	_setMap(scene, 0xF800, 0xFFFF);
+	_setMap(scene, 0xE000, 0xFFFF);
+	_writeRegister(scene, REG_BG0CNT, 31 << 8);
+	_writeRegister(scene, REG_BG0HOFS, 16);
+	_writeRegister(scene, REG_BG0VOFS, 8);
+	_writeRegister(scene, REG_BG2CNT, 28 << 8);
+	_writeRegister(scene, REG_DISPCNT, 0x0500 | 1);
+	_draw(scene);
+	assert_int_equal(scene->observation.tilemapLayers, 0x5);
+	assert_int_equal(maps[0][0], scene->vram[(0xF800 >> 1) + 32 + 2]);
+	assert_int_equal(maps[0][GBA_OBSERVATION_TILEMAP_WIDTH + 29], scene->vram[(0xF800 >> 1) + 64 + 31]);
+	// A 128x128 affine map without wraparound runs out partway across
+	assert_int_equal(maps[2][GBA_OBSERVATION_TILEMAP_WIDTH + 3], ((uint8_t*) scene->vram)[0xE000 + 16 + 3]);
+	assert_int_equal(maps[2][16], 0xFFFF);
+
+	_writeRegister(scene, REG_DISPCNT, 0x0400 | 3);
+	_draw(scene);
+	assert_int_equal(scene->observation.tilemapLayers, 0);
+	_destroyScene(scene);
+}
+
+M_TEST_SUITE_DEFINE(GBAVideoObservation,
+	cmocka_unit_test(textMode),
+	cmocka_unit_test(affineMode),
+	cmocka_unit_test(bitmapMode),
+	cmocka_unit_test(downscaledGray),
+	cmocka_unit_test(tilemaps))
@@ -10,9 +10,30 @@
 
 #define TIMER_RELOAD_DELAY 0
 #define TIMER_STARTUP_DELAY 2
+// Aligned to the largest prescaler, and well short of where relative times wrap around
+#define TIMER_LAZY_INTERVAL 0x8000000
 
 #define REG_TMCNT_LO(X) (REG_TM0CNT_LO + ((X) << 2))
 
+static bool _timerNeedsEvents(struct GBA* gba, int timerId) {
+	struct GBATimer* timer = &gba->timers[timerId];
+	if (GBATimerFlagsIsDoIrq(timer->flags)) {
+		return true;
+	}
+	if (timerId < 3 && GBATimerFlagsIsCountUp(gba->timers[timerId + 1].flags)) {
+		return true;
+	}
+	if (gba->audio.enable && timerId < 2) {
+		if ((gba->audio.chALeft || gba->audio.chARight) && gba->audio.chATimer == timerId) {
+			return true;
+		}
+		if ((gba->audio.chBLeft || gba->audio.chBRight) && gba->audio.chBTimer == timerId) {
+			return true;
+		}
+	}
+	return false;
+}
+
 static void GBATimerUpdate(struct GBA* gba, int timerId, uint32_t cyclesLate) {
 	struct GBATimer* timer = &gba->timers[timerId];
 	if (GBATimerFlagsIsCountUp(timer->flags)) {
@@ -103,14 +124,21 @@ void GBATimerUpdateRegister(struct GBA* gba, int timer, int32_t cyclesLate) {
 	currentTimer->lastEvent = currentTime;
 	tickIncrement >>= prescaleBits;
 	tickIncrement += gba->memory.io[REG_TMCNT_LO(timer) >> 1];
-	while (tickIncrement >= 0x10000) {
-		tickIncrement -= 0x10000 - currentTimer->reload;
+	if (tickIncrement >= 0x10000) {
+		// A lazily updated timer may have overflowed many times since it was last read
+		tickIncrement = currentTimer->reload + (tickIncrement - 0x10000) % (0x10000 - currentTimer->reload);
 	}
 	gba->memory.io[REG_TMCNT_LO(timer) >> 1] = tickIncrement;
 
 	// Schedule next update
-	tickIncrement = (0x10000 - tickIncrement) << prescaleBits;
-	currentTime += tickIncrement;
+	if (_timerNeedsEvents(gba, timer)) {
+		tickIncrement = (0x10000 - tickIncrement) << prescaleBits;
+		currentTime += tickIncrement;
+	} else {
+		// Nothing observes the overflows, so the counter only needs to be caught up when it's read.
+		// It still gets an occasional event so that lastEvent never falls too far behind.
+		currentTime += TIMER_LAZY_INTERVAL;
+	}
 	currentTime &= ~tickMask;
 	currentTime -= mTimingCurrentTime(&gba->timing);
 	mTimingDeschedule(&gba->timing, &currentTimer->event);
@@ -118,9 +146,20 @@ void GBATimerUpdateRegister(struct GBA* gba, int timer, int32_t cyclesLate) {
 }
 
 void GBATimerWriteTMCNT_LO(struct GBA* gba, int timer, uint16_t reload) {
+	if (!_timerNeedsEvents(gba, timer)) {
+		// Overflows that a lazy timer hasn't accounted for yet still used the old reload value
+		GBATimerUpdateRegister(gba, timer, 0);
+	}
 	gba->timers[timer].reload = reload;
 }
 
+void GBATimerUpdateScheduling(struct GBA* gba) {
+	int i;
+	for (i = 0; i < 4; ++i) {
+		GBATimerUpdateRegister(gba, i, 0);
+	}
+}
+
 void GBATimerWriteTMCNT_HI(struct GBA* gba, int timer, uint16_t control) {
 	struct GBATimer* currentTimer = &gba->timers[timer];
 	GBATimerUpdateRegister(gba, timer, 0);
@@ -141,6 +180,7 @@ void GBATimerWriteTMCNT_HI(struct GBA* gba, int timer, uint16_t control) {
 		prescaleBits = 10;
 		break;
 	}
+	bool wasCountUp = GBATimerFlagsIsCountUp(currentTimer->flags);
 	currentTimer->flags = GBATimerFlagsSetPrescaleBits(currentTimer->flags, prescaleBits);
 	currentTimer->flags = GBATimerFlagsTestFillCountUp(currentTimer->flags, timer > 0 && (control & 0x0004));
 	currentTimer->flags = GBATimerFlagsTestFillDoIrq(currentTimer->flags, control & 0x0040);
@@ -159,5 +199,12 @@ void GBATimerWriteTMCNT_HI(struct GBA* gba, int timer, uint16_t control) {
 		int32_t tickMask = (1 << prescaleBits) - 1;
 		currentTimer->lastEvent = (mTimingCurrentTime(&gba->timing) - TIMER_STARTUP_DELAY) & ~tickMask;
 		GBATimerUpdateRegister(gba, timer, TIMER_STARTUP_DELAY);
+	} else {
+		// Enabling the IRQ may mean this timer's overflows need events again
+		GBATimerUpdateRegister(gba, timer, 0);
+	}
+	if (timer > 0 && wasCountUp != GBATimerFlagsIsCountUp(currentTimer->flags)) {
+		// The previous timer only needs to schedule overflows while this one counts them
+		GBATimerUpdateRegister(gba, timer - 1, 0);
 	}
 }
@@ -41,16 +41,19 @@ static uint32_t _patternRightShift2(uint32_t addr);
 static int8_t _modifySramValue(enum GBAVFameCartType type, uint8_t value, int mode);
 static uint32_t _modifySramAddress(enum GBAVFameCartType type, uint32_t address, int mode);
 static int _reorderBits(uint32_t value, const uint8_t* reordering, int reorderLength);
+static void _updateSramTables(struct GBAVFameCart* cart);
 
 void GBAVFameInit(struct GBAVFameCart* cart) {
 	cart->cartType = VFAME_NO;
 	cart->sramMode = -1;
 	cart->romMode = -1;
 	cart->acceptingModeChange = false;
+	cart->tableMode = -1;
 }
 
 void GBAVFameDetect(struct GBAVFameCart* cart, uint32_t* rom, size_t romSize) {
 	cart->cartType = VFAME_NO;
+	cart->tableMode = -1;
 
 	// The initialisation code is also present & run in the dumps of Digimon Ruby & Sapphire from hacked/deprotected reprint carts,
 	// which would break if run in "proper" VFame mode so we need to exclude those..
@@ -244,10 +247,22 @@ void GBAVFameSramWrite(struct GBAVFameCart* cart, uint32_t address, uint8_t valu
 	}
 
 	// if mode has been set - the address and value of the SRAM write will be modified
-	address = _modifySramAddress(cart->cartType, address, cart->sramMode);
-	value = _modifySramValue(cart->cartType, value, cart->sramMode);
-	address &= (SIZE_CART_SRAM - 1);
-	sramData[address] = value;
+	if (cart->tableMode != cart->sramMode) {
+		_updateSramTables(cart);
+	}
+	address = cart->sramAddressLow[address & 0xFF] | cart->sramAddressHigh[(address >> 8) & 0xFF];
+	sramData[address & (SIZE_CART_SRAM - 1)] = cart->sramValue[value];
+}
+
+// The address scrambling only moves bits around, so each byte of the address can be looked up separately
+static void _updateSramTables(struct GBAVFameCart* cart) {
+	int i;
+	for (i = 0; i < 256; ++i) {
+		cart->sramAddressLow[i] = _modifySramAddress(cart->cartType, i, cart->sramMode);
+		cart->sramAddressHigh[i] = _modifySramAddress(cart->cartType, i << 8, cart->sramMode);
+		cart->sramValue[i] = _modifySramValue(cart->cartType, i, cart->sramMode);
+	}
+	cart->tableMode = cart->sramMode;
 }
 
 static uint32_t _modifySramAddress(enum GBAVFameCartType type, uint32_t address, int mode) {
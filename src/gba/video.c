@@ -14,7 +14,6 @@
 #include <mgba/internal/gba/renderers/cache-set.h>
 #include <mgba/internal/gba/serialize.h>
 
-#include <mgba-util/memory.h>
 
 mLOG_DEFINE_CATEGORY(GBA_VIDEO, "GBA Video", "gba.video");
 
@@ -69,8 +68,9 @@ static struct GBAVideoRenderer dummyRenderer = {
 void GBAVideoInit(struct GBAVideo* video) {
 	video->renderer = &dummyRenderer;
 	video->renderer->cache = NULL;
-	video->vram = anonymousMemoryMap(SIZE_VRAM);
+	// VRAM is carved out of the memory arena by GBAMemoryInit
 	video->frameskip = 0;
+	video->suppressOutput = false;
 	video->event.name = "GBA Video";
 	video->event.callback = NULL;
 	video->event.context = video;
@@ -95,6 +95,7 @@ void GBAVideoReset(struct GBAVideo* video) {
 	video->frameskipCounter = 0;
 	video->renderer->vram = video->vram;
 
+	memset(video->vram, 0, SIZE_VRAM);
 	memset(video->palette, 0, sizeof(video->palette));
 	memset(video->oam.raw, 0, sizeof(video->oam.raw));
 
@@ -103,7 +104,6 @@ void GBAVideoReset(struct GBAVideo* video) {
 
 void GBAVideoDeinit(struct GBAVideo* video) {
 	video->renderer->deinit(video->renderer);
-	mappedMemoryFree(video->vram, SIZE_VRAM);
 }
 
 void GBAVideoAssociateRenderer(struct GBAVideo* video, struct GBAVideoRenderer* renderer) {
@@ -116,12 +116,34 @@ void GBAVideoAssociateRenderer(struct GBAVideo* video, struct GBAVideoRenderer*
 	video->renderer->init(video->renderer);
 }
 
+static bool _isHblankObserved(const struct GBAVideo* video, GBARegisterDISPSTAT dispstat) {
+	if (GBARegisterDISPSTATIsHblankIRQ(dispstat)) {
+		return true;
+	}
+	const struct GBAMemory* memory = &video->p->memory;
+	if (video->vcount < GBA_VIDEO_VERTICAL_PIXELS) {
+		if (video->frameskipCounter <= 0) {
+			return true;
+		}
+		int i;
+		for (i = 0; i < 4; ++i) {
+			if (GBADMARegisterIsEnable(memory->dma[i].reg) && GBADMARegisterGetTiming(memory->dma[i].reg) == GBA_DMA_TIMING_HBLANK) {
+				return true;
+			}
+		}
+	}
+	if (video->vcount >= 2 && video->vcount < GBA_VIDEO_VERTICAL_PIXELS + 2) {
+		if (GBADMARegisterIsEnable(memory->dma[3].reg) && GBADMARegisterGetTiming(memory->dma[3].reg) == GBA_DMA_TIMING_CUSTOM) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void _startHdraw(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	struct GBAVideo* video = context;
 	GBARegisterDISPSTAT dispstat = video->p->memory.io[REG_DISPSTAT >> 1];
 	dispstat = GBARegisterDISPSTATClearInHblank(dispstat);
-	video->event.callback = _startHblank;
-	mTimingSchedule(timing, &video->event, VIDEO_HDRAW_LENGTH - cyclesLate);
 
 	++video->vcount;
 	if (video->vcount == VIDEO_VERTICAL_TOTAL_PIXELS) {
@@ -129,6 +151,15 @@ void _startHdraw(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	}
 	video->p->memory.io[REG_VCOUNT >> 1] = video->vcount;
 
+	if (_isHblankObserved(video, dispstat)) {
+		video->event.callback = _startHblank;
+		mTimingSchedule(timing, &video->event, VIDEO_HDRAW_LENGTH - cyclesLate);
+	} else {
+		// Go straight to the next line; the InHblank flag is filled in if DISPSTAT is read
+		video->event.callback = _startHdraw;
+		mTimingSchedule(timing, &video->event, VIDEO_HORIZONTAL_LENGTH - cyclesLate);
+	}
+
 	if (video->vcount == GBARegisterDISPSTATGetVcountSetting(dispstat)) {
 		dispstat = GBARegisterDISPSTATFillVcounter(dispstat);
 		if (GBARegisterDISPSTATIsVcounterIRQ(dispstat)) {
@@ -154,11 +185,16 @@ void _startHdraw(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 			GBARaiseIRQ(video->p, IRQ_VBLANK, cyclesLate);
 		}
 		GBAFrameEnded(video->p);
-		mCoreSyncPostFrame(video->p->sync);
+		if (!video->suppressOutput) {
+			mCoreSyncPostFrame(video->p->sync);
+		}
 		--video->frameskipCounter;
 		if (video->frameskipCounter < 0) {
 			video->frameskipCounter = video->frameskip;
 		}
+		if (video->suppressOutput && video->frameskipCounter <= 0) {
+			video->frameskipCounter = 1;
+		}
 		++video->frameCounter;
 		break;
 	case VIDEO_VERTICAL_TOTAL_PIXELS - 1:
@@ -192,7 +228,22 @@ void _startHblank(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	video->p->memory.io[REG_DISPSTAT >> 1] = dispstat;
 }
 
+void GBAVideoSyncHblank(struct GBAVideo* video) {
+	GBARegisterDISPSTAT dispstat = video->p->memory.io[REG_DISPSTAT >> 1];
+	if (video->event.callback != _startHdraw || GBARegisterDISPSTATIsInHblank(dispstat)) {
+		return;
+	}
+	int32_t until = mTimingUntil(&video->p->timing, &video->event);
+	if (until > VIDEO_HBLANK_LENGTH) {
+		video->event.callback = _startHblank;
+		mTimingSchedule(&video->p->timing, &video->event, until - VIDEO_HBLANK_LENGTH);
+	} else {
+		video->p->memory.io[REG_DISPSTAT >> 1] = GBARegisterDISPSTATFillInHblank(dispstat);
+	}
+}
+
 void GBAVideoWriteDISPSTAT(struct GBAVideo* video, uint16_t value) {
+	GBAVideoSyncHblank(video);
 	video->p->memory.io[REG_DISPSTAT >> 1] &= 0x7;
 	video->p->memory.io[REG_DISPSTAT >> 1] |= value;
 	// TODO: Does a VCounter IRQ trigger on write?
@@ -307,16 +358,44 @@ void GBAVideoSerialize(const struct GBAVideo* video, struct GBASerializedState*
 }
 
 void GBAVideoDeserialize(struct GBAVideo* video, const struct GBASerializedState* state) {
-	memcpy(video->vram, state->vram, SIZE_VRAM);
+	// Only what differs from the live state is written, so renderer caches and dirty pages
+	// are invalidated just for the parts of VRAM, OAM and palette that actually changed
+	struct mCoreMemoryDirty* dirty = &video->p->memory.dirtyPages[REGION_VRAM];
 	uint16_t value;
+	uint16_t live;
 	int i;
+	for (i = 0; i < SIZE_VRAM; i += mCORE_MEMORY_DIRTY_PAGE_SIZE) {
+		if (!memcmp((uint8_t*) video->vram + i, &state->vram[i >> 1], mCORE_MEMORY_DIRTY_PAGE_SIZE)) {
+			continue;
+		}
+		mCoreMemoryDirtyMark(dirty, i);
+		if (!video->renderer->cache) {
+			// Renderers track VRAM at page granularity or coarser, so one notification is enough
+			memcpy((uint8_t*) video->vram + i, &state->vram[i >> 1], mCORE_MEMORY_DIRTY_PAGE_SIZE);
+			video->renderer->writeVRAM(video->renderer, i);
+			continue;
+		}
+		int j;
+		for (j = i; j < i + mCORE_MEMORY_DIRTY_PAGE_SIZE; j += 2) {
+			if (video->vram[j >> 1] != state->vram[j >> 1]) {
+				video->vram[j >> 1] = state->vram[j >> 1];
+				video->renderer->writeVRAM(video->renderer, j);
+			}
+		}
+	}
 	for (i = 0; i < SIZE_OAM; i += 2) {
 		LOAD_16(value, i, state->oam);
-		GBAStore16(video->p->cpu, BASE_OAM | i, value, 0);
+		LOAD_16(live, i, video->oam.raw);
+		if (value != live) {
+			GBAStore16(video->p->cpu, BASE_OAM | i, value, 0);
+		}
 	}
 	for (i = 0; i < SIZE_PALETTE_RAM; i += 2) {
 		LOAD_16(value, i, state->pram);
-		GBAStore16(video->p->cpu, BASE_PALETTE_RAM | i, value, 0);
+		LOAD_16(live, i, video->palette);
+		if (value != live) {
+			GBAStore16(video->p->cpu, BASE_PALETTE_RAM | i, value, 0);
+		}
 	}
 	LOAD_32(video->frameCounter, 0, &state->video.frameCounter);
 
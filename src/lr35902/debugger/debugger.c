@@ -7,22 +7,25 @@
 
 #include <mgba/core/core.h>
 #include <mgba/internal/debugger/parser.h>
+#include <mgba/internal/debugger/trace.h>
 #include <mgba/internal/lr35902/decoder.h>
 #include <mgba/internal/lr35902/lr35902.h>
 #include <mgba/internal/lr35902/debugger/memory-debugger.h>
 
-static struct mBreakpoint* _lookupBreakpoint(struct mBreakpointList* breakpoints, struct LR35902Core* cpu) {
-	size_t i;
-	for (i = 0; i < mBreakpointListSize(breakpoints); ++i) {
-		struct mBreakpoint* breakpoint = mBreakpointListGetPointer(breakpoints, i);
-		if (breakpoint->address != cpu->pc) {
-			continue;
-		}
-		if (breakpoint->segment < 0 || breakpoint->segment == cpu->memory.currentSegment(cpu, breakpoint->address)) {
-			return breakpoint;
-		}
+#define BREAKPOINT_TABLE_SIZE 512
+
+static void _addBreakpointAddress(struct Table* addresses, uint32_t address) {
+	intptr_t count = (intptr_t) TableLookup(addresses, address);
+	TableInsert(addresses, address, (void*) (count + 1));
+}
+
+static void _removeBreakpointAddress(struct Table* addresses, uint32_t address) {
+	intptr_t count = (intptr_t) TableLookup(addresses, address);
+	if (count > 1) {
+		TableInsert(addresses, address, (void*) (count - 1));
+	} else {
+		TableRemove(addresses, address);
 	}
-	return NULL;
 }
 
 static void _destroyBreakpoint(struct mBreakpoint* breakpoint) {
@@ -41,21 +44,32 @@ static void _destroyWatchpoint(struct mWatchpoint* watchpoint) {
 
 static void LR35902DebuggerCheckBreakpoints(struct mDebuggerPlatform* d) {
 	struct LR35902Debugger* debugger = (struct LR35902Debugger*) d;
-	struct mBreakpoint* breakpoint = _lookupBreakpoint(&debugger->breakpoints, debugger->cpu);
-	if (!breakpoint) {
+	struct LR35902Core* cpu = debugger->cpu;
+	if (!TableLookup(&debugger->breakpointAddresses, cpu->pc)) {
 		return;
 	}
-	if (breakpoint->condition) {
-		int32_t value;
-		int segment;
-		if (!mDebuggerEvaluateParseTree(d->p, breakpoint->condition, &value, &segment) || !(value || segment >= 0)) {
-			return;
+	size_t i;
+	for (i = 0; i < mBreakpointListSize(&debugger->breakpoints); ++i) {
+		struct mBreakpoint* breakpoint = mBreakpointListGetPointer(&debugger->breakpoints, i);
+		if (breakpoint->address != cpu->pc) {
+			continue;
+		}
+		if (breakpoint->segment >= 0 && breakpoint->segment != cpu->memory.currentSegment(cpu, breakpoint->address)) {
+			continue;
+		}
+		if (breakpoint->condition) {
+			int32_t value;
+			int segment;
+			if (!mDebuggerEvaluateParseTree(d->p, breakpoint->condition, &value, &segment) || !(value || segment >= 0)) {
+				continue;
+			}
 		}
+		struct mDebuggerEntryInfo info = {
+			.address = breakpoint->address
+		};
+		mDebuggerEnter(d->p, DEBUGGER_ENTER_BREAKPOINT, &info);
+		return;
 	}
-	struct mDebuggerEntryInfo info = {
-		.address = breakpoint->address
-	};
-	mDebuggerEnter(d->p, DEBUGGER_ENTER_BREAKPOINT, &info);
 }
 
 static void LR35902DebuggerInit(void* cpu, struct mDebuggerPlatform* platform);
@@ -71,6 +85,9 @@ static void LR35902DebuggerListWatchpoints(struct mDebuggerPlatform*, struct mWa
 static void LR35902DebuggerCheckBreakpoints(struct mDebuggerPlatform*);
 static bool LR35902DebuggerHasBreakpoints(struct mDebuggerPlatform*);
 static void LR35902DebuggerTrace(struct mDebuggerPlatform*, char* out, size_t* length);
+static void LR35902DebuggerTraceInstruction(struct mDebuggerPlatform*, struct mDebuggerTraceRecord* out);
+static void LR35902DebuggerTraceAccesses(struct mDebuggerPlatform*, bool enable);
+static bool LR35902DebuggerGetCallFrame(struct mDebuggerPlatform*, uint32_t* pc, int* segment, uint32_t* returnAddress);
 static bool LR35902DebuggerGetRegister(struct mDebuggerPlatform*, const char* name, int32_t* value);
 static bool LR35902DebuggerSetRegister(struct mDebuggerPlatform*, const char* name, int32_t value);
 
@@ -87,6 +104,9 @@ struct mDebuggerPlatform* LR35902DebuggerPlatformCreate(void) {
 	platform->d.checkBreakpoints = LR35902DebuggerCheckBreakpoints;
 	platform->d.hasBreakpoints = LR35902DebuggerHasBreakpoints;
 	platform->d.trace = LR35902DebuggerTrace;
+	platform->d.traceInstruction = LR35902DebuggerTraceInstruction;
+	platform->d.traceAccesses = LR35902DebuggerTraceAccesses;
+	platform->d.getCallFrame = LR35902DebuggerGetCallFrame;
 	platform->d.getRegister = LR35902DebuggerGetRegister;
 	platform->d.setRegister = LR35902DebuggerSetRegister;
 	platform->printStatus = NULL;
@@ -98,8 +118,10 @@ void LR35902DebuggerInit(void* cpu, struct mDebuggerPlatform* platform) {
 	debugger->cpu = cpu;
 	debugger->originalMemory = debugger->cpu->memory;
 	mBreakpointListInit(&debugger->breakpoints, 0);
+	TableInit(&debugger->breakpointAddresses, BREAKPOINT_TABLE_SIZE, NULL);
 	mWatchpointListInit(&debugger->watchpoints, 0);
 	debugger->nextId = 1;
+	debugger->tracingAccesses = false;
 }
 
 void LR35902DebuggerDeinit(struct mDebuggerPlatform* platform) {
@@ -109,6 +131,7 @@ void LR35902DebuggerDeinit(struct mDebuggerPlatform* platform) {
 		_destroyBreakpoint(mBreakpointListGetPointer(&debugger->breakpoints, i));
 	}
 	mBreakpointListDeinit(&debugger->breakpoints);
+	TableDeinit(&debugger->breakpointAddresses);
 
 	for (i = 0; i < mWatchpointListSize(&debugger->watchpoints); ++i) {
 		_destroyWatchpoint(mWatchpointListGetPointer(&debugger->watchpoints, i));
@@ -134,6 +157,7 @@ static ssize_t LR35902DebuggerSetBreakpoint(struct mDebuggerPlatform* d, const s
 	*breakpoint = *info;
 	breakpoint->id = debugger->nextId;
 	++debugger->nextId;
+	_addBreakpointAddress(&debugger->breakpointAddresses, breakpoint->address);
 	return breakpoint->id;
 
 }
@@ -146,6 +170,7 @@ static bool LR35902DebuggerClearBreakpoint(struct mDebuggerPlatform* d, ssize_t
 	for (i = 0; i < mBreakpointListSize(breakpoints); ++i) {
 		struct mBreakpoint* breakpoint = mBreakpointListGetPointer(breakpoints, i);
 		if (breakpoint->id == id) {
+			_removeBreakpointAddress(&debugger->breakpointAddresses, breakpoint->address);
 			_destroyBreakpoint(breakpoint);
 			mBreakpointListShift(breakpoints, i, 1);
 			return true;
@@ -158,7 +183,7 @@ static bool LR35902DebuggerClearBreakpoint(struct mDebuggerPlatform* d, ssize_t
 		if (watchpoint->id == id) {
 			_destroyWatchpoint(watchpoint);
 			mWatchpointListShift(watchpoints, i, 1);
-			if (!mWatchpointListSize(&debugger->watchpoints)) {
+			if (!mWatchpointListSize(&debugger->watchpoints) && !debugger->tracingAccesses) {
 				LR35902DebuggerRemoveMemoryShim(debugger);
 			}
 			return true;
@@ -174,13 +199,16 @@ static bool LR35902DebuggerHasBreakpoints(struct mDebuggerPlatform* d) {
 
 static ssize_t LR35902DebuggerSetWatchpoint(struct mDebuggerPlatform* d, const struct mWatchpoint* info) {
 	struct LR35902Debugger* debugger = (struct LR35902Debugger*) d;
-	if (!mWatchpointListSize(&debugger->watchpoints)) {
+	if (!mWatchpointListSize(&debugger->watchpoints) && !debugger->tracingAccesses) {
 		LR35902DebuggerInstallMemoryShim(debugger);
 	}
 	struct mWatchpoint* watchpoint = mWatchpointListAppend(&debugger->watchpoints);
 	*watchpoint = *info;
 	watchpoint->id = debugger->nextId;
 	++debugger->nextId;
+	if (!watchpoint->size) {
+		watchpoint->size = 1;
+	}
 	return watchpoint->id;
 }
 
@@ -224,6 +252,55 @@ static void LR35902DebuggerTrace(struct mDebuggerPlatform* d, char* out, size_t*
 		               cpu->sp, cpu->memory.currentSegment(cpu, cpu->pc), cpu->pc, disassembly);
 }
 
+static void LR35902DebuggerTraceInstruction(struct mDebuggerPlatform* d, struct mDebuggerTraceRecord* out) {
+	struct LR35902Debugger* debugger = (struct LR35902Debugger*) d;
+	struct LR35902Core* cpu = debugger->cpu;
+
+	struct LR35902InstructionInfo info = {{0}};
+	uint16_t address = cpu->pc;
+	size_t bytesRemaining = 1;
+	out->type = TRACE_INSTRUCTION;
+	out->width = 0;
+	out->segment = cpu->memory.currentSegment(cpu, cpu->pc);
+	out->address = cpu->pc;
+	out->value = 0;
+	out->state = (cpu->a << 8) | cpu->f.packed;
+	for (bytesRemaining = 1; bytesRemaining && out->width < 4; --bytesRemaining) {
+		uint8_t instruction = debugger->d.p->core->rawRead8(debugger->d.p->core, address, -1);
+		out->value |= instruction << (out->width * 8);
+		++out->width;
+		++address;
+		bytesRemaining += LR35902Decode(instruction, &info);
+	}
+}
+
+static void LR35902DebuggerTraceAccesses(struct mDebuggerPlatform* d, bool enable) {
+	struct LR35902Debugger* debugger = (struct LR35902Debugger*) d;
+	if (enable == debugger->tracingAccesses) {
+		return;
+	}
+	debugger->tracingAccesses = enable;
+	if (mWatchpointListSize(&debugger->watchpoints)) {
+		return;
+	}
+	if (enable) {
+		LR35902DebuggerInstallMemoryShim(debugger);
+	} else {
+		LR35902DebuggerRemoveMemoryShim(debugger);
+	}
+}
+
+static bool LR35902DebuggerGetCallFrame(struct mDebuggerPlatform* d, uint32_t* pc, int* segment, uint32_t* returnAddress) {
+	struct LR35902Debugger* debugger = (struct LR35902Debugger*) d;
+	struct LR35902Core* cpu = debugger->cpu;
+
+	// Return addresses only live on the stack, which can't be told apart from other pushed values
+	UNUSED(returnAddress);
+	*pc = cpu->pc;
+	*segment = cpu->memory.currentSegment(cpu, cpu->pc);
+	return false;
+}
+
 bool LR35902DebuggerGetRegister(struct mDebuggerPlatform* d, const char* name, int32_t* value) {
 	struct LR35902Debugger* debugger = (struct LR35902Debugger*) d;
 	struct LR35902Core* cpu = debugger->cpu;
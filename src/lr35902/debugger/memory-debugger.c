@@ -6,6 +6,7 @@
 #include <mgba/internal/lr35902/debugger/memory-debugger.h>
 
 #include <mgba/internal/debugger/parser.h>
+#include <mgba/internal/debugger/trace.h>
 #include <mgba/internal/lr35902/debugger/debugger.h>
 
 #include <mgba-util/math.h>
@@ -28,31 +29,49 @@ static bool _checkWatchpoints(struct LR35902Debugger* debugger, uint16_t address
 		debuggerFound: break; \
 	} while(0)
 
-#define CREATE_WATCHPOINT_SHIM(NAME, RW, VALUE, RETURN, TYPES, ...) \
+#define CREATE_WATCHPOINT_READ_SHIM(NAME, RETURN, TYPES, ...) \
 	static RETURN DebuggerShim_ ## NAME TYPES { \
 		struct LR35902Debugger* debugger; \
 		FIND_DEBUGGER(debugger, cpu); \
 		struct mDebuggerEntryInfo info; \
-		if (_checkWatchpoints(debugger, address, &info, WATCHPOINT_ ## RW, VALUE)) { \
+		if (_checkWatchpoints(debugger, address, &info, WATCHPOINT_READ, 0)) { \
 			mDebuggerEnter(debugger->d.p, DEBUGGER_ENTER_WATCHPOINT, &info); \
 		} \
+		RETURN value = debugger->originalMemory.NAME(cpu, __VA_ARGS__); \
+		if (debugger->d.p->trace) { \
+			mDebuggerTraceAccess(debugger->d.p->trace, TRACE_READ, address, value, 1, debugger->originalMemory.currentSegment(cpu, address)); \
+		} \
+		return value; \
+	}
+
+#define CREATE_WATCHPOINT_WRITE_SHIM(NAME, RETURN, TYPES, ...) \
+	static RETURN DebuggerShim_ ## NAME TYPES { \
+		struct LR35902Debugger* debugger; \
+		FIND_DEBUGGER(debugger, cpu); \
+		struct mDebuggerEntryInfo info; \
+		if (_checkWatchpoints(debugger, address, &info, WATCHPOINT_WRITE, value)) { \
+			mDebuggerEnter(debugger->d.p, DEBUGGER_ENTER_WATCHPOINT, &info); \
+		} \
+		if (debugger->d.p->trace) { \
+			mDebuggerTraceAccess(debugger->d.p->trace, TRACE_WRITE, address, (uint8_t) value, 1, debugger->originalMemory.currentSegment(cpu, address)); \
+		} \
 		return debugger->originalMemory.NAME(cpu, __VA_ARGS__); \
 	}
 
-CREATE_WATCHPOINT_SHIM(load8, READ, 0, uint8_t, (struct LR35902Core* cpu, uint16_t address), address)
-CREATE_WATCHPOINT_SHIM(store8, WRITE, value, void, (struct LR35902Core* cpu, uint16_t address, int8_t value), address, value)
+CREATE_WATCHPOINT_READ_SHIM(load8, uint8_t, (struct LR35902Core* cpu, uint16_t address), address)
+CREATE_WATCHPOINT_WRITE_SHIM(store8, void, (struct LR35902Core* cpu, uint16_t address, int8_t value), address, value)
 
 static bool _checkWatchpoints(struct LR35902Debugger* debugger, uint16_t address, struct mDebuggerEntryInfo* info, enum mWatchpointType type, uint8_t newValue) {
 	struct mWatchpoint* watchpoint;
 	size_t i;
 	for (i = 0; i < mWatchpointListSize(&debugger->watchpoints); ++i) {
 		watchpoint = mWatchpointListGetPointer(&debugger->watchpoints, i);
-		if (watchpoint->address == address && (watchpoint->segment < 0 || watchpoint->segment == debugger->originalMemory.currentSegment(debugger->cpu, address)) && watchpoint->type & type) {
+		if (address - watchpoint->address < watchpoint->size && (watchpoint->segment < 0 || watchpoint->segment == debugger->originalMemory.currentSegment(debugger->cpu, address)) && watchpoint->type & type) {
 			if (watchpoint->condition) {
 				int32_t value;
 				int segment;
 				if (!mDebuggerEvaluateParseTree(debugger->d.p, watchpoint->condition, &value, &segment) || !(value || segment >= 0)) {
-					return false;
+					continue;
 				}
 			}
 			info->type.wp.oldValue = debugger->originalMemory.load8(debugger->cpu, address);
@@ -6,6 +6,20 @@
 #include <mgba/internal/lr35902/lr35902.h>
 
 #include <mgba/internal/lr35902/isa-lr35902.h>
+#include <mgba/core/mem-heatmap.h>
+#include <mgba/core/perf-counters.h>
+
+#ifdef ENABLE_PERF_COUNTERS
+// Every access the core makes takes one M-cycle, which is four cycles
+#define COUNT_HEAT(KIND, ADDRESS) \
+	if (cpu->heatmap) { \
+		struct mMemoryHeatmapPage* heatPage = mMemoryHeatmapGetPage(cpu->heatmap, (uint16_t) (ADDRESS)); \
+		++heatPage->accesses[mMEMORY_HEATMAP_ ## KIND]; \
+		heatPage->cycles[mMEMORY_HEATMAP_ ## KIND] += 4; \
+	}
+#else
+#define COUNT_HEAT(KIND, ADDRESS)
+#endif
 
 void LR35902Init(struct LR35902Core* cpu) {
 	cpu->master->init(cpu, cpu->master);
@@ -101,7 +115,7 @@ static void _LR35902InstructionIRQ(struct LR35902Core* cpu) {
 	cpu->instruction = _LR35902InstructionIRQDelay;
 }
 
-static void _LR35902Step(struct LR35902Core* cpu) {
+static inline void _LR35902Step(struct LR35902Core* cpu) {
 	++cpu->cycles;
 	enum LR35902ExecutionState state = cpu->executionState;
 	cpu->executionState = LR35902_CORE_IDLE_0;
@@ -117,14 +131,25 @@ static void _LR35902Step(struct LR35902Core* cpu) {
 		cpu->bus = cpu->memory.cpuLoad8(cpu, cpu->pc);
 		cpu->instruction = _lr35902InstructionTable[cpu->bus];
 		++cpu->pc;
+#ifdef ENABLE_PERF_COUNTERS
+		if (cpu->perfCounters) {
+			++cpu->perfCounters->instructions[0];
+			++cpu->perfCounters->handlers[0][cpu->bus];
+			++cpu->perfCounters->instructionRegions[(uint16_t) (cpu->pc - 1) >> 12];
+		}
+#endif
+		COUNT_HEAT(EXECUTE, cpu->pc - 1);
 		break;
 	case LR35902_CORE_MEMORY_LOAD:
+		COUNT_HEAT(READ, cpu->index);
 		cpu->bus = cpu->memory.load8(cpu, cpu->index);
 		break;
 	case LR35902_CORE_MEMORY_STORE:
+		COUNT_HEAT(WRITE, cpu->index);
 		cpu->memory.store8(cpu, cpu->index, cpu->bus);
 		break;
 	case LR35902_CORE_READ_PC:
+		COUNT_HEAT(EXECUTE, cpu->pc);
 		cpu->bus = cpu->memory.cpuLoad8(cpu, cpu->pc);
 		++cpu->pc;
 		break;
@@ -136,12 +161,11 @@ static void _LR35902Step(struct LR35902Core* cpu) {
 	}
 }
 
-void LR35902Tick(struct LR35902Core* cpu) {
-	while (cpu->cycles >= cpu->nextEvent) {
-		cpu->irqh.processEvents(cpu);
-	}
-	_LR35902Step(cpu);
-	if (cpu->cycles + 2 >= cpu->nextEvent) {
+// Finishes the M-cycle begun by _LR35902Step, splitting it if an event lands inside. Returns
+// whether it was split, since that may have been caused by the step's own memory access.
+static bool _LR35902Execute(struct LR35902Core* cpu) {
+	bool split = cpu->cycles + 2 >= cpu->nextEvent;
+	if (split) {
 		int32_t diff = cpu->nextEvent - cpu->cycles;
 		cpu->cycles = cpu->nextEvent;
 		cpu->executionState += diff;
@@ -153,28 +177,44 @@ void LR35902Tick(struct LR35902Core* cpu) {
 	cpu->executionState = LR35902_CORE_FETCH;
 	cpu->instruction(cpu);
 	++cpu->cycles;
+	return split;
+}
+
+void LR35902Tick(struct LR35902Core* cpu) {
+	while (cpu->cycles >= cpu->nextEvent) {
+		cpu->irqh.processEvents(cpu);
+	}
+	_LR35902Step(cpu);
+	_LR35902Execute(cpu);
+}
+
+// Runs whole M-cycles back to back for as long as the next event cannot land inside one.
+// nextEvent is rechecked every M-cycle since memory accesses can schedule events sooner,
+// including the access in the step itself. Returns false once an M-cycle had to be split.
+static bool _LR35902RunFast(struct LR35902Core* cpu) {
+	while (cpu->cycles + 3 < cpu->nextEvent) {
+		_LR35902Step(cpu);
+		if (_LR35902Execute(cpu)) {
+			return false;
+		}
+	}
+	return true;
 }
 
 void LR35902Run(struct LR35902Core* cpu) {
 	bool running = true;
 	while (running || cpu->executionState != LR35902_CORE_FETCH) {
+		if (running && !_LR35902RunFast(cpu)) {
+			running = false;
+			continue;
+		}
 		if (cpu->cycles >= cpu->nextEvent) {
 			cpu->irqh.processEvents(cpu);
 			break;
 		}
 		_LR35902Step(cpu);
-		if (cpu->cycles + 2 >= cpu->nextEvent) {
-			int32_t diff = cpu->nextEvent - cpu->cycles;
-			cpu->cycles = cpu->nextEvent;
-			cpu->executionState += diff;
-			cpu->irqh.processEvents(cpu);
-			cpu->cycles += LR35902_CORE_EXECUTE - cpu->executionState;
+		if (_LR35902Execute(cpu)) {
 			running = false;
-		} else {
-			cpu->cycles += 2;
 		}
-		cpu->executionState = LR35902_CORE_FETCH;
-		cpu->instruction(cpu);
-		++cpu->cycles;
 	}
 }
@@ -15,3 +15,11 @@ void mappedMemoryFree(void* memory, size_t size) {
 	UNUSED(size);
 	linearFree(memory);
 }
+
+void* hugeMemoryMap(size_t size) {
+	return anonymousMemoryMap(size);
+}
+
+void hugeMemoryFree(void* memory, size_t size) {
+	mappedMemoryFree(memory, size);
+}
@@ -14,6 +14,8 @@ struct VFile3DS {
 
 	Handle handle;
 	u64 offset;
+	const uint8_t* mapped;
+	size_t mappedSize;
 };
 
 struct VDirEntry3DS {
@@ -67,6 +69,8 @@ struct VFile* VFileOpen3DS(FS_Archive* archive, const char* path, int flags) {
 	}
 
 	vf3d->offset = 0;
+	vf3d->mapped = NULL;
+	vf3d->mappedSize = 0;
 
 	vf3d->d.close = _vf3dClose;
 	vf3d->d.seek = _vf3dSeek;
@@ -137,6 +141,8 @@ static void* _vf3dMap(struct VFile* vf, size_t size, int flags) {
 	if (buffer) {
 		u32 sizeRead;
 		FSFILE_Read(vf3d->handle, &sizeRead, 0, buffer, size);
+		vf3d->mapped = buffer;
+		vf3d->mappedSize = size;
 	}
 	return buffer;
 }
@@ -145,6 +151,10 @@ static void _vf3dUnmap(struct VFile* vf, void* memory, size_t size) {
 	struct VFile3DS* vf3d = (struct VFile3DS*) vf;
 	u32 sizeWritten;
 	FSFILE_Write(vf3d->handle, &sizeWritten, 0, memory, size, FS_WRITE_FLUSH);
+	if (memory == vf3d->mapped) {
+		vf3d->mapped = NULL;
+		vf3d->mappedSize = 0;
+	}
 	mappedMemoryFree(memory, size);
 }
 
@@ -164,7 +174,11 @@ static bool _vf3dSync(struct VFile* vf, const void* buffer, size_t size) {
 	struct VFile3DS* vf3d = (struct VFile3DS*) vf;
 	if (buffer) {
 		u32 sizeWritten;
-		Result res = FSFILE_Write(vf3d->handle, &sizeWritten, 0, buffer, size, FS_WRITE_FLUSH);
+		u64 offset = 0;
+		if ((const uint8_t*) buffer > vf3d->mapped && (const uint8_t*) buffer < vf3d->mapped + vf3d->mappedSize) {
+			offset = (const uint8_t*) buffer - vf3d->mapped;
+		}
+		Result res = FSFILE_Write(vf3d->handle, &sizeWritten, offset, buffer, size, FS_WRITE_FLUSH);
 		if (res) {
 			return false;
 		}
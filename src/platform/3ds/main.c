@@ -63,6 +63,10 @@ static enum DarkenMode {
 #define AUDIO_SAMPLE_BUFFER (AUDIO_SAMPLES * 16)
 #define DSP_BUFFERS 4
 
+// Share of the system core the app may use, as a percentage. Old 3DS threaded video needs most of it.
+#define SYSCORE_MENU_LIMIT 20
+#define SYSCORE_GAME_LIMIT 80
+
 static struct m3DSRotationSource {
 	struct mRotationSource d;
 	accelVector accel;
@@ -259,10 +263,8 @@ static void _resetCamera(struct m3DSImageSource* imageSource) {
 }
 
 static void _setup(struct mGUIRunner* runner) {
-	if (core2) {
-		mCoreConfigSetDefaultIntValue(&runner->config, "threadedVideo", 1);
-		mCoreLoadForeignConfig(runner->core, &runner->config);
-	}
+	mCoreConfigSetDefaultIntValue(&runner->config, "threadedVideo", 1);
+	mCoreLoadForeignConfig(runner->core, &runner->config);
 
 	runner->core->setPeripheral(runner->core, mPERIPH_ROTATION, &rotation.d);
 	runner->core->setPeripheral(runner->core, mPERIPH_IMAGE_SOURCE, &camera.d);
@@ -328,6 +330,11 @@ static void _gameLoaded(struct mGUIRunner* runner) {
 		break;
 	}
 	osSetSpeedupEnable(true);
+	int fakeBool;
+	if (!core2 && runner->core->platform(runner->core) == PLATFORM_GBA && mCoreConfigGetIntValue(&runner->config, "threadedVideo", &fakeBool) && fakeBool) {
+		// The GBA render thread lives on the system core, so take as much of it as the system allows
+		APT_SetAppCpuTimeLimit(SYSCORE_GAME_LIMIT);
+	}
 
 	double ratio = GBAAudioCalculateRatio(1, 59.8260982880808, 1);
 	blip_set_rates(runner->core->getAudioChannel(runner->core, 0), runner->core->frequency(runner->core), 32768 * ratio);
@@ -378,6 +385,9 @@ static void _gameLoaded(struct mGUIRunner* runner) {
 
 static void _gameUnloaded(struct mGUIRunner* runner) {
 	osSetSpeedupEnable(false);
+	if (!core2) {
+		APT_SetAppCpuTimeLimit(SYSCORE_MENU_LIMIT);
+	}
 	frameLimiter = true;
 
 	switch (runner->core->platform(runner->core)) {
@@ -744,8 +754,7 @@ static void _postAudioBuffer(struct mAVStream* stream, blip_t* left, blip_t* rig
 		memset(&dspBuffer[bufferId], 0, sizeof(dspBuffer[bufferId]));
 		dspBuffer[bufferId].data_pcm16 = tmpBuf;
 		dspBuffer[bufferId].nsamples = AUDIO_SAMPLES;
-		blip_read_samples(left, dspBuffer[bufferId].data_pcm16, AUDIO_SAMPLES, true);
-		blip_read_samples(right, dspBuffer[bufferId].data_pcm16 + 1, AUDIO_SAMPLES, true);
+		blip_read_samples_stereo(left, right, dspBuffer[bufferId].data_pcm16, AUDIO_SAMPLES);
 		DSP_FlushDataCache(dspBuffer[bufferId].data_pcm16, AUDIO_SAMPLES * 2 * sizeof(int16_t));
 		ndspChnWaveBufAdd(0, &dspBuffer[bufferId]);
 	}
@@ -952,13 +961,16 @@ int main() {
 	MutexInit(&runner.autosave.mutex);
 	ConditionInit(&runner.autosave.cond);
 
-	APT_SetAppCpuTimeLimit(20);
+	APT_SetAppCpuTimeLimit(SYSCORE_MENU_LIMIT);
 	runner.autosave.thread = threadCreate(mGUIAutosaveThread, &runner.autosave, 0x4000, 0x1F, 1, true);
 
 	Thread thread2;
 	if (ThreadCreate(&thread2, _core2Test, NULL) == 0) {
 		core2 = true;
 		ThreadJoin(thread2);
+	} else {
+		// No third core, so threaded video renders on the system core instead
+		ctrThreadCore = 1;
 	}
 
 	mGUIInit(&runner, "3ds");
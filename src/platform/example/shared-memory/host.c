@@ -0,0 +1,115 @@
+// This source file is placed into the public domain.
+#include <mgba/core/core.h>
+#include <mgba/feature/commandline.h>
+#include <mgba/feature/shared-memory.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define DEFAULT_PATH "/dev/shm/mgba"
+
+static bool _mExampleRun(const struct mArguments* args, const char* path);
+static void _log(struct mLogger* log, int category, enum mLogLevel level, const char* format, va_list args);
+
+static int _logLevel = 0;
+
+int main(int argc, char** argv) {
+	bool didFail = false;
+
+	struct mArguments args = {};
+	bool parsed = parseArguments(&args, argc, argv, NULL);
+	if (!args.fname) {
+		parsed = false;
+	}
+	if (!parsed || args.showHelp) {
+		usage(argv[0], NULL);
+		didFail = !parsed;
+		goto cleanup;
+	}
+
+	if (args.showVersion) {
+		version(argv[0]);
+		goto cleanup;
+	}
+
+	struct mLogger logger = { .log = _log };
+	mLogSetDefaultLogger(&logger);
+
+	// The mapping goes wherever the MGBA_SHM environment variable says, so that
+	// several hosts can run side by side.
+	const char* path = getenv("MGBA_SHM");
+	if (!path) {
+		path = DEFAULT_PATH;
+	}
+	didFail = !_mExampleRun(&args, path);
+
+	cleanup:
+	freeArguments(&args);
+
+	return didFail;
+}
+
+bool _mExampleRun(const struct mArguments* args, const char* path) {
+	struct mCore* core = mCoreFind(args->fname);
+	if (!core) {
+		return false;
+	}
+	core->init(core);
+	mCoreLoadFile(core, args->fname);
+
+	mCoreConfigInit(&core->config, "shared-memory");
+	mCoreConfigLoad(&core->config);
+	applyArguments(args, NULL, &core->config);
+	mCoreConfigSetDefaultValue(&core->config, "idleOptimization", "detect");
+	mCoreLoadConfig(core);
+	mCoreConfigGetIntValue(&core->config, "logLevel", &_logLevel);
+
+	core->reset(core);
+
+	// The shared memory takes over the video buffer and the AV stream. It has to be
+	// set up after the core is reset, since that decides which memory blocks exist.
+	struct mSharedMemory shm;
+	if (!mSharedMemoryInit(&shm, core, path)) {
+		mCoreConfigDeinit(&core->config);
+		core->deinit(core);
+		return false;
+	}
+
+	// The other process drives everything from here on through the control channel.
+	// It can let the core run freely, or pause it and step it frame by frame.
+	while (true) {
+		bool run = mSharedMemoryPoll(&shm);
+		if (mSharedMemoryIsQuitting(&shm)) {
+			break;
+		}
+		if (!run) {
+#ifdef _WIN32
+			Sleep(0);
+#else
+			usleep(50);
+#endif
+			continue;
+		}
+		mSharedMemoryFrameStarted(&shm);
+		core->runFrame(core);
+		mSharedMemoryFrameEnded(&shm);
+	}
+
+	mSharedMemoryDeinit(&shm);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+
+	return true;
+}
+
+void _log(struct mLogger* log, int category, enum mLogLevel level, const char* format, va_list args) {
+	UNUSED(log);
+	if (level & _logLevel) {
+		printf("%s: ", mLogCategoryName(category));
+		vprintf(format, args);
+		putchar('\n');
+	}
+}
@@ -22,6 +22,10 @@
 #include <mgba/gba/core.h>
 #include <mgba/gba/interface.h>
 #include <mgba/internal/gba/gba.h>
+#if defined(BUILD_GLES2) || defined(BUILD_GLES3)
+#include <mgba/internal/gba/renderers/gl.h>
+#define USE_HW_RENDER
+#endif
 #endif
 #include <mgba-util/memory.h>
 #include <mgba-util/vfs.h>
@@ -53,6 +57,7 @@ static void* outputBuffer;
 static void* data;
 static size_t dataSize;
 static void* savedata;
+static size_t serializeSize;
 static struct mAVStream stream;
 static int rumbleUp;
 static int rumbleDown;
@@ -68,6 +73,14 @@ static unsigned camHeight;
 static unsigned imcapWidth;
 static unsigned imcapHeight;
 static size_t camStride;
+#ifdef USE_HW_RENDER
+static struct retro_hw_render_callback hwRender;
+static bool hwRenderRequested;
+static bool hwRenderActive;
+static int hwScale = 1;
+static GLuint hwTex;
+static GLuint hwFbo;
+#endif
 
 static void _reloadSettings(void) {
 	struct mCoreOptions opts = {
@@ -161,6 +174,10 @@ void retro_set_environment(retro_environment_t env) {
 		{ "mgba_sgb_borders", "Use Super Game Boy borders (requires restart); ON|OFF" },
 		{ "mgba_idle_optimization", "Idle loop removal; Remove Known|Detect and Remove|Don't Remove" },
 		{ "mgba_frameskip", "Frameskip; 0|1|2|3|4|5|6|7|8|9|10" },
+#ifdef USE_HW_RENDER
+		{ "mgba_hwaccel_video", "Hardware-accelerated video (GBA only, requires restart); OFF|ON" },
+		{ "mgba_video_scale", "Hardware video scale (requires restart); 1|2|3|4|5|6" },
+#endif
 		{ 0, 0 }
 	};
 
@@ -198,6 +215,13 @@ void retro_get_system_info(struct retro_system_info* info) {
 void retro_get_system_av_info(struct retro_system_av_info* info) {
 	unsigned width, height;
 	core->desiredVideoDimensions(core, &width, &height);
+#ifdef USE_HW_RENDER
+	if (hwRenderRequested) {
+		// The GL renderer only picks up its scale once the context exists, so don't wait for it here
+		width = GBA_VIDEO_HORIZONTAL_PIXELS * hwScale;
+		height = GBA_VIDEO_VERTICAL_PIXELS * hwScale;
+	}
+#endif
 	info->geometry.base_width = width;
 	info->geometry.base_height = height;
 #ifdef M_CORE_GB
@@ -344,6 +368,16 @@ void retro_run(void) {
 	core->runFrame(core);
 	unsigned width, height;
 	core->desiredVideoDimensions(core, &width, &height);
+#ifdef USE_HW_RENDER
+	if (hwRenderActive) {
+		// Copy straight into the frontend's framebuffer on the GPU; rows are flipped to GL's bottom-up order
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, hwFbo);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, hwRender.get_current_framebuffer());
+		glBlitFramebuffer(0, 0, width, height, 0, height, width, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		videoCallback(RETRO_HW_FRAME_BUFFER_VALID, width, height, 0);
+	} else
+#endif
 	videoCallback(outputBuffer, width, height, BYTES_PER_PIXEL * 256);
 
 	if (rumbleCallback) {
@@ -359,6 +393,87 @@ void retro_run(void) {
 	}
 }
 
+#ifdef USE_HW_RENDER
+static void _reselectRenderer(void) {
+	// Renderers are only picked on reset, so carry the emulation state across one
+	size_t size = core->stateSize(core);
+	void* state = anonymousMemoryMap(size);
+	core->saveState(core, state);
+	core->reset(core);
+	core->loadState(core, state);
+	mappedMemoryFree(state, size);
+}
+
+static void _hwContextReset(void) {
+	glGenTextures(1, &hwTex);
+	glGenFramebuffers(1, &hwFbo);
+	core->setVideoGLTex(core, hwTex);
+	_reselectRenderer();
+
+	// The renderer allocates the texture's storage when it initializes
+	glBindFramebuffer(GL_FRAMEBUFFER, hwFbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, hwTex, 0);
+	hwRenderActive = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (!hwRenderActive) {
+		mLOG(GBA_VIDEO, ERROR, "Could not attach hardware-rendered output; falling back to software");
+		core->setVideoGLTex(core, -1);
+		_reselectRenderer();
+	}
+}
+
+static void _hwContextDestroy(void) {
+	// The context is still current here, so the GL renderer can clean up after itself
+	hwRenderActive = false;
+	if (core) {
+		core->setVideoGLTex(core, -1);
+		_reselectRenderer();
+	}
+	glDeleteFramebuffers(1, &hwFbo);
+	glDeleteTextures(1, &hwTex);
+	hwFbo = 0;
+	hwTex = 0;
+}
+
+static void _requestHwRender(void) {
+	struct retro_variable var = {
+		.key = "mgba_hwaccel_video",
+		.value = 0
+	};
+	if (!environCallback(RETRO_ENVIRONMENT_GET_VARIABLE, &var) || !var.value || strcmp(var.value, "ON") != 0) {
+		return;
+	}
+	var.key = "mgba_video_scale";
+	var.value = 0;
+	if (environCallback(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value) {
+		hwScale = strtol(var.value, NULL, 10);
+		if (hwScale < 1) {
+			hwScale = 1;
+		}
+	}
+
+	memset(&hwRender, 0, sizeof(hwRender));
+#ifdef BUILD_GL
+	hwRender.context_type = RETRO_HW_CONTEXT_OPENGL_CORE;
+	hwRender.version_major = 3;
+	hwRender.version_minor = 3;
+#else
+	hwRender.context_type = RETRO_HW_CONTEXT_OPENGLES3;
+	hwRender.version_major = 3;
+	hwRender.version_minor = 0;
+#endif
+	hwRender.context_reset = _hwContextReset;
+	hwRender.context_destroy = _hwContextDestroy;
+	hwRender.bottom_left_origin = true;
+	if (!environCallback(RETRO_ENVIRONMENT_SET_HW_RENDER, &hwRender)) {
+		return;
+	}
+	hwRenderRequested = true;
+	mCoreConfigSetIntValue(&core->config, "hwaccelVideo", 1);
+	mCoreConfigSetIntValue(&core->config, "videoScale", hwScale);
+}
+#endif
+
 static void _setupMaps(struct mCore* core) {
 #ifdef M_CORE_GBA
 	if (core->platform(core) == PLATFORM_GBA) {
@@ -505,6 +620,9 @@ bool retro_load_game(const struct retro_game_info* game) {
 	if (core->platform(core) == PLATFORM_GBA) {
 		core->setPeripheral(core, mPERIPH_GBA_LUMINANCE, &lux);
 		biosName = "gba_bios.bin";
+#ifdef USE_HW_RENDER
+		_requestHwRender();
+#endif
 
 	}
 #endif
@@ -564,6 +682,11 @@ void retro_unload_game(void) {
 	}
 	mCoreConfigDeinit(&core->config);
 	core->deinit(core);
+	core = NULL;
+	serializeSize = 0;
+#ifdef USE_HW_RENDER
+	hwRenderRequested = false;
+#endif
 	mappedMemoryFree(data, dataSize);
 	data = 0;
 	mappedMemoryFree(savedata, SIZE_CART_FLASH1M);
@@ -571,33 +694,26 @@ void retro_unload_game(void) {
 }
 
 size_t retro_serialize_size(void) {
-	struct VFile* vfm = VFileMemChunk(NULL, 0);
-	mCoreSaveStateNamed(core, vfm, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
-	size_t size = vfm->size(vfm);
-	vfm->close(vfm);
-	return size;
+	// Frontends expect this not to change while a game is running, but save data can still grow
+	// when its type is detected, so leave room for the largest the save buffer allows
+	if (!serializeSize) {
+		serializeSize = mCoreSaveStateBufferBound(core, SAVESTATE_SAVEDATA | SAVESTATE_RTC, SIZE_CART_FLASH1M);
+	}
+	return serializeSize;
 }
 
 bool retro_serialize(void* data, size_t size) {
-	struct VFile* vfm = VFileMemChunk(NULL, 0);
-	mCoreSaveStateNamed(core, vfm, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
-	if ((ssize_t) size > vfm->size(vfm)) {
-		size = vfm->size(vfm);
-	} else if ((ssize_t) size < vfm->size(vfm)) {
-		vfm->close(vfm);
+	size_t needed = mCoreSaveStateBuffer(core, data, size, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
+	if (!needed || needed > size) {
 		return false;
 	}
-	vfm->seek(vfm, 0, SEEK_SET);
-	vfm->read(vfm, data, size);
-	vfm->close(vfm);
+	// Keep the padding deterministic, since netplay compares whole states
+	memset((uint8_t*) data + needed, 0, size - needed);
 	return true;
 }
 
 bool retro_unserialize(const void* data, size_t size) {
-	struct VFile* vfm = VFileFromConstMemory(data, size);
-	bool success = mCoreLoadStateNamed(core, vfm, SAVESTATE_RTC);
-	vfm->close(vfm);
-	return success;
+	return mCoreLoadStateBuffer(core, data, size, SAVESTATE_RTC);
 }
 
 void retro_cheat_reset(void) {
@@ -755,8 +871,7 @@ void GBARetroLog(struct mLogger* logger, int category, enum mLogLevel level, con
 static void _postAudioBuffer(struct mAVStream* stream, blip_t* left, blip_t* right) {
 	UNUSED(stream);
 	int16_t samples[SAMPLES * 2];
-	blip_read_samples(left, samples, SAMPLES, true);
-	blip_read_samples(right, samples + 1, SAMPLES, true);
+	blip_read_samples_stereo(left, right, samples, SAMPLES);
 	audioCallback(samples, SAMPLES);
 }
 
@@ -5,8 +5,10 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "gles2.h"
 
+#include <mgba/core/interface.h>
 #include <mgba/core/log.h>
 #include <mgba-util/configuration.h>
+#include <mgba-util/crc32.h>
 #include <mgba-util/formatting.h>
 #include <mgba-util/math.h>
 #include <mgba-util/vector.h>
@@ -17,6 +19,28 @@ mLOG_DEFINE_CATEGORY(OPENGL, "OpenGL", "video.ogl");
 
 #define MAX_PASSES 8
 
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+#define FRAME_INTERNAL_FORMAT GL_RGB
+#define FRAME_FORMAT GL_RGB
+#define FRAME_TYPE GL_UNSIGNED_SHORT_5_6_5
+#else
+#define FRAME_INTERNAL_FORMAT GL_RGBA
+#define FRAME_FORMAT GL_RGBA
+#define FRAME_TYPE GL_UNSIGNED_SHORT_1_5_5_5_REV
+#endif
+#elif defined(__BIG_ENDIAN__)
+#define FRAME_INTERNAL_FORMAT GL_RGBA
+#define FRAME_FORMAT GL_RGBA
+#define FRAME_TYPE GL_UNSIGNED_INT_8_8_8_8_REV
+#else
+#define FRAME_INTERNAL_FORMAT GL_RGBA
+#define FRAME_FORMAT GL_RGBA
+#define FRAME_TYPE GL_UNSIGNED_BYTE
+#endif
+
+static struct VDir* _programCache = NULL;
+
 static const GLchar* const _gles2Header =
 	"#version 100\n"
 	"precision mediump float;\n";
@@ -76,6 +100,52 @@ static const GLfloat _vertices[] = {
 	1.f, -1.f,
 };
 
+#ifdef GL_SYNC_GPU_COMMANDS_COMPLETE
+static bool _fencesSupported(void) {
+	const char* version = (const char*) glGetString(GL_VERSION);
+	if (!version) {
+		return false;
+	}
+	// Sync objects are core in OpenGL 3.2 and OpenGL ES 3.0
+	if (!strncmp(version, "OpenGL ES ", strlen("OpenGL ES "))) {
+		return atoi(version + strlen("OpenGL ES ")) >= 3;
+	}
+	int major = atoi(version);
+	const char* minor = strchr(version, '.');
+	return major > 3 || (major == 3 && minor && atoi(&minor[1]) >= 2);
+}
+
+static void _waitForFence(struct mGLES2Context* context) {
+	if (!context->fencesSupported || !context->framesInFlight) {
+		return;
+	}
+	unsigned depth = context->framesInFlight;
+	if (depth > mGLES2_MAX_FRAMES_IN_FLIGHT) {
+		depth = mGLES2_MAX_FRAMES_IN_FLIGHT;
+	}
+	context->activeFence = (context->activeFence + 1) % depth;
+	GLsync fence = context->fences[context->activeFence];
+	if (!fence) {
+		return;
+	}
+	// Waiting here instead of letting the driver block somewhere in the next swap keeps
+	// the stall in one predictable place. The timeout keeps a lost context from hanging.
+	glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);
+	glDeleteSync(fence);
+	context->fences[context->activeFence] = NULL;
+}
+
+static void _clearFences(struct mGLES2Context* context) {
+	size_t i;
+	for (i = 0; i < mGLES2_MAX_FRAMES_IN_FLIGHT; ++i) {
+		if (context->fences[i]) {
+			glDeleteSync(context->fences[i]);
+			context->fences[i] = NULL;
+		}
+	}
+}
+#endif
+
 static void mGLES2ContextInit(struct VideoBackend* v, WHandle handle) {
 	UNUSED(handle);
 	struct mGLES2Context* context = (struct mGLES2Context*) v;
@@ -148,29 +218,70 @@ static void mGLES2ContextInit(struct VideoBackend* v, WHandle handle) {
 	glDeleteTextures(1, &context->finalShader.tex);
 	context->finalShader.fbo = 0;
 	context->finalShader.tex = 0;
+
+#ifdef GL_SYNC_GPU_COMMANDS_COMPLETE
+	memset(context->fences, 0, sizeof(context->fences));
+	context->activeFence = 0;
+	context->fencesSupported = _fencesSupported();
+#endif
+}
+
+#ifdef GL_PIXEL_UNPACK_BUFFER
+static bool _pixelBuffersSupported(void) {
+	const char* version = (const char*) glGetString(GL_VERSION);
+	if (!version) {
+		return false;
+	}
+	if (!strncmp(version, "OpenGL ES ", strlen("OpenGL ES "))) {
+		version += strlen("OpenGL ES ");
+	}
+	// Mapping buffer ranges is core in both OpenGL 3.0 and OpenGL ES 3.0
+	return atoi(version) >= 3;
+}
+
+static void* _mapPixelBuffer(struct mGLES2Context* context) {
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, context->pbo[context->activePbo]);
+	context->mappedFrame = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, context->d.width * context->d.height * BYTES_PER_PIXEL, GL_MAP_WRITE_BIT);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return context->mappedFrame;
+}
+#endif
+
+static void _endStreaming(struct mGLES2Context* context) {
+#ifdef GL_PIXEL_UNPACK_BUFFER
+	if (!context->pbo[0]) {
+		return;
+	}
+	if (context->mappedFrame) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, context->pbo[context->activePbo]);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		context->mappedFrame = NULL;
+	}
+	glDeleteBuffers(2, context->pbo);
+	context->pbo[0] = 0;
+	context->pbo[1] = 0;
+#else
+	UNUSED(context);
+#endif
 }
 
 static void mGLES2ContextSetDimensions(struct VideoBackend* v, unsigned width, unsigned height) {
 	struct mGLES2Context* context = (struct mGLES2Context*) v;
+	_endStreaming(context);
 	v->width = width;
 	v->height = height;
 
 	glBindTexture(GL_TEXTURE_2D, context->tex);
-#ifdef COLOR_16_BIT
-#ifdef COLOR_5_6_5
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, 0);
-#else
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, 0);
-#endif
-#elif defined(__BIG_ENDIAN__)
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, 0);
-#else
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
-#endif
+	glTexImage2D(GL_TEXTURE_2D, 0, FRAME_INTERNAL_FORMAT, width, height, 0, FRAME_FORMAT, FRAME_TYPE, 0);
 }
 
 static void mGLES2ContextDeinit(struct VideoBackend* v) {
 	struct mGLES2Context* context = (struct mGLES2Context*) v;
+	_endStreaming(context);
+#ifdef GL_SYNC_GPU_COMMANDS_COMPLETE
+	_clearFences(context);
+#endif
 	glDeleteTextures(1, &context->tex);
 	glDeleteBuffers(1, &context->vbo);
 	mGLES2ShaderDeinit(&context->initialShader);
@@ -240,23 +351,36 @@ void _drawShader(struct mGLES2Context* context, struct mGLES2Shader* shader) {
 		glClear(GL_COLOR_BUFFER_BIT);
 	}
 
-	if (shader->tex && (shader->width <= 0 || shader->height <= 0)) {
+	if (shader->tex && (shader->width <= 0 || shader->height <= 0) && (shader->texWidth != drawW || shader->texHeight != drawH)) {
 		GLint oldTex;
 		glGetIntegerv(GL_TEXTURE_BINDING_2D, &oldTex);
 		glBindTexture(GL_TEXTURE_2D, shader->tex);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, drawW, drawH, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
 		glBindTexture(GL_TEXTURE_2D, oldTex);
+		shader->texWidth = drawW;
+		shader->texHeight = drawH;
 	}
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, shader->filter ? GL_LINEAR : GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, shader->filter ? GL_LINEAR : GL_NEAREST);
 	glUseProgram(shader->program);
-	glUniform1i(shader->texLocation, 0);
-	glUniform2f(shader->texSizeLocation, context->d.width - padW, context->d.height - padH);
+	GLfloat texSize[2] = { context->d.width - padW, context->d.height - padH };
+	if (!shader->uniformsUploaded) {
+		glUniform1i(shader->texLocation, 0);
+	}
+	if (!shader->uniformsUploaded || memcmp(texSize, shader->texSize, sizeof(texSize))) {
+		glUniform2fv(shader->texSizeLocation, 1, texSize);
+		memcpy(shader->texSize, texSize, sizeof(texSize));
+	}
 	glBindVertexArray(shader->vao);
 	size_t u;
 	for (u = 0; u < shader->nUniforms; ++u) {
 		struct mGLES2Uniform* uniform = &shader->uniforms[u];
+		// Uniforms stay set in the program, so only ones that changed since the last draw need uploading
+		if (shader->uniformsUploaded && !memcmp(&uniform->value, &uniform->uploaded, sizeof(uniform->value))) {
+			continue;
+		}
+		uniform->uploaded = uniform->value;
 		switch (uniform->type) {
 		case GL_FLOAT:
 			glUniform1f(uniform->location, uniform->value.f);
@@ -305,12 +429,16 @@ void _drawShader(struct mGLES2Context* context, struct mGLES2Shader* shader) {
 			break;
 		}
 	}
+	shader->uniformsUploaded = true;
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 	glBindTexture(GL_TEXTURE_2D, shader->tex);
 }
 
 void mGLES2ContextDrawFrame(struct VideoBackend* v) {
 	struct mGLES2Context* context = (struct mGLES2Context*) v;
+#ifdef GL_SYNC_GPU_COMMANDS_COMPLETE
+	_waitForFence(context);
+#endif
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, context->tex);
 
@@ -329,21 +457,69 @@ void mGLES2ContextDrawFrame(struct VideoBackend* v) {
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	glUseProgram(0);
 	glBindVertexArray(0);
+#ifdef GL_SYNC_GPU_COMMANDS_COMPLETE
+	if (context->fencesSupported && context->framesInFlight) {
+		context->fences[context->activeFence] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+#endif
 }
 
 void mGLES2ContextPostFrame(struct VideoBackend* v, const void* frame) {
 	struct mGLES2Context* context = (struct mGLES2Context*) v;
 	glBindTexture(GL_TEXTURE_2D, context->tex);
-#ifdef COLOR_16_BIT
-#ifdef COLOR_5_6_5
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, v->width, v->height, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, frame);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, v->width, v->height, FRAME_FORMAT, FRAME_TYPE, frame);
+}
+
+void* mGLES2ContextBeginStreaming(struct mGLES2Context* context) {
+#ifdef GL_PIXEL_UNPACK_BUFFER
+	if (context->pbo[0]) {
+		return context->mappedFrame;
+	}
+	if (!context->d.width || !context->d.height || !_pixelBuffersSupported()) {
+		return NULL;
+	}
+	size_t size = context->d.width * context->d.height * BYTES_PER_PIXEL;
+	glGenBuffers(2, context->pbo);
+	int i;
+	for (i = 0; i < 2; ++i) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, context->pbo[i]);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	context->activePbo = 0;
+	if (!_mapPixelBuffer(context)) {
+		_endStreaming(context);
+		return NULL;
+	}
+	return context->mappedFrame;
 #else
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, v->width, v->height, 0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, frame);
+	UNUSED(context);
+	return NULL;
 #endif
-#elif defined(__BIG_ENDIAN__)
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, v->width, v->height, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, frame);
+}
+
+void* mGLES2ContextStreamFrame(struct mGLES2Context* context) {
+#ifdef GL_PIXEL_UNPACK_BUFFER
+	if (!context->mappedFrame) {
+		return NULL;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, context->pbo[context->activePbo]);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	context->mappedFrame = NULL;
+	glBindTexture(GL_TEXTURE_2D, context->tex);
+	// With an unpack buffer bound, the pixel pointer is an offset into it
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, context->d.width, context->d.height, FRAME_FORMAT, FRAME_TYPE, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	context->activePbo ^= 1;
+	if (!_mapPixelBuffer(context)) {
+		_endStreaming(context);
+		return NULL;
+	}
+	return context->mappedFrame;
 #else
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, v->width, v->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, frame);
+	UNUSED(context);
+	return NULL;
 #endif
 }
 
@@ -360,6 +536,109 @@ void mGLES2ContextCreate(struct mGLES2Context* context) {
 	context->d.clearMessage = 0;
 	context->shaders = 0;
 	context->nShaders = 0;
+	context->pbo[0] = 0;
+	context->pbo[1] = 0;
+	context->activePbo = 0;
+	context->mappedFrame = NULL;
+	context->framesInFlight = 2;
+}
+
+static uint32_t _hashString(uint32_t key, const char* string) {
+	if (!string) {
+		return key;
+	}
+	return crc32(key, (const uint8_t*) string, strlen(string) + 1);
+}
+
+static uint32_t _programKey(const char* header, const char* vs, const char* fs) {
+	// The driver and version are part of the key, since binaries from one driver are useless to another
+	uint32_t key = _hashString(0, (const char*) glGetString(GL_RENDERER));
+	key = _hashString(key, (const char*) glGetString(GL_VERSION));
+	key = _hashString(key, header);
+	key = _hashString(key, vs);
+	return _hashString(key, fs);
+}
+
+#ifdef GL_PROGRAM_BINARY_LENGTH
+static bool _programBinarySupported(void) {
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	// Drivers without program binaries reject the query, so don't leave the error behind
+	while (glGetError() != GL_NO_ERROR);
+	return formats > 0;
+}
+#endif
+
+static bool _loadProgramBinary(struct mGLES2Shader* shader, uint32_t key) {
+#ifdef GL_PROGRAM_BINARY_LENGTH
+	if (!_programCache || !_programBinarySupported()) {
+		return false;
+	}
+	char name[PATH_MAX];
+	snprintf(name, sizeof(name), "%08X.bin", key);
+	struct VFile* vf = _programCache->openFile(_programCache, name, O_RDONLY);
+	if (!vf) {
+		return false;
+	}
+	bool success = false;
+	uint32_t format;
+	ssize_t size = vf->size(vf) - sizeof(format);
+	if (size > 0 && vf->read(vf, &format, sizeof(format)) == sizeof(format)) {
+		void* binary = malloc(size);
+		if (vf->read(vf, binary, size) == size) {
+			glProgramBinary(shader->program, format, binary, size);
+			GLint status = GL_FALSE;
+			glGetProgramiv(shader->program, GL_LINK_STATUS, &status);
+			success = status == GL_TRUE;
+		}
+		free(binary);
+	}
+	vf->close(vf);
+	if (!success) {
+		// A driver update can invalidate old binaries; start over with a fresh program and recompile
+		glDeleteProgram(shader->program);
+		shader->program = glCreateProgram();
+	}
+	return success;
+#else
+	UNUSED(shader);
+	UNUSED(key);
+	return false;
+#endif
+}
+
+static void _saveProgramBinary(struct mGLES2Shader* shader, uint32_t key) {
+#ifdef GL_PROGRAM_BINARY_LENGTH
+	if (!_programCache || !_programBinarySupported()) {
+		return;
+	}
+	GLint status = GL_FALSE;
+	glGetProgramiv(shader->program, GL_LINK_STATUS, &status);
+	GLint size = 0;
+	glGetProgramiv(shader->program, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (status != GL_TRUE || size <= 0) {
+		return;
+	}
+	void* binary = malloc(size);
+	GLenum format;
+	GLsizei length = 0;
+	glGetProgramBinary(shader->program, size, &length, &format, binary);
+	if (length > 0) {
+		char name[PATH_MAX];
+		snprintf(name, sizeof(name), "%08X.bin", key);
+		struct VFile* vf = _programCache->openFile(_programCache, name, O_WRONLY | O_CREAT | O_TRUNC);
+		if (vf) {
+			uint32_t storedFormat = format;
+			vf->write(vf, &storedFormat, sizeof(storedFormat));
+			vf->write(vf, binary, length);
+			vf->close(vf);
+		}
+	}
+	free(binary);
+#else
+	UNUSED(shader);
+	UNUSED(key);
+#endif
 }
 
 void mGLES2ShaderInit(struct mGLES2Shader* shader, const char* vs, const char* fs, int width, int height, bool integerScaling, struct mGLES2Uniform* uniforms, size_t nUniforms) {
@@ -370,6 +649,9 @@ void mGLES2ShaderInit(struct mGLES2Shader* shader, const char* vs, const char* f
 	shader->blend = false;
 	shader->uniforms = uniforms;
 	shader->nUniforms = nUniforms;
+	shader->uniformsUploaded = false;
+	shader->texWidth = 0;
+	shader->texHeight = 0;
 	glGenFramebuffers(1, &shader->fbo);
 	glBindFramebuffer(GL_FRAMEBUFFER, shader->fbo);
 
@@ -381,12 +663,12 @@ void mGLES2ShaderInit(struct mGLES2Shader* shader, const char* vs, const char* f
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	if (shader->width > 0 && shader->height > 0) {
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, shader->width, shader->height, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
+		shader->texWidth = shader->width;
+		shader->texHeight = shader->height;
 	}
 
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, shader->tex, 0);
 	shader->program = glCreateProgram();
-	shader->vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	shader->fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
 	const GLchar* shaderBuffer[2];
 	const GLubyte* version = glGetString(GL_VERSION);
 	if (strncmp((const char*) version, "OpenGL ES ", strlen("OpenGL ES "))) {
@@ -394,37 +676,49 @@ void mGLES2ShaderInit(struct mGLES2Shader* shader, const char* vs, const char* f
 	} else {
 		shaderBuffer[0] = _gles2Header;
 	}
-	if (vs) {
-		shaderBuffer[1] = vs;
-	} else {
-		shaderBuffer[1] = _nullVertexShader;
+	if (!vs) {
+		vs = _nullVertexShader;
+	}
+	if (!fs) {
+		fs = _nullFragmentShader;
 	}
-	glShaderSource(shader->vertexShader, 2, shaderBuffer, 0);
 
-	if (fs) {
-		shaderBuffer[1] = fs;
+	uint32_t key = _programKey(shaderBuffer[0], vs, fs);
+	if (_loadProgramBinary(shader, key)) {
+		shader->vertexShader = 0;
+		shader->fragmentShader = 0;
 	} else {
-		shaderBuffer[1] = _nullFragmentShader;
-	}
-	glShaderSource(shader->fragmentShader, 2, shaderBuffer, 0);
+		shader->vertexShader = glCreateShader(GL_VERTEX_SHADER);
+		shader->fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+		shaderBuffer[1] = vs;
+		glShaderSource(shader->vertexShader, 2, shaderBuffer, 0);
+		shaderBuffer[1] = fs;
+		glShaderSource(shader->fragmentShader, 2, shaderBuffer, 0);
 
-	glAttachShader(shader->program, shader->vertexShader);
-	glAttachShader(shader->program, shader->fragmentShader);
-	char log[1024];
-	glCompileShader(shader->fragmentShader);
-	glGetShaderInfoLog(shader->fragmentShader, 1024, 0, log);
-	if (log[0]) {
-		mLOG(OPENGL, ERROR, "%s\n", log);
-	}
-	glCompileShader(shader->vertexShader);
-	glGetShaderInfoLog(shader->vertexShader, 1024, 0, log);
-	if (log[0]) {
-		mLOG(OPENGL, ERROR, "%s\n", log);
-	}
-	glLinkProgram(shader->program);
-	glGetProgramInfoLog(shader->program, 1024, 0, log);
-	if (log[0]) {
-		mLOG(OPENGL, ERROR, "%s\n", log);
+		glAttachShader(shader->program, shader->vertexShader);
+		glAttachShader(shader->program, shader->fragmentShader);
+		char log[1024];
+		glCompileShader(shader->fragmentShader);
+		glGetShaderInfoLog(shader->fragmentShader, 1024, 0, log);
+		if (log[0]) {
+			mLOG(OPENGL, ERROR, "%s\n", log);
+		}
+		glCompileShader(shader->vertexShader);
+		glGetShaderInfoLog(shader->vertexShader, 1024, 0, log);
+		if (log[0]) {
+			mLOG(OPENGL, ERROR, "%s\n", log);
+		}
+#ifdef GL_PROGRAM_BINARY_LENGTH
+		if (_programCache && _programBinarySupported()) {
+			glProgramParameteri(shader->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+#endif
+		glLinkProgram(shader->program);
+		glGetProgramInfoLog(shader->program, 1024, 0, log);
+		if (log[0]) {
+			mLOG(OPENGL, ERROR, "%s\n", log);
+		}
+		_saveProgramBinary(shader, key);
 	}
 
 	shader->texLocation = glGetUniformLocation(shader->program, "tex");
@@ -442,6 +736,7 @@ void mGLES2ShaderInit(struct mGLES2Shader* shader, const char* vs, const char* f
 
 void mGLES2ShaderDeinit(struct mGLES2Shader* shader) {
 	glDeleteTextures(1, &shader->tex);
+	glDeleteShader(shader->vertexShader);
 	glDeleteShader(shader->fragmentShader);
 	glDeleteProgram(shader->program);
 	glDeleteFramebuffers(1, &shader->fbo);
@@ -810,6 +1105,10 @@ static bool _loadUniform(struct Configuration* description, size_t pass, struct
 	return true;
 }
 
+void mGLES2ShaderSetProgramCache(struct VDir* cache) {
+	_programCache = cache;
+}
+
 bool mGLES2ShaderLoad(struct VideoShader* shader, struct VDir* dir) {
 	struct VFile* manifest = dir->openFile(dir, "manifest.ini", O_RDONLY);
 	if (!manifest) {
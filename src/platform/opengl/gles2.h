@@ -52,6 +52,7 @@ struct mGLES2Uniform {
 	union mGLES2UniformValue min;
 	union mGLES2UniformValue max;
 	const char* readableName;
+	union mGLES2UniformValue uploaded;
 };
 
 struct mGLES2Shader {
@@ -70,10 +71,18 @@ struct mGLES2Shader {
 	GLuint texSizeLocation;
 	GLuint positionLocation;
 
+	// What the program and its texture currently hold, so unchanged state isn't sent again every frame
+	bool uniformsUploaded;
+	GLfloat texSize[2];
+	int texWidth;
+	int texHeight;
+
 	struct mGLES2Uniform* uniforms;
 	size_t nUniforms;
 };
 
+#define mGLES2_MAX_FRAMES_IN_FLIGHT 4
+
 struct mGLES2Context {
 	struct VideoBackend d;
 
@@ -85,16 +94,39 @@ struct mGLES2Context {
 
 	struct mGLES2Shader* shaders;
 	size_t nShaders;
+
+	// Pixel unpack buffers the core can draw into directly, when the driver can map them
+	GLuint pbo[2];
+	unsigned activePbo;
+	void* mappedFrame;
+
+	// How many drawn frames the driver may queue before drawing another one waits for the oldest.
+	// Set to 0 to let the driver decide. Without fence sync support this does nothing.
+	unsigned framesInFlight;
+#ifdef GL_SYNC_GPU_COMMANDS_COMPLETE
+	GLsync fences[mGLES2_MAX_FRAMES_IN_FLIGHT];
+	unsigned activeFence;
+	bool fencesSupported;
+#endif
 };
 
 void mGLES2ContextCreate(struct mGLES2Context*);
 
+// Maps a buffer of the current dimensions in GPU-visible memory for the next frame to be drawn into,
+// or returns NULL if the driver can't map pixel buffers. Changing the dimensions ends streaming.
+void* mGLES2ContextBeginStreaming(struct mGLES2Context*);
+// Uploads the frame drawn into the mapped buffer and maps the other one, which is returned.
+// Returns NULL and stops streaming if mapping fails, after which frames go through postFrame again.
+void* mGLES2ContextStreamFrame(struct mGLES2Context*);
+
 void mGLES2ShaderInit(struct mGLES2Shader*, const char* vs, const char* fs, int width, int height, bool integerScaling, struct mGLES2Uniform* uniforms, size_t nUniforms);
 void mGLES2ShaderDeinit(struct mGLES2Shader*);
 void mGLES2ShaderAttach(struct mGLES2Context*, struct mGLES2Shader*, size_t nShaders);
 void mGLES2ShaderDetach(struct mGLES2Context*);
 
 struct VDir;
+// Linked programs get stored in and reused from this directory when the driver supports program binaries
+void mGLES2ShaderSetProgramCache(struct VDir*);
 bool mGLES2ShaderLoad(struct VideoShader*, struct VDir*);
 void mGLES2ShaderFree(struct VideoShader*);
 
@@ -14,3 +14,40 @@ void* anonymousMemoryMap(size_t size) {
 void mappedMemoryFree(void* memory, size_t size) {
 	munmap(memory, size);
 }
+
+#if defined(ENABLE_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+#define HUGE_PAGE_SIZE 0x200000
+
+static size_t _hugeSize(size_t size) {
+	return (size + HUGE_PAGE_SIZE - 1) & ~(size_t) (HUGE_PAGE_SIZE - 1);
+}
+
+void* hugeMemoryMap(size_t size) {
+	size = _hugeSize(size);
+	// Over-allocate so the block can be trimmed to huge page alignment, which THP needs
+	uint8_t* memory = mmap(0, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (memory == MAP_FAILED) {
+		return memory;
+	}
+	size_t head = (HUGE_PAGE_SIZE - ((uintptr_t) memory & (HUGE_PAGE_SIZE - 1))) & (HUGE_PAGE_SIZE - 1);
+	if (head) {
+		munmap(memory, head);
+	}
+	munmap(&memory[head + size], HUGE_PAGE_SIZE - head);
+	memory += head;
+	madvise(memory, size, MADV_HUGEPAGE);
+	return memory;
+}
+
+void hugeMemoryFree(void* memory, size_t size) {
+	munmap(memory, _hugeSize(size));
+}
+#else
+void* hugeMemoryMap(size_t size) {
+	return anonymousMemoryMap(size);
+}
+
+void hugeMemoryFree(void* memory, size_t size) {
+	mappedMemoryFree(memory, size);
+}
+#endif
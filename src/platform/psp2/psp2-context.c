@@ -18,7 +18,6 @@
 #include "feature/gui/gui-runner.h"
 #include <mgba/internal/gba/input.h>
 
-#include <mgba-util/memory.h>
 #include <mgba-util/circle-buffer.h>
 #include <mgba-util/math.h>
 #include <mgba-util/threading.h>
@@ -50,8 +49,9 @@ static enum ScreenMode {
 	SM_MAX
 } screenMode;
 
-static void* outputBuffer;
-static vita2d_texture* tex;
+// The core draws straight into one texture while the GPU may still be reading the other
+static vita2d_texture* tex[2];
+static unsigned currentTex;
 static vita2d_texture* screenshot;
 static Thread audioThread;
 
@@ -253,8 +253,7 @@ static void _postAudioBuffer(struct mAVStream* stream, blip_t* left, blip_t* rig
 		ConditionWait(&audioContext.cond, &audioContext.mutex);
 	}
 	struct GBAStereoSample* samples = &audioContext.buffer[audioContext.writeOffset];
-	blip_read_samples(left, &samples[0].left, PSP2_SAMPLES, true);
-	blip_read_samples(right, &samples[0].right, PSP2_SAMPLES, true);
+	blip_read_samples_stereo(left, right, &samples[0].left, PSP2_SAMPLES);
 	audioContext.samples += PSP2_SAMPLES;
 	audioContext.writeOffset += PSP2_SAMPLES;
 	if (audioContext.writeOffset >= PSP2_AUDIO_BUFFER_SIZE) {
@@ -321,11 +320,12 @@ void mPSP2Setup(struct mGUIRunner* runner) {
 
 	unsigned width, height;
 	runner->core->desiredVideoDimensions(runner->core, &width, &height);
-	tex = vita2d_create_empty_texture_format(256, toPow2(height), SCE_GXM_TEXTURE_FORMAT_X8U8U8U8_1BGR);
+	tex[0] = vita2d_create_empty_texture_format(256, toPow2(height), SCE_GXM_TEXTURE_FORMAT_X8U8U8U8_1BGR);
+	tex[1] = vita2d_create_empty_texture_format(256, toPow2(height), SCE_GXM_TEXTURE_FORMAT_X8U8U8U8_1BGR);
 	screenshot = vita2d_create_empty_texture_format(256, toPow2(height), SCE_GXM_TEXTURE_FORMAT_X8U8U8U8_1BGR);
 
-	outputBuffer = anonymousMemoryMap(256 * toPow2(height) * 4);
-	runner->core->setVideoBuffer(runner->core, outputBuffer, 256);
+	currentTex = 0;
+	runner->core->setVideoBuffer(runner->core, vita2d_texture_get_datap(tex[currentTex]), 256);
 	runner->core->setAudioBufferSize(runner->core, PSP2_SAMPLES);
 
 	rotation.d.sample = _sampleRotation;
@@ -456,9 +456,9 @@ void mPSP2Unpaused(struct mGUIRunner* runner) {
 void mPSP2Teardown(struct mGUIRunner* runner) {
 	UNUSED(runner);
 	CircleBufferDeinit(&rumble.history);
-	vita2d_free_texture(tex);
+	vita2d_free_texture(tex[0]);
+	vita2d_free_texture(tex[1]);
 	vita2d_free_texture(screenshot);
-	mappedMemoryFree(outputBuffer, 256 * 256 * 4);
 	frameLimiter = true;
 }
 
@@ -523,12 +523,19 @@ void _drawTex(vita2d_texture* t, unsigned width, unsigned height, bool faded) {
 	                                    (faded ? 0 : 0xC0000000) | 0x3FFFFFFF);
 }
 
+void mPSP2PrepareForFrame(struct mGUIRunner* runner) {
+	// Skipped frames leave the buffer untouched, so keep drawing into the one holding the last frame
+	if (runner->core->opts.frameskip) {
+		return;
+	}
+	currentTex = !currentTex;
+	runner->core->setVideoBuffer(runner->core, vita2d_texture_get_datap(tex[currentTex]), 256);
+}
+
 void mPSP2Draw(struct mGUIRunner* runner, bool faded) {
 	unsigned width, height;
 	runner->core->desiredVideoDimensions(runner->core, &width, &height);
-	void* texpixels = vita2d_texture_get_datap(tex);
-	memcpy(texpixels, outputBuffer, 256 * height * 4);
-	_drawTex(tex, width, height, faded);
+	_drawTex(tex[currentTex], width, height, faded);
 }
 
 void mPSP2DrawScreenshot(struct mGUIRunner* runner, const uint32_t* pixels, unsigned width, unsigned height, bool faded) {
@@ -51,3 +51,11 @@ void mappedMemoryFree(void* memory, size_t size) {
 		}
 	}
 }
+
+void* hugeMemoryMap(size_t size) {
+	return anonymousMemoryMap(size);
+}
+
+void hugeMemoryFree(void* memory, size_t size) {
+	mappedMemoryFree(memory, size);
+}
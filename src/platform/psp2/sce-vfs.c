@@ -18,6 +18,8 @@ struct VFileSce {
 	struct VFile d;
 
 	SceUID fd;
+	const uint8_t* mapped;
+	size_t mappedSize;
 };
 
 struct VDirEntrySce {
@@ -74,6 +76,8 @@ struct VFile* VFileOpenSce(const char* path, int flags, SceMode mode) {
 		return 0;
 	}
 
+	vfsce->mapped = NULL;
+	vfsce->mappedSize = 0;
 	vfsce->d.close = _vfsceClose;
 	vfsce->d.seek = _vfsceSeek;
 	vfsce->d.read = _vfsceRead;
@@ -118,6 +122,8 @@ static void* _vfsceMap(struct VFile* vf, size_t size, int flags) {
 		sceIoLseek(vfsce->fd, 0, SEEK_SET);
 		sceIoRead(vfsce->fd, buffer, size);
 		sceIoLseek(vfsce->fd, cur, SEEK_SET);
+		vfsce->mapped = buffer;
+		vfsce->mappedSize = size;
 	}
 	return buffer;
 }
@@ -129,6 +135,10 @@ static void _vfsceUnmap(struct VFile* vf, void* memory, size_t size) {
 	sceIoWrite(vfsce->fd, memory, size);
 	sceIoLseek(vfsce->fd, cur, SEEK_SET);
 	sceIoSyncByFd(vfsce->fd);
+	if (memory == vfsce->mapped) {
+		vfsce->mapped = NULL;
+		vfsce->mappedSize = 0;
+	}
 	mappedMemoryFree(memory, size);
 }
 
@@ -150,7 +160,11 @@ bool _vfsceSync(struct VFile* vf, const void* buffer, size_t size) {
 	struct VFileSce* vfsce = (struct VFileSce*) vf;
 	if (buffer && size) {
 		SceOff cur = sceIoLseek(vfsce->fd, 0, SEEK_CUR);
-		sceIoLseek(vfsce->fd, 0, SEEK_SET);
+		SceOff offset = 0;
+		if ((const uint8_t*) buffer > vfsce->mapped && (const uint8_t*) buffer < vfsce->mapped + vfsce->mappedSize) {
+			offset = (const uint8_t*) buffer - vfsce->mapped;
+		}
+		sceIoLseek(vfsce->fd, offset, SEEK_SET);
 		sceIoWrite(vfsce->fd, buffer, size);
 		sceIoLseek(vfsce->fd, cur, SEEK_SET);
 	}
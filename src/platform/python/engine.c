@@ -44,6 +44,9 @@ struct mPythonScriptEngine* mPythonCreateScriptEngine(void) {
 #ifdef USE_DEBUGGERS
 	engine->d.debuggerEntered = mPythonScriptDebuggerEntered;
 #endif
+	engine->d.frameStarted = NULL;
+	engine->d.frameEnded = NULL;
+	engine->d.memoryWritten = NULL;
 	engine->sb = NULL;
 	return engine;
 }
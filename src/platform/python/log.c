@@ -5,17 +5,102 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "log.h"
 
+#include <mgba-util/threading.h>
+
+struct mLoggerPyState {
+	struct mLogFilter filter;
+	Mutex mutex;
+	size_t batchSize;
+	size_t queued;
+	struct mLoggerPyMessage queue[mLOGGER_PY_MAX_BATCH];
+};
+
+static void _flush(struct mLoggerPy* pylogger) {
+	struct mLoggerPyState* state = pylogger->state;
+	if (state->queued) {
+		_pyLogBatch(pylogger, state->queue, state->queued);
+		state->queued = 0;
+	}
+}
+
 static void _pyLogShim(struct mLogger* logger, int category, enum mLogLevel level, const char* format, va_list args) {
 	struct mLoggerPy* pylogger = (struct mLoggerPy*) logger;
-	char message[256] = {0};
-	vsnprintf(message, sizeof(message) - 1, format, args);
-	_pyLog(pylogger, category, level, message);
+	struct mLoggerPyState* state = pylogger->state;
+	MutexLock(&state->mutex);
+	if (state->batchSize <= 1) {
+		MutexUnlock(&state->mutex);
+		char message[mLOGGER_PY_MESSAGE_LENGTH] = {0};
+		vsnprintf(message, sizeof(message) - 1, format, args);
+		_pyLog(pylogger, category, level, message);
+		return;
+	}
+	struct mLoggerPyMessage* entry = &state->queue[state->queued];
+	entry->category = category;
+	entry->level = level;
+	vsnprintf(entry->message, sizeof(entry->message), format, args);
+	++state->queued;
+	if (state->queued >= state->batchSize || level == mLOG_FATAL) {
+		_flush(pylogger);
+	}
+	MutexUnlock(&state->mutex);
 }
 
 struct mLogger* mLoggerPythonCreate(void* pyobj) {
 	struct mLoggerPy* logger = malloc(sizeof(*logger));
+	struct mLoggerPyState* state = malloc(sizeof(*state));
+	mLogFilterInit(&state->filter);
+	state->filter.defaultLevels = mLOG_ALL;
+	MutexInit(&state->mutex);
+	state->batchSize = 0;
+	state->queued = 0;
 	logger->d.log = _pyLogShim;
-	logger->d.filter = NULL;
+	logger->d.filter = &state->filter;
 	logger->pyobj = pyobj;
+	logger->state = state;
 	return &logger->d;
 }
+
+void mLoggerPythonDestroy(struct mLogger* logger) {
+	struct mLoggerPy* pylogger = (struct mLoggerPy*) logger;
+	// Python is tearing this logger down, so anything still queued can't be delivered
+	mLogFilterDeinit(&pylogger->state->filter);
+	MutexDeinit(&pylogger->state->mutex);
+	free(pylogger->state);
+	free(pylogger);
+}
+
+void mLoggerPythonSetLevels(struct mLogger* logger, const char* category, int levels) {
+	struct mLoggerPy* pylogger = (struct mLoggerPy*) logger;
+	if (category) {
+		mLogFilterSet(&pylogger->state->filter, category, levels);
+	} else {
+		pylogger->state->filter.defaultLevels = levels;
+	}
+}
+
+void mLoggerPythonResetLevels(struct mLogger* logger, const char* category) {
+	struct mLoggerPy* pylogger = (struct mLoggerPy*) logger;
+	if (category) {
+		mLogFilterReset(&pylogger->state->filter, category);
+	} else {
+		pylogger->state->filter.defaultLevels = mLOG_ALL;
+	}
+}
+
+void mLoggerPythonSetBatchSize(struct mLogger* logger, size_t batchSize) {
+	struct mLoggerPy* pylogger = (struct mLoggerPy*) logger;
+	if (batchSize > mLOGGER_PY_MAX_BATCH) {
+		batchSize = mLOGGER_PY_MAX_BATCH;
+	}
+	MutexLock(&pylogger->state->mutex);
+	_flush(pylogger);
+	pylogger->state->batchSize = batchSize;
+	MutexUnlock(&pylogger->state->mutex);
+}
+
+void mLoggerPythonFlush(struct mLogger* logger) {
+	struct mLoggerPy* pylogger = (struct mLoggerPy*) logger;
+	MutexLock(&pylogger->state->mutex);
+	_flush(pylogger);
+	MutexUnlock(&pylogger->state->mutex);
+}
@@ -7,11 +7,34 @@
 
 #include "pycommon.h"
 
+#define mLOGGER_PY_MESSAGE_LENGTH 256
+#define mLOGGER_PY_MAX_BATCH 64
+
+struct mLoggerPyMessage {
+    int category;
+    enum mLogLevel level;
+    char message[mLOGGER_PY_MESSAGE_LENGTH];
+};
+
+struct mLoggerPyState;
 struct mLoggerPy {
     struct mLogger d;
     void* pyobj;
+    struct mLoggerPyState* state;
 };
 
 struct mLogger* mLoggerPythonCreate(void* pyobj);
+void mLoggerPythonDestroy(struct mLogger*);
+
+// Messages are filtered before they're formatted, so anything filtered out never reaches Python.
+// A NULL category sets the levels used by categories that weren't given their own.
+void mLoggerPythonSetLevels(struct mLogger*, const char* category, int levels);
+void mLoggerPythonResetLevels(struct mLogger*, const char* category);
+
+// With a batch size above 1, messages are held back and handed to Python that many at a time.
+// Fatal messages, and changing the batch size, deliver whatever is waiting first.
+void mLoggerPythonSetBatchSize(struct mLogger*, size_t batchSize);
+void mLoggerPythonFlush(struct mLogger*);
 
 PYEXPORT void _pyLog(void* logger, int category, enum mLogLevel level, const char* message);
+PYEXPORT void _pyLogBatch(void* logger, const struct mLoggerPyMessage* messages, size_t count);
@@ -0,0 +1,71 @@
+# Copyright (c) 2013-2019 Jeffrey Pfau
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+from ._pylib import ffi, lib  # pylint: disable=no-name-in-module
+
+try:
+    import numpy
+except ImportError:
+    pass
+
+
+class Batch(object):
+    def __init__(self, cores, threads=1):
+        self.cores = list(cores)
+        if not self.cores:
+            raise ValueError("Batch needs at least one core")
+        self._native = ffi.gc(ffi.new("struct mCoreBatch*"), lib.mCoreBatchDeinit)
+        lib.mCoreBatchInit(self._native, threads)
+        self._list = ffi.new("struct mCore*[]", [core._core for core in self.cores])
+
+        # Every core draws straight into its own slice of one shared buffer, so observations never get copied
+        dimensions = [core.desired_video_dimensions() for core in self.cores]
+        self.width = max(width for width, _ in dimensions)
+        self.height = max(height for _, height in dimensions)
+        self._frame_size = self.width * self.height
+        self.buffer = ffi.new("color_t[{}]".format(self._frame_size * len(self.cores)))
+        for i, core in enumerate(self.cores):
+            core._core.setVideoBuffer(core._core, self.buffer + i * self._frame_size, self.width)
+
+    def __len__(self):
+        return len(self.cores)
+
+    def _keys(self, keys, frames):
+        count = len(self.cores)
+        if keys is None:
+            return None, ffi.NULL
+        if isinstance(keys, (list, tuple)):
+            if len(keys) == count:
+                # One set of keys per core, held for every frame
+                keys = [key for key in keys for _ in range(frames)]
+            if len(keys) != count * frames:
+                raise ValueError("Expected {} or {} keys".format(count, count * frames))
+            native = ffi.new("uint32_t[]", keys)
+            return native, native
+        # Anything exporting the buffer protocol, e.g. a numpy uint32 array of shape (cores, frames)
+        native = ffi.from_buffer(keys)
+        if len(native) != count * frames * ffi.sizeof("uint32_t"):
+            raise ValueError("Expected {} 32-bit keys".format(count * frames))
+        return native, ffi.cast("uint32_t*", native)
+
+    def step(self, frames=1, keys=None, render_last=True):
+        for core in self.cores:
+            if not core._was_reset:
+                raise RuntimeError("Core must be reset first")
+            if core._protected:
+                raise RuntimeError("Core is protected")
+        # Keep the owner alive for the duration of the call; cffi drops the GIL while the cores run
+        owner, native = self._keys(keys, frames)
+        lib.mCoreBatchStep(self._native, self._list, len(self.cores), frames, native, render_last)
+        del owner
+
+    def to_buffer(self):
+        return ffi.buffer(self.buffer)
+
+    if 'numpy' in globals():
+        def to_numpy(self):
+            if ffi.sizeof("color_t") == 2:
+                return numpy.frombuffer(self.to_buffer(), dtype=numpy.uint16).reshape(len(self.cores), self.height, self.width)
+            return numpy.frombuffer(self.to_buffer(), dtype=numpy.uint8).reshape(len(self.cores), self.height, self.width, 4)
@@ -5,6 +5,7 @@
 # file, You can obtain one at http://mozilla.org/MPL/2.0/.
 from ._pylib import ffi, lib  # pylint: disable=no-name-in-module
 from . import tile, audio
+from .memory import memory_blocks
 from cached_property import cached_property
 from functools import wraps
 
@@ -126,6 +127,7 @@ class Core(object):
     def __init__(self, native):
         self._core = native
         self._was_reset = False
+        self._rom_vf = None
         self._protected = False
         self._callbacks = CoreCallbacks()
         self._core.addCoreCallbacks(self._core, self._callbacks.context)
@@ -187,7 +189,12 @@ class Core(object):
 
     @protected
     def load_rom(self, vfile):
-        return bool(self._core.loadROM(self._core, vfile.handle))
+        res = bool(self._core.loadROM(self._core, vfile.handle))
+        if res:
+            # The core closes the ROM itself, but anything the file wraps has to outlive it
+            vfile._claimed = True
+            self._rom_vf = vfile
+        return res
 
     @protected
     def load_bios(self, vfile, id=0):
@@ -342,9 +349,15 @@ class Core(object):
     def add_frame_callback(self, callback):
         self._callbacks.video_frame_ended.append(callback)
 
+    @property
+    def memory_blocks(self):
+        return {block.name: block for block in memory_blocks(self._core)}
+
     @property
     def crc32(self):
-        return self._native.romCrc32
+        crc32 = ffi.new("uint32_t*")
+        self._core.checksum(self._core, crc32, lib.CHECKSUM_CRC32)
+        return crc32[0]
 
 
 class ICoreOwner(object):
@@ -11,6 +11,11 @@ try:
 except ImportError:
     pass
 
+try:
+    import numpy
+except ImportError:
+    pass
+
 
 class Image:
     def __init__(self, width, height, stride=0, alpha=False):
@@ -38,6 +43,18 @@ class Image:
             return PImage.frombytes(colorspace, (self.width, self.height), ffi.buffer(self.buffer), "raw",
                                     colorspace, self.stride * 4)
 
+    def to_buffer(self):
+        # Shares memory with the image, so it stays current when this is the core's video buffer
+        return ffi.buffer(self.buffer)
+
+    if 'numpy' in globals():
+        def to_numpy(self):
+            if ffi.sizeof("color_t") == 2:
+                pixels = numpy.frombuffer(self.to_buffer(), dtype=numpy.uint16).reshape(self.height, self.stride)
+            else:
+                pixels = numpy.frombuffer(self.to_buffer(), dtype=numpy.uint8).reshape(self.height, self.stride, 4)
+            return pixels[:, :self.width]
+
 
 def u16_to_u32(color):
     # pylint: disable=invalid-name
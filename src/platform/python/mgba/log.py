@@ -7,6 +7,7 @@ from ._pylib import ffi, lib  # pylint: disable=no-name-in-module
 from . import create_callback
 
 create_callback("mLoggerPy", "log", "_pyLog")
+create_callback("mLoggerPy", "log_batch", "_pyLogBatch")
 
 
 def install_default(logger):
@@ -28,14 +29,49 @@ class Logger(object):
 
     _DEFAULT_LOGGER = None
 
-    def __init__(self):
+    def __init__(self, batch_size=0):
         self._handle = ffi.new_handle(self)
-        self._native = ffi.gc(lib.mLoggerPythonCreate(self._handle), lib.free)
+        self._native = ffi.gc(lib.mLoggerPythonCreate(self._handle), lib.mLoggerPythonDestroy)
+        if batch_size:
+            self.set_batch_size(batch_size)
 
     @staticmethod
     def category_name(category):
         return ffi.string(lib.mLogCategoryName(category)).decode('UTF-8')
 
+    @staticmethod
+    def _category_id(category):
+        if category is None:
+            return ffi.NULL
+        if isinstance(category, int):
+            category = lib.mLogCategoryId(category)
+            if category == ffi.NULL:
+                raise ValueError("Unknown log category")
+            return category
+        return category.encode('UTF-8')
+
+    def set_levels(self, levels, category=None):
+        """Only pass on messages at the given levels, checked before they ever reach Python.
+
+        Without a category, this applies to every category not given levels of its own."""
+        lib.mLoggerPythonSetLevels(self._native, self._category_id(category), levels)
+
+    def reset_levels(self, category=None):
+        lib.mLoggerPythonResetLevels(self._native, self._category_id(category))
+
+    def set_batch_size(self, size):
+        """Deliver messages this many at a time, or as they come if 1 or less. Call flush to get
+        the rest before the batch fills."""
+        lib.mLoggerPythonSetBatchSize(self._native, size)
+
+    def flush(self):
+        lib.mLoggerPythonFlush(self._native)
+
+    def log_batch(self, messages, count):
+        for i in range(count):
+            message = messages[i]
+            self.log(message.category, message.level, message.message)
+
     @classmethod
     def install_default(cls, logger):
         cls._DEFAULT_LOGGER = logger
@@ -46,5 +82,9 @@ class Logger(object):
 
 
 class NullLogger(Logger):
+    def __init__(self):
+        super(NullLogger, self).__init__()
+        self.set_levels(0)
+
     def log(self, category, level, message):
         pass
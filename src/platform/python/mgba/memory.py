@@ -5,6 +5,11 @@
 # file, You can obtain one at http://mozilla.org/MPL/2.0/.
 from ._pylib import ffi, lib  # pylint: disable=no-name-in-module
 
+try:
+    import numpy
+except ImportError:
+    pass
+
 
 class MemoryView(object):
     def __init__(self, core, width, size, base=0, sign="u"):
@@ -68,6 +73,40 @@ class MemoryView(object):
         self._raw_write(self._core, self._base + address, segment, value & self._mask)
 
 
+class MemoryBlock(object):
+    def __init__(self, core, native):
+        self._core = core
+        self.id = native.id
+        self.name = ffi.string(native.shortName).decode("ascii")
+        self.long_name = ffi.string(native.longName).decode("ascii")
+        self.start = native.start
+        self.end = native.end
+        self.size = native.size
+        self.flags = native.flags
+        self.max_segment = native.maxSegment
+
+    def to_buffer(self):
+        # The core can reallocate a block, e.g. when save data is loaded, so this has to be fetched again afterwards
+        size = ffi.new("size_t*")
+        data = self._core.getMemoryBlock(self._core, self.id, size)
+        if data == ffi.NULL:
+            return None
+        return ffi.buffer(ffi.cast("uint8_t*", data), size[0])
+
+    if 'numpy' in globals():
+        def to_numpy(self, dtype=None):
+            data = self.to_buffer()
+            if data is None:
+                return None
+            return numpy.frombuffer(data, dtype=dtype or numpy.uint8)
+
+
+def memory_blocks(core):
+    blocks = ffi.new("struct mCoreMemoryBlock**")
+    count = core.listMemoryBlocks(core, blocks)
+    return [MemoryBlock(core, blocks[0][i]) for i in range(count)]
+
+
 class MemorySearchResult(object):
     def __init__(self, memory, result):
         self.address = result.address
@@ -126,6 +165,26 @@ class Memory(object):
     def __len__(self):
         return self.size
 
+    def _block(self):
+        for block in memory_blocks(self._core):
+            if block.start == self.base and self.base + self.size <= block.end:
+                return block
+        return None
+
+    def to_buffer(self):
+        # Side-effect-free view of the backing storage, every bank included; None if this isn't a plain memory block
+        block = self._block()
+        if not block:
+            return None
+        return block.to_buffer()
+
+    if 'numpy' in globals():
+        def to_numpy(self, dtype=None):
+            block = self._block()
+            if not block:
+                return None
+            return block.to_numpy(dtype)
+
     def search(self, value, type=SEARCH_GUESS, flags=RW, limit=10000, old_results=[]):
         results = ffi.new("struct mCoreMemorySearchResults*")
         lib.mCoreMemorySearchResultsInit(results, len(old_results))
@@ -27,6 +27,12 @@ class CacheSet:
         self.cache = ffi.gc(ffi.new("struct mCacheSet*"), core._deinit_cache)
         core._init_cache(self.cache)
 
+    def defer(self, vram_size, palette_size):
+        lib.mCacheSetDefer(self.cache, vram_size, palette_size)
+
+    def apply_deferred(self):
+        return lib.mCacheSetApplyDeferred(self.cache)
+
 
 class TileView:
     def __init__(self, cache):
@@ -35,6 +41,9 @@ class TileView:
     def get_tile(self, tile, palette):
         return Tile(lib.mTileCacheGetTile(self.cache, tile, palette))
 
+    def regenerate_dirty(self, palette):
+        return lib.mTileCacheRegenerateDirty(self.cache, palette)
+
 
 class MapView:
     def __init__(self, cache):
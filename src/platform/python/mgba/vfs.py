@@ -81,11 +81,27 @@ def _vfpSync(vf, buffer, size):
 
 
 def open(f):  # pylint: disable=redefined-builtin
+    if isinstance(f, (bytes, bytearray, memoryview)):
+        return open_buffer(f)
     handle = ffi.new_handle(f)
     vf = VFile(lib.VFileFromPython(handle), _no_gc=(f, handle))
     return vf
 
 
+def open_buffer(buf):
+    # Reads, writes and maps go straight to the buffer's memory instead of calling back into Python.
+    # Read-only buffers give a read-only file; writable ones are written in place and can't grow.
+    view = memoryview(buf).cast("B")
+    data = ffi.from_buffer(view)
+    if view.readonly:
+        vf = lib.VFileFromConstMemory(data, len(view))
+    else:
+        vf = lib.VFileFromMemory(data, len(view))
+    if vf == ffi.NULL:
+        return None
+    return VFile(vf, _no_gc=(buf, view, data))
+
+
 def open_path(path, mode="r"):
     flags = 0
     if mode.startswith("r"):
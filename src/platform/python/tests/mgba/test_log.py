@@ -0,0 +1,55 @@
+import pytest
+
+import mgba.log as log
+from mgba._pylib import ffi, lib
+
+
+class Collector(log.Logger):
+    def __init__(self, **kwargs):
+        super(Collector, self).__init__(**kwargs)
+        self.messages = []
+
+    def log(self, category, level, message):
+        self.messages.append((level, ffi.string(message)))
+
+
+@pytest.fixture
+def category():
+    return lib.mLogGenerateCategory(b"Python Test", b"test.python")
+
+
+@pytest.fixture
+def collector():
+    logger = Collector()
+    log.install_default(logger)
+    yield logger
+    lib.mLogSetDefaultLogger(ffi.NULL)
+
+
+def _log(category, level, text):
+    lib.mLog(category, level, b"%s", ffi.new("char[]", text))
+
+
+def test_log_levels(collector, category):
+    collector.set_levels(log.Logger.WARN | log.Logger.ERROR)
+    _log(category, log.Logger.INFO, b"info")
+    _log(category, log.Logger.WARN, b"warn")
+    assert collector.messages == [(log.Logger.WARN, b"warn")]
+
+
+def test_log_category_levels(collector, category):
+    collector.set_levels(0)
+    collector.set_levels(log.Logger.INFO, "test.python")
+    _log(category, log.Logger.INFO, b"info")
+    collector.reset_levels("test.python")
+    _log(category, log.Logger.INFO, b"dropped")
+    assert collector.messages == [(log.Logger.INFO, b"info")]
+
+
+def test_log_batch(collector, category):
+    collector.set_batch_size(4)
+    for i in range(5):
+        _log(category, log.Logger.INFO, b"%i" % i)
+    assert len(collector.messages) == 4
+    collector.flush()
+    assert [message for _, message in collector.messages] == [b"0", b"1", b"2", b"3", b"4"]
@@ -62,3 +62,33 @@ def test_vfs_seek():
 def test_vfs_open_path_invalid():
     vf = vfs.open_path('.invalid')
     assert not vf
+
+
+def test_vfs_open_bytes():
+    vf = vfs.open(b'import pytest')
+    assert vf
+    assert vf.size() == 13
+    buffer = ffi.new('char[6]')
+    assert vf.read(buffer, 6) == 6
+    assert ffi.string(buffer) == b'import'
+    # Read-only buffers can't be written through
+    assert vf.write(ffi.new('char[]', b'x'), 1) <= 0
+    vf.close()
+
+
+def test_vfs_open_bytearray():
+    data = bytearray(b'import pytest')
+    vf = vfs.open(data)
+    assert vf
+    assert vf.seek(7, os.SEEK_SET) == 7
+    assert vf.write(ffi.new('char[]', b'PYTEST'), 6) == 6
+    assert data == bytearray(b'import PYTEST')
+    vf.close()
+
+
+def test_vfs_open_memoryview():
+    data = b'0123456789'
+    vf = vfs.open(memoryview(data)[2:6])
+    assert vf
+    assert vf.read_all() == b'2345'
+    vf.close()
@@ -31,6 +31,9 @@ void AssetView::updateTiles() {
 }
 
 void AssetView::updateTiles(bool force) {
+	if (m_cacheSet) {
+		mCacheSetApplyDeferred(m_cacheSet);
+	}
 	switch (m_controller->platform()) {
 #ifdef M_CORE_GBA
 	case PLATFORM_GBA:
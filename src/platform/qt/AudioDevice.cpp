@@ -27,12 +27,9 @@ void AudioDevice::setFormat(const QAudioFormat& format) {
 		return;
 	}
 	double fauxClock = GBAAudioCalculateRatio(1, m_context->impl->sync.fpsTarget, 1);
-	mCoreSyncLockAudio(&m_context->impl->sync);
-	blip_set_rates(m_context->core->getAudioChannel(m_context->core, 0),
-		           m_context->core->frequency(m_context->core), format.sampleRate() * fauxClock);
-	blip_set_rates(m_context->core->getAudioChannel(m_context->core, 1),
-		           m_context->core->frequency(m_context->core), format.sampleRate() * fauxClock);
-	mCoreSyncUnlockAudio(&m_context->impl->sync);
+	mCoreSyncSetAudioRates(&m_context->impl->sync, m_context->core->getAudioChannel(m_context->core, 0),
+	                       m_context->core->getAudioChannel(m_context->core, 1),
+	                       m_context->core->frequency(m_context->core), format.sampleRate() * fauxClock);
 }
 
 void AudioDevice::setInput(mCoreThread* input) {
@@ -49,13 +46,21 @@ qint64 AudioDevice::readData(char* data, qint64 maxSize) {
 		return 0;
 	}
 
+	if (mCoreSyncHasAudioRing(&m_context->impl->sync)) {
+		size_t available = mCoreSyncAudioAvailable(&m_context->impl->sync);
+		if (available > maxSize / sizeof(GBAStereoSample)) {
+			available = maxSize / sizeof(GBAStereoSample);
+		}
+		available = mCoreSyncReadAudio(&m_context->impl->sync, reinterpret_cast<int16_t*>(data), available);
+		return available * sizeof(GBAStereoSample);
+	}
+
 	mCoreSyncLockAudio(&m_context->impl->sync);
 	int available = blip_samples_avail(m_context->core->getAudioChannel(m_context->core, 0));
 	if (available > maxSize / sizeof(GBAStereoSample)) {
 		available = maxSize / sizeof(GBAStereoSample);
 	}
-	blip_read_samples(m_context->core->getAudioChannel(m_context->core, 0), &reinterpret_cast<GBAStereoSample*>(data)->left, available, true);
-	blip_read_samples(m_context->core->getAudioChannel(m_context->core, 1), &reinterpret_cast<GBAStereoSample*>(data)->right, available, true);
+	blip_read_samples_stereo(m_context->core->getAudioChannel(m_context->core, 0), m_context->core->getAudioChannel(m_context->core, 1), reinterpret_cast<short*>(data), available);
 	mCoreSyncConsumeAudio(&m_context->impl->sync);
 	return available * sizeof(GBAStereoSample);
 }
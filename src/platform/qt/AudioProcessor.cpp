@@ -62,3 +62,7 @@ void AudioProcessor::stop() {
 void AudioProcessor::setBufferSamples(int samples) {
 	m_samples = samples;
 }
+
+void AudioProcessor::setLowLatency(bool lowLatency) {
+	m_lowLatency = lowLatency;
+}
@@ -35,6 +35,7 @@ public:
 	~AudioProcessor();
 
 	int getBufferSamples() const { return m_samples; }
+	bool isLowLatency() const { return m_lowLatency; }
 	virtual unsigned sampleRate() const = 0;
 
 public slots:
@@ -45,6 +46,7 @@ public slots:
 	virtual void pause() = 0;
 
 	virtual void setBufferSamples(int samples) = 0;
+	virtual void setLowLatency(bool lowLatency);
 	virtual void inputParametersChanged() = 0;
 
 	virtual void requestSampleRate(unsigned) = 0;
@@ -55,6 +57,7 @@ protected:
 private:
 	std::shared_ptr<CoreController> m_context;
 	int m_samples = 2048;
+	bool m_lowLatency = false;
 	static Driver s_driver;
 };
 
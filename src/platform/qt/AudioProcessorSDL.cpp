@@ -61,6 +61,17 @@ void AudioProcessorSDL::setBufferSamples(int samples) {
 	}
 }
 
+void AudioProcessorSDL::setLowLatency(bool lowLatency) {
+	AudioProcessor::setLowLatency(lowLatency);
+	if (m_audio.pull != lowLatency) {
+		m_audio.pull = lowLatency;
+		if (m_audio.core) {
+			mSDLDeinitAudio(&m_audio);
+			mSDLInitAudio(&m_audio, input());
+		}
+	}
+}
+
 void AudioProcessorSDL::inputParametersChanged() {
 }
 
@@ -28,6 +28,7 @@ public slots:
 	virtual void pause() override;
 
 	virtual void setBufferSamples(int samples) override;
+	virtual void setLowLatency(bool lowLatency) override;
 	virtual void inputParametersChanged() override;
 
 	virtual void requestSampleRate(unsigned) override;
@@ -14,6 +14,8 @@
 #include <QDateTime>
 #include <QMutexLocker>
 
+#include <utility>
+
 #include <mgba/core/serialize.h>
 #include <mgba/feature/video-logger.h>
 #ifdef M_CORE_GBA
@@ -82,8 +84,7 @@ CoreController::CoreController(mCore* core, QObject* parent)
 		controller->m_resetActions.clear();
 
 		if (!controller->m_hwaccel) {
-			controller->m_activeBuffer = &controller->m_buffers[0];
-			context->core->setVideoBuffer(context->core, reinterpret_cast<color_t*>(controller->m_activeBuffer->data()), controller->screenDimensions().width());
+			context->core->setVideoBuffer(context->core, reinterpret_cast<color_t*>(controller->m_buffers[controller->m_activeBuffer].data()), controller->screenDimensions().width());
 		}
 
 		QMetaObject::invokeMethod(controller, "didReset");
@@ -104,6 +105,11 @@ CoreController::CoreController(mCore* core, QObject* parent)
 		controller->finishFrame();
 	};
 
+	m_threadContext.keysReadCallback = [](mCoreThread* context) {
+		CoreController* controller = static_cast<CoreController*>(context->userData);
+		controller->updateKeys();
+	};
+
 	m_threadContext.cleanCallback = [](mCoreThread* context) {
 		CoreController* controller = static_cast<CoreController*>(context->userData);
 
@@ -204,7 +210,19 @@ const color_t* CoreController::drawContext() {
 	if (m_hwaccel) {
 		return nullptr;
 	}
-	return reinterpret_cast<const color_t*>(m_completeBuffer.constData());
+	return reinterpret_cast<const color_t*>(m_buffers[m_frameReady ? m_readyBuffer : m_frontBuffer].constData());
+}
+
+const color_t* CoreController::takeFrame() {
+	QMutexLocker locker(&m_mutex);
+	if (m_hwaccel) {
+		return nullptr;
+	}
+	if (m_frameReady) {
+		std::swap(m_frontBuffer, m_readyBuffer);
+		m_frameReady = false;
+	}
+	return reinterpret_cast<const color_t*>(m_buffers[m_frontBuffer].constData());
 }
 
 bool CoreController::isPaused() {
@@ -233,6 +251,7 @@ void CoreController::loadConfig(ConfigController* config) {
 	m_fastForwardRatio = config->getOption("fastForwardRatio", m_fastForwardRatio).toFloat();
 	m_videoSync = config->getOption("videoSync", m_videoSync).toInt();
 	m_audioSync = config->getOption("audioSync", m_audioSync).toInt();
+	m_framePacing = config->getOption("framePacing", m_framePacing).toInt();
 	m_fpsTarget = config->getOption("fpsTarget").toFloat();
 	m_autosave = config->getOption("autosave", false).toInt();
 	m_autoload = config->getOption("autoload", true).toInt();
@@ -294,6 +313,7 @@ mCacheSet* CoreController::graphicCaches() {
 		m_cacheSet = std::make_unique<mCacheSet>();
 		GBAVideoCacheInit(m_cacheSet.get());
 		GBAVideoCacheAssociate(m_cacheSet.get(), &gba->video);
+		mCacheSetDefer(m_cacheSet.get(), SIZE_VRAM, SIZE_PALETTE_RAM / 2);
 		break;
 	}
 #endif
@@ -303,6 +323,7 @@ mCacheSet* CoreController::graphicCaches() {
 		m_cacheSet = std::make_unique<mCacheSet>();
 		GBVideoCacheInit(m_cacheSet.get());
 		GBVideoCacheAssociate(m_cacheSet.get(), &gb->video);
+		mCacheSetDefer(m_cacheSet.get(), GB_SIZE_VRAM, 64);
 		break;
 	}
 #endif
@@ -335,14 +356,16 @@ void CoreController::setLogger(LogController* logger) {
 void CoreController::start() {
 	if (!m_hwaccel) {
 		QSize size(1024, 2048);
-		m_buffers[0].resize(size.width() * size.height() * sizeof(color_t));
-		m_buffers[1].resize(size.width() * size.height() * sizeof(color_t));
-		m_buffers[0].fill(0xFF);
-		m_buffers[1].fill(0xFF);
-		m_activeBuffer = &m_buffers[0];
-		m_completeBuffer = m_buffers[0];
+		for (auto& buffer : m_buffers) {
+			buffer.resize(size.width() * size.height() * sizeof(color_t));
+			buffer.fill(0xFF);
+		}
+		m_activeBuffer = 0;
+		m_readyBuffer = 1;
+		m_frontBuffer = 2;
+		m_frameReady = false;
 
-		m_threadContext.core->setVideoBuffer(m_threadContext.core, reinterpret_cast<color_t*>(m_activeBuffer->data()), size.width());
+		m_threadContext.core->setVideoBuffer(m_threadContext.core, reinterpret_cast<color_t*>(m_buffers[m_activeBuffer].data()), size.width());
 	}
 
 	if (!m_patched) {
@@ -399,9 +422,11 @@ void CoreController::setSync(bool sync) {
 	if (sync) {
 		m_threadContext.impl->sync.audioWait = m_audioSync;
 		m_threadContext.impl->sync.videoFrameWait = m_videoSync;
+		m_threadContext.impl->sync.framePacing = m_framePacing;
 	} else {
 		m_threadContext.impl->sync.audioWait = false;
 		m_threadContext.impl->sync.videoFrameWait = false;
+		m_threadContext.impl->sync.framePacing = false;
 	}
 }
 
@@ -423,14 +448,7 @@ void CoreController::setRewinding(bool rewind) {
 void CoreController::rewind(int states) {
 	{
 		Interrupter interrupter(this);
-		if (!states) {
-			states = INT_MAX;
-		}
-		for (int i = 0; i < states; ++i) {
-			if (!mCoreRewindRestore(&m_threadContext.impl->rewind, m_threadContext.core)) {
-				break;
-			}
-		}
+		mCoreRewindRestoreSteps(&m_threadContext.impl->rewind, m_threadContext.core, states ? states : SIZE_MAX);
 	}
 	emit frameAvailable();
 	emit rewound();
@@ -846,26 +864,72 @@ int CoreController::updateAutofire() {
 void CoreController::finishFrame() {
 	QMutexLocker locker(&m_mutex);
 	if (!m_hwaccel) {
-			memcpy(m_completeBuffer.data(), m_activeBuffer->constData(), m_activeBuffer->size());
-
-		// TODO: Generalize this to triple buffering?
-		m_activeBuffer = &m_buffers[0];
-		if (m_activeBuffer == m_completeBuffer) {
-			m_activeBuffer = &m_buffers[1];
+		std::swap(m_activeBuffer, m_readyBuffer);
+		m_frameReady = true;
+		if (m_threadContext.core->opts.frameskip) {
+			// Skipped frames leave the buffer untouched, so it has to start out holding the last frame
+			memcpy(m_buffers[m_activeBuffer].data(), m_buffers[m_readyBuffer].constData(), m_buffers[m_activeBuffer].size());
 		}
-		// Copy contents to avoid issues when doing frameskip
-		memcpy(m_activeBuffer->data(), m_completeBuffer.constData(), m_activeBuffer->size());
-		m_threadContext.core->setVideoBuffer(m_threadContext.core, reinterpret_cast<color_t*>(m_activeBuffer->data()), screenDimensions().width());
+		m_threadContext.core->setVideoBuffer(m_threadContext.core, reinterpret_cast<color_t*>(m_buffers[m_activeBuffer].data()), screenDimensions().width());
 	}
 	for (auto& action : m_frameActions) {
 		action();
 	}
 	m_frameActions.clear();
+	for (auto& snapshot : m_memorySnapshots) {
+		fillMemorySnapshot(snapshot);
+	}
 	updateKeys();
 
 	QMetaObject::invokeMethod(this, "frameAvailable");
 }
 
+void CoreController::setMemorySnapshot(const QObject* owner, uint32_t base, uint32_t size, int segment) {
+	QMutexLocker locker(&m_mutex);
+	MemorySnapshot& snapshot = m_memorySnapshots[owner];
+	if (snapshot.base == base && snapshot.size == size && snapshot.segment == segment && snapshot.data.size() == (int) size) {
+		return;
+	}
+	snapshot.base = base;
+	snapshot.size = size;
+	snapshot.segment = segment;
+	snapshot.data.clear();
+}
+
+void CoreController::clearMemorySnapshot(const QObject* owner) {
+	QMutexLocker locker(&m_mutex);
+	m_memorySnapshots.remove(owner);
+}
+
+QByteArray CoreController::memorySnapshot(const QObject* owner, bool refresh) {
+	if (refresh) {
+		Interrupter interrupter(this);
+		QMutexLocker locker(&m_mutex);
+		auto snapshot = m_memorySnapshots.find(owner);
+		if (snapshot == m_memorySnapshots.end()) {
+			return {};
+		}
+		fillMemorySnapshot(*snapshot);
+		return snapshot->data;
+	}
+	QMutexLocker locker(&m_mutex);
+	auto snapshot = m_memorySnapshots.constFind(owner);
+	if (snapshot == m_memorySnapshots.constEnd()) {
+		return {};
+	}
+	return snapshot->data;
+}
+
+void CoreController::fillMemorySnapshot(MemorySnapshot& snapshot) {
+	mCore* core = m_threadContext.core;
+	// Anyone still holding the last copy keeps it, since this detaches
+	snapshot.data.resize(snapshot.size);
+	char* data = snapshot.data.data();
+	for (uint32_t i = 0; i < snapshot.size; ++i) {
+		data[i] = core->rawRead8(core, snapshot.base + i, snapshot.segment);
+	}
+}
+
 void CoreController::updateFastForward() {
 	if (m_fastForward || m_fastForwardForced) {
 		if (m_fastForwardVolume >= 0) {
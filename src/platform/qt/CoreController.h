@@ -6,6 +6,7 @@
 #pragma once
 
 #include <QByteArray>
+#include <QHash>
 #include <QList>
 #include <QMutex>
 #include <QObject>
@@ -67,6 +68,8 @@ public:
 	mCoreThread* thread() { return &m_threadContext; }
 
 	const color_t* drawContext();
+	// Hands the newest finished frame to the caller, which keeps it until the next call
+	const color_t* takeFrame();
 
 	bool isPaused();
 	bool hasStarted();
@@ -90,6 +93,12 @@ public:
 	MultiplayerController* multiplayerController() { return m_multiplayer; }
 
 	mCacheSet* graphicCaches();
+
+	// Views that paint memory register the range they show, which is then copied once per frame
+	// on the emulation thread. Passing refresh copies it right away instead, e.g. while paused.
+	void setMemorySnapshot(const QObject* owner, uint32_t base, uint32_t size, int segment = -1);
+	void clearMemorySnapshot(const QObject* owner);
+	QByteArray memorySnapshot(const QObject* owner, bool refresh = false);
 	int stateSlot() const { return m_stateSlot; }
 
 	void setOverride(std::unique_ptr<Override> override);
@@ -191,15 +200,27 @@ private:
 	int updateAutofire();
 	void finishFrame();
 
+	struct MemorySnapshot {
+		uint32_t base = 0;
+		uint32_t size = 0;
+		int segment = -1;
+		QByteArray data;
+	};
+	void fillMemorySnapshot(MemorySnapshot&);
+
 	void updateFastForward();
 
 	mCoreThread m_threadContext{};
 
 	bool m_patched = false;
 
-	QByteArray m_buffers[2];
-	QByteArray* m_activeBuffer;
-	QByteArray m_completeBuffer;
+	// Triple buffered by index: the core draws into the active buffer, finished frames wait in the ready
+	// buffer, and the display holds the front buffer, so frames change hands without being copied
+	QByteArray m_buffers[3];
+	int m_activeBuffer = 0;
+	int m_readyBuffer = 1;
+	int m_frontBuffer = 2;
+	bool m_frameReady = false;
 	bool m_hwaccel = false;
 
 	std::unique_ptr<mCacheSet> m_cacheSet;
@@ -207,6 +228,7 @@ private:
 
 	QList<std::function<void()>> m_resetActions;
 	QList<std::function<void()>> m_frameActions;
+	QHash<const QObject*, MemorySnapshot> m_memorySnapshots;
 	QMutex m_mutex;
 
 	int m_activeKeys = 0;
@@ -223,6 +245,7 @@ private:
 
 	bool m_audioSync = AUDIO_SYNC;
 	bool m_videoSync = VIDEO_SYNC;
+	bool m_framePacing = false;
 
 	bool m_autosave;
 	bool m_autoload;
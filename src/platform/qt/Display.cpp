@@ -74,6 +74,10 @@ void Display::filter(bool filter) {
 	m_filter = filter;
 }
 
+void Display::setPacedPresent(bool paced) {
+	m_pacedPresent = paced;
+}
+
 void Display::showMessage(const QString& message) {
 	m_messagePainter.showMessage(message);
 	if (!isDrawing()) {
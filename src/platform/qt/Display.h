@@ -43,6 +43,7 @@ public:
 	bool isAspectRatioLocked() const { return m_lockAspectRatio; }
 	bool isIntegerScalingLocked() const { return m_lockIntegerScaling; }
 	bool isFiltered() const { return m_filter; }
+	bool isPresentPaced() const { return m_pacedPresent; }
 
 	virtual void startDrawing(std::shared_ptr<CoreController>) = 0;
 	virtual bool isDrawing() const = 0;
@@ -63,6 +64,7 @@ public slots:
 	virtual void lockAspectRatio(bool lock);
 	virtual void lockIntegerScaling(bool lock);
 	virtual void filter(bool filter);
+	virtual void setPacedPresent(bool paced);
 	virtual void framePosted() = 0;
 	virtual void setShaders(struct VDir*) = 0;
 	virtual void clearShaders() = 0;
@@ -84,6 +86,7 @@ private:
 	bool m_lockAspectRatio = false;
 	bool m_lockIntegerScaling = false;
 	bool m_filter = false;
+	bool m_pacedPresent = false;
 	QTimer m_mouseTimer;
 };
 
@@ -7,17 +7,21 @@
 
 #if defined(BUILD_GL) || defined(BUILD_GLES2)
 
+#include "ConfigController.h"
 #include "CoreController.h"
 
 #include <QApplication>
+#include <QDir>
 #include <QOpenGLContext>
 #include <QOpenGLPaintDevice>
 #include <QResizeEvent>
+#include <QScreen>
 #include <QTimer>
 #include <QWindow>
 
 #include <mgba/core/core.h>
 #include <mgba-util/math.h>
+#include <mgba-util/vfs.h>
 #ifdef BUILD_GL
 #include "platform/opengl/gl.h"
 #endif
@@ -103,6 +107,7 @@ void DisplayGL::startDrawing(std::shared_ptr<CoreController> controller) {
 	lockAspectRatio(isAspectRatioLocked());
 	lockIntegerScaling(isIntegerScalingLocked());
 	filter(isFiltered());
+	setPacedPresent(isPresentPaced());
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 6, 0))
 	messagePainter()->resize(size(), isAspectRatioLocked(), devicePixelRatioF());
 #else
@@ -171,9 +176,16 @@ void DisplayGL::filter(bool filter) {
 	}
 }
 
+void DisplayGL::setPacedPresent(bool paced) {
+	Display::setPacedPresent(paced);
+	if (m_drawThread) {
+		QMetaObject::invokeMethod(m_painter, "setPacedPresent", Q_ARG(bool, paced));
+	}
+}
+
 void DisplayGL::framePosted() {
 	if (m_drawThread) {
-		m_painter->enqueue(m_context->drawContext());
+		m_painter->enqueue();
 		QMetaObject::invokeMethod(m_painter, "draw");
 	}
 }
@@ -246,6 +258,14 @@ PainterGL::PainterGL(VideoProxy* proxy, QWindow* surface, QOpenGLContext* parent
 	if ((majorVersion == 2 && extensions.contains("GL_ARB_framebuffer_object")) || majorVersion > 2) {
 		gl2Backend = static_cast<mGLES2Context*>(malloc(sizeof(mGLES2Context)));
 		mGLES2ContextCreate(gl2Backend);
+		static VDir* programCache = nullptr;
+		if (!programCache) {
+			// Kept open for the life of the process, since every display shares it
+			QString path = ConfigController::configDir() + "/shader-cache";
+			QDir().mkpath(path);
+			programCache = VDirOpen(path.toUtf8().constData());
+			mGLES2ShaderSetProgramCache(programCache);
+		}
 		m_backend = &gl2Backend->d;
 		m_supportsShaders = true;
 	}
@@ -261,7 +281,9 @@ PainterGL::PainterGL(VideoProxy* proxy, QWindow* surface, QOpenGLContext* parent
 #endif
 	m_backend->swap = [](VideoBackend* v) {
 		PainterGL* painter = static_cast<PainterGL*>(v->user);
-		if (!painter->m_swapTimer.isActive()) {
+		if (painter->m_pacedPresent) {
+			painter->schedulePresent();
+		} else if (!painter->m_swapTimer.isActive()) {
 			QMetaObject::invokeMethod(&painter->m_swapTimer, "start");
 		}
 	};
@@ -278,22 +300,13 @@ PainterGL::PainterGL(VideoProxy* proxy, QWindow* surface, QOpenGLContext* parent
 	m_backend->filter = false;
 	m_backend->lockAspectRatio = false;
 
-	for (int i = 0; i < 2; ++i) {
-		m_free.append(new uint32_t[1024 * 2048]);
-	}
-
 	m_swapTimer.setInterval(16);
 	m_swapTimer.setSingleShot(true);
 	connect(&m_swapTimer, &QTimer::timeout, this, &PainterGL::swap);
+	m_presentClock.start();
 }
 
 PainterGL::~PainterGL() {
-	while (!m_queue.isEmpty()) {
-		delete[] m_queue.dequeue();
-	}
-	for (auto item : m_free) {
-		delete[] item;
-	}
 	m_gl->makeCurrent(m_surface);
 #if defined(_WIN32) && defined(USE_EPOXY)
 	epoxy_handle_external_wglMakeCurrent();
@@ -352,6 +365,25 @@ void PainterGL::filter(bool filter) {
 	}
 }
 
+void PainterGL::setPacedPresent(bool paced) {
+	m_pacedPresent = paced;
+	if (paced) {
+		qreal rate = m_surface->screen() ? m_surface->screen()->refreshRate() : 0;
+		if (rate < 1) {
+			rate = 60;
+		}
+		m_refreshPeriod = 1000000000LL / rate;
+		m_swapTimer.setTimerType(Qt::PreciseTimer);
+	} else {
+		m_swapTimer.setTimerType(Qt::CoarseTimer);
+		m_swapTimer.setInterval(16);
+		if (m_messagePainter) {
+			QMetaObject::invokeMethod(m_messagePainter, "showStatistics", Q_ARG(QString, QString()));
+		}
+	}
+	resetStatistics();
+}
+
 void PainterGL::start() {
 	m_gl->makeCurrent(m_surface);
 #if defined(_WIN32) && defined(USE_EPOXY)
@@ -369,7 +401,7 @@ void PainterGL::start() {
 }
 
 void PainterGL::draw() {
-	if (m_queue.isEmpty()) {
+	if (!m_queued) {
 		return;
 	}
 
@@ -378,9 +410,14 @@ void PainterGL::draw() {
 		return;
 	}
 
-	if (mCoreSyncWaitFrameStart(&m_context->thread()->impl->sync) || !m_queue.isEmpty()) {
+	if (mCoreSyncWaitFrameStart(&m_context->thread()->impl->sync) || m_queued) {
+		if (m_pacedPresent && m_frameReady) {
+			// The frame drawn last never reached the screen; the newer one replaces it
+			++m_droppedFrames;
+		}
 		dequeue();
 		forceDraw();
+		m_drawnTime = m_frameTime;
 		if (m_context->thread()->impl->sync.videoFrameWait) {
 			m_needsUnlock = true;
 		} else {
@@ -401,7 +438,10 @@ void PainterGL::forceDraw() {
 void PainterGL::stop() {
 	m_active = false;
 	m_started = false;
-	dequeueAll();
+	dequeue();
+	if (m_pacedPresent && m_messagePainter) {
+		QMetaObject::invokeMethod(m_messagePainter, "showStatistics", Q_ARG(QString, QString()));
+	}
 	m_backend->clear(m_backend);
 	m_backend->swap(m_backend);
 	if (m_swapTimer.isActive()) {
@@ -449,61 +489,126 @@ void PainterGL::swap() {
 		epoxy_handle_external_wglMakeCurrent();
 #endif
 		m_frameReady = false;
+		if (m_pacedPresent) {
+			waitForPresent();
+			updateStatistics(m_presentClock.nsecsElapsed());
+		}
 	}
 	if (m_needsUnlock) {
 		mCoreSyncWaitFrameEnd(&m_context->thread()->impl->sync);
 		m_needsUnlock = false;
 	}
-	if (!m_queue.isEmpty()) {
+	if (m_queued) {
 		QMetaObject::invokeMethod(this, "draw", Qt::QueuedConnection);
+	} else if (m_pacedPresent) {
+		schedulePresent();
 	} else {
 		m_swapTimer.start();
 	}
 }
 
-void PainterGL::enqueue(const uint32_t* backing) {
-	m_mutex.lock();
-	uint32_t* buffer = nullptr;
-	if (backing) {
-		if (m_free.isEmpty()) {
-			buffer = m_queue.dequeue();
-		} else {
-			buffer = m_free.takeLast();
+void PainterGL::schedulePresent() {
+	if (m_swapTimer.isActive()) {
+		// Already waiting on the upcoming refresh; whatever is drawn by then gets shown
+		return;
+	}
+	int delay = 0;
+	if (m_lastPresent >= 0 && m_refreshPeriod > 0) {
+		// Swap as late as possible before the next refresh so the frame is as fresh as it can be
+		qint64 now = m_presentClock.nsecsElapsed();
+		qint64 next = m_lastPresent + m_refreshPeriod;
+		if (next < now) {
+			next += ((now - next) / m_refreshPeriod + 1) * m_refreshPeriod;
+		}
+		delay = (next - now - PRESENT_MARGIN) / 1000000;
+		if (delay < 0) {
+			delay = 0;
 		}
-		QSize size = m_context->screenDimensions();
-		memcpy(buffer, backing, size.width() * size.height() * BYTES_PER_PIXEL);
 	}
-	m_queue.enqueue(buffer);
-	m_mutex.unlock();
+	m_swapTimer.start(delay);
 }
 
-void PainterGL::dequeue() {
-	m_mutex.lock();
-	if (m_queue.isEmpty()) {
-		m_mutex.unlock();
+void PainterGL::waitForPresent() {
+	// Blocking on the GPU puts the timestamp at the refresh the swap was synced to, rather than
+	// whenever the driver happened to return from queueing it
+	glFinish();
+}
+
+void PainterGL::updateStatistics(qint64 presented) {
+	if (m_lastPresent >= 0) {
+		qint64 interval = presented - m_lastPresent;
+		qint64 refreshes = (interval + m_refreshPeriod / 2) / m_refreshPeriod;
+		if (refreshes == 1) {
+			// Only swaps one refresh apart say anything about the refresh period
+			m_refreshPeriod += (interval - m_refreshPeriod) / 16;
+		} else if (refreshes > 1 && interval < PRESENT_STALL) {
+			m_repeatedFrames += refreshes - 1;
+		}
+	}
+	m_lastPresent = presented;
+	if (m_drawnTime >= 0) {
+		qint64 latency = presented - m_drawnTime;
+		m_latencyTotal += latency;
+		if (latency > m_latencyMax) {
+			m_latencyMax = latency;
+		}
+		++m_latencySamples;
+		m_drawnTime = -1;
+	}
+	if (presented - m_statisticsTime < 1000000000LL || !m_latencySamples) {
 		return;
 	}
-	uint32_t* buffer = m_queue.dequeue();
-	if (buffer) {
-		m_backend->postFrame(m_backend, buffer);
-		m_free.append(buffer);
+	QString statistics = tr("Latency: %1 ms (max %2 ms) at %3 Hz, %4 dropped, %5 repeated")
+		.arg(m_latencyTotal / (m_latencySamples * 1e6), 0, 'f', 1)
+		.arg(m_latencyMax / 1e6, 0, 'f', 1)
+		.arg(1e9 / m_refreshPeriod, 0, 'f', 2)
+		.arg(m_droppedFrames)
+		.arg(m_repeatedFrames);
+	if (m_messagePainter) {
+		QMetaObject::invokeMethod(m_messagePainter, "showStatistics", Q_ARG(QString, statistics));
 	}
+	qint64 refreshPeriod = m_refreshPeriod;
+	resetStatistics();
+	m_refreshPeriod = refreshPeriod;
+	m_lastPresent = presented;
+	m_statisticsTime = presented;
+}
+
+void PainterGL::resetStatistics() {
+	m_lastPresent = -1;
+	m_drawnTime = -1;
+	m_latencyTotal = 0;
+	m_latencyMax = 0;
+	m_latencySamples = 0;
+	m_droppedFrames = 0;
+	m_repeatedFrames = 0;
+	m_statisticsTime = m_presentClock.nsecsElapsed();
+}
+
+void PainterGL::enqueue() {
+	m_mutex.lock();
+	++m_queued;
+	m_queuedTime = m_presentClock.nsecsElapsed();
 	m_mutex.unlock();
 }
 
-void PainterGL::dequeueAll() {
-	uint32_t* buffer = 0;
+void PainterGL::dequeue() {
 	m_mutex.lock();
-	while (!m_queue.isEmpty()) {
-		buffer = m_queue.dequeue();
-		if (buffer) {
-			m_free.append(buffer);
-		}
+	if (!m_queued) {
+		m_mutex.unlock();
+		return;
 	}
+	if (m_pacedPresent && m_queued > 1) {
+		// Only the newest frame gets taken, so any others posted since the last draw are skipped
+		m_droppedFrames += m_queued - 1;
+	}
+	m_queued = 0;
+	m_frameTime = m_queuedTime;
+	m_mutex.unlock();
+	const color_t* buffer = m_context->takeFrame();
 	if (buffer) {
 		m_backend->postFrame(m_backend, buffer);
 	}
-	m_mutex.unlock();
 }
 
 void PainterGL::setShaders(struct VDir* dir) {
@@ -18,9 +18,9 @@
 
 #include <QOpenGLContext>
 #include <QList>
+#include <QElapsedTimer>
 #include <QMouseEvent>
 #include <QPainter>
-#include <QQueue>
 #include <QThread>
 #include <QTimer>
 
@@ -53,6 +53,7 @@ public slots:
 	void lockAspectRatio(bool lock) override;
 	void lockIntegerScaling(bool lock) override;
 	void filter(bool filter) override;
+	void setPacedPresent(bool paced) override;
 	void framePosted() override;
 	void setShaders(struct VDir*) override;
 	void clearShaders() override;
@@ -82,7 +83,7 @@ public:
 
 	void setContext(std::shared_ptr<CoreController>);
 	void setMessagePainter(MessagePainter*);
-	void enqueue(const uint32_t* backing);
+	void enqueue();
 
 	bool supportsShaders() const { return m_supportsShaders; }
 
@@ -97,6 +98,7 @@ public slots:
 	void lockAspectRatio(bool lock);
 	void lockIntegerScaling(bool lock);
 	void filter(bool filter);
+	void setPacedPresent(bool paced);
 	void resizeContext();
 
 	void setShaders(struct VDir*);
@@ -109,12 +111,18 @@ private slots:
 	void swap();
 
 private:
+	static const qint64 PRESENT_MARGIN = 2000000;
+	static const qint64 PRESENT_STALL = 250000000;
+
 	void performDraw();
 	void dequeue();
-	void dequeueAll();
+	void schedulePresent();
+	void waitForPresent();
+	void updateStatistics(qint64 presented);
+	void resetStatistics();
 
-	QList<uint32_t*> m_free;
-	QQueue<uint32_t*> m_queue;
+	// Frames are taken from the controller's buffers when drawn, so only how many were posted is tracked
+	int m_queued = 0;
 	QPainter m_painter;
 	QMutex m_mutex;
 	QWindow* m_surface;
@@ -132,6 +140,21 @@ private:
 	bool m_needsUnlock = false;
 	bool m_frameReady = false;
 	VideoProxy* m_videoProxy;
+
+	// Paced presentation: swaps are timed against the measured refresh instead of a fixed timer
+	bool m_pacedPresent = false;
+	QElapsedTimer m_presentClock;
+	qint64 m_refreshPeriod = 0;
+	qint64 m_lastPresent = -1;
+	qint64 m_queuedTime = -1;
+	qint64 m_frameTime = -1;
+	qint64 m_drawnTime = -1;
+	qint64 m_latencyTotal = 0;
+	qint64 m_latencyMax = 0;
+	int m_latencySamples = 0;
+	int m_droppedFrames = 0;
+	int m_repeatedFrames = 0;
+	qint64 m_statisticsTime = 0;
 };
 
 }
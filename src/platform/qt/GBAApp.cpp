@@ -11,6 +11,7 @@
 #include "ConfigController.h"
 #include "Display.h"
 #include "LogController.h"
+#include "MultiplayerView.h"
 #include "VFileDevice.h"
 #include "Window.h"
 
@@ -77,10 +78,20 @@ GBAApp::GBAApp(int& argc, char* argv[], ConfigController* config)
 	m_configController->updateOption("useDiscordPresence");
 #endif
 
+	ConfigOption* sharedMultiplayerView = m_configController->addOption("sharedMultiplayerView");
+	sharedMultiplayerView->connect([this](const QVariant&) {
+		updateMultiplayerView();
+	}, this);
+	connect(&m_multiplayer, &MultiplayerController::gameAttached, this, &GBAApp::updateMultiplayerView);
+	connect(&m_multiplayer, &MultiplayerController::gameDetached, this, &GBAApp::updateMultiplayerView);
+
 	connect(this, &GBAApp::aboutToQuit, this, &GBAApp::cleanup);
 }
 
 void GBAApp::cleanup() {
+	delete m_multiplayerView;
+	m_multiplayerView = nullptr;
+
 	m_workerThreads.waitForDone();
 
 	while (!m_workerJobs.isEmpty()) {
@@ -123,6 +134,7 @@ Window* GBAApp::newWindow() {
 	w->setAttribute(Qt::WA_DeleteOnClose);
 	w->loadConfig();
 	w->show();
+	w->setSharedDisplay(m_multiplayerView);
 	w->multiplayerChanged();
 	for (Window* w : m_windows) {
 		w->updateMultiplayerStatus(m_windows.count() < MAX_GBAS);
@@ -130,6 +142,29 @@ Window* GBAApp::newWindow() {
 	return w;
 }
 
+void GBAApp::updateMultiplayerView() {
+	// Only worth it once there is more than one player to show
+	bool shared = m_configController->getOption("sharedMultiplayerView").toInt() && m_multiplayer.attached() > 1;
+	if (shared == static_cast<bool>(m_multiplayerView)) {
+		return;
+	}
+	if (shared) {
+		m_multiplayerView = new MultiplayerView(&m_multiplayer);
+		m_multiplayerView->setAttribute(Qt::WA_QuitOnClose, false);
+		m_multiplayerView->setFiltered(m_configController->getOption("resampleVideo").toInt());
+		connect(m_multiplayerView, &MultiplayerView::closed, [this]() {
+			m_configController->addOption("sharedMultiplayerView")->setValue(false);
+		});
+		m_multiplayerView->show();
+	} else {
+		m_multiplayerView->deleteLater();
+		m_multiplayerView = nullptr;
+	}
+	for (Window* w : m_windows) {
+		w->setSharedDisplay(shared);
+	}
+}
+
 GBAApp* GBAApp::app() {
 	return g_app;
 }
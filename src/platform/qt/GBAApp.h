@@ -30,6 +30,7 @@ namespace QGBA {
 
 class ConfigController;
 class CoreController;
+class MultiplayerView;
 class Window;
 
 #ifdef USE_SQLITE3
@@ -79,6 +80,7 @@ protected:
 private slots:
 	void finishJob(qint64 jobId);
 	void cleanup();
+	void updateMultiplayerView();
 
 private:
 	class WorkerJob : public QRunnable {
@@ -102,6 +104,7 @@ private:
 	ConfigController* m_configController;
 	QList<Window*> m_windows;
 	MultiplayerController m_multiplayer;
+	MultiplayerView* m_multiplayerView = nullptr;
 	CoreManager m_manager;
 
 	QMap<qint64, WorkerJob*> m_workerJobs;
@@ -5,13 +5,11 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "GIFView.h"
 
-#ifdef USE_MAGICK
-
 #include "CoreController.h"
 #include "GBAApp.h"
 #include "LogController.h"
 
-#include <QMap>
+#include <QFileInfo>
 
 #include <mgba/internal/gba/gba.h>
 #include <mgba/internal/gba/video.h>
@@ -33,7 +31,7 @@ GIFView::GIFView(QWidget* parent)
 	        this, &GIFView::updateDelay);
 	connect(m_ui.delayAuto, &QAbstractButton::clicked, this, &GIFView::updateDelay);
 
-	ImageMagickGIFEncoderInit(&m_encoder);
+	GIFEncoderInit(&m_encoder);
 }
 
 GIFView::~GIFView() {
@@ -48,9 +46,15 @@ void GIFView::setController(std::shared_ptr<CoreController> controller) {
 
 void GIFView::startRecording() {
 	int delayMs = m_ui.delayAuto->isChecked() ? -1 : m_ui.delayMs->value();
-	ImageMagickGIFEncoderSetParams(&m_encoder, m_ui.frameskip->value(), delayMs);
-	if (!ImageMagickGIFEncoderOpen(&m_encoder, m_filename.toUtf8().constData())) {
-		LOG(QT, ERROR) << tr("Failed to open output GIF file: %1").arg(m_filename);
+	GIFEncoderSetParams(&m_encoder, m_ui.frameskip->value(), delayMs);
+	QString suffix = QFileInfo(m_filename).suffix().toLower();
+	bool apng = suffix == "png" || suffix == "apng";
+	if (!GIFEncoderSetFormat(&m_encoder, apng ? GIF_ENCODER_FORMAT_APNG : GIF_ENCODER_FORMAT_GIF)) {
+		LOG(QT, ERROR) << tr("Animated PNG recording is not supported in this build");
+		return;
+	}
+	if (!GIFEncoderOpen(&m_encoder, m_filename.toUtf8().constData())) {
+		LOG(QT, ERROR) << tr("Failed to open output file: %1").arg(m_filename);
 		return;
 	}
 	m_ui.start->setEnabled(false);
@@ -61,17 +65,17 @@ void GIFView::startRecording() {
 
 void GIFView::stopRecording() {
 	emit recordingStopped();
-	ImageMagickGIFEncoderClose(&m_encoder);
+	GIFEncoderClose(&m_encoder);
 	m_ui.stop->setEnabled(false);
 	m_ui.start->setEnabled(true);
 	m_ui.groupBox->setEnabled(true);
 }
 
 void GIFView::selectFile() {
-	QString filename = GBAApp::app()->getSaveFileName(this, tr("Select output file"), tr("Graphics Interchange Format (*.gif)"));
+	QString filename = GBAApp::app()->getSaveFileName(this, tr("Select output file"), tr("Graphics Interchange Format (*.gif);;Animated Portable Network Graphics (*.png *.apng)"));
 	if (!filename.isEmpty()) {
 		m_ui.filename->setText(filename);
-		if (!ImageMagickGIFEncoderIsOpen(&m_encoder)) {
+		if (!GIFEncoderIsOpen(&m_encoder)) {
 			m_ui.start->setEnabled(true);
 		}
 	}
@@ -91,5 +95,3 @@ void GIFView::updateDelay() {
 	s /= GBA_ARM7TDMI_FREQUENCY;
 	m_ui.delayMs->setValue(s);
 }
-
-#endif
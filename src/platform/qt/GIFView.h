@@ -5,15 +5,13 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #pragma once
 
-#ifdef USE_MAGICK
-
 #include <QWidget>
 
 #include <memory>
 
 #include "ui_GIFView.h"
 
-#include "feature/imagemagick/imagemagick-gif-encoder.h"
+#include "feature/gif/gif-encoder.h"
 
 namespace QGBA {
 
@@ -46,11 +44,9 @@ private slots:
 private:
 	Ui::GIFView m_ui;
 
-	ImageMagickGIFEncoder m_encoder;
+	GIFEncoder m_encoder;
 
 	QString m_filename;
 };
 
 }
-
-#endif
@@ -0,0 +1,198 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "MemoryHeatmapView.h"
+
+#include "CoreController.h"
+#include "GBAApp.h"
+#include "VFileDevice.h"
+
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QImage>
+#include <QMessageBox>
+#include <QPixmap>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+#include <algorithm>
+#include <cmath>
+
+#include <mgba/core/core.h>
+#include <mgba-util/vfs.h>
+
+using namespace QGBA;
+
+static const int COLUMNS = 64;
+static const int CELL_SIZE = 6;
+
+MemoryHeatmapView::MemoryHeatmapView(std::shared_ptr<CoreController> controller, QWidget* parent)
+	: QWidget(parent)
+	, m_controller(controller)
+{
+	setWindowTitle(tr("Memory heatmap"));
+	mMemoryHeatmapInit(&m_heatmap);
+
+	m_region = new QComboBox;
+	m_kind = new QComboBox;
+	m_kind->addItem(tr("Reads"));
+	m_kind->addItem(tr("Writes"));
+	m_kind->addItem(tr("Executes"));
+	m_kind->addItem(tr("Read cycles"));
+	m_kind->addItem(tr("Write cycles"));
+	m_kind->addItem(tr("Execute cycles"));
+	m_image = new QLabel;
+	m_image->setAlignment(Qt::AlignLeft | Qt::AlignTop);
+	m_status = new QLabel;
+	QPushButton* resetButton = new QPushButton(tr("Reset"));
+	QPushButton* exportButton = new QPushButton(tr("Export..."));
+
+	QHBoxLayout* controls = new QHBoxLayout;
+	controls->addWidget(m_region);
+	controls->addWidget(m_kind);
+	controls->addStretch();
+	controls->addWidget(resetButton);
+	controls->addWidget(exportButton);
+	QVBoxLayout* layout = new QVBoxLayout;
+	layout->addLayout(controls);
+	layout->addWidget(m_image, 1);
+	layout->addWidget(m_status);
+	setLayout(layout);
+
+	{
+		CoreController::Interrupter interrupter(m_controller);
+		mCore* core = m_controller->thread()->core;
+		const mCoreMemoryBlock* blocks;
+		size_t nBlocks = core->listMemoryBlocks(core, &blocks);
+		for (size_t i = 0; i < nBlocks; ++i) {
+			uint32_t size = blocks[i].end - blocks[i].start;
+			Region region{ QString(blocks[i].longName), blocks[i].start, (size + (1 << mMEMORY_HEATMAP_PAGE_SHIFT) - 1) >> mMEMORY_HEATMAP_PAGE_SHIFT };
+			m_regions.append(region);
+			m_region->addItem(region.name);
+		}
+		if (core->setMemoryHeatmap) {
+			mMemoryHeatmapReset(&m_heatmap, core->frameCounter(core));
+			m_attached = core->setMemoryHeatmap(core, &m_heatmap);
+		}
+	}
+
+	if (!m_attached) {
+		m_region->setEnabled(false);
+		m_kind->setEnabled(false);
+		resetButton->setEnabled(false);
+		exportButton->setEnabled(false);
+		m_status->setText(tr("Memory heatmaps need a build with performance counters enabled."));
+		return;
+	}
+
+	connect(m_region, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &MemoryHeatmapView::refresh);
+	connect(m_kind, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &MemoryHeatmapView::refresh);
+	connect(resetButton, &QAbstractButton::clicked, this, &MemoryHeatmapView::reset);
+	connect(exportButton, &QAbstractButton::clicked, this, &MemoryHeatmapView::exportHeatmap);
+	connect(m_controller.get(), &CoreController::stopping, this, [this]() {
+		// The core has stopped running by now and takes its pointer to the heatmap down with it
+		m_refresh.stop();
+		m_attached = false;
+	});
+	connect(&m_refresh, &QTimer::timeout, this, &MemoryHeatmapView::refresh);
+	m_refresh.start(500);
+	refresh();
+}
+
+MemoryHeatmapView::~MemoryHeatmapView() {
+	if (m_attached) {
+		CoreController::Interrupter interrupter(m_controller);
+		mCore* core = m_controller->thread()->core;
+		core->setMemoryHeatmap(core, nullptr);
+	}
+	mMemoryHeatmapDeinit(&m_heatmap);
+}
+
+uint64_t MemoryHeatmapView::pageValue(const mMemoryHeatmapPage& page) const {
+	int kind = m_kind->currentIndex();
+	if (kind < mMEMORY_HEATMAP_MAX) {
+		return page.accesses[kind];
+	}
+	return page.cycles[kind - mMEMORY_HEATMAP_MAX];
+}
+
+void MemoryHeatmapView::refresh() {
+	int index = m_region->currentIndex();
+	if (!m_attached || index < 0 || index >= m_regions.count()) {
+		return;
+	}
+	const Region& region = m_regions[index];
+
+	// Counters are only written from the core thread, so copying them out needs it paused
+	QVector<mMemoryHeatmapPage> pages(region.pages);
+	{
+		CoreController::Interrupter interrupter(m_controller);
+		mCore* core = m_controller->thread()->core;
+		mMemoryHeatmapMarkFrame(&m_heatmap, core->frameCounter(core));
+		for (uint32_t i = 0; i < region.pages; ++i) {
+			pages[i] = *mMemoryHeatmapGetPage(&m_heatmap, region.start + (i << mMEMORY_HEATMAP_PAGE_SHIFT));
+		}
+	}
+
+	uint64_t max = 0;
+	uint32_t hottest = 0;
+	for (uint32_t i = 0; i < region.pages; ++i) {
+		uint64_t value = pageValue(pages[i]);
+		if (value > max) {
+			max = value;
+			hottest = i;
+		}
+	}
+
+	int rows = (region.pages + COLUMNS - 1) / COLUMNS;
+	QImage image(COLUMNS, rows, QImage::Format_RGB32);
+	image.fill(Qt::darkGray);
+	double scale = max ? log1p(max) : 1;
+	for (uint32_t i = 0; i < region.pages; ++i) {
+		uint64_t value = pageValue(pages[i]);
+		// Black through red to yellow, so a few very hot pages don't wash out everything else
+		int heat = value ? 1 + log1p(value) / scale * 510 : 0;
+		image.setPixel(i % COLUMNS, i / COLUMNS, qRgb(std::min(heat, 255), std::max(heat - 255, 0), 0));
+	}
+	m_image->setPixmap(QPixmap::fromImage(image.scaled(COLUMNS * CELL_SIZE, rows * CELL_SIZE)));
+
+	QString status = tr("Frames %1 to %2").arg(m_heatmap.firstFrame).arg(m_heatmap.lastFrame);
+	if (max) {
+		status += tr(", hottest page 0x%1 (%2)")
+		          .arg(region.start + (hottest << mMEMORY_HEATMAP_PAGE_SHIFT), 8, 16, QChar('0'))
+		          .arg(max);
+	}
+	m_status->setText(status);
+}
+
+void MemoryHeatmapView::reset() {
+	{
+		CoreController::Interrupter interrupter(m_controller);
+		mCore* core = m_controller->thread()->core;
+		mMemoryHeatmapReset(&m_heatmap, core->frameCounter(core));
+	}
+	refresh();
+}
+
+void MemoryHeatmapView::exportHeatmap() {
+	QString filename = GBAApp::app()->getSaveFileName(this, tr("Export heatmap"), tr("CSV file (*.csv)"));
+	if (filename.isEmpty()) {
+		return;
+	}
+	VFile* vf = VFileDevice::open(filename, O_WRONLY | O_CREAT | O_TRUNC);
+	bool success = false;
+	if (vf) {
+		CoreController::Interrupter interrupter(m_controller);
+		mCore* core = m_controller->thread()->core;
+		mMemoryHeatmapMarkFrame(&m_heatmap, core->frameCounter(core));
+		success = mMemoryHeatmapDump(&m_heatmap, vf);
+	}
+	if (vf) {
+		vf->close(vf);
+	}
+	if (!success) {
+		QMessageBox::warning(this, tr("Export failed"), tr("Could not write the heatmap to %1").arg(filename));
+	}
+}
@@ -0,0 +1,57 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include <QLabel>
+#include <QTimer>
+#include <QVector>
+#include <QWidget>
+
+#include <memory>
+
+#include <mgba/core/mem-heatmap.h>
+
+class QComboBox;
+
+namespace QGBA {
+
+class CoreController;
+
+// Paints the per-page counters of one memory block, one cell per 4 KiB page, on a log scale
+class MemoryHeatmapView : public QWidget {
+Q_OBJECT
+
+public:
+	MemoryHeatmapView(std::shared_ptr<CoreController> controller, QWidget* parent = nullptr);
+	~MemoryHeatmapView();
+
+private slots:
+	void refresh();
+	void reset();
+	void exportHeatmap();
+
+private:
+	struct Region {
+		QString name;
+		uint32_t start;
+		uint32_t pages;
+	};
+
+	uint64_t pageValue(const mMemoryHeatmapPage&) const;
+
+	std::shared_ptr<CoreController> m_controller;
+	mMemoryHeatmap m_heatmap;
+	bool m_attached = false;
+
+	QVector<Region> m_regions;
+	QComboBox* m_region;
+	QComboBox* m_kind;
+	QLabel* m_image;
+	QLabel* m_status;
+	QTimer m_refresh;
+};
+
+}
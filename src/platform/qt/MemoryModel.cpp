@@ -91,8 +91,19 @@ MemoryModel::MemoryModel(QWidget* parent)
 	setRegion(0, 0x10000000, tr("All"));
 }
 
+MemoryModel::~MemoryModel() {
+	if (m_controller) {
+		m_controller->clearMemorySnapshot(this);
+	}
+}
+
 void MemoryModel::setController(std::shared_ptr<CoreController> controller) {
+	if (m_controller) {
+		m_controller->clearMemorySnapshot(this);
+	}
+	m_controller = controller;
 	m_core = controller->thread()->core;
+	m_snapshotStale = true;
 }
 
 void MemoryModel::setRegion(uint32_t base, uint32_t size, const QString& name, int segment) {
@@ -247,6 +258,7 @@ QByteArray MemoryModel::serialize() {
 
 void MemoryModel::deserialize(const QByteArray& bytes) {
 	uint32_t addr = m_selection.first;
+	m_snapshotStale = true;
 	switch (m_align) {
 	case 1:
 		for (int i = 0; i < bytes.size(); i += m_align, addr += m_align) {
@@ -329,6 +341,7 @@ void MemoryModel::paintEvent(QPaintEvent* event) {
 		                 QString::number(x, 16).toUpper());
 	}
 	int height = (viewport()->size().height() - m_cellHeight) / m_cellHeight;
+	updateSnapshot();
 	for (int y = 0; y < height; ++y) {
 		int yp = m_cellHeight * y + m_margins.top();
 		if ((y + m_top) * 16 >= m_size) {
@@ -362,7 +375,7 @@ void MemoryModel::paintEvent(QPaintEvent* event) {
 				} else {
 					painter.setPen(palette.color(QPalette::WindowText));
 				}
-				uint16_t b = m_core->rawRead16(m_core, address, m_currentBank);
+				uint16_t b = snapshotRead(address, 2);
 				painter.drawStaticText(
 				    QPointF(m_cellSize.width() * (x + 1.0) - 2 * m_letterWidth + m_margins.left(), yp),
 				    m_staticNumbers[(b >> 8) & 0xFF]);
@@ -390,7 +403,7 @@ void MemoryModel::paintEvent(QPaintEvent* event) {
 				} else {
 					painter.setPen(palette.color(QPalette::WindowText));
 				}
-				uint32_t b = m_core->rawRead32(m_core, address, m_currentBank);
+				uint32_t b = snapshotRead(address, 4);
 				painter.drawStaticText(
 				    QPointF(m_cellSize.width() * (x + 2.0) - 4 * m_letterWidth + m_margins.left(), yp),
 				    m_staticNumbers[(b >> 24) & 0xFF]);
@@ -423,7 +436,7 @@ void MemoryModel::paintEvent(QPaintEvent* event) {
 				} else {
 					painter.setPen(palette.color(QPalette::WindowText));
 				}
-				uint8_t b = m_core->rawRead8(m_core, address, m_currentBank);
+				uint8_t b = snapshotRead(address, 1);
 				painter.drawStaticText(QPointF(m_cellSize.width() * (x + 0.5) - m_letterWidth + m_margins.left(), yp),
 				                       m_staticNumbers[b]);
 			}
@@ -435,16 +448,16 @@ void MemoryModel::paintEvent(QPaintEvent* event) {
 			uint32_t b;
 			switch (m_align) {
 			case 1:
-				b = m_core->rawRead8(m_core, (y + m_top) * 16 + x + m_base, m_currentBank);
+				b = snapshotRead((y + m_top) * 16 + x + m_base, 1);
 				array.append((char) b);
 				break;
 			case 2:
-				b = m_core->rawRead16(m_core, (y + m_top) * 16 + x + m_base, m_currentBank);
+				b = snapshotRead((y + m_top) * 16 + x + m_base, 2);
 				array.append((char) b);
 				array.append((char) (b >> 8));
 				break;
 			case 4:
-				b = m_core->rawRead32(m_core, (y + m_top) * 16 + x + m_base, m_currentBank);
+				b = snapshotRead((y + m_top) * 16 + x + m_base, 4);
 				array.append((char) b);
 				array.append((char) (b >> 8));
 				array.append((char) (b >> 16));
@@ -584,6 +597,7 @@ void MemoryModel::keyPressEvent(QKeyEvent* event) {
 	m_buffer |= nybble;
 	++m_bufferedNybbles;
 	if (m_bufferedNybbles == m_align * 2) {
+		m_snapshotStale = true;
 		switch (m_align) {
 		case 1:
 			m_core->rawWrite8(m_core, m_selection.first, m_currentBank, m_buffer);
@@ -713,6 +727,53 @@ void MemoryModel::adjustCursor(int adjust, bool shift) {
 	viewport()->update();
 }
 
+void MemoryModel::updateSnapshot() {
+	if (!m_controller) {
+		m_snapshot.clear();
+		return;
+	}
+	int height = (viewport()->size().height() - m_cellHeight) / m_cellHeight;
+	uint32_t base = m_top * 16 + m_base;
+	uint32_t size = 0;
+	if (height > 0 && base - m_base < m_size) {
+		size = height * 16;
+		if (size > m_size - (base - m_base)) {
+			size = m_size - (base - m_base);
+		}
+	}
+	m_controller->setMemorySnapshot(this, base, size, m_currentBank);
+
+	// The copy made at the end of each frame is only useful once it covers what's on screen,
+	// and nothing will replace it while the core is paused
+	bool refresh = m_snapshotStale || base != m_snapshotBase || m_controller->isPaused();
+	m_snapshot = m_controller->memorySnapshot(this, refresh);
+	if (m_snapshot.size() != (int) size) {
+		m_snapshot = m_controller->memorySnapshot(this, true);
+	}
+	m_snapshotBase = base;
+	m_snapshotStale = false;
+}
+
+uint32_t MemoryModel::snapshotRead(uint32_t address, int width) const {
+	uint32_t offset = address - m_snapshotBase;
+	if (offset >= (uint32_t) m_snapshot.size() || m_snapshot.size() - offset < (uint32_t) width) {
+		return 0;
+	}
+	const char* data = m_snapshot.constData();
+	uint32_t value;
+	switch (width) {
+	case 1:
+		return (uint8_t) data[offset];
+	case 2:
+		LOAD_16LE(value, offset, data);
+		return value & 0xFFFF;
+	case 4:
+		LOAD_32LE(value, offset, data);
+		return value;
+	}
+	return 0;
+}
+
 void MemoryModel::TextCodecFree::operator()(TextCodec* codec) {
 	TextCodecDeinit(codec);
 	delete(codec);
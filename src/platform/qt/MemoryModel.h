@@ -6,6 +6,7 @@
 #pragma once
 
 #include <QAbstractScrollArea>
+#include <QByteArray>
 #include <QFont>
 #include <QSize>
 #include <QStaticText>
@@ -26,6 +27,7 @@ Q_OBJECT
 
 public:
 	MemoryModel(QWidget* parent = nullptr);
+	~MemoryModel();
 
 	void setController(std::shared_ptr<CoreController> controller);
 
@@ -71,12 +73,19 @@ private:
 
 	void adjustCursor(int adjust, bool shift);
 
+	void updateSnapshot();
+	uint32_t snapshotRead(uint32_t address, int width) const;
+
 	class TextCodecFree {
 	public:
 		void operator()(TextCodec*);
 	};
 
 	mCore* m_core = nullptr;
+	std::shared_ptr<CoreController> m_controller;
+	QByteArray m_snapshot;
+	uint32_t m_snapshotBase = 0;
+	bool m_snapshotStale = true;
 	std::unique_ptr<TextCodec, TextCodecFree> m_codec;
 	QFont m_font;
 	int m_cellHeight;
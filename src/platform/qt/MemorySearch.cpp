@@ -140,7 +140,7 @@ void MemorySearch::searchWithin() {
 	mCore* core = m_controller->thread()->core;
 
 	if (createParams(&params)) {
-		mCoreMemorySearchRepeat(core, &params, &m_results);
+		mCoreMemorySearchRepeatDirty(core, &params, &m_results);
 	}
 
 	refresh();
@@ -44,20 +44,31 @@ void MessagePainter::resize(const QSize& size, bool lockAspectRatio, qreal scale
 	m_local = QPoint(1, GBA_VIDEO_VERTICAL_PIXELS - m_messageFont.pixelSize() - 1);
 	m_local = m_world.map(m_local);
 	m_local += QPoint((w - drawW) / 2, (h - drawH) / 2);
+	m_statisticsLocal = m_world.map(QPoint(1, 1)) + QPoint((w - drawW) / 2, (h - drawH) / 2);
 	m_pixmapBuffer = QPixmap(drawW * m_scaleFactor,
 		                     (m_messageFont.pixelSize() + 2) * m_world.m22() * m_scaleFactor);
 	m_pixmapBuffer.setDevicePixelRatio(m_scaleFactor);
 	m_mutex.lock();
 	m_message.prepare(m_world, m_messageFont);
+	m_statistics.prepare(m_world, m_messageFont);
 	redraw();
+	redrawStatistics();
 	m_mutex.unlock();
 }
 
 void MessagePainter::redraw() {
+	renderText(m_message, &m_pixmap);
+}
+
+void MessagePainter::redrawStatistics() {
+	renderText(m_statistics, &m_statisticsPixmap);
+}
+
+void MessagePainter::renderText(const QStaticText& text, QPixmap* pixmap) {
 	m_pixmapBuffer.fill(Qt::transparent);
-	if (m_message.text().isEmpty()) {
-		m_pixmap = m_pixmapBuffer;
-		m_pixmap.setDevicePixelRatio(m_scaleFactor);
+	if (text.text().isEmpty()) {
+		*pixmap = m_pixmapBuffer;
+		pixmap->setDevicePixelRatio(m_scaleFactor);
 		return;
 	}
 	QPainter painter(&m_pixmapBuffer);
@@ -69,19 +80,23 @@ void MessagePainter::redraw() {
 	for (int i = 0; i < ITERATIONS; ++i) {
 		painter.save();
 		painter.translate(cos(i * 2.0 * M_PI / ITERATIONS) * 0.8, sin(i * 2.0 * M_PI / ITERATIONS) * 0.8);
-		painter.drawStaticText(0, 0, m_message);
+		painter.drawStaticText(0, 0, text);
 		painter.restore();
 	}
 	painter.setPen(Qt::white);
-	painter.drawStaticText(0, 0, m_message);
-	m_pixmap = m_pixmapBuffer;
-	m_pixmap.setDevicePixelRatio(m_scaleFactor);
+	painter.drawStaticText(0, 0, text);
+	painter.end();
+	*pixmap = m_pixmapBuffer;
+	pixmap->setDevicePixelRatio(m_scaleFactor);
 }
 
 void MessagePainter::paint(QPainter* painter) {
 	if (!m_message.text().isEmpty()) {
 		painter->drawPixmap(m_local, m_pixmap);
 	}
+	if (!m_statistics.text().isEmpty()) {
+		painter->drawPixmap(m_statisticsLocal, m_statisticsPixmap);
+	}
 }
 
 
@@ -94,6 +109,13 @@ void MessagePainter::showMessage(const QString& message) {
 	m_messageTimer.start();
 }
 
+void MessagePainter::showStatistics(const QString& statistics) {
+	m_mutex.lock();
+	m_statistics.setText(statistics);
+	redrawStatistics();
+	m_mutex.unlock();
+}
+
 void MessagePainter::clearMessage() {
 	m_mutex.lock();
 	m_message.setText(QString());
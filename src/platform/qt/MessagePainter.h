@@ -26,14 +26,20 @@ public:
 public slots:
 	void showMessage(const QString& message);
 	void clearMessage();
+	void showStatistics(const QString& statistics);
 
 private:
 	void redraw();
+	void redrawStatistics();
+	void renderText(const QStaticText& text, QPixmap* pixmap);
 
 	QMutex m_mutex;
 	QStaticText m_message;
 	QPixmap m_pixmap;
 	QPixmap m_pixmapBuffer;
+	QStaticText m_statistics;
+	QPixmap m_statisticsPixmap;
+	QPoint m_statisticsLocal;
 	QTimer m_messageTimer{this};
 	QPoint m_local;
 	QTransform m_world;
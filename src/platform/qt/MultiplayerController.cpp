@@ -185,14 +185,24 @@ bool MultiplayerController::attachGame(CoreController* controller) {
 	if (m_lockstep.attached == 0) {
 		switch (controller->platform()) {
 #ifdef M_CORE_GBA
-		case PLATFORM_GBA:
+		case PLATFORM_GBA: {
 			GBASIOLockstepInit(&m_gbaLockstep);
+			int budget;
+			if (controller->thread() && mCoreConfigGetIntValue(&controller->thread()->core->config, "gba.lockstepBudget", &budget)) {
+				GBASIOLockstepSetCycleBudget(&m_gbaLockstep, budget);
+			}
 			break;
+		}
 #endif
 #ifdef M_CORE_GB
-		case PLATFORM_GB:
+		case PLATFORM_GB: {
 			GBSIOLockstepInit(&m_gbLockstep);
+			int budget;
+			if (controller->thread() && mCoreConfigGetIntValue(&controller->thread()->core->config, "gb.lockstepBudget", &budget)) {
+				GBSIOLockstepSetCycleBudget(&m_gbLockstep, budget);
+			}
 			break;
+		}
 #endif
 		default:
 			return false;
@@ -302,6 +312,13 @@ int MultiplayerController::playerId(CoreController* controller) {
 	return -1;
 }
 
+CoreController* MultiplayerController::controller(int playerId) {
+	if (playerId < 0 || playerId >= m_players.count()) {
+		return nullptr;
+	}
+	return m_players[playerId].controller;
+}
+
 int MultiplayerController::attached() {
 	int num;
 	num = m_lockstep.attached;
@@ -38,6 +38,7 @@ public:
 
 	int attached();
 	int playerId(CoreController*);
+	CoreController* controller(int playerId);
 
 signals:
 	void gameAttached();
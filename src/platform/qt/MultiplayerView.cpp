@@ -0,0 +1,104 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "MultiplayerView.h"
+
+#include "CoreController.h"
+#include "MultiplayerController.h"
+
+#include <QCloseEvent>
+#include <QPainter>
+
+#include <mgba/core/core.h>
+#include <mgba/gba/interface.h>
+
+using namespace QGBA;
+
+MultiplayerView::MultiplayerView(MultiplayerController* multiplayer, QWidget* parent)
+	: QOpenGLWidget(parent)
+	, m_multiplayer(multiplayer)
+{
+	setWindowTitle(tr("Multiplayer"));
+	setMinimumSize(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
+	resize(GBA_VIDEO_HORIZONTAL_PIXELS * 4, GBA_VIDEO_VERTICAL_PIXELS * 4);
+
+	connect(m_multiplayer, &MultiplayerController::gameAttached, this, &MultiplayerView::updatePlayers);
+	connect(m_multiplayer, &MultiplayerController::gameDetached, this, &MultiplayerView::updatePlayers);
+	updatePlayers();
+}
+
+void MultiplayerView::setFiltered(bool filter) {
+	m_filter = filter;
+	update();
+}
+
+void MultiplayerView::updatePlayers() {
+	for (CoreController* controller : m_players) {
+		disconnect(controller, nullptr, this, nullptr);
+	}
+	m_players.clear();
+	for (int i = 0; i < m_multiplayer->attached(); ++i) {
+		CoreController* controller = m_multiplayer->controller(i);
+		if (!controller) {
+			continue;
+		}
+		m_players.append(controller);
+		connect(controller, &CoreController::frameAvailable, this, [this]() {
+			update();
+		});
+	}
+	update();
+}
+
+QImage MultiplayerView::frame(CoreController* controller) {
+	// The buffer stays the caller's until the next takeFrame, so it only needs to outlive this paint
+	const color_t* buffer = controller->takeFrame();
+	if (!buffer) {
+		return QImage();
+	}
+	QSize size = controller->screenDimensions();
+	const uchar* bits = reinterpret_cast<const uchar*>(buffer);
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+	return QImage(bits, size.width(), size.height(), QImage::Format_RGB16);
+#else
+	return QImage(bits, size.width(), size.height(), QImage::Format_RGB555);
+#endif
+#else
+	return QImage(bits, size.width(), size.height(), QImage::Format_RGBX8888);
+#endif
+}
+
+void MultiplayerView::paintGL() {
+	QPainter painter(this);
+	painter.fillRect(rect(), Qt::black);
+	if (m_filter) {
+		painter.setRenderHint(QPainter::SmoothPixmapTransform);
+	}
+	if (m_players.isEmpty()) {
+		return;
+	}
+
+	int columns = m_players.count() > 1 ? 2 : 1;
+	int rows = (m_players.count() + columns - 1) / columns;
+	int cellWidth = width() / columns;
+	int cellHeight = height() / rows;
+	for (int i = 0; i < m_players.count(); ++i) {
+		QImage image = frame(m_players[i]);
+		if (image.isNull()) {
+			continue;
+		}
+		QRect cell((i % columns) * cellWidth, (i / columns) * cellHeight, cellWidth, cellHeight);
+		QSize drawSize = image.size().scaled(cell.size(), Qt::KeepAspectRatio);
+		QRect target(QPoint(), drawSize);
+		target.moveCenter(cell.center());
+		painter.drawImage(target, image);
+	}
+}
+
+void MultiplayerView::closeEvent(QCloseEvent* event) {
+	emit closed();
+	QOpenGLWidget::closeEvent(event);
+}
@@ -0,0 +1,45 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include <QImage>
+#include <QList>
+#include <QOpenGLWidget>
+
+namespace QGBA {
+
+class CoreController;
+class MultiplayerController;
+
+// Shows every linked player in a grid from one GL context. Frames posted by any of the cores only
+// schedule a repaint, so however many arrive between refreshes, the window is drawn and swapped once.
+class MultiplayerView : public QOpenGLWidget {
+Q_OBJECT
+
+public:
+	MultiplayerView(MultiplayerController* multiplayer, QWidget* parent = nullptr);
+
+	void setFiltered(bool filter);
+
+signals:
+	void closed();
+
+protected:
+	virtual void paintGL() override;
+	virtual void closeEvent(QCloseEvent*) override;
+
+private slots:
+	void updatePlayers();
+
+private:
+	QImage frame(CoreController*);
+
+	MultiplayerController* m_multiplayer;
+	QList<CoreController*> m_players;
+	bool m_filter = false;
+};
+
+}
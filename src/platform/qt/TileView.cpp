@@ -93,6 +93,7 @@ void TileView::updateTilesGBA(bool force) {
 	if (m_ui.palette256->isChecked()) {
 		m_ui.tiles->setTileCount(1536);
 		mTileCache* cache = mTileCacheSetGetPointer(&m_cacheSet->tiles, 1);
+		mTileCacheRegenerateDirty(cache, 0);
 		for (int i = 0; i < 1024; ++i) {
 			const color_t* data = mTileCacheGetTileIfDirty(cache, &m_tileStatus[16 * i], i, 0);
 			if (data) {
@@ -102,6 +103,7 @@ void TileView::updateTilesGBA(bool force) {
 			}
 		}
 		cache = mTileCacheSetGetPointer(&m_cacheSet->tiles, 3);
+		mTileCacheRegenerateDirty(cache, 0);
 		for (int i = 1024; i < 1536; ++i) {
 			const color_t* data = mTileCacheGetTileIfDirty(cache, &m_tileStatus[16 * i], i - 1024, 0);
 			if (data) {
@@ -113,6 +115,7 @@ void TileView::updateTilesGBA(bool force) {
 	} else {
 		mTileCache* cache = mTileCacheSetGetPointer(&m_cacheSet->tiles, 0);
 		m_ui.tiles->setTileCount(3072);
+		mTileCacheRegenerateDirty(cache, m_paletteId);
 		for (int i = 0; i < 2048; ++i) {
 			const color_t* data = mTileCacheGetTileIfDirty(cache, &m_tileStatus[16 * i], i, m_paletteId);
 			if (data) {
@@ -122,6 +125,7 @@ void TileView::updateTilesGBA(bool force) {
 			}
 		}
 		cache = mTileCacheSetGetPointer(&m_cacheSet->tiles, 2);
+		mTileCacheRegenerateDirty(cache, m_paletteId);
 		for (int i = 2048; i < 3072; ++i) {
 			const color_t* data = mTileCacheGetTileIfDirty(cache, &m_tileStatus[16 * i], i - 2048, m_paletteId);
 			if (data) {
@@ -140,6 +144,7 @@ void TileView::updateTilesGB(bool force) {
 	int count = gb->model >= GB_MODEL_CGB ? 1024 : 512;
 	m_ui.tiles->setTileCount(count);
 	mTileCache* cache = mTileCacheSetGetPointer(&m_cacheSet->tiles, 0);
+	mTileCacheRegenerateDirty(cache, m_paletteId);
 	for (int i = 0; i < count; ++i) {
 		const color_t* data = mTileCacheGetTileIfDirty(cache, &m_tileStatus[8 * i], i, m_paletteId);
 		if (data) {
@@ -58,8 +58,14 @@ VideoView::VideoView(QWidget* parent)
 		s_vcodecMap["dirac"] = "libschroedinger";
 		s_vcodecMap["h264"] = "libx264";
 		s_vcodecMap["h264 nvenc"] = "h264_nvenc";
+		s_vcodecMap["h264 qsv"] = "h264_qsv";
+		s_vcodecMap["h264 vaapi"] = "h264_vaapi";
+		s_vcodecMap["h264 videotoolbox"] = "h264_videotoolbox";
 		s_vcodecMap["hevc"] = "libx265";
 		s_vcodecMap["hevc nvenc"] = "hevc_nvenc";
+		s_vcodecMap["hevc qsv"] = "hevc_qsv";
+		s_vcodecMap["hevc vaapi"] = "hevc_vaapi";
+		s_vcodecMap["hevc videotoolbox"] = "hevc_videotoolbox";
 		s_vcodecMap["theora"] = "libtheora";
 		s_vcodecMap["vp8"] = "libvpx";
 		s_vcodecMap["vp9"] = "libvpx-vp9";
@@ -38,6 +38,7 @@
 #include "LoadSaveState.h"
 #include "LogView.h"
 #include "MapView.h"
+#include "MemoryHeatmapView.h"
 #include "MemorySearch.h"
 #include "MemoryView.h"
 #include "MultiplayerController.h"
@@ -164,9 +165,7 @@ Window::~Window() {
 	delete m_videoView;
 #endif
 
-#ifdef USE_MAGICK
 	delete m_gifView;
-#endif
 
 #ifdef USE_SQLITE3
 	delete m_libraryView;
@@ -251,6 +250,7 @@ void Window::reloadConfig() {
 		m_controller->loadConfig(m_config);
 		if (m_audioProcessor) {
 			m_audioProcessor->setBufferSamples(opts->audioBuffers);
+			m_audioProcessor->setLowLatency(opts->lowLatencyAudio);
 			m_audioProcessor->requestSampleRate(opts->sampleRate);
 		}
 		m_display->resizeContext();
@@ -258,6 +258,7 @@ void Window::reloadConfig() {
 	if (m_display) {
 		m_display->lockAspectRatio(opts->lockAspectRatio);
 		m_display->filter(opts->resampleVideo);
+		m_display->setPacedPresent(m_config->getOption("pacedPresent").toInt());
 	}
 
 	m_inputController.setScreensaverSuspendable(opts->suspendScreensaver);
@@ -411,6 +412,23 @@ void Window::multiplayerChanged() {
 	}
 }
 
+void Window::setSharedDisplay(bool shared) {
+	if (m_sharedDisplay == shared) {
+		return;
+	}
+	m_sharedDisplay = shared;
+	if (!m_controller || !m_display) {
+		return;
+	}
+	if (shared) {
+		disconnect(m_controller.get(), &CoreController::frameAvailable, m_display.get(), &Display::framePosted);
+		m_display->stopDrawing();
+	} else {
+		connect(m_controller.get(), &CoreController::frameAvailable, m_display.get(), &Display::framePosted);
+		m_display->startDrawing(m_controller);
+	}
+}
+
 void Window::selectPatch() {
 	QString filename = GBAApp::app()->getOpenFileName(this, tr("Select patch"), tr("Patches (*.ips *.ups *.bps)"));
 	if (!filename.isEmpty()) {
@@ -506,7 +524,6 @@ void Window::openVideoWindow() {
 }
 #endif
 
-#ifdef USE_MAGICK
 void Window::openGIFWindow() {
 	if (!m_gifView) {
 		m_gifView = new GIFView();
@@ -517,7 +534,6 @@ void Window::openGIFWindow() {
 	}
 	m_gifView->show();
 }
-#endif
 
 #ifdef USE_GDB_STUB
 void Window::gdbOpen() {
@@ -884,6 +900,7 @@ void Window::reloadDisplayDriver() {
 	const mCoreOptions* opts = m_config->options();
 	m_display->lockAspectRatio(opts->lockAspectRatio);
 	m_display->filter(opts->resampleVideo);
+	m_display->setPacedPresent(m_config->getOption("pacedPresent").toInt());
 #if defined(BUILD_GL) || defined(BUILD_GLES2)
 	if (opts->shader) {
 		struct VDir* shader = VDirOpen(opts->shader);
@@ -901,11 +918,13 @@ void Window::reloadDisplayDriver() {
 		connect(m_controller.get(), &CoreController::rewound, m_display.get(), &Display::forceDraw);
 		connect(m_controller.get(), &CoreController::paused, m_display.get(), &Display::pauseDrawing);
 		connect(m_controller.get(), &CoreController::unpaused, m_display.get(), &Display::unpauseDrawing);
-		connect(m_controller.get(), &CoreController::frameAvailable, m_display.get(), &Display::framePosted);
 		connect(m_controller.get(), &CoreController::statusPosted, m_display.get(), &Display::showMessage);
 
 		attachWidget(m_display.get());
-		m_display->startDrawing(m_controller);
+		if (!m_sharedDisplay) {
+			connect(m_controller.get(), &CoreController::frameAvailable, m_display.get(), &Display::framePosted);
+			m_display->startDrawing(m_controller);
+		}
 	}
 #ifdef M_CORE_GB
 	m_display->setMinimumSize(GB_VIDEO_HORIZONTAL_PIXELS, GB_VIDEO_VERTICAL_PIXELS);
@@ -927,6 +946,7 @@ void Window::reloadAudioDriver() {
 	m_audioProcessor = std::move(std::unique_ptr<AudioProcessor>(AudioProcessor::create()));
 	m_audioProcessor->setInput(m_controller);
 	m_audioProcessor->setBufferSamples(opts->audioBuffers);
+	m_audioProcessor->setLowLatency(opts->lowLatencyAudio);
 	m_audioProcessor->requestSampleRate(opts->sampleRate);
 	m_audioProcessor->start();
 	connect(m_controller.get(), &CoreController::stopping, m_audioProcessor.get(), &AudioProcessor::stop);
@@ -1157,6 +1177,10 @@ void Window::setupMenu(QMenuBar* menubar) {
 		GBAApp::app()->newWindow();
 	}, "file");
 
+	ConfigOption* sharedMultiplayerView = m_config->addOption("sharedMultiplayerView");
+	sharedMultiplayerView->addBoolean(tr("Show all players in one window"), &m_actions, "file");
+	m_config->updateOption("sharedMultiplayerView");
+
 #ifndef Q_OS_MAC
 	m_actions.addSeparator("file");
 #endif
@@ -1340,6 +1364,15 @@ void Window::setupMenu(QMenuBar* menubar) {
 	}, this);
 	m_config->updateOption("lockIntegerScaling");
 
+	ConfigOption* pacedPresent = m_config->addOption("pacedPresent");
+	pacedPresent->addBoolean(tr("Pace frames to display refresh"), &m_actions, "av");
+	pacedPresent->connect([this](const QVariant& value) {
+		if (m_display) {
+			m_display->setPacedPresent(value.toBool());
+		}
+	}, this);
+	m_config->updateOption("pacedPresent");
+
 	ConfigOption* resampleVideo = m_config->addOption("resampleVideo");
 	resampleVideo->addBoolean(tr("Bilinear filtering"), &m_actions, "av");
 	resampleVideo->connect([this](const QVariant& value) {
@@ -1400,9 +1433,7 @@ void Window::setupMenu(QMenuBar* menubar) {
 	addGameAction(tr("Record A/V..."), "recordOutput", this, &Window::openVideoWindow, "av");
 #endif
 
-#ifdef USE_MAGICK
 	addGameAction(tr("Record GIF..."), "recordGIF", this, &Window::openGIFWindow, "av");
-#endif
 
 	m_actions.addSeparator("av");
 	m_actions.addMenu(tr("Video layers"), "videoLayers", "av");
@@ -1457,6 +1488,7 @@ void Window::setupMenu(QMenuBar* menubar) {
 	addGameAction(tr("View &map..."), "mapWindow", openControllerTView<MapView>(), "tools");
 	addGameAction(tr("View memory..."), "memoryView", openControllerTView<MemoryView>(), "tools");
 	addGameAction(tr("Search memory..."), "memorySearch", openControllerTView<MemorySearch>(), "tools");
+	addGameAction(tr("View memory heatmap..."), "memoryHeatmap", openControllerTView<MemoryHeatmapView>(), "tools");
 
 #ifdef M_CORE_GBA
 	Action* ioViewer = addGameAction(tr("View &I/O registers..."), "ioViewer", openControllerTView<IOViewer>(), "tools");
@@ -1742,7 +1774,9 @@ void Window::setController(CoreController* controller, const QString& fname) {
 	m_inputController.recalibrateAxes();
 	m_controller->setInputController(&m_inputController);
 	m_controller->setLogger(&m_log);
-	m_display->startDrawing(m_controller);
+	if (!m_sharedDisplay) {
+		m_display->startDrawing(m_controller);
+	}
 
 	connect(this, &Window::shutdown, [this]() {
 		if (!m_controller) {
@@ -1782,7 +1816,9 @@ void Window::setController(CoreController* controller, const QString& fname) {
 	connect(m_controller.get(), &CoreController::rewound, m_display.get(), &Display::forceDraw);
 	connect(m_controller.get(), &CoreController::paused, m_display.get(), &Display::pauseDrawing);
 	connect(m_controller.get(), &CoreController::unpaused, m_display.get(), &Display::unpauseDrawing);
-	connect(m_controller.get(), &CoreController::frameAvailable, m_display.get(), &Display::framePosted);
+	if (!m_sharedDisplay) {
+		connect(m_controller.get(), &CoreController::frameAvailable, m_display.get(), &Display::framePosted);
+	}
 	connect(m_controller.get(), &CoreController::statusPosted, m_display.get(), &Display::showMessage);
 
 	connect(m_controller.get(), &CoreController::unpaused, &m_inputController, &InputController::suspendScreensaver);
@@ -1803,11 +1839,9 @@ void Window::setController(CoreController* controller, const QString& fname) {
 	}
 #endif
 
-#ifdef USE_MAGICK
 	if (m_gifView) {
 		m_gifView->setController(m_controller);
 	}
-#endif
 
 #ifdef USE_FFMPEG
 	if (m_videoView) {
@@ -86,6 +86,7 @@ public slots:
 	void replaceROM();
 
 	void multiplayerChanged();
+	void setSharedDisplay(bool shared);
 
 	void importSharkport();
 	void exportSharkport();
@@ -102,9 +103,7 @@ public slots:
 	void openVideoWindow();
 #endif
 
-#ifdef USE_MAGICK
 	void openGIFWindow();
-#endif
 
 #ifdef USE_GDB_STUB
 	void gdbOpen();
@@ -210,6 +209,8 @@ private:
 	QString m_pendingState;
 	bool m_pendingPause = false;
 	bool m_pendingClose = false;
+	// Another window is showing this game's frames, so the display here is left idle
+	bool m_sharedDisplay = false;
 
 	bool m_hitUnimplementedBiosCall;
 
@@ -220,9 +221,7 @@ private:
 	VideoView* m_videoView = nullptr;
 #endif
 
-#ifdef USE_MAGICK
 	GIFView* m_gifView = nullptr;
-#endif
 
 #ifdef USE_GDB_STUB
 	GDBController* m_gdbController = nullptr;
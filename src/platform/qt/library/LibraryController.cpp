@@ -10,6 +10,8 @@
 #include "LibraryGrid.h"
 #include "LibraryTree.h"
 
+#include <QSet>
+
 namespace QGBA {
 
 LibraryEntry::LibraryEntry(mLibraryEntry* entry)
@@ -130,7 +132,7 @@ void LibraryController::refresh() {
 
 	setDisabled(true);
 
-	QStringList allEntries;
+	QSet<QString> allEntries;
 	QList<LibraryEntryRef> newEntries;
 
 	mLibraryListingClear(&m_listing);
@@ -145,15 +147,17 @@ void LibraryController::refresh() {
 			m_entries.insert(fullpath, libentry);
 			newEntries.append(libentry);
 		}
-		allEntries.append(fullpath);
+		allEntries.insert(fullpath);
 	}
 
 	// Check for entries that were removed
 	QList<LibraryEntryRef> removedEntries;
-	for (QString& path : m_entries.keys()) {
-		if (!allEntries.contains(path)) {
-			removedEntries.append(m_entries.value(path));
-			m_entries.remove(path);
+	for (auto iter = m_entries.begin(); iter != m_entries.end();) {
+		if (!allEntries.contains(iter.key())) {
+			removedEntries.append(iter.value());
+			iter = m_entries.erase(iter);
+		} else {
+			++iter;
 		}
 	}
 
@@ -56,6 +56,19 @@ void LibraryGrid::setViewStyle(LibraryStyle newStyle) {
 	m_widget->setDragEnabled(false);
 }
 
+void LibraryGrid::addEntries(QList<LibraryEntryRef> items) {
+	// Relaying out the grid after every item adds up quickly with large libraries
+	m_widget->setUpdatesEnabled(false);
+	AbstractGameList::addEntries(items);
+	m_widget->setUpdatesEnabled(true);
+}
+
+void LibraryGrid::removeEntries(QList<LibraryEntryRef> items) {
+	m_widget->setUpdatesEnabled(false);
+	AbstractGameList::removeEntries(items);
+	m_widget->setUpdatesEnabled(true);
+}
+
 void LibraryGrid::addEntry(LibraryEntryRef item) {
 	if (m_items.contains(item)) {
 		return;
@@ -22,7 +22,9 @@ public:
 
 	virtual void setViewStyle(LibraryStyle newStyle) override;
 
+	virtual void addEntries(QList<LibraryEntryRef> items) override;
 	virtual void addEntry(LibraryEntryRef item) override;
+	virtual void removeEntries(QList<LibraryEntryRef> items) override;
 	virtual void removeEntry(LibraryEntryRef entry) override;
 
 	virtual QWidget* widget() override { return m_widget; }
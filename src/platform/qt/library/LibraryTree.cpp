@@ -9,6 +9,7 @@
 
 #include <QApplication>
 #include <QDir>
+#include <QHash>
 
 namespace QGBA {
 
@@ -111,6 +112,12 @@ void LibraryTree::addEntries(QList<LibraryEntryRef> items) {
 	rebuildTree();
 }
 
+void LibraryTree::removeEntries(QList<LibraryEntryRef> items) {
+	m_widget->setUpdatesEnabled(false);
+	AbstractGameList::removeEntries(items);
+	m_widget->setUpdatesEnabled(true);
+}
+
 void LibraryTree::addEntry(LibraryEntryRef item) {
 	if (m_items.contains(item)) {
 		return;
@@ -152,6 +159,10 @@ void LibraryTree::rebuildTree() {
 
 	LibraryEntryRef currentGame = selectedEntry();
 
+	// Sorting on every insertion makes this quadratic, so only sort once everything is in place
+	m_widget->setUpdatesEnabled(false);
+	m_widget->setSortingEnabled(false);
+
 	int count = m_widget->topLevelItemCount();
 	for (int a = count - 1; a >= 0; --a) {
 		m_widget->takeTopLevelItem(a);
@@ -165,18 +176,22 @@ void LibraryTree::rebuildTree() {
 		for (QTreeWidgetItem* i : m_pathNodes.values()) {
 			m_widget->addTopLevelItem(i);
 		}
-		for (QTreeWidgetItem* i : m_items.values()) {
-			m_pathNodes.value(m_items.key(i)->base())->addChild(i);
+		QHash<QString, QList<QTreeWidgetItem*>> children;
+		for (auto iter = m_items.constBegin(); iter != m_items.constEnd(); ++iter) {
+			children[iter.key()->base()].append(iter.value());
 		}
-	} else {
-		for (QTreeWidgetItem* i : m_items.values()) {
-			m_widget->addTopLevelItem(i);
+		for (auto iter = children.constBegin(); iter != children.constEnd(); ++iter) {
+			m_pathNodes.value(iter.key())->addChildren(iter.value());
 		}
+	} else {
+		m_widget->addTopLevelItems(m_items.values());
 	}
 
+	m_widget->setSortingEnabled(true);
 	m_widget->expandAll();
 	resizeAllCols();
 	selectEntry(currentGame);
+	m_widget->setUpdatesEnabled(true);
 }
 
 }
@@ -34,6 +34,7 @@ public:
 	virtual void addEntries(QList<LibraryEntryRef> items) override;
 	virtual void addEntry(LibraryEntryRef item) override;
 	virtual void removeEntry(LibraryEntryRef item) override;
+	virtual void removeEntries(QList<LibraryEntryRef> items) override;
 
 	virtual QWidget* widget() override { return m_widget; }
 
@@ -58,6 +58,12 @@ bool mSDLGLES2Init(struct mSDLRenderer* renderer) {
 	renderer->gl2.d.init(&renderer->gl2.d, 0);
 	renderer->gl2.d.setDimensions(&renderer->gl2.d, renderer->width, renderer->height);
 
+	// Skip the upload copy when the core can draw straight into a mapped pixel buffer
+	color_t* frame = mGLES2ContextBeginStreaming(&renderer->gl2);
+	if (frame) {
+		renderer->core->setVideoBuffer(renderer->core, frame, renderer->width);
+	}
+
 	mSDLGLDoViewport(renderer->viewportWidth, renderer->viewportHeight, &renderer->gl2.d);
 	return true;
 }
@@ -85,7 +91,12 @@ void mSDLGLES2Runloop(struct mSDLRenderer* renderer, void* user) {
 		}
 
 		if (mCoreSyncWaitFrameStart(&context->impl->sync)) {
-			v->postFrame(v, renderer->outputBuffer);
+			if (renderer->gl2.mappedFrame) {
+				color_t* frame = mGLES2ContextStreamFrame(&renderer->gl2);
+				renderer->core->setVideoBuffer(renderer->core, frame ? frame : renderer->outputBuffer, renderer->width);
+			} else {
+				v->postFrame(v, renderer->outputBuffer);
+			}
 		}
 		mCoreSyncWaitFrameEnd(&context->impl->sync);
 		v->drawFrame(v);
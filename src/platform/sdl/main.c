@@ -26,6 +26,7 @@
 #include <mgba/core/config.h>
 #include <mgba/core/input.h>
 #include <mgba/core/serialize.h>
+#include <mgba/core/startup.h>
 #include <mgba/core/thread.h>
 #include <mgba/internal/gba/input.h>
 
@@ -50,6 +51,11 @@ static void _loadState(struct mCoreThread* thread) {
 	mCoreLoadStateNamed(thread->core, _state, SAVESTATE_RTC);
 }
 
+static void _keysRead(struct mCoreThread* thread) {
+	struct mSDLRenderer* renderer = thread->userData;
+	mSDLUpdateJoystickKeys(&renderer->player, thread->core);
+}
+
 int main(int argc, char** argv) {
 	struct mSDLRenderer renderer = {0};
 
@@ -197,13 +203,16 @@ int wmain(int argc, wchar_t** argv) {
 
 int mSDLRun(struct mSDLRenderer* renderer, struct mArguments* args) {
 	struct mCoreThread thread = {
-		.core = renderer->core
+		.core = renderer->core,
+		.keysReadCallback = _keysRead,
+		.userData = renderer
 	};
-	if (!mCoreLoadFile(renderer->core, args->fname)) {
+	struct mCoreStartup startup;
+	mCoreStartupInit(&startup);
+	startup.patch = args->patch;
+	if (!mCoreStartupLoad(&startup, renderer->core, args->fname)) {
 		return 1;
 	}
-	mCoreAutoloadSave(renderer->core);
-	mCoreAutoloadCheats(renderer->core);
 #ifdef ENABLE_SCRIPTING
 	struct mScriptBridge* bridge = mScriptBridgeCreate();
 #ifdef ENABLE_PYTHON
@@ -228,16 +237,8 @@ int mSDLRun(struct mSDLRenderer* renderer, struct mArguments* args) {
 	}
 #endif
 
-	if (args->patch) {
-		struct VFile* patch = VFileOpen(args->patch, O_RDONLY);
-		if (patch) {
-			renderer->core->loadPatch(renderer->core, patch);
-		}
-	} else {
-		mCoreAutoloadPatch(renderer->core);
-	}
-
 	renderer->audio.samples = renderer->core->opts.audioBuffers;
+	renderer->audio.pull = renderer->core->opts.lowLatencyAudio;
 	renderer->audio.sampleRate = 44100;
 
 	bool didFail = !mCoreThreadStart(&thread);
@@ -52,6 +52,7 @@ struct mSDLRenderer {
 #if SDL_VERSION_ATLEAST(2, 0, 0)
 	SDL_Window* window;
 	SDL_Texture* sdlTex;
+	SDL_Texture* sdlTexShown;
 	SDL_Renderer* sdlRenderer;
 	SDL_GLContext* glCtx;
 #endif
@@ -28,6 +28,9 @@ bool mSDLInitAudio(struct mSDLAudio* context, struct mCoreThread* threadContext)
 	context->desiredSpec.format = AUDIO_S16SYS;
 	context->desiredSpec.channels = 2;
 	context->desiredSpec.samples = context->samples;
+	if (context->pull && (!context->samples || context->samples > mSDL_AUDIO_PULL_SAMPLES)) {
+		context->desiredSpec.samples = mSDL_AUDIO_PULL_SAMPLES;
+	}
 	context->desiredSpec.callback = _mSDLAudioCallback;
 	context->desiredSpec.userdata = context;
 
@@ -45,6 +48,18 @@ bool mSDLInitAudio(struct mSDLAudio* context, struct mCoreThread* threadContext)
 	if (threadContext) {
 		context->core = threadContext->core;
 		context->sync = &threadContext->impl->sync;
+		context->clockRate = 0;
+		context->blipRate = 0;
+		if (context->obtainedSpec.channels == 2) {
+			if (context->pull) {
+				// The ring only bounds how far the target can grow; the target sets the latency
+				mCoreSyncInitAudioRing(context->sync, mSDL_AUDIO_PULL_RING);
+				mCoreSyncSetAudioPull(context->sync, context->obtainedSpec.samples);
+			} else {
+				mCoreSyncInitAudioRing(context->sync, context->obtainedSpec.samples * 2);
+				mCoreSyncSetAudioPull(context->sync, 0);
+			}
+		}
 
 #if SDL_VERSION_ATLEAST(2, 0, 0)
 		SDL_PauseAudioDevice(context->deviceId, 0);
@@ -105,6 +120,19 @@ static void _mSDLAudioCallback(void* context, Uint8* data, int len) {
 		if (audioContext->sync->fpsTarget > 0) {
 			fauxClock = GBAAudioCalculateRatio(1, audioContext->sync->fpsTarget, 1);
 		}
+	}
+	if (mCoreSyncHasAudioRing(audioContext->sync)) {
+		// The blip buffers belong to the emulation thread now, so only lock to retune them
+		double blipRate = audioContext->obtainedSpec.freq * fauxClock;
+		if (clockRate != audioContext->clockRate || blipRate != audioContext->blipRate) {
+			mCoreSyncSetAudioRates(audioContext->sync, left, right, clockRate, blipRate);
+			audioContext->clockRate = clockRate;
+			audioContext->blipRate = blipRate;
+		}
+		mCoreSyncReadAudio(audioContext->sync, (int16_t*) data, len / (2 * sizeof(int16_t)));
+		return;
+	}
+	if (audioContext->sync) {
 		mCoreSyncLockAudio(audioContext->sync);
 	}
 	blip_set_rates(left, clockRate, audioContext->obtainedSpec.freq * fauxClock);
@@ -114,9 +142,10 @@ static void _mSDLAudioCallback(void* context, Uint8* data, int len) {
 	if (available > len) {
 		available = len;
 	}
-	blip_read_samples(left, (short*) data, available, audioContext->obtainedSpec.channels == 2);
 	if (audioContext->obtainedSpec.channels == 2) {
-		blip_read_samples(right, ((short*) data) + 1, available, 1);
+		blip_read_samples_stereo(left, right, (short*) data, available);
+	} else {
+		blip_read_samples(left, (short*) data, available, 0);
 	}
 
 	if (audioContext->sync) {
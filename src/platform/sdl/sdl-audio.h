@@ -22,12 +22,17 @@ CXX_GUARD_START
 #define bool _Bool
 #endif
 
+#define mSDL_AUDIO_PULL_SAMPLES 256
+#define mSDL_AUDIO_PULL_RING 4096
+
 mLOG_DECLARE_CATEGORY(SDL_AUDIO);
 
 struct mSDLAudio {
 	// Input
 	size_t samples;
 	unsigned sampleRate;
+	// Open the device with at most mSDL_AUDIO_PULL_SAMPLES and let it pace the audio ring
+	bool pull;
 
 	// State
 	SDL_AudioSpec desiredSpec;
@@ -38,6 +43,8 @@ struct mSDLAudio {
 
 	struct mCore* core;
 	struct mCoreSync* sync;
+	int32_t clockRate;
+	double blipRate;
 };
 
 struct mCoreThread;
@@ -592,6 +592,40 @@ static void _mSDLHandleWindowEvent(struct mSDLPlayer* sdlContext, const struct S
 }
 #endif
 
+static bool _mSDLLateInput(struct mCoreThread* context) {
+	return context->core->opts.lateInput && context->core->opts.runAhead <= 0;
+}
+
+void mSDLUpdateJoystickKeys(struct mSDLPlayer* sdlContext, struct mCore* core) {
+	int keys = 0;
+	if (sdlContext->joystick) {
+		SDL_Joystick* joystick = sdlContext->joystick->joystick;
+		SDL_JoystickUpdate();
+		int numButtons = SDL_JoystickNumButtons(joystick);
+		int i;
+		for (i = 0; i < numButtons; ++i) {
+			int key = mInputMapKey(sdlContext->bindings, SDL_BINDING_BUTTON, i);
+			if (key != -1 && SDL_JoystickGetButton(joystick, i)) {
+				keys |= 1 << key;
+			}
+		}
+		int numHats = SDL_JoystickNumHats(joystick);
+		for (i = 0; i < numHats; ++i) {
+			keys |= mInputMapHat(sdlContext->bindings, SDL_BINDING_BUTTON, i, SDL_JoystickGetHat(joystick, i));
+		}
+		int numAxes = SDL_JoystickNumAxes(joystick);
+		for (i = 0; i < numAxes; ++i) {
+			int key = mInputMapAxis(sdlContext->bindings, SDL_BINDING_BUTTON, i, SDL_JoystickGetAxis(joystick, i));
+			if (key != -1) {
+				keys |= 1 << key;
+			}
+		}
+	}
+	core->clearKeys(core, sdlContext->joystickKeys & ~keys);
+	core->addKeys(core, keys);
+	sdlContext->joystickKeys = keys;
+}
+
 void mSDLHandleEvent(struct mCoreThread* context, struct mSDLPlayer* sdlContext, const union SDL_Event* event) {
 	switch (event->type) {
 	case SDL_QUIT:
@@ -614,13 +648,19 @@ void mSDLHandleEvent(struct mCoreThread* context, struct mSDLPlayer* sdlContext,
 		break;
 	case SDL_JOYBUTTONDOWN:
 	case SDL_JOYBUTTONUP:
-		_mSDLHandleJoyButton(context, sdlContext, &event->jbutton);
+		if (!_mSDLLateInput(context)) {
+			_mSDLHandleJoyButton(context, sdlContext, &event->jbutton);
+		}
 		break;
 	case SDL_JOYHATMOTION:
-		_mSDLHandleJoyHat(context, sdlContext, &event->jhat);
+		if (!_mSDLLateInput(context)) {
+			_mSDLHandleJoyHat(context, sdlContext, &event->jhat);
+		}
 		break;
 	case SDL_JOYAXISMOTION:
-		_mSDLHandleJoyAxis(context, sdlContext, &event->jaxis);
+		if (!_mSDLLateInput(context)) {
+			_mSDLHandleJoyAxis(context, sdlContext, &event->jaxis);
+		}
 		break;
 	}
 }
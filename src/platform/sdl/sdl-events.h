@@ -63,6 +63,8 @@ struct mSDLPlayer {
 	size_t playerId;
 	struct mInputMap* bindings;
 	struct SDL_JoystickCombo* joystick;
+	// Keys held on the joystick as of the last mSDLUpdateJoystickKeys
+	int joystickKeys;
 	int fullscreen;
 	int windowUpdated;
 #if SDL_VERSION_ATLEAST(2, 0, 0)
@@ -117,6 +119,11 @@ void mSDLInitBindingsGBA(struct mInputMap* inputMap);
 struct mCoreThread;
 void mSDLHandleEvent(struct mCoreThread* context, struct mSDLPlayer* sdlContext, const union SDL_Event* event);
 
+struct mCore;
+// With the lateInput option, joystick events are ignored and the emulation thread samples the
+// joystick with this instead, right as the game reads the keys
+void mSDLUpdateJoystickKeys(struct mSDLPlayer*, struct mCore*);
+
 #if SDL_VERSION_ATLEAST(2, 0, 0)
 void mSDLSuspendScreensaver(struct mSDLEvents*);
 void mSDLResumeScreensaver(struct mSDLEvents*);
@@ -10,36 +10,35 @@
 #include <mgba/core/version.h>
 #include <mgba-util/arm-algo.h>
 
-static bool mSDLSWInit(struct mSDLRenderer* renderer);
-static void mSDLSWRunloop(struct mSDLRenderer* renderer, void* user);
-static void mSDLSWDeinit(struct mSDLRenderer* renderer);
-
-void mSDLSWCreate(struct mSDLRenderer* renderer) {
-	renderer->init = mSDLSWInit;
-	renderer->deinit = mSDLSWDeinit;
-	renderer->runloop = mSDLSWRunloop;
-}
-
-bool mSDLSWInit(struct mSDLRenderer* renderer) {
-	unsigned width, height;
-	renderer->core->desiredVideoDimensions(renderer->core, &width, &height);
-	renderer->window = SDL_CreateWindow(projectName, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, renderer->viewportWidth, renderer->viewportHeight, SDL_WINDOW_OPENGL | (SDL_WINDOW_FULLSCREEN_DESKTOP * renderer->player.fullscreen));
-	SDL_GetWindowSize(renderer->window, &renderer->viewportWidth, &renderer->viewportHeight);
-	renderer->player.window = renderer->window;
-	renderer->sdlRenderer = SDL_CreateRenderer(renderer->window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+static static SDL_Texture* _createTexture(struct mSDLRenderer* renderer, unsigned width, unsigned height) {
 #ifdef COLOR_16_BIT
 #ifdef COLOR_5_6_5
-	renderer->sdlTex = SDL_CreateTexture(renderer->sdlRenderer, SDL_PIXELFORMAT_RGB565, SDL_TEXTUREACCESS_STREAMING, width, height);
+	return SDL_CreateTexture(renderer->sdlRenderer, SDL_PIXELFORMAT_RGB565, SDL_TEXTUREACCESS_STREAMING, width, height);
 #else
-	renderer->sdlTex = SDL_CreateTexture(renderer->sdlRenderer, SDL_PIXELFORMAT_ABGR1555, SDL_TEXTUREACCESS_STREAMING, width, height);
+	return SDL_CreateTexture(renderer->sdlRenderer, SDL_PIXELFORMAT_ABGR1555, SDL_TEXTUREACCESS_STREAMING, width, height);
 #endif
 #else
-	renderer->sdlTex = SDL_CreateTexture(renderer->sdlRenderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+	return SDL_CreateTexture(renderer->sdlRenderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, width, height);
 #endif
+}
 
+static void _lockTexture(struct mSDLRenderer* renderer) {
 	int stride;
 	SDL_LockTexture(renderer->sdlTex, 0, (void**) &renderer->outputBuffer, &stride);
 	renderer->core->setVideoBuffer(renderer->core, renderer->outputBuffer, stride / BYTES_PER_PIXEL);
+}
+
+bool mSDLSWInit(struct mSDLRenderer* renderer) {
+	unsigned width, height;
+	renderer->core->desiredVideoDimensions(renderer->core, &width, &height);
+	renderer->window = SDL_CreateWindow(projectName, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, renderer->viewportWidth, renderer->viewportHeight, SDL_WINDOW_OPENGL | (SDL_WINDOW_FULLSCREEN_DESKTOP * renderer->player.fullscreen));
+	SDL_GetWindowSize(renderer->window, &renderer->viewportWidth, &renderer->viewportHeight);
+	renderer->player.window = renderer->window;
+	renderer->sdlRenderer = SDL_CreateRenderer(renderer->window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+	// The core draws straight into whichever texture is locked while the other one is on screen
+	renderer->sdlTex = _createTexture(renderer, width, height);
+	renderer->sdlTexShown = _createTexture(renderer, width, height);
+	_lockTexture(renderer);
 
 	return true;
 }
@@ -53,20 +52,26 @@ void mSDLSWRunloop(struct mSDLRenderer* renderer, void* user) {
 			mSDLHandleEvent(context, &renderer->player, &event);
 		}
 
+		bool present = false;
 		if (mCoreSyncWaitFrameStart(&context->impl->sync)) {
 			SDL_UnlockTexture(renderer->sdlTex);
-			SDL_RenderCopy(renderer->sdlRenderer, renderer->sdlTex, 0, 0);
-			SDL_RenderPresent(renderer->sdlRenderer);
-			int stride;
-			SDL_LockTexture(renderer->sdlTex, 0, (void**) &renderer->outputBuffer, &stride);
-			renderer->core->setVideoBuffer(renderer->core, renderer->outputBuffer, stride / BYTES_PER_PIXEL);
+			SDL_Texture* finished = renderer->sdlTex;
+			renderer->sdlTex = renderer->sdlTexShown;
+			renderer->sdlTexShown = finished;
+			_lockTexture(renderer);
+			present = true;
 		}
 		mCoreSyncWaitFrameEnd(&context->impl->sync);
+
+		// Presenting can block on vsync, so it happens after the core is free to start the next frame
+		if (present) {
+			SDL_RenderCopy(renderer->sdlRenderer, renderer->sdlTexShown, 0, 0);
+			SDL_RenderPresent(renderer->sdlRenderer);
+		}
 	}
 }
 
 void mSDLSWDeinit(struct mSDLRenderer* renderer) {
-	if (renderer->ratio > 1) {
-		free(renderer->outputBuffer);
-	}
+	// The output buffer belongs to the locked texture, which goes away with the window
+	UNUSED(renderer);
 }
@@ -11,6 +11,7 @@
 #include <mgba-util/gui.h>
 #include <mgba-util/gui/font.h>
 #include <mgba-util/gui/menu.h>
+#include <mgba-util/threading.h>
 
 #include <switch.h>
 #include <EGL/egl.h>
@@ -86,6 +87,13 @@ static int audioBufferActive;
 static struct GBAStereoSample audioBuffer[N_BUFFERS][SAMPLES] __attribute__((__aligned__(0x1000)));
 static AudioOutBuffer audoutBuffer[N_BUFFERS];
 static int enqueuedBuffers;
+// Buffers the emulation thread has filled that the audio thread hasn't handed to audout yet
+static int pendingBuffers;
+static bool audioRunning;
+static Thread audioThread;
+static Mutex audioMutex;
+static Condition audioQueued;
+static Condition audioReleased;
 static bool frameLimiter = true;
 static unsigned framecount = 0;
 static unsigned framecap = 10;
@@ -231,6 +239,10 @@ static enum GUICursorState _pollCursor(unsigned* x, unsigned* y) {
 
 
 static void _setup(struct mGUIRunner* runner) {
+	// The render thread gets core 1 and the audio thread core 2, leaving core 0 to the emulator
+	mCoreConfigSetDefaultIntValue(&runner->config, "threadedVideo", 1);
+	mCoreLoadForeignConfig(runner->core, &runner->config);
+
 	_mapKey(&runner->core->inputMap, AUTO_INPUT, KEY_A, GBA_KEY_A);
 	_mapKey(&runner->core->inputMap, AUTO_INPUT, KEY_B, GBA_KEY_B);
 	_mapKey(&runner->core->inputMap, AUTO_INPUT, KEY_PLUS, GBA_KEY_START);
@@ -393,47 +405,105 @@ static void _incrementScreenMode(struct mGUIRunner* runner) {
 	mCoreConfigSetUIntValue(&runner->config, "screenMode", screenMode);
 }
 
-static void _setFrameLimiter(struct mGUIRunner* runner, bool limit) {
-	UNUSED(runner);
-	if (!frameLimiter && limit) {
-		while (enqueuedBuffers > 1) {
-			AudioOutBuffer* releasedBuffers;
-			u32 audoutNReleasedBuffers;
-			audoutWaitPlayFinish(&releasedBuffers, &audoutNReleasedBuffers, 100000000);
-			enqueuedBuffers -= audoutNReleasedBuffers;
-		}
-	}
-	frameLimiter = limit;
-	eglSwapInterval(s_surface, limit);
-}
-
 static bool _running(struct mGUIRunner* runner) {
 	UNUSED(runner);
 	return appletMainLoop();
 }
 
+// Called with audioMutex held, by the audio thread or by the emulation thread if there isn't one
+static void _releaseAudioBuffers(u64 timeout) {
+	AudioOutBuffer* releasedBuffers;
+	u32 audoutNReleasedBuffers = 0;
+	if (timeout) {
+		MutexUnlock(&audioMutex);
+		if (R_FAILED(audoutWaitPlayFinish(&releasedBuffers, &audoutNReleasedBuffers, timeout))) {
+			audoutNReleasedBuffers = 0;
+		}
+		MutexLock(&audioMutex);
+	} else {
+		audoutGetReleasedAudioOutBuffer(&releasedBuffers, &audoutNReleasedBuffers);
+	}
+	if (audoutNReleasedBuffers) {
+		enqueuedBuffers -= audoutNReleasedBuffers;
+		ConditionWake(&audioReleased);
+	}
+}
+
 static void _postAudioBuffer(struct mAVStream* stream, blip_t* left, blip_t* right) {
 	UNUSED(stream);
-	AudioOutBuffer* releasedBuffers;
-	u32 audoutNReleasedBuffers;
-	audoutGetReleasedAudioOutBuffer(&releasedBuffers, &audoutNReleasedBuffers);
-	enqueuedBuffers -= audoutNReleasedBuffers;
-	if (!frameLimiter && enqueuedBuffers >= N_BUFFERS) {
+	MutexLock(&audioMutex);
+	if (!audioRunning) {
+		_releaseAudioBuffers(0);
+	}
+	if (frameLimiter && enqueuedBuffers >= N_BUFFERS - 1) {
+		if (audioRunning) {
+			ConditionWaitTimed(&audioReleased, &audioMutex, 10);
+		} else {
+			_releaseAudioBuffers(10000000);
+		}
+	}
+	if (enqueuedBuffers >= N_BUFFERS) {
+		MutexUnlock(&audioMutex);
 		blip_clear(left);
 		blip_clear(right);
 		return;
 	}
-	if (enqueuedBuffers >= N_BUFFERS - 1 && R_SUCCEEDED(audoutWaitPlayFinish(&releasedBuffers, &audoutNReleasedBuffers, 10000000))) {
-		enqueuedBuffers -= audoutNReleasedBuffers;
-	}
+	MutexUnlock(&audioMutex);
 
+	// Buffers are released in the order they were appended, so the next one is always free here
 	struct GBAStereoSample* samples = audioBuffer[audioBufferActive];
-	blip_read_samples(left, &samples[0].left, SAMPLES, true);
-	blip_read_samples(right, &samples[0].right, SAMPLES, true);
-	audoutAppendAudioOutBuffer(&audoutBuffer[audioBufferActive]);
+	blip_read_samples_stereo(left, right, &samples[0].left, SAMPLES);
+
+	MutexLock(&audioMutex);
+	++enqueuedBuffers;
+	if (audioRunning) {
+		++pendingBuffers;
+		ConditionWake(&audioQueued);
+	} else {
+		audoutAppendAudioOutBuffer(&audoutBuffer[audioBufferActive]);
+	}
+	MutexUnlock(&audioMutex);
 	audioBufferActive += 1;
 	audioBufferActive %= N_BUFFERS;
-	++enqueuedBuffers;
+}
+
+// Talking to audout blocks, so it happens here instead of on the emulation thread
+static void _audioThread(void* context) {
+	UNUSED(context);
+	int appendBuffer = 0;
+	MutexLock(&audioMutex);
+	while (audioRunning) {
+		if (pendingBuffers) {
+			--pendingBuffers;
+			MutexUnlock(&audioMutex);
+			audoutAppendAudioOutBuffer(&audoutBuffer[appendBuffer]);
+			appendBuffer += 1;
+			appendBuffer %= N_BUFFERS;
+			MutexLock(&audioMutex);
+		} else if (enqueuedBuffers) {
+			_releaseAudioBuffers(10000000);
+		} else {
+			ConditionWait(&audioQueued, &audioMutex);
+		}
+	}
+	MutexUnlock(&audioMutex);
+}
+
+static void _setFrameLimiter(struct mGUIRunner* runner, bool limit) {
+	UNUSED(runner);
+	MutexLock(&audioMutex);
+	if (!frameLimiter && limit) {
+		while (enqueuedBuffers > 1) {
+			if (audioRunning) {
+				ConditionWait(&audioReleased, &audioMutex);
+			} else {
+				_releaseAudioBuffers(100000000);
+			}
+		}
+	}
+	frameLimiter = limit;
+	MutexUnlock(&audioMutex);
+	eglSwapInterval(s_surface, limit);
 }
 
 void _setRumble(struct mRumble* rumble, int enable) {
@@ -592,6 +662,10 @@ int main(int argc, char* argv[]) {
 	memset(audioBuffer, 0, sizeof(audioBuffer));
 	audioBufferActive = 0;
 	enqueuedBuffers = 0;
+	pendingBuffers = 0;
+	MutexInit(&audioMutex);
+	ConditionInit(&audioQueued);
+	ConditionInit(&audioReleased);
 	size_t i;
 	for (i = 0; i < N_BUFFERS; ++i) {
 		audoutBuffer[i].next = NULL;
@@ -716,6 +790,10 @@ int main(int argc, char* argv[]) {
 	_mapKey(&runner.params.keyMap, AUTO_INPUT, KEY_DRIGHT, GUI_INPUT_RIGHT);
 
 	audoutStartAudioOut();
+	audioRunning = true;
+	if (R_FAILED(threadCreate(&audioThread, _audioThread, NULL, 0x4000, 0x2B, 2)) || R_FAILED(threadStart(&audioThread))) {
+		audioRunning = false;
+	}
 
 	if (argc > 1) {
 		size_t i;
@@ -729,6 +807,15 @@ int main(int argc, char* argv[]) {
 
 	mGUIDeinit(&runner);
 
+	MutexLock(&audioMutex);
+	bool audioStarted = audioRunning;
+	audioRunning = false;
+	ConditionWake(&audioQueued);
+	MutexUnlock(&audioMutex);
+	if (audioStarted) {
+		threadWaitForExit(&audioThread);
+		threadClose(&audioThread);
+	}
 	audoutStopAudioOut();
 	GUIFontDestroy(font);
 
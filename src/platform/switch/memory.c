@@ -13,3 +13,11 @@ void mappedMemoryFree(void* memory, size_t size) {
 	UNUSED(size);
 	free(memory);
 }
+
+void* hugeMemoryMap(size_t size) {
+	return anonymousMemoryMap(size);
+}
+
+void hugeMemoryFree(void* memory, size_t size) {
+	mappedMemoryFree(memory, size);
+}
@@ -0,0 +1,702 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba/feature/commandline.h>
+
+#include <mgba-util/configuration.h>
+#include <mgba-util/png-io.h>
+#include <mgba-util/string.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
+#include <mgba-util/vfs.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <sys/time.h>
+
+#define CINEMA_OPTIONS "F:J:P:RT:U"
+#define CINEMA_USAGE \
+	"\nCinema options:\n" \
+	"  -F PREFIX        Only run tests whose name starts with PREFIX\n" \
+	"  -J THREADS       Run tests on THREADS worker threads [default: 4]\n" \
+	"  -P FILE          Read performance baselines from FILE [default: BASE/perf-baseline.ini]\n" \
+	"  -T PERCENT       Flag tests more than PERCENT slower than their baseline [default: 20]\n" \
+	"  -U               Store this run's times as the new performance baselines\n" \
+	"                   Times are wall clock, so update them from a quiet run with -J 1\n" \
+	"  -R               Overwrite the baseline frames of every test that runs\n" \
+	"\nBASE is the cinema directory to run [default: cinema]"
+
+#define CINEMA_BASELINE "baseline_%04u.png"
+#define CINEMA_MANIFEST "manifest.yml"
+#define CINEMA_PERF_SECTION "perf"
+#define CINEMA_MAX_CONFIG 16
+// Large enough for Super Game Boy borders
+#define CINEMA_MAX_WIDTH 256
+#define CINEMA_MAX_HEIGHT 224
+// Tests without a frame limit run until the movie stops advancing the frame counter
+#define CINEMA_MAX_FRAMES 3600
+// Shorter tests are too noisy to meaningfully flag as slower
+#define CINEMA_PERF_MIN_USEC 10000
+
+struct CinemaOpts {
+	char* filter;
+	char* perfBaseline;
+	unsigned threads;
+	unsigned threshold;
+	bool rebaseline;
+	bool updatePerf;
+};
+
+struct CinemaConfigItem {
+	char key[64];
+	char value[64];
+};
+
+struct CinemaSettings {
+	int skip;
+	int frames;
+	bool fail;
+	size_t nConfig;
+	struct CinemaConfigItem config[CINEMA_MAX_CONFIG];
+};
+
+enum CinemaStatus {
+	CINEMA_PASS = 0,
+	CINEMA_FAIL,
+	CINEMA_XFAIL,
+	CINEMA_XPASS,
+	CINEMA_ERROR
+};
+
+struct CinemaTest {
+	char* name;
+	char* path;
+	char* rom;
+	struct CinemaSettings settings;
+	enum CinemaStatus status;
+	unsigned frames;
+	unsigned failedFrame;
+	size_t diffPixels;
+	uint64_t duration;
+};
+
+DECLARE_VECTOR(CinemaTestList, struct CinemaTest);
+DEFINE_VECTOR(CinemaTestList, struct CinemaTest);
+
+struct CinemaRun {
+	const struct CinemaOpts* opts;
+	struct CinemaTestList tests;
+	Mutex mutex;
+	size_t nextTest;
+};
+
+static const char* const _statusNames[] = {
+	[CINEMA_PASS] = "PASS",
+	[CINEMA_FAIL] = "FAIL",
+	[CINEMA_XFAIL] = "XFAIL",
+	[CINEMA_XPASS] = "XPASS",
+	[CINEMA_ERROR] = "ERROR",
+};
+
+static const char* const _testFiles[] = {
+	"test.mvl", "test.gb", "test.gba", "test.nds"
+};
+
+static bool _parseCinemaOpts(struct mSubParser* parser, int option, const char* arg);
+static bool _parseUInt(const char* arg, unsigned* out);
+static void _loadManifest(const char* path, struct CinemaSettings* settings);
+static bool _gatherTests(struct CinemaRun* run, const char* path, const char* name, const struct CinemaSettings* parent);
+static void _runTests(struct CinemaRun* run);
+static void _runTest(const struct CinemaOpts* opts, struct CinemaTest* test);
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _cinemaWorker(void* context);
+#endif
+static bool _isRegression(const struct CinemaOpts* opts, const struct CinemaTest* test, uint64_t baseline);
+static int _compareTests(const void* a, const void* b);
+static void _log(struct mLogger*, int, enum mLogLevel, const char*, va_list);
+static uint64_t _now(void);
+
+int main(int argc, char** argv) {
+	int didFail = 0;
+
+	struct mLogger logger = { .log = _log };
+	mLogSetDefaultLogger(&logger);
+
+	struct CinemaOpts cinemaOpts = {
+		.threads = 4,
+		.threshold = 20
+	};
+	struct mSubParser subparser = {
+		.usage = CINEMA_USAGE,
+		.parse = _parseCinemaOpts,
+		.extraOptions = CINEMA_OPTIONS,
+		.opts = &cinemaOpts
+	};
+
+	struct mArguments args = {};
+	bool parsed = parseArguments(&args, argc, argv, &subparser);
+	if (!parsed || args.showHelp) {
+		usage(argv[0], CINEMA_USAGE);
+		didFail = !parsed;
+		goto cleanup;
+	}
+
+	if (args.showVersion) {
+		version(argv[0]);
+		goto cleanup;
+	}
+
+	const char* base = args.fname ? args.fname : "cinema";
+	char perfPath[PATH_MAX];
+	if (cinemaOpts.perfBaseline) {
+		snprintf(perfPath, sizeof(perfPath), "%s", cinemaOpts.perfBaseline);
+	} else {
+		snprintf(perfPath, sizeof(perfPath), "%s" PATH_SEP "perf-baseline.ini", base);
+	}
+
+	struct CinemaRun run = {
+		.opts = &cinemaOpts
+	};
+	CinemaTestListInit(&run.tests, 0);
+	struct CinemaSettings settings = {
+		.frames = -1
+	};
+	if (!_gatherTests(&run, base, NULL, &settings)) {
+		fprintf(stderr, "Could not open cinema directory %s\n", base);
+		didFail = 1;
+		CinemaTestListDeinit(&run.tests);
+		goto cleanup;
+	}
+	qsort(CinemaTestListGetPointer(&run.tests, 0), CinemaTestListSize(&run.tests), sizeof(struct CinemaTest), _compareTests);
+
+	MutexInit(&run.mutex);
+#ifndef DISABLE_THREADING
+	unsigned nThreads = cinemaOpts.threads;
+	if (nThreads > CinemaTestListSize(&run.tests)) {
+		nThreads = CinemaTestListSize(&run.tests);
+	}
+	if (nThreads > 1) {
+		Thread* threads = calloc(nThreads, sizeof(*threads));
+		unsigned i;
+		for (i = 0; i < nThreads; ++i) {
+			ThreadCreate(&threads[i], _cinemaWorker, &run);
+		}
+		for (i = 0; i < nThreads; ++i) {
+			ThreadJoin(threads[i]);
+		}
+		free(threads);
+	} else
+#endif
+	{
+		_runTests(&run);
+	}
+	MutexDeinit(&run.mutex);
+
+	struct Configuration perf;
+	ConfigurationInit(&perf);
+	ConfigurationRead(&perf, perfPath);
+
+	size_t counts[CINEMA_ERROR + 1] = { 0 };
+	size_t regressions = 0;
+	size_t i;
+	for (i = 0; i < CinemaTestListSize(&run.tests); ++i) {
+		struct CinemaTest* test = CinemaTestListGetPointer(&run.tests, i);
+		++counts[test->status];
+		printf("%-5s %s", _statusNames[test->status], test->name);
+		if (test->status == CINEMA_ERROR) {
+			puts(" (could not load test)");
+			continue;
+		}
+		printf(" %.3f ms", test->duration / 1000.);
+
+		const char* value = ConfigurationGetValue(&perf, CINEMA_PERF_SECTION, test->name);
+		uint64_t baseline = value ? strtoull(value, NULL, 10) : 0;
+		if (baseline) {
+			printf(" (baseline %.3f ms, %+.1f%%)", baseline / 1000., (test->duration * 100. / baseline) - 100.);
+			if (_isRegression(&cinemaOpts, test, baseline)) {
+				printf(" SLOW");
+				++regressions;
+			}
+		}
+		if (test->diffPixels) {
+			printf(" frame %u: %" PRIz "u pixels differ", test->failedFrame, test->diffPixels);
+		}
+		putchar('\n');
+
+		if (cinemaOpts.updatePerf) {
+			char duration[32];
+			snprintf(duration, sizeof(duration), "%" PRIu64, test->duration);
+			ConfigurationSetValue(&perf, CINEMA_PERF_SECTION, test->name, duration);
+		}
+	}
+	printf("\n%" PRIz "u passed, %" PRIz "u failed, %" PRIz "u expected failures, %" PRIz "u unexpected passes, %" PRIz "u errors, "
+	       "%" PRIz "u more than %u%% slower than baseline\n",
+	       counts[CINEMA_PASS], counts[CINEMA_FAIL], counts[CINEMA_XFAIL], counts[CINEMA_XPASS], counts[CINEMA_ERROR],
+	       regressions, cinemaOpts.threshold);
+	if (counts[CINEMA_FAIL] || counts[CINEMA_ERROR] || regressions) {
+		didFail = 1;
+	}
+
+	if (cinemaOpts.updatePerf && !ConfigurationWrite(&perf, perfPath)) {
+		fprintf(stderr, "Could not write performance baselines to %s\n", perfPath);
+		didFail = 1;
+	}
+	ConfigurationDeinit(&perf);
+
+	for (i = 0; i < CinemaTestListSize(&run.tests); ++i) {
+		struct CinemaTest* test = CinemaTestListGetPointer(&run.tests, i);
+		free(test->name);
+		free(test->path);
+		free(test->rom);
+	}
+	CinemaTestListDeinit(&run.tests);
+
+	cleanup:
+	free(cinemaOpts.filter);
+	free(cinemaOpts.perfBaseline);
+	freeArguments(&args);
+
+	return didFail;
+}
+
+static bool _parseUInt(const char* arg, unsigned* out) {
+	char* end;
+	errno = 0;
+	unsigned long value = strtoul(arg, &end, 10);
+	if (errno || *end || end == arg) {
+		return false;
+	}
+	*out = value;
+	return true;
+}
+
+static bool _parseCinemaOpts(struct mSubParser* parser, int option, const char* arg) {
+	struct CinemaOpts* opts = parser->opts;
+	switch (option) {
+	case 'F':
+		free(opts->filter);
+		opts->filter = strdup(arg);
+		return true;
+	case 'J':
+		return _parseUInt(arg, &opts->threads) && opts->threads;
+	case 'P':
+		free(opts->perfBaseline);
+		opts->perfBaseline = strdup(arg);
+		return true;
+	case 'R':
+		opts->rebaseline = true;
+		return true;
+	case 'T':
+		return _parseUInt(arg, &opts->threshold);
+	case 'U':
+		opts->updatePerf = true;
+		return true;
+	default:
+		return false;
+	}
+}
+
+static char* _trim(char* string) {
+	while (*string == ' ' || *string == '\t') {
+		++string;
+	}
+	size_t length = strlen(string);
+	while (length && strchr(" \t\r\n", string[length - 1])) {
+		--length;
+	}
+	string[length] = '\0';
+	if (length >= 2 && (string[0] == '"' || string[0] == '\'') && string[length - 1] == string[0]) {
+		string[length - 1] = '\0';
+		++string;
+	}
+	return string;
+}
+
+static void _setConfig(struct CinemaSettings* settings, const char* key, const char* value) {
+	// YAML booleans become the 0/1 the config loader expects
+	if (strcasecmp(value, "true") == 0 || strcasecmp(value, "yes") == 0) {
+		value = "1";
+	} else if (strcasecmp(value, "false") == 0 || strcasecmp(value, "no") == 0) {
+		value = "0";
+	}
+	size_t i;
+	for (i = 0; i < settings->nConfig; ++i) {
+		if (strcmp(settings->config[i].key, key) == 0) {
+			break;
+		}
+	}
+	if (i == CINEMA_MAX_CONFIG) {
+		return;
+	}
+	if (i == settings->nConfig) {
+		++settings->nConfig;
+	}
+	struct CinemaConfigItem* item = &settings->config[i];
+	strncpy(item->key, key, sizeof(item->key) - 1);
+	item->key[sizeof(item->key) - 1] = '\0';
+	strncpy(item->value, value, sizeof(item->value) - 1);
+	item->value[sizeof(item->value) - 1] = '\0';
+}
+
+static void _parseInlineConfig(struct CinemaSettings* settings, char* map) {
+	char* end = strchr(map, '}');
+	if (end) {
+		*end = '\0';
+	}
+	char* next = map + 1;
+	while (next && *next) {
+		char* entry = next;
+		next = strchr(entry, ',');
+		if (next) {
+			*next = '\0';
+			++next;
+		}
+		char* colon = strchr(entry, ':');
+		if (!colon) {
+			continue;
+		}
+		*colon = '\0';
+		_setConfig(settings, _trim(entry), _trim(&colon[1]));
+	}
+}
+
+// Manifests only use a flat subset of YAML: scalar keys, plus a config map that's either
+// indented below its key or written inline as { key: value, ... }
+static void _loadManifest(const char* path, struct CinemaSettings* settings) {
+	struct VFile* vf = VFileOpen(path, O_RDONLY);
+	if (!vf) {
+		return;
+	}
+	char line[256];
+	bool inConfig = false;
+	while (vf->readline(vf, line, sizeof(line)) > 0) {
+		char* comment = strchr(line, '#');
+		if (comment) {
+			*comment = '\0';
+		}
+		bool indented = line[0] == ' ' || line[0] == '\t';
+		char* key = _trim(line);
+		char* colon = strchr(key, ':');
+		if (!*key || !colon) {
+			continue;
+		}
+		*colon = '\0';
+		char* value = _trim(&colon[1]);
+		key = _trim(key);
+		if (indented) {
+			if (inConfig) {
+				_setConfig(settings, key, value);
+			}
+			continue;
+		}
+		inConfig = false;
+		if (strcmp(key, "config") == 0) {
+			if (value[0] == '{') {
+				_parseInlineConfig(settings, value);
+			} else {
+				inConfig = true;
+			}
+		} else if (strcmp(key, "skip") == 0) {
+			settings->skip = strtol(value, NULL, 10);
+		} else if (strcmp(key, "frames") == 0) {
+			settings->frames = strtol(value, NULL, 10);
+		} else if (strcmp(key, "fail") == 0) {
+			// A string here is the reason the test is expected to fail
+			settings->fail = strcasecmp(value, "false") != 0 && strcasecmp(value, "no") != 0 && strcmp(value, "0") != 0;
+		}
+	}
+	vf->close(vf);
+}
+
+static bool _gatherTests(struct CinemaRun* run, const char* path, const char* name, const struct CinemaSettings* parent) {
+	struct VDir* dir = VDirOpen(path);
+	if (!dir) {
+		return false;
+	}
+
+	// Settings are inherited from every manifest on the way down to a test
+	struct CinemaSettings settings = *parent;
+	char subpath[PATH_MAX];
+	snprintf(subpath, sizeof(subpath), "%s" PATH_SEP CINEMA_MANIFEST, path);
+	_loadManifest(subpath, &settings);
+
+	const char* filter = run->opts->filter;
+	struct VDirEntry* entry;
+	while ((entry = dir->listNext(dir))) {
+		const char* entryName = entry->name(entry);
+		if (entryName[0] == '.') {
+			continue;
+		}
+		snprintf(subpath, sizeof(subpath), "%s" PATH_SEP "%s", path, entryName);
+		if (entry->type(entry) == VFS_DIRECTORY) {
+			char subname[PATH_MAX];
+			if (name) {
+				snprintf(subname, sizeof(subname), "%s.%s", name, entryName);
+			} else {
+				snprintf(subname, sizeof(subname), "%s", entryName);
+			}
+			_gatherTests(run, subpath, subname, &settings);
+			continue;
+		}
+		if (!name) {
+			continue;
+		}
+		size_t i;
+		for (i = 0; i < sizeof(_testFiles) / sizeof(*_testFiles); ++i) {
+			if (strcmp(entryName, _testFiles[i]) == 0) {
+				break;
+			}
+		}
+		if (i == sizeof(_testFiles) / sizeof(*_testFiles)) {
+			continue;
+		}
+		if (filter && strncmp(name, filter, strlen(filter)) != 0) {
+			continue;
+		}
+		struct CinemaTest* test = CinemaTestListAppend(&run->tests);
+		memset(test, 0, sizeof(*test));
+		test->name = strdup(name);
+		test->path = strdup(path);
+		test->rom = strdup(subpath);
+		test->settings = settings;
+	}
+	dir->close(dir);
+	return true;
+}
+
+static bool _takeTest(struct CinemaRun* run, struct CinemaTest** test) {
+	MutexLock(&run->mutex);
+	bool available = run->nextTest < CinemaTestListSize(&run->tests);
+	if (available) {
+		*test = CinemaTestListGetPointer(&run->tests, run->nextTest);
+		++run->nextTest;
+	}
+	MutexUnlock(&run->mutex);
+	return available;
+}
+
+static void _runTests(struct CinemaRun* run) {
+	struct CinemaTest* test;
+	while (_takeTest(run, &test)) {
+		_runTest(run->opts, test);
+	}
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _cinemaWorker(void* context) {
+	ThreadSetName("Cinema Worker");
+	_runTests(context);
+	return 0;
+}
+#endif
+
+// Older baselines were saved at the size of the whole video buffer rather than the frame that was
+// drawn into it, so only the region both images cover is loaded, and width and height are clamped to it
+static bool _loadBaseline(const char* path, color_t* pixels, unsigned* width, unsigned* height, bool* found) {
+	struct VFile* vf = VFileOpen(path, O_RDONLY);
+	*found = !!vf;
+	if (!vf) {
+		return false;
+	}
+	png_structp png = PNGReadOpen(vf, 0);
+	png_infop info = png_create_info_struct(png);
+	png_infop end = png_create_info_struct(png);
+	bool success = PNGReadHeader(png, info);
+	if (success && !setjmp(png_jmpbuf(png))) {
+		// PNGReadPixels expects 8-bit RGB, but some baselines are saved as grayscale
+		int colorType = png_get_color_type(png, info);
+		if (colorType == PNG_COLOR_TYPE_PALETTE) {
+			png_set_palette_to_rgb(png);
+		} else if (!(colorType & PNG_COLOR_MASK_COLOR)) {
+			png_set_expand_gray_1_2_4_to_8(png);
+			png_set_gray_to_rgb(png);
+		}
+		if (colorType & PNG_COLOR_MASK_ALPHA) {
+			png_set_strip_alpha(png);
+		}
+		png_set_strip_16(png);
+		png_read_update_info(png, info);
+	} else {
+		success = false;
+	}
+	if (success) {
+		if (png_get_image_width(png, info) < *width) {
+			*width = png_get_image_width(png, info);
+		}
+		if (png_get_image_height(png, info) < *height) {
+			*height = png_get_image_height(png, info);
+		}
+		success = PNGReadPixels(png, info, pixels, *width, *height, CINEMA_MAX_WIDTH);
+	}
+	PNGReadClose(png, info, end);
+	vf->close(vf);
+	return success;
+}
+
+static bool _saveBaseline(const char* path, const color_t* pixels, unsigned width, unsigned height, unsigned stride) {
+	struct VFile* vf = VFileOpen(path, O_CREAT | O_TRUNC | O_WRONLY);
+	if (!vf) {
+		return false;
+	}
+	png_structp png = PNGWriteOpen(vf);
+	png_infop info = PNGWriteHeader(png, width, height);
+	bool success = PNGWritePixels(png, width, height, stride, pixels);
+	PNGWriteClose(png, info);
+	vf->close(vf);
+	return success;
+}
+
+static size_t _diffPixels(const color_t* frame, const color_t* baseline, unsigned width, unsigned height) {
+	// Only compare color, since the unused channel isn't necessarily the same
+#ifdef COLOR_5_6_5
+	const color_t mask = 0xFFFF;
+#elif defined(COLOR_16_BIT)
+	const color_t mask = 0x7FFF;
+#elif __BIG_ENDIAN__
+	const color_t mask = 0xFFFFFF00;
+#else
+	const color_t mask = 0x00FFFFFF;
+#endif
+	size_t diff = 0;
+	unsigned x, y;
+	for (y = 0; y < height; ++y) {
+		for (x = 0; x < width; ++x) {
+			size_t offset = y * CINEMA_MAX_WIDTH + x;
+			if ((frame[offset] ^ baseline[offset]) & mask) {
+				++diff;
+			}
+		}
+	}
+	return diff;
+}
+
+static void _runTest(const struct CinemaOpts* opts, struct CinemaTest* test) {
+	const struct CinemaSettings* settings = &test->settings;
+	test->status = CINEMA_ERROR;
+	struct mCore* core = mCoreFind(test->rom);
+	if (!core) {
+		return;
+	}
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	size_t i;
+	for (i = 0; i < settings->nConfig; ++i) {
+		mCoreConfigSetDefaultValue(&core->config, settings->config[i].key, settings->config[i].value);
+	}
+	if (!mCoreLoadFile(core, test->rom)) {
+		mCoreConfigDeinit(&core->config);
+		core->deinit(core);
+		return;
+	}
+	// Like the Python runner, only apply config if the test has any. Video log cores don't survive
+	// being reset twice, but they never have config.
+	if (settings->nConfig) {
+		mCoreLoadConfig(core);
+		core->reset(core);
+	}
+
+	color_t* frame = calloc(CINEMA_MAX_WIDTH * CINEMA_MAX_HEIGHT, BYTES_PER_PIXEL);
+	color_t* baseline = malloc(CINEMA_MAX_WIDTH * CINEMA_MAX_HEIGHT * BYTES_PER_PIXEL);
+	core->setVideoBuffer(core, frame, CINEMA_MAX_WIDTH);
+	core->reset(core);
+	unsigned width, height;
+	core->desiredVideoDimensions(core, &width, &height);
+	if (width > CINEMA_MAX_WIDTH) {
+		width = CINEMA_MAX_WIDTH;
+	}
+	if (height > CINEMA_MAX_HEIGHT) {
+		height = CINEMA_MAX_HEIGHT;
+	}
+	test->status = CINEMA_PASS;
+
+	// This mirrors the frame stepping of the Python cinema tracer so both runners agree on baselines
+	uint64_t start = _now();
+	int32_t frameCounter = core->frameCounter(core);
+	int skip = settings->skip + 1;
+	while (skip > 0) {
+		frameCounter = core->frameCounter(core);
+		core->runFrame(core);
+		--skip;
+	}
+	test->duration = _now() - start;
+
+	int limit = settings->frames;
+	unsigned index;
+	for (index = 0; frameCounter <= core->frameCounter(core) && limit != 0 && index < CINEMA_MAX_FRAMES; ++index) {
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s" PATH_SEP CINEMA_BASELINE, test->path, index);
+		if (opts->rebaseline) {
+			if (!_saveBaseline(path, frame, width, height, CINEMA_MAX_WIDTH)) {
+				test->status = CINEMA_ERROR;
+				break;
+			}
+		} else if (!test->diffPixels) {
+			bool found;
+			unsigned baselineWidth = width;
+			unsigned baselineHeight = height;
+			size_t diff = width * height;
+			if (_loadBaseline(path, baseline, &baselineWidth, &baselineHeight, &found)) {
+				diff = _diffPixels(frame, baseline, baselineWidth, baselineHeight);
+			} else if (!found) {
+				diff = 0;
+			}
+			if (diff) {
+				test->diffPixels = diff;
+				test->failedFrame = index;
+			}
+		}
+
+		start = _now();
+		frameCounter = core->frameCounter(core);
+		core->runFrame(core);
+		test->duration += _now() - start;
+		if (limit > 0) {
+			--limit;
+		}
+	}
+	test->frames = index;
+
+	if (test->status == CINEMA_PASS) {
+		if (settings->fail) {
+			test->status = test->diffPixels ? CINEMA_XFAIL : CINEMA_XPASS;
+		} else if (test->diffPixels) {
+			test->status = CINEMA_FAIL;
+		}
+	}
+
+	free(baseline);
+	free(frame);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+static bool _isRegression(const struct CinemaOpts* opts, const struct CinemaTest* test, uint64_t baseline) {
+	if (baseline < CINEMA_PERF_MIN_USEC) {
+		return false;
+	}
+	return test->duration * 100 > baseline * (100 + opts->threshold);
+}
+
+static int _compareTests(const void* a, const void* b) {
+	const struct CinemaTest* testA = a;
+	const struct CinemaTest* testB = b;
+	return strcmp(testA->name, testB->name);
+}
+
+static uint64_t _now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return 1000000LL * tv.tv_sec + tv.tv_usec;
+}
+
+static void _log(struct mLogger* log, int category, enum mLogLevel level, const char* format, va_list args) {
+	UNUSED(log);
+	UNUSED(category);
+	UNUSED(level);
+	UNUSED(format);
+	UNUSED(args);
+}
@@ -20,27 +20,54 @@
 #include <errno.h>
 #include <signal.h>
 
-#define FUZZ_OPTIONS "F:NO:S:V:"
+#define FUZZ_OPTIONS "F:K:NO:S:V:"
 #define FUZZ_USAGE \
 	"\nAdditional options:\n" \
 	"  -F FRAMES        Run for the specified number of FRAMES before exiting\n" \
+	"  -K FILE          Fuzz the key input sequence in FILE instead of the ROM\n" \
+	"                   Each frame reads its keys from two little-endian bytes\n" \
 	"  -N               Disable video rendering entirely\n" \
 	"  -O OFFSET        Offset to apply savestate overlay\n" \
 	"  -V FILE          Overlay a second savestate over the loaded savestate\n" \
 
+// How many inputs an AFL persistent loop runs before the process is restarted
+#define FUZZ_PERSISTENT_ITERATIONS 1000
+// Upper bound on frames per input, since libFuzzer has no -F
+#define FUZZ_MAX_FRAMES 3600
+
 struct FuzzOpts {
 	bool noVideo;
 	int frames;
 	size_t overlayOffset;
 	char* ssOverlay;
+	char* inputs;
 };
 
+// Everything kept alive between inputs in persistent mode
+struct FuzzContext {
+	struct mCore* core;
+	void* outputBuffer;
+	int frames;
+	// Snapshot taken once the game is loaded, restored before every key input sequence
+	void* baseline;
+	void* baselineSavedata;
+	size_t baselineSavedataSize;
+};
+
+static bool _fuzzInitCore(struct FuzzContext* context, struct mCore* core, bool noVideo);
+static void _fuzzDeinitCore(struct FuzzContext* context);
+static bool _fuzzTakeBaseline(struct FuzzContext* context);
+static void _fuzzRunInputs(struct FuzzContext* context, const uint8_t* data, size_t size);
 static void _fuzzRunloop(struct mCore* core, int frames);
-static void _fuzzShutdown(int signal);
-static bool _parseFuzzOpts(struct mSubParser* parser, int option, const char* arg);
 
 static bool _dispatchExiting = false;
 
+#ifndef USE_LIBFUZZER
+static void _fuzzShutdown(int signal);
+static bool _parseFuzzOpts(struct mSubParser* parser, int option, const char* arg);
+static bool _fuzzLoadGame(struct FuzzContext* context, const struct mArguments* args, const struct FuzzOpts* fuzzOpts);
+static bool _fuzzRunInputFile(struct FuzzContext* context, const char* path);
+
 int main(int argc, char** argv) {
 	signal(SIGINT, _fuzzShutdown);
 
@@ -65,63 +92,81 @@ int main(int argc, char** argv) {
 		version(argv[0]);
 		return 0;
 	}
-	struct mCore* core = mCoreFind(args.fname);
-	if (!core) {
+	struct FuzzContext context = {
+		.frames = fuzzOpts.frames
+	};
+	if (!_fuzzInitCore(&context, mCoreFind(args.fname), fuzzOpts.noVideo)) {
 		return 1;
 	}
-	core->init(core);
-	mCoreInitConfig(core, "fuzz");
-	applyArguments(&args, NULL, &core->config);
-
-	mCoreConfigSetDefaultValue(&core->config, "idleOptimization", "remove");
-
-	void* outputBuffer;
-	outputBuffer = 0;
-
-	if (!fuzzOpts.noVideo) {
-		outputBuffer = malloc(256 * 256 * 4);
-		core->setVideoBuffer(core, outputBuffer, 256);
-	}
+	applyArguments(&args, NULL, &context.core->config);
 
-#ifdef M_CORE_GBA
-	if (core->platform(core) == PLATFORM_GBA) {
-		((struct GBA*) core->board)->hardCrash = false;
+	bool cleanExit = true;
+	if (fuzzOpts.inputs) {
+		// The ROM stays the same for every input, so load it before AFL forks
+		if (!_fuzzLoadGame(&context, &args, &fuzzOpts) || !_fuzzTakeBaseline(&context)) {
+			cleanExit = false;
+			goto loadError;
+		}
 	}
-#endif
 
 #ifdef __AFL_HAVE_MANUAL_CONTROL
 	__AFL_INIT();
 #endif
 
-	bool cleanExit = true;
-	if (!mCoreLoadFile(core, args.fname)) {
-		cleanExit = false;
-		goto loadError;
+	// Outside of AFL persistent mode this runs exactly once
+#ifdef __AFL_LOOP
+	while (__AFL_LOOP(FUZZ_PERSISTENT_ITERATIONS) && !_dispatchExiting)
+#endif
+	{
+		if (fuzzOpts.inputs) {
+			cleanExit = _fuzzRunInputFile(&context, fuzzOpts.inputs);
+		} else {
+			cleanExit = _fuzzLoadGame(&context, &args, &fuzzOpts);
+			if (cleanExit) {
+				_fuzzRunloop(context.core, context.frames);
+			}
+		}
+	}
+
+	context.core->unloadROM(context.core);
+
+loadError:
+	freeArguments(&args);
+	free(fuzzOpts.ssOverlay);
+	free(fuzzOpts.inputs);
+	_fuzzDeinitCore(&context);
+
+	return !cleanExit;
+}
+
+static bool _fuzzLoadGame(struct FuzzContext* context, const struct mArguments* args, const struct FuzzOpts* fuzzOpts) {
+	struct mCore* core = context->core;
+	if (!mCoreLoadFile(core, args->fname)) {
+		return false;
 	}
-	if (args.patch) {
-		core->loadPatch(core, VFileOpen(args.patch, O_RDONLY));
+	if (args->patch) {
+		core->loadPatch(core, VFileOpen(args->patch, O_RDONLY));
 	}
 
 	struct VFile* savestate = 0;
 	struct VFile* savestateOverlay = 0;
 	size_t overlayOffset;
 
-	if (args.savestate) {
-		savestate = VFileOpen(args.savestate, O_RDONLY);
+	if (args->savestate) {
+		savestate = VFileOpen(args->savestate, O_RDONLY);
 	}
-	if (fuzzOpts.ssOverlay) {
-		overlayOffset = fuzzOpts.overlayOffset;
+	if (fuzzOpts->ssOverlay) {
+		overlayOffset = fuzzOpts->overlayOffset;
 		if (overlayOffset < core->stateSize(core)) {
-			savestateOverlay = VFileOpen(fuzzOpts.ssOverlay, O_RDONLY);
+			savestateOverlay = VFileOpen(fuzzOpts->ssOverlay, O_RDONLY);
 		}
-		free(fuzzOpts.ssOverlay);
 	}
 
 	core->reset(core);
 
 	struct mCheatDevice* device;
-	if (args.cheatsFile && (device = core->cheatDevice(core))) {
-		struct VFile* vf = VFileOpen(args.cheatsFile, O_RDONLY);
+	if (args->cheatsFile && (device = core->cheatDevice(core))) {
+		struct VFile* vf = VFileOpen(args->cheatsFile, O_RDONLY);
 		if (vf) {
 			mCheatDeviceClear(device);
 			mCheatParseFile(device, vf);
@@ -139,36 +184,173 @@ int main(int argc, char** argv) {
 			savestateOverlay->read(savestateOverlay, state + overlayOffset, size - overlayOffset);
 			core->loadState(core, state);
 			free(state);
-			savestateOverlay->close(savestateOverlay);
-			savestateOverlay = 0;
 		}
 		savestate->close(savestate);
-		savestate = 0;
 	}
+	if (savestateOverlay) {
+		savestateOverlay->close(savestateOverlay);
+	}
+	return true;
+}
 
-	blip_set_rates(core->getAudioChannel(core, 0), GBA_ARM7TDMI_FREQUENCY, 0x8000);
-	blip_set_rates(core->getAudioChannel(core, 1), GBA_ARM7TDMI_FREQUENCY, 0x8000);
-
-	_fuzzRunloop(core, fuzzOpts.frames);
+static bool _fuzzRunInputFile(struct FuzzContext* context, const char* path) {
+	struct VFile* vf = VFileOpen(path, O_RDONLY);
+	if (!vf) {
+		return false;
+	}
+	ssize_t size = vf->size(vf);
+	uint8_t* data = NULL;
+	if (size > 0) {
+		data = malloc(size);
+		size = vf->read(vf, data, size);
+	}
+	vf->close(vf);
+	if (size >= 0) {
+		_fuzzRunInputs(context, data, size);
+	}
+	free(data);
+	return size >= 0;
+}
+#else
+static struct FuzzContext _context;
 
-	core->unloadROM(core);
+// libFuzzer reserves the command line for itself, so the harness is configured from the environment:
+// MGBA_FUZZ_ROM switches from fuzzing ROMs to fuzzing key inputs for that ROM, optionally starting from
+// the savestate in MGBA_FUZZ_SAVESTATE, and MGBA_FUZZ_FRAMES bounds how long each input runs.
+int LLVMFuzzerInitialize(int* argc, char*** argv) {
+	UNUSED(argc);
+	UNUSED(argv);
+	const char* frames = getenv("MGBA_FUZZ_FRAMES");
+	_context.frames = frames ? strtol(frames, NULL, 10) : 0;
+	if (_context.frames <= 0 || _context.frames > FUZZ_MAX_FRAMES) {
+		_context.frames = FUZZ_MAX_FRAMES;
+	}
 
+	const char* rom = getenv("MGBA_FUZZ_ROM");
+	if (!rom) {
+		return 0;
+	}
+	if (!_fuzzInitCore(&_context, mCoreFind(rom), false) || !mCoreLoadFile(_context.core, rom)) {
+		abort();
+	}
+	_context.core->reset(_context.core);
+	const char* savestate = getenv("MGBA_FUZZ_SAVESTATE");
 	if (savestate) {
-		savestate->close(savestate);
+		struct VFile* vf = VFileOpen(savestate, O_RDONLY);
+		if (!vf || !mCoreLoadStateNamed(_context.core, vf, 0)) {
+			abort();
+		}
+		vf->close(vf);
 	}
-	if (savestateOverlay) {
-		savestateOverlay->close(savestateOverlay);
+	if (!_fuzzTakeBaseline(&_context)) {
+		abort();
 	}
+	return 0;
+}
 
-loadError:
-	freeArguments(&args);
-	if (outputBuffer) {
-		free(outputBuffer);
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	if (_context.baseline) {
+		_fuzzRunInputs(&_context, data, size);
+		return 0;
+	}
+
+	struct VFile* vf = VFileMemChunk(data, size);
+	enum mPlatform platform = mCoreIsCompatible(vf);
+	if (platform == PLATFORM_NONE) {
+		vf->close(vf);
+		return 0;
+	}
+	// Cores are kept between inputs unless the next ROM is for a different platform
+	if (_context.core && _context.core->platform(_context.core) != platform) {
+		_fuzzDeinitCore(&_context);
+	}
+	if (!_context.core && !_fuzzInitCore(&_context, mCoreFindVF(vf), false)) {
+		vf->close(vf);
+		return 0;
+	}
+	if (!_context.core->loadROM(_context.core, vf)) {
+		vf->close(vf);
+		return 0;
+	}
+	_context.core->reset(_context.core);
+	_fuzzRunloop(_context.core, _context.frames);
+	_context.core->unloadROM(_context.core);
+	return 0;
+}
+#endif
+
+static bool _fuzzInitCore(struct FuzzContext* context, struct mCore* core, bool noVideo) {
+	if (!core) {
+		return false;
+	}
+	core->init(core);
+	mCoreInitConfig(core, "fuzz");
+
+	mCoreConfigSetDefaultValue(&core->config, "idleOptimization", "remove");
+
+	if (!noVideo) {
+		context->outputBuffer = malloc(256 * 256 * 4);
+		core->setVideoBuffer(core, context->outputBuffer, 256);
 	}
+
+#ifdef M_CORE_GBA
+	if (core->platform(core) == PLATFORM_GBA) {
+		((struct GBA*) core->board)->hardCrash = false;
+	}
+#endif
+
+	blip_set_rates(core->getAudioChannel(core, 0), GBA_ARM7TDMI_FREQUENCY, 0x8000);
+	blip_set_rates(core->getAudioChannel(core, 1), GBA_ARM7TDMI_FREQUENCY, 0x8000);
+
+	context->core = core;
+	return true;
+}
+
+static void _fuzzDeinitCore(struct FuzzContext* context) {
+	struct mCore* core = context->core;
+	if (!core) {
+		return;
+	}
+	free(context->outputBuffer);
+	free(context->baseline);
+	free(context->baselineSavedata);
 	mCoreConfigDeinit(&core->config);
 	core->deinit(core);
+	context->core = NULL;
+	context->outputBuffer = NULL;
+	context->baseline = NULL;
+	context->baselineSavedata = NULL;
+}
 
-	return !cleanExit;
+static bool _fuzzTakeBaseline(struct FuzzContext* context) {
+	struct mCore* core = context->core;
+	context->baseline = malloc(core->stateSize(core));
+	if (!core->saveState(core, context->baseline)) {
+		return false;
+	}
+	// Savedata isn't part of a savestate, so without this one input's saves would leak into the next
+	context->baselineSavedataSize = core->savedataClone(core, &context->baselineSavedata);
+	return true;
+}
+
+static void _fuzzRunInputs(struct FuzzContext* context, const uint8_t* data, size_t size) {
+	struct mCore* core = context->core;
+	core->loadState(core, context->baseline);
+	if (context->baselineSavedataSize) {
+		core->savedataRestore(core, context->baselineSavedata, context->baselineSavedataSize, false);
+	}
+	size_t frames = size / 2;
+	if (context->frames > 0 && frames > (size_t) context->frames) {
+		frames = context->frames;
+	}
+	size_t i;
+	for (i = 0; i < frames && !_dispatchExiting; ++i) {
+		core->setKeys(core, data[i * 2] | (data[i * 2 + 1] << 8));
+		core->runFrame(core);
+		blip_clear(core->getAudioChannel(core, 0));
+		blip_clear(core->getAudioChannel(core, 1));
+	}
+	core->setKeys(core, 0);
 }
 
 static void _fuzzRunloop(struct mCore* core, int frames) {
@@ -180,6 +362,7 @@ static void _fuzzRunloop(struct mCore* core, int frames) {
 	} while (frames > 0 && !_dispatchExiting);
 }
 
+#ifndef USE_LIBFUZZER
 static void _fuzzShutdown(int signal) {
 	UNUSED(signal);
 	_dispatchExiting = true;
@@ -192,6 +375,10 @@ static bool _parseFuzzOpts(struct mSubParser* parser, int option, const char* ar
 	case 'F':
 		opts->frames = strtoul(arg, 0, 10);
 		return !errno;
+	case 'K':
+		free(opts->inputs);
+		opts->inputs = strdup(arg);
+		return true;
 	case 'N':
 		opts->noVideo = true;
 		return true;
@@ -205,3 +392,4 @@ static bool _parseFuzzOpts(struct mSubParser* parser, int option, const char* ar
 		return false;
 	}
 }
+#endif
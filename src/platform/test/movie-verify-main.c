@@ -0,0 +1,269 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/rr/kfm.h>
+
+#include <mgba-util/threading.h>
+#include <mgba-util/vfs.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define VERIFY_OPTIONS "hj:s:v"
+#define VERIFY_USAGE \
+	"usage: %s [options] ROM MOVIE\n" \
+	"Check a keyframed movie by replaying the segments between its keyframes in parallel and\n" \
+	"comparing the state at the end of each with the keyframe that follows it\n" \
+	"\nOptions:\n" \
+	"  -j THREADS       Number of segments to replay at once (default: one per CPU)\n" \
+	"  -s FIRST[:LAST]  Only check segments FIRST to LAST\n" \
+	"  -v               Print every segment, not just the ones that fail\n" \
+	"  -h               Print this usage and exit\n"
+
+struct VerifySegment {
+	uint32_t startFrame;
+	uint32_t endFrame;
+	enum GBAKFMVerifyResult result;
+	uint64_t expected;
+	uint64_t actual;
+};
+
+struct VerifyJob {
+	const char* rom;
+	const char* movie;
+	struct VerifySegment* segments;
+	size_t first;
+	size_t last;
+	size_t next;
+#ifndef DISABLE_THREADING
+	Mutex mutex;
+#endif
+};
+
+static bool _takeSegment(struct VerifyJob* job, size_t* index) {
+#ifndef DISABLE_THREADING
+	MutexLock(&job->mutex);
+#endif
+	bool found = job->next <= job->last;
+	if (found) {
+		*index = job->next;
+		++job->next;
+	}
+#ifndef DISABLE_THREADING
+	MutexUnlock(&job->mutex);
+#endif
+	return found;
+}
+
+static struct mCore* _loadCore(const char* rom) {
+	struct mCore* core = mCoreFind(rom);
+	if (!core) {
+		return NULL;
+	}
+	core->init(core);
+	if (core->platform(core) != PLATFORM_GBA) {
+		core->deinit(core);
+		return NULL;
+	}
+	// Keyframes only restore the emulated state, so settings that change timing, such as the BIOS or
+	// idle loop removal, come from the same configuration the movie was most likely recorded with
+	mCoreInitConfig(core, "movie-verify");
+	mCoreConfigLoad(&core->config);
+	struct mCoreOptions opts = {
+		.useBios = true,
+	};
+	mCoreConfigLoadDefaults(&core->config, &opts);
+	if (!mCoreLoadFile(core, rom)) {
+		mCoreConfigDeinit(&core->config);
+		core->deinit(core);
+		return NULL;
+	}
+	mCoreLoadConfig(core);
+	core->reset(core);
+	return core;
+}
+
+static void _verifySegments(struct VerifyJob* job) {
+	struct mCore* core = _loadCore(job->rom);
+	struct VFile* vf = core ? VFileOpen(job->movie, O_RDONLY) : NULL;
+	if (!vf) {
+		if (core) {
+			mCoreConfigDeinit(&core->config);
+			core->deinit(core);
+		}
+		// Leave the segments marked as errors for whichever workers did start to pick up
+		return;
+	}
+	struct GBA* gba = core->board;
+	struct GBAKFMContext kfm;
+	GBAKFMContextCreate(&kfm, gba);
+	gba->rr = &kfm.d;
+	if (GBAKFMSetStream(&kfm, vf)) {
+		size_t index;
+		while (_takeSegment(job, &index)) {
+			struct VerifySegment* segment = &job->segments[index];
+			segment->result = GBAKFMVerifySegment(&kfm, index, &segment->expected, &segment->actual);
+		}
+	}
+	gba->rr = NULL;
+	kfm.d.destroy(&kfm.d);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _verifyWorker(void* context) {
+	ThreadSetName("Movie Verify Worker");
+	_verifySegments(context);
+	return 0;
+}
+#endif
+
+static bool _readKeyframes(const char* movie, struct VerifySegment** segments, size_t* nSegments) {
+	struct VFile* vf = VFileOpen(movie, O_RDONLY);
+	if (!vf) {
+		return false;
+	}
+	struct GBAKFMContext kfm;
+	GBAKFMContextCreate(&kfm, NULL);
+	bool success = GBAKFMSetStream(&kfm, vf);
+	if (success) {
+		size_t nKeyframes = GBAKFMKeyframeCount(&kfm);
+		*nSegments = nKeyframes ? nKeyframes - 1 : 0;
+		*segments = calloc(*nSegments ? *nSegments : 1, sizeof(**segments));
+		size_t i;
+		for (i = 0; i < *nSegments; ++i) {
+			(*segments)[i].startFrame = GBAKFMKeyframeListGetPointer(&kfm.keyframes, i)->frame;
+			(*segments)[i].endFrame = GBAKFMKeyframeListGetPointer(&kfm.keyframes, i + 1)->frame;
+			(*segments)[i].result = GBA_KFM_VERIFY_ERROR;
+		}
+	}
+	kfm.d.destroy(&kfm.d);
+	return success;
+}
+
+int main(int argc, char** argv) {
+	unsigned nThreads = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus > 0) {
+		nThreads = cpus;
+	}
+#endif
+	size_t first = 0;
+	size_t last = SIZE_MAX;
+	bool verbose = false;
+	int ch;
+	while ((ch = getopt(argc, argv, VERIFY_OPTIONS)) != -1) {
+		switch (ch) {
+		case 'j':
+			nThreads = strtoul(optarg, NULL, 0);
+			if (!nThreads) {
+				nThreads = 1;
+			}
+			break;
+		case 's': {
+			char* end;
+			first = strtoul(optarg, &end, 0);
+			if (*end == ':') {
+				last = strtoul(end + 1, &end, 0);
+			}
+			if (*end || last < first) {
+				fprintf(stderr, "Invalid segment range: %s\n", optarg);
+				return 1;
+			}
+			break;
+		}
+		case 'v':
+			verbose = true;
+			break;
+		case 'h':
+		default:
+			printf(VERIFY_USAGE, argv[0]);
+			return ch == 'h' ? 0 : 1;
+		}
+	}
+	if (optind + 2 != argc) {
+		printf(VERIFY_USAGE, argv[0]);
+		return 1;
+	}
+
+	struct VerifyJob job = {
+		.rom = argv[optind],
+		.movie = argv[optind + 1],
+	};
+	size_t nSegments;
+	if (!_readKeyframes(job.movie, &job.segments, &nSegments)) {
+		fprintf(stderr, "Could not read keyframed movie %s\n", job.movie);
+		return 1;
+	}
+	if (last >= nSegments) {
+		last = nSegments - 1;
+	}
+	if (!nSegments || first > last) {
+		fprintf(stderr, "No segments to verify: the movie has %" PRIz "u\n", nSegments);
+		free(job.segments);
+		return 1;
+	}
+	job.first = first;
+	job.last = last;
+	job.next = first;
+
+#ifndef DISABLE_THREADING
+	if (nThreads > last - first + 1) {
+		nThreads = last - first + 1;
+	}
+	MutexInit(&job.mutex);
+	if (nThreads > 1) {
+		Thread* threads = calloc(nThreads, sizeof(*threads));
+		unsigned i;
+		for (i = 0; i < nThreads; ++i) {
+			ThreadCreate(&threads[i], _verifyWorker, &job);
+		}
+		for (i = 0; i < nThreads; ++i) {
+			ThreadJoin(threads[i]);
+		}
+		free(threads);
+	} else
+#endif
+	{
+		_verifySegments(&job);
+	}
+#ifndef DISABLE_THREADING
+	MutexDeinit(&job.mutex);
+#endif
+
+	size_t mismatched = 0;
+	size_t failed = 0;
+	size_t i;
+	for (i = first; i <= last; ++i) {
+		const struct VerifySegment* segment = &job.segments[i];
+		switch (segment->result) {
+		case GBA_KFM_VERIFY_MATCH:
+			if (verbose) {
+				printf("Segment %" PRIz "u (frames %u-%u): OK\n", i, segment->startFrame, segment->endFrame);
+			}
+			break;
+		case GBA_KFM_VERIFY_MISMATCH:
+			++mismatched;
+			printf("Segment %" PRIz "u (frames %u-%u): desync, state hash %016" PRIX64 " instead of %016" PRIX64 "\n",
+			       i, segment->startFrame, segment->endFrame, segment->actual, segment->expected);
+			break;
+		case GBA_KFM_VERIFY_ERROR:
+			++failed;
+			printf("Segment %" PRIz "u (frames %u-%u): could not be replayed\n", i, segment->startFrame, segment->endFrame);
+			break;
+		}
+	}
+	printf("Verified %" PRIz "u segments: %" PRIz "u desynced, %" PRIz "u failed\n", last - first + 1, mismatched, failed);
+	free(job.segments);
+	return mismatched || failed ? 1 : 0;
+}
@@ -7,13 +7,23 @@
 #include <mgba/core/cheats.h>
 #include <mgba/core/config.h>
 #include <mgba/core/core.h>
+#include <mgba/core/metrics.h>
+#include <mgba/core/perf-counters.h>
+#include <mgba/core/trace.h>
+#include <mgba/core/rom-cache.h>
 #include <mgba/core/serialize.h>
+#include <mgba/core/version.h>
 #include <mgba/gb/core.h>
 #include <mgba/gba/core.h>
 
 #include <mgba/feature/commandline.h>
+#include <mgba/feature/video-logger.h>
+#include <mgba-util/crc32.h>
+#include <mgba-util/memory.h>
 #include <mgba-util/socket.h>
 #include <mgba-util/string.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 
 #ifdef _3DS
@@ -27,27 +37,131 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <inttypes.h>
+#include <math.h>
 #include <sys/time.h>
 
-#define PERF_OPTIONS "DF:L:NPS:T"
+#define PERF_OPTIONS "AB:DE:F:H:I:J:L:M:NPR:S:TW:"
 #define PERF_USAGE \
 	"\nBenchmark options:\n" \
+	"  -A               Skip audio synthesis entirely\n" \
 	"  -F FRAMES        Run for the specified number of FRAMES before exiting\n" \
 	"  -N               Disable video rendering entirely\n" \
 	"  -T               Use threaded video rendering\n" \
 	"  -P               CSV output, useful for parsing\n" \
+	"  -H FILE          Write per-handler and per-region counters to FILE when done\n" \
+	"                   Only available in builds with ENABLE_PERF_COUNTERS\n" \
+	"  -E FILE          Write a Chrome trace-event timeline of every thread to FILE when done\n" \
+	"                   Only available in builds with ENABLE_TRACE\n" \
 	"  -S SEC           Run for SEC in-game seconds before exiting\n" \
 	"  -L FILE          Load a savestate when starting the test\n" \
-	"  -D               Act as a server"
+	"  -D               Act as a server\n" \
+	"                   With -J, serve jobs from many clients at once on a pool of cores\n" \
+	"  -B FILE          Run every job listed in FILE and output CSV\n" \
+	"                   Each line is a ROM path, optionally followed by a tab and a savestate path\n" \
+	"                   and another tab and a frame count overriding -F or -S\n" \
+	"  -J THREADS       Run batch or server jobs on THREADS worker threads\n" \
+	"  -M PORT          With -D and -J, serve Prometheus metrics over HTTP on PORT\n" \
+	"  -R FILE          Benchmark every scene listed in FILE and output JSON statistics\n" \
+	"                   Scenes are listed in the same format as for -B\n" \
+	"  -W FRAMES        Run each benchmark scene for FRAMES unmeasured frames first\n" \
+	"  -I COUNT         Measure each benchmark scene COUNT times (default 5)"
+
+#define PERF_CSV_HEADER "game_code,frames,duration,renderer"
+#ifdef ENABLE_PERF_COUNTERS
+#define PERF_COUNTERS_CSV_HEADER ",arm_instructions,thumb_instructions," \
+	"accesses_0,accesses_1,accesses_2,accesses_3,accesses_4,accesses_5,accesses_6,accesses_7," \
+	"accesses_8,accesses_9,accesses_a,accesses_b,accesses_c,accesses_d,accesses_e,accesses_f," \
+	"waitstate_cycles,dma_cycles,idle_loop_skips,events_fired,events"
+#else
+#define PERF_COUNTERS_CSV_HEADER ""
+#endif
+#define PERF_BATCH_CSV_HEADER PERF_CSV_HEADER ",job,cycles,fps"
+#define PERF_SERVER_CSV_HEADER PERF_BATCH_CSV_HEADER ",rom_crc32,video_crc32,status"
+
+#define PERF_SERVER_PORT 7216
+#define PERF_SERVER_MAX_CLIENTS 64
+#define PERF_SERVER_LINE_MAX (PATH_MAX * 2 + 0x1000)
 
 struct PerfOpts {
 	bool noVideo;
+	bool noAudio;
 	bool threadedVideo;
 	bool csv;
+	char* counters;
+	char* trace;
 	unsigned duration;
 	unsigned frames;
 	char* savestate;
 	bool server;
+	char* batch;
+	unsigned batchThreads;
+	char* scenes;
+	unsigned warmup;
+	unsigned repetitions;
+	unsigned metricsPort;
+};
+
+struct PerfROM {
+	char* path;
+	struct VFile* vf;
+	enum mPlatform platform;
+	bool shared;
+	uint32_t crc32;
+};
+
+struct PerfInput {
+	unsigned frame;
+	uint32_t keys;
+};
+
+struct PerfClient {
+	Socket socket;
+	unsigned refs;
+	bool closed;
+	size_t nextJob;
+	size_t fill;
+	char buffer[PERF_SERVER_LINE_MAX];
+};
+
+struct PerfJob {
+	size_t rom;
+	char* savestate;
+	unsigned frames;
+	struct PerfInput* inputs;
+	size_t nInputs;
+	// Set for jobs submitted to the server, whose results go back to that client instead of stdout
+	struct PerfClient* client;
+	size_t id;
+};
+
+DECLARE_VECTOR(PerfROMList, struct PerfROM);
+DEFINE_VECTOR(PerfROMList, struct PerfROM);
+DECLARE_VECTOR(PerfJobList, struct PerfJob);
+DEFINE_VECTOR(PerfJobList, struct PerfJob);
+DECLARE_VECTOR(PerfClientList, struct PerfClient*);
+DEFINE_VECTOR(PerfClientList, struct PerfClient*);
+
+struct PerfBatch {
+	const struct mArguments* args;
+	const struct PerfOpts* perfOpts;
+	struct mROMCache romCache;
+	struct PerfROMList roms;
+	struct PerfJobList jobs;
+	Mutex mutex;
+	Condition jobAvailable;
+	size_t nextJob;
+	// While serving, workers wait for more jobs instead of exiting once the list runs out
+	bool serving;
+	bool failed;
+	// Totals over every finished job, only collected when serving metrics
+	struct mCoreMetrics metrics;
+};
+
+struct PerfWorker {
+	struct mCore* core;
+	struct mCoreOptions opts;
+	void* outputBuffer;
+	struct mCoreMetricsRecorder metrics;
 };
 
 #ifdef _3DS
@@ -58,12 +172,22 @@ FS_Archive sdmcArchive;
 TimeType __nx_time_type = TimeType_LocalSystemClock;
 #endif
 
-static void _mPerfRunloop(struct mCore* context, int* frames, bool quiet);
+static void _mPerfRunloop(struct mCore* context, int* frames, bool quiet, const struct PerfInput* inputs, size_t nInputs, struct mCoreMetricsRecorder* metrics);
 static void _mPerfShutdown(int signal);
 static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* arg);
 static void _log(struct mLogger*, int, enum mLogLevel, const char*, va_list);
 static bool _mPerfRunCore(const char* fname, const struct mArguments*, const struct PerfOpts*);
 static bool _mPerfRunServer(const char* listen, const struct mArguments*, const struct PerfOpts*);
+static bool _mPerfRunBatch(const char* manifest, const struct mArguments*, const struct PerfOpts*);
+static bool _mPerfRunBenchmark(const char* pack, const struct mArguments*, const struct PerfOpts*);
+#ifndef DISABLE_THREADING
+static bool _mPerfRunPoolServer(const struct mArguments*, const struct PerfOpts*);
+#endif
+static void _mPerfConfigureCore(struct mCore* core, const struct mArguments*, const struct PerfOpts*, struct mCoreOptions* opts);
+static const char* _mPerfRendererName(const struct PerfOpts*);
+#ifdef ENABLE_PERF_COUNTERS
+static void _mPerfFormatCounters(char* buffer, size_t size, const struct mPerfCounters*);
+#endif
 
 static bool _dispatchExiting = false;
 static struct VFile* _savestate = 0;
@@ -90,7 +214,7 @@ int main(int argc, char** argv) {
 	struct mLogger logger = { .log = _log };
 	mLogSetDefaultLogger(&logger);
 
-	struct PerfOpts perfOpts = { false, false, false, 0, 0, 0, false };
+	struct PerfOpts perfOpts = { false, false, false, false, NULL, NULL, 0, 0, 0, false, 0, 0, NULL, 0, 5, 0 };
 	struct mSubParser subparser = {
 		.usage = PERF_USAGE,
 		.parse = _parsePerfOpts,
@@ -100,7 +224,7 @@ int main(int argc, char** argv) {
 
 	struct mArguments args = {};
 	bool parsed = parseArguments(&args, argc, argv, &subparser);
-	if (!args.fname) {
+	if (!args.fname && !perfOpts.batch && !perfOpts.scenes) {
 		parsed = false;
 	}
 	if (!parsed || args.showHelp) {
@@ -118,10 +242,33 @@ int main(int argc, char** argv) {
 		_savestate = VFileOpen(perfOpts.savestate, O_RDONLY);
 		free(perfOpts.savestate);
 	}
+#ifdef ENABLE_TRACE
+	if (perfOpts.trace) {
+		mTraceSetEnabled(true);
+	}
+#endif
+
+	if (perfOpts.scenes) {
+		didFail = !_mPerfRunBenchmark(perfOpts.scenes, &args, &perfOpts);
+		free(perfOpts.scenes);
+		free(perfOpts.batch);
+		goto cleanup;
+	}
+	if (perfOpts.batch) {
+		didFail = !_mPerfRunBatch(perfOpts.batch, &args, &perfOpts);
+		free(perfOpts.batch);
+		goto cleanup;
+	}
+#ifndef DISABLE_THREADING
+	if (perfOpts.server && perfOpts.batchThreads) {
+		didFail = !_mPerfRunPoolServer(&args, &perfOpts);
+		goto cleanup;
+	}
+#endif
 
 	_outputBuffer = malloc(256 * 256 * 4);
 	if (perfOpts.csv) {
-		puts("game_code,frames,duration,renderer");
+		puts(PERF_CSV_HEADER PERF_COUNTERS_CSV_HEADER);
 #ifdef __SWITCH__
 		consoleUpdate(NULL);
 #endif
@@ -133,10 +280,25 @@ int main(int argc, char** argv) {
 	}
 	free(_outputBuffer);
 
+	cleanup:
+#ifdef ENABLE_TRACE
+	if (mTraceIsEnabled()) {
+		mTraceSetEnabled(false);
+		struct VFile* vf = VFileOpen(perfOpts.trace, O_CREAT | O_TRUNC | O_WRONLY);
+		if (!vf || !mTraceWriteChrome(vf)) {
+			fprintf(stderr, "Could not write trace to %s\n", perfOpts.trace);
+			didFail = true;
+		}
+		if (vf) {
+			vf->close(vf);
+		}
+	}
+#endif
+	free(perfOpts.counters);
+	free(perfOpts.trace);
 	if (_savestate) {
 		_savestate->close(_savestate);
 	}
-	cleanup:
 	freeArguments(&args);
 
 #ifdef _3DS
@@ -163,22 +325,8 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 		core->setVideoBuffer(core, _outputBuffer, 256);
 	}
 	mCoreLoadFile(core, fname);
-	mCoreConfigInit(&core->config, "perf");
-	mCoreConfigLoad(&core->config);
-
-	if (perfOpts->threadedVideo) {
-		mCoreConfigSetOverrideIntValue(&core->config, "threadedVideo", 1);
-	} else {
-		mCoreConfigSetOverrideIntValue(&core->config, "threadedVideo", 0);
-	}
-
 	struct mCoreOptions opts = {};
-	mCoreConfigMap(&core->config, &opts);
-	opts.audioSync = false;
-	opts.videoSync = false;
-	applyArguments(args, NULL, &core->config);
-	mCoreConfigLoadDefaults(&core->config, &opts);
-	mCoreConfigSetDefaultValue(&core->config, "idleOptimization", "detect");
+	_mPerfConfigureCore(core, args, perfOpts, &opts);
 	mCoreLoadConfig(core);
 
 	core->reset(core);
@@ -192,13 +340,33 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 	if (!frames) {
 		frames = perfOpts->duration * 60;
 	}
+#ifdef ENABLE_PERF_COUNTERS
+	// The handler histograms make this too big for the stack on some platforms
+	struct mPerfCounters* counters = malloc(sizeof(*counters));
+	mPerfCountersReset(counters);
+	if (perfOpts->csv || perfOpts->counters) {
+		core->setPerfCounters(core, counters);
+	}
+#endif
 	struct timeval tv;
 	gettimeofday(&tv, 0);
 	uint64_t start = 1000000LL * tv.tv_sec + tv.tv_usec;
-	_mPerfRunloop(core, &frames, perfOpts->csv);
+	_mPerfRunloop(core, &frames, perfOpts->csv, NULL, 0, NULL);
 	gettimeofday(&tv, 0);
 	uint64_t end = 1000000LL * tv.tv_sec + tv.tv_usec;
 	uint64_t duration = end - start;
+#ifdef ENABLE_PERF_COUNTERS
+	core->setPerfCounters(core, NULL);
+	if (perfOpts->counters) {
+		struct VFile* vf = VFileOpen(perfOpts->counters, O_CREAT | O_TRUNC | O_WRONLY);
+		if (!vf || !mPerfCountersDump(counters, vf)) {
+			fprintf(stderr, "Could not write counters to %s\n", perfOpts->counters);
+		}
+		if (vf) {
+			vf->close(vf);
+		}
+	}
+#endif
 
 	mCoreConfigFreeOpts(&opts);
 	mCoreConfigDeinit(&core->config);
@@ -206,16 +374,13 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 
 	float scaledFrames = frames * 1000000.f;
 	if (perfOpts->csv) {
-		char buffer[256];
-		const char* rendererName;
-		if (perfOpts->noVideo) {
-			rendererName = "none";
-		} else if (perfOpts->threadedVideo) {
-			rendererName = "threaded-software";
-		} else {
-			rendererName = "software";
-		}
-		snprintf(buffer, sizeof(buffer), "%s,%i,%" PRIu64 ",%s\n", gameCode, frames, duration, rendererName);
+		char buffer[2048];
+		size_t length = snprintf(buffer, sizeof(buffer), "%s,%i,%" PRIu64 ",%s", gameCode, frames, duration, _mPerfRendererName(perfOpts));
+#ifdef ENABLE_PERF_COUNTERS
+		_mPerfFormatCounters(&buffer[length], sizeof(buffer) - length, counters);
+		length = strlen(buffer);
+#endif
+		snprintf(&buffer[length], sizeof(buffer) - length, "\n");
 		printf("%s", buffer);
 		if (_socket != INVALID_SOCKET) {
 			SocketSend(_socket, buffer, strlen(buffer));
@@ -226,18 +391,87 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 #ifdef __SWITCH__
 	consoleUpdate(NULL);
 #endif
+#ifdef ENABLE_PERF_COUNTERS
+	free(counters);
+#endif
 
 	return true;
 }
 
-static void _mPerfRunloop(struct mCore* core, int* frames, bool quiet) {
+static void _mPerfConfigureCore(struct mCore* core, const struct mArguments* args, const struct PerfOpts* perfOpts, struct mCoreOptions* opts) {
+	mCoreConfigInit(&core->config, "perf");
+	mCoreConfigLoad(&core->config);
+
+	if (perfOpts->threadedVideo) {
+		mCoreConfigSetOverrideIntValue(&core->config, "threadedVideo", 1);
+	} else {
+		mCoreConfigSetOverrideIntValue(&core->config, "threadedVideo", 0);
+	}
+
+	mCoreConfigMap(&core->config, opts);
+	opts->audioSync = false;
+	opts->videoSync = false;
+	opts->skipAudio = perfOpts->noAudio;
+	applyArguments(args, NULL, &core->config);
+	mCoreConfigLoadDefaults(&core->config, opts);
+	mCoreConfigSetDefaultValue(&core->config, "idleOptimization", "detect");
+}
+
+static const char* _mPerfRendererName(const struct PerfOpts* perfOpts) {
+	if (perfOpts->noVideo) {
+		return "none";
+	}
+	if (perfOpts->threadedVideo) {
+		return "threaded-software";
+	}
+	return "software";
+}
+
+#ifdef ENABLE_PERF_COUNTERS
+static void _mPerfFormatCounters(char* buffer, size_t size, const struct mPerfCounters* counters) {
+	size_t length = snprintf(buffer, size, ",%" PRIu64 ",%" PRIu64, counters->instructions[0], counters->instructions[1]);
+	size_t i;
+	for (i = 0; i < mPERF_COUNTER_REGIONS && length < size; ++i) {
+		length += snprintf(&buffer[length], size - length, ",%" PRIu64, counters->memoryAccesses[i]);
+	}
+	if (length < size) {
+		length += snprintf(&buffer[length], size - length, ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",",
+		                   counters->waitstateCycles, counters->dmaCycles, counters->idleLoopSkips, counters->eventsFired);
+	}
+	// Events go in one column as name:count pairs, since which ones fire depends on the core
+	for (i = 0; i < counters->nEvents && length < size; ++i) {
+		length += snprintf(&buffer[length], size - length, "%s%s:%" PRIu64, i ? ";" : "", counters->events[i].name, counters->events[i].fired);
+	}
+}
+#endif
+
+static void _mPerfRecordFrame(struct mCore* core, struct mCoreMetricsRecorder* metrics) {
+	// There is no sync here, so the only waiting to account for is on a threaded renderer
+	uint64_t waits[mCORE_METRICS_PHASE_MAX] = { 0 };
+	if (core->videoLogger) {
+		waits[mCORE_METRICS_RENDER] = core->videoLogger->blockedTime;
+	}
+	mCoreMetricsRecorderFrame(metrics, waits);
+	mCoreMetricsSampleVideoLogger(&metrics->metrics, core->videoLogger);
+}
+
+static void _mPerfRunloop(struct mCore* core, int* frames, bool quiet, const struct PerfInput* inputs, size_t nInputs, struct mCoreMetricsRecorder* metrics) {
 	struct timeval lastEcho;
 	gettimeofday(&lastEcho, 0);
 	int duration = *frames;
 	*frames = 0;
 	int lastFrames = 0;
+	size_t input = 0;
 	while (!_dispatchExiting) {
+		for (; input < nInputs && inputs[input].frame <= (unsigned) *frames; ++input) {
+			core->setKeys(core, inputs[input].keys);
+		}
+		mTRACE_BEGIN(trace);
 		core->runFrame(core);
+		mTRACE_END(trace, "frame");
+		if (metrics) {
+			_mPerfRecordFrame(core, metrics);
+		}
 		++*frames;
 		++lastFrames;
 		if (!quiet) {
@@ -280,7 +514,7 @@ static bool _mPerfRunServer(const char* listen, const struct mArguments* args, c
 	}
 	_socket = SocketAccept(server, NULL);
 	if (perfOpts->csv) {
-		const char* header = "game_code,frames,duration,renderer\n";
+		const char* header = PERF_CSV_HEADER PERF_COUNTERS_CSV_HEADER "\n";
 		SocketSend(_socket, header, strlen(header));
 	}
 	char path[PATH_MAX];
@@ -306,6 +540,942 @@ static bool _mPerfRunServer(const char* listen, const struct mArguments* args, c
 	return true;
 }
 
+static void _mPerfBatchInit(struct PerfBatch* batch, const struct mArguments* args, const struct PerfOpts* perfOpts) {
+	memset(batch, 0, sizeof(*batch));
+	batch->args = args;
+	batch->perfOpts = perfOpts;
+	mROMCacheInit(&batch->romCache);
+	PerfROMListInit(&batch->roms, 0);
+	PerfJobListInit(&batch->jobs, 0);
+	MutexInit(&batch->mutex);
+	ConditionInit(&batch->jobAvailable);
+}
+
+static void _mPerfBatchDeinit(struct PerfBatch* batch) {
+	size_t i;
+	for (i = 0; i < PerfJobListSize(&batch->jobs); ++i) {
+		struct PerfJob* job = PerfJobListGetPointer(&batch->jobs, i);
+		free(job->savestate);
+		free(job->inputs);
+	}
+	for (i = 0; i < PerfROMListSize(&batch->roms); ++i) {
+		struct PerfROM* rom = PerfROMListGetPointer(&batch->roms, i);
+		rom->vf->close(rom->vf);
+		free(rom->path);
+	}
+	PerfJobListDeinit(&batch->jobs);
+	PerfROMListDeinit(&batch->roms);
+	mROMCacheDeinit(&batch->romCache);
+	ConditionDeinit(&batch->jobAvailable);
+	MutexDeinit(&batch->mutex);
+}
+
+static bool _mPerfBatchAddROM(struct PerfBatch* batch, const char* path, size_t* index) {
+	// The batch keeps every ROM open in the cache so that all jobs using it share one copy
+	size_t i;
+	for (i = 0; i < PerfROMListSize(&batch->roms); ++i) {
+		if (strcmp(PerfROMListGetPointer(&batch->roms, i)->path, path) == 0) {
+			*index = i;
+			return true;
+		}
+	}
+	struct VFile* romVf = VFileOpen(path, O_RDONLY);
+	if (!romVf) {
+		return false;
+	}
+	enum mPlatform platform = mCoreIsCompatible(romVf);
+	if (platform == PLATFORM_NONE) {
+		romVf->close(romVf);
+		return false;
+	}
+	romVf = mROMCacheOpen(&batch->romCache, romVf);
+
+	// Workers copy ROM entries out while the server appends to the list, so this needs the lock
+	MutexLock(&batch->mutex);
+	struct PerfROM* rom = PerfROMListAppend(&batch->roms);
+	rom->path = strdup(path);
+	rom->vf = romVf;
+	rom->platform = platform;
+	rom->shared = mROMCacheGetCRC32(romVf, &rom->crc32);
+	*index = PerfROMListIndex(&batch->roms, rom);
+	MutexUnlock(&batch->mutex);
+	return true;
+}
+
+static bool _mPerfBatchLoad(struct PerfBatch* batch, const char* manifest) {
+	struct VFile* vf = VFileOpen(manifest, O_RDONLY);
+	if (!vf) {
+		fprintf(stderr, "Could not open batch manifest %s\n", manifest);
+		return false;
+	}
+	char line[PATH_MAX * 2 + 2];
+	unsigned lineNo = 0;
+	bool success = true;
+	while (vf->readline(vf, line, sizeof(line)) > 0) {
+		++lineNo;
+		line[strcspn(line, "\r\n")] = '\0';
+		if (!line[0] || line[0] == '#') {
+			continue;
+		}
+		char* savestate = strchr(line, '\t');
+		char* frames = NULL;
+		if (savestate) {
+			*savestate = '\0';
+			++savestate;
+			frames = strchr(savestate, '\t');
+			if (frames) {
+				*frames = '\0';
+				++frames;
+			}
+			if (!savestate[0]) {
+				savestate = NULL;
+			}
+		}
+		unsigned long nFrames = 0;
+		if (frames && frames[0]) {
+			char* end;
+			errno = 0;
+			nFrames = strtoul(frames, &end, 10);
+			if (errno || *end || nFrames > INT_MAX) {
+				fprintf(stderr, "%s:%u: Invalid frame count %s\n", manifest, lineNo, frames);
+				success = false;
+				break;
+			}
+		}
+
+		size_t rom;
+		if (!_mPerfBatchAddROM(batch, line, &rom)) {
+			fprintf(stderr, "%s:%u: Could not load ROM %s\n", manifest, lineNo, line);
+			success = false;
+			break;
+		}
+
+		struct PerfJob* job = PerfJobListAppend(&batch->jobs);
+		memset(job, 0, sizeof(*job));
+		job->rom = rom;
+		job->savestate = savestate ? strdup(savestate) : NULL;
+		job->frames = nFrames;
+		job->id = PerfJobListIndex(&batch->jobs, job);
+	}
+	vf->close(vf);
+	return success;
+}
+
+static void _mPerfClientUnref(struct PerfClient* client) {
+	// Called with the batch mutex held
+	--client->refs;
+	if (!client->refs) {
+		SocketClose(client->socket);
+		free(client);
+	}
+}
+
+static bool _mPerfBatchTakeJob(struct PerfBatch* batch, struct PerfJob* job, struct PerfROM* rom) {
+	MutexLock(&batch->mutex);
+	while (batch->serving && batch->nextJob == PerfJobListSize(&batch->jobs)) {
+		ConditionWait(&batch->jobAvailable, &batch->mutex);
+	}
+	bool found = batch->nextJob < PerfJobListSize(&batch->jobs);
+	if (found) {
+		// The job's allocations now belong to the worker
+		struct PerfJob* next = PerfJobListGetPointer(&batch->jobs, batch->nextJob);
+		*job = *next;
+		next->savestate = NULL;
+		next->inputs = NULL;
+		*rom = *PerfROMListGetConstPointer(&batch->roms, job->rom);
+		++batch->nextJob;
+		if (batch->serving && batch->nextJob == PerfJobListSize(&batch->jobs)) {
+			PerfJobListClear(&batch->jobs);
+			batch->nextJob = 0;
+		}
+	}
+	MutexUnlock(&batch->mutex);
+	return found;
+}
+
+// Jobs find their ROM by the CRC32 it was cached under when it was added, so neither the file
+// nor its checksum is read again per job. Only a ROM the cache couldn't share is reopened.
+static struct VFile* _mPerfBatchOpenROM(struct PerfBatch* batch, const struct PerfROM* rom) {
+	struct VFile* vf = NULL;
+	if (rom->shared) {
+		vf = mROMCacheOpenCRC32(&batch->romCache, rom->crc32);
+	}
+	if (!vf) {
+		vf = VFileOpen(rom->path, O_RDONLY);
+	}
+	return vf;
+}
+
+static void _mPerfBatchReport(struct PerfBatch* batch, const struct PerfJob* job, const char* line) {
+	MutexLock(&batch->mutex);
+	if (job->client) {
+		SocketSend(job->client->socket, line, strlen(line));
+	} else {
+		printf("%s", line);
+		fflush(stdout);
+	}
+	MutexUnlock(&batch->mutex);
+}
+
+static uint32_t _mPerfVideoCRC32(struct mCore* core, const struct PerfOpts* perfOpts, const void* outputBuffer) {
+	if (perfOpts->noVideo) {
+		return 0;
+	}
+	unsigned width;
+	unsigned height;
+	core->desiredVideoDimensions(core, &width, &height);
+	const uint8_t* row = outputBuffer;
+	uint32_t crc = 0;
+	unsigned y;
+	for (y = 0; y < height; ++y, row += 256 * BYTES_PER_PIXEL) {
+		crc = crc32(crc, row, width * BYTES_PER_PIXEL);
+	}
+	return crc;
+}
+
+static bool _mPerfBatchRunJob(struct PerfBatch* batch, struct PerfWorker* worker, const struct PerfJob* job, const struct PerfROM* rom) {
+	const struct PerfOpts* perfOpts = batch->perfOpts;
+	struct VFile* vf = _mPerfBatchOpenROM(batch, rom);
+	if (!vf) {
+		return false;
+	}
+
+	// Workers keep their core between jobs unless the next ROM is for a different platform.
+	// The threaded video proxy does not survive a second reset, so those cores are not reused.
+	// A kept core also keeps its BIOS, which is only loaded when the core has none yet.
+	struct mCore* core = worker->core;
+	if (core && (core->platform(core) != rom->platform || perfOpts->threadedVideo)) {
+		mCoreConfigFreeOpts(&worker->opts);
+		mCoreConfigDeinit(&core->config);
+		core->deinit(core);
+		core = NULL;
+	}
+	if (!core) {
+		core = mCoreFindVF(vf);
+		if (!core) {
+			vf->close(vf);
+			worker->core = NULL;
+			return false;
+		}
+		core->init(core);
+		if (!perfOpts->noVideo) {
+			core->setVideoBuffer(core, worker->outputBuffer, 256);
+		}
+		memset(&worker->opts, 0, sizeof(worker->opts));
+		_mPerfConfigureCore(core, batch->args, perfOpts, &worker->opts);
+	}
+	worker->core = core;
+
+	if (!core->loadROM(core, vf)) {
+		vf->close(vf);
+		return false;
+	}
+	mCoreLoadConfig(core);
+	core->reset(core);
+	// Keys outlive a reset, so don't let the previous job's input leak into this one
+	core->setKeys(core, 0);
+	if (job->savestate) {
+		struct VFile* state = VFileOpen(job->savestate, O_RDONLY);
+		if (!state) {
+			return false;
+		}
+		bool loaded = mCoreLoadStateNamed(core, state, 0);
+		state->close(state);
+		if (!loaded) {
+			return false;
+		}
+	}
+
+	char gameCode[9] = { 0 };
+	core->getGameCode(core, gameCode);
+
+	int frames = job->frames;
+	if (!frames) {
+		frames = perfOpts->frames;
+	}
+	if (!frames) {
+		frames = perfOpts->duration * 60;
+	}
+	struct mCoreMetricsRecorder* metrics = NULL;
+	if (perfOpts->metricsPort) {
+		// The core may be new, so its renderer's totals can't be compared to the last job's
+		metrics = &worker->metrics;
+		mCoreMetricsRecorderSkip(metrics);
+	}
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	uint64_t start = 1000000LL * tv.tv_sec + tv.tv_usec;
+	_mPerfRunloop(core, &frames, true, job->inputs, job->nInputs, metrics);
+	gettimeofday(&tv, 0);
+	uint64_t end = 1000000LL * tv.tv_sec + tv.tv_usec;
+	uint64_t duration = end - start;
+	uint64_t cycles = (uint64_t) frames * core->frameCycles(core);
+	if (metrics) {
+		// Nothing is left queued for a job that's done
+		metrics->metrics.videoQueueDepth = 0;
+		MutexLock(&batch->mutex);
+		mCoreMetricsMerge(&batch->metrics, &metrics->metrics);
+		MutexUnlock(&batch->mutex);
+		mCoreMetricsReset(&metrics->metrics);
+	}
+
+	char line[256];
+	size_t length = snprintf(line, sizeof(line), "%s,%i,%" PRIu64 ",%s,%" PRIz "u,%" PRIu64 ",%g", gameCode, frames, duration,
+	                         _mPerfRendererName(perfOpts), job->id, cycles, duration ? frames * 1000000. / duration : 0.);
+	if (job->client) {
+		uint32_t romCrc32 = 0;
+		core->checksum(core, &romCrc32, CHECKSUM_CRC32);
+		length += snprintf(&line[length], sizeof(line) - length, ",%08X,%08X,ok", romCrc32, _mPerfVideoCRC32(core, perfOpts, worker->outputBuffer));
+	}
+	snprintf(&line[length], sizeof(line) - length, "\n");
+	_mPerfBatchReport(batch, job, line);
+	return true;
+}
+
+static void _mPerfServerReportError(struct PerfBatch* batch, const struct PerfJob* job, const char* status) {
+	char line[128];
+	snprintf(line, sizeof(line), ",0,0,%s,%" PRIz "u,0,0,,,%s\n", _mPerfRendererName(batch->perfOpts), job->id, status);
+	_mPerfBatchReport(batch, job, line);
+}
+
+static void _mPerfBatchRunJobs(struct PerfBatch* batch) {
+	struct PerfWorker worker = {
+		.outputBuffer = calloc(256 * 256, 4)
+	};
+	mCoreMetricsRecorderInit(&worker.metrics);
+	struct PerfJob job;
+	struct PerfROM rom;
+	while (!_dispatchExiting && _mPerfBatchTakeJob(batch, &job, &rom)) {
+		bool skip = false;
+		if (job.client) {
+			// Nobody is left to read the results of a client that already hung up
+			MutexLock(&batch->mutex);
+			skip = job.client->closed;
+			MutexUnlock(&batch->mutex);
+		}
+		if (!skip && !_mPerfBatchRunJob(batch, &worker, &job, &rom)) {
+			if (job.client) {
+				_mPerfServerReportError(batch, &job, "failed");
+			} else {
+				MutexLock(&batch->mutex);
+				fprintf(stderr, "Job %" PRIz "u failed\n", job.id);
+				batch->failed = true;
+				MutexUnlock(&batch->mutex);
+			}
+		}
+		free(job.savestate);
+		free(job.inputs);
+		if (job.client) {
+			MutexLock(&batch->mutex);
+			_mPerfClientUnref(job.client);
+			MutexUnlock(&batch->mutex);
+		}
+	}
+	if (worker.core) {
+		mCoreConfigFreeOpts(&worker.opts);
+		mCoreConfigDeinit(&worker.core->config);
+		worker.core->deinit(worker.core);
+	}
+	free(worker.outputBuffer);
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _mPerfBatchWorker(void* context) {
+	ThreadSetName("Perf Worker");
+	mTRACE_THREAD("Perf Worker");
+	_mPerfBatchRunJobs(context);
+	return 0;
+}
+#endif
+
+static bool _mPerfRunBatch(const char* manifest, const struct mArguments* args, const struct PerfOpts* perfOpts) {
+	if (!perfOpts->frames && !perfOpts->duration) {
+		fprintf(stderr, "Batch mode requires -F or -S\n");
+		return false;
+	}
+	struct PerfBatch batch;
+	_mPerfBatchInit(&batch, args, perfOpts);
+
+	bool success = _mPerfBatchLoad(&batch, manifest);
+	if (success) {
+		puts(PERF_BATCH_CSV_HEADER);
+#ifndef DISABLE_THREADING
+		unsigned nThreads = perfOpts->batchThreads;
+		if (nThreads > PerfJobListSize(&batch.jobs)) {
+			nThreads = PerfJobListSize(&batch.jobs);
+		}
+		if (nThreads > 1) {
+			Thread* threads = calloc(nThreads, sizeof(*threads));
+			unsigned i;
+			for (i = 0; i < nThreads; ++i) {
+				ThreadCreate(&threads[i], _mPerfBatchWorker, &batch);
+			}
+			for (i = 0; i < nThreads; ++i) {
+				ThreadJoin(threads[i]);
+			}
+			free(threads);
+		} else
+#endif
+		{
+			_mPerfBatchRunJobs(&batch);
+		}
+		success = !batch.failed;
+	}
+
+	_mPerfBatchDeinit(&batch);
+	return success;
+}
+
+struct PerfFrameStats {
+	double mean;
+	double stddev;
+	uint64_t min;
+	uint64_t median;
+	uint64_t p95;
+	uint64_t p99;
+	uint64_t max;
+};
+
+static uint64_t _mPerfNow(void) {
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return 1000000LL * tv.tv_sec + tv.tv_usec;
+}
+
+static int _mPerfCompareTimes(const void* a, const void* b) {
+	uint64_t x = *(const uint64_t*) a;
+	uint64_t y = *(const uint64_t*) b;
+	return (x > y) - (x < y);
+}
+
+static uint64_t _mPerfPercentile(const uint64_t* sorted, size_t n, unsigned percentile) {
+	// Nearest rank, so every figure reported is a frame time that was actually measured
+	size_t rank = (n * percentile + 99) / 100;
+	if (rank) {
+		--rank;
+	}
+	return sorted[rank];
+}
+
+static void _mPerfFrameStats(uint64_t* times, size_t n, struct PerfFrameStats* stats) {
+	qsort(times, n, sizeof(*times), _mPerfCompareTimes);
+	double sum = 0;
+	size_t i;
+	for (i = 0; i < n; ++i) {
+		sum += times[i];
+	}
+	stats->mean = sum / n;
+	double variance = 0;
+	for (i = 0; i < n; ++i) {
+		double diff = times[i] - stats->mean;
+		variance += diff * diff;
+	}
+	stats->stddev = n > 1 ? sqrt(variance / (n - 1)) : 0;
+	stats->min = times[0];
+	stats->median = _mPerfPercentile(times, n, 50);
+	stats->p95 = _mPerfPercentile(times, n, 95);
+	stats->p99 = _mPerfPercentile(times, n, 99);
+	stats->max = times[n - 1];
+}
+
+static void _mPerfPrintJSONString(const char* string) {
+	if (!string) {
+		printf("null");
+		return;
+	}
+	putchar('"');
+	for (; *string; ++string) {
+		unsigned char c = *string;
+		if (c == '"' || c == '\\') {
+			printf("\\%c", c);
+		} else if (c < 0x20) {
+			printf("\\u%04x", c);
+		} else {
+			putchar(c);
+		}
+	}
+	putchar('"');
+}
+
+static bool _mPerfBenchmarkScene(struct PerfBatch* batch, const struct PerfJob* job, const struct PerfROM* rom, void* outputBuffer, bool first) {
+	const struct PerfOpts* perfOpts = batch->perfOpts;
+	int frames = job->frames;
+	if (!frames) {
+		frames = perfOpts->frames;
+	}
+	if (!frames) {
+		frames = perfOpts->duration * 60;
+	}
+	if (!frames) {
+		return false;
+	}
+
+	struct VFile* vf = _mPerfBatchOpenROM(batch, rom);
+	if (!vf) {
+		return false;
+	}
+	// Every scene gets a fresh core so that nothing carries over from the scene before it
+	struct mCore* core = mCoreFindVF(vf);
+	if (!core) {
+		vf->close(vf);
+		return false;
+	}
+	core->init(core);
+	if (!perfOpts->noVideo) {
+		core->setVideoBuffer(core, outputBuffer, 256);
+	}
+	struct mCoreOptions opts = {};
+	_mPerfConfigureCore(core, batch->args, perfOpts, &opts);
+
+	bool success = core->loadROM(core, vf);
+	if (!success) {
+		vf->close(vf);
+	} else {
+		mCoreLoadConfig(core);
+		core->reset(core);
+		core->setKeys(core, 0);
+	}
+	if (success && job->savestate) {
+		struct VFile* state = VFileOpen(job->savestate, O_RDONLY);
+		success = state && mCoreLoadStateNamed(core, state, 0);
+		if (state) {
+			state->close(state);
+		}
+	}
+	if (!success) {
+		mCoreConfigFreeOpts(&opts);
+		mCoreConfigDeinit(&core->config);
+		core->deinit(core);
+		return false;
+	}
+
+	char gameCode[9] = { 0 };
+	core->getGameCode(core, gameCode);
+
+	// Each repetition restarts from the same snapshot, save data included, so that they all emulate the same frames
+	int flags = SAVESTATE_SAVEDATA | SAVESTATE_RTC;
+	size_t stateSize = mCoreSaveStateBuffer(core, NULL, 0, flags);
+	void* state = anonymousMemoryMap(stateSize);
+	mCoreSaveStateBuffer(core, state, stateSize, flags);
+
+	if (perfOpts->warmup) {
+		int warmup = perfOpts->warmup;
+		_mPerfRunloop(core, &warmup, true, NULL, 0, NULL);
+	}
+
+	unsigned repetitions = perfOpts->repetitions;
+	uint64_t* times = malloc(sizeof(*times) * frames * repetitions);
+	uint64_t* durations = malloc(sizeof(*durations) * repetitions);
+#ifdef ENABLE_PERF_COUNTERS
+	struct mPerfCounters* counters = malloc(sizeof(*counters));
+	core->setPerfCounters(core, counters);
+	uint64_t instructions = 0;
+#endif
+	unsigned r;
+	for (r = 0; r < repetitions; ++r) {
+		mCoreLoadStateBuffer(core, state, stateSize, flags);
+#ifdef ENABLE_PERF_COUNTERS
+		mPerfCountersReset(counters);
+#endif
+		uint64_t start = _mPerfNow();
+		uint64_t last = start;
+		int f;
+		for (f = 0; f < frames && !_dispatchExiting; ++f) {
+			core->runFrame(core);
+			uint64_t now = _mPerfNow();
+			times[r * frames + f] = now - last;
+			last = now;
+		}
+		if (f < frames) {
+			break;
+		}
+		durations[r] = last - start;
+#ifdef ENABLE_PERF_COUNTERS
+		instructions += counters->instructions[0] + counters->instructions[1];
+#endif
+	}
+#ifdef ENABLE_PERF_COUNTERS
+	core->setPerfCounters(core, NULL);
+	free(counters);
+#endif
+	uint32_t frameCycles = core->frameCycles(core);
+	mappedMemoryFree(state, stateSize);
+	mCoreConfigFreeOpts(&opts);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+
+	// An interrupted scene is left out rather than reported with fewer repetitions than asked for
+	success = r == repetitions;
+	if (success) {
+		struct PerfFrameStats stats;
+		_mPerfFrameStats(times, (size_t) frames * repetitions, &stats);
+		uint64_t total = 0;
+		for (r = 0; r < repetitions; ++r) {
+			total += durations[r];
+		}
+		double seconds = total ? total / 1000000. : 1.;
+
+		printf("%s\n\t\t{\n\t\t\t\"job\": %" PRIz "u,\n\t\t\t\"rom\": ", first ? "" : ",", job->id);
+		_mPerfPrintJSONString(rom->path);
+		printf(",\n\t\t\t\"savestate\": ");
+		_mPerfPrintJSONString(job->savestate);
+		printf(",\n\t\t\t\"game_code\": ");
+		_mPerfPrintJSONString(gameCode);
+		printf(",\n\t\t\t\"frames\": %i,\n", frames);
+		printf("\t\t\t\"frame_time_us\": { \"mean\": %.3f, \"stddev\": %.3f, \"min\": %" PRIu64 ", \"median\": %" PRIu64
+		       ", \"p95\": %" PRIu64 ", \"p99\": %" PRIu64 ", \"max\": %" PRIu64 " },\n",
+		       stats.mean, stats.stddev, stats.min, stats.median, stats.p95, stats.p99, stats.max);
+		printf("\t\t\t\"repetition_fps\": [");
+		for (r = 0; r < repetitions; ++r) {
+			printf("%s%.3f", r ? ", " : " ", durations[r] ? frames * 1000000. / durations[r] : 0.);
+		}
+		printf(" ],\n");
+		printf("\t\t\t\"fps\": %.3f,\n", (double) frames * repetitions / seconds);
+#ifdef ENABLE_PERF_COUNTERS
+		printf("\t\t\t\"instructions_per_second\": %.0f,\n", instructions / seconds);
+#endif
+		printf("\t\t\t\"cycles_per_second\": %.0f\n\t\t}", (double) frameCycles * frames * repetitions / seconds);
+		fflush(stdout);
+	}
+	free(durations);
+	free(times);
+	return success;
+}
+
+static bool _mPerfRunBenchmark(const char* pack, const struct mArguments* args, const struct PerfOpts* perfOpts) {
+	struct PerfBatch batch;
+	_mPerfBatchInit(&batch, args, perfOpts);
+
+	bool success = _mPerfBatchLoad(&batch, pack);
+	if (success) {
+		// Scenes always run one at a time, since concurrent ones would skew each other's timings
+		void* outputBuffer = calloc(256 * 256, 4);
+		printf("{\n\t\"version\": ");
+		_mPerfPrintJSONString(projectVersion);
+		printf(",\n\t\"commit\": ");
+		_mPerfPrintJSONString(gitCommit);
+		printf(",\n\t\"renderer\": \"%s\",\n\t\"warmup\": %u,\n\t\"repetitions\": %u,\n\t\"scenes\": [",
+		       _mPerfRendererName(perfOpts), perfOpts->warmup, perfOpts->repetitions);
+		bool first = true;
+		size_t i;
+		for (i = 0; i < PerfJobListSize(&batch.jobs) && !_dispatchExiting; ++i) {
+			const struct PerfJob* job = PerfJobListGetConstPointer(&batch.jobs, i);
+			const struct PerfROM* rom = PerfROMListGetConstPointer(&batch.roms, job->rom);
+			if (_mPerfBenchmarkScene(&batch, job, rom, outputBuffer, first)) {
+				first = false;
+			} else {
+				fprintf(stderr, "Scene %" PRIz "u failed\n", job->id);
+				success = false;
+			}
+		}
+		printf("\n\t]\n}\n");
+		free(outputBuffer);
+	}
+
+	_mPerfBatchDeinit(&batch);
+	return success;
+}
+
+#ifndef DISABLE_THREADING
+static bool _mPerfServerParseInputs(char* script, struct PerfJob* job) {
+	size_t capacity = 0;
+	char* next = script;
+	while (next && *next) {
+		char* entry = next;
+		next = strchr(entry, ',');
+		if (next) {
+			*next = '\0';
+			++next;
+		}
+		char* end;
+		errno = 0;
+		unsigned long frame = strtoul(entry, &end, 10);
+		if (errno || end == entry || *end != ':') {
+			return false;
+		}
+		entry = end + 1;
+		unsigned long keys = strtoul(entry, &end, 16);
+		if (errno || end == entry || *end) {
+			return false;
+		}
+		if (job->nInputs && frame < job->inputs[job->nInputs - 1].frame) {
+			return false;
+		}
+		if (job->nInputs == capacity) {
+			capacity = capacity ? capacity * 2 : 16;
+			job->inputs = realloc(job->inputs, capacity * sizeof(*job->inputs));
+		}
+		job->inputs[job->nInputs].frame = frame;
+		job->inputs[job->nInputs].keys = keys;
+		++job->nInputs;
+	}
+	return true;
+}
+
+static void _mPerfServerSubmit(struct PerfBatch* batch, struct PerfClient* client, char* line) {
+	struct PerfJob job = {
+		.client = client,
+		.id = client->nextJob
+	};
+	++client->nextJob;
+
+	char* fields[4] = { line, NULL, NULL, NULL };
+	size_t i;
+	for (i = 1; i < 4; ++i) {
+		fields[i] = strchr(fields[i - 1], '\t');
+		if (!fields[i]) {
+			break;
+		}
+		*fields[i] = '\0';
+		++fields[i];
+	}
+
+	const char* status = NULL;
+	if (strncmp(fields[0], "crc32:", 6) == 0) {
+		// Any ROM another job has already loaded can be requested by checksum alone
+		char* end;
+		uint32_t crc32 = strtoul(&fields[0][6], &end, 16);
+		status = "unknown-rom";
+		MutexLock(&batch->mutex);
+		for (i = 0; !*end && i < PerfROMListSize(&batch->roms); ++i) {
+			const struct PerfROM* rom = PerfROMListGetConstPointer(&batch->roms, i);
+			if (rom->shared && rom->crc32 == crc32) {
+				job.rom = i;
+				status = NULL;
+				break;
+			}
+		}
+		MutexUnlock(&batch->mutex);
+	} else if (!_mPerfBatchAddROM(batch, fields[0], &job.rom)) {
+		status = "bad-rom";
+	}
+	if (!status && fields[1] && fields[1][0]) {
+		job.savestate = strdup(fields[1]);
+	}
+	if (!status && fields[2] && fields[2][0]) {
+		char* end;
+		errno = 0;
+		job.frames = strtoul(fields[2], &end, 10);
+		if (errno || *end) {
+			status = "bad-request";
+		}
+	}
+	if (!status && !job.frames && !batch->perfOpts->frames && !batch->perfOpts->duration) {
+		status = "bad-request";
+	}
+	if (!status && fields[3] && !_mPerfServerParseInputs(fields[3], &job)) {
+		status = "bad-request";
+	}
+	if (status) {
+		_mPerfServerReportError(batch, &job, status);
+		free(job.savestate);
+		free(job.inputs);
+		return;
+	}
+
+	MutexLock(&batch->mutex);
+	++client->refs;
+	*PerfJobListAppend(&batch->jobs) = job;
+	ConditionWake(&batch->jobAvailable);
+	MutexUnlock(&batch->mutex);
+}
+
+static bool _mPerfServerRead(struct PerfBatch* batch, struct PerfClient* client) {
+	ssize_t received = SocketRecv(client->socket, &client->buffer[client->fill], sizeof(client->buffer) - client->fill);
+	if (received <= 0) {
+		return false;
+	}
+	client->fill += received;
+	char* line = client->buffer;
+	char* end = &client->buffer[client->fill];
+	char* nl;
+	while ((nl = memchr(line, '\n', end - line))) {
+		*nl = '\0';
+		if (nl > line && nl[-1] == '\r') {
+			nl[-1] = '\0';
+		}
+		// An empty line ends the session, as it does for the single-core server
+		if (!line[0]) {
+			return false;
+		}
+		_mPerfServerSubmit(batch, client, line);
+		line = nl + 1;
+	}
+	client->fill = end - line;
+	if (client->fill == sizeof(client->buffer)) {
+		return false;
+	}
+	memmove(client->buffer, line, client->fill);
+	return true;
+}
+
+static void _mPerfServerDisconnect(struct PerfBatch* batch, struct PerfClientList* clients, size_t index) {
+	struct PerfClient* client = *PerfClientListGetPointer(clients, index);
+	PerfClientListShift(clients, index, 1);
+	MutexLock(&batch->mutex);
+	client->closed = true;
+	_mPerfClientUnref(client);
+	MutexUnlock(&batch->mutex);
+}
+
+static void _mPerfServeMetrics(struct PerfBatch* batch, Socket server) {
+	Socket socket = SocketAccept(server, NULL);
+	if (SOCKET_FAILED(socket)) {
+		return;
+	}
+	// Whatever was asked for, the answer is the same. The request only has to be read so that
+	// closing the socket doesn't reset the connection before the client sees the response.
+	char request[0x400];
+	Socket reads[1] = { socket };
+	if (SocketPoll(1, reads, NULL, NULL, 100) > 0) {
+		SocketRecv(socket, request, sizeof(request));
+	}
+
+	char body[0x1000];
+	MutexLock(&batch->mutex);
+	size_t length = mCoreMetricsFormatPrometheus(&batch->metrics, NULL, body, sizeof(body));
+	MutexUnlock(&batch->mutex);
+	if (length >= sizeof(body)) {
+		length = sizeof(body) - 1;
+	}
+	char header[128];
+	snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %" PRIz "u\r\n\r\n", length);
+	SocketSend(socket, header, strlen(header));
+	SocketSend(socket, body, length);
+	SocketClose(socket);
+}
+
+static bool _mPerfRunPoolServer(const struct mArguments* args, const struct PerfOpts* perfOpts) {
+	SocketSubsystemInit();
+	Socket server = SocketOpenTCP(PERF_SERVER_PORT, NULL);
+	if (SOCKET_FAILED(server)) {
+		SocketSubsystemDeinit();
+		return false;
+	}
+	if (SOCKET_FAILED(SocketListen(server, PERF_SERVER_MAX_CLIENTS))) {
+		SocketClose(server);
+		SocketSubsystemDeinit();
+		return false;
+	}
+	Socket metricsServer = INVALID_SOCKET;
+	if (perfOpts->metricsPort) {
+		metricsServer = SocketOpenTCP(perfOpts->metricsPort, NULL);
+		if (SOCKET_FAILED(metricsServer) || SOCKET_FAILED(SocketListen(metricsServer, PERF_SERVER_MAX_CLIENTS))) {
+			if (!SOCKET_FAILED(metricsServer)) {
+				SocketClose(metricsServer);
+			}
+			SocketClose(server);
+			SocketSubsystemDeinit();
+			return false;
+		}
+	}
+#ifdef SIGPIPE
+	// Clients can hang up while a worker is still sending them results
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	struct PerfBatch batch;
+	_mPerfBatchInit(&batch, args, perfOpts);
+	batch.serving = true;
+	unsigned nThreads = perfOpts->batchThreads;
+	Thread* threads = calloc(nThreads, sizeof(*threads));
+	unsigned i;
+	for (i = 0; i < nThreads; ++i) {
+		ThreadCreate(&threads[i], _mPerfBatchWorker, &batch);
+	}
+
+	struct PerfClientList clients;
+	PerfClientListInit(&clients, 0);
+	bool success = true;
+	while (!_dispatchExiting) {
+		Socket reads[PERF_SERVER_MAX_CLIENTS + 2];
+		size_t nSockets = 0;
+		reads[nSockets] = server;
+		++nSockets;
+		if (!SOCKET_FAILED(metricsServer)) {
+			reads[nSockets] = metricsServer;
+			++nSockets;
+		}
+		size_t c;
+		for (c = 0; c < PerfClientListSize(&clients); ++c, ++nSockets) {
+			reads[nSockets] = (*PerfClientListGetPointer(&clients, c))->socket;
+		}
+		if (SocketPoll(nSockets, reads, NULL, NULL, 1000) < 0) {
+			success = _dispatchExiting;
+			break;
+		}
+		size_t r;
+		for (r = 0; r < nSockets && !SOCKET_FAILED(reads[r]); ++r) {
+			if (reads[r] == metricsServer) {
+				_mPerfServeMetrics(&batch, metricsServer);
+				continue;
+			}
+			if (reads[r] == server) {
+				Socket socket = SocketAccept(server, NULL);
+				if (SOCKET_FAILED(socket)) {
+					continue;
+				}
+				if (PerfClientListSize(&clients) == PERF_SERVER_MAX_CLIENTS) {
+					SocketClose(socket);
+					continue;
+				}
+				struct PerfClient* client = calloc(1, sizeof(*client));
+				client->socket = socket;
+				client->refs = 1;
+				*PerfClientListAppend(&clients) = client;
+				const char* header = PERF_SERVER_CSV_HEADER "\n";
+				SocketSend(socket, header, strlen(header));
+				continue;
+			}
+			for (c = 0; c < PerfClientListSize(&clients); ++c) {
+				struct PerfClient* client = *PerfClientListGetPointer(&clients, c);
+				if (client->socket != reads[r]) {
+					continue;
+				}
+				if (!_mPerfServerRead(&batch, client)) {
+					_mPerfServerDisconnect(&batch, &clients, c);
+				}
+				break;
+			}
+		}
+	}
+
+	while (PerfClientListSize(&clients)) {
+		_mPerfServerDisconnect(&batch, &clients, 0);
+	}
+	PerfClientListDeinit(&clients);
+
+	// Drop whatever is still queued; jobs already running stop on their own once exiting
+	MutexLock(&batch.mutex);
+	size_t j;
+	for (j = batch.nextJob; j < PerfJobListSize(&batch.jobs); ++j) {
+		struct PerfJob* job = PerfJobListGetPointer(&batch.jobs, j);
+		_mPerfClientUnref(job->client);
+		free(job->savestate);
+		free(job->inputs);
+		job->savestate = NULL;
+		job->inputs = NULL;
+	}
+	PerfJobListClear(&batch.jobs);
+	batch.nextJob = 0;
+	batch.serving = false;
+	ConditionWake(&batch.jobAvailable);
+	MutexUnlock(&batch.mutex);
+	for (i = 0; i < nThreads; ++i) {
+		ThreadJoin(threads[i]);
+	}
+	free(threads);
+
+	_mPerfBatchDeinit(&batch);
+	if (!SOCKET_FAILED(metricsServer)) {
+		SocketClose(metricsServer);
+	}
+	SocketClose(server);
+	SocketSubsystemDeinit();
+	return success;
+}
+#endif
+
 static void _mPerfShutdown(int signal) {
 	UNUSED(signal);
 	_dispatchExiting = true;
@@ -316,18 +1486,42 @@ static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* ar
 	struct PerfOpts* opts = parser->opts;
 	errno = 0;
 	switch (option) {
+	case 'A':
+		opts->noAudio = true;
+		return true;
+	case 'B':
+		opts->batch = strdup(arg);
+		return true;
 	case 'D':
 		opts->server = true;
 		return true;
 	case 'F':
 		opts->frames = strtoul(arg, 0, 10);
 		return !errno;
+	case 'E':
+		opts->trace = strdup(arg);
+		return true;
+	case 'H':
+		opts->counters = strdup(arg);
+		return true;
+	case 'I':
+		opts->repetitions = strtoul(arg, 0, 10);
+		return !errno && opts->repetitions;
+	case 'J':
+		opts->batchThreads = strtoul(arg, 0, 10);
+		return !errno;
+	case 'M':
+		opts->metricsPort = strtoul(arg, 0, 10);
+		return !errno && opts->metricsPort && opts->metricsPort < 0x10000;
 	case 'N':
 		opts->noVideo = true;
 		return true;
 	case 'P':
 		opts->csv = true;
 		return true;
+	case 'R':
+		opts->scenes = strdup(arg);
+		return true;
 	case 'S':
 		opts->duration = strtoul(arg, 0, 10);
 		return !errno;
@@ -337,6 +1531,9 @@ static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* ar
 	case 'L':
 		opts->savestate = strdup(arg);
 		return true;
+	case 'W':
+		opts->warmup = strtoul(arg, 0, 10);
+		return !errno;
 	default:
 		return false;
 	}
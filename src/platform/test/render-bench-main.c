@@ -0,0 +1,555 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba/feature/commandline.h>
+#include <mgba/feature/video-logger.h>
+#include <mgba/gba/interface.h>
+
+#include <mgba-util/string.h>
+#include <mgba-util/vector.h>
+#include <mgba-util/vfs.h>
+
+#ifdef USE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#ifdef USE_EPOXY
+#include <epoxy/gl.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#endif
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <sys/time.h>
+
+#define BENCH_OPTIONS "B:F:PR:T:VW:"
+#define BENCH_USAGE \
+	"\nBenchmark options:\n" \
+	"  -F FRAMES        Time FRAMES frames of each log [default: 600]\n" \
+	"  -W FRAMES        Play FRAMES untimed frames first [default: 10]\n" \
+	"  -R RENDERERS     Comma-separated list of renderers to run\n" \
+	"                   Any of software, parallel, gl [default: all available]\n" \
+	"  -T THREADS       Use THREADS threads for the parallel renderer [default: 4]\n" \
+	"  -P               CSV output, useful for parsing\n" \
+	"  -B FILE          Run every video log listed in FILE, one path per line\n" \
+	"  -V               Check every frame of the other renderers against the software renderer"
+
+#define BENCH_CSV_HEADER "log,renderer,frames,duration,min,mean,p50,p90,p99,max,fps"
+#define BENCH_COMPARE_CSV_HEADER ",frames_differing,worst_frame,worst_pixels"
+
+enum BenchRenderer {
+	BENCH_RENDERER_SOFTWARE = 0,
+	BENCH_RENDERER_PARALLEL,
+	BENCH_RENDERER_GL,
+	BENCH_RENDERER_MAX
+};
+
+struct BenchOpts {
+	unsigned frames;
+	unsigned warmup;
+	unsigned threads;
+	bool renderers[BENCH_RENDERER_MAX];
+	bool csv;
+	bool compare;
+	char* batch;
+};
+
+struct BenchResult {
+	unsigned frames;
+	uint64_t duration;
+	uint32_t min;
+	uint32_t p50;
+	uint32_t p90;
+	uint32_t p99;
+	uint32_t max;
+	// Only filled in with -V, for the renderers other than software
+	unsigned framesDiffering;
+	unsigned worstFrame;
+	unsigned worstPixels;
+};
+
+// Every frame the software renderer drew for a log, reduced to 15-bit color like the GBA's own
+// output, so that renderers that expand colors differently still compare equal
+struct BenchReference {
+	uint16_t* frames;
+	unsigned nFrames;
+};
+
+DECLARE_VECTOR(BenchLogList, char*);
+DEFINE_VECTOR(BenchLogList, char*);
+
+static const char* const _rendererNames[BENCH_RENDERER_MAX] = {
+	[BENCH_RENDERER_SOFTWARE] = "software",
+	[BENCH_RENDERER_PARALLEL] = "parallel",
+	[BENCH_RENDERER_GL] = "gl",
+};
+
+static bool _parseBenchOpts(struct mSubParser* parser, int option, const char* arg);
+static bool _parseRenderers(struct BenchOpts* benchOpts, const char* arg);
+static bool _parseUInt(const char* arg, unsigned* out);
+static bool _loadManifest(const char* manifest, struct BenchLogList* logs);
+static bool _benchLog(const char* fname, enum BenchRenderer, const struct mArguments*, const struct BenchOpts*, struct BenchReference*, struct BenchResult*);
+static unsigned _compareFrame(const void* pixels, size_t stride, uint16_t* reference, bool record);
+static bool _rendererAvailable(struct mCore* core, enum BenchRenderer);
+static void _computeResult(uint32_t* times, unsigned frames, struct BenchResult*);
+static void _printResult(const char* fname, enum BenchRenderer, const struct BenchResult*, const struct BenchOpts*);
+static void _log(struct mLogger*, int, enum mLogLevel, const char*, va_list);
+static uint64_t _now(void);
+#ifdef USE_EGL
+static bool _initGL(void);
+static void _deinitGL(void);
+
+static EGLDisplay _display = EGL_NO_DISPLAY;
+static EGLContext _context = EGL_NO_CONTEXT;
+#endif
+
+static void* _outputBuffer = NULL;
+
+int main(int argc, char** argv) {
+	int didFail = 0;
+
+	struct mLogger logger = { .log = _log };
+	mLogSetDefaultLogger(&logger);
+
+	struct BenchOpts benchOpts = {
+		.frames = 600,
+		.warmup = 10,
+		.threads = 4,
+		.renderers = { true, true, true }
+	};
+	struct mSubParser subparser = {
+		.usage = BENCH_USAGE,
+		.parse = _parseBenchOpts,
+		.extraOptions = BENCH_OPTIONS,
+		.opts = &benchOpts
+	};
+
+	struct mArguments args = {};
+	bool parsed = parseArguments(&args, argc, argv, &subparser);
+	if (!args.fname && !benchOpts.batch) {
+		parsed = false;
+	}
+	if (!parsed || args.showHelp) {
+		usage(argv[0], BENCH_USAGE);
+		didFail = !parsed;
+		goto cleanup;
+	}
+
+	if (args.showVersion) {
+		version(argv[0]);
+		goto cleanup;
+	}
+
+	struct BenchLogList logs;
+	BenchLogListInit(&logs, 0);
+	if (args.fname) {
+		*BenchLogListAppend(&logs) = strdup(args.fname);
+	}
+	if (benchOpts.batch && !_loadManifest(benchOpts.batch, &logs)) {
+		didFail = 1;
+	}
+
+#ifdef USE_EGL
+	if (benchOpts.renderers[BENCH_RENDERER_GL] && !_initGL()) {
+		fprintf(stderr, "Could not create an OpenGL context, skipping gl renderer\n");
+		benchOpts.renderers[BENCH_RENDERER_GL] = false;
+	}
+#else
+	benchOpts.renderers[BENCH_RENDERER_GL] = false;
+#endif
+
+	if (benchOpts.compare) {
+		benchOpts.renderers[BENCH_RENDERER_SOFTWARE] = true;
+	}
+
+	_outputBuffer = malloc(256 * 256 * 4);
+	if (benchOpts.csv) {
+		puts(benchOpts.compare ? BENCH_CSV_HEADER BENCH_COMPARE_CSV_HEADER : BENCH_CSV_HEADER);
+	}
+	struct BenchReference reference = {
+		.frames = benchOpts.compare ? malloc((benchOpts.frames + benchOpts.warmup) * GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * sizeof(uint16_t)) : NULL
+	};
+	size_t i;
+	for (i = 0; i < BenchLogListSize(&logs); ++i) {
+		const char* fname = *BenchLogListGetPointer(&logs, i);
+		enum BenchRenderer renderer;
+		for (renderer = 0; renderer < BENCH_RENDERER_MAX; ++renderer) {
+			if (!benchOpts.renderers[renderer]) {
+				continue;
+			}
+			struct BenchResult result;
+			if (!_benchLog(fname, renderer, &args, &benchOpts, &reference, &result)) {
+				didFail = 1;
+				break;
+			}
+			if (result.frames) {
+				_printResult(fname, renderer, &result, &benchOpts);
+			}
+			if (renderer != BENCH_RENDERER_SOFTWARE && result.framesDiffering) {
+				didFail = 1;
+			}
+		}
+		free(*BenchLogListGetPointer(&logs, i));
+	}
+	BenchLogListDeinit(&logs);
+	free(reference.frames);
+	free(_outputBuffer);
+
+#ifdef USE_EGL
+	_deinitGL();
+#endif
+	free(benchOpts.batch);
+
+	cleanup:
+	freeArguments(&args);
+
+	return didFail;
+}
+
+static bool _benchLog(const char* fname, enum BenchRenderer renderer, const struct mArguments* args, const struct BenchOpts* benchOpts, struct BenchReference* reference, struct BenchResult* result) {
+	memset(result, 0, sizeof(*result));
+	struct VFile* vf = VFileOpen(fname, O_RDONLY);
+	if (!vf) {
+		fprintf(stderr, "Could not open %s: %s\n", fname, strerror(errno));
+		return false;
+	}
+	struct mCore* core = mVideoLogCoreFind(vf);
+	if (!core) {
+		fprintf(stderr, "%s is not a video log\n", fname);
+		vf->close(vf);
+		return false;
+	}
+	core->init(core);
+	if (!_rendererAvailable(core, renderer)) {
+		// Not every platform has every renderer, e.g. there is no parallel GB renderer
+		core->deinit(core);
+		vf->close(vf);
+		return true;
+	}
+
+	core->setVideoBuffer(core, _outputBuffer, 256);
+#ifdef USE_EGL
+	GLuint tex = 0;
+	if (renderer == BENCH_RENDERER_GL) {
+		glGenTextures(1, &tex);
+		core->setVideoGLTex(core, tex);
+	}
+#endif
+	if (!core->loadROM(core, vf)) {
+		fprintf(stderr, "Could not load %s\n", fname);
+		core->deinit(core);
+		vf->close(vf);
+		return false;
+	}
+
+	struct mCoreOptions opts = {};
+	mCoreConfigInit(&core->config, "render-bench");
+	mCoreConfigSetOverrideIntValue(&core->config, "threadedVideo", 0);
+	mCoreConfigSetOverrideIntValue(&core->config, "videoThreads", renderer == BENCH_RENDERER_PARALLEL ? benchOpts->threads : 1);
+	mCoreConfigSetOverrideIntValue(&core->config, "hwaccelVideo", renderer == BENCH_RENDERER_GL);
+	mCoreConfigMap(&core->config, &opts);
+	opts.audioSync = false;
+	opts.videoSync = false;
+	applyArguments(args, NULL, &core->config);
+	mCoreConfigLoadDefaults(&core->config, &opts);
+	mCoreLoadConfig(core);
+	core->reset(core);
+
+	const void* pixels;
+	size_t stride;
+	unsigned i;
+	// The software renderer runs first, so its frames are there to compare the others against
+	bool record = renderer == BENCH_RENDERER_SOFTWARE;
+	bool compare = benchOpts->compare && (record || reference->nFrames) && core->platform(core) == PLATFORM_GBA;
+	if (record) {
+		reference->nFrames = 0;
+	}
+	unsigned frame = 0;
+	for (i = 0; i < benchOpts->warmup; ++i, ++frame) {
+		core->runFrame(core);
+		core->getPixels(core, &pixels, &stride);
+		if (compare) {
+			_compareFrame(pixels, stride, &reference->frames[frame * GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS], record);
+		}
+	}
+
+	// Each frame is timed through getPixels so that deferred work, like the GL
+	// readback or the parallel renderer's final join, is counted where it lands
+	uint32_t* times = malloc(sizeof(*times) * benchOpts->frames);
+	uint64_t start = _now();
+	uint64_t last = start;
+	uint64_t compareTime = 0;
+	for (i = 0; i < benchOpts->frames; ++i, ++frame) {
+		core->runFrame(core);
+		core->getPixels(core, &pixels, &stride);
+		uint64_t now = _now();
+		times[i] = now - last;
+		last = now;
+		if (compare) {
+			unsigned differing = _compareFrame(pixels, stride, &reference->frames[frame * GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS], record);
+			if (differing) {
+				++result->framesDiffering;
+			}
+			if (differing > result->worstPixels) {
+				result->worstPixels = differing;
+				result->worstFrame = i;
+			}
+			// Checking isn't part of what's being timed
+			now = _now();
+			compareTime += now - last;
+			last = now;
+		}
+	}
+	if (record && compare) {
+		reference->nFrames = frame;
+	}
+	_computeResult(times, benchOpts->frames, result);
+	result->duration = last - start - compareTime;
+	free(times);
+
+	mCoreConfigFreeOpts(&opts);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	vf->close(vf);
+#ifdef USE_EGL
+	if (tex) {
+		glDeleteTextures(1, &tex);
+	}
+#endif
+	return true;
+}
+
+// Compares a frame against the reference, or stores it there if record is set, returning the
+// number of pixels that differ. Upscaled output is compared at the top-left of each scaled pixel.
+static unsigned _compareFrame(const void* pixels, size_t stride, uint16_t* reference, bool record) {
+	// Upscaled renderers return tightly packed rows, while the software renderer's are padded
+	unsigned scale = stride / GBA_VIDEO_HORIZONTAL_PIXELS;
+	unsigned differing = 0;
+	unsigned x, y;
+	for (y = 0; y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+		const uint32_t* row = &((const uint32_t*) pixels)[stride * y * scale];
+		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
+			uint32_t color = row[x * scale];
+			uint16_t color15 = ((color >> 3) & 0x1F) | ((color >> 6) & 0x3E0) | ((color >> 9) & 0x7C00);
+			if (record) {
+				reference[y * GBA_VIDEO_HORIZONTAL_PIXELS + x] = color15;
+			} else if (reference[y * GBA_VIDEO_HORIZONTAL_PIXELS + x] != color15) {
+				++differing;
+			}
+		}
+	}
+	return differing;
+}
+
+static bool _rendererAvailable(struct mCore* core, enum BenchRenderer renderer) {
+	switch (renderer) {
+	case BENCH_RENDERER_SOFTWARE:
+		return true;
+	case BENCH_RENDERER_PARALLEL:
+#if defined(M_CORE_GBA) && !defined(DISABLE_THREADING)
+		return core->platform(core) == PLATFORM_GBA;
+#else
+		return false;
+#endif
+	case BENCH_RENDERER_GL:
+#ifdef USE_EGL
+		return _context != EGL_NO_CONTEXT;
+#else
+		return false;
+#endif
+	default:
+		return false;
+	}
+}
+
+static int _compareTimes(const void* a, const void* b) {
+	uint32_t ta = *(const uint32_t*) a;
+	uint32_t tb = *(const uint32_t*) b;
+	return (ta > tb) - (ta < tb);
+}
+
+static void _computeResult(uint32_t* times, unsigned frames, struct BenchResult* result) {
+	result->frames = frames;
+	if (!frames) {
+		return;
+	}
+	qsort(times, frames, sizeof(*times), _compareTimes);
+	result->min = times[0];
+	result->p50 = times[frames / 2];
+	result->p90 = times[frames * 9 / 10];
+	result->p99 = times[frames * 99 / 100];
+	result->max = times[frames - 1];
+}
+
+static void _printResult(const char* fname, enum BenchRenderer renderer, const struct BenchResult* result, const struct BenchOpts* benchOpts) {
+	double mean = result->duration / (double) result->frames;
+	double fps = result->frames * 1000000. / result->duration;
+	if (benchOpts->csv) {
+		printf("%s,%s,%u,%" PRIu64 ",%" PRIu32 ",%.2f,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%.2f",
+		       fname, _rendererNames[renderer], result->frames, result->duration,
+		       result->min, mean, result->p50, result->p90, result->p99, result->max, fps);
+		if (benchOpts->compare) {
+			printf(",%u,%u,%u", result->framesDiffering, result->worstFrame, result->worstPixels);
+		}
+		printf("\n");
+	} else {
+		printf("%s [%s]: %u frames in %" PRIu64 " microseconds: %g fps\n", fname, _rendererNames[renderer], result->frames, result->duration, fps);
+		printf("  per frame (us): min %" PRIu32 ", mean %.1f, p50 %" PRIu32 ", p90 %" PRIu32 ", p99 %" PRIu32 ", max %" PRIu32 "\n",
+		       result->min, mean, result->p50, result->p90, result->p99, result->max);
+		if (benchOpts->compare && renderer != BENCH_RENDERER_SOFTWARE) {
+			if (result->framesDiffering) {
+				printf("  %u frames differ from software, worst is frame %u with %u pixels\n", result->framesDiffering, result->worstFrame, result->worstPixels);
+			} else {
+				printf("  every frame matches software\n");
+			}
+		}
+	}
+}
+
+static bool _loadManifest(const char* manifest, struct BenchLogList* logs) {
+	struct VFile* vf = VFileOpen(manifest, O_RDONLY);
+	if (!vf) {
+		fprintf(stderr, "Could not open manifest %s: %s\n", manifest, strerror(errno));
+		return false;
+	}
+	char line[PATH_MAX];
+	while (vf->readline(vf, line, sizeof(line)) > 0) {
+		char* end = strpbrk(line, "\r\n");
+		if (end) {
+			*end = '\0';
+		}
+		if (!line[0] || line[0] == '#') {
+			continue;
+		}
+		*BenchLogListAppend(logs) = strdup(line);
+	}
+	vf->close(vf);
+	return true;
+}
+
+static bool _parseRenderers(struct BenchOpts* benchOpts, const char* arg) {
+	memset(benchOpts->renderers, 0, sizeof(benchOpts->renderers));
+	while (*arg) {
+		size_t length = strcspn(arg, ",");
+		enum BenchRenderer renderer;
+		for (renderer = 0; renderer < BENCH_RENDERER_MAX; ++renderer) {
+			if (strlen(_rendererNames[renderer]) == length && !strncmp(arg, _rendererNames[renderer], length)) {
+				break;
+			}
+		}
+		if (renderer == BENCH_RENDERER_MAX) {
+			return false;
+		}
+		benchOpts->renderers[renderer] = true;
+		arg += length;
+		if (*arg) {
+			++arg;
+		}
+	}
+	return true;
+}
+
+static bool _parseUInt(const char* arg, unsigned* out) {
+	char* end;
+	errno = 0;
+	unsigned long value = strtoul(arg, &end, 10);
+	if (errno || *end || end == arg) {
+		return false;
+	}
+	*out = value;
+	return true;
+}
+
+static bool _parseBenchOpts(struct mSubParser* parser, int option, const char* arg) {
+	struct BenchOpts* opts = parser->opts;
+	switch (option) {
+	case 'B':
+		free(opts->batch);
+		opts->batch = strdup(arg);
+		return true;
+	case 'V':
+		opts->compare = true;
+		return true;
+	case 'F':
+		return _parseUInt(arg, &opts->frames);
+	case 'P':
+		opts->csv = true;
+		return true;
+	case 'R':
+		return _parseRenderers(opts, arg);
+	case 'T':
+		return _parseUInt(arg, &opts->threads) && opts->threads;
+	case 'W':
+		return _parseUInt(arg, &opts->warmup);
+	default:
+		return false;
+	}
+}
+
+#ifdef USE_EGL
+static bool _initGL(void) {
+	// A surfaceless context is enough since the renderers draw into their own framebuffers
+#ifdef EGL_MESA_platform_surfaceless
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay) {
+		_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+#endif
+	if (_display == EGL_NO_DISPLAY) {
+		_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	if (_display == EGL_NO_DISPLAY || !eglInitialize(_display, NULL, NULL)) {
+		_display = EGL_NO_DISPLAY;
+		return false;
+	}
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		_deinitGL();
+		return false;
+	}
+	static const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	_context = eglCreateContext(_display, NULL, EGL_NO_CONTEXT, contextAttributes);
+	if (_context == EGL_NO_CONTEXT || !eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, _context)) {
+		_deinitGL();
+		return false;
+	}
+	return true;
+}
+
+static void _deinitGL(void) {
+	if (_display == EGL_NO_DISPLAY) {
+		return;
+	}
+	eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (_context != EGL_NO_CONTEXT) {
+		eglDestroyContext(_display, _context);
+		_context = EGL_NO_CONTEXT;
+	}
+	eglTerminate(_display);
+	_display = EGL_NO_DISPLAY;
+}
+#endif
+
+static uint64_t _now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return 1000000LL * tv.tv_sec + tv.tv_usec;
+}
+
+static void _log(struct mLogger* log, int category, enum mLogLevel level, const char* format, va_list args) {
+	UNUSED(log);
+	UNUSED(category);
+	UNUSED(level);
+	UNUSED(format);
+	UNUSED(args);
+}
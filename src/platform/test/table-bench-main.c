@@ -0,0 +1,161 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba-util/table.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define TABLE_BENCH_OPTIONS "hn:r:"
+#define TABLE_BENCH_USAGE \
+	"usage: %s [options]\n" \
+	"Time Table and HashTable operations on address and symbol-like keys\n" \
+	"\nOptions:\n" \
+	"  -n ENTRIES       Fill each table with ENTRIES keys [default: 4096]\n" \
+	"  -r ROUNDS        Repeat each lookup pass ROUNDS times [default: 256]\n" \
+	"  -h               Print this usage and exit\n"
+
+#define KEY_LENGTH 24
+
+struct TableBenchResult {
+	uint64_t insert;
+	uint64_t hit;
+	uint64_t miss;
+	uint64_t remove;
+};
+
+static uint64_t _now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return 1000000LL * tv.tv_sec + tv.tv_usec;
+}
+
+static void _benchTable(size_t entries, unsigned rounds, struct TableBenchResult* result) {
+	struct Table table;
+	TableInit(&table, 0, NULL);
+	uintptr_t sink = 0;
+	size_t i;
+	unsigned r;
+
+	uint64_t start = _now();
+	for (i = 0; i < entries; ++i) {
+		TableInsert(&table, 0x08000000 + i * 4, (void*) (uintptr_t) (i + 1));
+	}
+	result->insert = _now() - start;
+
+	start = _now();
+	for (r = 0; r < rounds; ++r) {
+		for (i = 0; i < entries; ++i) {
+			sink += (uintptr_t) TableLookup(&table, 0x08000000 + i * 4);
+		}
+	}
+	result->hit = _now() - start;
+
+	start = _now();
+	for (r = 0; r < rounds; ++r) {
+		for (i = 0; i < entries; ++i) {
+			sink += (uintptr_t) TableLookup(&table, 0x08000002 + i * 4);
+		}
+	}
+	result->miss = _now() - start;
+
+	start = _now();
+	for (i = 0; i < entries; ++i) {
+		TableRemove(&table, 0x08000000 + i * 4);
+	}
+	result->remove = _now() - start;
+
+	TableDeinit(&table);
+	if (sink == 1) {
+		puts("");
+	}
+}
+
+static void _benchHashTable(size_t entries, unsigned rounds, struct TableBenchResult* result) {
+	char (*keys)[KEY_LENGTH] = malloc(entries * 2 * KEY_LENGTH);
+	size_t i;
+	unsigned r;
+	for (i = 0; i < entries * 2; ++i) {
+		snprintf(keys[i], KEY_LENGTH, "sym_%s_%08zX", (i & 1) ? "data" : "func", i * 0x1F);
+	}
+
+	struct Table table;
+	HashTableInit(&table, 0, NULL);
+	uintptr_t sink = 0;
+
+	uint64_t start = _now();
+	for (i = 0; i < entries; ++i) {
+		HashTableInsert(&table, keys[i * 2], keys[i * 2]);
+	}
+	result->insert = _now() - start;
+
+	start = _now();
+	for (r = 0; r < rounds; ++r) {
+		for (i = 0; i < entries; ++i) {
+			sink += (uintptr_t) HashTableLookup(&table, keys[i * 2]);
+		}
+	}
+	result->hit = _now() - start;
+
+	start = _now();
+	for (r = 0; r < rounds; ++r) {
+		for (i = 0; i < entries; ++i) {
+			sink += (uintptr_t) HashTableLookup(&table, keys[i * 2 + 1]);
+		}
+	}
+	result->miss = _now() - start;
+
+	start = _now();
+	for (i = 0; i < entries; ++i) {
+		HashTableRemove(&table, keys[i * 2]);
+	}
+	result->remove = _now() - start;
+
+	HashTableDeinit(&table);
+	free(keys);
+	if (sink == 1) {
+		puts("");
+	}
+}
+
+static void _printResult(const char* name, size_t entries, unsigned rounds, const struct TableBenchResult* result) {
+	double lookups = (double) entries * rounds;
+	printf("%-10s insert %7.2f ns  hit %7.2f ns  miss %7.2f ns  remove %7.2f ns\n", name,
+	       result->insert * 1000.0 / entries, result->hit * 1000.0 / lookups,
+	       result->miss * 1000.0 / lookups, result->remove * 1000.0 / entries);
+}
+
+int main(int argc, char** argv) {
+	size_t entries = 4096;
+	unsigned rounds = 256;
+	int ch;
+	while ((ch = getopt(argc, argv, TABLE_BENCH_OPTIONS)) != -1) {
+		switch (ch) {
+		case 'n':
+			entries = strtoul(optarg, 0, 10);
+			break;
+		case 'r':
+			rounds = strtoul(optarg, 0, 10);
+			break;
+		case 'h':
+		default:
+			fprintf(stderr, TABLE_BENCH_USAGE, argv[0]);
+			return ch == 'h' ? 0 : 1;
+		}
+	}
+	if (!entries || !rounds) {
+		fprintf(stderr, TABLE_BENCH_USAGE, argv[0]);
+		return 1;
+	}
+
+	struct TableBenchResult result;
+	_benchTable(entries, rounds, &result);
+	_printResult("Table", entries, rounds, &result);
+	_benchHashTable(entries, rounds, &result);
+	_printResult("HashTable", entries, rounds, &result);
+	return 0;
+}
@@ -0,0 +1,584 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/core.h>
+#include <mgba/core/timing.h>
+#include <mgba-util/vfs.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define TIMING_BENCH_OPTIONS "F:ho:Pr:t:"
+#define TIMING_BENCH_USAGE \
+	"usage: %s [options] [ROM]\n" \
+	"Replay a recorded trace of timing events against mTiming and against a plain sorted list\n" \
+	"\nOptions:\n" \
+	"  -F FRAMES        Record FRAMES frames of ROM [default: 3600]\n" \
+	"  -o FILE          Save the recorded trace to FILE\n" \
+	"  -t FILE          Replay the trace saved in FILE instead of recording one\n" \
+	"  -r ROUNDS        Replay the trace ROUNDS times on each queue [default: 8]\n" \
+	"  -P               CSV output, useful for parsing\n" \
+	"  -h               Print this usage and exit\n"
+
+#define TIMING_BENCH_CSV_HEADER "queue,operations,fired,duration,ns_per_op"
+
+#define TRACE_MAGIC "mTTR"
+#define TRACE_VERSION 1
+
+struct TimingReplay {
+	const struct mTimingTrace* trace;
+	size_t position;
+	size_t fired;
+	bool diverged;
+};
+
+// The same operations as the trace records, so both queues go through the same replay loop
+struct TimingQueue {
+	const char* name;
+	struct TimingReplay* replay;
+	void (*init)(struct TimingQueue*, const struct mTimingTrace*);
+	void (*deinit)(struct TimingQueue*);
+	void (*schedule)(struct TimingQueue*, size_t event, uint32_t when, bool pending);
+	void (*deschedule)(struct TimingQueue*, size_t event);
+	void (*tick)(struct TimingQueue*, int32_t cycles);
+	void (*interrupt)(struct TimingQueue*);
+	void (*clear)(struct TimingQueue*);
+	void (*setMaster)(struct TimingQueue*, uint32_t masterCycles);
+};
+
+static uint64_t _now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return 1000000LL * tv.tv_sec + tv.tv_usec;
+}
+
+static void _apply(struct TimingQueue* queue, const struct mTimingTraceEntry* entry) {
+	switch (entry->op) {
+	case mTIMING_TRACE_SCHEDULE:
+	case mTIMING_TRACE_RESCHEDULE:
+		queue->schedule(queue, entry->event, entry->value, entry->op == mTIMING_TRACE_RESCHEDULE);
+		break;
+	case mTIMING_TRACE_DESCHEDULE:
+		queue->deschedule(queue, entry->event);
+		break;
+	case mTIMING_TRACE_INTERRUPT:
+		queue->interrupt(queue);
+		break;
+	case mTIMING_TRACE_CLEAR:
+		queue->clear(queue);
+		break;
+	case mTIMING_TRACE_SET_MASTER:
+		queue->setMaster(queue, entry->value);
+		break;
+	default:
+		queue->replay->diverged = true;
+		break;
+	}
+}
+
+static bool _isTickBoundary(const struct mTimingTraceEntry* entry) {
+	return entry->op == mTIMING_TRACE_TICK || entry->op == mTIMING_TRACE_FIRE || entry->op == mTIMING_TRACE_TICK_END;
+}
+
+// Called by a queue for each event it fires. Whatever that event's callback did is next in the trace.
+static void _fired(struct TimingQueue* queue, size_t event) {
+	struct TimingReplay* replay = queue->replay;
+	const struct mTimingTrace* trace = replay->trace;
+	size_t size = mTimingTraceEntryListSize(&trace->entries);
+	if (replay->diverged) {
+		return;
+	}
+	if (replay->position >= size) {
+		replay->diverged = true;
+		return;
+	}
+	const struct mTimingTraceEntry* entry = mTimingTraceEntryListGetConstPointer(&trace->entries, replay->position);
+	if (entry->op != mTIMING_TRACE_FIRE || entry->event != event) {
+		replay->diverged = true;
+		return;
+	}
+	++replay->position;
+	++replay->fired;
+	while (replay->position < size) {
+		entry = mTimingTraceEntryListGetConstPointer(&trace->entries, replay->position);
+		if (_isTickBoundary(entry)) {
+			break;
+		}
+		_apply(queue, entry);
+		++replay->position;
+	}
+}
+
+static bool _replay(struct TimingQueue* queue, struct TimingReplay* replay) {
+	const struct mTimingTrace* trace = replay->trace;
+	size_t size = mTimingTraceEntryListSize(&trace->entries);
+	replay->position = 0;
+	replay->fired = 0;
+	replay->diverged = false;
+	queue->replay = replay;
+	while (replay->position < size && !replay->diverged) {
+		const struct mTimingTraceEntry* entry = mTimingTraceEntryListGetConstPointer(&trace->entries, replay->position);
+		++replay->position;
+		if (entry->op != mTIMING_TRACE_TICK) {
+			_apply(queue, entry);
+			continue;
+		}
+		queue->tick(queue, entry->value);
+		// Anything left over means this queue fired fewer events than were recorded
+		if (replay->position >= size || mTimingTraceEntryListGetConstPointer(&trace->entries, replay->position)->op != mTIMING_TRACE_TICK_END) {
+			replay->diverged = true;
+			break;
+		}
+		++replay->position;
+	}
+	return !replay->diverged;
+}
+
+struct HeapQueue {
+	struct TimingQueue d;
+	struct mTiming timing;
+	int32_t relativeCycles;
+	int32_t nextEvent;
+	struct mTimingEvent events[mTIMING_TRACE_MAX_EVENTS];
+};
+
+static void _heapFire(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	UNUSED(cyclesLate);
+	struct HeapQueue* queue = (struct HeapQueue*) ((uintptr_t) timing - offsetof(struct HeapQueue, timing));
+	_fired(&queue->d, (uintptr_t) context);
+}
+
+static void _heapInit(struct TimingQueue* queue, const struct mTimingTrace* trace) {
+	struct HeapQueue* heap = (struct HeapQueue*) queue;
+	heap->relativeCycles = 0;
+	heap->nextEvent = INT_MAX;
+	mTimingInit(&heap->timing, &heap->relativeCycles, &heap->nextEvent);
+	size_t i;
+	for (i = 0; i < trace->nEvents; ++i) {
+		struct mTimingEvent* event = &heap->events[i];
+		memset(event, 0, sizeof(*event));
+		event->context = (void*) (uintptr_t) i;
+		event->callback = _heapFire;
+		event->name = trace->events[i].name;
+		event->priority = trace->events[i].priority;
+		event->index = (size_t) -1;
+	}
+}
+
+static void _heapDeinit(struct TimingQueue* queue) {
+	struct HeapQueue* heap = (struct HeapQueue*) queue;
+	mTimingDeinit(&heap->timing);
+}
+
+static void _heapSchedule(struct TimingQueue* queue, size_t event, uint32_t when, bool pending) {
+	UNUSED(pending);
+	struct HeapQueue* heap = (struct HeapQueue*) queue;
+	mTimingSchedule(&heap->timing, &heap->events[event], when - heap->timing.masterCycles);
+}
+
+static void _heapDeschedule(struct TimingQueue* queue, size_t event) {
+	struct HeapQueue* heap = (struct HeapQueue*) queue;
+	mTimingDeschedule(&heap->timing, &heap->events[event]);
+}
+
+static void _heapTick(struct TimingQueue* queue, int32_t cycles) {
+	struct HeapQueue* heap = (struct HeapQueue*) queue;
+	heap->nextEvent = mTimingTick(&heap->timing, cycles);
+}
+
+static void _heapInterrupt(struct TimingQueue* queue) {
+	struct HeapQueue* heap = (struct HeapQueue*) queue;
+	mTimingInterrupt(&heap->timing);
+}
+
+static void _heapClear(struct TimingQueue* queue) {
+	struct HeapQueue* heap = (struct HeapQueue*) queue;
+	mTimingClear(&heap->timing);
+}
+
+static void _heapSetMaster(struct TimingQueue* queue, uint32_t masterCycles) {
+	struct HeapQueue* heap = (struct HeapQueue*) queue;
+	heap->timing.masterCycles = masterCycles;
+}
+
+// The original mTiming queue, a singly linked list kept sorted by deadline, without the heap
+// fallback. The only addition is the interrupted flag, which took the place of the old reroot list.
+struct ListEvent {
+	// Fired through a pointer, as mTiming's callbacks are, so that only the queues differ
+	void (*callback)(struct TimingQueue*, size_t event);
+	uint32_t when;
+	unsigned priority;
+	struct ListEvent* next;
+};
+
+struct ListQueue {
+	struct TimingQueue d;
+	struct ListEvent* root;
+	bool interrupted;
+	uint32_t masterCycles;
+	int32_t nextEvent;
+	struct ListEvent events[mTIMING_TRACE_MAX_EVENTS];
+};
+
+static void _listInit(struct TimingQueue* queue, const struct mTimingTrace* trace) {
+	struct ListQueue* list = (struct ListQueue*) queue;
+	list->root = NULL;
+	list->interrupted = false;
+	list->masterCycles = 0;
+	list->nextEvent = INT_MAX;
+	size_t i;
+	for (i = 0; i < trace->nEvents; ++i) {
+		list->events[i].callback = _fired;
+		list->events[i].when = 0;
+		list->events[i].priority = trace->events[i].priority;
+		list->events[i].next = NULL;
+	}
+}
+
+static void _listDeinit(struct TimingQueue* queue) {
+	UNUSED(queue);
+}
+
+static void _listDeschedule(struct TimingQueue* queue, size_t index) {
+	struct ListQueue* list = (struct ListQueue*) queue;
+	struct ListEvent* event = &list->events[index];
+	list->interrupted = false;
+	struct ListEvent** previous = &list->root;
+	struct ListEvent* next = list->root;
+	while (next) {
+		if (next == event) {
+			*previous = next->next;
+			return;
+		}
+		previous = &next->next;
+		next = next->next;
+	}
+}
+
+static void _listSchedule(struct TimingQueue* queue, size_t index, uint32_t when, bool pending) {
+	struct ListQueue* list = (struct ListQueue*) queue;
+	struct ListEvent* event = &list->events[index];
+	if (pending) {
+		// The old list would have been corrupted by this, so callers descheduled first
+		_listDeschedule(queue, index);
+	}
+	int32_t nextEvent = when - list->masterCycles;
+	event->when = when;
+	if (nextEvent < list->nextEvent) {
+		list->nextEvent = nextEvent;
+	}
+	list->interrupted = false;
+	struct ListEvent** previous = &list->root;
+	struct ListEvent* next = list->root;
+	unsigned priority = event->priority;
+	while (next) {
+		int32_t nextWhen = next->when - list->masterCycles;
+		if (nextWhen > nextEvent || (nextWhen == nextEvent && next->priority > priority)) {
+			break;
+		}
+		previous = &next->next;
+		next = next->next;
+	}
+	event->next = next;
+	*previous = event;
+}
+
+static void _listTick(struct TimingQueue* queue, int32_t cycles) {
+	struct ListQueue* list = (struct ListQueue*) queue;
+	list->masterCycles += cycles;
+	uint32_t masterCycles = list->masterCycles;
+	while (list->root && !list->interrupted) {
+		struct ListEvent* next = list->root;
+		int32_t nextWhen = next->when - masterCycles;
+		if (nextWhen > 0) {
+			list->nextEvent = nextWhen;
+			return;
+		}
+		list->root = next->next;
+		next->callback(queue, next - list->events);
+	}
+	if (list->interrupted) {
+		list->interrupted = false;
+		list->nextEvent = list->root ? (int32_t) (list->root->when - list->masterCycles) : INT_MAX;
+	}
+}
+
+static void _listInterrupt(struct TimingQueue* queue) {
+	struct ListQueue* list = (struct ListQueue*) queue;
+	if (list->root) {
+		list->interrupted = true;
+	}
+}
+
+static void _listClear(struct TimingQueue* queue) {
+	struct ListQueue* list = (struct ListQueue*) queue;
+	list->root = NULL;
+	list->interrupted = false;
+	list->masterCycles = 0;
+}
+
+static void _listSetMaster(struct TimingQueue* queue, uint32_t masterCycles) {
+	struct ListQueue* list = (struct ListQueue*) queue;
+	list->masterCycles = masterCycles;
+}
+
+static bool _record(const char* path, unsigned frames, struct mTimingTrace* trace) {
+#ifdef ENABLE_PERF_COUNTERS
+	struct mCore* core = mCoreFind(path);
+	if (!core) {
+		fprintf(stderr, "Could not find a core for %s\n", path);
+		return false;
+	}
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	unsigned width, height;
+	core->desiredVideoDimensions(core, &width, &height);
+	color_t* outputBuffer = malloc(width * height * BYTES_PER_PIXEL);
+	core->setVideoBuffer(core, outputBuffer, width);
+	bool success = mCoreLoadFile(core, path);
+	if (success) {
+		// Attached before resetting so that the events scheduled on reset are in the trace
+		core->timing->trace = trace;
+		core->reset(core);
+		unsigned i;
+		for (i = 0; i < frames; ++i) {
+			core->runFrame(core);
+		}
+		core->timing->trace = NULL;
+	} else {
+		fprintf(stderr, "Could not load %s\n", path);
+	}
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(outputBuffer);
+	if (trace->overflowed) {
+		fprintf(stderr, "More than %i timing events were seen; the trace is incomplete\n", mTIMING_TRACE_MAX_EVENTS);
+		return false;
+	}
+	return success;
+#else
+	UNUSED(path);
+	UNUSED(frames);
+	UNUSED(trace);
+	fprintf(stderr, "Traces can only be recorded in builds with ENABLE_PERF_COUNTERS; use -t to replay a saved one\n");
+	return false;
+#endif
+}
+
+static bool _write32(struct VFile* vf, uint32_t value) {
+	uint32_t buffer;
+	STORE_32LE(value, 0, &buffer);
+	return vf->write(vf, &buffer, sizeof(buffer)) == sizeof(buffer);
+}
+
+static bool _read32(struct VFile* vf, uint32_t* value) {
+	uint32_t buffer;
+	if (vf->read(vf, &buffer, sizeof(buffer)) != sizeof(buffer)) {
+		return false;
+	}
+	LOAD_32LE(*value, 0, &buffer);
+	return true;
+}
+
+static bool _save(const char* path, const struct mTimingTrace* trace) {
+	struct VFile* vf = VFileOpen(path, O_CREAT | O_TRUNC | O_WRONLY);
+	if (!vf) {
+		return false;
+	}
+	bool success = vf->write(vf, TRACE_MAGIC, 4) == 4 && _write32(vf, TRACE_VERSION) && _write32(vf, trace->nEvents);
+	size_t i;
+	for (i = 0; success && i < trace->nEvents; ++i) {
+		const char* name = trace->events[i].name ? trace->events[i].name : "";
+		size_t length = strlen(name);
+		success = _write32(vf, trace->events[i].priority) && _write32(vf, length) && vf->write(vf, name, length) == (ssize_t) length;
+	}
+	size_t size = mTimingTraceEntryListSize(&trace->entries);
+	success = success && _write32(vf, size);
+	for (i = 0; success && i < size; ++i) {
+		const struct mTimingTraceEntry* entry = mTimingTraceEntryListGetConstPointer(&trace->entries, i);
+		success = _write32(vf, entry->op | (entry->event << 8)) && _write32(vf, entry->value);
+	}
+	vf->close(vf);
+	return success;
+}
+
+// Names read back from a file are owned by the trace and freed with _freeNames
+static bool _load(const char* path, struct mTimingTrace* trace) {
+	struct VFile* vf = VFileOpen(path, O_RDONLY);
+	if (!vf) {
+		return false;
+	}
+	char magic[4];
+	uint32_t version;
+	uint32_t nEvents = 0;
+	bool success = vf->read(vf, magic, sizeof(magic)) == sizeof(magic) && memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0 &&
+	               _read32(vf, &version) && version == TRACE_VERSION &&
+	               _read32(vf, &nEvents) && nEvents <= mTIMING_TRACE_MAX_EVENTS;
+	size_t i;
+	for (i = 0; success && i < nEvents; ++i) {
+		uint32_t priority;
+		uint32_t length;
+		success = _read32(vf, &priority) && _read32(vf, &length) && length < 256;
+		if (!success) {
+			break;
+		}
+		char* name = calloc(1, length + 1);
+		success = vf->read(vf, name, length) == (ssize_t) length;
+		trace->events[i].name = name;
+		trace->events[i].priority = priority;
+		++trace->nEvents;
+	}
+	uint32_t size;
+	success = success && _read32(vf, &size);
+	for (i = 0; success && i < size; ++i) {
+		uint32_t op;
+		uint32_t value;
+		success = _read32(vf, &op) && _read32(vf, &value) && (op >> 8) < trace->nEvents;
+		if (success) {
+			struct mTimingTraceEntry* entry = mTimingTraceEntryListAppend(&trace->entries);
+			entry->op = op & 0xFF;
+			entry->event = op >> 8;
+			entry->value = value;
+		}
+	}
+	vf->close(vf);
+	return success;
+}
+
+static void _freeNames(struct mTimingTrace* trace) {
+	size_t i;
+	for (i = 0; i < trace->nEvents; ++i) {
+		free((char*) trace->events[i].name);
+	}
+}
+
+static bool _bench(struct TimingQueue* queue, const struct mTimingTrace* trace, unsigned rounds, bool csv) {
+	struct TimingReplay replay = { .trace = trace };
+	uint64_t duration = 0;
+	unsigned i;
+	for (i = 0; i < rounds; ++i) {
+		queue->init(queue, trace);
+		uint64_t start = _now();
+		bool success = _replay(queue, &replay);
+		duration += _now() - start;
+		queue->deinit(queue);
+		if (!success) {
+			fprintf(stderr, "%s: replay diverged from the trace at operation %zu\n", queue->name, replay.position);
+			return false;
+		}
+	}
+	double operations = (double) mTimingTraceEntryListSize(&trace->entries) * rounds;
+	double nsPerOp = duration * 1000.0 / operations;
+	if (csv) {
+		printf("%s,%.0f,%zu,%llu,%.3f\n", queue->name, operations, replay.fired * rounds, (unsigned long long) duration, nsPerOp);
+	} else {
+		printf("%-7s %10.3f ms total %8.2f ns/op\n", queue->name, duration / 1000.0, nsPerOp);
+	}
+	fflush(stdout);
+	return true;
+}
+
+int main(int argc, char** argv) {
+	unsigned frames = 3600;
+	unsigned rounds = 8;
+	const char* output = NULL;
+	const char* input = NULL;
+	bool csv = false;
+	int ch;
+	while ((ch = getopt(argc, argv, TIMING_BENCH_OPTIONS)) != -1) {
+		switch (ch) {
+		case 'F':
+			frames = strtoul(optarg, 0, 10);
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'P':
+			csv = true;
+			break;
+		case 'r':
+			rounds = strtoul(optarg, 0, 10);
+			break;
+		case 't':
+			input = optarg;
+			break;
+		case 'h':
+		default:
+			fprintf(stderr, TIMING_BENCH_USAGE, argv[0]);
+			return ch == 'h' ? 0 : 1;
+		}
+	}
+	if (!rounds || (!input && (optind + 1 != argc || !frames)) || (input && optind != argc)) {
+		fprintf(stderr, TIMING_BENCH_USAGE, argv[0]);
+		return 1;
+	}
+
+	struct mTimingTrace trace;
+	mTimingTraceInit(&trace);
+	bool success;
+	if (input) {
+		success = _load(input, &trace);
+		if (!success) {
+			fprintf(stderr, "Could not read trace %s\n", input);
+		}
+	} else {
+		success = _record(argv[optind], frames, &trace);
+		if (success && output && !_save(output, &trace)) {
+			fprintf(stderr, "Could not write trace %s\n", output);
+			success = false;
+		}
+	}
+
+	if (success) {
+		size_t fired = 0;
+		size_t i;
+		for (i = 0; i < mTimingTraceEntryListSize(&trace.entries); ++i) {
+			fired += mTimingTraceEntryListGetPointer(&trace.entries, i)->op == mTIMING_TRACE_FIRE;
+		}
+		if (csv) {
+			puts(TIMING_BENCH_CSV_HEADER);
+		} else {
+			printf("Trace: %zu operations, %zu events fired, %zu distinct events\n", mTimingTraceEntryListSize(&trace.entries), fired, trace.nEvents);
+		}
+
+		struct HeapQueue heap = {
+			.d = {
+				.name = "mtiming",
+				.init = _heapInit,
+				.deinit = _heapDeinit,
+				.schedule = _heapSchedule,
+				.deschedule = _heapDeschedule,
+				.tick = _heapTick,
+				.interrupt = _heapInterrupt,
+				.clear = _heapClear,
+				.setMaster = _heapSetMaster,
+			}
+		};
+		struct ListQueue list = {
+			.d = {
+				.name = "list",
+				.init = _listInit,
+				.deinit = _listDeinit,
+				.schedule = _listSchedule,
+				.deschedule = _listDeschedule,
+				.tick = _listTick,
+				.interrupt = _listInterrupt,
+				.clear = _listClear,
+				.setMaster = _listSetMaster,
+			}
+		};
+		// Both replays also check that each queue fires events in the order they were recorded
+		success = _bench(&heap.d, &trace, rounds, csv);
+		success = _bench(&list.d, &trace, rounds, csv) && success;
+	}
+
+	if (input) {
+		_freeNames(&trace);
+	}
+	mTimingTraceDeinit(&trace);
+	return !success;
+}
@@ -0,0 +1,240 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/core.h>
+#include <mgba/internal/debugger/trace.h>
+#ifdef M_CORE_GBA
+#include <mgba/internal/arm/decoder.h>
+#endif
+#ifdef M_CORE_GB
+#include <mgba/internal/lr35902/decoder.h>
+#endif
+
+#include <mgba-util/vfs.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TRACE_OPTIONS "a:hmn:o:p:s"
+#define TRACE_USAGE \
+	"usage: %s [options] TRACE\n" \
+	"Disassemble a binary trace recorded by the debugger's trace/binary or trace/ring commands\n" \
+	"\nOptions:\n" \
+	"  -p START[:END]   Only show instructions with addresses from START to END\n" \
+	"  -m               Show memory accesses following each instruction\n" \
+	"  -a START[:END]   Only show memory accesses from START to END (implies -m)\n" \
+	"  -o FIRST         Skip the first FIRST instructions\n" \
+	"  -n COUNT         Stop after COUNT instructions\n" \
+	"  -s               Only print a summary of the trace\n" \
+	"  -h               Print this usage and exit\n"
+
+#define TRACE_READ_CHUNK 4096
+
+struct TraceRange {
+	uint32_t start;
+	uint32_t end;
+};
+
+struct TraceOpts {
+	struct TraceRange pc;
+	struct TraceRange memory;
+	bool accesses;
+	bool summary;
+	uint64_t first;
+	uint64_t count;
+};
+
+static bool _parseRange(const char* arg, struct TraceRange* range) {
+	char* end;
+	range->start = strtoul(arg, &end, 0);
+	if (end == arg) {
+		return false;
+	}
+	if (!*end) {
+		range->end = range->start;
+		return true;
+	}
+	if (*end != ':') {
+		return false;
+	}
+	arg = end + 1;
+	range->end = strtoul(arg, &end, 0);
+	return end != arg && !*end && range->end >= range->start;
+}
+
+static bool _inRange(const struct TraceRange* range, uint32_t address) {
+	return address >= range->start && address <= range->end;
+}
+
+static void _disassemble(int platform, const struct mDebuggerTraceRecord* record, char* out, size_t size) {
+	switch (platform) {
+#ifdef M_CORE_GBA
+	case PLATFORM_GBA: {
+		struct ARMInstructionInfo info;
+		if (record->width == 4) {
+			ARMDecodeARM(record->value, &info);
+			int written = snprintf(out, size, "%08X  ", record->value);
+			ARMDisassemble(&info, record->address + WORD_SIZE_ARM * 2, out + written, size - written);
+		} else {
+			struct ARMInstructionInfo info2;
+			struct ARMInstructionInfo combined;
+			uint16_t instruction = record->value;
+			uint16_t instruction2 = record->value >> 16;
+			ARMDecodeThumb(instruction, &info);
+			ARMDecodeThumb(instruction2, &info2);
+			if (ARMDecodeThumbCombine(&info, &info2, &combined)) {
+				int written = snprintf(out, size, "%04X%04X  ", instruction, instruction2);
+				ARMDisassemble(&combined, record->address + WORD_SIZE_THUMB * 2, out + written, size - written);
+			} else {
+				int written = snprintf(out, size, "    %04X  ", instruction);
+				ARMDisassemble(&info, record->address + WORD_SIZE_THUMB * 2, out + written, size - written);
+			}
+		}
+		break;
+	}
+#endif
+#ifdef M_CORE_GB
+	case PLATFORM_GB: {
+		struct LR35902InstructionInfo info = {{0}};
+		int written = 0;
+		int i;
+		for (i = 0; i < record->width; ++i) {
+			uint8_t instruction = record->value >> (i * 8);
+			written += snprintf(out + written, size - written, "%02X", instruction);
+			LR35902Decode(instruction, &info);
+		}
+		written += snprintf(out + written, size - written, "%*s", 8 - written, "");
+		LR35902Disassemble(&info, record->address + record->width, out + written, size - written);
+		break;
+	}
+#endif
+	default:
+		snprintf(out, size, "%0*X", record->width * 2, record->value);
+		break;
+	}
+}
+
+static void _printInstruction(int platform, uint64_t index, const struct mDebuggerTraceRecord* record) {
+	char disassembly[128];
+	_disassemble(platform, record, disassembly, sizeof(disassembly));
+	if (record->segment >= 0) {
+		printf("%10" PRIu64 "  %02X:%04X  %04X  %s\n", index, record->segment, record->address, record->state, disassembly);
+	} else {
+		printf("%10" PRIu64 "  %08X  %08X  %s\n", index, record->address, record->state, disassembly);
+	}
+}
+
+static void _printAccess(const struct mDebuggerTraceRecord* record) {
+	char type = record->type == TRACE_WRITE ? 'w' : 'r';
+	if (record->segment >= 0) {
+		printf("            %c%i %02X:%04X = %0*X\n", type, record->width, record->segment, record->address, record->width * 2, record->value);
+	} else {
+		printf("            %c%i %08X = %0*X\n", type, record->width, record->address, record->width * 2, record->value);
+	}
+}
+
+int main(int argc, char** argv) {
+	struct TraceOpts opts = {
+		.pc = { 0, UINT32_MAX },
+		.memory = { 0, UINT32_MAX },
+		.count = UINT64_MAX,
+	};
+	int ch;
+	while ((ch = getopt(argc, argv, TRACE_OPTIONS)) != -1) {
+		switch (ch) {
+		case 'a':
+			if (!_parseRange(optarg, &opts.memory)) {
+				fprintf(stderr, "Invalid address range: %s\n", optarg);
+				return 1;
+			}
+			opts.accesses = true;
+			break;
+		case 'm':
+			opts.accesses = true;
+			break;
+		case 'n':
+			opts.count = strtoull(optarg, NULL, 0);
+			break;
+		case 'o':
+			opts.first = strtoull(optarg, NULL, 0);
+			break;
+		case 'p':
+			if (!_parseRange(optarg, &opts.pc)) {
+				fprintf(stderr, "Invalid address range: %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 's':
+			opts.summary = true;
+			break;
+		case 'h':
+		default:
+			printf(TRACE_USAGE, argv[0]);
+			return ch == 'h' ? 0 : 1;
+		}
+	}
+	if (optind + 1 != argc) {
+		printf(TRACE_USAGE, argv[0]);
+		return 1;
+	}
+
+	struct VFile* vf = VFileOpen(argv[optind], O_RDONLY);
+	if (!vf) {
+		fprintf(stderr, "Could not open %s\n", argv[optind]);
+		return 1;
+	}
+	struct mDebuggerTraceHeader header;
+	if (!mDebuggerTraceReadHeader(vf, &header)) {
+		fprintf(stderr, "%s is not a supported trace file\n", argv[optind]);
+		vf->close(vf);
+		return 1;
+	}
+
+	struct mDebuggerTraceRecord* records = malloc(sizeof(*records) * TRACE_READ_CHUNK);
+	uint64_t instructions = 0;
+	uint64_t reads = 0;
+	uint64_t writes = 0;
+	bool showing = false;
+	size_t count;
+	while ((count = mDebuggerTraceReadRecords(vf, records, TRACE_READ_CHUNK))) {
+		size_t i;
+		for (i = 0; i < count; ++i) {
+			const struct mDebuggerTraceRecord* record = &records[i];
+			switch (record->type) {
+			case TRACE_INSTRUCTION:
+				if (instructions - opts.first >= opts.count && instructions >= opts.first) {
+					goto done;
+				}
+				showing = instructions >= opts.first && _inRange(&opts.pc, record->address);
+				if (showing && !opts.summary) {
+					_printInstruction(header.platform, instructions, record);
+				}
+				++instructions;
+				break;
+			case TRACE_READ:
+			case TRACE_WRITE:
+				if (record->type == TRACE_READ) {
+					++reads;
+				} else {
+					++writes;
+				}
+				if (showing && opts.accesses && !opts.summary && _inRange(&opts.memory, record->address)) {
+					_printAccess(record);
+				}
+				break;
+			}
+		}
+	}
+done:
+	if (opts.summary) {
+		printf("%" PRIu64 " instructions, %" PRIu64 " reads, %" PRIu64 " writes\n", instructions, reads, writes);
+	}
+	free(records);
+	vf->close(vf);
+	return 0;
+}
@@ -0,0 +1,439 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba-util/circle-buffer.h>
+#include <mgba-util/crc32.h>
+#include <mgba-util/memory.h>
+#include <mgba-util/patch/fast.h>
+#include <mgba-util/ring-fifo.h>
+#include <mgba-util/ring-spsc.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vfs.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define UTIL_BENCH_OPTIONS "f:hPr:"
+#define UTIL_BENCH_USAGE \
+	"usage: %s [options]\n" \
+	"Time the mgba-util data structures used on emulation hot paths\n" \
+	"\nOptions:\n" \
+	"  -f FILTER        Only run benchmarks whose name contains FILTER\n" \
+	"  -r ROUNDS        Scale every benchmark's operation count by ROUNDS [default: 1]\n" \
+	"  -P               CSV output, useful for parsing\n" \
+	"  -h               Print this usage and exit\n"
+
+#define UTIL_BENCH_CSV_HEADER "benchmark,size,operations,duration,ns_per_op,mb_per_s"
+
+struct UtilBench {
+	const char* name;
+	// Bytes handled per operation
+	size_t size;
+	size_t operations;
+	// Returns the time taken for the operations, in microseconds, leaving out any setup
+	uint64_t (*run)(const struct UtilBench*, size_t operations);
+};
+
+static volatile uint32_t _sink;
+
+static uint64_t _now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return 1000000LL * tv.tv_sec + tv.tv_usec;
+}
+
+static void _fill(void* buffer, size_t size, uint32_t seed) {
+	uint8_t* bytes = buffer;
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		seed = seed * 1103515245 + 12345;
+		bytes[i] = seed >> 16;
+	}
+}
+
+static uint64_t _benchRingFIFO(const struct UtilBench* bench, size_t operations) {
+	// Writes and reads alternate in bursts, as the video proxy and audio code use it
+	struct RingFIFO fifo;
+	RingFIFOInit(&fifo, 0x10000);
+	uint8_t* chunk = malloc(bench->size);
+	_fill(chunk, bench->size, 1);
+	size_t burst = 0x8000 / bench->size;
+	size_t i;
+	size_t j;
+	uint64_t start = _now();
+	for (i = 0; i < operations; i += burst) {
+		for (j = 0; j < burst; ++j) {
+			RingFIFOWrite(&fifo, chunk, bench->size);
+		}
+		for (j = 0; j < burst; ++j) {
+			RingFIFORead(&fifo, chunk, bench->size);
+		}
+	}
+	uint64_t duration = _now() - start;
+	_sink += chunk[0];
+	free(chunk);
+	RingFIFODeinit(&fifo);
+	return duration;
+}
+
+static uint64_t _benchRingSPSC(const struct UtilBench* bench, size_t operations) {
+	struct RingSPSC ring;
+	RingSPSCInit(&ring, 0x10000);
+	uint8_t* chunk = malloc(bench->size);
+	_fill(chunk, bench->size, 2);
+	size_t burst = 0x8000 / bench->size;
+	size_t i;
+	size_t j;
+	uint64_t start = _now();
+	for (i = 0; i < operations; i += burst) {
+		for (j = 0; j < burst; ++j) {
+			RingSPSCWrite(&ring, chunk, bench->size);
+		}
+		for (j = 0; j < burst; ++j) {
+			RingSPSCRead(&ring, chunk, bench->size);
+		}
+	}
+	uint64_t duration = _now() - start;
+	_sink += chunk[0];
+	free(chunk);
+	RingSPSCDeinit(&ring);
+	return duration;
+}
+
+#ifndef DISABLE_THREADING
+struct RingSPSCProducer {
+	struct RingSPSC* ring;
+	const uint8_t* chunk;
+	size_t size;
+	size_t operations;
+};
+
+static THREAD_ENTRY _produceRingSPSC(void* context) {
+	struct RingSPSCProducer* producer = context;
+	size_t i;
+	for (i = 0; i < producer->operations; ++i) {
+		while (!RingSPSCWrite(producer->ring, producer->chunk, producer->size));
+	}
+	return 0;
+}
+
+static uint64_t _benchRingSPSCThreaded(const struct UtilBench* bench, size_t operations) {
+	// One producer and one consumer thread running concurrently, as the ring is meant to be used
+	struct RingSPSC ring;
+	RingSPSCInit(&ring, 0x10000);
+	uint8_t* chunk = malloc(bench->size);
+	uint8_t* out = malloc(bench->size);
+	_fill(chunk, bench->size, 2);
+	struct RingSPSCProducer producer = {
+		.ring = &ring,
+		.chunk = chunk,
+		.size = bench->size,
+		.operations = operations
+	};
+	Thread thread;
+	size_t i;
+	uint64_t start = _now();
+	ThreadCreate(&thread, _produceRingSPSC, &producer);
+	for (i = 0; i < operations; ++i) {
+		while (!RingSPSCRead(&ring, out, bench->size));
+	}
+	ThreadJoin(thread);
+	uint64_t duration = _now() - start;
+	if (memcmp(chunk, out, bench->size) != 0) {
+		fprintf(stderr, "ring-spsc-threaded: data was corrupted in transit\n");
+	}
+	_sink += out[0];
+	free(out);
+	free(chunk);
+	RingSPSCDeinit(&ring);
+	return duration;
+}
+#endif
+
+static uint64_t _benchCircleBuffer8(const struct UtilBench* bench, size_t operations) {
+	// Single bytes, like the GB serial and SIO queues
+	UNUSED(bench);
+	struct CircleBuffer buffer;
+	CircleBufferInit(&buffer, 0x1000);
+	int8_t value = 0;
+	size_t i;
+	size_t j;
+	uint64_t start = _now();
+	for (i = 0; i < operations; i += 0x800) {
+		for (j = 0; j < 0x800; ++j) {
+			CircleBufferWrite8(&buffer, j);
+		}
+		for (j = 0; j < 0x800; ++j) {
+			CircleBufferRead8(&buffer, &value);
+		}
+	}
+	uint64_t duration = _now() - start;
+	_sink += value;
+	CircleBufferDeinit(&buffer);
+	return duration;
+}
+
+static uint64_t _benchCircleBuffer32(const struct UtilBench* bench, size_t operations) {
+	// Words, like the GBA audio FIFOs
+	UNUSED(bench);
+	struct CircleBuffer buffer;
+	CircleBufferInit(&buffer, 0x1000);
+	int32_t value = 0;
+	size_t i;
+	size_t j;
+	uint64_t start = _now();
+	for (i = 0; i < operations; i += 0x200) {
+		for (j = 0; j < 0x200; ++j) {
+			CircleBufferWrite32(&buffer, j);
+		}
+		for (j = 0; j < 0x200; ++j) {
+			CircleBufferRead32(&buffer, &value);
+		}
+	}
+	uint64_t duration = _now() - start;
+	_sink += value;
+	CircleBufferDeinit(&buffer);
+	return duration;
+}
+
+static uint64_t _benchCircleBufferBulk(const struct UtilBench* bench, size_t operations) {
+	struct CircleBuffer buffer;
+	CircleBufferInit(&buffer, 0x10000);
+	uint8_t* chunk = malloc(bench->size);
+	_fill(chunk, bench->size, 3);
+	size_t burst = 0x8000 / bench->size;
+	size_t i;
+	size_t j;
+	uint64_t start = _now();
+	for (i = 0; i < operations; i += burst) {
+		for (j = 0; j < burst; ++j) {
+			CircleBufferWrite(&buffer, chunk, bench->size);
+		}
+		for (j = 0; j < burst; ++j) {
+			CircleBufferRead(&buffer, chunk, bench->size);
+		}
+	}
+	uint64_t duration = _now() - start;
+	_sink += chunk[0];
+	free(chunk);
+	CircleBufferDeinit(&buffer);
+	return duration;
+}
+
+static uint64_t _benchCircleBufferMasked8(const struct UtilBench* bench, size_t operations) {
+	UNUSED(bench);
+	struct CircleBufferMasked buffer;
+	CircleBufferMaskedInit(&buffer, 0x1000);
+	int8_t value = 0;
+	size_t i;
+	size_t j;
+	uint64_t start = _now();
+	for (i = 0; i < operations; i += 0x800) {
+		for (j = 0; j < 0x800; ++j) {
+			CircleBufferMaskedWrite8(&buffer, j);
+		}
+		for (j = 0; j < 0x800; ++j) {
+			CircleBufferMaskedRead8(&buffer, &value);
+		}
+	}
+	uint64_t duration = _now() - start;
+	_sink += value;
+	CircleBufferMaskedDeinit(&buffer);
+	return duration;
+}
+
+static uint64_t _benchCircleBufferMaskedBulk(const struct UtilBench* bench, size_t operations) {
+	struct CircleBufferMasked buffer;
+	CircleBufferMaskedInit(&buffer, 0x10000);
+	uint8_t* chunk = malloc(bench->size);
+	_fill(chunk, bench->size, 4);
+	size_t burst = 0x8000 / bench->size;
+	size_t i;
+	size_t j;
+	uint64_t start = _now();
+	for (i = 0; i < operations; i += burst) {
+		for (j = 0; j < burst; ++j) {
+			CircleBufferMaskedWrite(&buffer, chunk, bench->size);
+		}
+		for (j = 0; j < burst; ++j) {
+			CircleBufferMaskedRead(&buffer, chunk, bench->size);
+		}
+	}
+	uint64_t duration = _now() - start;
+	_sink += chunk[0];
+	free(chunk);
+	CircleBufferMaskedDeinit(&buffer);
+	return duration;
+}
+
+static uint64_t _benchPatchFast(const struct UtilBench* bench, size_t operations) {
+	// A diff and an apply per operation, with about one changed word in a hundred, as in rewind
+	uint32_t* in = anonymousMemoryMap(bench->size);
+	uint32_t* out = anonymousMemoryMap(bench->size);
+	uint32_t* result = anonymousMemoryMap(bench->size);
+	_fill(in, bench->size, 5);
+	memcpy(out, in, bench->size);
+	size_t i;
+	for (i = 0; i < bench->size / 4; i += 97) {
+		out[i] ^= 0x5A5A5A5A;
+	}
+	struct PatchFast patch;
+	initPatchFast(&patch);
+	uint64_t start = _now();
+	for (i = 0; i < operations; ++i) {
+		diffPatchFast(&patch, in, out, bench->size);
+		patch.d.applyPatch(&patch.d, in, bench->size, result, bench->size);
+	}
+	uint64_t duration = _now() - start;
+	_sink += result[0];
+	deinitPatchFast(&patch);
+	mappedMemoryFree(result, bench->size);
+	mappedMemoryFree(out, bench->size);
+	mappedMemoryFree(in, bench->size);
+	return duration;
+}
+
+static uint64_t _benchCrc32(const struct UtilBench* bench, size_t operations) {
+	uint8_t* buffer = anonymousMemoryMap(bench->size);
+	_fill(buffer, bench->size, 6);
+	uint32_t crc = 0;
+	size_t i;
+	uint64_t start = _now();
+	for (i = 0; i < operations; ++i) {
+		crc = crc32(crc, buffer, bench->size);
+	}
+	uint64_t duration = _now() - start;
+	_sink += crc;
+	mappedMemoryFree(buffer, bench->size);
+	return duration;
+}
+
+static uint64_t _benchVFileMemSequential(const struct UtilBench* bench, size_t operations) {
+	// Small writes into a growing chunk followed by reading it back, as when serializing a state
+	uint8_t chunk[0x100];
+	_fill(chunk, sizeof(chunk), 7);
+	size_t perFile = 0x100000 / bench->size;
+	size_t i;
+	size_t j;
+	uint64_t start = _now();
+	for (i = 0; i < operations; i += perFile) {
+		struct VFile* vf = VFileMemChunk(NULL, 0);
+		for (j = 0; j < perFile; ++j) {
+			vf->write(vf, chunk, bench->size);
+		}
+		vf->seek(vf, 0, SEEK_SET);
+		for (j = 0; j < perFile; ++j) {
+			vf->read(vf, chunk, bench->size);
+		}
+		vf->close(vf);
+	}
+	uint64_t duration = _now() - start;
+	_sink += chunk[0];
+	return duration;
+}
+
+static uint64_t _benchVFileMemRandom(const struct UtilBench* bench, size_t operations) {
+	// Scattered small reads, as when a loader jumps between headers and tables
+	size_t fileSize = 0x100000;
+	uint8_t* data = anonymousMemoryMap(fileSize);
+	_fill(data, fileSize, 8);
+	struct VFile* vf = VFileFromConstMemory(data, fileSize);
+	uint8_t chunk[0x100];
+	uint32_t seed = 9;
+	size_t i;
+	uint64_t start = _now();
+	for (i = 0; i < operations; ++i) {
+		seed = seed * 1103515245 + 12345;
+		vf->seek(vf, (seed >> 8) % (fileSize - bench->size), SEEK_SET);
+		vf->read(vf, chunk, bench->size);
+	}
+	uint64_t duration = _now() - start;
+	_sink += chunk[0];
+	vf->close(vf);
+	mappedMemoryFree(data, fileSize);
+	return duration;
+}
+
+static const struct UtilBench _benches[] = {
+	{ "ring-fifo", 4, 0x1000000, _benchRingFIFO },
+	{ "ring-fifo", 256, 0x100000, _benchRingFIFO },
+	{ "ring-spsc", 4, 0x1000000, _benchRingSPSC },
+	{ "ring-spsc", 256, 0x100000, _benchRingSPSC },
+#ifndef DISABLE_THREADING
+	{ "ring-spsc-threaded", 4, 0x400000, _benchRingSPSCThreaded },
+	{ "ring-spsc-threaded", 256, 0x40000, _benchRingSPSCThreaded },
+#endif
+	{ "circle-buffer-8", 1, 0x1000000, _benchCircleBuffer8 },
+	{ "circle-buffer-32", 4, 0x1000000, _benchCircleBuffer32 },
+	{ "circle-buffer-bulk", 256, 0x100000, _benchCircleBufferBulk },
+	{ "circle-buffer-masked-8", 1, 0x1000000, _benchCircleBufferMasked8 },
+	{ "circle-buffer-masked-bulk", 256, 0x100000, _benchCircleBufferMaskedBulk },
+	{ "patch-fast", 0x40000, 0x400, _benchPatchFast },
+	{ "crc32", 0x400, 0x40000, _benchCrc32 },
+	{ "crc32", 0x1000000, 0x20, _benchCrc32 },
+	{ "vfs-mem-sequential", 4, 0x1000000, _benchVFileMemSequential },
+	{ "vfs-mem-sequential", 256, 0x100000, _benchVFileMemSequential },
+	{ "vfs-mem-random", 4, 0x400000, _benchVFileMemRandom },
+	{ "vfs-mem-random", 256, 0x400000, _benchVFileMemRandom },
+};
+
+static void _printResult(const struct UtilBench* bench, size_t operations, uint64_t duration, bool csv) {
+	double nsPerOp = duration * 1000.0 / operations;
+	double mbPerS = 0;
+	if (duration) {
+		mbPerS = (double) bench->size * operations / duration;
+	}
+	if (csv) {
+		printf("%s,%zu,%zu,%llu,%.3f,%.3f\n", bench->name, bench->size, operations, (unsigned long long) duration, nsPerOp, mbPerS);
+	} else {
+		printf("%-26s %9zu bytes   %12.2f ns/op %10.1f MB/s\n", bench->name, bench->size, nsPerOp, mbPerS);
+	}
+	fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+	const char* filter = NULL;
+	unsigned rounds = 1;
+	bool csv = false;
+	int ch;
+	while ((ch = getopt(argc, argv, UTIL_BENCH_OPTIONS)) != -1) {
+		switch (ch) {
+		case 'f':
+			filter = optarg;
+			break;
+		case 'P':
+			csv = true;
+			break;
+		case 'r':
+			rounds = strtoul(optarg, 0, 10);
+			break;
+		case 'h':
+		default:
+			fprintf(stderr, UTIL_BENCH_USAGE, argv[0]);
+			return ch == 'h' ? 0 : 1;
+		}
+	}
+	if (!rounds) {
+		fprintf(stderr, UTIL_BENCH_USAGE, argv[0]);
+		return 1;
+	}
+
+	if (csv) {
+		puts(UTIL_BENCH_CSV_HEADER);
+	}
+	size_t i;
+	for (i = 0; i < sizeof(_benches) / sizeof(*_benches); ++i) {
+		const struct UtilBench* bench = &_benches[i];
+		if (filter && !strstr(bench->name, filter)) {
+			continue;
+		}
+		size_t operations = bench->operations * rounds;
+		uint64_t duration = bench->run(bench, operations);
+		_printResult(bench, operations, duration, csv);
+	}
+	return 0;
+}
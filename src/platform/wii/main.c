@@ -108,6 +108,7 @@ static float guiScale = GUI_SCALE;
 static Mtx model, view, modelview;
 static uint16_t* texmem;
 static GXTexObj tex;
+static bool directTexture;
 static uint16_t* rescaleTexmem;
 static GXTexObj rescaleTex;
 static int32_t tiltX;
@@ -613,8 +614,7 @@ static void _postAudioBuffer(struct mAVStream* stream, blip_t* left, blip_t* rig
 	available &= ~((32 / sizeof(struct GBAStereoSample)) - 1); // Force align to 32 bytes
 	if (available > 0) {
 		// These appear to be reversed for AUDIO_InitDMA
-		blip_read_samples(left, &audioBuffer[currentAudioBuffer][audioBufferSize].right, available, true);
-		blip_read_samples(right, &audioBuffer[currentAudioBuffer][audioBufferSize].left, available, true);
+		blip_read_samples_stereo(right, left, &audioBuffer[currentAudioBuffer][audioBufferSize].left, available);
 		audioBufferSize += available;
 	}
 	if (audioBufferSize == SAMPLES && !AUDIO_GetDMAEnableFlag()) {
@@ -778,7 +778,13 @@ void _setup(struct mGUIRunner* runner) {
 	mInputBindAxis(&runner->core->inputMap, CLASSIC_INPUT, 1, &desc);
 
 	outputBuffer = memalign(32, TEX_W * TEX_H * BYTES_PER_PIXEL);
-	runner->core->setVideoBuffer(runner->core, outputBuffer, TEX_W);
+	// Cores that can draw GX tiles themselves render straight into the texture
+	directTexture = runner->core->setVideoBufferFormat(runner->core, mCOLOR_NATIVE | mCOLOR_TILED_4X4);
+	if (directTexture) {
+		runner->core->setVideoBuffer(runner->core, texmem, TEX_W);
+	} else {
+		runner->core->setVideoBuffer(runner->core, outputBuffer, TEX_W);
+	}
 
 	runner->core->setAudioBufferSize(runner->core, SAMPLES);
 
@@ -858,18 +864,20 @@ void _drawFrame(struct mGUIRunner* runner, bool faded) {
 	if (!faded) {
 		color |= 0xC0;
 	}
-	size_t x, y;
-	uint64_t* texdest = (uint64_t*) texmem;
-	uint64_t* texsrc = (uint64_t*) outputBuffer;
-	for (y = 0; y < coreh; y += 4) {
-		for (x = 0; x < corew >> 2; ++x) {
-			texdest[0 + x * 4 + y * 64] = texsrc[0   + x + y * 64];
-			texdest[1 + x * 4 + y * 64] = texsrc[64  + x + y * 64];
-			texdest[2 + x * 4 + y * 64] = texsrc[128 + x + y * 64];
-			texdest[3 + x * 4 + y * 64] = texsrc[192 + x + y * 64];
+	if (!directTexture) {
+		size_t x, y;
+		uint64_t* texdest = (uint64_t*) texmem;
+		uint64_t* texsrc = (uint64_t*) outputBuffer;
+		for (y = 0; y < coreh; y += 4) {
+			for (x = 0; x < corew >> 2; ++x) {
+				texdest[0 + x * 4 + y * 64] = texsrc[0   + x + y * 64];
+				texdest[1 + x * 4 + y * 64] = texsrc[64  + x + y * 64];
+				texdest[2 + x * 4 + y * 64] = texsrc[128 + x + y * 64];
+				texdest[3 + x * 4 + y * 64] = texsrc[192 + x + y * 64];
+			}
 		}
 	}
-	DCFlushRange(texdest, TEX_W * TEX_H * BYTES_PER_PIXEL);
+	DCFlushRange(texmem, TEX_W * TEX_H * BYTES_PER_PIXEL);
 
 	if (faded) {
 		GX_SetBlendMode(GX_BM_BLEND, GX_BL_SRCALPHA, GX_BL_INVSRCALPHA, GX_LO_NOOP);
@@ -16,3 +16,21 @@ void mappedMemoryFree(void* memory, size_t size) {
 	// size is not useful here because we're freeing the memory, not decommitting it
 	VirtualFree(memory, 0, MEM_RELEASE);
 }
+
+void* hugeMemoryMap(size_t size) {
+#ifdef ENABLE_HUGE_PAGES
+	// Large pages need the "Lock pages in memory" privilege, so fall back quietly if this fails
+	SIZE_T pageSize = GetLargePageMinimum();
+	if (pageSize) {
+		void* memory = VirtualAlloc(NULL, (size + pageSize - 1) & ~(pageSize - 1), MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (memory) {
+			return memory;
+		}
+	}
+#endif
+	return anonymousMemoryMap(size);
+}
+
+void hugeMemoryFree(void* memory, size_t size) {
+	mappedMemoryFree(memory, size);
+}
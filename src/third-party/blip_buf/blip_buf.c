@@ -7,6 +7,14 @@
 #include <string.h>
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define BLIP_SIMD_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BLIP_SIMD_NEON
+#endif
+
 /* Library Copyright (C) 2003-2009 Shay Green. This library is free software;
 you can redistribute it and/or modify it under the terms of the GNU Lesser
 General Public License as published by the Free Software Foundation; either
@@ -242,6 +250,90 @@ int blip_read_samples( blip_t* m, short out [], int count, int stereo )
 	return count;
 }
 
+int blip_read_samples_stereo( blip_t* left, blip_t* right, short out [], int count )
+{
+	assert( count >= 0 );
+	
+	if ( count > left->avail )
+		count = left->avail;
+	if ( count > right->avail )
+		count = right->avail;
+	
+	if ( count )
+	{
+		buf_t const* inLeft  = SAMPLES( left );
+		buf_t const* inRight = SAMPLES( right );
+		int i;
+#if defined(BLIP_SIMD_SSE2)
+		/* Both integrators share a vector, left in lane 0 and right in lane 1 */
+		__m128i sum = _mm_set_epi32( 0, 0, right->integrator, left->integrator );
+		__m128i const max = _mm_set1_epi32( max_sample );
+		for ( i = 0; i < count; ++i )
+		{
+			__m128i s = _mm_srai_epi32( sum, delta_bits );
+			sum = _mm_add_epi32( sum, _mm_set_epi32( 0, 0, inRight [i], inLeft [i] ) );
+			
+			/* Same result as CLAMP, including how it wraps far outside the range */
+			__m128i inRange = _mm_cmpeq_epi32( _mm_srai_epi32( _mm_slli_epi32( s, 16 ), 16 ), s );
+			__m128i clamped = _mm_xor_si128( _mm_srai_epi32( s, 16 ), max );
+			s = _mm_or_si128( _mm_and_si128( inRange, s ), _mm_andnot_si128( inRange, clamped ) );
+			
+			int frame = _mm_cvtsi128_si32( _mm_packs_epi32( s, s ) );
+			memcpy( &out [i * 2], &frame, sizeof( frame ) );
+			
+			sum = _mm_sub_epi32( sum, _mm_slli_epi32( s, delta_bits - bass_shift ) );
+		}
+		left->integrator  = _mm_cvtsi128_si32( sum );
+		right->integrator = _mm_cvtsi128_si32( _mm_srli_si128( sum, 4 ) );
+#elif defined(BLIP_SIMD_NEON)
+		int32x2_t sum = vset_lane_s32( right->integrator, vdup_n_s32( left->integrator ), 1 );
+		int32x2_t const max = vdup_n_s32( max_sample );
+		for ( i = 0; i < count; ++i )
+		{
+			int32x2_t s = vshr_n_s32( sum, delta_bits );
+			sum = vadd_s32( sum, vset_lane_s32( inRight [i], vdup_n_s32( inLeft [i] ), 1 ) );
+			
+			uint32x2_t inRange = vceq_s32( vshr_n_s32( vshl_n_s32( s, 16 ), 16 ), s );
+			s = vbsl_s32( inRange, s, veor_s32( vshr_n_s32( s, 16 ), max ) );
+			
+			out [i * 2]     = vget_lane_s32( s, 0 );
+			out [i * 2 + 1] = vget_lane_s32( s, 1 );
+			
+			sum = vsub_s32( sum, vshl_n_s32( s, delta_bits - bass_shift ) );
+		}
+		left->integrator  = vget_lane_s32( sum, 0 );
+		right->integrator = vget_lane_s32( sum, 1 );
+#else
+		int sumLeft  = left->integrator;
+		int sumRight = right->integrator;
+		for ( i = 0; i < count; ++i )
+		{
+			int l = ARITH_SHIFT( sumLeft, delta_bits );
+			int r = ARITH_SHIFT( sumRight, delta_bits );
+			
+			sumLeft  += inLeft [i];
+			sumRight += inRight [i];
+			
+			CLAMP( l );
+			CLAMP( r );
+			
+			out [i * 2]     = l;
+			out [i * 2 + 1] = r;
+			
+			sumLeft  -= l << (delta_bits - bass_shift);
+			sumRight -= r << (delta_bits - bass_shift);
+		}
+		left->integrator  = sumLeft;
+		right->integrator = sumRight;
+#endif
+		
+		remove_samples( left, count );
+		remove_samples( right, count );
+	}
+	
+	return count;
+}
+
 /* Things that didn't help performance on x86:
 	__attribute__((aligned(128)))
 	#define short int
@@ -5,6 +5,8 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba-util/circle-buffer.h>
 
+#include <mgba-util/math.h>
+
 #ifndef NDEBUG
 static int _checkIntegrity(struct CircleBuffer* buffer) {
 	if ((int8_t*) buffer->writePtr - (int8_t*) buffer->readPtr == (ssize_t) buffer->size) {
@@ -282,3 +284,67 @@ size_t CircleBufferDump(const struct CircleBuffer* buffer, void* output, size_t
 
 	return length;
 }
+
+void CircleBufferMaskedInit(struct CircleBufferMasked* buffer, size_t capacity) {
+	capacity = toPow2(capacity);
+	buffer->data = malloc(capacity);
+	buffer->mask = capacity - 1;
+	CircleBufferMaskedClear(buffer);
+}
+
+void CircleBufferMaskedDeinit(struct CircleBufferMasked* buffer) {
+	free(buffer->data);
+	buffer->data = 0;
+}
+
+void CircleBufferMaskedClear(struct CircleBufferMasked* buffer) {
+	buffer->readIndex = 0;
+	buffer->writeIndex = 0;
+}
+
+size_t CircleBufferMaskedWrite(struct CircleBufferMasked* buffer, const void* input, size_t length) {
+	if (CircleBufferMaskedSize(buffer) + length > CircleBufferMaskedCapacity(buffer)) {
+		return 0;
+	}
+	size_t offset = buffer->writeIndex & buffer->mask;
+	size_t remaining = CircleBufferMaskedCapacity(buffer) - offset;
+	if (length <= remaining) {
+		memcpy(&buffer->data[offset], input, length);
+	} else {
+		memcpy(&buffer->data[offset], input, remaining);
+		memcpy(buffer->data, (const uint8_t*) input + remaining, length - remaining);
+	}
+	buffer->writeIndex += length;
+	return length;
+}
+
+size_t CircleBufferMaskedPeek(const struct CircleBufferMasked* buffer, void* output, size_t length) {
+	size_t size = CircleBufferMaskedSize(buffer);
+	if (length > size) {
+		length = size;
+	}
+	size_t offset = buffer->readIndex & buffer->mask;
+	size_t remaining = CircleBufferMaskedCapacity(buffer) - offset;
+	if (length <= remaining) {
+		memcpy(output, &buffer->data[offset], length);
+	} else {
+		memcpy(output, &buffer->data[offset], remaining);
+		memcpy((uint8_t*) output + remaining, buffer->data, length - remaining);
+	}
+	return length;
+}
+
+size_t CircleBufferMaskedRead(struct CircleBufferMasked* buffer, void* output, size_t length) {
+	length = CircleBufferMaskedPeek(buffer, output, length);
+	buffer->readIndex += length;
+	return length;
+}
+
+size_t CircleBufferMaskedDiscard(struct CircleBufferMasked* buffer, size_t length) {
+	size_t size = CircleBufferMaskedSize(buffer);
+	if (length > size) {
+		length = size;
+	}
+	buffer->readIndex += length;
+	return length;
+}
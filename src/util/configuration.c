@@ -76,6 +76,7 @@ static void _enumHandler(const char* key, void* value, void* user) {
 void ConfigurationInit(struct Configuration* configuration) {
 	HashTableInit(&configuration->sections, 0, _tableDeinit);
 	HashTableInit(&configuration->root, 0, _sectionDeinit);
+	configuration->generation = 0;
 }
 
 void ConfigurationDeinit(struct Configuration* configuration) {
@@ -84,6 +85,7 @@ void ConfigurationDeinit(struct Configuration* configuration) {
 }
 
 void ConfigurationSetValue(struct Configuration* configuration, const char* section, const char* key, const char* value) {
+	++configuration->generation;
 	struct Table* currentSection = &configuration->root;
 	if (section) {
 		currentSection = HashTableLookup(&configuration->sections, section);
@@ -123,6 +125,7 @@ void ConfigurationSetFloatValue(struct Configuration* configuration, const char*
 }
 
 void ConfigurationClearValue(struct Configuration* configuration, const char* section, const char* key) {
+	++configuration->generation;
 	struct Table* currentSection = &configuration->root;
 	if (section) {
 		currentSection = HashTableLookup(&configuration->sections, section);
@@ -167,6 +170,7 @@ bool ConfigurationRead(struct Configuration* configuration, const char* path) {
 }
 
 bool ConfigurationReadVFile(struct Configuration* configuration, struct VFile* vf) {
+	++configuration->generation;
 	HashTableClear(&configuration->root);
 	HashTableClear(&configuration->sections);
 	return ini_parse_stream(_vfgets, vf, _iniRead, configuration) == 0;
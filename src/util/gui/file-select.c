@@ -20,6 +20,15 @@
 #define SCANNING_THRESHOLD_2 50
 #endif
 
+struct GUIFileListing {
+	char path[PATH_MAX];
+	struct GUIMenuItemList items;
+	size_t index;
+};
+
+DECLARE_VECTOR(GUIFileListingList, struct GUIFileListing);
+DEFINE_VECTOR(GUIFileListingList, struct GUIFileListing);
+
 static void _cleanFiles(struct GUIMenuItemList* currentFiles) {
 	size_t size = GUIMenuItemListSize(currentFiles);
 	size_t i;
@@ -47,6 +56,19 @@ static int _strpcmp(const void* a, const void* b) {
 	return strcasecmp(((const struct GUIMenuItem*) a)->title, ((const struct GUIMenuItem*) b)->title);
 }
 
+static void _drawProgress(struct GUIParams* params, const char* currentPath, const char* format, size_t i, size_t items) {
+	params->drawStart();
+	if (params->guiPrepare) {
+		params->guiPrepare();
+	}
+	GUIFontPrintf(params->font, 0, GUIFontHeight(params->font), GUI_ALIGN_LEFT, 0xFFFFFFFF, format, i, items);
+	GUIFontPrintf(params->font, 0, GUIFontHeight(params->font) * 2, GUI_ALIGN_LEFT, 0xFFFFFFFF, "%s", currentPath);
+	if (params->guiFinish) {
+		params->guiFinish();
+	}
+	params->drawEnd();
+}
+
 static bool _refreshDirectory(struct GUIParams* params, const char* currentPath, struct GUIMenuItemList* currentFiles, bool (*filterName)(const char* name), bool (*filterContents)(struct VFile*)) {
 	_cleanFiles(currentFiles);
 
@@ -67,68 +89,55 @@ static bool _refreshDirectory(struct GUIParams* params, const char* currentPath,
 				dir->close(dir);
 				return false;
 			}
-
-			params->drawStart();
-			if (params->guiPrepare) {
-				params->guiPrepare();
-			}
-			GUIFontPrintf(params->font, 0, GUIFontHeight(params->font), GUI_ALIGN_LEFT, 0xFFFFFFFF, "(scanning for items: %"PRIz"u)", i);
-			GUIFontPrintf(params->font, 0, GUIFontHeight(params->font) * 2, GUI_ALIGN_LEFT, 0xFFFFFFFF, "%s", currentPath);
-			if (params->guiFinish) {
-				params->guiFinish();
-			}
-			params->drawEnd();
+			_drawProgress(params, currentPath, "(scanning for items: %"PRIz"u)", i, 0);
 		}
 		const char* name = de->name(de);
 		if (name[0] == '.') {
 			continue;
 		}
-		if (de->type(de) == VFS_DIRECTORY) {
+		enum VFSType type = de->type(de);
+		if (type == VFS_DIRECTORY) {
 			size_t len = strlen(name) + 2;
 			char* n2 = malloc(len);
 			snprintf(n2, len, "%s/", name);
 			name = n2;
+		} else if (filterName && !filterName(name)) {
+			// Checking the name is cheap, so the rejects never make it into the list to be sorted
+			continue;
 		} else {
 			name = strdup(name);
 		}
-		*GUIMenuItemListAppend(currentFiles) = (struct GUIMenuItem) { .title = name, .data = (void*) de->type(de) };
+		*GUIMenuItemListAppend(currentFiles) = (struct GUIMenuItem) { .title = name, .data = (void*) type };
 		++items;
 	}
 	qsort(GUIMenuItemListGetPointer(currentFiles, 1), GUIMenuItemListSize(currentFiles) - 1, sizeof(struct GUIMenuItem), _strpcmp);
-	i = 0;
-	size_t item = 0;
-	while (item < GUIMenuItemListSize(currentFiles)) {
-		++i;
-		if (!(i % SCANNING_THRESHOLD_2)) {
+	if (!filterContents) {
+		dir->close(dir);
+		return true;
+	}
+
+	// Opening files is slow on some platforms, so this pass shows its progress more often.
+	// Items that pass are compacted towards the front instead of shifting the list for every reject.
+	size_t size = GUIMenuItemListSize(currentFiles);
+	size_t kept = 1;
+	size_t item;
+	for (item = 1; item < size; ++item) {
+		if (!(item % SCANNING_THRESHOLD_2)) {
 			uint32_t input = 0;
 			GUIPollInput(params, &input, 0);
 			if (input & (1 << GUI_INPUT_CANCEL)) {
+				for (; item < size; ++item) {
+					free((char*) GUIMenuItemListGetPointer(currentFiles, item)->title);
+				}
+				GUIMenuItemListResize(currentFiles, (ssize_t) kept - (ssize_t) size);
 				dir->close(dir);
 				return false;
 			}
-
-			params->drawStart();
-			if (params->guiPrepare) {
-				params->guiPrepare();
-			}
-			GUIFontPrintf(params->font, 0, GUIFontHeight(params->font), GUI_ALIGN_LEFT, 0xFFFFFFFF, "(scanning item %"PRIz"u of %"PRIz"u)", i, items);
-			GUIFontPrintf(params->font, 0, GUIFontHeight(params->font) * 2, GUI_ALIGN_LEFT, 0xFFFFFFFF, "%s", currentPath);
-			if (params->guiFinish) {
-				params->guiFinish();
-			}
-			params->drawEnd();
+			_drawProgress(params, currentPath, "(scanning item %"PRIz"u of %"PRIz"u)", item, items);
 		}
 		struct GUIMenuItem* testItem = GUIMenuItemListGetPointer(currentFiles, item);
-		if (testItem->data != (void*) VFS_FILE) {
-			++item;
-			continue;
-		}
 		bool failed = false;
-		if (filterName && !filterName(testItem->title)) {
-			failed = true;
-		}
-
-		if (!failed && filterContents) {
+		if (testItem->data == (void*) VFS_FILE) {
 			struct VFile* vf = dir->openFile(dir, testItem->title, O_RDONLY);
 			if (!vf) {
 				failed = true;
@@ -142,22 +151,70 @@ static bool _refreshDirectory(struct GUIParams* params, const char* currentPath,
 
 		if (failed) {
 			free((char*) testItem->title);
-			GUIMenuItemListShift(currentFiles, item, 1);
 		} else {
-			++item;
+			*GUIMenuItemListGetPointer(currentFiles, kept) = *testItem;
+			++kept;
 		}
 	}
+	GUIMenuItemListResize(currentFiles, (ssize_t) kept - (ssize_t) size);
 	dir->close(dir);
 
 	return true;
 }
 
+static bool _samePath(const char* a, const char* b) {
+	size_t lenA = strlen(a);
+	size_t lenB = strlen(b);
+	if (lenA && a[lenA - 1] == '/') {
+		--lenA;
+	}
+	if (lenB && b[lenB - 1] == '/') {
+		--lenB;
+	}
+	return lenA == lenB && strncmp(a, b, lenA) == 0;
+}
+
+static void _cleanParents(struct GUIFileListingList* parents) {
+	size_t i;
+	for (i = 0; i < GUIFileListingListSize(parents); ++i) {
+		struct GUIFileListing* listing = GUIFileListingListGetPointer(parents, i);
+		_cleanFiles(&listing->items);
+		GUIMenuItemListDeinit(&listing->items);
+	}
+	GUIFileListingListClear(parents);
+}
+
+static bool _enterParent(struct GUIParams* params, struct GUIMenu* menu, struct GUIFileListingList* parents, bool (*filterName)(const char* name), bool (*filterContents)(struct VFile*)) {
+	_upDirectory(params->currentPath);
+	size_t depth = GUIFileListingListSize(parents);
+	if (depth) {
+		struct GUIFileListing* listing = GUIFileListingListGetPointer(parents, depth - 1);
+		if (_samePath(listing->path, params->currentPath)) {
+			// Nothing can change the parent's contents from in here, so the listing from when it was left is still good
+			_cleanFiles(&menu->items);
+			GUIMenuItemListDeinit(&menu->items);
+			menu->items = listing->items;
+			menu->index = listing->index;
+			GUIFileListingListResize(parents, -1);
+			return true;
+		}
+		_cleanParents(parents);
+	}
+	if (!_refreshDirectory(params, params->currentPath, &menu->items, filterName, filterContents)) {
+		return false;
+	}
+	menu->index = 0;
+	return true;
+}
+
 bool GUISelectFile(struct GUIParams* params, char* outPath, size_t outLen, bool (*filterName)(const char* name), bool (*filterContents)(struct VFile*)) {
 	struct GUIMenu menu = {
 		.title = "Select file",
 		.subtitle = params->currentPath,
 		.index = params->fileIndex,
 	};
+	struct GUIFileListingList parents;
+	GUIFileListingListInit(&parents, 0);
 	GUIMenuItemListInit(&menu.items, 0);
 	_refreshDirectory(params, params->currentPath, &menu.items, filterName, filterContents);
 
@@ -173,8 +230,7 @@ bool GUISelectFile(struct GUIParams* params, char* outPath, size_t outLen, bool
 				if (strncmp(params->currentPath, params->basePath, PATH_MAX) == 0) {
 					continue;
 				}
-				_upDirectory(params->currentPath);
-				if (!_refreshDirectory(params, params->currentPath, &menu.items, filterName, filterContents)) {
+				if (!_enterParent(params, &menu, &parents, filterName, filterContents)) {
 					break;
 				}
 			} else {
@@ -192,31 +248,37 @@ bool GUISelectFile(struct GUIParams* params, char* outPath, size_t outLen, bool
 					GUIMenuItemListDeinit(&newFiles);
 					_cleanFiles(&menu.items);
 					GUIMenuItemListDeinit(&menu.items);
+					_cleanParents(&parents);
+					GUIFileListingListDeinit(&parents);
 					return true;
 				} else {
-					_cleanFiles(&menu.items);
-					GUIMenuItemListDeinit(&menu.items);
+					// Keep the current listing around for when the user comes back up
+					struct GUIFileListing* listing = GUIFileListingListAppend(&parents);
+					strncpy(listing->path, params->currentPath, PATH_MAX - 1);
+					listing->path[PATH_MAX - 1] = '\0';
+					listing->items = menu.items;
+					listing->index = menu.index;
 					menu.items = newFiles;
 					strncpy(params->currentPath, outPath, PATH_MAX);
+					menu.index = 0;
 				}
 			}
-			params->fileIndex = 0;
-			menu.index = 0;
+			params->fileIndex = menu.index;
 		}
 		if (reason == GUI_MENU_EXIT_BACK) {
 			if (strncmp(params->currentPath, params->basePath, PATH_MAX) == 0) {
 				break;
 			}
-			_upDirectory(params->currentPath);
-			if (!_refreshDirectory(params, params->currentPath, &menu.items, filterName, filterContents)) {
+			if (!_enterParent(params, &menu, &parents, filterName, filterContents)) {
 				break;
 			}
-			params->fileIndex = 0;
-			menu.index = 0;
+			params->fileIndex = menu.index;
 		}
 	}
 
 	_cleanFiles(&menu.items);
 	GUIMenuItemListDeinit(&menu.items);
+	_cleanParents(&parents);
+	GUIFileListingListDeinit(&parents);
 	return false;
 }
@@ -97,3 +97,95 @@ uint32_t hash32(const void* key, int len, uint32_t seed) {
 
   return h1;
 } 
+
+//-----------------------------------------------------------------------------
+// xxHash64 was written by Yann Collet, and is available under the BSD 2-Clause
+// license. Its four accumulators are independent, so they can be run in
+// parallel within each 32-byte stripe.
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64 ( uint64_t x, int8_t r ) {
+  return (x << r) | (x >> (64 - r));
+}
+
+static FORCE_INLINE uint64_t round64 ( uint64_t acc, uint64_t input ) {
+  acc += input * PRIME64_2;
+  acc = rotl64(acc, 31);
+  return acc * PRIME64_1;
+}
+
+static FORCE_INLINE uint64_t mergeRound64 ( uint64_t acc, uint64_t val ) {
+  acc ^= round64(0, val);
+  return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t hash64(const void* key, size_t len, uint64_t seed) {
+  const uint8_t * data = (const uint8_t*)key;
+  size_t offset = 0;
+  uint64_t h64;
+  uint64_t k;
+
+  if (len >= 32) {
+    uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+    uint64_t v2 = seed + PRIME64_2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - PRIME64_1;
+
+    for (; offset + 32 <= len; offset += 32) {
+      LOAD_64LE(k, offset, data);
+      v1 = round64(v1, k);
+      LOAD_64LE(k, offset + 8, data);
+      v2 = round64(v2, k);
+      LOAD_64LE(k, offset + 16, data);
+      v3 = round64(v3, k);
+      LOAD_64LE(k, offset + 24, data);
+      v4 = round64(v4, k);
+    }
+
+    h64 = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+    h64 = mergeRound64(h64, v1);
+    h64 = mergeRound64(h64, v2);
+    h64 = mergeRound64(h64, v3);
+    h64 = mergeRound64(h64, v4);
+  } else {
+    h64 = seed + PRIME64_5;
+  }
+
+  h64 += len;
+
+  //----------
+  // tail
+
+  for (; offset + 8 <= len; offset += 8) {
+    LOAD_64LE(k, offset, data);
+    h64 ^= round64(0, k);
+    h64 = rotl64(h64, 27) * PRIME64_1 + PRIME64_4;
+  }
+  if (offset + 4 <= len) {
+    uint32_t k32;
+    LOAD_32LE(k32, offset, data);
+    h64 ^= (uint64_t) k32 * PRIME64_1;
+    h64 = rotl64(h64, 23) * PRIME64_2 + PRIME64_3;
+    offset += 4;
+  }
+  for (; offset < len; ++offset) {
+    h64 ^= data[offset] * PRIME64_5;
+    h64 = rotl64(h64, 11) * PRIME64_1;
+  }
+
+  //----------
+  // finalization
+
+  h64 ^= h64 >> 33;
+  h64 *= PRIME64_2;
+  h64 ^= h64 >> 29;
+  h64 *= PRIME64_3;
+  h64 ^= h64 >> 32;
+
+  return h64;
+}
@@ -5,6 +5,18 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba-util/patch/fast.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PATCH_FAST_SIMD_SSE2
+#ifdef __AVX2__
+#include <immintrin.h>
+#define PATCH_FAST_SIMD_AVX2
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PATCH_FAST_SIMD_NEON
+#endif
+
 DEFINE_VECTOR(PatchFastExtents, struct PatchFastExtent);
 
 size_t _fastOutputSize(struct Patch* patch, size_t inSize);
@@ -14,60 +26,113 @@ void initPatchFast(struct PatchFast* patch) {
 	PatchFastExtentsInit(&patch->extents, 32);
 	patch->d.outputSize = _fastOutputSize;
 	patch->d.applyPatch = _fastApplyPatch;
+	patch->d.applyPatchInPlace = NULL;
+	patch->d.hasOutputCrc32 = false;
 }
 
 void deinitPatchFast(struct PatchFast* patch) {
 	PatchFastExtentsDeinit(&patch->extents);
 }
 
+// XORs one 16-byte block of a and b into out, returning whether any bit differed
+static inline bool _fastXorBlock(void* out, const void* a, const void* b) {
+#if defined(PATCH_FAST_SIMD_SSE2)
+	__m128i x = _mm_xor_si128(_mm_loadu_si128(a), _mm_loadu_si128(b));
+	_mm_storeu_si128(out, x);
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_setzero_si128())) != 0xFFFF;
+#elif defined(PATCH_FAST_SIMD_NEON)
+	uint8x16_t x = veorq_u8(vld1q_u8(a), vld1q_u8(b));
+	vst1q_u8(out, x);
+	uint64x2_t wide = vreinterpretq_u64_u8(x);
+	return (vgetq_lane_u64(wide, 0) | vgetq_lane_u64(wide, 1)) != 0;
+#else
+	const uint32_t* aptr = a;
+	const uint32_t* bptr = b;
+	uint32_t* optr = out;
+	optr[0] = aptr[0] ^ bptr[0];
+	optr[1] = aptr[1] ^ bptr[1];
+	optr[2] = aptr[2] ^ bptr[2];
+	optr[3] = aptr[3] ^ bptr[3];
+	return (optr[0] | optr[1] | optr[2] | optr[3]) != 0;
+#endif
+}
+
+// Returns the offset of the first 16-byte block at or after off that differs, or end if none do
+static size_t _fastSkipIdentical(const uint8_t* in, const uint8_t* out, size_t off, size_t end) {
+#if defined(PATCH_FAST_SIMD_AVX2)
+	for (; off + 64 <= end; off += 64) {
+		__m256i a = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) &in[off]), _mm256_loadu_si256((const __m256i*) &out[off]));
+		__m256i b = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) &in[off + 32]), _mm256_loadu_si256((const __m256i*) &out[off + 32]));
+		__m256i x = _mm256_or_si256(a, b);
+		if (!_mm256_testz_si256(x, x)) {
+			break;
+		}
+	}
+#elif defined(PATCH_FAST_SIMD_SSE2)
+	for (; off + 64 <= end; off += 64) {
+		__m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) &in[off]), _mm_loadu_si128((const __m128i*) &out[off]));
+		__m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) &in[off + 16]), _mm_loadu_si128((const __m128i*) &out[off + 16]));
+		__m128i c = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) &in[off + 32]), _mm_loadu_si128((const __m128i*) &out[off + 32]));
+		__m128i d = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) &in[off + 48]), _mm_loadu_si128((const __m128i*) &out[off + 48]));
+		if (_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(a, b), _mm_and_si128(c, d))) != 0xFFFF) {
+			break;
+		}
+	}
+#elif defined(PATCH_FAST_SIMD_NEON)
+	for (; off + 64 <= end; off += 64) {
+		uint8x16_t a = veorq_u8(vld1q_u8(&in[off]), vld1q_u8(&out[off]));
+		uint8x16_t b = veorq_u8(vld1q_u8(&in[off + 16]), vld1q_u8(&out[off + 16]));
+		uint8x16_t c = veorq_u8(vld1q_u8(&in[off + 32]), vld1q_u8(&out[off + 32]));
+		uint8x16_t d = veorq_u8(vld1q_u8(&in[off + 48]), vld1q_u8(&out[off + 48]));
+		uint64x2_t wide = vreinterpretq_u64_u8(vorrq_u8(vorrq_u8(a, b), vorrq_u8(c, d)));
+		if (vgetq_lane_u64(wide, 0) | vgetq_lane_u64(wide, 1)) {
+			break;
+		}
+	}
+#endif
+	for (; off < end; off += 16) {
+		const uint32_t* iptr = (const uint32_t*) &in[off];
+		const uint32_t* optr = (const uint32_t*) &out[off];
+		if ((iptr[0] ^ optr[0]) | (iptr[1] ^ optr[1]) | (iptr[2] ^ optr[2]) | (iptr[3] ^ optr[3])) {
+			break;
+		}
+	}
+	return off;
+}
+
 bool diffPatchFast(struct PatchFast* patch, const void* restrict in, const void* restrict out, size_t size) {
 	PatchFastExtentsClear(&patch->extents);
-	const uint32_t* iptr = in;
-	const uint32_t* optr = out;
+	const uint8_t* iptr = in;
+	const uint8_t* optr = out;
+	size_t blocks = size & ~15;
 	size_t extentOff = 0;
 	struct PatchFastExtent* extent = NULL;
-	size_t off;
-	for (off = 0; off < (size & ~15); off += 16) {
-		uint32_t a = iptr[0] ^ optr[0];
-		uint32_t b = iptr[1] ^ optr[1];
-		uint32_t c = iptr[2] ^ optr[2];
-		uint32_t d = iptr[3] ^ optr[3];
-		iptr += 4;
-		optr += 4;
-		if (a | b | c | d) {
-			if (!extent) {
-				extent = PatchFastExtentsAppend(&patch->extents);
-				extent->offset = off;
-				extentOff = 0;
+	size_t off = 0;
+	while (off < blocks) {
+		off = _fastSkipIdentical(iptr, optr, off, blocks);
+		if (off == blocks) {
+			break;
+		}
+		extent = PatchFastExtentsAppend(&patch->extents);
+		extent->offset = off;
+		extentOff = 0;
+		for (; off < blocks && extentOff < PATCH_FAST_EXTENT; off += 16) {
+			if (!_fastXorBlock(&extent->extent[extentOff], &iptr[off], &optr[off])) {
+				off += 16;
+				break;
 			}
-			extent->extent[extentOff] = a;
-			extent->extent[extentOff + 1] = b;
-			extent->extent[extentOff + 2] = c;
-			extent->extent[extentOff + 3] = d;
 			extentOff += 4;
-			if (extentOff == PATCH_FAST_EXTENT) {
-				extent->length = extentOff * 4;
-				extent = NULL;
-			}
-		} else if (extent) {
-			extent->length = extentOff * 4;
-			extent = NULL;
 		}
-	}
-	if (extent) {
 		extent->length = extentOff * 4;
 		extent = NULL;
 	}
-	const uint32_t* iptr8 = iptr;
-	const uint32_t* optr8 = optr;
 	for (; off < size; ++off) {
-		uint8_t a = iptr8[0] ^ optr8[0];
-		++iptr8;
-		++optr8;
+		uint8_t a = iptr[off] ^ optr[off];
 		if (a) {
 			if (!extent) {
 				extent = PatchFastExtentsAppend(&patch->extents);
 				extent->offset = off;
+				extentOff = 0;
 			}
 			((uint8_t*) extent->extent)[extentOff] = a;
 			++extentOff;
@@ -94,37 +159,27 @@ bool _fastApplyPatch(struct Patch* p, const void* in, size_t inSize, void* out,
 	if (inSize != outSize) {
 		return false;
 	}
-	const uint32_t* iptr = in;
-	uint32_t* optr = out;
+	const uint8_t* iptr = in;
+	uint8_t* optr = out;
 	size_t lastWritten = 0;
 	size_t s;
 	for (s = 0; s < PatchFastExtentsSize(&patch->extents); ++s) {
 		struct PatchFastExtent* extent = PatchFastExtentsGetPointer(&patch->extents, s);
-		if (extent->length + extent->offset > outSize) {
+		if (extent->length + extent->offset > outSize || extent->offset < lastWritten) {
 			return false;
 		}
-		memcpy(optr, iptr, extent->offset - lastWritten);
-		optr = (uint32_t*) out + extent->offset / 4;
-		iptr = (uint32_t*) in + extent->offset / 4;
-		uint32_t* eptr = extent->extent;
+		memcpy(&optr[lastWritten], &iptr[lastWritten], extent->offset - lastWritten);
+		const uint8_t* eptr = (const uint8_t*) extent->extent;
+		size_t base = extent->offset;
 		size_t off;
 		for (off = 0; off < (extent->length & ~15); off += 16) {
-			optr[0] = iptr[0] ^ eptr[0];
-			optr[1] = iptr[1] ^ eptr[1];
-			optr[2] = iptr[2] ^ eptr[2];
-			optr[3] = iptr[3] ^ eptr[3];
-			optr += 4;
-			iptr += 4;
-			eptr += 4;
+			_fastXorBlock(&optr[base + off], &iptr[base + off], &eptr[off]);
 		}
 		for (; off < extent->length; ++off) {
-			*(uint8_t*) optr = *(uint8_t*) iptr ^ *(uint8_t*) eptr;
-			++optr;
-			++iptr;
-			++eptr;
+			optr[base + off] = iptr[base + off] ^ eptr[off];
 		}
-		lastWritten = extent->offset + off;
+		lastWritten = base + off;
 	}
-	memcpy(optr, iptr, outSize - lastWritten);
+	memcpy(&optr[lastWritten], &iptr[lastWritten], outSize - lastWritten);
 	return true;
 }
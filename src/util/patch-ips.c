@@ -10,6 +10,8 @@
 
 static size_t _IPSOutputSize(struct Patch* patch, size_t inSize);
 static bool _IPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize);
+static bool _IPSApplyPatchInPlace(struct Patch* patch, void* buffer, size_t size);
+static bool _IPSApplyRecords(struct Patch* patch, uint8_t* buf, size_t outSize, bool write);
 
 bool loadPatchIPS(struct Patch* patch) {
 	patch->vf->seek(patch->vf, 0, SEEK_SET);
@@ -34,6 +36,7 @@ bool loadPatchIPS(struct Patch* patch) {
 
 	patch->outputSize = _IPSOutputSize;
 	patch->applyPatch = _IPSApplyPatch;
+	patch->applyPatchInPlace = _IPSApplyPatchInPlace;
 	return true;
 }
 
@@ -44,11 +47,22 @@ size_t _IPSOutputSize(struct Patch* patch, size_t inSize) {
 }
 
 bool _IPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize) {
+	memcpy(out, in, inSize > outSize ? outSize : inSize);
+	return _IPSApplyRecords(patch, out, outSize, true);
+}
+
+bool _IPSApplyPatchInPlace(struct Patch* patch, void* buffer, size_t size) {
+	// Records can land anywhere, so make sure they all fit before touching the buffer
+	if (!_IPSApplyRecords(patch, NULL, size, false)) {
+		return false;
+	}
+	return _IPSApplyRecords(patch, buffer, size, true);
+}
+
+bool _IPSApplyRecords(struct Patch* patch, uint8_t* buf, size_t outSize, bool write) {
 	if (patch->vf->seek(patch->vf, 5, SEEK_SET) != 5) {
 		return false;
 	}
-	memcpy(out, in, inSize > outSize ? outSize : inSize);
-	uint8_t* buf = out;
 
 	while (true) {
 		uint32_t offset = 0;
@@ -79,13 +93,19 @@ bool _IPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* ou
 			if (offset + size > outSize) {
 				return false;
 			}
-			memset(&buf[offset], byte, size);
+			if (write) {
+				memset(&buf[offset], byte, size);
+			}
 		} else {
 			size = (size >> 8) | (size << 8);
 			if (offset + size > outSize) {
 				return false;
 			}
-			if (patch->vf->read(patch->vf, &buf[offset], size) != size) {
+			if (!write) {
+				if (patch->vf->seek(patch->vf, size, SEEK_CUR) < 0) {
+					return false;
+				}
+			} else if (patch->vf->read(patch->vf, &buf[offset], size) != size) {
 				return false;
 			}
 		}
@@ -18,6 +18,9 @@ enum {
 static size_t _UPSOutputSize(struct Patch* patch, size_t inSize);
 
 static bool _UPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize);
+static bool _UPSApplyPatchInPlace(struct Patch* patch, void* buffer, size_t size);
+static bool _UPSApplyRecords(struct Patch* patch, uint8_t* buf, const uint8_t* in, size_t inSize, size_t outSize, uint32_t* inCrc32, uint32_t* outCrc32);
+static bool _UPSVerify(struct Patch* patch, uint32_t inCrc32, uint32_t outCrc32);
 static bool _BPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize);
 
 static size_t _decodeLength(struct VFile* vf);
@@ -32,6 +35,7 @@ bool loadPatchUPS(struct Patch* patch) {
 
 	if (memcmp(buffer, "UPS1", 4) == 0) {
 		patch->applyPatch = _UPSApplyPatch;
+		patch->applyPatchInPlace = _UPSApplyPatchInPlace;
 	} else if (memcmp(buffer, "BPS1", 4) == 0) {
 		patch->applyPatch = _BPSApplyPatch;
 	} else {
@@ -65,9 +69,6 @@ size_t _UPSOutputSize(struct Patch* patch, size_t inSize) {
 }
 
 bool _UPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize) {
-	// TODO: Input checksum
-
-	size_t filesize = patch->vf->size(patch->vf);
 	patch->vf->seek(patch->vf, 4, SEEK_SET);
 	_decodeLength(patch->vf); // Discard input size
 	if (_decodeLength(patch->vf) != outSize) {
@@ -75,40 +76,113 @@ bool _UPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* ou
 	}
 
 	memcpy(out, in, inSize > outSize ? outSize : inSize);
+	uint32_t inCrc32;
+	uint32_t outCrc32;
+	if (!_UPSApplyRecords(patch, out, in, inSize, outSize, &inCrc32, &outCrc32)) {
+		return false;
+	}
+	return _UPSVerify(patch, inCrc32, outCrc32);
+}
+
+bool _UPSApplyPatchInPlace(struct Patch* patch, void* buffer, size_t size) {
+	patch->vf->seek(patch->vf, 4, SEEK_SET);
+	if (_decodeLength(patch->vf) != size || _decodeLength(patch->vf) != size) {
+		return false;
+	}
 
+	uint32_t inCrc32;
+	uint32_t outCrc32;
+	if (!_UPSApplyRecords(patch, buffer, buffer, size, size, &inCrc32, &outCrc32) || !_UPSVerify(patch, inCrc32, outCrc32)) {
+		// UPS records are XORs, so applying them again restores the input
+		patch->vf->seek(patch->vf, 4, SEEK_SET);
+		_decodeLength(patch->vf);
+		_decodeLength(patch->vf);
+		_UPSApplyRecords(patch, buffer, buffer, size, size, NULL, NULL);
+		return false;
+	}
+	return true;
+}
+
+static void _UPSChecksum(const uint8_t* buf, const uint8_t* in, size_t start, size_t end, size_t inSize, size_t outSize, uint32_t* inCrc32, uint32_t* outCrc32) {
+	if (!inCrc32) {
+		return;
+	}
+	if (start < outSize) {
+		*outCrc32 = crc32(*outCrc32, &buf[start], (end < outSize ? end : outSize) - start);
+	}
+	size_t inEnd = end < inSize ? end : inSize;
+	if (start < inEnd) {
+		// Past the end of the output, the input only survives in the source
+		size_t split = outSize < start ? start : outSize < inEnd ? outSize : inEnd;
+		*inCrc32 = crc32(*inCrc32, &buf[start], split - start);
+		*inCrc32 = crc32(*inCrc32, &in[split], inEnd - split);
+	}
+}
+
+bool _UPSApplyRecords(struct Patch* patch, uint8_t* buf, const uint8_t* in, size_t inSize, size_t outSize, uint32_t* inCrc32, uint32_t* outCrc32) {
+	// Expects the patch file to be positioned just after the sizes. Both checksums are accumulated in the
+	// same pass that applies the records, so the untouched parts of the buffer are only read once.
+	if (inCrc32) {
+		*inCrc32 = 0;
+		*outCrc32 = 0;
+	}
+	size_t filesize = patch->vf->size(patch->vf);
+	size_t alreadyRead = patch->vf->seek(patch->vf, 0, SEEK_CUR);
 	size_t offset = 0;
-	size_t alreadyRead = 0;
-	uint8_t* buf = out;
 	while (alreadyRead < filesize + IN_CHECKSUM) {
-		offset += _decodeLength(patch->vf);
-		uint8_t byte;
+		size_t skip = _decodeLength(patch->vf);
+		if (skip > outSize - offset) {
+			return false;
+		}
+		_UPSChecksum(buf, in, offset, offset + skip, inSize, outSize, inCrc32, outCrc32);
+		offset += skip;
 
-		while (true) {
-			if (patch->vf->read(patch->vf, &byte, 1) != 1) {
-				return false;
+		bool done = false;
+		while (!done) {
+			uint8_t chunk[256];
+			size_t length = 0;
+			while (length < sizeof(chunk) && !done) {
+				if (patch->vf->read(patch->vf, &chunk[length], 1) != 1) {
+					return false;
+				}
+				done = !chunk[length];
+				++length;
 			}
-			if (offset >= outSize) {
+			if (length > outSize - offset) {
 				return false;
 			}
-			buf[offset] ^= byte;
-			++offset;
-			if (!byte) {
-				break;
+			if (inCrc32 && offset < inSize) {
+				*inCrc32 = crc32(*inCrc32, &buf[offset], (offset + length < inSize ? offset + length : inSize) - offset);
+			}
+			size_t i;
+			for (i = 0; i < length; ++i) {
+				buf[offset + i] ^= chunk[i];
+			}
+			if (inCrc32) {
+				*outCrc32 = crc32(*outCrc32, &buf[offset], length);
 			}
+			offset += length;
 		}
 		alreadyRead = patch->vf->seek(patch->vf, 0, SEEK_CUR);
 	}
+	size_t end = inSize > outSize ? inSize : outSize;
+	_UPSChecksum(buf, in, offset, end, inSize, outSize, inCrc32, outCrc32);
+	return true;
+}
 
-	uint32_t goodCrc32;
-	patch->vf->seek(patch->vf, OUT_CHECKSUM, SEEK_END);
-	if (patch->vf->read(patch->vf, &goodCrc32, 4) != 4) {
+bool _UPSVerify(struct Patch* patch, uint32_t inCrc32, uint32_t outCrc32) {
+	uint32_t goodInCrc32;
+	uint32_t goodOutCrc32;
+	patch->vf->seek(patch->vf, IN_CHECKSUM, SEEK_END);
+	if (patch->vf->read(patch->vf, &goodInCrc32, 4) != 4 || patch->vf->read(patch->vf, &goodOutCrc32, 4) != 4) {
 		return false;
 	}
-
 	patch->vf->seek(patch->vf, 0, SEEK_SET);
-	if (doCrc32(out, outSize) != goodCrc32) {
+	if (inCrc32 != goodInCrc32 || outCrc32 != goodOutCrc32) {
 		return false;
 	}
+	patch->hasOutputCrc32 = true;
+	patch->outputCrc32 = outCrc32;
 	return true;
 }
 
@@ -205,6 +279,8 @@ bool _BPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* ou
 	if (expectedOutChecksum != outputChecksum) {
 		return false;
 	}
+	patch->hasOutputCrc32 = true;
+	patch->outputCrc32 = outputChecksum;
 	return true;
 }
 
@@ -10,6 +10,8 @@
 
 bool loadPatch(struct VFile* vf, struct Patch* patch) {
 	patch->vf = vf;
+	patch->applyPatchInPlace = NULL;
+	patch->hasOutputCrc32 = false;
 
 	if (loadPatchIPS(patch)) {
 		return true;
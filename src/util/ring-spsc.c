@@ -0,0 +1,127 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba-util/ring-spsc.h>
+
+#include <mgba-util/math.h>
+#include <mgba-util/memory.h>
+
+void RingSPSCInit(struct RingSPSC* ring, size_t capacity) {
+	capacity = toPow2(capacity);
+	ring->data = anonymousMemoryMap(capacity);
+	ring->mask = capacity - 1;
+	RingSPSCClear(ring);
+}
+
+void RingSPSCDeinit(struct RingSPSC* ring) {
+	mappedMemoryFree(ring->data, RingSPSCCapacity(ring));
+	ring->data = NULL;
+}
+
+size_t RingSPSCCapacity(const struct RingSPSC* ring) {
+	return (size_t) ring->mask + 1;
+}
+
+size_t RingSPSCSize(const struct RingSPSC* ring) {
+	uint32_t read;
+	uint32_t write;
+	ATOMIC_LOAD(read, ring->readIndex);
+	ATOMIC_LOAD(write, ring->writeIndex);
+	return write - read;
+}
+
+void RingSPSCClear(struct RingSPSC* ring) {
+	ATOMIC_STORE(ring->writeIndex, 0);
+	ATOMIC_STORE(ring->readIndex, 0);
+	ring->readIndexCache = 0;
+	ring->writeIndexCache = 0;
+}
+
+static size_t _freeSpace(struct RingSPSC* ring, size_t length) {
+	size_t capacity = RingSPSCCapacity(ring);
+	size_t available = capacity - (uint32_t) (ring->writeIndex - ring->readIndexCache);
+	if (available < length || !available) {
+		ATOMIC_LOAD(ring->readIndexCache, ring->readIndex);
+		available = capacity - (uint32_t) (ring->writeIndex - ring->readIndexCache);
+	}
+	return available;
+}
+
+static size_t _queuedSpace(struct RingSPSC* ring, size_t length) {
+	size_t available = (uint32_t) (ring->writeIndexCache - ring->readIndex);
+	if (available < length || !available) {
+		ATOMIC_LOAD(ring->writeIndexCache, ring->writeIndex);
+		available = (uint32_t) (ring->writeIndexCache - ring->readIndex);
+	}
+	return available;
+}
+
+void* RingSPSCReserve(struct RingSPSC* ring, size_t* length) {
+	size_t offset = ring->writeIndex & ring->mask;
+	size_t available = _freeSpace(ring, *length);
+	if (available > RingSPSCCapacity(ring) - offset) {
+		available = RingSPSCCapacity(ring) - offset;
+	}
+	if (!available || available < *length) {
+		return NULL;
+	}
+	*length = available;
+	return &ring->data[offset];
+}
+
+void RingSPSCCommit(struct RingSPSC* ring, size_t length) {
+	ATOMIC_STORE(ring->writeIndex, ring->writeIndex + (uint32_t) length);
+}
+
+const void* RingSPSCPeek(struct RingSPSC* ring, size_t* length) {
+	size_t offset = ring->readIndex & ring->mask;
+	size_t available = _queuedSpace(ring, *length);
+	if (available > RingSPSCCapacity(ring) - offset) {
+		available = RingSPSCCapacity(ring) - offset;
+	}
+	if (!available || available < *length) {
+		return NULL;
+	}
+	*length = available;
+	return &ring->data[offset];
+}
+
+void RingSPSCConsume(struct RingSPSC* ring, size_t length) {
+	ATOMIC_STORE(ring->readIndex, ring->readIndex + (uint32_t) length);
+}
+
+size_t RingSPSCWrite(struct RingSPSC* ring, const void* value, size_t length) {
+	if (!length || _freeSpace(ring, length) < length) {
+		return 0;
+	}
+	size_t offset = ring->writeIndex & ring->mask;
+	size_t first = RingSPSCCapacity(ring) - offset;
+	if (first > length) {
+		first = length;
+	}
+	if (value) {
+		memcpy(&ring->data[offset], value, first);
+		memcpy(ring->data, (const uint8_t*) value + first, length - first);
+	}
+	RingSPSCCommit(ring, length);
+	return length;
+}
+
+size_t RingSPSCRead(struct RingSPSC* ring, void* output, size_t length) {
+	if (!length || _queuedSpace(ring, length) < length) {
+		return 0;
+	}
+	size_t offset = ring->readIndex & ring->mask;
+	size_t first = RingSPSCCapacity(ring) - offset;
+	if (first > length) {
+		first = length;
+	}
+	if (output) {
+		memcpy(output, &ring->data[offset], first);
+		memcpy((uint8_t*) output + first, ring->data, length - first);
+	}
+	RingSPSCConsume(ring, length);
+	return length;
+}
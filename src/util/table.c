@@ -8,60 +8,134 @@
 #include <mgba-util/hash.h>
 #include <mgba-util/string.h>
 
-#define LIST_INITIAL_SIZE 8
 #define TABLE_INITIAL_SIZE 8
 
-#define TABLE_COMPARATOR(LIST, INDEX) LIST->list[(INDEX)].key == key
-#define HASH_TABLE_COMPARATOR(LIST, INDEX) LIST->list[(INDEX)].key == hash && strncmp(LIST->list[(INDEX)].stringKey, key, LIST->list[(INDEX)].keylen) == 0
-
-#define TABLE_LOOKUP_START(COMPARATOR, LIST, KEY) \
-	uint32_t entry = (KEY) & (table->tableSize - 1); \
-	LIST = &table->table[entry]; \
-	size_t i; \
-	for (i = 0; i < LIST->nEntries; ++i) { \
-		if (COMPARATOR(LIST, i)) { \
-			struct TableTuple* lookupResult = &LIST->list[i]; \
-			UNUSED(lookupResult);
-
-#define TABLE_LOOKUP_END \
-			break; \
-		} \
-	}
+// Tables are open-addressed with linear probing and Robin Hood displacement:
+// an entry being inserted takes the slot of any entry closer to its home slot,
+// which keeps probe sequences short and lets a lookup stop at the first entry
+// closer to home than itself. Removal shifts the following run back by one
+// instead of leaving tombstones.
+#define TABLE_MAX_LOAD(SIZE) ((SIZE) - ((SIZE) >> 2))
 
 struct TableTuple {
 	uint32_t key;
+	// Zero marks an empty slot, otherwise this is the probe distance plus one
+	uint32_t distance;
 	char* stringKey;
-	size_t keylen;
 	void* value;
 };
 
-struct TableList {
-	struct TableTuple* list;
-	size_t nEntries;
-	size_t listSize;
-};
+static inline size_t _home(const struct Table* table, uint32_t key) {
+	// Integer keys are often aligned addresses, so spread them before masking
+	key *= 0x9E3779B1;
+	key ^= key >> 16;
+	return key & (table->tableSize - 1);
+}
+
+static struct TableTuple* _lookupTuple(const struct Table* table, uint32_t key, const char* stringKey) {
+	size_t mask = table->tableSize - 1;
+	size_t i = _home(table, key);
+	uint32_t distance;
+	for (distance = 1;; ++distance, i = (i + 1) & mask) {
+		struct TableTuple* tuple = &table->table[i];
+		if (tuple->distance < distance) {
+			return NULL;
+		}
+		if (tuple->key == key && (!stringKey || strcmp(tuple->stringKey, stringKey) == 0)) {
+			return tuple;
+		}
+	}
+}
 
-static struct TableList* _resizeAsNeeded(struct Table* table, struct TableList* list, uint32_t key) {
-	UNUSED(table);
-	UNUSED(key);
-	// TODO: Expand table if needed
-	if (list->nEntries + 1 == list->listSize) {
-		list->listSize *= 2;
-		list->list = realloc(list->list, list->listSize * sizeof(struct TableTuple));
+static void _placeTuple(struct Table* table, struct TableTuple tuple) {
+	size_t mask = table->tableSize - 1;
+	size_t i = _home(table, tuple.key);
+	tuple.distance = 1;
+	for (;; ++tuple.distance, i = (i + 1) & mask) {
+		struct TableTuple* slot = &table->table[i];
+		if (!slot->distance) {
+			*slot = tuple;
+			return;
+		}
+		if (slot->distance < tuple.distance) {
+			struct TableTuple displaced = *slot;
+			*slot = tuple;
+			tuple = displaced;
+		}
 	}
-	return list;
 }
 
-static void _removeItemFromList(struct Table* table, struct TableList* list, size_t item) {
-	--list->nEntries;
+static void _resize(struct Table* table, size_t tableSize) {
+	struct TableTuple* old = table->table;
+	size_t oldSize = table->tableSize;
+	table->table = calloc(tableSize, sizeof(struct TableTuple));
+	table->tableSize = tableSize;
+	size_t i;
+	for (i = 0; i < oldSize; ++i) {
+		if (old[i].distance) {
+			_placeTuple(table, old[i]);
+		}
+	}
+	free(old);
+}
+
+static void _insertTuple(struct Table* table, uint32_t key, char* stringKey, void* value) {
+	if (table->size + 1 > TABLE_MAX_LOAD(table->tableSize)) {
+		_resize(table, table->tableSize * 2);
+	}
+	struct TableTuple tuple = {
+		.key = key,
+		.stringKey = stringKey,
+		.value = value
+	};
+	_placeTuple(table, tuple);
+	++table->size;
+}
+
+static void _replaceValue(struct Table* table, struct TableTuple* tuple, void* value) {
+	if (value != tuple->value) {
+		if (table->deinitializer) {
+			table->deinitializer(tuple->value);
+		}
+		tuple->value = value;
+	}
+}
+
+static void _removeTuple(struct Table* table, struct TableTuple* tuple) {
 	--table->size;
-	free(list->list[item].stringKey);
+	free(tuple->stringKey);
 	if (table->deinitializer) {
-		table->deinitializer(list->list[item].value);
+		table->deinitializer(tuple->value);
 	}
-	if (item != list->nEntries) {
-		list->list[item] = list->list[list->nEntries];
+
+	size_t mask = table->tableSize - 1;
+	size_t i = tuple - table->table;
+	while (true) {
+		size_t next = (i + 1) & mask;
+		if (table->table[next].distance <= 1) {
+			break;
+		}
+		table->table[i] = table->table[next];
+		--table->table[i].distance;
+		i = next;
+	}
+	memset(&table->table[i], 0, sizeof(struct TableTuple));
+}
+
+static void _clear(struct Table* table) {
+	size_t i;
+	for (i = 0; i < table->tableSize; ++i) {
+		struct TableTuple* tuple = &table->table[i];
+		if (!tuple->distance) {
+			continue;
+		}
+		free(tuple->stringKey);
+		if (table->deinitializer) {
+			table->deinitializer(tuple->value);
+		}
 	}
+	memset(table->table, 0, table->tableSize * sizeof(struct TableTuple));
+	table->size = 0;
 }
 
 void TableInit(struct Table* table, size_t initialSize, void (deinitializer(void*))) {
@@ -69,94 +143,62 @@ void TableInit(struct Table* table, size_t initialSize, void (deinitializer(void
 		initialSize = TABLE_INITIAL_SIZE;
 	}
 	table->tableSize = initialSize;
-	table->table = calloc(table->tableSize, sizeof(struct TableList));
+	table->table = calloc(table->tableSize, sizeof(struct TableTuple));
 	table->size = 0;
 	table->deinitializer = deinitializer;
-
-	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		table->table[i].listSize = LIST_INITIAL_SIZE;
-		table->table[i].nEntries = 0;
-		table->table[i].list = calloc(LIST_INITIAL_SIZE, sizeof(struct TableTuple));
-	}
 }
 
 void TableDeinit(struct Table* table) {
-	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			free(list->list[j].stringKey);
-			if (table->deinitializer) {
-				table->deinitializer(list->list[j].value);
-			}
-		}
-		free(list->list);
-	}
+	_clear(table);
 	free(table->table);
 	table->table = 0;
 	table->tableSize = 0;
 }
 
+void TableReserve(struct Table* table, size_t count) {
+	size_t tableSize = table->tableSize;
+	while (count > TABLE_MAX_LOAD(tableSize)) {
+		tableSize *= 2;
+	}
+	if (tableSize != table->tableSize) {
+		_resize(table, tableSize);
+	}
+}
+
 void* TableLookup(const struct Table* table, uint32_t key) {
-	const struct TableList* list;
-	TABLE_LOOKUP_START(TABLE_COMPARATOR, list, key) {
-		return lookupResult->value;
-	} TABLE_LOOKUP_END;
-	return 0;
+	const struct TableTuple* tuple = _lookupTuple(table, key, NULL);
+	if (!tuple) {
+		return 0;
+	}
+	return tuple->value;
 }
 
 void TableInsert(struct Table* table, uint32_t key, void* value) {
-	struct TableList* list;
-	TABLE_LOOKUP_START(TABLE_COMPARATOR, list, key) {
-		if (value != lookupResult->value) {
-			if (table->deinitializer) {
-				table->deinitializer(lookupResult->value);
-			}
-			lookupResult->value = value;
-		}
+	struct TableTuple* tuple = _lookupTuple(table, key, NULL);
+	if (tuple) {
+		_replaceValue(table, tuple, value);
 		return;
-	} TABLE_LOOKUP_END;
-	list = _resizeAsNeeded(table, list, key);
-	list->list[list->nEntries].key = key;
-	list->list[list->nEntries].stringKey = 0;
-	list->list[list->nEntries].value = value;
-	++list->nEntries;
-	++table->size;
+	}
+	_insertTuple(table, key, NULL, value);
 }
 
 void TableRemove(struct Table* table, uint32_t key) {
-	struct TableList* list;
-	TABLE_LOOKUP_START(TABLE_COMPARATOR, list, key) {
-		_removeItemFromList(table, list, i); // TODO: Move i out of the macro
-	} TABLE_LOOKUP_END;
+	struct TableTuple* tuple = _lookupTuple(table, key, NULL);
+	if (tuple) {
+		_removeTuple(table, tuple);
+	}
 }
 
 void TableClear(struct Table* table) {
-	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		struct TableList* list = &table->table[i];
-		if (table->deinitializer) {
-			size_t j;
-			for (j = 0; j < list->nEntries; ++j) {
-				table->deinitializer(list->list[j].value);
-			}
-		}
-		free(list->list);
-		list->listSize = LIST_INITIAL_SIZE;
-		list->nEntries = 0;
-		list->list = calloc(LIST_INITIAL_SIZE, sizeof(struct TableTuple));
-	}
+	_clear(table);
 }
 
 void TableEnumerate(const struct Table* table, void (handler(uint32_t key, void* value, void* user)), void* user) {
 	size_t i;
 	for (i = 0; i < table->tableSize; ++i) {
-		const struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			handler(list->list[j].key, list->list[j].value, user);
+		const struct TableTuple* tuple = &table->table[i];
+		if (tuple->distance) {
+			handler(tuple->key, tuple->value, user);
 		}
 	}
 }
@@ -173,67 +215,47 @@ void HashTableDeinit(struct Table* table) {
 	TableDeinit(table);
 }
 
+void HashTableReserve(struct Table* table, size_t count) {
+	TableReserve(table, count);
+}
+
 void* HashTableLookup(const struct Table* table, const char* key) {
 	uint32_t hash = hash32(key, strlen(key), 0);
-	const struct TableList* list;
-	TABLE_LOOKUP_START(HASH_TABLE_COMPARATOR, list, hash) {
-		return lookupResult->value;
-	} TABLE_LOOKUP_END;
-	return 0;
+	const struct TableTuple* tuple = _lookupTuple(table, hash, key);
+	if (!tuple) {
+		return 0;
+	}
+	return tuple->value;
 }
 
 void HashTableInsert(struct Table* table, const char* key, void* value) {
 	uint32_t hash = hash32(key, strlen(key), 0);
-	struct TableList* list;
-	TABLE_LOOKUP_START(HASH_TABLE_COMPARATOR, list, hash) {
-		if (value != lookupResult->value) {
-			table->deinitializer(lookupResult->value);
-			lookupResult->value = value;
-		}
+	struct TableTuple* tuple = _lookupTuple(table, hash, key);
+	if (tuple) {
+		_replaceValue(table, tuple, value);
 		return;
-	} TABLE_LOOKUP_END;
-	list = _resizeAsNeeded(table, list, hash);
-	list->list[list->nEntries].key = hash;
-	list->list[list->nEntries].stringKey = strdup(key);
-	list->list[list->nEntries].keylen = strlen(key);
-	list->list[list->nEntries].value = value;
-	++list->nEntries;
-	++table->size;
+	}
+	_insertTuple(table, hash, strdup(key), value);
 }
 
 void HashTableRemove(struct Table* table, const char* key) {
 	uint32_t hash = hash32(key, strlen(key), 0);
-	struct TableList* list;
-	TABLE_LOOKUP_START(HASH_TABLE_COMPARATOR, list, hash) {
-		_removeItemFromList(table, list, i); // TODO: Move i out of the macro
-	} TABLE_LOOKUP_END;
+	struct TableTuple* tuple = _lookupTuple(table, hash, key);
+	if (tuple) {
+		_removeTuple(table, tuple);
+	}
 }
 
 void HashTableClear(struct Table* table) {
-	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			if (table->deinitializer) {
-				table->deinitializer(list->list[j].value);
-			}
-			free(list->list[j].stringKey);
-		}
-		free(list->list);
-		list->listSize = LIST_INITIAL_SIZE;
-		list->nEntries = 0;
-		list->list = calloc(LIST_INITIAL_SIZE, sizeof(struct TableTuple));
-	}
+	_clear(table);
 }
 
 void HashTableEnumerate(const struct Table* table, void (handler(const char* key, void* value, void* user)), void* user) {
 	size_t i;
 	for (i = 0; i < table->tableSize; ++i) {
-		const struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			handler(list->list[j].stringKey, list->list[j].value, user);
+		const struct TableTuple* tuple = &table->table[i];
+		if (tuple->distance) {
+			handler(tuple->stringKey, tuple->value, user);
 		}
 	}
 }
@@ -0,0 +1,78 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/circle-buffer.h>
+
+M_TEST_DEFINE(maskedCapacity) {
+	struct CircleBufferMasked buffer;
+	CircleBufferMaskedInit(&buffer, 24);
+	assert_int_equal(CircleBufferMaskedCapacity(&buffer), 32);
+	assert_int_equal(CircleBufferMaskedSize(&buffer), 0);
+	CircleBufferMaskedDeinit(&buffer);
+}
+
+M_TEST_DEFINE(maskedBytes) {
+	struct CircleBufferMasked buffer;
+	CircleBufferMaskedInit(&buffer, 4);
+	int8_t value;
+	assert_int_equal(CircleBufferMaskedRead8(&buffer, &value), 0);
+	int i;
+	for (i = 0; i < 4; ++i) {
+		assert_int_equal(CircleBufferMaskedWrite8(&buffer, i), 1);
+	}
+	assert_int_equal(CircleBufferMaskedWrite8(&buffer, 4), 0);
+	for (i = 0; i < 4; ++i) {
+		assert_int_equal(CircleBufferMaskedRead8(&buffer, &value), 1);
+		assert_int_equal(value, i);
+	}
+	assert_int_equal(CircleBufferMaskedRead8(&buffer, &value), 0);
+	CircleBufferMaskedDeinit(&buffer);
+}
+
+M_TEST_DEFINE(maskedWrap) {
+	struct CircleBufferMasked buffer;
+	CircleBufferMaskedInit(&buffer, 32);
+	uint8_t in[12];
+	uint8_t out[12];
+	int i;
+	for (i = 0; i < 100; ++i) {
+		memset(in, i, sizeof(in));
+		in[0] = ~i;
+		assert_int_equal(CircleBufferMaskedWrite(&buffer, in, sizeof(in)), sizeof(in));
+		assert_int_equal(CircleBufferMaskedSize(&buffer), sizeof(in));
+		assert_int_equal(CircleBufferMaskedPeek(&buffer, out, sizeof(out)), sizeof(out));
+		assert_memory_equal(in, out, sizeof(in));
+		memset(out, 0, sizeof(out));
+		assert_int_equal(CircleBufferMaskedRead(&buffer, out, sizeof(out)), sizeof(out));
+		assert_memory_equal(in, out, sizeof(in));
+		assert_int_equal(CircleBufferMaskedSize(&buffer), 0);
+	}
+	CircleBufferMaskedDeinit(&buffer);
+}
+
+M_TEST_DEFINE(maskedPartial) {
+	struct CircleBufferMasked buffer;
+	CircleBufferMaskedInit(&buffer, 16);
+	uint8_t data[16] = { 0 };
+	assert_int_equal(CircleBufferMaskedWrite(&buffer, data, 10), 10);
+	assert_int_equal(CircleBufferMaskedWrite(&buffer, data, 7), 0);
+	assert_int_equal(CircleBufferMaskedWrite(&buffer, data, 6), 6);
+	assert_int_equal(CircleBufferMaskedSize(&buffer), 16);
+	assert_int_equal(CircleBufferMaskedDiscard(&buffer, 4), 4);
+	assert_int_equal(CircleBufferMaskedRead(&buffer, data, sizeof(data)), 12);
+	assert_int_equal(CircleBufferMaskedDiscard(&buffer, 4), 0);
+	assert_int_equal(CircleBufferMaskedWrite(&buffer, data, 17), 0);
+	CircleBufferMaskedClear(&buffer);
+	assert_int_equal(CircleBufferMaskedSize(&buffer), 0);
+	CircleBufferMaskedDeinit(&buffer);
+}
+
+M_TEST_SUITE_DEFINE(CircleBuffer,
+	cmocka_unit_test(maskedCapacity),
+	cmocka_unit_test(maskedBytes),
+	cmocka_unit_test(maskedWrap),
+	cmocka_unit_test(maskedPartial))
@@ -0,0 +1,73 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/crc32.h>
+#include <mgba-util/vfs.h>
+
+#define BUFFER_SIZE 0x1040
+
+static uint32_t _referenceCrc32(const uint8_t* buffer, size_t size) {
+	uint32_t crc = 0xFFFFFFFF;
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		crc ^= buffer[i];
+		int bit;
+		for (bit = 0; bit < 8; ++bit) {
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+		}
+	}
+	return ~crc;
+}
+
+static void _fill(uint8_t* buffer, size_t size, uint32_t seed) {
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		seed = seed * 1103515245 + 12345;
+		buffer[i] = seed >> 16;
+	}
+}
+
+M_TEST_DEFINE(checkValue) {
+	assert_int_equal(doCrc32("123456789", 9), 0xCBF43926);
+	assert_int_equal(doCrc32("", 0), 0);
+}
+
+M_TEST_DEFINE(lengthsAndAlignments) {
+	static uint8_t buffer[BUFFER_SIZE + 16];
+	_fill(buffer, sizeof(buffer), 1);
+	size_t offset;
+	for (offset = 0; offset < 16; offset += 3) {
+		size_t size;
+		for (size = 0; size <= 256; ++size) {
+			assert_int_equal(doCrc32(&buffer[offset], size), _referenceCrc32(&buffer[offset], size));
+		}
+		for (size = 0x1000 - 17; size <= BUFFER_SIZE; size += 7) {
+			assert_int_equal(doCrc32(&buffer[offset], size), _referenceCrc32(&buffer[offset], size));
+		}
+	}
+}
+
+M_TEST_DEFINE(fileChunks) {
+	static uint8_t buffer[0x9123];
+	_fill(buffer, sizeof(buffer), 2);
+	uint32_t expected = _referenceCrc32(buffer, sizeof(buffer));
+	assert_int_equal(doCrc32(buffer, sizeof(buffer)), expected);
+
+	struct VFile* vf = VFileFromConstMemory(buffer, sizeof(buffer));
+	assert_int_equal(fileCrc32(vf, sizeof(buffer)), expected);
+	assert_int_equal(fileCrc32(vf, 100), _referenceCrc32(buffer, 100));
+	vf->close(vf);
+
+	uint32_t crc = crc32(0, buffer, 0x1001);
+	crc = crc32(crc, &buffer[0x1001], sizeof(buffer) - 0x1001);
+	assert_int_equal(crc, expected);
+}
+
+M_TEST_SUITE_DEFINE(Crc32,
+	cmocka_unit_test(checkValue),
+	cmocka_unit_test(lengthsAndAlignments),
+	cmocka_unit_test(fileChunks))
@@ -0,0 +1,95 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/patch/fast.h>
+
+#define BUFFER_SIZE 0x4013
+
+struct PatchFastTestContext {
+	struct PatchFast patch;
+	uint32_t in[BUFFER_SIZE / 4 + 1];
+	uint32_t out[BUFFER_SIZE / 4 + 1];
+	uint32_t result[BUFFER_SIZE / 4 + 1];
+};
+
+static void _fill(void* buffer, size_t size, uint32_t seed) {
+	uint8_t* bytes = buffer;
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		seed = seed * 1103515245 + 12345;
+		bytes[i] = seed >> 16;
+	}
+}
+
+static void _roundTrip(struct PatchFastTestContext* ctx, size_t size) {
+	assert_true(diffPatchFast(&ctx->patch, ctx->in, ctx->out, size));
+	memset(ctx->result, 0, sizeof(ctx->result));
+	assert_true(ctx->patch.d.applyPatch(&ctx->patch.d, ctx->in, size, ctx->result, size));
+	assert_memory_equal(ctx->result, ctx->out, size);
+}
+
+M_TEST_SUITE_SETUP(PatchFast) {
+	struct PatchFastTestContext* ctx = calloc(1, sizeof(*ctx));
+	initPatchFast(&ctx->patch);
+	*state = ctx;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(PatchFast) {
+	struct PatchFastTestContext* ctx = *state;
+	deinitPatchFast(&ctx->patch);
+	free(ctx);
+	return 0;
+}
+
+M_TEST_DEFINE(identical) {
+	struct PatchFastTestContext* ctx = *state;
+	_fill(ctx->in, BUFFER_SIZE, 1);
+	memcpy(ctx->out, ctx->in, BUFFER_SIZE);
+	_roundTrip(ctx, BUFFER_SIZE);
+	assert_int_equal(PatchFastExtentsSize(&ctx->patch.extents), 0);
+}
+
+M_TEST_DEFINE(sparse) {
+	struct PatchFastTestContext* ctx = *state;
+	_fill(ctx->in, BUFFER_SIZE, 2);
+	memcpy(ctx->out, ctx->in, BUFFER_SIZE);
+	uint8_t* out = (uint8_t*) ctx->out;
+	out[0] ^= 1;
+	out[0x47] ^= 0x80;
+	out[0x2000] ^= 0x10;
+	out[BUFFER_SIZE - 1] ^= 0xFF;
+	_roundTrip(ctx, BUFFER_SIZE);
+	assert_int_equal(PatchFastExtentsSize(&ctx->patch.extents), 4);
+	assert_int_equal(PatchFastExtentsGetPointer(&ctx->patch.extents, 1)->offset, 0x40);
+	assert_int_equal(PatchFastExtentsGetPointer(&ctx->patch.extents, 3)->offset, BUFFER_SIZE - 1);
+}
+
+M_TEST_DEFINE(dense) {
+	struct PatchFastTestContext* ctx = *state;
+	_fill(ctx->in, BUFFER_SIZE, 3);
+	_fill(ctx->out, BUFFER_SIZE, 4);
+	_roundTrip(ctx, BUFFER_SIZE);
+	struct PatchFastExtent* extent = PatchFastExtentsGetPointer(&ctx->patch.extents, 0);
+	assert_int_equal(extent->length, PATCH_FAST_EXTENT * 4);
+}
+
+M_TEST_DEFINE(unalignedSizes) {
+	struct PatchFastTestContext* ctx = *state;
+	size_t size;
+	for (size = 1; size < 80; ++size) {
+		_fill(ctx->in, size, size);
+		_fill(ctx->out, size, size * 2);
+		_roundTrip(ctx, size);
+	}
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(PatchFast,
+	cmocka_unit_test(identical),
+	cmocka_unit_test(sparse),
+	cmocka_unit_test(dense),
+	cmocka_unit_test(unalignedSizes))
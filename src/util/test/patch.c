@@ -0,0 +1,184 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/crc32.h>
+#include <mgba-util/patch.h>
+#include <mgba-util/vfs.h>
+
+#define ROM_SIZE 0x4000
+
+static void _fillRom(uint8_t* rom) {
+	size_t i;
+	for (i = 0; i < ROM_SIZE; ++i) {
+		rom[i] = i * 7 + (i >> 8);
+	}
+}
+
+static void _patchRom(uint8_t* rom) {
+	memcpy(&rom[0x10], "PATCHED", 7);
+	memset(&rom[0x1800], 0xAA, 0x300);
+	rom[0x3FF0] ^= 0x55;
+}
+
+static struct VFile* _makeIPS(void) {
+	static const uint8_t ips[] = {
+		'P', 'A', 'T', 'C', 'H',
+		0x00, 0x00, 0x10, 0x00, 0x07, 'P', 'A', 'T', 'C', 'H', 'E', 'D',
+		0x00, 0x18, 0x00, 0x00, 0x00, 0x03, 0x00, 0xAA,
+		0x00, 0x3F, 0xF0, 0x00, 0x01, 0x00,
+		'E', 'O', 'F'
+	};
+	struct VFile* vf = VFileMemChunk(ips, sizeof(ips));
+	uint8_t byte;
+	uint8_t rom[ROM_SIZE];
+	_fillRom(rom);
+	byte = rom[0x3FF0] ^ 0x55;
+	vf->seek(vf, 30, SEEK_SET);
+	vf->write(vf, &byte, 1);
+	return vf;
+}
+
+static void _writeLength(struct VFile* vf, size_t value) {
+	while (true) {
+		uint8_t byte = value & 0x7F;
+		value >>= 7;
+		if (!value) {
+			byte |= 0x80;
+			vf->write(vf, &byte, 1);
+			break;
+		}
+		vf->write(vf, &byte, 1);
+		--value;
+	}
+}
+
+static struct VFile* _makeUPS(const uint8_t* in, const uint8_t* out, size_t size) {
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	vf->write(vf, "UPS1", 4);
+	_writeLength(vf, size);
+	_writeLength(vf, size);
+	size_t offset = 0;
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		if (in[i] == out[i]) {
+			continue;
+		}
+		_writeLength(vf, i - offset);
+		for (; i < size; ++i) {
+			uint8_t byte = in[i] ^ out[i];
+			vf->write(vf, &byte, 1);
+			if (!byte) {
+				break;
+			}
+		}
+		offset = i + 1;
+	}
+	uint8_t crcs[12];
+	uint32_t crc = doCrc32(in, size);
+	STORE_32LE(crc, 0, crcs);
+	crc = doCrc32(out, size);
+	STORE_32LE(crc, 4, crcs);
+	vf->write(vf, crcs, 8);
+	crc = fileCrc32(vf, vf->size(vf));
+	STORE_32LE(crc, 8, crcs);
+	vf->seek(vf, 0, SEEK_END);
+	vf->write(vf, &crcs[8], 4);
+	return vf;
+}
+
+M_TEST_DEFINE(ipsInPlace) {
+	uint8_t rom[ROM_SIZE];
+	uint8_t expected[ROM_SIZE];
+	_fillRom(rom);
+	_fillRom(expected);
+	_patchRom(expected);
+
+	struct Patch patch;
+	struct VFile* vf = _makeIPS();
+	assert_true(loadPatch(vf, &patch));
+	assert_non_null(patch.applyPatchInPlace);
+	assert_true(patch.applyPatchInPlace(&patch, rom, sizeof(rom)));
+	assert_memory_equal(rom, expected, sizeof(rom));
+
+	uint8_t* copy = calloc(1, patch.outputSize(&patch, ROM_SIZE));
+	_fillRom(rom);
+	assert_true(patch.applyPatch(&patch, rom, sizeof(rom), copy, patch.outputSize(&patch, ROM_SIZE)));
+	assert_memory_equal(copy, expected, sizeof(expected));
+	assert_false(patch.hasOutputCrc32);
+	free(copy);
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(ipsInPlaceTooLarge) {
+	uint8_t rom[ROM_SIZE];
+	uint8_t pristine[ROM_SIZE];
+	_fillRom(rom);
+	_fillRom(pristine);
+
+	struct Patch patch;
+	struct VFile* vf = _makeIPS();
+	assert_true(loadPatch(vf, &patch));
+	// The last record is past the end, so none of them may be applied
+	assert_false(patch.applyPatchInPlace(&patch, rom, 0x3FF0));
+	assert_memory_equal(rom, pristine, sizeof(rom));
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(upsInPlace) {
+	uint8_t rom[ROM_SIZE];
+	uint8_t expected[ROM_SIZE];
+	_fillRom(rom);
+	_fillRom(expected);
+	_patchRom(expected);
+
+	struct Patch patch;
+	struct VFile* vf = _makeUPS(rom, expected, ROM_SIZE);
+	assert_true(loadPatch(vf, &patch));
+	assert_non_null(patch.applyPatchInPlace);
+	assert_true(patch.applyPatchInPlace(&patch, rom, sizeof(rom)));
+	assert_memory_equal(rom, expected, sizeof(rom));
+	assert_true(patch.hasOutputCrc32);
+	assert_int_equal(patch.outputCrc32, doCrc32(expected, sizeof(expected)));
+
+	uint8_t copy[ROM_SIZE];
+	patch.hasOutputCrc32 = false;
+	_fillRom(rom);
+	assert_int_equal(patch.outputSize(&patch, ROM_SIZE), ROM_SIZE);
+	assert_true(patch.applyPatch(&patch, rom, sizeof(rom), copy, sizeof(copy)));
+	assert_memory_equal(copy, expected, sizeof(expected));
+	assert_true(patch.hasOutputCrc32);
+	assert_int_equal(patch.outputCrc32, doCrc32(expected, sizeof(expected)));
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(upsInPlaceWrongInput) {
+	uint8_t rom[ROM_SIZE];
+	uint8_t expected[ROM_SIZE];
+	_fillRom(rom);
+	_fillRom(expected);
+	_patchRom(expected);
+
+	struct Patch patch;
+	struct VFile* vf = _makeUPS(rom, expected, ROM_SIZE);
+	assert_true(loadPatch(vf, &patch));
+
+	uint8_t other[ROM_SIZE];
+	uint8_t pristine[ROM_SIZE];
+	_fillRom(other);
+	other[0x2000] ^= 1;
+	memcpy(pristine, other, sizeof(other));
+	assert_false(patch.applyPatchInPlace(&patch, other, sizeof(other)));
+	assert_memory_equal(other, pristine, sizeof(other));
+	assert_false(patch.applyPatchInPlace(&patch, rom, 0x2000));
+	vf->close(vf);
+}
+
+M_TEST_SUITE_DEFINE(Patch,
+	cmocka_unit_test(ipsInPlace),
+	cmocka_unit_test(ipsInPlaceTooLarge),
+	cmocka_unit_test(upsInPlace),
+	cmocka_unit_test(upsInPlaceWrongInput))
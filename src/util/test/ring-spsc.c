@@ -0,0 +1,88 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/ring-spsc.h>
+
+M_TEST_DEFINE(capacity) {
+	struct RingSPSC ring;
+	RingSPSCInit(&ring, 1000);
+	assert_int_equal(RingSPSCCapacity(&ring), 1024);
+	assert_int_equal(RingSPSCSize(&ring), 0);
+	RingSPSCDeinit(&ring);
+}
+
+M_TEST_DEFINE(wrap) {
+	struct RingSPSC ring;
+	RingSPSCInit(&ring, 16);
+	uint8_t in[12];
+	uint8_t out[12];
+	int i;
+	for (i = 0; i < 100; ++i) {
+		memset(in, i, sizeof(in));
+		assert_int_equal(RingSPSCWrite(&ring, in, sizeof(in)), sizeof(in));
+		assert_int_equal(RingSPSCSize(&ring), sizeof(in));
+		assert_int_equal(RingSPSCRead(&ring, out, sizeof(out)), sizeof(out));
+		assert_memory_equal(in, out, sizeof(in));
+	}
+	RingSPSCDeinit(&ring);
+}
+
+M_TEST_DEFINE(allOrNothing) {
+	struct RingSPSC ring;
+	RingSPSCInit(&ring, 16);
+	uint8_t buffer[16] = { 0 };
+	assert_int_equal(RingSPSCRead(&ring, buffer, 1), 0);
+	assert_int_equal(RingSPSCWrite(&ring, buffer, 10), 10);
+	assert_int_equal(RingSPSCWrite(&ring, buffer, 7), 0);
+	assert_int_equal(RingSPSCWrite(&ring, buffer, 6), 6);
+	assert_int_equal(RingSPSCSize(&ring), 16);
+	assert_int_equal(RingSPSCWrite(&ring, buffer, 1), 0);
+	assert_int_equal(RingSPSCRead(&ring, buffer, 16), 16);
+	assert_int_equal(RingSPSCWrite(&ring, buffer, 17), 0);
+	RingSPSCDeinit(&ring);
+}
+
+M_TEST_DEFINE(reserveCommit) {
+	struct RingSPSC ring;
+	RingSPSCInit(&ring, 16);
+	size_t length = 1;
+	uint8_t* span = RingSPSCReserve(&ring, &length);
+	assert_non_null(span);
+	assert_int_equal(length, 16);
+	memcpy(span, "0123456789", 10);
+	length = 1;
+	assert_null(RingSPSCPeek(&ring, &length));
+	RingSPSCCommit(&ring, 10);
+
+	length = 4;
+	const uint8_t* queued = RingSPSCPeek(&ring, &length);
+	assert_non_null(queued);
+	assert_int_equal(length, 10);
+	assert_memory_equal(queued, "0123", 4);
+	RingSPSCConsume(&ring, 8);
+
+	// Only 6 bytes are contiguous before the end, even though 14 are free
+	length = 7;
+	assert_null(RingSPSCReserve(&ring, &length));
+	length = 1;
+	span = RingSPSCReserve(&ring, &length);
+	assert_int_equal(length, 6);
+	memcpy(span, "abcdef", 6);
+	RingSPSCCommit(&ring, 6);
+	assert_int_equal(RingSPSCWrite(&ring, "ghij", 4), 4);
+
+	uint8_t out[12];
+	assert_int_equal(RingSPSCRead(&ring, out, sizeof(out)), sizeof(out));
+	assert_memory_equal(out, "89abcdefghij", sizeof(out));
+	RingSPSCDeinit(&ring);
+}
+
+M_TEST_SUITE_DEFINE(RingSPSC,
+	cmocka_unit_test(capacity),
+	cmocka_unit_test(wrap),
+	cmocka_unit_test(allOrNothing),
+	cmocka_unit_test(reserveCommit))
@@ -0,0 +1,150 @@
+/* Copyright (c) 2013-2019 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/table.h>
+
+#define N_ENTRIES 5000
+
+static int _deinitCount;
+
+static void _countDeinit(void* value) {
+	UNUSED(value);
+	++_deinitCount;
+}
+
+static void _sumKeys(uint32_t key, void* value, void* user) {
+	assert_ptr_equal(value, (void*) (uintptr_t) (key + 1));
+	*(uint64_t*) user += key;
+}
+
+static void _countEntries(const char* key, void* value, void* user) {
+	assert_string_equal(key, value);
+	++*(size_t*) user;
+}
+
+M_TEST_DEFINE(insertLookupRemove) {
+	struct Table table;
+	TableInit(&table, 0, NULL);
+	uint32_t i;
+	for (i = 0; i < N_ENTRIES; ++i) {
+		TableInsert(&table, 0x08000000 + i * 4, (void*) (uintptr_t) (0x08000000 + i * 4 + 1));
+	}
+	assert_int_equal(TableSize(&table), N_ENTRIES);
+	for (i = 0; i < N_ENTRIES; ++i) {
+		assert_ptr_equal(TableLookup(&table, 0x08000000 + i * 4), (void*) (uintptr_t) (0x08000000 + i * 4 + 1));
+		assert_null(TableLookup(&table, 0x08000000 + i * 4 + 2));
+	}
+
+	for (i = 0; i < N_ENTRIES; i += 2) {
+		TableRemove(&table, 0x08000000 + i * 4);
+	}
+	assert_int_equal(TableSize(&table), N_ENTRIES / 2);
+	for (i = 0; i < N_ENTRIES; ++i) {
+		if (i & 1) {
+			assert_ptr_equal(TableLookup(&table, 0x08000000 + i * 4), (void*) (uintptr_t) (0x08000000 + i * 4 + 1));
+		} else {
+			assert_null(TableLookup(&table, 0x08000000 + i * 4));
+		}
+	}
+
+	uint64_t sum = 0;
+	uint64_t expected = 0;
+	for (i = 1; i < N_ENTRIES; i += 2) {
+		expected += 0x08000000 + i * 4;
+	}
+	TableEnumerate(&table, _sumKeys, &sum);
+	assert_int_equal(sum, expected);
+	TableDeinit(&table);
+}
+
+M_TEST_DEFINE(replaceAndClear) {
+	struct Table table;
+	TableInit(&table, 4, _countDeinit);
+	_deinitCount = 0;
+	TableInsert(&table, 1, &table);
+	TableInsert(&table, 1, &table);
+	assert_int_equal(_deinitCount, 0);
+	TableInsert(&table, 1, &_deinitCount);
+	assert_int_equal(_deinitCount, 1);
+	assert_int_equal(TableSize(&table), 1);
+
+	uint32_t i;
+	for (i = 2; i < 100; ++i) {
+		TableInsert(&table, i, &table);
+	}
+	TableClear(&table);
+	assert_int_equal(_deinitCount, 100);
+	assert_int_equal(TableSize(&table), 0);
+	assert_null(TableLookup(&table, 1));
+	TableInsert(&table, 1, &table);
+	assert_ptr_equal(TableLookup(&table, 1), &table);
+	TableDeinit(&table);
+	assert_int_equal(_deinitCount, 101);
+}
+
+M_TEST_DEFINE(hashTableKeys) {
+	static char keys[N_ENTRIES][16];
+	struct Table table;
+	HashTableInit(&table, 0, NULL);
+	size_t i;
+	for (i = 0; i < N_ENTRIES; ++i) {
+		snprintf(keys[i], sizeof(keys[i]), "key%u", (unsigned) i);
+		HashTableInsert(&table, keys[i], keys[i]);
+	}
+	assert_int_equal(HashTableSize(&table), N_ENTRIES);
+	for (i = 0; i < N_ENTRIES; ++i) {
+		assert_ptr_equal(HashTableLookup(&table, keys[i]), keys[i]);
+	}
+	assert_null(HashTableLookup(&table, "key"));
+	assert_null(HashTableLookup(&table, "key00"));
+
+	for (i = 0; i < N_ENTRIES; i += 3) {
+		HashTableRemove(&table, keys[i]);
+	}
+	size_t count = 0;
+	HashTableEnumerate(&table, _countEntries, &count);
+	assert_int_equal(count, HashTableSize(&table));
+	for (i = 0; i < N_ENTRIES; ++i) {
+		if (i % 3) {
+			assert_ptr_equal(HashTableLookup(&table, keys[i]), keys[i]);
+		} else {
+			assert_null(HashTableLookup(&table, keys[i]));
+		}
+	}
+	HashTableClear(&table);
+	assert_int_equal(HashTableSize(&table), 0);
+	HashTableDeinit(&table);
+}
+
+M_TEST_DEFINE(reserve) {
+	struct Table table;
+	TableInit(&table, 0, NULL);
+	TableInsert(&table, 7, (void*) (uintptr_t) 8);
+	TableReserve(&table, N_ENTRIES + 1);
+	size_t tableSize = table.tableSize;
+	assert_true(tableSize - (tableSize >> 2) >= N_ENTRIES + 1);
+	assert_ptr_equal(TableLookup(&table, 7), (void*) (uintptr_t) 8);
+
+	uint32_t i;
+	for (i = 0; i < N_ENTRIES; ++i) {
+		TableInsert(&table, i * 16, (void*) (uintptr_t) (i * 16 + 1));
+	}
+	assert_int_equal(table.tableSize, tableSize);
+	// Reserving less than is already there leaves the table alone
+	TableReserve(&table, 1);
+	assert_int_equal(table.tableSize, tableSize);
+	for (i = 0; i < N_ENTRIES; ++i) {
+		assert_ptr_equal(TableLookup(&table, i * 16), (void*) (uintptr_t) (i * 16 + 1));
+	}
+	TableDeinit(&table);
+}
+
+M_TEST_SUITE_DEFINE(Table,
+	cmocka_unit_test(insertLookupRemove),
+	cmocka_unit_test(replaceAndClear),
+	cmocka_unit_test(hashTableKeys),
+	cmocka_unit_test(reserve))
@@ -145,6 +145,34 @@ M_TEST_DEFINE(mapMemChunk) {
 	vf->close(vf);
 }
 
+M_TEST_DEFINE(reuseArenaChunk) {
+	uint8_t bytes[32] = "Test Pattern";
+	struct VFileMemArena* arena = VFileMemArenaCreate();
+	assert_non_null(arena);
+	struct VFile* vf = VFileMemArenaChunk(arena);
+	assert_non_null(vf);
+	assert_int_equal(vf->size(vf), 0);
+	assert_int_equal(vf->write(vf, bytes, sizeof(bytes)), sizeof(bytes));
+	void* mapped = vf->map(vf, sizeof(bytes), MAP_READ);
+	vf->unmap(vf, mapped, sizeof(bytes));
+	vf->close(vf);
+
+	struct VFile* vf2 = VFileMemArenaChunk(arena);
+	assert_ptr_equal(vf, vf2);
+	assert_int_equal(vf2->size(vf2), 0);
+	assert_int_equal(vf2->seek(vf2, 0, SEEK_CUR), 0);
+	assert_int_equal(vf2->write(vf2, bytes, 16), 16);
+	void* mapped2 = vf2->map(vf2, 16, MAP_READ);
+	assert_ptr_equal(mapped, mapped2);
+	vf2->unmap(vf2, mapped2, 16);
+
+	struct VFile* vf3 = VFileMemArenaChunk(arena);
+	assert_ptr_not_equal(vf2, vf3);
+	vf3->close(vf3);
+	vf2->close(vf2);
+	VFileMemArenaDestroy(arena);
+}
+
 M_TEST_SUITE_DEFINE(VFS,
 #if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
 	cmocka_unit_test(openNullPathR),
@@ -164,4 +192,5 @@ M_TEST_SUITE_DEFINE(VFS,
 	cmocka_unit_test(resizeMemChunk),
 	cmocka_unit_test(mapMem),
 	cmocka_unit_test(mapConstMem),
-	cmocka_unit_test(mapMemChunk))
+	cmocka_unit_test(mapMemChunk),
+	cmocka_unit_test(reuseArenaChunk))
@@ -172,7 +172,10 @@ static bool _vfdSync(struct VFile* vf, const void* buffer, size_t size) {
 	futimes(vfd->fd, NULL);
 #endif
 	if (buffer && size) {
-		return msync(buffer, size, MS_SYNC) == 0;
+		// msync needs a page-aligned start, which a range inside a mapping may not have
+		uintptr_t pageMask = sysconf(_SC_PAGESIZE) - 1;
+		uintptr_t start = (uintptr_t) buffer & ~pageMask;
+		return msync((void*) start, size + ((uintptr_t) buffer - start), MS_SYNC) == 0;
 	}
 	return fsync(vfd->fd) == 0;
 #else
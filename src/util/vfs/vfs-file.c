@@ -14,6 +14,8 @@ struct VFileFILE {
 	struct VFile d;
 	FILE* file;
 	bool writable;
+	const uint8_t* mapped;
+	size_t mappedSize;
 };
 
 static bool _vffClose(struct VFile* vf);
@@ -49,6 +51,8 @@ struct VFile* VFileFromFILE(FILE* file) {
 
 	vff->file = file;
 	vff->writable = false;
+	vff->mapped = NULL;
+	vff->mappedSize = 0;
 	vff->d.close = _vffClose;
 	vff->d.seek = _vffSeek;
 	vff->d.read = _vffRead;
@@ -101,6 +105,8 @@ static void* _vffMap(struct VFile* vf, size_t size, int flags) {
 	fseek(vff->file, 0, SEEK_SET);
 	fread(mem, size, 1, vff->file);
 	fseek(vff->file, pos, SEEK_SET);
+	vff->mapped = mem;
+	vff->mappedSize = size;
 	return mem;
 }
 
@@ -112,6 +118,10 @@ static void _vffUnmap(struct VFile* vf, void* memory, size_t size) {
 		fwrite(memory, size, 1, vff->file);
 		fseek(vff->file, pos, SEEK_SET);
 	}
+	if (memory == vff->mapped) {
+		vff->mapped = NULL;
+		vff->mappedSize = 0;
+	}
 	mappedMemoryFree(memory, size);
 }
 
@@ -148,7 +158,11 @@ static bool _vffSync(struct VFile* vf, const void* buffer, size_t size) {
 	struct VFileFILE* vff = (struct VFileFILE*) vf;
 	if (buffer && size) {
 		long pos = ftell(vff->file);
-		fseek(vff->file, 0, SEEK_SET);
+		long offset = 0;
+		if ((const uint8_t*) buffer > vff->mapped && (const uint8_t*) buffer < vff->mapped + vff->mappedSize) {
+			offset = (const uint8_t*) buffer - vff->mapped;
+		}
+		fseek(vff->file, offset, SEEK_SET);
 		fwrite(buffer, size, 1, vff->file);
 		fseek(vff->file, pos, SEEK_SET);
 	}
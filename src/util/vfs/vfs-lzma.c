@@ -24,10 +24,29 @@ struct VDirEntry7z {
 	char* utf8;
 };
 
+struct VDir7zBlock {
+	UInt32 folder;
+	Byte* buffer;
+	size_t size;
+	unsigned refs;
+	unsigned lastUse;
+	ISzAlloc alloc;
+};
+
+enum {
+	BLOCK_CACHE_ENTRIES = 4,
+	// The most recently used block is always kept, even if it alone exceeds this
+	BLOCK_CACHE_BUDGET = 0x4000000
+};
+
 struct VDir7z {
 	struct VDir d;
 	struct VDirEntry7z dirent;
 
+	// Decoded solid blocks, shared between every file opened from this archive
+	struct VDir7zBlock* blocks[BLOCK_CACHE_ENTRIES];
+	unsigned useCounter;
+
 	// What is all this garbage?
 	CFileInStream archiveStream;
 	CLookToRead lookStream;
@@ -39,7 +58,7 @@ struct VDir7z {
 struct VFile7z {
 	struct VFile d;
 
-	struct VDir7z* vd;
+	struct VDir7zBlock* block;
 
 	size_t offset;
 
@@ -104,6 +123,9 @@ struct VDir* VDirOpen7z(const char* path, int flags) {
 		return 0;
 	}
 
+	memset(vd->blocks, 0, sizeof(vd->blocks));
+	vd->useCounter = 0;
+
 	vd->dirent.index = -1;
 	vd->dirent.utf8 = 0;
 	vd->dirent.vd = vd;
@@ -120,9 +142,121 @@ struct VDir* VDirOpen7z(const char* path, int flags) {
 	return &vd->d;
 }
 
+static void _vd7zBlockUnref(struct VDir7zBlock* block) {
+	if (!block) {
+		return;
+	}
+	--block->refs;
+	if (!block->refs) {
+		IAlloc_Free(&block->alloc, block->buffer);
+		free(block);
+	}
+}
+
+static void _vd7zBlockInsert(struct VDir7z* vd7z, struct VDir7zBlock* block) {
+	size_t total = block->size;
+	size_t i;
+	for (i = 0; i < BLOCK_CACHE_ENTRIES; ++i) {
+		if (vd7z->blocks[i]) {
+			total += vd7z->blocks[i]->size;
+		}
+	}
+	while (true) {
+		size_t oldest = BLOCK_CACHE_ENTRIES;
+		size_t empty = BLOCK_CACHE_ENTRIES;
+		for (i = 0; i < BLOCK_CACHE_ENTRIES; ++i) {
+			if (!vd7z->blocks[i]) {
+				empty = i;
+			} else if (oldest == BLOCK_CACHE_ENTRIES || vd7z->blocks[i]->lastUse < vd7z->blocks[oldest]->lastUse) {
+				oldest = i;
+			}
+		}
+		if (empty < BLOCK_CACHE_ENTRIES && (total <= BLOCK_CACHE_BUDGET || oldest == BLOCK_CACHE_ENTRIES)) {
+			++block->refs;
+			vd7z->blocks[empty] = block;
+			return;
+		}
+		total -= vd7z->blocks[oldest]->size;
+		_vd7zBlockUnref(vd7z->blocks[oldest]);
+		vd7z->blocks[oldest] = NULL;
+	}
+}
+
+static void _vd7zBlockEvict(struct VDir7z* vd7z, struct VDir7zBlock* block) {
+	size_t i;
+	for (i = 0; i < BLOCK_CACHE_ENTRIES; ++i) {
+		if (vd7z->blocks[i] == block) {
+			_vd7zBlockUnref(block);
+			vd7z->blocks[i] = NULL;
+		}
+	}
+}
+
+static SRes _vd7zExtract(struct VDir7z* vd7z, UInt32 index, struct VFile7z* vf) {
+	UInt32 folder = vd7z->db.FileToFolder[index];
+	vf->block = NULL;
+	vf->outBuffer = NULL;
+	vf->bufferOffset = 0;
+	vf->size = 0;
+	if (folder == (UInt32) -1) {
+		// Empty file
+		return SZ_OK;
+	}
+
+	size_t i;
+	for (i = 0; i < BLOCK_CACHE_ENTRIES; ++i) {
+		struct VDir7zBlock* block = vd7z->blocks[i];
+		if (!block || block->folder != folder) {
+			continue;
+		}
+		// The block is already decoded, so this only locates the file in it and checks its CRC
+		UInt32 blockIndex = folder;
+		Byte* buffer = block->buffer;
+		size_t bufferSize = block->size;
+		SRes res = SzArEx_Extract(&vd7z->db, &vd7z->lookStream.s, index, &blockIndex,
+			&buffer, &bufferSize,
+			&vf->bufferOffset, &vf->size,
+			&vd7z->allocImp, &vd7z->allocTempImp);
+		if (res != SZ_OK) {
+			_vd7zBlockEvict(vd7z, block);
+			break;
+		}
+		block->lastUse = ++vd7z->useCounter;
+		++block->refs;
+		vf->block = block;
+		vf->outBuffer = block->buffer;
+		return SZ_OK;
+	}
+
+	UInt32 blockIndex = (UInt32) -1;
+	Byte* buffer = NULL;
+	size_t bufferSize = 0;
+	SRes res = SzArEx_Extract(&vd7z->db, &vd7z->lookStream.s, index, &blockIndex,
+		&buffer, &bufferSize,
+		&vf->bufferOffset, &vf->size,
+		&vd7z->allocImp, &vd7z->allocTempImp);
+	if (res != SZ_OK) {
+		IAlloc_Free(&vd7z->allocImp, buffer);
+		return res;
+	}
+
+	struct VDir7zBlock* block = malloc(sizeof(*block));
+	block->folder = folder;
+	block->buffer = buffer;
+	block->size = bufferSize;
+	block->refs = 1;
+	block->lastUse = ++vd7z->useCounter;
+	block->alloc = vd7z->allocImp;
+	_vd7zBlockInsert(vd7z, block);
+	vf->block = block;
+	vf->outBuffer = buffer;
+	return SZ_OK;
+}
+
 bool _vf7zClose(struct VFile* vf) {
 	struct VFile7z* vf7z = (struct VFile7z*) vf;
-	IAlloc_Free(&vf7z->vd->allocImp, vf7z->outBuffer);
+	_vd7zBlockUnref(vf7z->block);
+	free(vf7z);
 	return true;
 }
 
@@ -208,6 +342,10 @@ ssize_t _vf7zSize(struct VFile* vf) {
 
 bool _vd7zClose(struct VDir* vd) {
 	struct VDir7z* vd7z = (struct VDir7z*) vd;
+	size_t i;
+	for (i = 0; i < BLOCK_CACHE_ENTRIES; ++i) {
+		_vd7zBlockUnref(vd7z->blocks[i]);
+	}
 	SzArEx_Free(&vd7z->db, &vd7z->allocImp);
 	File_Close(&vd7z->archiveStream.file);
 
@@ -275,17 +413,7 @@ struct VFile* _vd7zOpenFile(struct VDir* vd, const char* path, int mode) {
 	}
 
 	struct VFile7z* vf = malloc(sizeof(struct VFile7z));
-	vf->vd = vd7z;
-
-	size_t outBufferSize;
-	UInt32 blockIndex;
-
-	vf->outBuffer = 0;
-	SRes res = SzArEx_Extract(&vd7z->db, &vd7z->lookStream.s, i, &blockIndex,
-		&vf->outBuffer, &outBufferSize,
-		&vf->bufferOffset, &vf->size,
-		&vd7z->allocImp, &vd7z->allocTempImp);
-
+	SRes res = _vd7zExtract(vd7z, i, vf);
 	if (res != SZ_OK) {
 		free(vf);
 		return 0;
@@ -6,6 +6,13 @@
 #include <mgba-util/vfs.h>
 #include <mgba-util/math.h>
 #include <mgba-util/memory.h>
+#include <mgba-util/threading.h>
+
+enum {
+	// Growing chunks start at a page, so small writes don't remap the buffer at every power of two
+	MEM_CHUNK_MIN_SIZE = 0x1000,
+	MEM_ARENA_MAX_FREE = 16
+};
 
 struct VFileMem {
 	struct VFile d;
@@ -13,10 +20,18 @@ struct VFileMem {
 	size_t size;
 	size_t bufferSize;
 	size_t offset;
+	struct VFileMemArena* arena;
+};
+
+struct VFileMemArena {
+	struct VFileMem* free[MEM_ARENA_MAX_FREE];
+	size_t nFree;
+	Mutex mutex;
 };
 
 static bool _vfmClose(struct VFile* vf);
 static bool _vfmCloseFree(struct VFile* vf);
+static bool _vfmCloseArena(struct VFile* vf);
 static off_t _vfmSeek(struct VFile* vf, off_t offset, int whence);
 static off_t _vfmSeekExpanding(struct VFile* vf, off_t offset, int whence);
 static ssize_t _vfmRead(struct VFile* vf, void* buffer, size_t size);
@@ -44,6 +59,7 @@ struct VFile* VFileFromMemory(void* mem, size_t size) {
 	vfm->size = size;
 	vfm->bufferSize = size;
 	vfm->offset = 0;
+	vfm->arena = NULL;
 	vfm->d.close = _vfmClose;
 	vfm->d.seek = _vfmSeek;
 	vfm->d.read = _vfmRead;
@@ -72,6 +88,7 @@ struct VFile* VFileFromConstMemory(const void* mem, size_t size) {
 	vfm->size = size;
 	vfm->bufferSize = size;
 	vfm->offset = 0;
+	vfm->arena = NULL;
 	vfm->d.close = _vfmClose;
 	vfm->d.seek = _vfmSeek;
 	vfm->d.read = _vfmRead;
@@ -103,6 +120,7 @@ struct VFile* VFileMemChunk(const void* mem, size_t size) {
 		vfm->mem = 0;
 	}
 	vfm->offset = 0;
+	vfm->arena = NULL;
 	vfm->d.close = _vfmCloseFree;
 	vfm->d.seek = _vfmSeekExpanding;
 	vfm->d.read = _vfmRead;
@@ -117,8 +135,54 @@ struct VFile* VFileMemChunk(const void* mem, size_t size) {
 	return &vfm->d;
 }
 
+struct VFileMemArena* VFileMemArenaCreate(void) {
+	struct VFileMemArena* arena = malloc(sizeof(*arena));
+	if (!arena) {
+		return 0;
+	}
+	arena->nFree = 0;
+	MutexInit(&arena->mutex);
+	return arena;
+}
+
+void VFileMemArenaDestroy(struct VFileMemArena* arena) {
+	size_t i;
+	for (i = 0; i < arena->nFree; ++i) {
+		_vfmCloseFree(&arena->free[i]->d);
+	}
+	MutexDeinit(&arena->mutex);
+	free(arena);
+}
+
+struct VFile* VFileMemArenaChunk(struct VFileMemArena* arena) {
+	struct VFileMem* vfm = NULL;
+	MutexLock(&arena->mutex);
+	if (arena->nFree) {
+		--arena->nFree;
+		vfm = arena->free[arena->nFree];
+	}
+	MutexUnlock(&arena->mutex);
+
+	if (!vfm) {
+		struct VFile* vf = VFileMemChunk(NULL, 0);
+		if (!vf) {
+			return 0;
+		}
+		vfm = (struct VFileMem*) vf;
+		vfm->arena = arena;
+		vfm->d.close = _vfmCloseArena;
+	}
+	// The buffer is kept from the last user, so only the length is reset
+	vfm->size = 0;
+	vfm->offset = 0;
+	return &vfm->d;
+}
+
 void _vfmExpand(struct VFileMem* vfm, size_t newSize) {
 	size_t alignedSize = toPow2(newSize);
+	if (alignedSize < MEM_CHUNK_MIN_SIZE) {
+		alignedSize = MEM_CHUNK_MIN_SIZE;
+	}
 	if (alignedSize > vfm->bufferSize) {
 		void* oldBuf = vfm->mem;
 		vfm->mem = anonymousMemoryMap(alignedSize);
@@ -150,6 +214,22 @@ bool _vfmCloseFree(struct VFile* vf) {
 	return true;
 }
 
+bool _vfmCloseArena(struct VFile* vf) {
+	struct VFileMem* vfm = (struct VFileMem*) vf;
+	struct VFileMemArena* arena = vfm->arena;
+	MutexLock(&arena->mutex);
+	if (arena->nFree < MEM_ARENA_MAX_FREE) {
+		arena->free[arena->nFree] = vfm;
+		++arena->nFree;
+		vfm = NULL;
+	}
+	MutexUnlock(&arena->mutex);
+	if (vfm) {
+		return _vfmCloseFree(vf);
+	}
+	return true;
+}
+
 off_t _vfmSeek(struct VFile* vf, off_t offset, int whence) {
 	struct VFileMem* vfm = (struct VFileMem*) vf;
 
@@ -42,6 +42,7 @@ enum {
 #include "third-party/zlib/contrib/minizip/unzip.h"
 #endif
 #include <mgba-util/memory.h>
+#include <mgba-util/table.h>
 
 struct VDirEntryZip {
 	struct VDirEntry d;
@@ -53,16 +54,41 @@ struct VDirEntryZip {
 struct VDirZip {
 	struct VDir d;
 	unzFile z;
+	char* path;
 	struct VDirEntryZip dirent;
+	struct Table index;
+	bool indexed;
 	bool atStart;
 };
 
+struct VFileZipCheckpoint {
+	z_stream stream;
+	size_t inOffset;
+	bool valid;
+};
+
 struct VFileZip {
 	struct VFile d;
-	unzFile z;
+	struct VFile* source;
 	void* buffer;
 	size_t bufferSize;
 	size_t fileSize;
+	size_t compressedSize;
+	off_t dataOffset;
+	size_t offset;
+	size_t inOffset;
+	bool deflated;
+	bool streamEnd;
+	z_stream stream;
+	struct VFileZipCheckpoint* checkpoints;
+	size_t nCheckpoints;
+	uint8_t input[0x4000];
+};
+
+enum {
+	// Inflate state is snapshotted every time this many bytes have been output, so seeking
+	// backwards only needs to re-inflate from the nearest checkpoint
+	CHECKPOINT_INTERVAL = 0x40000
 };
 #endif
 
@@ -184,6 +210,9 @@ struct VDir* VDirOpenZip(const char* path, int flags) {
 	vd->z = z;
 
 #ifndef USE_LIBZIP
+	vd->path = strdup(path);
+	HashTableInit(&vd->index, 0, free);
+	vd->indexed = false;
 	vd->atStart = true;
 #endif
 
@@ -451,7 +480,17 @@ static enum VFSType _vdezType(struct VDirEntry* vde) {
 #else
 bool _vfzClose(struct VFile* vf) {
 	struct VFileZip* vfz = (struct VFileZip*) vf;
-	unzCloseCurrentFile(vfz->z);
+	if (vfz->deflated) {
+		inflateEnd(&vfz->stream);
+		size_t i;
+		for (i = 0; i < vfz->nCheckpoints; ++i) {
+			if (vfz->checkpoints[i].valid) {
+				inflateEnd(&vfz->checkpoints[i].stream);
+			}
+		}
+		free(vfz->checkpoints);
+	}
+	vfz->source->close(vfz->source);
 	if (vfz->buffer) {
 		mappedMemoryFree(vfz->buffer, vfz->bufferSize);
 	}
@@ -459,17 +498,94 @@ bool _vfzClose(struct VFile* vf) {
 	return true;
 }
 
+static void _vfzCheckpoint(struct VFileZip* vfz) {
+	size_t index = vfz->offset / CHECKPOINT_INTERVAL;
+	if (index >= vfz->nCheckpoints || vfz->checkpoints[index].valid) {
+		return;
+	}
+	struct VFileZipCheckpoint* checkpoint = &vfz->checkpoints[index];
+	if (inflateCopy(&checkpoint->stream, &vfz->stream) != Z_OK) {
+		return;
+	}
+	checkpoint->inOffset = vfz->inOffset - vfz->stream.avail_in;
+	checkpoint->valid = true;
+}
+
+static bool _vfzRestore(struct VFileZip* vfz, size_t index) {
+	if (index && vfz->checkpoints[index].valid) {
+		inflateEnd(&vfz->stream);
+		if (inflateCopy(&vfz->stream, &vfz->checkpoints[index].stream) != Z_OK) {
+			memset(&vfz->stream, 0, sizeof(vfz->stream));
+			if (inflateInit2(&vfz->stream, -MAX_WBITS) != Z_OK) {
+				vfz->deflated = false;
+				return false;
+			}
+			index = 0;
+		}
+	} else {
+		index = 0;
+		inflateReset(&vfz->stream);
+	}
+	vfz->inOffset = index ? vfz->checkpoints[index].inOffset : 0;
+	vfz->offset = index * CHECKPOINT_INTERVAL;
+	vfz->streamEnd = false;
+	vfz->stream.next_in = vfz->input;
+	vfz->stream.avail_in = 0;
+	return vfz->source->seek(vfz->source, vfz->dataOffset + vfz->inOffset, SEEK_SET) >= 0;
+}
+
+static ssize_t _vfzInflate(struct VFileZip* vfz, uint8_t* buffer, size_t size) {
+	size_t total = 0;
+	while (size && !vfz->streamEnd) {
+		if (!vfz->stream.avail_in) {
+			size_t toRead = vfz->compressedSize - vfz->inOffset;
+			if (toRead > sizeof(vfz->input)) {
+				toRead = sizeof(vfz->input);
+			}
+			ssize_t read = toRead ? vfz->source->read(vfz->source, vfz->input, toRead) : 0;
+			if (read <= 0) {
+				break;
+			}
+			vfz->stream.next_in = vfz->input;
+			vfz->stream.avail_in = read;
+			vfz->inOffset += read;
+		}
+
+		// Stop at each checkpoint boundary so the state there can be saved
+		size_t chunk = CHECKPOINT_INTERVAL - vfz->offset % CHECKPOINT_INTERVAL;
+		if (chunk > size) {
+			chunk = size;
+		}
+		vfz->stream.next_out = buffer;
+		vfz->stream.avail_out = chunk;
+		int status = inflate(&vfz->stream, Z_NO_FLUSH);
+		size_t produced = chunk - vfz->stream.avail_out;
+		buffer += produced;
+		size -= produced;
+		total += produced;
+		vfz->offset += produced;
+		if (status == Z_STREAM_END) {
+			vfz->streamEnd = true;
+		} else if (status != Z_OK && status != Z_BUF_ERROR) {
+			return total ? (ssize_t) total : -1;
+		}
+		if (produced && !(vfz->offset % CHECKPOINT_INTERVAL)) {
+			_vfzCheckpoint(vfz);
+		}
+	}
+	return total;
+}
+
 off_t _vfzSeek(struct VFile* vf, off_t offset, int whence) {
 	struct VFileZip* vfz = (struct VFileZip*) vf;
 
-	int64_t currentPos = unztell64(vfz->z);
 	int64_t pos;
 	switch (whence) {
 	case SEEK_SET:
 		pos = 0;
 		break;
 	case SEEK_CUR:
-		pos = unztell64(vfz->z);
+		pos = vfz->offset;
 		break;
 	case SEEK_END:
 		pos = vfz->fileSize;
@@ -478,34 +594,55 @@ off_t _vfzSeek(struct VFile* vf, off_t offset, int whence) {
 		return -1;
 	}
 
-	if (pos < 0 || pos + offset < 0) {
+	if (pos < 0 || pos + offset < 0 || (size_t) (pos + offset) > vfz->fileSize) {
 		return -1;
 	}
 	pos += offset;
-	if (currentPos > pos) {
-		unzCloseCurrentFile(vfz->z);
-		unzOpenCurrentFile(vfz->z);
-		currentPos = 0;
-	}
-	while (currentPos < pos) {
-		char tempBuf[1024];
-		ssize_t toRead = sizeof(tempBuf);
-		if (toRead > pos - currentPos) {
-			toRead = pos - currentPos;
+	if (!vfz->deflated) {
+		if (vfz->source->seek(vfz->source, vfz->dataOffset + pos, SEEK_SET) < 0) {
+			return -1;
+		}
+		vfz->offset = pos;
+		return pos;
+	}
+
+	size_t index = pos / CHECKPOINT_INTERVAL;
+	while (index && !vfz->checkpoints[index].valid) {
+		--index;
+	}
+	if ((size_t) pos < vfz->offset || index * CHECKPOINT_INTERVAL > vfz->offset) {
+		if (!_vfzRestore(vfz, index)) {
+			return -1;
+		}
+	}
+	while (vfz->offset < (size_t) pos) {
+		uint8_t tempBuf[0x4000];
+		size_t toRead = sizeof(tempBuf);
+		if (toRead > pos - vfz->offset) {
+			toRead = pos - vfz->offset;
 		}
-		ssize_t read = vf->read(vf, tempBuf, toRead);
-		if (read < toRead) {
+		ssize_t read = _vfzInflate(vfz, tempBuf, toRead);
+		if (read <= 0) {
 			return -1;
 		}
-		currentPos += read;
 	}
 
-	return unztell64(vfz->z);
+	return vfz->offset;
 }
 
 ssize_t _vfzRead(struct VFile* vf, void* buffer, size_t size) {
 	struct VFileZip* vfz = (struct VFileZip*) vf;
-	return unzReadCurrentFile(vfz->z, buffer, size);
+	if (size > vfz->fileSize - vfz->offset) {
+		size = vfz->fileSize - vfz->offset;
+	}
+	if (vfz->deflated) {
+		return _vfzInflate(vfz, buffer, size);
+	}
+	ssize_t read = vfz->source->read(vfz->source, buffer, size);
+	if (read > 0) {
+		vfz->offset += read;
+	}
+	return read;
 }
 
 ssize_t _vfzWrite(struct VFile* vf, const void* buffer, size_t size) {
@@ -532,11 +669,9 @@ void* _vfzMap(struct VFile* vf, size_t size, int flags) {
 		return 0;
 	}
 
-	unzCloseCurrentFile(vfz->z);
-	unzOpenCurrentFile(vfz->z);
-	vf->read(vf, vfz->buffer, size);
-	unzCloseCurrentFile(vfz->z);
-	unzOpenCurrentFile(vfz->z);
+	if (vf->seek(vf, 0, SEEK_SET) == 0) {
+		vf->read(vf, vfz->buffer, size);
+	}
 	vf->seek(vf, pos, SEEK_SET);
 
 	vfz->bufferSize = size;
@@ -571,6 +706,8 @@ bool _vdzClose(struct VDir* vd) {
 	if (unzClose(vdz->z) < 0) {
 		return false;
 	}
+	HashTableDeinit(&vdz->index);
+	free(vdz->path);
 	free(vdz);
 	return true;
 }
@@ -598,6 +735,33 @@ struct VDirEntry* _vdzListNext(struct VDir* vd) {
 	return &vdz->dirent.d;
 }
 
+static void _vdzBuildIndex(struct VDirZip* vdz) {
+	// Remember the listing position so that a scan in progress isn't disturbed
+	unz64_file_pos current;
+	bool listing = unzGetFilePos64(vdz->z, &current) == UNZ_OK;
+	char name[PATH_MAX];
+	int status;
+	for (status = unzGoToFirstFile(vdz->z); status == UNZ_OK; status = unzGoToNextFile(vdz->z)) {
+		if (unzGetCurrentFileInfo64(vdz->z, 0, name, sizeof(name), 0, 0, 0, 0) != UNZ_OK) {
+			continue;
+		}
+		if (HashTableLookup(&vdz->index, name)) {
+			// unzLocateFile finds the first entry with a given name
+			continue;
+		}
+		unz64_file_pos* pos = malloc(sizeof(*pos));
+		if (unzGetFilePos64(vdz->z, pos) != UNZ_OK) {
+			free(pos);
+			continue;
+		}
+		HashTableInsert(&vdz->index, name, pos);
+	}
+	if (listing) {
+		unzGoToFilePos64(vdz->z, &current);
+	}
+	vdz->indexed = true;
+}
+
 struct VFile* _vdzOpenFile(struct VDir* vd, const char* path, int mode) {
 	UNUSED(mode);
 	struct VDirZip* vdz = (struct VDirZip*) vd;
@@ -607,11 +771,16 @@ struct VFile* _vdzOpenFile(struct VDir* vd, const char* path, int mode) {
 		return 0;
 	}
 
-	if (unzLocateFile(vdz->z, path, 0) != UNZ_OK) {
-		return 0;
+	if (!vdz->indexed) {
+		_vdzBuildIndex(vdz);
 	}
-
-	if (unzOpenCurrentFile(vdz->z) < 0) {
+	// Misses still go through minizip's own lookup, which may be case-insensitive on some platforms
+	const unz64_file_pos* pos = HashTableLookup(&vdz->index, path);
+	if (pos) {
+		if (unzGoToFilePos64(vdz->z, pos) != UNZ_OK) {
+			return 0;
+		}
+	} else if (unzLocateFile(vdz->z, path, 0) != UNZ_OK) {
 		return 0;
 	}
 
@@ -620,12 +789,50 @@ struct VFile* _vdzOpenFile(struct VDir* vd, const char* path, int mode) {
 	if (status < 0) {
 		return 0;
 	}
+	if ((info.flag & 1) || (info.compression_method != 0 && info.compression_method != Z_DEFLATED)) {
+		// Encrypted and non-deflate entries aren't supported
+		return 0;
+	}
+
+	if (unzOpenCurrentFile(vdz->z) < 0) {
+		return 0;
+	}
+	ZPOS64_T dataOffset = unzGetCurrentFileZStreamPos64(vdz->z);
+	unzCloseCurrentFile(vdz->z);
+
+	// Each file reads the archive through its own handle, so it can seek without minizip's help
+	struct VFile* source = VFileOpen(vdz->path, O_RDONLY);
+	if (!source) {
+		return 0;
+	}
+	if (source->seek(source, dataOffset, SEEK_SET) < 0) {
+		source->close(source);
+		return 0;
+	}
 
 	struct VFileZip* vfz = malloc(sizeof(struct VFileZip));
-	vfz->z = vdz->z;
+	vfz->source = source;
 	vfz->buffer = 0;
 	vfz->bufferSize = 0;
 	vfz->fileSize = info.uncompressed_size;
+	vfz->compressedSize = info.compressed_size;
+	vfz->dataOffset = dataOffset;
+	vfz->offset = 0;
+	vfz->inOffset = 0;
+	vfz->deflated = info.compression_method == Z_DEFLATED;
+	vfz->streamEnd = false;
+	vfz->checkpoints = NULL;
+	vfz->nCheckpoints = 0;
+	if (vfz->deflated) {
+		memset(&vfz->stream, 0, sizeof(vfz->stream));
+		if (inflateInit2(&vfz->stream, -MAX_WBITS) != Z_OK) {
+			source->close(source);
+			free(vfz);
+			return 0;
+		}
+		vfz->nCheckpoints = vfz->fileSize / CHECKPOINT_INTERVAL + 1;
+		vfz->checkpoints = calloc(vfz->nCheckpoints, sizeof(*vfz->checkpoints));
+	}
 
 	vfz->d.close = _vfzClose;
 	vfz->d.seek = _vfzSeek;
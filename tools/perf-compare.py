@@ -0,0 +1,69 @@
+#!/usr/bin/env python
+from __future__ import print_function
+import argparse
+import json
+import sys
+
+METRICS = ('mean', 'median', 'p95', 'p99')
+
+
+def load(path):
+    with open(path) as f:
+        results = json.load(f)
+    scenes = {}
+    for scene in results['scenes']:
+        scenes[(scene['rom'], scene['savestate'], scene['frames'])] = scene
+    return results, scenes
+
+
+def delta(base, new):
+    if not base:
+        return 0.
+    return (new - base) * 100. / base
+
+
+def scene_name(key):
+    rom, savestate, frames = key
+    name = rom
+    if savestate:
+        name += ' @ ' + savestate
+    return '{} ({} frames)'.format(name, frames)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Compare two mgba-perf -R benchmark results')
+    parser.add_argument('-t', '--threshold', type=float, default=0, metavar='PERCENT',
+                        help='exit with an error if any median frame time regresses by more than PERCENT')
+    parser.add_argument('baseline', help='results to compare against')
+    parser.add_argument('candidate', help='results to compare')
+    args = parser.parse_args()
+
+    base_results, base = load(args.baseline)
+    new_results, new = load(args.candidate)
+    for setting in ('renderer', 'warmup', 'repetitions'):
+        if base_results[setting] != new_results[setting]:
+            print('Warning: {} differs ({} vs {})'.format(setting, base_results[setting], new_results[setting]), file=sys.stderr)
+
+    regressed = False
+    for key in sorted(set(base) | set(new), key=lambda k: (k[0], k[1] or '', k[2])):
+        print(scene_name(key))
+        if key not in base or key not in new:
+            print('  only in {}'.format(args.baseline if key in base else args.candidate))
+            continue
+        old_times = base[key]['frame_time_us']
+        new_times = new[key]['frame_time_us']
+        for metric in METRICS:
+            change = delta(old_times[metric], new_times[metric])
+            print('  {:<8} {:>12.1f} us {:>12.1f} us {:>+8.2f}%'.format(metric, old_times[metric], new_times[metric], change))
+        print('  {:<8} {:>12.1f} us {:>12.1f} us'.format('stddev', old_times['stddev'], new_times['stddev']))
+        print('  {:<8} {:>15.1f} {:>15.1f} {:>+8.2f}%'.format('fps', base[key]['fps'], new[key]['fps'], delta(base[key]['fps'], new[key]['fps'])))
+        if 'instructions_per_second' in base[key] and 'instructions_per_second' in new[key]:
+            old_ips = base[key]['instructions_per_second']
+            new_ips = new[key]['instructions_per_second']
+            print('  {:<8} {:>15.0f} {:>15.0f} {:>+8.2f}%'.format('ips', old_ips, new_ips, delta(old_ips, new_ips)))
+        if args.threshold and delta(old_times['median'], new_times['median']) > args.threshold:
+            regressed = True
+            print('  REGRESSION: median frame time is up by more than {}%'.format(args.threshold))
+
+    if regressed:
+        sys.exit(1)